@@ -1,11 +1,52 @@
 #include <benchmark/benchmark.h>
-#include "blockchain/Block.hpp"
+#include "Workloads.hpp"
+#include "blockchain/BlockPacker.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <vector>
 
+using namespace quids;
+using namespace quids::bench;
+
+// Encoded transfers in, packed block with its transaction root out:
+// parse, verify and offer each one, seal, then hash the chosen ones
 static void BM_BlockCreation(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    std::vector<blockchain::ByteVector> encoded;
+    for (size_t i = 0; i < count; ++i) {
+        // Four transactions per sender, so nonce chains are packed too
+        encoded.push_back(signedTransfer(accountName(i / 4), accountName(i / 4 + 1), 1, i % 4));
+    }
+
+    blockchain::BlockPackerConfig config;
+    config.maxTransactionsPerBlock = count;
+    config.maxGasPerBlock = count * 21000;
     for (auto _ : state) {
-        // Add benchmark implementation
+        std::vector<blockchain::TransactionView> views;
+        views.reserve(count);
+        blockchain::BlockPacker packer(config);
+        for (size_t i = 0; i < count; ++i) {
+            auto view = blockchain::TransactionView::parse(encoded[i]);
+            if (!view || !view->verify()) {
+                continue;
+            }
+            blockchain::BlockPacker::Candidate candidate;
+            candidate.id = views.size();
+            candidate.sender = std::string(view->getSender());
+            candidate.nonce = view->getNonce();
+            candidate.gasPrice = 1 + i % 50;
+            candidate.gasLimit = 21000;
+            packer.offer(std::move(candidate));
+            views.push_back(*view);
+        }
+        const auto block = packer.seal();
+
+        crypto::MerkleBuilder builder;
+        for (const uint64_t id : block.ids) {
+            builder.appendHash(views[id].computeHash());
+        }
+        benchmark::DoNotOptimize(builder.root());
     }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
 }
-BENCHMARK(BM_BlockCreation);
-
-BENCHMARK_MAIN();
\ No newline at end of file
+BENCHMARK(BM_BlockCreation)->Arg(100)->Arg(1000);
@@ -0,0 +1,126 @@
+// Multi-node cluster simulation; see ClusterSimulator.hpp.
+//
+//   quids_cluster_sim --nodes=100 --latency-ms=40 --loss=0.01
+//   quids_cluster_sim --nodes=30 --partition=5000:8000:10 --deterministic
+//
+// Options: --nodes, --peers, --latency-ms, --jitter-ms, --bandwidth-mbps
+// (0 for unlimited), --loss, --batches, --batch-bytes, --interval-ms,
+// --partition=<from ms>:<until ms>:<first n nodes>, repeatable as a
+// comma-separated list, --announce (batches by announcement), --wall
+// (real clock), --deterministic (no CPU charge), --per-node, --seed.
+
+#include "ClusterSimulator.hpp"
+#include <cstdio>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace quids;
+using namespace quids::bench;
+
+namespace {
+
+std::map<std::string, std::string> parseArgs(int argc, char** argv) {
+    std::map<std::string, std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            throw std::invalid_argument("expected --name[=value], got " + arg);
+        }
+        const auto eq = arg.find('=');
+        args[arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2)] =
+            eq == std::string::npos ? "" : arg.substr(eq + 1);
+    }
+    return args;
+}
+
+std::vector<Partition> parsePartitions(const std::string& spec) {
+    std::vector<Partition> partitions;
+    std::stringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        long long from = 0;
+        long long until = 0;
+        size_t count = 0;
+        if (std::sscanf(item.c_str(), "%lld:%lld:%zu", &from, &until, &count) != 3 || until < from) {
+            throw std::invalid_argument("bad partition " + item);
+        }
+        Partition p{std::chrono::milliseconds(from), std::chrono::milliseconds(until), {}};
+        p.side.resize(count);
+        std::iota(p.side.begin(), p.side.end(), size_t{0});
+        partitions.push_back(std::move(p));
+    }
+    return partitions;
+}
+
+void printSamples(const char* name, const std::vector<double>& us) {
+    auto ms = [&](double p) { return ClusterReport::percentile(us, p) / 1e3; };
+    std::printf("%-11s p50 %9.3f  p90 %9.3f  p99 %9.3f  max %9.3f ms  (%zu samples)\n", name, ms(0.5), ms(0.9),
+                ms(0.99), ms(1.0), us.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ClusterConfig config;
+    bool per_node = false;
+    try {
+        for (const auto& [name, value] : parseArgs(argc, argv)) {
+            if (name == "nodes") config.nodes = std::stoul(value);
+            else if (name == "peers") config.peers = std::stoul(value);
+            else if (name == "latency-ms") config.link.latency = std::chrono::microseconds(static_cast<int64_t>(std::stod(value) * 1000));
+            else if (name == "jitter-ms") config.link.jitter = std::chrono::microseconds(static_cast<int64_t>(std::stod(value) * 1000));
+            else if (name == "bandwidth-mbps") config.link.bandwidth = static_cast<uint64_t>(std::stod(value) * 125'000);
+            else if (name == "loss") config.link.loss = std::stod(value);
+            else if (name == "batches") config.batches = std::stoul(value);
+            else if (name == "batch-bytes") config.batch_bytes = std::stoul(value);
+            else if (name == "interval-ms") config.batch_interval = std::chrono::milliseconds(std::stoll(value));
+            else if (name == "partition") config.partitions = parsePartitions(value);
+            else if (name == "announce") config.gossip.announce_topics = {ClusterSimulator::BATCH_TOPIC};
+            else if (name == "wall") config.virtual_clock = false;
+            else if (name == "deterministic") config.charge_cpu = false;
+            else if (name == "per-node") per_node = true;
+            else if (name == "seed") config.seed = std::stoull(value);
+            else throw std::invalid_argument("unknown option --" + name);
+        }
+        if (config.nodes == 0) {
+            throw std::invalid_argument("--nodes must be positive");
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+
+    ClusterSimulator simulator(config);
+    const auto report = simulator.run();
+
+    std::printf("%zu nodes, %zu/%zu batches final, coverage %.4f\n", config.nodes, report.finalized_batches,
+                report.batches, report.coverage);
+    std::printf("simulated %.2f s in %.2f s wall; frames lost %llu, partitioned %llu\n", report.simulated_seconds,
+                report.wall_seconds, static_cast<unsigned long long>(report.frames_lost),
+                static_cast<unsigned long long>(report.frames_partitioned));
+    printSamples("finality", report.finality_us);
+    printSamples("propagation", report.propagation_us);
+
+    std::vector<double> cpu;
+    uint64_t bytes = 0;
+    for (const auto& node : report.nodes) {
+        cpu.push_back(node.cpu_seconds * 1e3);
+        bytes += node.bytes_sent;
+    }
+    std::printf("cpu/node    p50 %9.3f  max %9.3f ms; sent %.1f MiB/node\n", ClusterReport::percentile(cpu, 0.5),
+                ClusterReport::percentile(cpu, 1.0),
+                static_cast<double>(bytes) / static_cast<double>(report.nodes.size()) / (1 << 20));
+    if (per_node) {
+        for (size_t i = 0; i < report.nodes.size(); ++i) {
+            const auto& n = report.nodes[i];
+            std::printf("%-9s cpu %8.3f ms  sent %8llu frames %10llu bytes  received %zu  final %zu  dup %llu\n",
+                        ClusterSimulator::peerName(i).c_str(), n.cpu_seconds * 1e3,
+                        static_cast<unsigned long long>(n.frames_sent), static_cast<unsigned long long>(n.bytes_sent),
+                        n.batches_received, n.batches_final, static_cast<unsigned long long>(n.gossip.duplicates));
+        }
+    }
+    return 0;
+}
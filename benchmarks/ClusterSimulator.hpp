@@ -0,0 +1,446 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "network/GossipRouter.hpp"
+#include "utils/RandomService.hpp"
+
+namespace quids {
+namespace bench {
+
+// In-process cluster of gossiping validators over a simulated network.
+//
+// Every node runs a real GossipRouter; only the wire is modelled. Frames
+// leave through the sender's uplink, which serializes them at a bandwidth,
+// then cross a link with a latency and jitter, and may be lost or cut by
+// a partition. Proposers take turns publishing a batch, every node that
+// receives one gossips a vote, and a node counts the batch final once it
+// has seen a quorum of votes.
+//
+// With the virtual clock, events run back to back in time order and the
+// real CPU time a node spends handling one is added to that node's clock,
+// as if each node had a core of its own. Turning charge_cpu off as well
+// makes a run a pure function of the seed. Without the virtual clock the
+// dispatcher sleeps until each event is due; nodes then share its one
+// thread, which only suits small clusters.
+
+struct LinkModel {
+    std::chrono::microseconds latency{20000};
+    // Uniform extra delay in [0, jitter)
+    std::chrono::microseconds jitter{5000};
+    // Uplink bytes per second per node, 0 for unlimited
+    uint64_t bandwidth{12'500'000};
+    // Probability a frame never arrives
+    double loss{0.0};
+};
+
+// Cuts the nodes in `side` off from the rest during [from, until)
+struct Partition {
+    std::chrono::milliseconds from{0};
+    std::chrono::milliseconds until{0};
+    std::vector<size_t> side;
+};
+
+inline network::GossipRouter::Config clusterGossipConfig() {
+    network::GossipRouter::Config config;
+    // A node sees a few thousand messages a second here; the default
+    // filter would cost 2 MiB a node
+    config.seen_filter_bits = 1u << 20;
+    return config;
+}
+
+struct ClusterConfig {
+    size_t nodes{16};
+    // Links each node opens to random others; links carry both ways
+    size_t peers{8};
+    LinkModel link;
+    std::vector<Partition> partitions;
+    network::GossipRouter::Config gossip{clusterGossipConfig()};
+    std::chrono::milliseconds heartbeat{700};
+    std::chrono::milliseconds announce_flush{10};
+    // Meshes form before the first proposal
+    std::chrono::milliseconds warmup{3000};
+    // One batch of batch_bytes every batch_interval, proposers round robin
+    std::chrono::milliseconds batch_interval{200};
+    size_t batch_bytes{16 * 1024};
+    size_t batches{50};
+    // Kept running after the last proposal for stragglers
+    std::chrono::milliseconds drain{5000};
+    double quorum{2.0 / 3.0};
+    bool virtual_clock{true};
+    bool charge_cpu{true};
+    uint64_t seed{1};
+};
+
+struct NodeReport {
+    double cpu_seconds{0.0};
+    uint64_t frames_sent{0};
+    uint64_t bytes_sent{0};
+    size_t batches_received{0};
+    size_t batches_final{0};
+    network::GossipRouter::Stats gossip;
+};
+
+struct ClusterReport {
+    // Proposal to the moment a quorum of nodes held the batch final
+    std::vector<double> finality_us;
+    // Proposal to arrival, one sample per receiving node and batch
+    std::vector<double> propagation_us;
+    size_t batches{0};
+    size_t finalized_batches{0};
+    // Share of (batch, non-proposer) pairs where the batch arrived
+    double coverage{0.0};
+    uint64_t frames_lost{0};
+    uint64_t frames_partitioned{0};
+    double simulated_seconds{0.0};
+    double wall_seconds{0.0};
+    std::vector<NodeReport> nodes;
+
+    static double percentile(const std::vector<double>& samples, double p) {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+};
+
+class ClusterSimulator {
+public:
+    static constexpr const char* BATCH_TOPIC = "batches";
+    static constexpr const char* VOTE_TOPIC = "votes";
+
+    explicit ClusterSimulator(const ClusterConfig& config)
+        : config_(config), rng_(config.seed, 2),
+          quorum_(std::max<size_t>(1, static_cast<size_t>(std::ceil(config.quorum * static_cast<double>(config.nodes))))),
+          batches_(config.batches), nodes_(config.nodes) {
+        for (const auto& partition : config_.partitions) {
+            std::vector<uint8_t> side(config_.nodes, 0);
+            for (size_t node : partition.side) {
+                if (node < side.size()) {
+                    side[node] = 1;
+                }
+            }
+            cuts_.push_back({ns(partition.from), ns(partition.until), std::move(side)});
+        }
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            auto gossip = config_.gossip;
+            gossip.seed = config_.seed * 1'000'003 + i;
+            nodes_[i].router = std::make_unique<network::GossipRouter>(
+                gossip, [this, i](const std::string& peer, std::vector<uint8_t>&& frame) {
+                    nodes_[i].outbox.emplace_back(indexOf(peer), std::move(frame));
+                });
+        }
+    }
+
+    ClusterSimulator(const ClusterSimulator&) = delete;
+    ClusterSimulator& operator=(const ClusterSimulator&) = delete;
+
+    ClusterReport run() {
+        const int64_t end = ns(config_.warmup) + static_cast<int64_t>(config_.batches) * ns(config_.batch_interval) +
+                            ns(config_.drain);
+        setup(end);
+
+        const auto wall_start = std::chrono::steady_clock::now();
+        while (!events_.empty() && events_.top().at <= end) {
+            // The heap orders by time only, so moving the callback out is safe
+            Event event = std::move(const_cast<Event&>(events_.top()));
+            events_.pop();
+            if (config_.virtual_clock) {
+                now_ = event.at;
+            } else {
+                std::this_thread::sleep_until(wall_start + std::chrono::nanoseconds(event.at));
+                now_ = std::max(event.at, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now() - wall_start).count()));
+            }
+            event.run();
+        }
+
+        ClusterReport report = std::move(report_);
+        report.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+        report.simulated_seconds = static_cast<double>(std::min(now_, end)) / 1e9;
+        report.batches = batches_.size();
+        size_t received = 0;
+        for (const auto& batch : batches_) {
+            received += batch.received;
+            report.finalized_batches += batch.finals >= quorum_ ? 1 : 0;
+        }
+        if (!batches_.empty() && nodes_.size() > 1) {
+            report.coverage = static_cast<double>(received) /
+                              static_cast<double>(batches_.size() * (nodes_.size() - 1));
+        }
+        for (auto& node : nodes_) {
+            NodeReport r;
+            r.cpu_seconds = static_cast<double>(node.cpu_ns) / 1e9;
+            r.frames_sent = node.frames_sent;
+            r.bytes_sent = node.bytes_sent;
+            r.batches_received = node.batches_received;
+            r.batches_final = node.batches_final;
+            r.gossip = node.router->stats();
+            report.nodes.push_back(r);
+        }
+        return report;
+    }
+
+    static std::string peerName(size_t node) {
+        return "node-" + std::to_string(node);
+    }
+
+private:
+    struct Event {
+        int64_t at;
+        uint64_t seq;
+        std::function<void()> run;
+
+        bool operator>(const Event& other) const {
+            return at != other.at ? at > other.at : seq > other.seq;
+        }
+    };
+
+    struct Cut {
+        int64_t from;
+        int64_t until;
+        std::vector<uint8_t> side;
+    };
+
+    struct Node {
+        std::unique_ptr<network::GossipRouter> router;
+        // Frames sent by the handler running now, by recipient
+        std::vector<std::pair<size_t, std::vector<uint8_t>>> outbox;
+        int64_t busy_until{0};
+        int64_t uplink_free{0};
+        int64_t cpu_ns{0};
+        uint64_t frames_sent{0};
+        uint64_t bytes_sent{0};
+        size_t batches_received{0};
+        size_t batches_final{0};
+        std::unordered_map<uint64_t, size_t> votes;
+    };
+
+    struct Batch {
+        int64_t proposed{-1};
+        size_t received{0};
+        size_t finals{0};
+    };
+
+    template<typename Duration>
+    static int64_t ns(Duration d) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    }
+
+    size_t indexOf(const std::string& peer) const {
+        return static_cast<size_t>(std::stoul(peer.substr(5)));
+    }
+
+    void schedule(int64_t at, std::function<void()> run) {
+        events_.push(Event{at, next_seq_++, std::move(run)});
+    }
+
+    // Runs fn on `node` once the node is free, then sends what it queued
+    void act(size_t node, int64_t at, std::function<void()> fn) {
+        schedule(at, [this, node, fn = std::move(fn)]() mutable {
+            Node& n = nodes_[node];
+            if (config_.virtual_clock && n.busy_until > now_) {
+                act(node, n.busy_until, std::move(fn));
+                return;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            fn();
+            const int64_t cpu = ns(std::chrono::steady_clock::now() - start);
+            n.cpu_ns += cpu;
+            n.busy_until = now_ + (config_.virtual_clock && config_.charge_cpu ? cpu : 0);
+            transmit(node);
+        });
+    }
+
+    bool partitioned(size_t a, size_t b, int64_t at) const {
+        for (const auto& cut : cuts_) {
+            if (at >= cut.from && at < cut.until && cut.side[a] != cut.side[b]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void transmit(size_t from) {
+        Node& n = nodes_[from];
+        auto outbox = std::move(n.outbox);
+        n.outbox.clear();
+        for (auto& [to, frame] : outbox) {
+            int64_t depart = std::max(n.busy_until, n.uplink_free);
+            if (config_.link.bandwidth > 0) {
+                depart += static_cast<int64_t>(static_cast<double>(frame.size()) * 1e9 /
+                                               static_cast<double>(config_.link.bandwidth));
+            }
+            n.uplink_free = depart;
+            ++n.frames_sent;
+            n.bytes_sent += frame.size();
+
+            if (partitioned(from, to, depart)) {
+                ++report_.frames_partitioned;
+                continue;
+            }
+            if (config_.link.loss > 0.0 && rng_.uniform() < config_.link.loss) {
+                ++report_.frames_lost;
+                continue;
+            }
+            int64_t arrive = depart + ns(config_.link.latency);
+            if (config_.link.jitter.count() > 0) {
+                arrive += static_cast<int64_t>(rng_.below(static_cast<uint64_t>(ns(config_.link.jitter))));
+            }
+            auto payload = std::make_shared<std::vector<uint8_t>>(std::move(frame));
+            act(to, arrive, [this, from, to, payload] {
+                nodes_[to].router->handleFrame(peerName(from), *payload);
+            });
+        }
+    }
+
+    static std::vector<uint8_t> header(uint64_t batch, uint32_t node, size_t size) {
+        std::vector<uint8_t> bytes(std::max<size_t>(12, size), 0);
+        for (size_t i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<uint8_t>(batch >> (8 * i));
+        }
+        for (size_t i = 0; i < 4; ++i) {
+            bytes[8 + i] = static_cast<uint8_t>(node >> (8 * i));
+        }
+        return bytes;
+    }
+
+    static bool parse(std::span<const uint8_t> payload, uint64_t& batch) {
+        if (payload.size() < 12) {
+            return false;
+        }
+        batch = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            batch |= static_cast<uint64_t>(payload[i]) << (8 * i);
+        }
+        return true;
+    }
+
+    void vote(size_t node, uint64_t batch) {
+        nodes_[node].router->publish(VOTE_TOPIC, header(batch, static_cast<uint32_t>(node), 12));
+        count(node, batch);
+    }
+
+    void count(size_t node, uint64_t batch) {
+        Node& n = nodes_[node];
+        if (batch >= batches_.size() || ++n.votes[batch] != quorum_) {
+            return;
+        }
+        ++n.batches_final;
+        Batch& b = batches_[batch];
+        if (++b.finals == quorum_ && b.proposed >= 0) {
+            report_.finality_us.push_back(static_cast<double>(now_ - b.proposed) / 1e3);
+        }
+    }
+
+    void setup(int64_t end) {
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            nodes_[i].router->subscribe(BATCH_TOPIC, [this, i](const std::string&, std::span<const uint8_t> payload,
+                                                               const std::string&) {
+                uint64_t batch = 0;
+                if (!parse(payload, batch) || batch >= batches_.size()) {
+                    return;
+                }
+                Batch& b = batches_[batch];
+                ++b.received;
+                ++nodes_[i].batches_received;
+                if (b.proposed >= 0) {
+                    report_.propagation_us.push_back(static_cast<double>(now_ - b.proposed) / 1e3);
+                }
+                vote(i, batch);
+            });
+            nodes_[i].router->subscribe(VOTE_TOPIC, [this, i](const std::string&, std::span<const uint8_t> payload,
+                                                              const std::string&) {
+                uint64_t batch = 0;
+                if (parse(payload, batch)) {
+                    count(i, batch);
+                }
+            });
+            nodes_[i].outbox.clear();  // no peers yet
+        }
+
+        // Random links, each opened from both ends
+        std::vector<std::vector<size_t>> links(nodes_.size());
+        if (nodes_.size() > 1) {
+            for (size_t i = 0; i < nodes_.size(); ++i) {
+                for (size_t k = 0; k < std::min(config_.peers, nodes_.size() - 1); ++k) {
+                    size_t j = static_cast<size_t>(rng_.below(nodes_.size() - 1));
+                    j += j >= i ? 1 : 0;
+                    links[i].push_back(j);
+                    links[j].push_back(i);
+                }
+            }
+        }
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            std::sort(links[i].begin(), links[i].end());
+            links[i].erase(std::unique(links[i].begin(), links[i].end()), links[i].end());
+            act(i, 0, [this, i, peers = links[i]] {
+                for (size_t j : peers) {
+                    nodes_[i].router->addPeer(peerName(j));
+                }
+            });
+
+            // Timers start at random offsets so nodes do not tick in step
+            recur(i, static_cast<int64_t>(rng_.below(static_cast<uint64_t>(ns(config_.heartbeat)))),
+                  ns(config_.heartbeat), end, [this, i] { nodes_[i].router->heartbeat(); });
+            if (!config_.gossip.announce_topics.empty()) {
+                recur(i, static_cast<int64_t>(rng_.below(static_cast<uint64_t>(ns(config_.announce_flush)))),
+                      ns(config_.announce_flush), end, [this, i] { nodes_[i].router->flushAnnouncements(); });
+            }
+        }
+
+        for (size_t b = 0; b < batches_.size(); ++b) {
+            const size_t proposer = nodes_.empty() ? 0 : b % nodes_.size();
+            act(proposer, ns(config_.warmup) + static_cast<int64_t>(b) * ns(config_.batch_interval), [this, b, proposer] {
+                auto payload = header(b, static_cast<uint32_t>(proposer), config_.batch_bytes);
+                for (size_t i = 12; i < payload.size(); i += 8) {
+                    const uint64_t word = rng_();
+                    for (size_t k = 0; k < 8 && i + k < payload.size(); ++k) {
+                        payload[i + k] = static_cast<uint8_t>(word >> (8 * k));
+                    }
+                }
+                batches_[b].proposed = now_;
+                nodes_[proposer].router->publish(BATCH_TOPIC, payload);
+                vote(proposer, b);
+            });
+        }
+    }
+
+    void recur(size_t node, int64_t at, int64_t period, int64_t end, std::function<void()> fn) {
+        if (period <= 0 || at > end) {
+            return;
+        }
+        act(node, at, [this, node, at, period, end, fn] {
+            fn();
+            recur(node, at + period, period, end, fn);
+        });
+    }
+
+    const ClusterConfig config_;
+    utils::Philox rng_;
+    const size_t quorum_;
+    std::vector<Batch> batches_;
+    std::vector<Node> nodes_;
+    std::vector<Cut> cuts_;
+    std::priority_queue<Event, std::vector<Event>, std::greater<>> events_;
+    uint64_t next_seq_{0};
+    int64_t now_{0};
+    ClusterReport report_;
+};
+
+} // namespace bench
+} // namespace quids
@@ -0,0 +1,216 @@
+#include <benchmark/benchmark.h>
+#include "ConsensusHarness.hpp"
+#include "consensus/OptimizedPOBPC.hpp"
+#include "consensus/POBPC.hpp"
+#include "crypto/signature/Falcon.hpp"
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+
+using namespace quids;
+using namespace quids::bench;
+
+namespace {
+
+constexpr size_t BATCH_SIZE = 128;
+constexpr size_t BATCHES = 8;
+
+std::string witnessId(size_t i) {
+    return "witness-" + std::to_string(i);
+}
+
+// Witnesses sign batch hashes with their own keys; a Byzantine one sends
+// a signature with a flipped byte
+class POBPCDriver : public ConsensusDriver {
+public:
+    explicit POBPCDriver(size_t witnesses) {
+        consensus::POBPC::BatchConfig config;
+        config.max_transactions = BATCH_SIZE;
+        config.witness_count = witnesses;
+        pobpc_ = std::make_unique<consensus::POBPC>(config);
+    }
+
+    void registerWitnesses(size_t count) override {
+        for (size_t i = 0; i < count; ++i) {
+            auto& signer = signers_.emplace_back(std::make_unique<crypto::FalconSigner>());
+            signer->generateKeyPair();
+            benchmark::DoNotOptimize(pobpc_->registerWitness(witnessId(i), signer->getPublicKey()));
+        }
+    }
+
+    void submit(std::vector<uint8_t>&& transaction) override {
+        benchmark::DoNotOptimize(pobpc_->addTransaction(transaction));
+    }
+
+    std::optional<std::vector<size_t>> propose() override {
+        proof_ = pobpc_->generateBatchProof();
+        if (proof_.batch_hash.empty()) {
+            return std::nullopt;
+        }
+        std::vector<size_t> voters;
+        for (const auto* witness : pobpc_->selectWitnesses()) {
+            voters.push_back(witness->index);
+        }
+        return voters;
+    }
+
+    bool deliverVote(size_t witness, bool byzantine) override {
+        auto signature = signers_[witness]->sign(proof_.batch_hash);
+        if (byzantine && !signature.empty()) {
+            signature[0] ^= 0x01;
+        }
+        return pobpc_->submitWitnessVote(witnessId(witness), signature, proof_) &&
+               pobpc_->hasReachedConsensus(proof_);
+    }
+
+private:
+    std::unique_ptr<consensus::POBPC> pobpc_;
+    std::vector<std::unique_ptr<crypto::FalconSigner>> signers_;
+    consensus::POBPC::BatchProof proof_;
+};
+
+// OptimizedPOBPC signs for its selected witnesses while proving, so each
+// signature slot is held back and released as that witness's vote arrives;
+// a Byzantine vote releases a corrupted signature. Slot k stands in for
+// witness k. The proof is verified once enough votes are in to pass.
+class OptimizedPOBPCDriver : public ConsensusDriver {
+public:
+    explicit OptimizedPOBPCDriver(size_t witnesses) {
+        config_.witness_count = witnesses;
+        config_.batch_size = BATCH_SIZE;
+        config_.max_transactions = std::max<size_t>(config_.max_transactions, BATCH_SIZE);
+        pobpc_ = std::make_unique<consensus::OptimizedPOBPC>(config_);
+    }
+
+    void registerWitnesses(size_t count) override {
+        for (size_t i = 0; i < count; ++i) {
+            const std::vector<uint8_t> public_key(32, static_cast<uint8_t>(i + 1));
+            benchmark::DoNotOptimize(pobpc_->registerWitness(witnessId(i), public_key));
+        }
+    }
+
+    void submit(std::vector<uint8_t>&& transaction) override {
+        benchmark::DoNotOptimize(pobpc_->addTransaction(transaction));
+    }
+
+    std::optional<std::vector<size_t>> propose() override {
+        proof_ = pobpc_->generateBatchProof();
+        if (proof_.batch_hash.empty()) {
+            return std::nullopt;
+        }
+        signatures_ = std::move(proof_.witness_signatures);
+        proof_.witness_signatures.assign(signatures_.size(), {});
+        delivered_ = 0;
+
+        std::vector<size_t> voters(signatures_.size());
+        std::iota(voters.begin(), voters.end(), 0);
+        return voters;
+    }
+
+    bool deliverVote(size_t slot, bool byzantine) override {
+        auto& signature = proof_.witness_signatures[slot];
+        signature = signatures_[slot];
+        if (byzantine && !signature.empty()) {
+            signature[0] ^= 0x01;
+        }
+        ++delivered_;
+        const double needed = static_cast<double>(config_.witness_count) * config_.consensus_threshold;
+        return static_cast<double>(delivered_) >= needed && pobpc_->verifyBatchProof(proof_);
+    }
+
+private:
+    consensus::BatchConfig config_;
+    std::unique_ptr<consensus::OptimizedPOBPC> pobpc_;
+    consensus::OptimizedPOBPC::BatchProof proof_;
+    std::vector<std::vector<uint8_t>> signatures_;
+    size_t delivered_{0};
+};
+
+LoadConfig loadConfig(const benchmark::State& state) {
+    LoadConfig config;
+    config.witnesses = static_cast<size_t>(state.range(0));
+    config.byzantine_fraction = static_cast<double>(state.range(1)) / 100.0;
+    config.batch_size = BATCH_SIZE;
+    config.network.loss = static_cast<double>(state.range(3)) / 1000.0;
+    return config;
+}
+
+void reportCounters(benchmark::State& state, const Report& report) {
+    state.counters["p50_us"] = report.percentileMicros(0.50);
+    state.counters["p99_us"] = report.percentileMicros(0.99);
+    state.counters["tps"] = report.throughputTps();
+    state.counters["finalized"] = report.batches == 0 ? 0.0 :
+        static_cast<double>(report.finalized_batches) / static_cast<double>(report.batches);
+}
+
+template<typename Driver>
+void runFinality(benchmark::State& state) {
+    const LoadConfig config = loadConfig(state);
+    const auto trace = syntheticTrace(static_cast<double>(state.range(2)), BATCH_SIZE * BATCHES, config.seed);
+    Report report;
+    for (auto _ : state) {
+        Driver driver(config.witnesses);
+        report = runLoad(driver, trace, config);
+    }
+    reportCounters(state, report);
+}
+
+// Replays the trace named by QUIDS_CONSENSUS_TRACE; see loadTrace
+template<typename Driver>
+void runReplay(benchmark::State& state) {
+    const char* path = std::getenv("QUIDS_CONSENSUS_TRACE");
+    if (path == nullptr) {
+        state.SkipWithError("QUIDS_CONSENSUS_TRACE is not set");
+        return;
+    }
+    const LoadConfig config = loadConfig(state);
+    const auto trace = loadTrace(path);
+    Report report;
+    for (auto _ : state) {
+        Driver driver(config.witnesses);
+        report = runLoad(driver, trace, config);
+    }
+    reportCounters(state, report);
+}
+
+// witnesses, Byzantine percent, target TPS, vote loss per mille
+void finalityArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"witnesses", "byzantine_pct", "tps", "loss_permille"});
+    for (int64_t witnesses : {7, 16}) {
+        for (int64_t byzantine : {0, 20, 33}) {
+            b->Args({witnesses, byzantine, 1000, 0});
+        }
+        b->Args({witnesses, 0, 10000, 0});
+        b->Args({witnesses, 0, 1000, 50});
+    }
+    b->Unit(benchmark::kMillisecond);
+}
+
+void replayArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"witnesses", "byzantine_pct", "tps", "loss_permille"});
+    b->Args({16, 0, 0, 0});
+    b->Args({16, 33, 0, 10});
+    b->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+static void BM_POBPC_Finality(benchmark::State& state) {
+    runFinality<POBPCDriver>(state);
+}
+BENCHMARK(BM_POBPC_Finality)->Apply(finalityArgs);
+
+static void BM_OptimizedPOBPC_Finality(benchmark::State& state) {
+    runFinality<OptimizedPOBPCDriver>(state);
+}
+BENCHMARK(BM_OptimizedPOBPC_Finality)->Apply(finalityArgs);
+
+static void BM_POBPC_Replay(benchmark::State& state) {
+    runReplay<POBPCDriver>(state);
+}
+BENCHMARK(BM_POBPC_Replay)->Apply(replayArgs);
+
+static void BM_OptimizedPOBPC_Replay(benchmark::State& state) {
+    runReplay<OptimizedPOBPCDriver>(state);
+}
+BENCHMARK(BM_OptimizedPOBPC_Replay)->Apply(replayArgs);
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "utils/RandomService.hpp"
+
+namespace quids {
+namespace bench {
+
+// Discrete-event load harness for consensus engines.
+//
+// Witnesses live in-process. Time is simulated: transactions arrive on the
+// schedule of a trace, every vote crosses a modelled link with a latency
+// and a loss rate, and the real CPU time the engine spends proposing and
+// counting votes is added to the clock. That keeps runs reproducible from
+// a seed while still charging the engine for its own work.
+
+struct NetworkModel {
+    std::chrono::microseconds base_latency{2000};
+    // Uniform extra delay in [0, jitter)
+    std::chrono::microseconds jitter{1000};
+    // Probability a vote never arrives
+    double loss{0.0};
+};
+
+// One transaction arrival, relative to the start of the run
+struct TraceEvent {
+    std::chrono::microseconds at{0};
+    uint32_t size{0};
+};
+
+// Text trace: one "<arrival microseconds> <size bytes>" pair per line,
+// arrivals non-decreasing; '#' starts a comment
+inline std::vector<TraceEvent> loadTrace(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("cannot open trace " + path);
+    }
+    std::vector<TraceEvent> trace;
+    std::string line;
+    while (std::getline(in, line)) {
+        const auto hash = line.find('#');
+        if (hash != std::string::npos) {
+            line.resize(hash);
+        }
+        long long at = 0;
+        unsigned long size = 0;
+        if (std::sscanf(line.c_str(), "%lld %lu", &at, &size) != 2) {
+            continue;
+        }
+        if (at < 0 || (!trace.empty() && std::chrono::microseconds(at) < trace.back().at)) {
+            throw std::runtime_error("trace arrivals must be non-negative and ordered");
+        }
+        trace.push_back(TraceEvent{std::chrono::microseconds(at), static_cast<uint32_t>(size)});
+    }
+    return trace;
+}
+
+// Poisson arrivals at target_tps, transaction sizes uniform in [min, max]
+inline std::vector<TraceEvent> syntheticTrace(double target_tps, size_t count, uint64_t seed,
+                                              uint32_t min_size = 100, uint32_t max_size = 400) {
+    utils::Philox rng(seed, 0);
+    std::vector<TraceEvent> trace(count);
+    double at_us = 0.0;
+    for (auto& event : trace) {
+        at_us += -std::log1p(-rng.uniform()) * 1e6 / target_tps;
+        event.at = std::chrono::microseconds(static_cast<int64_t>(at_us));
+        event.size = min_size + static_cast<uint32_t>(rng.below(max_size - min_size + 1));
+    }
+    return trace;
+}
+
+struct LoadConfig {
+    size_t witnesses{16};
+    // Share of witnesses that vote with a corrupted signature
+    double byzantine_fraction{0.0};
+    size_t batch_size{256};
+    NetworkModel network;
+    uint64_t seed{1};
+};
+
+struct Report {
+    // Arrival of a batch's first transaction to the vote that finalized it
+    std::vector<double> finality_us;
+    size_t batches{0};
+    size_t finalized_batches{0};
+    size_t finalized_transactions{0};
+    double simulated_seconds{0.0};
+
+    [[nodiscard]] double percentileMicros(double p) const {
+        if (finality_us.empty()) {
+            return 0.0;
+        }
+        std::vector<double> sorted = finality_us;
+        std::sort(sorted.begin(), sorted.end());
+        const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    [[nodiscard]] double throughputTps() const {
+        return simulated_seconds > 0.0 ? static_cast<double>(finalized_transactions) / simulated_seconds : 0.0;
+    }
+};
+
+// What the harness needs from an engine. The simulated witnesses are
+// numbered 0..witnesses-1 in registration order.
+class ConsensusDriver {
+public:
+    virtual ~ConsensusDriver() = default;
+
+    virtual void registerWitnesses(size_t count) = 0;
+    virtual void submit(std::vector<uint8_t>&& transaction) = 0;
+    // Cuts a batch from the submitted transactions; returns the witnesses
+    // asked to vote on it, or nullopt if nothing could be proposed
+    virtual std::optional<std::vector<size_t>> propose() = 0;
+    // Delivers one witness's vote on the current batch; true once the
+    // batch is final
+    virtual bool deliverVote(size_t witness, bool byzantine) = 0;
+};
+
+inline Report runLoad(ConsensusDriver& driver, const std::vector<TraceEvent>& trace, const LoadConfig& config) {
+    using clock = std::chrono::steady_clock;
+    auto cpuMicros = [](clock::time_point start) {
+        return static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count()) / 1e3;
+    };
+
+    driver.registerWitnesses(config.witnesses);
+    utils::Philox rng(config.seed, 1);
+    const auto byzantine_count = static_cast<size_t>(
+        std::llround(config.byzantine_fraction * static_cast<double>(config.witnesses)));
+    std::vector<uint8_t> byzantine(config.witnesses, 0);
+    std::fill_n(byzantine.begin(), std::min(byzantine_count, config.witnesses), 1);
+    rng.shuffle(byzantine.begin(), byzantine.end());
+
+    Report report;
+    double now_us = 0.0;
+    double last_final_us = 0.0;
+    std::vector<std::pair<double, size_t>> deliveries;
+
+    for (size_t first = 0; first < trace.size(); first += config.batch_size) {
+        const size_t last = std::min(trace.size(), first + config.batch_size);
+        for (size_t i = first; i < last; ++i) {
+            std::vector<uint8_t> tx(std::max<uint32_t>(1, trace[i].size));
+            for (size_t b = 0; b < tx.size(); b += 8) {
+                const uint64_t word = rng();
+                for (size_t k = 0; k < 8 && b + k < tx.size(); ++k) {
+                    tx[b + k] = static_cast<uint8_t>(word >> (8 * k));
+                }
+            }
+            driver.submit(std::move(tx));
+        }
+
+        // The batch is cut when its last transaction arrives, unless the
+        // engine is still busy with the previous one
+        const double opened_us = static_cast<double>(trace[first].at.count());
+        now_us = std::max(now_us, static_cast<double>(trace[last - 1].at.count()));
+        ++report.batches;
+
+        const auto propose_start = clock::now();
+        const auto voters = driver.propose();
+        now_us += cpuMicros(propose_start);
+        if (!voters) {
+            continue;
+        }
+
+        deliveries.clear();
+        for (size_t witness : *voters) {
+            if (rng.uniform() < config.network.loss) {
+                continue;
+            }
+            const double jitter = config.network.jitter.count() > 0
+                ? static_cast<double>(rng.below(static_cast<uint64_t>(config.network.jitter.count())))
+                : 0.0;
+            deliveries.emplace_back(now_us + static_cast<double>(config.network.base_latency.count()) + jitter,
+                                    witness);
+        }
+        std::sort(deliveries.begin(), deliveries.end());
+
+        double engine_free_us = now_us;
+        for (const auto& [arrival_us, witness] : deliveries) {
+            // Votes queue behind the engine while it counts earlier ones
+            const auto vote_start = clock::now();
+            const bool final = driver.deliverVote(witness, witness < byzantine.size() && byzantine[witness] != 0);
+            engine_free_us = std::max(engine_free_us, arrival_us) + cpuMicros(vote_start);
+            if (final) {
+                report.finality_us.push_back(engine_free_us - opened_us);
+                ++report.finalized_batches;
+                report.finalized_transactions += last - first;
+                last_final_us = std::max(last_final_us, engine_free_us);
+                break;
+            }
+        }
+        now_us = std::max(now_us, engine_free_us);
+    }
+
+    if (!trace.empty()) {
+        report.simulated_seconds = (std::max(last_final_us, now_us) - static_cast<double>(trace.front().at.count())) / 1e6;
+    }
+    return report;
+}
+
+} // namespace bench
+} // namespace quids
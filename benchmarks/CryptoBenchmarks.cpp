@@ -0,0 +1,320 @@
+#include <benchmark/benchmark.h>
+#include "PerfReport.hpp"
+#include "crypto/AuditLog.hpp"
+#include "crypto/blake3/BatchHasher.hpp"
+#include "crypto/blake3/Blake3Hash.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include "crypto/falcon/sha3_256.hpp"
+#include "crypto/kyber/BotanKyber.hpp"
+#include "crypto/signature/BatchVerifier.hpp"
+#include "crypto/signature/Dilithium.hpp"
+#include "crypto/signature/Falcon.hpp"
+#include "crypto/signature/Sphincs.hpp"
+#include <botan/auto_rng.h>
+#include <botan/dilithium.h>
+#include <botan/kyber.h>
+#include <botan/pubkey.h>
+
+using namespace quids::crypto;
+
+namespace {
+
+// Short messages are where per-call setup dominates
+const std::vector<uint8_t> MESSAGE(64, 0xab);
+
+// A batch of transaction-sized messages, 100 to 400 bytes
+std::vector<std::vector<uint8_t>> transactionBatch(size_t count) {
+    std::vector<std::vector<uint8_t>> batch(count);
+    for (size_t i = 0; i < count; ++i) {
+        batch[i].assign(100 + (i * 37) % 300, static_cast<uint8_t>(i));
+    }
+    return batch;
+}
+
+// Batch verification of `count` signatures over distinct messages, spread
+// over a handful of keys as a block's senders would be
+template<typename Signer>
+void batchVerify(benchmark::State& state, SignatureScheme scheme, std::unique_ptr<SchemeVerifier> scheme_verifier) {
+    constexpr size_t KEYS = 8;
+    const size_t count = static_cast<size_t>(state.range(0));
+    std::vector<std::unique_ptr<Signer>> signers;
+    std::vector<std::vector<uint8_t>> public_keys;
+    for (size_t k = 0; k < KEYS; ++k) {
+        signers.push_back(std::make_unique<Signer>());
+        signers.back()->generateKeyPair();
+        public_keys.push_back(signers.back()->getPublicKey());
+    }
+    auto messages = transactionBatch(count);
+    std::vector<std::vector<uint8_t>> signatures;
+    for (size_t i = 0; i < count; ++i) {
+        signatures.push_back(signers[i % KEYS]->sign(messages[i]));
+    }
+    std::vector<VerifyItem> items;
+    for (size_t i = 0; i < count; ++i) {
+        items.push_back({scheme, messages[i], signatures[i], public_keys[i % KEYS]});
+    }
+
+    BatchVerifier verifier;
+    if (scheme_verifier) {
+        verifier.register_scheme(scheme, std::move(scheme_verifier));
+    }
+    quids::bench::StagePerf perf(quids::utils::PerfStage::SignatureVerify);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(verifier.verify(items));
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+// Per-call Botan objects, as the wrappers used to build them
+static void BM_Dilithium_Sign_FreshObjects(benchmark::State& state) {
+    Botan::AutoSeeded_RNG keygen_rng;
+    Botan::Dilithium_PrivateKey key(keygen_rng, Botan::DilithiumMode(Botan::DilithiumMode::Dilithium8x7));
+    for (auto _ : state) {
+        Botan::AutoSeeded_RNG rng;
+        Botan::PK_Signer signer(key, rng, "Randomized");
+        benchmark::DoNotOptimize(signer.sign_message(MESSAGE, rng));
+    }
+}
+BENCHMARK(BM_Dilithium_Sign_FreshObjects);
+
+static void BM_Dilithium_Sign_Reused(benchmark::State& state) {
+    DilithiumSigner signer;
+    signer.generateKeyPair();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(signer.sign(MESSAGE));
+    }
+}
+BENCHMARK(BM_Dilithium_Sign_Reused);
+
+static void BM_Dilithium_Verify_FreshObjects(benchmark::State& state) {
+    DilithiumSigner signer;
+    signer.generateKeyPair();
+    const auto public_key = signer.getPublicKey();
+    const auto signature = signer.sign(MESSAGE);
+    for (auto _ : state) {
+        Botan::Dilithium_PublicKey key(public_key, Botan::DilithiumMode(Botan::DilithiumMode::Dilithium8x7));
+        Botan::PK_Verifier verifier(key, "Randomized");
+        benchmark::DoNotOptimize(verifier.verify_message(MESSAGE, signature));
+    }
+}
+BENCHMARK(BM_Dilithium_Verify_FreshObjects);
+
+static void BM_Dilithium_Verify_Reused(benchmark::State& state) {
+    DilithiumSigner signer;
+    signer.generateKeyPair();
+    const auto public_key = signer.getPublicKey();
+    const auto signature = signer.sign(MESSAGE);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(signer.verify(MESSAGE, signature, public_key));
+    }
+}
+BENCHMARK(BM_Dilithium_Verify_Reused);
+
+static void BM_Sphincs_Sign_Reused(benchmark::State& state) {
+    SphincsPlus signer;
+    signer.generateKeyPair();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(signer.sign(MESSAGE));
+    }
+}
+BENCHMARK(BM_Sphincs_Sign_Reused);
+
+static void BM_Kyber_Encapsulate_FreshObjects(benchmark::State& state) {
+    KyberKEM kem;
+    const auto keypair = kem.generateKeyPair();
+    for (auto _ : state) {
+        Botan::AutoSeeded_RNG rng;
+        Botan::Kyber_PublicKey key(keypair.public_key, Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
+        Botan::PK_KEM_Encryptor encryptor(key, "KDF2(SHA-256)");
+        benchmark::DoNotOptimize(encryptor.encrypt(rng, 32));
+    }
+}
+BENCHMARK(BM_Kyber_Encapsulate_FreshObjects);
+
+static void BM_Kyber_Encapsulate_Reused(benchmark::State& state) {
+    KyberKEM kem;
+    const auto keypair = kem.generateKeyPair();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kem.encapsulate(keypair.public_key));
+    }
+}
+BENCHMARK(BM_Kyber_Encapsulate_Reused);
+
+static void BM_Kyber_AuditTrail(benchmark::State& state) {
+    KyberKEM kem;
+    const auto keypair = kem.generateKeyPair();
+    AuditLog::global().setSink([](const std::vector<AuditLog::Record>&) {});
+    for (auto _ : state) {
+        kem.logAuditTrail("encapsulate", keypair.public_key);
+    }
+    AuditLog::global().flush();
+}
+BENCHMARK(BM_Kyber_AuditTrail);
+
+static void BM_Blake3_Batch_OneAtATime(benchmark::State& state) {
+    const auto batch = transactionBatch(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        for (const auto& tx : batch) {
+            Blake3Hash hasher;
+            hasher.update(tx);
+            benchmark::DoNotOptimize(hasher.finalize());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Blake3_Batch_OneAtATime)->Arg(256)->Arg(4096);
+
+static void BM_Blake3_Batch_Lanes(benchmark::State& state) {
+    const auto batch = transactionBatch(static_cast<size_t>(state.range(0)));
+    state.SetLabel(BatchHasher::isa());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(BatchHasher::hashMany(batch));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Blake3_Batch_Lanes)->Arg(256)->Arg(4096);
+
+static void BM_Falcon_KeyGen(benchmark::State& state) {
+    FalconSigner signer;
+    for (auto _ : state) {
+        signer.generateKeyPair();
+    }
+}
+BENCHMARK(BM_Falcon_KeyGen);
+
+static void BM_Falcon_Sign(benchmark::State& state) {
+    FalconSigner signer;
+    signer.generateKeyPair();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(signer.sign(MESSAGE));
+    }
+}
+BENCHMARK(BM_Falcon_Sign);
+
+static void BM_Falcon_Verify(benchmark::State& state) {
+    FalconSigner signer;
+    signer.generateKeyPair();
+    const auto public_key = signer.getPublicKey();
+    const auto signature = signer.sign(MESSAGE);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(signer.verify(MESSAGE, signature, public_key));
+    }
+}
+BENCHMARK(BM_Falcon_Verify);
+
+static void BM_Falcon_BatchVerify(benchmark::State& state) {
+    batchVerify<FalconSigner>(state, SignatureScheme::Falcon512, nullptr);
+}
+BENCHMARK(BM_Falcon_BatchVerify)->Arg(64)->Arg(1024)->UseRealTime();
+
+static void BM_Dilithium_KeyGen(benchmark::State& state) {
+    DilithiumSigner signer;
+    for (auto _ : state) {
+        signer.generateKeyPair();
+    }
+}
+BENCHMARK(BM_Dilithium_KeyGen);
+
+static void BM_Dilithium_BatchVerify(benchmark::State& state) {
+    batchVerify<DilithiumSigner>(state, SignatureScheme::Dilithium, DilithiumSigner::batchVerifier());
+}
+BENCHMARK(BM_Dilithium_BatchVerify)->Arg(64)->Arg(1024)->UseRealTime();
+
+static void BM_Sphincs_KeyGen(benchmark::State& state) {
+    SphincsPlus signer;
+    for (auto _ : state) {
+        signer.generateKeyPair();
+    }
+}
+BENCHMARK(BM_Sphincs_KeyGen);
+
+static void BM_Sphincs_Verify(benchmark::State& state) {
+    SphincsPlus signer;
+    signer.generateKeyPair();
+    const auto public_key = signer.getPublicKey();
+    const auto signature = signer.sign(MESSAGE);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(signer.verify(MESSAGE, signature, public_key));
+    }
+}
+BENCHMARK(BM_Sphincs_Verify);
+
+// SPHINCS+ signing is slow enough that a small batch is representative
+static void BM_Sphincs_BatchVerify(benchmark::State& state) {
+    batchVerify<SphincsPlus>(state, SignatureScheme::SphincsPlus, SphincsPlus::batchVerifier());
+}
+BENCHMARK(BM_Sphincs_BatchVerify)->Arg(16)->UseRealTime();
+
+static void BM_Kyber_KeyGen(benchmark::State& state) {
+    KyberKEM kem;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kem.generateKeyPair());
+    }
+}
+BENCHMARK(BM_Kyber_KeyGen);
+
+static void BM_Kyber_Decapsulate(benchmark::State& state) {
+    KyberKEM kem;
+    const auto keypair = kem.generateKeyPair();
+    const auto ciphertext = kem.encapsulate(keypair.public_key);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kem.decapsulate(ciphertext.data, keypair.private_key));
+    }
+}
+BENCHMARK(BM_Kyber_Decapsulate);
+
+static void BM_Blake3_Hash(benchmark::State& state) {
+    const std::vector<uint8_t> message(static_cast<size_t>(state.range(0)), 0x5a);
+    for (auto _ : state) {
+        Blake3Hash hasher;
+        hasher.update(message);
+        benchmark::DoNotOptimize(hasher.finalize());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Blake3_Hash)->Arg(64)->Arg(1024)->Arg(64 * 1024);
+
+static void BM_Sha3_256_Hash(benchmark::State& state) {
+    const std::vector<uint8_t> message(static_cast<size_t>(state.range(0)), 0x5a);
+    uint8_t digest[32];
+    for (auto _ : state) {
+        sha3_256::hash(message.data(), message.size(), digest);
+        benchmark::DoNotOptimize(digest);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Sha3_256_Hash)->Arg(64)->Arg(1024)->Arg(64 * 1024);
+
+// Root of a fresh tree over a block's worth of transactions
+static void BM_Merkle_Root(benchmark::State& state) {
+    const auto batch = transactionBatch(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        MerkleBuilder builder;
+        for (const auto& tx : batch) {
+            builder.append(tx);
+        }
+        benchmark::DoNotOptimize(builder.root());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Merkle_Root)->Arg(256)->Arg(4096)->UseRealTime();
+
+static void BM_Merkle_ProveAndVerify(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    const auto batch = transactionBatch(count);
+    MerkleBuilder builder;
+    for (const auto& tx : batch) {
+        builder.append(tx);
+    }
+    const MerkleHash root = builder.root();
+    size_t index = 0;
+    for (auto _ : state) {
+        const auto proof = builder.proof(index);
+        benchmark::DoNotOptimize(MerkleBuilder::verify(root, MerkleBuilder::hashLeaf(batch[index]), proof));
+        index = (index + 1) % count;
+    }
+}
+BENCHMARK(BM_Merkle_ProveAndVerify)->Arg(4096);
@@ -0,0 +1,202 @@
+#include <benchmark/benchmark.h>
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Interpreter.hpp"
+#include "evm/Keccak.hpp"
+#include "evm/Storage.hpp"
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace quids::evm;
+
+namespace {
+
+constexpr uint64_t GAS = uint64_t{1} << 40;
+constexpr size_t LOOP_ITERATIONS = 1000;
+// Copies of the body per iteration, so the loop's own jump is amortised
+constexpr size_t UNROLL = 8;
+
+// prefix PUSH3 n JUMPDEST body... PUSH1 1 SWAP1 SUB DUP1 PUSH1 start JUMPI
+// STOP. The loop counter stays on top of the stack; body must leave it there.
+std::vector<uint8_t> loop(const std::vector<uint8_t>& body, size_t unroll = UNROLL,
+                          std::vector<uint8_t> prefix = {}) {
+    std::vector<uint8_t> code = std::move(prefix);
+    code.insert(code.end(), {0x62,
+                             static_cast<uint8_t>(LOOP_ITERATIONS >> 16),
+                             static_cast<uint8_t>(LOOP_ITERATIONS >> 8),
+                             static_cast<uint8_t>(LOOP_ITERATIONS)});
+    const auto start = static_cast<uint8_t>(code.size());
+    code.push_back(0x5b);
+    for (size_t i = 0; i < unroll; ++i) {
+        code.insert(code.end(), body.begin(), body.end());
+    }
+    code.insert(code.end(), {0x60, 0x01, 0x90, 0x03, 0x80, 0x60, start, 0x57, 0x00});
+    return code;
+}
+
+// range(0) picks the tier: 0 straight from analysis, 1 optimized
+std::shared_ptr<const AnalyzedCode> prepare(const std::vector<uint8_t>& code, int64_t tier) {
+    auto analyzed = analyze(code, keccak256(code));
+    return tier == 0 ? analyzed : optimize(*analyzed);
+}
+
+void runLoop(benchmark::State& state, const std::vector<uint8_t>& body) {
+    const auto code = prepare(loop(body), state.range(0));
+    ::evm::Storage storage;
+    ExecutionContext ctx;
+    ctx.storage = &storage;
+    for (auto _ : state) {
+        storage.begin_transaction();
+        auto result = interpret(*code, ctx, GAS);
+        if (result.status != InterpreterStatus::Success) {
+            state.SkipWithError("loop did not run to completion");
+            break;
+        }
+        benchmark::DoNotOptimize(result.gas_left);
+    }
+    state.SetItemsProcessed(state.iterations() * LOOP_ITERATIONS * UNROLL);
+}
+
+// Minimal token: balances live at keccak256(holder), calldata is
+// (recipient, amount). Reverts when the caller's balance is short.
+std::vector<uint8_t> tokenTransfer() {
+    std::vector<uint8_t> code = {
+        0x33, 0x60, 0x00, 0x52,              // CALLER PUSH1 0 MSTORE
+        0x60, 0x20, 0x60, 0x00, 0x20,        // PUSH1 32 PUSH1 0 SHA3: sender slot
+        0x80, 0x54,                          // DUP1 SLOAD
+        0x60, 0x20, 0x35,                    // PUSH1 32 CALLDATALOAD: amount
+        0x80, 0x82, 0x10,                    // DUP1 DUP3 LT: balance < amount
+        0x60, 0x00, 0x57,                    // PUSH1 fail JUMPI (patched below)
+        0x90, 0x03,                          // SWAP1 SUB
+        0x90, 0x55,                          // SWAP1 SSTORE
+        0x60, 0x00, 0x35, 0x60, 0x00, 0x52,  // PUSH1 0 CALLDATALOAD PUSH1 0 MSTORE
+        0x60, 0x20, 0x60, 0x00, 0x20,        // PUSH1 32 PUSH1 0 SHA3: recipient slot
+        0x80, 0x54,                          // DUP1 SLOAD
+        0x60, 0x20, 0x35, 0x01,              // PUSH1 32 CALLDATALOAD ADD
+        0x90, 0x55,                          // SWAP1 SSTORE
+        0x60, 0x01, 0x60, 0x00, 0x52,        // PUSH1 1 PUSH1 0 MSTORE
+        0x60, 0x20, 0x60, 0x00, 0xf3,        // PUSH1 32 PUSH1 0 RETURN
+    };
+    code[18] = static_cast<uint8_t>(code.size());
+    code.insert(code.end(), {0x5b, 0x60, 0x00, 0x60, 0x00, 0xfd});  // fail: JUMPDEST PUSH1 0 PUSH1 0 REVERT
+    return code;
+}
+
+::evm::uint256_t balanceSlot(const ::evm::uint256_t& holder) {
+    uint8_t word[32];
+    holder.store_be(word);
+    const auto hash = keccak256(word, sizeof(word));
+    return ::evm::uint256_t::load_be(hash.data());
+}
+
+} // namespace
+
+static void BM_EVM_Add(benchmark::State& state) {
+    runLoop(state, {0x60, 0x03, 0x60, 0x05, 0x01, 0x50});  // PUSH1 3 PUSH1 5 ADD POP
+}
+BENCHMARK(BM_EVM_Add)->Arg(0)->Arg(1);
+
+static void BM_EVM_Mul(benchmark::State& state) {
+    runLoop(state, {0x60, 0x03, 0x80, 0x02, 0x50});  // PUSH1 3 DUP1 MUL POP
+}
+BENCHMARK(BM_EVM_Mul)->Arg(0)->Arg(1);
+
+static void BM_EVM_Div(benchmark::State& state) {
+    runLoop(state, {0x60, 0x07, 0x80, 0x04, 0x50});  // PUSH1 7 DUP1 DIV POP
+}
+BENCHMARK(BM_EVM_Div)->Arg(0)->Arg(1);
+
+static void BM_EVM_Exp(benchmark::State& state) {
+    runLoop(state, {0x60, 0x1f, 0x80, 0x0a, 0x50});  // PUSH1 31 DUP1 EXP POP
+}
+BENCHMARK(BM_EVM_Exp)->Arg(0)->Arg(1);
+
+static void BM_EVM_StackShuffle(benchmark::State& state) {
+    runLoop(state, {0x60, 0x01, 0x80, 0x90, 0x50, 0x50});  // PUSH1 1 DUP1 SWAP1 POP POP
+}
+BENCHMARK(BM_EVM_StackShuffle)->Arg(0)->Arg(1);
+
+static void BM_EVM_Memory(benchmark::State& state) {
+    // DUP1 PUSH1 0 MSTORE PUSH1 0 MLOAD POP
+    runLoop(state, {0x80, 0x60, 0x00, 0x52, 0x60, 0x00, 0x51, 0x50});
+}
+BENCHMARK(BM_EVM_Memory)->Arg(0)->Arg(1);
+
+static void BM_EVM_Keccak(benchmark::State& state) {
+    runLoop(state, {0x60, 0x40, 0x60, 0x00, 0x20, 0x50});  // PUSH1 64 PUSH1 0 SHA3 POP
+}
+BENCHMARK(BM_EVM_Keccak)->Arg(0)->Arg(1);
+
+static void BM_EVM_Storage(benchmark::State& state) {
+    // DUP1 PUSH1 1 SSTORE PUSH1 1 SLOAD POP: one warm write and read
+    runLoop(state, {0x80, 0x60, 0x01, 0x55, 0x60, 0x01, 0x54, 0x50});
+}
+BENCHMARK(BM_EVM_Storage)->Arg(0)->Arg(1);
+
+// Nothing but the loop's own block: dispatch, PUSH/SUB/DUP and JUMPI
+static void BM_EVM_JumpLoop(benchmark::State& state) {
+    const auto code = prepare(loop({}, 0), state.range(0));
+    ExecutionContext ctx;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpret(*code, ctx, GAS).gas_left);
+    }
+    state.SetItemsProcessed(state.iterations() * LOOP_ITERATIONS);
+}
+BENCHMARK(BM_EVM_JumpLoop)->Arg(0)->Arg(1);
+
+// One token transfer per call over a rotating set of holders, through
+// the shared code cache as deployed contracts are run
+static void BM_EVM_TokenTransfer(benchmark::State& state) {
+    constexpr size_t HOLDERS = 1024;
+    const auto code = tokenTransfer();
+    ::evm::Storage storage;
+    ExecutionContext ctx;
+    ctx.storage = &storage;
+    for (size_t i = 0; i < HOLDERS; ++i) {
+        storage.store(ctx.address, balanceSlot(::evm::uint256_t(i + 1)), ::evm::uint256_t(uint64_t{1} << 40));
+    }
+    std::vector<uint8_t> calldata(64, 0);
+    calldata[63] = 1;  // amount
+    ctx.input = calldata.data();
+    ctx.input_size = calldata.size();
+
+    size_t i = 0;
+    for (auto _ : state) {
+        ctx.caller = ::evm::uint256_t(i % HOLDERS + 1);
+        const uint64_t recipient = (i * 7 + 3) % HOLDERS + 1;
+        calldata[31] = static_cast<uint8_t>(recipient);
+        calldata[30] = static_cast<uint8_t>(recipient >> 8);
+        storage.begin_transaction();
+        auto result = interpret(*CodeCache::global().get(code), ctx, 100000);
+        if (result.status != InterpreterStatus::Success) {
+            state.SkipWithError("transfer failed");
+            break;
+        }
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EVM_TokenTransfer);
+
+// Compute-bound contract: iterative Fibonacci, the pair kept under the
+// loop counter as [a b i] and advanced to [b a+b i] each iteration
+static void BM_EVM_Fibonacci(benchmark::State& state) {
+    const std::vector<uint8_t> body = {
+        0x82,  // DUP3     [a b i a]
+        0x82,  // DUP3     [a b i a b]
+        0x01,  // ADD      [a b i a+b]
+        0x92,  // SWAP3    [a+b b i a]
+        0x50,  // POP      [a+b b i]
+        0x91,  // SWAP2    [i b a+b]
+        0x90,  // SWAP1    [i a+b b]
+        0x91,  // SWAP2    [b a+b i]
+    };
+    const auto code = prepare(loop(body, 1, {0x60, 0x00, 0x60, 0x01}), 1);  // a=0 b=1
+    ExecutionContext ctx;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(interpret(*code, ctx, GAS).gas_left);
+    }
+    state.SetItemsProcessed(state.iterations() * LOOP_ITERATIONS);
+}
+BENCHMARK(BM_EVM_Fibonacci);
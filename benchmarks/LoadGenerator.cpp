@@ -0,0 +1,150 @@
+// Open-loop load generator; see LoadGenerator.hpp.
+//
+//   quids_loadgen --rate=5000 --duration=30 --target=http://127.0.0.1:8080
+//   quids_loadgen --rate=20000 --target=in-process
+//
+// Options: --rate (tx/s), --duration (s), --accounts, --contracts,
+// --token-share, --zipf, --senders, --seed, --target.
+
+#include "LoadGenerator.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "rollup/RollupTransactionAPI.hpp"
+#include <curl/curl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace quids;
+using namespace quids::bench;
+
+namespace {
+
+// One keep-alive connection per sender, posting to /tx/ingest
+class HttpTarget {
+public:
+    explicit HttpTarget(std::string base) : url_(std::move(base) + "/tx/ingest"), curl_(curl_easy_init()) {
+        if (!curl_) {
+            throw std::runtime_error("curl_easy_init failed");
+        }
+        headers_ = curl_slist_append(nullptr, "Content-Type: application/octet-stream");
+        curl_easy_setopt(curl_, CURLOPT_URL, url_.c_str());
+        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers_);
+        curl_easy_setopt(curl_, CURLOPT_TCP_NODELAY, 1L);
+        curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &HttpTarget::collect);
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &body_);
+    }
+
+    ~HttpTarget() {
+        curl_slist_free_all(headers_);
+        curl_easy_cleanup(curl_);
+    }
+
+    HttpTarget(const HttpTarget&) = delete;
+    HttpTarget& operator=(const HttpTarget&) = delete;
+
+    bool submit(const blockchain::ByteVector& bytes) {
+        body_.clear();
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, bytes.data());
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, static_cast<long>(bytes.size()));
+        if (curl_easy_perform(curl_) != CURLE_OK) {
+            return false;
+        }
+        long status = 0;
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &status);
+        // A shed call gets 429; an accepted one lists nothing as rejected
+        return status == 200 && body_.find("\"rejected\":[]") != std::string::npos;
+    }
+
+private:
+    static size_t collect(char* data, size_t size, size_t count, void* out) {
+        static_cast<std::string*>(out)->append(data, size * count);
+        return size * count;
+    }
+
+    std::string url_;
+    CURL* curl_;
+    curl_slist* headers_{nullptr};
+    std::string body_;
+};
+
+std::map<std::string, std::string> parseArgs(int argc, char** argv) {
+    std::map<std::string, std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            throw std::invalid_argument("expected --name=value, got " + arg);
+        }
+        args[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+    }
+    return args;
+}
+
+void printHistogram(const char* name, const utils::HistogramSnapshot& h) {
+    auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    std::printf("%-9s p50 %9.3f  p90 %9.3f  p99 %9.3f  p99.9 %9.3f  max %9.3f ms\n", name,
+                ms(h.quantile(0.5)), ms(h.quantile(0.9)), ms(h.quantile(0.99)), ms(h.quantile(0.999)), ms(h.max));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    LoadProfile profile;
+    std::string target = "in-process";
+    try {
+        for (const auto& [name, value] : parseArgs(argc, argv)) {
+            if (name == "rate") profile.rate = std::stod(value);
+            else if (name == "duration") profile.duration = std::chrono::milliseconds(static_cast<int64_t>(std::stod(value) * 1000));
+            else if (name == "accounts") profile.accounts = std::stoul(value);
+            else if (name == "contracts") profile.contracts = std::stoul(value);
+            else if (name == "token-share") profile.token_share = std::stod(value);
+            else if (name == "zipf") profile.zipf_exponent = std::stod(value);
+            else if (name == "senders") profile.send_threads = std::stoul(value);
+            else if (name == "seed") profile.seed = std::stoull(value);
+            else if (name == "target") target = value;
+            else throw std::invalid_argument("unknown option --" + name);
+        }
+        if (!(profile.rate > 0.0)) {
+            throw std::invalid_argument("--rate must be positive");
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+
+    const auto signing_start = std::chrono::steady_clock::now();
+    const auto schedule = buildSchedule(profile);
+    std::printf("signed %zu transactions in %.2f s\n", schedule.size(),
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - signing_start).count());
+
+    LoadReport report;
+    if (target == "in-process") {
+        rollup::RollupTransactionAPI api(nullptr);
+        api.start_processing();
+        report = runOpenLoop(schedule, [&api] {
+            return SubmitFn([&api](const blockchain::ByteVector& bytes) {
+                auto view = blockchain::TransactionView::parse(bytes);
+                return view && api.submitTransaction(std::make_shared<const blockchain::StandardTransaction>(view->materialize()));
+            });
+        }, profile.send_threads);
+        api.stop_processing();
+    } else {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        report = runOpenLoop(schedule, [&target] {
+            auto http = std::make_shared<HttpTarget>(target);
+            return SubmitFn([http](const blockchain::ByteVector& bytes) { return http->submit(bytes); });
+        }, profile.send_threads);
+        curl_global_cleanup();
+    }
+
+    std::printf("offered  %10.1f tx/s\nachieved %10.1f tx/s (%zu accepted, %zu rejected)\n", report.offered_rate,
+                report.achieved_rate, report.accepted, report.rejected);
+    std::printf("worst start delay %.3f ms\n", static_cast<double>(report.worst_start_delay.count()) / 1e6);
+    printHistogram("latency", report.latency);
+    printHistogram("service", report.service);
+    return 0;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Workloads.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/WorkStealingPool.hpp"
+
+namespace quids {
+namespace bench {
+
+// Open-loop load for a node.
+//
+// Closed-loop drivers submit the next batch only once the last one
+// returned, so a stall slows the driver down with the node and the stall
+// never shows in the numbers (coordinated omission). Here arrivals follow
+// a fixed schedule drawn up front, a Poisson process at the offered rate,
+// and every transaction's latency is measured from the moment it was due,
+// not from when a sender got round to it. A node that falls behind shows
+// up as a growing tail rather than as a lower send rate.
+
+inline std::string contractName(size_t i) {
+    return "contract_" + std::to_string(i);
+}
+
+// Draws k in [0, n) with probability proportional to 1 / (k + 1)^s, so a
+// few hot contracts take most of the calls
+class ZipfSampler {
+public:
+    ZipfSampler(size_t n, double exponent) : cdf_(std::max<size_t>(1, n)) {
+        double total = 0.0;
+        for (size_t k = 0; k < cdf_.size(); ++k) {
+            total += 1.0 / std::pow(static_cast<double>(k + 1), exponent);
+            cdf_[k] = total;
+        }
+        for (auto& c : cdf_) {
+            c /= total;
+        }
+    }
+
+    template<typename Rng>
+    size_t operator()(Rng& rng) const {
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        const auto it = std::lower_bound(cdf_.begin(), cdf_.end(), u);
+        return std::min<size_t>(static_cast<size_t>(it - cdf_.begin()), cdf_.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+struct LoadProfile {
+    double rate{1000.0};  // offered arrivals per second
+    std::chrono::milliseconds duration{10000};
+    size_t accounts{10000};
+    size_t contracts{100};
+    double token_share{0.3};     // fraction of arrivals that are token calls
+    double zipf_exponent{1.1};   // popularity skew across contracts
+    size_t send_threads{64};     // submissions that can be outstanding at once
+    uint64_t seed{1};
+};
+
+struct ScheduledTx {
+    std::chrono::nanoseconds due;  // from the start of the run
+    blockchain::ByteVector bytes;
+};
+
+// ERC-20 transfer(address,uint256) calldata
+inline blockchain::ByteVector tokenTransferData(const std::string& to, uint64_t amount) {
+    blockchain::ByteVector data{0xa9, 0x05, 0x9c, 0xbb};
+    data.resize(4 + 64, 0);
+    for (size_t i = 0; i < 20 && i < to.size(); ++i) {
+        data[4 + 12 + i] = static_cast<uint8_t>(to[i]);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        data[4 + 64 - 1 - i] = static_cast<uint8_t>(amount >> (8 * i));
+    }
+    return data;
+}
+
+// The whole run, drawn and signed before the clock starts. Arrival times
+// and the mix are drawn serially from the seed, so a profile always yields
+// the same schedule; signing is spread over the shared pool.
+inline std::vector<ScheduledTx> buildSchedule(const LoadProfile& profile) {
+    struct Draw {
+        size_t sender;
+        size_t target;
+        bool token;
+        uint64_t nonce;
+    };
+
+    std::mt19937_64 rng(profile.seed);
+    std::exponential_distribution<double> gap(profile.rate);
+    std::uniform_int_distribution<size_t> account(0, std::max<size_t>(1, profile.accounts) - 1);
+    std::bernoulli_distribution token(profile.token_share);
+    const ZipfSampler contract(profile.contracts, profile.zipf_exponent);
+
+    std::vector<uint64_t> nonces(std::max<size_t>(1, profile.accounts), 0);
+    std::vector<Draw> draws;
+    std::vector<std::chrono::nanoseconds> due;
+    const double horizon = std::chrono::duration<double>(profile.duration).count();
+    for (double t = gap(rng); t < horizon; t += gap(rng)) {
+        Draw d{account(rng), 0, profile.contracts > 0 && token(rng), 0};
+        d.target = d.token ? contract(rng) : account(rng);
+        d.nonce = ++nonces[d.sender];
+        draws.push_back(d);
+        due.emplace_back(static_cast<int64_t>(t * 1e9));
+    }
+
+    std::vector<ScheduledTx> schedule(draws.size());
+    utils::WorkStealingPool::global().parallel_for(0, draws.size(), [&](size_t i) {
+        const auto& d = draws[i];
+        const auto sender = accountName(d.sender);
+        schedule[i].due = due[i];
+        if (d.token) {
+            const auto to = accountName(d.nonce % std::max<size_t>(1, profile.accounts));
+            schedule[i].bytes = signedCall(sender, contractName(d.target), 0, d.nonce, tokenTransferData(to, 1), 60000);
+        } else {
+            schedule[i].bytes = signedTransfer(sender, accountName(d.target), 1, d.nonce);
+        }
+    }, utils::TaskPriority::Execution, 256);
+    return schedule;
+}
+
+// Hands one encoded transaction to the node; true when it was accepted
+using SubmitFn = std::function<bool(const blockchain::ByteVector&)>;
+
+struct LoadReport {
+    size_t scheduled{0};
+    size_t accepted{0};
+    size_t rejected{0};
+    double offered_rate{0.0};
+    double achieved_rate{0.0};  // accepted per second of wall time
+    // Due time to completion: what a client arriving on schedule sees
+    utils::HistogramSnapshot latency;
+    // Send to completion: the node's own service time, for comparison
+    utils::HistogramSnapshot service;
+    std::chrono::nanoseconds worst_start_delay{0};
+};
+
+// `make_submit` is called once per sender thread, so each can hold its own
+// connection. Senders take arrivals in schedule order and wait for each
+// one's due time; if all of them are busy, arrivals wait and that wait is
+// part of their latency.
+inline LoadReport runOpenLoop(const std::vector<ScheduledTx>& schedule,
+                              const std::function<SubmitFn()>& make_submit, size_t send_threads) {
+    using Clock = std::chrono::steady_clock;
+
+    utils::Histogram latency;
+    utils::Histogram service;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> accepted{0};
+    std::atomic<int64_t> worst_delay{0};
+
+    const auto start = Clock::now() + std::chrono::milliseconds(50);  // all senders up first
+    std::vector<std::thread> senders;
+    for (size_t t = 0; t < std::max<size_t>(1, send_threads); ++t) {
+        senders.emplace_back([&] {
+            const SubmitFn submit = make_submit();
+            for (size_t i = next.fetch_add(1); i < schedule.size(); i = next.fetch_add(1)) {
+                const auto due = start + schedule[i].due;
+                std::this_thread::sleep_until(due);
+                const auto sent = Clock::now();
+                const bool ok = submit(schedule[i].bytes);
+                const auto done = Clock::now();
+
+                latency.record(done - due);
+                service.record(done - sent);
+                if (ok) {
+                    accepted.fetch_add(1, std::memory_order_relaxed);
+                }
+                int64_t delay = std::chrono::duration_cast<std::chrono::nanoseconds>(sent - due).count();
+                int64_t seen = worst_delay.load(std::memory_order_relaxed);
+                while (delay > seen && !worst_delay.compare_exchange_weak(seen, delay, std::memory_order_relaxed)) {
+                }
+            }
+        });
+    }
+    for (auto& sender : senders) {
+        sender.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LoadReport report;
+    report.scheduled = schedule.size();
+    report.accepted = accepted.load();
+    report.rejected = report.scheduled - report.accepted;
+    if (!schedule.empty()) {
+        report.offered_rate = static_cast<double>(schedule.size()) /
+                              std::max(1e-9, std::chrono::duration<double>(schedule.back().due).count());
+    }
+    report.achieved_rate = elapsed > 0 ? static_cast<double>(report.accepted) / elapsed : 0.0;
+    report.latency = latency.snapshot();
+    report.service = service.snapshot();
+    report.worst_start_delay = std::chrono::nanoseconds(worst_delay.load());
+    return report;
+}
+
+} // namespace bench
+} // namespace quids
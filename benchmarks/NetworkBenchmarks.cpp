@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+#include "network/WireFormat.hpp"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace quids::network;
+
+namespace {
+
+std::vector<uint8_t> payloadOf(size_t size) {
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < size; ++i) {
+        payload[i] = static_cast<uint8_t>(i * 131 + 7);
+    }
+    return payload;
+}
+
+// A gossip-sized typed message: fixed fields, a body and a repeated field
+struct Announce {
+    static constexpr uint8_t WIRE_TYPE = wire::types::GOSSIP;
+    uint64_t id{0};
+    std::array<uint8_t, 32> origin{};
+    uint16_t ttl{0};
+    std::span<const uint8_t> body;
+    wire::Seq<uint64_t> seen;
+    QUIDS_WIRE_FIELDS(id, origin, ttl, body, seen)
+};
+
+} // namespace
+
+// Checksum alone over the payload sizes frames carry
+static void BM_Wire_Crc32c(benchmark::State& state) {
+    const auto payload = payloadOf(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(wire::crc32c(payload));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Wire_Crc32c)->RangeMultiplier(4)->Range(64, 64 << 10);
+
+// Header checks and checksum for one received frame; the payload is only
+// viewed, never copied
+static void BM_Wire_DecodeFrame(benchmark::State& state) {
+    std::vector<uint8_t> frame;
+    wire::appendFrame(frame, wire::types::GOSSIP, 0, payloadOf(static_cast<size_t>(state.range(0))));
+    for (auto _ : state) {
+        wire::Frame decoded;
+        benchmark::DoNotOptimize(wire::decodeFrame(frame, decoded));
+        benchmark::DoNotOptimize(decoded.payload.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(frame.size()));
+}
+BENCHMARK(BM_Wire_DecodeFrame)->Arg(64)->Arg(1024)->Arg(16 << 10);
+
+// A typed message into a reused buffer and back, framing included
+static void BM_Wire_MessageRoundTrip(benchmark::State& state) {
+    const auto body = payloadOf(static_cast<size_t>(state.range(0)));
+    const std::vector<uint64_t> seen{1, 2, 3, 4, 5, 6, 7, 8};
+    Announce message;
+    message.id = 42;
+    message.ttl = 6;
+    message.body = body;
+    message.seen = wire::Seq<uint64_t>(seen);
+    std::vector<uint8_t> buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        wire::encode(message, buffer);
+        wire::Frame frame;
+        Announce decoded;
+        if (wire::decodeFrame(buffer, frame) != wire::Status::Ok || !wire::decode(frame, decoded)) {
+            state.SkipWithError("round trip failed");
+            break;
+        }
+        benchmark::DoNotOptimize(decoded.body.data());
+    }
+}
+BENCHMARK(BM_Wire_MessageRoundTrip)->Arg(1024);
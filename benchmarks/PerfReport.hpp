@@ -0,0 +1,43 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include "utils/PerfCounters.hpp"
+#include <string>
+
+namespace quids {
+namespace bench {
+
+// Hardware counters per iteration for a stage the benchmark drives.
+// Construct before the timing loop and call report() after it; with
+// QUIDS_PERF_COUNTERS unset, or no PMU, nothing is added to the output.
+class StagePerf {
+public:
+    explicit StagePerf(utils::PerfStage stage)
+        : stage_(stage), before_(utils::PerfCounters::global().totals(stage)) {}
+
+    void report(benchmark::State& state) const {
+        if (!utils::PerfCounters::global().enabled() || state.iterations() == 0) {
+            return;
+        }
+        const auto after = utils::PerfCounters::global().totals(stage_);
+        if (after.scopes == before_.scopes) {
+            return;
+        }
+        utils::PerfCounters::StageTotals delta;
+        delta.scopes = after.scopes - before_.scopes;
+        delta.counts = after.counts - before_.counts;
+        const auto iterations = static_cast<double>(state.iterations());
+        for (size_t i = 0; i < utils::PerfSample::NUM_EVENTS; ++i) {
+            state.counters[std::string(utils::PerfSample::EVENT_NAMES[i]) + "/op"] =
+                static_cast<double>(delta.counts.values[i]) / iterations;
+        }
+        state.counters["ipc"] = delta.ipc();
+    }
+
+private:
+    const utils::PerfStage stage_;
+    const utils::PerfCounters::StageTotals before_;
+};
+
+} // namespace bench
+} // namespace quids
@@ -0,0 +1,196 @@
+#include <benchmark/benchmark.h>
+#include "PerfReport.hpp"
+#include "Workloads.hpp"
+#include "rollup/DataCompressor.hpp"
+#include "rollup/ParallelProcessor.hpp"
+#include "rollup/StateManager.hpp"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace quids;
+using namespace quids::rollup;
+using namespace quids::bench;
+
+namespace {
+
+constexpr size_t ACCOUNTS = 10000;
+
+StateManager::Account makeAccount(const std::string& address, uint64_t balance) {
+    StateManager::Account account;
+    account.address = address;
+    account.balance = balance;
+    account.nonce = 0;
+    return account;
+}
+
+// Built once and cloned per run, which is O(1)
+const StateManager& populatedState() {
+    static const auto state = [] {
+        auto s = std::make_unique<StateManager>();
+        for (size_t i = 0; i < ACCOUNTS; ++i) {
+            const auto address = accountName(i);
+            s->add_account(address, makeAccount(address, uint64_t{1} << 40));
+        }
+        (void)s->get_state_root();
+        return s;
+    }();
+    return *state;
+}
+
+// Transfers among a small set of accounts, as a sequencer would batch them
+std::vector<TransactionRecord> recordBatch(size_t count) {
+    std::vector<TransactionRecord> batch;
+    std::vector<uint64_t> nonces(16, 100);
+    for (size_t i = 0; i < count; ++i) {
+        TransactionRecord tx;
+        tx.sender = "0x" + std::string(38, 'a') + std::to_string(10 + i % 16);
+        tx.recipient = "0x" + std::string(38, 'b') + std::to_string(10 + i % 7);
+        tx.nonce = nonces[i % 16]++;
+        tx.value = 1000 * (i % 50);
+        tx.gas_cost = 21000;
+        tx.timestamp_us = 1'700'000'000'000'000 + static_cast<int64_t>(i) * 250;
+        for (size_t b = 0; b < tx.signature.size(); ++b) {
+            tx.signature[b] = static_cast<uint8_t>((i * 131 + b * 17) ^ (i >> 3));
+        }
+        if (i % 4 == 0) tx.data = {0xa9, 0x05, 0x9c, 0xbb, static_cast<uint8_t>(i)};
+        batch.push_back(std::move(tx));
+    }
+    return batch;
+}
+
+// Bytes the batch takes as plain rows
+size_t rowSize(const std::vector<TransactionRecord>& batch) {
+    size_t total = 0;
+    for (const auto& tx : batch) {
+        total += tx.sender.size() + tx.recipient.size() + 4 * sizeof(uint64_t) +
+                 tx.signature.size() + tx.data.size();
+    }
+    return total;
+}
+
+} // namespace
+
+// One block's transfers applied to a 10k-account state, signatures
+// already checked as the mempool leaves them
+static void BM_StateManager_Apply(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    std::vector<blockchain::StandardTransaction> txs;
+    std::vector<uint64_t> nonces(ACCOUNTS, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t sender = (i * 7919) % ACCOUNTS;
+        txs.push_back(transfer(accountName(sender), accountName((sender + 1) % ACCOUNTS), 1, ++nonces[sender]));
+        (void)txs.back().verified();
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto working = populatedState().clone();
+        state.ResumeTiming();
+        for (const auto& tx : txs) {
+            if (!working->apply_transaction(tx)) {
+                state.SkipWithError("transfer rejected");
+                break;
+            }
+        }
+        state.PauseTiming();
+        working.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StateManager_Apply)->Arg(100)->Arg(1000);
+
+// Root after range(0) accounts change; only their paths are rehashed
+static void BM_StateManager_Root(benchmark::State& state) {
+    const size_t dirty = static_cast<size_t>(state.range(0));
+    auto working = populatedState().clone();
+    uint64_t round = 0;
+    StagePerf perf(utils::PerfStage::StateRoot);
+    for (auto _ : state) {
+        state.PauseTiming();
+        ++round;
+        for (size_t i = 0; i < dirty; ++i) {
+            working->set_balance(accountName((i * 7919 + round) % ACCOUNTS), round);
+        }
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(working->get_state_root());
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StateManager_Root)->Arg(1)->Arg(100)->Arg(1000);
+
+// Prospective root for a block's leaves, without touching the state
+static void BM_StateManager_RootAfter(benchmark::State& state) {
+    const auto& base = populatedState();
+    std::vector<std::pair<std::string, StateTrie::Hash>> leaves;
+    for (size_t i = 0; i < static_cast<size_t>(state.range(0)); ++i) {
+        const auto address = accountName((i * 7919) % ACCOUNTS);
+        leaves.emplace_back(address, StateManager::account_hash(makeAccount(address, i)));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(base.root_after(leaves));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StateManager_RootAfter)->Arg(100)->Arg(1000);
+
+// range(0) percent of the calls go to one hot contract and are run in
+// order; the rest each have a contract of their own
+static void BM_ParallelProcessor_Conflicts(benchmark::State& state) {
+    constexpr size_t CALLS = 512;
+    // i = 200; do { i -= 1 } while (i != 0); STOP
+    const std::vector<uint8_t> code = {0x60, 0xc8, 0x5b, 0x60, 0x01, 0x90, 0x03, 0x80, 0x60, 0x02, 0x57, 0x00};
+    const auto conflict_percent = static_cast<size_t>(state.range(0));
+
+    std::vector<ParallelProcessor::ContractCall> calls(CALLS);
+    for (size_t i = 0; i < CALLS; ++i) {
+        auto& call = calls[i];
+        call.contract_address = ::evm::Address{};
+        if (i % 100 >= conflict_percent) {
+            call.contract_address.bytes[18] = static_cast<uint8_t>((i + 1) >> 8);
+            call.contract_address.bytes[19] = static_cast<uint8_t>(i + 1);
+        }
+        call.input = code;  // executed as the contract code
+        call.gas_limit = 100000;
+    }
+
+    ParallelProcessor processor(ParallelProcessor::Config{});
+    for (auto _ : state) {
+        auto results = processor.executeContracts(calls);
+        for (auto& result : results) {
+            benchmark::DoNotOptimize(result.get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * CALLS);
+}
+BENCHMARK(BM_ParallelProcessor_Conflicts)->Arg(0)->Arg(10)->Arg(50)->Arg(100)->UseRealTime();
+
+// bytes_per_second is against the plain row size; ratio is row bytes
+// over compressed bytes
+static void BM_DataCompressor_Compress(benchmark::State& state) {
+    const auto batch = recordBatch(static_cast<size_t>(state.range(0)));
+    const auto rows = rowSize(batch);
+    size_t compressed = 0;
+    for (auto _ : state) {
+        auto packed = DataCompressor::compress_batch(batch);
+        compressed = packed.compressed_data.size();
+        benchmark::DoNotOptimize(packed);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rows));
+    state.counters["ratio"] = compressed ? static_cast<double>(rows) / static_cast<double>(compressed) : 0.0;
+}
+BENCHMARK(BM_DataCompressor_Compress)->Arg(100)->Arg(1000)->Arg(10000);
+
+static void BM_DataCompressor_Decompress(benchmark::State& state) {
+    const auto batch = recordBatch(static_cast<size_t>(state.range(0)));
+    const auto rows = rowSize(batch);
+    const auto packed = DataCompressor::compress_batch(batch);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(DataCompressor::decompress_batch(packed));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rows));
+}
+BENCHMARK(BM_DataCompressor_Decompress)->Arg(1000)->Arg(10000);
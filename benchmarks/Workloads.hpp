@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "blockchain/TransactionView.hpp"
+#include "crypto/blake3/Blake3Hash.hpp"
+
+namespace quids {
+namespace bench {
+
+// Inputs shared by the blockchain and rollup suites
+
+inline std::string accountName(size_t i) {
+    return "account_" + std::to_string(i);
+}
+
+// A call in the canonical wire format, signed the way
+// TransactionView::verify() checks it: BLAKE3 over the signed prefix
+inline blockchain::ByteVector signedCall(const std::string& sender, const std::string& recipient, uint64_t value,
+                                         uint64_t nonce, const blockchain::ByteVector& data, uint64_t gas) {
+    blockchain::ByteVector out{blockchain::wire::VERSION};
+    auto put = [&](uint64_t v, size_t width) {
+        for (size_t i = 0; i < width; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    };
+    put(1'700'000'000'000'000 + nonce, 8);
+    put(value, 8);
+    put(nonce, 8);
+    put(gas, 8);
+    put(sender.size(), 2);
+    put(recipient.size(), 2);
+    put(data.size(), 4);
+    out.insert(out.end(), sender.begin(), sender.end());
+    out.insert(out.end(), recipient.begin(), recipient.end());
+    out.insert(out.end(), data.begin(), data.end());
+
+    crypto::Blake3Hash hasher;
+    hasher.update(out.data(), out.size());
+    const auto signature = hasher.finalize();
+    out.insert(out.end(), signature.begin(), signature.begin() + blockchain::wire::SIGNATURE_SIZE);
+    return out;
+}
+
+inline blockchain::ByteVector signedTransfer(const std::string& sender, const std::string& recipient,
+                                             uint64_t value, uint64_t nonce) {
+    return signedCall(sender, recipient, value, nonce, {}, 21000);
+}
+
+inline blockchain::StandardTransaction transfer(const std::string& sender, const std::string& recipient,
+                                                uint64_t value, uint64_t nonce) {
+    const auto bytes = signedTransfer(sender, recipient, value, nonce);
+    return blockchain::TransactionView::parse(bytes)->materialize();
+}
+
+} // namespace bench
+} // namespace quids
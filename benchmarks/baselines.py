@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Runs quids_benchmarks suite by suite and checks each against its baseline.
+
+Every suite is written to <out-dir>/<suite>.json in Google Benchmark's JSON
+format and compared with benchmarks/baselines/<suite>.json. A benchmark whose
+time grew by more than the threshold is reported and makes the run fail.
+Baselines are recorded on release hardware with --update and committed, so
+one suite can be refreshed without touching the others.
+
+    baselines.py --binary build/benchmarks/quids_benchmarks
+    baselines.py --binary ... --suite rollup --update
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+SUITES = {
+    "crypto": "^BM_(Falcon|Dilithium|Sphincs|Kyber|Blake3|Sha3|Merkle)_",
+    "evm": "^BM_EVM_",
+    "rollup": "^BM_(StateManager|ParallelProcessor|DataCompressor)_",
+    "blockchain": "^BM_Block",
+    "consensus": "POBPC_",
+    "network": "^BM_Wire_",
+}
+
+BASELINE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "baselines")
+
+
+def run_suite(binary, suite, out_path, repetitions):
+    subprocess.run([
+        binary,
+        "--benchmark_filter=" + SUITES[suite],
+        "--benchmark_out=" + out_path,
+        "--benchmark_out_format=json",
+        "--benchmark_repetitions=%d" % repetitions,
+        "--benchmark_report_aggregates_only=true",
+    ], check=True)
+
+
+def times(path):
+    # Median of the repetitions where there are several, the run otherwise
+    with open(path) as f:
+        benchmarks = json.load(f)["benchmarks"]
+    result = {}
+    for b in benchmarks:
+        if b.get("error_occurred"):
+            continue
+        if b.get("run_type") == "aggregate" and b.get("aggregate_name") != "median":
+            continue
+        result[b.get("run_name", b["name"])] = b["real_time"] * unit_ns(b["time_unit"])
+    return result
+
+
+def unit_ns(unit):
+    return {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}[unit]
+
+
+def compare(suite, current_path, threshold):
+    baseline_path = os.path.join(BASELINE_DIR, suite + ".json")
+    if not os.path.exists(baseline_path):
+        print("%s: no baseline, record one with --update" % suite)
+        return True
+    baseline = times(baseline_path)
+    current = times(current_path)
+    ok = True
+    for name, old in sorted(baseline.items()):
+        new = current.get(name)
+        if new is None:
+            print("%s: %s missing from this run" % (suite, name))
+            continue
+        change = (new - old) / old
+        marker = ""
+        if change > threshold:
+            marker = "  REGRESSION"
+            ok = False
+        print("%s: %-60s %12.0f ns -> %12.0f ns %+7.1f%%%s" % (suite, name, old, new, 100 * change, marker))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--binary", required=True, help="path to quids_benchmarks")
+    parser.add_argument("--suite", action="append", choices=sorted(SUITES), help="suites to run, default all")
+    parser.add_argument("--out-dir", default="benchmark_results")
+    parser.add_argument("--repetitions", type=int, default=5)
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed slowdown, 0.10 is 10%%")
+    parser.add_argument("--update", action="store_true", help="replace the baselines with this run")
+    args = parser.parse_args()
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    ok = True
+    for suite in args.suite or sorted(SUITES):
+        out_path = os.path.join(args.out_dir, suite + ".json")
+        run_suite(args.binary, suite, out_path, args.repetitions)
+        if args.update:
+            os.makedirs(BASELINE_DIR, exist_ok=True)
+            shutil.copyfile(out_path, os.path.join(BASELINE_DIR, suite + ".json"))
+            print("%s: baseline updated" % suite)
+        else:
+            ok = compare(suite, out_path, args.threshold) and ok
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
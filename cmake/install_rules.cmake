@@ -5,6 +5,7 @@ include(GNUInstallDirs)
 # Install all targets together to ensure proper export set handling
 install(TARGETS 
     project_includes
+    common
     crypto
     storage
     quantum
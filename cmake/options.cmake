@@ -5,6 +5,9 @@ option(BUILD_BENCHMARKS "Build benchmarks" OFF)
 option(USE_SANITIZERS "Enable sanitizers in debug builds" OFF)
 option(BUILD_SHARED_LIBS "Build shared libraries" ON)
 option(USE_CCACHE "Use ccache if available" ON)
+option(QUIDS_ENABLE_GPU "Offload large quantum simulations to a GPU" OFF)
+set(QUIDS_GPU_RUNTIME "CUDA" CACHE STRING "GPU runtime when QUIDS_ENABLE_GPU is on: CUDA or HIP")
+set_property(CACHE QUIDS_GPU_RUNTIME PROPERTY STRINGS CUDA HIP)
 
 # Print build configuration
 message(STATUS "")
@@ -15,4 +18,5 @@ message(STATUS "  Build benchmarks: ${BUILD_BENCHMARKS}")
 message(STATUS "  Use sanitizers: ${USE_SANITIZERS}")
 message(STATUS "  Build shared libs: ${BUILD_SHARED_LIBS}")
 message(STATUS "  Use ccache: ${USE_CCACHE}")
+message(STATUS "  GPU simulation: ${QUIDS_ENABLE_GPU} (${QUIDS_GPU_RUNTIME})")
 message(STATUS "")
\ No newline at end of file
@@ -43,7 +43,7 @@ int main() {
         // Register message handler
         node.register_message_handler([](const std::string& peer_address,
                                       uint16_t peer_port,
-                                      const std::vector<uint8_t>& message) {
+                                      std::span<const uint8_t> message) {
             std::cout << "Received message from " << peer_address 
                       << ":" << peer_port 
                       << " (size: " << message.size() << " bytes)" << std::endl;
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace quids {
+namespace api {
+
+// Serialized responses of read endpoints, keyed by endpoint and
+// arguments. A body is built once and shared by every request that hits
+// it, and its ETag lets clients revalidate without a body at all.
+//
+// Final entries (finalized blocks) never go stale; they age out in two
+// generations like SignatureCache. Head entries depend on the chain tip
+// and are all dropped by on_new_block().
+class ResponseCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    enum class Lifetime {
+        Final,
+        UntilNextBlock
+    };
+
+    struct Entry {
+        std::shared_ptr<const std::string> body;
+        std::string etag;  // quoted, ready for the header
+    };
+
+    explicit ResponseCache(size_t capacity = DEFAULT_CAPACITY);
+
+    [[nodiscard]] std::optional<Entry> get(const std::string& key) const;
+    Entry put(const std::string& key, std::string body, Lifetime lifetime);
+
+    void on_new_block();
+    void clear();
+
+    [[nodiscard]] size_t size() const;
+
+    // True when an If-None-Match header value names the entry
+    [[nodiscard]] static bool matches(const Entry& entry, const std::string& if_none_match);
+
+private:
+    using Map = std::unordered_map<std::string, Entry>;
+
+    static std::string make_etag(const std::string& body, uint64_t generation);
+
+    size_t generation_capacity_;
+    mutable std::shared_mutex mutex_;
+    Map current_;
+    Map previous_;
+    Map head_;
+    // Head ETags include it, so a client cannot revalidate across blocks
+    uint64_t block_generation_{0};
+};
+
+} // namespace api
+} // namespace quids
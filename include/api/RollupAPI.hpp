@@ -3,10 +3,19 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <span>
+#include <thread>
+#include <algorithm>
+#include <chrono>
 #include <nlohmann/json.hpp>
 #include "rollup/RollupTransactionAPI.hpp"
 #include "rollup/StateManager.hpp"
 #include "l1/RollupContract.hpp"
+#include "storage/BlockArchive.hpp"
+#include "rollup/HistoryIndexer.hpp"
+#include "rollup/WithdrawalBatcher.hpp"
+#include "rollup/TransactionSimulator.hpp"
+#include "api/SubmitPayload.hpp"
 
 namespace quids {
 namespace api {
@@ -22,12 +31,25 @@ public:
         std::string ssl_cert_path;
         std::string ssl_key_path;
         std::vector<std::string> allowed_origins;
+        // Connections are served by a pool rather than one thread
+        size_t worker_threads{std::max(2u, std::thread::hardware_concurrency())};
+        size_t keep_alive_requests{1000};
+        size_t max_batch_size{1000};         // calls in one JSON-RPC batch
+        size_t max_ingest_bytes{64u << 20};  // body of one /tx/ingest request
+        size_t response_cache_entries{4096};
+        size_t max_queued_events{1024};      // per subscriber before it is dropped
+        size_t max_history_page{1000};       // entries per get_account_transactions call
+        size_t proof_cache_entries{8192};
+        size_t max_proof_accounts{1000};     // addresses in one get_proof call
+        rollup::TransactionSimulator::Config simulator;
     };
 
     struct APIResponse {
         bool success;
         json data;
         std::string error_message;
+        // Set when the submission was shed; answered with 429 and Retry-After
+        std::chrono::milliseconds retry_after{0};
     };
 
     explicit RollupAPI(
@@ -49,6 +71,19 @@ public:
     void start();
     void stop();
 
+    // Finalized blocks served by the block endpoints
+    void set_block_archive(std::shared_ptr<storage::BlockArchive> archive);
+    // Account history served by get_account_transactions
+    void set_history_indexer(std::shared_ptr<rollup::HistoryIndexer> indexer);
+    // Queue initiate_withdrawal adds to; the node seals it with each state
+    // commitment
+    void set_withdrawal_batcher(std::shared_ptr<rollup::WithdrawalBatcher> batcher);
+
+    // Called by the node for every new head, once the block is archived:
+    // drops cached responses that depend on the tip and pushes header to
+    // newHeads subscribers
+    void on_new_block(uint64_t number, const json& header);
+
     // Transaction endpoints
     APIResponse submit_transaction(const json& params);
     APIResponse get_transaction(const json& params);
@@ -67,10 +102,16 @@ public:
     // State endpoints
     APIResponse get_state_root(const json& params);
     APIResponse get_proof(const json& params);
+    // Dry runs on the latest snapshot; nothing is signed or committed
+    APIResponse simulate_transaction(const json& params);
+    APIResponse estimate_gas(const json& params);
     
     // Bridge endpoints
     APIResponse initiate_deposit(const json& params);
+    // Debits the L2 balance and queues the withdrawal for the next batch
     APIResponse initiate_withdrawal(const json& params);
+    // Inclusion proof to claim with on L1, once the batch is sealed
+    APIResponse get_withdrawal_proof(const json& params);
     APIResponse get_bridge_events(const json& params);
     
     // Validator endpoints
@@ -86,10 +127,20 @@ private:
     std::shared_ptr<RollupTransactionAPI> tx_api_;
     std::shared_ptr<StateManager> state_manager_;
     std::shared_ptr<RollupContract> l1_contract_;
+    std::shared_ptr<storage::BlockArchive> block_archive_;
+    std::shared_ptr<rollup::HistoryIndexer> history_indexer_;
+    std::shared_ptr<rollup::WithdrawalBatcher> withdrawal_batcher_;
     
     // Internal helper methods
     void setup_routes();
     APIResponse handle_request(const std::string& method, const json& params);
+    // One JSON-RPC 2.0 call or batch. Returns null when there is nothing
+    // to send back, i.e. every call was a notification.
+    json handle_rpc(const json& body);
+    json handle_rpc_call(const json& call);
+    // body is one or more canonical transactions packed back to back
+    APIResponse ingest_transactions(std::span<const uint8_t> body);
+    APIResponse submit_payload(const SubmitPayload& payload);
     bool validate_params(const json& params, const std::vector<std::string>& required);
 
     // Implementation details
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "blockchain/Types.hpp"
+
+namespace quids {
+namespace api {
+
+// Fields of a submit_transaction request. Strings point into the request
+// body, so it must outlive the payload.
+struct SubmitPayload {
+    std::string_view sender;
+    std::string_view recipient;
+    std::string_view signature;  // hex, 32 bytes
+    std::string_view data;       // hex, may be empty
+    std::string_view raw;        // hex canonical encoding; replaces every other field
+    uint64_t amount{0};
+    uint64_t nonce{0};
+    uint64_t gas_cost{0};
+    std::optional<int64_t> timestamp;  // microseconds since the epoch; now if absent
+    bool has_amount{false};
+};
+
+// Single pass over a flat JSON object, with no DOM and no allocation.
+// Gives nullopt for anything outside the common shape -- nested values,
+// escaped strings, signs, fractions -- so the caller can fall back to the
+// full parser. Numbers may also arrive as decimal strings.
+std::optional<SubmitPayload> scan_submit_payload(std::string_view body) noexcept;
+
+// Canonical wire encoding of the payload, or nullopt when a required
+// field is missing or a hex field is malformed
+std::optional<blockchain::ByteVector> encode_submit_payload(const SubmitPayload& payload);
+
+} // namespace api
+} // namespace quids
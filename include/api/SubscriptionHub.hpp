@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace quids {
+namespace api {
+
+// Fan-out of chain events to streaming clients. Each event is framed
+// once as a server-sent event and the same buffer is queued for every
+// subscriber of its topic.
+//
+// A subscriber that falls max_queued events behind is closed rather than
+// allowed to hold memory for the whole node; it can resubscribe and catch
+// up over the regular endpoints.
+class SubscriptionHub {
+public:
+    enum class Topic : uint8_t {
+        NewHeads = 1 << 0,
+        PendingTx = 1 << 1
+    };
+
+    using Frame = std::shared_ptr<const std::string>;
+
+    class Subscription {
+    public:
+        // Queued frames, waiting up to timeout for the first one. Empty on
+        // timeout, nullopt once the subscription is closed.
+        std::optional<std::vector<Frame>> wait(std::chrono::milliseconds timeout);
+        void close();
+        [[nodiscard]] bool closed() const;
+
+    private:
+        friend class SubscriptionHub;
+
+        explicit Subscription(uint8_t topics) : topics_(topics) {}
+
+        uint8_t topics_;
+        mutable std::mutex mutex_;
+        std::condition_variable ready_;
+        std::deque<Frame> queue_;
+        bool closed_{false};
+    };
+
+    explicit SubscriptionHub(size_t max_queued = 1024) : max_queued_(max_queued) {}
+    ~SubscriptionHub();
+
+    // "newHeads" or "pendingTx"
+    static std::optional<Topic> parse_topic(std::string_view name);
+
+    std::shared_ptr<Subscription> subscribe(const std::vector<Topic>& topics);
+    void publish(Topic topic, const nlohmann::json& event);
+    // Closes every subscription, e.g. on shutdown
+    void close_all();
+
+    [[nodiscard]] size_t subscriber_count() const;
+
+private:
+    size_t max_queued_;
+    mutable std::mutex mutex_;
+    std::vector<std::weak_ptr<Subscription>> subscribers_;
+};
+
+} // namespace api
+} // namespace quids
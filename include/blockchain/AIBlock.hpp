@@ -10,6 +10,7 @@
 #include <chrono>
 #include <array>
 #include <optional>
+#include <span>
 #include <vector>
 #include <functional>
 
@@ -41,9 +42,7 @@ public:
     ~AIBlock() override;
 
     // Block interface implementation
-    bool addTransaction(const Transaction& tx) override;
-    size_t getTransactionCount() const override;
-    const Transaction& getTransaction(size_t index) const override;
+    bool addTransaction(TransactionPtr tx) override;
     bool verifyTransactions() const override;
     bool verify() const override;
     ByteArray hash() const override;
@@ -65,7 +64,7 @@ public:
 
 protected:
     void processBlockParallel();
-    void processTransactionsSIMD(const ::std::vector<::std::reference_wrapper<const Transaction>>& batch);
+    void processTransactionsSIMD(::std::span<const TransactionPtr> batch);
     void applyQuantumCircuit(QuantumState& state) const;
     double computeTransactionEntropy() const;
     void updateMetrics();
@@ -86,9 +85,6 @@ private:
     mutable ::std::mutex mutex_;
     ::std::optional<ByteArray> cachedHash_;
     ::std::optional<ByteArray> cachedMerkleRoot_;
-    uint64_t blockNumber_{0};
-    ByteArray previousHash_{};
-    ByteArray merkleRoot_{};
     ::std::chrono::system_clock::time_point timestamp_{::std::chrono::system_clock::now()};
     uint64_t nonce_{0};
     uint64_t difficulty_{0};
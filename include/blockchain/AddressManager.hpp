@@ -9,7 +9,8 @@
 #include <optional>
 #include <array>
 #include <unordered_map>
-#include <complex>
+#include <span>
+#include <string_view>
 
 namespace quids {
 namespace blockchain {
@@ -33,9 +34,18 @@ public:
         std::string purpose;
     };
 
-    // VSS-related structures
+    // Verifiable secret sharing of a location over GF(2^61 - 1). Each
+    // component of the location vector has its own polynomial whose
+    // constant term is the component in fixed point, SHARE_SCALE units per
+    // degree; shares are plain field elements in fixed-size arrays.
+    static constexpr size_t LOCATION_VECTOR_SIZE = 4;
+    static constexpr size_t MIN_SHARES = 3;
+    static constexpr size_t MAX_SHARES = 10;
+    static constexpr uint64_t FIELD_PRIME = (uint64_t{1} << 61) - 1;
+    static constexpr double SHARE_SCALE = 1e9;
+
     struct VSSShare {
-        std::vector<std::complex<double>> data;
+        std::array<uint64_t, LOCATION_VECTOR_SIZE> data;
         size_t index;
         std::array<uint8_t, 32> commitment;
     };
@@ -46,6 +56,21 @@ public:
         std::array<uint8_t, 32> root_commitment;
     };
 
+    // Weights that interpolate one set of share indices at zero. Build them
+    // once per set of share holders and reuse them for every address
+    // those holders reconstruct.
+    struct LagrangeCoefficients {
+        std::array<size_t, MAX_SHARES> indices{};
+        std::array<uint64_t, MAX_SHARES> weights{};
+        size_t count{0};
+    };
+
+    // Accounts are keyed by the 32-byte binary address. String addresses
+    // are parsed once, at the edge: an optional "qu_0x" or "0x" prefix and
+    // up to 64 hex digits, right-aligned so 20-byte addresses fit.
+    using AccountKey = std::array<uint8_t, 32>;
+    static std::optional<AccountKey> accountKey(std::string_view address);
+
     static constexpr size_t ADDRESS_LENGTH = 42;  // Example: "qu_0x" + 32 bytes (64 hex chars)
     static constexpr const char* ADDRESS_PREFIX = "qu_0x";
 
@@ -59,15 +84,32 @@ public:
 
     // VSS methods
     VSSScheme generateShares(const LocationData& location, size_t num_shares, size_t threshold);
+    // Same as generateShares for each location, with the evaluation table
+    // and the random coefficients drawn once for the whole batch
+    std::vector<VSSScheme> generateSharesBatch(std::span<const LocationData> locations,
+                                               size_t num_shares, size_t threshold);
     bool verifyShare(const VSSShare& share, const std::array<uint8_t, 32>& root_commitment);
+    // Interpolates the first `threshold` shares
     std::optional<LocationData> reconstructLocation(const std::vector<VSSShare>& shares, size_t threshold);
-
-    // Account management
+    // shares in the order of coefficients.indices
+    std::optional<LocationData> reconstructLocation(std::span<const VSSShare> shares,
+                                                    const LagrangeCoefficients& coefficients);
+    // Nullopt when the indices are zero, repeated, too many or too large
+    static std::optional<LagrangeCoefficients> lagrangeCoefficients(std::span<const size_t> indices);
+
+    // Account management. The table is sharded; operations on different
+    // accounts run concurrently, and balances and nonces change atomically
+    // under a shared shard lock. A transfer locks its two shards in shard
+    // order. String overloads parse the address and fail as "no account"
+    // when it does not parse.
     bool create_account(const std::string& address, uint64_t initial_balance);
     bool create_contract_account(const std::string& address, const std::vector<uint8_t>& code, uint64_t initial_balance);
     bool delete_account(const std::string& address);
     bool transfer(const std::string& from, const std::string& to, uint64_t amount);
 
+    bool create_account(const AccountKey& key, const std::string& address, uint64_t initial_balance);
+    bool transfer(const AccountKey& from, const AccountKey& to, uint64_t amount);
+
     // Account queries
     uint64_t get_balance(const std::string& address) const;
     bool set_balance(const std::string& address, uint64_t balance);
@@ -78,6 +120,12 @@ public:
     bool account_exists(const std::string& address) const;
     bool is_contract_account(const std::string& address) const;
 
+    uint64_t get_balance(const AccountKey& key) const;
+    bool set_balance(const AccountKey& key, uint64_t balance);
+    uint64_t get_nonce(const AccountKey& key) const;
+    bool increment_nonce(const AccountKey& key);
+    bool account_exists(const AccountKey& key) const;
+
     // Quantum state management
     bool register_quantum_state(const std::string& address, const quantum::QuantumState& state);
     bool verify_quantum_state(const std::string& address, const quantum::QuantumState& state) const;
@@ -97,15 +145,7 @@ private:
     std::optional<AddressComponents> decodeAddress(const std::string& address);
 
     // VSS helper methods
-    std::vector<std::complex<double>> createPolynomial(const std::vector<double>& coefficients, size_t degree);
-    std::vector<std::complex<double>> evaluatePolynomial(const std::vector<std::complex<double>>& poly, std::complex<double> x);
-    std::array<uint8_t, 32> computeShareCommitment(const std::vector<std::complex<double>>& share_data);
-
-    // Constants
-    static constexpr size_t LOCATION_VECTOR_SIZE = 4;
-    static constexpr size_t MIN_SHARES = 3;
-    static constexpr size_t MAX_SHARES = 10;
-    static constexpr size_t POLYNOMIAL_DEGREE = 8;
+    std::array<uint8_t, 32> computeShareCommitment(std::span<const uint64_t> share_data);
 };
 
 } // namespace blockchain
@@ -3,8 +3,10 @@
 
 #include "Types.hpp"
 #include "Transaction.hpp"
+#include "QuantumBlockMetrics.hpp"
 #include <vector>
 #include <memory>
+#include <span>
 
 /**
  * @file Block.hpp
@@ -37,7 +39,13 @@ public:
     Block& operator=(Block&&) noexcept = default;
 
     // Pure virtual methods that derived classes must implement
-    virtual bool addTransaction(const Transaction& tx) = 0;
+    /**
+     * @brief Appends a transaction by handle
+     *
+     * The block shares ownership instead of copying, and stores the
+     * transaction's hash alongside it.
+     */
+    virtual bool addTransaction(TransactionPtr tx) = 0;
     virtual bool verify() const = 0;
     virtual Hash hash() const = 0;
     virtual void computeHash() = 0;
@@ -47,65 +55,52 @@ public:
     virtual void serialize(ByteVector& out) const = 0;
     virtual void deserialize(const ByteVector& in) = 0;
 
+    virtual size_t getTransactionCount() const { return transactions_.size(); }
+    virtual const Transaction& getTransaction(size_t index) const { return *transactions_.at(index); }
+    /**
+     * @brief Hashes of the transactions, in block order
+     */
+    [[nodiscard]] const ::std::vector<Hash>& transactionHashes() const noexcept { return transactionHashes_; }
+    [[nodiscard]] ::std::span<const TransactionPtr> transactions() const noexcept { return transactions_; }
+    [[nodiscard]] const Hash& merkleRoot() const noexcept { return merkleRoot_; }
+    [[nodiscard]] const Hash& previousHash() const noexcept { return previousHash_; }
+    [[nodiscard]] BlockNumber number() const noexcept { return number_; }
+    /**
+     * @brief Reserves room for n transactions ahead of assembly
+     */
+    void reserveTransactions(size_t n);
+
 protected:
     Block() = default;
 
     // Protected members
-    Hash previousHash_;
-    Hash merkleRoot_;
+    Hash previousHash_{};
+    Hash merkleRoot_{};
     BlockNumber number_{0};
     Timestamp timestamp_{::std::chrono::system_clock::now()};
-    ::std::vector<Transaction> transactions_;
+    /**
+     * @brief Stores tx and its hash; for addTransaction() implementations
+     */
+    void appendTransaction(TransactionPtr tx);
+
+    ::std::vector<TransactionPtr> transactions_;
+    // transactionHashes_[i] is transactions_[i]->hash()
     ::std::vector<Hash> transactionHashes_;
-    ::std::vector<double> quantumStates_;
-    ::std::vector<double> quantumAmplitudes_;
-    ::std::vector<double> quantumPhases_;
-    ::std::vector<double> quantumEntanglement_;
-    ::std::vector<double> quantumSuperposition_;
-    ::std::vector<double> quantumDecoherence_;
-    ::std::vector<double> quantumInterference_;
-    ::std::vector<double> quantumTeleportation_;
-    ::std::vector<double> quantumErrorCorrection_;
-    ::std::vector<double> quantumGates_;
-    ::std::vector<double> quantumMeasurements_;
-    ::std::vector<double> quantumFeatures_;
-    ::std::vector<double> quantumMetrics_;
-    ::std::vector<double> quantumParameters_;
-    ::std::vector<double> quantumGradients_;
-    ::std::vector<double> quantumOptimization_;
-    ::std::vector<double> quantumLearning_;
-    ::std::vector<double> quantumPredictions_;
-    ::std::vector<double> quantumProbabilities_;
-    ::std::vector<double> quantumStatistics_;
-    ::std::vector<double> quantumCorrelations_;
-    ::std::vector<double> quantumCoherence_;
-    ::std::vector<double> quantumEntropy_;
-    ::std::vector<double> quantumFidelity_;
-    ::std::vector<double> quantumPurity_;
-    ::std::vector<double> quantumConcurrence_;
-    ::std::vector<double> quantumDiscord_;
-    ::std::vector<double> quantumNegentropy_;
-    ::std::vector<double> quantumInformation_;
-    ::std::vector<double> quantumComplexity_;
-    ::std::vector<double> quantumCapacity_;
-    ::std::vector<double> quantumEfficiency_;
-    ::std::vector<double> quantumRobustness_;
-    ::std::vector<double> quantumResilience_;
-    ::std::vector<double> quantumSecurity_;
-    ::std::vector<double> quantumPrivacy_;
-    ::std::vector<double> quantumAuthenticity_;
-    ::std::vector<double> quantumIntegrity_;
-    ::std::vector<double> quantumConfidentiality_;
-    ::std::vector<double> quantumAvailability_;
-    ::std::vector<double> quantumReliability_;
-    ::std::vector<double> quantumPerformance_;
-    ::std::vector<double> quantumScalability_;
-    ::std::vector<double> quantumThroughput_;
-    ::std::vector<double> quantumLatency_;
-    ::std::vector<double> quantumBandwidth_;
-    ::std::vector<double> quantumUtilization_;
-    ::std::vector<double> quantumEffectiveness_;
-    ::std::vector<double> quantumQuality_;
+
+    /**
+     * @brief Quantum series recorded for this block, allocated on first use
+     *
+     * Most blocks record none, so they carry a null pointer instead of a
+     * vector header per series.
+     */
+    QuantumBlockMetrics& quantumMetrics();
+    /**
+     * @brief The recorded quantum series, or nullptr if there are none
+     */
+    [[nodiscard]] const QuantumBlockMetrics* quantumMetricsIfAny() const noexcept { return quantumMetrics_.get(); }
+
+private:
+    ::std::unique_ptr<QuantumBlockMetrics> quantumMetrics_;
 };
 
 } // namespace quids::blockchain
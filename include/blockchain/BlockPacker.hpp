@@ -0,0 +1,172 @@
+#ifndef QUIDS_BLOCKCHAIN_BLOCK_PACKER_HPP
+#define QUIDS_BLOCKCHAIN_BLOCK_PACKER_HPP
+
+#include "blockchain/Types.hpp"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace quids::blockchain {
+
+struct BlockPackerConfig {
+    GasLimit maxGasPerBlock{15'000'000};
+    std::size_t maxTransactionsPerBlock{1000};
+    // Longest run of conflicting transactions a block may hold, i.e. how
+    // many execution waves it needs at most
+    std::size_t maxConflictDepth{8};
+    // Fee-per-gas range the admission threshold is tuned for
+    GasPrice minFeePerGas{1};
+    GasPrice maxFeePerGas{1000};
+    // Gas reserved on top of a predicted cost, in percent
+    uint64_t predictionMarginPercent{10};
+    // Chain prefix considered when pricing a sender's next transaction
+    std::size_t packageDepth{16};
+};
+
+// Chooses a block's transactions while it is still open.
+//
+// The mempool offers candidates as they arrive. A sender's transactions
+// become eligible strictly in nonce order, and each one is ranked by the
+// best fee per reserved gas of any prefix of its sender's pending chain, so
+// a cheap transaction that unlocks expensive ones is priced as a package.
+//
+// fill() runs between arrivals and only admits candidates that beat an
+// online knapsack threshold rising with the block's fill level: cheap
+// transactions cannot take gas that a later arrival would pay more for.
+// seal() then drops the threshold and tops the block up greedily, so the
+// work left at seal time is the final fill only.
+//
+// Candidates name the state keys they read and write. The packer places
+// every admitted transaction in the first execution wave after everything
+// it conflicts with, and a transaction that would need more than
+// maxConflictDepth waves waits for the next block, so one hot contract
+// cannot serialize the whole block.
+//
+// Predicted execution costs (e.g. from the rollup model) are hints: a
+// candidate is ranked by predictedGas and reserves it plus a margin, capped
+// at its gas limit. reconcile() hands back what execution did not use.
+class BlockPacker {
+public:
+    struct Candidate {
+        uint64_t id{0};  // the caller's handle, returned by seal()
+        Address sender;
+        Nonce nonce{0};
+        GasPrice gasPrice{0};
+        GasLimit gasLimit{0};
+        GasLimit predictedGas{0};  // 0 when there is no hint
+        ::std::vector<uint64_t> reads;
+        ::std::vector<uint64_t> writes;
+    };
+
+    struct PackedBlock {
+        // Execution order: wave by wave, admission order within a wave
+        ::std::vector<uint64_t> ids;
+        // waves[w] lists the ids that run side by side in wave w
+        ::std::vector<::std::vector<uint64_t>> waves;
+        GasLimit gasReserved{0};
+        uint64_t expectedFees{0};
+    };
+
+    explicit BlockPacker(const BlockPackerConfig& config = BlockPackerConfig{});
+
+    BlockPacker(const BlockPacker&) = delete;
+    BlockPacker& operator=(const BlockPacker&) = delete;
+
+    // False for a nonce below the sender's next one, or a resubmission
+    // that does not raise the gas price
+    bool offer(Candidate candidate);
+    // The next nonce sender may use, from committed state. Pending
+    // transactions below it are dropped.
+    void setNextNonce(const Address& sender, Nonce nonce);
+
+    // Admits up to maxSteps candidates that meet the threshold; returns how
+    // many were admitted
+    ::std::size_t fill(::std::size_t maxSteps = SIZE_MAX);
+    // Admits, without the threshold, whatever still fits; what seal() would
+    // add. Returns how many were admitted.
+    ::std::size_t topUp();
+    // Tops the block up, returns it and opens the next one. Candidates that
+    // did not make it stay pending.
+    PackedBlock seal();
+
+    // The open block's transactions in admission order, from index from
+    // on. Conflicting transactions keep this order in every wave layout, so
+    // executing them in it gives the sealed block's state.
+    [[nodiscard]] ::std::vector<Candidate> admittedSince(::std::size_t from) const;
+    [[nodiscard]] ::std::size_t admitted() const;
+    // Takes ids out of the open block, e.g. because a new head included
+    // them or they failed to execute, and lays the rest out again. Senders'
+    // next nonces are left alone; setNextNonce() them from the new state.
+    void drop(const ::std::vector<uint64_t>& ids);
+
+    // Credits reserved gas that id did not use to the open block
+    void reconcile(uint64_t id, GasLimit gasUsed);
+
+    [[nodiscard]] ::std::size_t pending() const;
+    [[nodiscard]] GasLimit gasReserved() const;
+    [[nodiscard]] BlockPackerConfig getConfig() const noexcept { return config_; }
+
+private:
+    struct Sender {
+        Nonce next{0};
+        bool nextKnown{false};
+        ::std::map<Nonce, Candidate> chain;
+        // Bumped whenever the head's rank may have changed
+        uint64_t version{0};
+        // Wave of this sender's last admitted transaction, 1-based
+        ::std::size_t lastWave{0};
+        // Waiting for the next block
+        bool deferred{false};
+    };
+
+    struct Ranked {
+        double density;
+        uint64_t seq;
+        Sender* sender;
+        uint64_t version;
+
+        bool operator<(const Ranked& other) const {
+            if (density != other.density) return density < other.density;
+            return seq > other.seq;
+        }
+    };
+
+    struct KeyWaves {
+        ::std::size_t lastWrite{0};  // 1-based, 0 = untouched this block
+        ::std::size_t lastRead{0};
+    };
+
+    enum class Admit { Admitted, BelowThreshold, Exhausted };
+
+    // All callers hold mutex_
+    GasLimit reservedGas(const Candidate& c) const;
+    static GasLimit expectedGas(const Candidate& c);
+    double packageDensity(const Sender& sender) const;
+    void rank(Sender& sender);
+    ::std::size_t waveOf(const Sender& sender, const Candidate& c) const;
+    void place(Sender& sender, const Candidate& c, ::std::size_t wave, GasLimit reserve);
+    double threshold() const;
+    Admit admitBest(bool useThreshold);
+    void resetBlock();
+
+    const BlockPackerConfig config_;
+
+    mutable ::std::mutex mutex_;
+    ::std::unordered_map<Address, Sender> senders_;
+    ::std::priority_queue<Ranked> heads_;
+    ::std::size_t pending_{0};
+    uint64_t seq_{0};
+
+    // The open block
+    PackedBlock block_;
+    ::std::unordered_map<uint64_t, KeyWaves> keys_;
+    ::std::unordered_map<uint64_t, GasLimit> reserved_;  // by id
+    ::std::vector<Candidate> order_;                     // admission order
+};
+
+} // namespace quids::blockchain
+
+#endif // QUIDS_BLOCKCHAIN_BLOCK_PACKER_HPP
@@ -2,12 +2,15 @@
 #define QUIDS_BLOCKCHAIN_BLOCK_PRODUCER_HPP
 
 #include "AIBlock.hpp"
+#include "blockchain/BlockPacker.hpp"
 #include "blockchain/Transaction.hpp"
 #include "quantum/QuantumState.hpp"
 #include "neural/QuantumPolicyNetwork.hpp"
 #include <memory>
 #include <vector>
 #include <chrono>
+#include <functional>
+#include <optional>
 
 namespace quids::blockchain {
 
@@ -18,6 +21,9 @@ struct BlockProducerConfig {
     std::size_t maxDifficulty;
     double targetBlockTime;
     std::size_t numQubits;
+    GasLimit maxGasPerBlock{15'000'000};
+    // Execution waves a packed block may need
+    std::size_t maxConflictDepth{8};
 };
 
 class BlockProducer {
@@ -35,6 +41,39 @@ public:
 
     // Block production
     [[nodiscard]] AIBlock produceBlock(const std::vector<Transaction>& transactions);
+    // Seals whatever packer() has chosen. resolve maps a candidate id back
+    // to the mempool's handle, which the block shares rather than copies.
+    using TransactionResolver = std::function<TransactionPtr(uint64_t id)>;
+    [[nodiscard]] AIBlock produceBlock(const TransactionResolver& resolve);
+    // Mempool-driven packing: offer candidates as they arrive and call
+    // fill() between arrivals. Keeps the limits it was first given.
+    [[nodiscard]] BlockPacker& packer() noexcept;
+
+    // Speculative building: the next block is executed while it fills, so
+    // sealing it only runs what was admitted since the last buildAhead().
+    // Transactions execute in packer admission order on a speculative
+    // state owned by the caller.
+    struct SpeculativeExecutor {
+        // Runs id after every transaction executed before it and returns
+        // the gas it used; nullopt if it cannot go in the block, in which
+        // case it must leave the state untouched
+        std::function<std::optional<GasLimit>(uint64_t id)> execute;
+        // A new head was imported on the open block's parent: rebuild the
+        // speculative state as that head plus the first keep transactions
+        // executed, discarding the rest
+        std::function<void(std::size_t keep)> rebase;
+        // The executed transactions were sealed; later rebase() counts
+        // start after them
+        std::function<void()> commit;
+    };
+    void setSpeculativeExecutor(SpeculativeExecutor executor);
+    // fill()s the packer and executes what it admitted; call between
+    // mempool arrivals. Returns how many transactions were admitted.
+    std::size_t buildAhead(std::size_t maxSteps = SIZE_MAX);
+    // Keeps the executed prefix that neither touched a key the head wrote
+    // nor was included by it; everything from the first such transaction
+    // on runs again on the next buildAhead() or seal
+    void onNewHead(const std::vector<uint64_t>& writtenKeys, const std::vector<uint64_t>& includedIds);
     [[nodiscard]] bool verifyBlock(const AIBlock& block) const noexcept;
     
     // Quantum-enhanced methods
@@ -52,6 +91,11 @@ public:
         double currentDifficulty{0.0};
         double quantumEntanglement{0.0};
         std::chrono::system_clock::time_point lastBlockTime;
+        // Speculative building
+        std::size_t speculativeExecutions{0};
+        std::size_t discardedExecutions{0};  // undone by a new head
+        std::size_t sealExecutions{0};       // left for seal time
+        std::chrono::microseconds lastSealLatency{0};
     };
     
     [[nodiscard]] const Metrics& getMetrics() const noexcept;
@@ -64,6 +108,7 @@ private:
     void adjustDifficulty();
     [[nodiscard]] bool validateTransactions(const std::vector<Transaction>& transactions) const;
     void updateMetrics(const AIBlock& block);
+    void mine(AIBlock& block, double difficulty) const;
     [[nodiscard]] quantum::QuantumState prepareQuantumState() const;
 };
 
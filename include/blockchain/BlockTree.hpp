@@ -0,0 +1,84 @@
+#ifndef QUIDS_BLOCKCHAIN_BLOCK_TREE_HPP
+#define QUIDS_BLOCKCHAIN_BLOCK_TREE_HPP
+
+#include "blockchain/Types.hpp"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace quids::blockchain {
+
+// Every known block above the last final one, keyed by hash.
+//
+// Each node caches the total weight of its branch, so an insert is O(1):
+// weights are never negative, and only the new leaf can overtake the
+// current head. Ties keep the head that was seen first. Moving between two
+// heads walks back only to their common ancestor.
+//
+// Not synchronized; Chain serializes access.
+class BlockTree {
+public:
+    struct Node {
+        Hash hash{};
+        Hash parent{};
+        BlockNumber height{0};
+        uint64_t weight{0};
+        uint64_t totalWeight{0};  // weight of this block and all its ancestors
+        ::std::vector<Hash> children;
+    };
+
+    // How the canonical chain changes between two heads
+    struct Reorg {
+        Hash ancestor{};
+        ::std::vector<Hash> detached;  // old head first
+        ::std::vector<Hash> attached;  // the ancestor's child first, new head last
+
+        [[nodiscard]] bool empty() const noexcept { return detached.empty() && attached.empty(); }
+    };
+
+    // For maps keyed by block hash
+    struct Hasher {
+        size_t operator()(const Hash& h) const noexcept {
+            size_t v = 0;
+            for (size_t i = 0; i < sizeof(v); ++i) {
+                v = (v << 8) | h[i];  // already uniformly distributed
+            }
+            return v;
+        }
+    };
+
+    enum class Insert {
+        Added,
+        Duplicate,
+        UnknownParent
+    };
+
+    explicit BlockTree(const Hash& root, BlockNumber height = 0, uint64_t totalWeight = 0);
+
+    Insert insert(const Hash& hash, const Hash& parent, uint64_t weight);
+
+    [[nodiscard]] const Node* find(const Hash& hash) const;
+    [[nodiscard]] const Node& head() const noexcept { return *head_; }
+    [[nodiscard]] const Node& root() const noexcept { return *root_; }
+    [[nodiscard]] size_t size() const noexcept { return nodes_.size(); }
+
+    // The ancestor of hash at height, or nullptr when there is none in the tree
+    [[nodiscard]] const Node* ancestorAt(const Hash& hash, BlockNumber height) const;
+    // Both must be in the tree; costs the length of the two branches
+    [[nodiscard]] Reorg path(const Hash& from, const Hash& to) const;
+
+    // Makes newRoot the root and drops everything not descending from it.
+    // The head must descend from newRoot. Returns the hashes dropped.
+    ::std::vector<Hash> prune(const Hash& newRoot);
+
+private:
+    // Node addresses stay valid across rehashing, so head_ and root_ can
+    // point into the map
+    ::std::unordered_map<Hash, Node, Hasher> nodes_;
+    const Node* head_{nullptr};
+    const Node* root_{nullptr};
+};
+
+} // namespace quids::blockchain
+
+#endif // QUIDS_BLOCKCHAIN_BLOCK_TREE_HPP
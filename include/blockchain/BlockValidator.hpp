@@ -0,0 +1,75 @@
+#ifndef QUIDS_BLOCKCHAIN_BLOCK_VALIDATOR_HPP
+#define QUIDS_BLOCKCHAIN_BLOCK_VALIDATOR_HPP
+
+#include "blockchain/Block.hpp"
+#include "blockchain/Transaction.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stop_token>
+
+namespace quids::blockchain {
+
+// Checks a block's transactions against the state before it, in parallel.
+//
+// Three phases run one after another on the shared pool:
+//   1. every signature, through verified(), so gossip-time checks are hits
+//      in the SignatureCache
+//   2. nonces and balances, one task per sender, each walking its own
+//      transactions in block order
+//   3. the Merkle root, rebuilt from the transactions' memoized hashes
+// The first failure stops everything: outstanding tasks see the flag and
+// return without doing their work, and later phases never start. A
+// caller's stop_token cancels the same way.
+//
+// Balances are exact for serial execution. A sender may spend what earlier
+// transactions in the block paid them, because every per-sender walk sees
+// the credits that arrived before each of its transactions.
+class BlockValidator {
+public:
+    // Committed state of an account before the block
+    struct Account {
+        uint64_t balance{0};
+        Nonce nonce{0};  // the next one it may use
+    };
+    // nullopt for an account that does not exist yet. Called concurrently.
+    using AccountLookup = ::std::function<::std::optional<Account>(const Address&)>;
+
+    enum class Status {
+        Valid,
+        BadSignature,
+        BadNonce,
+        InsufficientBalance,
+        BadMerkleRoot,
+        Cancelled
+    };
+
+    struct Result {
+        Status status{Status::Valid};
+        // The offending transaction; npos for the root or a cancellation
+        size_t index{npos};
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+        explicit operator bool() const noexcept { return status == Status::Valid; }
+    };
+
+    explicit BlockValidator(utils::WorkStealingPool& pool = utils::WorkStealingPool::global());
+
+    [[nodiscard]] Result validate(::std::span<const TransactionPtr> transactions,
+                                  const Hash& merkleRoot,
+                                  const AccountLookup& accounts,
+                                  ::std::stop_token stop = {}) const;
+    [[nodiscard]] Result validate(const Block& block, const AccountLookup& accounts,
+                                  ::std::stop_token stop = {}) const;
+
+private:
+    class Run;
+
+    utils::WorkStealingPool& pool_;
+};
+
+} // namespace quids::blockchain
+
+#endif // QUIDS_BLOCKCHAIN_BLOCK_VALIDATOR_HPP
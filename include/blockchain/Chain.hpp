@@ -1,37 +1,82 @@
 #pragma once
 
-#include "blockchain/AIBlock.hpp"
-#include "blockchain/Transaction.hpp"
 #include "blockchain/Account.hpp"
-#include <string>
-#include <vector>
-#include <unordered_map>
+#include "blockchain/Block.hpp"
+#include "blockchain/BlockTree.hpp"
+#include "blockchain/BlockValidator.hpp"
+#include "blockchain/Transaction.hpp"
+#include "utils/PersistentMap.hpp"
 #include <memory>
-
-using std::string;
-using std::unordered_map;
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 namespace quids::blockchain {
 
-
-
+// Fork-aware chain of blocks and the account state after each of them.
+//
+// Every block is validated and executed against its own parent's state
+// when it arrives, on whichever branch. States are copy-on-write maps, so
+// each block's state costs only the accounts it touched, and a reorg just
+// switches to the new head's state: nothing is rolled back or replayed.
+// Blocks finalityDepth below the head are final; their competitors are
+// pruned along with the states nothing can reorg back to.
 class Chain {
 public:
-    Chain() = default;
-    ~Chain() = default;
+    using BlockPtr = ::std::shared_ptr<const Block>;
+    using AccountState = utils::PersistentMap<Address, Account>;
 
-    // Core chain operations
-    bool addBlock(const AIBlock& block);
-    bool addTransaction(const Transaction& transaction);
+    struct Config {
+        BlockNumber finalityDepth{64};
+    };
+
+    enum class Status {
+        Extended,       // the head moved; reorg says how
+        SideBranch,     // valid, but lighter than the head
+        Duplicate,
+        UnknownParent,  // or its parent was pruned
+        Invalid
+    };
+
+    struct Update {
+        Status status{Status::Invalid};
+        BlockTree::Reorg reorg;
+        BlockValidator::Result validation;  // why, when Invalid
+    };
+
+    Chain();
+    explicit Chain(Config config, AccountState genesisState = {}, const Hash& genesis = {});
+
+    // weight is the block's share of fork choice, e.g. its difficulty
+    Update addBlock(BlockPtr block, uint64_t weight = 1);
+    bool addTransaction(TransactionPtr transaction);
+
+    [[nodiscard]] Hash head() const;
+    [[nodiscard]] BlockNumber height() const;
+    [[nodiscard]] BlockPtr getBlock(const Hash& hash) const;
+    [[nodiscard]] BlockPtr getLatestBlock() const;
+    // O(1) copies of the state after a block
+    [[nodiscard]] AccountState state() const;
+    [[nodiscard]] ::std::optional<AccountState> stateAt(const Hash& hash) const;
+    [[nodiscard]] ::std::vector<TransactionPtr> getPendingTransactions() const;
 
 private:
-    // Chain state
-    AIBlock latestBlock;
-    Transaction pendingTransaction;
-    unordered_map<string, Account> accounts;
-
-    // Internal methods
-    bool validateBlock(const AIBlock& block);
-    bool validateTransaction(const Transaction& transaction);
-    bool updateAccountStates(const AIBlock& block);
-}; 
\ No newline at end of file
+    struct Entry {
+        BlockPtr block;  // null for the genesis
+        AccountState state;
+    };
+
+    static void execute(AccountState& state, const Block& block);
+    // Callers must hold mutex_
+    void finalize();
+
+    const Config config_;
+    BlockValidator validator_;
+    mutable ::std::mutex mutex_;
+    BlockTree tree_;
+    ::std::unordered_map<Hash, Entry, BlockTree::Hasher> entries_;
+    ::std::vector<TransactionPtr> pending_;
+};
+
+} // namespace quids::blockchain
@@ -4,6 +4,9 @@
 #include <vector>
 #include <memory>
 #include <array>
+#include <mutex>
+#include <stop_token>
+#include "blockchain/BlockValidator.hpp"
 #include "quantum/QuantumTypes.hpp"
 #include "memory/MemoryPool.hpp"
 #include "consensus/QuantumConsensus.hpp"
@@ -28,7 +31,13 @@ public:
 
     // Main processing functions
     void processBlockParallel();
+    // Signatures, then nonces and balances per sender, then the Merkle
+    // root, each phase in parallel; stops at the first failure
     bool validateBlock(const Block& block) const;
+    // State the block is checked against; called from pool threads
+    void setAccountLookup(blockchain::BlockValidator::AccountLookup accounts);
+    // Abandons validations in flight, e.g. when sync moves to another fork
+    void cancelValidation();
     void finalizeBlockZK();
 
     // Metrics and state
@@ -45,6 +54,10 @@ private:
     state::LockFreeStateManager stateManager_;
     consensus::QuantumConsensusModule consensus_;
     rl::QuantumRLAgent agent_;
+    blockchain::BlockValidator validator_;
+    blockchain::BlockValidator::AccountLookup accounts_;
+    mutable std::mutex validationMutex_;
+    std::stop_source validationStop_;
 
     // Metrics tracking
     struct EnhancedBlockMetrics {
@@ -0,0 +1,61 @@
+#ifndef QUIDS_BLOCKCHAIN_QUANTUM_BLOCK_METRICS_HPP
+#define QUIDS_BLOCKCHAIN_QUANTUM_BLOCK_METRICS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace quids::blockchain {
+
+// Per-block quantum series, stored as one structure-of-arrays blob.
+//
+// Every series is a column of a single buffer, so a block that records a
+// few of them pays one allocation, and one that records none pays for no
+// allocation at all: Block only holds a pointer, allocated on first use.
+class QuantumBlockMetrics {
+public:
+    enum class Series : uint8_t {
+        States, Amplitudes, Phases, Entanglement, Superposition, Decoherence,
+        Interference, Teleportation, ErrorCorrection, Gates, Measurements,
+        Features, Metrics, Parameters, Gradients, Optimization, Learning,
+        Predictions, Probabilities, Statistics, Correlations, Coherence,
+        Entropy, Fidelity, Purity, Concurrence, Discord, Negentropy,
+        Information, Complexity, Capacity, Efficiency, Robustness, Resilience,
+        Security, Privacy, Authenticity, Integrity, Confidentiality,
+        Availability, Reliability, Performance, Scalability, Throughput,
+        Latency, Bandwidth, Utilization, Effectiveness, Quality,
+        Count
+    };
+    static constexpr size_t SERIES_COUNT = static_cast<size_t>(Series::Count);
+
+    [[nodiscard]] std::span<const double> get(Series series) const noexcept {
+        const auto i = static_cast<size_t>(series);
+        return {data_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]};
+    }
+    [[nodiscard]] std::span<double> get(Series series) noexcept {
+        const auto i = static_cast<size_t>(series);
+        return {data_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]};
+    }
+
+    // Resizes the series, keeping its leading values and zero-filling the
+    // rest. Spans from get() are invalidated.
+    std::span<double> resize(Series series, size_t size);
+    void assign(Series series, std::span<const double> values);
+    void clear() noexcept;
+
+    [[nodiscard]] bool empty() const noexcept { return data_.empty(); }
+    [[nodiscard]] size_t memoryUsage() const noexcept {
+        return sizeof(*this) + data_.capacity() * sizeof(double);
+    }
+
+private:
+    // Series i occupies data_[offsets_[i], offsets_[i + 1])
+    std::array<uint32_t, SERIES_COUNT + 1> offsets_{};
+    std::vector<double> data_;
+};
+
+} // namespace quids::blockchain
+
+#endif // QUIDS_BLOCKCHAIN_QUANTUM_BLOCK_METRICS_HPP
@@ -0,0 +1,62 @@
+#ifndef QUIDS_BLOCKCHAIN_SIGNATURE_CACHE_HPP
+#define QUIDS_BLOCKCHAIN_SIGNATURE_CACHE_HPP
+
+#include "blockchain/Types.hpp"
+#include "utils/FlatHashMap.hpp"
+#include <array>
+#include <cstring>
+#include <mutex>
+
+namespace quids::blockchain {
+
+// Node-wide record of transactions whose signature has already checked
+// out, keyed by transaction hash. The hash covers the signature, so a hit
+// means this exact (message, signature) pair was verified before; a
+// transaction that is gossiped, batched and applied is verified once.
+//
+// Only successes are stored. Each shard keeps two generations: when the
+// current one fills up it becomes the previous one and the old previous
+// one is dropped, which approximates LRU without per-hit bookkeeping.
+class SignatureCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 18;
+
+    explicit SignatureCache(size_t capacity = DEFAULT_CAPACITY);
+
+    [[nodiscard]] static SignatureCache& global();
+
+    [[nodiscard]] bool contains(const Hash& tx_hash);
+    void insert(const Hash& tx_hash);
+    void clear();
+
+    [[nodiscard]] size_t size() const;
+
+private:
+    static constexpr size_t NUM_SHARDS = 16;
+
+    struct HashKeyHash {
+        size_t operator()(const Hash& h) const noexcept {
+            size_t v;
+            std::memcpy(&v, h.data(), sizeof(v));  // already uniformly distributed
+            return v;
+        }
+    };
+    using Set = utils::FlatHashMap<Hash, bool, HashKeyHash>;
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        Set current;
+        Set previous;
+    };
+
+    Shard& shard(const Hash& tx_hash) { return shards_[tx_hash[31] % NUM_SHARDS]; }
+    // Caller holds the shard lock
+    void admit(Shard& s, const Hash& tx_hash);
+
+    size_t shard_capacity_;
+    std::array<Shard, NUM_SHARDS> shards_;
+};
+
+} // namespace quids::blockchain
+
+#endif // QUIDS_BLOCKCHAIN_SIGNATURE_CACHE_HPP
@@ -12,6 +12,7 @@ namespace quids::blockchain {
 
 // Forward declaration only
 class StandardTransaction;
+class TransactionView;
 
 class Transaction {
 public:
@@ -35,6 +36,14 @@ public:
     [[nodiscard]] uint64_t getAmount() const noexcept { return value; }
     [[nodiscard]] uint64_t calculate_gas_cost() const noexcept { return gas_cost; }
 
+    // computeHash(), memoized on first use and carried along by copies.
+    // Fields only change through deserialize(), which starts from a fresh
+    // object, so the memo never goes stale.
+    [[nodiscard]] Hash hash() const;
+    // verify(), memoized the same way and shared node-wide through
+    // SignatureCache so each transaction is checked once
+    [[nodiscard]] bool verified() const;
+
     // Virtual interface methods
     virtual Address getFrom() const = 0;
     virtual Address getTo() const = 0;
@@ -43,6 +52,8 @@ public:
     [[nodiscard]] virtual uint64_t getNonce() const noexcept = 0;
 
 protected:
+    friend class TransactionView;  // materialize() fills the fields directly
+
     Timestamp timestamp{::std::chrono::system_clock::now()};
     Address sender;
     Address receiver;
@@ -51,6 +62,31 @@ protected:
     Signature signature;
     uint64_t nonce{0};
     uint64_t gas_cost{0};
+
+private:
+    // Concurrent first calls may both compute; one of them publishes
+    struct Memo {
+        static constexpr uint8_t HASH_READY = 1;
+        static constexpr uint8_t HASH_CLAIMED = 2;
+        static constexpr uint8_t VERIFY_DONE = 4;
+        static constexpr uint8_t VERIFIED = 8;
+
+        Memo() = default;
+        Memo(const Memo& other) noexcept { *this = other; }
+        Memo& operator=(const Memo& other) noexcept {
+            uint8_t st = other.state.load(std::memory_order_acquire) & (HASH_READY | VERIFY_DONE | VERIFIED);
+            if (st & HASH_READY) {
+                hash = other.hash;
+                st |= HASH_CLAIMED;
+            }
+            state.store(st, std::memory_order_release);
+            return *this;
+        }
+
+        std::atomic<uint8_t> state{0};
+        Hash hash{};
+    };
+    mutable Memo memo_;
 };
 
 // Concrete implementation
@@ -64,8 +100,18 @@ public:
     [[nodiscard]] std::vector<uint8_t> computeHash() const override;
     [[nodiscard]] bool verify() const override;
     [[nodiscard]] ::std::string toString() const override;
+
+    [[nodiscard]] Address getFrom() const override { return sender; }
+    [[nodiscard]] Address getTo() const override { return receiver; }
+    [[nodiscard]] GasPrice getGasPrice() const override { return gas_cost; }
+    [[nodiscard]] GasLimit getGasLimit() const override { return 21000; }
+    [[nodiscard]] uint64_t getNonce() const noexcept override { return nonce; }
 };
 
+// Shared handle to an immutable transaction. Blocks hold these, so a
+// transaction taken from the mempool is never copied on its way in.
+using TransactionPtr = ::std::shared_ptr<const Transaction>;
+
 } // namespace quids::blockchain
 
 #endif // QUIDS_BLOCKCHAIN_TRANSACTION_HPP 
\ No newline at end of file
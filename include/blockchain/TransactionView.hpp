@@ -0,0 +1,82 @@
+#ifndef QUIDS_BLOCKCHAIN_TRANSACTION_VIEW_HPP
+#define QUIDS_BLOCKCHAIN_TRANSACTION_VIEW_HPP
+
+#include "blockchain/Transaction.hpp"
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace quids::blockchain {
+
+// Canonical transaction wire format. All integers are little-endian:
+//
+//   u8   version
+//   i64  timestamp, microseconds since the epoch
+//   u64  value
+//   u64  nonce
+//   u64  gas cost
+//   u16  sender length
+//   u16  recipient length
+//   u32  data length
+//   ...  sender, recipient and data bytes
+//   32   signature
+//
+// The signature comes last, so the signed message is a prefix of the
+// encoding and can be hashed in place.
+namespace wire {
+constexpr uint8_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 1 + 4 * sizeof(uint64_t) + 2 * sizeof(uint16_t) + sizeof(uint32_t);
+constexpr size_t SIGNATURE_SIZE = sizeof(Signature);
+constexpr size_t MIN_SIZE = HEADER_SIZE + SIGNATURE_SIZE;
+} // namespace wire
+
+// Appends the canonical encoding of tx. Throws std::length_error when an
+// address or the payload does not fit its length field.
+void encodeTransaction(const Transaction& tx, ByteVector& out);
+
+// Non-owning view over one encoded transaction. Accessors decode straight
+// from the bytes, so the buffer must outlive the view. Getter names match
+// Transaction so code can be written against either.
+class TransactionView {
+public:
+    // nullopt unless bytes hold exactly one well-formed transaction
+    [[nodiscard]] static std::optional<TransactionView> parse(std::span<const uint8_t> bytes) noexcept;
+    // Parses the transaction at the front of bytes, for packed sequences
+    [[nodiscard]] static std::optional<TransactionView> parsePrefix(std::span<const uint8_t> bytes) noexcept;
+
+    [[nodiscard]] std::string_view getSender() const noexcept;
+    [[nodiscard]] std::string_view getRecipient() const noexcept;
+    [[nodiscard]] Value getValue() const noexcept { return load64(1 + 8); }
+    [[nodiscard]] uint64_t getNonce() const noexcept { return load64(1 + 16); }
+    [[nodiscard]] uint64_t calculate_gas_cost() const noexcept { return load64(1 + 24); }
+    [[nodiscard]] Timestamp getTimestamp() const noexcept;
+    [[nodiscard]] std::span<const uint8_t> getData() const noexcept;
+    [[nodiscard]] std::span<const uint8_t, wire::SIGNATURE_SIZE> getSignature() const noexcept;
+
+    [[nodiscard]] std::span<const uint8_t> bytes() const noexcept { return bytes_; }
+    [[nodiscard]] std::span<const uint8_t> signedBytes() const noexcept {
+        return bytes_.first(bytes_.size() - wire::SIGNATURE_SIZE);
+    }
+
+    // BLAKE3 of the full encoding; the same as StandardTransaction::computeHash
+    [[nodiscard]] Hash computeHash() const noexcept;
+    // BLAKE3 of signedBytes() matches the signature
+    [[nodiscard]] bool verify() const noexcept;
+
+    // Owned copy, for code that needs the Transaction interface
+    [[nodiscard]] StandardTransaction materialize() const;
+
+private:
+    explicit TransactionView(std::span<const uint8_t> bytes) noexcept : bytes_(bytes) {}
+
+    [[nodiscard]] uint64_t load64(size_t offset) const noexcept;
+    [[nodiscard]] size_t senderLength() const noexcept;
+    [[nodiscard]] size_t recipientLength() const noexcept;
+    [[nodiscard]] size_t dataLength() const noexcept;
+
+    std::span<const uint8_t> bytes_;
+};
+
+} // namespace quids::blockchain
+
+#endif // QUIDS_BLOCKCHAIN_TRANSACTION_VIEW_HPP
@@ -2,6 +2,7 @@
 #define QUIDS_BLOCKCHAIN_TYPES_HPP
 
 #include <array>
+#include <algorithm>
 #include <vector>
 #include <memory>
 #include <optional>
@@ -0,0 +1,27 @@
+#pragma once
+#include "cli/QuidsCommand.hpp"
+#include "rollup/BlockReplay.hpp"
+
+namespace quids {
+namespace cli {
+
+// Re-executes stored blocks offline against a checkpointed state, to
+// reproduce a slow block and measure changes against real traffic
+class ReplayCommand : public QuidsCommand {
+public:
+    std::string getName() const override { return "replay"; }
+    std::string getDescription() const override {
+        return "Re-execute stored blocks against a checkpointed state";
+    }
+    std::string getUsage() const override {
+        return "quids replay --data-dir=<path> [--state-dir=<path>] [--from=<block>] [--to=<block>] "
+               "[--threads=<n>] [--repeat=<n>] [--trace=<file.json>] [--slowest=<n>] [--keep-going]";
+    }
+    int execute(const std::vector<std::string>& args) override;
+
+private:
+    void printReport(const rollup::BlockReplayer::Report& report, size_t slowest) const;
+};
+
+} // namespace cli
+} // namespace quids
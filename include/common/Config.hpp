@@ -1,29 +1,124 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 namespace quids::common {
+    // Typed view of config.json, one struct per top-level section. Fields
+    // with an initializer are optional in the file; the rest are required.
+    struct NetworkSettings {
+        uint16_t port{0};
+        std::string stun_server;
+        bool enable_upnp{true};
+        bool enable_nat_pmp{false};
+    };
+
+    struct StorageSettings {
+        std::string path;
+        size_t cache_size_mb{1024};
+    };
+
+    struct LogSettings {
+        std::string level{"info"};
+        std::string file{"quids.log"};
+        bool console{true};
+        bool async{true};
+    };
+
+    // Tunable at runtime: components read these per batch, not at startup
+    struct RollupSettings {
+        size_t batch_size{1000};
+        uint64_t batch_timeout_ms{100};
+        size_t max_pending_txs{100000};
+        size_t num_worker_threads{4};
+    };
+
+    struct Settings {
+        NetworkSettings network;
+        StorageSettings storage;
+        LogSettings log;
+        RollupSettings rollup;
+
+        // The parsed file, for keys without a typed field
+        nlohmann::json raw;
+        // Counts published snapshots, starting at 1
+        uint64_t generation{0};
+    };
+
+    // Parses the file once into an immutable Settings snapshot. Readers
+    // get the current one with a single acquire load; reload() builds and
+    // validates a new snapshot off to the side and only then publishes it,
+    // so a reader never sees a half-applied or invalid file.
     class Config {
     public:
         explicit Config(const std::string& path = "config.json");
-        
+        ~Config();
+
+        Config(const Config&) = delete;
+        Config& operator=(const Config&) = delete;
+
+        // Valid for the lifetime of the Config: replaced snapshots are
+        // retired, not freed, because readers hold no reference count
+        const Settings& settings() const {
+            return *current_.load(std::memory_order_acquire);
+        }
+
+        // Dotted keys, e.g. "network.port"; T{} when missing or mistyped
         template<typename T>
         T get(const std::string& key) const {
-            return data_.value<T>(key, T{});
+            return get_or_default<T>(key, T{});
         }
-        
+
         template<typename T>
         T get_or_default(const std::string& key, T default_val) const {
-            return data_.value(key, default_val);
+            const auto& raw = settings().raw;
+            const auto pointer = to_pointer(key);
+            if (!raw.contains(pointer)) {
+                return default_val;
+            }
+            try {
+                return raw.at(pointer).template get<T>();
+            } catch (const nlohmann::json::exception&) {
+                return default_val;
+            }
         }
-        
+
+        // Re-reads the file and publishes it if it parses and validates;
+        // throws and keeps the current snapshot otherwise
         void reload();
         void validate() const;
 
+        // Polls the file's modification time and reloads on change. A file
+        // that fails to load is logged and skipped until it changes again.
+        void watch(std::chrono::milliseconds interval = std::chrono::seconds(1));
+        void stop_watching();
+
     private:
-        void load();
-        
+        static nlohmann::json::json_pointer to_pointer(const std::string& key);
+        static void validate(const nlohmann::json& data);
+
+        std::shared_ptr<Settings> load(std::filesystem::file_time_type& mtime) const;
+        void publish(std::shared_ptr<Settings> settings, std::filesystem::file_time_type mtime);
+        void watch_loop(std::chrono::milliseconds interval);
+
         std::string config_path_;
-        nlohmann::json data_;
+        std::atomic<const Settings*> current_{nullptr};
+
+        std::mutex publish_mutex_;
+        std::vector<std::shared_ptr<const Settings>> snapshots_;  // current one last
+        std::filesystem::file_time_type loaded_mtime_{};
+
+        std::mutex watch_mutex_;
+        std::condition_variable watch_cv_;
+        bool watch_stop_{false};
+        std::thread watcher_;
     };
-} 
\ No newline at end of file
+}
@@ -1,30 +1,206 @@
 #pragma once
 #include <spdlog/spdlog.h>
 #include <spdlog/async.h>
+#include <spdlog/fmt/fmt.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
+#include "utils/BoundedQueue.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iterator>
 #include <memory>
+#include <tuple>
+#include <type_traits>
+
+// Levels below this are compiled out: the QUIDS_LOG_* macros expand to
+// nothing and their arguments are never evaluated. Uses spdlog's numbering.
+#ifndef QUIDS_LOG_ACTIVE_LEVEL
+#define QUIDS_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#endif
+
+// Formats on the calling thread, after a runtime level check
+#define QUIDS_LOG(LEVEL, ...)                                                                   \
+    do {                                                                                        \
+        if constexpr (SPDLOG_LEVEL_##LEVEL >= QUIDS_LOG_ACTIVE_LEVEL) {                         \
+            constexpr auto quids_log_level_ = static_cast<::spdlog::level::level_enum>(SPDLOG_LEVEL_##LEVEL); \
+            if (::quids::common::Logger::should_log(quids_log_level_)) {                        \
+                ::quids::common::Logger::log(quids_log_level_, __VA_ARGS__);                    \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+// Hot paths: copies numeric arguments into a queue and returns; the
+// logger's drain thread formats them later
+#define QUIDS_LOG_DEFERRED(LEVEL, ...)                                                          \
+    do {                                                                                        \
+        if constexpr (SPDLOG_LEVEL_##LEVEL >= QUIDS_LOG_ACTIVE_LEVEL) {                         \
+            constexpr auto quids_log_level_ = static_cast<::spdlog::level::level_enum>(SPDLOG_LEVEL_##LEVEL); \
+            if (::quids::common::Logger::should_log(quids_log_level_)) {                        \
+                ::quids::common::Logger::log_deferred(quids_log_level_, __VA_ARGS__);           \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+#define QUIDS_LOG_TRACE(...) QUIDS_LOG(TRACE, __VA_ARGS__)
+#define QUIDS_LOG_DEBUG(...) QUIDS_LOG(DEBUG, __VA_ARGS__)
+#define QUIDS_LOG_INFO(...) QUIDS_LOG(INFO, __VA_ARGS__)
+#define QUIDS_LOG_WARN(...) QUIDS_LOG(WARN, __VA_ARGS__)
+#define QUIDS_LOG_ERROR(...) QUIDS_LOG(ERROR, __VA_ARGS__)
+#define QUIDS_LOG_CRITICAL(...) QUIDS_LOG(CRITICAL, __VA_ARGS__)
 
 namespace quids::common {
+    // Process-wide logger. Until init() runs, messages go to spdlog's
+    // default logger and deferred ones are formatted in place, so library
+    // code can log before (or without) the node setting things up.
     class Logger {
     public:
-        static void init(const std::string& name = "quids", 
+        // Bytes of arguments one deferred message can carry
+        static constexpr size_t DEFERRED_ARGS_BYTES = 48;
+
+        // With async set, sinks are written by a background thread behind
+        // a queue of queue_size messages; when it is full the oldest are
+        // dropped rather than the caller blocked
+        static void init(const std::string& name = "quids",
                         const std::string& logfile = "quids.log",
                         bool console = true,
-                        bool async = true);
-        
+                        bool async = true,
+                        size_t queue_size = 8192);
+        // Writes out everything queued and stops the background threads
+        static void shutdown();
+
+        template<typename... Args>
+        static void trace(fmt::format_string<Args...> fmt, Args&&... args) {
+            log(spdlog::level::trace, fmt, std::forward<Args>(args)...);
+        }
+        template<typename... Args>
+        static void debug(fmt::format_string<Args...> fmt, Args&&... args) {
+            log(spdlog::level::debug, fmt, std::forward<Args>(args)...);
+        }
         template<typename... Args>
-        static void info(const char* fmt, const Args&... args) {
-            instance()->log(spdlog::level::info, fmt, args...);
+        static void info(fmt::format_string<Args...> fmt, Args&&... args) {
+            log(spdlog::level::info, fmt, std::forward<Args>(args)...);
+        }
+        template<typename... Args>
+        static void warn(fmt::format_string<Args...> fmt, Args&&... args) {
+            log(spdlog::level::warn, fmt, std::forward<Args>(args)...);
+        }
+        template<typename... Args>
+        static void error(fmt::format_string<Args...> fmt, Args&&... args) {
+            log(spdlog::level::err, fmt, std::forward<Args>(args)...);
+        }
+        template<typename... Args>
+        static void critical(fmt::format_string<Args...> fmt, Args&&... args) {
+            log(spdlog::level::critical, fmt, std::forward<Args>(args)...);
+        }
+
+        [[nodiscard]] static bool should_log(spdlog::level::level_enum level) noexcept {
+            return level >= level_.load(std::memory_order_relaxed);
+        }
+
+        template<typename... Args>
+        static void log(spdlog::level::level_enum level, fmt::format_string<Args...> fmt, Args&&... args) {
+            target()->log(level, fmt, std::forward<Args>(args)...);
+        }
+
+        // fmt must be a string literal and the arguments numbers: both are
+        // used after the call returns. A message that finds the queue full
+        // is dropped and counted.
+        template<typename... Args>
+        static void log_deferred(spdlog::level::level_enum level, fmt::format_string<Args...> fmt,
+                                 Args... args) noexcept {
+            static_assert((std::is_arithmetic_v<Args> && ...), "deferred arguments must be numbers");
+            static_assert((sizeof(Args) + ... + 0) <= DEFERRED_ARGS_BYTES, "too many deferred arguments");
+
+            DeferredRecord record;
+            record.time = coarse_now();
+            record.level = level;
+            const fmt::string_view format = fmt;
+            record.format = format.data();
+            record.format_size = format.size();
+            record.render = &render<Args...>;
+            size_t offset = 0;
+            ((std::memcpy(record.args + offset, &args, sizeof(Args)), offset += sizeof(Args)), ...);
+
+            if (auto* queue = deferred_.load(std::memory_order_acquire)) {
+                if (!queue->try_push(std::move(record))) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                }
+                return;
+            }
+            write(record);
         }
-        
-        // Similar methods for other levels
-        // ... (warn, error, critical, debug, trace)
 
         static void set_level(spdlog::level::level_enum level);
-        
+        // Flushes the sinks after the deferred messages queued so far
+        static void flush();
+        // Deferred messages dropped on a full queue plus async sink overruns
+        [[nodiscard]] static uint64_t dropped();
+
     private:
+        struct DeferredRecord {
+            spdlog::log_clock::time_point time;
+            spdlog::level::level_enum level{spdlog::level::info};
+            const char* format{""};
+            size_t format_size{0};
+            void (*render)(const DeferredRecord&, fmt::memory_buffer&){nullptr};
+            alignas(8) unsigned char args[DEFERRED_ARGS_BYTES];
+        };
+        using DeferredQueue = utils::BoundedQueue<DeferredRecord>;
+
+        template<typename... Args>
+        static void render(const DeferredRecord& record, fmt::memory_buffer& out) {
+            std::tuple<Args...> values;
+            size_t offset = 0;
+            std::apply([&](auto&... value) {
+                ((std::memcpy(&value, record.args + offset, sizeof(value)), offset += sizeof(value)), ...);
+            }, values);
+            std::apply([&](const auto&... value) {
+                fmt::vformat_to(std::back_inserter(out), fmt::string_view(record.format, record.format_size),
+                                fmt::make_format_args(value...));
+            }, values);
+        }
+
+        static void write(const DeferredRecord& record) noexcept {
+            try {
+                fmt::memory_buffer buffer;
+                record.render(record, buffer);
+                target()->log(record.time, spdlog::source_loc{}, record.level,
+                              spdlog::string_view_t(buffer.data(), buffer.size()));
+            } catch (...) {
+                // A message that cannot be formatted is not worth the caller
+            }
+        }
+
+        // Tick-resolution wall clock, a fraction of the cost of a precise read;
+        // the default pattern only prints milliseconds anyway
+        static spdlog::log_clock::time_point coarse_now() noexcept {
+#if defined(__linux__)
+            timespec ts;
+            if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0) {
+                return spdlog::log_clock::time_point(std::chrono::duration_cast<spdlog::log_clock::duration>(
+                    std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+            }
+#endif
+            return spdlog::log_clock::now();
+        }
+
+        static spdlog::logger* target() noexcept {
+            auto* logger = raw_.load(std::memory_order_acquire);
+            return logger ? logger : spdlog::default_logger_raw();
+        }
+
+        static void drain_deferred();
+
         static std::shared_ptr<spdlog::logger> instance();
         static std::shared_ptr<spdlog::logger> logger_;
+
+        // Read on every call, so kept apart from the shared_ptr
+        inline static std::atomic<spdlog::level::level_enum> level_{spdlog::level::info};
+        inline static std::atomic<spdlog::logger*> raw_{nullptr};
+        inline static std::atomic<DeferredQueue*> deferred_{nullptr};
+        inline static std::atomic<uint64_t> dropped_{0};
     };
-} 
\ No newline at end of file
+}
@@ -0,0 +1,157 @@
+#ifndef QUIDS_CONSENSUS_BATCH_PROOF_VIEW_HPP
+#define QUIDS_CONSENSUS_BATCH_PROOF_VIEW_HPP
+
+#include "consensus/OptimizedPOBPC.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <array>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace quids::consensus {
+
+/**
+ * @file BatchProofView.hpp
+ * @brief Compact wire format for OptimizedPOBPC batch proofs
+ *
+ * All integers are little-endian and doubles are IEEE-754 bit patterns.
+ * The header has fixed offsets:
+ *
+ *   0    u8   version
+ *   1    u8   flags, bit 0 = witness consensus reached
+ *   2    u16  witness count W
+ *   4    u32  measurement count M
+ *   8    u64  timestamp
+ *   16   u64  transaction count
+ *   24   32   batch hash (Merkle root of the transactions)
+ *   56   32   quantum state commitment
+ *   88   u32  quantum state qubits
+ *   92   u32  proof data length
+ *   96   u32  ZKP commitment, challenge, response and recursive proof lengths
+ *   112  f64  quorum threshold
+ *   120  f64  ZKP verification confidence
+ *
+ * followed by fixed-stride tables, so entry i of each sits at a computed
+ * offset:
+ *
+ *   M x { u64 outcome, f64 fidelity }
+ *   W x { 32 witness id digest, f64 reliability, u64 verification time }
+ *   W x u32 end offset of the witness signature in the signature area
+ *
+ * and then the variable areas: proof data, the four ZKP fields and the
+ * concatenated witness signatures.
+ *
+ * The quantum state travels as a BLAKE3 commitment to its amplitudes, not
+ * the amplitudes themselves; a verifier rebuilds the state it expects from
+ * the batch hash and compares the commitments. Measurements keep only
+ * their outcome and fidelity. Batch metrics are local and not encoded.
+ */
+namespace proof_wire {
+constexpr uint8_t VERSION = 1;
+constexpr size_t HASH_SIZE = 32;
+constexpr size_t HEADER_SIZE = 128;
+constexpr size_t MEASUREMENT_SIZE = 2 * sizeof(uint64_t);
+constexpr size_t WITNESS_SIZE = HASH_SIZE + 2 * sizeof(uint64_t);
+constexpr size_t SIGNATURE_END_SIZE = sizeof(uint32_t);
+} // namespace proof_wire
+
+/**
+ * @brief BLAKE3 commitment to a quantum state
+ *
+ * Covers the qubit count and every amplitude's real and imaginary bit
+ * patterns, so two states commit equally only if they are bit-identical.
+ */
+[[nodiscard]] crypto::MerkleHash stateCommitment(const quantum::QuantumState& state);
+
+/**
+ * @brief Digest a witness is identified by on the wire
+ */
+[[nodiscard]] crypto::MerkleHash witnessIdDigest(std::string_view node_id);
+
+/**
+ * @brief Appends the compact encoding of a proof
+ * @throws std::length_error if the batch hash is not 32 bytes or a count or
+ *         length does not fit its field
+ * @throws std::invalid_argument if the witness vectors do not line up
+ */
+void encodeBatchProof(const OptimizedPOBPC::BatchProof& proof, std::vector<uint8_t>& out);
+
+/**
+ * @brief Non-owning view over one encoded batch proof
+ *
+ * Accessors read straight from the bytes, so the buffer must outlive the
+ * view. parse() checks every length against the buffer once; after that
+ * no accessor can read out of bounds.
+ */
+class BatchProofView {
+public:
+    struct Measurement {
+        uint64_t outcome;
+        double fidelity;
+    };
+
+    /**
+     * @brief Parses exactly one well-formed proof
+     * @return nullopt on a wrong version, truncation or trailing bytes
+     */
+    [[nodiscard]] static std::optional<BatchProofView> parse(std::span<const uint8_t> bytes) noexcept;
+
+    [[nodiscard]] uint64_t timestamp() const noexcept;
+    [[nodiscard]] uint64_t transactionCount() const noexcept;
+    [[nodiscard]] std::span<const uint8_t, proof_wire::HASH_SIZE> batchHash() const noexcept;
+    [[nodiscard]] std::span<const uint8_t, proof_wire::HASH_SIZE> stateCommitment() const noexcept;
+    [[nodiscard]] size_t stateQubits() const noexcept;
+    [[nodiscard]] bool hasConsensus() const noexcept { return (bytes_[1] & 1) != 0; }
+    [[nodiscard]] double quorumThreshold() const noexcept;
+    [[nodiscard]] double zkpConfidence() const noexcept;
+
+    [[nodiscard]] size_t measurementCount() const noexcept { return measurements_; }
+    [[nodiscard]] Measurement measurement(size_t i) const noexcept;
+
+    [[nodiscard]] size_t witnessCount() const noexcept { return witnesses_; }
+    [[nodiscard]] std::span<const uint8_t, proof_wire::HASH_SIZE> witnessId(size_t i) const noexcept;
+    [[nodiscard]] double witnessReliability(size_t i) const noexcept;
+    [[nodiscard]] uint64_t witnessVerificationTime(size_t i) const noexcept;
+    [[nodiscard]] std::span<const uint8_t> witnessSignature(size_t i) const noexcept;
+
+    [[nodiscard]] std::span<const uint8_t> proofData() const noexcept { return field(0); }
+    [[nodiscard]] std::span<const uint8_t> zkpCommitment() const noexcept { return field(1); }
+    [[nodiscard]] std::span<const uint8_t> zkpChallenge() const noexcept { return field(2); }
+    [[nodiscard]] std::span<const uint8_t> zkpResponse() const noexcept { return field(3); }
+    [[nodiscard]] std::span<const uint8_t> zkpRecursiveProof() const noexcept { return field(4); }
+
+    [[nodiscard]] std::span<const uint8_t> bytes() const noexcept { return bytes_; }
+
+    /// @brief Same rules as BatchProof::WitnessData::hasQuorum
+    [[nodiscard]] bool hasQuorum() const noexcept;
+    /// @brief Same rules as BatchProof::calculateConfidence
+    [[nodiscard]] double calculateConfidence() const noexcept;
+    /// @brief BatchProof::isValid without the batch metrics, which are not encoded
+    [[nodiscard]] bool isValid() const noexcept;
+    /// @brief Same rules as BatchProof::isReadyForConsensus, minus metrics
+    [[nodiscard]] bool isReadyForConsensus() const noexcept;
+
+    /// @brief Whether state commits to the encoded commitment
+    [[nodiscard]] bool commitsTo(const quantum::QuantumState& state) const;
+
+private:
+    static constexpr size_t FIELDS = 5;
+
+    explicit BatchProofView(std::span<const uint8_t> bytes) noexcept;
+
+    [[nodiscard]] std::span<const uint8_t> field(size_t f) const noexcept {
+        return bytes_.subspan(field_offsets_[f], field_offsets_[f + 1] - field_offsets_[f]);
+    }
+
+    std::span<const uint8_t> bytes_;
+    size_t measurements_{0};
+    size_t witnesses_{0};
+    size_t witness_table_{0};
+    size_t signature_ends_{0};
+    // Start of each variable field; the last entry starts the signatures
+    std::array<size_t, FIELDS + 1> field_offsets_{};
+};
+
+} // namespace quids::consensus
+
+#endif // QUIDS_CONSENSUS_BATCH_PROOF_VIEW_HPP
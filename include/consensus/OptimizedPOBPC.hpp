@@ -5,8 +5,11 @@
 #include "quantum/QuantumTypes.hpp"
 #include "quantum/QuantumState.hpp"
 #include "quantum/QuantumCircuit.hpp"
-#include "quantum/QuantumCrypto.hpp"
+#include "utils/AdaptiveBatchController.hpp"
 #include "utils/LockFreeQueue.hpp"
+#include <cmath>
+#include <functional>
+#include <span>
 
 namespace utils {
     template<typename T>
@@ -69,6 +72,11 @@ struct BatchConfig {
     size_t max_batch_verification_time{500}; ///< Maximum time for batch verification (ms)
     bool adaptive_witness_selection{true};   ///< Enable adaptive witness count based on load
     size_t recursive_zkp_layers{2};         ///< Number of recursive ZKP layers for critical txs
+    double proof_confidence{0.99};           ///< Confidence at which proof checks may stop early
+    double proof_mismatch_tolerance{0.05};   ///< Fraction of proof measurements allowed to disagree
+    size_t pipeline_depth{2};                ///< Batches queued between pipeline stages
+    size_t key_rotation_batches{1024};       ///< Batches per witness key epoch
+    bool adaptive_batching{false};           ///< Tune batch size and timeout live against max_batch_verification_time
     
     /**
      * @brief Validates the configuration
@@ -92,7 +100,14 @@ struct BatchConfig {
                min_witness_reliability > 50 && // Majority reliability required
                min_witness_reliability <= 100 &&
                recursive_zkp_layers > 0 &&
-               recursive_zkp_layers <= 5; // Practical limit for recursive ZKP
+               recursive_zkp_layers <= 5 && // Practical limit for recursive ZKP
+               proof_confidence > 0.0 &&
+               proof_confidence < 1.0 &&
+               proof_mismatch_tolerance >= 0.0 &&
+               proof_mismatch_tolerance < 0.5 &&
+               pipeline_depth > 0 &&
+               pipeline_depth <= 64 &&
+               key_rotation_batches > 0;
     }
 };
 
@@ -116,20 +131,19 @@ public:
     struct WitnessInfo {
         string node_id;                                ///< Unique node identifier
         vector<uint8_t> public_key;                   ///< Witness public key
-        atomic<double> reliability_score{1.0};        ///< Reliability metric (0-1)
-        atomic<uint64_t> last_active{0};             ///< Last active timestamp
+        double reliability_score{1.0};                ///< Reliability metric (0-1)
+        uint64_t last_active{0};                      ///< Last active timestamp
         quantum::QuantumState quantum_state;          ///< Quantum state for verification
-        atomic<size_t> successful_validations{0};     ///< Successful validations count
-        atomic<size_t> total_validations{0};         ///< Total validations attempted
+        size_t successful_validations{0};             ///< Successful validations count
+        size_t total_validations{0};                  ///< Total validations attempted
 
         /**
          * @brief Calculates the current reliability ratio
          * @return Reliability score between 0 and 1
          */
         [[nodiscard]] double calculateReliability() const noexcept {
-            const size_t total = total_validations.load();
-            return total > 0 ? 
-                static_cast<double>(successful_validations.load()) / total : 0.0;
+            return total_validations > 0 ?
+                static_cast<double>(successful_validations) / total_validations : 0.0;
         }
 
         /**
@@ -141,7 +155,7 @@ public:
                 successful_validations++;
             }
             total_validations++;
-            reliability_score.store(calculateReliability());
+            reliability_score = calculateReliability();
         }
 
         /**
@@ -151,7 +165,7 @@ public:
          */
         [[nodiscard]] bool isActive(uint64_t timeout_ms) const noexcept {
             const auto now = std::chrono::system_clock::now().time_since_epoch().count();
-            return (now - last_active.load()) < timeout_ms;
+            return (now - last_active) < timeout_ms;
         }
     };
 
@@ -308,46 +322,46 @@ public:
      * @brief Consensus performance metrics
      */
     struct ConsensusMetrics {
-        std::atomic<double> avg_batch_time{0.0};          ///< Average batch processing time (ms)
-        std::atomic<double> avg_verification_time{0.0};   ///< Average verification time (ms)
-        std::atomic<uint64_t> total_batches{0};          ///< Total batches processed
-        std::atomic<uint64_t> total_transactions{0};      ///< Total transactions processed
-        std::atomic<double> witness_participation{0.0};   ///< Witness participation rate
-        std::atomic<double> quantum_security{0.0};        ///< Quantum security score
-        std::atomic<double> quantum_fidelity{1.0};        ///< Quantum state fidelity
-        std::atomic<uint64_t> error_corrections{0};       ///< Number of error corrections
+        double avg_batch_time{0.0};          ///< Average batch processing time (ms)
+        double avg_verification_time{0.0};   ///< Average verification time (ms)
+        uint64_t total_batches{0};           ///< Total batches processed
+        uint64_t total_transactions{0};      ///< Total transactions processed
+        double witness_participation{0.0};   ///< Witness participation rate
+        double quantum_security{0.0};        ///< Quantum security score
+        double quantum_fidelity{1.0};        ///< Quantum state fidelity
+        uint64_t error_corrections{0};       ///< Number of error corrections
         
         // Additional POBPC-specific metrics
         struct BatchMetrics {
-            std::atomic<double> avg_batch_size{0.0};      ///< Average transactions per batch
-            std::atomic<double> batch_formation_time{0.0}; ///< Time to form batches (ms)
-            std::atomic<double> proof_generation_time{0.0}; ///< Time to generate proofs (ms)
-            std::atomic<uint64_t> failed_batches{0};      ///< Number of failed batch proofs
-            std::atomic<double> batch_success_rate{1.0};   ///< Successful batch ratio
+            double avg_batch_size{0.0};      ///< Average transactions per batch
+            double batch_formation_time{0.0}; ///< Time to form batches (ms)
+            double proof_generation_time{0.0}; ///< Time to generate proofs (ms)
+            uint64_t failed_batches{0};      ///< Number of failed batch proofs
+            double batch_success_rate{1.0};   ///< Successful batch ratio
         } batch_metrics;
         
         struct WitnessMetrics {
-            std::atomic<double> avg_witness_count{0.0};    ///< Average witnesses per batch
-            std::atomic<double> witness_response_time{0.0}; ///< Average response time (ms)
-            std::atomic<uint64_t> witness_timeouts{0};     ///< Number of witness timeouts
-            std::atomic<double> witness_reliability{1.0};   ///< Average witness reliability
-            std::atomic<uint64_t> malicious_attempts{0};   ///< Detected malicious attempts
+            double avg_witness_count{0.0};    ///< Average witnesses per batch
+            double witness_response_time{0.0}; ///< Average response time (ms)
+            uint64_t witness_timeouts{0};     ///< Number of witness timeouts
+            double witness_reliability{1.0};   ///< Average witness reliability
+            uint64_t malicious_attempts{0};   ///< Detected malicious attempts
         } witness_metrics;
         
         struct ZKPMetrics {
-            std::atomic<double> avg_proof_size{0.0};      ///< Average ZKP size (bytes)
-            std::atomic<double> verification_success{1.0}; ///< ZKP verification success rate
-            std::atomic<double> recursive_depth_avg{1.0};  ///< Average recursive ZKP depth
-            std::atomic<uint64_t> proof_optimizations{0};  ///< Number of proof optimizations
-            std::atomic<double> quantum_speedup{1.0};      ///< Quantum vs classical speedup
+            double avg_proof_size{0.0};      ///< Average ZKP size (bytes)
+            double verification_success{1.0}; ///< ZKP verification success rate
+            double recursive_depth_avg{1.0};  ///< Average recursive ZKP depth
+            uint64_t proof_optimizations{0};  ///< Number of proof optimizations
+            double quantum_speedup{1.0};      ///< Quantum vs classical speedup
         } zkp_metrics;
         
         struct NetworkMetrics {
-            std::atomic<double> consensus_latency{0.0};    ///< Average consensus time (ms)
-            std::atomic<double> network_throughput{0.0};   ///< Transactions per second
-            std::atomic<uint64_t> network_conflicts{0};    ///< Number of consensus conflicts
-            std::atomic<double> bandwidth_usage{0.0};      ///< Average bandwidth (MB/s)
-            std::atomic<double> sync_time{0.0};           ///< Average state sync time (ms)
+            double consensus_latency{0.0};    ///< Average consensus time (ms)
+            double network_throughput{0.0};   ///< Transactions per second
+            uint64_t network_conflicts{0};    ///< Number of consensus conflicts
+            double bandwidth_usage{0.0};      ///< Average bandwidth (MB/s)
+            double sync_time{0.0};           ///< Average state sync time (ms)
         } network_metrics;
         
         /**
@@ -389,6 +403,49 @@ public:
         }
     };
 
+    /// Log2 latency buckets per pipeline stage
+    static constexpr std::size_t LATENCY_BUCKETS = 32;
+
+    /**
+     * @brief Latency distribution of one pipeline stage
+     *
+     * Bucket i counts runs that took [2^i, 2^(i+1)) microseconds.
+     */
+    struct StageLatency {
+        array<uint64_t, LATENCY_BUCKETS> buckets{};
+        uint64_t count{0};
+        double mean_us{0.0};
+
+        /**
+         * @brief Upper bound on the p-th latency quantile
+         * @param p Quantile in [0, 1]
+         * @return Microseconds, rounded up to a bucket edge
+         */
+        [[nodiscard]] uint64_t percentileMicros(double p) const noexcept {
+            const auto target = static_cast<uint64_t>(std::ceil(p * static_cast<double>(count)));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+                seen += buckets[i];
+                if (seen >= target && seen > 0) {
+                    return uint64_t{1} << (i + 1);
+                }
+            }
+            return 0;
+        }
+    };
+
+    /**
+     * @brief Pipeline stage latencies and backpressure counters
+     */
+    struct PipelineStats {
+        StageLatency collect;          ///< Batch collection, SIMD pass and hashing
+        StageLatency prove;            ///< Quantum proof generation
+        StageLatency witness;          ///< Witness selection and signing
+        uint64_t backpressure_waits{0}; ///< Times a stage waited for room downstream
+        uint64_t batches_completed{0};
+        utils::AdaptiveBatchController::Stats batching; ///< Adaptive batch size and timeout decisions
+    };
+
     /**
      * @brief Creates a new POBPC instance
      * @param config Initial configuration
@@ -423,6 +480,18 @@ public:
      */
     [[nodiscard]] bool verifyBatchProof(const BatchProof& proof) const;
 
+    /**
+     * @brief Verifies a proof straight from its compact encoding
+     *
+     * Reads the received buffer in place through BatchProofView; the
+     * quantum state is checked against its commitment instead of being
+     * decoded.
+     *
+     * @param encoded Bytes produced by encodeBatchProof
+     * @return true if the encoding is well formed and the proof is valid
+     */
+    [[nodiscard]] bool verifyBatchProof(std::span<const uint8_t> encoded) const;
+
     // Witness management
     /**
      * @brief Registers a new witness
@@ -473,6 +542,33 @@ public:
      */
     [[nodiscard]] ConsensusMetrics getMetrics() const noexcept;
 
+    // Pipelined consensus
+    /**
+     * @brief Starts producing batch proofs on a three-stage pipeline
+     *
+     * Batch N+1 is collected and hashed while batch N's quantum proof is
+     * generated and batch N-1 gathers witness signatures, so throughput is
+     * set by the slowest stage. At most pipeline_depth batches wait between
+     * stages; a full stage blocks the one before it. A partial batch is
+     * emitted once batch_timeout has passed since its first transaction.
+     *
+     * @param on_proof Called with each finished proof, in batch order, on
+     *                 the witness stage's thread
+     * @throws std::logic_error if the pipeline is already running
+     */
+    void startPipeline(std::function<void(BatchProof&&)> on_proof);
+
+    /**
+     * @brief Stops the pipeline after finishing the batches inside it
+     */
+    void stopPipeline();
+
+    /**
+     * @brief Gets per-stage latency histograms of the pipeline
+     * @return Statistics since construction
+     */
+    [[nodiscard]] PipelineStats getPipelineStats() const;
+
     // Configuration
     /**
      * @brief Updates consensus configuration
@@ -540,7 +636,6 @@ private:
         std::chrono::microseconds processing_time);
 
     // SIMD batch processing
-    void processBatchSIMD(std::vector<std::vector<uint8_t>>& batch);
     void verifyBatchSIMD(const BatchProof& proof, std::vector<bool>& results);
 
     // Quantum operations
@@ -5,9 +5,10 @@
 #include <random>
 #include <chrono>
 #include <atomic>
-#include "quantum/QuantumTypes.hpp"
-#include "quantum/QuantumCrypto.hpp"
-#include "evm/FloatingPoint.hpp"
+#include <string>
+#include "crypto/signature/BatchVerifier.hpp"
+#include "quantum/QuantumProof.hpp"
+#include "quantum/QuantumState.hpp"
 
 namespace quids {
 namespace consensus {
@@ -22,15 +23,24 @@ public:
         bool use_quantum_proofs{true};
         size_t quantum_circuit_depth{20};
         bool enable_error_correction{true};
+        // Scheme of the witness keys registered here and of their votes
+        crypto::SignatureScheme witness_scheme{crypto::SignatureScheme::Falcon512};
+        // Names this node's proposals; peers register its key under it
+        std::string node_id;
     };
 
     struct BatchProof {
         std::vector<uint8_t> proof_data;
         std::vector<uint8_t> batch_hash;
+        std::string proposer_id;  // proof_data verifies under this proposer's key
         uint64_t timestamp;
         size_t transaction_count;
+        std::vector<uint64_t> signer_bitmap;  // bit i: witness with index i signed
+        // One per set bit, in ascending witness index order
         std::vector<std::vector<uint8_t>> witness_signatures;
-        QuantumProof quantum_proof;
+        quantum::QuantumProof quantum_proof;
+
+        size_t signerCount() const noexcept;
     };
 
     struct WitnessInfo {
@@ -38,7 +48,8 @@ public:
         std::vector<uint8_t> public_key;
         std::atomic<double> reliability_score;
         std::atomic<uint64_t> last_active;
-        QuantumState quantum_state;
+        quantum::QuantumState quantum_state;
+        uint32_t index{0};  // dense id, fixed at registration
     };
 
     // Constructor
@@ -56,14 +67,21 @@ public:
     BatchProof generateBatchProof();
     bool verifyBatchProof(const BatchProof& proof);
 
+    // Proposer keys. A node always knows its own; proofs from any other
+    // proposer verify only once its Falcon-512 key is registered here
+    std::vector<uint8_t> getProposerPublicKey() const;
+    bool registerProposer(const std::string& node_id, const std::vector<uint8_t>& public_key);
+
     // Witness management
     bool registerWitness(const std::string& node_id, const std::vector<uint8_t>& public_key);
-    std::vector<WitnessInfo> selectWitnesses();
+    // Handles into the witness table, valid for the lifetime of this POBPC
+    std::vector<const WitnessInfo*> selectWitnesses();
     bool submitWitnessVote(const std::string& witness_id, 
                           const std::vector<uint8_t>& signature,
-                          const BatchProof& proof);
+                          BatchProof& proof);
 
-    // Consensus verification
+    // Consensus verification. Each signer bit is counted only if its
+    // signature verifies against that witness's key and the batch hash.
     bool hasReachedConsensus(const BatchProof& proof);
     double calculateConsensusConfidence(const BatchProof& proof);
 
@@ -90,7 +108,7 @@ private:
                                const std::vector<uint8_t>& signature,
                                const std::vector<uint8_t>& message);
     void updateWitnessReliability(const std::string& witness_id, bool successful_validation);
-    std::vector<WitnessInfo> selectWitnessesRandomly(size_t count);
+    std::vector<const WitnessInfo*> selectWitnessesRandomly(size_t count);
     bool validateBatchStructure(const BatchProof& proof);
     void recordMetrics(const BatchProof& proof, std::chrono::microseconds processing_time);
 
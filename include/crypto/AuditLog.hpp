@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+
+// Asynchronous audit trail for key operations.
+//
+// record() only hashes the data and pushes a fixed-size entry onto a bounded
+// queue. A background thread hands the entries to the sink in batches, so
+// the operation being audited never waits on I/O. When the queue is full,
+// entries are dropped and counted rather than stalling the caller. Only a
+// digest of the data is kept, never the data itself.
+class AuditLog {
+public:
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        std::string operation;
+        uint64_t data_size{0};
+        std::array<uint8_t, 16> digest{};  // BLAKE3 of the data, truncated
+    };
+
+    using Sink = std::function<void(const std::vector<Record>&)>;
+
+    struct Stats {
+        uint64_t recorded{0};
+        uint64_t dropped{0};
+        uint64_t written{0};
+    };
+
+    static constexpr size_t DEFAULT_CAPACITY = 8192;
+
+    explicit AuditLog(size_t capacity = DEFAULT_CAPACITY);
+    // Writes out whatever is still queued
+    ~AuditLog();
+
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+
+    [[nodiscard]] static AuditLog& global();
+
+    // Called on the writer thread; entries are discarded while no sink is set
+    void setSink(Sink sink);
+
+    // Never blocks; false when the entry was dropped
+    bool record(std::string_view operation, std::span<const uint8_t> data);
+
+    // Returns once everything recorded before the call has reached the sink
+    void flush();
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace crypto
+} // namespace quids
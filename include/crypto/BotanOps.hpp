@@ -0,0 +1,82 @@
+#pragma once
+
+#include <botan/auto_rng.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+
+// Per-thread RNG for the Botan wrappers. Constructing an AutoSeeded_RNG reads
+// the system RNG, which costs more than signing a short message.
+inline Botan::RandomNumberGenerator& threadRng() {
+    thread_local Botan::AutoSeeded_RNG rng;
+    return rng;
+}
+
+// Long-lived Botan operation objects (PK_Signer, PK_KEM_Decryptor, ...) for
+// one key. They keep per-message state, so a thread leases one for the length
+// of an operation and gives it back afterwards. A thread that finds the pool
+// empty builds a new object, and up to maxIdle objects are kept between
+// operations. In steady state every thread reuses the object it returned
+// last time.
+template<typename Op>
+class BotanOpPool {
+public:
+    using Factory = std::function<std::unique_ptr<Op>()>;
+
+    class Lease {
+    public:
+        Lease(BotanOpPool& pool, std::unique_ptr<Op> op) : pool_(&pool), op_(std::move(op)) {}
+        Lease(Lease&&) = default;
+        Lease& operator=(Lease&&) = delete;
+        ~Lease() {
+            if (op_) pool_->release(std::move(op_));
+        }
+
+        Op& operator*() const { return *op_; }
+        Op* operator->() const { return op_.get(); }
+
+    private:
+        BotanOpPool* pool_;
+        std::unique_ptr<Op> op_;
+    };
+
+    explicit BotanOpPool(Factory factory, size_t maxIdle = 16)
+        : factory_(std::move(factory)), max_idle_(maxIdle) {}
+
+    BotanOpPool(const BotanOpPool&) = delete;
+    BotanOpPool& operator=(const BotanOpPool&) = delete;
+
+    // The pool must outlive the lease
+    Lease acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!idle_.empty()) {
+                auto op = std::move(idle_.back());
+                idle_.pop_back();
+                return Lease(*this, std::move(op));
+            }
+        }
+        return Lease(*this, factory_());
+    }
+
+private:
+    void release(std::unique_ptr<Op> op) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < max_idle_) {
+            idle_.push_back(std::move(op));
+        }
+    }
+
+    Factory factory_;
+    size_t max_idle_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Op>> idle_;
+};
+
+} // namespace crypto
+} // namespace quids
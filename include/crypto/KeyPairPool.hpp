@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace quids {
+namespace crypto {
+
+// Key pairs generated ahead of time, so a caller that needs a fresh one
+// (an ephemeral session key, a new address) pops it instead of paying
+// for key generation on the request path.
+//
+// A background thread keeps `depth` pairs ready. It starts with the
+// first take(), runs at idle priority where the OS has one (SCHED_IDLE
+// on Linux), and only works while the pool is below depth, so it uses
+// cycles nothing else wants. take() is O(1) while pairs are ready; when
+// the pool has run dry it generates on the calling thread, as if there
+// were no pool. Every pair is handed out once. Pairs with a private_key
+// byte vector have it wiped when the pool drops them unused.
+template<typename Pair>
+class KeyPairPool {
+public:
+    using Generator = std::function<Pair()>;
+
+    struct Stats {
+        uint64_t taken{0};
+        uint64_t misses{0};  // generated on the caller's thread
+        uint64_t generated{0};  // by the background thread
+        size_t ready{0};
+    };
+
+    KeyPairPool(Generator generator, size_t depth) : generator_(std::move(generator)), depth_(depth) {}
+
+    ~KeyPairPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        changed_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        for (auto& pair : ready_) {
+            wipe(pair);
+        }
+    }
+
+    KeyPairPool(const KeyPairPool&) = delete;
+    KeyPairPool& operator=(const KeyPairPool&) = delete;
+
+    Pair take() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++stats_.taken;
+            startLocked();
+            if (!ready_.empty()) {
+                Pair pair = std::move(ready_.front());
+                ready_.pop_front();
+                lock.unlock();
+                changed_.notify_all();
+                return pair;
+            }
+            ++stats_.misses;
+        }
+        return generator_();
+    }
+
+    // 0 stops refilling and drops what is ready
+    void setDepth(size_t depth) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        depth_ = depth;
+        while (ready_.size() > depth_) {
+            wipe(ready_.back());
+            ready_.pop_back();
+        }
+        startLocked();
+        changed_.notify_all();
+    }
+
+    // Blocks until depth pairs are ready, e.g. during startup
+    void prefill() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        startLocked();
+        changed_.wait(lock, [&] { return stopping_ || ready_.size() >= depth_; });
+    }
+
+    [[nodiscard]] Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats stats = stats_;
+        stats.ready = ready_.size();
+        return stats;
+    }
+
+private:
+    static constexpr std::chrono::seconds FAILURE_BACKOFF{1};
+
+    static void wipe(Pair& pair) {
+        if constexpr (requires { pair.private_key.data(); pair.private_key.size(); }) {
+            volatile uint8_t* p = pair.private_key.data();
+            for (size_t i = 0; i < pair.private_key.size(); ++i) {
+                p[i] = 0;
+            }
+        }
+    }
+
+    void startLocked() {
+        if (!worker_.joinable() && depth_ > 0 && !stopping_) {
+            worker_ = std::thread([this] { run(); });
+        }
+    }
+
+    void run() {
+#if defined(__linux__)
+        // Thread-level on Linux: only this thread drops to idle priority
+        sched_param param{};
+        sched_setscheduler(0, SCHED_IDLE, &param);
+#endif
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            changed_.wait(lock, [&] { return stopping_ || ready_.size() < depth_; });
+            if (stopping_) {
+                break;
+            }
+            lock.unlock();
+            bool ok = true;
+            Pair pair{};
+            try {
+                pair = generator_();
+            } catch (...) {
+                ok = false;
+            }
+            lock.lock();
+            if (!ok) {
+                // A broken RNG or library should not spin this thread
+                changed_.wait_for(lock, FAILURE_BACKOFF, [&] { return stopping_; });
+                continue;
+            }
+            ++stats_.generated;
+            if (ready_.size() < depth_) {
+                ready_.push_back(std::move(pair));
+                changed_.notify_all();
+            } else {
+                wipe(pair);
+            }
+        }
+    }
+
+    const Generator generator_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Pair> ready_;
+    size_t depth_;
+    bool stopping_{false};
+    Stats stats_;
+    std::thread worker_;
+};
+
+} // namespace crypto
+} // namespace quids
@@ -1,19 +1,35 @@
 #pragma once
 
+#include "crypto/blake3/MerkleBuilder.hpp"
 #include <memory>
+#include <span>
 #include <vector>
 #include <cstdint>
 
 namespace quids {
 namespace crypto {
 
+// BLAKE3-256, one-shot, streaming, or many messages at once. hashMany()
+// runs short messages through BatchHasher's multi-lane kernels, so bulk
+// callers (transaction IDs, Merkle leaves, address derivation) get the
+// vector width without any change in digests.
 class QuantumHashFunction {
 public:
+    using Digest = MerkleHash;
+
     QuantumHashFunction();
     ~QuantumHashFunction();
     
     // Hash data using quantum-resistant algorithm
     std::vector<uint8_t> hash(const std::vector<uint8_t>& data);
+
+    // out.size() must equal messages.size()
+    static void hashMany(std::span<const std::span<const uint8_t>> messages, std::span<Digest> out);
+
+    // Streaming: update() as data arrives, finalize() returns the digest of
+    // everything since the last finalize() and starts over
+    void update(std::span<const uint8_t> data);
+    Digest finalize();
     
 private:
     class Impl;
@@ -21,4 +37,4 @@ private:
 };
 
 } // namespace crypto
-} // namespace quids
\ No newline at end of file
+} // namespace quids
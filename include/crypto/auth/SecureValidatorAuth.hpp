@@ -101,7 +101,11 @@ public:
 
 private:
     class Impl;
-    std::unique_ptr<Impl> impl_;
+    // Impls come from a slab pool; one is made per authentication attempt
+    struct ImplDeleter {
+        void operator()(Impl* impl) const noexcept;
+    };
+    std::unique_ptr<Impl, ImplDeleter> impl_;
 };
 
 } // namespace crypto
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "crypto/auth/SecureValidatorAuth.hpp"
+#include "utils/WorkStealingPool.hpp"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+
+/**
+ * @brief Server side of SRP6 validator authentication for many peers at once
+ *
+ * SecureValidatorAuth holds a single session per object. This class instead
+ * keeps a table of open sessions, so one instance can serve a whole
+ * validator-set rotation. Verifiers are decoded once when they are registered.
+ * Session state comes from a slab pool. The modular exponentiations of each
+ * handshake run on the work-stealing pool, so the calling thread (typically
+ * consensus) only queues work and collects proofs. Thread-safe.
+ */
+class ValidatorAuthServer {
+public:
+    using SessionId = uint64_t;
+
+    struct Handshake {
+        SessionId session_id{0};
+        SecureValidatorAuth::ServerSession session;
+    };
+
+    struct Request {
+        std::string identifier;
+        std::vector<uint8_t> client_public_ephemeral;
+    };
+
+    struct Stats {
+        uint64_t started{0};
+        uint64_t verified{0};
+        uint64_t rejected{0};
+        size_t open_sessions{0};
+        size_t verifiers{0};
+    };
+
+    explicit ValidatorAuthServer(utils::WorkStealingPool& pool = utils::WorkStealingPool::global());
+    ~ValidatorAuthServer();
+
+    ValidatorAuthServer(const ValidatorAuthServer&) = delete;
+    ValidatorAuthServer& operator=(const ValidatorAuthServer&) = delete;
+
+    /**
+     * @brief Cache a validator's verifier, replacing any earlier one
+     */
+    void registerVerifier(const std::string& identifier, const SecureValidatorAuth::Verifier& verifier);
+    void removeVerifier(const std::string& identifier);
+
+    /**
+     * @brief Run the server steps of SRP6 against a registered verifier
+     *
+     * @return The handshake, or nullopt for an unknown identifier or an invalid ephemeral
+     */
+    std::optional<Handshake> startServerAuth(const std::string& identifier,
+                                             const std::vector<uint8_t>& client_public_ephemeral);
+
+    /**
+     * @brief startServerAuth on the worker pool
+     *
+     * The server must outlive the returned future.
+     */
+    std::future<std::optional<Handshake>> startServerAuthAsync(std::string identifier,
+                                                               std::vector<uint8_t> client_public_ephemeral);
+
+    /**
+     * @brief Start many handshakes, spread across the worker pool
+     *
+     * @return One result per request, in request order
+     */
+    std::vector<std::optional<Handshake>> startServerAuthBatch(const std::vector<Request>& requests);
+
+    /**
+     * @brief Check a client's proof. The session is closed either way.
+     */
+    bool verifyClientProof(SessionId session_id, const std::vector<uint8_t>& client_proof);
+
+    /**
+     * @brief Session key of an open session
+     */
+    std::optional<std::vector<uint8_t>> getSessionKey(SessionId session_id) const;
+
+    void closeSession(SessionId session_id);
+    Stats stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace crypto
+} // namespace quids
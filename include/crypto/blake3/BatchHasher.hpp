@@ -0,0 +1,34 @@
+#pragma once
+
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+
+// Plain BLAKE3 digests of many independent messages.
+//
+// A message that fits in one 1 KiB BLAKE3 chunk takes a single chunk's worth
+// of compressions, so such messages are hashed side by side, one per vector
+// lane: 16 at a time with AVX-512, 8 with AVX2 and 4 with NEON or SSE2,
+// chosen at runtime. Messages are grouped by block count so lanes finish
+// together. Longer messages go through the BLAKE3 library one at a time.
+// Digests are identical to Blake3Hash over the same bytes.
+class BatchHasher {
+public:
+    static constexpr size_t CHUNK_SIZE = 1024;
+
+    // "avx512", "avx2", "neon" or "sse2"; "portable" without vector lanes
+    [[nodiscard]] static const char* isa() noexcept;
+    // Messages the widest usable kernel hashes at once
+    [[nodiscard]] static size_t lanes() noexcept;
+
+    // out must have room for messages.size() digests
+    static void hashMany(std::span<const std::span<const uint8_t>> messages, MerkleHash* out);
+    [[nodiscard]] static std::vector<MerkleHash> hashMany(const std::vector<std::vector<uint8_t>>& messages);
+};
+
+} // namespace crypto
+} // namespace quids
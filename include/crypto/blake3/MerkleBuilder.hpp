@@ -0,0 +1,66 @@
+#pragma once
+
+#include "utils/WorkStealingPool.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+
+using MerkleHash = std::array<uint8_t, 32>;
+
+// Inclusion proof for one leaf: the sibling at each level, bottom up. A level
+// where the node had no sibling and was carried up contributes nothing.
+struct MerkleProof {
+    size_t index{0};
+    size_t leaf_count{0};
+    std::vector<MerkleHash> siblings;
+};
+
+// BLAKE3 Merkle tree shared by block, batch and proof roots.
+//
+// Leaves and interior nodes are hashed under different domain bytes, and an
+// odd node at the end of a level is carried up unchanged. Each level lives in
+// one contiguous array; appending leaves only recomputes the nodes on the
+// right edge that they change, and wide levels are hashed in parallel on the
+// work-stealing pool. Not thread-safe; use one builder per tree.
+class MerkleBuilder {
+public:
+    explicit MerkleBuilder(utils::WorkStealingPool& pool = utils::WorkStealingPool::global());
+
+    [[nodiscard]] static MerkleHash hashLeaf(std::span<const uint8_t> data);
+    [[nodiscard]] static MerkleHash hashNode(const MerkleHash& left, const MerkleHash& right);
+    // Throws std::invalid_argument unless digest is 32 bytes
+    [[nodiscard]] static MerkleHash toHash(std::span<const uint8_t> digest);
+
+    // Hashes data as a leaf
+    void append(std::span<const uint8_t> data);
+    // Takes an existing digest as the leaf, e.g. a transaction hash
+    void appendHash(const MerkleHash& leaf);
+    // Appends count leaves, leaf(i) computed in parallel
+    void appendParallel(size_t count, const std::function<MerkleHash(size_t)>& leaf);
+
+    [[nodiscard]] size_t size() const { return levels_.front().size(); }
+
+    // All zeros for an empty tree
+    [[nodiscard]] MerkleHash root();
+    // Throws std::out_of_range for an index past the last leaf
+    [[nodiscard]] MerkleProof proof(size_t index);
+    [[nodiscard]] static bool verify(const MerkleHash& root, const MerkleHash& leaf, const MerkleProof& proof);
+
+    void clear();
+
+private:
+    void build();
+
+    utils::WorkStealingPool& pool_;
+    std::vector<std::vector<MerkleHash>> levels_;
+    // Per level, how many leading nodes no later append can change
+    std::vector<size_t> final_;
+};
+
+} // namespace crypto
+} // namespace quids
@@ -1,4 +1,5 @@
 #pragma once
+#include "simd.hpp"
 #include <cmath>
 #include <complex>
 #include <numbers>
@@ -1099,6 +1100,10 @@ fft(cmplx* const __restrict vec)
     const size_t lenx2 = len << 1;
     const size_t k_beg = N >> (l + 1);
 
+    if (simd::fft_layer(vec, N, len, k_beg, POWERS_OF_ζ)) {
+      continue;
+    }
+
     for (size_t start = 0; start < N; start += lenx2) {
       const size_t k_now = k_beg + (start >> (l + 1));
       // Can also be computed using computeζ<N>(bit_rev<LOG2N>(k_now))
@@ -1136,6 +1141,10 @@ ifft(cmplx* const __restrict vec)
     const size_t lenx2 = len << 1;
     const size_t k_beg = (N >> l) - 1;
 
+    if (simd::ifft_layer(vec, N, len, k_beg, POWERS_OF_ζ)) {
+      continue;
+    }
+
     for (size_t start = 0; start < N; start += lenx2) {
       const size_t k_now = k_beg - (start >> (l + 1));
       // Can also be computed using -computeζ<N>(bit_rev<LOG2N>(k_now))
@@ -1151,6 +1160,10 @@ ifft(cmplx* const __restrict vec)
     }
   }
 
+  if (simd::scale(vec, N, INV_N)) {
+    return;
+  }
+
   for (size_t i = 0; i < N; i++) {
     vec[i] = vec[i] * INV_N;
   }
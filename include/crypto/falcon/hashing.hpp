@@ -49,4 +49,87 @@ hash_to_point(const uint8_t* const __restrict salt,
   }
 }
 
+namespace detail {
+
+template<const size_t n, const size_t L>
+inline void
+hash_to_point_group(const uint8_t* const* const salts,
+                    const size_t slen,
+                    const uint8_t* const* const msgs,
+                    const size_t* const mlens,
+                    ff::ff_t* const* const polys,
+                    const size_t count)
+{
+  constexpr size_t m = 1ul << 16;
+  constexpr size_t q = ff::Q;
+  constexpr size_t k = m / q;
+  constexpr uint16_t kq = k * q;
+
+  size_t plens[L];
+  std::fill_n(plens, L, slen);
+  shake256::shake256_multi<L> hasher;
+  hasher.hash(salts, plens, msgs, mlens, count);
+
+  uint8_t bufs[L][shake256::rate >> 3];
+  uint8_t* outs[L];
+  for (size_t j = 0; j < L; j++) {
+    outs[j] = bufs[j];
+  }
+
+  size_t coeff_idx[L]{};
+  size_t done = 0;
+  while (done < count) {
+    hasher.squeeze_block(outs);
+
+    for (size_t j = 0; j < count; j++) {
+      if (coeff_idx[j] == n) {
+        continue;
+      }
+      for (size_t off = 0; (off < sizeof(bufs[j])) && (coeff_idx[j] < n); off += 2) {
+        const uint16_t t = (static_cast<uint16_t>(bufs[j][off + 0]) << 8) |
+                           (static_cast<uint16_t>(bufs[j][off + 1]) << 0);
+        if (t < kq) {
+          polys[j][coeff_idx[j]] = ff::ff_t{ t };
+          coeff_idx[j]++;
+        }
+      }
+      done += coeff_idx[j] == n;
+    }
+  }
+}
+
+}
+
+// Same as hash_to_point, for `count` messages at once that share a salt
+// length, e.g. the signatures of one verification batch. Output i goes to
+// polys[i]. Uses the multi-lane SHAKE256 when the CPU supports it.
+template<const size_t n>
+inline void
+hash_to_point_many(const uint8_t* const* const __restrict salts,
+                   const size_t slen,
+                   const uint8_t* const* const __restrict msgs,
+                   const size_t* const __restrict mlens,
+                   ff::ff_t* const* const __restrict polys,
+                   const size_t count)
+  requires((n == 512) || (n == 1024))
+{
+  const size_t lanes = keccak::multi_lanes();
+  if (lanes == 1 || count < 2) {
+    for (size_t i = 0; i < count; i++) {
+      hash_to_point<n>(salts[i], slen, msgs[i], mlens[i], polys[i]);
+    }
+    return;
+  }
+
+  if (lanes >= 8) {
+    for (size_t g = 0; g < count; g += 8) {
+      detail::hash_to_point_group<n, 8>(salts + g, slen, msgs + g, mlens + g, polys + g, std::min<size_t>(8, count - g));
+    }
+  } else {
+    for (size_t g = 0; g < count; g += 4) {
+      detail::hash_to_point_group<n, 4>(salts + g, slen, msgs + g, mlens + g, polys + g, std::min<size_t>(4, count - g));
+    }
+  }
+}
+
 }
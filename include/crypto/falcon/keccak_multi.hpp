@@ -0,0 +1,179 @@
+#pragma once
+#include "keccak.hpp"
+#include "utils/CpuFeatures.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define KECCAK_MULTI_X86 1
+#endif
+
+// Keccak-p[1600, 24] over several independent states at once.
+//
+// States are stored interleaved, word-major: state[25 * lanes] holds word w of
+// lane j at index w * lanes + j, so word w of every lane sits in one vector
+// register. Four lanes use AVX2 and eight use AVX-512F; which ones are usable
+// is decided at runtime, and the scalar permutation remains the fallback.
+namespace keccak {
+
+// Largest lane count any kernel handles
+constexpr size_t MAX_LANES = 8;
+
+// Round constants for the lane-parallel kernels, independent of the layout the
+// single-state AVX2 build uses for RC
+constexpr uint64_t MULTI_RC[ROUNDS]{ compute_rc(0),  compute_rc(1),  compute_rc(2),  compute_rc(3),  compute_rc(4),
+                                     compute_rc(5),  compute_rc(6),  compute_rc(7),  compute_rc(8),  compute_rc(9),
+                                     compute_rc(10), compute_rc(11), compute_rc(12), compute_rc(13), compute_rc(14),
+                                     compute_rc(15), compute_rc(16), compute_rc(17), compute_rc(18), compute_rc(19),
+                                     compute_rc(20), compute_rc(21), compute_rc(22), compute_rc(23) };
+
+// Number of lanes the widest kernel usable on this CPU permutes at once; 1
+// when only the scalar permutation is available
+inline size_t
+multi_lanes()
+{
+#if KECCAK_MULTI_X86
+  using quids::utils::CpuFeature;
+  static const size_t lanes = [] {
+    switch (quids::utils::selectFeature("keccak.multi", { CpuFeature::Avx512f, CpuFeature::Avx2 })) {
+      case CpuFeature::Avx512f:
+        return size_t{ 8 };
+      case CpuFeature::Avx2:
+        return size_t{ 4 };
+      default:
+        return size_t{ 1 };
+    }
+  }();
+  return lanes;
+#else
+  return 1;
+#endif
+}
+
+namespace multi {
+
+#if KECCAK_MULTI_X86
+
+using u64x4 = uint64_t __attribute__((vector_size(32)));
+using u64x8 = uint64_t __attribute__((vector_size(64)));
+
+// In place, so no vector crosses a call boundary by value
+template<typename V>
+[[gnu::always_inline]] inline void
+rotl(V& v, const size_t n)
+{
+  if (n != 0) {
+    v = (v << n) | (v >> (LANE_SIZE - n));
+  }
+}
+
+// The five step mappings of each round, on whole vectors; compiled for the
+// instruction set of whichever kernel inlines it
+template<typename V>
+[[gnu::always_inline]] inline void
+permute_lanes(V* const s)
+{
+  for (size_t r = 0; r < ROUNDS; r++) {
+    V c[5];
+#if defined __GNUC__
+#pragma GCC unroll 5
+#endif
+    for (size_t x = 0; x < 5; x++) {
+      c[x] = s[x] ^ s[x + 5] ^ s[x + 10] ^ s[x + 15] ^ s[x + 20];
+    }
+
+    V d[5];
+#if defined __GNUC__
+#pragma GCC unroll 5
+#endif
+    for (size_t x = 0; x < 5; x++) {
+      d[x] = c[(x + 1) % 5];
+      rotl(d[x], 1);
+      d[x] ^= c[(x + 4) % 5];
+    }
+
+    // θ, then ρ and π together
+    V t[25];
+#if defined __GNUC__
+#pragma GCC unroll 25
+#endif
+    for (size_t i = 0; i < 25; i++) {
+      const size_t from = PERM[i];
+      t[i] = s[from] ^ d[from % 5];
+      rotl(t[i], ROT[from]);
+    }
+
+    // χ
+#if defined __GNUC__
+#pragma GCC unroll 5
+#endif
+    for (size_t y = 0; y < 25; y += 5) {
+#if defined __GNUC__
+#pragma GCC unroll 5
+#endif
+      for (size_t x = 0; x < 5; x++) {
+        s[y + x] = t[y + x] ^ (~t[y + (x + 1) % 5] & t[y + (x + 2) % 5]);
+      }
+    }
+
+    // ι
+    s[0] ^= MULTI_RC[r];
+  }
+}
+
+__attribute__((target("avx2"))) inline void
+permute_x4(uint64_t* const state)
+{
+  u64x4 s[25];
+  std::memcpy(s, state, sizeof(s));
+  permute_lanes(s);
+  std::memcpy(state, s, sizeof(s));
+}
+
+__attribute__((target("avx512f"))) inline void
+permute_x8(uint64_t* const state)
+{
+  u64x8 s[25];
+  std::memcpy(s, state, sizeof(s));
+  permute_lanes(s);
+  std::memcpy(state, s, sizeof(s));
+}
+
+#endif
+
+// Permutes `lanes` interleaved states one at a time, for CPUs without a
+// matching kernel
+inline void
+permute_scalar(uint64_t* const state, const size_t lanes)
+{
+  uint64_t lane[25];
+  for (size_t j = 0; j < lanes; j++) {
+    for (size_t w = 0; w < 25; w++) {
+      lane[w] = state[w * lanes + j];
+    }
+    permute(lane);
+    for (size_t w = 0; w < 25; w++) {
+      state[w * lanes + j] = lane[w];
+    }
+  }
+}
+
+}
+
+// Applies Keccak-p[1600, 24] to each of `lanes` ∈ {4, 8} interleaved states
+inline void
+permute_multi(uint64_t* const state, const size_t lanes)
+{
+#if KECCAK_MULTI_X86
+  if (lanes == 8 && multi_lanes() >= 8) {
+    multi::permute_x8(state);
+    return;
+  }
+  if (lanes == 4 && multi_lanes() >= 4) {
+    multi::permute_x4(state);
+    return;
+  }
+#endif
+  multi::permute_scalar(state, lanes);
+}
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "ff.hpp"
+#include "simd.hpp"
 #include <array>
 
 // (inverse) Number Theoretic Transform for degree-{511, 1023} polynomial, over
@@ -108,6 +109,12 @@ compute_neg_powers_of_ζ()
 constexpr auto NEG_POWERS_OF_ζ_512 = compute_neg_powers_of_ζ<FALCON512_N>();
 constexpr auto NEG_POWERS_OF_ζ_1024 = compute_neg_powers_of_ζ<FALCON1024_N>();
 
+// The same twiddle tables in Montgomery form, for the vectorized layers
+constexpr auto MONT_POWERS_OF_ζ_512 = simd::to_montgomery(POWERS_OF_ζ_512);
+constexpr auto MONT_POWERS_OF_ζ_1024 = simd::to_montgomery(POWERS_OF_ζ_1024);
+constexpr auto MONT_NEG_POWERS_OF_ζ_512 = simd::to_montgomery(NEG_POWERS_OF_ζ_512);
+constexpr auto MONT_NEG_POWERS_OF_ζ_1024 = simd::to_montgomery(NEG_POWERS_OF_ζ_1024);
+
 // Given a polynomial f with {512, 1024} coefficients s.t. each coefficient ∈
 // Z_q, this routine computes number theoretic transform using Cooley-Tukey
 // algorithm, producing {512, 1024} evaluations f' s.t. they are placed in
@@ -129,6 +136,12 @@ ntt(ff::ff_t* const __restrict poly)
     const size_t lenx2 = len << 1;
     const size_t k_beg = N >> (l + 1);
 
+    const auto* const mont_ζ = (LOG2N == FALCON512_LOG2N) ? MONT_POWERS_OF_ζ_512.data()
+                                                           : MONT_POWERS_OF_ζ_1024.data();
+    if (simd::ntt_layer(poly, N, len, k_beg, mont_ζ)) {
+      continue;
+    }
+
     for (size_t start = 0; start < N; start += lenx2) {
       const size_t k_now = k_beg + (start >> (l + 1));
       ff::ff_t ζ_exp{};
@@ -170,6 +183,12 @@ intt(ff::ff_t* const __restrict poly)
     const size_t lenx2 = len << 1;
     const size_t k_beg = (N >> l) - 1;
 
+    const auto* const mont_neg_ζ = (LOG2N == FALCON512_LOG2N) ? MONT_NEG_POWERS_OF_ζ_512.data()
+                                                               : MONT_NEG_POWERS_OF_ζ_1024.data();
+    if (simd::intt_layer(poly, N, len, k_beg, mont_neg_ζ)) {
+      continue;
+    }
+
     for (size_t start = 0; start < N; start += lenx2) {
       const size_t k_now = k_beg - (start >> (l + 1));
       ff::ff_t neg_ζ_exp{};
@@ -190,6 +209,11 @@ intt(ff::ff_t* const __restrict poly)
     }
   }
 
+  constexpr auto INV_N = (LOG2N == FALCON512_LOG2N) ? INV_FALCON512_N : INV_FALCON1024_N;
+  if (simd::scale(poly, N, INV_N)) {
+    return;
+  }
+
   for (size_t i = 0; i < N; i++) {
     if constexpr (LOG2N == FALCON512_LOG2N) {
       poly[i] *= INV_FALCON512_N;
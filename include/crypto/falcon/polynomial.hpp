@@ -2,6 +2,7 @@
 #include "ff.hpp"
 #include "fft.hpp"
 #include "ntt.hpp"
+#include "simd.hpp"
 
 // Polynomial arithmetic over Falcon Prime Field Z_q | q = 3 * (2 ^ 12) + 1 and
 // complex number field C
@@ -89,6 +90,10 @@ mul(const fft::cmplx* const __restrict polya,
 {
   constexpr size_t n = 1ul << lg2n;
 
+  if (simd::mul(polya, polyb, polyc, n)) {
+    return;
+  }
+
   for (size_t i = 0; i < n; i++) {
     polyc[i] = polya[i] * polyb[i];
   }
@@ -104,6 +109,10 @@ mul(const ff::ff_t* const __restrict polya,
 {
   constexpr size_t n = 1ul << lg2n;
 
+  if (simd::mul(polya, polyb, polyc, n)) {
+    return;
+  }
+
   for (size_t i = 0; i < n; i++) {
     polyc[i] = polya[i] * polyb[i];
   }
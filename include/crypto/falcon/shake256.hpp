@@ -1,5 +1,8 @@
 #pragma once
+#include "keccak_multi.hpp"
 #include "sponge.hpp"
+#include <numeric>
+#include <vector>
 
 // SHAKE256 Extendable Output Function : Keccak[512](M || 1111, d)
 namespace shake256 {
@@ -237,4 +240,203 @@ public:
   }
 };
 
+// SHAKE256 over L ∈ {4, 8} independent messages advanced in lockstep, lane j
+// absorbing the concatenation prefix[j] || msg[j]. Lanes whose input ends a few
+// blocks early keep the state they had at that point, so mixed lengths are
+// correct, if slower than equal ones.
+template<const size_t L>
+struct shake256_multi
+{
+private:
+  static constexpr size_t rbytes = rate >> 3;
+  static constexpr size_t rwords = rbytes >> 3;
+
+  alignas(64) uint64_t state[25 * L]{};
+  size_t lanes = 0;
+
+  // Fills blk with bytes [off, off + rbytes) of prefix || msg || padding,
+  // for a total input of tlen bytes
+  static void get_block(const uint8_t* const prefix,
+                        const size_t plen,
+                        const uint8_t* const msg,
+                        const size_t tlen,
+                        const size_t off,
+                        uint8_t* const blk)
+  {
+    std::memset(blk, 0, rbytes);
+
+    const size_t end = std::min(off + rbytes, tlen);
+    if (off < plen) {
+      const size_t n = std::min(end, plen) - off;
+      std::memcpy(blk, prefix + off, n);
+    }
+    if (end > std::max(off, plen)) {
+      const size_t from = std::max(off, plen);
+      std::memcpy(blk + (from - off), msg + (from - plen), end - from);
+    }
+    if (tlen >= off && tlen < off + rbytes) {
+      blk[tlen - off] ^= 0x1f;
+      blk[rbytes - 1] ^= 0x80;
+    }
+  }
+
+public:
+  static_assert(L == 4 || L == 8);
+
+  // Absorbs `count` ≤ L messages; prefixes may be nullptr when every plen is 0
+  void hash(const uint8_t* const* const prefixes,
+            const size_t* const plens,
+            const uint8_t* const* const msgs,
+            const size_t* const mlens,
+            const size_t count)
+  {
+    lanes = std::min(count, L);
+
+    size_t blocks[L]{};
+    size_t max_blocks = 0;
+    for (size_t j = 0; j < lanes; j++) {
+      const size_t plen = prefixes ? plens[j] : 0;
+      blocks[j] = (plen + mlens[j]) / rbytes + 1;
+      max_blocks = std::max(max_blocks, blocks[j]);
+    }
+
+    alignas(64) uint64_t saved[25 * L];
+    uint8_t blk[rbytes];
+    for (size_t b = 0; b < max_blocks; b++) {
+      for (size_t j = 0; j < lanes; j++) {
+        if (b >= blocks[j]) {
+          continue;
+        }
+        const uint8_t* const prefix = prefixes ? prefixes[j] : nullptr;
+        const size_t plen = prefixes ? plens[j] : 0;
+        const size_t tlen = plen + mlens[j];
+        get_block(prefix, plen, msgs[j], tlen, b * rbytes, blk);
+
+        for (size_t w = 0; w < rwords; w++) {
+          uint64_t word = 0;
+          if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(&word, blk + (w << 3), sizeof(word));
+          } else {
+            for (size_t k = 0; k < 8; k++) {
+              word |= static_cast<uint64_t>(blk[(w << 3) + k]) << (k << 3);
+            }
+          }
+          state[w * L + j] ^= word;
+        }
+      }
+
+      keccak::permute_multi(state, L);
+
+      for (size_t j = 0; j < lanes; j++) {
+        if (b + 1 == blocks[j]) {
+          for (size_t w = 0; w < 25; w++) {
+            saved[w * L + j] = state[w * L + j];
+          }
+        }
+      }
+    }
+
+    for (size_t j = 0; j < lanes; j++) {
+      for (size_t w = 0; w < 25; w++) {
+        state[w * L + j] = saved[w * L + j];
+      }
+    }
+  }
+
+  // Writes the next rate/8 output bytes of lane j to outs[j], for each
+  // absorbed lane
+  void squeeze_block(uint8_t* const* const outs)
+  {
+    for (size_t j = 0; j < lanes; j++) {
+      if constexpr (std::endian::native == std::endian::little) {
+        for (size_t w = 0; w < rwords; w++) {
+          std::memcpy(outs[j] + (w << 3), &state[w * L + j], sizeof(uint64_t));
+        }
+      } else {
+        for (size_t i = 0; i < rbytes; i++) {
+          outs[j][i] = static_cast<uint8_t>(state[(i >> 3) * L + j] >> ((i & 7ul) << 3));
+        }
+      }
+    }
+    keccak::permute_multi(state, L);
+  }
+};
+
+namespace detail {
+
+template<const size_t L>
+inline void
+shake256_many(const uint8_t* const* const msgs,
+              const size_t* const mlens,
+              uint8_t* const* const digs,
+              const size_t dlen,
+              const size_t* const order,
+              const size_t count)
+{
+  constexpr size_t rbytes = rate >> 3;
+
+  const uint8_t* group_msgs[L];
+  size_t group_mlens[L];
+  uint8_t blocks[L][rbytes];
+  uint8_t* outs[L];
+  for (size_t j = 0; j < L; j++) {
+    outs[j] = blocks[j];
+  }
+
+  for (size_t g = 0; g < count; g += L) {
+    const size_t n = std::min(L, count - g);
+    for (size_t j = 0; j < n; j++) {
+      group_msgs[j] = msgs[order[g + j]];
+      group_mlens[j] = mlens[order[g + j]];
+    }
+
+    shake256_multi<L> hasher;
+    hasher.hash(nullptr, nullptr, group_msgs, group_mlens, n);
+
+    for (size_t off = 0; off < dlen; off += rbytes) {
+      hasher.squeeze_block(outs);
+      const size_t len = std::min(rbytes, dlen - off);
+      for (size_t j = 0; j < n; j++) {
+        std::memcpy(digs[order[g + j]] + off, blocks[j], len);
+      }
+    }
+  }
+}
+
+}
+
+// Computes dlen bytes of SHAKE256 output for each of `count` independent
+// messages, msgs[i] of mlens[i] bytes into digs[i], several at a time on the
+// widest Keccak kernel this CPU has. Same output as hashing them one by one.
+inline void
+shake256_many(const uint8_t* const* const msgs,
+              const size_t* const mlens,
+              uint8_t* const* const digs,
+              const size_t dlen,
+              const size_t count)
+{
+  const size_t lanes = keccak::multi_lanes();
+  if (lanes == 1 || count < 2) {
+    for (size_t i = 0; i < count; i++) {
+      shake256<false> hasher;
+      hasher.hash(msgs[i], mlens[i]);
+      hasher.read(digs[i], dlen);
+    }
+    return;
+  }
+
+  // Messages of similar length share a group, so lanes rarely sit idle
+  std::vector<size_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+    return mlens[a] / (rate >> 3) < mlens[b] / (rate >> 3);
+  });
+
+  if (lanes >= 8) {
+    detail::shake256_many<8>(msgs, mlens, digs, dlen, order.data(), count);
+  } else {
+    detail::shake256_many<4>(msgs, mlens, digs, dlen, order.data(), count);
+  }
+}
+
 }
@@ -0,0 +1,399 @@
+#pragma once
+#include "ff.hpp"
+#include "utils/CpuFeatures.hpp"
+#include <atomic>
+#include <complex>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FALCON_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+// AVX2 kernels for the NTT over Z_q, the complex FFT and pointwise
+// multiplication, chosen at runtime when the CPU has AVX2. The scalar
+// routines in ntt.hpp, fft.hpp and polynomial.hpp stay as the fallback and
+// keep handling the short butterfly layers that do not fill a vector.
+//
+// Every kernel produces exactly what the scalar code does: Z_q results are
+// canonical, and complex products use the same multiply and add order
+// without fused multiply-add, so outputs match bit for bit.
+namespace simd {
+
+// Montgomery arithmetic over Z_q with R = 2^16, on signed 16-bit lanes
+constexpr int32_t MONT_R = (1 << 16) % ff::Q;
+constexpr int32_t MONT_R2 = static_cast<int32_t>((static_cast<int64_t>(MONT_R) * MONT_R) % ff::Q);
+
+// q^-1 mod 2^16, by Newton iteration
+consteval uint16_t
+compute_qinv()
+{
+  uint32_t x = ff::Q;
+  for (int i = 0; i < 4; i++) {
+    x = x * (2u - ff::Q * x);
+  }
+  return static_cast<uint16_t>(x);
+}
+
+constexpr uint16_t QINV = compute_qinv();
+static_assert(static_cast<uint16_t>(QINV * ff::Q) == 1);
+
+// Twiddle factor w as (w * R mod q, (w * R mod q) * q^-1 mod 2^16)
+struct MontTwiddle
+{
+  uint16_t w;
+  uint16_t w_qinv;
+};
+
+constexpr MontTwiddle
+to_montgomery(const ff::ff_t w)
+{
+  const auto m = static_cast<uint16_t>((static_cast<uint32_t>(w.v) * MONT_R) % ff::Q);
+  return { m, static_cast<uint16_t>(m * QINV) };
+}
+
+template<const size_t N>
+constexpr std::array<MontTwiddle, N>
+to_montgomery(const std::array<ff::ff_t, N>& ws)
+{
+  std::array<MontTwiddle, N> res{};
+  for (size_t i = 0; i < N; i++) {
+    res[i] = to_montgomery(ws[i]);
+  }
+  return res;
+}
+
+// Lanes per vector: 16 Z_q elements, 2 complex numbers
+constexpr size_t ZQ_LANES = 16;
+constexpr size_t CMPLX_LANES = 2;
+
+inline bool
+has_avx2()
+{
+#if FALCON_SIMD_AVX2
+  static const bool avx2 = quids::utils::useFeature("falcon.ntt", quids::utils::CpuFeature::Avx2);
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+// Cleared to run, benchmark or cross-check the scalar path
+inline std::atomic<bool> enabled{ true };
+
+inline bool
+use_avx2()
+{
+  return has_avx2() && enabled.load(std::memory_order_relaxed);
+}
+
+#if FALCON_SIMD_AVX2
+
+static_assert(sizeof(ff::ff_t) == sizeof(uint16_t));
+static_assert(sizeof(std::complex<double>) == 2 * sizeof(double));
+
+namespace avx2 {
+
+// x * w for a twiddle in Montgomery form, canonical
+__attribute__((target("avx2"))) inline __m256i
+mul_twiddle(const __m256i x, const __m256i w, const __m256i w_qinv)
+{
+  const __m256i q = _mm256_set1_epi16(static_cast<int16_t>(ff::Q));
+  const __m256i hi = _mm256_mulhi_epi16(x, w);
+  const __m256i t = _mm256_mullo_epi16(x, w_qinv);
+  const __m256i r = _mm256_sub_epi16(hi, _mm256_mulhi_epi16(t, q));
+  // r in (-q, q); fold negatives up
+  return _mm256_add_epi16(r, _mm256_and_si256(_mm256_srai_epi16(r, 15), q));
+}
+
+// Canonical a + b and a - b for canonical inputs
+__attribute__((target("avx2"))) inline __m256i
+add_mod(const __m256i a, const __m256i b)
+{
+  const __m256i q = _mm256_set1_epi16(static_cast<int16_t>(ff::Q));
+  const __m256i s = _mm256_add_epi16(a, b);
+  return _mm256_min_epu16(s, _mm256_sub_epi16(s, q));
+}
+
+__attribute__((target("avx2"))) inline __m256i
+sub_mod(const __m256i a, const __m256i b)
+{
+  const __m256i q = _mm256_set1_epi16(static_cast<int16_t>(ff::Q));
+  const __m256i d = _mm256_add_epi16(_mm256_sub_epi16(a, b), q);
+  return _mm256_min_epu16(d, _mm256_sub_epi16(d, q));
+}
+
+// One Cooley-Tukey layer with butterflies len >= ZQ_LANES apart
+__attribute__((target("avx2"))) inline void
+ntt_layer(uint16_t* const poly, const size_t n, const size_t len, const size_t k_beg, const MontTwiddle* const ws)
+{
+  const size_t lenx2 = len << 1;
+  for (size_t start = 0, k = k_beg; start < n; start += lenx2, k++) {
+    const __m256i w = _mm256_set1_epi16(static_cast<int16_t>(ws[k].w));
+    const __m256i w_qinv = _mm256_set1_epi16(static_cast<int16_t>(ws[k].w_qinv));
+    for (size_t i = start; i < start + len; i += ZQ_LANES) {
+      auto* const lo_ptr = reinterpret_cast<__m256i*>(poly + i);
+      auto* const hi_ptr = reinterpret_cast<__m256i*>(poly + i + len);
+      const __m256i lo = _mm256_loadu_si256(lo_ptr);
+      const __m256i tmp = mul_twiddle(_mm256_loadu_si256(hi_ptr), w, w_qinv);
+      _mm256_storeu_si256(hi_ptr, sub_mod(lo, tmp));
+      _mm256_storeu_si256(lo_ptr, add_mod(lo, tmp));
+    }
+  }
+}
+
+// One Gentleman-Sande layer, twiddles taken in descending order from k_beg
+__attribute__((target("avx2"))) inline void
+intt_layer(uint16_t* const poly, const size_t n, const size_t len, const size_t k_beg, const MontTwiddle* const ws)
+{
+  const size_t lenx2 = len << 1;
+  for (size_t start = 0, k = k_beg; start < n; start += lenx2, k--) {
+    const __m256i w = _mm256_set1_epi16(static_cast<int16_t>(ws[k].w));
+    const __m256i w_qinv = _mm256_set1_epi16(static_cast<int16_t>(ws[k].w_qinv));
+    for (size_t i = start; i < start + len; i += ZQ_LANES) {
+      auto* const lo_ptr = reinterpret_cast<__m256i*>(poly + i);
+      auto* const hi_ptr = reinterpret_cast<__m256i*>(poly + i + len);
+      const __m256i lo = _mm256_loadu_si256(lo_ptr);
+      const __m256i hi = _mm256_loadu_si256(hi_ptr);
+      _mm256_storeu_si256(lo_ptr, add_mod(lo, hi));
+      _mm256_storeu_si256(hi_ptr, mul_twiddle(sub_mod(lo, hi), w, w_qinv));
+    }
+  }
+}
+
+// poly[i] *= c for all i, n a multiple of ZQ_LANES
+__attribute__((target("avx2"))) inline void
+scale(uint16_t* const poly, const size_t n, const MontTwiddle c)
+{
+  const __m256i w = _mm256_set1_epi16(static_cast<int16_t>(c.w));
+  const __m256i w_qinv = _mm256_set1_epi16(static_cast<int16_t>(c.w_qinv));
+  for (size_t i = 0; i < n; i += ZQ_LANES) {
+    auto* const ptr = reinterpret_cast<__m256i*>(poly + i);
+    _mm256_storeu_si256(ptr, mul_twiddle(_mm256_loadu_si256(ptr), w, w_qinv));
+  }
+}
+
+// c[i] = a[i] * b[i], n a multiple of ZQ_LANES
+__attribute__((target("avx2"))) inline void
+mul(const uint16_t* const a, const uint16_t* const b, uint16_t* const c, const size_t n)
+{
+  const __m256i q = _mm256_set1_epi16(static_cast<int16_t>(ff::Q));
+  const __m256i qinv = _mm256_set1_epi16(static_cast<int16_t>(QINV));
+  constexpr MontTwiddle r2 = { static_cast<uint16_t>(MONT_R2),
+                               static_cast<uint16_t>(static_cast<uint16_t>(MONT_R2) * QINV) };
+  const __m256i w = _mm256_set1_epi16(static_cast<int16_t>(r2.w));
+  const __m256i w_qinv = _mm256_set1_epi16(static_cast<int16_t>(r2.w_qinv));
+
+  for (size_t i = 0; i < n; i += ZQ_LANES) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    // x * y / R in (-q, q), then * R^2 / R brings it back to x * y
+    const __m256i t = _mm256_mullo_epi16(_mm256_mullo_epi16(x, y), qinv);
+    const __m256i r = _mm256_sub_epi16(_mm256_mulhi_epi16(x, y), _mm256_mulhi_epi16(t, q));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + i), mul_twiddle(r, w, w_qinv));
+  }
+}
+
+// Two complex products x * z with z broadcast, as the scalar code computes them
+__attribute__((target("avx2"))) inline __m256d
+cmul(const __m256d x, const __m256d z_re, const __m256d z_im)
+{
+  const __m256d t = _mm256_mul_pd(x, z_re);
+  const __m256d u = _mm256_mul_pd(_mm256_permute_pd(x, 0b0101), z_im);
+  return _mm256_addsub_pd(t, u);
+}
+
+// One FFT layer with butterflies len >= CMPLX_LANES apart
+__attribute__((target("avx2"))) inline void
+fft_layer(std::complex<double>* const vec,
+          const size_t n,
+          const size_t len,
+          const size_t k_beg,
+          const std::complex<double>* const ws)
+{
+  auto* const d = reinterpret_cast<double*>(vec);
+  const size_t lenx2 = len << 1;
+  for (size_t start = 0, k = k_beg; start < n; start += lenx2, k++) {
+    const __m256d z_re = _mm256_set1_pd(ws[k].real());
+    const __m256d z_im = _mm256_set1_pd(ws[k].imag());
+    for (size_t i = start; i < start + len; i += CMPLX_LANES) {
+      const __m256d lo = _mm256_loadu_pd(d + 2 * i);
+      const __m256d tmp = cmul(_mm256_loadu_pd(d + 2 * (i + len)), z_re, z_im);
+      _mm256_storeu_pd(d + 2 * (i + len), _mm256_sub_pd(lo, tmp));
+      _mm256_storeu_pd(d + 2 * i, _mm256_add_pd(lo, tmp));
+    }
+  }
+}
+
+// One inverse FFT layer; twiddles are negated and taken in descending order
+__attribute__((target("avx2"))) inline void
+ifft_layer(std::complex<double>* const vec,
+           const size_t n,
+           const size_t len,
+           const size_t k_beg,
+           const std::complex<double>* const ws)
+{
+  auto* const d = reinterpret_cast<double*>(vec);
+  const size_t lenx2 = len << 1;
+  for (size_t start = 0, k = k_beg; start < n; start += lenx2, k--) {
+    const __m256d z_re = _mm256_set1_pd(-ws[k].real());
+    const __m256d z_im = _mm256_set1_pd(-ws[k].imag());
+    for (size_t i = start; i < start + len; i += CMPLX_LANES) {
+      const __m256d lo = _mm256_loadu_pd(d + 2 * i);
+      const __m256d hi = _mm256_loadu_pd(d + 2 * (i + len));
+      _mm256_storeu_pd(d + 2 * i, _mm256_add_pd(lo, hi));
+      _mm256_storeu_pd(d + 2 * (i + len), cmul(_mm256_sub_pd(lo, hi), z_re, z_im));
+    }
+  }
+}
+
+// vec[i] *= s, n a multiple of CMPLX_LANES
+__attribute__((target("avx2"))) inline void
+scale(std::complex<double>* const vec, const size_t n, const double s)
+{
+  auto* const d = reinterpret_cast<double*>(vec);
+  const __m256d sv = _mm256_set1_pd(s);
+  for (size_t i = 0; i < 2 * n; i += 2 * CMPLX_LANES) {
+    _mm256_storeu_pd(d + i, _mm256_mul_pd(_mm256_loadu_pd(d + i), sv));
+  }
+}
+
+// c[i] = a[i] * b[i] over C, n a multiple of CMPLX_LANES
+__attribute__((target("avx2"))) inline void
+mul(const std::complex<double>* const a,
+    const std::complex<double>* const b,
+    std::complex<double>* const c,
+    const size_t n)
+{
+  const auto* const da = reinterpret_cast<const double*>(a);
+  const auto* const db = reinterpret_cast<const double*>(b);
+  auto* const dc = reinterpret_cast<double*>(c);
+  for (size_t i = 0; i < 2 * n; i += 2 * CMPLX_LANES) {
+    const __m256d x = _mm256_loadu_pd(da + i);
+    const __m256d y = _mm256_loadu_pd(db + i);
+    // (xr, xi) * (yr, yi) = (xr*yr - xi*yi, xr*yi + xi*yr)
+    const __m256d x_re = _mm256_movedup_pd(x);
+    const __m256d x_im = _mm256_permute_pd(x, 0b1111);
+    const __m256d t = _mm256_mul_pd(x_re, y);
+    const __m256d u = _mm256_mul_pd(x_im, _mm256_permute_pd(y, 0b0101));
+    _mm256_storeu_pd(dc + i, _mm256_addsub_pd(t, u));
+  }
+}
+
+} // namespace avx2
+
+#endif
+
+// Dispatchers: each runs the vector kernel and returns true when the CPU and
+// the layer size allow it, otherwise returns false for the scalar loop to run
+
+inline bool
+ntt_layer(ff::ff_t* const poly, const size_t n, const size_t len, const size_t k_beg, const MontTwiddle* const ws)
+{
+#if FALCON_SIMD_AVX2
+  if (len >= ZQ_LANES && use_avx2()) {
+    avx2::ntt_layer(reinterpret_cast<uint16_t*>(poly), n, len, k_beg, ws);
+    return true;
+  }
+#endif
+  return false;
+}
+
+inline bool
+intt_layer(ff::ff_t* const poly, const size_t n, const size_t len, const size_t k_beg, const MontTwiddle* const ws)
+{
+#if FALCON_SIMD_AVX2
+  if (len >= ZQ_LANES && use_avx2()) {
+    avx2::intt_layer(reinterpret_cast<uint16_t*>(poly), n, len, k_beg, ws);
+    return true;
+  }
+#endif
+  return false;
+}
+
+inline bool
+scale(ff::ff_t* const poly, const size_t n, const ff::ff_t c)
+{
+#if FALCON_SIMD_AVX2
+  if (n % ZQ_LANES == 0 && use_avx2()) {
+    avx2::scale(reinterpret_cast<uint16_t*>(poly), n, to_montgomery(c));
+    return true;
+  }
+#endif
+  return false;
+}
+
+inline bool
+mul(const ff::ff_t* const a, const ff::ff_t* const b, ff::ff_t* const c, const size_t n)
+{
+#if FALCON_SIMD_AVX2
+  if (n % ZQ_LANES == 0 && use_avx2()) {
+    avx2::mul(reinterpret_cast<const uint16_t*>(a),
+              reinterpret_cast<const uint16_t*>(b),
+              reinterpret_cast<uint16_t*>(c),
+              n);
+    return true;
+  }
+#endif
+  return false;
+}
+
+inline bool
+fft_layer(std::complex<double>* const vec,
+          const size_t n,
+          const size_t len,
+          const size_t k_beg,
+          const std::complex<double>* const ws)
+{
+#if FALCON_SIMD_AVX2
+  if (len >= CMPLX_LANES && use_avx2()) {
+    avx2::fft_layer(vec, n, len, k_beg, ws);
+    return true;
+  }
+#endif
+  return false;
+}
+
+inline bool
+ifft_layer(std::complex<double>* const vec,
+           const size_t n,
+           const size_t len,
+           const size_t k_beg,
+           const std::complex<double>* const ws)
+{
+#if FALCON_SIMD_AVX2
+  if (len >= CMPLX_LANES && use_avx2()) {
+    avx2::ifft_layer(vec, n, len, k_beg, ws);
+    return true;
+  }
+#endif
+  return false;
+}
+
+inline bool
+scale(std::complex<double>* const vec, const size_t n, const double s)
+{
+#if FALCON_SIMD_AVX2
+  if (n % CMPLX_LANES == 0 && use_avx2()) {
+    avx2::scale(vec, n, s);
+    return true;
+  }
+#endif
+  return false;
+}
+
+inline bool
+mul(const std::complex<double>* const a,
+    const std::complex<double>* const b,
+    std::complex<double>* const c,
+    const size_t n)
+{
+#if FALCON_SIMD_AVX2
+  if (n % CMPLX_LANES == 0 && use_avx2()) {
+    avx2::mul(a, b, c, n);
+    return true;
+  }
+#endif
+  return false;
+}
+
+}
@@ -17,12 +17,15 @@ namespace verification {
 //
 // This routine returns boolean truth value in case of successful signature
 // verification, otherwise it returns false.
+//
+// This variant takes h already in NTT form, so that a caller verifying many
+// signatures under the same public key transforms it only once.
 template<const size_t N, const int32_t β2>
 static inline bool
-verify(const ff::ff_t* const __restrict h,
-       const uint8_t* const __restrict msg,
-       const size_t mlen,
-       const uint8_t* const __restrict sig)
+verify_ntt(const ff::ff_t* const __restrict h_ntt,
+           const uint8_t* const __restrict msg,
+           const size_t mlen,
+           const uint8_t* const __restrict sig)
   requires((N == 512) || (N == 1024))
 {
   uint8_t salt[40];
@@ -41,16 +44,12 @@ verify(const ff::ff_t* const __restrict h,
   ff::ff_t c[N];
   hashing::hash_to_point<N>(salt, sizeof(salt), msg, mlen, c);
 
-  ff::ff_t h_[N];
-  std::memcpy(h_, h, sizeof(h_));
-
   ntt::ntt<log2<N>()>(c);
   ntt::ntt<log2<N>()>(s2_ntt);
-  ntt::ntt<log2<N>()>(h_);
 
   ff::ff_t s1[N];
 
-  polynomial::mul<log2<N>()>(s2_ntt, h_, s1); // s1 <- s2 * h ( mod q ) [NTT]
+  polynomial::mul<log2<N>()>(s2_ntt, h_ntt, s1); // s1 <- s2 * h ( mod q ) [NTT]
   polynomial::neg<log2<N>()>(s1);             // s1 <- -s1 ( mod q ) [NTT]
   polynomial::add_to<log2<N>()>(s1, c);       // s1 <- s1 + c ( mod q ) [NTT]
 
@@ -67,16 +66,34 @@ verify(const ff::ff_t* const __restrict h,
     normalized_s1[i] = t0 - t1;
   }
 
-  int32_t sqrd_norm = 0;
+  // 64-bit: for a forged s2 the sum of squares overflows int32 and could
+  // wrap back under the bound
+  int64_t sqrd_norm = 0;
 
   for (size_t i = 0; i < N; i++) {
-    sqrd_norm += s2[i] * s2[i];
+    sqrd_norm += static_cast<int64_t>(s2[i]) * s2[i];
   }
   for (size_t i = 0; i < N; i++) {
-    sqrd_norm += normalized_s1[i] * normalized_s1[i];
+    sqrd_norm += static_cast<int64_t>(normalized_s1[i]) * normalized_s1[i];
   }
 
   return sqrd_norm <= β2;
 }
 
+// Same as verify_ntt, with the public key h in coefficient form
+template<const size_t N, const int32_t β2>
+static inline bool
+verify(const ff::ff_t* const __restrict h,
+       const uint8_t* const __restrict msg,
+       const size_t mlen,
+       const uint8_t* const __restrict sig)
+  requires((N == 512) || (N == 1024))
+{
+  ff::ff_t h_ntt[N];
+  std::memcpy(h_ntt, h, sizeof(h_ntt));
+  ntt::ntt<log2<N>()>(h_ntt);
+
+  return verify_ntt<N, β2>(h_ntt, msg, mlen, sig);
+}
+
 }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "crypto/QuantumHashFunction.hpp"
 #include <vector>
 #include <cstdint>
+#include <span>
 #include <string>
 #include <memory>
 
@@ -10,6 +12,8 @@ namespace crypto {
 
 class QuantumResistantHash {
 public:
+    using Digest = QuantumHashFunction::Digest;
+
     QuantumResistantHash();
     ~QuantumResistantHash();
 
@@ -22,6 +26,15 @@ public:
     // Primary hash function - returns 256-bit hash
     std::vector<uint8_t> hash(const std::vector<uint8_t>& data);
 
+    // Same digests as hash(), both passes run through the multi-lane
+    // kernels; out.size() must equal messages.size()
+    static void hashMany(std::span<const std::span<const uint8_t>> messages, std::span<Digest> out);
+
+    // Streaming: the message is never buffered, only the hash state;
+    // finalize() starts over
+    void update(std::span<const uint8_t> data);
+    Digest finalize();
+
     // Get estimated security level in bits
     double getSecurityLevel() const;
 
@@ -34,4 +47,4 @@ private:
 };
 
 } // namespace crypto
-} // namespace quids
\ No newline at end of file
+} // namespace quids
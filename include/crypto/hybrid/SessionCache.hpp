@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+
+// Session resumption for peer handshakes.
+//
+// After a full hybrid KEM handshake both sides store the shared secret under
+// the peer's id. A reconnect then derives its key from the cached resumption
+// secret and fresh handshake nonces instead of running the KEM again. Tickets
+// expire after a lifetime and a number of resumptions, after which callers
+// fall back to a full handshake. The raw shared secret is never kept.
+class SessionCache {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Derived from the shared secret, so both sides agree on it unprompted
+    using TicketId = std::array<uint8_t, 16>;
+
+    struct Config {
+        Clock::duration ticket_lifetime{std::chrono::hours(1)};
+        uint32_t max_resumptions{256};
+        size_t capacity{4096};  // peers; the oldest ticket goes first
+    };
+
+    struct Stats {
+        uint64_t stored{0};
+        uint64_t resumed{0};
+        uint64_t misses{0};  // no ticket, or expired or used up
+    };
+
+    SessionCache();
+    explicit SessionCache(Config config);
+    ~SessionCache();
+
+    SessionCache(const SessionCache&) = delete;
+    SessionCache& operator=(const SessionCache&) = delete;
+
+    [[nodiscard]] static SessionCache& global();
+
+    // Records a full handshake with peer_id, replacing any earlier ticket
+    TicketId store(const std::string& peer_id, std::span<const uint8_t> shared_secret);
+
+    // Key for a resumed connection. nonce must be fresh per connection and
+    // identical on both sides, e.g. both peers' hello nonces concatenated.
+    // nullopt when the caller has to run a full handshake instead.
+    [[nodiscard]] std::optional<std::vector<uint8_t>> resume(const std::string& peer_id,
+                                                             std::span<const uint8_t> nonce,
+                                                             size_t key_length = 32);
+
+    [[nodiscard]] std::optional<TicketId> ticket(const std::string& peer_id) const;
+    void invalidate(const std::string& peer_id);
+    void clear();
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] Stats stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace crypto
+} // namespace quids
@@ -30,12 +30,20 @@ public:
     KyberKEM(KyberKEM&&) = delete;
     KyberKEM& operator=(KyberKEM&&) = delete;
 
-    // Key generation
+    // Key generation; hands out a pre-generated pair from the shared pool
     KyberKeyPair generateKeyPair();
+    // Pairs kept ready for generateKeyPair(); 0 generates every pair on
+    // demand. See KeyPairPool.
+    static void setKeyPoolDepth(size_t depth);
 
     // Encapsulation: Generate shared secret and ciphertext
     KyberCiphertext encapsulate(const std::vector<uint8_t>& public_key);
 
+    // One encapsulation per entry, for handshaking with many peers at once.
+    // Each distinct key is parsed (and its matrix expanded) once, and distinct
+    // keys are encapsulated in parallel. Results are in input order.
+    std::vector<KyberCiphertext> encapsulate_many(const std::vector<std::vector<uint8_t>>& public_keys);
+
     // Decapsulation: Recover shared secret from ciphertext
     std::vector<uint8_t> decapsulate(const std::vector<uint8_t>& ciphertext,
                                    const std::vector<uint8_t>& private_key);
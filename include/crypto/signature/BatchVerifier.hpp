@@ -0,0 +1,111 @@
+#pragma once
+
+#include "utils/WorkStealingPool.hpp"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+
+enum class SignatureScheme : uint8_t {
+    Falcon512,
+    Falcon1024,
+    Dilithium,
+    SphincsPlus
+};
+
+constexpr size_t NUM_SIGNATURE_SCHEMES = 4;
+
+// A public key decoded into the form its scheme verifies against
+struct PreparedKey {
+    virtual ~PreparedKey() = default;
+};
+
+// One scheme's verification, split so that decoding a public key happens
+// once per key rather than once per signature. Both calls must be safe to
+// make concurrently.
+class SchemeVerifier {
+public:
+    virtual ~SchemeVerifier() = default;
+
+    // nullptr when the key does not decode
+    [[nodiscard]] virtual std::shared_ptr<const PreparedKey> prepare(std::span<const uint8_t> public_key) const = 0;
+    [[nodiscard]] virtual bool verify(const PreparedKey& key,
+                                      std::span<const uint8_t> message,
+                                      std::span<const uint8_t> signature) const = 0;
+};
+
+// Falcon-512 or Falcon-1024; keeps h in NTT form
+[[nodiscard]] std::unique_ptr<SchemeVerifier> makeFalconVerifier(size_t n);
+
+struct VerifyItem {
+    SignatureScheme scheme;
+    std::span<const uint8_t> message;
+    std::span<const uint8_t> signature;
+    std::span<const uint8_t> public_key;
+};
+
+// Verifies many signatures at once on the shared pool.
+//
+// Items are grouped by (scheme, public key). Each distinct key is decoded
+// once, or taken from a bounded cache of recently used keys, and then the
+// signatures are checked in parallel with items under the same key kept
+// together. Falcon is built in; Dilithium and SPHINCS+ are added with
+// register_scheme(DilithiumSigner::batchVerifier()) and the like wherever
+// their backend is linked.
+class BatchVerifier {
+public:
+    static constexpr size_t DEFAULT_KEY_CACHE_CAPACITY = 4096;
+
+    struct Stats {
+        uint64_t signatures{0};
+        uint64_t keys_decoded{0};
+        uint64_t key_cache_hits{0};
+    };
+
+    explicit BatchVerifier(utils::WorkStealingPool& pool = utils::WorkStealingPool::global(),
+                           size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY);
+    ~BatchVerifier();
+
+    BatchVerifier(const BatchVerifier&) = delete;
+    BatchVerifier& operator=(const BatchVerifier&) = delete;
+
+    [[nodiscard]] static BatchVerifier& global();
+
+    // Replaces any verifier already registered for the scheme
+    void register_scheme(SignatureScheme scheme, std::unique_ptr<SchemeVerifier> verifier);
+    [[nodiscard]] bool has_scheme(SignatureScheme scheme) const;
+
+    // One entry per item, 1 when the signature is valid. Items of an
+    // unregistered scheme or with a key that does not decode get 0.
+    [[nodiscard]] std::vector<uint8_t> verify(std::span<const VerifyItem> items);
+
+    // Runs verified() on each transaction in parallel, which also warms
+    // their memos and the node-wide SignatureCache for later checks. Tx
+    // is a transaction or a pointer to one.
+    template<typename Tx>
+    std::vector<uint8_t> verify_transactions(std::span<const Tx> txs) {
+        std::vector<uint8_t> result(txs.size(), 0);
+        pool_.parallel_for(0, txs.size(), [&](size_t i) {
+            if constexpr (requires { txs[i]->verified(); }) {
+                result[i] = txs[i] && txs[i]->verified() ? 1 : 0;
+            } else {
+                result[i] = txs[i].verified() ? 1 : 0;
+            }
+        });
+        return result;
+    }
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    struct Impl;
+
+    utils::WorkStealingPool& pool_;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace crypto
+} // namespace quids
@@ -7,6 +7,8 @@
 namespace quids {
 namespace crypto {
 
+class SchemeVerifier;
+
 class DilithiumSigner {
 public:
     DilithiumSigner();
@@ -18,8 +20,11 @@ public:
     DilithiumSigner(DilithiumSigner&&) = delete;
     DilithiumSigner& operator=(DilithiumSigner&&) = delete;
 
-    // Key generation
+    // Key generation; draws a pre-generated key from the shared pool
     void generateKeyPair();
+    // Keys kept ready for generateKeyPair(); 0 generates every key on
+    // demand. See KeyPairPool.
+    static void setKeyPoolDepth(size_t depth);
     
     // Get public/private keys
     std::vector<uint8_t> getPublicKey() const;
@@ -35,6 +40,9 @@ public:
                const std::vector<uint8_t>& signature,
                const std::vector<uint8_t>& public_key);
 
+    // For BatchVerifier::register_scheme; decodes each public key once
+    [[nodiscard]] static std::unique_ptr<SchemeVerifier> batchVerifier();
+
     // Get parameters and info
     size_t getSignatureSize() const;
     size_t getPublicKeySize() const;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <memory>
 #include <cstdint>
@@ -8,6 +9,81 @@
 namespace quids {
 namespace crypto {
 
+struct PreparedKey;
+
+// A Falcon-512 public key decoded once into the NTT form that verification
+// works on, so checks against a hot key skip decoding and the transform
+class PreparedPublicKey {
+public:
+    using Fingerprint = std::array<uint8_t, 32>;  // BLAKE3 of the encoded key
+
+    // nullptr when the key does not decode
+    [[nodiscard]] static std::shared_ptr<const PreparedPublicKey> prepare(const std::vector<uint8_t>& public_key);
+    [[nodiscard]] static Fingerprint fingerprint(const std::vector<uint8_t>& public_key);
+
+    [[nodiscard]] const Fingerprint& getFingerprint() const { return fingerprint_; }
+
+private:
+    friend class FalconSigner;
+
+    Fingerprint fingerprint_{};
+    std::shared_ptr<const PreparedKey> key_;
+};
+
+// Bounded LRU of prepared keys, keyed by fingerprint. Sized for the set of
+// witness and validator keys a node checks over and over.
+class PreparedKeyCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    struct Stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+    };
+
+    explicit PreparedKeyCache(size_t capacity = DEFAULT_CAPACITY);
+    ~PreparedKeyCache();
+
+    PreparedKeyCache(const PreparedKeyCache&) = delete;
+    PreparedKeyCache& operator=(const PreparedKeyCache&) = delete;
+
+    [[nodiscard]] static PreparedKeyCache& global();
+
+    // Prepares and caches the key on a miss; nullptr when it does not decode
+    [[nodiscard]] std::shared_ptr<const PreparedPublicKey> get(const std::vector<uint8_t>& public_key);
+
+    void clear();
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] Stats stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+// A Falcon-512 private key expanded once into the basis B = [[g, -f],
+// [G, -F]] and the LDL tree that ffSampling walks, so signing skips
+// recomputing G and the tree per signature. sign() is safe to call from
+// many threads; each thread draws from its own PRNG.
+class SigningKey {
+public:
+    // nullptr when the key does not decode
+    [[nodiscard]] static std::shared_ptr<const SigningKey> load(const std::vector<uint8_t>& private_key);
+
+    ~SigningKey();
+    SigningKey(const SigningKey&) = delete;
+    SigningKey& operator=(const SigningKey&) = delete;
+
+    [[nodiscard]] std::vector<uint8_t> sign(const std::vector<uint8_t>& message) const;
+
+private:
+    struct Expanded;
+
+    SigningKey();
+
+    std::unique_ptr<Expanded> expanded_;
+};
+
 class FalconSigner {
 public:
     FalconSigner();
@@ -19,8 +95,11 @@ public:
     FalconSigner(FalconSigner&&) = delete;
     FalconSigner& operator=(FalconSigner&&) = delete;
 
-    // Key generation
+    // Key generation; draws a pre-generated pair from the shared pool
     void generateKeyPair();
+    // Pairs kept ready for generateKeyPair(); 0 generates every pair on
+    // demand. See KeyPairPool.
+    static void setKeyPoolDepth(size_t depth);
     
     // Get public/private keys
     std::vector<uint8_t> getPublicKey() const;
@@ -28,11 +107,16 @@ public:
 
     // Sign a message
     std::vector<uint8_t> sign(const std::vector<uint8_t>& message);
+    // The expanded key sign() uses, to share across signing threads
+    std::shared_ptr<const SigningKey> getSigningKey() const;
 
-    // Verify a signature
+    // Verify a signature; the key is looked up in PreparedKeyCache::global()
     bool verify(const std::vector<uint8_t>& message,
                const std::vector<uint8_t>& signature,
                const std::vector<uint8_t>& public_key);
+    bool verify(const std::vector<uint8_t>& message,
+               const std::vector<uint8_t>& signature,
+               const PreparedPublicKey& public_key);
 
     // Parameters and info
     size_t getSignatureSize() const;
@@ -47,4 +131,4 @@ private:
 };
 
 } // namespace crypto
-} // namespace quids
\ No newline at end of file
+} // namespace quids
@@ -8,6 +8,8 @@
 namespace quids {
 namespace crypto {
 
+class SchemeVerifier;
+
 class SphincsPlus {
 public:
     SphincsPlus();
@@ -34,6 +36,9 @@ public:
                const std::vector<uint8_t>& signature,
                const std::vector<uint8_t>& public_key);
 
+    // For BatchVerifier::register_scheme; decodes each public key once
+    [[nodiscard]] static std::unique_ptr<SchemeVerifier> batchVerifier();
+
     // Parameters and info
     size_t getSignatureSize() const;
     size_t getPublicKeySize() const;
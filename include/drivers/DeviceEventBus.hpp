@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "utils/WorkStealingPool.hpp"
+
+namespace drivers {
+
+// Interned event type; ids are dense and start at 0 for each bus
+using EventTypeId = uint32_t;
+
+struct DeviceEvent {
+    EventTypeId type{0};
+    std::string device_id;
+    std::vector<uint8_t> data;
+};
+
+// Device events from drivers to their consumers.
+//
+// Event types are interned once, so emitting an event indexes a vector
+// rather than hashing a string. Each subscriber has its own bounded queue:
+// publish() appends under that queue's lock and never blocks on a handler,
+// and an event that finds the queue full is dropped and counted. While a
+// subscriber has events queued, one task on the shared pool drains them in
+// batches of up to max_batch, so a burst costs one pool post per batch
+// instead of one handler call per event on the producer thread.
+//
+// Events reach a subscriber in the order they were published to it, and a
+// subscriber's handler never runs concurrently with itself. Once
+// unsubscribe() returns the handler will not be called again, except that
+// a handler may unsubscribe itself from inside its own batch.
+class DeviceEventBus {
+public:
+    using BatchHandler = std::function<void(std::span<const DeviceEvent> events)>;
+    using SubscriptionId = uint64_t;
+
+    struct Config {
+        size_t queue_capacity{1024};  // per subscriber, in events
+        size_t max_batch{64};
+        quids::utils::TaskPriority priority{quids::utils::TaskPriority::Execution};
+    };
+
+    struct Stats {
+        uint64_t published{0};
+        uint64_t delivered{0};
+        uint64_t dropped{0};      // queue full
+        uint64_t unrouted{0};     // no subscriber for the type
+        uint64_t batches{0};
+        uint64_t handler_errors{0};
+    };
+
+    explicit DeviceEventBus(const Config& config,
+                            quids::utils::WorkStealingPool& pool = quids::utils::WorkStealingPool::global())
+        : config_(config), pool_(pool), counters_(std::make_shared<Counters>()),
+          routes_(std::make_shared<const Routes>()) {
+        config_.queue_capacity = std::max<size_t>(1, config_.queue_capacity);
+        config_.max_batch = std::max<size_t>(1, config_.max_batch);
+    }
+
+    DeviceEventBus() : DeviceEventBus(Config{}) {}
+
+    // Queued events are discarded; a batch already running finishes first
+    ~DeviceEventBus() {
+        for (const auto& route : *routes_.load(std::memory_order_acquire)) {
+            for (const auto& subscriber : route) {
+                subscriber->close();
+            }
+        }
+    }
+
+    DeviceEventBus(const DeviceEventBus&) = delete;
+    DeviceEventBus& operator=(const DeviceEventBus&) = delete;
+
+    // Same id for the same name; cheap enough for setup, not for every event
+    EventTypeId intern(std::string_view name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = type_ids_.find(std::string(name));
+        if (it != type_ids_.end()) {
+            return it->second;
+        }
+        const auto id = static_cast<EventTypeId>(type_names_.size());
+        type_names_.emplace_back(name);
+        type_ids_.emplace(type_names_.back(), id);
+        return id;
+    }
+
+    [[nodiscard]] std::string typeName(EventTypeId type) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return type < type_names_.size() ? type_names_[type] : std::string();
+    }
+
+    // queue_capacity of 0 takes the bus default
+    SubscriptionId subscribe(EventTypeId type, BatchHandler handler, size_t queue_capacity = 0) {
+        auto subscriber = std::make_shared<Subscriber>(
+            std::move(handler), queue_capacity == 0 ? config_.queue_capacity : queue_capacity, config_.max_batch,
+            config_.priority, pool_, counters_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscriber->id = next_id_++;
+        auto routes = std::make_shared<Routes>(*routes_.load(std::memory_order_acquire));
+        if (routes->size() <= type) {
+            routes->resize(type + 1);
+        }
+        (*routes)[type].push_back(subscriber);
+        routes_.store(std::move(routes), std::memory_order_release);
+        return subscriber->id;
+    }
+
+    // Drops the subscriber's queued events; false if the id is unknown
+    bool unsubscribe(SubscriptionId id) {
+        std::shared_ptr<Subscriber> removed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto routes = std::make_shared<Routes>(*routes_.load(std::memory_order_acquire));
+            for (auto& route : *routes) {
+                auto it = std::find_if(route.begin(), route.end(), [id](const auto& s) { return s->id == id; });
+                if (it != route.end()) {
+                    removed = *it;
+                    route.erase(it);
+                    break;
+                }
+            }
+            if (!removed) {
+                return false;
+            }
+            routes_.store(std::move(routes), std::memory_order_release);
+        }
+        removed->close();
+        return true;
+    }
+
+    // Never blocks on a handler. False if no subscriber took the event,
+    // because there was none or every queue was full.
+    bool publish(DeviceEvent event) {
+        counters_->published.fetch_add(1, std::memory_order_relaxed);
+        const auto routes = routes_.load(std::memory_order_acquire);
+        if (event.type >= routes->size() || (*routes)[event.type].empty()) {
+            counters_->unrouted.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        const auto& route = (*routes)[event.type];
+        bool accepted = false;
+        for (size_t i = 0; i + 1 < route.size(); ++i) {
+            accepted |= route[i]->push(DeviceEvent(event));
+        }
+        accepted |= route.back()->push(std::move(event));
+        return accepted;
+    }
+
+    bool publish(EventTypeId type, std::string device_id, std::vector<uint8_t> data) {
+        return publish(DeviceEvent{type, std::move(device_id), std::move(data)});
+    }
+
+    [[nodiscard]] Stats stats() const noexcept {
+        return Stats{counters_->published.load(std::memory_order_relaxed),
+                     counters_->delivered.load(std::memory_order_relaxed),
+                     counters_->dropped.load(std::memory_order_relaxed),
+                     counters_->unrouted.load(std::memory_order_relaxed),
+                     counters_->batches.load(std::memory_order_relaxed),
+                     counters_->handler_errors.load(std::memory_order_relaxed)};
+    }
+
+private:
+    // Shared with subscribers, whose drain tasks can outlive the bus
+    struct Counters {
+        std::atomic<uint64_t> published{0};
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> unrouted{0};
+        std::atomic<uint64_t> batches{0};
+        std::atomic<uint64_t> handler_errors{0};
+    };
+
+    class Subscriber : public std::enable_shared_from_this<Subscriber> {
+    public:
+        Subscriber(BatchHandler handler, size_t capacity, size_t max_batch, quids::utils::TaskPriority priority,
+                   quids::utils::WorkStealingPool& pool, std::shared_ptr<Counters> counters)
+            : handler_(std::move(handler)), capacity_(capacity), max_batch_(max_batch), priority_(priority),
+              pool_(pool), counters_(std::move(counters)) {}
+
+        SubscriptionId id{0};
+
+        bool push(DeviceEvent&& event) {
+            bool schedule = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (closed_ || queue_.size() >= capacity_) {
+                    counters_->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                queue_.push_back(std::move(event));
+                schedule = !scheduled_;
+                scheduled_ = true;
+            }
+            if (schedule) {
+                post();
+            }
+            return true;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+                queue_.clear();
+            }
+            // Waits out a running batch, unless this is that batch
+            if (running_ != this) {
+                std::lock_guard<std::mutex> run(run_mutex_);
+            }
+        }
+
+    private:
+        void post() {
+            pool_.post(priority_, [self = shared_from_this()] { self->drain(); });
+        }
+
+        // One batch per pool task, so a busy subscriber shares the workers
+        void drain() {
+            std::vector<DeviceEvent> batch;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                const size_t n = std::min(max_batch_, queue_.size());
+                batch.reserve(n);
+                for (size_t i = 0; i < n; ++i) {
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                }
+                if (batch.empty()) {
+                    scheduled_ = false;
+                    return;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> run(run_mutex_);
+                if (!is_closed()) {
+                    running_ = this;
+                    try {
+                        handler_(std::span<const DeviceEvent>(batch));
+                    } catch (...) {
+                        counters_->handler_errors.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    running_ = nullptr;
+                    counters_->delivered.fetch_add(batch.size(), std::memory_order_relaxed);
+                    counters_->batches.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            bool more = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                more = !closed_ && !queue_.empty();
+                scheduled_ = more;
+            }
+            if (more) {
+                post();
+            }
+        }
+
+        bool is_closed() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return closed_;
+        }
+
+        const BatchHandler handler_;
+        const size_t capacity_;
+        const size_t max_batch_;
+        const quids::utils::TaskPriority priority_;
+        quids::utils::WorkStealingPool& pool_;
+        const std::shared_ptr<Counters> counters_;
+
+        std::mutex mutex_;
+        std::deque<DeviceEvent> queue_;
+        bool scheduled_{false};
+        bool closed_{false};
+
+        // Held while the handler runs, so close() can wait for it
+        std::mutex run_mutex_;
+        static inline thread_local const Subscriber* running_ = nullptr;
+    };
+
+    // Subscribers per event type, replaced whole on (un)subscribe
+    using Routes = std::vector<std::vector<std::shared_ptr<Subscriber>>>;
+
+    Config config_;
+    quids::utils::WorkStealingPool& pool_;
+    const std::shared_ptr<Counters> counters_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, EventTypeId> type_ids_;
+    std::vector<std::string> type_names_;
+    SubscriptionId next_id_{1};
+    std::atomic<std::shared_ptr<const Routes>> routes_;
+};
+
+} // namespace drivers
@@ -5,6 +5,7 @@
 #include <memory>
 #include <functional>
 #include <unordered_map>
+#include "drivers/DeviceEventBus.hpp"
 #include "quantum/QuantumCrypto.hpp"
 
 namespace drivers {
@@ -57,13 +58,25 @@ public:
     bool unregisterProtocol(const std::string& protocol_name);
     std::shared_ptr<Protocol> getProtocol(const std::string& protocol_name);
 
-    // Event handling
-    using EventCallback = std::function<void(const std::string& device_id,
-                                           const std::string& event_type,
-                                           const std::vector<uint8_t>& data)>;
-    
-    void registerEventHandler(const std::string& event_type, EventCallback handler);
-    void unregisterEventHandler(const std::string& event_type);
+    // Event handling. Types are interned once at setup; handlers receive
+    // batches on the shared pool, never on the thread that emitted them.
+    EventTypeId eventType(std::string_view event_type) { return events_.intern(event_type); }
+
+    DeviceEventBus::SubscriptionId registerEventHandler(EventTypeId event_type,
+                                                        DeviceEventBus::BatchHandler handler,
+                                                        size_t queue_capacity = 0) {
+        return events_.subscribe(event_type, std::move(handler), queue_capacity);
+    }
+    bool unregisterEventHandler(DeviceEventBus::SubscriptionId subscription) {
+        return events_.unsubscribe(subscription);
+    }
+
+    // For drivers and devices; returns without waiting for any handler
+    bool emitDeviceEvent(EventTypeId event_type, std::string device_id, std::vector<uint8_t> data) {
+        return events_.publish(event_type, std::move(device_id), std::move(data));
+    }
+
+    DeviceEventBus::Stats eventStats() const { return events_.stats(); }
 
     // Status and monitoring
     struct DriverStatus {
@@ -84,9 +97,8 @@ private:
     // Internal helper methods
     bool validateDriver(const std::shared_ptr<Driver>& driver);
     bool validateConnection(const ConnectionInfo& connection);
-    void handleDeviceEvent(const std::string& device_id,
-                          const std::string& event_type,
-                          const std::vector<uint8_t>& data);
+
+    DeviceEventBus events_;
 };
 
 // Base class for all drivers
@@ -1,22 +1,38 @@
 #pragma once
 
 #include <array>
-#include <functional>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
 
 
 namespace evm {
 
+// 20-byte account address. State is keyed by this rather than by hex
+// strings; text goes through from_hex/from_string and to_hex only where an
+// address enters or leaves (APIs, persistence, logs).
 struct Address {
     std::array<uint8_t, 20> bytes;
     
     // Constructors
     Address() = default;
     ~Address() = default;
+
+    // An optional "0x" and up to 40 hex digits, right-aligned; nullopt
+    // for anything else
+    static std::optional<Address> from_hex(std::string_view hex);
+    // from_hex when the text parses, otherwise the low 20 bytes of its
+    // keccak256, so account names that are not hex still get a stable key
+    static Address from_string(std::string_view text);
+    // 40 lowercase hex digits, no prefix
+    std::string to_hex() const;
     
     // Comparison operators
-    bool operator==(const Address& other) const;
-    bool operator<(const Address& other) const;
+    bool operator==(const Address& other) const { return std::memcmp(bytes.data(), other.bytes.data(), 20) == 0; }
+    bool operator<(const Address& other) const { return std::memcmp(bytes.data(), other.bytes.data(), 20) < 0; }
     bool operator!=(const Address& other) const { return !(*this == other); }
     bool operator>(const Address& other) const { return other < *this; }
     bool operator<=(const Address& other) const { return !(other < *this); }
@@ -30,12 +46,18 @@ struct Address {
 namespace std {
     template<>
     struct hash<evm::Address> {
+        // Three loads and a multiply-xorshift mix; sequential and
+        // zero-padded addresses differ only in a few bytes
         size_t operator()(const evm::Address& addr) const noexcept {
-            size_t h = 0;
-            for (auto b : addr.bytes) {
-                h = h * 31 + b;
-            }
-            return h;
+            uint64_t a, b;
+            uint32_t c;
+            std::memcpy(&a, addr.bytes.data(), 8);
+            std::memcpy(&b, addr.bytes.data() + 8, 8);
+            std::memcpy(&c, addr.bytes.data() + 16, 4);
+            uint64_t h = (a ^ 0x9e3779b97f4a7c15ULL) * 0xbf58476d1ce4e5b9ULL;
+            h = (h ^ (h >> 31) ^ b) * 0x94d049bb133111ebULL;
+            h = (h ^ (h >> 29) ^ c) * 0xbf58476d1ce4e5b9ULL;
+            return static_cast<size_t>(h ^ (h >> 32));
         }
     };
-} 
\ No newline at end of file
+}
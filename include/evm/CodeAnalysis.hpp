@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "evm/Keccak.hpp"
+#include "evm/uint256.hpp"
+
+namespace quids {
+namespace evm {
+
+// Protocol upgrades that change which opcodes exist or what they cost.
+// Code is analysed for one fork and the interpreter is instantiated per
+// fork, so neither checks the fork while running.
+enum class Fork : uint8_t {
+    Berlin,    // EIP-2929 access lists; the gas costs below assume at least this
+    London,    // BASEFEE, EIP-3541 rejects new code starting with 0xEF
+    Shanghai,  // PUSH0, EIP-3860 initcode limit and gas
+};
+
+constexpr Fork LATEST_FORK = Fork::Shanghai;
+
+// What the interpreter dispatches on. Opcodes that share a handler are
+// folded together here (PUSH0-PUSH32, DUPn, SWAPn, LOGn) with the variant
+// in Instruction::arg, so the dispatch table is indexed without a lookup.
+enum Handler : uint8_t {
+    H_STOP, H_ADD, H_MUL, H_SUB, H_DIV, H_SDIV, H_MOD, H_SMOD,
+    H_ADDMOD, H_MULMOD, H_EXP, H_SIGNEXTEND,
+    H_LT, H_GT, H_SLT, H_SGT, H_EQ, H_ISZERO, H_AND, H_OR, H_XOR, H_NOT,
+    H_BYTE, H_SHL, H_SHR, H_SAR,
+    H_SHA3,
+    H_ADDRESS, H_ORIGIN, H_CALLER, H_CALLVALUE, H_CALLDATALOAD, H_CALLDATASIZE,
+    H_CALLDATACOPY, H_CODESIZE, H_CODECOPY, H_GASPRICE, H_RETURNDATASIZE,
+    H_RETURNDATACOPY,
+    H_COINBASE, H_TIMESTAMP, H_NUMBER, H_PREVRANDAO, H_GASLIMIT, H_CHAINID,
+    H_BASEFEE,
+    H_POP, H_MLOAD, H_MSTORE, H_MSTORE8, H_SLOAD, H_SSTORE,
+    H_JUMP, H_JUMPI, H_PC, H_MSIZE, H_GAS, H_JUMPDEST,
+    H_PUSH, H_DUP, H_SWAP, H_LOG,
+    H_RETURN, H_REVERT,
+    // Both end their block, so the caller's gas is exact when it is split
+    // and the rest of the block is paid for after the callee returns.
+    // arg is the opcode.
+    H_CALL,    // CALL, DELEGATECALL, STATICCALL
+    H_CREATE,  // CREATE, CREATE2
+    H_INVALID,      // undefined opcodes as well as INVALID itself
+    H_UNSUPPORTED,  // defined, but needs state or calls this engine lacks
+    H_BEGIN_BLOCK,  // starts a basic block not introduced by a JUMPDEST
+    // Optimised tier only: a PUSH fused with the instruction after it,
+    // which stays in place and is skipped
+    H_JUMP_STATIC,   // PUSH JUMP to a valid JUMPDEST; arg is its instruction index
+    H_JUMPI_STATIC,  // PUSH JUMPI, likewise
+    H_PUSH_ADD, H_PUSH_SUB, H_PUSH_AND, H_PUSH_EQ,  // arg is the push index
+    NUM_HANDLERS
+};
+
+struct Instruction {
+    uint8_t op;  // a Handler
+    // PUSH: index into push_values. DUP/SWAP/LOG: n. JUMPDEST/BEGIN_BLOCK:
+    // index into blocks. PC: the original pc. GAS/SSTORE: static gas of the
+    // rest of the block, which was already charged on entry.
+    uint32_t arg;
+};
+
+// Static gas and stack bounds of one basic block, checked once on entry
+struct BlockInfo {
+    uint64_t gas;
+    int32_t stack_required;  // items that must already be on the stack
+    int32_t stack_growth;    // highest the block takes the stack above entry
+};
+
+// Bytecode decoded once and shared between executions. A valid jump
+// target maps straight to its instruction index, PUSH immediates are
+// already 256-bit values, and undefined opcodes are left in place so they
+// fail only if reached.
+struct AnalyzedCode {
+    Hash256 code_hash{};
+    uint8_t tier{0};  // 0 straight from analyze(), 1 after optimize()
+    Fork fork{LATEST_FORK};
+    std::vector<uint8_t> code;
+    std::vector<Instruction> instructions;  // always ends in STOP
+    std::vector<::evm::uint256_t> push_values;
+    std::vector<BlockInfo> blocks;
+    std::vector<uint64_t> jumpdest_bitmap;  // one bit per code byte
+    std::vector<uint32_t> jumpdest_index;   // pc -> instruction, valid where the bit is set
+
+    bool is_jumpdest(uint64_t pc) const {
+        return pc < code.size() && (jumpdest_bitmap[pc >> 6] >> (pc & 63)) & 1;
+    }
+};
+
+// Decodes code against the fork's opcode table (see OpcodeTable.hpp)
+std::shared_ptr<const AnalyzedCode> analyze(std::vector<uint8_t> code, const Hash256& code_hash,
+                                            Fork fork = LATEST_FORK);
+
+// Second tier for hot code: fuses PUSH with a following JUMP, JUMPI or
+// simple ALU op and resolves static jump targets ahead of time. Blocks and
+// their gas are unchanged, so metering is identical to the first tier.
+std::shared_ptr<const AnalyzedCode> optimize(const AnalyzedCode& code);
+
+// Analyses keyed by code hash, shared by every executor in the process.
+// Code fetched hot_threshold times is replaced by its optimize()d form.
+// Everything in the cache is analysed for LATEST_FORK.
+class CodeCache {
+public:
+    struct Stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t evictions{0};
+        uint64_t promotions{0};  // entries moved to the optimised tier
+    };
+
+    static constexpr uint32_t DEFAULT_HOT_THRESHOLD = 32;
+
+    // hot_threshold 0 never promotes
+    explicit CodeCache(size_t capacity = 4096, uint32_t hot_threshold = DEFAULT_HOT_THRESHOLD);
+
+    static CodeCache& global() {
+        static CodeCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const AnalyzedCode> get(const std::vector<uint8_t>& code);
+    // For callers that already know the hash, such as stored contracts
+    std::shared_ptr<const AnalyzedCode> get(const Hash256& code_hash, const std::vector<uint8_t>& code);
+
+    // Code worth keeping across a restart: promoted entries first, then
+    // the rest by calls, at most limit of them
+    struct WarmEntry {
+        std::vector<uint8_t> code;
+        bool hot{false};  // was in the optimised tier
+    };
+    std::vector<WarmEntry> export_warm(size_t limit) const;
+    // Analyses entries ahead of their first call, hot ones straight into
+    // the optimised tier; returns how many were added
+    size_t import_warm(const std::vector<WarmEntry>& entries);
+
+    void clear();
+    Stats stats() const;
+
+private:
+    struct HashKey {
+        size_t operator()(const Hash256& h) const noexcept {
+            // Already uniformly distributed
+            size_t v;
+            std::memcpy(&v, h.data(), sizeof(v));
+            return v;
+        }
+    };
+
+    struct Entry {
+        std::shared_ptr<const AnalyzedCode> code;
+        std::atomic<uint32_t> calls{0};  // bumped under the shared lock
+    };
+
+    size_t capacity_;
+    uint32_t hot_threshold_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<Hash256, Entry, HashKey> entries_;
+    std::deque<Hash256> order_;  // insertion order, oldest evicted first
+    mutable std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    uint64_t evictions_{0};  // guarded by mutex_
+    uint64_t promotions_{0};  // guarded by mutex_
+};
+
+} // namespace evm
+} // namespace quids
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Keccak.hpp"
+
+namespace quids {
+namespace evm {
+
+// Contract code interned by hash, one copy per distinct code however many
+// accounts run it. Holders keep an entry alive through CodeRef; the last
+// one to drop it frees the bytes. An entry's bytes are those of its
+// first-tier analysis, which comes from CodeCache, so restoring the cache
+// at start (CodeCache::import_warm) also spares re-analysing stored code.
+class CodeStore {
+public:
+    class Entry {
+    public:
+        explicit Entry(std::shared_ptr<const AnalyzedCode> base) : base_(std::move(base)) {}
+
+        const Hash256& hash() const { return base_->code_hash; }
+        const std::vector<uint8_t>& code() const { return base_->code; }
+
+        // The cache's current analysis until it hands out the optimised
+        // tier, which is then kept here
+        std::shared_ptr<const AnalyzedCode> analysis() const;
+
+    private:
+        std::shared_ptr<const AnalyzedCode> base_;
+        mutable std::atomic<std::shared_ptr<const AnalyzedCode>> hot_;
+    };
+
+    struct Stats {
+        size_t entries{0};
+        size_t bytes{0};
+        uint64_t interned{0};  // intern() calls
+        uint64_t shared{0};    // of those, ones that found the code already held
+    };
+
+    CodeStore();
+    ~CodeStore();
+
+    CodeStore(const CodeStore&) = delete;
+    CodeStore& operator=(const CodeStore&) = delete;
+
+    static CodeStore& global() {
+        static CodeStore store;
+        return store;
+    }
+
+    std::shared_ptr<const Entry> intern(std::vector<uint8_t> code);
+    // For callers that already know the hash, such as code read back by it
+    std::shared_ptr<const Entry> intern(const Hash256& code_hash, std::vector<uint8_t> code);
+    // Only if something still holds it
+    std::shared_ptr<const Entry> find(const Hash256& code_hash) const;
+
+    Stats stats() const;
+
+private:
+    struct Table;
+    std::shared_ptr<Table> table_;  // entries unlink themselves through a weak reference
+};
+
+// An account's code: its hash plus a shared handle on the stored bytes.
+// Copies are cheap and compare by hash; empty is no code.
+class CodeRef {
+public:
+    CodeRef() = default;
+    // Interns code in CodeStore::global()
+    CodeRef(std::vector<uint8_t> code);  // NOLINT: implicit, like the vector it replaces
+    explicit CodeRef(std::shared_ptr<const CodeStore::Entry> entry) : entry_(std::move(entry)) {}
+
+    bool empty() const { return !entry_; }
+    size_t size() const { return entry_ ? entry_->code().size() : 0; }
+    // All zero for no code
+    Hash256 hash() const { return entry_ ? entry_->hash() : Hash256{}; }
+    const std::vector<uint8_t>& bytes() const;
+    std::shared_ptr<const AnalyzedCode> analysis() const { return entry_ ? entry_->analysis() : nullptr; }
+
+    bool operator==(const CodeRef& other) const {
+        return entry_ == other.entry_ || (entry_ && other.entry_ && entry_->hash() == other.entry_->hash());
+    }
+
+private:
+    std::shared_ptr<const CodeStore::Entry> entry_;
+};
+
+} // namespace evm
+} // namespace quids
@@ -7,10 +7,26 @@
 
 namespace evm {
 
+// Compression for rollup calldata and other bulk data.
+//
+// ZSTD is the default. Its contexts are created once and reused by every
+// call; calls on one instance are serialized, so give each thread its own
+// instance when compressing in parallel. A dictionary trained on recent
+// transactions helps most with many small, similar payloads. Its ID is
+// written into every frame header, and the last few dictionaries stay
+// loaded so frames written before a retrain still decompress.
 class Compression {
 public:
+    enum class Algorithm {
+        ZLIB,
+        SNAPPY,  // not built in; rejected
+        LZ4,     // not built in; rejected
+        ZSTD
+    };
+
     // Constructors and destructor
     Compression();
+    explicit Compression(Algorithm algo);
     ~Compression();
 
     // Disable copy
@@ -21,39 +37,39 @@ public:
     Compression(Compression&&) noexcept;
     Compression& operator=(Compression&&) noexcept;
 
-    enum class Algorithm {
-        ZLIB,
-        SNAPPY,
-        LZ4,
-        ZSTD
-    };
-    
-    explicit Compression(Algorithm algo = Algorithm::ZSTD);
-    
     // Compression operations
     [[nodiscard]] std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const;
     [[nodiscard]] std::vector<uint8_t> decompress(const std::vector<uint8_t>& compressed_data) const;
-    
+
     // Configuration
     void set_algorithm(Algorithm algo);
     void set_level(uint8_t level);
     [[nodiscard]] uint8_t get_level() const;
-    
+
     // Statistics
-    [[nodiscard]] double get_compression_ratio() const;
+    [[nodiscard]] double get_compression_ratio() const;  // original / compressed
     [[nodiscard]] size_t get_total_compressed_size() const;
     [[nodiscard]] size_t get_total_original_size() const;
-    
-    // Dictionary-based compression
+
+    // Dictionary-based compression (ZSTD only). Training replaces the
+    // current dictionary; an empty set_dictionary() goes back to none.
     void train_dictionary(const std::vector<std::vector<uint8_t>>& samples);
     void set_dictionary(const std::vector<uint8_t>& dictionary);
     [[nodiscard]] std::vector<uint8_t> get_dictionary() const;
-    
-    // Stream interface for large data
+    [[nodiscard]] uint32_t get_dictionary_id() const;  // 0 without a dictionary
+
+    // Recent payloads kept for retraining, oldest dropped past the window
+    void add_training_sample(const std::vector<uint8_t>& sample);
+    void set_training_window(size_t max_bytes);
+    void train_dictionary();  // from the samples added so far
+
+    // Stream interface for large data (ZSTD only). write() feeds input and
+    // read() takes whatever output is ready. On a compression stream
+    // flush() ends the current frame and the next write() starts another;
+    // on a decompression stream it decodes input still held back.
     class Stream {
     public:
-        Stream() = default;
-        ~Stream() = default;
+        ~Stream();
 
         // Disable copy and move
         Stream(const Stream&) = delete;
@@ -64,26 +80,26 @@ public:
         void write(const std::vector<uint8_t>& data);
         [[nodiscard]] std::vector<uint8_t> read(size_t size);
         void flush();
-        
+        [[nodiscard]] size_t available() const { return buffer_.size() - position_; }
+
     private:
-        std::vector<uint8_t> buffer_;
+        friend class Compression;
+        struct State;
+
+        explicit Stream(std::unique_ptr<State> state);
+        void process(bool flushing);
+
+        std::unique_ptr<State> state_;
+        std::vector<uint8_t> buffer_;  // output not yet read
         size_t position_{0};
     };
-    
+
     [[nodiscard]] std::unique_ptr<Stream> create_compression_stream();
     [[nodiscard]] std::unique_ptr<Stream> create_decompression_stream();
 
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
-    
-    Algorithm algorithm_;
-    uint8_t compression_level_;
-    std::vector<uint8_t> dictionary_;
-    
-    // Statistics
-    size_t total_compressed_size_{0};
-    size_t total_original_size_{0};
 };
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
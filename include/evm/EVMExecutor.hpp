@@ -9,6 +9,8 @@
 #include <string>
 #include <unordered_map>
 
+#include "evm/CodeStore.hpp"
+#include "evm/Interpreter.hpp"
 #include "evm/Memory.hpp"
 #include "evm/Storage.hpp"
 #include "evm/Stack.hpp"
@@ -31,9 +33,12 @@ public:
     // Implementation details
     struct Impl {
         // EVM state
-        std::unordered_map<std::string, uint64_t> balances;
-        std::unordered_map<std::string, std::vector<uint8_t>> code;
-        std::unordered_map<std::string, std::unordered_map<::evm::uint256_t, std::vector<uint8_t>>> storage;
+        // Keyed by address; strings are parsed at the API
+        std::unordered_map<::evm::Address, uint64_t> balances;
+        // Shared with every other account that holds the same code
+        std::unordered_map<::evm::Address, CodeRef> code;
+        std::unordered_map<::evm::Address, uint64_t> nonces;
+        std::unordered_map<::evm::Address, std::unordered_map<::evm::uint256_t, std::vector<uint8_t>>> storage;
     };
 
     struct ExecutionResult {
@@ -41,6 +46,8 @@ public:
         std::vector<uint8_t> return_data;
         uint64_t gas_used;
         std::string error_message;
+        // Storage slots the call touched, including ones it rolled back
+        ::evm::StorageAccessSet storage_access;
     };
 
     // Constructor and destructor
@@ -61,25 +68,55 @@ public:
         uint64_t gas_limit
     );
 
+    // Reads slots this executor has not seen from backend. Each call then
+    // starts by prefetching the slots SlotPredictor expects it to touch.
+    void set_storage_backend(std::shared_ptr<::evm::SlotBackend> backend);
+    // Starts those fetches early, e.g. for the next call of a block while
+    // this one runs; returns how many slots were requested
+    size_t prefetch_contract(
+        const ::evm::Address& contract_address,
+        const std::vector<uint8_t>& code,
+        const std::vector<uint8_t>& input_data
+    );
+
+    // Stateless replay. Between begin_storage_witness() and
+    // take_storage_witness() the committed value of every slot a call reads
+    // or writes is recorded; load_storage_witness() then lets another
+    // executor run the same calls with only that. A call there that
+    // touches a slot outside the witness throws std::out_of_range.
+    void begin_storage_witness();
+    ::evm::SlotWitness take_storage_witness();
+    void load_storage_witness(const ::evm::SlotWitness& witness);
+
     // Transaction execution
     bool execute(const blockchain::Transaction& tx);
     bool deploy(const std::vector<uint8_t>& code);
 
+    // Installs code that calls from execute_contract() can reach
+    void set_code(const ::evm::Address& address, std::vector<uint8_t> code);
+    // Seeds the balance execute() transfers from
+    void set_balance(const ::evm::Address& address, uint64_t balance);
+
     // State access
     uint64_t getBalance(const std::string& address) const;
     std::vector<uint8_t> getCode(const std::string& address) const;
     std::vector<uint8_t> getStorage(const std::string& address, ::evm::uint256_t key) const;
     
+    // Drops all state and gas accounting but keeps the call frames, their
+    // committed memory pages and storage tables, so a pooled executor can be reused
+    // without reallocating
+    void reset();
+
     // Gas management
     [[nodiscard]] uint64_t get_gas_used() const { return gas_used_; }
     [[nodiscard]] uint64_t get_gas_limit() const { return gas_limit_; }
 
 private:
-    void require_gas(uint64_t gas);
+    class Host;
 
-    // Core components
-    std::shared_ptr<::evm::Memory> memory_;
-    std::shared_ptr<::evm::Stack> stack_;
+    // Core components. The frames are reused by every call this executor
+    // runs, nested ones included.
+    std::unique_ptr<CallArena> frames_;
     std::shared_ptr<::evm::Storage> storage_;
     
     // Gas tracking
@@ -91,6 +128,8 @@ private:
 
     // Implementation details
     std::unique_ptr<Impl> impl_;
+    // Serves impl_'s accounts to nested calls
+    std::unique_ptr<Host> host_;
 };
 
 } // namespace evm
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <vector>
 #include <memory>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <future>
+#include <optional>
+#include <span>
+#include "crypto/signature/BatchVerifier.hpp"
 #include "evm/FloatingPoint.hpp"
 #include "evm/Address.hpp"
+#include "utils/Task.hpp"
 
 namespace evm {
 
@@ -17,10 +24,19 @@ class ProofVerifier;
 struct ExternalData {
     std::vector<uint8_t> data;
     std::vector<uint8_t> proof;
-    uint64_t timestamp;
+    uint64_t timestamp;  // when it was received; not signed
     std::string source;
+    std::vector<uint8_t> signature;  // by the source's key over ExternalLink::payload_hash
 };
 
+// Fetches off-chain data for contracts.
+//
+// Popular oracle contracts make many identical requests at once, so
+// requests are served through three layers: a sharded cache that also
+// remembers failures for a short while, single-flight coalescing that
+// lets identical in-flight requests share one upstream fetch, and a pool
+// of keep-alive HTTPS handles per endpoint. Only the fetch that actually
+// goes upstream is charged against the source's rate limit and quota.
 class ExternalLink {
 public:
     struct LinkConfig {
@@ -45,11 +61,28 @@ public:
         std::vector<uint8_t> data;
         std::vector<uint8_t> proof;
         std::string error_message;
+        std::vector<uint8_t> signature;
     };
 
     // Callback type for async operations
     using DataCallback = std::function<void(const DataResponse&)>;
 
+    // Performs one upstream fetch. The default speaks HTTPS through the
+    // connection pool; tests and embedders can substitute their own.
+    using Transport = std::function<DataResponse(const DataRequest&)>;
+
+    struct Stats {
+        uint64_t upstream_fetches{0};
+        uint64_t coalesced{0};         // requests that joined a fetch in flight
+        uint64_t cache_hits{0};
+        uint64_t negative_hits{0};     // cache hits on a remembered failure
+        uint64_t rate_limited{0};
+        uint64_t connections_opened{0};
+        uint64_t connections_reused{0};
+        uint64_t signatures_checked{0};
+        uint64_t verifications_remembered{0};  // items accepted without checking again
+    };
+
     explicit ExternalLink(
         const LinkConfig& config,
         std::shared_ptr<StateManager> state_manager,
@@ -61,26 +94,48 @@ public:
     // Synchronous operations
     DataResponse fetch_data(const DataRequest& request);
     bool verify_external_data(const ExternalData& data);
+    // Verifies a block's worth of responses together, one entry per item,
+    // 1 when it checks out. Signatures go through a single batch call that
+    // decodes each source key once; accepted (source, payload) pairs are
+    // remembered, so a response read by many contracts is verified once.
+    std::vector<uint8_t> verify_external_data(std::span<const ExternalData> batch);
+    // What a source signs: keccak256 of the data length, data and proof
+    static std::array<uint8_t, 32> payload_hash(const ExternalData& data);
     
     // Asynchronous operations
     std::future<DataResponse> fetch_data_async(const DataRequest& request);
+    // callback runs on the calling thread when the answer is immediate (a
+    // cache hit or an invalid request), otherwise on the fetching thread
     void fetch_data_with_callback(const DataRequest& request, DataCallback callback);
+    // The callback form as a coroutine; joins an identical fetch in flight
+    // instead of holding a thread while it waits
+    quids::utils::Task<DataResponse> fetch_data_task(DataRequest request);
     
-    // Source management
-    bool add_trusted_source(const std::string& source, const std::string& public_key);
+    // Source management. public_key holds the raw key bytes; a source
+    // added with an empty key is trusted by name and sends no signature.
+    // Changing the sources forgets every remembered verification.
+    bool add_trusted_source(const std::string& source, const std::string& public_key,
+                            quids::crypto::SignatureScheme scheme = quids::crypto::SignatureScheme::Falcon512);
     bool remove_trusted_source(const std::string& source);
     std::vector<std::string> get_trusted_sources() const;
     
-    // Rate limiting and quotas
+    // Rate limiting and quotas; sources without a limit are not limited,
+    // and 0 removes one. A source may burst up to one second's worth.
     void set_rate_limit(const std::string& source, uint32_t requests_per_second);
     void set_quota(const std::string& source, uint32_t daily_quota);
     
     // Caching
     void enable_caching(bool enable);
     void set_cache_duration(std::chrono::seconds duration);
+    // How long a failed fetch is answered from the cache
+    void set_negative_cache_duration(std::chrono::seconds duration);
     void clear_cache();
 
-    // Connection management
+    void set_transport(Transport transport);
+    Stats stats() const;
+
+    // Connection management. Opens a verified TLS connection to endpoint
+    // and keeps it in the pool; throws when that fails.
     void establish_secure_connection(const std::string& endpoint);
     void verify_tls_certificate(const std::string& cert);
 
@@ -95,9 +150,12 @@ private:
     
     // Internal helper methods
     bool validate_request(const DataRequest& request);
-    bool verify_source(const std::string& source, const std::vector<uint8_t>& signature);
-    ExternalData fetch_from_cache(const DataRequest& request);
-    void update_cache(const DataRequest& request, const ExternalData& data);
+    std::optional<DataResponse> fetch_from_cache(const std::string& key);
+    void update_cache(const std::string& key, const DataResponse& response);
+    // Run by the one request of a flight that goes upstream: rate limits,
+    // fetches, verifies and caches, then answers the requests that joined
+    DataResponse lead_flight(const DataRequest& request, const std::string& key);
+    DataResponse fetch_upstream(const DataRequest& request, const std::string& key);
     
     // Rate limiting
     bool check_rate_limit(const std::string& source);
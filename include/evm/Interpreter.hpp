@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "evm/Address.hpp"
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Memory.hpp"
+#include "evm/Stack.hpp"
+#include "evm/Storage.hpp"
+#include "evm/uint256.hpp"
+
+namespace quids {
+namespace evm {
+
+enum class InterpreterStatus {
+    Success,
+    Revert,
+    OutOfGas,
+    StackUnderflow,
+    StackOverflow,
+    BadJump,
+    InvalidOpcode,
+    OutOfBounds,  // RETURNDATACOPY past the end of the return data
+    StaticViolation,  // a state change inside STATICCALL
+    Unsupported  // opcodes that need state this engine lacks, or calls without a host
+};
+
+const char* to_string(InterpreterStatus status);
+
+// A native contract's run in place of bytecode
+struct PrecompileResult {
+    bool success{false};  // false consumes all the gas it was given
+    uint64_t gas_used{0};
+    std::vector<uint8_t> output;
+};
+
+// Accounts a call can reach beyond its own storage: other contracts'
+// code, balances and nonces. Every change is undone by revert() back to a
+// checkpoint, in time proportional to the changes.
+class CallHost {
+public:
+    virtual ~CallHost() = default;
+    // nullptr for an account without code
+    virtual std::shared_ptr<const AnalyzedCode> code_at(const ::evm::Address& address) = 0;
+    // False, with nothing moved, when `from` cannot cover it
+    virtual bool transfer(const ::evm::Address& from, const ::evm::Address& to, const ::evm::uint256_t& value) = 0;
+    // Returns the nonce before the increment
+    virtual uint64_t increment_nonce(const ::evm::Address& address) = 0;
+    virtual void set_code(const ::evm::Address& address, std::vector<uint8_t> code) = 0;
+    // nullopt when the address is not a native contract
+    virtual std::optional<PrecompileResult> run_precompile(const ::evm::Address& /*address*/,
+                                                           const uint8_t* /*input*/, size_t /*size*/,
+                                                           uint64_t /*gas*/) {
+        return std::nullopt;
+    }
+
+    using Checkpoint = size_t;
+    virtual Checkpoint checkpoint() = 0;
+    virtual void revert(Checkpoint checkpoint) = 0;
+};
+
+struct ExecutionContext {
+    ::evm::Address address{};
+    ::evm::uint256_t caller{0};
+    ::evm::uint256_t origin{0};
+    ::evm::uint256_t value{0};
+    ::evm::uint256_t gas_price{0};
+    ::evm::uint256_t coinbase{0};
+    ::evm::uint256_t timestamp{0};
+    ::evm::uint256_t number{0};
+    ::evm::uint256_t prevrandao{0};
+    ::evm::uint256_t block_gas_limit{0};
+    ::evm::uint256_t chain_id{0};
+    ::evm::uint256_t base_fee{0};
+    const uint8_t* input{nullptr};
+    size_t input_size{0};
+    ::evm::Storage* storage{nullptr};
+    // Without a host, CALL, CREATE and their variants fail Unsupported
+    CallHost* host{nullptr};
+    bool is_static{false};
+};
+
+struct LogEntry {
+    ::evm::Address address;
+    std::vector<::evm::uint256_t> topics;
+    std::vector<uint8_t> data;
+};
+
+struct InterpreterResult {
+    InterpreterStatus status{InterpreterStatus::Success};
+    uint64_t gas_left{0};  // zero for every failure except Revert
+    std::vector<uint8_t> output;
+    std::vector<LogEntry> logs;
+};
+
+// Frames for nested calls. The frame at depth d always runs in slot d,
+// whose stack, memory and return data buffer are allocated the first
+// time a call gets that deep and kept from then on, so once an arena has
+// seen a transaction's call depth its nested calls allocate nothing. A
+// call is a switch to the next slot inside one interpreter loop, not a
+// native recursion. Used by one thread at a time.
+class CallArena {
+public:
+    // EVM call depth limit; a call that would go deeper fails
+    static constexpr size_t DEPTH_LIMIT = 1024;
+
+    CallArena();
+    ~CallArena();
+
+    CallArena(const CallArena&) = delete;
+    CallArena& operator=(const CallArena&) = delete;
+
+    // Slots allocated so far: the deepest call seen, plus one
+    [[nodiscard]] size_t capacity() const { return slots_.size(); }
+
+    // For the interpreter, which defines what a slot holds
+    struct Slot;
+    Slot& slot(size_t depth);
+
+private:
+    std::vector<std::unique_ptr<Slot>> slots_;
+};
+
+// Runs analysed code. Gas and stack bounds are checked once per basic
+// block, so individual instructions do no checks beyond their dynamic
+// costs. The stack and memory are cleared first and left as the code
+// finished with them; callers that run many contracts pass the same pair
+// every time. Calls need the arena form below and fail Unsupported here.
+InterpreterResult interpret(const AnalyzedCode& code, const ExecutionContext& ctx, uint64_t gas_limit,
+                            ::evm::Stack& stack, ::evm::Memory& memory);
+
+// Same, with nested calls through ctx.host run on the arena's frames. The
+// outermost frame's stack and memory are the arena's first slot.
+InterpreterResult interpret(const AnalyzedCode& code, const ExecutionContext& ctx, uint64_t gas_limit,
+                            CallArena& arena);
+
+// Same, on an arena borrowed from the calling thread
+InterpreterResult interpret(const AnalyzedCode& code, const ExecutionContext& ctx, uint64_t gas_limit);
+
+// Where CREATE puts the contract sender deploys with nonce
+::evm::Address contract_address(const ::evm::Address& sender, uint64_t nonce);
+
+} // namespace evm
+} // namespace quids
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace quids {
+namespace evm {
+
+using Hash256 = std::array<uint8_t, 32>;
+
+// Keccak-256 as used by the EVM (original Keccak padding, not FIPS-202 SHA3)
+Hash256 keccak256(const uint8_t* data, size_t size);
+
+inline Hash256 keccak256(const std::vector<uint8_t>& data) {
+    return keccak256(data.data(), data.size());
+}
+
+} // namespace evm
+} // namespace quids
@@ -1,13 +1,30 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <span>
 #include <string>
+#include <vector>
+
+#include "evm/uint256.hpp"
 
 namespace evm {
 
+// Byte-addressed memory of one call frame.
+//
+// The full address range is reserved up front and pages are committed as
+// the frame grows, so growth never moves existing bytes and views stay
+// valid until clear(). Committed pages are kept across clear() (up to
+// RETAINED_SIZE), so an executor that is reused for many calls stops
+// allocating after the first few.
 class Memory {
 public:
+    static constexpr size_t PAGE_SIZE = 4096;
+    // Paying for this much memory takes billions of gas, far above any
+    // block gas limit, so the reservation is never the real bound
+    static constexpr size_t MAX_SIZE = size_t{64} << 20;
+    static constexpr size_t RETAINED_SIZE = size_t{1} << 20;
+
     // Constructors and destructor
     Memory();
     ~Memory();  // Non-inline destructor declaration
@@ -17,35 +34,47 @@ public:
     Memory& operator=(const Memory&) = delete;
     Memory(Memory&&) = delete;
     Memory& operator=(Memory&&) = delete;
-    
-    // Basic memory operations
+
+    // Basic memory operations; stores grow memory as needed
     void store(size_t offset, uint8_t value);
     void store(size_t offset, const std::vector<uint8_t>& data);
+    void store(size_t offset, std::span<const uint8_t> data);
+    void store_word(size_t offset, const uint256_t& value);
     [[nodiscard]] uint8_t load(size_t offset) const;
+    // Copy, zero-filled past the end of memory
     [[nodiscard]] std::vector<uint8_t> load(size_t offset, size_t size) const;
-    
-    // Memory expansion and gas calculation
+    [[nodiscard]] uint256_t load_word(size_t offset) const;
+
+    // Zero-copy access; the range must already be inside size()
+    [[nodiscard]] std::span<uint8_t> view(size_t offset, size_t size);
+    [[nodiscard]] std::span<const uint8_t> view(size_t offset, size_t size) const;
+    [[nodiscard]] uint8_t* data() { return base_; }
+    [[nodiscard]] const uint8_t* data() const { return base_; }
+
+    // Memory expansion and gas calculation. Memory grows in whole 32-byte
+    // words; both return only the cost on top of what size() already paid.
     [[nodiscard]] uint64_t expand(size_t new_size);
     [[nodiscard]] uint64_t calculate_expansion_cost(size_t offset, size_t size) const;
-    
+
     // Memory state
-    [[nodiscard]] size_t size() const { return data_.size(); }
+    [[nodiscard]] size_t size() const { return size_; }
     [[nodiscard]] bool is_zero(size_t offset, size_t size) const;
     void clear();
-    
+
     // Debug helpers
     [[nodiscard]] std::string dump() const;
     [[nodiscard]] std::string dump(size_t offset, size_t size) const;
 
 private:
-    std::vector<uint8_t> data_;
-    
     void ensure_capacity(size_t offset, size_t size);
-    [[nodiscard]] uint64_t calculate_words(size_t size) const;
+    void commit(size_t bytes);
+    [[nodiscard]] static uint64_t calculate_words(size_t size);
+    [[nodiscard]] static uint64_t cost_of_words(uint64_t words);
 
-    // Implementation details
-    class Impl;
-    std::unique_ptr<Impl> impl_;
+    uint8_t* base_{nullptr};
+    size_t size_{0};       // bytes in use, a multiple of 32
+    size_t committed_{0};  // bytes backed by pages; everything past size_ is zero
+    uint64_t cost_{0};     // gas already charged for size_
 };
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Opcodes.hpp"
+
+namespace quids {
+namespace evm {
+
+// Everything analysis needs to know about one opcode under one fork
+struct OpInfo {
+    uint8_t handler;    // a Handler
+    uint16_t gas;       // static part only; the interpreter adds the rest
+    int8_t in;          // stack items consumed
+    int8_t out;         // stack items produced
+    uint8_t immediate;  // code bytes that follow the opcode (PUSHn)
+    bool ends_block;
+};
+
+using OpTable = std::array<OpInfo, 256>;
+
+// Built at compile time, one table per fork. Opcodes a fork does not have
+// yet are H_INVALID there, like any other undefined byte.
+constexpr OpTable make_op_table(Fork fork) {
+    OpTable t{};
+    for (auto& e : t) {
+        e = OpInfo{H_INVALID, 0, 0, 0, 0, true};
+    }
+    auto set = [&t](uint8_t op, Handler h, uint16_t gas, int8_t in, int8_t out, bool ends = false) {
+        t[op] = OpInfo{static_cast<uint8_t>(h), gas, in, out, 0, ends};
+    };
+
+    set(STOP, H_STOP, 0, 0, 0, true);
+    set(ADD, H_ADD, 3, 2, 1);
+    set(MUL, H_MUL, 5, 2, 1);
+    set(SUB, H_SUB, 3, 2, 1);
+    set(DIV, H_DIV, 5, 2, 1);
+    set(SDIV, H_SDIV, 5, 2, 1);
+    set(MOD, H_MOD, 5, 2, 1);
+    set(SMOD, H_SMOD, 5, 2, 1);
+    set(ADDMOD, H_ADDMOD, 8, 3, 1);
+    set(MULMOD, H_MULMOD, 8, 3, 1);
+    set(EXP, H_EXP, 10, 2, 1);
+    set(SIGNEXTEND, H_SIGNEXTEND, 5, 2, 1);
+
+    set(LT, H_LT, 3, 2, 1);
+    set(GT, H_GT, 3, 2, 1);
+    set(SLT, H_SLT, 3, 2, 1);
+    set(SGT, H_SGT, 3, 2, 1);
+    set(EQ, H_EQ, 3, 2, 1);
+    set(ISZERO, H_ISZERO, 3, 1, 1);
+    set(AND, H_AND, 3, 2, 1);
+    set(OR, H_OR, 3, 2, 1);
+    set(XOR, H_XOR, 3, 2, 1);
+    set(NOT, H_NOT, 3, 1, 1);
+    set(BYTE, H_BYTE, 3, 2, 1);
+    set(SHL, H_SHL, 3, 2, 1);
+    set(SHR, H_SHR, 3, 2, 1);
+    set(SAR, H_SAR, 3, 2, 1);
+
+    set(SHA3, H_SHA3, 30, 2, 1);
+
+    set(ADDRESS, H_ADDRESS, 2, 0, 1);
+    set(ORIGIN, H_ORIGIN, 2, 0, 1);
+    set(CALLER, H_CALLER, 2, 0, 1);
+    set(CALLVALUE, H_CALLVALUE, 2, 0, 1);
+    set(CALLDATALOAD, H_CALLDATALOAD, 3, 1, 1);
+    set(CALLDATASIZE, H_CALLDATASIZE, 2, 0, 1);
+    set(CALLDATACOPY, H_CALLDATACOPY, 3, 3, 0);
+    set(CODESIZE, H_CODESIZE, 2, 0, 1);
+    set(CODECOPY, H_CODECOPY, 3, 3, 0);
+    set(GASPRICE, H_GASPRICE, 2, 0, 1);
+    set(RETURNDATASIZE, H_RETURNDATASIZE, 2, 0, 1);
+    set(RETURNDATACOPY, H_RETURNDATACOPY, 3, 3, 0);
+
+    set(COINBASE, H_COINBASE, 2, 0, 1);
+    set(TIMESTAMP, H_TIMESTAMP, 2, 0, 1);
+    set(NUMBER, H_NUMBER, 2, 0, 1);
+    set(DIFFICULTY, H_PREVRANDAO, 2, 0, 1);
+    set(GASLIMIT, H_GASLIMIT, 2, 0, 1);
+    set(CHAINID, H_CHAINID, 2, 0, 1);
+    if (fork >= Fork::London) {
+        set(BASEFEE, H_BASEFEE, 2, 0, 1);  // EIP-3198
+    }
+
+    set(POP, H_POP, 2, 1, 0);
+    set(MLOAD, H_MLOAD, 3, 1, 1);
+    set(MSTORE, H_MSTORE, 3, 2, 0);
+    set(MSTORE8, H_MSTORE8, 3, 2, 0);
+    set(SLOAD, H_SLOAD, 100, 1, 1);
+    set(SSTORE, H_SSTORE, 100, 2, 0);  // plus the dynamic EIP-2200 cost
+    set(JUMP, H_JUMP, 8, 1, 0, true);
+    set(JUMPI, H_JUMPI, 10, 2, 0, true);
+    set(PC, H_PC, 2, 0, 1);
+    set(MSIZE, H_MSIZE, 2, 0, 1);
+    set(GAS, H_GAS, 2, 0, 1);
+    set(JUMPDEST, H_JUMPDEST, 1, 0, 0);
+
+    if (fork >= Fork::Shanghai) {
+        set(PUSH0, H_PUSH, 2, 0, 1);  // EIP-3855
+    }
+    for (int op = PUSH1; op <= PUSH32; ++op) {
+        set(static_cast<uint8_t>(op), H_PUSH, 3, 0, 1);
+        t[op].immediate = static_cast<uint8_t>(op - PUSH0);
+    }
+    for (int n = 1; n <= 16; ++n) {
+        set(static_cast<uint8_t>(DUP1 + n - 1), H_DUP, 3, static_cast<int8_t>(n), static_cast<int8_t>(n + 1));
+        set(static_cast<uint8_t>(SWAP1 + n - 1), H_SWAP, 3, static_cast<int8_t>(n + 1), static_cast<int8_t>(n + 1));
+    }
+    for (int n = 0; n <= 4; ++n) {
+        set(static_cast<uint8_t>(LOG0 + n), H_LOG, static_cast<uint16_t>(375 + 375 * n),
+            static_cast<int8_t>(n + 2), 0);
+    }
+
+    set(RETURN, H_RETURN, 0, 2, 0, true);
+    set(REVERT, H_REVERT, 0, 2, 0, true);
+    set(INVALID, H_INVALID, 0, 0, 0, true);
+
+    // Warm account access; the cold surcharge, value transfer and the
+    // gas handed to the callee are dynamic
+    set(CALL, H_CALL, 100, 7, 1, true);
+    set(DELEGATECALL, H_CALL, 100, 6, 1, true);
+    set(STATICCALL, H_CALL, 100, 6, 1, true);
+    set(CREATE, H_CREATE, 32000, 3, 1, true);
+    set(CREATE2, H_CREATE, 32000, 4, 1, true);
+
+    // These halt the frame with an error, so their stack effect is moot
+    for (uint8_t op : {BALANCE, EXTCODESIZE, EXTCODECOPY, EXTCODEHASH, BLOCKHASH, SELFBALANCE,
+                       CALLCODE, SELFDESTRUCT}) {
+        set(op, H_UNSUPPORTED, 0, 0, 0, true);
+    }
+    return t;
+}
+
+template <Fork F>
+inline constexpr OpTable OP_TABLE = make_op_table(F);
+
+static_assert(OP_TABLE<Fork::Berlin>[PUSH0].handler == H_INVALID && OP_TABLE<Fork::Shanghai>[PUSH0].handler == H_PUSH);
+static_assert(OP_TABLE<Fork::Shanghai>[PUSH32].immediate == 32 && OP_TABLE<Fork::Shanghai>[PUSH0].immediate == 0);
+
+} // namespace evm
+} // namespace quids
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "crypto/signature/BatchVerifier.hpp"
+#include "evm/Address.hpp"
+#include "evm/Interpreter.hpp"
+
+namespace quids {
+namespace evm {
+
+// Prices of the native contracts. A signature check is priced as one
+// call plus the message it hashes, whether it comes alone or in a batch.
+struct PrecompileGas {
+    uint64_t blake3_base{30};
+    uint64_t blake3_word{3};
+    uint64_t falcon512_verify{1500};
+    uint64_t falcon1024_verify{3000};
+    uint64_t dilithium_verify{2500};
+    uint64_t sphincs_verify{25000};
+    uint64_t message_word{3};
+    uint64_t batch_base{500};
+};
+
+// Native contracts for work bytecode cannot afford: post-quantum signature
+// checks and BLAKE3. They sit at 0x...0100 and up, clear of the Ethereum
+// range.
+//
+// Encodings:
+//   BLAKE3            data                                   -> 32-byte hash
+//   FALCON512_VERIFY  key_len:u32 sig_len:u32 key sig message -> 32-byte 1 or 0
+//   DILITHIUM_VERIFY  same, with a Dilithium key and signature
+//   BATCH_VERIFY      count:u32, then per item scheme:u8 key_len:u32
+//                     sig_len:u32 msg_len:u32 key sig message
+//                                                            -> 32 bytes per item
+// Lengths are big-endian. Input that does not parse fails the call, and
+// signatures are checked through crypto::BatchVerifier::global(), so a
+// scheme verifies here once it is registered there. A single verify of
+// an unregistered scheme fails; in a batch its items come back 0.
+class Precompiles {
+public:
+    static constexpr uint16_t BLAKE3 = 0x0100;
+    static constexpr uint16_t FALCON512_VERIFY = 0x0101;
+    static constexpr uint16_t DILITHIUM_VERIFY = 0x0102;
+    static constexpr uint16_t BATCH_VERIFY = 0x0103;
+    static constexpr uint16_t FIRST = BLAKE3;
+    static constexpr uint16_t LAST = BATCH_VERIFY;
+
+    explicit Precompiles(PrecompileGas gas = {});
+
+    [[nodiscard]] static ::evm::Address address(uint16_t id);
+    [[nodiscard]] static bool contains(const ::evm::Address& address);
+
+    // nullopt when the address is not one of these
+    [[nodiscard]] std::optional<PrecompileResult> run(const ::evm::Address& address, const uint8_t* input,
+                                                      size_t size, uint64_t gas) const;
+
+    // Inputs in the layouts above
+    [[nodiscard]] static std::vector<uint8_t> encode_verify(std::span<const uint8_t> public_key,
+                                                            std::span<const uint8_t> signature,
+                                                            std::span<const uint8_t> message);
+    [[nodiscard]] static std::vector<uint8_t> encode_batch(std::span<const crypto::VerifyItem> items);
+
+    [[nodiscard]] const PrecompileGas& gas() const { return gas_; }
+
+private:
+    PrecompileResult blake3(std::span<const uint8_t> input, uint64_t gas) const;
+    PrecompileResult verify(crypto::SignatureScheme scheme, std::span<const uint8_t> input, uint64_t gas) const;
+    PrecompileResult batch_verify(std::span<const uint8_t> input, uint64_t gas) const;
+    uint64_t verify_gas(crypto::SignatureScheme scheme, size_t message_size) const;
+
+    PrecompileGas gas_;
+};
+
+} // namespace evm
+} // namespace quids
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "evm/Address.hpp"
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Storage.hpp"
+#include "evm/uint256.hpp"
+
+namespace quids {
+namespace evm {
+
+// Guesses which storage slots a call will touch, so a Storage with a
+// backend can fetch them all before the call runs instead of stalling on
+// each cold SLOAD in turn. Two sources:
+//
+//  - the code: a constant pushed straight before SLOAD or SSTORE is a
+//    fixed slot, and a small constant hashed by a nearby SHA3 is most
+//    likely a mapping's base slot, whose entries are keccak(key . base)
+//    for keys taken from the caller and the calldata arguments;
+//  - history: the slots earlier calls to the same contract touched, most
+//    frequent first.
+//
+// Wrong guesses cost a wasted read, never a wrong result.
+class SlotPredictor {
+public:
+    struct Config {
+        size_t max_predictions{64};    // slots per call
+        size_t history_slots{32};      // remembered per contract
+        size_t max_contracts{4096};    // contracts with history, and codes with hints
+        size_t max_mapping_bases{8};
+        size_t max_key_words{4};       // calldata arguments tried as mapping keys
+    };
+
+    // What analysis finds in one piece of code
+    struct CodeHints {
+        std::vector<::evm::uint256_t> constant_slots;
+        std::vector<::evm::uint256_t> mapping_bases;
+    };
+
+    SlotPredictor() : SlotPredictor(Config{}) {}
+    explicit SlotPredictor(Config config);
+
+    static SlotPredictor& global() {
+        static SlotPredictor predictor;
+        return predictor;
+    }
+
+    static CodeHints analyze(const AnalyzedCode& code);
+
+    // caller 0 when unknown
+    std::vector<::evm::StorageKey> predict(const AnalyzedCode& code,
+                                           const ::evm::Address& contract,
+                                           std::span<const uint8_t> input,
+                                           const ::evm::uint256_t& caller = ::evm::uint256_t(0));
+
+    // Feeds what a finished call actually touched into the history
+    void record(const ::evm::Address& contract, const ::evm::StorageAccessSet& accessed);
+
+    void clear();
+
+private:
+    struct HashKey {
+        size_t operator()(const Hash256& h) const noexcept {
+            size_t v;
+            std::memcpy(&v, h.data(), sizeof(v));
+            return v;
+        }
+    };
+
+    struct SlotCount {
+        ::evm::uint256_t slot;
+        uint32_t count;
+    };
+
+    std::shared_ptr<const CodeHints> hints_for(const AnalyzedCode& code);
+
+    Config config_;
+    std::mutex mutex_;
+    std::unordered_map<Hash256, std::shared_ptr<const CodeHints>, HashKey> hints_;
+    std::deque<Hash256> hints_order_;  // oldest evicted first
+    std::unordered_map<::evm::Address, std::vector<SlotCount>> history_;
+};
+
+} // namespace evm
+} // namespace quids
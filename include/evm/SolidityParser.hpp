@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <optional>
@@ -61,7 +62,7 @@ struct Token {
     };
     
     Type type;
-    std::string value;
+    std::string_view value;  // into ParseResult::source, or the tokenized text
     size_t line;
     size_t column;
 };
@@ -74,6 +75,7 @@ public:
         std::vector<std::string> warnings;
         bool success;
         std::vector<Token> tokens;
+        std::shared_ptr<const std::string> source;  // what the tokens point into
     };
 
     SolidityParser() = default;
@@ -85,8 +87,10 @@ public:
     SolidityParser(SolidityParser&&) = delete;
     SolidityParser& operator=(SolidityParser&&) = delete;
 
-    // Parse Solidity source code
+    // Parse Solidity source code. Results are kept process-wide by content
+    // hash, so re-checking a source that was seen before costs a lookup.
     ParseResult parse(const std::string& source_code);
+    static void clear_cache();
     
     // Parse a single contract
     std::shared_ptr<ContractDefinition> parse_contract(const std::string& contract_source);
@@ -96,14 +100,15 @@ public:
     
     // Type checking and validation
     bool validate_types(const ASTNode& node);
-    TypeInfo resolve_type(const std::string& type_string);
+    TypeInfo resolve_type(std::string_view type_string);
     
     // Bytecode generation
     std::vector<uint8_t> generate_bytecode(const ASTNode& node);
     
 private:
-    // Lexical analysis
-    std::vector<Token> tokenize(const std::string& source);
+    // Lexical analysis, one pass over the text
+    std::vector<Token> tokenize(std::string_view source);
+    ParseResult parse_uncached(std::shared_ptr<const std::string> source);
     
     // Parsing helpers
     std::shared_ptr<ASTNode> parse_statement();
@@ -125,10 +130,6 @@ private:
     
     std::vector<std::string> errors_;
     std::vector<std::string> warnings_;
-
-    // Implementation details
-    class Impl;
-    std::unique_ptr<Impl> impl_;
 };
 
 } // namespace evm 
\ No newline at end of file
@@ -1,13 +1,19 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
+#include <memory>
 #include "evm/uint256.hpp"
 
 namespace evm {
 
+// Fixed-capacity EVM operand stack. All 1024 slots are allocated once, on
+// a cache-line boundary, so an executor reuses the same stack for every
+// call instead of growing a vector.
 class Stack {
 public:
-    Stack() = default;
+    static constexpr size_t LIMIT = 1024;
+
+    Stack();
     ~Stack() = default;
 
     void push(const uint256_t& value);
@@ -19,8 +25,18 @@ public:
     void clear();
     bool empty() const;
 
+    // Raw slots for the interpreter, which keeps its own top of stack and
+    // checks bounds once per basic block; set_size() publishes it back
+    uint256_t* slots() noexcept { return slots_->items; }
+    void set_size(size_t n) noexcept { size_ = n; }
+
 private:
-    std::vector<uint256_t> items_;
+    struct alignas(64) Slots {
+        uint256_t items[LIMIT];
+    };
+
+    std::unique_ptr<Slots> slots_;
+    size_t size_{0};
 };
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
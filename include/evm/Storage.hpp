@@ -1,14 +1,92 @@
 #pragma once
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <span>
 #include <vector>
 #include "evm/uint256.hpp"
 #include "evm/Address.hpp"
+#include "utils/FlatHashMap.hpp"
 
 namespace evm {
 
+// One storage slot of one contract
+struct StorageKey {
+    Address address;
+    uint256_t slot;
+
+    bool operator==(const StorageKey& other) const {
+        return slot == other.slot && address.bytes == other.address.bytes;
+    }
+};
+
+struct StorageKeyHash {
+    size_t operator()(const StorageKey& key) const noexcept;
+};
+
+struct AddressHash {
+    size_t operator()(const Address& address) const noexcept;
+};
+
+struct SlotRead {
+    uint256_t value;
+    bool warm;  // already accessed in this transaction
+};
+
+struct SlotWrite {
+    uint256_t original;  // value at the start of the transaction
+    uint256_t current;   // value before this write
+    bool warm;
+};
+
+// Slots a transaction touched, for the parallel scheduler. A slot that was
+// written is listed only under writes.
+struct StorageAccessSet {
+    std::vector<StorageKey> reads;
+    std::vector<StorageKey> writes;
+};
+
+// Committed values of the slots a run touched: enough storage to replay
+// it with nothing behind the table. Sorted by key.
+struct SlotWitness {
+    std::vector<std::pair<StorageKey, uint256_t>> slots;
+};
+
+// Committed state behind a Storage, such as the state store on disk. Called
+// from the executor thread and from prefetch threads at once.
+class SlotBackend {
+public:
+    virtual ~SlotBackend() = default;
+    // Values of keys, in order; zero for slots never written
+    virtual std::vector<uint256_t> read(std::span<const StorageKey> keys) = 0;
+};
+
+// Contract storage in a single open-addressing table keyed by (address,
+// slot). Zero values are not stored.
+//
+// The *_for_access calls are what the interpreter uses: they track which
+// slots and accounts are warm (EIP-2929) and the original value of each
+// slot (EIP-2200) for the current transaction, journal every change so
+// revert() can roll back to a snapshot, and log what was accessed.
+// begin_transaction() starts a fresh warm set and journal without walking
+// the old ones. load()/store() are raw state access and are not journalled.
+//
+// With a backend, the table is a cache of the backend's state: a slot read
+// for the first time is fetched from it, and prefetch() starts fetching
+// slots a transaction is expected to read so that it does not wait on them
+// one at a time. A load of a slot already in flight waits for that fetch.
 class Storage {
 public:
+    using Snapshot = size_t;
+
+    struct Stats {
+        uint64_t prefetched{0};       // slots requested ahead of use
+        uint64_t prefetch_waits{0};   // loads that waited on a fetch in flight
+        uint64_t backend_reads{0};    // loads that went to the backend alone
+    };
+
     Storage() = default;
     ~Storage() = default;
 
@@ -20,8 +98,87 @@ public:
     size_t size(const Address& address) const;
     void clear();
 
+    // Transaction-scoped access
+    void begin_transaction();
+    SlotRead load_for_access(const Address& address, const uint256_t& key);
+    SlotWrite store_for_access(const Address& address, const uint256_t& key, const uint256_t& value);
+    // Marks the account warm; returns whether it already was
+    bool warm_account(const Address& address);
+
+    Snapshot snapshot() const { return journal_.size(); }
+    // Undoes every write and warm mark made since the snapshot. The access
+    // log keeps reverted accesses since they were still observed.
+    void revert(Snapshot snapshot);
+
+    StorageAccessSet access_set() const;
+
+    void set_backend(std::shared_ptr<SlotBackend> backend);
+    bool has_backend() const { return backend_ != nullptr; }
+    // Starts fetching the slots that are not cached or in flight yet;
+    // returns how many were requested. No-op without a backend.
+    size_t prefetch(std::span<const StorageKey> keys);
+    Stats stats() const { return stats_; }
+
+    // From begin_witness(), the value each slot has when a transaction
+    // first touches it is kept unless one was already; since every write
+    // touches first, that is the value before the run
+    void begin_witness();
+    SlotWitness take_witness();
+    // Replaces the table with `witness` and nothing else: a transaction
+    // touching a slot outside it throws std::out_of_range. Lasts until
+    // clear().
+    void load_witness(const SlotWitness& witness);
+
 private:
-    std::map<Address, std::map<uint256_t, uint256_t>> storage_;
+    struct SlotState {
+        uint32_t epoch{0};  // transaction that last warmed the slot; 0 is never current
+        uint32_t write_logged{0};  // transaction whose access log already has a write
+        uint256_t original;
+    };
+
+    struct JournalEntry {
+        enum Kind : uint8_t { Value, WarmSlot, WarmAccount } kind;
+        StorageKey key;
+        uint256_t previous;  // for Value
+    };
+
+    struct Access {
+        StorageKey key;
+        bool write;
+    };
+
+    struct PendingFetch {
+        std::vector<StorageKey> keys;
+        std::future<std::vector<uint256_t>> values;
+    };
+
+    // Warms the slot if needed; returns its state and whether it was warm
+    SlotState& touch(const StorageKey& key, bool& was_warm);
+    void assign(const StorageKey& key, const uint256_t& value);
+    // Brings a slot the table does not know into it, from a fetch in
+    // flight or from the backend
+    void fetch(const StorageKey& key) const;
+    void complete_pending() const;
+
+    mutable quids::utils::FlatHashMap<StorageKey, uint256_t, StorageKeyHash> values_;  // filled by fetch()
+    quids::utils::FlatHashMap<StorageKey, SlotState, StorageKeyHash> slots_;
+    quids::utils::FlatHashMap<Address, uint32_t, AddressHash> accounts_;
+    std::vector<JournalEntry> journal_;
+    std::vector<Access> accesses_;
+    uint32_t epoch_{1};
+
+    // Backend cache state. Mutable because load() fills it; a Storage is
+    // still used by one thread at a time.
+    std::shared_ptr<SlotBackend> backend_;
+    mutable quids::utils::FlatHashMap<StorageKey, uint8_t, StorageKeyHash> resident_;  // known, zero or not
+    mutable quids::utils::FlatHashMap<StorageKey, uint8_t, StorageKeyHash> in_flight_;
+    mutable std::vector<PendingFetch> pending_;
+    mutable Stats stats_;
+
+    bool recording_{false};
+    quids::utils::FlatHashMap<StorageKey, uint256_t, StorageKeyHash> witness_;
+    bool sealed_{false};
+    quids::utils::FlatHashMap<StorageKey, uint8_t, StorageKeyHash> covered_;
 };
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
@@ -1,6 +1,3 @@
 #pragma once
-#include <cstdint>
 
-namespace evm {
-    using uint256_t = unsigned __int128;  // Or use boost::multiprecision::uint256_t
-} 
\ No newline at end of file
+#include "evm/uint256.hpp"
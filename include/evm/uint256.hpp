@@ -1,16 +1,592 @@
 #pragma once
 
-#include <ios>
-#include <iomanip>
-#include <iostream>
-#include <string>
+#include <array>
+#include <bit>
+#include <compare>
+#include <cstddef>
 #include <cstdint>
-#include <boost/multiprecision/cpp_int.hpp>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "utils/Int128.hpp"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
 
 namespace evm {
 
-using uint256_t = boost::multiprecision::uint256_t;
+namespace detail {
+
+// Limb primitives. Each has a portable constexpr path; the intrinsic forms
+// are only taken outside constant evaluation.
+
+constexpr uint64_t addc(uint64_t a, uint64_t b, uint64_t& carry) noexcept {
+#if defined(QUIDS_HAS_INT128)
+    const quids::utils::u128 s = static_cast<quids::utils::u128>(a) + b + carry;
+    carry = static_cast<uint64_t>(s >> 64);
+    return static_cast<uint64_t>(s);
+#else
+#if defined(_MSC_VER) && defined(_M_X64)
+    if (!std::is_constant_evaluated()) {
+        unsigned long long out;
+        carry = _addcarry_u64(static_cast<unsigned char>(carry), a, b, &out);
+        return out;
+    }
+#endif
+    const uint64_t s = a + b;
+    const uint64_t r = s + carry;
+    carry = static_cast<uint64_t>(s < a) | static_cast<uint64_t>(r < s);
+    return r;
+#endif
+}
+
+constexpr uint64_t subb(uint64_t a, uint64_t b, uint64_t& borrow) noexcept {
+#if defined(_MSC_VER) && defined(_M_X64)
+    if (!std::is_constant_evaluated()) {
+        unsigned long long out;
+        borrow = _subborrow_u64(static_cast<unsigned char>(borrow), a, b, &out);
+        return out;
+    }
+#endif
+    const uint64_t d = a - b;
+    const uint64_t r = d - borrow;
+    borrow = static_cast<uint64_t>(a < b) | static_cast<uint64_t>(d < borrow);
+    return r;
+}
+
+// Full 64x64 -> 128 product
+constexpr uint64_t umul(uint64_t a, uint64_t b, uint64_t& hi) noexcept {
+#if defined(QUIDS_HAS_INT128)
+    const quids::utils::u128 p = static_cast<quids::utils::u128>(a) * b;
+    hi = static_cast<uint64_t>(p >> 64);
+    return static_cast<uint64_t>(p);
+#else
+#if defined(_MSC_VER) && defined(_M_X64)
+    if (!std::is_constant_evaluated()) {
+        unsigned long long h;
+        const unsigned long long lo = _umul128(a, b, &h);
+        hi = h;
+        return lo;
+    }
+#endif
+    const uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+    const uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+    const uint64_t ll = a_lo * b_lo;
+    const uint64_t lh = a_lo * b_hi;
+    const uint64_t hl = a_hi * b_lo;
+    const uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+    hi = a_hi * b_hi + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return (mid << 32) | (ll & 0xffffffff);
+#endif
+}
+
+// (hi:lo) / d with hi < d, so the quotient fits in 64 bits
+constexpr uint64_t udiv128(uint64_t hi, uint64_t lo, uint64_t d, uint64_t& rem) noexcept {
+    if (!std::is_constant_evaluated()) {
+#if defined(__GNUC__) && defined(__x86_64__)
+        uint64_t q, r;
+        __asm__("divq %4" : "=a"(q), "=d"(r) : "a"(lo), "d"(hi), "r"(d));
+        rem = r;
+        return q;
+#elif defined(_MSC_VER) && defined(_M_X64) && _MSC_VER >= 1920
+        unsigned long long r;
+        const unsigned long long q = _udiv128(hi, lo, d, &r);
+        rem = r;
+        return q;
+#endif
+    }
+#if defined(QUIDS_HAS_INT128)
+    const quids::utils::u128 n = (static_cast<quids::utils::u128>(hi) << 64) | lo;
+    rem = static_cast<uint64_t>(n % d);
+    return static_cast<uint64_t>(n / d);
+#else
+    uint64_t q = 0;
+    for (int i = 0; i < 64; ++i) {
+        const uint64_t top = hi >> 63;
+        hi = (hi << 1) | (lo >> 63);
+        lo <<= 1;
+        q <<= 1;
+        if (top || hi >= d) {
+            hi -= d;
+            q |= 1;
+        }
+    }
+    rem = hi;
+    return q;
+#endif
+}
+
+constexpr uint64_t bswap(uint64_t v) noexcept {
+    if (!std::is_constant_evaluated()) {
+#if defined(__GNUC__)
+        return __builtin_bswap64(v);
+#elif defined(_MSC_VER)
+        return _byteswap_uint64(v);
+#endif
+    }
+    uint64_t r = 0;
+    for (int i = 0; i < 8; ++i) {
+        r = (r << 8) | ((v >> (8 * i)) & 0xff);
+    }
+    return r;
+}
+
+// Knuth algorithm D. u has m limbs, v has n limbs with v[n-1] != 0 and
+// m >= n; q receives m - n + 1 limbs and r receives n limbs.
+constexpr void udivrem(const uint64_t* u, int m, const uint64_t* v, int n,
+                       uint64_t* q, uint64_t* r) noexcept {
+    if (n == 1) {
+        uint64_t rem = 0;
+        for (int i = m - 1; i >= 0; --i) {
+            q[i] = udiv128(rem, u[i], v[0], rem);
+        }
+        r[0] = rem;
+        return;
+    }
+
+    // Normalise so the divisor's top bit is set
+    const int s = std::countl_zero(v[n - 1]);
+    uint64_t vn[8] = {};
+    uint64_t un[9] = {};
+    for (int i = n - 1; i > 0; --i) {
+        vn[i] = (v[i] << s) | (s ? v[i - 1] >> (64 - s) : 0);
+    }
+    vn[0] = v[0] << s;
+    un[m] = s ? u[m - 1] >> (64 - s) : 0;
+    for (int i = m - 1; i > 0; --i) {
+        un[i] = (u[i] << s) | (s ? u[i - 1] >> (64 - s) : 0);
+    }
+    un[0] = u[0] << s;
+
+    const uint64_t top = vn[n - 1];
+    for (int j = m - n; j >= 0; --j) {
+        uint64_t qhat, rhat;
+        bool rhat_overflow = false;
+        if (un[j + n] >= top) {
+            // Only equality is possible; the estimate saturates
+            qhat = ~uint64_t{0};
+            rhat = un[j + n - 1] + top;
+            rhat_overflow = rhat < top;
+        } else {
+            qhat = udiv128(un[j + n], un[j + n - 1], top, rhat);
+        }
+        while (!rhat_overflow) {
+            uint64_t p_hi;
+            const uint64_t p_lo = umul(qhat, vn[n - 2], p_hi);
+            if (p_hi < rhat || (p_hi == rhat && p_lo <= un[j + n - 2])) {
+                break;
+            }
+            --qhat;
+            rhat += top;
+            rhat_overflow = rhat < top;
+        }
+
+        // un[j .. j+n] -= qhat * vn
+        uint64_t borrow = 0;
+        uint64_t carry = 0;
+        for (int i = 0; i < n; ++i) {
+            uint64_t p_hi;
+            uint64_t p_lo = umul(qhat, vn[i], p_hi);
+            p_lo += carry;
+            p_hi += p_lo < carry;
+            carry = p_hi;
+            un[i + j] = subb(un[i + j], p_lo, borrow);
+        }
+        un[j + n] = subb(un[j + n], carry, borrow);
+
+        if (borrow) {
+            // Estimate was one too high; add the divisor back
+            --qhat;
+            uint64_t c = 0;
+            for (int i = 0; i < n; ++i) {
+                un[i + j] = addc(un[i + j], vn[i], c);
+            }
+            un[j + n] += c;
+        }
+        q[j] = qhat;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        r[i] = (un[i] >> s) | (s ? un[i + 1] << (64 - s) : 0);
+    }
+}
+
+constexpr int significant_limbs(const uint64_t* v, int n) noexcept {
+    while (n > 0 && v[n - 1] == 0) --n;
+    return n;
+}
+
+} // namespace detail
+
+// 256-bit unsigned integer with EVM (mod 2^256) arithmetic, stored as four
+// little-endian 64-bit limbs. Trivially copyable, so the interpreter stack
+// and storage maps move it with plain 32-byte copies.
+class uint256_t {
+public:
+    std::array<uint64_t, 4> limbs{};  // limbs[0] is least significant
+
+    constexpr uint256_t() noexcept = default;
+
+    // Negative values wrap to their two's complement, as in the EVM
+    template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr uint256_t(T v) noexcept {
+        const uint64_t fill = (std::is_signed_v<T> && v < 0) ? ~uint64_t{0} : 0;
+        limbs = {static_cast<uint64_t>(v), fill, fill, fill};
+    }
+
+    // Decimal, or hexadecimal with a 0x prefix
+    explicit uint256_t(std::string_view text) : uint256_t(parse(text)) {}
+
+    static constexpr uint256_t from_limbs(uint64_t l0, uint64_t l1, uint64_t l2, uint64_t l3) noexcept {
+        uint256_t v;
+        v.limbs = {l0, l1, l2, l3};
+        return v;
+    }
+
+    static constexpr uint256_t max() noexcept {
+        return from_limbs(~uint64_t{0}, ~uint64_t{0}, ~uint64_t{0}, ~uint64_t{0});
+    }
+
+    // 32 big-endian bytes, as stored in EVM memory and calldata
+    static uint256_t load_be(const uint8_t* data) noexcept {
+        uint256_t v;
+        for (size_t i = 0; i < 4; ++i) {
+            uint64_t word;
+            std::memcpy(&word, data + 8 * (3 - i), sizeof(word));
+            v.limbs[i] = to_big_endian(word);
+        }
+        return v;
+    }
+
+    // n <= 32 big-endian bytes as the low end of the value
+    static uint256_t load_be(const uint8_t* data, size_t n) noexcept {
+        if (n == 32) return load_be(data);
+        uint8_t buf[32] = {};
+        std::memcpy(buf + 32 - n, data, n);
+        return load_be(buf);
+    }
+
+    void store_be(uint8_t* out) const noexcept {
+        for (size_t i = 0; i < 4; ++i) {
+            const uint64_t word = to_big_endian(limbs[i]);
+            std::memcpy(out + 8 * (3 - i), &word, sizeof(word));
+        }
+    }
+
+    // Truncates to the low bits, like a C++ narrowing conversion
+    template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    explicit constexpr operator T() const noexcept {
+        return static_cast<T>(limbs[0]);
+    }
+
+    explicit constexpr operator bool() const noexcept { return !is_zero(); }
+
+    constexpr bool is_zero() const noexcept {
+        return (limbs[0] | limbs[1] | limbs[2] | limbs[3]) == 0;
+    }
+
+    constexpr bool fits_u64() const noexcept {
+        return (limbs[1] | limbs[2] | limbs[3]) == 0;
+    }
+
+    constexpr bool bit(unsigned n) const noexcept {
+        return n < 256 && ((limbs[n / 64] >> (n % 64)) & 1);
+    }
+
+    // Number of significant bits; 0 for zero
+    constexpr unsigned bit_width() const noexcept {
+        for (int i = 3; i >= 0; --i) {
+            if (limbs[i]) {
+                return 64 * static_cast<unsigned>(i) + static_cast<unsigned>(std::bit_width(limbs[i]));
+            }
+        }
+        return 0;
+    }
+
+    constexpr unsigned byte_width() const noexcept { return (bit_width() + 7) / 8; }
+
+    std::string to_string() const {
+        if (is_zero()) return "0";
+        // Peel off 19 decimal digits per short division
+        constexpr uint64_t CHUNK = 10000000000000000000ull;
+        std::string out;
+        uint256_t v = *this;
+        while (!v.is_zero()) {
+            uint64_t rem = 0;
+            for (int i = 3; i >= 0; --i) {
+                v.limbs[i] = detail::udiv128(rem, v.limbs[i], CHUNK, rem);
+            }
+            for (int d = 0; d < 19 && (rem || !v.is_zero()); ++d) {
+                out.push_back(static_cast<char>('0' + rem % 10));
+                rem /= 10;
+            }
+        }
+        return std::string(out.rbegin(), out.rend());
+    }
+
+    std::string to_hex() const {
+        static constexpr char DIGITS[] = "0123456789abcdef";
+        if (is_zero()) return "0";
+        std::string out;
+        for (unsigned nibble = (bit_width() + 3) / 4; nibble-- > 0;) {
+            out.push_back(DIGITS[(limbs[nibble / 16] >> (4 * (nibble % 16))) & 0xf]);
+        }
+        return out;
+    }
+
+    // Arithmetic wraps modulo 2^256
+    friend constexpr uint256_t operator+(const uint256_t& a, const uint256_t& b) noexcept {
+        uint256_t r;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < 4; ++i) r.limbs[i] = detail::addc(a.limbs[i], b.limbs[i], carry);
+        return r;
+    }
+
+    friend constexpr uint256_t operator-(const uint256_t& a, const uint256_t& b) noexcept {
+        uint256_t r;
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < 4; ++i) r.limbs[i] = detail::subb(a.limbs[i], b.limbs[i], borrow);
+        return r;
+    }
+
+    friend constexpr uint256_t operator*(const uint256_t& a, const uint256_t& b) noexcept {
+        // Schoolbook, dropping every partial product above 2^256
+        uint256_t r;
+        for (size_t i = 0; i < 4; ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; i + j < 4; ++j) {
+                uint64_t hi;
+                uint64_t lo = detail::umul(a.limbs[i], b.limbs[j], hi);
+                uint64_t c = 0;
+                lo = detail::addc(lo, carry, c);
+                hi += c;
+                c = 0;
+                r.limbs[i + j] = detail::addc(r.limbs[i + j], lo, c);
+                carry = hi + c;
+            }
+        }
+        return r;
+    }
+
+    friend constexpr uint256_t operator/(const uint256_t& a, const uint256_t& b) {
+        return divmod(a, b).first;
+    }
+
+    friend constexpr uint256_t operator%(const uint256_t& a, const uint256_t& b) {
+        return divmod(a, b).second;
+    }
+
+    // Throws std::overflow_error when b is zero; the EVM's x/0 == 0 is up
+    // to the caller
+    friend constexpr std::pair<uint256_t, uint256_t> divmod(const uint256_t& a, const uint256_t& b) {
+        const int n = detail::significant_limbs(b.limbs.data(), 4);
+        if (n == 0) {
+            throw std::overflow_error("Division by zero");
+        }
+        if (a < b) {
+            return {uint256_t{}, a};
+        }
+        if (n == 1 && a.fits_u64()) {
+            return {uint256_t(a.limbs[0] / b.limbs[0]), uint256_t(a.limbs[0] % b.limbs[0])};
+        }
+        const int m = detail::significant_limbs(a.limbs.data(), 4);
+        uint256_t q, r;
+        detail::udivrem(a.limbs.data(), m, b.limbs.data(), n, q.limbs.data(), r.limbs.data());
+        return {q, r};
+    }
+
+    friend constexpr uint256_t operator-(const uint256_t& a) noexcept { return uint256_t{} - a; }
+
+    friend constexpr uint256_t operator~(const uint256_t& a) noexcept {
+        return from_limbs(~a.limbs[0], ~a.limbs[1], ~a.limbs[2], ~a.limbs[3]);
+    }
+
+    friend constexpr uint256_t operator&(const uint256_t& a, const uint256_t& b) noexcept {
+        return from_limbs(a.limbs[0] & b.limbs[0], a.limbs[1] & b.limbs[1],
+                          a.limbs[2] & b.limbs[2], a.limbs[3] & b.limbs[3]);
+    }
+
+    friend constexpr uint256_t operator|(const uint256_t& a, const uint256_t& b) noexcept {
+        return from_limbs(a.limbs[0] | b.limbs[0], a.limbs[1] | b.limbs[1],
+                          a.limbs[2] | b.limbs[2], a.limbs[3] | b.limbs[3]);
+    }
+
+    friend constexpr uint256_t operator^(const uint256_t& a, const uint256_t& b) noexcept {
+        return from_limbs(a.limbs[0] ^ b.limbs[0], a.limbs[1] ^ b.limbs[1],
+                          a.limbs[2] ^ b.limbs[2], a.limbs[3] ^ b.limbs[3]);
+    }
+
+    // Shifts of 256 or more give zero. A negative count is a bug and throws.
+    template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    friend constexpr uint256_t operator<<(const uint256_t& a, T n) {
+        return a.shl(checked_shift(n));
+    }
+
+    template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    friend constexpr uint256_t operator>>(const uint256_t& a, T n) {
+        return a.shr(checked_shift(n));
+    }
+
+    constexpr uint256_t shl(uint64_t n) const noexcept {
+        if (n >= 256) return {};
+        const int limb = static_cast<int>(n / 64);
+        const unsigned bits = n % 64;
+        uint256_t r;
+        for (int i = 3; i >= limb; --i) {
+            uint64_t v = limbs[i - limb] << bits;
+            if (bits && i > limb) v |= limbs[i - limb - 1] >> (64 - bits);
+            r.limbs[i] = v;
+        }
+        return r;
+    }
+
+    constexpr uint256_t shr(uint64_t n) const noexcept {
+        if (n >= 256) return {};
+        const size_t limb = n / 64;
+        const unsigned bits = n % 64;
+        uint256_t r;
+        for (size_t i = 0; i + limb < 4; ++i) {
+            uint64_t v = limbs[i + limb] >> bits;
+            if (bits && i + limb + 1 < 4) v |= limbs[i + limb + 1] << (64 - bits);
+            r.limbs[i] = v;
+        }
+        return r;
+    }
+
+    constexpr uint256_t& operator+=(const uint256_t& o) noexcept { return *this = *this + o; }
+    constexpr uint256_t& operator-=(const uint256_t& o) noexcept { return *this = *this - o; }
+    constexpr uint256_t& operator*=(const uint256_t& o) noexcept { return *this = *this * o; }
+    constexpr uint256_t& operator/=(const uint256_t& o) { return *this = *this / o; }
+    constexpr uint256_t& operator%=(const uint256_t& o) { return *this = *this % o; }
+    constexpr uint256_t& operator&=(const uint256_t& o) noexcept { return *this = *this & o; }
+    constexpr uint256_t& operator|=(const uint256_t& o) noexcept { return *this = *this | o; }
+    constexpr uint256_t& operator^=(const uint256_t& o) noexcept { return *this = *this ^ o; }
+
+    template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr uint256_t& operator<<=(T n) { return *this = *this << n; }
+
+    template<typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr uint256_t& operator>>=(T n) { return *this = *this >> n; }
+
+    constexpr uint256_t& operator++() noexcept { return *this += 1; }
+    constexpr uint256_t& operator--() noexcept { return *this -= 1; }
+
+    friend constexpr bool operator==(const uint256_t& a, const uint256_t& b) noexcept {
+        return a.limbs == b.limbs;
+    }
+
+    friend constexpr std::strong_ordering operator<=>(const uint256_t& a, const uint256_t& b) noexcept {
+        for (int i = 3; i >= 0; --i) {
+            if (a.limbs[i] != b.limbs[i]) {
+                return a.limbs[i] < b.limbs[i] ? std::strong_ordering::less : std::strong_ordering::greater;
+            }
+        }
+        return std::strong_ordering::equal;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const uint256_t& v) {
+        return os << ((os.flags() & std::ios_base::hex) ? v.to_hex() : v.to_string());
+    }
+
+private:
+    static uint64_t to_big_endian(uint64_t v) noexcept {
+        if constexpr (std::endian::native == std::endian::little) {
+            return detail::bswap(v);
+        } else {
+            return v;
+        }
+    }
+
+    template<typename T>
+    static constexpr uint64_t checked_shift(T n) {
+        if constexpr (std::is_signed_v<T>) {
+            if (n < 0) throw std::runtime_error("Negative shift");
+        }
+        return static_cast<uint64_t>(n);
+    }
+
+    static uint256_t parse(std::string_view text) {
+        if (text.empty()) throw std::invalid_argument("Empty uint256 literal");
+        uint256_t v;
+        const bool hex = text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+        if (hex) text.remove_prefix(2);
+        const unsigned base = hex ? 16 : 10;
+        for (char c : text) {
+            unsigned digit;
+            if (c >= '0' && c <= '9') digit = static_cast<unsigned>(c - '0');
+            else if (hex && c >= 'a' && c <= 'f') digit = static_cast<unsigned>(c - 'a' + 10);
+            else if (hex && c >= 'A' && c <= 'F') digit = static_cast<unsigned>(c - 'A' + 10);
+            else throw std::invalid_argument("Invalid uint256 literal");
+            if (v > (max() - digit) / base) throw std::out_of_range("uint256 literal out of range");
+            v = v * base + digit;
+        }
+        return v;
+    }
+};
+
+static_assert(sizeof(uint256_t) == 32);
+static_assert(std::is_trivially_copyable_v<uint256_t>);
+
+// (a + b) % m and (a * b) % m without wrapping the intermediate; zero when
+// m is zero, as the EVM defines
+constexpr uint256_t addmod(const uint256_t& a, const uint256_t& b, const uint256_t& m) noexcept {
+    const int n = detail::significant_limbs(m.limbs.data(), 4);
+    if (n == 0) return {};
+    uint64_t sum[5];
+    uint64_t carry = 0;
+    for (size_t i = 0; i < 4; ++i) sum[i] = detail::addc(a.limbs[i], b.limbs[i], carry);
+    sum[4] = carry;
+    const int len = detail::significant_limbs(sum, 5);
+    if (len < n) return uint256_t::from_limbs(sum[0], sum[1], sum[2], sum[3]);
+    uint64_t q[5] = {};
+    uint256_t r;
+    detail::udivrem(sum, len, m.limbs.data(), n, q, r.limbs.data());
+    return r;
+}
+
+constexpr uint256_t mulmod(const uint256_t& a, const uint256_t& b, const uint256_t& m) noexcept {
+    const int n = detail::significant_limbs(m.limbs.data(), 4);
+    if (n == 0) return {};
+    uint64_t prod[8] = {};
+    for (size_t i = 0; i < 4; ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < 4; ++j) {
+            uint64_t hi;
+            uint64_t lo = detail::umul(a.limbs[i], b.limbs[j], hi);
+            uint64_t c = 0;
+            lo = detail::addc(lo, carry, c);
+            hi += c;
+            c = 0;
+            prod[i + j] = detail::addc(prod[i + j], lo, c);
+            carry = hi + c;
+        }
+        prod[i + 4] = carry;
+    }
+    const int len = detail::significant_limbs(prod, 8);
+    if (len < n) return uint256_t::from_limbs(prod[0], prod[1], prod[2], prod[3]);
+    uint64_t q[8] = {};
+    uint256_t r;
+    detail::udivrem(prod, len, m.limbs.data(), n, q, r.limbs.data());
+    return r;
+}
+
+// base^exponent mod 2^256 by square-and-multiply
+constexpr uint256_t exp(uint256_t base, const uint256_t& exponent) noexcept {
+    uint256_t result = 1;
+    const unsigned bits = exponent.bit_width();
+    for (unsigned i = 0; i < bits; ++i) {
+        if (exponent.bit(i)) result *= base;
+        base *= base;
+    }
+    return result;
+}
 
 class Uint256 {
 private:
@@ -34,7 +610,40 @@ public:
     bool operator<(const Uint256& other) const { return value_ < other.value_; }
     bool operator>(const Uint256& other) const { return value_ > other.value_; }
 
-    std::string to_string() const { return value_.str(); }
+    std::string to_string() const { return value_.to_string(); }
 };
 
 } // namespace evm
+
+namespace std {
+
+template<>
+struct hash<evm::uint256_t> {
+    size_t operator()(const evm::uint256_t& v) const noexcept {
+        uint64_t h = v.limbs[0];
+        for (size_t i = 1; i < 4; ++i) {
+            h ^= v.limbs[i] + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+template<>
+class numeric_limits<evm::uint256_t> {
+public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = false;
+    static constexpr bool is_integer = true;
+    static constexpr bool is_exact = true;
+    static constexpr bool is_bounded = true;
+    static constexpr bool is_modulo = true;
+    static constexpr int digits = 256;
+    static constexpr int digits10 = 77;
+    static constexpr int radix = 2;
+
+    static constexpr evm::uint256_t min() noexcept { return {}; }
+    static constexpr evm::uint256_t lowest() noexcept { return {}; }
+    static constexpr evm::uint256_t max() noexcept { return evm::uint256_t::max(); }
+};
+
+} // namespace std
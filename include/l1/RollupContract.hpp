@@ -6,6 +6,7 @@
 #include <array>
 #include "rollup/StateManager.hpp"
 #include "rollup/RollupStateTransition.hpp"
+#include "rollup/WithdrawalBatcher.hpp"
 
 class RollupContract {
 public:
@@ -33,15 +34,21 @@ public:
 
     explicit RollupContract(const ContractConfig& config);
 
-    // State commitment
+    // State commitment. withdrawal_root is the root of the withdrawal
+    // batch sealed with this state (WithdrawalBatcher::seal), all zero
+    // when there is none; L1 keeps it by batch number for claims.
     bool submit_state_commitment(
         const std::array<uint8_t, 32>& state_root,
-        const StateTransitionProof& proof
+        const StateTransitionProof& proof,
+        uint64_t withdrawal_batch = 0,
+        const std::array<uint8_t, 32>& withdrawal_root = {}
     );
 
-    // Deposits and withdrawals
+    // Deposits and withdrawals. Withdrawals are not sent one by one: the
+    // user claims against a committed batch root with the inclusion proof
+    // from WithdrawalBatcher::claim. L1 pays out once per withdrawal id.
     std::vector<DepositEvent> get_pending_deposits();
-    bool process_withdrawal(const WithdrawalEvent& withdrawal);
+    bool claim_withdrawal(const quids::rollup::WithdrawalBatcher::Claim& claim);
     
     // Fraud proof
     bool submit_fraud_proof(
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace quids::memory {
+
+// Bump allocator for objects that all die together, typically everything
+// built while one batch is executed. deallocate() is a no-op; reset()
+// rewinds to the first chunk and keeps the chunks for the next batch, so a
+// steady-state batch does no system allocation at all. Not thread-safe:
+// give each batch builder its own arena.
+//
+// Usable directly or as a std::pmr::memory_resource for pmr containers.
+class MonotonicArena : public std::pmr::memory_resource {
+public:
+    struct Stats {
+        size_t chunks{0};
+        size_t reserved_bytes{0};
+        size_t used_bytes{0};      // since the last reset
+        size_t peak_bytes{0};      // largest used_bytes seen at a reset
+        uint64_t resets{0};
+    };
+
+    explicit MonotonicArena(size_t chunk_size = 64 * 1024)
+        : chunk_size_(std::max<size_t>(chunk_size, 256)) {}
+
+    ~MonotonicArena() override {
+        for (auto& chunk : chunks_) {
+            ::operator delete(chunk.data, std::align_val_t(alignof(std::max_align_t)));
+        }
+    }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* allocate_bytes(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+        return do_allocate(bytes, alignment);
+    }
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "reset() runs no destructors; use MemoryPool for T");
+        return ::new (do_allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Invalidates everything handed out since the previous reset
+    void reset() noexcept {
+        stats_.peak_bytes = std::max(stats_.peak_bytes, stats_.used_bytes);
+        stats_.used_bytes = 0;
+        stats_.resets++;
+        current_ = 0;
+        offset_ = 0;
+    }
+
+    const Stats& stats() const noexcept { return stats_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        alignment = std::max<size_t>(alignment, 1);
+        while (true) {
+            if (current_ < chunks_.size()) {
+                Chunk& chunk = chunks_[current_];
+                const auto base = reinterpret_cast<uintptr_t>(chunk.data);
+                const size_t start = ((base + offset_ + alignment - 1) & ~(alignment - 1)) - base;
+                if (start + bytes <= chunk.size) {
+                    offset_ = start + bytes;
+                    stats_.used_bytes += bytes;
+                    return chunk.data + start;
+                }
+                // Try the next retained chunk before growing
+                if (current_ + 1 < chunks_.size()) {
+                    current_++;
+                    offset_ = 0;
+                    continue;
+                }
+            }
+            add_chunk(bytes + alignment);
+        }
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    struct Chunk {
+        unsigned char* data;
+        size_t size;
+    };
+
+    void add_chunk(size_t at_least) {
+        const size_t size = std::max(chunk_size_, at_least);
+        auto* data = static_cast<unsigned char*>(
+            ::operator new(size, std::align_val_t(alignof(std::max_align_t))));
+        chunks_.push_back(Chunk{data, size});
+        current_ = chunks_.size() - 1;
+        offset_ = 0;
+        stats_.chunks++;
+        stats_.reserved_bytes += size;
+    }
+
+    size_t chunk_size_;
+    std::vector<Chunk> chunks_;
+    size_t current_{0};
+    size_t offset_{0};
+    Stats stats_;
+};
+
+} // namespace quids::memory
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace quids::memory {
+
+// NUMA topology as far as placement needs it. Pinned pool workers
+// (WorkStealingPool::Config::pin_threads) stay on one node, so what they
+// allocate and touch first stays local to them.
+namespace numa {
+
+// Nodes the kernel reports online; 1 where there is no NUMA information
+inline size_t node_count() {
+    static const size_t count = [] {
+        size_t highest = 0;
+#if defined(__linux__)
+        // A list of ranges such as "0-1" or "0,2-3"
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string list;
+        if (online >> list) {
+            size_t value = 0;
+            for (char c : list + ",") {
+                if (c >= '0' && c <= '9') {
+                    value = value * 10 + static_cast<size_t>(c - '0');
+                } else {
+                    highest = std::max(highest, value);
+                    value = 0;
+                }
+            }
+        }
+#endif
+        return highest + 1;
+    }();
+    return count;
+}
+
+// Node of the CPU the caller runs on right now
+inline size_t current_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return node;
+    }
+#endif
+    return 0;
+}
+
+inline size_t node_of_cpu(size_t cpu) {
+#if defined(__linux__)
+    std::error_code ec;
+    const std::filesystem::path dir("/sys/devices/system/cpu/cpu" + std::to_string(cpu));
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        const auto name = entry.path().filename().string();
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+            name.find_first_not_of("0123456789", 4) == std::string::npos) {
+            return std::stoul(name.substr(4));
+        }
+    }
+#else
+    (void)cpu;
+#endif
+    return 0;
+}
+
+} // namespace numa
+
+constexpr size_t HUGE_PAGE_SIZE = size_t{2} << 20;
+
+enum class PagePolicy : uint8_t {
+    Default,      // whatever the kernel picks
+    Transparent,  // 2 MiB aligned and advised for transparent huge pages
+    HugeTlb       // the reserved hugetlbfs pool, else as Transparent
+};
+
+struct Placement {
+    PagePolicy pages{PagePolicy::Transparent};
+    // Preferred node; -1 leaves it to first touch, i.e. the node of the
+    // thread that writes each page first
+    int node{-1};
+};
+
+// Asks for transparent huge pages over the 2 MiB aligned part of a range
+// that is not touched yet, such as a freshly allocated vector. A no-op
+// for ranges too small to hold one huge page.
+inline void advise_huge_pages(void* data, size_t bytes) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    const auto begin = (reinterpret_cast<uintptr_t>(data) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    const auto end = (reinterpret_cast<uintptr_t>(data) + bytes) & ~(HUGE_PAGE_SIZE - 1);
+    if (end > begin) {
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+    }
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
+
+// A large, long-lived, zero-filled mapping placed by a Placement.
+//
+// Nothing is touched here: pages materialize where they are first written,
+// so the owner should initialize the buffer from the threads that will use
+// it, or name a node. Huge pages are a request, not a guarantee;
+// hugetlb() tells whether the reserved pool served it.
+class LargeBuffer {
+public:
+    LargeBuffer() = default;
+
+    LargeBuffer(size_t bytes, const Placement& placement) : size_(bytes) {
+        if (bytes == 0) {
+            return;
+        }
+#if defined(__linux__)
+        // Below one huge page it would only round the footprint up
+        const bool huge = placement.pages != PagePolicy::Default && bytes >= HUGE_PAGE_SIZE;
+        mapped_ = huge ? round_up(bytes, HUGE_PAGE_SIZE) : bytes;
+#if defined(MAP_HUGETLB)
+        if (huge && placement.pages == PagePolicy::HugeTlb) {
+            void* p = ::mmap(nullptr, mapped_, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                data_ = static_cast<uint8_t*>(p);
+                hugetlb_ = true;
+            }
+        }
+#endif
+        if (!data_) {
+            // Over-map by a huge page and trim, so the buffer starts on a
+            // boundary THP can back
+            const size_t slack = huge ? HUGE_PAGE_SIZE : 0;
+            void* p = ::mmap(nullptr, mapped_ + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            auto* raw = static_cast<uint8_t*>(p);
+            data_ = huge ? reinterpret_cast<uint8_t*>(round_up(reinterpret_cast<uintptr_t>(raw), HUGE_PAGE_SIZE))
+                         : raw;
+            if (data_ > raw) {
+                ::munmap(raw, static_cast<size_t>(data_ - raw));
+            }
+            if (const size_t tail = slack - static_cast<size_t>(data_ - raw); tail > 0) {
+                ::munmap(data_ + mapped_, tail);
+            }
+            if (huge) {
+                advise_huge_pages(data_, mapped_);
+            }
+        }
+        if (placement.node >= 0) {
+            prefer_node(static_cast<size_t>(placement.node));
+        }
+#else
+        (void)placement;
+        mapped_ = bytes;
+        data_ = new uint8_t[bytes]();
+#endif
+    }
+
+    explicit LargeBuffer(size_t bytes) : LargeBuffer(bytes, Placement{}) {}
+
+    ~LargeBuffer() { reset(); }
+
+    LargeBuffer(LargeBuffer&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          mapped_(std::exchange(other.mapped_, 0)),
+          hugetlb_(std::exchange(other.hugetlb_, false)) {}
+
+    LargeBuffer& operator=(LargeBuffer&& other) noexcept {
+        if (this != &other) {
+            reset();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            mapped_ = std::exchange(other.mapped_, 0);
+            hugetlb_ = std::exchange(other.hugetlb_, false);
+        }
+        return *this;
+    }
+
+    LargeBuffer(const LargeBuffer&) = delete;
+    LargeBuffer& operator=(const LargeBuffer&) = delete;
+
+    [[nodiscard]] uint8_t* data() noexcept { return data_; }
+    [[nodiscard]] const uint8_t* data() const noexcept { return data_; }
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool hugetlb() const noexcept { return hugetlb_; }
+
+private:
+    static constexpr uintptr_t round_up(uintptr_t n, uintptr_t to) { return (n + to - 1) & ~(to - 1); }
+
+    void prefer_node(size_t node) {
+#if defined(__linux__) && defined(SYS_mbind)
+        // MPOL_PREFERRED: the node while it has room, elsewhere rather than fail
+        constexpr int MPOL_PREFERRED_MODE = 1;
+        constexpr size_t MASK_BITS = 8 * sizeof(unsigned long);
+        // The kernel reads one bit fewer than maxnode
+        if (node + 1 >= MASK_BITS) {
+            return;
+        }
+        unsigned long mask = 1UL << node;
+        ::syscall(SYS_mbind, data_, mapped_, MPOL_PREFERRED_MODE, &mask, MASK_BITS, 0);
+#else
+        (void)node;
+#endif
+    }
+
+    void reset() noexcept {
+        if (!data_) {
+            return;
+        }
+#if defined(__linux__)
+        ::munmap(data_, mapped_);
+#else
+        delete[] data_;
+#endif
+        data_ = nullptr;
+    }
+
+    uint8_t* data_{nullptr};
+    size_t size_{0};
+    size_t mapped_{0};
+    bool hugetlb_{false};
+};
+
+// Per-node memory resources for long-lived objects built by pinned
+// workers: pmr containers made with local() stay on the caller's node.
+// Each node has a pool over chunks mapped per a Placement that prefers
+// that node. Small blocks come out of shared chunks, which go back to the
+// system only with the arenas; large ones get a mapping of their own and
+// are unmapped on deallocation.
+class NodeArenas {
+public:
+    explicit NodeArenas(size_t chunk_size = HUGE_PAGE_SIZE, PagePolicy pages = PagePolicy::Transparent) {
+        for (size_t node = 0; node < numa::node_count(); ++node) {
+            nodes_.push_back(std::make_unique<Node>(Placement{pages, static_cast<int>(node)}, chunk_size));
+        }
+    }
+
+    NodeArenas(const NodeArenas&) = delete;
+    NodeArenas& operator=(const NodeArenas&) = delete;
+
+    [[nodiscard]] size_t nodes() const noexcept { return nodes_.size(); }
+
+    std::pmr::memory_resource* resource(size_t node) {
+        return &nodes_[std::min(node, nodes_.size() - 1)]->pool;
+    }
+
+    // The resource of the node the caller runs on; stable for pinned threads
+    std::pmr::memory_resource* local() { return resource(numa::current_node()); }
+
+private:
+    class ChunkSource : public std::pmr::memory_resource {
+    public:
+        ChunkSource(const Placement& placement, size_t chunk_size)
+            : placement_(placement), chunk_size_(std::max<size_t>(chunk_size, 64 * 1024)) {}
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (bytes >= chunk_size_ / 4) {
+                LargeBuffer buffer(bytes, placement_);
+                void* p = buffer.data();
+                large_.emplace(p, std::move(buffer));
+                return p;
+            }
+            auto at = (offset_ + alignment - 1) & ~(alignment - 1);
+            if (chunks_.empty() || at + bytes > chunk_size_) {
+                chunks_.emplace_back(chunk_size_, placement_);
+                at = 0;
+            }
+            offset_ = at + bytes;
+            return chunks_.back().data() + at;
+        }
+
+        void do_deallocate(void* p, size_t, size_t) override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            large_.erase(p);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+    private:
+        const Placement placement_;
+        const size_t chunk_size_;
+        std::mutex mutex_;
+        std::vector<LargeBuffer> chunks_;
+        size_t offset_{0};
+        std::unordered_map<void*, LargeBuffer> large_;
+    };
+
+    struct Node {
+        ChunkSource source;
+        std::pmr::synchronized_pool_resource pool;
+
+        Node(const Placement& placement, size_t chunk_size) : source(placement, chunk_size), pool(&source) {}
+    };
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+};
+
+} // namespace quids::memory
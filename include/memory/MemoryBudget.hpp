@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "utils/Metrics.hpp"
+
+namespace quids::memory {
+
+// Subsystems whose live bytes are attributed separately, so a node that
+// grows can be traced to the part of it that did
+enum class Subsystem : size_t {
+    Mempool,
+    StateCache,
+    QuantumState,
+    NetworkBuffers,
+    Dht,
+    MlModels,
+    BlockCache,
+    Count
+};
+
+constexpr size_t NUM_SUBSYSTEMS = static_cast<size_t>(Subsystem::Count);
+
+inline const char* subsystemName(Subsystem subsystem) {
+    switch (subsystem) {
+        case Subsystem::Mempool: return "mempool";
+        case Subsystem::StateCache: return "state_cache";
+        case Subsystem::QuantumState: return "quantum_state";
+        case Subsystem::NetworkBuffers: return "network_buffers";
+        case Subsystem::Dht: return "dht";
+        case Subsystem::MlModels: return "ml_models";
+        case Subsystem::BlockCache: return "block_cache";
+        case Subsystem::Count: break;
+    }
+    return "unknown";
+}
+
+// Live bytes and a budget per subsystem, exported as
+// quids_memory_live_bytes{subsystem}, quids_memory_peak_bytes,
+// quids_memory_budget_bytes and quids_memory_budget_rejections_total.
+//
+// Accounting is by charge: owners report what they hold, in their own units
+// of work (an entry, a buffer, a state vector), not through a global
+// allocator hook, so the cost is one relaxed add per charge. The
+// accountant never calls back into an owner. A cache enforces its budget
+// by evicting while over_budget() holds; a queue or pool enforces it with
+// try_charge(), which refuses work that would cross the budget, and
+// surfaces that to its callers as backpressure. A budget of 0 is unlimited.
+class MemoryAccountant {
+public:
+    struct Usage {
+        Subsystem subsystem{Subsystem::Count};
+        size_t live_bytes{0};
+        size_t peak_bytes{0};
+        size_t budget_bytes{0};
+        uint64_t rejections{0};
+    };
+
+    static MemoryAccountant& global() {
+        static MemoryAccountant* accountant = new MemoryAccountant();
+        return *accountant;
+    }
+
+    MemoryAccountant(const MemoryAccountant&) = delete;
+    MemoryAccountant& operator=(const MemoryAccountant&) = delete;
+
+    void set_budget(Subsystem subsystem, size_t bytes) noexcept {
+        entry(subsystem).budget->set(static_cast<int64_t>(bytes));
+    }
+
+    [[nodiscard]] size_t budget(Subsystem subsystem) const noexcept {
+        return static_cast<size_t>(entry(subsystem).budget->value());
+    }
+
+    [[nodiscard]] size_t live(Subsystem subsystem) const noexcept {
+        return static_cast<size_t>(std::max<int64_t>(0, entry(subsystem).live->value()));
+    }
+
+    // Always succeeds; for memory the owner has already committed to
+    void charge(Subsystem subsystem, size_t bytes) noexcept {
+        auto& e = entry(subsystem);
+        e.live->add(static_cast<int64_t>(bytes));
+        raise_peak(e);
+    }
+
+    // Refused, with nothing charged, when it would take the subsystem past
+    // its budget. Racing callers can overshoot by at most one charge each.
+    [[nodiscard]] bool try_charge(Subsystem subsystem, size_t bytes) noexcept {
+        auto& e = entry(subsystem);
+        const int64_t budget = e.budget->value();
+        if (budget > 0 && e.live->value() + static_cast<int64_t>(bytes) > budget) {
+            e.rejections->add();
+            return false;
+        }
+        charge(subsystem, bytes);
+        return true;
+    }
+
+    void release(Subsystem subsystem, size_t bytes) noexcept {
+        entry(subsystem).live->add(-static_cast<int64_t>(bytes));
+    }
+
+    [[nodiscard]] bool over_budget(Subsystem subsystem) const noexcept {
+        return excess(subsystem) > 0;
+    }
+
+    // Bytes above the budget; what an evicting owner should free
+    [[nodiscard]] size_t excess(Subsystem subsystem) const noexcept {
+        const auto& e = entry(subsystem);
+        const int64_t budget = e.budget->value();
+        const int64_t live = e.live->value();
+        return budget > 0 && live > budget ? static_cast<size_t>(live - budget) : 0;
+    }
+
+    [[nodiscard]] Usage usage(Subsystem subsystem) const noexcept {
+        const auto& e = entry(subsystem);
+        return Usage{subsystem, live(subsystem), static_cast<size_t>(e.peak->value()), budget(subsystem),
+                     e.rejections->value()};
+    }
+
+    [[nodiscard]] std::vector<Usage> usage() const {
+        std::vector<Usage> all;
+        all.reserve(NUM_SUBSYSTEMS);
+        for (size_t s = 0; s < NUM_SUBSYSTEMS; ++s) {
+            all.push_back(usage(static_cast<Subsystem>(s)));
+        }
+        return all;
+    }
+
+    [[nodiscard]] size_t total_live() const noexcept {
+        size_t total = 0;
+        for (size_t s = 0; s < NUM_SUBSYSTEMS; ++s) {
+            total += live(static_cast<Subsystem>(s));
+        }
+        return total;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<utils::Gauge> live;
+        std::shared_ptr<utils::Gauge> peak;
+        std::shared_ptr<utils::Gauge> budget;
+        std::shared_ptr<utils::Counter> rejections;
+    };
+
+    MemoryAccountant() {
+        auto& registry = utils::MetricsRegistry::global();
+        for (size_t s = 0; s < NUM_SUBSYSTEMS; ++s) {
+            const utils::MetricsRegistry::Labels labels{{"subsystem", subsystemName(static_cast<Subsystem>(s))}};
+            auto& e = entries_[s];
+            e.live = registry.gauge("quids_memory_live_bytes", "Bytes held per subsystem", labels);
+            e.peak = registry.gauge("quids_memory_peak_bytes", "Most bytes held at once per subsystem", labels);
+            e.budget = registry.gauge("quids_memory_budget_bytes", "Byte budget per subsystem, 0 for none", labels);
+            e.rejections = registry.counter("quids_memory_budget_rejections_total",
+                                            "Charges refused because they would exceed the budget", labels);
+        }
+    }
+
+    Entry& entry(Subsystem subsystem) noexcept { return entries_[static_cast<size_t>(subsystem)]; }
+    const Entry& entry(Subsystem subsystem) const noexcept { return entries_[static_cast<size_t>(subsystem)]; }
+
+    static void raise_peak(Entry& e) noexcept {
+        // Gauges have no compare-exchange; a lost race only understates
+        // the peak by one charge
+        const int64_t live = e.live->value();
+        if (live > e.peak->value()) {
+            e.peak->set(live);
+        }
+    }
+
+    std::array<Entry, NUM_SUBSYSTEMS> entries_;
+};
+
+// Bytes held on behalf of a subsystem for as long as the owner lives.
+// Copies charge again and moves carry the charge, so a member of this type
+// keeps a copyable owner's accounting right without further code.
+class MemoryCharge {
+public:
+    // Holds nothing, and cannot be resized, until assigned a charge
+    MemoryCharge() = default;
+    MemoryCharge(Subsystem subsystem, size_t bytes) : subsystem_(subsystem), bytes_(bytes) {
+        MemoryAccountant::global().charge(subsystem_, bytes_);
+    }
+    ~MemoryCharge() { reset(); }
+
+    MemoryCharge(const MemoryCharge& other) : subsystem_(other.subsystem_), bytes_(other.bytes_) {
+        if (bytes_ != 0) {
+            MemoryAccountant::global().charge(subsystem_, bytes_);
+        }
+    }
+    MemoryCharge& operator=(const MemoryCharge& other) {
+        if (this != &other) {
+            MemoryCharge copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    MemoryCharge(MemoryCharge&& other) noexcept
+        : subsystem_(other.subsystem_), bytes_(std::exchange(other.bytes_, 0)) {}
+    MemoryCharge& operator=(MemoryCharge&& other) noexcept {
+        if (this != &other) {
+            reset();
+            subsystem_ = other.subsystem_;
+            bytes_ = std::exchange(other.bytes_, 0);
+        }
+        return *this;
+    }
+
+    // Moves the charge to `bytes`, for an owner that grew or shrank
+    void resize(size_t bytes) noexcept {
+        auto& accountant = MemoryAccountant::global();
+        if (bytes > bytes_) {
+            accountant.charge(subsystem_, bytes - bytes_);
+        } else {
+            accountant.release(subsystem_, bytes_ - bytes);
+        }
+        bytes_ = bytes;
+    }
+
+    void reset() noexcept {
+        if (bytes_ != 0) {
+            MemoryAccountant::global().release(subsystem_, bytes_);
+            bytes_ = 0;
+        }
+    }
+
+    [[nodiscard]] size_t bytes() const noexcept { return bytes_; }
+
+private:
+    Subsystem subsystem_{Subsystem::Count};
+    size_t bytes_{0};
+};
+
+} // namespace quids::memory
@@ -1,27 +1,280 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
 
 namespace quids::memory {
 
+struct PoolStats {
+    uint64_t allocations{0};
+    uint64_t deallocations{0};
+    uint64_t slabs{0};
+    uint64_t slab_bytes{0};
+    uint64_t refills{0};  // times a thread cache went to the shared free list
+};
+
+// Fixed-size object pool for T.
+//
+// Objects are carved out of slabs of initialSize slots. Each thread keeps a
+// small cache of free slots per pool and only takes the pool lock to move a
+// batch of slots between its cache and the shared free list, so the common
+// allocate/deallocate is a vector push or pop. Slabs are returned to the
+// system when the pool and every thread cache that used it are gone.
 template<typename T>
 class MemoryPool {
+    static constexpr size_t SLOT_ALIGN = std::max(alignof(T), alignof(void*));
+    static constexpr size_t SLOT_SIZE =
+        (std::max(sizeof(T), sizeof(void*)) + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+    static constexpr size_t CACHE_LIMIT = 64;
+    static constexpr size_t TRANSFER_BATCH = CACHE_LIMIT / 2;
+
+    struct Central {
+        std::mutex mutex;
+        std::vector<void*> free;
+        std::vector<void*> slabs;
+        size_t slab_objects;
+
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> deallocations{0};
+        std::atomic<uint64_t> refills{0};
+
+        explicit Central(size_t objects) : slab_objects(std::max<size_t>(1, objects)) {}
+
+        ~Central() {
+            for (void* slab : slabs) {
+                ::operator delete(slab, std::align_val_t(SLOT_ALIGN));
+            }
+        }
+
+        void grow_locked() {
+            void* slab = ::operator new(SLOT_SIZE * slab_objects, std::align_val_t(SLOT_ALIGN));
+            slabs.push_back(slab);
+            auto* base = static_cast<unsigned char*>(slab);
+            free.reserve(free.size() + slab_objects);
+            // Reversed so the cache hands out slots in address order
+            for (size_t i = slab_objects; i-- > 0;) {
+                free.push_back(base + i * SLOT_SIZE);
+            }
+            type_totals().slabs.fetch_add(1, std::memory_order_relaxed);
+            type_totals().slab_bytes.fetch_add(SLOT_SIZE * slab_objects, std::memory_order_relaxed);
+        }
+    };
+
+    // One per (thread, pool) pair; hands its slots back on thread exit
+    struct Cache {
+        std::shared_ptr<Central> central;
+        std::vector<void*> free;
+
+        ~Cache() {
+            if (!central || free.empty()) return;
+            std::lock_guard<std::mutex> lock(central->mutex);
+            central->free.insert(central->free.end(), free.begin(), free.end());
+        }
+    };
+
+    struct Totals {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> deallocations{0};
+        std::atomic<uint64_t> slabs{0};
+        std::atomic<uint64_t> slab_bytes{0};
+        std::atomic<uint64_t> refills{0};
+    };
+
 public:
-    explicit MemoryPool(size_t initialSize) : size_(initialSize) {}
-    
-    T* allocate() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return new T();
+    explicit MemoryPool(size_t initialSize = 1024)
+        : central_(std::make_shared<Central>(initialSize)) {
+        std::lock_guard<std::mutex> lock(central_->mutex);
+        central_->grow_locked();
+    }
+
+    MemoryPool(const MemoryPool&) = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+
+    // Uninitialised storage for one T
+    void* allocate_raw() {
+        void* slot;
+        if (Cache* cache = local_cache()) {
+            if (cache->free.empty()) {
+                refill(*cache);
+            }
+            slot = cache->free.back();
+            cache->free.pop_back();
+        } else {
+            std::lock_guard<std::mutex> lock(central_->mutex);
+            if (central_->free.empty()) {
+                central_->grow_locked();
+            }
+            slot = central_->free.back();
+            central_->free.pop_back();
+        }
+        central_->allocations.fetch_add(1, std::memory_order_relaxed);
+        type_totals().allocations.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    void deallocate_raw(void* slot) noexcept {
+        if (!slot) return;
+        if (Cache* cache = local_cache()) {
+            cache->free.push_back(slot);
+            if (cache->free.size() > CACHE_LIMIT) {
+                spill(*cache);
+            }
+        } else {
+            std::lock_guard<std::mutex> lock(central_->mutex);
+            central_->free.push_back(slot);
+        }
+        central_->deallocations.fetch_add(1, std::memory_order_relaxed);
+        type_totals().deallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template<typename... Args>
+    T* construct(Args&&... args) {
+        void* slot = allocate_raw();
+        try {
+            return ::new (slot) T(std::forward<Args>(args)...);
+        } catch (...) {
+            deallocate_raw(slot);
+            throw;
+        }
+    }
+
+    void destroy(T* ptr) noexcept {
+        if (!ptr) return;
+        ptr->~T();
+        deallocate_raw(ptr);
     }
-    
-    void deallocate(T* ptr) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        delete ptr;
+
+    // Destroys a whole batch and returns it under one lock, e.g. once the
+    // batch that owned the objects has committed
+    void destroy_bulk(const std::vector<T*>& ptrs) noexcept {
+        size_t count = 0;
+        for (T* ptr : ptrs) {
+            if (ptr) {
+                ptr->~T();
+                ++count;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(central_->mutex);
+            for (T* ptr : ptrs) {
+                if (ptr) central_->free.push_back(ptr);
+            }
+        }
+        central_->deallocations.fetch_add(count, std::memory_order_relaxed);
+        type_totals().deallocations.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    T* allocate() { return construct(); }
+    void deallocate(T* ptr) noexcept { destroy(ptr); }
+
+    // For std::unique_ptr<T, MemoryPool<T>::Deleter>; the pool must outlive it
+    struct Deleter {
+        MemoryPool* pool{nullptr};
+        void operator()(T* ptr) const noexcept { pool->destroy(ptr); }
+    };
+
+    template<typename... Args>
+    std::unique_ptr<T, Deleter> make_unique(Args&&... args) {
+        return std::unique_ptr<T, Deleter>(construct(std::forward<Args>(args)...), Deleter{this});
+    }
+
+    PoolStats stats() const {
+        PoolStats s;
+        s.allocations = central_->allocations.load(std::memory_order_relaxed);
+        s.deallocations = central_->deallocations.load(std::memory_order_relaxed);
+        s.refills = central_->refills.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(central_->mutex);
+        s.slabs = central_->slabs.size();
+        s.slab_bytes = s.slabs * central_->slab_objects * SLOT_SIZE;
+        return s;
+    }
+
+    // Summed over every pool of T in the process
+    static PoolStats type_stats() {
+        const Totals& t = type_totals();
+        PoolStats s;
+        s.allocations = t.allocations.load(std::memory_order_relaxed);
+        s.deallocations = t.deallocations.load(std::memory_order_relaxed);
+        s.slabs = t.slabs.load(std::memory_order_relaxed);
+        s.slab_bytes = t.slab_bytes.load(std::memory_order_relaxed);
+        s.refills = t.refills.load(std::memory_order_relaxed);
+        return s;
     }
 
 private:
-    size_t size_;
-    std::mutex mutex_;
-}; 
\ No newline at end of file
+    static Totals& type_totals() {
+        static Totals totals;
+        return totals;
+    }
+
+    struct CacheList {
+        std::vector<std::unique_ptr<Cache>> caches;
+        ~CacheList() { cache_list_gone() = true; }
+    };
+
+    // Trivially destructible, so still readable while the thread (or the
+    // process, for static objects) is tearing down
+    static bool& cache_list_gone() {
+        thread_local bool gone = false;
+        return gone;
+    }
+
+    // nullptr once this thread's caches are destroyed; callers then use
+    // the shared free list directly
+    Cache* local_cache() {
+        if (cache_list_gone()) {
+            return nullptr;
+        }
+        // Most threads touch one or two pools of a type, so a short list
+        // with the last hit in front beats a map
+        thread_local CacheList list;
+        auto& caches = list.caches;
+        if (!caches.empty() && caches.front()->central == central_) {
+            return caches.front().get();
+        }
+        for (size_t i = 1; i < caches.size(); ++i) {
+            if (caches[i]->central == central_) {
+                std::swap(caches[0], caches[i]);
+                return caches.front().get();
+            }
+        }
+        // Drop caches of pools that no longer exist elsewhere
+        caches.erase(std::remove_if(caches.begin(), caches.end(), [](const auto& c) {
+            return c->central.use_count() == 1;
+        }), caches.end());
+        auto cache = std::make_unique<Cache>();
+        cache->central = central_;
+        cache->free.reserve(CACHE_LIMIT + 1);
+        caches.insert(caches.begin(), std::move(cache));
+        return caches.front().get();
+    }
+
+    void refill(Cache& cache) {
+        std::lock_guard<std::mutex> lock(central_->mutex);
+        if (central_->free.empty()) {
+            central_->grow_locked();
+        }
+        const size_t n = std::min(TRANSFER_BATCH, central_->free.size());
+        cache.free.insert(cache.free.end(), central_->free.end() - n, central_->free.end());
+        central_->free.resize(central_->free.size() - n);
+        central_->refills.fetch_add(1, std::memory_order_relaxed);
+        type_totals().refills.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void spill(Cache& cache) noexcept {
+        std::lock_guard<std::mutex> lock(central_->mutex);
+        central_->free.insert(central_->free.end(), cache.free.end() - TRANSFER_BATCH, cache.free.end());
+        cache.free.resize(cache.free.size() - TRANSFER_BATCH);
+    }
+
+    std::shared_ptr<Central> central_;
+};
+
+} // namespace quids::memory
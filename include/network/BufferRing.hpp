@@ -0,0 +1,226 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "memory/LargePages.hpp"
+#include "utils/BoundedQueue.hpp"
+
+namespace quids {
+namespace network {
+
+class BufferRing;
+
+// Byte budget shared by every buffer charged to one owner, typically a peer.
+// Charged on acquire, refunded when the last handle to a buffer goes away.
+class BufferQuota {
+public:
+    explicit BufferQuota(size_t limit) : limit_(limit) {}
+
+    bool tryCharge(size_t bytes) noexcept {
+        size_t used = used_.load(std::memory_order_relaxed);
+        do {
+            if (used + bytes > limit_) {
+                return false;
+            }
+        } while (!used_.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+        return true;
+    }
+
+    void refund(size_t bytes) noexcept { used_.fetch_sub(bytes, std::memory_order_relaxed); }
+
+    [[nodiscard]] size_t used() const noexcept { return used_.load(std::memory_order_relaxed); }
+    [[nodiscard]] size_t limit() const noexcept { return limit_; }
+
+private:
+    std::atomic<size_t> used_{0};
+    const size_t limit_;
+};
+
+// Refcounted reference to one pooled buffer. Copies share the buffer; it
+// goes back to the ring when the last copy is destroyed. Write the payload
+// before handing out copies: the bytes are not copy-on-write.
+class BufferHandle {
+public:
+    BufferHandle() = default;
+    ~BufferHandle() { reset(); }
+
+    BufferHandle(const BufferHandle& other) noexcept;
+    BufferHandle& operator=(const BufferHandle& other) noexcept;
+    BufferHandle(BufferHandle&& other) noexcept
+        : ring_(other.ring_), slot_(other.slot_), size_(other.size_) {
+        other.ring_ = nullptr;
+    }
+    BufferHandle& operator=(BufferHandle&& other) noexcept;
+
+    void reset() noexcept;
+
+    [[nodiscard]] explicit operator bool() const noexcept { return ring_ != nullptr; }
+    [[nodiscard]] uint8_t* data() const noexcept;
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] size_t capacity() const noexcept;
+
+    // Payload length after writing into data(); clamped to capacity()
+    void resize(size_t size) noexcept;
+
+    [[nodiscard]] std::span<uint8_t> writable() const noexcept { return {data(), capacity()}; }
+    [[nodiscard]] std::span<const uint8_t> bytes() const noexcept { return {data(), size_}; }
+
+private:
+    friend class BufferRing;
+    BufferHandle(BufferRing* ring, uint32_t slot, size_t size) noexcept
+        : ring_(ring), slot_(slot), size_(size) {}
+
+    BufferRing* ring_{nullptr};
+    uint32_t slot_{0};
+    size_t size_{0};
+};
+
+// Preallocated buffers in a few size classes, handed out as BufferHandles.
+//
+// Each class is one contiguous allocation with a BoundedQueue of free slot
+// indices, so acquire and release are a pop and a push with no lock and no
+// allocation. A request is served from the smallest class that fits, and
+// from the next larger class when that one is exhausted. The ring must
+// outlive every handle it has issued.
+//
+// Class storage lives for the whole process and is hot, so it is mapped
+// per the Placement: on huge pages by default, and on a given NUMA node
+// for a ring owned by threads pinned there.
+//
+// Buffers in use are charged to memory::Subsystem::NetworkBuffers; once
+// that budget is spent acquire() refuses, as it does for a spent quota, and
+// the caller applies backpressure.
+class BufferRing {
+public:
+    struct SizeClass {
+        size_t buffer_size;
+        size_t count;
+    };
+
+    struct ClassStats {
+        size_t buffer_size{0};
+        size_t capacity{0};
+        size_t in_use{0};
+        size_t high_water{0};
+        // Acquires this class could not serve from its own slots
+        uint64_t exhausted{0};
+    };
+
+    struct Stats {
+        std::vector<ClassStats> classes;
+        size_t bytes_reserved{0};
+        size_t bytes_in_use{0};
+        // Acquires refused because the owner's quota was spent
+        uint64_t quota_rejections{0};
+        // Acquires refused by the node's network buffer budget
+        uint64_t budget_rejections{0};
+    };
+
+    BufferRing(std::vector<SizeClass> classes, const memory::Placement& placement);
+    explicit BufferRing(std::vector<SizeClass> classes);
+    ~BufferRing();
+
+    BufferRing(const BufferRing&) = delete;
+    BufferRing& operator=(const BufferRing&) = delete;
+
+    // A buffer of at least `bytes` with size() == bytes, charged to `quota`
+    // if given; an empty handle if nothing fits or the quota is spent
+    BufferHandle acquire(size_t bytes, std::shared_ptr<BufferQuota> quota = nullptr);
+
+    [[nodiscard]] size_t maxBufferSize() const noexcept;
+    [[nodiscard]] Stats stats() const;
+
+private:
+    friend class BufferHandle;
+
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> refs{0};
+        uint32_t size_class{0};
+        uint8_t* data{nullptr};
+        // Owned by the slot while it is out; dropped on release
+        std::shared_ptr<BufferQuota> quota;
+    };
+
+    struct Class {
+        size_t buffer_size;
+        size_t first_slot;
+        size_t count;
+        memory::LargeBuffer storage;
+        utils::BoundedQueue<uint32_t> free;
+        alignas(64) std::atomic<size_t> in_use{0};
+        std::atomic<size_t> high_water{0};
+        std::atomic<uint64_t> exhausted{0};
+
+        Class(size_t size, size_t first, size_t n)
+            : buffer_size(size), first_slot(first), count(n), free(n) {}
+    };
+
+    void retain(uint32_t slot) noexcept {
+        slots_[slot].refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    void release(uint32_t slot) noexcept;
+    static void giveBack(Class& size_class, uint32_t slot) noexcept;
+
+    std::vector<std::unique_ptr<Class>> classes_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> quota_rejections_{0};
+    std::atomic<uint64_t> budget_rejections_{0};
+};
+
+inline BufferHandle::BufferHandle(const BufferHandle& other) noexcept
+    : ring_(other.ring_), slot_(other.slot_), size_(other.size_) {
+    if (ring_) {
+        ring_->retain(slot_);
+    }
+}
+
+inline BufferHandle& BufferHandle::operator=(const BufferHandle& other) noexcept {
+    if (this != &other) {
+        if (other.ring_) {
+            other.ring_->retain(other.slot_);
+        }
+        reset();
+        ring_ = other.ring_;
+        slot_ = other.slot_;
+        size_ = other.size_;
+    }
+    return *this;
+}
+
+inline BufferHandle& BufferHandle::operator=(BufferHandle&& other) noexcept {
+    if (this != &other) {
+        reset();
+        ring_ = other.ring_;
+        slot_ = other.slot_;
+        size_ = other.size_;
+        other.ring_ = nullptr;
+    }
+    return *this;
+}
+
+inline void BufferHandle::reset() noexcept {
+    if (ring_) {
+        ring_->release(slot_);
+        ring_ = nullptr;
+    }
+    size_ = 0;
+}
+
+inline uint8_t* BufferHandle::data() const noexcept {
+    return ring_ ? ring_->slots_[slot_].data : nullptr;
+}
+
+inline size_t BufferHandle::capacity() const noexcept {
+    return ring_ ? ring_->classes_[ring_->slots_[slot_].size_class]->buffer_size : 0;
+}
+
+inline void BufferHandle::resize(size_t size) noexcept {
+    size_ = size < capacity() ? size : capacity();
+}
+
+} // namespace network
+} // namespace quids
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace quids {
+namespace network {
+
+// Compact block relay in the style of BIP 152.
+//
+// A block travels as its header and one 6-byte short id per transaction:
+// SipHash-2-4 of the transaction hash, keyed by the block id and a random
+// nonce, so ids collide rarely and differently for every block and
+// nobody can grind transactions that collide on purpose. A receiver
+// matches the ids against its mempool and asks the sender for the rest
+// in one round trip.
+//
+// The network layer treats headers and transactions as opaque bytes; the
+// header must commit to the transactions (a merkle root), which is how a
+// receiver catches a short id that matched the wrong transaction.
+class CompactBlock {
+public:
+    using Hash = std::array<uint8_t, 32>;
+    using ShortId = uint64_t;  // low 48 bits
+
+    static constexpr size_t SHORT_ID_BYTES = 6;
+
+    // Sent in full, for transactions the receiver is unlikely to hold
+    struct Prefilled {
+        uint32_t index;
+        std::vector<uint8_t> tx;
+    };
+
+    // Calls visit once per transaction the receiver already holds. bytes()
+    // serializes it and is only called for ones the block contains.
+    using Visitor = std::function<void(const Hash& tx_hash, const std::function<std::vector<uint8_t>()>& bytes)>;
+    using TransactionSource = std::function<void(const Visitor& visit)>;
+
+    std::vector<uint8_t> header;
+    uint64_t nonce{0};
+    // One per transaction not prefilled, in block order
+    std::vector<ShortId> short_ids;
+    std::vector<Prefilled> prefilled;  // by increasing index
+
+    // `prefill` lists indexes to send in full, e.g. ones just created
+    static CompactBlock build(std::vector<uint8_t> header, std::span<const Hash> tx_hashes,
+                              std::span<const std::vector<uint8_t>> txs, uint64_t nonce,
+                              std::span<const uint32_t> prefill = {});
+
+    [[nodiscard]] Hash id() const { return block_id(header); }
+    [[nodiscard]] size_t transaction_count() const { return short_ids.size() + prefilled.size(); }
+    [[nodiscard]] ShortId short_id(const Hash& tx_hash) const;
+
+    static Hash block_id(std::span<const uint8_t> header);
+
+    std::vector<uint8_t> encode() const;
+    static std::optional<CompactBlock> decode(std::span<const uint8_t> data);
+
+    // The missing-transaction round trip: which ones, by index in the
+    // block, and the answer, in the order asked
+    static std::vector<uint8_t> encode_request(const Hash& block, std::span<const uint32_t> indexes);
+    static bool decode_request(std::span<const uint8_t> data, Hash& block, std::vector<uint32_t>& indexes);
+    static std::vector<uint8_t> encode_transactions(std::span<const std::vector<uint8_t>> txs);
+    static std::optional<std::vector<std::vector<uint8_t>>> decode_transactions(std::span<const uint8_t> data);
+
+private:
+    friend class PartialBlock;
+    std::array<uint64_t, 2> keys() const;
+};
+
+// A compact block being rebuilt by a receiver
+class PartialBlock {
+public:
+    // Fills what it can from source; ids that match two transactions are
+    // left missing rather than guessed
+    PartialBlock(const CompactBlock& block, const CompactBlock::TransactionSource& source);
+
+    [[nodiscard]] bool complete() const { return missing_.empty(); }
+    [[nodiscard]] const std::vector<uint32_t>& missing() const { return missing_; }
+    // How many came from the source rather than the block or a fill
+    [[nodiscard]] size_t matched() const { return matched_; }
+
+    // The reply to a request for missing(); false if it does not fit
+    bool fill(std::vector<std::vector<uint8_t>> txs);
+
+    // Valid once complete()
+    [[nodiscard]] const std::vector<std::vector<uint8_t>>& transactions() const { return txs_; }
+    std::vector<std::vector<uint8_t>> take_transactions() { return std::move(txs_); }
+
+private:
+    std::vector<std::vector<uint8_t>> txs_;
+    std::vector<uint8_t> have_;
+    std::vector<uint32_t> missing_;
+    size_t matched_{0};
+};
+
+} // namespace network
+} // namespace quids
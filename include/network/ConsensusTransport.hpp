@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "network/OptimizedNetworkLayer.hpp"
+#include "network/WireFormat.hpp"
+
+namespace quids {
+namespace network {
+
+// Coalesces consensus traffic per peer.
+//
+// Votes, batch proofs and acknowledgements queued for the same peer within
+// one tick leave as a single frame on the network layer's consensus lane,
+// which is drained ahead of transaction gossip. A frame that reaches
+// max_frame_bytes is cut early, so a burst never waits for the tick.
+//
+// Frames travel as wire frames of frame_type. Payload layout, little-endian:
+//   u8 version, u32 entry count, then per entry u8 kind, u32 length, payload
+class ConsensusTransport {
+public:
+    enum class EntryKind : uint8_t {
+        Vote = 0,
+        Proof = 1,
+        Ack = 2
+    };
+
+    using EntryHandler = std::function<void(const NodeID& from, std::span<const uint8_t> payload)>;
+
+    struct Config {
+        // Wire type consensus frames are sent and registered under
+        uint8_t frame_type{wire::types::CONSENSUS_FRAME};
+        std::chrono::milliseconds tick{5};
+        size_t max_frame_bytes{64 * 1024};
+    };
+
+    struct Stats {
+        uint64_t entries_sent{0};
+        uint64_t frames_sent{0};
+        uint64_t entries_received{0};
+        uint64_t malformed_frames{0};
+    };
+
+    static constexpr uint8_t FRAME_VERSION = 1;
+
+    ConsensusTransport(OptimizedNetworkLayer& network, const Config& config);
+    ~ConsensusTransport();
+
+    ConsensusTransport(const ConsensusTransport&) = delete;
+    ConsensusTransport& operator=(const ConsensusTransport&) = delete;
+
+    // Flushes every tick on a background thread until stop()
+    void start();
+    void stop();
+
+    void queueVote(const NodeID& peer, std::span<const uint8_t> payload);
+    void queueProof(const NodeID& peer, std::span<const uint8_t> payload);
+    void queueAck(const NodeID& peer, std::span<const uint8_t> payload);
+
+    // Sends one frame per peer with pending entries
+    void flush();
+
+    void setHandler(EntryKind kind, EntryHandler handler);
+    // Unpacks a received frame's payload and dispatches its entries in order
+    void onFrame(const NodeID& from, std::span<const uint8_t> frame);
+
+    [[nodiscard]] Stats stats() const;
+
+    // Calls fn(kind, payload) per entry; false if the frame is malformed,
+    // in which case no entry is delivered
+    static bool decodeFrame(std::span<const uint8_t> frame,
+                            const std::function<void(EntryKind, std::span<const uint8_t>)>& fn);
+
+private:
+    struct PendingFrame {
+        // Wire header space, then the payload
+        std::vector<uint8_t> bytes;
+        uint32_t entries{0};
+    };
+
+    void queue(const NodeID& peer, EntryKind kind, std::span<const uint8_t> payload);
+    void send(const NodeID& peer, PendingFrame&& frame);
+    void tickLoop();
+
+    OptimizedNetworkLayer& network_;
+    const Config config_;
+
+    std::mutex pending_mutex_;
+    std::unordered_map<NodeID, PendingFrame> pending_;
+
+    std::mutex handler_mutex_;
+    std::array<EntryHandler, 3> handlers_;
+
+    std::atomic<bool> running_{false};
+    std::mutex tick_mutex_;
+    std::condition_variable tick_cv_;
+    std::thread ticker_;
+
+    std::atomic<uint64_t> entries_sent_{0};
+    std::atomic<uint64_t> frames_sent_{0};
+    std::atomic<uint64_t> entries_received_{0};
+    std::atomic<uint64_t> malformed_frames_{0};
+};
+
+} // namespace network
+} // namespace quids
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace quids {
+namespace network {
+
+// Erasure-coded block dissemination and data-availability sampling.
+//
+// A block is cut into data chunks and Reed-Solomon extended with parity
+// chunks (see ReedSolomon); any data_chunks of them rebuild it. The
+// commitment is the BLAKE3 Merkle root over all chunks, so every chunk
+// comes with a proof against it. Each chunk is kept by the peers whose
+// ids are closest to its key, which spreads a block over the network
+// instead of sending all of it to everyone. A node that only needs to
+// know the block is available asks for a few random chunks: a block
+// that cannot be rebuilt lacks more than parity_chunks of them, and each
+// sample notices that with probability at least
+// (parity_chunks + 1) / total_chunks().
+struct AvailabilityCommitment {
+    using Hash = std::array<uint8_t, 32>;
+
+    static constexpr size_t ENCODED_SIZE = 32 + 4 + 4 + 4 + 8;
+
+    crypto::MerkleHash root{};
+    uint32_t data_chunks{0};
+    uint32_t parity_chunks{0};
+    uint32_t chunk_size{0};
+    uint64_t block_size{0};
+
+    [[nodiscard]] uint32_t total_chunks() const { return data_chunks + parity_chunks; }
+    [[nodiscard]] Hash id() const;
+    // Where chunk `index` lives in the node id space
+    [[nodiscard]] Hash chunk_key(uint32_t index) const;
+
+    // Chance that `samples` distinct random chunks all arrive although
+    // the block cannot be rebuilt
+    [[nodiscard]] double miss_probability(size_t samples) const;
+
+    std::vector<uint8_t> encode() const;
+    static std::optional<AvailabilityCommitment> decode(std::span<const uint8_t> data);
+};
+
+struct BlockChunk {
+    uint32_t index{0};
+    std::vector<uint8_t> data;
+    // Merkle siblings, bottom up; the index and chunk count place them
+    std::vector<crypto::MerkleHash> proof;
+
+    std::vector<uint8_t> encode() const;
+    static std::optional<BlockChunk> decode(std::span<const uint8_t> data);
+};
+
+class ChunkedBlock {
+public:
+    // Throws std::invalid_argument for an empty block or a chunk count
+    // ReedSolomon does not accept
+    static ChunkedBlock encode(std::span<const uint8_t> block, uint32_t data_chunks, uint32_t parity_chunks);
+
+    // Any data_chunks verified chunks; nullopt if there are too few
+    static std::optional<std::vector<uint8_t>> reconstruct(const AvailabilityCommitment& commitment,
+                                                           std::span<const BlockChunk> chunks);
+
+    // Checks the proof and the chunk's size against the commitment
+    static bool verify(const AvailabilityCommitment& commitment, const BlockChunk& chunk);
+
+    // `count` distinct chunk indexes, at most total_chunks()
+    static std::vector<uint32_t> sample(const AvailabilityCommitment& commitment, size_t count,
+                                        std::mt19937_64& rng);
+
+    const AvailabilityCommitment& commitment() const { return commitment_; }
+    const std::vector<BlockChunk>& chunks() const { return chunks_; }
+
+private:
+    AvailabilityCommitment commitment_;
+    std::vector<BlockChunk> chunks_;
+};
+
+} // namespace network
+} // namespace quids
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio/ip/udp.hpp>
+
+namespace quids {
+namespace network {
+
+// Batched UDP receive and send.
+//
+// Opens `workers` sockets bound to the same port with SO_REUSEPORT, so the
+// kernel spreads flows across them, and drains each on its own thread with
+// recvmmsg, up to `batch` datagrams per system call. With GRO the kernel
+// may hand over several datagrams of one flow as a single buffer; they are
+// split again before the handler sees them. Receive buffers are allocated
+// once per worker and reused, so handlers get spans that are only valid
+// for the duration of the call.
+//
+// send() goes out through sendmmsg. With GSO, a run of equal-sized
+// datagrams to the same peer is passed to the kernel as one buffer and
+// segmented there, or on the NIC.
+//
+// Platforms without recvmmsg fall back to one datagram per call.
+class DatagramEngine {
+public:
+    struct Config {
+        std::string bind_address{"0.0.0.0"};
+        uint16_t port{0};
+        // Sockets and receive threads; 0 means one per core
+        size_t workers{1};
+        // Datagrams per recvmmsg or sendmmsg call
+        size_t batch{64};
+        // Largest datagram accepted without GRO
+        size_t max_datagram{2048};
+        bool enable_gro{true};
+        bool enable_gso{true};
+        // Requested SO_RCVBUF and SO_SNDBUF per socket
+        int socket_buffer_bytes{4 << 20};
+    };
+
+    struct Stats {
+        uint64_t datagrams_received{0};
+        uint64_t receive_calls{0};
+        uint64_t bytes_received{0};
+        uint64_t truncated{0};
+        uint64_t datagrams_sent{0};
+        uint64_t send_calls{0};
+        uint64_t send_errors{0};
+    };
+
+    struct Outgoing {
+        boost::asio::ip::udp::endpoint to;
+        std::span<const uint8_t> data;
+    };
+
+    // Called on a worker thread; data points into that worker's pool
+    using Handler = std::function<void(const std::string& address, uint16_t port, std::span<const uint8_t> data)>;
+
+    DatagramEngine(const Config& config, Handler handler);
+    ~DatagramEngine();
+
+    DatagramEngine(const DatagramEngine&) = delete;
+    DatagramEngine& operator=(const DatagramEngine&) = delete;
+
+    // Binds every socket and starts the workers; throws std::system_error
+    void start();
+    void stop();
+
+    // Bound port, useful when Config::port was 0
+    [[nodiscard]] uint16_t port() const noexcept { return bound_port_; }
+
+    // Thread-safe; returns how many datagrams the kernel accepted
+    size_t send(std::span<const Outgoing> datagrams);
+
+    [[nodiscard]] Stats stats() const noexcept;
+
+private:
+    void receiveLoop(size_t worker);
+    size_t sendOne(int fd, const Outgoing& datagram);
+
+    const Config config_;
+    const Handler handler_;
+
+    std::vector<int> sockets_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> gso_{false};
+    std::atomic<size_t> next_send_socket_{0};
+    uint16_t bound_port_{0};
+
+    std::atomic<uint64_t> datagrams_received_{0};
+    std::atomic<uint64_t> receive_calls_{0};
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> truncated_{0};
+    std::atomic<uint64_t> datagrams_sent_{0};
+    std::atomic<uint64_t> send_calls_{0};
+    std::atomic<uint64_t> send_errors_{0};
+};
+
+} // namespace network
+} // namespace quids
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace quids {
+namespace network {
+
+// Systematic Reed-Solomon code over GF(2^8).
+//
+// k data shards are extended with m parity shards, and any k of the k + m
+// shards give back the data. The parity rows are a Cauchy matrix, so
+// every k-row submatrix of [I; C] is invertible. Shards are byte strings
+// of one common length; the code works on each byte position separately.
+class ReedSolomon {
+public:
+    static constexpr size_t MAX_SHARDS = 256;
+
+    // Throws std::invalid_argument unless data_shards > 0 and
+    // data_shards + parity_shards <= MAX_SHARDS
+    ReedSolomon(size_t data_shards, size_t parity_shards);
+
+    [[nodiscard]] size_t data_shards() const { return k_; }
+    [[nodiscard]] size_t parity_shards() const { return m_; }
+    [[nodiscard]] size_t total_shards() const { return k_ + m_; }
+
+    // Appends the parity shards to data_shards() data shards of equal,
+    // nonzero length; throws std::invalid_argument otherwise
+    void encode(std::vector<std::vector<uint8_t>>& shards) const;
+
+    // Restores the data shards in place from any data_shards() of the
+    // total_shards() shards; missing ones are empty. Parity shards are
+    // left as they are. False if too few are present or lengths disagree.
+    bool reconstruct(std::vector<std::vector<uint8_t>>& shards) const;
+
+private:
+    size_t k_;
+    size_t m_;
+    std::vector<uint8_t> parity_;  // m_ rows of k_ coefficients
+};
+
+} // namespace network
+} // namespace quids
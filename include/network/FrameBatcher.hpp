@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "network/WireFormat.hpp"
+
+namespace quids::network {
+
+// Coalesces outgoing wire frames per peer and compresses large batches.
+//
+// Frames queued for a peer wait until linger passes with nothing new for
+// that peer, but never longer than max_delay after the first one, and a
+// batch that reaches max_batch_bytes leaves at once. A flushed batch is
+// one packet of back-to-back wire frames.
+//
+// At flush, the frames of each type that add up to compress_threshold or
+// more are packed into one frame of that type, flagged BATCH|COMPRESSED,
+// whose payload is a ZSTD frame of the original frames. It is compressed
+// with the type's dictionary if one is set. Batches that do not shrink
+// go out as they are.
+//
+// Dictionaries have to match on both ends, so they are configured, not
+// trained per node; trainDictionary() builds one offline from samples.
+// ZSTD frames carry the dictionary ID, and the receiver knows every
+// dictionary ever set, so a frame made before a switch still decodes.
+class FrameBatcher {
+public:
+    using PeerID = std::string;
+    using Send = std::function<void(const PeerID& peer, std::vector<uint8_t>&& packet)>;
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        std::chrono::microseconds linger{1000};
+        std::chrono::microseconds max_delay{5000};
+        size_t max_batch_bytes{60 * 1024};
+        size_t compress_threshold{1024};
+        int level{3};
+        // Largest decompressed batch accepted from a peer
+        size_t max_unpacked_bytes{4u << 20};
+    };
+
+    struct Stats {
+        uint64_t frames_queued{0};
+        uint64_t packets_sent{0};
+        uint64_t bytes_in{0};
+        uint64_t bytes_out{0};
+        uint64_t batches_compressed{0};
+        uint64_t batches_unpacked{0};
+        uint64_t unpack_errors{0};
+    };
+
+    FrameBatcher(const Config& config, Send send);
+    ~FrameBatcher();
+
+    FrameBatcher(const FrameBatcher&) = delete;
+    FrameBatcher& operator=(const FrameBatcher&) = delete;
+
+    // Queues complete wire frames (one or more) for peer
+    void enqueue(const PeerID& peer, std::span<const uint8_t> frames);
+
+    // Sends every batch whose deadline has passed; returns packets sent
+    size_t poll(Clock::time_point now = Clock::now());
+    void flushAll();
+
+    // Earliest pending deadline, or time_point::max() when idle
+    [[nodiscard]] Clock::time_point nextDeadline() const;
+
+    // Calls fn for every frame in a received packet, expanding compressed
+    // batches into scratch; payload views stay valid until scratch is
+    // reused. False if anything in the packet was malformed.
+    bool unpack(std::span<const uint8_t> packet, std::vector<uint8_t>& scratch,
+                const std::function<void(const wire::Frame& frame)>& fn);
+
+    // Compress frames of type with dictionary; empty turns it off
+    void setDictionary(uint8_t type, const std::vector<uint8_t>& dictionary);
+    static std::vector<uint8_t> trainDictionary(const std::vector<std::vector<uint8_t>>& samples,
+                                                size_t capacity = 16 * 1024);
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    struct Dictionary;
+    using DictionaryPtr = std::shared_ptr<const Dictionary>;
+
+    struct Pending {
+        std::vector<uint8_t> bytes;
+        Clock::time_point first;
+        Clock::time_point deadline;
+    };
+
+    // Builds the packet for one batch; runs without the lock
+    std::vector<uint8_t> pack(std::vector<uint8_t>&& frames,
+                              const std::array<DictionaryPtr, 256>& dictionaries);
+    bool unpackFrame(const wire::Frame& frame, std::vector<uint8_t>& scratch,
+                     const std::function<void(const wire::Frame& frame)>& fn);
+    void sendAll(std::vector<std::pair<PeerID, std::vector<uint8_t>>>& due);
+
+    const Config config_;
+    const Send send_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<PeerID, Pending> pending_;
+    // Compression dictionary per type, and every dictionary by ZSTD ID
+    std::array<DictionaryPtr, 256> dictionaries_;
+    std::unordered_map<uint32_t, DictionaryPtr> known_;
+    Stats stats_;
+};
+
+} // namespace quids::network
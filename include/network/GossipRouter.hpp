@@ -0,0 +1,222 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "network/PeerScoreBook.hpp"
+#include "utils/RandomService.hpp"
+
+namespace quids {
+namespace network {
+
+// Gossipsub-style dissemination over whatever transport the owner provides.
+//
+// Each subscribed topic keeps a mesh of between degree_low and degree_high
+// peers. Messages are pushed eagerly along mesh links only. Every heartbeat
+// the ids of recent messages are advertised (IHAVE) to a few peers outside
+// the mesh; they pull anything they missed with IWANT. So bandwidth grows
+// with the mesh degree, not with the number of peers.
+//
+// Topics in announce_topics skip the eager push: mesh peers get only the
+// message ids, batched until the next flushAnnouncements(), and pull the
+// bodies they have not seen with IWANT. A body is pulled from one
+// announcer at a time, falling back to the next one to announce it if no
+// answer comes within pull_timeout flushes, so each node receives it
+// about once however many peers offer it.
+//
+// Duplicates are dropped by a seen filter keyed by message id: two bloom
+// filters, where new ids go into the current one and lookups check both.
+// Every seen_rotation heartbeats the older filter is cleared and becomes
+// the current one, so an id is remembered for one to two rotations.
+//
+// With a PeerScoreBook, the router reports deliveries, duplicates and
+// malformed frames to it, and uses its scores: grafting prefers the best
+// candidates, pruning keeps the degree_score best members plus a random
+// rest (so high scores alone cannot capture a mesh), peers below the
+// mesh threshold are pruned, and graylisted peers are ignored.
+//
+// The router does no I/O. Frames go out through the Send callback and
+// come in through handleFrame; heartbeat() has to be called periodically.
+// Callbacks run after the router's lock is released.
+class GossipRouter {
+public:
+    using PeerID = std::string;
+    using MessageId = std::array<uint8_t, 32>;
+    using Send = std::function<void(const PeerID& peer, std::vector<uint8_t>&& frame)>;
+    using Handler = std::function<void(const std::string& topic, std::span<const uint8_t> payload,
+                                       const PeerID& from)>;
+
+    struct Config {
+        // Mesh degree target and bounds
+        size_t degree{6};
+        size_t degree_low{4};
+        size_t degree_high{12};
+        // Mesh members kept by score when pruning; the rest are random
+        size_t degree_score{4};
+        // Peers outside the mesh sent IHAVE per topic per heartbeat
+        size_t degree_lazy{6};
+        // Heartbeats a message stays retrievable by IWANT
+        size_t history_length{5};
+        // Of those, how many recent heartbeats are advertised in IHAVE
+        size_t history_gossip{3};
+        // Ids per IHAVE frame and ids answered per IWANT
+        size_t max_ihave_ids{500};
+        // Bits per seen filter; at 4 probes and 2^23 bits, 100k messages per
+        // rotation cost about five false drops per million
+        size_t seen_filter_bits{1u << 23};
+        size_t seen_rotation{120};
+        uint64_t seed{0};
+        // Relayed by announcement rather than push
+        std::unordered_set<std::string> announce_topics;
+        // flushAnnouncements() calls before an unanswered pull moves on
+        size_t pull_timeout{5};
+    };
+
+    struct Stats {
+        uint64_t published{0};
+        uint64_t delivered{0};
+        uint64_t duplicates{0};
+        uint64_t frames_sent{0};
+        uint64_t bytes_sent{0};
+        uint64_t ihave_sent{0};
+        uint64_t iwant_sent{0};
+        uint64_t announced{0};
+        uint64_t pull_retries{0};
+        uint64_t malformed{0};
+        uint64_t graylisted{0};
+    };
+
+    GossipRouter(const Config& config, Send send, std::shared_ptr<PeerScoreBook> scores = nullptr);
+
+    // Joins the topic's mesh; the handler gets messages from other peers
+    void subscribe(const std::string& topic, Handler handler);
+    void unsubscribe(const std::string& topic);
+
+    // Returns false if the same payload was already seen on this topic
+    bool publish(const std::string& topic, std::span<const uint8_t> payload);
+
+    void addPeer(const PeerID& peer);
+    void removePeer(const PeerID& peer);
+    void handleFrame(const PeerID& from, std::span<const uint8_t> frame);
+    void heartbeat();
+    // Sends the batched announcements and retries stalled pulls; call it
+    // more often than heartbeat(), as it sets the relay delay per hop
+    void flushAnnouncements();
+
+    [[nodiscard]] std::vector<PeerID> meshPeers(const std::string& topic) const;
+    [[nodiscard]] Stats stats() const;
+
+    static MessageId messageId(const std::string& topic, std::span<const uint8_t> payload);
+
+private:
+    enum class FrameKind : uint8_t {
+        Publish = 1,
+        IHave = 2,
+        IWant = 3,
+        Graft = 4,
+        Prune = 5,
+        Subscribe = 6,
+        Unsubscribe = 7
+    };
+
+    struct MessageIdHash {
+        size_t operator()(const MessageId& id) const noexcept;
+    };
+
+    class SeenFilter {
+    public:
+        explicit SeenFilter(size_t bits);
+        bool contains(const MessageId& id) const noexcept;
+        void insert(const MessageId& id) noexcept;
+        void rotate() noexcept;
+
+    private:
+        static constexpr size_t PROBES = 4;
+        size_t mask_;
+        std::vector<uint64_t> current_;
+        std::vector<uint64_t> previous_;
+    };
+
+    struct CachedMessage {
+        std::string topic;
+        std::shared_ptr<const std::vector<uint8_t>> payload;
+    };
+
+    struct Outgoing {
+        PeerID peer;
+        std::vector<uint8_t> frame;
+    };
+
+    // A body asked for by IWANT and not yet received
+    struct Pull {
+        std::string topic;
+        size_t requested_at;  // in flushAnnouncements() calls
+        PeerID asked;         // empty once that peer is removed
+        std::deque<PeerID> announcers;  // not asked yet
+    };
+
+    struct Delivery {
+        Handler handler;
+        std::string topic;
+        std::shared_ptr<const std::vector<uint8_t>> payload;
+        PeerID from;
+    };
+
+    // All of these expect mutex_ held and queue work into out
+    void forward(const std::string& topic, const MessageId& id,
+                 const std::shared_ptr<const std::vector<uint8_t>>& payload, const PeerID* except,
+                 std::vector<Outgoing>& out);
+    bool accept(const std::string& topic, const MessageId& id, std::span<const uint8_t> payload,
+                const PeerID& from, std::vector<Outgoing>& out, std::vector<Delivery>& deliveries);
+    void maintainMesh(const std::string& topic, std::vector<Outgoing>& out);
+    void emitGossip(const std::string& topic, std::vector<Outgoing>& out);
+    std::vector<PeerID> peersOnTopic(const std::string& topic, const std::unordered_set<PeerID>& exclude) const;
+    double scoreOf(const PeerID& peer) const;
+    // Best first; the shuffle beforehand breaks ties randomly
+    void rankByScore(std::vector<PeerID>& peers);
+
+    static std::vector<uint8_t> topicFrame(FrameKind kind, const std::string& topic);
+    static std::vector<uint8_t> publishFrame(const std::string& topic, std::span<const uint8_t> payload);
+    static std::vector<uint8_t> idsFrame(FrameKind kind, const std::string& topic,
+                                         const std::vector<MessageId>& ids);
+
+    // account() under mutex_, flush() after releasing it
+    void account(const std::vector<Outgoing>& out);
+    void flush(std::vector<Outgoing>& out);
+
+    const Config config_;
+    const Send send_;
+    const std::shared_ptr<PeerScoreBook> scores_;
+
+    mutable std::mutex mutex_;
+    utils::Philox rng_;
+    SeenFilter seen_;
+    size_t heartbeats_{0};
+
+    std::unordered_map<std::string, Handler> subscriptions_;
+    std::unordered_map<std::string, std::unordered_set<PeerID>> meshes_;
+    // Topics each known peer has announced
+    std::unordered_map<PeerID, std::unordered_set<std::string>> peer_topics_;
+
+    // Recent messages for IWANT, plus one id window per heartbeat
+    std::unordered_map<MessageId, CachedMessage, MessageIdHash> cache_;
+    std::deque<std::vector<MessageId>> history_;
+
+    // Ids awaiting the next flushAnnouncements(), by peer and topic
+    std::unordered_map<PeerID, std::unordered_map<std::string, std::vector<MessageId>>> announcements_;
+    std::unordered_map<MessageId, Pull, MessageIdHash> pulls_;
+    size_t flushes_{0};
+
+    Stats stats_;
+};
+
+} // namespace network
+} // namespace quids
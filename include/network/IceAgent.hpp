@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace quids::network {
+
+// An address a peer might reach us at, ranked as in RFC 8445
+struct IceCandidate {
+    enum class Type : uint8_t {
+        Host,             // a local interface
+        PortMapped,       // opened on the gateway by UPnP or NAT-PMP
+        ServerReflexive,  // as a STUN server saw us
+        Relayed
+    };
+
+    Type type{Type::Host};
+    std::string address;
+    uint16_t port{0};
+    uint32_t priority{0};
+
+    // (2^24) type preference + (2^8) local preference + 255, for the
+    // single component we use
+    static uint32_t compute_priority(Type type, uint16_t local_preference = 65535);
+    static IceCandidate make(Type type, std::string address, uint16_t port, uint16_t local_preference = 65535);
+};
+
+struct IceCandidatePair {
+    IceCandidate local;
+    IceCandidate remote;
+    uint64_t priority{0};
+
+    // RFC 8445 6.1.2.3, with the local side controlling
+    static uint64_t compute_priority(const IceCandidate& local, const IceCandidate& remote);
+};
+
+// ICE-style path selection.
+//
+// Candidate sources (host interfaces, STUN, UPnP, NAT-PMP) are gathered
+// concurrently, each on its own thread, and whatever has arrived when
+// gather_timeout runs out is used, so one slow or absent gateway costs
+// no more than the deadline. Connectivity checks for every pair start in
+// priority order, check_pacing apart, and race; the first pair that
+// succeeds wins and the others are told to stop. The winner is cached
+// per peer for cache_ttl.
+//
+// Sources and checks are plain callbacks, so the agent does no I/O of
+// its own. A source that outlives the deadline finishes in the
+// background and its result is dropped; checks should poll `cancelled`.
+class IceAgent {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Blocking; may throw, which counts as no candidates
+    using Gatherer = std::function<std::vector<IceCandidate>()>;
+    using Check = std::function<bool(const IceCandidatePair& pair, const std::atomic<bool>& cancelled,
+                                     Clock::time_point deadline)>;
+
+    struct Config {
+        std::chrono::milliseconds gather_timeout{500};
+        std::chrono::milliseconds check_timeout{1000};
+        std::chrono::milliseconds check_pacing{20};
+        std::chrono::minutes cache_ttl{10};
+    };
+
+    IceAgent();
+    explicit IceAgent(const Config& config);
+
+    void add_gatherer(std::string name, Gatherer gatherer);
+
+    // Deduplicated by address and port, best first
+    [[nodiscard]] std::vector<IceCandidate> gather() const;
+
+    // The cached pair for peer, else gathers and races checks against
+    // `remote`; nullopt if no pair succeeded in time
+    std::optional<IceCandidatePair> connect(const std::string& peer, const std::vector<IceCandidate>& remote,
+                                            const Check& check);
+
+    [[nodiscard]] std::optional<IceCandidatePair> cached(const std::string& peer) const;
+    // E.g. once the path stops working
+    void forget(const std::string& peer);
+
+    // Best first
+    static std::vector<IceCandidatePair> pair(const std::vector<IceCandidate>& local,
+                                              const std::vector<IceCandidate>& remote);
+    // Races check over pairs as connect() does, without gathering or cache
+    std::optional<IceCandidatePair> race(const std::vector<IceCandidatePair>& pairs, const Check& check) const;
+
+private:
+    struct CachedPair {
+        IceCandidatePair pair;
+        Clock::time_point expires;
+    };
+
+    const Config config_;
+    std::vector<std::pair<std::string, Gatherer>> gatherers_;
+    mutable std::mutex cache_mutex_;
+    std::unordered_map<std::string, CachedPair> cache_;
+};
+
+} // namespace quids::network
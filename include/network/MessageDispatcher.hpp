@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace quids::network {
+
+// Runs inbound message handlers off the receive thread, by priority class.
+//
+// Topics are interned once to a dense TopicId, and the receive path looks
+// the topic's route up in a table that is replaced whole on every change,
+// so it takes no lock and does no string hashing. Each topic has its own
+// bounded queue; a message that finds it full is dropped and counted, so a
+// flood on one topic costs only that topic's messages.
+//
+// Each priority class has its own workers, which take turns over the
+// class's topics with ready messages, handling up to drain_batch from one
+// before moving on to the next. Classes share nothing, so however far
+// behind the transaction workers fall, consensus messages are picked up as
+// soon as they arrive. A topic is drained by one worker at a time, so its
+// messages are handled in the order they came in.
+class MessageDispatcher {
+public:
+    enum class Priority : uint8_t { Consensus, Blocks, Transactions, Dht };
+    static constexpr size_t PRIORITY_COUNT = 4;
+
+    using TopicId = uint32_t;
+    using Handler = std::function<void(const std::vector<uint8_t>& payload, const std::string& from)>;
+
+    struct Config {
+        // Worker threads per class, in Priority order
+        std::array<size_t, PRIORITY_COUNT> workers{2, 1, 2, 1};
+        // Messages waiting per topic; more are dropped
+        size_t queue_capacity{1024};
+        // Messages handled from one topic before the next gets a turn
+        size_t drain_batch{32};
+    };
+
+    struct Stats {
+        uint64_t queued{0};
+        uint64_t handled{0};
+        uint64_t dropped{0};    // queue full, or not running
+        uint64_t unrouted{0};   // no handler for the topic
+    };
+
+    explicit MessageDispatcher(const Config& config);
+    ~MessageDispatcher();
+
+    MessageDispatcher(const MessageDispatcher&) = delete;
+    MessageDispatcher& operator=(const MessageDispatcher&) = delete;
+
+    // Same id for the same name, and ids are never reused
+    TopicId intern(const std::string& topic);
+    [[nodiscard]] std::optional<TopicId> find(const std::string& topic) const;
+
+    // Replaces the topic's handler; messages already queued follow the
+    // topic to its new class from its next turn
+    void setHandler(TopicId topic, Priority priority, Handler handler);
+
+    // Queues a message for its topic's handler; false if it was dropped,
+    // which it always is while the dispatcher is stopped
+    bool dispatch(TopicId topic, std::vector<uint8_t> payload, std::string from);
+
+    void start();
+    // Joins the workers; messages still queued are dropped
+    void stop();
+
+    [[nodiscard]] Stats stats(Priority priority) const;
+
+private:
+    struct Message {
+        std::vector<uint8_t> payload;
+        std::string from;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Message> messages;
+        bool scheduled{false};  // on a class's ready list, or being drained
+    };
+
+    struct Route {
+        std::shared_ptr<Queue> queue;
+        Priority priority{Priority::Transactions};
+        Handler handler;
+    };
+
+    struct Table {
+        std::unordered_map<std::string, TopicId> ids;
+        std::vector<Route> routes;  // by id
+    };
+
+    struct Lane {
+        std::mutex mutex;
+        std::condition_variable ready_cv;
+        std::deque<TopicId> ready;
+        std::vector<std::thread> workers;
+        std::atomic<uint64_t> queued{0};
+        std::atomic<uint64_t> handled{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> unrouted{0};
+    };
+
+    void schedule(TopicId topic, Priority priority);
+    void work(Lane& lane);
+
+    const Config config_;
+    std::atomic<std::shared_ptr<const Table>> table_;
+    std::mutex writer_mutex_;  // serialises table copies
+    std::array<Lane, PRIORITY_COUNT> lanes_;
+    std::atomic<bool> running_{false};
+};
+
+} // namespace quids::network
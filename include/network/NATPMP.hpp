@@ -20,6 +20,9 @@ public:
      // Method to discover the gateway
     std::string discover_gateway(); // Add this line
     
+    // The gateway's public address; nullopt if it does not answer
+    std::optional<std::string> external_address();
+
     // Method to set up a mapping
     std::optional<bool> setupMapping(uint16_t internal_port, uint16_t external_port, uint16_t lifetime);
 
@@ -31,6 +34,9 @@ public:
     // Method to remove a mapping
     void removeMapping();
 
+    // Of the last successful map_port()
+    uint16_t mapped_external_port() const { return mapped_external_port_; }
+
     // Method to get the last seen time
     std::chrono::system_clock::time_point get_last_seen() const;
 
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "network/FrameBatcher.hpp"
+
+namespace quids {
+namespace network {
+
+// Peers are named by their node ID, as FrameBatcher and PeerScoreBook do
+using NodeID = std::string;
+
+// What OptimizedNetworkLayer moves between its rings and the transport:
+// one or more wire frames, or a sealed record of them
+struct Message {
+    NodeID sender;
+    NodeID target;
+    std::vector<uint8_t> data;
+};
+
+// A message the transport could not take
+class NetworkError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct NetworkConfig {
+    uint16_t port;
+    size_t maxConnections;
+    size_t bufferSize;
+    bool useQuantumEncryption;
+    std::string certificatePath;
+    std::string privateKeyPath;
+    size_t numWorkerThreads;
+    // Per-peer coalescing and compression of the gossip lane
+    FrameBatcher::Config batching{};
+    // Send budget in bits per second, split across peers by score; 0 is
+    // unlimited
+    size_t maxSendBitrate{0};
+    // Where QUIC sessions are kept across restarts for 0-RTT reconnects;
+    // empty keeps them in memory only
+    std::string sessionCacheDir;
+};
+
+} // namespace network
+} // namespace quids
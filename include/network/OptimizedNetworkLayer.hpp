@@ -1,30 +1,66 @@
 
-#include <memory>
-#include <vector>
-#include <queue>
+#pragma once
+
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <thread>
-#include "network/QUICTransport.hpp"
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "network/FrameBatcher.hpp"
+#include "network/NetworkTypes.hpp"
+#include "network/PeerScoreBook.hpp"
+#include "network/RecordLayer.hpp"
+#include "network/WireFormat.hpp"
 #include "node/QuidsConfig.hpp"
-#include "utils/LockFreeQueue.hpp"
+#include "utils/BoundedQueue.hpp"
+#include "utils/Metrics.hpp"
 #include "quantum/QuantumTypes.hpp"
 
 namespace quids {
 namespace network {
 
-struct NetworkConfig {
-    uint16_t port;
-    size_t maxConnections;
-    size_t bufferSize;
-    bool useQuantumEncryption;
-    std::string certificatePath;
-    std::string privateKeyPath;
-    size_t numWorkerThreads;
+// Point-in-time view of OptimizedNetworkLayer's counters
+struct NetworkMetrics {
+    uint64_t messagesProcessed{0};
+    uint64_t bytesTransferred{0};
+    uint64_t activeConnections{0};
+    // Time to dispatch one received message, in nanoseconds
+    uint64_t latencyP50{0};
+    uint64_t latencyP99{0};
+    uint64_t latencyP999{0};
+    uint64_t errorCount{0};
+};
+
+// What the layer needs from the transport underneath it. Nodes run it
+// over QUICTransport; tests plug in their own.
+class MessageTransport {
+public:
+    virtual ~MessageTransport() = default;
+
+    virtual void start() = 0;
+    virtual void stop() = 0;
+    virtual size_t getActiveConnections() const = 0;
+    // Throws NetworkError when the message cannot be queued
+    virtual void sendMessage(Message&& msg) = 0;
+    // What arrived since the last call
+    virtual std::vector<Message> receiveMessages() = 0;
+    virtual void setMaxStreamBitrate(size_t bitrate) = 0;
+    virtual void setPeerWeights(const std::vector<std::pair<NodeID, double>>& weights) = 0;
+    virtual void setDisconnectionHandler(std::function<void(const NodeID&)> handler) = 0;
 };
 
 class OptimizedNetworkLayer {
 public:
+    // Over a QUICTransport built from config; defined in
+    // QUICMessageTransport.cpp, which builds only where QUICTransport does
     explicit OptimizedNetworkLayer(const NetworkConfig& config);
+    OptimizedNetworkLayer(const NetworkConfig& config, std::unique_ptr<MessageTransport> transport);
     ~OptimizedNetworkLayer();
 
     // Disable copy
@@ -34,16 +70,30 @@ public:
     // Network operations
     void start();
     void stop();
+    // Gossip lane: frames are coalesced per peer and compressed per type
     void broadcastMessage(const Message& msg);
     void sendMessage(const NodeID& target, const Message& msg);
+    // Consensus lane: skips batching and is drained ahead of gossip
+    void sendConsensusMessage(const NodeID& target, Message&& msg);
 
     // Connection management
     void addPeer(const NodeID& peer);
     void removePeer(const NodeID& peer);
+    // With useQuantumEncryption, traffic to and from peer is sealed under
+    // the secret its hybrid KEM handshake agreed on; until this is called
+    // for a peer, its messages are dropped rather than sent in the clear
+    void installSessionKey(const NodeID& peer, std::span<const uint8_t> secret, bool initiator);
     std::vector<NodeID> getActivePeers() const;
 
-    // Message handling
-    void registerMessageHandler(MessageType type, MessageHandler handler);
+    // Message handling. Every message carries one or more wire frames;
+    // each is dispatched by its header type with its payload viewed in place
+    using MessageHandler = std::function<void(const NodeID& from, const wire::Frame& frame)>;
+    void registerMessageHandler(uint8_t type, MessageHandler handler);
+    // Must match what peers use; see FrameBatcher
+    void setFrameDictionary(uint8_t type, const std::vector<uint8_t>& dictionary);
+    // Dispatches up to BATCH_SIZE received messages on the calling thread.
+    // The owner has to keep calling it; workers drop what arrives while
+    // the incoming ring is full rather than wait for it.
     void processIncomingMessages();
 
     // Metrics
@@ -51,13 +101,23 @@ public:
     void resetMetrics();
 
 private:
+    static constexpr size_t MAX_MESSAGE_TYPES = 256;
+
     // Core components
-    std::unique_ptr<QUICTransport> transport_;
+    std::unique_ptr<MessageTransport> transport_;
+    std::unique_ptr<FrameBatcher> batcher_;
+    RecordLayer records_;
+    // Feeds the transport's per-peer send budgets once per SCORE_INTERVAL
+    std::shared_ptr<PeerScoreBook> scores_;
+    std::atomic<int64_t> nextScoreRound_{0};
     std::vector<std::unique_ptr<std::thread>> workerThreads_;
     
-    // Lock-free message queues
-    utils::LockFreeQueue<Message> incomingQueue_;
-    utils::LockFreeQueue<Message> outgoingQueue_;
+    // Bounded lock-free rings sized by config.bufferSize. Senders back off
+    // while an outgoing ring is full; received messages that find the
+    // incoming ring full are dropped and counted in errorCount
+    utils::BoundedQueue<Message> incomingQueue_;
+    utils::BoundedQueue<Message> outgoingQueue_;
+    utils::BoundedQueue<Message> consensusQueue_;
     
     // Message handlers
     std::array<MessageHandler, MAX_MESSAGE_TYPES> messageHandlers_;
@@ -65,33 +125,43 @@ private:
     // Network state
     std::atomic<bool> running_{false};
     NetworkConfig config_;
+    // Broadcast targets, from addPeer() and removePeer()
+    mutable std::mutex peersMutex_;
+    std::unordered_set<NodeID> peers_;
     
-    // Metrics tracking
-    struct alignas(64) NetworkMetrics {
-        std::atomic<uint64_t> messagesProcessed{0};
-        std::atomic<uint64_t> bytesTransferred{0};
-        std::atomic<uint64_t> activeConnections{0};
-        std::atomic<double> averageLatency{0.0};
-        std::atomic<uint64_t> errorCount{0};
+    // Sharded per thread and attached to the global metrics registry
+    struct Metrics {
+        std::shared_ptr<utils::Counter> messagesProcessed = std::make_shared<utils::Counter>();
+        std::shared_ptr<utils::Counter> bytesTransferred = std::make_shared<utils::Counter>();
+        std::shared_ptr<utils::Gauge> activeConnections = std::make_shared<utils::Gauge>();
+        std::shared_ptr<utils::Histogram> dispatchLatency = std::make_shared<utils::Histogram>();
+        std::shared_ptr<utils::Counter> errorCount = std::make_shared<utils::Counter>();
     } metrics_;
 
     // Internal helper functions
     void workerThread();
     void processMessage(const Message& msg);
     void handleError(const NetworkError& error);
+    void enqueueAll(utils::BoundedQueue<Message>& queue, std::vector<Message>& messages);
+    size_t drainOutgoing(utils::BoundedQueue<Message>& queue, std::vector<Message>& batch, size_t max,
+                         bool batched);
+    void sendPacket(const NodeID& target, std::vector<uint8_t>&& packet);
+    void updateScores();
     
     // SIMD-optimized message processing
     void processBatchSIMD(const std::vector<Message>& batch);
-    void compressMessagesSIMD(std::vector<Message>& messages);
     
-    // Quantum encryption
-    void encryptQuantum(Message& msg);
-    void decryptQuantum(Message& msg);
+    // Record protection, one RecordLayer call per peer in the batch;
+    // messages that fail are counted as errors and removed
+    void sealBatch(std::vector<Message>& batch);
+    void openBatch(std::vector<Message>& batch);
     
     // Constants
     static constexpr size_t BATCH_SIZE = 1024;
+    // Gossip sent between checks of the consensus lane
+    static constexpr size_t GOSSIP_SLICE = 64;
     static constexpr size_t CACHE_LINE_SIZE = 64;
-    static constexpr size_t MAX_MESSAGE_TYPES = 256;
+    static constexpr std::chrono::seconds SCORE_INTERVAL{1};
 };
 
 } // namespace network
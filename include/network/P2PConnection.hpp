@@ -1,6 +1,8 @@
 #pragma once
 
+#include "network/IceAgent.hpp"
 #include <boost/asio.hpp>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <functional>
@@ -48,15 +50,24 @@ public:
           config_(config),
           connected_(false),
           peer_port_(0),
-          last_seen_(std::chrono::steady_clock::now()) {
+          last_seen_(std::chrono::steady_clock::now()),
+          ice_(ice_config(config)) {
         stats_.connected_since = std::chrono::steady_clock::now();
+        add_candidate_sources();
     }
     ~P2PConnection() = default;
 
     bool start();
     void stop();
     bool ping();
+    // Host, STUN, UPnP and NAT-PMP candidates are gathered in parallel and
+    // connectivity checks race (see IceAgent); the path found is cached
+    // per peer. The first form knows only the peer's address; the second
+    // takes the candidates it sent, e.g. through the DHT.
     bool perform_nat_traversal(const std::string& ip, uint16_t port);
+    bool perform_nat_traversal(const std::string& peer, const std::vector<IceCandidate>& remote);
+    // Ours, to send to a peer
+    std::vector<IceCandidate> local_candidates() const;
     void broadcast(const std::vector<uint8_t>& data);
     bool send_message(const std::string& peer_address, uint16_t peer_port,
                      const std::vector<uint8_t>& message);
@@ -79,6 +90,13 @@ public:
     const ConnectionStats& get_stats() const;
 
 private:
+    static IceAgent::Config ice_config(const Config& config);
+    void add_candidate_sources();
+    // Hole punching: sends probes to the remote candidate and succeeds on
+    // the first datagram back from it, which the peer's own probes are
+    static bool probe(const IceCandidatePair& pair, const std::atomic<bool>& cancelled,
+               IceAgent::Clock::time_point deadline);
+
     boost::asio::io_context& io_context_;
     boost::asio::ip::udp::socket socket_;
     const Config config_;
@@ -89,6 +107,7 @@ private:
     uint16_t peer_port_{0};
     std::chrono::steady_clock::time_point last_seen_;
     ConnectionStats stats_;
+    IceAgent ice_;
 };
 
 } // namespace quids::network
\ No newline at end of file
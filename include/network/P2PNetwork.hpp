@@ -5,6 +5,12 @@
 #include <memory>
 #include <functional>
 #include <mutex>
+#include <chrono>
+#include <optional>
+#include <span>
+#include "network/CompactBlock.hpp"
+#include "network/DataAvailability.hpp"
+#include "network/MessageDispatcher.hpp"
 
 namespace quids {
 
@@ -35,9 +41,36 @@ public:
         std::string address;
         uint16_t port{0};
         bool is_validator{false};
+        // PeerScoreBook score; the lowest-scoring peer is evicted first
+        // once max_peers is exceeded
+        double score{0.0};
     };
 
     using MessageHandler = std::function<void(const std::vector<uint8_t>&, const std::string&)>;
+    // Builds the reply to a request from peer
+    using RequestHandler = std::function<std::vector<uint8_t>(std::span<const uint8_t>, const std::string& peer)>;
+    // Called exactly once: with the reply, or nullopt on timeout or stop
+    using ResponseCallback = std::function<void(std::optional<std::vector<uint8_t>>)>;
+    // Gets each rebuilt block once; false if it fails validation, e.g.
+    // its transactions do not match the header's merkle root
+    using BlockHandler = std::function<bool(const std::vector<uint8_t>& header,
+                                            const std::vector<std::vector<uint8_t>>& transactions,
+                                            const std::string& peer)>;
+    using AvailabilityCallback = std::function<void(bool available)>;
+    using ChunkedBlockCallback = std::function<void(std::optional<std::vector<uint8_t>> block)>;
+
+    static constexpr std::chrono::milliseconds DEFAULT_REQUEST_TIMEOUT{10000};
+
+    // Handlers for it run in the consensus class by default
+    static constexpr const char* CONSENSUS_TOPIC = "quids/consensus";
+    // Gossip topics the broadcast helpers publish on
+    static constexpr const char* TRANSACTION_TOPIC = "quids/transactions";
+    static constexpr const char* STATE_UPDATE_TOPIC = "quids/state-updates";
+    // Its mesh carries compact blocks, as direct frames rather than gossip
+    static constexpr const char* BLOCK_TOPIC = "quids/blocks";
+
+    // Peers each chunk of an erasure-coded block is pushed to
+    static constexpr size_t CHUNK_REPLICATION = 2;
 
     explicit P2PNetwork(const NetworkConfig& config);
     ~P2PNetwork();
@@ -56,11 +89,53 @@ public:
     bool connect_to_peer(const std::string& peer_address);
     std::vector<NodeInfo> get_connected_peers() const;
 
-    // Message handling
+    // Message handling; topics are gossip topics, so a handler sees each
+    // message once however many peers relay it. Handlers run on the
+    // dispatcher's workers for their priority class (see
+    // MessageDispatcher), by default consensus for CONSENSUS_TOPIC, blocks
+    // for the block and state-update topics and transactions otherwise.
+    // Compact blocks and chunk pushes are handled in the blocks and DHT
+    // classes too.
     void register_message_handler(const std::string& topic, MessageHandler handler);
+    void register_message_handler(const std::string& topic, MessageHandler handler,
+                                  MessageDispatcher::Priority priority);
+    static MessageDispatcher::Priority default_priority(const std::string& topic);
     void broadcast_transaction(const blockchain::Transaction& tx);
     void broadcast_state_update(const rollup::StateTransitionProof& proof);
 
+    // Request/response with one peer ("address:port"), outside gossip.
+    // Replies are matched by request id; ones arriving after the timeout
+    // are dropped. The handler runs on the receive thread.
+    void request(const std::string& peer_address, std::vector<uint8_t> payload, ResponseCallback done,
+                 std::chrono::milliseconds timeout = DEFAULT_REQUEST_TIMEOUT);
+    void set_request_handler(RequestHandler handler);
+
+    // Compact block relay. A block goes to the block topic's mesh peers as
+    // its header and a short id per transaction (see CompactBlock).
+    // Receivers rebuild it from `source`, fetch what they lack from the
+    // peer that sent it in one request, and pass it on to their own mesh
+    // only once it is complete and `handler` accepted it, so any relayer
+    // can serve the transactions it sends ids for. A block that fails
+    // validation after mempool matching is fetched in full once, in case
+    // a short id matched the wrong transaction.
+    void broadcast_block(std::vector<uint8_t> header, std::span<const CompactBlock::Hash> tx_hashes,
+                         std::vector<std::vector<uint8_t>> transactions);
+    void set_block_handler(CompactBlock::TransactionSource source, BlockHandler handler);
+
+    // Erasure-coded dissemination for large blocks (see DataAvailability).
+    // Each chunk goes to the CHUNK_REPLICATION peers whose ids are closest
+    // to its key in the routing table, and is kept here too; the block's
+    // commitment has to reach other nodes some other way, e.g. in its
+    // header. Readers then fetch chunks from their holders: any
+    // data_chunks of them for the whole block, or a few random ones to
+    // check it is available. Callbacks run on the receive thread.
+    AvailabilityCommitment publish_block_chunks(std::span<const uint8_t> block, uint32_t data_chunks = 32,
+                                                uint32_t parity_chunks = 32);
+    // True once every sampled chunk arrived with a valid proof; see
+    // AvailabilityCommitment::miss_probability() for how many to take
+    void sample_availability(const AvailabilityCommitment& commitment, size_t samples, AvailabilityCallback done);
+    void fetch_chunked_block(const AvailabilityCommitment& commitment, ChunkedBlockCallback done);
+
     // Validator management
     bool register_as_validator(const std::string& validator_key);
 
@@ -69,6 +144,23 @@ private:
     void handle_peer_connection(const std::string& peer_address);
     void handle_peer_disconnection(const std::string& peer_address);
     std::string generate_node_id();
+    void send_gossip_frame(const std::string& peer_address, std::vector<uint8_t>&& frame);
+    bool send_frame(const std::string& peer_address, uint8_t type, std::span<const uint8_t> payload);
+    void handle_request_frame(const std::string& peer, uint8_t type, std::span<const uint8_t> payload);
+    void expire_requests(bool all);
+    void send_request(const std::string& peer_address, uint8_t type, std::span<const uint8_t> payload,
+                      ResponseCallback done, std::chrono::milliseconds timeout);
+    void handle_compact_block(const std::string& peer, std::span<const uint8_t> payload);
+    std::vector<uint8_t> serve_block_transactions(std::span<const uint8_t> body);
+    void finish_block(const std::string& peer, const CompactBlock& block,
+                      std::vector<std::vector<uint8_t>> transactions, bool from_source);
+    void relay_block(const CompactBlock& block, std::vector<std::vector<uint8_t>> transactions,
+                     const std::string* except);
+    void handle_chunk_push(const std::string& peer, std::span<const uint8_t> payload);
+    std::vector<uint8_t> serve_chunk(std::span<const uint8_t> body);
+    std::vector<std::string> chunk_holders(const AvailabilityCommitment& commitment, uint32_t index, size_t count);
+    void fetch_chunk(const AvailabilityCommitment& commitment, uint32_t index,
+                     std::function<void(std::optional<BlockChunk>)> done);
 
     NetworkConfig config_;
     class Impl;
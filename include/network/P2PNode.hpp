@@ -5,8 +5,10 @@
 #include <memory>
 #include <functional>
 #include <mutex>
+#include <span>
 #include <chrono>
 #include "network/P2PConnection.hpp"
+#include "network/DatagramEngine.hpp"
 #include <boost/asio.hpp>
 #include <atomic>
 #include <unordered_map>
@@ -46,7 +48,12 @@ public:
         std::string node_name;
         std::string node_version;
         std::string node_listen_address;
-        
+        // Receive sockets sharing bind_port; 0 means one per core
+        size_t datagram_workers{0};
+        // Datagrams per recvmmsg or sendmmsg call
+        size_t datagram_batch{64};
+        bool enable_gro{true};
+        bool enable_gso{true};
     };
 
     struct PeerInfo {
@@ -58,7 +65,8 @@ public:
         bool is_connected{false};
     };
 
-    using MessageHandler = std::function<void(const std::string&, uint16_t, const std::vector<uint8_t>&)>;
+    // The data span points into a receive buffer and is only valid during the call
+    using MessageHandler = std::function<void(const std::string&, uint16_t, std::span<const uint8_t>)>;
 
     explicit P2PNode(const Config& config);
     ~P2PNode();
@@ -87,15 +95,13 @@ public:
     void discover_peers();
     std::vector<std::pair<std::string, uint16_t>> get_bootstrap_peers() const;
 
-    // Add missing method declaration
-    void process_incoming_connections();
-
     void cleanup() noexcept;
 
 private:
-    void accept_connections();
+    void handle_datagram(const std::string& address, uint16_t port, std::span<const uint8_t> data);
+    void register_peer(const std::string& address, uint16_t port);
+    void notify_handlers(const std::string& address, uint16_t port, std::span<const uint8_t> data);
     void manage_connections();
-    void handle_incoming_messages();
     void cleanup_disconnected_peers();
     bool validate_peer(const std::string& address, uint16_t port);
     void update_peer_info(const std::string& address, uint16_t port, bool connected);
@@ -111,14 +117,11 @@ private:
     struct Impl {
         Config config;
         boost::asio::io_context io_context_;
-        boost::asio::ip::udp::socket socket_{io_context_};
-        std::thread accept_thread;
+        std::unique_ptr<DatagramEngine> datagrams;
         std::thread management_thread;
-        std::thread message_thread;
         std::atomic<bool> should_stop{false};
         std::unordered_map<std::string, std::shared_ptr<P2PConnection>> connections;
         std::mutex connections_mutex;
-        std::function<void(const std::string&, uint16_t, const std::vector<uint8_t>&)> message_handler_;
     };
 
     std::unique_ptr<Impl> impl_;
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace network {
+
+// Running score per peer, from what the peer has actually done for us.
+//
+//   score = rtt_weight        * ref / (ref + srtt)
+//         + throughput_weight * useful / (useful + ref)
+//         + useful_weight     * first deliveries / (deliveries + 1)
+//         + invalid_weight    * invalid^2
+//         + validator_bonus   if the peer is a validator
+//
+// Useful throughput only counts messages the peer was first to deliver,
+// so replaying duplicates or junk earns nothing. The counters decay by
+// decay_factor on every decay() call (once per gossip heartbeat), which
+// lets a peer recover from old mistakes. A peer that disconnects keeps its
+// score for retain_rounds decays, so reconnecting does not wipe a penalty.
+//
+// Scores feed three places: mesh selection and gossip targets in
+// GossipRouter, max_peers eviction in P2PNetwork, and per-peer send
+// budgets in QUICTransport through bandwidthWeights().
+class PeerScoreBook {
+public:
+    using PeerID = std::string;
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        std::chrono::microseconds rtt_reference{100000};
+        double throughput_reference{64.0 * 1024}; // useful bytes per second
+        double rtt_weight{1.0};
+        double throughput_weight{1.0};
+        double useful_weight{2.0};
+        double invalid_weight{-10.0};
+        double validator_bonus{10.0};
+        double decay_factor{0.9};
+        // Counters below this snap to zero
+        double decay_to_zero{0.01};
+        size_t retain_rounds{600};
+
+        // Below mesh_threshold a peer is pruned and not grafted; below
+        // gossip_threshold it gets no IHAVE; below graylist_threshold its
+        // frames are dropped unread
+        double mesh_threshold{0.0};
+        double gossip_threshold{-10.0};
+        double graylist_threshold{-50.0};
+
+        // Bandwidth shares: negative peers keep a trickle so they can
+        // recover, validators get a multiple of their share
+        double min_share{0.05};
+        double validator_share{4.0};
+    };
+
+    explicit PeerScoreBook(const Config& config);
+
+    void addPeer(const PeerID& peer, bool validator = false);
+    void removePeer(const PeerID& peer);
+    void setValidator(const PeerID& peer, bool validator);
+
+    void recordRtt(const PeerID& peer, std::chrono::microseconds rtt);
+    void recordDelivery(const PeerID& peer, size_t bytes, bool first);
+    void recordInvalid(const PeerID& peer);
+
+    void decay(Clock::time_point now = Clock::now());
+
+    // Unknown peers score 0
+    [[nodiscard]] double score(const PeerID& peer) const;
+    // Lowest-scoring connected non-validator, if any
+    [[nodiscard]] std::optional<PeerID> evictionCandidate() const;
+    // Connected peers with their relative share of the send bandwidth
+    [[nodiscard]] std::vector<std::pair<PeerID, double>> bandwidthWeights() const;
+
+    [[nodiscard]] const Config& config() const noexcept { return config_; }
+
+private:
+    struct Peer {
+        bool connected{true};
+        bool validator{false};
+        size_t rounds_away{0};
+        double srtt_us{0.0};
+        double useful_bytes{0.0}; // since the last decay
+        double throughput{0.0};
+        double first_deliveries{0.0};
+        double deliveries{0.0};
+        double invalid{0.0};
+    };
+
+    double scoreOf(const Peer& peer) const noexcept;
+
+    const Config config_;
+    mutable std::mutex mutex_;
+    std::unordered_map<PeerID, Peer> peers_;
+    Clock::time_point last_decay_{Clock::now()};
+};
+
+} // namespace network
+} // namespace quids
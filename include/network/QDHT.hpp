@@ -1,6 +1,10 @@
 #pragma once
 
 #include "network/QDHTConstants.hpp"
+#include "network/QDHTLookup.hpp"
+#include "network/QDHTMessages.hpp"
+#include "network/QDHTValueStore.hpp"
+#include "network/RoutingIndex.hpp"
 #include <memory>
 #include <vector>
 #include <array>
@@ -12,48 +16,24 @@
 #include "quantum/QKDSystem.hpp"
 #include "quantum/QuantumConsensus.hpp"
 
-namespace quids::network {
-
-// Forward declarations
-namespace quantum {
-    class QKDSystem;
-    class QuantumConsensus;
-    enum class QuantumSecurityLevel {
-        HIGH,
-        MEDIUM,
-        LOW
-    };
+namespace quids::quantum {
+class QuantumConsensus;
 }
 
+namespace quids::network {
+
 // Forward declarations
 class QDHTNode;
 class QDHTBucket;
 class QDHTRoutingTable;
 struct QuantumRoutingTree;
 
-// Message type enum
-enum class MessageType {
-    PING,
-    PONG,
-    STORE,
-    STORE_ACK,
-    FIND_VALUE,
-    VALUE_RESPONSE,
-    NODES_RESPONSE
-};
-
 // Internal message structures
 struct Message {
     MessageType type;
     std::vector<uint8_t> data;
 };
 
-struct FindValueResponse {
-    bool found;
-    std::vector<uint8_t> value;
-    std::vector<QNodeIdentity> closest_nodes;
-};
-
 // Quantum-secure node identity
 struct QNodeIdentity {
     std::array<uint8_t, QDHT_ID_LENGTH / 8> id;
@@ -62,13 +42,19 @@ struct QNodeIdentity {
     uint16_t port{0};
     std::chrono::steady_clock::time_point last_seen;
     bool is_validator{false};
-    ::quids::quantum::QuantumState quantum_state;
+    ::quids::quantum::QuantumState quantum_state{QDHT_STATE_QUBITS};
 
     static std::array<uint8_t, QDHT_ID_LENGTH / 8> distance(const QNodeIdentity& a, const QNodeIdentity& b);
     static QNodeIdentity generate();
     bool verify(const std::vector<uint8_t>& signature) const;
 };
 
+struct FindValueResponse {
+    bool found;
+    std::vector<uint8_t> value;
+    std::vector<QNodeIdentity> closest_nodes;
+};
+
 // Internal lookup state
 struct LookupState {
     QNodeIdentity target;
@@ -97,6 +83,8 @@ public:
     QDHTBucket();
     ~QDHTBucket();
 
+    // False when the bucket is full or the node's state is not
+    // QDHT_STATE_QUBITS wide
     bool add_node(const QNodeIdentity& node);
     bool remove_node(const QNodeIdentity& node);
     std::vector<QNodeIdentity> get_closest_nodes(
@@ -107,24 +95,32 @@ public:
     std::pair<std::unique_ptr<QDHTBucket>, std::unique_ptr<QDHTBucket>> split();
     void refresh();
 
-    const QBucketMetrics& get_metrics() const { return metrics_; }
+    // Recomputed here once membership has changed since the last read,
+    // and by refresh(), so churn alone costs no quantum work
+    const QBucketMetrics& get_metrics() const;
     const std::vector<QNodeIdentity>& get_nodes() const { return nodes_; }
 
 private:
     std::vector<QNodeIdentity> nodes_;
+    // XOR-metric keys of nodes_, position for position
+    RoutingIndex index_;
     std::chrono::steady_clock::time_point last_updated_;
     size_t prefix_length_{0};
     std::array<uint8_t, QDHT_ID_LENGTH / 8> prefix_;
-    QBucketMetrics metrics_;
+    mutable QBucketMetrics metrics_;
+    mutable bool metrics_dirty_{false};
     std::unique_ptr<QuantumRoutingTree> routing_tree_;
+    // Base state plus the members' state vectors, updated per node as they
+    // come and go; the tree's state is this normalised
+    Eigen::VectorXcd routing_sum_;
 
     void initialize_quantum_state();
-    void update_metrics();
+    void add_to_routing_tree(const QNodeIdentity& node, double sign);
+    void update_metrics() const;
     bool verify_prefix_match(const QNodeIdentity& node) const;
-    double calculate_distance(const std::array<uint8_t, QDHT_ID_LENGTH / 8>& a,
-                            const std::array<uint8_t, QDHT_ID_LENGTH / 8>& b) const;
     double calculate_entanglement_factor() const;
     double calculate_coherence_level() const;
+    double calculate_quantum_entropy() const;
 };
 
 // Quantum-enhanced routing table
@@ -177,6 +173,9 @@ public:
 
     // Quantum-enhanced DHT operations
     std::vector<QNodeIdentity> find_node(const QNodeIdentity& target);
+    // Iterative lookup from the routing table's closest nodes, alpha
+    // requests at a time; done runs on the lookup engine's strand
+    void find_node_async(const QNodeIdentity& target, QDHTLookup::Completion done);
     bool store_value(
         const std::array<uint8_t, QDHT_ID_LENGTH / 8>& key,
         const std::vector<uint8_t>& value,
@@ -196,6 +195,8 @@ private:
     std::unique_ptr<QDHTRoutingTable> routing_table_;
     std::shared_ptr<quantum::QKDSystem> qkd_system_;
     std::shared_ptr<quantum::QuantumConsensus> consensus_;
+    std::unique_ptr<QDHTLookup> lookup_;
+    std::unique_ptr<QDHTValueStore> values_;
 
     // Quantum-enhanced network operations
     void handle_find_node(const QNodeIdentity& sender, const QNodeIdentity& target);
@@ -8,5 +8,6 @@ constexpr size_t QDHT_ID_LENGTH = 256;  // Length of node IDs in bits (quantum-s
 constexpr size_t QDHT_K = 20;           // Size of k-buckets
 constexpr size_t QDHT_ALPHA = 3;        // Number of parallel lookups
 constexpr size_t QDHT_B = 256;          // Number of bits per digit
+constexpr size_t QDHT_STATE_QUBITS = 1; // Width of node and bucket routing states
 
 } // namespace quids::network 
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include "network/QDHTConstants.hpp"
+
+namespace quids::network {
+
+// Where to reach a node; what FIND_NODE requests and replies carry
+struct QDHTContact {
+    std::array<uint8_t, QDHT_ID_LENGTH / 8> id{};
+    std::string address;
+    uint16_t port{0};
+};
+
+// Iterative Kademlia FIND_NODE lookups on an io_context.
+//
+// A lookup keeps a shortlist of known contacts ordered by XOR distance to
+// the target and keeps up to alpha requests in flight to the closest ones
+// not yet asked. Each reply merges the returned contacts into the
+// shortlist; a request to a contact that has dropped out of the k closest
+// is cancelled, since its answer can no longer change the result. The
+// lookup completes when the k closest live contacts have all answered.
+//
+// Every request gets a timeout from that peer's smoothed RTT (RFC 6298
+// style), doubled after each timeout until the peer answers again, so a
+// slow peer costs its own latency rather than a fixed worst case.
+//
+// Lookups for a target that is already being looked up join the running
+// one and complete with it.
+//
+// The engine does no I/O. Requests go out through Transport::find_node,
+// which must eventually call the reply with the peer's contacts, or with
+// nullopt if the request failed; replies may come from any thread. All
+// state lives on a strand, and completions are called on it.
+class QDHTLookup {
+public:
+    using NodeId = std::array<uint8_t, QDHT_ID_LENGTH / 8>;
+    using Reply = std::function<void(std::optional<std::vector<QDHTContact>> contacts)>;
+    using Completion = std::function<void(std::vector<QDHTContact> closest)>;
+
+    struct Transport {
+        std::function<void(uint64_t request, const QDHTContact& peer, const NodeId& target, Reply reply)>
+            find_node;
+        // Optional; the reply for a cancelled request is ignored either way
+        std::function<void(uint64_t request)> cancel;
+    };
+
+    struct Config {
+        size_t alpha{QDHT_ALPHA};
+        size_t k{QDHT_K};
+        // Contacts kept per lookup beyond the k closest, as fallbacks
+        size_t shortlist_limit{QDHT_K * 4};
+        // Contacts with this id are never queried or returned
+        std::optional<NodeId> self;
+        std::chrono::milliseconds initial_timeout{1000};
+        std::chrono::milliseconds min_timeout{50};
+        std::chrono::milliseconds max_timeout{5000};
+        // Peers whose RTT is remembered
+        size_t rtt_table_limit{4096};
+    };
+
+    struct Stats {
+        uint64_t lookups{0};
+        uint64_t coalesced{0};
+        uint64_t requests{0};
+        uint64_t replies{0};
+        uint64_t timeouts{0};
+        uint64_t failures{0};
+        uint64_t cancelled{0};
+    };
+
+    QDHTLookup(boost::asio::io_context& io_context, Transport transport, Config config);
+    QDHTLookup(boost::asio::io_context& io_context, Transport transport);
+    // Cancels every running lookup; their completions are not called
+    ~QDHTLookup();
+
+    QDHTLookup(const QDHTLookup&) = delete;
+    QDHTLookup& operator=(const QDHTLookup&) = delete;
+
+    // Starts from seeds, usually the routing table's closest contacts
+    void lookup(const NodeId& target, std::vector<QDHTContact> seeds, Completion done);
+
+    // Timeout the next request to peer would get
+    [[nodiscard]] std::chrono::milliseconds timeoutFor(const NodeId& peer) const;
+    [[nodiscard]] Stats stats() const;
+
+private:
+    class Core;
+    std::shared_ptr<Core> core_;
+};
+
+} // namespace quids::network
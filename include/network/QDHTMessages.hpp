@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include "network/QDHTConstants.hpp"
+#include "network/WireFormat.hpp"
+
+namespace quids::network {
+
+// QDHT message types, doubling as wire type ids in the QDHT range
+enum class MessageType : uint8_t {
+    PING = 0x20,
+    PONG = 0x21,
+    STORE = 0x22,
+    STORE_ACK = 0x23,
+    FIND_VALUE = 0x24,
+    VALUE_RESPONSE = 0x25,
+    NODES_RESPONSE = 0x26,
+    FIND_NODE = 0x27,
+    // Replication: (key, version) offers, the keys wanted back, and records
+    OFFER = 0x28,
+    WANT = 0x29,
+    RECORDS = 0x2a
+};
+
+// Wire form of the QDHT protocol. Every request carries a request id that
+// its response echoes. Byte and string fields are views into the received
+// payload.
+namespace qdht_wire {
+
+using NodeId = std::array<uint8_t, QDHT_ID_LENGTH / 8>;
+
+template <MessageType T>
+struct Typed {
+    static constexpr uint8_t WIRE_TYPE = static_cast<uint8_t>(T);
+};
+
+struct Contact {
+    NodeId id{};
+    std::string_view address;
+    uint16_t port{0};
+    QUIDS_WIRE_FIELDS(id, address, port)
+};
+
+struct Ping : Typed<MessageType::PING> {
+    uint64_t request{0};
+    NodeId sender{};
+    QUIDS_WIRE_FIELDS(request, sender)
+};
+
+struct Pong : Typed<MessageType::PONG> {
+    uint64_t request{0};
+    NodeId sender{};
+    QUIDS_WIRE_FIELDS(request, sender)
+};
+
+struct FindNode : Typed<MessageType::FIND_NODE> {
+    uint64_t request{0};
+    NodeId target{};
+    QUIDS_WIRE_FIELDS(request, target)
+};
+
+struct Nodes : Typed<MessageType::NODES_RESPONSE> {
+    uint64_t request{0};
+    wire::Seq<Contact> nodes;
+    QUIDS_WIRE_FIELDS(request, nodes)
+};
+
+struct FindValue : Typed<MessageType::FIND_VALUE> {
+    uint64_t request{0};
+    NodeId key{};
+    QUIDS_WIRE_FIELDS(request, key)
+};
+
+struct Value : Typed<MessageType::VALUE_RESPONSE> {
+    uint64_t request{0};
+    uint64_t version{0};
+    uint64_t ttl_ms{0};
+    std::span<const uint8_t> value;
+    QUIDS_WIRE_FIELDS(request, version, ttl_ms, value)
+};
+
+struct Store : Typed<MessageType::STORE> {
+    uint64_t request{0};
+    NodeId key{};
+    uint64_t ttl_ms{0};
+    std::span<const uint8_t> value;
+    QUIDS_WIRE_FIELDS(request, key, ttl_ms, value)
+};
+
+struct StoreAck : Typed<MessageType::STORE_ACK> {
+    uint64_t request{0};
+    NodeId key{};
+    bool stored{false};
+    QUIDS_WIRE_FIELDS(request, key, stored)
+};
+
+struct OfferItem {
+    NodeId key{};
+    uint64_t version{0};
+    QUIDS_WIRE_FIELDS(key, version)
+};
+
+struct Offer : Typed<MessageType::OFFER> {
+    uint64_t request{0};
+    wire::Seq<OfferItem> items;
+    QUIDS_WIRE_FIELDS(request, items)
+};
+
+struct Want : Typed<MessageType::WANT> {
+    uint64_t request{0};
+    wire::Seq<NodeId> keys;
+    QUIDS_WIRE_FIELDS(request, keys)
+};
+
+struct Record {
+    NodeId key{};
+    uint64_t version{0};
+    uint64_t ttl_ms{0};
+    std::span<const uint8_t> value;
+    QUIDS_WIRE_FIELDS(key, version, ttl_ms, value)
+};
+
+struct Records : Typed<MessageType::RECORDS> {
+    uint64_t request{0};
+    wire::Seq<Record> records;
+    QUIDS_WIRE_FIELDS(request, records)
+};
+
+} // namespace qdht_wire
+
+} // namespace quids::network
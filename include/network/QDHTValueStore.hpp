@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "memory/MemoryBudget.hpp"
+#include "network/QDHTLookup.hpp"
+
+namespace quids::storage {
+class PersistentStorage;
+}
+
+namespace quids::network {
+
+// Local value store behind QDHT STORE / FIND_VALUE.
+//
+// Values live in memory up to memory_limit bytes, and within the node's
+// memory::Subsystem::Dht budget, least recently used first out. With a PersistentStorage attached, evicted values spill to
+// its state column under "dht/" and are read back on demand; without one
+// they are dropped. Either way at most max_keys keys are tracked, and
+// every value expires after its TTL.
+//
+// Expiry and republishing share one timing wheel: each key sits in the
+// slot of its next deadline, and tick() processes one slot, so the cost
+// per tick is the keys due in it, not the size of the store. Call tick()
+// every tickInterval().
+//
+// Republishing is a delta sync. For each due key the k closest peers are
+// asked for; a peer is offered (key, version) only if it has not already
+// been offered or sent this version. Offers are batched per peer. The
+// receiving store answers with the keys it wants (handleOffer), and the
+// sender ships just those (recordsFor). Every full_sync_rounds republishes
+// a key is offered to all of its peers again, in case one dropped it.
+class QDHTValueStore {
+public:
+    using Key = std::array<uint8_t, QDHT_ID_LENGTH / 8>;
+    using Clock = std::chrono::steady_clock;
+
+    struct Record {
+        Key key{};
+        std::vector<uint8_t> value;
+        uint64_t version{0};
+        // Remaining lifetime
+        std::chrono::milliseconds ttl{0};
+    };
+
+    struct OfferItem {
+        Key key{};
+        uint64_t version{0};
+    };
+
+    using ClosestPeers = std::function<std::vector<QDHTContact>(const Key& key)>;
+    using SendOffer = std::function<void(const QDHTContact& peer, std::vector<OfferItem>&& items)>;
+
+    struct Config {
+        size_t memory_limit{64u << 20};
+        size_t max_keys{1u << 20};
+        size_t max_value_size{1u << 20};
+        std::chrono::milliseconds default_ttl{std::chrono::hours(24)};
+        std::chrono::milliseconds max_ttl{std::chrono::hours(24)};
+        std::chrono::milliseconds republish_interval{std::chrono::hours(1)};
+        // tickInterval() is republish_interval / wheel_slots
+        size_t wheel_slots{512};
+        size_t full_sync_rounds{24};
+        size_t max_offer_items{1024};
+    };
+
+    struct Stats {
+        size_t keys{0};
+        size_t keys_in_memory{0};
+        size_t memory_bytes{0};
+        uint64_t spilled{0};
+        uint64_t reloaded{0};
+        uint64_t evicted{0};
+        uint64_t expired{0};
+        uint64_t offers_sent{0};
+        uint64_t offer_items{0};
+        uint64_t offer_items_skipped{0};
+        uint64_t rejected{0};
+    };
+
+    QDHTValueStore(Config config, ClosestPeers closest, SendOffer send_offer,
+                   std::shared_ptr<storage::PersistentStorage> spill = nullptr);
+    ~QDHTValueStore();
+
+    QDHTValueStore(const QDHTValueStore&) = delete;
+    QDHTValueStore& operator=(const QDHTValueStore&) = delete;
+
+    // A value published by this node; ttl 0 means default_ttl
+    bool put(const Key& key, std::span<const uint8_t> value,
+             std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+    // A value replicated from `from`, which is then known to hold it
+    bool storeReplica(const Record& record, const QDHTContact& from);
+
+    std::optional<std::vector<uint8_t>> get(const Key& key);
+    bool erase(const Key& key);
+
+    // Offered keys missing here or held at another version
+    [[nodiscard]] std::vector<Key> handleOffer(const std::vector<OfferItem>& items) const;
+    // Records for keys a peer asked for; unknown or expired keys are skipped
+    std::vector<Record> recordsFor(const std::vector<Key>& keys);
+
+    void tick();
+    [[nodiscard]] std::chrono::milliseconds tickInterval() const noexcept { return tick_interval_; }
+    [[nodiscard]] Stats stats() const;
+
+    static uint64_t versionOf(std::span<const uint8_t> value);
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const noexcept;
+    };
+
+    struct Holder {
+        uint64_t peer;
+        uint64_t version;
+    };
+
+    struct Entry {
+        // Null while spilled
+        std::shared_ptr<const std::vector<uint8_t>> value;
+        size_t size{0};
+        uint64_t version{0};
+        Clock::time_point expires;
+        Clock::time_point republish;
+        // Tick this entry is filed under in the wheel
+        uint64_t due_tick{0};
+        size_t rounds{0};
+        // A copy of this version is in the spill store
+        bool on_disk{false};
+        // Peers offered or sent this version, at most one per replica
+        std::vector<Holder> holders;
+        // Position in hot_ or cold_
+        std::list<Key>::iterator lru;
+    };
+
+    using Batch = std::vector<std::pair<Key, std::optional<std::vector<uint8_t>>>>;
+
+    // All of these expect mutex_ held; disk writes are queued into batch
+    void insert(const Key& key, std::shared_ptr<const std::vector<uint8_t>> value, uint64_t version,
+                Clock::time_point expires, Batch& batch);
+    void remove(std::unordered_map<Key, Entry, KeyHash>::iterator it, Batch& batch);
+    void touch(Entry& entry);
+    void schedule(const Key& key, Entry& entry, Clock::time_point now);
+    void enforceLimits(Batch& batch);
+
+    void writeSpill(Batch& batch);
+    std::optional<Record> readSpill(const Key& key);
+    void loadSpilled();
+
+    const Config config_;
+    const std::chrono::milliseconds tick_interval_;
+    const ClosestPeers closest_;
+    const SendOffer send_offer_;
+    const std::shared_ptr<storage::PersistentStorage> spill_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+    // In-memory keys, most recent first, and spilled keys, newest first
+    std::list<Key> hot_;
+    std::list<Key> cold_;
+    size_t memory_bytes_{0};
+    memory::MemoryCharge charge_{memory::Subsystem::Dht, 0};  // follows memory_bytes_
+
+    std::vector<std::vector<Key>> wheel_;
+    uint64_t tick_{0};
+
+    Stats stats_;
+};
+
+} // namespace quids::network
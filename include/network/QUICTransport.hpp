@@ -7,9 +7,14 @@
 #include <unordered_map>
 #include <mutex>
 #include <atomic>
-
-
-
+#include <thread>
+#include <deque>
+#include "network/BufferRing.hpp"
+#include "network/NetworkTypes.hpp"
+#include "network/SessionTicketCache.hpp"
+#include "utils/BoundedQueue.hpp"
+#include "utils/ShardMailbox.hpp"
+#include "utils/TimerWheel.hpp"
 
 // Forward declarations for QUIC library types
 namespace quiche {
@@ -21,9 +26,34 @@ namespace quiche {
 namespace quids {
 namespace network {
 
+// Connections are sharded by a hash of the peer ID across `shards` event
+// loops. A shard's loop is the only thread that touches its connections,
+// stream metrics and timers, so none of them are locked. Sends reach a
+// shard through a utils::ShardMailbox: an MPMC inbox from application
+// threads, a dedicated SPSC queue from each other shard's loop. Connection
+// callbacks run on the owning shard's loop.
+//
+// With a send bitrate set, every peer gets a token bucket holding its
+// share of it, split by the weights from setPeerWeights() (peers without
+// one weigh 1). Sends past a peer's budget wait in that peer's backlog on
+// its shard, so one slow or spammy peer cannot starve the others.
+//
+// Each shard keeps its timers on a TimerWheel advanced by its loop. A
+// connection's idle timer is armed once and, when it fires, either closes
+// the connection or re-arms for the rest of the timeout, so the loop
+// never scans its connections to find idle ones.
+//
+// Reconnects resume: the session a connection ends with is kept per peer
+// in a SessionTicketCache, saved across restarts when
+// NetworkConfig::sessionCacheDir is set, and offered on the next connect
+// so the first messages go out as 0-RTT data. Connections are keyed by
+// peer, not address, so a peer whose NAT rebinds keeps its connection
+// (quiche validates the new path), and migrateLocalAddress() moves ours
+// when our own address changes.
 class QUICTransport {
 public:
-    explicit QUICTransport(const NetworkConfig& config);
+    // shards == 0 means one per core
+    explicit QUICTransport(const NetworkConfig& config, size_t shards = 0);
     ~QUICTransport();
 
     // Connection management
@@ -31,10 +61,13 @@ public:
     void stop();
     size_t getActiveConnections() const;
 
+    // The payload is a pooled buffer: serialize into one from
+    // acquireBuffer() and it reaches the stream without another copy;
+    // received payloads arrive the same way
     struct Message {
         NodeID sender;
         NodeID recipient;
-        std::vector<uint8_t> data;
+        BufferHandle payload;
     };
 
     struct MessageHandler {
@@ -42,14 +75,26 @@ public:
         std::function<void(const NodeID&)> onDisconnection;
     };
 
+    // Kept per shard and only touched by that shard's loop
     struct MessageHandlerRegistry {
         std::unordered_map<NodeID, MessageHandler> handlers;
-        std::mutex mutex;
     };
 
     // Message handling
+    // Empty handle when the pool is exhausted or the peer's budget is spent
+    BufferHandle acquireBuffer(const NodeID& peer, size_t bytes);
+    // Queues msg on the shard owning msg.recipient; throws if that queue is full
     void sendMessage(Message&& msg);
+    // Collects what every shard has read since the last call
     std::vector<Message> receiveMessages();
+    [[nodiscard]] size_t shardCount() const noexcept { return shards_.size(); }
+
+    struct BufferMetrics {
+        BufferRing::Stats pool;
+        // Bytes pinned by each peer's outstanding buffers
+        std::vector<std::pair<NodeID, size_t>> peer_bytes;
+    };
+    BufferMetrics getBufferMetrics() const;
 
     // Connection events
     using ConnectionCallback = std::function<void(const NodeID&)>;
@@ -62,7 +107,16 @@ public:
 
     // Configuration
     void updateConfig(const NetworkConfig& config);
+    // Total send budget in bits per second shared by all peers; 0 lifts it
     void setMaxStreamBitrate(size_t bitrate);
+    // Relative shares of that budget, e.g. PeerScoreBook::bandwidthWeights()
+    void setPeerWeights(const std::vector<std::pair<NodeID, double>>& weights);
+
+    // After our address changes (NAT rebinding, a new interface), moves
+    // every connection onto it by QUIC connection migration rather than
+    // new handshakes; each loop picks it up on its next timer pass
+    void migrateLocalAddress(const std::string& address, uint16_t port);
+    SessionTicketCache& sessionTickets() noexcept { return sessions_; }
 
 private:
     // QUIC configuration
@@ -82,12 +136,61 @@ private:
         uint64_t lastActivity;
         size_t bytesReceived;
         size_t bytesSent;
+        utils::TimerWheel::TimerId idleTimer;
+        bool offeredSession{false};
+    };
+
+    // Performance optimization
+    struct alignas(64) StreamMetrics {
+        std::atomic<uint64_t> bytesProcessed{0};
+        std::atomic<uint64_t> packetsProcessed{0};
+        std::atomic<double> averageLatency{0.0};
+    };
+
+    // Per-peer send budget, owned by the shard loop
+    struct Throttle {
+        double tokens{0.0};
+        double rate{0.0}; // bytes per microsecond
+        uint64_t refilled{0};
+        uint64_t version{0};
+        std::deque<Message> backlog;
+        size_t backlogBytes{0};
+    };
+
+    using ShardQueue = utils::BoundedQueue<Message>;
+
+    struct Shard {
+        explicit Shard(size_t index);
+
+        const size_t index;
+        std::thread loop;
+
+        // Owned by the loop thread
+        std::unordered_map<NodeID, Connection> connections;
+        std::unordered_map<NodeID, StreamMetrics> streamMetrics;
+        MessageHandlerRegistry handlers;
+        std::unordered_map<NodeID, Throttle> throttles;
+        size_t throttledPeers{0};
+        utils::TimerWheel timers{std::chrono::milliseconds(TIMER_TICK)};
+        uint64_t pathVersion{0};
+
+        // Read by the loop, waiting for receiveMessages()
+        ShardQueue received;
+        std::atomic<size_t> activeConnections{0};
+
+        // Application threads acquire buffers too, so quotas keep a lock,
+        // but one per shard
+        std::unordered_map<NodeID, std::shared_ptr<BufferQuota>> quotas;
+        mutable std::mutex quotaMutex;
     };
 
     // Core components
     std::unique_ptr<quiche::Config> quicConfig_;
-    std::unordered_map<NodeID, Connection> connections_;
     NetworkConfig config_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    // Sends waiting for the loop of the shard that owns the recipient
+    utils::ShardMailbox<Message> outbound_;
+    std::atomic<bool> running_{false};
 
     // Event handlers
     ConnectionCallback onConnection_;
@@ -95,39 +198,76 @@ private:
 
     // Internal helper functions
     void initializeQuicConfig();
+    size_t shardFor(const NodeID& peer) const;
+    void runShard(Shard& shard);
+    // Returns how many messages it moved, so an idle loop can back off
+    size_t drainInbound(Shard& shard);
+    size_t pollStreams(Shard& shard);
+    void transmit(Shard& shard, Message&& msg);
+    void transmitNow(Shard& shard, Message&& msg);
+    // Tops up the bucket, picking up a new rate if one was published
+    void refill(Throttle& throttle, const NodeID& peer, uint64_t now);
+    size_t releaseThrottled(Shard& shard);
+    double rateFor(const NodeID& peer) const;
     void handleIncomingPacket(const uint8_t* data, size_t len);
-    void processTimeouts();
-    void cleanupInactiveConnections();
+    void processTimeouts(Shard& shard);
+    void armIdleTimer(Shard& shard, const NodeID& peer, uint64_t delay);
+    // Closes the connection if nothing moved for TIMEOUT_INTERVAL
+    void checkIdle(Shard& shard, const NodeID& peer);
+    void closeConnection(Shard& shard, const NodeID& peer);
+    // Keeps what the connection can resume from, or drops a session the
+    // server would not take
+    void saveSession(const NodeID& peer, Connection& conn);
+    void migratePaths(Shard& shard);
     
     // Stream management
-    quiche::Stream* getOrCreateStream(const NodeID& peer);
+    quiche::Stream* getOrCreateStream(Shard& shard, const NodeID& peer);
     void handleStreamData(quiche::Stream* stream, const uint8_t* data, size_t len);
     
     // Zero-copy buffer management
-    struct BufferPool {
-        static constexpr size_t BUFFER_SIZE = 65536;
-        static constexpr size_t NUM_BUFFERS = 1024;
-        
-        std::vector<std::array<uint8_t, BUFFER_SIZE>> buffers;
-        std::vector<size_t> freeBuffers;
-        
-        BufferPool();
-        uint8_t* acquireBuffer();
-        void releaseBuffer(uint8_t* buffer);
-    } bufferPool_;
+    std::shared_ptr<BufferQuota> peerQuota(const NodeID& peer);
 
-    // Performance optimization
-    struct alignas(64) StreamMetrics {
-        std::atomic<uint64_t> bytesProcessed{0};
-        std::atomic<uint64_t> packetsProcessed{0};
-        std::atomic<double> averageLatency{0.0};
-    };
-    std::unordered_map<NodeID, StreamMetrics> streamMetrics_;
+    BufferRing bufferRing_;
+
+    // Send budgets; loops pick up changes when rateVersion_ moves
+    mutable std::mutex rateMutex_;
+    size_t maxBitrate_{0};
+    std::unordered_map<NodeID, double> peerWeights_;
+    double totalWeight_{0.0};
+    std::atomic<uint64_t> rateVersion_{0};
+    std::atomic<bool> throttled_{false};
+
+    SessionTicketCache sessions_;
+    // Loops pick up a new local address when pathVersion_ moves
+    mutable std::mutex pathMutex_;
+    std::string localAddress_;
+    uint16_t localPort_{0};
+    std::atomic<uint64_t> pathVersion_{0};
 
     // Constants
     static constexpr size_t MAX_PACKET_SIZE = 1350;
     static constexpr size_t MAX_DATAGRAM_SIZE = 1200;
     static constexpr uint64_t TIMEOUT_INTERVAL = 1000; // milliseconds
+    static constexpr uint64_t TIMER_TICK = 10; // milliseconds
+    // Spare connection IDs let either end move to a new path
+    static constexpr uint64_t ACTIVE_CONNECTION_IDS = 4;
+    static constexpr const char* SESSION_CACHE = "quic-sessions";
+    // Per-shard inbox and outbox depth
+    static constexpr size_t SHARD_QUEUE_SIZE = 4096;
+    static constexpr size_t CROSS_SHARD_QUEUE_SIZE = 1024;
+    // Messages a loop moves per queue before checking the others
+    static constexpr size_t LOOP_BATCH = 64;
+
+    // Pool size classes: single datagrams, a GSO burst, one full stream read
+    static constexpr size_t BURST_DATAGRAMS = 16;
+    static constexpr size_t MAX_STREAM_READ = 65536;
+    static constexpr size_t DATAGRAM_BUFFERS = 4096;
+    static constexpr size_t BURST_BUFFERS = 256;
+    static constexpr size_t STREAM_BUFFERS = 64;
+    // Ceiling on pool memory one peer can hold
+    static constexpr size_t PEER_BUFFER_LIMIT = 4 * 1024 * 1024;
+    // Bucket depth as time at the peer's rate; bursts beyond it queue
+    static constexpr uint64_t BURST_MICROS = 50000;
 };
 
 } // namespace network
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace quids {
+namespace network {
+
+// AEAD record protection for peer traffic, keyed by the secret each
+// peer's hybrid KEM handshake (or a crypto::SessionCache resumption)
+// agreed on.
+//
+// A record is sealed in place: the plaintext is encrypted where it lies
+// and a trailer is appended,
+//
+//   ciphertext | cipher (1) | epoch (4) | sequence (8) | tag (16)
+//
+// with the trailer fields as associated data, so the buffer never moves
+// and opening just truncates it. Each direction has its own traffic
+// secret; the nonce is the sequence number XORed into a per-epoch IV, as
+// in TLS 1.3. Every rekey_records records or rekey_interval the sender
+// ratchets to the next epoch's secret and the receiver follows when the
+// first record of it verifies, so old keys do not outlive their epoch.
+// The receiver ratchets forward up to receive_epoch_window epochs to
+// verify a record, so an epoch whose records were all lost does not
+// strand it. Replays are refused with a sliding window per epoch.
+//
+// Senders use AES-256-GCM where the CPU has AES instructions and
+// ChaCha20-Poly1305 elsewhere; receivers open either. A peer's cipher
+// contexts are keyed once per epoch and reused, and seal()/open() take a
+// whole batch for one peer under one lock, so the per-record cost is the
+// cipher itself (OpenSSL's AES-NI/VAES or SIMD ChaCha paths).
+class RecordLayer {
+public:
+    using PeerID = std::string;
+    using Clock = std::chrono::steady_clock;
+
+    enum class Cipher : uint8_t {
+        Aes256Gcm = 1,
+        ChaCha20Poly1305 = 2
+    };
+
+    struct Config {
+        uint64_t rekey_records{uint64_t{1} << 24};
+        std::chrono::seconds rekey_interval{600};
+        // How far past its current epoch the receiver will ratchet to
+        // open a record; at least 1
+        uint32_t receive_epoch_window{16};
+        // What seal() uses; preferredCipher() when unset
+        std::optional<Cipher> cipher;
+    };
+
+    struct Stats {
+        uint64_t sealed{0};
+        uint64_t opened{0};
+        uint64_t rejected{0};  // failed authentication, replays, unknown peers
+        uint64_t rekeys{0};
+    };
+
+    static constexpr size_t TAG_SIZE = 16;
+    static constexpr size_t TRAILER_SIZE = 1 + 4 + 8 + TAG_SIZE;
+
+    RecordLayer();
+    explicit RecordLayer(Config config);
+    ~RecordLayer();
+
+    RecordLayer(const RecordLayer&) = delete;
+    RecordLayer& operator=(const RecordLayer&) = delete;
+
+    // Both ends install the same secret; exactly one of them is the
+    // initiator. Replaces any earlier keys for peer.
+    void install(const PeerID& peer, std::span<const uint8_t> secret, bool initiator);
+    void remove(const PeerID& peer);
+    [[nodiscard]] bool has(const PeerID& peer) const;
+
+    // Seals every record for peer; false, with nothing sealed, when peer
+    // has no keys
+    bool seal(const PeerID& peer, std::span<std::vector<uint8_t>> records);
+    bool seal(const PeerID& peer, std::vector<uint8_t>& record) { return seal(peer, {&record, 1}); }
+
+    // Opens records from peer in place; a record that fails is cleared.
+    // Returns how many opened.
+    size_t open(const PeerID& peer, std::span<std::vector<uint8_t>> records);
+    bool open(const PeerID& peer, std::vector<uint8_t>& record) { return open(peer, {&record, 1}) == 1; }
+
+    [[nodiscard]] Stats stats() const;
+    // What seal() uses on this host
+    [[nodiscard]] static Cipher preferredCipher();
+
+private:
+    class Peer;
+
+    std::shared_ptr<Peer> find(const PeerID& peer) const;
+
+    const Config config_;
+    mutable std::mutex mutex_;
+    std::unordered_map<PeerID, std::shared_ptr<Peer>> peers_;
+    std::atomic<uint64_t> sealed_{0};
+    std::atomic<uint64_t> opened_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> rekeys_{0};
+};
+
+} // namespace network
+} // namespace quids
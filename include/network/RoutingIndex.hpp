@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace quids {
+namespace network {
+
+// Flat XOR-metric index for Kademlia-style routing.
+//
+// Keys are 256-bit node ids kept as four 64-bit words, most significant
+// first, in one contiguous array, so a distance is four XORs (one AVX2 op)
+// and comparing distances is comparing words. Closest-peer queries do a
+// partial selection over the array and return positions, leaving it to
+// the caller to copy out only the entries it wants.
+//
+// Positions are dense: remove() moves the last key into the hole, and the
+// caller mirrors that move in whatever arrays it keeps alongside.
+class RoutingIndex {
+public:
+    static constexpr size_t KEY_BYTES = 32;
+    static constexpr size_t KEY_BITS = KEY_BYTES * 8;
+
+    using NodeKey = std::array<uint8_t, KEY_BYTES>;
+    using Distance = std::array<uint64_t, KEY_BYTES / 8>;
+
+    // Raw id bytes, zero-padded or truncated to 32 bytes
+    static NodeKey keyFromBytes(std::span<const uint8_t> bytes) noexcept;
+    static NodeKey keyFromString(std::string_view id) noexcept;
+
+    static Distance distance(const NodeKey& a, const NodeKey& b) noexcept;
+    // Leading bits a and b share; KEY_BITS when they are equal
+    static size_t commonPrefixBits(const NodeKey& a, const NodeKey& b) noexcept;
+
+    // Returns the key's position
+    size_t add(const NodeKey& key);
+    // Removes the key at position; returns the old position of the key that
+    // now sits there, or position itself if it was the last one
+    size_t remove(size_t position) noexcept;
+    void clear() noexcept { keys_.clear(); }
+
+    // Position of key, or size() if absent
+    [[nodiscard]] size_t find(const NodeKey& key) const noexcept;
+    [[nodiscard]] size_t size() const noexcept { return keys_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return keys_.empty(); }
+
+    // Positions of the count keys nearest target, nearest first
+    [[nodiscard]] std::vector<uint32_t> closest(const NodeKey& target, size_t count) const;
+
+private:
+    using Words = std::array<uint64_t, KEY_BYTES / 8>;
+
+    static Words toWords(const NodeKey& key) noexcept;
+
+    std::vector<Words> keys_;
+};
+
+} // namespace network
+} // namespace quids
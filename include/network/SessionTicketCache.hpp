@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace quids {
+namespace network {
+
+// QUIC resumption state, one session per peer, so a reconnect can send
+// 0-RTT data instead of waiting out a full handshake.
+//
+// A session is whatever quiche hands back for a connection, ticket and
+// transport parameters included; the cache does not look inside. Expiry
+// runs on the wall clock so it means the same thing after a restart, and
+// encode()/decode() carry the cache across one (see WarmStartStore).
+// Past capacity the session closest to expiring goes first.
+class SessionTicketCache {
+public:
+    using PeerID = std::string;
+    using Clock = std::chrono::system_clock;
+
+    // TLS 1.3 caps ticket lifetime at seven days; servers usually issue
+    // far shorter ones
+    static constexpr std::chrono::seconds DEFAULT_LIFETIME{24 * 60 * 60};
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    explicit SessionTicketCache(size_t capacity = DEFAULT_CAPACITY,
+                                std::chrono::seconds lifetime = DEFAULT_LIFETIME);
+
+    // Replaces any earlier session for peer
+    void store(const PeerID& peer, std::span<const uint8_t> session, Clock::time_point now = Clock::now());
+    [[nodiscard]] std::optional<std::vector<uint8_t>> find(const PeerID& peer,
+                                                           Clock::time_point now = Clock::now()) const;
+    // E.g. when quiche refuses the session
+    void erase(const PeerID& peer);
+    [[nodiscard]] size_t size() const;
+
+    // Unexpired sessions only
+    [[nodiscard]] std::vector<uint8_t> encode(Clock::time_point now = Clock::now()) const;
+    // Merges sessions from encode(), skipping expired ones; returns how
+    // many it kept, or nullopt if data is malformed (nothing is merged)
+    std::optional<size_t> decode(std::span<const uint8_t> data, Clock::time_point now = Clock::now());
+
+private:
+    struct Entry {
+        std::vector<uint8_t> session;
+        Clock::time_point expires;
+    };
+
+    void insert(const PeerID& peer, Entry entry);
+
+    const size_t capacity_;
+    const std::chrono::seconds lifetime_;
+    mutable std::mutex mutex_;
+    std::unordered_map<PeerID, Entry> sessions_;
+};
+
+} // namespace network
+} // namespace quids
@@ -0,0 +1,407 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Shared framing for everything the node sends between peers.
+//
+// A frame is a fixed 12-byte header followed by the payload:
+//   u8 version, u8 type, u16 flags, u32 payload length, u32 CRC32C of payload
+// all little-endian. decodeFrame() validates the header and checksum and
+// hands back a view of the payload inside the receive buffer; nothing is
+// copied or allocated.
+//
+// Payloads of typed messages are produced from a field list. A message
+// struct names its wire type and its fields:
+//
+//   struct Ping {
+//       static constexpr uint8_t WIRE_TYPE = ...;
+//       uint64_t nonce;
+//       std::span<const uint8_t> data;
+//       QUIDS_WIRE_FIELDS(nonce, data)
+//   };
+//
+// and wire::encode / wire::decode are generated from that list. Variable-
+// length fields decode as views into the payload (std::span, string_view,
+// wire::Seq), so a decoded message is only valid while the buffer is.
+// Fields are written in order with no padding; decoders ignore trailing
+// bytes, so a later version may append fields to a message.
+#define QUIDS_WIRE_FIELDS(...)                                          \
+    auto wireFields() { return std::tie(__VA_ARGS__); }                 \
+    auto wireFields() const { return std::tie(__VA_ARGS__); }
+
+namespace quids::network::wire {
+
+constexpr uint8_t VERSION = 1;
+// Oldest version this build still decodes
+constexpr uint8_t MIN_VERSION = 1;
+constexpr size_t HEADER_SIZE = 12;
+constexpr uint32_t MAX_PAYLOAD = 16u << 20;
+
+// Type ids are global so one dispatcher can route any frame:
+// 0x01-0x1f network layer, 0x20-0x3f QDHT, 0x40-0x5f consensus
+namespace types {
+constexpr uint8_t GOSSIP = 0x01;
+// Point-to-point request and its reply; payload is a u64 request id
+// followed by the body
+constexpr uint8_t REQUEST = 0x02;
+constexpr uint8_t RESPONSE = 0x03;
+// Compact block relay: the block itself, and a request for the
+// transactions a receiver lacks, answered with a RESPONSE
+constexpr uint8_t COMPACT_BLOCK = 0x04;
+constexpr uint8_t BLOCK_TXN_REQUEST = 0x05;
+// Erasure-coded blocks: a chunk handed to a peer to keep, and a request
+// for one, answered with a RESPONSE
+constexpr uint8_t CHUNK_PUSH = 0x06;
+constexpr uint8_t CHUNK_REQUEST = 0x07;
+constexpr uint8_t CONSENSUS_FRAME = 0x40;
+}
+
+enum Flags : uint16_t {
+    COMPRESSED = 1u << 0,
+    ENCRYPTED = 1u << 1,
+    // Payload is itself a sequence of frames (after decompression)
+    BATCH = 1u << 2
+};
+
+struct Header {
+    uint8_t version{VERSION};
+    uint8_t type{0};
+    uint16_t flags{0};
+    uint32_t length{0};
+    uint32_t checksum{0};
+};
+
+struct Frame {
+    Header header;
+    std::span<const uint8_t> payload;
+
+    [[nodiscard]] uint8_t type() const noexcept { return header.type; }
+    [[nodiscard]] size_t size() const noexcept { return HEADER_SIZE + payload.size(); }
+};
+
+enum class Status {
+    Ok,
+    // Fewer bytes than the header or its declared length; read more
+    Incomplete,
+    BadVersion,
+    TooLarge,
+    BadChecksum
+};
+
+// CRC32C (Castagnoli); the SSE4.2 instruction when the CPU has it
+uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc = 0) noexcept;
+
+// Parses the frame at the start of bytes; on Ok, frame.size() bytes were used
+Status decodeFrame(std::span<const uint8_t> bytes, Frame& frame) noexcept;
+
+// Writes a header for payload into out[0, HEADER_SIZE)
+void writeHeader(uint8_t* out, uint8_t type, uint16_t flags, std::span<const uint8_t> payload) noexcept;
+
+// Appends a frame around an already encoded payload
+void appendFrame(std::vector<uint8_t>& out, uint8_t type, uint16_t flags, std::span<const uint8_t> payload);
+
+// Bounds-checked cursor over a payload
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> data) noexcept : data_(data) {}
+
+    bool take(size_t n, std::span<const uint8_t>& out) noexcept {
+        if (data_.size() - offset_ < n) {
+            return false;
+        }
+        out = data_.subspan(offset_, n);
+        offset_ += n;
+        return true;
+    }
+
+    [[nodiscard]] size_t offset() const noexcept { return offset_; }
+
+private:
+    std::span<const uint8_t> data_;
+    size_t offset_{0};
+};
+
+template <class T, class = void>
+struct Field;
+
+template <class T, bool = std::is_enum_v<T>>
+struct RawOf {
+    using type = std::make_unsigned_t<T>;
+};
+
+template <class T>
+struct RawOf<T, true> {
+    using type = std::make_unsigned_t<std::underlying_type_t<T>>;
+};
+
+template <>
+struct RawOf<bool, false> {
+    using type = uint8_t;
+};
+
+template <class T>
+concept Message = requires(T& m) { m.wireFields(); };
+
+template <class M>
+size_t payloadSize(const M& message);
+template <Message M>
+uint8_t* encodeFields(const M& message, uint8_t* out) noexcept;
+template <Message M>
+bool decodeFields(Reader& reader, M& message) noexcept;
+
+// Repeated field: u32 count, then the elements back to back. Encoding
+// reads from a span of elements; a decoded Seq is a view that decodes
+// each element as it is iterated. Elements were validated when the
+// enclosing message was decoded.
+template <class T>
+class Seq {
+public:
+    Seq() = default;
+    Seq(std::span<const T> items) noexcept : items_(items), count_(items.size()) {}
+
+    [[nodiscard]] size_t size() const noexcept { return count_; }
+    [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+
+    class iterator {
+    public:
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(std::span<const uint8_t> bytes, size_t remaining) noexcept
+            : reader_(bytes), remaining_(remaining) {
+            load();
+        }
+
+        const T& operator*() const noexcept { return current_; }
+        const T* operator->() const noexcept { return &current_; }
+        iterator& operator++() noexcept {
+            --remaining_;
+            load();
+            return *this;
+        }
+        bool operator==(const iterator& other) const noexcept { return remaining_ == other.remaining_; }
+
+    private:
+        void load() noexcept {
+            if (remaining_ != 0) {
+                Field<T>::read(reader_, current_);
+            }
+        }
+
+        Reader reader_{{}};
+        size_t remaining_{0};
+        T current_{};
+    };
+
+    // Iterates a decoded Seq
+    [[nodiscard]] iterator begin() const noexcept { return iterator(bytes_, count_); }
+    [[nodiscard]] iterator end() const noexcept { return iterator(); }
+
+    // The elements a Seq built for encoding refers to
+    [[nodiscard]] std::span<const T> items() const noexcept { return items_; }
+
+private:
+    friend struct Field<Seq<T>>;
+
+    std::span<const T> items_;
+    std::span<const uint8_t> bytes_;
+    size_t count_{0};
+};
+
+template <class T>
+struct Field<T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>> {
+    static constexpr size_t SIZE = sizeof(T);
+
+    static size_t size(const T&) noexcept { return SIZE; }
+
+    static uint8_t* write(uint8_t* out, const T& value) noexcept {
+        using U = typename RawOf<T>::type;
+        U raw = static_cast<U>(value);
+        for (size_t i = 0; i < SIZE; ++i) {
+            out[i] = static_cast<uint8_t>(raw >> (8 * i));
+        }
+        return out + SIZE;
+    }
+
+    static bool read(Reader& reader, T& value) noexcept {
+        using U = typename RawOf<T>::type;
+        std::span<const uint8_t> bytes;
+        if (!reader.take(SIZE, bytes)) {
+            return false;
+        }
+        U raw = 0;
+        for (size_t i = 0; i < SIZE; ++i) {
+            raw |= static_cast<U>(static_cast<U>(bytes[i]) << (8 * i));
+        }
+        value = static_cast<T>(raw);
+        return true;
+    }
+};
+
+template <size_t N>
+struct Field<std::array<uint8_t, N>> {
+    static size_t size(const std::array<uint8_t, N>&) noexcept { return N; }
+
+    static uint8_t* write(uint8_t* out, const std::array<uint8_t, N>& value) noexcept {
+        std::memcpy(out, value.data(), N);
+        return out + N;
+    }
+
+    static bool read(Reader& reader, std::array<uint8_t, N>& value) noexcept {
+        std::span<const uint8_t> bytes;
+        if (!reader.take(N, bytes)) {
+            return false;
+        }
+        std::memcpy(value.data(), bytes.data(), N);
+        return true;
+    }
+};
+
+// u32 length, then the bytes
+template <>
+struct Field<std::span<const uint8_t>> {
+    static size_t size(const std::span<const uint8_t>& value) noexcept { return 4 + value.size(); }
+
+    static uint8_t* write(uint8_t* out, const std::span<const uint8_t>& value) noexcept {
+        out = Field<uint32_t>::write(out, static_cast<uint32_t>(value.size()));
+        if (!value.empty()) {
+            std::memcpy(out, value.data(), value.size());
+        }
+        return out + value.size();
+    }
+
+    static bool read(Reader& reader, std::span<const uint8_t>& value) noexcept {
+        uint32_t length;
+        return Field<uint32_t>::read(reader, length) && reader.take(length, value);
+    }
+};
+
+// u16 length, then the characters
+template <>
+struct Field<std::string_view> {
+    static size_t size(const std::string_view& value) noexcept { return 2 + value.size(); }
+
+    static uint8_t* write(uint8_t* out, const std::string_view& value) noexcept {
+        out = Field<uint16_t>::write(out, static_cast<uint16_t>(value.size()));
+        if (!value.empty()) {
+            std::memcpy(out, value.data(), value.size());
+        }
+        return out + value.size();
+    }
+
+    static bool read(Reader& reader, std::string_view& value) noexcept {
+        uint16_t length;
+        std::span<const uint8_t> bytes;
+        if (!Field<uint16_t>::read(reader, length) || !reader.take(length, bytes)) {
+            return false;
+        }
+        value = std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        return true;
+    }
+};
+
+template <class T>
+struct Field<Seq<T>> {
+    static size_t size(const Seq<T>& value) noexcept {
+        size_t total = 4;
+        for (const auto& item : value.items_) {
+            total += Field<T>::size(item);
+        }
+        return total;
+    }
+
+    static uint8_t* write(uint8_t* out, const Seq<T>& value) noexcept {
+        out = Field<uint32_t>::write(out, static_cast<uint32_t>(value.items_.size()));
+        for (const auto& item : value.items_) {
+            out = Field<T>::write(out, item);
+        }
+        return out;
+    }
+
+    static bool read(Reader& reader, Seq<T>& value) noexcept {
+        uint32_t count;
+        if (!Field<uint32_t>::read(reader, count)) {
+            return false;
+        }
+        // Walk once to bound and validate the elements
+        const size_t start = reader.offset();
+        Reader probe = reader;
+        T scratch{};
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!Field<T>::read(probe, scratch)) {
+                return false;
+            }
+        }
+        std::span<const uint8_t> bytes;
+        reader.take(probe.offset() - start, bytes);
+        value.items_ = {};
+        value.bytes_ = bytes;
+        value.count_ = count;
+        return true;
+    }
+};
+
+// A message nested as a field
+template <Message M>
+struct Field<M> {
+    static size_t size(const M& value) noexcept { return payloadSize(value); }
+    static uint8_t* write(uint8_t* out, const M& value) noexcept { return encodeFields(value, out); }
+    static bool read(Reader& reader, M& value) noexcept { return decodeFields(reader, value); }
+};
+
+template <class M>
+size_t payloadSize(const M& message) {
+    return std::apply([](const auto&... field) {
+        return (size_t{0} + ... + Field<std::decay_t<decltype(field)>>::size(field));
+    }, message.wireFields());
+}
+
+template <Message M>
+uint8_t* encodeFields(const M& message, uint8_t* out) noexcept {
+    std::apply([&out](const auto&... field) {
+        ((out = Field<std::decay_t<decltype(field)>>::write(out, field)), ...);
+    }, message.wireFields());
+    return out;
+}
+
+template <Message M>
+bool decodeFields(Reader& reader, M& message) noexcept {
+    return std::apply([&reader](auto&... field) {
+        return (... && Field<std::decay_t<decltype(field)>>::read(reader, field));
+    }, message.wireFields());
+}
+
+// Appends one frame holding message to out
+template <Message M>
+void encode(const M& message, std::vector<uint8_t>& out, uint16_t flags = 0) {
+    const size_t length = payloadSize(message);
+    const size_t start = out.size();
+    out.resize(start + HEADER_SIZE + length);
+    uint8_t* payload = out.data() + start + HEADER_SIZE;
+    encodeFields(message, payload);
+    writeHeader(out.data() + start, M::WIRE_TYPE, flags, {payload, length});
+}
+
+// Decodes a payload in place; views in message point into payload
+template <Message M>
+bool decode(std::span<const uint8_t> payload, M& message) noexcept {
+    Reader reader(payload);
+    return decodeFields(reader, message);
+}
+
+// Same, checking the frame carries this message type
+template <Message M>
+bool decode(const Frame& frame, M& message) noexcept {
+    return frame.header.type == M::WIRE_TYPE && decode(frame.payload, message);
+}
+
+} // namespace quids::network::wire
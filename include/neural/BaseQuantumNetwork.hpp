@@ -7,6 +7,9 @@
 #include <vector>
 #include <string>
 #include <cstddef>
+#include <memory>
+#include <span>
+#include "neural/ParameterShift.hpp"
 
 namespace quids::neural {
 
@@ -35,12 +38,28 @@ public:
     virtual void loadNetworkState(const string& filePath) = 0;
     virtual void saveNetworkState(const string& filePath) const = 0;
 
+    // Backs calculateQuantumGradients() with the parameter-shift rule on
+    // `circuit`, reading <Z> on `readouts` with getQuantumParameters() as
+    // the angles. Networks handed the same cache share simulations.
+    void setVariationalCircuit(std::shared_ptr<const VariationalCircuit> circuit,
+                               std::vector<size_t> readouts,
+                               std::shared_ptr<ParameterShiftCache> cache = nullptr);
+
 protected:
     BaseQuantumNetwork() = default;
     BaseQuantumNetwork(const BaseQuantumNetwork&) = default;
     BaseQuantumNetwork& operator=(const BaseQuantumNetwork&) = default;
     BaseQuantumNetwork(BaseQuantumNetwork&&) = default;
     BaseQuantumNetwork& operator=(BaseQuantumNetwork&&) = default;
+
+    // Gradient of sum_r weights[r] * <Z_readouts[r]>; weights default to 1.
+    // Empty when no circuit is set.
+    [[nodiscard]] std::vector<double> circuitGradients(std::span<const double> weights = {}) const;
+
+private:
+    std::shared_ptr<const VariationalCircuit> circuit_;
+    std::vector<size_t> readouts_;
+    std::shared_ptr<ParameterShiftCache> shiftCache_;
 };
 
 } // namespace quids::neural
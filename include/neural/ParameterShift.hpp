@@ -0,0 +1,77 @@
+#ifndef QUIDS_NEURAL_PARAMETER_SHIFT_HPP
+#define QUIDS_NEURAL_PARAMETER_SHIFT_HPP
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace quids::neural {
+
+// Parameterized ansatz: fixed gates plus rotations whose angles come from a
+// parameter vector. A parameter may drive several rotations.
+struct VariationalCircuit {
+    enum class Gate : uint8_t { Hadamard, CNOT, RY, RZ };
+
+    struct Op {
+        Gate gate;
+        size_t qubit;
+        size_t target{0};     // CNOT only
+        size_t parameter{0};  // RY and RZ only
+    };
+
+    size_t numQubits{1};
+    std::vector<Op> ops;
+
+    [[nodiscard]] size_t numParameters() const;
+    [[nodiscard]] uint64_t fingerprint() const;
+};
+
+// <Z> on every qubit and its gradient with respect to every parameter
+struct ShiftResult {
+    Eigen::VectorXd expectations;  // one per qubit
+    Eigen::MatrixXd jacobian;      // qubits x parameters
+};
+
+// Parameter-shift rule, with the unshifted circuit and both shifts of every
+// rotation simulated together as one StateBatch: each gate is one sweep
+// over all 2R + 1 states, and every readout comes from the same final
+// amplitudes. Large batches spread each sweep over the shared pool.
+// Throws std::invalid_argument if angles do not cover the circuit.
+ShiftResult parameterShift(const VariationalCircuit& circuit, std::span<const double> angles);
+
+// Shares parameterShift() results between networks. Everything is
+// computed for every qubit, so networks that read different qubits of one
+// ansatz at the same angles, such as a policy and a value head on a shared
+// trunk, pay for one simulation between them.
+class ParameterShiftCache {
+public:
+    explicit ParameterShiftCache(size_t capacity = 16);
+
+    std::shared_ptr<const ShiftResult> evaluate(const VariationalCircuit& circuit,
+                                                std::span<const double> angles);
+
+    [[nodiscard]] size_t hits() const;
+    [[nodiscard]] size_t misses() const;
+
+private:
+    struct Entry {
+        uint64_t fingerprint;
+        std::vector<double> angles;
+        std::shared_ptr<const ShiftResult> result;
+    };
+
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;  // most recent first
+    size_t hits_{0};
+    size_t misses_{0};
+};
+
+} // namespace quids::neural
+
+#endif // QUIDS_NEURAL_PARAMETER_SHIFT_HPP
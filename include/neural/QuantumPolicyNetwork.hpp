@@ -2,6 +2,7 @@
 #define QUIDS_NEURAL_QUANTUM_POLICY_NETWORK_HPP
 
 #include "BaseQuantumNetwork.hpp"
+#include <Eigen/Dense>
 #include <vector>
 #include <memory>
 
@@ -43,6 +44,12 @@ public:
     [[nodiscard]] std::vector<double> getCurrentState() const;
     [[nodiscard]] std::vector<double> getActionProbabilities() const;
 
+    // Batched policy: one state per row in, one row of action
+    // probabilities per state out, through a single GEMM
+    [[nodiscard]] Eigen::MatrixXd forwardBatch(const Eigen::MatrixXd& states) const;
+    // Gradient ascent on the logits: parameters += lr * states^T * logitGradients / rows
+    void updateBatch(const Eigen::MatrixXd& states, const Eigen::MatrixXd& logitGradients, double learningRate);
+
     void updatePolicy(const std::vector<double>& rewards, double learningRate);
     void updatePolicy(const std::vector<double>& rewards, double learningRate, double discountFactor);
     void resetNetworkState();
@@ -3,6 +3,7 @@
 
 #include "neural/BaseQuantumNetwork.hpp"
 #include "quantum/QuantumState.hpp"
+#include <Eigen/Dense>
 #include <memory>
 #include <string>
 #include <vector>
@@ -12,6 +13,7 @@ namespace quids::neural {
 class QuantumValueNetwork : public BaseQuantumNetwork {
 public:
     QuantumValueNetwork();
+    QuantumValueNetwork(::std::size_t stateSize, ::std::size_t numQubits);
     ~QuantumValueNetwork() override;
 
     // Implement pure virtual methods from BaseQuantumNetwork
@@ -31,6 +33,13 @@ public:
     void updateValue(const quantum::QuantumState& state, double target);
     [[nodiscard]] double getValueLoss() const;
 
+    // Batched: one state per row, one value per state
+    [[nodiscard]] Eigen::VectorXd getValues(const Eigen::MatrixXd& states) const;
+    // Moves each value toward its target, weighted per row (empty weights
+    // for uniform); returns the weighted TD errors target - value
+    Eigen::VectorXd updateValues(const Eigen::MatrixXd& states, const Eigen::VectorXd& targets,
+                                 const Eigen::VectorXd& weights, double learningRate);
+
 private:
     class Impl;
     ::std::unique_ptr<Impl> impl_;
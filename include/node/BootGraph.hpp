@@ -0,0 +1,50 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace quids {
+
+// Boot stages and what each one needs first.
+//
+// run() starts every stage as soon as the stages it depends on have
+// succeeded, each on its own thread since stages block on disk and on the
+// network. Once a stage fails or throws, nothing new starts; stages
+// already running are left to finish.
+class BootGraph {
+public:
+    using Stage = std::function<bool()>;
+
+    struct Timing {
+        std::string name;
+        std::chrono::milliseconds elapsed{0};
+        bool ran{false};
+        bool ok{false};
+    };
+
+    struct Report {
+        bool ok{true};
+        std::string failed;  // the first stage that failed
+        std::chrono::milliseconds total{0};
+        std::vector<Timing> stages;  // in the order they were added
+    };
+
+    // Dependencies must already be added, which keeps the graph acyclic.
+    // Throws std::invalid_argument for an unknown or duplicate name.
+    void add(std::string name, const std::vector<std::string>& after, Stage stage);
+
+    Report run();
+
+private:
+    struct Node {
+        std::string name;
+        std::vector<size_t> dependents;
+        size_t dependencies{0};
+        Stage stage;
+    };
+
+    std::vector<Node> nodes_;
+};
+
+} // namespace quids
@@ -24,6 +24,19 @@ struct ChainConfig {
     // Placeholder for chain configuration
 };
 
+// Per-subsystem memory budgets (memory::MemoryAccountant), in MB; 0 leaves
+// a subsystem unbounded. Caches evict down to theirs, the mempool and
+// network buffers refuse new work past theirs.
+struct MemoryBudgets {
+    size_t mempool_mb{0};
+    size_t state_cache_mb{0};
+    size_t quantum_state_mb{0};
+    size_t network_buffers_mb{0};
+    size_t dht_mb{0};
+    size_t ml_models_mb{0};
+    size_t block_cache_mb{256};
+};
+
 struct QuidsConfig {
     // Network settings
     std::string network_type{"mainnet"};
@@ -35,10 +48,15 @@ struct QuidsConfig {
     std::string data_dir;
     std::string config_path;
     std::string log_dir;
+
+    // Reload caches saved under data_dir on the last clean stop
+    bool warm_start{true};
+    size_t warm_code_entries{1024};
     
     // Resource limits
     size_t max_memory_mb{8192};
     size_t num_worker_threads{4};
+    MemoryBudgets memory;
     
     // Quantum settings
     size_t num_qubits{24};
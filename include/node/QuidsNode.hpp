@@ -34,6 +34,9 @@ private:
     bool initializeEVM();
     bool initializeChain();
     bool completeBoot();
+    // Best effort both ways: a missing or bad cache only means a cold start
+    bool restoreWarmCaches();
+    void saveWarmCaches();
 
     // Member variables
     QuidsConfig config_;
@@ -1,14 +1,24 @@
 #pragma once
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace quids {
 
+struct SubsystemMemory {
+    std::string subsystem;
+    uint64_t live_bytes{0};
+    uint64_t peak_bytes{0};
+    uint64_t budget_bytes{0};  // 0 = none
+    uint64_t rejections{0};    // work refused by the budget
+};
+
 struct SystemHealth {
-    double cpu_usage{0.0};
-    double memory_usage{0.0};
-    double disk_usage{0.0};
-    double network_latency{0.0};
+    double cpu_usage{0.0};     // Share of all cores over the last second, 0 to 1
+    double memory_usage{0.0};  // Resident MB; the subsystems below are the tracked part of it
+    std::vector<SubsystemMemory> memory_by_subsystem;
+    double disk_usage{0.0};       // Used share of the data_dir filesystem, 0 to 1
+    double network_latency{0.0};  // Mean peer round trip over the last second, microseconds
     uint64_t uptime{0};
     std::string status{"unknown"};
     bool is_syncing{false};
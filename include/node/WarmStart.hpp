@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace quids {
+
+// Caches a node saves on the way down and reloads on the next start, one
+// file per cache under dir. Files carry a checksum and are replaced
+// atomically, so a torn or corrupt one is skipped, never trusted; every
+// cache must be rebuildable from scratch.
+class WarmStartStore {
+public:
+    explicit WarmStartStore(std::string dir);
+
+    bool save(const std::string& name, std::span<const uint8_t> data) const;
+    std::optional<std::vector<uint8_t>> load(const std::string& name) const;
+
+private:
+    std::string path(const std::string& name) const;
+
+    std::string dir_;
+};
+
+} // namespace quids
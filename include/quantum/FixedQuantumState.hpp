@@ -0,0 +1,334 @@
+#ifndef QUIDS_QUANTUM_FIXED_QUANTUM_STATE_HPP
+#define QUIDS_QUANTUM_FIXED_QUANTUM_STATE_HPP
+
+#include "QuantumState.hpp"
+#include "utils/RandomService.hpp"
+#include <Eigen/Dense>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace quids::quantum {
+
+/// Widest state FixedQuantumState holds inline (16 KiB of amplitudes)
+inline constexpr std::size_t MAX_FIXED_QUBITS = 10;
+
+namespace detail {
+
+/// Group loops at or below this many iterations are expanded in full
+inline constexpr std::size_t FIXED_UNROLL_LIMIT = 32;
+
+/// k with a zero bit inserted at position p
+constexpr std::size_t fixedInsertZero(std::size_t k, std::size_t p) noexcept {
+    const std::size_t low = (std::size_t{1} << p) - 1;
+    return ((k & ~low) << 1) | (k & low);
+}
+
+/// Calls body(k) for k in [0, Count); each k is a compile-time constant
+/// when the loop is short enough to unroll
+template<std::size_t Count, typename Body>
+inline void fixedUnrolled(Body&& body) {
+    if constexpr (Count <= FIXED_UNROLL_LIMIT) {
+        [&]<std::size_t... K>(std::index_sequence<K...>) {
+            (body(std::integral_constant<std::size_t, K>{}), ...);
+        }(std::make_index_sequence<Count>{});
+    } else {
+        for (std::size_t k = 0; k < Count; ++k) {
+            body(k);
+        }
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief Quantum state with a qubit count fixed at compile time
+ *
+ * The amplitudes live inline in a fixed-size Eigen vector, so a state
+ * costs no heap allocation and every stride is a constant. Gates take the
+ * qubit as a template argument and their group loops are expanded in full
+ * for small states; the runtime-qubit overloads pick the matching
+ * instantiation. Qubit numbering, gate conventions and measurement match
+ * QuantumState, and the two convert into each other.
+ *
+ * @tparam NumQubits Number of qubits, 1 to MAX_FIXED_QUBITS
+ */
+template<std::size_t NumQubits>
+class FixedQuantumState {
+    static_assert(NumQubits >= 1 && NumQubits <= MAX_FIXED_QUBITS,
+                  "FixedQuantumState holds 1 to MAX_FIXED_QUBITS qubits");
+
+public:
+    static constexpr std::size_t NUM_QUBITS = NumQubits;
+    static constexpr std::size_t DIM = std::size_t{1} << NumQubits;
+
+    using Vector = Eigen::Matrix<std::complex<double>, static_cast<int>(DIM), 1>;
+
+    /**
+     * @brief Creates the ground state |0...0>
+     */
+    FixedQuantumState() {
+        amplitudes_.setZero();
+        amplitudes_(0) = 1.0;
+    }
+
+    /**
+     * @brief Copies and normalizes amplitudes, as QuantumState does
+     * @param state_vector Amplitudes, DIM of them
+     * @throws std::invalid_argument if the dimension differs
+     */
+    explicit FixedQuantumState(const StateVector& state_vector) {
+        if (static_cast<std::size_t>(state_vector.size()) != DIM) {
+            throw std::invalid_argument("State vector dimension does not match qubit count");
+        }
+        amplitudes_ = state_vector;
+        amplitudes_.normalize();
+    }
+
+    /**
+     * @brief Copies a dynamic state of the same qubit count
+     * @throws std::invalid_argument if the qubit count differs
+     */
+    explicit FixedQuantumState(const QuantumState& state) : FixedQuantumState(state.getStateVector()) {}
+
+    /**
+     * @brief Copies the amplitudes into a dynamic state
+     */
+    [[nodiscard]] QuantumState toDynamic() const { return QuantumState(StateVector(amplitudes_)); }
+
+    [[nodiscard]] static constexpr std::size_t getNumQubits() noexcept { return NumQubits; }
+    [[nodiscard]] static constexpr std::size_t size() noexcept { return DIM; }
+
+    [[nodiscard]] const Vector& getStateVector() const noexcept { return amplitudes_; }
+
+    /**
+     * @throws std::out_of_range if index is invalid
+     */
+    [[nodiscard]] std::complex<double> getAmplitude(std::size_t index) const {
+        if (index >= DIM) {
+            throw std::out_of_range("Amplitude index out of range");
+        }
+        return amplitudes_(static_cast<Eigen::Index>(index));
+    }
+
+    /**
+     * @throws std::out_of_range if index is invalid
+     */
+    void setAmplitude(std::size_t index, const std::complex<double>& value) {
+        if (index >= DIM) {
+            throw std::out_of_range("Amplitude index out of range");
+        }
+        amplitudes_(static_cast<Eigen::Index>(index)) = value;
+    }
+
+    /**
+     * @brief Normalizes the state
+     * @throws std::runtime_error if state is zero vector
+     */
+    void normalize() {
+        const double norm = amplitudes_.norm();
+        if (norm == 0.0) {
+            throw std::runtime_error("Cannot normalize zero state");
+        }
+        amplitudes_ /= norm;
+    }
+
+    [[nodiscard]] bool isValid() const noexcept {
+        return amplitudes_.allFinite() && std::abs(amplitudes_.norm() - 1.0) < 1e-10;
+    }
+
+    // Gates with the qubits fixed at compile time
+
+    template<std::size_t Qubit>
+    void applySingleQubitGate(const Eigen::Matrix2cd& gate) {
+        static_assert(Qubit < NumQubits, "Qubit index out of range");
+        constexpr std::size_t stride = std::size_t{1} << Qubit;
+        const std::complex<double> g00 = gate(0, 0), g01 = gate(0, 1), g10 = gate(1, 0), g11 = gate(1, 1);
+        detail::fixedUnrolled<DIM / 2>([&](std::size_t k) {
+            const std::size_t i0 = detail::fixedInsertZero(k, Qubit);
+            const std::complex<double> x = amplitudes_(i0);
+            const std::complex<double> y = amplitudes_(i0 | stride);
+            amplitudes_(i0) = g00 * x + g01 * y;
+            amplitudes_(i0 | stride) = g10 * x + g11 * y;
+        });
+    }
+
+    template<std::size_t Control, std::size_t Target>
+    void applyControlledGate(const Eigen::Matrix2cd& gate) {
+        static_assert(Control < NumQubits && Target < NumQubits, "Qubit index out of range");
+        static_assert(Control != Target, "Control and target must be distinct qubits");
+        constexpr std::size_t lo = Control < Target ? Control : Target;
+        constexpr std::size_t hi = Control < Target ? Target : Control;
+        constexpr std::size_t control = std::size_t{1} << Control;
+        constexpr std::size_t target = std::size_t{1} << Target;
+        const std::complex<double> g00 = gate(0, 0), g01 = gate(0, 1), g10 = gate(1, 0), g11 = gate(1, 1);
+        detail::fixedUnrolled<DIM / 4>([&](std::size_t k) {
+            const std::size_t i0 = detail::fixedInsertZero(detail::fixedInsertZero(k, lo), hi) | control;
+            const std::complex<double> x = amplitudes_(i0);
+            const std::complex<double> y = amplitudes_(i0 | target);
+            amplitudes_(i0) = g00 * x + g01 * y;
+            amplitudes_(i0 | target) = g10 * x + g11 * y;
+        });
+    }
+
+    /// gate row and column index 2 * bit(Qubit1) + bit(Qubit2)
+    template<std::size_t Qubit1, std::size_t Qubit2>
+    void applyTwoQubitGate(const Eigen::Matrix4cd& gate) {
+        static_assert(Qubit1 < NumQubits && Qubit2 < NumQubits, "Qubit index out of range");
+        static_assert(Qubit1 != Qubit2, "Two-qubit gate needs two distinct qubits");
+        constexpr std::size_t lo = Qubit1 < Qubit2 ? Qubit1 : Qubit2;
+        constexpr std::size_t hi = Qubit1 < Qubit2 ? Qubit2 : Qubit1;
+        constexpr std::size_t m1 = std::size_t{1} << Qubit1;
+        constexpr std::size_t m2 = std::size_t{1} << Qubit2;
+        detail::fixedUnrolled<DIM / 4>([&](std::size_t k) {
+            const std::size_t i = detail::fixedInsertZero(detail::fixedInsertZero(k, lo), hi);
+            const std::size_t idx[4] = {i, i | m2, i | m1, i | m1 | m2};
+            const std::complex<double> x[4] = {amplitudes_(idx[0]), amplitudes_(idx[1]),
+                                               amplitudes_(idx[2]), amplitudes_(idx[3])};
+            for (std::size_t r = 0; r < 4; ++r) {
+                amplitudes_(idx[r]) = gate(r, 0) * x[0] + gate(r, 1) * x[1] + gate(r, 2) * x[2] + gate(r, 3) * x[3];
+            }
+        });
+    }
+
+    template<std::size_t Control, std::size_t Target>
+    void applyCNOT() {
+        static_assert(Control < NumQubits && Target < NumQubits, "Qubit index out of range");
+        if constexpr (Control != Target) {
+            constexpr std::size_t lo = Control < Target ? Control : Target;
+            constexpr std::size_t hi = Control < Target ? Target : Control;
+            constexpr std::size_t control = std::size_t{1} << Control;
+            constexpr std::size_t target = std::size_t{1} << Target;
+            detail::fixedUnrolled<DIM / 4>([&](std::size_t k) {
+                const std::size_t i0 = detail::fixedInsertZero(detail::fixedInsertZero(k, lo), hi) | control;
+                std::swap(amplitudes_(i0), amplitudes_(i0 | target));
+            });
+        }
+    }
+
+    // Runtime qubits, same checks as QuantumState
+
+    /**
+     * @throws std::out_of_range if qubit is invalid
+     */
+    void applySingleQubitGate(std::size_t qubit, const Eigen::Matrix2cd& gate) {
+        dispatch(qubit, [&](auto q) { applySingleQubitGate<q()>(gate); });
+    }
+
+    void applyHadamard(std::size_t qubit) {
+        const double h = 1.0 / std::sqrt(2.0);
+        Eigen::Matrix2cd H;
+        H << h, h,
+             h, -h;
+        applySingleQubitGate(qubit, H);
+    }
+
+    void applyPhase(std::size_t qubit, double angle) {
+        Eigen::Matrix2cd P;
+        P << 1.0, 0.0,
+             0.0, std::exp(std::complex<double>(0.0, angle));
+        applySingleQubitGate(qubit, P);
+    }
+
+    /**
+     * @throws std::out_of_range if either qubit is invalid
+     */
+    void applyCNOT(std::size_t control, std::size_t target) {
+        dispatch(control, [&](auto c) {
+            dispatch(target, [&](auto t) { applyCNOT<c(), t()>(); });
+        });
+    }
+
+    /**
+     * @throws std::out_of_range if either qubit is invalid
+     * @throws std::invalid_argument if the qubits are the same
+     */
+    void applyControlledGate(std::size_t control, std::size_t target, const Eigen::Matrix2cd& gate) {
+        if (control == target && control < NumQubits) {
+            throw std::invalid_argument("Control and target must be distinct qubits");
+        }
+        dispatch(control, [&](auto c) {
+            dispatch(target, [&](auto t) {
+                if constexpr (c() != t()) {
+                    applyControlledGate<c(), t()>(gate);
+                }
+            });
+        });
+    }
+
+    /**
+     * @throws std::out_of_range if either qubit is invalid
+     * @throws std::invalid_argument if the qubits are the same
+     */
+    void applyTwoQubitGate(std::size_t qubit1, std::size_t qubit2, const Eigen::Matrix4cd& gate) {
+        if (qubit1 == qubit2 && qubit1 < NumQubits) {
+            throw std::invalid_argument("Two-qubit gate needs two distinct qubits");
+        }
+        dispatch(qubit1, [&](auto q1) {
+            dispatch(qubit2, [&](auto q2) {
+                if constexpr (q1() != q2()) {
+                    applyTwoQubitGate<q1(), q2()>(gate);
+                }
+            });
+        });
+    }
+
+    /**
+     * @brief Measures qubit, collapsing the state
+     * @param u Uniform draw in [0, 1); the outcome is 1 when u falls below
+     *          the probability of 1
+     * @return Measured bit
+     * @throws std::out_of_range if qubit is invalid
+     */
+    bool measure(std::size_t qubit, double u) {
+        if (qubit >= NumQubits) {
+            throw std::out_of_range("Qubit index out of range");
+        }
+        const std::size_t mask = std::size_t{1} << qubit;
+        double prob_one = 0.0;
+        for (std::size_t i = 0; i < DIM; ++i) {
+            if ((i & mask) != 0) {
+                prob_one += std::norm(amplitudes_(i));
+            }
+        }
+        const bool result = u < prob_one;
+        const double norm_factor = 1.0 / std::sqrt(result ? prob_one : (1.0 - prob_one));
+        for (std::size_t i = 0; i < DIM; ++i) {
+            if (((i & mask) != 0) != result) {
+                amplitudes_(i) = 0.0;
+            } else {
+                amplitudes_(i) *= norm_factor;
+            }
+        }
+        return result;
+    }
+
+    bool measure(std::size_t qubit) {
+        return measure(qubit, ::quids::utils::RandomService::global().local().uniform());
+    }
+
+    [[nodiscard]] bool operator==(const FixedQuantumState& other) const noexcept {
+        return amplitudes_ == other.amplitudes_;
+    }
+
+private:
+    /// Calls f with qubit as a std::integral_constant
+    template<typename F>
+    static void dispatch(std::size_t qubit, F&& f) {
+        if (qubit >= NumQubits) {
+            throw std::out_of_range("Qubit index out of range");
+        }
+        [&]<std::size_t... Q>(std::index_sequence<Q...>) {
+            ((qubit == Q ? (f(std::integral_constant<std::size_t, Q>{}), true) : false) || ...);
+        }(std::make_index_sequence<NumQubits>{});
+    }
+
+    Vector amplitudes_;
+};
+
+} // namespace quids::quantum
+
+#endif // QUIDS_QUANTUM_FIXED_QUANTUM_STATE_HPP
@@ -0,0 +1,19 @@
+#ifndef QUIDS_QUANTUM_GPU_BACKEND_HPP
+#define QUIDS_QUANTUM_GPU_BACKEND_HPP
+
+#include "SimulationBackend.hpp"
+#include <memory>
+
+namespace quids::quantum::gpu {
+
+/**
+ * @brief Creates the CUDA or HIP backend this build was compiled with
+ *
+ * Only defined when QUIDS_HAVE_GPU is set; see QUIDS_ENABLE_GPU.
+ * @return Backend on the first device, or nullptr when none is present
+ */
+[[nodiscard]] std::shared_ptr<SimulationBackend> makeGpuBackend();
+
+} // namespace quids::quantum::gpu
+
+#endif // QUIDS_QUANTUM_GPU_BACKEND_HPP
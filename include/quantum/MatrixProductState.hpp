@@ -0,0 +1,110 @@
+#ifndef QUIDS_QUANTUM_MATRIX_PRODUCT_STATE_HPP
+#define QUIDS_QUANTUM_MATRIX_PRODUCT_STATE_HPP
+
+#include "SimulationBackend.hpp"
+#include <Eigen/Dense>
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace quids::quantum {
+
+/**
+ * @brief n-qubit state as a chain of tensors, one per qubit
+ *
+ * Site k holds qubit k as two bond matrices A_k[0] and A_k[1], and the
+ * amplitude of basis state b is A_0[b_0] A_1[b_1] ... A_{n-1}[b_{n-1}].
+ * Memory is O(n chi^2) for bond dimension chi, so weakly entangled states
+ * such as product-like encodings stay small however many qubits they have.
+ *
+ * The chain is kept in mixed canonical form around one site. Gates on
+ * neighbouring qubits are applied there and split again by SVD, keeping at
+ * most max_bond_dimension singular values and dropping the tail whose
+ * weight is below truncation_cutoff; gates on distant qubits are routed by
+ * swaps. Truncation changes the state, and the weight it dropped is
+ * reported by truncationError().
+ */
+class MatrixProductState {
+public:
+    struct Config {
+        std::size_t max_bond_dimension{64};
+        double truncation_cutoff{1e-12};  ///< discarded weight per split, relative to the norm
+    };
+
+    /**
+     * @brief Creates the |0...0> state
+     * @throws std::invalid_argument if num_qubits is 0
+     */
+    MatrixProductState(std::size_t num_qubits, const Config& config);
+    explicit MatrixProductState(std::size_t num_qubits) : MatrixProductState(num_qubits, Config{}) {}
+
+    /**
+     * @brief Decomposes 2^num_qubits amplitudes by successive SVDs
+     * @param amplitudes Amplitudes in basis order
+     * @param stride Distance between consecutive amplitudes, for batches
+     * @throws std::invalid_argument if num_qubits is 0
+     */
+    MatrixProductState(const std::complex<double>* amplitudes, std::size_t num_qubits,
+                       const Config& config, std::size_t stride = 1);
+
+    [[nodiscard]] std::size_t getNumQubits() const noexcept { return sites_.size(); }
+
+    /**
+     * @brief Writes the 2^n amplitudes out in basis order
+     * @param amplitudes Destination
+     * @param stride Distance between consecutive amplitudes
+     */
+    void toAmplitudes(std::complex<double>* amplitudes, std::size_t stride = 1) const;
+
+    /// Gates as on QuantumState; two-qubit row index is 2 * bit(qubit1) + bit(qubit2)
+    void applySingleQubitGate(std::size_t qubit, const Eigen::Matrix2cd& gate);
+    void applyTwoQubitGate(std::size_t qubit1, std::size_t qubit2, const Eigen::Matrix4cd& gate);
+    void applyControlledGate(std::size_t control, std::size_t target, const Eigen::Matrix2cd& gate);
+
+    /**
+     * @brief Measures one qubit and collapses the state
+     * @param uniform Draw from [0, 1); reads 1 when below the probability of 1
+     * @return Outcome
+     */
+    bool measure(std::size_t qubit, double uniform);
+
+    /// Largest bond dimension in the chain
+    [[nodiscard]] std::size_t maxBondDimension() const noexcept;
+
+    /// Weight dropped by truncation so far, summed over splits
+    [[nodiscard]] double truncationError() const noexcept { return truncation_error_; }
+
+    /// Bytes held by the tensors
+    [[nodiscard]] std::size_t memoryBytes() const noexcept;
+
+private:
+    using Site = std::array<Eigen::MatrixXcd, 2>;
+
+    void validateQubit(std::size_t qubit) const;
+    void moveCenterTo(std::size_t site);
+    // Gate on sites (site, site + 1), row index 2 * bit(site) + bit(site + 1)
+    void applyAdjacent(std::size_t site, const Eigen::Matrix4cd& gate);
+    // Singular values to keep out of a descending list
+    std::size_t keepCount(const Eigen::VectorXd& singular);
+
+    Config config_;
+    std::vector<Site> sites_;
+    std::size_t center_{0};
+    double truncation_error_{0.0};
+};
+
+/**
+ * @brief Creates a simulation backend that keeps states as MPS
+ *
+ * Buffers hold one MatrixProductState per state, so QuantumState frees its
+ * host vector while the backend has the state (see
+ * SimulationBackend::replacesHostCopy). Install it with
+ * setSimulationBackend and a threshold above which states are compressed.
+ */
+[[nodiscard]] std::shared_ptr<SimulationBackend> makeMpsBackend(const MatrixProductState::Config& config = {});
+
+} // namespace quids::quantum
+
+#endif // QUIDS_QUANTUM_MATRIX_PRODUCT_STATE_HPP
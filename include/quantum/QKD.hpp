@@ -1,10 +1,10 @@
 #ifndef QKD_HPP
 #define QKD_HPP
 
-#include <vector>
-#include <string>
-#include <random>
-#include <unordered_map>
+#include "utils/RandomService.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <stdexcept>
 
 /**
@@ -24,52 +24,74 @@ Alice generates random bits and bases.
 Alice sends qubits to Bob using her bases.
 Bob measures the qubits using his randomly chosen bases.
 Alice and Bob sift their keys by comparing bases and discarding mismatched bits.
-Error correction is performed to fix any discrepancies.
-Privacy amplification is applied to reduce Eve's knowledge of the key.
+Cascade error correction fixes discrepancies by comparing block parities.
+Privacy amplification hashes the key with a random Toeplitz matrix to reduce Eve's knowledge of the key.
+Keys are built in chunks of raw qubits, so memory stays bounded for long keys.
+Bit Storage:
+Keys and bases are packed 64 bits to a word, so sifting, noise and parity work a word at a time.
 Classical Simulation:
 Quantum operations (e.g., qubit transmission and measurement) are simulated using classical random number generation.
 
 Random Number Generation:
-The std::mt19937 random number generator is used to simulate randomness in quantum measurements.
+The thread's quids::utils::RandomService generator simulates randomness in quantum measurements.
 Error Handling:
-The code assumes a small error rate (5%) and corrects errors by flipping bits randomly.
+The simulated channel flips each transmitted bit with the configured error rate (5% by default).
+Rates at or above 11%, where BB84 yields no secure key, are rejected.
  */
 
 namespace quantum {
 
+// Key bits, packed 64 to a word
+using KeyBits = quids::utils::PackedBits;
+
 class QKD {
 public:
-    // Constructor
-    QKD();
+    // Raw qubits per chunk of a streamed key
+    static constexpr size_t DEFAULT_CHUNK_LENGTH = size_t{1} << 16;
+
+    // Outcome of error correction
+    struct CorrectionStats {
+        size_t disclosedBits{0};    // Parities revealed on the public channel
+        size_t correctedErrors{0};  // Bits flipped in Bob's key
+    };
+
+    // Constructor; errorRate is the simulated channel's bit error rate
+    explicit QKD(double errorRate = 0.05);
+
+    // Generate a random quantum key of keyLength bits using the BB84 protocol
+    KeyBits generateKey(size_t keyLength);
 
-    // Generate a random quantum key using the BB84 protocol
-    std::vector<bool> generateKey(size_t keyLength);
+    // Generate keyLength key bits chunk by chunk, handing each chunk's bits to sink
+    void streamKey(size_t keyLength, const std::function<void(const KeyBits&)>& sink,
+                   size_t chunkLength = DEFAULT_CHUNK_LENGTH);
 
-    // Simulate the transmission of qubits from Alice to Bob
-    std::vector<bool> transmitQubits(const std::vector<bool>& bits, const std::vector<bool>& bases);
+    // Simulate the transmission of qubits from Alice to Bob; returns Bob's measured bits
+    KeyBits transmitQubits(const KeyBits& bits, const KeyBits& aliceBases, const KeyBits& bobBases);
 
-    // Perform sifting to discard mismatched bases
-    std::vector<bool> siftKeys(const std::vector<bool>& aliceBases, const std::vector<bool>& bobBases, const std::vector<bool>& rawKey);
+    // Perform sifting to keep the bits measured in matching bases
+    KeyBits siftKeys(const KeyBits& aliceBases, const KeyBits& bobBases, const KeyBits& rawKey);
 
-    // Perform error correction (simplified for demonstration)
-    std::vector<bool> correctErrors(const std::vector<bool>& siftedKey, double errorRate);
+    // Perform Cascade error correction of bobKey against aliceKey
+    CorrectionStats correctErrors(const KeyBits& aliceKey, KeyBits& bobKey, double errorRate);
 
-    // Perform privacy amplification to reduce Eve's knowledge
-    std::vector<bool> privacyAmplification(const std::vector<bool>& correctedKey, size_t finalKeyLength);
+    // Perform privacy amplification with the Toeplitz matrix given by seed
+    // (finalKeyLength + correctedKey.size - 1 bits) to reduce Eve's knowledge
+    KeyBits privacyAmplification(const KeyBits& correctedKey, size_t finalKeyLength, const KeyBits& seed);
+
+    // Same, with a freshly drawn seed
+    KeyBits privacyAmplification(const KeyBits& correctedKey, size_t finalKeyLength);
+
+    // XOR of two keys of equal length
+    static KeyBits xorBits(const KeyBits& a, const KeyBits& b);
 
 private:
     // Helper functions
-    std::vector<bool> generateRandomBits(size_t length);
-    std::vector<bool> generateRandomBases(size_t length);
-    std::vector<bool> measureQubits(const std::vector<bool>& bits, const std::vector<bool>& bases);
-    std::vector<bool> xorVectors(const std::vector<bool>& a, const std::vector<bool>& b);
-
-    // Random number generator
-    std::random_device rd;
-    std::mt19937 gen;
-    std::uniform_int_distribution<> dis;
+    KeyBits generateRandomBits(size_t length);
+    KeyBits generateChannelNoise(size_t length);
+
+    double errorRate_;
 };
 
 } // namespace quantum
 
-#endif // QKD_HPP
\ No newline at end of file
+#endif // QKD_HPP
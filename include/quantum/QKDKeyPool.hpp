@@ -0,0 +1,102 @@
+#ifndef QKD_KEY_POOL_HPP
+#define QKD_KEY_POOL_HPP
+
+#include "quantum/QKD.hpp"
+#include "utils/Metrics.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quantum {
+
+// Key material distilled ahead of demand for one QKD channel.
+//
+// A background thread runs the BB84 pipeline (QKD::streamKey) whenever
+// the reservoir drops below its low watermark and tops it up to capacity,
+// one chunk at a time, so consumers such as session rekeying take bytes
+// already distilled instead of waiting out sifting, Cascade and privacy
+// amplification. take() never waits for the pipeline: it hands out what is
+// there or nothing, and the caller decides how to fall back. Bytes are
+// handed out once.
+//
+// Depth, production, consumption and shortfalls are exported through
+// utils::MetricsRegistry with a channel label; the consumption rate is the
+// rate of quids_qkd_pool_consumed_bytes_total.
+class QKDKeyPool {
+public:
+    struct Config {
+        size_t capacityBytes{64 * 1024};
+        // Refilling starts below this many bytes
+        size_t lowWatermarkBytes{32 * 1024};
+        size_t chunkLength{QKD::DEFAULT_CHUNK_LENGTH};
+        double errorRate{0.05};
+    };
+
+    struct Stats {
+        size_t availableBytes{0};
+        uint64_t producedBytes{0};
+        uint64_t consumedBytes{0};
+        uint64_t shortfalls{0};  // take() calls the reservoir could not cover
+    };
+
+    explicit QKDKeyPool(std::string channel);
+    QKDKeyPool(std::string channel, Config config);
+    ~QKDKeyPool();
+
+    QKDKeyPool(const QKDKeyPool&) = delete;
+    QKDKeyPool& operator=(const QKDKeyPool&) = delete;
+
+    // Starts the refill thread; idempotent
+    void start();
+    // Joins the refill thread after the chunk in progress
+    void stop();
+
+    // bytes of key material, or nullopt without waiting when fewer are ready
+    std::optional<std::vector<uint8_t>> take(size_t bytes);
+
+    // Blocks until bytes are ready or timeout passes, e.g. during startup;
+    // false on timeout
+    bool waitFor(size_t bytes, std::chrono::milliseconds timeout);
+
+    [[nodiscard]] Stats stats() const;
+    [[nodiscard]] const std::string& channel() const { return channel_; }
+
+private:
+    void run();
+    // Appends a distilled chunk; whole bytes go to the reservoir
+    void deposit(const KeyBits& chunk);
+
+    const std::string channel_;
+    const Config config_;
+    QKD qkd_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    // Ring buffer of capacityBytes
+    std::vector<uint8_t> ring_;
+    size_t head_{0};
+    size_t size_{0};
+    bool stopping_{false};
+    Stats stats_;
+    std::thread worker_;
+
+    // Bits of the last chunk short of a byte; worker thread only
+    uint64_t spareBits_{0};
+    unsigned spareCount_{0};
+
+    std::shared_ptr<quids::utils::Gauge> depth_;
+    std::shared_ptr<quids::utils::Counter> produced_;
+    std::shared_ptr<quids::utils::Counter> consumed_;
+    std::shared_ptr<quids::utils::Counter> shortfalls_;
+};
+
+} // namespace quantum
+
+#endif // QKD_KEY_POOL_HPP
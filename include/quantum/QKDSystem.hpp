@@ -10,6 +10,12 @@ namespace quids::quantum {
 
 class QKDChannel;
 
+enum class QuantumSecurityLevel {
+    HIGH,
+    MEDIUM,
+    LOW
+};
+
 class QKDSystem {
 public:
     static std::unique_ptr<QKDSystem> create(uint16_t port);
@@ -32,7 +32,10 @@ public:
     /**
      * @brief Creates a quantum circuit with specified number of qubits
      * @param numQubits Number of qubits in the circuit
-     * @throws std::invalid_argument if numQubits is 0
+     * @throws std::invalid_argument if numQubits is 0 or above 4096
+     *
+     * Circuits of more than 63 qubits have no state vector: they accept
+     * Clifford gates only and run through measure().
      */
     explicit QuantumCircuit(std::size_t numQubits);
 
@@ -88,15 +91,31 @@ public:
      * @brief Executes the circuit on an initial state
      * @param initialState Starting quantum state
      * @return Final quantum state after circuit execution
-     * @throws std::invalid_argument if state dimensions don't match circuit
+     * @throws std::invalid_argument if state dimensions don't match circuit,
+     *         or the circuit is wider than a state vector allows
      */
     [[nodiscard]] QuantumState execute(const QuantumState& initialState) const;
 
     /**
      * @brief Measures all qubits in the circuit
+     *
+     * Runs the circuit from |0...0>. A Clifford circuit runs on a
+     * StabilizerTableau in time polynomial in the qubit count; any other
+     * runs on the state vector.
+     *
      * @return Vector of measurement results
      */
     [[nodiscard]] std::vector<bool> measure() const;
+
+    /**
+     * @brief Checks whether every gate so far is a Clifford gate
+     *
+     * H, S (PHASE), the Paulis, CNOT, CZ, CY, SWAP, and custom gates equal
+     * to a single-qubit Clifford up to global phase all qualify.
+     *
+     * @return true if measure() takes the stabilizer path
+     */
+    [[nodiscard]] bool isClifford() const noexcept;
     
     /**
      * @brief Gets the depth of the circuit
@@ -118,9 +137,47 @@ public:
     
     /**
      * @brief Optimizes the circuit by combining and simplifying gates
+     *
+     * Replaces the gates with their compiled form: adjacent inverses cancel,
+     * runs of single-qubit gates fuse into one 2x2 matrix, gates on the same
+     * qubit pair fuse into one 4x4 block, and gates on disjoint qubits are
+     * reordered so each qubit's run is applied in one sweep. execute()
+     * applies the same compilation without changing the circuit.
      */
     void optimize();
 
+    /**
+     * @brief Hit and miss counts of a process-wide circuit cache
+     */
+    struct CacheStats {
+        std::size_t hits{0};
+        std::size_t misses{0};
+        std::size_t entries{0};
+    };
+
+    using CompileCacheStats = CacheStats;
+
+    /**
+     * @brief Counters of the compiled-circuit cache
+     *
+     * Circuits are compiled once per structure (qubits, gates and matrices),
+     * so fixed circuits rebuilt by callers skip recompilation.
+     */
+    [[nodiscard]] static CompileCacheStats compileCacheStats() noexcept;
+    static void clearCompileCache() noexcept;
+
+    /**
+     * @brief Counters of the execution result cache
+     *
+     * execute() remembers the output of circuits without measurements,
+     * keyed by circuit structure and a digest of the input state, for
+     * inputs of up to 2^14 amplitudes. Running the same circuit on the same
+     * input again, as re-verification does, returns a shared copy of the
+     * earlier result. The cache is bounded and safe to use concurrently.
+     */
+    [[nodiscard]] static CacheStats resultCacheStats() noexcept;
+    static void clearResultCache() noexcept;
+
     /**
      * @brief Calculates the computational cost of the circuit
      * @return Cost metric value
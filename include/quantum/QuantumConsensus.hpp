@@ -47,6 +47,49 @@ struct ConsensusResult {
     vector<size_t> measurements{};     ///< Final measurements
 };
 
+/**
+ * @brief One party's vote for an outcome
+ */
+struct Vote {
+    size_t party{0};                              ///< Voter index in [0, num_parties)
+    size_t outcome{0};                            ///< Outcome index in [0, num_outcomes)
+};
+
+/**
+ * @brief Result of tallying a set of votes
+ */
+struct VoteTally {
+    vector<size_t> counts{};                      ///< Counted votes per outcome
+    size_t examined{0};                           ///< Votes read before the result settled
+    size_t duplicates{0};                         ///< Repeat votes from a party, ignored
+    size_t invalid{0};                            ///< Votes naming an unknown party or outcome
+    optional<size_t> winner{};                    ///< Outcome backed by the threshold share of all parties
+    bool settled{false};                          ///< A winner exists or the remaining votes cannot make one
+};
+
+/**
+ * @brief Tallies votes in parallel, with the same result on every node
+ *
+ * Votes are read in fixed-size windows. Within a window a party bitmap keeps
+ * only each party's first vote in input order. Chunks are counted on the
+ * shared task pool, and their counts are summed pairwise in a fixed tree,
+ * so the result does not depend on thread count or scheduling. The tally
+ * stops after the first window in which an outcome holds
+ * ceil(threshold * num_parties) votes, or in which no outcome could reach
+ * that many even if every remaining vote went its way.
+ *
+ * @param votes Votes in arrival order
+ * @param num_parties Size of the electorate
+ * @param num_outcomes Number of distinct outcomes
+ * @param threshold Required share of all parties, in (0, 1]
+ * @return Counts so far and the decision, if any
+ */
+[[nodiscard]] VoteTally tallyVotes(
+    const vector<Vote>& votes,
+    size_t num_parties,
+    size_t num_outcomes,
+    double threshold);
+
 /**
  * @brief Implements quantum Byzantine agreement protocol
  * @param config Protocol configuration
@@ -15,9 +15,12 @@
 #include <string>
 #include <array>
 #include <cstdint>
+#include <span>
 #include "QKD.hpp"
 
-
+namespace quantum {
+class QKDKeyPool;
+} // namespace quantum
 
 namespace quids::quantum {
 
@@ -133,6 +136,16 @@ public:
      * @return Generated quantum key structure
      */
     quids::quantum::QuantumKey generateKey(const quids::quantum::QuantumEncryptionParams& params);
+
+    /**
+     * @brief Draw key material from a QKD reservoir
+     *
+     * generateKey() then takes its bytes from pool without waiting and
+     * falls back to local randomness when the pool runs short, so rekeying
+     * never stalls on the QKD pipeline.
+     * @param pool Reservoir to draw from; nullptr to stop drawing
+     */
+    void setKeyPool(std::shared_ptr<::quantum::QKDKeyPool> pool);
     
     /**
      * @brief Distribute a quantum key to a recipient
@@ -193,6 +206,36 @@ public:
     bool verify(const std::vector<uint8_t>& data,
                const quids::quantum::QuantumSignature& signature,
                const quids::quantum::QuantumKey& public_key);
+
+    /**
+     * @brief Sign many messages under one private key
+     *
+     * The key is decoded, and for Falcon expanded into its signing tree,
+     * once for the batch rather than once per message, and the proof key
+     * is derived from the current state once; the messages are then signed
+     * in parallel on the shared pool.
+     * @param messages Messages to sign
+     * @param private_key Private key used for every message
+     * @return One signature per message, in order
+     */
+    std::vector<quids::quantum::QuantumSignature> signMany(std::span<const std::vector<uint8_t>> messages,
+                                                           const std::vector<uint8_t>& private_key);
+
+    /**
+     * @brief Verify many signatures under one public key
+     *
+     * The classical signatures go through crypto::BatchVerifier, which
+     * decodes the key once for the whole batch; each proof is then scored
+     * against its message.
+     * @param messages Messages that were signed
+     * @param signatures One signature per message
+     * @param public_key Encoded public key of the signer
+     * @return One entry per item, 1 when both the signature and its proof hold
+     * @throws std::invalid_argument if messages and signatures differ in length
+     */
+    std::vector<uint8_t> verifyMany(std::span<const std::vector<uint8_t>> messages,
+                                    std::span<const quids::quantum::QuantumSignature> signatures,
+                                    const std::vector<uint8_t>& public_key);
                
     /**
      * @brief Get the current key size in bits
@@ -27,6 +27,38 @@ public:
     /// Forward declaration of implementation class
     class Impl;
 
+    /// Returns the implementation to its pool
+    struct ImplDeleter {
+        void operator()(Impl* impl) const noexcept;
+    };
+
+    /**
+     * @brief Compact summary of a state, for callers that only need metadata
+     *
+     * A few dozen bytes regardless of qubit count. Two states with equal
+     * amplitudes have equal descriptors; the fingerprint is not a
+     * commitment and must not be used as one.
+     */
+    struct Descriptor {
+        std::size_t num_qubits{0};
+        double norm{0.0};
+        double coherence{0.0};
+        double entropy{0.0};
+        std::uint64_t fingerprint{0};
+
+        [[nodiscard]] bool operator==(const Descriptor& other) const noexcept = default;
+    };
+
+    /**
+     * @brief Amplitude statistics, all produced by one pass over the vector
+     */
+    struct Metrics {
+        double norm{0.0};             ///< L2 norm of the amplitudes
+        double coherence{0.0};        ///< l1-norm of coherence over its maximum, in [0, 1]
+        double entropy{0.0};          ///< Shannon entropy of the basis probabilities, in bits
+        double max_probability{0.0};  ///< Probability of the likeliest basis state
+    };
+
     // Constructors
     explicit QuantumState(const StateVector& state_vector);
     
@@ -49,6 +81,10 @@ public:
 
     /**
      * @brief Copy constructor
+     *
+     * Copies share the amplitudes and cached matrices until one of them is
+     * modified, so copying is constant time. A copy of a state held by a
+     * simulation backend starts back on the host.
      * @param other State to copy from
      */
     QuantumState(const QuantumState& other);
@@ -78,6 +114,12 @@ public:
      */
     ~QuantumState();
 
+    /**
+     * @brief Summarizes the state without copying its amplitudes
+     * @return Descriptor of the current state
+     */
+    [[nodiscard]] Descriptor describe() const noexcept;
+
     /**
      * @brief Gets the number of qubits in the state
      * @return Number of qubits
@@ -175,6 +217,26 @@ public:
      */
     void applySingleQubitGate(std::size_t qubit, const Eigen::Matrix2cd& gate);
 
+    /**
+     * @brief Applies arbitrary two-qubit gate
+     * @param qubit1 First qubit
+     * @param qubit2 Second qubit
+     * @param gate 4x4 matrix, row and column index 2 * bit(qubit1) + bit(qubit2)
+     * @throws std::out_of_range if either qubit is invalid
+     * @throws std::invalid_argument if the qubits are the same
+     */
+    void applyTwoQubitGate(std::size_t qubit1, std::size_t qubit2, const Eigen::Matrix4cd& gate);
+
+    /**
+     * @brief Applies single-qubit gate to target where control is set
+     * @param control Control qubit
+     * @param target Target qubit
+     * @param gate 2x2 matrix applied to target
+     * @throws std::out_of_range if either qubit is invalid
+     * @throws std::invalid_argument if the qubits are the same
+     */
+    void applyControlledGate(std::size_t control, std::size_t target, const Eigen::Matrix2cd& gate);
+
     /**
      * @brief Applies optimized gate operation
      * @param gate Gate matrix to apply
@@ -197,6 +259,16 @@ public:
     void applyRotation(std::size_t qubit, double angle);
 
     // Quantum metrics
+    /**
+     * @brief Computes every amplitude metric in a single pass
+     *
+     * Cached until the state is next modified, so repeated metric reads on
+     * an unchanged state cost nothing. Writes made through the StateVector&
+     * conversion are only noticed at the next modifying call.
+     * @return Metrics of the current state
+     */
+    [[nodiscard]] const Metrics& computeMetrics() const;
+
     /**
      * @brief Gets coherence measure of the state
      * @return Coherence value between 0 and 1
@@ -291,11 +363,12 @@ protected:
         std::size_t target_qubit) const;
 
 private:
-    /// Implementation pointer
-    std::unique_ptr<Impl> impl_;
+    /// Implementation for writing; copies it first if another state shares it
+    Impl& mutableImpl();
 
-    /// Static cache for frequently used states
-    static std::unordered_map<std::size_t, QuantumState> state_cache_;
+    /// Implementation, allocated from a shared MemoryPool and shared
+    /// copy-on-write between copies
+    std::shared_ptr<Impl> impl_;
 };
 
 } // namespace quids::quantum
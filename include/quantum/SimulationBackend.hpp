@@ -0,0 +1,133 @@
+#ifndef QUIDS_QUANTUM_SIMULATION_BACKEND_HPP
+#define QUIDS_QUANTUM_SIMULATION_BACKEND_HPP
+
+#include <Eigen/Dense>
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace quids::quantum {
+
+/**
+ * @brief Off-host engine for state vector simulation
+ *
+ * A backend owns amplitudes in its own memory (a GPU, typically) and
+ * applies gates there. QuantumState and StateBatch hand their amplitudes to
+ * the selected backend once the simulation is large enough, keep them there
+ * across gates, and read only measurement outcomes back until the host
+ * needs the amplitudes themselves.
+ *
+ * Buffers hold batch_size states of 2^num_qubits amplitudes each; the
+ * amplitude of basis state i in state k is element i * batch_size + k.
+ */
+class SimulationBackend {
+public:
+    /// Amplitudes resident in the backend
+    class Buffer {
+    public:
+        virtual ~Buffer() = default;
+    };
+
+    virtual ~SimulationBackend() = default;
+
+    /**
+     * @brief Gets the backend name, for logs and metrics
+     * @return Name, e.g. "cuda"
+     */
+    [[nodiscard]] virtual const char* name() const noexcept = 0;
+
+    /**
+     * @brief Whether a buffer stands in for the host amplitudes
+     *
+     * A backend that compresses states, such as the MPS one, can hold a
+     * state in far less than 2^n amplitudes. QuantumState then frees its
+     * host vector while the buffer is current and rebuilds it with
+     * download() when the host next reads the amplitudes.
+     * @return true to let the host copy go
+     */
+    [[nodiscard]] virtual bool replacesHostCopy() const noexcept { return false; }
+
+    /**
+     * @brief Copies amplitudes into backend memory
+     * @param amplitudes 2^num_qubits * batch_size amplitudes, in buffer order
+     * @param num_qubits Qubits per state
+     * @param batch_size Number of states
+     * @return Buffer holding the copy
+     * @throws std::runtime_error if the backend is out of memory
+     */
+    [[nodiscard]] virtual std::unique_ptr<Buffer> upload(
+        const std::complex<double>* amplitudes,
+        std::size_t num_qubits,
+        std::size_t batch_size) = 0;
+
+    /**
+     * @brief Copies amplitudes back to host memory
+     * @param buffer Buffer from this backend
+     * @param amplitudes Destination, as many amplitudes as were uploaded
+     */
+    virtual void download(const Buffer& buffer, std::complex<double>* amplitudes) = 0;
+
+    /**
+     * @brief Applies a single-qubit gate to every state in the buffer
+     */
+    virtual void applySingleQubitGate(Buffer& buffer, const Eigen::Matrix2cd& gate, std::size_t qubit) = 0;
+
+    /**
+     * @brief Applies a two-qubit gate, row index 2 * bit(qubit1) + bit(qubit2)
+     */
+    virtual void applyTwoQubitGate(
+        Buffer& buffer,
+        const Eigen::Matrix4cd& gate,
+        std::size_t qubit1,
+        std::size_t qubit2) = 0;
+
+    /**
+     * @brief Applies gate to target where control is set
+     */
+    virtual void applyControlledGate(
+        Buffer& buffer,
+        const Eigen::Matrix2cd& gate,
+        std::size_t control,
+        std::size_t target) = 0;
+
+    /**
+     * @brief Measures one qubit of every state and collapses each
+     * @param buffer Buffer from this backend
+     * @param qubit Qubit to measure
+     * @param uniforms One draw from [0, 1) per state; state k reads 1 when
+     *        its draw is below its probability of 1
+     * @return Outcome per state
+     */
+    [[nodiscard]] virtual std::vector<bool> measure(
+        Buffer& buffer,
+        std::size_t qubit,
+        const std::vector<double>& uniforms) = 0;
+};
+
+/// Simulations of at least this many amplitudes, summed over a batch, go
+/// to the backend by default: 20 qubits, or a batch of equal total size
+inline constexpr std::size_t DEFAULT_OFFLOAD_AMPLITUDES = std::size_t{1} << 20;
+
+/**
+ * @brief Picks the backend for a simulation of the given size
+ * @param total_amplitudes Amplitudes across all states simulated together
+ * @return Backend to use, or nullptr to simulate on the host
+ */
+[[nodiscard]] std::shared_ptr<SimulationBackend> selectSimulationBackend(std::size_t total_amplitudes) noexcept;
+
+/**
+ * @brief Replaces the backend, e.g. to plug in another device type
+ *
+ * At startup this is the GPU backend when the build has one and a device
+ * is present. Simulations already offloaded keep their backend.
+ * @param backend New backend, or nullptr to keep everything on the host
+ * @param min_amplitudes Offload threshold for selectSimulationBackend
+ */
+void setSimulationBackend(
+    std::shared_ptr<SimulationBackend> backend,
+    std::size_t min_amplitudes = DEFAULT_OFFLOAD_AMPLITUDES);
+
+} // namespace quids::quantum
+
+#endif // QUIDS_QUANTUM_SIMULATION_BACKEND_HPP
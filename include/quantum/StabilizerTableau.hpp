@@ -0,0 +1,84 @@
+#ifndef QUIDS_QUANTUM_STABILIZER_TABLEAU_HPP
+#define QUIDS_QUANTUM_STABILIZER_TABLEAU_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace quids::quantum {
+
+/**
+ * @brief Stabilizer state of n qubits, simulated with a CHP tableau
+ *
+ * Holds the n destabilizer and n stabilizer generators of the state
+ * (Aaronson and Gottesman, "Improved simulation of stabilizer circuits"),
+ * each as X and Z bit rows packed 64 qubits to a word plus a sign bit.
+ * Clifford gates cost O(n) bit operations and a measurement O(n^2 / 64)
+ * word operations, against O(2^n) for a state vector, so circuits of
+ * H, S, the Paulis, CNOT, CZ and SWAP stay cheap at hundreds of qubits.
+ * Global phase is not tracked.
+ */
+class StabilizerTableau {
+public:
+    /**
+     * @brief Creates the |0...0> state
+     * @param num_qubits Number of qubits
+     * @throws std::invalid_argument if num_qubits is 0
+     */
+    explicit StabilizerTableau(std::size_t num_qubits);
+
+    /**
+     * @brief Gets the number of qubits
+     * @return Number of qubits
+     */
+    [[nodiscard]] std::size_t getNumQubits() const noexcept { return num_qubits_; }
+
+    /// Single-qubit Clifford gates; qubits are not range checked
+    void applyHadamard(std::size_t qubit) noexcept;
+    void applyPhase(std::size_t qubit) noexcept;  ///< S = diag(1, i)
+    void applyPauliX(std::size_t qubit) noexcept;
+    void applyPauliY(std::size_t qubit) noexcept;
+    void applyPauliZ(std::size_t qubit) noexcept;
+
+    /// Two-qubit Clifford gates on distinct qubits, not range checked
+    void applyCNOT(std::size_t control, std::size_t target) noexcept;
+    void applyCZ(std::size_t a, std::size_t b) noexcept;
+    void applySwap(std::size_t a, std::size_t b) noexcept;
+
+    /**
+     * @brief Measures a qubit in the Z basis and collapses the state
+     * @param qubit Qubit to measure
+     * @return Outcome; random outcomes come from utils::RandomService
+     * @throws std::out_of_range if qubit index is invalid
+     */
+    bool measure(std::size_t qubit);
+
+    /**
+     * @brief Gets a Z measurement outcome without measuring
+     * @param qubit Qubit to inspect
+     * @return The outcome if it is certain, nothing if it would be random
+     * @throws std::out_of_range if qubit index is invalid
+     */
+    [[nodiscard]] std::optional<bool> peekMeasurement(std::size_t qubit) const;
+
+private:
+    std::uint64_t* xRow(std::size_t row) noexcept { return x_.data() + row * words_; }
+    std::uint64_t* zRow(std::size_t row) noexcept { return z_.data() + row * words_; }
+
+    // Row h := row h * row i, both given as bit rows and a sign
+    void multiplyInto(std::uint64_t* hx, std::uint64_t* hz, std::uint8_t& hsign,
+                      const std::uint64_t* ix, const std::uint64_t* iz, std::uint8_t isign) const noexcept;
+    void validateQubit(std::size_t qubit) const;
+
+    std::size_t num_qubits_;
+    std::size_t words_;  // per bit row
+    // Rows 0..n-1 are destabilizers, n..2n-1 stabilizers
+    std::vector<std::uint64_t> x_;
+    std::vector<std::uint64_t> z_;
+    std::vector<std::uint8_t> sign_;
+};
+
+} // namespace quids::quantum
+
+#endif // QUIDS_QUANTUM_STABILIZER_TABLEAU_HPP
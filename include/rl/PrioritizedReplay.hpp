@@ -0,0 +1,86 @@
+#ifndef QUIDS_RL_PRIORITIZED_REPLAY_HPP
+#define QUIDS_RL_PRIORITIZED_REPLAY_HPP
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace quids::rl {
+
+struct Experience {
+    ::std::vector<double> state;
+    ::std::vector<double> action;
+    double reward;
+    ::std::vector<double> next_state;
+    bool done;
+};
+
+/**
+ * @brief Fixed-capacity prioritized experience replay.
+ *
+ * Experiences are stored as structure-of-arrays: one row per slot in a
+ * state, action and next-state matrix, so a sampled batch is gathered
+ * into contiguous matrices that feed the networks' batched passes
+ * directly. Sampling is proportional to priority^alpha through a sum
+ * tree, with stratified draws and importance weights normalized to 1.
+ */
+class PrioritizedReplay {
+public:
+    using Matrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    struct Batch {
+        ::std::vector<::std::size_t> indices;
+        Matrix states;
+        Matrix actions;
+        Matrix next_states;
+        Eigen::VectorXd rewards;
+        Eigen::VectorXd not_done;  // 0 for terminal transitions
+        Eigen::VectorXd weights;   // importance-sampling corrections
+    };
+
+    PrioritizedReplay(::std::size_t capacity, ::std::size_t state_dim, ::std::size_t action_dim,
+                      double alpha = 0.6);
+
+    /// Overwrites the oldest slot once full; new experiences get the
+    /// highest priority seen so far. Throws std::invalid_argument on a
+    /// dimension mismatch.
+    void add(const Experience& experience);
+    void add(::std::span<const Experience> experiences);
+
+    /// Draws `count` experiences into `out`, reusing its storage
+    void sample(::std::size_t count, double beta, ::std::mt19937_64& rng, Batch& out) const;
+
+    /// Sets priorities from the batch's TD errors
+    void updatePriorities(::std::span<const ::std::size_t> indices, const Eigen::VectorXd& tdErrors);
+
+    [[nodiscard]] ::std::size_t size() const { return size_; }
+    [[nodiscard]] ::std::size_t capacity() const { return capacity_; }
+    [[nodiscard]] double totalPriority() const { return tree_[1]; }
+
+private:
+    void setPriority(::std::size_t slot, double priority);
+    [[nodiscard]] ::std::size_t find(double mass) const;
+
+    ::std::size_t capacity_;
+    ::std::size_t leaves_;  // capacity rounded up to a power of two
+    double alpha_;
+
+    Matrix states_;
+    Matrix actions_;
+    Matrix next_states_;
+    Eigen::VectorXd rewards_;
+    Eigen::VectorXd not_done_;
+
+    // Sum tree in heap order: node i has children 2i and 2i + 1, slot s
+    // is leaf leaves_ + s
+    ::std::vector<double> tree_;
+    double max_priority_{1.0};
+    ::std::size_t next_{0};
+    ::std::size_t size_{0};
+};
+
+} // namespace quids::rl
+
+#endif // QUIDS_RL_PRIORITIZED_REPLAY_HPP
@@ -1,46 +1,71 @@
 #ifndef QUIDS_RL_QUANTUM_RL_AGENT_HPP
 #define QUIDS_RL_QUANTUM_RL_AGENT_HPP
 
-//#include "../StdNamespace.hpp"
-#include "../quantum/QuantumTypes.hpp"
-#include "../quantum/QuantumCircuit.hpp"
 #include "../neural/QuantumPolicyNetwork.hpp"
 #include "../neural/QuantumValueNetwork.hpp"
+#include "PrioritizedReplay.hpp"
+#include <Eigen/Dense>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace quids::rl {
 
-struct Experience {
-    ::std::vector<double> state;
-    ::std::vector<double> action;
-    double reward;
-    ::std::vector<double> next_state;
-    bool done;
-};
-
+/**
+ * @brief Actor-critic agent over a prioritized replay buffer.
+ *
+ * Every learning step samples one batch and runs it through the policy
+ * and value networks as matrices, so its cost is fixed by the batch size
+ * rather than by how many experiences arrive. update() only stores
+ * experiences and takes one step per trainInterval of them, which keeps
+ * RL-driven tuning to a bounded share of a core.
+ */
 class QuantumRLAgent {
 public:
+    struct Config {
+        ::std::size_t batchSize{64};
+        ::std::size_t replayCapacity{1 << 16};
+        ::std::size_t trainInterval{16};  ///< Experiences per learning step
+        double learningRate{0.01};
+        double discount{0.99};
+        double explorationRate{0.1};
+        double priorityAlpha{0.6};
+        double importanceBeta{0.4};
+        ::std::size_t numQubits{8};
+    };
+
     explicit QuantumRLAgent(::std::size_t state_dim, ::std::size_t action_dim);
+    QuantumRLAgent(::std::size_t state_dim, ::std::size_t action_dim, const Config& config);
     ~QuantumRLAgent();
 
+    /// One-hot action, epsilon-greedy over the policy
     ::std::vector<double> selectAction(const ::std::vector<double>& state);
+    /// One action index per state row, from a single batched forward pass
+    ::std::vector<::std::size_t> selectActions(const Eigen::MatrixXd& states);
+    [[nodiscard]] Eigen::MatrixXd actionProbabilities(const Eigen::MatrixXd& states) const;
+
     void update(const Experience& experience);
+    void update(::std::span<const Experience> experiences);
+    /// Runs `num_episodes` learning steps over the replay buffer
     void train(::std::size_t num_episodes);
+
+    /// Both networks, as `path`.policy and `path`.value
     void save(const ::std::string& path) const;
     void load(const ::std::string& path);
 
+    [[nodiscard]] ::std::size_t replaySize() const;
+    [[nodiscard]] ::std::size_t trainingSteps() const;
+
 private:
     struct Impl;
     ::std::unique_ptr<Impl> impl_;
-    ::std::vector<Experience> replay_buffer_;
     ::std::unique_ptr<neural::QuantumPolicyNetwork> policy_network_;
     ::std::unique_ptr<neural::QuantumValueNetwork> value_network_;
-    ::std::unique_ptr<quantum::QuantumCircuit> circuit_;
 
-    void updateMetrics();
-    void optimizeQuantumCircuit();
-    double computeQuantumAdvantage() const;
+    void learnStep();
 };
 
 } // namespace quids::rl
 
-#endif // QUIDS_RL_QUANTUM_RL_AGENT_HPP 
\ No newline at end of file
+#endif // QUIDS_RL_QUANTUM_RL_AGENT_HPP
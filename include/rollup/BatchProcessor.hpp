@@ -1,11 +1,15 @@
 #pragma once
 #include "blockchain/Transaction.hpp"
+#include "rollup/Mempool.hpp"
+#include "rollup/PreExecutor.hpp"
 #include "rollup/StateManager.hpp"
 #include <vector>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <atomic>
+#include "utils/AdaptiveBatchController.hpp"
+#include "utils/WorkStealingPool.hpp"
 
 namespace quids {
 namespace rollup {
@@ -16,31 +20,55 @@ public:
         size_t max_batch_size;
         std::chrono::milliseconds max_wait_time;
         size_t min_batch_size;
+        // Tune batch size and wait time live within [min_batch_size,
+        // max_batch_size] and (0, max_wait_time] to hold batch latency
+        // under latency_target
+        bool adaptive{false};
+        std::chrono::milliseconds latency_target{500};
+        // Run pending transactions in the background so batches skip the
+        // ones certain to fail and find their signatures already checked
+        bool pre_execute{false};
+        PreExecutor::Config pre_execution{};
     };
 
+    // Batches are cut from mempool, which may be shared with the API front
+    // end; a null mempool gets a private one
     explicit BatchProcessor(
         std::shared_ptr<quids::rollup::StateManager> state_manager,
-        const BatchConfig& config
+        const BatchConfig& config,
+        std::shared_ptr<Mempool> mempool = nullptr
     );
     
     ~BatchProcessor();
     
-    void submit_transaction(const quids::blockchain::Transaction& tx);
+    Mempool::AddResult submit_transaction(quids::blockchain::TransactionPtr tx);
     void process_batches();
     void stop();
     
+    // Current adaptive decisions; only meaningful with config.adaptive
+    utils::AdaptiveBatchController::Stats batch_stats() const;
+    // Null unless config.pre_execute
+    const PreExecutor* pre_executor() const { return pre_executor_.get(); }
+    
 private:
     std::shared_ptr<quids::rollup::StateManager> state_manager_;
     BatchConfig config_;
-    std::queue<quids::blockchain::Transaction> pending_transactions_;
-    std::vector<std::thread> worker_threads_;
-    bool should_stop_;
+    std::shared_ptr<Mempool> mempool_;
+    utils::AdaptiveBatchController controller_;
+    std::unique_ptr<PreExecutor> pre_executor_;
+    
+    // One thread cuts batches, the shared pool applies them
+    utils::WorkStealingPool& pool_;
+    std::thread dispatcher_;
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<bool> should_stop_;
     
+    // Only wakes the dispatcher; the mempool has its own locking
     std::mutex mutex_;
     std::condition_variable cv_;
     
     void process_batch();
-    std::vector<quids::blockchain::Transaction> create_batch();
+    std::vector<quids::blockchain::TransactionPtr> create_batch(size_t batch_size);
 };
 
 } // namespace rollup
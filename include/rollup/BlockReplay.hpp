@@ -0,0 +1,111 @@
+#pragma once
+
+#include "blockchain/Transaction.hpp"
+#include "rollup/StateManager.hpp"
+#include "rollup/StateTrie.hpp"
+#include "utils/Metrics.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace storage {
+class PersistentStorage;
+}
+
+namespace rollup {
+
+// Offline re-execution of stored blocks.
+//
+// Starting from a copy of a checkpointed state, each block is loaded,
+// verified, executed and hashed exactly as the execute and state root
+// stages of L2BlockProcessor would, with nothing sent anywhere and
+// nothing written back. With one thread transactions are applied in order
+// through StateManager; with more they go through OptimisticExecutor on
+// the shared pool, which must reach the same state. After each block the
+// root is compared with the one its stored proof commits to, so a replay
+// that drifts from what the node produced is caught at the first block
+// where it does.
+//
+// Every stage of every block is timed and recorded as a span on trace
+// aggregate_trace_id("replay", block) (Tracing.hpp). Span timestamps are
+// steady_clock, which is CLOCK_MONOTONIC on Linux, so an exported trace
+// lines up with samples from `perf record -k CLOCK_MONOTONIC`.
+class BlockReplayer {
+public:
+    struct StoredBlock {
+        uint64_t number{0};
+        std::vector<blockchain::TransactionPtr> transactions;
+        // From the block's proof; nullopt skips the check
+        std::optional<StateTrie::Hash> post_state_root;
+    };
+    // nullopt when the block is not stored
+    using BlockSource = std::function<std::optional<StoredBlock>(uint64_t number)>;
+
+    enum Stage : size_t { Load, Verify, Execute, StateRoot, NUM_STAGES };
+
+    struct Config {
+        // 1 = in order on the calling thread
+        size_t threads{1};
+        // Stop at the first block whose root differs from the stored one
+        bool stop_on_mismatch{true};
+        // Accounts kept in Report::hot_accounts
+        size_t hot_accounts{20};
+    };
+
+    struct BlockReport {
+        uint64_t number{0};
+        size_t transactions{0};
+        size_t executed{0};
+        size_t accounts_written{0};
+        // OptimisticExecutor only
+        size_t reexecutions{0};
+        std::array<std::chrono::nanoseconds, NUM_STAGES> stages{};
+        bool root_checked{false};
+        bool root_matches{false};
+    };
+
+    struct Report {
+        std::vector<BlockReport> blocks;
+        // Per-block stage times and whole-block times, in nanoseconds
+        std::array<utils::HistogramSnapshot, NUM_STAGES> stage_latency;
+        utils::HistogramSnapshot block_latency;
+        utils::HistogramSnapshot transactions_per_block;
+        utils::HistogramSnapshot accounts_per_block;  // written
+        // Accounts read or written most often over the range, most first
+        std::vector<std::pair<std::string, uint64_t>> hot_accounts;
+        // Later blocks depend on it, so the run ends at a missing block
+        std::optional<uint64_t> missing_block;
+        size_t mismatches{0};
+        std::optional<uint64_t> first_mismatch;
+        StateTrie::Hash final_root{};
+        std::chrono::nanoseconds elapsed{0};
+    };
+
+    static constexpr const char* STAGE_NAMES[NUM_STAGES] = {"load", "verify", "execute", "state_root"};
+
+    BlockReplayer(StateManager::Snapshot base, const Config& config);
+    explicit BlockReplayer(StateManager::Snapshot base);
+
+    // Replays [first, last] on a fresh copy of the base state, so calling
+    // it again measures the same work again. An open range ends at the
+    // first block the source does not have.
+    Report run(const BlockSource& source, uint64_t first, uint64_t last);
+
+    // Transactions with their proofs' post-state roots; blocks without
+    // stored transactions, body or proof count as missing
+    static BlockSource from_storage(std::shared_ptr<storage::PersistentStorage> storage);
+
+private:
+    const StateManager::Snapshot base_;
+    const Config config_;
+};
+
+} // namespace rollup
+} // namespace quids
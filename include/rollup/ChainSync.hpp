@@ -0,0 +1,186 @@
+#pragma once
+
+#include "blockchain/Transaction.hpp"
+#include "rollup/StateManager.hpp"
+#include "rollup/StateTrie.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Block header as exchanged during sync. The hash commits to every field,
+// so headers that link back to a trusted anchor are authentic whichever
+// peers they came from.
+struct SyncHeader {
+    using Hash = std::array<uint8_t, 32>;
+    static constexpr size_t ENCODED_SIZE = 8 + 3 * 32 + 4;
+
+    uint64_t height{0};
+    Hash parent{};
+    Hash tx_root{};     // MerkleBuilder root over the transaction hashes
+    Hash state_root{};  // StateTrie root after the block
+    uint32_t tx_count{0};
+
+    [[nodiscard]] Hash hash() const;
+    void encode(std::vector<uint8_t>& out) const;
+    static std::optional<SyncHeader> decode(std::span<const uint8_t> bytes);
+};
+
+// Which of `chunks` state chunks an account belongs to. Chunks split the
+// trie's key space evenly, so they come out about the same size.
+uint32_t state_chunk_of(const std::string& address, uint32_t chunks);
+
+// Answers the requests ChainSync sends, from a node's own chain and state.
+class SyncServer {
+public:
+    struct Source {
+        // nullopt past the node's tip
+        std::function<std::optional<SyncHeader>(uint64_t height)> header;
+        // The block's transactions in canonical wire encoding
+        std::function<std::optional<std::vector<blockchain::ByteVector>>(uint64_t height)> body;
+        // The state with this root, while the node still keeps it
+        std::function<std::optional<StateManager::Snapshot>(const StateTrie::Hash& root)> state;
+    };
+
+    struct Limits {
+        size_t max_headers{2048};
+        size_t max_bodies{64};
+    };
+
+    explicit SyncServer(Source source);
+    SyncServer(Source source, Limits limits);
+
+    // The reply to one request; NotFound when this node cannot serve it
+    std::vector<uint8_t> handle(std::span<const uint8_t> request);
+
+private:
+    // Addresses of one snapshot split by chunk, built on the first chunk
+    // request for its root and reused for the rest
+    struct ChunkIndex {
+        StateTrie::Hash root{};
+        uint32_t chunks{0};
+        StateManager::Snapshot snapshot;
+        std::vector<std::vector<std::string>> addresses;
+    };
+
+    std::shared_ptr<const ChunkIndex> chunk_index(const StateTrie::Hash& root, uint32_t chunks);
+
+    const Source source_;
+    const Limits limits_;
+    std::mutex index_mutex_;
+    std::shared_ptr<const ChunkIndex> index_;
+};
+
+// Brings a node from a trusted anchor to a given tip.
+//
+// Headers come first, in segments spread over every peer at once. Each
+// segment is checked on arrival and the whole run is then linked back to
+// the anchor, so a peer that serves a bad segment only costs a refetch
+// of that segment. When the tip is far enough ahead, the state at a pivot
+// below it is downloaded in chunks rather than replayed: every account
+// arrives with a proof against the pivot header's state root, and the
+// assembled trie must rebuild that root exactly. Bodies from there on
+// are fetched out of order. Each body is checked against its header's
+// transaction root and has its signatures verified on the pool as soon as
+// it lands, and blocks go to the caller in height order as the gaps fill.
+// A peer whose replies keep failing is dropped; a request that fails on
+// max_attempts peers fails the sync.
+class ChainSync {
+public:
+    using Hash = StateTrie::Hash;
+    using ResponseCallback = std::function<void(std::optional<std::vector<uint8_t>> response)>;
+    // Sends the request to peer and calls done exactly once, with nullopt
+    // on timeout or disconnect. P2PNetwork::request has this shape.
+    using Transport = std::function<void(const std::string& peer, std::vector<uint8_t> request,
+                                         ResponseCallback done)>;
+    // Verified blocks in height order; false stops the sync
+    using BlockSink = std::function<bool(const SyncHeader& header,
+                                         std::vector<blockchain::TransactionPtr>&& transactions)>;
+    // Verified accounts of one state chunk. Called concurrently; if the
+    // sync then ends in StateMismatch, what it delivered must be dropped.
+    using StateSink = std::function<void(std::vector<StateManager::Account>&& accounts)>;
+
+    struct Config {
+        size_t headers_per_request{512};
+        size_t bodies_per_request{16};
+        size_t max_inflight_per_peer{4};
+        uint32_t state_chunks{256};
+        // Sync state at this many blocks below the tip; 0 replays every block
+        uint64_t snapshot_distance{128};
+        size_t max_attempts{4};        // per request
+        size_t max_peer_failures{8};   // then the peer is dropped
+    };
+
+    struct Target {
+        uint64_t height{0};
+        Hash hash{};
+    };
+
+    enum class Status {
+        Synced,
+        NoPeers,        // every peer was dropped or a request ran out of attempts
+        BadChain,       // no peer served headers that reach the target
+        StateMismatch,  // the assembled state does not hash to the pivot's root
+        Rejected,       // the block sink refused a block
+        Stopped
+    };
+
+    struct Result {
+        Status status{Status::Synced};
+        uint64_t height{0};        // last block handed to the sink
+        uint64_t state_height{0};  // where the state came from: the pivot, or the anchor
+        size_t headers{0};
+        size_t bodies{0};
+        size_t accounts{0};
+    };
+
+    ChainSync(Config config, Transport transport,
+              utils::WorkStealingPool& pool = utils::WorkStealingPool::global());
+
+    // Blocks until the target is applied or the sync fails
+    Result run(const SyncHeader& anchor, const Target& target, const std::vector<std::string>& peers,
+               const BlockSink& blocks, const StateSink& state, std::stop_token stop = {});
+
+private:
+    struct Fetch;
+
+    using Request = std::function<std::vector<uint8_t>(size_t task)>;
+    // Runs on a pool thread; false rejects the reply and retries elsewhere
+    using Accept = std::function<bool(size_t task, const std::string& peer, std::span<const uint8_t> reply)>;
+    // Runs on the calling thread after replies land; false aborts
+    using Progress = std::function<bool()>;
+
+    // Spreads tasks [0, count) over the peers; false when one ran out of
+    // attempts, every peer was dropped, progress aborted or stop was
+    // requested. Returns only once no reply is outstanding.
+    bool fetch(size_t count, const Request& request, const Accept& accept, const Progress& progress,
+               const std::vector<std::string>& avoid, std::stop_token stop);
+
+    Status sync_headers(const SyncHeader& anchor, const Target& target, std::vector<SyncHeader>& headers,
+                        std::stop_token stop);
+    Status sync_state(const SyncHeader& pivot, const StateSink& sink, Result& result, std::stop_token stop);
+    Status sync_bodies(const std::vector<SyncHeader>& headers, size_t first, const BlockSink& sink,
+                       Result& result, std::stop_token stop);
+
+    const Config config_;
+    const Transport transport_;
+    utils::WorkStealingPool& pool_;
+
+    std::mutex peers_mutex_;
+    std::vector<std::string> peers_;
+    std::vector<size_t> inflight_;
+    std::vector<size_t> failures_;
+};
+
+} // namespace rollup
+} // namespace quids
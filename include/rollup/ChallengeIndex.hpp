@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace storage {
+class PersistentStorage;
+}
+
+namespace rollup {
+
+// Optimistic commitments whose challenge window is still open.
+//
+// Commitments are keyed by post-state root in a hash map, so find() and
+// challenge() are O(1). Expiry runs on a hierarchical timer wheel of
+// LEVELS levels with SLOTS slots each, in ticks of Config::tick. The wheel
+// spans SLOTS^LEVELS ticks, about 194 days at one second. advance() costs
+// one step per elapsed tick plus one per commitment finalized or moved
+// down a level, and never touches the others, so it costs the same with
+// ten windows pending or ten million. Everything that closes in one
+// advance() reaches the finalizer as one batch, in window order.
+//
+// A challenged commitment is skipped when its window closes. resolve()
+// either drops it (fraud shown) or puts it back, finalizing at the next
+// advance() if its window has passed.
+//
+// Each commitment is also stored under a key ordered by window end, so
+// the constructor rebuilds the wheel from storage after a restart.
+// Finalized commitments are deleted in one batch after the finalizer
+// returns. A crash in between finalizes them again after the restart, so
+// the finalizer must tolerate repeats.
+class ChallengeIndex {
+public:
+    using Root = std::array<uint8_t, 32>;
+    using Clock = std::chrono::system_clock;
+
+    enum class Status : uint8_t { Pending = 0, Challenged = 1 };
+
+    struct Commitment {
+        uint64_t batch_number{0};
+        Root pre_state_root{};
+        Root post_state_root{};
+        Root batch_hash{};
+        Clock::time_point window_end;
+        Status status{Status::Pending};
+    };
+
+    using Finalizer = std::function<void(const std::vector<Commitment>& closed)>;
+
+    struct Config {
+        std::chrono::milliseconds tick{1000};
+        bool sync_writes{true};
+    };
+
+    static constexpr size_t LEVEL_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << LEVEL_BITS;
+    static constexpr size_t LEVELS = 4;
+
+    ChallengeIndex(std::shared_ptr<storage::PersistentStorage> storage, const Config& config, Finalizer finalizer);
+    ChallengeIndex(std::shared_ptr<storage::PersistentStorage> storage, Finalizer finalizer);
+
+    ChallengeIndex(const ChallengeIndex&) = delete;
+    ChallengeIndex& operator=(const ChallengeIndex&) = delete;
+
+    // Indexed by post_state_root, so the status given is ignored. False if
+    // the root is already pending or the write failed.
+    bool add(const Commitment& commitment);
+
+    [[nodiscard]] std::optional<Commitment> find(const Root& post_state_root) const;
+
+    // False unless the commitment is pending
+    bool challenge(const Root& post_state_root);
+    // Settles a challenge: a commitment shown fraudulent is dropped, any
+    // other goes back to pending. False unless it was challenged.
+    bool resolve(const Root& post_state_root, bool fraud_shown);
+
+    // Finalizes the pending commitments whose windows closed by now, at
+    // most one tick late; returns how many
+    size_t advance(Clock::time_point now);
+
+    [[nodiscard]] size_t size() const;
+
+private:
+    struct Entry {
+        Commitment commitment;
+        uint64_t expiry{0};  // tick
+    };
+    // Wheel slots hold the root and the expiry it was filed under, so a
+    // root dropped and added again ignores the old one
+    using Timer = std::pair<Root, uint64_t>;
+
+    struct RootHash {
+        size_t operator()(const Root& root) const noexcept;
+    };
+
+    // Caller holds mutex_
+    uint64_t tick_of(Clock::time_point t, bool round_up) const;
+    void schedule(const Root& root, uint64_t expiry);
+    void cascade(size_t level);
+    void expire(const Timer& timer, std::vector<Commitment>& closed);
+    bool persist(const Commitment& commitment);
+    void resume();
+    std::string key_of(const Commitment& commitment) const;
+
+    std::shared_ptr<storage::PersistentStorage> storage_;
+    const Config config_;
+    Finalizer finalizer_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Root, Entry, RootHash> entries_;
+    std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> wheel_;
+    // Expired before they were filed, e.g. added late or resolved late
+    std::vector<Timer> due_;
+    size_t filed_{0};  // timers in wheel_
+    uint64_t current_{0};
+};
+
+} // namespace rollup
+} // namespace quids
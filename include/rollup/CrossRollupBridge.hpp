@@ -2,26 +2,143 @@
 #include <vector>
 #include <array>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include "crypto/blake3/MerkleBuilder.hpp"
 #include "zkp/QZKPGenerator.hpp"
 
 namespace quids {
 namespace rollup {
 
+// Relays messages between rollups in batches.
+//
+// Outgoing messages are numbered per destination and folded into that
+// destination's Merkle tree. A sealed batch carries one validity proof for
+// its root, and each message travels with an inclusion path to it, so the
+// proving cost is paid per batch rather than per message. The receiving
+// side checks a batch proof once, then each message with O(log n) hashes.
+// Replays are caught by per-source nonce windows that stay small however
+// many messages have been delivered.
 class CrossRollupBridge {
 public:
+    using Hash = std::array<uint8_t, 32>;
+    using Proof = quids::zkp::QZKPGenerator::Proof;
+
     struct CrossRollupMessage {
         uint32_t source_chain_id;
         uint32_t destination_chain_id;
         std::vector<uint8_t> payload;
+        // Batches are proven as a whole; kept for existing callers
         quids::zkp::QZKPGenerator::Proof validity_proof;
+        // Assigned by send_message(), per source and destination
+        uint64_t nonce{0};
+    };
+
+    struct BatchHeader {
+        uint32_t source_chain_id{0};
+        uint32_t destination_chain_id{0};
+        uint64_t batch_number{0};
+        uint64_t first_nonce{0};
+        uint64_t message_count{0};
+        Hash root{};
+        Proof validity_proof;
+    };
+
+    // What the relay carries to the destination
+    struct SealedBatch {
+        BatchHeader header;
+        std::vector<CrossRollupMessage> messages;
+        // inclusion[i] opens header.root to messages[i]
+        std::vector<quids::crypto::MerkleProof> inclusion;
+    };
+
+    struct MessageProof {
+        uint64_t batch_number{0};
+        quids::crypto::MerkleProof path;
+    };
+
+    using BatchProver = std::function<Proof(const BatchHeader& header)>;
+    using BatchVerifier = std::function<bool(const BatchHeader& header)>;
+
+    struct Config {
+        // A destination's batch seals itself at this many messages
+        size_t max_batch_size{1024};
     };
-    
-    void send_message(const CrossRollupMessage& message);
+
+    // Without a prover batches go out unproven; without a verifier their
+    // proofs are not checked
+    CrossRollupBridge();
+    CrossRollupBridge(const Config& config, BatchProver prover, BatchVerifier verifier);
+
+    // Queues the message for its destination's next batch and returns the
+    // nonce it was given
+    uint64_t send_message(const CrossRollupMessage& message);
+    // True for a message this bridge sent
     bool verify_incoming_message(const CrossRollupMessage& message);
-    
+
+    // Seals every destination's open batch
+    void seal();
+    // Sealed batches in order, for the relay
+    std::vector<SealedBatch> take_sealed();
+
+    // Trusts a batch root once its proof checks out
+    bool accept_batch(const BatchHeader& header);
+    // False unless the message is in an accepted batch from its source and
+    // has not been delivered before
+    bool receive_message(const CrossRollupMessage& message, const MessageProof& proof);
+
+    static Hash message_hash(const CrossRollupMessage& message);
+
 private:
-    std::vector<std::array<uint8_t, 32>> message_hashes_;
+    struct HashHasher {
+        size_t operator()(const Hash& h) const noexcept {
+            size_t v = 0;
+            for (size_t i = 0; i < sizeof(v); ++i) {
+                v = (v << 8) | h[i];  // already uniformly distributed
+            }
+            return v;
+        }
+    };
+
+    struct Outbound {
+        uint64_t next_nonce{0};
+        uint64_t next_batch{0};
+        std::vector<CrossRollupMessage> pending;
+    };
+
+    // Every nonce below next is delivered; above it, only those listed
+    struct Inbound {
+        uint64_t next{0};
+        std::unordered_set<uint64_t> delivered;
+        std::map<uint64_t, Hash> roots;  // by batch number
+    };
+
+    static uint64_t stream(uint32_t source, uint32_t destination) {
+        return (static_cast<uint64_t>(source) << 32) | destination;
+    }
+    // Caller holds mutex_
+    SealedBatch cut(uint64_t key, Outbound& outbound);
+    // Proves and publishes; called without mutex_
+    void finish(std::vector<SealedBatch>&& batches);
+
+    const Config config_;
+    BatchProver prover_;
+    BatchVerifier verifier_;
+
+    // Held from cutting a batch to publishing it, so each stream's batches
+    // come out in order
+    std::mutex seal_mutex_;
+    std::mutex mutex_;
+    // Both keyed by stream()
+    std::unordered_map<uint64_t, Outbound> outbound_;
+    std::unordered_map<uint64_t, Inbound> inbound_;
+    std::unordered_set<Hash, HashHasher> message_hashes_;
+    std::deque<SealedBatch> sealed_;
 };
 
 } // namespace rollup
-} // namespace quids 
\ No newline at end of file
+} // namespace quids
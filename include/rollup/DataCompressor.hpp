@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <span>
 #include <string>
 #include <vector>
@@ -8,21 +10,49 @@
 namespace quids {
 namespace rollup {
 
+// The fields of a transaction that are posted to L1, in a form that can
+// be decoded without the (abstract) Transaction hierarchy
+struct TransactionRecord {
+    std::string sender;
+    std::string recipient;
+    uint64_t nonce{0};
+    uint64_t value{0};
+    uint64_t gas_cost{0};
+    int64_t timestamp_us{0};  // microseconds since the epoch
+    std::array<uint8_t, 32> signature{};
+    std::vector<uint8_t> data;
+
+    static TransactionRecord from(const quids::blockchain::Transaction& tx);
+    bool operator==(const TransactionRecord&) const = default;
+};
+
 struct CompressedBatch {
     std::string compressed_data;
-    size_t original_size;
+    size_t original_size;  // column bytes before entropy coding
 };
 
+// Columnar batch codec.
+//
+// A batch is split into columns that are each encoded for what they hold:
+// addresses go into a per-batch table and are referenced by index, nonces
+// are deltas against the sender's previous nonce, timestamps are deltas
+// against the previous transaction, amounts and lengths are varints and
+// signatures are stored raw. Every column is then ZSTD-compressed on its
+// own and kept raw when that does not help. The layout is fixed-endian
+// and pointer-free, so any verifier can decode it.
 class DataCompressor {
 public:
-    static CompressedBatch compress_batch(std::span<const quids::blockchain::Transaction> transactions);
+    static constexpr int DEFAULT_LEVEL = 3;
 
-    static std::vector<quids::blockchain::Transaction> decompress_batch(const CompressedBatch& compressed);
+    static CompressedBatch compress_batch(std::span<const TransactionRecord> transactions,
+                                          int level = DEFAULT_LEVEL);
+    static CompressedBatch compress_batch(std::span<const quids::blockchain::Transaction* const> transactions,
+                                          int level = DEFAULT_LEVEL);
 
-private:
-    static std::string compress_transaction(const quids::blockchain::Transaction& tx);
-    static quids::blockchain::Transaction decompress_transaction(const std::string& compressed_tx);
+    // Throws std::runtime_error on malformed input
+    static std::vector<TransactionRecord> decompress_batch(std::span<const uint8_t> compressed);
+    static std::vector<TransactionRecord> decompress_batch(const CompressedBatch& compressed);
 };
 
 } // namespace rollup
-} // namespace quids 
\ No newline at end of file
+} // namespace quids
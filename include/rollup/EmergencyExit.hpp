@@ -1,10 +1,17 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
-#include "quantum/QuantumState.hpp"
 #include "rollup/StateManager.hpp"
+#include "rollup/StateTrie.hpp"
 
 namespace quids {
 namespace rollup {
@@ -14,20 +21,74 @@ struct EmergencyProof {
     std::vector<uint8_t> signature;
     uint64_t timestamp;
     std::vector<uint8_t> state_root;
+    // Membership of the account in the trie committed to by state_root
+    StateTrie::Proof account_proof;
 };
 
+// Lets accounts leave the rollup with a proof of their balance.
+//
+// A checkpoint freezes a snapshot of the state and builds every account's
+// exit witness from it in the background, so when users rush to exit at
+// once their proofs are lookups rather than trie walks. process_exits()
+// checks a whole batch against the checkpoint's one root in parallel and
+// applies the accepted exits together.
 class EmergencyExit {
 public:
     explicit EmergencyExit(std::shared_ptr<StateManager> state_manager);
-    ~EmergencyExit() = default;
+    ~EmergencyExit();
 
+    EmergencyExit(const EmergencyExit&) = delete;
+    EmergencyExit& operator=(const EmergencyExit&) = delete;
+
+    // Against the live state root
     bool verify_proof(const EmergencyProof& proof);
     bool process_exit(const EmergencyProof& proof);
+    // The precomputed witness when the latest checkpoint has one
     EmergencyProof generate_proof(const std::string& account_address);
 
+    // Snapshots the state and builds every account's witness; returns the
+    // checkpoint's root
+    std::vector<uint8_t> checkpoint();
+    // Takes a checkpoint every `interval` on a background thread
+    void start(std::chrono::milliseconds interval);
+    void stop();
+    // Empty before the first checkpoint
+    std::vector<uint8_t> checkpoint_root() const;
+
+    // Verifies every proof against the latest checkpoint's root, taking one
+    // first if there is none, and exits the accounts that pass. An account
+    // exits at most once. Returns which proofs were accepted.
+    std::vector<bool> process_exits(std::span<const EmergencyProof> proofs);
+
 private:
-    quantum::QuantumState encode_state(uint64_t balance, uint64_t nonce);
+    struct Checkpoint {
+        StateManager::Snapshot snapshot;
+        std::vector<uint8_t> root;
+        std::unordered_map<std::string, EmergencyProof> witnesses;
+    };
+
+    std::shared_ptr<const Checkpoint> latest() const;
+    bool verify_against(const EmergencyProof& proof, const StateManager::Snapshot& snapshot,
+                        const std::vector<uint8_t>& root) const;
+    bool apply_exit(const std::string& account_address);
+
+    // Signed over address, timestamp and root
+    static std::vector<uint8_t> exit_message(const std::string& account_address, uint64_t timestamp,
+                                             const std::vector<uint8_t>& state_root);
+    static uint64_t now();
+
     std::shared_ptr<StateManager> state_manager_;
+
+    mutable std::mutex mutex_;
+    std::shared_ptr<const Checkpoint> checkpoint_;
+    // Held while exits are applied, so an account cannot pass twice in
+    // racing batches
+    std::mutex exit_mutex_;
+    std::unordered_set<std::string> exited_;
+
+    std::condition_variable cv_;
+    bool stopping_{false};
+    std::thread worker_;
 };
 
 } // namespace rollup
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
+#include <utility>
+#include <vector>
+#include "rollup/MEVProtection.hpp"
+
+namespace quids {
+namespace rollup {
+
+// Threshold ElGamal over P-256 with a ChaCha20-Poly1305 payload.
+//
+// Each epoch has a key pair whose secret is Shamir-shared among the
+// validators. Users encrypt to the epoch's public key; once `threshold`
+// validators release their shares the secret is rebuilt once and every
+// ciphertext of the epoch opens locally. Releasing a share gives the epoch
+// secret away, so an epoch key opens exactly one batch.
+class ThresholdCipher {
+public:
+    static constexpr size_t POINT_SIZE = 33;  // compressed
+    static constexpr size_t SCALAR_SIZE = 32;
+    static constexpr size_t TAG_SIZE = 16;
+
+    using Point = std::array<uint8_t, POINT_SIZE>;
+    using Scalar = std::array<uint8_t, SCALAR_SIZE>;
+    using Hash = std::array<uint8_t, 32>;
+
+    struct EpochKey {
+        uint64_t epoch{0};
+        size_t threshold{0};
+        Point public_key{};
+        // public_shares[i] belongs to validator i + 1
+        std::vector<Point> public_shares;
+    };
+
+    // Validator `index`'s share of the epoch secret, 1-based
+    struct SecretShare {
+        uint32_t index{0};
+        Scalar value{};
+    };
+
+    struct Ciphertext {
+        uint64_t epoch{0};
+        Point ephemeral{};
+        std::vector<uint8_t> body;
+        std::array<uint8_t, TAG_SIZE> tag{};
+
+        [[nodiscard]] Hash id() const;
+    };
+
+    // Trusted-dealer setup; a DKG produces the same shapes
+    static std::pair<EpochKey, std::vector<SecretShare>> deal(uint64_t epoch, size_t threshold,
+                                                              size_t validators);
+
+    static Ciphertext encrypt(const EpochKey& key, std::span<const uint8_t> plaintext);
+
+    // The share matches its validator's public share
+    static bool verify_share(const EpochKey& key, const SecretShare& share);
+    // Interpolates the first `threshold` distinct shares and checks the
+    // result against the public key. Shares must already be verified.
+    static std::optional<Scalar> combine(const EpochKey& key, std::span<const SecretShare> shares);
+    // Nullopt when the ciphertext does not authenticate
+    static std::optional<std::vector<uint8_t>> decrypt(const Scalar& secret, const Ciphertext& ciphertext);
+};
+
+// Commit-reveal mempool for one epoch.
+//
+// Transactions arrive encrypted and are sequenced blind; commit() fixes the
+// order before anyone can read them. Validators then release their shares,
+// which are checked in parallel, and decrypt_batch() opens the whole batch
+// at once in the committed order. Nothing is decrypted per transaction
+// while it waits, so there is nothing to front-run.
+class EncryptedMempool {
+public:
+    using Payload = std::optional<std::vector<uint8_t>>;
+
+    explicit EncryptedMempool(ThresholdCipher::EpochKey key);
+
+    // False once committed, for another epoch, or already queued
+    bool submit(ThresholdCipher::Ciphertext ciphertext);
+    // Over the epoch and the ciphertext ids in order; later calls return
+    // the same commitment
+    MEVProtection::OrderingCommitment commit();
+
+    // Returns how many of `shares` were valid and new. Throws
+    // std::logic_error before commit().
+    size_t add_shares(std::span<const ThresholdCipher::SecretShare> shares);
+    [[nodiscard]] bool ready() const;
+
+    // One payload per committed ciphertext, nullopt where it fails to
+    // authenticate. Throws std::logic_error until ready().
+    std::vector<Payload> decrypt_batch();
+
+    [[nodiscard]] std::vector<ThresholdCipher::Ciphertext> ordering() const;
+    [[nodiscard]] uint64_t epoch() const { return key_.epoch; }
+    [[nodiscard]] size_t size() const;
+
+private:
+    const ThresholdCipher::EpochKey key_;
+
+    mutable std::mutex mutex_;
+    std::vector<ThresholdCipher::Ciphertext> ciphertexts_;
+    std::set<ThresholdCipher::Hash> ids_;
+    std::optional<MEVProtection::OrderingCommitment> commitment_;
+    std::map<uint32_t, ThresholdCipher::SecretShare> shares_;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <chrono>
 #include <memory>
 #include <utility>
 #include <Eigen/Dense>
@@ -79,9 +80,24 @@ public:
 
     // Model management
     void update_model(const std::vector<double>& new_data);
+    // A storage::TensorCheckpoint, renamed into place so a crash mid-save
+    // leaves the previous one intact
     void save_model(const std::string& path) const;
+    // Maps the checkpoint and infers straight from it until the next
+    // training step; the swap is atomic for concurrent inference. False if
+    // the file is missing, corrupt or for another architecture.
     bool load_model(const std::string& path);
 
+    // Online training. observe() records a snapshot and the parameters it
+    // ran under in a bounded feature store; train_incremental() takes Adam
+    // steps over only the samples observed since its last call and returns
+    // how many it used.
+    void observe(const RollupPerformanceMetrics& metrics, const QuantumParameters& params);
+    size_t train_incremental();
+    // Calls save_model(path) every `interval` while the model keeps changing
+    void start_checkpoints(const std::string& path, std::chrono::milliseconds interval);
+    void stop_checkpoints();
+
     // Configuration
     void set_learning_rate(double rate);
     void set_batch_size(size_t size);
@@ -127,7 +143,13 @@ public:
         const Eigen::VectorXd& prediction
     ) const;
 
+    // Raw engineered features in, decoded by optimize_quantum_parameters()
     [[nodiscard]] Eigen::VectorXd forward_pass(const Eigen::VectorXd& features) const;
+    // One row of outputs per sample, all through the same GEMMs
+    [[nodiscard]] Eigen::MatrixXf predict_batch(const std::vector<RollupPerformanceMetrics>& metrics) const;
+    // int8 weights and activations with int32 accumulation; training
+    // stays in float32 and requantizes after each run
+    void set_quantized_inference(bool enabled);
 
     void optimize_chain_parameters(const std::vector<QuantumParameters>& chain_params);
 
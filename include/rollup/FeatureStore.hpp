@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <Eigen/Dense>
+#include "memory/MemoryBudget.hpp"
+
+namespace quids {
+namespace rollup {
+
+// Bounded ring buffer of training samples.
+//
+// Models push one (features, targets) row per observed metrics snapshot
+// and read back only the rows added since their last step, so online
+// training costs O(new samples) and memory stays at `capacity` rows no
+// matter how long the node runs. Rows are contiguous, and a read copies a
+// ready-made batch matrix.
+class FeatureStore {
+public:
+    using Matrix = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    FeatureStore(size_t capacity, Eigen::Index feature_dim, Eigen::Index target_dim);
+
+    // Overwrites the oldest sample once full
+    void push(const Eigen::Ref<const Eigen::RowVectorXf>& features,
+              const Eigen::Ref<const Eigen::RowVectorXf>& targets);
+
+    // Copies the samples pushed after `cursor` that are still held, oldest
+    // first, and returns the cursor to pass next time. Samples overwritten
+    // before they were read are skipped.
+    uint64_t read_since(uint64_t cursor, Matrix& features, Matrix& targets) const;
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t capacity() const { return capacity_; }
+    // Samples ever pushed
+    [[nodiscard]] uint64_t total() const;
+
+private:
+    const size_t capacity_;
+
+    mutable std::mutex mutex_;
+    Matrix features_;
+    Matrix targets_;
+    memory::MemoryCharge charge_;
+    uint64_t total_{0};
+};
+
+} // namespace rollup
+} // namespace quids
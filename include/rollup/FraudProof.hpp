@@ -1,8 +1,16 @@
 #pragma once
 #include "StateManager.hpp"
+#include "StateWitness.hpp"
+#include "blockchain/Transaction.hpp"
 #include "zkp/QZKPGenerator.hpp"
 #include "quantum/QuantumState.hpp"
+#include <array>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace quids {
 namespace rollup {
@@ -26,7 +34,7 @@ public:
     struct InvalidTransitionProof {
         std::array<uint8_t, 32> pre_state_root;
         std::array<uint8_t, 32> post_state_root;
-        std::vector<quids::blockchain::Transaction> transactions;
+        std::vector<quids::blockchain::TransactionPtr> transactions;
         StateProof state_proof;
         quids::zkp::QZKPGenerator::Proof validity_proof;
     };
@@ -36,18 +44,118 @@ public:
         std::string message;
     };
     
+    using Hash = std::array<uint8_t, 32>;
+    using Writes = std::vector<std::pair<std::string, quids::rollup::StateManager::Account>>;
+
+    // What the asserter says the state is after the first `index`
+    // transactions of a batch: its root, and every account written since the
+    // batch started. The writes let the state be rebuilt from the batch's
+    // pre-state and checked against the root without executing anything.
+    struct StateClaim {
+        size_t index{0};
+        Hash root{};
+        Writes writes;
+    };
+
+    // Takes claims as they are produced; returning false stops the trace
+    using ClaimSink = std::function<bool(StateClaim&& claim)>;
+
+    // Interactive dispute over one batch. Both sides start agreeing on the
+    // pre-state and disagreeing on the asserted result. Each round the
+    // asserter commits to the state at midpoint() and the challenger accepts
+    // or rejects it, halving the range, until a single transaction is left
+    // for verify_step().
+    class Bisection {
+    public:
+        Bisection(StateClaim agreed, StateClaim disputed);
+
+        [[nodiscard]] bool resolved() const { return disputed_.index - agreed_.index <= 1; }
+        [[nodiscard]] size_t midpoint() const;
+        // `claim` must be at midpoint(). Throws std::logic_error once resolved.
+        void respond(StateClaim claim, bool challenger_agrees);
+
+        [[nodiscard]] const StateClaim& agreed() const { return agreed_; }
+        [[nodiscard]] const StateClaim& disputed() const { return disputed_; }
+        [[nodiscard]] size_t rounds() const { return rounds_; }
+
+    private:
+        StateClaim agreed_;
+        StateClaim disputed_;
+        size_t rounds_{0};
+    };
+
     FraudProof(std::shared_ptr<quids::zkp::QZKPGenerator> zkp_generator)
         : zkp_generator_(zkp_generator) {}
     
     InvalidTransitionProof generate_fraud_proof(
         std::unique_ptr<quids::rollup::StateManager> pre_state,
         std::unique_ptr<quids::rollup::StateManager> post_state,
-        const std::vector<quids::blockchain::Transaction>& transactions
+        const std::vector<quids::blockchain::TransactionPtr>& transactions
     );
     
     FraudVerificationResult verify_fraud_proof(
         const InvalidTransitionProof& proof
     );
+
+    // The state before any transaction of a batch
+    static StateClaim initial_claim(const quids::rollup::StateManager& pre_state);
+
+    // Executes `transactions` on a copy-on-write clone of `pre_state`,
+    // emitting a claim every `stride` transactions and after the last one.
+    // Transactions that fail to apply leave the state as it was. Challengers
+    // stream their roots from here; asserters answer rounds from it.
+    static void trace(
+        const quids::rollup::StateManager& pre_state,
+        const std::vector<quids::blockchain::TransactionPtr>& transactions,
+        size_t stride,
+        const ClaimSink& sink
+    );
+
+    // True when `claim`'s writes over `pre_state` hash to its root
+    static bool consistent(const quids::rollup::StateManager& pre_state, const StateClaim& claim);
+    // The state `claim` describes, sharing nodes with `pre_state`
+    static std::unique_ptr<quids::rollup::StateManager> materialize(
+        const quids::rollup::StateManager& pre_state,
+        const StateClaim& claim
+    );
+
+    // Re-executes the segments between consecutive `checkpoints` in
+    // parallel, each from its own materialized start, and returns the first
+    // one whose end claim is wrong. The last checkpoint must cover every
+    // transaction. Segment i runs from checkpoints[i-1] (the pre-state for
+    // i = 0) to checkpoints[i].
+    static std::optional<size_t> find_divergent_segment(
+        const quids::rollup::StateManager& pre_state,
+        const std::vector<quids::blockchain::TransactionPtr>& transactions,
+        const std::vector<StateClaim>& checkpoints
+    );
+
+    // Settles a resolved bisection by applying the one disputed transaction
+    // to the agreed state. is_valid means fraud was shown: the asserter's
+    // agreed claim was inconsistent, or its disputed root was wrong.
+    static FraudVerificationResult verify_step(
+        const quids::rollup::StateManager& pre_state,
+        const std::vector<quids::blockchain::TransactionPtr>& transactions,
+        const Bisection& game
+    );
+
+    // The accounts verify_step() touches, proven against `pre_state`: all
+    // a challenger without the state needs to settle the same game
+    static StateWitness witness_step(
+        const quids::rollup::StateManager& pre_state,
+        const std::vector<quids::blockchain::TransactionPtr>& transactions,
+        const Bisection& game
+    );
+    // verify_step() on the state `witness` proves. Throws
+    // std::invalid_argument unless it opens to `pre_root`, the root the
+    // batch is agreed to start from, and std::out_of_range when the step
+    // touches an account it leaves out.
+    static FraudVerificationResult verify_step(
+        const StateWitness& witness,
+        const Hash& pre_root,
+        const std::vector<quids::blockchain::TransactionPtr>& transactions,
+        const Bisection& game
+    );
     
 private:
     std::shared_ptr<quids::zkp::QZKPGenerator> zkp_generator_;
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "storage/PersistentStorage.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Writes the account-history index behind the apply path.
+//
+// StateManager hands over each committed block's references and returns
+// at once; a background writer coalesces everything queued into one
+// WriteBatch, the way StateStore flushes state. Queries read what is on
+// disk, so an entry becomes visible once its block is written; flush()
+// first for read-your-writes.
+class HistoryIndexer {
+public:
+    using Ref = storage::PersistentStorage::HistoryRef;
+    using Query = storage::PersistentStorage::HistoryQuery;
+    using Cursor = std::pair<uint64_t, uint32_t>;
+
+    struct Config {
+        size_t max_queued_blocks{4096};  // enqueue() waits beyond this
+        bool sync_writes{false};         // the index can be rebuilt, state cannot
+    };
+
+    struct Page {
+        std::vector<Ref> entries;
+        std::optional<Cursor> next;  // pass as Query::after for the next page
+    };
+
+    struct Stats {
+        uint64_t indexed_blocks{0};
+        uint64_t indexed_refs{0};
+        uint64_t flushed_batches{0};
+        uint64_t failed_flushes{0};
+    };
+
+    HistoryIndexer(std::shared_ptr<storage::PersistentStorage> storage, const Config& config);
+    explicit HistoryIndexer(std::shared_ptr<storage::PersistentStorage> storage);
+    ~HistoryIndexer();
+
+    HistoryIndexer(const HistoryIndexer&) = delete;
+    HistoryIndexer& operator=(const HistoryIndexer&) = delete;
+
+    // References of one block
+    void enqueue(std::vector<Ref> refs);
+    // Blocks until everything queued so far is written
+    bool flush();
+
+    [[nodiscard]] Page query(const std::string& address, const Query& query) const;
+
+    Stats stats() const;
+
+private:
+    static constexpr auto RETRY_DELAY = std::chrono::milliseconds(100);
+
+    void writer_loop();
+
+    std::shared_ptr<storage::PersistentStorage> storage_;
+    Config config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::deque<std::vector<Ref>> queue_;
+    uint64_t queued_seq_{0};
+    uint64_t flushed_seq_{0};
+    bool stop_{false};
+    Stats stats_;
+
+    std::thread writer_;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rollup/L2BlockProcessor.hpp"
+#include "rollup/ProofAggregator.hpp"
+#include "storage/PersistentStorage.hpp"
+
+namespace quids {
+namespace rollup {
+
+// Posts L2 blocks to L1 several at a time.
+//
+// Queued blocks are sealed into a frame once they fill the byte budget or
+// the oldest has waited max_delay. A frame holds each block's compressed
+// transactions and roots, plus one 52-byte aggregate of all their proofs,
+// so the fixed cost of an L1 transaction and of proof verification is
+// shared by every block in it. Each frame goes out as calldata or as
+// blobs, whichever the current fee quote makes cheaper.
+//
+// A sealed frame is written to an outbox in PersistentStorage before it is
+// sent, and is removed only once L1 includes it. After a restart the
+// outbox is resumed: the transactions already sent are checked rather than
+// posted again. A worker polls everything in flight. A transaction still
+// pending after replace_after is sent again at the same nonce with bumped
+// fees.
+class L1Batcher {
+public:
+    using Hash = std::array<uint8_t, 32>;
+
+    enum class Posting : uint8_t { Calldata = 0, Blob = 1 };
+    enum class TxStatus { Pending, Included, Dropped };
+
+    // Per unit of gas and of blob gas
+    struct Fees {
+        uint64_t base_fee{0};
+        uint64_t priority_fee{0};
+        uint64_t blob_base_fee{0};
+    };
+
+    struct L1Transaction {
+        uint64_t nonce{0};
+        Posting posting{Posting::Calldata};
+        // Calldata, or whole blobs back to back
+        std::vector<uint8_t> payload;
+        uint64_t max_fee{0};
+        uint64_t priority_fee{0};
+        uint64_t max_blob_fee{0};
+    };
+
+    // L1 access. Calls may block, and throw on transport errors.
+    class Client {
+    public:
+        virtual ~Client() = default;
+        virtual Fees fees() = 0;
+        virtual uint64_t next_nonce() = 0;
+        // Returns the transaction id
+        virtual std::string send(const L1Transaction& tx) = 0;
+        virtual TxStatus status(const std::string& tx_id) = 0;
+    };
+
+    static constexpr size_t FIELD_ELEMENTS_PER_BLOB = 4096;
+    static constexpr size_t BLOB_SIZE = FIELD_ELEMENTS_PER_BLOB * 32;
+    // The top byte of every field element stays zero so it is always
+    // below the BLS12-381 modulus
+    static constexpr size_t USABLE_BYTES_PER_ELEMENT = 31;
+    static constexpr size_t BLOB_CAPACITY = FIELD_ELEMENTS_PER_BLOB * USABLE_BYTES_PER_ELEMENT;
+    static constexpr uint64_t BLOB_GAS_PER_BLOB = 1 << 17;
+    static constexpr uint64_t TX_BASE_GAS = 21000;
+
+    struct Config {
+        // Frame bytes to aim for; three blobs by default
+        size_t byte_budget{3 * BLOB_CAPACITY - 4};
+        size_t max_blobs{6};
+        std::chrono::milliseconds max_delay{12000};
+        std::chrono::milliseconds poll_interval{1000};
+        std::chrono::milliseconds replace_after{36000};
+        // Per replacement; L1 nodes want at least a 10% bump
+        double fee_bump{1.125};
+        uint64_t max_fee_cap{UINT64_MAX / 4};
+        size_t max_in_flight{4};
+        // Unset: the cheaper of the two for each frame
+        std::optional<Posting> posting;
+    };
+
+    struct Metrics {
+        size_t queued_blocks{0};
+        size_t in_flight{0};
+        uint64_t frames_sent{0};
+        uint64_t frames_confirmed{0};
+        uint64_t replacements{0};
+        uint64_t send_failures{0};
+        uint64_t transactions_posted{0};
+        uint64_t bytes_posted{0};
+    };
+
+    struct BlockEntry {
+        uint64_t block_number{0};
+        Hash state_root{};
+        Hash block_hash{};
+        uint32_t transaction_count{0};
+        // DataCompressor encoding of the transactions
+        std::vector<uint8_t> data;
+
+        [[nodiscard]] size_t encoded_size() const { return 8 + 32 + 32 + 4 + 4 + data.size(); }
+    };
+
+    // What one L1 transaction carries
+    struct Frame {
+        ProofAggregator::Aggregate proofs;
+        std::vector<BlockEntry> blocks;
+
+        [[nodiscard]] std::vector<uint8_t> encode() const;
+        // Throws std::invalid_argument on a malformed encoding
+        static Frame decode(std::span<const uint8_t> bytes);
+    };
+
+    L1Batcher(std::shared_ptr<Client> client, std::shared_ptr<storage::PersistentStorage> storage,
+              const Config& config);
+    L1Batcher(std::shared_ptr<Client> client, std::shared_ptr<storage::PersistentStorage> storage);
+    ~L1Batcher();
+
+    L1Batcher(const L1Batcher&) = delete;
+    L1Batcher& operator=(const L1Batcher&) = delete;
+
+    // Queues a finished block. False for a failed block, or one already in
+    // the outbox or on L1.
+    bool add_block(const L2BlockProcessor::L2Block& block);
+    // Seals what is queued without waiting for the budget or max_delay
+    void flush();
+    // Seals what is queued into the outbox without sending it; frames in
+    // flight stay there for the next start
+    void stop();
+
+    // Blocks below this are included on L1
+    [[nodiscard]] uint64_t confirmed_height() const;
+    // Lowest block add_block() still takes. Blocks queued but not sealed
+    // are not durable, so after a crash the producer replays from here.
+    [[nodiscard]] uint64_t next_block() const;
+    [[nodiscard]] Metrics metrics() const;
+    // 1 once every in-flight slot is taken and another full frame is
+    // queued behind them, for admission control upstream
+    [[nodiscard]] double utilization() const;
+
+    // Length-prefixed bytes spread over whole blobs
+    static std::vector<uint8_t> encode_blobs(std::span<const uint8_t> bytes);
+    // Throws std::invalid_argument on a malformed encoding
+    static std::vector<uint8_t> decode_blobs(std::span<const uint8_t> blobs);
+    static uint64_t calldata_gas(std::span<const uint8_t> bytes);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Queued {
+        BlockEntry entry;
+        zkp::QZKPGenerator::Proof proof;
+        Clock::time_point added;
+    };
+
+    // One frame from sealing until inclusion
+    struct Outbound {
+        uint64_t first_block{0};
+        uint64_t end_block{0};  // one past the last
+        uint64_t transaction_count{0};
+        std::vector<uint8_t> frame;
+        // Payload and posting are fixed by the first send
+        L1Transaction tx;
+        std::vector<std::string> sent;  // every id tried at this nonce
+        Clock::time_point last_sent{};
+
+        [[nodiscard]] std::vector<uint8_t> serialize() const;
+        static Outbound deserialize(std::span<const uint8_t> bytes);
+    };
+
+    void workerLoop();
+    void resume();
+    // Worker only
+    bool sealFrame(bool force);
+    // Returns how many frames it confirmed off the front
+    size_t advance(size_t index);
+    void sendFrame(Outbound& frame, bool replace);
+    void confirmThrough(size_t index);
+    bool persist(const Outbound& frame);
+    L1Transaction buildTransaction(const std::vector<uint8_t>& frame, const Fees& fees) const;
+
+    std::shared_ptr<Client> client_;
+    std::shared_ptr<storage::PersistentStorage> storage_;
+    const Config config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Queued> queue_;
+    size_t queued_bytes_{0};
+    uint64_t next_block_{0};  // lowest block not yet queued or posted
+    uint64_t confirmed_height_{0};
+    bool flush_requested_{false};
+    bool stopping_{false};
+    Metrics metrics_;
+
+    // Worker only, oldest nonce first
+    std::deque<Outbound> in_flight_;
+    uint64_t next_nonce_{0};
+
+    std::thread worker_;
+};
+
+} // namespace rollup
+} // namespace quids
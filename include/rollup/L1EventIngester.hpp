@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "storage/PersistentStorage.hpp"
+
+namespace quids {
+namespace rollup {
+
+// Pulls deposit logs from L1 in block ranges and hands them to L2.
+//
+// Each round reads the L1 head and fetches every block from the cursor up
+// to `confirmations` below it. Up to max_concurrent ranges of range_blocks
+// blocks each are in flight at once, and a pacer spaces request starts at
+// requests_per_second. A round that leaves the cursor short of the target
+// is followed straight away by another; otherwise the worker sleeps for
+// poll_interval.
+//
+// Blocks reach the sink strictly in order, and only while every block's
+// parent hash chains to the block before it. The last reorg_window block
+// headers applied are kept, with the cursor, in PersistentStorage, in one
+// write after each round. Before fetching, a round checks that L1 still
+// has the cursor block. If it does not, it walks back to the newest kept
+// block that L1 still has and calls Sink::rollback() for everything after
+// it. A reorg deeper than the window cannot be undone, so the ingester
+// stops there and reports it in metrics.
+//
+// The sink sees a block before the cursor past it is durable, so a crash
+// can replay blocks. Deposits carry their L1 block and log index so the
+// sink can drop repeats.
+class L1EventIngester {
+public:
+    using Hash = std::array<uint8_t, 32>;
+
+    struct BlockHeader {
+        uint64_t number{0};
+        Hash hash{};
+        Hash parent_hash{};
+    };
+
+    struct Deposit {
+        uint64_t l1_block{0};
+        uint32_t log_index{0};
+        std::string l1_address;
+        std::string l2_address;
+        uint64_t amount{0};
+        uint64_t timestamp{0};
+    };
+
+    struct Block {
+        BlockHeader header;
+        std::vector<Deposit> deposits;
+    };
+
+    // L1 access. Calls may block, and throw on transport errors.
+    class Client {
+    public:
+        virtual ~Client() = default;
+        virtual uint64_t head() = 0;
+        // nullopt if L1 has no block at that height
+        virtual std::optional<BlockHeader> header(uint64_t number) = 0;
+        // Every block in [first, last] in order, each with its deposit logs
+        virtual std::vector<Block> blocks(uint64_t first, uint64_t last) = 0;
+    };
+
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        virtual void apply(const Block& block) = 0;
+        // Undoes every block from first on
+        virtual void rollback(uint64_t first) = 0;
+    };
+
+    struct Config {
+        uint64_t start_block{0};
+        uint64_t confirmations{2};
+        uint64_t range_blocks{500};
+        size_t max_concurrent{4};
+        double requests_per_second{10.0};  // 0 = unpaced
+        uint64_t reorg_window{128};
+        std::chrono::milliseconds poll_interval{2000};
+    };
+
+    struct Metrics {
+        // Next block to apply
+        uint64_t cursor{0};
+        uint64_t l1_head{0};
+        uint64_t requests{0};
+        uint64_t request_failures{0};
+        uint64_t blocks_applied{0};
+        uint64_t deposits_applied{0};
+        uint64_t reorgs{0};
+        uint64_t blocks_rolled_back{0};
+        bool halted{false};
+    };
+
+    L1EventIngester(std::shared_ptr<Client> client, std::shared_ptr<Sink> sink,
+                    std::shared_ptr<storage::PersistentStorage> storage, const Config& config);
+    L1EventIngester(std::shared_ptr<Client> client, std::shared_ptr<Sink> sink,
+                    std::shared_ptr<storage::PersistentStorage> storage);
+    ~L1EventIngester();
+
+    L1EventIngester(const L1EventIngester&) = delete;
+    L1EventIngester& operator=(const L1EventIngester&) = delete;
+
+    // Runs rounds on a worker until stop()
+    void start();
+    void stop();
+
+    // One round on the calling thread; returns the blocks applied. Not to
+    // be mixed with a running worker.
+    size_t poll();
+
+    [[nodiscard]] Metrics metrics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void workerLoop();
+    void resume();
+    bool persist();
+    // Waits for the next request slot
+    void pace();
+    // False when the reorg is deeper than the window
+    bool reconcile();
+    uint64_t next_block() const;
+
+    std::shared_ptr<Client> client_;
+    std::shared_ptr<Sink> sink_;
+    std::shared_ptr<storage::PersistentStorage> storage_;
+    const Config config_;
+
+    // Newest last; the cursor is one past the back
+    std::deque<BlockHeader> applied_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    Metrics metrics_;
+    bool stopping_{false};
+    std::thread worker_;
+
+    std::mutex pace_mutex_;
+    Clock::time_point next_request_{};
+};
+
+} // namespace rollup
+} // namespace quids
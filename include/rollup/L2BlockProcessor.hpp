@@ -1,32 +1,168 @@
 #pragma once
-#include <queue>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
 #include <memory>
-#include "RollupStateTransition.hpp"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "blockchain/Transaction.hpp"
+#include "rollup/MEVProtection.hpp"
+#include "rollup/OptimisticExecutor.hpp"
+#include "rollup/ProvingService.hpp"
+#include "rollup/StateManager.hpp"
+
+namespace quids {
+namespace rollup {
 
+// Block production as a pipeline:
+//
+//   ingest -> order -> execute -> state root -> proof -> L1 submit
+//
+// Every stage has its own worker threads and a bounded input queue, so a
+// block is executed while the previous one is hashed and older ones are
+// proven, and a slow stage pushes back on the ones before it instead of
+// buffering without limit. Blocks travel as shared pointers; a batch's
+// transactions are moved into its block once and never copied.
+//
+// Execute is the only stage that writes the state and takes one block at a
+// time, so each block sees every earlier block's writes. The state root
+// stage folds each block's write set into a shadow copy of the state, so
+// hashing happens off the execute thread. Proof runs proof_workers blocks
+// at once; L1 submit puts them back in block order. A stage that throws
+// marks the block failed and later stages pass it through untouched.
 class L2BlockProcessor {
 public:
+    using Hash = std::array<uint8_t, 32>;
+
     struct L2Block {
-        uint64_t block_number;
-        std::vector<Transaction> transactions;
-        std::array<uint8_t, 32> state_root;
-        std::array<uint8_t, 32> previous_hash;
-        ZKPGenerator::Proof block_proof;
-        uint64_t timestamp;
+        uint64_t block_number{0};
+        std::vector<blockchain::TransactionPtr> transactions;
+        // Per transaction, set by execute
+        std::vector<bool> executed;
+        // Accounts written by execute, consumed by state root
+        std::vector<std::pair<std::string, StateManager::Account>> writes;
+        MEVProtection::OrderingCommitment ordering{};
+        Hash pre_state_root{};
+        Hash state_root{};
+        Hash previous_hash{};
+        Hash block_hash{};
+        zkp::QZKPGenerator::Proof block_proof;
+        uint64_t timestamp{0};
+        std::chrono::steady_clock::time_point ingested;
+        std::exception_ptr error;
+    };
+    using BlockPtr = std::shared_ptr<L2Block>;
+
+    // Reorders a block's transactions in place; the default keeps arrival
+    // order. The ordering commitment is taken after it runs.
+    using Orderer = std::function<void(std::vector<blockchain::TransactionPtr>& transactions)>;
+    // Called in block order, failed blocks included
+    using Submitter = std::function<void(const BlockPtr& block)>;
+
+    enum Stage : size_t { Ingest, Order, Execute, StateRoot, Proof, Submit, NUM_STAGES };
+
+    struct Config {
+        size_t queue_capacity{4};  // blocks waiting in front of each stage
+        size_t proof_workers{2};
+        size_t max_block_size{10000};
     };
 
-    L2Block create_block(const std::vector<Transaction>& batch);
-    bool verify_block(const L2Block& block);
-    void apply_block(const L2Block& block);
-    
-    // L1 synchronization
-    void submit_block_to_l1(const L2Block& block);
-    void process_l1_events();
-    
+    struct Metrics {
+        uint64_t blocks_submitted{0};
+        uint64_t blocks_failed{0};
+        uint64_t transactions_rejected{0};  // bad signatures, dropped at ingest
+        std::array<size_t, NUM_STAGES> queue_depth{};
+        // Time each stage spent working; the largest is the bottleneck
+        std::array<std::chrono::microseconds, NUM_STAGES> busy{};
+        // Ingest to L1 submission
+        std::chrono::microseconds average_latency{0};
+        std::chrono::microseconds max_latency{0};
+    };
+
+    L2BlockProcessor(std::shared_ptr<StateManager> state, const Config& config, Submitter submitter,
+                     ProvingService::BackendFactory prover = ProvingService::local(), Orderer orderer = {});
+    ~L2BlockProcessor();
+
+    L2BlockProcessor(const L2BlockProcessor&) = delete;
+    L2BlockProcessor& operator=(const L2BlockProcessor&) = delete;
+
+    // Moves batch into a new block and returns its number; blocks while the
+    // ingest queue is full. Throws std::invalid_argument on an empty or
+    // oversized batch and std::runtime_error once stopped; a refused batch
+    // is left with the caller.
+    uint64_t submit(std::vector<blockchain::TransactionPtr>&& batch);
+
+    // Blocks until every submitted block has reached the submitter
+    void drain();
+    // Lets blocks in flight finish, then joins the workers
+    void stop();
+
+    [[nodiscard]] Metrics metrics() const;
+
+    [[nodiscard]] static Hash calculate_block_hash(const L2Block& block);
+    // Checks the block hash and chaining against its predecessor's hash
+    [[nodiscard]] static bool verify_block(const L2Block& block, const Hash& previous_hash);
+
 private:
-    std::unique_ptr<StateManager> state_manager_;
-    std::unique_ptr<RollupStateTransition> state_transition_;
-    uint64_t current_block_number_{0};
-    
-    std::array<uint8_t, 32> calculate_block_hash(const L2Block& block);
-    bool verify_block_proof(const L2Block& block);
-}; 
\ No newline at end of file
+    class Queue;
+
+    void runStage(Stage stage, const std::function<void(L2Block&)>& work);
+    void runSubmit();
+
+    void ingest(L2Block& block);
+    void order(L2Block& block);
+    void execute(L2Block& block);
+    void computeRoot(L2Block& block);
+
+    const Config config_;
+    std::shared_ptr<StateManager> state_;
+    Submitter submitter_;
+    ProvingService::BackendFactory prover_;
+    Orderer orderer_;
+    MEVProtection mev_;
+    OptimisticExecutor executor_;
+
+    // Owned by the state root stage: lags the live state by the blocks
+    // in flight between execute and state root
+    std::unique_ptr<StateManager> shadow_;
+    Hash last_root_{};
+    Hash last_block_hash_{};
+
+    // queues_[s] feeds stage s
+    std::array<std::unique_ptr<Queue>, NUM_STAGES> queues_;
+    std::array<std::atomic<size_t>, NUM_STAGES> live_workers_{};
+    std::array<std::atomic<int64_t>, NUM_STAGES> busy_us_{};
+    std::vector<std::thread> workers_;
+
+    // Serializes producers so blocks enter ingest in number order
+    std::mutex submit_mutex_;
+    mutable std::mutex mutex_;
+    std::condition_variable drained_cv_;
+    uint64_t next_block_number_{0};
+    bool stopped_{false};
+    std::atomic<uint64_t> transactions_rejected_{0};
+
+    // Submit stage only
+    std::map<uint64_t, BlockPtr> reorder_;
+    uint64_t next_submit_{0};
+
+    // Guarded by mutex_
+    uint64_t blocks_submitted_{0};
+    uint64_t blocks_failed_{0};
+    double average_latency_us_{0.0};
+    std::chrono::microseconds max_latency_{0};
+
+    static constexpr double LATENCY_GAIN = 0.125;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "rollup/StateManager.hpp"
+#include "rollup/StateTrie.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Follows the chain by headers alone, for clients that keep neither
+// blocks nor state.
+//
+// Every block whose number is a multiple of 2^checkpoint_shift is a
+// checkpoint. A checkpoint links to the checkpoints 2^(shift + i) blocks
+// back, for each i where its number is a multiple of 2^(shift + i), so the
+// checkpoints form a skip list. Each link carries an aggregated proof of
+// the state transition over the blocks it spans. sync() climbs and then
+// descends the skip list from the trusted checkpoint to the target. That
+// takes O(log n) headers and transition checks, and the blocks at most
+// one interval past the last checkpoint are then followed header by header.
+//
+// Only the trusted checkpoint and the current head are held, so memory
+// does not grow with the chain. Account queries are answered against the
+// trusted checkpoint's state root. Proofs for them are fetched on demand
+// from the DHT, where full nodes store account_proof() under proof_key().
+class LightClient {
+public:
+    using Hash = StateTrie::Hash;
+    using DhtKey = std::array<uint8_t, 32>;
+
+    struct Skip {
+        Hash checkpoint{};
+        // Aggregated proof for the blocks since that checkpoint; checked
+        // by TransitionCheck, and not covered by the header hash
+        std::vector<uint8_t> proof;
+    };
+
+    struct Header {
+        uint64_t number{0};
+        Hash parent_hash{};
+        Hash state_root{};
+        Hash transactions_root{};
+        uint64_t timestamp{0};
+        // Checkpoints only; skips[i] reaches back 2^(shift + i) blocks
+        std::vector<Skip> skips;
+
+        // BLAKE3 over the fields and the skip links' checkpoint hashes
+        [[nodiscard]] Hash hash() const;
+    };
+
+    // True when proof shows to.state_root follows from from.state_root
+    // over the blocks in between. The node supplies one built on its proof
+    // system; the client only decides which transitions to check.
+    using TransitionCheck = std::function<bool(const Header& from, const Header& to, std::span<const uint8_t> proof)>;
+    // A header by number, from any peer; nullopt when none answers
+    using HeaderSource = std::function<std::optional<Header>(uint64_t number)>;
+    // A DHT value by key; network::QDHTNode::find_value fits as it is
+    using ProofSource = std::function<std::optional<std::vector<uint8_t>>(const DhtKey& key)>;
+
+    struct Config {
+        // Checkpoints every 2^checkpoint_shift blocks
+        uint32_t checkpoint_shift{10};
+    };
+
+    struct AccountQuery {
+        enum class Status {
+            Found,
+            Absent,       // proven not to exist
+            Unavailable,  // no proof in the DHT
+            Invalid       // a proof that does not open to the root
+        };
+        Status status{Status::Unavailable};
+        std::optional<StateManager::Account> account;
+    };
+
+    struct Stats {
+        uint64_t headers_fetched{0};
+        uint64_t transitions_checked{0};
+        uint64_t proofs_fetched{0};
+    };
+
+    // trusted must be a checkpoint, typically genesis or one the client
+    // shipped with; throws std::invalid_argument otherwise
+    LightClient(Header trusted, const Config& config, TransitionCheck check);
+
+    // Accepts the header after head() if it links to it. At a checkpoint
+    // its first skip must link to the trusted checkpoint and pass the
+    // transition check, and it becomes the trusted one. False, with
+    // nothing changed, otherwise.
+    bool follow(Header header);
+
+    // Brings head() to target over the skip list. False, keeping every
+    // checkpoint verified on the way, when a header is missing or fails.
+    bool sync(uint64_t target, const HeaderSource& headers);
+
+    [[nodiscard]] const Header& trusted() const { return trusted_; }
+    [[nodiscard]] const Header& head() const { return head_; }
+    [[nodiscard]] bool is_checkpoint(uint64_t number) const;
+    // Numbers of the checkpoints the header at number links back to, in
+    // skip order; empty unless it is a checkpoint
+    [[nodiscard]] std::vector<uint64_t> skip_targets(uint64_t number) const;
+
+    // On the trusted checkpoint's state root
+    AccountQuery get_account(const std::string& address, const ProofSource& proofs);
+
+    // Where a full node stores an account's proof for one state root
+    [[nodiscard]] static DhtKey proof_key(const Hash& state_root, const std::string& address);
+    // The value stored there: a one-entry StateWitness, showing either the
+    // account or its absence
+    [[nodiscard]] static std::vector<uint8_t> account_proof(const StateManager::Snapshot& snapshot,
+                                                            const std::string& address);
+
+    [[nodiscard]] Stats stats() const { return stats_; }
+
+private:
+    // Moves trusted_ to next over skip level; head_ follows
+    bool advance(Header next, size_t level);
+
+    const Config config_;
+    TransitionCheck check_;
+    Header trusted_;
+    Header head_;
+    Stats stats_;
+};
+
+} // namespace rollup
+} // namespace quids
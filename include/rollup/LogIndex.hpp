@@ -0,0 +1,172 @@
+#pragma once
+
+#include "storage/PersistentStorage.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// 2048-bit log bloom in the Ethereum layout: every address and topic sets
+// three bits, taken from 11-bit slices of its hash. The hash is BLAKE3
+// rather than Keccak, so blooms are only comparable within this chain.
+class LogBloom {
+public:
+    static constexpr size_t BYTES = 256;
+
+    void add(const uint8_t* data, size_t size);
+    [[nodiscard]] bool may_contain(const uint8_t* data, size_t size) const;
+    void merge(const LogBloom& other);
+    [[nodiscard]] bool empty() const;
+
+    std::array<uint8_t, BYTES> bits{};
+    bool operator==(const LogBloom&) const = default;
+};
+
+// Receipts and event logs with indexed queries.
+//
+// index_block() writes, in one batch: the block's receipts with its bloom,
+// a location for every transaction hash, the block's bit in a bitmap for
+// each address and each (position, topic) it logged, and the bloom of the
+// block's batch of BATCH_BLOCKS blocks. A bitmap covers one batch and is
+// stored as a sorted offset list while sparse, or as a plain bitmap once
+// that is smaller.
+//
+// query() walks the batches in range. It skips a batch whose bloom rules
+// the filter out. Otherwise it intersects the bitmaps of the filter's
+// constraints, where a constraint is the union of its alternatives, and
+// reads only the candidate blocks. A query over 100k blocks looks at
+// about 25 blooms and a few bitmaps, not 100k blocks.
+//
+// Blocks of the same batch should be indexed in order by one writer;
+// queries may run at any time and see every block indexed before they
+// started.
+class LogIndex {
+public:
+    using Address = std::array<uint8_t, 20>;
+    using Topic = std::array<uint8_t, 32>;
+    using Hash = std::array<uint8_t, 32>;
+
+    static constexpr uint64_t BATCH_BLOCKS = 4096;
+    static constexpr size_t MAX_TOPICS = 4;
+
+    struct Log {
+        Address address{};
+        std::vector<Topic> topics;  // at most MAX_TOPICS
+        std::vector<uint8_t> data;
+        bool operator==(const Log&) const = default;
+    };
+
+    struct Receipt {
+        Hash tx_hash{};
+        bool success{true};
+        uint64_t gas_used{0};
+        std::vector<Log> logs;
+        [[nodiscard]] LogBloom bloom() const;
+        bool operator==(const Receipt&) const = default;
+    };
+
+    // Where a receipt sits
+    struct Located {
+        uint64_t block_number{0};
+        uint32_t tx_index{0};
+        Receipt receipt;
+    };
+
+    // Empty addresses match any address. topics[i] constrains position i,
+    // and an empty entry there matches anything.
+    struct Filter {
+        uint64_t from_block{0};
+        uint64_t to_block{UINT64_MAX};  // inclusive
+        std::vector<Address> addresses;
+        std::vector<std::vector<Topic>> topics;
+        size_t limit{10000};
+    };
+
+    struct Match {
+        uint64_t block_number{0};
+        uint32_t tx_index{0};
+        uint32_t log_index{0};  // within the block
+        Hash tx_hash{};
+        Log log;
+    };
+
+    struct Stats {
+        uint64_t blocks_indexed{0};
+        uint64_t queries{0};
+        uint64_t batches_skipped{0};
+        uint64_t blocks_read{0};
+        uint64_t failed_writes{0};
+    };
+
+    explicit LogIndex(std::shared_ptr<storage::PersistentStorage> storage, bool sync_writes = false);
+
+    LogIndex(const LogIndex&) = delete;
+    LogIndex& operator=(const LogIndex&) = delete;
+
+    // Throws std::invalid_argument for a log with too many topics. False
+    // if the write failed.
+    bool index_block(uint64_t block_number, const std::vector<Receipt>& receipts);
+
+    [[nodiscard]] std::optional<Located> receipt(const Hash& tx_hash) const;
+    [[nodiscard]] std::optional<std::vector<Receipt>> block_receipts(uint64_t block_number) const;
+    [[nodiscard]] std::optional<LogBloom> block_bloom(uint64_t block_number) const;
+    [[nodiscard]] LogBloom batch_bloom(uint64_t batch) const;
+
+    // In block, transaction and log order, at most filter.limit matches
+    [[nodiscard]] std::vector<Match> query(const Filter& filter) const;
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    // One batch's block offsets for one index key
+    class Bitmap {
+    public:
+        static constexpr size_t WORDS = BATCH_BLOCKS / 64;
+
+        void set(size_t offset) { words_[offset / 64] |= uint64_t{1} << (offset % 64); }
+        [[nodiscard]] bool test(size_t offset) const { return (words_[offset / 64] >> (offset % 64)) & 1; }
+        void unite(const Bitmap& other);
+        void intersect(const Bitmap& other);
+        void fill();
+        // Set offsets in [first, last]
+        [[nodiscard]] std::vector<uint32_t> offsets(size_t first, size_t last) const;
+
+        [[nodiscard]] std::vector<uint8_t> encode() const;
+        static Bitmap decode(const std::vector<uint8_t>& data);
+
+    private:
+        std::array<uint64_t, WORDS> words_{};
+    };
+
+    [[nodiscard]] Bitmap load_bitmap(const std::string& key, uint64_t batch) const;
+    // Current contents for the writer, from the cache of its batch
+    Bitmap& open_bitmap(const std::string& key, uint64_t batch);
+
+    std::shared_ptr<storage::PersistentStorage> storage_;
+    const bool sync_writes_;
+    // One past the highest block indexed, so open-ended queries stop there
+    std::atomic<uint64_t> end_block_{0};
+
+    // Writer state: the bitmaps and bloom of the batch being written
+    std::mutex write_mutex_;
+    std::optional<uint64_t> open_batch_;
+    std::map<std::string, Bitmap> open_bitmaps_;
+    LogBloom open_bloom_;
+
+    mutable std::atomic<uint64_t> blocks_indexed_{0};
+    mutable std::atomic<uint64_t> queries_{0};
+    mutable std::atomic<uint64_t> batches_skipped_{0};
+    mutable std::atomic<uint64_t> blocks_read_{0};
+    mutable std::atomic<uint64_t> failed_writes_{0};
+};
+
+} // namespace rollup
+} // namespace quids
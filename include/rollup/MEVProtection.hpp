@@ -4,15 +4,27 @@
 #include <array>
 #include <vector>
 #include <memory>
+#include <span>
 #include <string>
 #include <chrono>
-#include <unordered_map>
 
 namespace quids {
 namespace rollup {
 
+// Fair sequencing and MEV detection.
+//
+// Pending transactions are kept in first-come order as they arrive, so
+// get_optimal_ordering() is a walk rather than a sort. Detection is indexed
+// by the contract or pool a transaction touches: a new arrival is only
+// compared with recent pending transactions to the same target, and only
+// senders with more than one transaction in their rolling window are
+// checked for sandwiches. Transactions caught front-running or bracketing a
+// victim are moved to the end of the ordering.
 class MEVProtection {
 public:
+    // How far back arrivals are compared
+    static constexpr std::chrono::milliseconds DETECTION_WINDOW{30000};
+
     struct OrderingCommitment {
         uint64_t timestamp;
         std::array<uint8_t, 32> batch_hash;
@@ -26,20 +38,28 @@ public:
     MEVProtection& operator=(const MEVProtection&) = delete;
 
     // Move operations
-    MEVProtection(MEVProtection&&) noexcept = default;
-    MEVProtection& operator=(MEVProtection&&) noexcept = default;
+    MEVProtection(MEVProtection&&) noexcept;
+    MEVProtection& operator=(MEVProtection&&) noexcept;
 
-    void add_transaction(const blockchain::Transaction& tx);
-    std::vector<blockchain::Transaction> get_optimal_ordering();
+    // O(log n) plus the recent transactions to the same target
+    void add_transaction(const blockchain::TransactionPtr& tx);
+    std::vector<blockchain::TransactionPtr> get_optimal_ordering();
+    [[nodiscard]] size_t pending_count() const;
     [[nodiscard]] OrderingCommitment create_ordering_commitment(
-        const std::vector<blockchain::Transaction>& transactions
+        std::span<const blockchain::TransactionPtr> transactions
     ) const;
     
     [[nodiscard]] double estimate_profit(const blockchain::Transaction& tx) const;
 
     [[nodiscard]] bool detect_sandwich_attack(
         const blockchain::Transaction& target,
-        const std::vector<blockchain::Transaction>& batch
+        std::span<const blockchain::TransactionPtr> batch
+    ) const;
+
+    // Indices of every transaction in `batch` with another sender's
+    // transactions to the same target both before and after it
+    [[nodiscard]] std::vector<size_t> detect_sandwiches(
+        std::span<const blockchain::TransactionPtr> batch
     ) const;
 
     [[nodiscard]] bool detect_frontrunning(
@@ -48,7 +68,7 @@ public:
     ) const;
 
     [[nodiscard]] std::array<uint8_t, 32> compute_fairness_hash(
-        const std::vector<blockchain::Transaction>& transactions
+        std::span<const blockchain::TransactionPtr> transactions
     ) const;
 
     [[nodiscard]] std::vector<uint8_t> compute_transaction_hash(
@@ -59,13 +79,11 @@ public:
     [[nodiscard]] bool is_high_value_transaction(const blockchain::Transaction& tx) const;
     void set_high_value_threshold(double threshold);
 
+    // Drops the pending set; sender windows carry over to the next batch
     void finalize_batch();
 
 private:
-    struct Impl {
-        double high_value_threshold{1000.0};
-        std::unordered_map<std::string, std::chrono::system_clock::time_point> last_transaction_time;
-    };
+    struct Impl;
     std::unique_ptr<Impl> impl_;
 };
 
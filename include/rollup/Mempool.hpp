@@ -0,0 +1,173 @@
+#pragma once
+
+#include "blockchain/Transaction.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Pending transactions shared by the API front end and the batch builders.
+// They are held by TransactionPtr, so what take() hands out is the object
+// that was submitted, with its memoized hash and signature check.
+//
+// Senders are hashed onto a power-of-two number of shards, each with its own
+// lock, so submissions from different senders rarely meet. Inside a shard a
+// sender's transactions are kept in nonce order and the lowest nonce of each
+// sender is indexed by fee. submit_batch() takes every shard lock once per
+// call instead of once per transaction, and take() merges the per-shard fee
+// indexes lazily, so cutting a batch of k costs O(k log k) whatever the pool
+// size.
+//
+// Every pending entry is charged to memory::Subsystem::Mempool. Once that
+// subsystem's budget is spent a new transaction has to evict a cheaper one,
+// as with a full shard, or is refused with PoolFull.
+class Mempool {
+public:
+    using Transaction = blockchain::Transaction;
+    using TransactionPtr = blockchain::TransactionPtr;
+
+    struct Config {
+        size_t shard_count{64};             // rounded up to a power of two
+        size_t capacity{1 << 18};           // transactions, split evenly over shards
+        size_t max_per_sender{256};
+        uint64_t replacement_bump_percent{10};
+        size_t parallel_batch_threshold{4096};  // submit_batch() fans out above this
+    };
+
+    enum class AddResult {
+        Added,
+        Replaced,     // same sender and nonce, paid enough more to take the slot
+        Duplicate,
+        Underpriced,  // replacement without the required bump, or loses eviction
+        NonceTooLow,  // at or below the sender's last committed nonce
+        SenderFull,
+        PoolFull      // capacity or memory budget reached
+    };
+
+    static bool is_accepted(AddResult result);
+
+    struct Stats {
+        uint64_t added{0};
+        uint64_t replaced{0};
+        uint64_t rejected{0};
+        uint64_t evicted{0};
+        uint64_t taken{0};
+        uint64_t pruned{0};
+    };
+
+    explicit Mempool(const Config& config);
+    Mempool();
+    ~Mempool();
+
+    Mempool(const Mempool&) = delete;
+    Mempool& operator=(const Mempool&) = delete;
+
+    // tx must not be null
+    AddResult submit(TransactionPtr tx);
+    // One result per input, in input order
+    std::vector<AddResult> submit_batch(const std::vector<TransactionPtr>& txs);
+
+    // Up to k transactions by fee, never ahead of a lower nonce from the same
+    // sender. select() leaves them pending, take() removes them.
+    std::vector<TransactionPtr> select(size_t k) const;
+    std::vector<TransactionPtr> take(size_t k);
+
+    // Drops everything from sender up to and including nonce, and rejects
+    // such nonces for as long as the sender has anything pending
+    void on_committed(const std::string& sender, uint64_t nonce);
+
+    // Removes and returns everything pending from senders that moves()
+    // picks, each sender's transactions in nonce order. Used to hand an
+    // account range over to another chain's pool.
+    std::vector<TransactionPtr> extract_senders(const std::function<bool(const std::string&)>& moves);
+
+    void clear();
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return shard_capacity_ * shards_.size(); }
+    bool is_full() const { return size() >= capacity(); }
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        TransactionPtr tx;
+        uint64_t fee;
+        uint64_t seq;
+        size_t bytes;  // charged to Subsystem::Mempool
+    };
+
+    struct Sender;
+
+    // Orders by fee, then by arrival
+    struct FeeKey {
+        uint64_t fee;
+        uint64_t seq;
+        Sender* sender;
+        uint64_t nonce;
+
+        bool operator<(const FeeKey& other) const {
+            if (fee != other.fee) return fee > other.fee;
+            return seq < other.seq;
+        }
+    };
+
+    struct Sender {
+        std::string address;
+        std::map<uint64_t, Entry> txs;  // by nonce
+        uint64_t committed_floor{0};    // nonces below this are stale
+        bool has_head{false};
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Sender>> senders;
+        std::set<FeeKey> heads;     // lowest-nonce entry of every sender
+        std::set<FeeKey> by_fee;    // every entry, cheapest last
+        size_t count{0};
+    };
+
+    struct Pick {
+        FeeKey key;
+        size_t shard;
+    };
+
+    Shard& shard_for(const std::string& sender);
+    AddResult add_locked(Shard& shard, const TransactionPtr& tx, Stats& stats);
+    void detach_head(Shard& shard, Sender& sender);
+    void attach_head(Shard& shard, Sender& sender);
+    size_t remove_range(Shard& shard, Sender& sender,
+                        std::map<uint64_t, Entry>::iterator first,
+                        std::map<uint64_t, Entry>::iterator last);
+    void erase_if_idle(Shard& shard, Sender& sender);
+    bool evict_below(Shard& shard, uint64_t fee, const Sender& keep, Stats& stats);
+    // Shards are always locked in index order
+    std::vector<std::unique_lock<std::mutex>> lock_all() const;
+    std::vector<Pick> pick_locked(size_t k) const;
+    void merge_stats(const Stats& delta);
+
+    Config config_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t shard_mask_;
+    size_t shard_capacity_;
+    std::atomic<size_t> size_{0};
+    std::atomic<uint64_t> next_seq_{0};
+
+    mutable std::mutex stats_mutex_;
+    Stats stats_;
+
+    utils::WorkStealingPool& pool_;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -1,17 +1,27 @@
 #pragma once
 #include "RollupStateTransition.hpp"
+#include "rollup/ChallengeIndex.hpp"
+#include <chrono>
+#include <memory>
 
 using quids::rollup::StateManager;
 using quids::rollup::StateTransitionProof;
 
 class OptimisticAdapter {
 public:
+    static constexpr std::chrono::hours CHALLENGE_PERIOD{24 * 7};
+
     struct OptimisticProof {
         StateTransitionProof zk_proof;
         std::chrono::system_clock::time_point challenge_period_end;
         bool has_fraud_proof;
     };
 
+    OptimisticAdapter() = default;
+    // Every converted proof opens a window in the index, and a proof
+    // under challenge there fails verification
+    explicit OptimisticAdapter(std::shared_ptr<quids::rollup::ChallengeIndex> index);
+
     OptimisticProof convert_to_optimistic(
         const StateTransitionProof& zk_proof
     );
@@ -22,6 +32,8 @@ public:
     );
 
 private:
+    std::shared_ptr<quids::rollup::ChallengeIndex> index_;
+
     bool verify_state_transition(
         const StateTransitionProof& proof,
         const StateManager& state_manager
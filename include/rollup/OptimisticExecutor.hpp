@@ -0,0 +1,104 @@
+#pragma once
+
+#include "rollup/StateManager.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Block-STM style speculative executor.
+//
+// Every transaction of a batch is executed at once against a multi-version
+// view of the state: a read sees the latest write of a lower-indexed
+// transaction, or the base state. After a round the read sets are validated
+// and only transactions whose reads changed are executed again. Every round
+// finalizes at least the lowest pending transaction, so the outcome always
+// equals executing the batch in order.
+class OptimisticExecutor {
+public:
+    using Key = std::string;
+    using Value = StateManager::Account;
+    using BaseReader = std::function<std::optional<Value>(const Key&)>;
+
+    struct Config {
+        // 1 = execute inline, otherwise rounds fan out on the shared pool
+        size_t num_threads{4};
+        // Rounds before the remaining suffix is finished sequentially
+        size_t max_rounds{8};
+    };
+
+    struct Metrics {
+        size_t rounds{0};
+        size_t executions{0};
+        size_t reexecutions{0};
+        bool sequential_fallback{false};
+    };
+
+    struct Result {
+        std::vector<bool> success;
+        // Final value of every key written by the batch, still intact after
+        // apply_batch so it can serve as the batch's state diff
+        std::vector<std::pair<Key, Value>> writes;
+        Metrics metrics;
+    };
+
+    class MVMemory;
+
+    // Per-incarnation view handed to the execute callback
+    class View {
+    public:
+        std::optional<Value> read(const Key& key);
+        void write(const Key& key, Value value);
+
+    private:
+        friend class OptimisticExecutor;
+
+        struct ReadDescriptor {
+            Key key;
+            int64_t writer;       // -1 = base state
+            uint32_t incarnation;
+        };
+
+        View(size_t tx_index, MVMemory& memory, const BaseReader& base)
+            : tx_index_(tx_index), memory_(memory), base_(base) {}
+
+        size_t tx_index_;
+        MVMemory& memory_;
+        const BaseReader& base_;
+        std::vector<ReadDescriptor> reads_;
+        std::unordered_map<Key, Value> writes_;
+    };
+
+    using ExecuteFn = std::function<bool(size_t tx_index, View& view)>;
+
+    explicit OptimisticExecutor(const Config& config);
+    OptimisticExecutor();
+    ~OptimisticExecutor();
+
+    Result execute(size_t tx_count, const BaseReader& base, const ExecuteFn& fn);
+
+    // Transfer semantics of StateManager::apply_transaction, run under
+    // speculation and committed back into `state` in one pass
+    Result apply_batch(StateManager& state, const std::vector<blockchain::Transaction>& txs);
+    Result apply_batch(StateManager& state, std::span<const blockchain::TransactionPtr> txs);
+
+private:
+    // `at(i)` yields the i-th transaction of a batch of `count`
+    template <typename At>
+    Result apply_transfers(StateManager& state, size_t count, const At& at);
+
+    Config config_;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -8,12 +8,18 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <deque>
 #include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <future>
+#include <functional>
 #include "rollup/RollupPerformanceMetrics.hpp"
+#include "rollup/ConflictScheduler.hpp"
+#include "rollup/Mempool.hpp"
+#include "rollup/OptimisticExecutor.hpp"
+#include "utils/WorkStealingPool.hpp"
 
 namespace quids {
 namespace rollup {
@@ -48,20 +54,28 @@ public:
         uint64_t gas_limit;
     };
 
+    struct PendingCall {
+        ContractCall call;
+        std::promise<quids::evm::EVMExecutor::ExecutionResult> result;
+    };
+
+    // Calls to one contract queue here and are drained in order by at most
+    // one pool task at a time, so they run serially while different
+    // contracts run in parallel
     struct ContractState {
         uint64_t balance{0};
-        std::vector<uint8_t> code;
+        quids::evm::CodeRef code;
         std::unordered_map<std::string, std::vector<uint8_t>> storage;
         std::mutex mutex;
-        bool is_executing{false};
-        std::queue<ContractCall> pending_calls;
+        bool is_executing{false};  // a drain task is scheduled or running
+        std::deque<PendingCall> pending_calls;
     };
 
     struct AccountState {
         uint64_t balance{0};
         uint64_t nonce{0};
         std::mutex mutex;
-        std::queue<blockchain::Transaction> pending_transactions;
+        std::queue<blockchain::TransactionPtr> pending_transactions;
     };
 
     struct ProcessingResult {
@@ -77,6 +91,11 @@ public:
     ~ParallelProcessor();
 
     void process_batch(const std::vector<blockchain::Transaction>& batch);
+    // Speculative Block-STM style execution against `state`; the outcome
+    // matches applying `batch` in order
+    OptimisticExecutor::Result process_batch_optimistic(
+        StateManager& state,
+        const std::vector<blockchain::Transaction>& batch);
     ProcessingResult process_transaction(const blockchain::Transaction& tx);
     void process(const ::evm::Address& contract_address);
 
@@ -84,8 +103,14 @@ public:
     void stop();
 
     ContractResult executeContract(const ContractCall& call);
+    // Queues all calls with one lock per contract; results are in input order
+    std::vector<ContractResult> executeContracts(std::vector<ContractCall> calls);
+    // Runs one call on the calling thread's executor, bypassing the queue
     quids::evm::EVMExecutor::ExecutionResult executeContractInternal(const ContractCall& call);
 
+    // Wave layout and per-wave timings of the most recent submitBatch
+    ScheduleMetrics getLastScheduleMetrics() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl_;
@@ -93,45 +118,50 @@ private:
     // Member variables
     std::atomic<bool> should_stop_;
     ParallelProcessorConfig config_;
+    // One executor per pool worker, indexed by worker_index(); only that
+    // worker touches its entry. The last entry serves threads outside the
+    // pool and is guarded by external_executor_mutex_.
     std::vector<std::unique_ptr<quids::evm::EVMExecutor>> evm_executors_;
-    std::mutex evm_executors_mutex_;
+    std::mutex external_executor_mutex_;
     
-    // Thread management
-    std::vector<std::thread> worker_threads_;
-    std::vector<std::thread> contract_worker_threads_;
+    // All work runs on the process-wide pool; in_flight_ counts tasks that
+    // still reference this processor
+    utils::WorkStealingPool& pool_;
+    std::atomic<size_t> in_flight_{0};
     
-    // Queue management
-    std::queue<blockchain::Transaction> transaction_queue_;
-    std::mutex transaction_queue_mutex_;
-    std::condition_variable transaction_queue_cv_;
-    
-    // Contract queue
-    std::queue<ContractCall> contract_queue_;
-    std::mutex contract_queue_mutex_;
-    std::condition_variable contract_queue_cv_;
+    // Submitted transactions wait here, bounded by max_queue_size
+    Mempool mempool_;
     
     // State management
-    std::unordered_map<std::string, AccountState> account_states_;
+    std::unordered_map<::evm::Address, AccountState> account_states_;
     std::mutex account_states_mutex_;
     std::unordered_map<::evm::Address, ContractState> contract_states_;
     std::mutex contract_states_mutex_;
 
     // Helper methods
-    void startWorkers();
-    void stopWorkers();
-    void workerThread();
-    void contractWorkerThread();
-    bool submitTransaction(const blockchain::Transaction& tx);
-    bool submitBatch(const std::vector<blockchain::Transaction>& batch);
-    bool processTransaction(const blockchain::Transaction& tx);
-    bool processBatch(const std::vector<blockchain::Transaction>& batch);
-    bool hasDependency(const blockchain::Transaction& tx1, const blockchain::Transaction& tx2) const;
-    std::vector<std::vector<blockchain::Transaction>> createIndependentBatches(
-        const std::vector<blockchain::Transaction>& transactions);
-    quids::evm::EVMExecutor* getAvailableExecutor();
-    void returnExecutor(quids::evm::EVMExecutor* executor);
+    void drainTransactionQueue();
+    void waitForInFlight();
+    bool submitTransaction(blockchain::TransactionPtr tx);
+    bool submitBatch(const std::vector<blockchain::TransactionPtr>& batch);
+    bool processTransaction(const blockchain::TransactionPtr& tx);
+    bool processBatch(const std::vector<blockchain::TransactionPtr>& batch);
+    std::vector<std::vector<blockchain::TransactionPtr>> createIndependentBatches(
+        const std::vector<blockchain::TransactionPtr>& transactions);
+    size_t runWave(const std::vector<blockchain::TransactionPtr>& transactions,
+                   const ConflictScheduler::Wave& wave);
+    void initExecutors();
+    ContractState& contractState(const ::evm::Address& address);
+    // Appends to the contract's queue; true if the caller must schedule a drain
+    bool enqueueLocked(ContractState& state, PendingCall pending);
+    void scheduleDrain(ContractState& state);
+    void drainContract(ContractState& state);
+    quids::evm::EVMExecutor::ExecutionResult runOnLocalExecutor(const ContractCall& call);
 
     RollupPerformanceMetrics metrics_;
+
+    ConflictScheduler scheduler_;
+    ScheduleMetrics last_schedule_metrics_;
+    mutable std::mutex schedule_mutex_;
 };
 
 } // namespace rollup
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "blockchain/Transaction.hpp"
+#include "rollup/ConflictScheduler.hpp"
+#include "rollup/Mempool.hpp"
+#include "rollup/StateManager.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Runs pending transactions ahead of their batch so that sealing finds
+// the work done.
+//
+// A pass takes the pool's best pending transactions (Mempool::select, so
+// nothing is removed), groups them by sender and replays each sender's
+// run in nonce order against the latest StateManager snapshot, with the
+// transfer rules of StateManager::apply_transaction. Senders run side by
+// side on the shared pool at the lowest priority, so a pass only uses
+// cores that execution and proving leave idle.
+//
+// Each pass checks signatures, which fills the node-wide SignatureCache
+// that the batch's own checks then hit. It also records, per transaction
+// hash, the access set the conflict scheduler should use and whether the
+// transaction is expected to fail. A transaction that fails writes
+// nothing, so its set shrinks to a read of the sender. Failures for a
+// bad signature or a used nonce hold in any later state, and screen()
+// drops those before they take block space. Other failures depend on the
+// state the pass saw and are only reported. Credits from other senders
+// in the same pass are not modelled.
+class PreExecutor {
+public:
+    struct Config {
+        size_t max_per_pass{4096};
+        size_t max_predictions{1 << 16};  // oldest are forgotten first
+        std::chrono::milliseconds interval{50};  // between background passes
+    };
+
+    enum class Outcome : uint8_t {
+        Succeeds,
+        BadSignature,  // permanent
+        StaleNonce,    // permanent: at or below the sender's nonce
+        NonceGap,
+        InsufficientFunds,
+        UnknownAccount
+    };
+
+    static bool is_permanent(Outcome outcome) {
+        return outcome == Outcome::BadSignature || outcome == Outcome::StaleNonce;
+    }
+
+    struct Prediction {
+        Outcome outcome{Outcome::Succeeds};
+        AccessSet access;
+        uint64_t state_version{0};  // snapshot the pass ran against
+    };
+
+    struct Stats {
+        uint64_t passes{0};
+        uint64_t executed{0};
+        uint64_t predicted_failures{0};
+        uint64_t screened{0};  // dropped by screen()
+        uint64_t hits{0};      // predictions found by access_sets()/screen()
+        uint64_t misses{0};
+    };
+
+    PreExecutor(std::shared_ptr<StateManager> state, std::shared_ptr<Mempool> mempool,
+                const Config& config);
+    PreExecutor(std::shared_ptr<StateManager> state, std::shared_ptr<Mempool> mempool);
+    ~PreExecutor();
+
+    PreExecutor(const PreExecutor&) = delete;
+    PreExecutor& operator=(const PreExecutor&) = delete;
+
+    // One pass on the calling thread and the pool; returns how many
+    // transactions it ran. Transactions already predicted against the
+    // current state version are skipped.
+    size_t run_once();
+
+    // Background passes every interval, or sooner after notify()
+    void start();
+    void stop();
+    void notify();
+
+    [[nodiscard]] std::optional<Prediction> prediction(const blockchain::Transaction& tx) const;
+    // For ConflictScheduler::schedule; transactions without a prediction
+    // get ConflictScheduler::buildAccessSet
+    [[nodiscard]] std::vector<AccessSet> access_sets(const std::vector<blockchain::TransactionPtr>& batch) const;
+    // The batch without the transactions predicted to fail permanently,
+    // order kept; the dropped ones are forgotten
+    std::vector<blockchain::TransactionPtr> screen(std::vector<blockchain::TransactionPtr> batch);
+    // Drops what is known about transactions that have been sealed
+    void forget(const std::vector<blockchain::TransactionPtr>& txs);
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] Stats stats() const;
+
+private:
+    struct HashKey {
+        size_t operator()(const blockchain::Hash& h) const noexcept {
+            size_t v;
+            std::memcpy(&v, h.data(), sizeof(v));  // already uniformly distributed
+            return v;
+        }
+    };
+
+    std::optional<Prediction> lookup(const blockchain::Hash& hash) const;
+    void record(std::vector<std::pair<blockchain::Hash, Prediction>> results);
+    void loop();
+
+    std::shared_ptr<StateManager> state_;
+    std::shared_ptr<Mempool> mempool_;
+    Config config_;
+    utils::WorkStealingPool& pool_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<blockchain::Hash, Prediction, HashKey> predictions_;
+    std::deque<blockchain::Hash> order_;  // insertion order, for eviction
+    mutable Stats stats_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool woken_{false};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+} // namespace rollup
+} // namespace quids
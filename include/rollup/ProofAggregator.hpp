@@ -1,19 +1,92 @@
 #pragma once
 #include "zkp/QZKPGenerator.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <cstdint>
+#include <span>
 #include <vector>
 
 using quids::zkp::QZKPGenerator;
 
+// Folds proofs into a hierarchy of Merkle aggregates: proofs into a
+// block aggregate (level 0), block aggregates into an epoch (level 1),
+// and so on. Children are folded in as they arrive; each append only
+// rehashes the right edge of the tree.
+//
+// An aggregate is 52 bytes however much it covers, so L1 only ever
+// checks the top aggregate. Any one proof is shown to be in it by a path
+// with one Merkle proof per level, O(log n) hashes in total, without the
+// other proofs. Not thread-safe.
 class ProofAggregator {
 public:
+    using Hash = quids::crypto::MerkleHash;
+
+    struct Aggregate {
+        uint32_t level{0};
+        // Proofs covered, counting through every level below
+        uint64_t proof_count{0};
+        uint64_t child_count{0};
+        Hash root{};
+
+        static constexpr size_t SERIALIZED_SIZE = 4 + 8 + 8 + 32;
+        [[nodiscard]] std::vector<uint8_t> serialize() const;
+        // Throws std::invalid_argument on a malformed encoding
+        static Aggregate deserialize(std::span<const uint8_t> bytes);
+
+        bool operator==(const Aggregate& other) const = default;
+    };
+
+    // One step from a child up to the aggregate that contains it
+    struct PathStep {
+        quids::crypto::MerkleProof proof;
+        Aggregate parent;
+    };
+    using InclusionPath = std::vector<PathStep>;
+
     ProofAggregator();
-    
+
+    // Flat aggregation kept for existing callers: proof bytes followed by
+    // the Merkle root of the proofs
     std::vector<uint8_t> aggregate_proofs(
         const std::vector<quids::zkp::QZKPGenerator::Proof>& proofs
     );
-    
+
     bool verify_aggregated_proof(
         const std::vector<uint8_t>& aggregated_proof,
         const std::vector<quids::zkp::QZKPGenerator::Proof>& original_proofs
     );
-}; 
\ No newline at end of file
+
+    // Incremental folding. The first child fixes what this aggregator
+    // takes: proofs, or aggregates of one level; mixing throws
+    // std::logic_error.
+    void add_proof(const quids::zkp::QZKPGenerator::Proof& proof);
+    void add_proofs(const std::vector<quids::zkp::QZKPGenerator::Proof>& proofs);
+    void add_aggregate(const Aggregate& child);
+
+    [[nodiscard]] size_t size() const { return builder_.size(); }
+    // The aggregate of everything added so far
+    [[nodiscard]] Aggregate current();
+    // Path step for child index into current(); extend a child's own path
+    // with it to reach this level
+    [[nodiscard]] PathStep path_step(size_t index);
+    // Returns current() and starts over empty
+    Aggregate seal();
+
+    // Leaves commit to the whole proof through its canonical encoding;
+    // see zkp::ProofCodec. The second form hashes a received encoding as is.
+    [[nodiscard]] static Hash proof_leaf(const quids::zkp::QZKPGenerator::Proof& proof);
+    // Throws std::runtime_error on a malformed encoding
+    [[nodiscard]] static Hash proof_leaf(std::span<const uint8_t> encoded);
+    [[nodiscard]] static Hash aggregate_leaf(const Aggregate& aggregate);
+
+    // Checks that leaf is included in trusted by following path bottom
+    // up; the last step's parent must be trusted itself
+    [[nodiscard]] static bool verify_path(const Aggregate& trusted, const Hash& leaf, const InclusionPath& path);
+
+private:
+    enum class Children { None, Proofs, Aggregates };
+
+    quids::crypto::MerkleBuilder builder_;
+    Children children_{Children::None};
+    uint32_t child_level_{0};
+    uint64_t proof_count_{0};
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "rollup/StateManager.hpp"
+#include "rollup/StateTrie.hpp"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Bounded LRU of account proofs, keyed by (state root, address).
+//
+// Proofs are built from a StateManager::Snapshot, so a burst of requests
+// after a checkpoint walks an immutable trie and never holds up writers.
+// A root names one state, so an entry never goes stale; entries for old
+// roots simply age out. Absent accounts are not cached.
+class ProofCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 8192;
+
+    struct Stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t evictions{0};
+    };
+
+    explicit ProofCache(size_t capacity = DEFAULT_CAPACITY);
+
+    ProofCache(const ProofCache&) = delete;
+    ProofCache& operator=(const ProofCache&) = delete;
+
+    // nullptr when the account is not in the snapshot
+    [[nodiscard]] std::shared_ptr<const StateTrie::Proof> prove(const StateManager::Snapshot& snapshot,
+                                                                const std::string& address);
+    // Same, in order; the misses are proven side by side on the shared pool
+    [[nodiscard]] std::vector<std::shared_ptr<const StateTrie::Proof>> prove_all(
+        const StateManager::Snapshot& snapshot, const std::vector<std::string>& addresses);
+
+    void clear();
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] Stats stats() const;
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const StateTrie::Proof>>;
+
+    static std::string key_of(const std::vector<uint8_t>& root, const std::string& address);
+    std::shared_ptr<const StateTrie::Proof> lookup(const std::string& key);
+    void insert(const std::string& key, std::shared_ptr<const StateTrie::Proof> proof);
+
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    // Most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    Stats stats_;
+};
+
+} // namespace rollup
+} // namespace quids
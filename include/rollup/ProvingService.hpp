@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "quantum/QuantumState.hpp"
+#include "utils/Task.hpp"
+#include "zkp/QZKPGenerator.hpp"
+
+namespace quids {
+namespace rollup {
+
+// Proof jobs queued by priority and run by a pool of prover workers, so
+// block production never waits for a proof.
+//
+// Each worker owns one backend from the factory; the default runs a
+// QZKPGenerator locally, and a backend that forwards the state to a remote
+// prover node fits the same signature. Workers are dedicated threads: a
+// proof occupies one for its whole duration, and any parallel work a
+// backend does goes to the shared pool at TaskPriority::Proof, behind
+// consensus and execution. Within a priority, jobs run in submission
+// order. Completions run on the worker that finished the job.
+class ProvingService {
+public:
+    using Proof = zkp::QZKPGenerator::Proof;
+    using Backend = std::function<Proof(const quantum::QuantumState& state)>;
+    using BackendFactory = std::function<Backend()>;
+    // Exactly one of proof and error is meaningful
+    using Completion = std::function<void(uint64_t job, Proof&& proof, std::exception_ptr error)>;
+    using Clock = std::chrono::steady_clock;
+
+    enum class Priority : uint8_t {
+        Urgent = 0,     // e.g. exits and L1 deadlines
+        Normal = 1,     // block proofs
+        Background = 2  // re-proving and aggregation
+    };
+
+    struct Config {
+        size_t workers{0};      // 0 = half the hardware threads, at least 1
+        size_t max_queue{1024}; // submissions beyond this are refused
+    };
+
+    struct Metrics {
+        size_t queue_depth{0};
+        size_t in_flight{0};
+        uint64_t submitted{0};
+        uint64_t completed{0};
+        uint64_t failed{0};
+        uint64_t rejected{0};
+        // Submission to completion: moving average, worst seen, and the age
+        // of the oldest job not yet finished
+        std::chrono::microseconds average_lag{0};
+        std::chrono::microseconds max_lag{0};
+        std::chrono::microseconds oldest_pending{0};
+    };
+
+    ProvingService(const Config& config, BackendFactory factory);
+    explicit ProvingService(const Config& config);
+    ProvingService();
+    ~ProvingService();
+
+    ProvingService(const ProvingService&) = delete;
+    ProvingService& operator=(const ProvingService&) = delete;
+
+    // One QZKPGenerator per worker
+    static BackendFactory local();
+
+    // Job id, or nullopt when the queue is full or the service stopped;
+    // a refused state is left where it was
+    std::optional<uint64_t> submit(quantum::QuantumState&& state, Priority priority, Completion done);
+    // submit() as a coroutine, resuming on the worker that finished the
+    // job; a refused submission or a failed proof is rethrown
+    utils::Task<Proof> prove(quantum::QuantumState state, Priority priority);
+
+    // Blocks until nothing is queued or running
+    void drain();
+    // Finishes running jobs; queued ones complete with an error
+    void stop();
+
+    [[nodiscard]] Metrics metrics() const;
+    // Queued jobs over max_queue, for admission control upstream
+    [[nodiscard]] double utilization() const;
+
+private:
+    struct Job {
+        uint64_t id;
+        quantum::QuantumState state;
+        Completion done;
+        Clock::time_point submitted;
+    };
+
+    void workerLoop(Backend backend);
+    void finish(const Job& job, Clock::time_point now, bool failed);
+
+    static constexpr size_t NUM_PRIORITIES = 3;
+    static constexpr double LAG_GAIN = 0.125;
+
+    const Config config_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    std::array<std::deque<Job>, NUM_PRIORITIES> queues_;
+    // Submission times of running jobs, for oldest_pending
+    std::vector<std::pair<uint64_t, Clock::time_point>> running_;
+    bool stopping_{false};
+    uint64_t next_id_{1};
+    Metrics metrics_;
+    double average_lag_us_{0.0};
+    std::vector<std::thread> workers_;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -8,6 +8,8 @@
 #include "rollup/RollupTransactionAPI.hpp"
 #include "quantum/QuantumParameters.hpp"
 #include "rollup/RollupPerformanceMetrics.hpp"
+#include "memory/MemoryBudget.hpp"
+#include "rollup/FeatureStore.hpp"
 
 namespace quids {
 namespace rollup {
@@ -61,6 +63,12 @@ public:
     
     // Add this method
     void updateMetrics(const RollupPerformanceMetrics& metrics);
+
+    // Online training: updateMetrics() plus a labelled sample in a bounded
+    // feature store; trainIncremental() runs SGD over only the samples
+    // observed since its last call and returns how many it used
+    void observe(const RollupPerformanceMetrics& metrics, const QuantumParameters& params);
+    size_t trainIncremental();
     
 protected:
     void initializeWeights();
@@ -79,9 +87,13 @@ private:
     size_t output_size_;
     std::vector<Eigen::MatrixXd> weights_;
     std::vector<Eigen::VectorXd> biases_;
+    memory::MemoryCharge charge_;  // weights and biases
     
     // Add current metrics member
     RollupPerformanceMetrics current_metrics_;
+
+    FeatureStore store_;
+    uint64_t store_cursor_{0};
     
     // Natural language processing
     void initializeNLPModel();
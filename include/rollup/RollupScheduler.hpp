@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include "rollup/ProvingService.hpp"
+#include "utils/Metrics.hpp"
+
+namespace quids {
+namespace rollup {
+
+// Schedules the batches of many rollups over one executor and one prover.
+//
+// A batch goes through two stages. Execution builds the state to prove and
+// runs on the shared WorkStealingPool at TaskPriority::Execution, at most
+// `executors` batches at a time. Proving goes to a shared ProvingService,
+// at most `prover_slots` batches at a time, so the service's own queue
+// never fills with one rollup's work.
+//
+// Each stage picks its next batch by start-time fair queuing. Every rollup
+// has its own FIFO and each batch is tagged with its virtual start time:
+// the later of the stage's virtual time and the finish tag of the rollup's
+// previous batch. The finish tag is the start plus cost / weight. The batch
+// with the smallest start runs next, with ties going to the earlier SLO
+// deadline. A rollup that goes idle banks no credit, and a burst only
+// pushes that rollup's own tags further out, so under contention every
+// rollup gets its weighted share. Each rollup is also held to max_queued
+// batches not yet finished, so a burst cannot take all the memory either.
+//
+// The SLO is the target from submission to proof. Batches that finish
+// later count as SLO misses. Every rollup exports its series to the
+// MetricsRegistry with a `rollup` label. Completions run on the thread
+// that finished the batch.
+class RollupScheduler {
+public:
+    using RollupId = uint32_t;
+    using Proof = ProvingService::Proof;
+    using Clock = std::chrono::steady_clock;
+    // Applies the batch and returns the state to prove; runs on the executor
+    using Execute = std::function<quantum::QuantumState()>;
+    // Exactly one of proof and error is meaningful
+    using Completion = std::function<void(uint64_t batch, Proof&& proof, std::exception_ptr error)>;
+
+    struct Config {
+        size_t executors{0};     // 0 = half the hardware threads, at least 1
+        size_t prover_slots{0};  // 0 = the same as executors
+    };
+
+    struct RollupConfig {
+        uint32_t weight{1};
+        std::chrono::milliseconds slo{2000};
+        size_t max_queued{64};
+    };
+
+    struct RollupMetrics {
+        size_t queued{0};   // waiting for either stage
+        size_t running{0};  // executing or proving
+        uint64_t submitted{0};
+        uint64_t completed{0};
+        uint64_t failed{0};
+        uint64_t rejected{0};
+        uint64_t slo_misses{0};
+        // Sum of the costs sent to the executor, for checking shares
+        uint64_t executed_cost{0};
+        std::chrono::microseconds p50_latency{0};
+        std::chrono::microseconds p99_latency{0};
+    };
+
+    RollupScheduler(const Config& config, std::shared_ptr<ProvingService> prover);
+    ~RollupScheduler();
+
+    RollupScheduler(const RollupScheduler&) = delete;
+    RollupScheduler& operator=(const RollupScheduler&) = delete;
+
+    // Throws std::invalid_argument for a known id, a zero weight or a zero
+    // max_queued
+    void add_rollup(RollupId rollup, const RollupConfig& config);
+
+    // Batch id, or nullopt when the rollup is at max_queued or the
+    // scheduler stopped. cost is the batch's share of a stage, e.g. its
+    // transaction count. Throws std::out_of_range for an unknown rollup.
+    std::optional<uint64_t> submit(RollupId rollup, Execute execute, Completion done, uint32_t cost = 1);
+
+    // Blocks until no batch is queued or running
+    void drain();
+    // Waits for running batches; queued ones complete with an error
+    void stop();
+
+    // Throws std::out_of_range for an unknown rollup
+    [[nodiscard]] RollupMetrics metrics(RollupId rollup) const;
+
+private:
+    enum Stage : size_t { EXECUTE = 0, PROVE = 1, NUM_STAGES = 2 };
+
+    struct Batch {
+        uint64_t id;
+        RollupId rollup;
+        uint32_t cost;
+        Execute execute;
+        Completion done;
+        Clock::time_point submitted;
+        Clock::time_point deadline;
+        double start{0.0};
+        quantum::QuantumState state;
+    };
+    using BatchPtr = std::shared_ptr<Batch>;
+
+    struct Rollup {
+        RollupConfig config;
+        std::array<std::deque<BatchPtr>, NUM_STAGES> queues;
+        std::array<double, NUM_STAGES> last_finish{};
+        size_t outstanding{0};
+        size_t running{0};
+
+        std::shared_ptr<utils::Gauge> queued;
+        std::shared_ptr<utils::Counter> submitted;
+        std::shared_ptr<utils::Counter> completed;
+        std::shared_ptr<utils::Counter> failed;
+        std::shared_ptr<utils::Counter> rejected;
+        std::shared_ptr<utils::Counter> slo_misses;
+        std::shared_ptr<utils::Counter> executed_cost;
+        std::shared_ptr<utils::Histogram> latency;
+    };
+
+    struct StageState {
+        size_t slots{1};
+        size_t running{0};
+        double virtual_time{0.0};
+    };
+
+    // Caller holds mutex_
+    void enqueue(Stage stage, BatchPtr batch);
+    BatchPtr pick(Stage stage);
+
+    // Starts whatever the free slots allow
+    void dispatch();
+    void run(const BatchPtr& batch);
+    void proved(const BatchPtr& batch, Proof&& proof, std::exception_ptr error);
+    void finish(const BatchPtr& batch, Proof&& proof, std::exception_ptr error);
+
+    std::shared_ptr<ProvingService> prover_;
+    mutable std::mutex mutex_;
+    std::condition_variable idle_cv_;
+    std::map<RollupId, std::unique_ptr<Rollup>> rollups_;
+    std::array<StageState, NUM_STAGES> stages_;
+    size_t outstanding_{0};
+    bool stopping_{false};
+    uint64_t next_id_{1};
+};
+
+} // namespace rollup
+} // namespace quids
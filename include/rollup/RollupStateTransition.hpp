@@ -4,8 +4,11 @@
 #include <vector>
 #include <array>
 #include <memory>
+#include <span>
 #include "quantum/QuantumState.hpp"
 #include "blockchain/Transaction.hpp"
+#include "rollup/OptimisticExecutor.hpp"
+#include "rollup/ProvingService.hpp"
 #include "rollup/StateManager.hpp"
 #include "zkp/QZKPGenerator.hpp"
 
@@ -14,9 +17,14 @@ namespace rollup {
 
 using quids::zkp::QZKPGenerator;
 
+// Account leaf hashes written by a batch, in no particular order
+using StateDiff = std::vector<std::pair<std::string, StateTrie::Hash>>;
+
 struct StateTransitionProof {
     std::array<uint8_t, 32> pre_state_root;
+    // pre_state_root with state_diff written over it
     std::array<uint8_t, 32> post_state_root;
+    StateDiff state_diff;
     std::vector<blockchain::Transaction> transactions;
     std::vector<uint8_t> proof_data;
     uint64_t timestamp;
@@ -38,22 +46,56 @@ public:
     RollupStateTransition(RollupStateTransition&&) noexcept = default;
     RollupStateTransition& operator=(RollupStateTransition&&) noexcept = default;
 
-    // Core functionality
+    // With a proving service, generate_transition_proof returns at once
+    // with empty proof_data and the listener gets the proof for
+    // batch_number when it is done. A full queue falls back to proving
+    // inline, which is the only time production waits for a proof.
+    using ProofListener = std::function<void(uint64_t batch_number, std::vector<uint8_t>&& proof_data,
+                                             std::exception_ptr error)>;
+    void set_proving_service(std::shared_ptr<ProvingService> service, ProofListener listener);
+
+    // Core functionality. Executes the batch once, speculatively against
+    // a clone of state_manager, and takes the post-state root and diff
+    // from that run.
     [[nodiscard]] StateTransitionProof generate_transition_proof(
         const std::vector<blockchain::Transaction>& batch,
         const StateManager& state_manager
     );
 
+    // For a batch already executed against pre_state whose writes have
+    // not been applied to it: no re-execution, only the diff's trie
+    // paths are rehashed
+    [[nodiscard]] StateTransitionProof generate_transition_proof(
+        const std::vector<blockchain::Transaction>& batch,
+        const StateManager& pre_state,
+        const OptimisticExecutor::Result& execution
+    );
+
     [[nodiscard]] bool verify_transition(
         const StateManager& pre_state,
         const StateManager& post_state,
         const std::vector<blockchain::Transaction>& transactions
     );
 
+    // Checks the proof's roots against pre_state by re-applying its state
+    // diff, without executing the transactions
+    [[nodiscard]] bool verify_transition(
+        const StateManager& pre_state,
+        const StateTransitionProof& proof
+    ) const;
+
     // Batch validation
     [[nodiscard]] bool validate_batch(const std::vector<blockchain::Transaction>& batch) const;
     [[nodiscard]] bool verify_batch_ordering(const std::vector<blockchain::Transaction>& batch) const;
     
+    // What the ZKP is generated over
+    [[nodiscard]] static quantum::QuantumState encode_batch_to_quantum_state(
+        const std::vector<blockchain::Transaction>& batch
+    );
+    [[nodiscard]] static quantum::QuantumState encode_batch_to_quantum_state(
+        std::span<const blockchain::TransactionPtr> batch
+    );
+
     // Proof verification
     [[nodiscard]] bool verify_proof(const StateTransitionProof& proof) const;
     [[nodiscard]] bool verify_state_roots(
@@ -63,21 +105,25 @@ public:
 
 private:
     std::shared_ptr<QZKPGenerator> zkp_generator_;
+    OptimisticExecutor executor_;
+    std::shared_ptr<ProvingService> proving_service_;
+    ProofListener proof_listener_;
     uint64_t batch_number_{0};  // Add batch number counter
     
     // Internal helper methods
-    [[nodiscard]] quantum::QuantumState encode_batch_to_quantum_state(
-        const std::vector<blockchain::Transaction>& batch
-    ) const;
-    
     [[nodiscard]] bool verify_transaction_sequence(
         const std::vector<blockchain::Transaction>& transactions
     ) const;
     
-    [[nodiscard]] std::array<uint8_t, 32> compute_post_state_root(
+    // Proof around roots already computed; submits or runs the ZKP
+    [[nodiscard]] StateTransitionProof build_proof(
         const std::vector<blockchain::Transaction>& batch,
-        const StateManager& state_manager
+        const std::vector<uint8_t>& pre_root_bytes,
+        const StateTrie::Hash& post_state_root,
+        StateDiff state_diff
     );
+
+    [[nodiscard]] static StateDiff diff_of(const OptimisticExecutor::Result& execution);
     
     [[nodiscard]] std::array<uint8_t, 32> compute_batch_hash(
         const std::vector<blockchain::Transaction>& batch
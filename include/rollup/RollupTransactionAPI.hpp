@@ -3,17 +3,22 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <atomic>
 #include <cstdint>
 #include <future>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
 #include <chrono>
+#include <functional>
 #include "rollup/RollupPerformanceMetrics.hpp"
 #include "rollup/EnhancedRollupMLModel.hpp"
 #include "rollup/RollupTypes.hpp"
+#include "rollup/Mempool.hpp"
 #include "blockchain/Transaction.hpp"
+#include "utils/AdmissionController.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/WorkStealingPool.hpp"
 
 namespace quids {
 namespace rollup {
@@ -22,11 +27,14 @@ namespace rollup {
 class EnhancedRollupMLModel;
 
 struct TransactionBatch {
-    std::vector<blockchain::Transaction> transactions;
+    std::vector<blockchain::TransactionPtr> transactions;
     uint64_t batch_id;
     uint64_t timestamp;
     std::string validator;
     std::vector<uint8_t> merkle_root;
+    // Published parameters when the batch was cut; the whole batch runs
+    // under this one snapshot even if a newer one lands meanwhile
+    std::shared_ptr<const QuantumParameters> parameters;
     
     [[nodiscard]] bool is_valid() const;
     [[nodiscard]] size_t size() const { return transactions.size(); }
@@ -44,11 +52,17 @@ struct TransactionResult {
 
 class RollupTransactionAPI {
 public:
-    static constexpr size_t MAX_QUEUE_SIZE = 1000;
-    
+    // Receives each batch that passes validation; called from the drain
+    // tasks, so up to num_worker_threads calls may run at once
+    using BatchSink = std::function<void(const TransactionBatch& batch)>;
+
+    // A null mempool gets a private one; pass a shared one to feed other
+    // batch builders from the same pool
     explicit RollupTransactionAPI(
         std::shared_ptr<EnhancedRollupMLModel> ml_model,
-        size_t num_worker_threads = 4
+        size_t num_worker_threads = 4,
+        std::shared_ptr<Mempool> mempool = nullptr,
+        BatchSink sink = {}
     );
     ~RollupTransactionAPI();
 
@@ -61,8 +75,8 @@ public:
     RollupTransactionAPI& operator=(RollupTransactionAPI&&) noexcept = delete;
 
     // Transaction submission and management
-    bool submitTransaction(const blockchain::Transaction& tx);
-    bool submit_batch(const std::vector<blockchain::Transaction>& transactions);
+    bool submitTransaction(blockchain::TransactionPtr tx);
+    bool submit_batch(const std::vector<blockchain::TransactionPtr>& transactions);
     
     // Processing control
     void start_processing();
@@ -72,11 +86,20 @@ public:
     // Metrics and optimization
     [[nodiscard]] RollupPerformanceMetrics get_performance_metrics() const;
     void reset_metrics();
+    // Queues one inference at ML priority on the shared pool and returns at
+    // once; a call while one is in flight is dropped. The result replaces
+    // the published parameters when it finishes.
     void optimize_parameters();
+    // Latest published parameters; never waits on inference.
+    // Default-constructed until the first inference finishes.
+    [[nodiscard]] std::shared_ptr<const QuantumParameters> get_parameters() const;
+    // Bumped by every publish
+    [[nodiscard]] uint64_t get_parameters_version() const;
     
-    // ML model management
+    // ML model management. Swapping is atomic; an inference already
+    // running finishes on the model it started with.
     void set_ml_model(std::shared_ptr<EnhancedRollupMLModel> model);
-    [[nodiscard]] const EnhancedRollupMLModel& get_ml_model() const;
+    [[nodiscard]] std::shared_ptr<const EnhancedRollupMLModel> get_ml_model() const;
     
     // Transaction validation
     bool validate_transaction(const blockchain::Transaction& tx) const;
@@ -86,9 +109,15 @@ public:
     [[nodiscard]] size_t get_pending_batch_count() const;
     [[nodiscard]] size_t get_processed_batch_count() const;
     void clear_pending_batches();
+    [[nodiscard]] std::shared_ptr<Mempool> get_mempool() const { return mempool_; }
+    // Sheds submissions by lane once the pipeline backs up. The mempool is
+    // registered as a stage; the node adds the proving and L1 stages it
+    // owns, e.g. add_stage("proving", [p] { return p->utilization(); }).
+    [[nodiscard]] std::shared_ptr<utils::AdmissionController> admission() const { return admission_; }
 
 private:
-    void worker_thread();
+    void drain_batches();
+    void schedule_drain_locked();
     bool process_batch(const TransactionBatch& batch);
     std::string calculate_transaction_hash(const blockchain::Transaction& tx) const;
     bool is_overloaded() const;
@@ -99,15 +128,32 @@ private:
     void record_verification_time(std::chrono::microseconds time);
     
     // Member variables
-    std::shared_ptr<EnhancedRollupMLModel> ml_model_;
-    std::queue<TransactionBatch> batch_queue_;
+    std::atomic<std::shared_ptr<EnhancedRollupMLModel>> ml_model_;
+    // Written only by the inference task, read once per batch. Not
+    // lock-free on libstdc++: load and store briefly take a lock bit in
+    // the control-block pointer, never held across inference.
+    std::atomic<std::shared_ptr<const QuantumParameters>> parameters_;
+    std::atomic<uint64_t> parameters_version_{0};
+    std::atomic<bool> inference_running_{false};
+    std::shared_ptr<Mempool> mempool_;
+    std::shared_ptr<utils::AdmissionController> admission_;
+    BatchSink sink_;
     mutable std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
-    std::vector<std::thread> worker_threads_;
     
-    mutable RollupPerformanceMetrics current_metrics_;
-    mutable std::mutex metrics_mutex_;
-    std::chrono::system_clock::time_point last_metrics_update_;
+    // The mempool is drained by at most max_drains_ tasks on the shared pool,
+    // each cutting batches of up to MAX_BATCH_SIZE; active_drains_ is
+    // guarded by queue_mutex_
+    utils::WorkStealingPool& pool_;
+    size_t max_drains_;
+    size_t active_drains_{0};
+    
+    // Recorded lock-free from every submitting thread; also attached to
+    // the global metrics registry
+    std::shared_ptr<utils::Histogram> latency_;
+    std::shared_ptr<utils::Histogram> proof_time_;
+    std::shared_ptr<utils::Histogram> verification_time_;
+    // steady_clock at the last reset_metrics(), in nanoseconds
+    std::atomic<int64_t> metrics_epoch_ns_;
     bool should_stop_;
     
     // Constants
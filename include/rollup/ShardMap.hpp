@@ -0,0 +1,102 @@
+#pragma once
+
+#include "rollup/CrossChainState.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Assigns accounts to child chains by range.
+//
+// An account's key is the first 8 bytes of BLAKE3 of its address, so every
+// node puts it in the same place. The key space is cut into contiguous
+// ranges, each owned by one chain. record() counts load for each half of
+// each range. When a CrossChainState says the chains are out of balance,
+// rebalance() splits the busiest range of the most loaded chain and moves
+// one half to the least loaded chain. It moves the half that comes closer
+// to half of that chain's recorded load. A chain added with add_chain()
+// gets a share the same way. Every change bumps the epoch, and adjoining
+// ranges of one chain are merged back together.
+//
+// Chain i of a CrossChainState is chains()[i], in the order chains were
+// added. Lookups and record() take a shared lock; changes take it
+// exclusively.
+class ShardMap {
+public:
+    using ChainId = uint32_t;
+    using Key = uint64_t;
+
+    struct Range {
+        Key first{0};
+        Key last{0};  // inclusive
+        ChainId chain{0};
+        bool operator==(const Range&) const = default;
+    };
+
+    // A range that changed owner
+    struct Migration {
+        Range range;
+        ChainId from{0};
+        uint64_t epoch{0};
+    };
+
+    // The whole key space starts on root
+    explicit ShardMap(ChainId root);
+
+    ShardMap(const ShardMap&) = delete;
+    ShardMap& operator=(const ShardMap&) = delete;
+
+    [[nodiscard]] static Key key_of(std::string_view account);
+
+    [[nodiscard]] ChainId chain_for(std::string_view account) const;
+    [[nodiscard]] ChainId chain_for_key(Key key) const;
+
+    // Counts weight against the account's range
+    void record(std::string_view account, uint64_t weight = 1);
+
+    // Gives a new chain half of the busiest range. nullopt if the chain is
+    // already known or no range can be split.
+    std::optional<Migration> add_chain(ChainId chain);
+
+    // nullopt unless state.needs_rebalancing() and a range can move.
+    // Throws std::invalid_argument if state covers a different number of
+    // chains.
+    std::optional<Migration> rebalance(const CrossChainState& state);
+
+    [[nodiscard]] std::vector<ChainId> chains() const;
+    [[nodiscard]] std::vector<Range> ranges() const;
+    [[nodiscard]] uint64_t epoch() const;
+
+private:
+    struct Slot {
+        Key first;
+        ChainId chain;
+        // Load below and from the midpoint of the range
+        std::atomic<uint64_t> lower{0};
+        std::atomic<uint64_t> upper{0};
+
+        Slot(Key first_, ChainId chain_) : first(first_), chain(chain_) {}
+    };
+
+    // Caller holds mutex_
+    size_t slot_index(Key key) const;
+    Key last_of(size_t index) const;
+    // Splits the slot at index and hands the better half to chain; false
+    // when the slot holds a single key
+    bool split_to(size_t index, ChainId chain, uint64_t target, Migration& out);
+    void merge_neighbours();
+
+    mutable std::shared_mutex mutex_;
+    std::vector<std::unique_ptr<Slot>> slots_;  // by first key, first is 0
+    std::vector<ChainId> chains_;
+    uint64_t epoch_{0};
+};
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "rollup/CrossRollupBridge.hpp"
+#include "rollup/Mempool.hpp"
+#include "rollup/ShardMap.hpp"
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Sends transactions to the child chain that owns their sender.
+//
+// Each chain in the ShardMap gets its own Mempool. submit() queues a
+// transaction on the pool of its sender's chain and records the load
+// there. A transaction whose recipient lives on another chain executes on
+// the sender's chain. When it commits, the credit goes to the recipient's
+// chain as a CrossRollupBridge message whose payload is the serialized
+// transaction. When the map moves a range, apply() moves that range's
+// pending transactions to the new owner's pool.
+//
+// Wire a child chain in with add_chain() after
+// OptimizedAIBlock::spawnChildChain(). Call rebalance() with the
+// CrossChainState from each metrics interval.
+class ShardRouter {
+public:
+    using ChainId = ShardMap::ChainId;
+    using Transaction = Mempool::Transaction;
+    using TransactionPtr = Mempool::TransactionPtr;
+
+    ShardRouter(std::shared_ptr<ShardMap> map,
+                std::shared_ptr<CrossRollupBridge> bridge,
+                Mempool::Config pool_config = {});
+
+    Mempool::AddResult submit(TransactionPtr tx);
+
+    [[nodiscard]] ChainId chain_of(const Transaction& tx) const;
+    [[nodiscard]] bool is_cross_shard(const Transaction& tx) const;
+
+    // The pool of one chain, created on first use
+    Mempool& mempool(ChainId chain);
+
+    // Prunes the sender's pool and bridges the credit of a cross-shard
+    // transaction; returns the bridge nonce when one was sent
+    std::optional<uint64_t> on_committed(const Transaction& tx);
+
+    // Moves the pending transactions of a migrated range; returns how many
+    size_t apply(const ShardMap::Migration& migration);
+
+    // add_chain() or rebalance() on the map, followed by apply()
+    std::optional<ShardMap::Migration> add_chain(ChainId chain);
+    std::optional<ShardMap::Migration> rebalance(const CrossChainState& state);
+
+    [[nodiscard]] const ShardMap& map() const { return *map_; }
+
+private:
+    std::shared_ptr<ShardMap> map_;
+    std::shared_ptr<CrossRollupBridge> bridge_;
+    const Mempool::Config pool_config_;
+
+    // Shared by submit(), exclusive while a range changes hands, so no
+    // transaction lands in a pool its range just left
+    std::shared_mutex routing_mutex_;
+    std::mutex pools_mutex_;
+    std::unordered_map<ChainId, std::unique_ptr<Mempool>> pools_;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -8,22 +8,26 @@
 #include <optional>
 #include <map>
 #include <deque>
+#include <functional>
 #include "blockchain/Transaction.hpp"
 #include "evm/Address.hpp"
+#include "evm/CodeStore.hpp"
 #include "evm/uint256.hpp"
+#include "rollup/StateTrie.hpp"
 
 // Custom hasher for std::vector<unsigned char>
 #include <cstddef>
+#include <span>
+#include <string_view>
 
 namespace std {
     template<>
     struct hash<std::vector<unsigned char>> {
+        // Hash the bytes in one pass with the library's string hash rather
+        // than a byte-at-a-time polynomial, which clusters on short keys
         size_t operator()(const std::vector<unsigned char>& v) const {
-            size_t hash_val = 0;
-            for (auto byte : v) {
-                hash_val = hash_val * 31u + byte;
-            }
-            return hash_val;
+            return hash<std::string_view>{}(
+                std::string_view(reinterpret_cast<const char*>(v.data()), v.size()));
         }
     };
 }
@@ -31,7 +35,9 @@ namespace std {
 namespace quids {
 namespace rollup {
 
-
+class StateStore;
+class HistoryIndexer;
+struct StateWitness;
 
 class StateManager {
 public:
@@ -39,31 +45,103 @@ public:
         std::string address;
         uint64_t balance;  // Changed from uint256_t to uint64_t for now
         uint64_t nonce;
-        std::vector<uint8_t> code;
+        // Held once per distinct code by evm::CodeStore
+        evm::CodeRef code;
         std::unordered_map<std::vector<uint8_t>, std::vector<uint8_t>> storage;
-        
-        std::vector<uint8_t> serialize() const;
-        static std::optional<Account> deserialize(const std::vector<uint8_t>& data);
+
+        // Looks up code written by hash that no account holds in memory any more
+        using CodeLoader = std::function<std::optional<std::vector<uint8_t>>(const evm::Hash256&)>;
+
+        // Self-contained by default. With code_by_hash only the code hash is
+        // written, for stores that keep the code itself once under that hash.
+        std::vector<uint8_t> serialize(bool code_by_hash = false) const;
+        // Code written by hash is taken from evm::CodeStore, else from
+        // load_code; without either the account does not deserialize
+        static std::optional<Account> deserialize(const std::vector<uint8_t>& data,
+                                                  const CodeLoader& load_code = {});
+    };
+
+    // Immutable view of the state at one point in time. Taking one is O(1)
+    // and never blocks writers for longer than the capture; nodes are shared
+    // with the live state until either side writes to them.
+    class Snapshot {
+    public:
+        Snapshot();
+
+        uint64_t version() const;
+        size_t account_count() const;
+        std::optional<Account> get_account(const std::string& address) const;
+        // In place, without copying its storage; valid as long as the snapshot
+        const Account* find_account(const std::string& address) const;
+        uint64_t get_balance(const std::string& address) const;
+        uint64_t get_nonce(const std::string& address) const;
+        std::vector<uint8_t> get_state_root() const;
+        std::optional<StateTrie::Proof> prove_account(const std::string& address) const;
+        // nullopt if the account exists
+        std::optional<StateTrie::AbsenceProof> prove_absent(const std::string& address) const;
+        // One proof for all of `addresses`; nullopt if any is missing
+        std::optional<StateTrie::MultiProof> prove_accounts(const std::vector<std::string>& addresses) const;
+        void for_each_account(const std::function<void(const std::string&, const Account&)>& fn) const;
+
+    private:
+        friend class StateManager;
+        struct Data;
+
+        explicit Snapshot(std::shared_ptr<const Data> data);
+
+        std::shared_ptr<const Data> data_;
     };
 
     StateManager();
+    // Starts from `snapshot`, sharing its nodes
+    explicit StateManager(const Snapshot& snapshot);
+    // Opens the last committed state of `store` and writes every later
+    // commit_state() back to it. Only the trie is built up front; accounts
+    // are read through the store's cache when first used and stay resident
+    // from then on, so memory follows the accounts in use, not the state.
+    explicit StateManager(std::shared_ptr<StateStore> store);
     ~StateManager();
 
     // State management
     bool apply_transaction(const blockchain::Transaction& tx);
     bool verify_transaction(const blockchain::Transaction& tx) const;
     bool revert_transaction(const blockchain::Transaction& tx);
+    // Retains the committed state as a new version
     bool commit_state();
+    // Discards changes since the last commit_state()
     bool rollback_state();
 
-    // State queries
+    // Versioned views
+    Snapshot snapshot() const;
+    std::optional<Snapshot> at(uint64_t version) const;  // recent commits only
+    uint64_t version() const;
+    // How many commits at() can reach, at least 1; 64 by default. Trie
+    // nodes no retained version or live snapshot shares are freed as the
+    // oldest versions drop out.
+    void set_retained_versions(size_t versions);
+
+    // State queries. Balances and nonces are read without the lock from a
+    // sharded account index, except on states built from a snapshot or
+    // loaded from a store, or while a witness records; each reflects every
+    // call that returned.
     uint64_t get_balance(const std::string& address) const;
     uint64_t get_nonce(const std::string& address) const;
     std::vector<uint8_t> get_storage(const ::evm::Address& address, const std::vector<uint8_t>& key) const;
     std::vector<uint8_t> get_code(const ::evm::Address& address) const;
+    // Live root of the account trie
     std::vector<uint8_t> get_state_root() const;
     std::vector<uint8_t> get_previous_root() const;
+    // Root the trie would have with `leaves` written over it, rehashing
+    // only their paths; the live state is left as it is
+    StateTrie::Hash root_after(const std::vector<std::pair<std::string, StateTrie::Hash>>& leaves) const;
+    // Membership proof of `address`; `root` receives the root it opens to
+    std::optional<StateTrie::Proof> prove_account(const std::string& address,
+                                                  std::vector<uint8_t>& root) const;
+    // Copies the account, storage included; prefer visit_account()
     std::optional<Account> get_account(const std::string& address) const;
+    // Calls fn on the account in place, under the shared lock; false if
+    // there is no such account. fn must not call back into this state.
+    bool visit_account(const std::string& address, const std::function<void(const Account&)>& fn) const;
     std::map<std::string, Account> get_accounts_snapshot() const;
 
     // State modifications
@@ -73,14 +151,41 @@ public:
     bool set_code(const ::evm::Address& address, const std::vector<uint8_t>& code);
     void add_account(std::string address, Account account);
 
-    // Transaction management
-    bool apply_transactions(const std::vector<blockchain::Transaction>& txs);
-    std::vector<blockchain::Transaction> get_account_history(const std::string& address) const;
+    // Transaction management. Same outcome as applying txs one by one:
+    // invalid ones are skipped, and the batch stops at the first valid one
+    // whose recipient does not exist, returning false. Transactions that
+    // share no account are applied side by side.
+    bool apply_transactions(std::span<const blockchain::TransactionPtr> txs);
+    // Each commit_state() hands the transactions recorded since the last
+    // one to `indexer` as one block, numbered by the new version. Without
+    // an indexer nothing is recorded.
+    void set_history_indexer(std::shared_ptr<HistoryIndexer> indexer);
     void record_transaction(const std::string& address, const blockchain::Transaction& tx);
 
+    // O(1); prefer snapshot() for read-only use
     std::unique_ptr<StateManager> clone() const;
 
+    // Witness recording. From begin_witness() every account this state,
+    // or a clone taken since, reads or writes is noted; take_witness()
+    // returns those accounts as they were at begin_witness(), proven
+    // against that root, and stops recording.
+    void begin_witness();
+    StateWitness take_witness();
+    // A state holding only what `witness` proves, for replaying the run
+    // it was recorded from; nullptr when the proofs do not open to its
+    // pre_root. Touching an account outside it throws std::out_of_range.
+    static std::unique_ptr<StateManager> from_witness(const StateWitness& witness);
+
+    // Leaf value committed to the trie for one account
+    static StateTrie::Hash account_hash(const Account& account);
+
 private:
+    // Callers must hold mutex_
+    bool verify_transaction_locked(const blockchain::Transaction& tx) const;
+    bool apply_transaction_locked(const blockchain::Transaction& tx);
+    // apply_transactions() over groups of transactions that share accounts
+    bool apply_grouped_locked(std::span<const blockchain::TransactionPtr> txs);
+
     struct Impl;
     std::unique_ptr<Impl> impl_;
     mutable std::shared_mutex mutex_;
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "rollup/StateManager.hpp"
+#include "storage/PersistentStorage.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace quids {
+namespace rollup {
+
+// Keeps history within a fixed depth behind the head.
+//
+// Account state itself is stored once, at its latest value (StateStore
+// overwrites in place), and the in-memory trie is copy-on-write with
+// reference-counted nodes, so what grows is per-block history: block data,
+// proofs, transaction bodies, the account-history index and the committed
+// versions StateManager keeps for at(). Archive keeps all of it on disk.
+// Full keeps the last `depth` blocks.
+//
+// The head is reported with on_head(); a worker then drops what fell out
+// of the window in steps of a bounded size, with step_interval between
+// them, so pruning is an even trickle of small writes rather than a burst
+// that stalls writers. Blocks go first. The account-history index is keyed
+// by address, so it is swept one address range at a time, and a new sweep
+// starts only once the last one finished.
+class StatePruner {
+public:
+    enum class Mode : uint8_t {
+        Archive,  // nothing on disk is dropped
+        Full      // history older than `depth` blocks is dropped
+    };
+
+    struct Config {
+        Mode mode{Mode::Full};
+        uint64_t depth{100000};          // blocks kept behind the head
+        size_t retained_versions{64};    // StateManager::at() reach, either mode
+        size_t blocks_per_step{64};
+        size_t addresses_per_step{1024};
+        std::chrono::milliseconds step_interval{100};
+    };
+
+    struct Stats {
+        uint64_t pruned_below{0};  // blocks below this are gone, account history aside
+        uint64_t pruned_blocks{0};
+        uint64_t steps{0};
+        uint64_t history_sweeps{0};  // full passes over the account index
+    };
+
+    // state may be null when only the disk is pruned
+    StatePruner(std::shared_ptr<storage::PersistentStorage> storage, std::shared_ptr<StateManager> state,
+                const Config& config);
+    StatePruner(std::shared_ptr<storage::PersistentStorage> storage, std::shared_ptr<StateManager> state);
+    ~StatePruner();
+
+    StatePruner(const StatePruner&) = delete;
+    StatePruner& operator=(const StatePruner&) = delete;
+
+    // Latest finalized block; no-op in Archive mode
+    void on_head(uint64_t head);
+    // Blocks until everything outside the window for the last head is gone
+    void drain();
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    // One bounded step; false when there was nothing to do
+    bool step(uint64_t target);
+    void worker_loop();
+
+    std::shared_ptr<storage::PersistentStorage> storage_;
+    const Config config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    uint64_t target_{0};  // blocks below this should go
+    bool idle_{true};
+    bool stop_{false};
+    Stats stats_;
+
+    // Worker only
+    std::optional<std::string> sweep_cursor_;  // set while a sweep is under way
+    uint64_t sweep_target_{0};
+    uint64_t swept_below_{0};
+
+    std::thread worker_;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "rollup/StateManager.hpp"
+#include "storage/PersistentStorage.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Durable tier for committed account state.
+//
+// Reads go through a CLOCK cache of bounded size, then to the accounts
+// queued for writing, then to PersistentStorage. commit() only queues the
+// changed accounts; a background flusher coalesces everything queued into
+// one WriteBatch, so a run of commits costs one WAL sync. The committed
+// version and root are written in the same batch, which lets a restart
+// load the state directly instead of replaying history. Contract code is
+// stored once by hash next to the accounts, which refer to it by hash.
+//
+// With a checkpoint interval the flusher turns into a periodic
+// checkpointer: each write covers only the accounts dirtied since the
+// previous one, still with the head in the same batch, so a restart resumes
+// from the last checkpoint and the caller re-applies blocks after
+// durable_version(). The interval and max_lag_versions bound that tail.
+class StateStore {
+public:
+    using Account = StateManager::Account;
+    // nullopt = account deleted
+    using Change = std::pair<std::string, std::optional<Account>>;
+
+    struct Config {
+        size_t cache_capacity{1 << 16};  // accounts
+        bool async_flush{true};          // false = commit() writes inline
+        bool sync_writes{true};          // fsync the WAL once per flushed batch
+        // Queued commits are held and coalesced for up to this long, so an
+        // account written every block reaches disk once per interval;
+        // zero writes whenever the flusher wakes
+        std::chrono::milliseconds checkpoint_interval{0};
+        // commit() blocks while more versions than this are not yet on
+        // disk, bounding what a crash can lose when writes fall behind;
+        // zero leaves it unbounded
+        uint64_t max_lag_versions{0};
+    };
+
+    struct Head {
+        uint64_t version{0};
+        std::vector<uint8_t> state_root;
+    };
+
+    struct Stats {
+        uint64_t cache_hits{0};
+        uint64_t cache_misses{0};
+        uint64_t evictions{0};
+        uint64_t flushed_batches{0};
+        uint64_t flushed_accounts{0};
+        uint64_t failed_flushes{0};
+        uint64_t lag_stalls{0};  // commits held back by max_lag_versions
+    };
+
+    StateStore(std::shared_ptr<storage::PersistentStorage> storage, const Config& config);
+    explicit StateStore(std::shared_ptr<storage::PersistentStorage> storage);
+    ~StateStore();
+
+    StateStore(const StateStore&) = delete;
+    StateStore& operator=(const StateStore&) = delete;
+
+    std::optional<Account> get(const std::string& address);
+
+    // Queues one committed version; durable once flush() returns true
+    void commit(uint64_t version, std::vector<uint8_t> state_root, std::vector<Change> changes);
+
+    // Blocks until everything queued so far is written
+    bool flush();
+
+    // Last version handed to commit() and last version on disk
+    uint64_t committed_version() const;
+    uint64_t durable_version() const;
+
+    // Head as stored on disk, if anything was ever committed
+    std::optional<Head> load_head();
+
+    // Every durable account, in key order; flush() first to include queued ones
+    void for_each_account(const std::function<void(const std::string&, Account)>& fn);
+
+    Stats stats() const;
+
+    // Whole-state transfer for bootstrapping a node from a snapshot, in
+    // place of one commit per account. Export writes the accounts as
+    // sorted, non-overlapping SST chunks, one writer per chunk in
+    // parallel, plus a manifest with the version, the root and each
+    // chunk's account count.
+    struct SnapshotChunk {
+        std::string file;  // relative to the snapshot directory
+        uint64_t accounts{0};
+    };
+
+    struct SnapshotManifest {
+        Head head;
+        std::vector<SnapshotChunk> chunks;
+    };
+
+    static constexpr size_t DEFAULT_ACCOUNTS_PER_CHUNK = 1 << 20;
+
+    static std::optional<SnapshotManifest> export_snapshot(const StateManager::Snapshot& snapshot,
+                                                           const std::string& dir,
+                                                           size_t accounts_per_chunk = DEFAULT_ACCOUNTS_PER_CHUNK);
+    static std::optional<SnapshotManifest> read_manifest(const std::string& dir);
+
+    // Imports an exported snapshot into a store nothing was committed to.
+    // Chunks are read in parallel and each is folded into a trie as soon
+    // as it is read, so the root is checked against the manifest without a
+    // second pass; only then are the files ingested whole and the head
+    // written. With move_files the chunks are hard-linked instead of
+    // copied and the directory should not be reused. False if the store
+    // is not empty, a chunk is unreadable or out of order, or the root
+    // does not match.
+    bool import_snapshot(const std::string& dir, bool move_files = false);
+
+private:
+    struct Pending {
+        uint64_t seq;
+        std::optional<Account> value;
+    };
+
+    struct Batch {
+        uint64_t seq;
+        Head head;
+        std::vector<Change> changes;
+    };
+
+    class ClockCache;
+
+    void flusher_loop();
+    bool write_batches(std::deque<Batch>& batches);
+    // Reads code the accounts refer to
+    Account::CodeLoader code_loader() const;
+
+    std::shared_ptr<storage::PersistentStorage> storage_;
+    Config config_;
+    std::unique_ptr<ClockCache> cache_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    // Latest queued value per account, until its batch is on disk
+    std::unordered_map<std::string, Pending> unflushed_;
+    std::deque<Batch> queue_;
+    uint64_t next_seq_{1};
+    uint64_t flushed_seq_{0};
+    uint64_t committed_version_{0};
+    uint64_t durable_version_{0};
+    bool writing_{false};
+    bool urgent_{false};  // someone waits on the queue; skip the interval
+    bool stop_{false};
+    std::chrono::steady_clock::time_point last_write_{};
+    Stats stats_;
+    // Keys of code known to be on disk; only the writer (writing_) touches it
+    std::unordered_set<std::string> stored_code_;
+
+    std::thread flusher_;
+};
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Authenticated hexary trie over BLAKE3(address).
+//
+// A leaf sits at the first depth where its path prefix is unique and a
+// branch with a single leaf below it is collapsed, so the shape depends
+// only on the set of keys, never on insertion order. Updates only mark
+// their own path dirty; root() rehashes the dirty nodes, fanning the top
+// of the trie out over the shared pool.
+//
+// Copies share nodes. A copy hashes the source first so shared nodes are
+// always clean, and an update copies the shared nodes on its path before
+// marking them dirty, leaving other copies untouched.
+//
+// A trie can also be grafted together from proofs, for stateless
+// verification: it holds the nodes on the proven paths and only the hashes
+// of the subtrees beside them. Updates and erases on a proven path work as
+// usual; one that runs into an unproven subtree throws std::out_of_range.
+class StateTrie {
+public:
+    using Hash = std::array<uint8_t, 32>;
+
+    struct ProofStep {
+        uint16_t bitmap{0};          // occupied children of this branch
+        uint8_t nibble{0};           // child on the path
+        std::vector<Hash> siblings;  // hashes of the other occupied children, in nibble order
+    };
+
+    // Branch steps from the leaf up to the root
+    struct Proof {
+        std::vector<ProofStep> steps;
+    };
+
+    // Shows a key is not in the trie: its path either ends at an empty
+    // child of the deepest step, whose siblings are then all its occupied
+    // children, or at the leaf of another key sharing the prefix
+    struct AbsenceProof {
+        std::vector<ProofStep> steps;   // deepest first, as in Proof
+        std::optional<Hash> leaf_path;  // the other key's leaf, if any
+        Hash leaf_value_hash{};
+    };
+
+    // Membership of many keys at once. The union of their paths is walked
+    // once, depth first in nibble order, so a branch shared by several
+    // keys appears once however many of them pass through it.
+    struct MultiProof {
+        struct Branch {
+            uint16_t bitmap{0};   // occupied children
+            uint16_t descend{0};  // children on a proven path
+            uint16_t leaves{0};   // of those, the ones that are a proven leaf
+        };
+        std::vector<Branch> branches;
+        // Hashes of the occupied children not descended into, in walk order
+        std::vector<Hash> hashes;
+    };
+
+    StateTrie();
+    ~StateTrie();
+
+    StateTrie(const StateTrie& other);
+    StateTrie& operator=(const StateTrie& other);
+
+    void update(const std::string& key, const Hash& value_hash);
+    bool erase(const std::string& key);
+    void clear();
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool contains(const std::string& key) const;
+
+    // Rehashes dirty nodes; safe to call concurrently with other readers
+    Hash root() const;
+
+    std::optional<Proof> prove(const std::string& key) const;
+    static bool verify(const Hash& root, const std::string& key,
+                       const Hash& value_hash, const Proof& proof);
+
+    std::optional<AbsenceProof> prove_absent(const std::string& key) const;
+    static bool verify_absent(const Hash& root, const std::string& key,
+                              const AbsenceProof& proof);
+
+    // nullopt when `keys` is empty or any of them is missing
+    std::optional<MultiProof> prove_many(const std::vector<std::string>& keys) const;
+    static bool verify_many(const Hash& root, const std::vector<std::pair<std::string, Hash>>& leaves,
+                            const MultiProof& proof);
+
+    // Add a proven path to a partial trie. False when the proof does not
+    // fit the paths grafted so far; whether they open to the expected root
+    // is for the caller to check against root().
+    bool graft(const std::string& key, const Hash& value_hash, const Proof& proof);
+    bool graft_absent(const std::string& key, const AbsenceProof& proof);
+
+    static Hash path_of(const std::string& key);
+    static Hash hash_bytes(const uint8_t* data, size_t len);
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+
+    static uint8_t nibble_at(const Hash& path, size_t depth) {
+        uint8_t byte = path[depth / 2];
+        return (depth % 2 == 0) ? static_cast<uint8_t>(byte >> 4) : static_cast<uint8_t>(byte & 0x0F);
+    }
+
+    static void make_unique(NodePtr& node);
+    const Node* find_leaf(const Hash& path) const;
+
+    static Hash leaf_hash(const Hash& path, const Hash& value_hash);
+    static Hash branch_hash(uint16_t bitmap, const std::vector<Hash>& children);
+    // Folds `steps[first..]` over `current`, the hash found at their depth
+    static bool climb(const Hash& path, Hash& current, const std::vector<ProofStep>& steps, size_t first);
+    static ProofStep step_at(const Node& node, uint8_t nibble);
+    using PathRange = std::pair<const Hash*, const Hash*>;
+    static bool walk_many(const Node& node, size_t depth, PathRange paths, MultiProof& proof);
+    // Branch nodes for `steps` down `path`; the slot below the deepest, or
+    // nullptr when they conflict with what is there
+    NodePtr* graft_steps(const Hash& path, const std::vector<ProofStep>& steps);
+    bool graft_leaf(NodePtr& slot, const Hash& path, const Hash& value_hash);
+
+    void insert(NodePtr& slot, size_t depth, const Hash& path, const Hash& value_hash);
+    bool remove(NodePtr& slot, size_t depth, const Hash& path);
+    static const Hash& rehash(Node& node);
+
+    NodePtr root_;
+    size_t size_{0};
+    mutable std::mutex hash_mutex_;
+};
+
+} // namespace rollup
+} // namespace quids
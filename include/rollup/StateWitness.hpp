@@ -0,0 +1,38 @@
+#pragma once
+
+#include "rollup/StateManager.hpp"
+#include "rollup/StateTrie.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Everything a run over a state read or wrote, as it was before the run,
+// with the trie proofs that open it against `pre_root`. Enough to replay
+// the run with StateManager::from_witness() and no state database.
+//
+// Contract storage is committed inside the account leaf, so an account's
+// proof also covers all of its storage slots.
+struct StateWitness {
+    struct Entry {
+        std::string address;
+        // nullopt: the account did not exist, and `absence` shows it
+        std::optional<StateManager::Account> account;
+        StateTrie::Proof proof;
+        StateTrie::AbsenceProof absence;
+    };
+
+    StateTrie::Hash pre_root{};
+    std::vector<Entry> entries;  // in address order
+
+    // Proof hashes are stored once and referenced by index: the proofs of
+    // a block's accounts share most of the steps near the root
+    std::vector<uint8_t> serialize() const;
+    static std::optional<StateWitness> deserialize(const std::vector<uint8_t>& data);
+};
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "evm/Interpreter.hpp"
+#include "evm/Precompiles.hpp"
+#include "rollup/StateManager.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+// Dry runs for wallets: simulate() reports what a call or transfer would
+// do on the latest state, and estimate_gas() finds the least gas limit it
+// succeeds with.
+//
+// A run takes a StateManager::Snapshot and executes on an overlay over it.
+// Reads fall through to the snapshot, which is immutable, so no lock is
+// held on the live state. Writes stay in the overlay and are dropped with
+// it. Nothing is signed, charged for gas or committed, and the sender's
+// nonce is not checked.
+//
+// Estimation first runs at the cap. It then probes parallel_probes
+// candidate limits per round on the shared pool, at a priority below
+// block execution. The first round tries exactly the gas the capped run
+// used, where most calls settle. Results are cached by (state root,
+// call); a root names one state, so an entry never goes stale.
+class TransactionSimulator {
+public:
+    static constexpr uint64_t TX_GAS = 21000;
+    static constexpr uint64_t CREATE_GAS = 32000;
+    static constexpr uint64_t ZERO_BYTE_GAS = 4;
+    static constexpr uint64_t NONZERO_BYTE_GAS = 16;
+    static constexpr uint64_t CODE_DEPOSIT_BYTE_GAS = 200;
+    static constexpr size_t MAX_CODE_SIZE = 24576;
+
+    struct Call {
+        std::string from;
+        // Empty deploys data as init code
+        std::string to;
+        uint64_t value{0};
+        std::vector<uint8_t> data;
+        // 0 for Config::max_gas
+        uint64_t gas_limit{0};
+    };
+
+    struct Result {
+        evm::InterpreterStatus status{evm::InterpreterStatus::Success};
+        uint64_t gas_used{0};
+        // Return or revert data
+        std::vector<uint8_t> output;
+        std::vector<evm::LogEntry> logs;
+        // Set for deployments that succeed
+        std::string contract_address;
+        // Why it failed before any code ran, e.g. the value is not covered
+        std::string error;
+
+        [[nodiscard]] bool success() const { return status == evm::InterpreterStatus::Success; }
+    };
+
+    struct Estimate {
+        // Least limit that succeeds; 0 when the call fails even at the cap
+        uint64_t gas{0};
+        // The run at gas, or at the cap when it fails there
+        Result result;
+        size_t probes{0};
+    };
+
+    struct Config {
+        uint64_t max_gas{30'000'000};
+        size_t parallel_probes{8};
+        size_t cache_entries{4096};
+    };
+
+    struct Stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t runs{0};
+    };
+
+    TransactionSimulator(std::shared_ptr<const StateManager> state, const Config& config,
+                         utils::WorkStealingPool& pool = utils::WorkStealingPool::global());
+
+    TransactionSimulator(const TransactionSimulator&) = delete;
+    TransactionSimulator& operator=(const TransactionSimulator&) = delete;
+
+    // On the latest state, at the call's limit
+    [[nodiscard]] std::shared_ptr<const Result> simulate(const Call& call);
+    [[nodiscard]] std::shared_ptr<const Estimate> estimate_gas(const Call& call);
+
+    // Uncached forms, on a given snapshot
+    [[nodiscard]] Result run(const StateManager::Snapshot& snapshot, const Call& call, uint64_t gas_limit) const;
+    [[nodiscard]] Estimate estimate(const StateManager::Snapshot& snapshot, const Call& call) const;
+
+    // Charged before any code runs
+    [[nodiscard]] static uint64_t intrinsic_gas(const Call& call);
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    // Bounded LRU, most recently used first
+    template <typename T>
+    class Cache {
+    public:
+        explicit Cache(size_t capacity) : capacity_(capacity) {}
+
+        std::shared_ptr<const T> find(const std::string& key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it == index_.end()) {
+                return nullptr;
+            }
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->second;
+        }
+
+        void insert(const std::string& key, std::shared_ptr<const T> value) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (capacity_ == 0 || index_.count(key)) {
+                return;
+            }
+            entries_.emplace_front(key, std::move(value));
+            index_.emplace(key, entries_.begin());
+            if (entries_.size() > capacity_) {
+                index_.erase(entries_.back().first);
+                entries_.pop_back();
+            }
+        }
+
+    private:
+        using Entry = std::pair<std::string, std::shared_ptr<const T>>;
+
+        const size_t capacity_;
+        std::mutex mutex_;
+        std::list<Entry> entries_;
+        std::unordered_map<std::string, typename std::list<Entry>::iterator> index_;
+    };
+
+    uint64_t cap_of(const Call& call) const;
+    static std::string key_of(const StateManager::Snapshot& snapshot, const Call& call);
+
+    std::shared_ptr<const StateManager> state_;
+    const Config config_;
+    utils::WorkStealingPool& pool_;
+    const evm::Precompiles precompiles_;
+
+    Cache<Result> results_;
+    Cache<Estimate> estimates_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    mutable std::atomic<uint64_t> runs_{0};
+};
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include "utils/WorkStealingPool.hpp"
+
+namespace quids {
+namespace rollup {
+
+// Withdrawals from L2 to L1, committed a batch at a time.
+//
+// Requests are queued as they come in and sealed into a batch whose Merkle
+// root goes to L1 with the next state commitment (see
+// RollupContract::submit_state_commitment). Leaves are hashed in parallel
+// on the work-stealing pool. Users then claim on L1 with their withdrawal
+// and its inclusion proof against that root, so L1 stores one root per
+// batch rather than processing each withdrawal, and a claim costs one
+// proof check.
+//
+// Ids are assigned in queue order and batches cover consecutive ids. The
+// last retained_batches sealed batches are kept to serve proofs; claims
+// for older ones have to come from an archive.
+class WithdrawalBatcher {
+public:
+    using Hash = quids::crypto::MerkleHash;
+
+    struct Withdrawal {
+        // Unique per batcher; L1 marks it claimed so it pays out once
+        uint64_t id{0};
+        std::string l2_address;
+        std::string l1_address;
+        uint64_t amount{0};
+        uint64_t timestamp{0};
+
+        // What the leaf commits to; L1 rebuilds it from the claim
+        [[nodiscard]] std::vector<uint8_t> encode() const;
+        bool operator==(const Withdrawal& other) const = default;
+    };
+
+    struct Batch {
+        uint64_t number{0};
+        Hash root{};
+        uint64_t first_id{0};
+        size_t count{0};
+    };
+
+    // Everything L1 needs to pay one withdrawal out of a committed batch
+    struct Claim {
+        uint64_t batch{0};
+        Withdrawal withdrawal;
+        quids::crypto::MerkleProof proof;
+    };
+
+    struct Config {
+        size_t max_batch{4096};
+        size_t retained_batches{256};
+    };
+
+    explicit WithdrawalBatcher(const Config& config,
+                               utils::WorkStealingPool& pool = utils::WorkStealingPool::global());
+
+    WithdrawalBatcher(const WithdrawalBatcher&) = delete;
+    WithdrawalBatcher& operator=(const WithdrawalBatcher&) = delete;
+
+    // Returns the withdrawal's id
+    uint64_t enqueue(std::string l2_address, std::string l1_address, uint64_t amount, uint64_t timestamp);
+    [[nodiscard]] size_t pending() const;
+
+    // Seals up to max_batch queued withdrawals, oldest first; nullopt when
+    // none are queued
+    std::optional<Batch> seal();
+
+    [[nodiscard]] std::optional<Batch> batch(uint64_t number) const;
+    // Nullopt unless the withdrawal is in a retained batch
+    [[nodiscard]] std::optional<Claim> claim(uint64_t withdrawal_id) const;
+
+    [[nodiscard]] static Hash leaf(const Withdrawal& withdrawal);
+    // The check L1 makes before paying out
+    [[nodiscard]] static bool verify(const Hash& root, const Claim& claim);
+
+private:
+    struct Sealed {
+        Batch batch;
+        std::vector<Withdrawal> withdrawals;
+        // Levels of the batch's tree, for proofs. proof() rehashes the
+        // right edge, so calls are serialised.
+        mutable std::mutex tree_mutex;
+        mutable quids::crypto::MerkleBuilder tree;
+
+        explicit Sealed(utils::WorkStealingPool& pool) : tree(pool) {}
+    };
+
+    const Config config_;
+    utils::WorkStealingPool& pool_;
+
+    mutable std::mutex mutex_;
+    std::deque<Withdrawal> queue_;
+    uint64_t next_id_{0};
+    // Oldest first; shared so proofs are made outside the lock
+    std::deque<std::shared_ptr<const Sealed>> sealed_;
+    uint64_t next_batch_{0};
+    // Seals one at a time, so batches keep id order
+    std::mutex seal_mutex_;
+};
+
+} // namespace rollup
+} // namespace quids
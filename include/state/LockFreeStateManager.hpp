@@ -1,21 +1,337 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include "utils/WorkStealingPool.hpp"
 
 namespace quids::state {
 
+// The fixed-size part of an account, which is what hot readers ask for
+struct AccountState {
+    uint64_t balance{0};
+    uint64_t nonce{0};
+
+    bool operator==(const AccountState&) const = default;
+};
+
+// Concurrent account store: a fixed number of shards, each an
+// open-addressing table with linear probing.
+//
+// Reads take no lock. Every slot carries a sequence number that writers
+// make odd while they update it, so a reader copies the slot and retries
+// only if the number moved underneath it. Once a slot is claimed for a key
+// it keeps it for the life of its table, so a probe never has to
+// revalidate the keys it skipped. Growing a shard publishes a new table;
+// readers still on the old one finish there, and superseded tables are
+// kept until clear() or destruction. Doubling bounds them by the live
+// table's size.
+//
+// Writes take only their shard's lock. A WriteBatch groups writes by shard
+// as it is built, and commit() merges each shard's group under that shard's
+// lock, shards side by side on the shared pool, so a block's writes scale
+// with the shard count. Each account is updated atomically; a batch as a
+// whole is not, so readers that need several accounts at one instant
+// should read a snapshot instead.
 class LockFreeStateManager {
 public:
-    explicit LockFreeStateManager(bool useParallelProcessing) 
-        : useParallel_(useParallelProcessing) {}
-    
-    void updateState(double value) {
-        currentValue_.store(value, std::memory_order_relaxed);
+    struct Config {
+        size_t shards{64};            // rounded up to a power of two
+        size_t initial_capacity{256}; // slots per shard, rounded the same way
+        bool use_parallel{true};      // merge large batches on the shared pool
+    };
+
+    class WriteBatch {
+    public:
+        void put(std::string address, AccountState state) {
+            add(std::move(address), state);
+        }
+        void erase(std::string address) { add(std::move(address), std::nullopt); }
+
+        [[nodiscard]] size_t size() const noexcept { return size_; }
+        [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+        void clear() {
+            for (auto& shard : shards_) {
+                shard.clear();
+            }
+            size_ = 0;
+        }
+
+    private:
+        friend class LockFreeStateManager;
+
+        struct Write {
+            uint64_t hash;
+            std::string address;
+            std::optional<AccountState> state;
+        };
+
+        explicit WriteBatch(size_t shards) : shards_(shards) {}
+
+        void add(std::string address, std::optional<AccountState> state) {
+            const uint64_t hash = hash_of(address);
+            shards_[shard_of(hash, shards_.size())].push_back({hash, std::move(address), state});
+            ++size_;
+        }
+
+        std::vector<std::vector<Write>> shards_;
+        size_t size_{0};
+    };
+
+    explicit LockFreeStateManager(const Config& config)
+        : config_(config), shards_(std::bit_ceil(std::max<size_t>(1, config.shards))) {
+        const size_t capacity = std::bit_ceil(std::max<size_t>(4, config.initial_capacity));
+        for (auto& shard : shards_) {
+            shard.reset(capacity);
+        }
     }
 
+    LockFreeStateManager() : LockFreeStateManager(Config{}) {}
+
+    explicit LockFreeStateManager(bool useParallelProcessing)
+        : LockFreeStateManager(Config{.use_parallel = useParallelProcessing}) {}
+
+    LockFreeStateManager(const LockFreeStateManager&) = delete;
+    LockFreeStateManager& operator=(const LockFreeStateManager&) = delete;
+
+    [[nodiscard]] std::optional<AccountState> read(std::string_view address) const noexcept {
+        const uint64_t hash = hash_of(address);
+        const Table* table = shards_[shard_of(hash, shards_.size())].table.load(std::memory_order_acquire);
+        for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+            const Slot& slot = table->slots[i];
+            const uint64_t claimed = slot.hash.load(std::memory_order_acquire);
+            if (claimed == 0) {
+                return std::nullopt;
+            }
+            if (claimed != hash || *slot.key.load(std::memory_order_relaxed) != address) {
+                continue;
+            }
+            while (true) {
+                const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+                if (seq & 1) {
+                    continue;
+                }
+                const AccountState state{slot.balance.load(std::memory_order_relaxed),
+                                         slot.nonce.load(std::memory_order_relaxed)};
+                const bool live = slot.live.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq.load(std::memory_order_relaxed) == seq) {
+                    return live ? std::optional<AccountState>(state) : std::nullopt;
+                }
+            }
+        }
+    }
+
+    void write(std::string_view address, AccountState state) {
+        const uint64_t hash = hash_of(address);
+        Shard& shard = shards_[shard_of(hash, shards_.size())];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.apply(hash, address, state);
+    }
+
+    // False if there was no such account
+    bool erase(std::string_view address) {
+        const uint64_t hash = hash_of(address);
+        Shard& shard = shards_[shard_of(hash, shards_.size())];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.apply(hash, address, std::nullopt);
+    }
+
+    [[nodiscard]] WriteBatch batch() const { return WriteBatch(shards_.size()); }
+
+    // Merges and empties `batch`; later writes to an account win
+    void commit(WriteBatch& batch) {
+        if (batch.empty()) {
+            return;
+        }
+        auto merge = [this, &batch](size_t s) {
+            auto& writes = batch.shards_[s];
+            if (writes.empty()) {
+                return;
+            }
+            Shard& shard = shards_[s];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& w : writes) {
+                shard.apply(w.hash, w.address, w.state);
+            }
+        };
+        if (config_.use_parallel && batch.size() >= PARALLEL_COMMIT_WRITES) {
+            utils::WorkStealingPool::global().parallel_for(0, shards_.size(), merge,
+                                                           utils::TaskPriority::Execution);
+        } else {
+            for (size_t s = 0; s < shards_.size(); ++s) {
+                merge(s);
+            }
+        }
+        batch.clear();
+    }
+
+    // Not concurrent with readers: frees every table
+    void clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.reset(std::bit_ceil(std::max<size_t>(4, config_.initial_capacity)));
+        }
+    }
+
+    [[nodiscard]] size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard.live.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    [[nodiscard]] size_t shard_count() const noexcept { return shards_.size(); }
+
 private:
-    std::atomic<double> currentValue_{0.0};
-    bool useParallel_;
-}; 
-}
\ No newline at end of file
+    // Below this a batch is merged on the calling thread
+    static constexpr size_t PARALLEL_COMMIT_WRITES = 512;
+
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> hash{0};  // 0 = unclaimed; set once
+        std::atomic<const std::string*> key{nullptr};
+        std::atomic<uint64_t> balance{0};
+        std::atomic<uint64_t> nonce{0};
+        std::atomic<bool> live{false};
+    };
+
+    struct Table {
+        explicit Table(size_t capacity) : slots(new Slot[capacity]), mask(capacity - 1) {}
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::atomic<const Table*> table{nullptr};
+        // Everything below is only touched under mutex
+        std::vector<std::unique_ptr<Table>> tables;  // the current one last
+        std::deque<std::string> keys;                // referenced by slots
+        size_t claimed{0};
+        std::atomic<size_t> live{0};
+
+        void reset(size_t capacity) {
+            tables.clear();
+            keys.clear();
+            tables.push_back(std::make_unique<Table>(capacity));
+            table.store(tables.back().get(), std::memory_order_release);
+            claimed = 0;
+            live.store(0, std::memory_order_relaxed);
+        }
+
+        // Returns whether the account existed
+        bool apply(uint64_t hash, std::string_view address, const std::optional<AccountState>& state) {
+            Table* current = tables.back().get();
+            size_t i = hash & current->mask;
+            for (;; i = (i + 1) & current->mask) {
+                Slot& slot = current->slots[i];
+                const uint64_t claimedHash = slot.hash.load(std::memory_order_relaxed);
+                if (claimedHash == 0) {
+                    break;
+                }
+                if (claimedHash == hash && *slot.key.load(std::memory_order_relaxed) == address) {
+                    const bool existed = slot.live.load(std::memory_order_relaxed);
+                    update(slot, state);
+                    if (existed != state.has_value()) {
+                        live.fetch_add(state ? 1 : size_t(-1), std::memory_order_relaxed);
+                    }
+                    return existed;
+                }
+            }
+            if (!state) {
+                return false;
+            }
+            if ((claimed + 1) * 4 > (current->mask + 1) * 3) {
+                current = grow();
+                for (i = hash & current->mask; current->slots[i].hash.load(std::memory_order_relaxed) != 0;
+                     i = (i + 1) & current->mask) {
+                }
+            }
+            keys.emplace_back(address);
+            claim(current->slots[i], hash, &keys.back(), *state);
+            ++claimed;
+            live.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        static void update(Slot& slot, const std::optional<AccountState>& state) {
+            const uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+            slot.seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            if (state) {
+                slot.balance.store(state->balance, std::memory_order_relaxed);
+                slot.nonce.store(state->nonce, std::memory_order_relaxed);
+            }
+            slot.live.store(state.has_value(), std::memory_order_relaxed);
+            slot.seq.store(seq + 2, std::memory_order_release);
+        }
+
+        // The release store of the hash publishes the rest of the slot
+        static void claim(Slot& slot, uint64_t hash, const std::string* key, const AccountState& state) {
+            slot.key.store(key, std::memory_order_relaxed);
+            slot.balance.store(state.balance, std::memory_order_relaxed);
+            slot.nonce.store(state.nonce, std::memory_order_relaxed);
+            slot.live.store(true, std::memory_order_relaxed);
+            slot.hash.store(hash, std::memory_order_release);
+        }
+
+        // Live entries only; erased ones are left behind in the old table
+        Table* grow() {
+            const Table& old = *tables.back();
+            const size_t live_now = live.load(std::memory_order_relaxed);
+            size_t capacity = old.mask + 1;
+            while ((live_now + 1) * 4 > capacity * 3 / 2) {
+                capacity *= 2;
+            }
+            auto next = std::make_unique<Table>(capacity);
+            for (size_t s = 0; s <= old.mask; ++s) {
+                const Slot& from = old.slots[s];
+                if (from.hash.load(std::memory_order_relaxed) == 0 || !from.live.load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                const uint64_t hash = from.hash.load(std::memory_order_relaxed);
+                size_t i = hash & next->mask;
+                while (next->slots[i].hash.load(std::memory_order_relaxed) != 0) {
+                    i = (i + 1) & next->mask;
+                }
+                claim(next->slots[i], hash, from.key.load(std::memory_order_relaxed),
+                      {from.balance.load(std::memory_order_relaxed), from.nonce.load(std::memory_order_relaxed)});
+            }
+            claimed = live_now;
+            tables.push_back(std::move(next));
+            table.store(tables.back().get(), std::memory_order_release);
+            return tables.back().get();
+        }
+    };
+
+    static uint64_t hash_of(std::string_view address) noexcept {
+        // Mixed so that shard and slot bits are independent; never 0
+        uint64_t h = std::hash<std::string_view>{}(address);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h == 0 ? 1 : h;
+    }
+
+    static size_t shard_of(uint64_t hash, size_t shards) noexcept {
+        return static_cast<size_t>(hash >> 40) & (shards - 1);
+    }
+
+    const Config config_;
+    std::vector<Shard> shards_;
+};
+
+} // namespace quids::state
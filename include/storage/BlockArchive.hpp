@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace storage {
+
+// Append-only, memory-mapped archive of finalized blocks.
+//
+// Blocks go into segment files of consecutive block numbers, named
+// <first block>.seg. Each record is a fixed-size header, the block data, a
+// transaction offset table and the transaction bodies in wire format. A
+// matching <first block>.idx holds one fixed-width record offset per block.
+// Reads hand out views straight into the mapping, so nothing is copied or
+// deserialized until the caller asks for it.
+class BlockArchive {
+public:
+    struct Config {
+        size_t blocks_per_segment{4096};
+        bool sync_on_append{false};  // fdatasync both files after each block
+    };
+
+    class Mapping;
+
+    // Valid for as long as the view is alive, even across later appends
+    class BlockView {
+    public:
+        uint64_t block_number() const { return block_number_; }
+        std::span<const uint8_t> data() const { return data_; }
+        size_t transaction_count() const { return tx_count_; }
+        // Wire-format bytes of transaction `index`
+        std::span<const uint8_t> transaction(size_t index) const;
+
+    private:
+        friend class BlockArchive;
+
+        std::shared_ptr<const Mapping> mapping_;
+        uint64_t block_number_{0};
+        std::span<const uint8_t> data_;
+        const uint8_t* offsets_{nullptr};  // tx_count_ + 1 little-endian u32
+        const uint8_t* bodies_{nullptr};
+        size_t tx_count_{0};
+    };
+
+    BlockArchive(const std::string& directory, const Config& config);
+    explicit BlockArchive(const std::string& directory);
+    ~BlockArchive();
+
+    BlockArchive(const BlockArchive&) = delete;
+    BlockArchive& operator=(const BlockArchive&) = delete;
+
+    // Blocks must be appended in order without gaps
+    bool append(uint64_t block_number,
+                std::span<const uint8_t> data,
+                const std::vector<std::vector<uint8_t>>& tx_bodies);
+
+    std::optional<BlockView> get(uint64_t block_number) const;
+    bool contains(uint64_t block_number) const;
+
+    // Range of archived blocks, if any
+    std::optional<uint64_t> first_block() const;
+    std::optional<uint64_t> last_block() const;
+
+private:
+    struct Segment;
+
+    Segment& writable_segment(uint64_t block_number);
+    void load_segments();
+    std::optional<uint64_t> last_block_locked() const;
+    std::shared_ptr<const Mapping> mapping_for(const Segment& segment, uint64_t end) const;
+
+    std::string directory_;
+    Config config_;
+    // Keyed by first block number
+    std::map<uint64_t, std::unique_ptr<Segment>> segments_;
+    mutable std::shared_mutex mutex_;
+};
+
+} // namespace storage
+} // namespace quids
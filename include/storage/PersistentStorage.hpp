@@ -2,10 +2,17 @@
 
 #include "blockchain/Transaction.hpp"
 #include "rollup/StateTransitionProof.hpp"
+#include "storage/BlockArchive.hpp"
+#include "utils/Task.hpp"
 #include <string>
 #include <vector>
+#include <array>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <optional>
+#include <span>
+#include <utility>
 
 namespace quids {
 namespace storage {
@@ -17,8 +24,14 @@ public:
 
     // Transaction storage
     bool storeTransaction(const blockchain::Transaction& tx);
-    std::optional<blockchain::Transaction> loadTransaction(const std::array<uint8_t, 32>& tx_hash);
-    std::vector<blockchain::Transaction> loadTransactions(uint64_t block_number);
+    // One WriteBatch; also indexes the transactions under `block_number`
+    bool storeTransactions(uint64_t block_number, std::span<const blockchain::TransactionPtr> txs);
+    // nullptr when the hash is unknown
+    blockchain::TransactionPtr loadTransaction(const std::array<uint8_t, 32>& tx_hash);
+    // In block order
+    std::vector<blockchain::TransactionPtr> loadTransactions(uint64_t block_number);
+    // Hashes of the block's transactions in block order, from the index
+    std::vector<std::array<uint8_t, 32>> loadTransactionHashes(uint64_t block_number);
 
     // Proof storage
     bool storeProof(uint64_t block_number, const rollup::StateTransitionProof& proof);
@@ -28,6 +41,90 @@ public:
     bool storeBlockData(uint64_t block_number, const std::vector<uint8_t>& data);
     std::optional<std::vector<uint8_t>> loadBlockData(uint64_t block_number);
 
+    // Transactions, their index, the proof and the block data of one block
+    // in a single WriteBatch with one WAL sync
+    bool storeBlockAtomic(
+        uint64_t block_number,
+        std::span<const blockchain::TransactionPtr> txs,
+        const rollup::StateTransitionProof& proof,
+        const std::vector<uint8_t>& data
+    );
+
+    // Cold history. Archived blocks are served from the mmap archive and
+    // dropped from RocksDB; transactions stay findable by hash.
+    void attachArchive(std::shared_ptr<BlockArchive> archive);
+    // Moves every block up to `last_block` not archived yet; returns the count
+    size_t archiveBlocks(uint64_t last_block);
+    // Zero-copy view of an archived block
+    std::optional<BlockArchive::BlockView> viewBlock(uint64_t block_number) const;
+
+    // Account history: (address, block, index) -> tx hash, one entry for
+    // each side of a transfer. Entries of one address are contiguous and
+    // in block order, so pages and block ranges are plain range scans.
+    struct HistoryRef {
+        std::string address;
+        uint64_t block_number{0};
+        uint32_t index{0};  // position in the block
+        std::array<uint8_t, 32> tx_hash{};
+    };
+    struct HistoryQuery {
+        uint64_t from_block{0};
+        uint64_t to_block{std::numeric_limits<uint64_t>::max()};
+        // Cursor: position of the last entry of the previous page
+        std::optional<std::pair<uint64_t, uint32_t>> after;
+        size_t limit{100};
+        bool newest_first{true};
+    };
+    bool storeAccountHistory(const std::vector<HistoryRef>& refs, bool sync);
+    // At most query.limit entries of `address`, starting past the cursor
+    std::vector<HistoryRef> loadAccountHistory(const std::string& address, const HistoryQuery& query);
+
+    // Pruning. Both calls do a bounded amount of work and write without a
+    // WAL sync, so a caller can spread them over time; a delete lost in a
+    // crash is simply redone by the next call.
+    //
+    // Drops the block data, proof, transaction index and transactions of
+    // at most `max_blocks` blocks below `below_block`, lowest first.
+    // Archived blocks stay in their segments. Returns how many were dropped.
+    size_t pruneBlocks(uint64_t below_block, size_t max_blocks);
+    // Drops account history below `below_block` for up to `max_addresses`
+    // addresses, starting at `cursor` (empty for the first). Returns the
+    // cursor to continue from, or nullopt once every address was visited.
+    std::optional<std::string> pruneAccountHistory(uint64_t below_block, const std::string& cursor,
+                                                   size_t max_addresses);
+
+    // State storage; a missing value deletes the key
+    struct StateWrite {
+        std::string key;
+        std::optional<std::vector<uint8_t>> value;
+    };
+    // All writes land atomically, with a single WAL sync when `sync` is set
+    bool storeStateBatch(const std::vector<StateWrite>& writes, bool sync);
+    std::optional<std::vector<uint8_t>> loadState(const std::string& key);
+    // loadState() run on the shared pool, for coroutines; a read is short
+    // enough (mostly block cache) that it does not need a thread of its own
+    utils::Task<std::optional<std::vector<uint8_t>>> loadStateAsync(std::string key);
+    // Visits keys starting with `prefix` in key order until `fn` returns false
+    void scanState(const std::string& prefix,
+                   const std::function<bool(const std::string&, const std::vector<uint8_t>&)>& fn);
+
+    // Bulk state transfer through SST files laid out for the state family.
+    // `entries` must be in strictly increasing key order.
+    using StateEntry = std::pair<std::string, std::vector<uint8_t>>;
+    static bool writeStateFile(const std::string& path, const std::vector<StateEntry>& entries);
+    // Visits the entries of one file in key order until `fn` returns false;
+    // false if the file cannot be opened or fails its checksums
+    static bool readStateFile(const std::string& path,
+                              const std::function<bool(const std::string&, const std::vector<uint8_t>&)>& fn);
+    // Links or copies the files straight into the state family as one
+    // atomic step, bypassing the memtable and WAL
+    bool ingestStateFiles(const std::vector<std::string>& paths, bool move_files);
+
+    // Resizes the block cache to the memory::Subsystem::BlockCache budget,
+    // if one is set, and charges its usage to that subsystem. Done after
+    // every stored block; returns the bytes the cache holds.
+    size_t applyMemoryBudget();
+
 private:
     // Forward declaration of implementation
     struct Impl;  // Changed from class to struct
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace quids {
+namespace storage {
+
+// One-file container of named tensors, used in place through mmap.
+//
+// Layout, little-endian:
+//   header  magic | format u32 | tensor count u32 | table length u64 |
+//           table checksum u64, padded to ALIGNMENT
+//   table   per tensor: name length u16 | name | dtype u8 | rank u8 |
+//           dims u64 x rank | data offset u64 | data length u64 | checksum u64
+//   data    each tensor on an ALIGNMENT boundary
+// Opening maps the file and reads the table only. Tensor views point
+// straight into the mapping, so loading a model is a page fault per tensor
+// touched rather than a parse and copy of every weight. Files are written
+// next to their target and renamed over it, so a reader sees the old file
+// or the new one, and a mapping of the old one stays valid after the swap.
+class TensorCheckpoint {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    enum class DType : uint8_t {
+        Float32 = 1,
+        Float64 = 2,
+        Int8 = 3,
+        Int32 = 4,
+        UInt8 = 5,
+    };
+
+    static size_t dtype_size(DType dtype);
+
+    template <typename T> static constexpr DType dtype_of();
+
+    // Valid for as long as the checkpoint is alive
+    struct TensorView {
+        DType dtype{DType::UInt8};
+        std::vector<uint64_t> shape;
+        std::span<const uint8_t> bytes;
+
+        [[nodiscard]] uint64_t elements() const;
+
+        // Throws std::invalid_argument on a dtype mismatch
+        template <typename T>
+        std::span<const T> as() const {
+            if (dtype != dtype_of<T>()) {
+                throw std::invalid_argument("Tensor dtype mismatch");
+            }
+            return {reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)};
+        }
+    };
+
+    class Writer {
+    public:
+        // Bytes are copied; their length must match the shape
+        void add(std::string name, DType dtype, std::vector<uint64_t> shape, std::span<const uint8_t> bytes);
+
+        template <typename T>
+        void add(std::string name, std::vector<uint64_t> shape, std::span<const T> values) {
+            add(std::move(name), dtype_of<T>(), std::move(shape),
+                {reinterpret_cast<const uint8_t*>(values.data()), values.size_bytes()});
+        }
+
+        // Writes and fsyncs path + ".tmp", then renames it over path.
+        // Throws std::runtime_error on I/O failure.
+        void write(const std::string& path) const;
+
+    private:
+        struct Entry {
+            std::string name;
+            DType dtype;
+            std::vector<uint64_t> shape;
+            std::vector<uint8_t> bytes;
+        };
+        std::vector<Entry> entries_;
+    };
+
+    // Nullptr if the file is missing or malformed. verify also checks
+    // every tensor's checksum, which reads but does not copy the data.
+    static std::shared_ptr<const TensorCheckpoint> open(const std::string& path, bool verify = true);
+
+    ~TensorCheckpoint();
+    TensorCheckpoint(const TensorCheckpoint&) = delete;
+    TensorCheckpoint& operator=(const TensorCheckpoint&) = delete;
+
+    [[nodiscard]] const TensorView* find(std::string_view name) const;
+    // Throws std::out_of_range when absent
+    [[nodiscard]] const TensorView& at(std::string_view name) const;
+    [[nodiscard]] size_t size() const { return tensors_.size(); }
+    [[nodiscard]] bool verify() const;
+
+    static uint64_t checksum(std::span<const uint8_t> data) noexcept;
+
+private:
+    struct Entry {
+        TensorView view;
+        uint64_t checksum{0};
+    };
+
+    TensorCheckpoint() = default;
+
+    const uint8_t* base_{nullptr};
+    size_t size_{0};
+    std::map<std::string, Entry, std::less<>> tensors_;
+};
+
+template <> constexpr TensorCheckpoint::DType TensorCheckpoint::dtype_of<float>() { return DType::Float32; }
+template <> constexpr TensorCheckpoint::DType TensorCheckpoint::dtype_of<double>() { return DType::Float64; }
+template <> constexpr TensorCheckpoint::DType TensorCheckpoint::dtype_of<int8_t>() { return DType::Int8; }
+template <> constexpr TensorCheckpoint::DType TensorCheckpoint::dtype_of<int32_t>() { return DType::Int32; }
+template <> constexpr TensorCheckpoint::DType TensorCheckpoint::dtype_of<uint8_t>() { return DType::UInt8; }
+
+} // namespace storage
+} // namespace quids
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+
+namespace quids {
+namespace utils {
+
+// AIMD feedback on batch size and batch wait time against a latency target.
+//
+// Each finished batch reports its size, the limit it was cut under, its
+// end-to-end latency and the queue depth it left behind. A batch over the
+// target cuts the size to a fraction of its own size, and the wait
+// multiplicatively. A full batch with work still queued and latency comfortably under the
+// target grows the size by a fixed step. A batch the wait could not fill
+// halves the wait, so quiet periods stop holding work for a batch that
+// will never fill, and a full one lets the wait recover.
+//
+// observe() may be called from any thread; readers see the current
+// decision without locking.
+class AdaptiveBatchController {
+public:
+    struct Config {
+        size_t min_batch_size{1};
+        size_t max_batch_size{1024};
+        std::chrono::milliseconds min_wait{1};
+        std::chrono::milliseconds max_wait{1000};
+        std::chrono::microseconds latency_target{500'000};
+        size_t increase_step{16};
+        double decrease_factor{0.7};
+        // Grow only while smoothed latency is below this share of the target
+        double headroom{0.8};
+        // Weight of the newest batch in the smoothed latency
+        double smoothing{0.2};
+        // Hold growth while observeLoad() reports the process above this
+        // share of all cores; larger batches would only queue behind it
+        double cpu_ceiling{1.0};
+    };
+
+    struct Stats {
+        size_t batch_size{0};
+        std::chrono::milliseconds wait{0};
+        double smoothed_latency_us{0.0};
+        uint64_t observations{0};
+        uint64_t increases{0};
+        uint64_t decreases{0};
+        uint64_t slo_violations{0};
+    };
+
+    // Starts at the largest batch and longest wait, the static behaviour
+    explicit AdaptiveBatchController(const Config& config)
+        : config_(config), batch_size_(config.max_batch_size), wait_ms_(config.max_wait.count()) {
+        if (config.min_batch_size == 0 || config.min_batch_size > config.max_batch_size ||
+            config.min_wait.count() <= 0 || config.min_wait > config.max_wait ||
+            config.latency_target.count() <= 0 || config.increase_step == 0 ||
+            !(config.decrease_factor > 0.0 && config.decrease_factor < 1.0) ||
+            !(config.headroom > 0.0 && config.headroom <= 1.0) ||
+            !(config.smoothing > 0.0 && config.smoothing <= 1.0) ||
+            !(config.cpu_ceiling > 0.0 && config.cpu_ceiling <= 1.0)) {
+            throw std::invalid_argument("invalid adaptive batching configuration");
+        }
+    }
+
+    [[nodiscard]] size_t batchSize() const noexcept { return batch_size_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::chrono::milliseconds waitTime() const noexcept {
+        return std::chrono::milliseconds(wait_ms_.load(std::memory_order_relaxed));
+    }
+
+    // Process CPU share, 0 to 1, typically HealthSampler's 1 s window
+    void observeLoad(double cpu_usage) noexcept { cpu_usage_.store(cpu_usage, std::memory_order_relaxed); }
+
+    // `limit` is batchSize() as read when the batch was cut
+    void observe(size_t batch_size, size_t limit, std::chrono::microseconds latency, size_t queue_depth) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const double sample = static_cast<double>(latency.count());
+        smoothed_us_ = observations_ == 0 ? sample : smoothed_us_ + config_.smoothing * (sample - smoothed_us_);
+        ++observations_;
+
+        const double target = static_cast<double>(config_.latency_target.count());
+        size_t size = batch_size_.load(std::memory_order_relaxed);
+        int64_t wait = wait_ms_.load(std::memory_order_relaxed);
+
+        // The limit may have moved while the batch was in flight, so it is
+        // judged by its own size and the limit it was cut under
+        if (latency > config_.latency_target) {
+            ++slo_violations_;
+            const auto cut = static_cast<size_t>(static_cast<double>(batch_size) * config_.decrease_factor);
+            const size_t next = std::min(size, std::max(config_.min_batch_size, cut));
+            // A batch cut before an earlier decrease only cuts further
+            if (next < size || limit <= size) {
+                ++decreases_;
+                size = next;
+                wait = std::max<int64_t>(config_.min_wait.count(),
+                                         static_cast<int64_t>(static_cast<double>(wait) * config_.decrease_factor));
+            }
+        } else if (batch_size >= limit) {
+            // Only a batch cut under the current limit may grow it
+            const bool cpu_bound = cpu_usage_.load(std::memory_order_relaxed) > config_.cpu_ceiling;
+            if (limit == size && queue_depth > 0 && smoothed_us_ < target * config_.headroom &&
+                size < config_.max_batch_size && !cpu_bound) {
+                ++increases_;
+                size = std::min(config_.max_batch_size, size + config_.increase_step);
+            }
+            wait = std::min<int64_t>(config_.max_wait.count(), wait + config_.min_wait.count());
+        } else {
+            wait = std::max<int64_t>(config_.min_wait.count(), wait / 2);
+        }
+
+        batch_size_.store(size, std::memory_order_relaxed);
+        wait_ms_.store(wait, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return Stats{
+            .batch_size = batchSize(),
+            .wait = waitTime(),
+            .smoothed_latency_us = smoothed_us_,
+            .observations = observations_,
+            .increases = increases_,
+            .decreases = decreases_,
+            .slo_violations = slo_violations_
+        };
+    }
+
+private:
+    const Config config_;
+    std::atomic<size_t> batch_size_;
+    std::atomic<int64_t> wait_ms_;
+    std::atomic<double> cpu_usage_{0.0};
+
+    mutable std::mutex mutex_;
+    double smoothed_us_{0.0};
+    uint64_t observations_{0};
+    uint64_t increases_{0};
+    uint64_t decreases_{0};
+    uint64_t slo_violations_{0};
+};
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// Admission at the edge of the pipeline, driven by how full its stages are.
+//
+// Each stage (mempool, proving queue, L1 outbox, ...) registers a probe
+// that reports its fill: 0 when idle, 1 at capacity. The fullest stage is
+// the pipeline's pressure, so a proving backlog throttles ingestion before
+// it ever reaches the mempool's own limit. What a stage has left below its
+// capacity is the credit it grants upstream.
+//
+// Submissions come in lanes. A lane is shed once pressure passes its
+// threshold, Bulk first and Priority last, and a shed submission is told
+// how long to wait: longer the further pressure is past its lane's
+// threshold. Probes run at most once per refresh interval, on whichever
+// caller finds the reading stale, so admit() is normally two atomic loads.
+class AdmissionController {
+public:
+    enum class Lane : uint8_t { Bulk = 0, Standard = 1, Priority = 2 };
+    static constexpr size_t NUM_LANES = 3;
+
+    // Fill of one stage; values above 1 mean past capacity
+    using Probe = std::function<double()>;
+
+    struct Config {
+        // A lane is admitted while pressure is below its entry
+        std::array<double, NUM_LANES> shed_above{0.6, 0.85, 1.0};
+        // Fees at or above these pick the Standard and Priority lanes
+        uint64_t standard_fee{1};
+        uint64_t priority_fee{1000};
+        std::chrono::milliseconds refresh{5};
+        std::chrono::milliseconds min_retry{100};
+        std::chrono::milliseconds max_retry{10000};
+    };
+
+    struct Decision {
+        bool admitted{true};
+        std::chrono::milliseconds retry_after{0};  // set when shed
+    };
+
+    struct Stats {
+        double pressure{0.0};
+        std::string bottleneck;  // fullest stage at the last refresh
+        std::array<uint64_t, NUM_LANES> admitted{};
+        std::array<uint64_t, NUM_LANES> shed{};
+    };
+
+    explicit AdmissionController(const Config& config) : config_(config) {
+        for (size_t i = 0; i < NUM_LANES; ++i) {
+            if (!(config.shed_above[i] > 0.0) || (i > 0 && config.shed_above[i] < config.shed_above[i - 1])) {
+                throw std::invalid_argument("invalid admission lanes");
+            }
+        }
+        if (config.refresh.count() < 0 || config.min_retry.count() <= 0 || config.min_retry > config.max_retry ||
+            config.priority_fee < config.standard_fee) {
+            throw std::invalid_argument("invalid admission configuration");
+        }
+    }
+    AdmissionController() : AdmissionController(Config{}) {}
+
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+
+    // Stages are usually added while wiring the node; a later one counts
+    // from the next refresh
+    void add_stage(std::string name, Probe probe) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stages_.push_back({std::move(name), std::move(probe)});
+        refreshed_ns_.store(NEVER, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] Lane lane_for_fee(uint64_t fee) const noexcept {
+        if (fee >= config_.priority_fee) return Lane::Priority;
+        if (fee >= config_.standard_fee) return Lane::Standard;
+        return Lane::Bulk;
+    }
+
+    Decision admit(Lane lane) {
+        const auto index = static_cast<size_t>(lane);
+        const double p = pressure();
+        const double threshold = config_.shed_above[index];
+        if (p < threshold) {
+            admitted_[index].fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+        shed_[index].fetch_add(1, std::memory_order_relaxed);
+        // Scaled by how far past this lane's threshold the fullest stage
+        // is, reaching max_retry at twice the threshold
+        const double over = std::clamp((p - threshold) / std::max(threshold, 1e-9), 0.0, 1.0);
+        const auto span = static_cast<double>((config_.max_retry - config_.min_retry).count());
+        return {false, config_.min_retry + std::chrono::milliseconds(static_cast<int64_t>(over * span))};
+    }
+
+    Decision admit_fee(uint64_t fee) { return admit(lane_for_fee(fee)); }
+
+    // Fill of the fullest stage, at most one refresh interval old
+    double pressure() {
+        const int64_t now = now_ns();
+        int64_t last = refreshed_ns_.load(std::memory_order_acquire);
+        const int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.refresh).count();
+        if (last == NEVER || now - last >= interval) {
+            // One caller polls; the rest use the reading they have
+            if (refreshed_ns_.compare_exchange_strong(last, now, std::memory_order_acq_rel)) {
+                refresh();
+            }
+        }
+        return pressure_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool overloaded() { return pressure() >= config_.shed_above[NUM_LANES - 1]; }
+
+    [[nodiscard]] Stats stats() const {
+        Stats s;
+        s.pressure = pressure_.load(std::memory_order_acquire);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            s.bottleneck = bottleneck_;
+        }
+        for (size_t i = 0; i < NUM_LANES; ++i) {
+            s.admitted[i] = admitted_[i].load(std::memory_order_relaxed);
+            s.shed[i] = shed_[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    [[nodiscard]] const Config& config() const noexcept { return config_; }
+
+private:
+    struct Stage {
+        std::string name;
+        Probe probe;
+    };
+
+    static constexpr int64_t NEVER = INT64_MIN;
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void refresh() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        double fullest = 0.0;
+        const Stage* bottleneck = nullptr;
+        for (const auto& stage : stages_) {
+            const double fill = stage.probe();
+            if (fill > fullest) {
+                fullest = fill;
+                bottleneck = &stage;
+            }
+        }
+        bottleneck_ = bottleneck ? bottleneck->name : std::string();
+        pressure_.store(fullest, std::memory_order_release);
+    }
+
+    const Config config_;
+    mutable std::mutex mutex_;  // stages_ and bottleneck_
+    std::vector<Stage> stages_;
+    std::string bottleneck_;
+    std::atomic<double> pressure_{0.0};
+    std::atomic<int64_t> refreshed_ns_{NEVER};
+    std::array<std::atomic<uint64_t>, NUM_LANES> admitted_{};
+    std::array<std::atomic<uint64_t>, NUM_LANES> shed_{};
+};
+
+} // namespace utils
+} // namespace quids
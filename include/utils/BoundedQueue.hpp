@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace quids {
+namespace utils {
+
+enum class QueueMode {
+    MPMC,  // any number of producers and consumers
+    SPSC   // exactly one producer thread and one consumer thread
+};
+
+// Fixed-capacity ring buffer that never allocates after construction.
+//
+// The MPMC form stamps every cell with a sequence number: a producer may
+// fill cell i when its sequence equals the enqueue position, a consumer may
+// empty it when it equals the position plus one, so a push or pop is one CAS
+// on a position counter. The bulk calls claim a run of ready cells with a
+// single CAS. Cells and counters sit on their own cache lines. Capacity is
+// rounded up to a power of two.
+template<typename T, QueueMode Mode = QueueMode::MPMC>
+class BoundedQueue {
+    static_assert(std::is_move_constructible_v<T>, "T must be move constructible");
+
+public:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    explicit BoundedQueue(size_t capacity)
+        : mask_(round_up(capacity) - 1),
+          cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~BoundedQueue() {
+        while (try_pop()) {}
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    template<typename... Args>
+    bool try_emplace(Args&&... args) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        ::new (cell->storage) T(std::forward<Args>(args)...);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(T&& item) { return try_emplace(std::move(item)); }
+    bool try_push(const T& item) { return try_emplace(item); }
+
+    std::optional<T> try_pop() {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;  // empty
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        std::optional<T> out(take(*cell));
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return out;
+    }
+
+    // Moves up to count items out of first; returns how many went in
+    template<typename It>
+    size_t try_push_bulk(It first, size_t count) {
+        // Otherwise a free cell at pos reads as a lost race and is retried
+        if (count == 0) {
+            return 0;
+        }
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t ready;
+        while (true) {
+            ready = 0;
+            while (ready < count &&
+                   cells_[(pos + ready) & mask_].seq.load(std::memory_order_acquire) == pos + ready) {
+                ++ready;
+            }
+            if (ready == 0) {
+                const size_t seq = cells_[pos & mask_].seq.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0) {
+                    return 0;
+                }
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            // Nobody else can claim cells past pos without moving enqueue_pos_
+            // first, so the run checked above stays ready if this succeeds
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < ready; ++i, ++first) {
+            Cell& cell = cells_[(pos + i) & mask_];
+            ::new (cell.storage) T(std::move(*first));
+            cell.seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return ready;
+    }
+
+    // Writes up to max items to out; returns how many were taken
+    template<typename OutIt>
+    size_t try_pop_bulk(OutIt out, size_t max) {
+        if (max == 0) {
+            return 0;
+        }
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t ready;
+        while (true) {
+            ready = 0;
+            while (ready < max &&
+                   cells_[(pos + ready) & mask_].seq.load(std::memory_order_acquire) == pos + ready + 1) {
+                ++ready;
+            }
+            if (ready == 0) {
+                const size_t seq = cells_[pos & mask_].seq.load(std::memory_order_acquire);
+                if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0) {
+                    return 0;
+                }
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < ready; ++i) {
+            Cell& cell = cells_[(pos + i) & mask_];
+            *out = take(cell);
+            ++out;
+            cell.seq.store(pos + i + mask_ + 1, std::memory_order_release);
+        }
+        return ready;
+    }
+
+    // Approximate while other threads are active
+    [[nodiscard]] size_t size() const noexcept {
+        const size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+        const size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+        return tail > head ? std::min(tail - head, capacity()) : 0;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Cell {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static size_t round_up(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    static T take(Cell& cell) {
+        T* item = std::launder(reinterpret_cast<T*>(cell.storage));
+        T value(std::move(*item));
+        item->~T();
+        return value;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos_{0};
+};
+
+// Single producer, single consumer: no CAS at all. Each side caches the
+// other side's index and only rereads it when the ring looks full or empty.
+template<typename T>
+class BoundedQueue<T, QueueMode::SPSC> {
+    static_assert(std::is_move_constructible_v<T>, "T must be move constructible");
+
+public:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    explicit BoundedQueue(size_t capacity)
+        : mask_(round_up(capacity) - 1),
+          slots_(new Slot[mask_ + 1]) {}
+
+    ~BoundedQueue() {
+        while (try_pop()) {}
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    template<typename... Args>
+    bool try_emplace(Args&&... args) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) {
+                return false;
+            }
+        }
+        ::new (slots_[tail & mask_].storage) T(std::forward<Args>(args)...);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(T&& item) { return try_emplace(std::move(item)); }
+    bool try_push(const T& item) { return try_emplace(item); }
+
+    std::optional<T> try_pop() {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return std::nullopt;
+            }
+        }
+        std::optional<T> out(take(slots_[head & mask_]));
+        head_.store(head + 1, std::memory_order_release);
+        return out;
+    }
+
+    template<typename It>
+    size_t try_push_bulk(It first, size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t free = capacity() - (tail - head_cache_);
+        if (free < count) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            free = capacity() - (tail - head_cache_);
+        }
+        const size_t n = std::min(free, count);
+        for (size_t i = 0; i < n; ++i, ++first) {
+            ::new (slots_[(tail + i) & mask_].storage) T(std::move(*first));
+        }
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    template<typename OutIt>
+    size_t try_pop_bulk(OutIt out, size_t max) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        size_t available = tail_cache_ - head;
+        if (available < max) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            available = tail_cache_ - head;
+        }
+        const size_t n = std::min(available, max);
+        for (size_t i = 0; i < n; ++i) {
+            *out = take(slots_[(head + i) & mask_]);
+            ++out;
+        }
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    [[nodiscard]] size_t size() const noexcept {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+    [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static size_t round_up(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    static T take(Slot& slot) {
+        T* item = std::launder(reinterpret_cast<T*>(slot.storage));
+        T value(std::move(*item));
+        item->~T();
+        return value;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    // Consumer side
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{0};
+    size_t tail_cache_{0};
+    // Producer side
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0};
+    size_t head_cache_{0};
+};
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+// Runtime CPU feature detection shared by the SIMD kernels. One binary
+// carries every variant (compiled with __attribute__((target(...))) on
+// x86), and each kernel picks the widest one the host supports the first
+// time it runs, so a single build serves the whole fleet.
+//
+// QUIDS_DISABLE_CPU_FEATURES takes a comma-separated list of feature names
+// ("avx512f,avx2") to hide from the kernels, for benchmarking narrower
+// paths or working around a bad host without rebuilding.
+
+namespace quids::utils {
+
+enum class CpuFeature : uint8_t {
+    Scalar,   // always available
+    Sse42,
+    Avx2,
+    Avx512f,
+    Bmi2,
+    Pclmul,
+    Neon,
+    Aes       // AES-NI on x86, the AES instructions on ARMv8
+};
+
+inline constexpr std::string_view featureName(CpuFeature feature) {
+    switch (feature) {
+        case CpuFeature::Scalar: return "scalar";
+        case CpuFeature::Sse42: return "sse4.2";
+        case CpuFeature::Avx2: return "avx2";
+        case CpuFeature::Avx512f: return "avx512f";
+        case CpuFeature::Bmi2: return "bmi2";
+        case CpuFeature::Pclmul: return "pclmul";
+        case CpuFeature::Neon: return "neon";
+        case CpuFeature::Aes: return "aes";
+    }
+    return "unknown";
+}
+
+class CpuFeatures {
+public:
+    bool has(CpuFeature feature) const {
+        return (mask_ & bit(feature)) != 0;
+    }
+
+    // What this host offers, after QUIDS_DISABLE_CPU_FEATURES
+    static const CpuFeatures& host() {
+        static const CpuFeatures features = detect(std::getenv("QUIDS_DISABLE_CPU_FEATURES"));
+        return features;
+    }
+
+    // Detection with `disabled` read in place of the environment variable;
+    // Scalar cannot be disabled
+    static CpuFeatures detect(const char* disabled) {
+        CpuFeatures f;
+        f.mask_ = bit(CpuFeature::Scalar);
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+        // libgcc checks XCR0 too, so AVX state the OS does not save reads
+        // as unsupported
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2")) f.mask_ |= bit(CpuFeature::Sse42);
+        if (__builtin_cpu_supports("avx2")) f.mask_ |= bit(CpuFeature::Avx2);
+        if (__builtin_cpu_supports("avx512f")) f.mask_ |= bit(CpuFeature::Avx512f);
+        if (__builtin_cpu_supports("bmi2")) f.mask_ |= bit(CpuFeature::Bmi2);
+        if (__builtin_cpu_supports("pclmul")) f.mask_ |= bit(CpuFeature::Pclmul);
+        if (__builtin_cpu_supports("aes")) f.mask_ |= bit(CpuFeature::Aes);
+#elif defined(__aarch64__) && defined(__linux__)
+        const unsigned long hwcap = getauxval(AT_HWCAP);
+        if (hwcap & HWCAP_ASIMD) f.mask_ |= bit(CpuFeature::Neon);
+        if (hwcap & HWCAP_AES) f.mask_ |= bit(CpuFeature::Aes);
+#elif defined(__aarch64__)
+        f.mask_ |= bit(CpuFeature::Neon);  // Advanced SIMD is part of the base ISA
+        f.mask_ |= bit(CpuFeature::Aes);   // as are the AES instructions on Apple silicon
+#endif
+
+        if (disabled) {
+            std::string_view list(disabled);
+            while (!list.empty()) {
+                const auto comma = list.find(',');
+                const auto name = list.substr(0, comma);
+                for (uint32_t i = 1; i <= static_cast<uint32_t>(CpuFeature::Aes); ++i) {
+                    if (featureName(static_cast<CpuFeature>(i)) == name) {
+                        f.mask_ &= ~(1u << i);
+                    }
+                }
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            }
+        }
+        return f;
+    }
+
+private:
+    static constexpr uint32_t bit(CpuFeature feature) {
+        return 1u << static_cast<uint32_t>(feature);
+    }
+
+    uint32_t mask_{0};
+};
+
+// Which variant each kernel settled on, for startup logs and benchmarks
+class KernelRegistry {
+public:
+    static KernelRegistry& global() {
+        static KernelRegistry registry;
+        return registry;
+    }
+
+    void record(std::string_view kernel, CpuFeature feature) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : entries_) {
+            if (entry.first == kernel) {
+                entry.second = feature;
+                return;
+            }
+        }
+        entries_.emplace_back(std::string(kernel), feature);
+    }
+
+    std::vector<std::pair<std::string, CpuFeature>> selected() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::pair<std::string, CpuFeature>> entries_;
+};
+
+// The first candidate the host has, Scalar when none; list the widest
+// first. Callers keep the answer in a function-local static so the
+// choice is made, and recorded, once.
+inline CpuFeature selectFeature(std::string_view kernel, std::initializer_list<CpuFeature> candidates,
+                                const CpuFeatures& features = CpuFeatures::host()) {
+    CpuFeature chosen = CpuFeature::Scalar;
+    for (const CpuFeature feature : candidates) {
+        if (features.has(feature)) {
+            chosen = feature;
+            break;
+        }
+    }
+    KernelRegistry::global().record(kernel, chosen);
+    return chosen;
+}
+
+// For kernels with one accelerated variant
+inline bool useFeature(std::string_view kernel, CpuFeature feature,
+                       const CpuFeatures& features = CpuFeatures::host()) {
+    return selectFeature(kernel, {feature}, features) == feature;
+}
+
+template<typename Fn>
+struct KernelVariant {
+    CpuFeature feature;
+    Fn fn;
+};
+
+// Function-pointer form of selectFeature; the last variant should be
+// the Scalar one
+template<typename Fn>
+Fn selectKernel(std::string_view kernel, std::initializer_list<KernelVariant<Fn>> variants,
+                const CpuFeatures& features = CpuFeatures::host()) {
+    for (const auto& variant : variants) {
+        if (features.has(variant.feature)) {
+            KernelRegistry::global().record(kernel, variant.feature);
+            return variant.fn;
+        }
+    }
+    KernelRegistry::global().record(kernel, CpuFeature::Scalar);
+    return nullptr;
+}
+
+} // namespace quids::utils
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// Open-addressing hash map with linear probing.
+//
+// Keys and values live inline in one array, so a lookup is a hash and a
+// short forward scan over adjacent slots instead of a chain of node
+// pointers. Erase shifts the following run back instead of leaving
+// tombstones, so probe lengths do not degrade under churn. Capacity is a
+// power of two and the table grows at 3/4 load. Pointers to values are
+// invalidated by any insert that grows the table and by erase.
+template<typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class FlatHashMap {
+public:
+    explicit FlatHashMap(size_t initial_capacity = 16) { rehash(round_up(initial_capacity)); }
+
+    V* find(const K& key) {
+        const size_t i = locate(key);
+        return i == NPOS ? nullptr : &slots_[i].value;
+    }
+
+    const V* find(const K& key) const {
+        const size_t i = locate(key);
+        return i == NPOS ? nullptr : &slots_[i].value;
+    }
+
+    bool contains(const K& key) const { return locate(key) != NPOS; }
+
+    // Value for key, default-constructed if absent; second is true when
+    // the entry was inserted
+    std::pair<V*, bool> try_emplace(const K& key) {
+        if ((size_ + 1) * 4 > capacity() * 3) {
+            rehash(capacity() * 2);
+        }
+        size_t i = bucket(key);
+        while (used_[i]) {
+            if (eq_(slots_[i].key, key)) {
+                return {&slots_[i].value, false};
+            }
+            i = (i + 1) & mask_;
+        }
+        used_[i] = 1;
+        slots_[i].key = key;
+        slots_[i].value = V{};
+        ++size_;
+        return {&slots_[i].value, true};
+    }
+
+    void insert_or_assign(const K& key, V value) {
+        *try_emplace(key).first = std::move(value);
+    }
+
+    bool erase(const K& key) {
+        size_t i = locate(key);
+        if (i == NPOS) return false;
+        erase_at(i);
+        return true;
+    }
+
+    // Removes every entry for which pred(key, value) holds
+    template<typename Pred>
+    size_t erase_if(Pred pred) {
+        size_t removed = 0;
+        for (size_t i = 0; i < capacity();) {
+            if (used_[i] && pred(slots_[i].key, slots_[i].value)) {
+                erase_at(i);
+                ++removed;
+                // The shift may have pulled an unvisited entry into i
+                continue;
+            }
+            ++i;
+        }
+        return removed;
+    }
+
+    template<typename Fn>
+    void for_each(Fn fn) const {
+        for (size_t i = 0; i < capacity(); ++i) {
+            if (used_[i]) fn(slots_[i].key, slots_[i].value);
+        }
+    }
+
+    void clear() {
+        std::fill(used_.begin(), used_.end(), 0);
+        size_ = 0;
+    }
+
+    void reserve(size_t n) {
+        const size_t needed = round_up(n * 4 / 3 + 1);
+        if (needed > capacity()) rehash(needed);
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    static constexpr size_t NPOS = ~size_t{0};
+
+    struct Slot {
+        K key;
+        V value;
+    };
+
+    static size_t round_up(size_t n) {
+        size_t p = 16;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    size_t bucket(const K& key) const { return hash_(key) & mask_; }
+
+    size_t locate(const K& key) const {
+        size_t i = bucket(key);
+        while (used_[i]) {
+            if (eq_(slots_[i].key, key)) return i;
+            i = (i + 1) & mask_;
+        }
+        return NPOS;
+    }
+
+    // Backward-shift deletion: pull later members of the probe run into
+    // the hole unless that would move them before their home bucket
+    void erase_at(size_t hole) {
+        size_t next = (hole + 1) & mask_;
+        while (used_[next]) {
+            const size_t home = bucket(slots_[next].key);
+            if (((next - home) & mask_) >= ((next - hole) & mask_)) {
+                slots_[hole] = std::move(slots_[next]);
+                hole = next;
+            }
+            next = (next + 1) & mask_;
+        }
+        used_[hole] = 0;
+        --size_;
+    }
+
+    void rehash(size_t new_capacity) {
+        std::vector<Slot> old_slots = std::move(slots_);
+        std::vector<uint8_t> old_used = std::move(used_);
+        slots_ = std::vector<Slot>(new_capacity);
+        used_.assign(new_capacity, 0);
+        mask_ = new_capacity - 1;
+        size_ = 0;
+        for (size_t i = 0; i < old_used.size(); ++i) {
+            if (!old_used[i]) continue;
+            size_t j = bucket(old_slots[i].key);
+            while (used_[j]) j = (j + 1) & mask_;
+            used_[j] = 1;
+            slots_[j] = std::move(old_slots[i]);
+            ++size_;
+        }
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<uint8_t> used_;
+    size_t mask_{0};
+    size_t size_{0};
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] Eq eq_;
+};
+
+} // namespace utils
+} // namespace quids
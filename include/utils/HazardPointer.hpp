@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// Hazard pointers for the node-based lock-free containers.
+//
+// A thread publishes the nodes it is about to dereference in its record;
+// retired nodes are only freed once no record names them. Records are
+// claimed on a thread's first use, handed back when it exits, and never
+// freed before the process ends, so readers can walk the record list
+// without locks.
+class HazardPointers {
+public:
+    static constexpr size_t SLOTS_PER_THREAD = 2;
+
+    // Owns one hazard slot of the calling thread for its lifetime
+    class Guard {
+    public:
+        explicit Guard(size_t slot) : slot_(&local().record->hazards[slot]) {}
+        ~Guard() { reset(); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        // Loads src until the published value is still current, after
+        // which the node cannot be freed until reset()
+        template<typename T>
+        T* protect(const std::atomic<T*>& src) {
+            T* p = src.load(std::memory_order_acquire);
+            while (true) {
+                slot_->store(p, std::memory_order_seq_cst);
+                T* again = src.load(std::memory_order_acquire);
+                if (again == p) {
+                    return p;
+                }
+                p = again;
+            }
+        }
+
+        void reset() { slot_->store(nullptr, std::memory_order_release); }
+
+    private:
+        std::atomic<void*>* slot_;
+    };
+
+    // Deletes p once no thread holds a hazard on it
+    template<typename T>
+    static void retire(T* p) {
+        ThreadState& state = local();
+        state.retired.push_back(Retired{p, [](void* q) { delete static_cast<T*>(q); }});
+        if (state.retired.size() >= SCAN_THRESHOLD) {
+            domain().scan(state.retired);
+        }
+    }
+
+private:
+    static constexpr size_t SCAN_THRESHOLD = 64;
+
+    struct Record {
+        std::atomic<void*> hazards[SLOTS_PER_THREAD] = {};
+        std::atomic<bool> active{false};
+        Record* next{nullptr};
+    };
+
+    struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+    };
+
+    class Domain {
+    public:
+        ~Domain() {
+            for (auto& r : orphans_) r.deleter(r.ptr);
+            Record* r = head_.load(std::memory_order_acquire);
+            while (r) {
+                Record* next = r->next;
+                delete r;
+                r = next;
+            }
+        }
+
+        Record* acquire() {
+            for (Record* r = head_.load(std::memory_order_acquire); r; r = r->next) {
+                bool expected = false;
+                if (!r->active.load(std::memory_order_relaxed) &&
+                    r->active.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                    return r;
+                }
+            }
+            auto* r = new Record;
+            r->active.store(true, std::memory_order_relaxed);
+            Record* head = head_.load(std::memory_order_relaxed);
+            do {
+                r->next = head;
+            } while (!head_.compare_exchange_weak(head, r, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+            return r;
+        }
+
+        void release(Record* record, std::vector<Retired>& retired) {
+            for (auto& h : record->hazards) {
+                h.store(nullptr, std::memory_order_release);
+            }
+            scan(retired);
+            record->active.store(false, std::memory_order_release);
+            // Whatever is still protected is picked up by a later scan
+            if (!retired.empty()) {
+                std::lock_guard<std::mutex> lock(orphans_mutex_);
+                orphans_.insert(orphans_.end(), retired.begin(), retired.end());
+                retired.clear();
+            }
+        }
+
+        void scan(std::vector<Retired>& retired) {
+            {
+                std::unique_lock<std::mutex> lock(orphans_mutex_, std::try_to_lock);
+                if (lock.owns_lock() && !orphans_.empty()) {
+                    retired.insert(retired.end(), orphans_.begin(), orphans_.end());
+                    orphans_.clear();
+                }
+            }
+
+            std::vector<void*> hazards;
+            for (Record* r = head_.load(std::memory_order_acquire); r; r = r->next) {
+                for (auto& h : r->hazards) {
+                    if (void* p = h.load(std::memory_order_seq_cst)) {
+                        hazards.push_back(p);
+                    }
+                }
+            }
+            std::sort(hazards.begin(), hazards.end());
+
+            auto keep = std::partition(retired.begin(), retired.end(), [&](const Retired& r) {
+                return std::binary_search(hazards.begin(), hazards.end(), r.ptr);
+            });
+            for (auto it = keep; it != retired.end(); ++it) {
+                it->deleter(it->ptr);
+            }
+            retired.erase(keep, retired.end());
+        }
+
+    private:
+        std::atomic<Record*> head_{nullptr};
+        std::mutex orphans_mutex_;
+        std::vector<Retired> orphans_;
+    };
+
+    struct ThreadState {
+        Record* record;
+        std::vector<Retired> retired;
+
+        ThreadState() : record(domain().acquire()) {}
+        ~ThreadState() { domain().release(record, retired); }
+    };
+
+    static Domain& domain() {
+        static Domain instance;
+        return instance;
+    }
+
+    static ThreadState& local() {
+        // Thread-local objects are destroyed before the static domain
+        thread_local ThreadState state;
+        return state;
+    }
+};
+
+} // namespace utils
+} // namespace quids
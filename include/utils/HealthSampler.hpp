@@ -0,0 +1,355 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#endif
+
+namespace quids {
+namespace utils {
+
+// Process resource use over one tick
+struct HealthSample {
+    double cpu_usage{0.0};          // share of all cores, 0 to 1
+    double memory_mb{0.0};          // resident set
+    double disk_usage{0.0};         // used share of the data volume, 0 to 1
+    double network_latency_us{0.0}; // mean peer round trip; the last one seen if no new ones
+};
+
+struct HealthSnapshot {
+    HealthSample latest;
+    // Means over the ticks in each window, or over the ticks so far
+    HealthSample last_1s;
+    HealthSample last_10s;
+    HealthSample last_60s;
+    double cpu_peak_10s{0.0};
+    uint64_t ticks{0};
+    int64_t sampled_at_ns{0};  // steady_clock
+};
+
+// Background sampler for SystemHealth and for the controllers that adapt to
+// load.
+//
+// One thread reads getrusage, /proc/self/statm and statvfs once per tick.
+// The sampler thread is the only one that touches the per-tick ring. It
+// averages the 1 s, 10 s and 60 s windows and publishes the result behind
+// a seqlock. snapshot() is a handful of relaxed loads on any thread, with
+// no syscall and no lock, so health checks, RPC handlers and batch
+// controllers can read it each time they need it. A reader retries only
+// while a publish is in progress.
+//
+// Network latency is pushed in, not polled: the transport reports round
+// trips with record_network_latency() and each tick takes their mean.
+class HealthSampler {
+public:
+    struct Config {
+        std::chrono::milliseconds tick{100};
+        // Volume whose usage is reported, typically the data directory
+        std::string disk_path{"."};
+    };
+
+    static HealthSampler& global() {
+        static HealthSampler* sampler = new HealthSampler();
+        return *sampler;
+    }
+
+    HealthSampler() = default;
+    ~HealthSampler() {
+        stop();
+#if defined(__linux__)
+        if (statm_fd_ >= 0) {
+            ::close(statm_fd_);
+        }
+#endif
+    }
+
+    HealthSampler(const HealthSampler&) = delete;
+    HealthSampler& operator=(const HealthSampler&) = delete;
+
+    // Restarts with the new configuration if already running
+    void start(const Config& config) {
+        stop();
+        std::lock_guard<std::mutex> lock(mutex_);
+        config_ = config;
+        config_.tick = std::max(config_.tick, std::chrono::milliseconds(1));
+        reset_locked();
+        stop_ = false;
+        thread_ = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    // While stopped, for callers that drive tick() themselves
+    void configure(const Config& config) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config_ = config;
+        config_.tick = std::max(config_.tick, std::chrono::milliseconds(1));
+        reset_locked();
+    }
+
+    // One tick now, on the calling thread. The sampler thread calls it;
+    // tests and single-threaded tools may call it instead of start().
+    void tick() {
+        std::lock_guard<std::mutex> lock(tick_mutex_);
+        const auto now = std::chrono::steady_clock::now();
+        HealthSample sample;
+        read_cpu(sample, now);
+        sample.memory_mb = read_resident_mb();
+        sample.disk_usage = read_disk_usage();
+        const uint64_t count = latency_count_.exchange(0, std::memory_order_acq_rel);
+        const uint64_t sum = latency_sum_us_.exchange(0, std::memory_order_acq_rel);
+        if (count > 0) {
+            last_latency_us_ = static_cast<double>(sum) / static_cast<double>(count);
+        }
+        sample.network_latency_us = last_latency_us_;
+
+        if (ring_.empty()) {
+            ring_.resize(ticks_in(std::chrono::seconds(60)));
+        }
+        ring_[ticks_ % ring_.size()] = sample;
+        ++ticks_;
+
+        HealthSnapshot snapshot;
+        snapshot.latest = sample;
+        snapshot.last_1s = mean_over(ticks_in(std::chrono::seconds(1)));
+        snapshot.last_10s = mean_over(ticks_in(std::chrono::seconds(10)));
+        snapshot.last_60s = mean_over(ring_.size());
+        const size_t peak_window = std::min<uint64_t>(ticks_, ticks_in(std::chrono::seconds(10)));
+        for (size_t i = 0; i < peak_window; ++i) {
+            snapshot.cpu_peak_10s = std::max(snapshot.cpu_peak_10s, ring_[(ticks_ - 1 - i) % ring_.size()].cpu_usage);
+        }
+        snapshot.ticks = ticks_;
+        snapshot.sampled_at_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        publish(snapshot);
+    }
+
+    // Latest published snapshot; all zero before the first tick
+    [[nodiscard]] HealthSnapshot snapshot() const noexcept {
+        std::array<uint64_t, NUM_WORDS> words;
+        while (true) {
+            const uint64_t seq = seq_.load(std::memory_order_acquire);
+            if (seq & 1) {
+                continue;
+            }
+            for (size_t i = 0; i < NUM_WORDS; ++i) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == seq) {
+                break;
+            }
+        }
+        return decode(words);
+    }
+
+    // One peer round trip; any thread
+    void record_network_latency(std::chrono::microseconds rtt) noexcept {
+        latency_sum_us_.fetch_add(static_cast<uint64_t>(std::max<int64_t>(0, rtt.count())), std::memory_order_relaxed);
+        latency_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    // Four samples, the 10 s CPU peak, the tick count and the timestamp
+    static constexpr size_t SAMPLE_WORDS = 4;
+    static constexpr size_t NUM_WORDS = 4 * SAMPLE_WORDS + 3;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto next = std::chrono::steady_clock::now();
+        while (!stop_) {
+            lock.unlock();
+            tick();
+            lock.lock();
+            // Fixed-rate, so windows hold the number of ticks they claim;
+            // after a stall it restarts from now rather than catching up
+            next = std::max(next + config_.tick, std::chrono::steady_clock::now());
+            cv_.wait_until(lock, next, [this] { return stop_; });
+        }
+    }
+
+    void reset_locked() {
+        std::lock_guard<std::mutex> lock(tick_mutex_);
+        ring_.clear();
+        ticks_ = 0;
+        last_cpu_ns_ = -1;
+        publish(HealthSnapshot{});
+    }
+
+    size_t ticks_in(std::chrono::milliseconds window) const {
+        return std::max<size_t>(1, static_cast<size_t>(window / config_.tick));
+    }
+
+    HealthSample mean_over(size_t window) const {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(ticks_, std::min(window, ring_.size())));
+        HealthSample mean;
+        for (size_t i = 0; i < n; ++i) {
+            const auto& s = ring_[(ticks_ - 1 - i) % ring_.size()];
+            mean.cpu_usage += s.cpu_usage;
+            mean.memory_mb += s.memory_mb;
+            mean.disk_usage += s.disk_usage;
+            mean.network_latency_us += s.network_latency_us;
+        }
+        if (n > 0) {
+            const double d = static_cast<double>(n);
+            mean.cpu_usage /= d;
+            mean.memory_mb /= d;
+            mean.disk_usage /= d;
+            mean.network_latency_us /= d;
+        }
+        return mean;
+    }
+
+    void read_cpu(HealthSample& sample, std::chrono::steady_clock::time_point now) {
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return;
+        }
+        auto ns = [](const timeval& tv) { return int64_t{tv.tv_sec} * 1'000'000'000 + int64_t{tv.tv_usec} * 1000; };
+        const int64_t cpu_ns = ns(usage.ru_utime) + ns(usage.ru_stime);
+        const int64_t wall_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        if (last_cpu_ns_ >= 0 && wall_ns > last_wall_ns_) {
+            const double cores = std::max(1u, std::thread::hardware_concurrency());
+            sample.cpu_usage = std::clamp(static_cast<double>(cpu_ns - last_cpu_ns_) /
+                                              (static_cast<double>(wall_ns - last_wall_ns_) * cores),
+                                          0.0, 1.0);
+        }
+        last_cpu_ns_ = cpu_ns;
+        last_wall_ns_ = wall_ns;
+#else
+        (void)sample;
+        (void)now;
+#endif
+    }
+
+    double read_resident_mb() {
+#if defined(__linux__)
+        // Kept open; each tick is one pread
+        if (statm_fd_ < 0) {
+            statm_fd_ = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+        }
+        char buffer[128];
+        const ssize_t n = statm_fd_ < 0 ? -1 : ::pread(statm_fd_, buffer, sizeof(buffer) - 1, 0);
+        if (n > 0) {
+            buffer[n] = '\0';
+            unsigned long long size = 0;
+            unsigned long long resident = 0;
+            if (std::sscanf(buffer, "%llu %llu", &size, &resident) == 2) {
+                static const long page = ::sysconf(_SC_PAGESIZE);
+                return static_cast<double>(resident) * static_cast<double>(page) / (1 << 20);
+            }
+        }
+        return 0.0;
+#elif defined(__APPLE__)
+        // Peak rather than current, in bytes on macOS
+        rusage usage{};
+        return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<double>(usage.ru_maxrss) / (1 << 20) : 0.0;
+#else
+        return 0.0;
+#endif
+    }
+
+    double read_disk_usage() const {
+#if defined(__unix__) || defined(__APPLE__)
+        struct statvfs volume{};
+        if (::statvfs(config_.disk_path.c_str(), &volume) != 0 || volume.f_blocks == 0) {
+            return 0.0;
+        }
+        return 1.0 - static_cast<double>(volume.f_bavail) / static_cast<double>(volume.f_blocks);
+#else
+        return 0.0;
+#endif
+    }
+
+    void publish(const HealthSnapshot& snapshot) noexcept {
+        const std::array<uint64_t, NUM_WORDS> words = encode(snapshot);
+        const uint64_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < NUM_WORDS; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    static std::array<uint64_t, NUM_WORDS> encode(const HealthSnapshot& s) noexcept {
+        std::array<uint64_t, NUM_WORDS> words{};
+        size_t i = 0;
+        for (const HealthSample* sample : {&s.latest, &s.last_1s, &s.last_10s, &s.last_60s}) {
+            words[i++] = std::bit_cast<uint64_t>(sample->cpu_usage);
+            words[i++] = std::bit_cast<uint64_t>(sample->memory_mb);
+            words[i++] = std::bit_cast<uint64_t>(sample->disk_usage);
+            words[i++] = std::bit_cast<uint64_t>(sample->network_latency_us);
+        }
+        words[i++] = std::bit_cast<uint64_t>(s.cpu_peak_10s);
+        words[i++] = s.ticks;
+        words[i++] = static_cast<uint64_t>(s.sampled_at_ns);
+        return words;
+    }
+
+    static HealthSnapshot decode(const std::array<uint64_t, NUM_WORDS>& words) noexcept {
+        HealthSnapshot s;
+        size_t i = 0;
+        for (HealthSample* sample : {&s.latest, &s.last_1s, &s.last_10s, &s.last_60s}) {
+            sample->cpu_usage = std::bit_cast<double>(words[i++]);
+            sample->memory_mb = std::bit_cast<double>(words[i++]);
+            sample->disk_usage = std::bit_cast<double>(words[i++]);
+            sample->network_latency_us = std::bit_cast<double>(words[i++]);
+        }
+        s.cpu_peak_10s = std::bit_cast<double>(words[i++]);
+        s.ticks = words[i++];
+        s.sampled_at_ns = static_cast<int64_t>(words[i++]);
+        return s;
+    }
+
+    // Lifecycle
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_{true};
+    std::thread thread_;
+    Config config_;
+
+    // Sampler state; tick_mutex_ only orders a manual tick() with the thread
+    std::mutex tick_mutex_;
+    std::vector<HealthSample> ring_;
+    uint64_t ticks_{0};
+    int64_t last_cpu_ns_{-1};
+    int64_t last_wall_ns_{0};
+    double last_latency_us_{0.0};
+    int statm_fd_{-1};
+
+    std::atomic<uint64_t> latency_sum_us_{0};
+    std::atomic<uint64_t> latency_count_{0};
+
+    // Published snapshot
+    std::atomic<uint64_t> seq_{0};
+    std::array<std::atomic<uint64_t>, NUM_WORDS> words_{};
+};
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,321 @@
+#pragma once
+
+#include "utils/CpuFeatures.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define QUIDS_HEX_X86 1
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define QUIDS_HEX_NEON 1
+#endif
+
+// Hex text for hashes, roots, keys and addresses where they cross the API
+// and storage boundary. Encoding writes lowercase digits, two per byte, and
+// decoding takes either case with no prefix. Everything writes into a
+// buffer the caller sizes, so a hot path can reuse one.
+//
+// The kernels take 16 bytes at a time with SSSE3 shuffles (picked on
+// SSE4.2 hosts, which all have them), 32 with AVX2 and 16 with NEON; the
+// tail and other hosts go through the scalar loop.
+
+namespace quids::utils {
+
+namespace hex_detail {
+
+inline constexpr char DIGITS[] = "0123456789abcdef";
+
+inline int digitValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// n bytes in, 2n characters out
+using Encode = void (*)(const uint8_t* in, size_t n, char* out);
+// 2n characters in, n bytes out; false at the first non-digit
+using Decode = bool (*)(const char* in, size_t n, uint8_t* out);
+using Validate = bool (*)(const char* in, size_t n);
+
+inline void encodeScalar(const uint8_t* in, size_t n, char* out) {
+    for (size_t i = 0; i < n; ++i) {
+        out[2 * i] = DIGITS[in[i] >> 4];
+        out[2 * i + 1] = DIGITS[in[i] & 0x0f];
+    }
+}
+
+inline bool decodeScalar(const char* in, size_t n, uint8_t* out) {
+    for (size_t i = 0; i < n; ++i) {
+        const int high = digitValue(in[2 * i]);
+        const int low = digitValue(in[2 * i + 1]);
+        if ((high | low) < 0) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+inline bool validateScalar(const char* in, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (digitValue(in[i]) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if QUIDS_HEX_X86
+// Digit values of each lane, and in valid the lanes that hold a digit.
+// c - '0' is at most 9 only for '0'-'9', and (c | 0x20) - 'a' at most 5
+// only for 'a'-'f' and 'A'-'F'.
+__attribute__((target("sse4.2"), always_inline)) inline __m128i valuesSse(__m128i c, __m128i& valid) {
+    const __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    valid = _mm_or_si128(is_digit, is_letter);
+    return _mm_or_si128(_mm_and_si128(is_digit, digit),
+                        _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+__attribute__((target("sse4.2"))) inline void encodeSse(const uint8_t* in, size_t n, char* out) {
+    const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(DIGITS));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(v, nibble));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+    }
+    encodeScalar(in + i, n - i, out + 2 * i);
+}
+
+__attribute__((target("sse4.2"))) inline bool decodeSse(const char* in, size_t n, uint8_t* out) {
+    // 16 * high + low for each pair of lanes
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i valid0, valid1;
+        const __m128i v0 = valuesSse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i)), valid0);
+        const __m128i v1 = valuesSse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i + 16)), valid1);
+        if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xffff) {
+            return false;
+        }
+        const __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(v0, weights), _mm_maddubs_epi16(v1, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+    return decodeScalar(in + 2 * i, n - i, out + i);
+}
+
+__attribute__((target("sse4.2"))) inline bool validateSse(const char* in, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i valid;
+        valuesSse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), valid);
+        if (_mm_movemask_epi8(valid) != 0xffff) {
+            return false;
+        }
+    }
+    return validateScalar(in + i, n - i);
+}
+
+__attribute__((target("avx2"), always_inline)) inline __m256i valuesAvx2(__m256i c, __m256i& valid) {
+    const __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+    const __m256i letter = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    const __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+    valid = _mm256_or_si256(is_digit, is_letter);
+    return _mm256_or_si256(_mm256_and_si256(is_digit, digit),
+                           _mm256_and_si256(is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2"))) inline void encodeAvx2(const uint8_t* in, size_t n, char* out) {
+    const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(DIGITS)));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        const __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, nibble));
+        // Unpacking stays within 128-bit lanes: bytes 0-7 and 16-23, then
+        // 8-15 and 24-31
+        const __m256i first = _mm256_unpacklo_epi8(high, low);
+        const __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    encodeSse(in + i, n - i, out + 2 * i);
+}
+
+__attribute__((target("avx2"))) inline bool decodeAvx2(const char* in, size_t n, uint8_t* out) {
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i valid0, valid1;
+        const __m256i v0 = valuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i)), valid0);
+        const __m256i v1 = valuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 2 * i + 32)), valid1);
+        if (_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1) {
+            return false;
+        }
+        // Packing interleaves the lanes as bytes 0-7, 16-23, 8-15, 24-31
+        const __m256i packed = _mm256_packus_epi16(_mm256_maddubs_epi16(v0, weights),
+                                                   _mm256_maddubs_epi16(v1, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    return decodeSse(in + 2 * i, n - i, out + i);
+}
+
+__attribute__((target("avx2"))) inline bool validateAvx2(const char* in, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i valid;
+        valuesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)), valid);
+        if (_mm256_movemask_epi8(valid) != -1) {
+            return false;
+        }
+    }
+    return validateSse(in + i, n - i);
+}
+#endif
+
+#if QUIDS_HEX_NEON
+inline uint8x16_t valuesNeon(uint8x16_t c, uint8x16_t& valid) {
+    const uint8x16_t digit = vsubq_u8(c, vdupq_n_u8('0'));
+    const uint8x16_t letter = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+    const uint8x16_t is_digit = vcleq_u8(digit, vdupq_n_u8(9));
+    const uint8x16_t is_letter = vcleq_u8(letter, vdupq_n_u8(5));
+    valid = vorrq_u8(is_digit, is_letter);
+    return vorrq_u8(vandq_u8(is_digit, digit), vandq_u8(is_letter, vaddq_u8(letter, vdupq_n_u8(10))));
+}
+
+inline void encodeNeon(const uint8_t* in, size_t n, char* out) {
+    const uint8x16_t digits = vld1q_u8(reinterpret_cast<const uint8_t*>(DIGITS));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t v = vld1q_u8(in + i);
+        uint8x16x2_t pair;
+        pair.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(v, 4));
+        pair.val[1] = vqtbl1q_u8(digits, vandq_u8(v, vdupq_n_u8(0x0f)));
+        // Stores the two interleaved, high digit first
+        vst2q_u8(reinterpret_cast<uint8_t*>(out + 2 * i), pair);
+    }
+    encodeScalar(in + i, n - i, out + 2 * i);
+}
+
+inline bool decodeNeon(const char* in, size_t n, uint8_t* out) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        // Even characters into val[0], odd into val[1]
+        const uint8x16x2_t pair = vld2q_u8(reinterpret_cast<const uint8_t*>(in + 2 * i));
+        uint8x16_t valid_high, valid_low;
+        const uint8x16_t high = valuesNeon(pair.val[0], valid_high);
+        const uint8x16_t low = valuesNeon(pair.val[1], valid_low);
+        if (vminvq_u8(vandq_u8(valid_high, valid_low)) != 0xff) {
+            return false;
+        }
+        vst1q_u8(out + i, vorrq_u8(vshlq_n_u8(high, 4), low));
+    }
+    return decodeScalar(in + 2 * i, n - i, out + i);
+}
+
+inline bool validateNeon(const char* in, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t valid;
+        valuesNeon(vld1q_u8(reinterpret_cast<const uint8_t*>(in + i)), valid);
+        if (vminvq_u8(valid) != 0xff) {
+            return false;
+        }
+    }
+    return validateScalar(in + i, n - i);
+}
+#endif
+
+inline Encode encodeKernel() {
+    static const Encode kernel = selectKernel<Encode>("utils.hex_encode", {
+#if QUIDS_HEX_X86
+        {CpuFeature::Avx2, encodeAvx2},
+        {CpuFeature::Sse42, encodeSse},
+#endif
+#if QUIDS_HEX_NEON
+        {CpuFeature::Neon, encodeNeon},
+#endif
+        {CpuFeature::Scalar, encodeScalar},
+    });
+    return kernel;
+}
+
+inline Decode decodeKernel() {
+    static const Decode kernel = selectKernel<Decode>("utils.hex_decode", {
+#if QUIDS_HEX_X86
+        {CpuFeature::Avx2, decodeAvx2},
+        {CpuFeature::Sse42, decodeSse},
+#endif
+#if QUIDS_HEX_NEON
+        {CpuFeature::Neon, decodeNeon},
+#endif
+        {CpuFeature::Scalar, decodeScalar},
+    });
+    return kernel;
+}
+
+inline Validate validateKernel() {
+    static const Validate kernel = selectKernel<Validate>("utils.hex_validate", {
+#if QUIDS_HEX_X86
+        {CpuFeature::Avx2, validateAvx2},
+        {CpuFeature::Sse42, validateSse},
+#endif
+#if QUIDS_HEX_NEON
+        {CpuFeature::Neon, validateNeon},
+#endif
+        {CpuFeature::Scalar, validateScalar},
+    });
+    return kernel;
+}
+
+} // namespace hex_detail
+
+// out holds 2 * bytes.size() characters; nothing is terminated
+inline void hexEncode(std::span<const uint8_t> bytes, char* out) {
+    hex_detail::encodeKernel()(bytes.data(), bytes.size(), out);
+}
+
+inline std::string toHex(std::span<const uint8_t> bytes) {
+    std::string out(2 * bytes.size(), '\0');
+    hexEncode(bytes, out.data());
+    return out;
+}
+
+// out holds hex.size() / 2 bytes. False on an odd length or a character
+// that is not a hex digit, in which case out may be partly written.
+inline bool hexDecode(std::string_view hex, uint8_t* out) {
+    return hex.size() % 2 == 0 && hex_detail::decodeKernel()(hex.data(), hex.size() / 2, out);
+}
+
+inline std::optional<std::vector<uint8_t>> fromHex(std::string_view hex) {
+    std::vector<uint8_t> out(hex.size() / 2);
+    if (!hexDecode(hex, out.data())) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+// Every character is a hex digit, in either case
+inline bool isHex(std::string_view text) {
+    return hex_detail::validateKernel()(text.data(), text.size());
+}
+
+} // namespace quids::utils
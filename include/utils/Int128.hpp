@@ -0,0 +1,17 @@
+#pragma once
+
+// The one spelling of GCC and Clang's 128-bit integer. Declaring it with
+// __extension__ keeps -Wpedantic quiet in every translation unit that uses
+// u128, where a bare `unsigned __int128` warns at each mention. Callers
+// that also build elsewhere keep their own fallback behind
+// QUIDS_HAS_INT128.
+
+#if defined(__SIZEOF_INT128__)
+#define QUIDS_HAS_INT128 1
+
+namespace quids::utils {
+
+__extension__ typedef unsigned __int128 u128;
+
+} // namespace quids::utils
+#endif
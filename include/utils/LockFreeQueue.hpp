@@ -1,5 +1,6 @@
 #pragma once
 
+#include "utils/HazardPointer.hpp"
 #include <atomic>
 #include <memory>
 #include <optional>
@@ -8,18 +9,22 @@
 namespace quids {
 namespace utils {
 
+// Unbounded Michael-Scott queue. Dequeued nodes are reclaimed through
+// hazard pointers; for bounded hot paths prefer BoundedQueue, which does
+// not allocate per element.
 template<typename T>
 class LockFreeQueue {
     static_assert(std::is_move_constructible_v<T>, "T must be move constructible");
     static_assert(std::is_move_assignable_v<T>, "T must be move assignable");
 
 private:
+    // Value lives inline so a push costs one allocation
     struct Node {
-        std::unique_ptr<T> data;
+        std::optional<T> data;
         std::atomic<Node*> next{nullptr};
         
         Node() = default;
-        explicit Node(T&& item) : data(std::make_unique<T>(std::move(item))) {}
+        explicit Node(T&& item) : data(std::move(item)) {}
     };
 
     alignas(64) std::atomic<Node*> head_{nullptr};
@@ -99,50 +104,62 @@ public:
     }
 
     void push(T item) {
-        auto new_node = std::make_unique<Node>(std::move(item));
-        auto new_node_ptr = new_node.get();
+        auto* node = new Node(std::move(item));
+        HazardPointers::Guard tail_guard(0);
         
         while (true) {
-            auto tail = tail_.load();
-            auto next = tail->next.load();
+            Node* tail = tail_guard.protect(tail_);
+            Node* next = tail->next.load(std::memory_order_acquire);
             
-            if (tail == tail_.load()) {
-                if (next == nullptr) {
-                    if (tail->next.compare_exchange_weak(next, new_node_ptr)) {
-                        tail_.compare_exchange_strong(tail, new_node_ptr);
-                        new_node.release();
-                        size_.fetch_add(1);
-                        return;
-                    }
-                } else {
-                    tail_.compare_exchange_strong(tail, next);
-                }
+            if (tail != tail_.load(std::memory_order_acquire)) {
+                continue;
+            }
+            if (next != nullptr) {
+                // Help a push that linked its node but has not swung tail_
+                tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+                                            std::memory_order_relaxed);
+                continue;
+            }
+            if (tail->next.compare_exchange_weak(next, node, std::memory_order_release,
+                                                 std::memory_order_relaxed)) {
+                tail_.compare_exchange_strong(tail, node, std::memory_order_release,
+                                              std::memory_order_relaxed);
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return;
             }
         }
     }
 
     std::optional<T> pop() {
+        HazardPointers::Guard head_guard(0);
+        HazardPointers::Guard next_guard(1);
+        
         while (true) {
-            auto head = head_.load();
-            auto tail = tail_.load();
-            auto next = head->next.load();
+            Node* head = head_guard.protect(head_);
+            Node* tail = tail_.load(std::memory_order_acquire);
+            Node* next = next_guard.protect(head->next);
             
-            if (head == head_.load()) {
-                if (head == tail) {
-                    if (next == nullptr) {
-                        return std::nullopt;
-                    }
-                    tail_.compare_exchange_strong(tail, next);
-                } else {
-                    if (next) {
-                        auto result = std::move(*next->data);
-                        if (head_.compare_exchange_weak(head, next)) {
-                            size_.fetch_sub(1);
-                            delete head;
-                            return result;
-                        }
-                    }
-                }
+            if (head != head_.load(std::memory_order_acquire)) {
+                continue;
+            }
+            if (next == nullptr) {
+                return std::nullopt;
+            }
+            if (head == tail) {
+                tail_.compare_exchange_weak(tail, next, std::memory_order_release,
+                                            std::memory_order_relaxed);
+                continue;
+            }
+            if (head_.compare_exchange_weak(head, next, std::memory_order_acq_rel,
+                                            std::memory_order_relaxed)) {
+                // next is the new dummy; only the winner reads its value,
+                // and the hazard on it keeps a later pop from freeing it
+                std::optional<T> result(std::move(next->data));
+                next->data.reset();
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                head_guard.reset();
+                HazardPointers::retire(head);
+                return result;
             }
         }
     }
@@ -0,0 +1,439 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// Hot-path metrics. Writers touch only their own shard with relaxed
+// atomics, so recording never takes a lock or bounces a cache line
+// between cores; readers sum the shards when they scrape.
+namespace metrics_detail {
+
+constexpr size_t NUM_SHARDS = 16;
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Threads are spread round-robin over the shards on first use
+inline size_t shard_index() noexcept {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+    return index;
+}
+
+inline void atomic_max(std::atomic<uint64_t>& target, uint64_t value) noexcept {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+} // namespace metrics_detail
+
+class Counter {
+public:
+    void add(uint64_t n = 1) noexcept {
+        shards_[metrics_detail::shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t value() const noexcept {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void reset() noexcept {
+        for (auto& shard : shards_) {
+            shard.value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct alignas(metrics_detail::CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, metrics_detail::NUM_SHARDS> shards_;
+};
+
+// Last value wins; for levels such as queue depth, not for rates
+class Gauge {
+public:
+    void set(int64_t v) noexcept { value_.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+    [[nodiscard]] int64_t value() const noexcept { return value_.load(std::memory_order_relaxed); }
+    void reset() noexcept { set(0); }
+
+private:
+    alignas(metrics_detail::CACHE_LINE_SIZE) std::atomic<int64_t> value_{0};
+};
+
+// Merged view of a histogram at one point in time
+struct HistogramSnapshot {
+    uint64_t count{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+    std::vector<uint64_t> buckets;
+
+    [[nodiscard]] double mean() const noexcept {
+        return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+    }
+
+    // Value at quantile q in [0, 1], within one bucket's relative error
+    [[nodiscard]] uint64_t quantile(double q) const noexcept;
+
+    void merge(const HistogramSnapshot& other);
+};
+
+// Log-linear buckets in the style of HdrHistogram: every power of two is
+// split into SUB_BUCKETS equal parts, which bounds the relative error of a
+// quantile by 1/SUB_BUCKETS (about 6%) across the whole range. Values are
+// unitless; latencies are recorded in nanoseconds. Values past 2^40 (about
+// 18 minutes in ns) land in the last bucket.
+class Histogram {
+public:
+    static constexpr size_t SUB_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BITS;
+    static constexpr size_t MAX_BITS = 40;
+    static constexpr size_t NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    static constexpr size_t bucket_of(uint64_t v) noexcept {
+        if (v < 2 * SUB_BUCKETS) {
+            return static_cast<size_t>(v);
+        }
+        const size_t msb = 63 - static_cast<size_t>(std::countl_zero(v));
+        if (msb >= MAX_BITS) {
+            return NUM_BUCKETS - 1;
+        }
+        const size_t shift = msb - SUB_BITS;
+        return shift * SUB_BUCKETS + static_cast<size_t>(v >> shift);
+    }
+
+    // Smallest value that maps to the bucket
+    static constexpr uint64_t bucket_floor(size_t index) noexcept {
+        if (index < 2 * SUB_BUCKETS) {
+            return index;
+        }
+        const size_t shift = index / SUB_BUCKETS - 1;
+        return static_cast<uint64_t>(index - shift * SUB_BUCKETS) << shift;
+    }
+
+    // Midpoint of the bucket, which halves the worst-case error
+    static constexpr uint64_t bucket_value(size_t index) noexcept {
+        if (index < 2 * SUB_BUCKETS) {
+            return index;
+        }
+        const size_t shift = index / SUB_BUCKETS - 1;
+        return bucket_floor(index) + ((uint64_t{1} << shift) >> 1);
+    }
+
+    Histogram() : shards_(std::make_unique<Shard[]>(metrics_detail::NUM_SHARDS)) {}
+
+    void record(uint64_t v) noexcept {
+        Shard& shard = shards_[metrics_detail::shard_index()];
+        shard.buckets[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(v, std::memory_order_relaxed);
+        metrics_detail::atomic_max(shard.max, v);
+    }
+
+    template<typename Rep, typename Period>
+    void record(std::chrono::duration<Rep, Period> d) noexcept {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        record(ns > 0 ? static_cast<uint64_t>(ns) : 0);
+    }
+
+    [[nodiscard]] HistogramSnapshot snapshot() const {
+        HistogramSnapshot s;
+        s.buckets.assign(NUM_BUCKETS, 0);
+        for (size_t i = 0; i < metrics_detail::NUM_SHARDS; ++i) {
+            const Shard& shard = shards_[i];
+            s.count += shard.count.load(std::memory_order_relaxed);
+            s.sum += shard.sum.load(std::memory_order_relaxed);
+            s.max = std::max(s.max, shard.max.load(std::memory_order_relaxed));
+            for (size_t b = 0; b < NUM_BUCKETS; ++b) {
+                s.buckets[b] += shard.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+        return s;
+    }
+
+    // Not atomic with respect to concurrent record() calls
+    void reset() noexcept {
+        for (size_t i = 0; i < metrics_detail::NUM_SHARDS; ++i) {
+            Shard& shard = shards_[i];
+            shard.count.store(0, std::memory_order_relaxed);
+            shard.sum.store(0, std::memory_order_relaxed);
+            shard.max.store(0, std::memory_order_relaxed);
+            for (auto& bucket : shard.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct alignas(metrics_detail::CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets{};
+    };
+    std::unique_ptr<Shard[]> shards_;
+};
+
+inline uint64_t HistogramSnapshot::quantile(double q) const noexcept {
+    if (count == 0) {
+        return 0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    // Rank of the first value at or above q, counting from one
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * static_cast<double>(count) + 0.5));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return std::min(Histogram::bucket_value(b), max);
+        }
+    }
+    return max;
+}
+
+inline void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+    if (buckets.size() < other.buckets.size()) {
+        buckets.resize(other.buckets.size(), 0);
+    }
+    for (size_t b = 0; b < other.buckets.size(); ++b) {
+        buckets[b] += other.buckets[b];
+    }
+}
+
+// Records the time from construction to destruction
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram) noexcept
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { histogram_.record(std::chrono::steady_clock::now() - start_); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Named series for scraping. Registration is the slow path: look a metric
+// up once and keep the pointer. Series registered under the same name and
+// labels, e.g. one per instance of a component, are merged at scrape time.
+class MetricsRegistry {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    static MetricsRegistry& global() {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    // Owned by the registry; the same series always gives the same object
+    std::shared_ptr<Counter> counter(const std::string& name, const std::string& help, const Labels& labels = {}) {
+        return owned<Counter>(Kind::Counter, name, help, labels);
+    }
+    std::shared_ptr<Gauge> gauge(const std::string& name, const std::string& help, const Labels& labels = {}) {
+        return owned<Gauge>(Kind::Gauge, name, help, labels);
+    }
+    // Latency histograms take nanoseconds and are exported in seconds
+    std::shared_ptr<Histogram> histogram(const std::string& name, const std::string& help, const Labels& labels = {}) {
+        return owned<Histogram>(Kind::Histogram, name, help, labels);
+    }
+
+    // Owned by the caller and dropped from scrapes once it is destroyed
+    void attach(const std::string& name, const std::string& help, const Labels& labels,
+                const std::shared_ptr<Counter>& metric) {
+        add(Kind::Counter, name, help, labels, metric);
+    }
+    void attach(const std::string& name, const std::string& help, const Labels& labels,
+                const std::shared_ptr<Gauge>& metric) {
+        add(Kind::Gauge, name, help, labels, metric);
+    }
+    void attach(const std::string& name, const std::string& help, const Labels& labels,
+                const std::shared_ptr<Histogram>& metric) {
+        add(Kind::Histogram, name, help, labels, metric);
+    }
+
+    // Prometheus text exposition format, version 0.0.4. Histograms are
+    // exported as summaries with p50, p99 and p999.
+    [[nodiscard]] std::string scrape() const;
+
+private:
+    enum class Kind { Counter, Gauge, Histogram };
+
+    struct Series {
+        std::string labels;  // rendered, e.g. {stage="verify"}
+        std::shared_ptr<void> owned;
+        std::vector<std::weak_ptr<void>> attached;
+    };
+
+    struct Family {
+        Kind kind;
+        std::string help;
+        std::map<std::string, Series> series;  // by rendered labels
+    };
+
+    static std::string render_labels(const Labels& labels) {
+        if (labels.empty()) {
+            return {};
+        }
+        std::string out = "{";
+        for (const auto& [key, value] : labels) {
+            if (out.size() > 1) out += ',';
+            out += key;
+            out += "=\"";
+            for (char c : value) {
+                if (c == '\\' || c == '"') out += '\\';
+                if (c == '\n') { out += "\\n"; continue; }
+                out += c;
+            }
+            out += '"';
+        }
+        out += '}';
+        return out;
+    }
+
+    // Adds the quantile label to a series' rendered labels
+    static std::string with_label(const std::string& labels, const std::string& extra) {
+        if (labels.empty()) {
+            return "{" + extra + "}";
+        }
+        return labels.substr(0, labels.size() - 1) + "," + extra + "}";
+    }
+
+    template<typename T>
+    std::shared_ptr<T> owned(Kind kind, const std::string& name, const std::string& help, const Labels& labels) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& series = series_locked(kind, name, help, labels);
+        if (!series.owned) {
+            series.owned = std::make_shared<T>();
+        }
+        return std::static_pointer_cast<T>(series.owned);
+    }
+
+    void add(Kind kind, const std::string& name, const std::string& help, const Labels& labels,
+             std::shared_ptr<void> metric) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& series = series_locked(kind, name, help, labels);
+        auto& attached = series.attached;
+        attached.erase(std::remove_if(attached.begin(), attached.end(),
+                                      [](const auto& weak) { return weak.expired(); }),
+                       attached.end());
+        attached.push_back(metric);
+    }
+
+    Series& series_locked(Kind kind, const std::string& name, const std::string& help, const Labels& labels) {
+        auto it = families_.try_emplace(name, Family{kind, help, {}}).first;
+        if (it->second.kind != kind) {
+            throw std::invalid_argument("MetricsRegistry: " + name + " already registered as another type");
+        }
+        const std::string rendered = render_labels(labels);
+        return it->second.series[rendered];
+    }
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+};
+
+inline std::string MetricsRegistry::scrape() const {
+    // Pointers are collected under the lock and read outside it
+    struct Row {
+        std::string name;
+        Kind kind;
+        std::string help;
+        std::string labels;
+        std::vector<std::shared_ptr<void>> parts;
+    };
+    std::vector<Row> rows;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [name, family] : families_) {
+            for (const auto& [labels, series] : family.series) {
+                Row row{name, family.kind, family.help, labels, {}};
+                if (series.owned) {
+                    row.parts.push_back(series.owned);
+                }
+                for (const auto& weak : series.attached) {
+                    if (auto part = weak.lock()) {
+                        row.parts.push_back(std::move(part));
+                    }
+                }
+                if (!row.parts.empty()) {
+                    rows.push_back(std::move(row));
+                }
+            }
+        }
+    }
+
+    std::string out;
+    char number[64];
+    const std::string* last_family = nullptr;
+    for (const Row& row : rows) {
+        if (!last_family || *last_family != row.name) {
+            const char* type = row.kind == Kind::Counter ? "counter" : row.kind == Kind::Gauge ? "gauge" : "summary";
+            out += "# HELP " + row.name + " " + row.help + "\n";
+            out += "# TYPE " + row.name + " " + type + "\n";
+            last_family = &row.name;
+        }
+        switch (row.kind) {
+        case Kind::Counter: {
+            uint64_t total = 0;
+            for (const auto& part : row.parts) {
+                total += static_cast<const Counter*>(part.get())->value();
+            }
+            std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(total));
+            out += row.name + row.labels + " " + number + "\n";
+            break;
+        }
+        case Kind::Gauge: {
+            int64_t total = 0;
+            for (const auto& part : row.parts) {
+                total += static_cast<const Gauge*>(part.get())->value();
+            }
+            std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(total));
+            out += row.name + row.labels + " " + number + "\n";
+            break;
+        }
+        case Kind::Histogram: {
+            HistogramSnapshot merged;
+            for (const auto& part : row.parts) {
+                merged.merge(static_cast<const Histogram*>(part.get())->snapshot());
+            }
+            for (const auto& [q, label] : {std::pair{0.5, "0.5"}, std::pair{0.99, "0.99"}, std::pair{0.999, "0.999"}}) {
+                std::snprintf(number, sizeof(number), "%.9f", static_cast<double>(merged.quantile(q)) * 1e-9);
+                out += row.name + with_label(row.labels, std::string("quantile=\"") + label + "\"") + " " + number + "\n";
+            }
+            std::snprintf(number, sizeof(number), "%.9f", static_cast<double>(merged.sum) * 1e-9);
+            out += row.name + "_sum" + row.labels + " " + number + "\n";
+            std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(merged.count));
+            out += row.name + "_count" + row.labels + " " + number + "\n";
+            break;
+        }
+        }
+    }
+    return out;
+}
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,347 @@
+#pragma once
+
+#include "utils/Metrics.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+
+namespace quids {
+namespace utils {
+
+// Hardware counters around hot stages.
+//
+// A PerfScope reads the calling thread's cycles, instructions, cache
+// misses and branch misses on entry and exit and adds the difference to
+// its stage, next to a count of scopes, as MetricsRegistry counters:
+// quids_perf_<event>_total{stage="..."}. Dividing any two of them over a
+// window gives IPC or misses per call, which separates a memory regression
+// from a compute one where wall time cannot.
+//
+// On Linux each thread opens one perf_event_open group the first time it
+// enters a scope and reads it with rdpmc from user space where the kernel
+// allows, otherwise with read(). On macOS the fixed counters are read
+// through kperf, which gives cycles and instructions only and needs root.
+// Counting is per thread, so a stage that fans out onto the pool is only
+// charged for the threads its scopes run on.
+//
+// Off by default; a disabled scope costs one relaxed load. Set
+// QUIDS_PERF_COUNTERS=1 or call enable(), which fails without a PMU or
+// permission (perf_event_paranoid above 2 without CAP_PERFMON).
+enum class PerfStage : size_t {
+    EvmExecute,
+    StateRoot,
+    SignatureVerify,
+    GateApply,
+    NetworkDecode,
+    Count
+};
+
+constexpr size_t NUM_PERF_STAGES = static_cast<size_t>(PerfStage::Count);
+
+inline constexpr const char* perfStageName(PerfStage stage) {
+    switch (stage) {
+        case PerfStage::EvmExecute: return "evm_execute";
+        case PerfStage::StateRoot: return "state_root";
+        case PerfStage::SignatureVerify: return "signature_verify";
+        case PerfStage::GateApply: return "gate_apply";
+        case PerfStage::NetworkDecode: return "network_decode";
+        case PerfStage::Count: break;
+    }
+    return "unknown";
+}
+
+struct PerfSample {
+    static constexpr size_t NUM_EVENTS = 4;
+    static constexpr const char* EVENT_NAMES[NUM_EVENTS] = {"cycles", "instructions", "cache_misses",
+                                                            "branch_misses"};
+
+    std::array<uint64_t, NUM_EVENTS> values{};
+
+    uint64_t cycles() const noexcept { return values[0]; }
+    uint64_t instructions() const noexcept { return values[1]; }
+    uint64_t cache_misses() const noexcept { return values[2]; }
+    uint64_t branch_misses() const noexcept { return values[3]; }
+
+    PerfSample operator-(const PerfSample& start) const noexcept {
+        PerfSample delta;
+        for (size_t i = 0; i < NUM_EVENTS; ++i) {
+            // A counter that went backwards was rescheduled mid-scope
+            delta.values[i] = values[i] >= start.values[i] ? values[i] - start.values[i] : 0;
+        }
+        return delta;
+    }
+};
+
+class PerfCounters {
+public:
+    struct StageTotals {
+        uint64_t scopes{0};
+        PerfSample counts;
+
+        double ipc() const noexcept {
+            return counts.cycles() == 0
+                ? 0.0
+                : static_cast<double>(counts.instructions()) / static_cast<double>(counts.cycles());
+        }
+    };
+
+    static PerfCounters& global() {
+        static PerfCounters* counters = new PerfCounters();
+        return *counters;
+    }
+
+    // True once counters could be opened on the calling thread
+    bool enable() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!registered_) {
+            register_series();
+            registered_ = true;
+        }
+        PerfSample probe;
+        if (!thread_group().read(probe)) {
+            return false;
+        }
+        enabled_.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void disable() noexcept { enabled_.store(false, std::memory_order_relaxed); }
+
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    // The calling thread's counters; false where they cannot be opened
+    bool read(PerfSample& out) noexcept { return thread_group().read(out); }
+
+    void record(PerfStage stage, const PerfSample& delta) noexcept {
+        if (!enabled_.load(std::memory_order_acquire)) {
+            return;
+        }
+        auto& series = stages_[static_cast<size_t>(stage)];
+        series.scopes->add();
+        for (size_t i = 0; i < PerfSample::NUM_EVENTS; ++i) {
+            series.events[i]->add(delta.values[i]);
+        }
+    }
+
+    // Since the first enable()
+    [[nodiscard]] StageTotals totals(PerfStage stage) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        StageTotals totals;
+        if (!registered_) {
+            return totals;
+        }
+        const auto& series = stages_[static_cast<size_t>(stage)];
+        totals.scopes = series.scopes->value();
+        for (size_t i = 0; i < PerfSample::NUM_EVENTS; ++i) {
+            totals.counts.values[i] = series.events[i]->value();
+        }
+        return totals;
+    }
+
+private:
+    struct StageSeries {
+        std::shared_ptr<Counter> scopes;
+        std::array<std::shared_ptr<Counter>, PerfSample::NUM_EVENTS> events;
+    };
+
+    // One per thread, opened on first use and closed when the thread exits
+    class ThreadGroup {
+    public:
+        ThreadGroup() { open(); }
+        ~ThreadGroup() { close(); }
+
+        ThreadGroup(const ThreadGroup&) = delete;
+        ThreadGroup& operator=(const ThreadGroup&) = delete;
+
+        bool read(PerfSample& out) noexcept {
+#if defined(__linux__)
+            if (fds_[0] < 0) {
+                return false;
+            }
+            for (size_t i = 0; i < PerfSample::NUM_EVENTS; ++i) {
+                out.values[i] = fds_[i] < 0 ? 0 : read_counter(i);
+            }
+            return true;
+#elif defined(__APPLE__)
+            uint64_t counters[KPC_MAX_COUNTERS] = {};
+            if (!get_thread_counters_ || get_thread_counters_(0, KPC_MAX_COUNTERS, counters) != 0) {
+                return false;
+            }
+            // Fixed counters: cycles, then instructions
+            out.values = {counters[0], counters[1], 0, 0};
+            return true;
+#else
+            (void)out;
+            return false;
+#endif
+        }
+
+    private:
+#if defined(__linux__)
+        void open() noexcept {
+            static constexpr uint64_t CONFIGS[PerfSample::NUM_EVENTS] = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+                PERF_COUNT_HW_BRANCH_MISSES};
+            const long page = sysconf(_SC_PAGESIZE);
+            for (size_t i = 0; i < PerfSample::NUM_EVENTS; ++i) {
+                perf_event_attr attr{};
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = CONFIGS[i];
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                // A group is scheduled onto the PMU as a unit, so the four
+                // counts always cover the same instructions
+                fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, fds_[0], 0));
+                if (fds_[i] < 0) {
+                    if (i == 0) {
+                        return;
+                    }
+                    continue;  // e.g. no cache-miss event on this PMU
+                }
+                void* mapped = mmap(nullptr, static_cast<size_t>(page), PROT_READ, MAP_SHARED, fds_[i], 0);
+                pages_[i] = mapped == MAP_FAILED ? nullptr : static_cast<perf_event_mmap_page*>(mapped);
+            }
+        }
+
+        void close() noexcept {
+            const long page = sysconf(_SC_PAGESIZE);
+            for (size_t i = PerfSample::NUM_EVENTS; i-- > 0;) {
+                if (pages_[i]) {
+                    munmap(pages_[i], static_cast<size_t>(page));
+                }
+                if (fds_[i] >= 0) {
+                    ::close(fds_[i]);
+                }
+            }
+        }
+
+        uint64_t read_counter(size_t i) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+            // Seqlock over the kernel's page: offset plus the live PMC value
+            if (perf_event_mmap_page* pc = pages_[i]; pc && pc->cap_user_rdpmc) {
+                for (;;) {
+                    const uint32_t seq = __atomic_load_n(&pc->lock, __ATOMIC_ACQUIRE);
+                    const uint32_t index = pc->index;
+                    int64_t count = pc->offset;
+                    if (index != 0) {
+                        const unsigned width = pc->pmc_width;
+                        int64_t pmc = static_cast<int64_t>(__builtin_ia32_rdpmc(static_cast<int>(index - 1)));
+                        pmc = static_cast<int64_t>(static_cast<uint64_t>(pmc) << (64 - width)) >> (64 - width);
+                        count += pmc;
+                    }
+                    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                    if (__atomic_load_n(&pc->lock, __ATOMIC_RELAXED) == seq) {
+                        return static_cast<uint64_t>(count);
+                    }
+                }
+            }
+#endif
+            uint64_t value = 0;
+            return ::read(fds_[i], &value, sizeof(value)) == sizeof(value) ? value : 0;
+        }
+
+        std::array<int, PerfSample::NUM_EVENTS> fds_{-1, -1, -1, -1};
+        std::array<perf_event_mmap_page*, PerfSample::NUM_EVENTS> pages_{};
+#elif defined(__APPLE__)
+        static constexpr uint32_t KPC_CLASS_FIXED_MASK = 1;
+        static constexpr uint32_t KPC_MAX_COUNTERS = 32;
+        using SetCounting = int (*)(uint32_t);
+        using GetThreadCounters = int (*)(uint32_t, uint32_t, uint64_t*);
+
+        void open() noexcept {
+            void* kperf = dlopen("/System/Library/PrivateFrameworks/kperf.framework/kperf", RTLD_LAZY);
+            if (!kperf) {
+                return;
+            }
+            auto set_counting = reinterpret_cast<SetCounting>(dlsym(kperf, "kpc_set_counting"));
+            auto set_thread_counting = reinterpret_cast<SetCounting>(dlsym(kperf, "kpc_set_thread_counting"));
+            auto get = reinterpret_cast<GetThreadCounters>(dlsym(kperf, "kpc_get_thread_counters"));
+            if (set_counting && set_thread_counting && get && set_counting(KPC_CLASS_FIXED_MASK) == 0 &&
+                set_thread_counting(KPC_CLASS_FIXED_MASK) == 0) {
+                get_thread_counters_ = get;
+            }
+        }
+
+        void close() noexcept {}
+
+        GetThreadCounters get_thread_counters_{nullptr};
+#else
+        void open() noexcept {}
+        void close() noexcept {}
+#endif
+    };
+
+    PerfCounters() {
+        if (const char* env = std::getenv("QUIDS_PERF_COUNTERS"); env && env[0] == '1') {
+            enable();
+        }
+    }
+
+    static ThreadGroup& thread_group() {
+        thread_local ThreadGroup group;
+        return group;
+    }
+
+    void register_series() {
+        auto& registry = MetricsRegistry::global();
+        for (size_t s = 0; s < NUM_PERF_STAGES; ++s) {
+            const MetricsRegistry::Labels labels{{"stage", perfStageName(static_cast<PerfStage>(s))}};
+            stages_[s].scopes = registry.counter("quids_perf_scopes_total", "Instrumented stage runs", labels);
+            for (size_t i = 0; i < PerfSample::NUM_EVENTS; ++i) {
+                stages_[s].events[i] = registry.counter(
+                    std::string("quids_perf_") + PerfSample::EVENT_NAMES[i] + "_total",
+                    std::string("Hardware ") + PerfSample::EVENT_NAMES[i] + " in instrumented stages, user space",
+                    labels);
+            }
+        }
+    }
+
+    mutable std::mutex mutex_;
+    bool registered_{false};
+    std::atomic<bool> enabled_{false};
+    std::array<StageSeries, NUM_PERF_STAGES> stages_;
+};
+
+// Counts [construction, destruction) on the calling thread towards a stage
+class PerfScope {
+public:
+    explicit PerfScope(PerfStage stage) noexcept : stage_(stage) {
+        auto& counters = PerfCounters::global();
+        active_ = counters.enabled() && counters.read(start_);
+    }
+
+    ~PerfScope() {
+        if (active_) {
+            auto& counters = PerfCounters::global();
+            PerfSample end;
+            if (counters.read(end)) {
+                counters.record(stage_, end - start_);
+            }
+        }
+    }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfStage stage_;
+    bool active_{false};
+    PerfSample start_;
+};
+
+} // namespace utils
+} // namespace quids
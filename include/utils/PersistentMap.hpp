@@ -0,0 +1,229 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// Hash array mapped trie with structural sharing.
+//
+// Copying a map is O(1): both copies point at the same nodes. A mutation
+// copies only the nodes on its own path that are still shared, so a copy
+// taken before a batch of writes keeps seeing the old values while the
+// untouched parts of the tree stay shared between the two.
+//
+// Not synchronized: concurrent readers are fine, writers to one instance
+// must be serialized by the caller. Different instances sharing nodes may
+// be used from different threads freely.
+template <typename K, typename V, typename Hasher = std::hash<K>>
+class PersistentMap {
+public:
+    PersistentMap() = default;
+
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    const V* find(const K& key) const {
+        const size_t h = Hasher{}(key);
+        const Node* node = root_.get();
+        for (size_t shift = 0; node; shift += BITS) {
+            if (node->is_leaf()) {
+                if (node->hash != h) return nullptr;
+                for (const auto& entry : node->entries) {
+                    if (entry.first == key) return &entry.second;
+                }
+                return nullptr;
+            }
+            const uint16_t bit = bit_for(h, shift);
+            if (!(node->bitmap & bit)) return nullptr;
+            node = node->children[slot_of(node->bitmap, bit)].get();
+        }
+        return nullptr;
+    }
+
+    bool contains(const K& key) const { return find(key) != nullptr; }
+
+    // Unshares the path to `key`; the pointer stays valid until the next
+    // insertion or erase on this instance
+    V* find_mutable(const K& key) {
+        if (!find(key)) return nullptr;
+        const size_t h = Hasher{}(key);
+        NodePtr* slot = &root_;
+        for (size_t shift = 0;; shift += BITS) {
+            make_unique(*slot);
+            Node& node = **slot;
+            if (node.is_leaf()) {
+                for (auto& entry : node.entries) {
+                    if (entry.first == key) return &entry.second;
+                }
+                return nullptr;
+            }
+            const uint16_t bit = bit_for(h, shift);
+            slot = &node.children[slot_of(node.bitmap, bit)];
+        }
+    }
+
+    void set(const K& key, V value) {
+        assign(root_, 0, Hasher{}(key), key, std::move(value));
+    }
+
+    bool erase(const K& key) {
+        if (!find(key)) return false;
+        remove(root_, 0, Hasher{}(key), key);
+        size_--;
+        return true;
+    }
+
+    void clear() {
+        root_.reset();
+        size_ = 0;
+    }
+
+    // Unordered traversal
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        if (root_) visit(*root_, fn);
+    }
+
+private:
+    static constexpr size_t BITS = 4;
+
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+
+    struct Node {
+        // Branch
+        uint16_t bitmap{0};
+        std::vector<NodePtr> children;
+
+        // Leaf; more than one entry only on a full hash collision
+        size_t hash{0};
+        std::vector<std::pair<K, V>> entries;
+
+        bool is_leaf() const { return !entries.empty(); }
+    };
+
+    static uint16_t bit_for(size_t h, size_t shift) {
+        return static_cast<uint16_t>(1u << ((h >> shift) & 0x0F));
+    }
+
+    static size_t slot_of(uint16_t bitmap, uint16_t bit) {
+        return static_cast<size_t>(std::popcount(static_cast<uint16_t>(bitmap & (bit - 1))));
+    }
+
+    static NodePtr make_leaf(size_t h, const K& key, V&& value) {
+        auto leaf = std::make_shared<Node>();
+        leaf->hash = h;
+        leaf->entries.emplace_back(key, std::move(value));
+        return leaf;
+    }
+
+    // A node is only written in place when no other map can reach it
+    static void make_unique(NodePtr& node) {
+        if (node.use_count() != 1) {
+            node = std::make_shared<Node>(*node);
+        }
+    }
+
+    void assign(NodePtr& slot, size_t shift, size_t h, const K& key, V&& value) {
+        if (!slot) {
+            slot = make_leaf(h, key, std::move(value));
+            size_++;
+            return;
+        }
+
+        if (slot->is_leaf()) {
+            if (slot->hash == h) {
+                make_unique(slot);
+                for (auto& entry : slot->entries) {
+                    if (entry.first == key) {
+                        entry.second = std::move(value);
+                        return;
+                    }
+                }
+                slot->entries.emplace_back(key, std::move(value));
+                size_++;
+                return;
+            }
+            // Push the existing leaf one level down; the leaf itself is
+            // not modified and may stay shared
+            auto branch = std::make_shared<Node>();
+            branch->bitmap = bit_for(slot->hash, shift);
+            branch->children.push_back(std::move(slot));
+            slot = std::move(branch);
+        } else {
+            make_unique(slot);
+        }
+
+        Node& node = *slot;
+        const uint16_t bit = bit_for(h, shift);
+        const size_t pos = slot_of(node.bitmap, bit);
+        if (!(node.bitmap & bit)) {
+            node.bitmap |= bit;
+            node.children.insert(node.children.begin() + static_cast<std::ptrdiff_t>(pos),
+                                 make_leaf(h, key, std::move(value)));
+            size_++;
+            return;
+        }
+        assign(node.children[pos], shift + BITS, h, key, std::move(value));
+    }
+
+    // Caller has checked that `key` is present
+    static void remove(NodePtr& slot, size_t shift, size_t h, const K& key) {
+        if (slot->is_leaf()) {
+            if (slot->entries.size() == 1) {
+                slot.reset();
+                return;
+            }
+            make_unique(slot);
+            auto& entries = slot->entries;
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                if (it->first == key) {
+                    entries.erase(it);
+                    return;
+                }
+            }
+            return;
+        }
+
+        make_unique(slot);
+        Node& node = *slot;
+        const uint16_t bit = bit_for(h, shift);
+        const size_t pos = slot_of(node.bitmap, bit);
+        remove(node.children[pos], shift + BITS, h, key);
+
+        if (!node.children[pos]) {
+            node.children.erase(node.children.begin() + static_cast<std::ptrdiff_t>(pos));
+            node.bitmap &= static_cast<uint16_t>(~bit);
+        }
+
+        // Keep the shape canonical: no empty branches, no branch over a lone leaf
+        if (node.children.empty()) {
+            slot.reset();
+        } else if (node.children.size() == 1 && node.children.front()->is_leaf()) {
+            NodePtr leaf = std::move(node.children.front());
+            slot = std::move(leaf);
+        }
+    }
+
+    template <typename Fn>
+    static void visit(const Node& node, Fn& fn) {
+        if (node.is_leaf()) {
+            for (const auto& entry : node.entries) fn(entry.first, entry.second);
+            return;
+        }
+        for (const auto& child : node.children) visit(*child, fn);
+    }
+
+    NodePtr root_;
+    size_t size_{0};
+};
+
+} // namespace utils
+} // namespace quids
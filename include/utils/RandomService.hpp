@@ -0,0 +1,219 @@
+#pragma once
+
+#include "utils/Int128.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// Bits packed 64 to a word, lowest bit first
+struct PackedBits {
+    std::vector<uint64_t> words;
+    size_t size{0};
+
+    bool operator[](size_t i) const noexcept { return (words[i >> 6] >> (i & 63)) & 1; }
+};
+
+// Philox4x32-10 counter-based generator (Salmon et al., SC'11).
+//
+// Output block n is a pure function of (key, stream, n), so generators need
+// no shared state, can jump anywhere, and give the same sequence on every
+// platform. Not a CSPRNG: use it for simulation and selection, not keys.
+// Satisfies UniformRandomBitGenerator, but prefer below() and shuffle() to
+// the std distributions, whose algorithms differ between standard libraries.
+class Philox {
+public:
+    using result_type = uint64_t;
+
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return ~result_type{0}; }
+
+    explicit Philox(uint64_t key = 0, uint64_t stream = 0) noexcept : key_(key), stream_(stream) {}
+
+    result_type operator()() noexcept {
+        if (index_ == buffer_.size()) {
+            buffer_ = block(counter_++);
+            index_ = 0;
+        }
+        return buffer_[index_++];
+    }
+
+    // Uniform in [0, 1), 53 bits
+    double uniform() noexcept { return static_cast<double>((*this)() >> 11) * 0x1.0p-53; }
+
+    // Uniform in [0, bound), bound > 0 (Lemire's multiply-shift rejection)
+    uint64_t below(uint64_t bound) noexcept {
+        u128 m = static_cast<u128>((*this)()) * bound;
+        auto low = static_cast<uint64_t>(m);
+        if (low < bound) {
+            const uint64_t threshold = (0 - bound) % bound;
+            while (low < threshold) {
+                m = static_cast<u128>((*this)()) * bound;
+                low = static_cast<uint64_t>(m);
+            }
+        }
+        return static_cast<uint64_t>(m >> 64);
+    }
+
+    // Fisher-Yates, identical on every standard library
+    template<typename It>
+    void shuffle(It first, It last) noexcept {
+        const auto n = static_cast<uint64_t>(last - first);
+        for (uint64_t i = n; i > 1; --i) {
+            std::swap(first[i - 1], first[below(i)]);
+        }
+    }
+
+    // Bulk output, two words per block with no per-call buffering
+    void fill(uint64_t* out, size_t count) noexcept {
+        size_t i = 0;
+        while (i < count && index_ < buffer_.size()) {
+            out[i++] = buffer_[index_++];
+        }
+        for (; i + 2 <= count; i += 2) {
+            const auto b = block(counter_++);
+            out[i] = b[0];
+            out[i + 1] = b[1];
+        }
+        if (i < count) {
+            out[i] = (*this)();
+        }
+    }
+
+    PackedBits bits(size_t count) {
+        PackedBits result;
+        result.size = count;
+        result.words.resize((count + 63) / 64);
+        fill(result.words.data(), result.words.size());
+        if (count % 64 != 0) {
+            result.words.back() &= (uint64_t{1} << (count % 64)) - 1;
+        }
+        return result;
+    }
+
+    // Jumps to output block n
+    void seek(uint64_t block_index) noexcept {
+        counter_ = block_index;
+        index_ = buffer_.size();
+    }
+
+private:
+    static constexpr uint32_t M0 = 0xD2511F53;
+    static constexpr uint32_t M1 = 0xCD9E8D57;
+    static constexpr uint32_t W0 = 0x9E3779B9;
+    static constexpr uint32_t W1 = 0xBB67AE85;
+
+    std::array<uint64_t, 2> block(uint64_t n) const noexcept {
+        uint32_t c[4] = {static_cast<uint32_t>(n), static_cast<uint32_t>(n >> 32),
+                         static_cast<uint32_t>(stream_), static_cast<uint32_t>(stream_ >> 32)};
+        uint32_t k0 = static_cast<uint32_t>(key_);
+        uint32_t k1 = static_cast<uint32_t>(key_ >> 32);
+        for (int round = 0; round < 10; ++round) {
+            const uint64_t p0 = static_cast<uint64_t>(M0) * c[0];
+            const uint64_t p1 = static_cast<uint64_t>(M1) * c[2];
+            const uint32_t next[4] = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k0, static_cast<uint32_t>(p1),
+                                      static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k1, static_cast<uint32_t>(p0)};
+            c[0] = next[0];
+            c[1] = next[1];
+            c[2] = next[2];
+            c[3] = next[3];
+            k0 += W0;
+            k1 += W1;
+        }
+        return {(static_cast<uint64_t>(c[1]) << 32) | c[0], (static_cast<uint64_t>(c[3]) << 32) | c[2]};
+    }
+
+    uint64_t key_;
+    uint64_t stream_;
+    uint64_t counter_{0};
+    std::array<uint64_t, 2> buffer_{};
+    size_t index_{2};
+};
+
+// Process-wide randomness for simulation, proofs and witness selection.
+//
+// Everything derives from one 64-bit seed, random at startup and replaced
+// from consensus randomness with reseed(). local() hands each thread its
+// own generator, so draws never contend; threads take stream numbers in
+// the order they first draw after a reseed, which makes a single-threaded
+// replay reproduce a run exactly. stream() gives a generator that depends
+// only on the seed and its arguments, for results every node must agree on.
+class RandomService {
+public:
+    RandomService() : seed_(std::random_device{}() ^ (uint64_t{std::random_device{}()} << 32)) {}
+
+    static RandomService& global() {
+        static RandomService service;
+        return service;
+    }
+
+    void reseed(uint64_t seed) noexcept {
+        seed_.store(seed, std::memory_order_relaxed);
+        next_thread_.store(0, std::memory_order_relaxed);
+        epoch_.fetch_add(1, std::memory_order_release);
+    }
+
+    // e.g. a block hash or beacon output
+    void reseed(std::span<const uint8_t> randomness) noexcept { reseed(hashBytes(randomness)); }
+
+    uint64_t seed() const noexcept { return seed_.load(std::memory_order_relaxed); }
+
+    // The calling thread's generator; invalidated by reseed()
+    Philox& local() noexcept {
+        thread_local struct {
+            const RandomService* owner{nullptr};
+            uint64_t epoch{0};
+            Philox generator;
+        } state;
+
+        const uint64_t epoch = epoch_.load(std::memory_order_acquire);
+        if (state.owner != this || state.epoch != epoch) {
+            const uint64_t thread = next_thread_.fetch_add(1, std::memory_order_relaxed);
+            state.owner = this;
+            state.epoch = epoch;
+            state.generator = Philox(mix(seed() ^ THREAD_DOMAIN), thread);
+        }
+        return state.generator;
+    }
+
+    // Generator for (domain, index) under the current seed
+    Philox stream(std::string_view domain, uint64_t index) const noexcept {
+        const std::span<const uint8_t> bytes(reinterpret_cast<const uint8_t*>(domain.data()), domain.size());
+        return Philox(mix(seed() ^ hashBytes(bytes)), index);
+    }
+
+private:
+    static constexpr uint64_t THREAD_DOMAIN = 0x7468726561647321ULL;
+
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t x) noexcept {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t hashBytes(std::span<const uint8_t> bytes) noexcept {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (uint8_t b : bytes) {
+            h = mix(h ^ b);
+        }
+        return h;
+    }
+
+    std::atomic<uint64_t> seed_;
+    std::atomic<uint64_t> epoch_{1};
+    std::atomic<uint64_t> next_thread_{0};
+};
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "utils/BoundedQueue.hpp"
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// The queues between a set of shard event loops and everyone else.
+//
+// Each shard has an MPMC inbox for threads that are not one of its loops,
+// and one SPSC queue per other shard, written only by that shard's loop,
+// so loops forwarding to each other never contend with application
+// threads or with one another. A send to the caller's own shard skips the
+// queues and runs in place.
+//
+// A loop thread declares itself with a LoopScope for as long as it runs;
+// sends are routed by which shard, if any, the calling thread is the loop
+// of. Only a shard's own loop may drain() it.
+template<typename T>
+class ShardMailbox {
+public:
+    ShardMailbox(size_t shards, size_t inbox_capacity, size_t cross_capacity) {
+        if (shards == 0) {
+            throw std::invalid_argument("ShardMailbox needs at least one shard");
+        }
+        shards_.reserve(shards);
+        for (size_t i = 0; i < shards; ++i) {
+            auto shard = std::make_unique<Shard>(inbox_capacity);
+            shard->from_shard.reserve(shards);
+            for (size_t from = 0; from < shards; ++from) {
+                // A shard never queues to itself
+                shard->from_shard.push_back(from == i ? nullptr : std::make_unique<CrossQueue>(cross_capacity));
+            }
+            shards_.push_back(std::move(shard));
+        }
+    }
+
+    ShardMailbox(const ShardMailbox&) = delete;
+    ShardMailbox& operator=(const ShardMailbox&) = delete;
+
+    // Marks the constructing thread as shard `shard`'s loop until destroyed
+    class LoopScope {
+    public:
+        LoopScope(const ShardMailbox& mailbox, size_t shard)
+            : previous_owner_(current_owner_), previous_shard_(current_shard_) {
+            current_owner_ = &mailbox;
+            current_shard_ = shard;
+        }
+        ~LoopScope() {
+            current_owner_ = previous_owner_;
+            current_shard_ = previous_shard_;
+        }
+
+        LoopScope(const LoopScope&) = delete;
+        LoopScope& operator=(const LoopScope&) = delete;
+
+    private:
+        const ShardMailbox* previous_owner_;
+        size_t previous_shard_;
+    };
+
+    [[nodiscard]] size_t shards() const noexcept { return shards_.size(); }
+
+    // The shard the calling thread is the loop of, if any
+    [[nodiscard]] std::optional<size_t> current_shard() const noexcept {
+        if (current_owner_ != this) {
+            return std::nullopt;
+        }
+        return current_shard_;
+    }
+
+    // Hands item to shard `target`: in place through `local` on that
+    // shard's own loop, otherwise queued for it. Throws std::runtime_error
+    // if the queue is full, leaving item with the caller.
+    template<typename Local>
+    void send(size_t target, T&& item, Local&& local) {
+        Shard& shard = *shards_.at(target);
+        if (const auto from = current_shard()) {
+            if (*from == target) {
+                std::forward<Local>(local)(std::move(item));
+                return;
+            }
+            if (!shard.from_shard[*from]->try_push(std::move(item))) {
+                throw std::runtime_error("Cross-shard queue full");
+            }
+            return;
+        }
+        if (!shard.inbox.try_push(std::move(item))) {
+            throw std::runtime_error("Shard queue full");
+        }
+    }
+
+    // Passes up to `batch` items from the inbox and from each other shard
+    // to fn, so no one queue can starve the rest; returns how many it
+    // passed. Per sender, items arrive in the order they were sent.
+    template<typename Fn>
+    size_t drain(size_t shard, Fn&& fn, size_t batch) {
+        Shard& owned = *shards_.at(shard);
+        size_t moved = drain_queue(owned.inbox, fn, batch);
+        for (auto& queue : owned.from_shard) {
+            if (queue) {
+                moved += drain_queue(*queue, fn, batch);
+            }
+        }
+        return moved;
+    }
+
+private:
+    using Inbox = BoundedQueue<T>;
+    using CrossQueue = BoundedQueue<T, QueueMode::SPSC>;
+
+    struct Shard {
+        explicit Shard(size_t inbox_capacity) : inbox(inbox_capacity) {}
+
+        Inbox inbox;
+        // from_shard[i] is written only by shard i's loop
+        std::vector<std::unique_ptr<CrossQueue>> from_shard;
+    };
+
+    template<typename Queue, typename Fn>
+    static size_t drain_queue(Queue& queue, Fn& fn, size_t batch) {
+        size_t moved = 0;
+        for (; moved < batch; ++moved) {
+            auto item = queue.try_pop();
+            if (!item) {
+                break;
+            }
+            fn(std::move(*item));
+        }
+        return moved;
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    static inline thread_local const ShardMailbox* current_owner_ = nullptr;
+    static inline thread_local size_t current_shard_ = 0;
+};
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,285 @@
+#pragma once
+
+#include "utils/WorkStealingPool.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace quids {
+namespace utils {
+
+// Coroutine task on top of WorkStealingPool.
+//
+// A Task<T> is lazy: nothing runs until it is awaited, and the awaiting
+// coroutine is resumed by symmetric transfer when it finishes, so a chain
+// of awaits costs no threads. Where a coroutine runs is explicit: it
+// continues on whatever thread resumed it, and co_await resume_on(pool,
+// priority) moves it onto the pool at a priority.
+//
+// Waits become suspensions through adapters instead of a blocked thread:
+// offload() for blocking calls such as RocksDB reads, from_callback() for
+// anything with a completion handler (ProvingService jobs, ExternalLink
+// fetches, Asio async operations). Threads outside the pool enter with
+// sync_wait() or fire and forget with spawn().
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> done) noexcept {
+            auto next = done.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template<typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T take() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template<>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() const noexcept {}
+
+    void take() const {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+// Starts eagerly and frees itself at the end; only for the entry points
+// below, which own everything the body touches
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+template<typename T>
+class [[nodiscard]] Task {
+public:
+    using promise_type = detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    // Awaiting starts the body; the result or exception comes back here
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume() { return handle_.promise().take(); }
+
+private:
+    friend promise_type;
+    explicit Task(Handle handle) noexcept : handle_(handle) {}
+
+    Handle handle_;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+template<typename T>
+struct SyncState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done{false};
+    std::exception_ptr error;
+    std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>> value;
+};
+
+template<typename T>
+Detached run_sync(Task<T> task, SyncState<T>& state) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            state.value.emplace(co_await task);
+        }
+    } catch (...) {
+        state.error = std::current_exception();
+    }
+    // Notified under the lock: the waiter owns `state` and may return the
+    // moment it sees done
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.done = true;
+    state.cv.notify_one();
+}
+
+} // namespace detail
+
+// Suspends and resumes as a task on `pool`
+class ResumeOn {
+public:
+    ResumeOn(WorkStealingPool& pool, TaskPriority priority) noexcept : pool_(pool), priority_(priority) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const {
+        pool_.post(priority_, [handle] { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+private:
+    WorkStealingPool& pool_;
+    TaskPriority priority_;
+};
+
+inline ResumeOn resume_on(WorkStealingPool& pool, TaskPriority priority) {
+    return ResumeOn(pool, priority);
+}
+
+// Runs fn() as a pool task and continues there with its result. Meant for
+// short blocking calls; long waits belong behind from_callback()
+template<typename F>
+auto offload(TaskPriority priority, F fn) -> Task<std::invoke_result_t<F&>> {
+    co_await resume_on(WorkStealingPool::global(), priority);
+    if constexpr (std::is_void_v<std::invoke_result_t<F&>>) {
+        fn();
+    } else {
+        co_return fn();
+    }
+}
+
+// Awaits a completion handler. `initiate` is called with a handler taking
+// a T, which must be called exactly once, from any thread and possibly
+// before initiate returns; the coroutine resumes on that thread.
+template<typename T, typename Initiate>
+class CallbackAwaitable {
+public:
+    explicit CallbackAwaitable(Initiate initiate) : initiate_(std::move(initiate)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        initiate_([this](auto&& result) {
+            value_.emplace(std::forward<decltype(result)>(result));
+            // Whoever comes second resumes: the handler if the awaiter
+            // already suspended, otherwise await_suspend by not suspending
+            if (state_.exchange(COMPLETED, std::memory_order_acq_rel) == SUSPENDED) {
+                handle_.resume();
+            }
+        });
+        return state_.exchange(SUSPENDED, std::memory_order_acq_rel) != COMPLETED;
+    }
+
+    T await_resume() { return std::move(*value_); }
+
+private:
+    static constexpr int PENDING = 0;
+    static constexpr int SUSPENDED = 1;
+    static constexpr int COMPLETED = 2;
+
+    Initiate initiate_;
+    std::coroutine_handle<> handle_;
+    std::optional<T> value_;
+    std::atomic<int> state_{PENDING};
+};
+
+template<typename T, typename Initiate>
+CallbackAwaitable<T, Initiate> from_callback(Initiate initiate) {
+    return CallbackAwaitable<T, Initiate>(std::move(initiate));
+}
+
+// Blocks the calling thread until the task is done; not from a pool task,
+// where it would hold a worker the task may need
+template<typename T>
+T sync_wait(Task<T> task) {
+    detail::SyncState<T> state;
+    detail::run_sync(std::move(task), state);
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.cv.wait(lock, [&] { return state.done; });
+    if (state.error) {
+        std::rethrow_exception(state.error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*state.value);
+    }
+}
+
+namespace detail {
+
+inline Detached run_spawned(Task<void> task, WorkStealingPool& pool, TaskPriority priority) {
+    co_await resume_on(pool, priority);
+    co_await task;
+}
+
+} // namespace detail
+
+// Starts the task on the pool and lets it run to completion on its own.
+// An exception escaping it terminates, as it would on a std::thread.
+inline void spawn(Task<void> task, TaskPriority priority = TaskPriority::Execution,
+                  WorkStealingPool& pool = WorkStealingPool::global()) {
+    detail::run_spawned(std::move(task), pool, priority);
+}
+
+} // namespace utils
+} // namespace quids
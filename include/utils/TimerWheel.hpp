@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// Hierarchical timing wheel (Varghese and Lauck) for large numbers of
+// short-lived timers: idle timeouts, request deadlines, keepalives.
+//
+// Time is counted in ticks. Level 0 has one slot per tick for the next
+// 256 ticks, level 1 one slot per 256 ticks, and so on over four levels,
+// 2^32 ticks in all; later deadlines wait in the top level and are placed
+// again when it comes round. A timer sits in one slot's intrusive list,
+// so schedule and cancel are O(1), and each tick runs one level-0 slot,
+// plus a cascade of one higher slot into the levels below every 256
+// ticks. Timers fire at or after their deadline, never early, and never
+// more than a tick late relative to advance() calls.
+//
+// Not thread-safe: one wheel belongs to one event loop, which calls
+// advance() as it goes. Callbacks may schedule and cancel timers.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t SLOT_BITS = 8;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+
+    // Safe to keep after the timer fires or is cancelled; cancel() then
+    // returns false
+    struct TimerId {
+        uint32_t index{NONE};
+        uint32_t generation{0};
+        [[nodiscard]] bool valid() const { return index != NONE; }
+    };
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(1),
+                        Clock::time_point start = Clock::now())
+        : tick_(tick), start_(start) {
+        for (auto& level : slots_) level.fill(NONE);
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Rounded up to whole ticks, and at least one
+    TimerId schedule(std::chrono::nanoseconds delay, Callback callback) {
+        const auto ticks = (std::max(delay, std::chrono::nanoseconds(1)) + tick_ - std::chrono::nanoseconds(1)) / tick_;
+        const uint64_t expiry = now_ + static_cast<uint64_t>(ticks);
+
+        uint32_t index;
+        if (free_ != NONE) {
+            index = free_;
+            free_ = nodes_[index].next;
+        } else {
+            index = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node& node = nodes_[index];
+        node.callback = std::move(callback);
+        node.expiry = expiry;
+        node.active = true;
+        place(index);
+        ++size_;
+        return {index, node.generation};
+    }
+
+    bool cancel(TimerId id) {
+        if (!live(id)) {
+            return false;
+        }
+        unlink(id.index);
+        release(id.index);
+        return true;
+    }
+
+    // cancel() and schedule() with the same callback; the old id stops
+    // being valid. An invalid id is a no-op returning an invalid id.
+    TimerId reschedule(TimerId id, std::chrono::nanoseconds delay) {
+        if (!live(id)) {
+            return {};
+        }
+        Callback callback = std::move(nodes_[id.index].callback);
+        cancel(id);
+        return schedule(delay, std::move(callback));
+    }
+
+    // Runs everything due by now; returns how many fired
+    size_t advance(Clock::time_point now = Clock::now()) {
+        if (now <= start_) {
+            return 0;
+        }
+        const auto target = static_cast<uint64_t>((now - start_) / tick_);
+        size_t fired = 0;
+        while (now_ < target) {
+            if (size_ == 0) {
+                now_ = target;
+                break;
+            }
+            // Nothing can come due below the lowest occupied level before
+            // its next slot boundary, so skip straight there
+            size_t lowest = 0;
+            while (level_sizes_[lowest] == 0) {
+                ++lowest;
+            }
+            if (lowest > 0) {
+                now_ = std::min(target, now_ | ((uint64_t{1} << (lowest * SLOT_BITS)) - 1));
+                if (now_ == target) {
+                    break;
+                }
+            }
+            ++now_;
+            // Every 256 ticks the next slot of the level above comes due.
+            // Highest first, so timers it drops into a lower level's
+            // current slot are cascaded again on this same tick.
+            size_t top = 0;
+            while (top + 1 < LEVELS && slot_of(now_, top) == 0) {
+                ++top;
+            }
+            for (size_t level = top; level >= 1; --level) {
+                cascade(level, slot_of(now_, level));
+            }
+            fired += run(slot_of(now_, 0));
+        }
+        return fired;
+    }
+
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    [[nodiscard]] std::chrono::nanoseconds tick() const { return tick_; }
+
+private:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    struct Node {
+        Callback callback;
+        uint64_t expiry{0};
+        uint32_t prev{NONE};
+        uint32_t next{NONE};
+        uint32_t generation{0};
+        uint8_t level{0};
+        uint8_t slot{0};
+        bool active{false};
+    };
+
+    static size_t slot_of(uint64_t tick, size_t level) {
+        return static_cast<size_t>(tick >> (level * SLOT_BITS)) & (SLOTS - 1);
+    }
+
+    bool live(TimerId id) const {
+        return id.index < nodes_.size() && nodes_[id.index].active &&
+               nodes_[id.index].generation == id.generation;
+    }
+
+    // The level is set by the highest bit where expiry and now differ. A
+    // cascade can place a timer due this very tick, in the slot about to run.
+    void place(uint32_t index) {
+        Node& node = nodes_[index];
+        const uint64_t expiry = std::max(node.expiry, now_);
+        const uint64_t differing = expiry ^ now_;
+        size_t level = differing == 0 ? 0 : (static_cast<size_t>(std::bit_width(differing)) - 1) / SLOT_BITS;
+        size_t slot;
+        if (level >= LEVELS) {
+            // Past this lap of the top level. Within the next lap, its own
+            // slot if that comes round before the current one does;
+            // otherwise the slot that comes due last, to be placed again.
+            level = LEVELS - 1;
+            constexpr size_t SPAN = LEVELS * SLOT_BITS;
+            const size_t current = slot_of(now_, level);
+            if ((expiry >> SPAN) == (now_ >> SPAN) + 1 && slot_of(expiry, level) < current) {
+                slot = slot_of(expiry, level);
+            } else {
+                slot = (current + SLOTS - 1) & (SLOTS - 1);
+            }
+        } else {
+            slot = slot_of(expiry, level);
+        }
+        node.level = static_cast<uint8_t>(level);
+        node.slot = static_cast<uint8_t>(slot);
+        node.prev = NONE;
+        node.next = slots_[level][slot];
+        if (node.next != NONE) {
+            nodes_[node.next].prev = index;
+        }
+        slots_[level][slot] = index;
+        ++level_sizes_[level];
+    }
+
+    void unlink(uint32_t index) {
+        Node& node = nodes_[index];
+        if (node.prev != NONE) {
+            nodes_[node.prev].next = node.next;
+        } else {
+            slots_[node.level][node.slot] = node.next;
+        }
+        if (node.next != NONE) {
+            nodes_[node.next].prev = node.prev;
+        }
+        --level_sizes_[node.level];
+    }
+
+    void release(uint32_t index) {
+        Node& node = nodes_[index];
+        node.callback = nullptr;
+        node.active = false;
+        ++node.generation;
+        node.next = free_;
+        free_ = index;
+        --size_;
+    }
+
+    void cascade(size_t level, size_t slot) {
+        uint32_t index = slots_[level][slot];
+        slots_[level][slot] = NONE;
+        while (index != NONE) {
+            const uint32_t next = nodes_[index].next;
+            --level_sizes_[level];
+            place(index);
+            index = next;
+        }
+    }
+
+    size_t run(size_t slot) {
+        size_t fired = 0;
+        // Callbacks may add to this slot only for a later lap, never now_,
+        // so the list drains
+        while (slots_[0][slot] != NONE) {
+            const uint32_t index = slots_[0][slot];
+            unlink(index);
+            Callback callback = std::move(nodes_[index].callback);
+            release(index);
+            ++fired;
+            if (callback) {
+                callback();
+            }
+        }
+        return fired;
+    }
+
+    const std::chrono::nanoseconds tick_;
+    const Clock::time_point start_;
+    uint64_t now_{0};
+    size_t size_{0};
+    std::vector<Node> nodes_;
+    uint32_t free_{NONE};
+    std::array<std::array<uint32_t, SLOTS>, LEVELS> slots_;
+    std::array<size_t, LEVELS> level_sizes_{};
+};
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace quids {
+namespace utils {
+
+// Lifecycle tracing. Each thread appends finished spans to its own ring
+// buffer with relaxed stores, so a span costs two clock reads when its
+// trace is sampled and one comparison when it is not; export reads the
+// rings without stopping the writers.
+//
+// Trace ids are derived, not propagated: a transaction's id comes from
+// its sender and nonce, so every stage can recompute it from what it
+// already holds. Batches, blocks and L1 frames get aggregate ids (top bit
+// set) that are always recorded; a transaction's span in a stage that
+// works on aggregates links to the aggregate's id, and exporting the
+// transaction follows those links.
+using TraceId = uint64_t;
+
+constexpr TraceId AGGREGATE_TRACE = uint64_t{1} << 63;
+
+namespace tracing_detail {
+
+constexpr uint64_t fnv1a(std::string_view text) noexcept {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : text) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+constexpr uint64_t mix(uint64_t x) noexcept {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+inline uint64_t now_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace tracing_detail
+
+constexpr TraceId transaction_trace_id(std::string_view sender, uint64_t nonce) noexcept {
+    const TraceId id = tracing_detail::mix(tracing_detail::fnv1a(sender) ^ nonce) & ~AGGREGATE_TRACE;
+    return id == 0 ? 1 : id;
+}
+
+// kind keeps e.g. block 7 and L1 frame 7 apart
+constexpr TraceId aggregate_trace_id(std::string_view kind, uint64_t key) noexcept {
+    return tracing_detail::mix(tracing_detail::fnv1a(kind) ^ key) | AGGREGATE_TRACE;
+}
+
+struct SpanRecord {
+    TraceId trace{0};
+    TraceId link{0};        // aggregate this span hands the trace over to
+    const char* name{""};   // a string literal
+    uint64_t start_ns{0};   // steady clock
+    uint64_t duration_ns{0};
+    uint32_t thread{0};
+};
+
+class Tracer {
+public:
+    static constexpr size_t RING_CAPACITY = 2048;  // spans kept per thread
+
+    // Never destroyed, so threads exiting during shutdown can still
+    // release their rings
+    static Tracer& global() {
+        static Tracer* tracer = new Tracer();
+        return *tracer;
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Fraction of transaction traces recorded, 0 turns tracing off
+    void set_sample_rate(double rate) noexcept {
+        rate = std::clamp(rate, 0.0, 1.0);
+        threshold_.store(static_cast<uint64_t>(rate * static_cast<double>(AGGREGATE_TRACE)),
+                         std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] double sample_rate() const noexcept {
+        return static_cast<double>(threshold_.load(std::memory_order_relaxed)) /
+               static_cast<double>(AGGREGATE_TRACE);
+    }
+
+    // Decided by the id alone, so every stage makes the same choice
+    [[nodiscard]] bool sampled(TraceId trace) const noexcept {
+        const uint64_t threshold = threshold_.load(std::memory_order_relaxed);
+        if (trace & AGGREGATE_TRACE) {
+            return threshold != 0;
+        }
+        return trace < threshold;
+    }
+
+    void record(SpanRecord span) noexcept {
+        Ring& ring = local_ring();
+        span.thread = ring.thread;
+        const uint64_t index = ring.head.load(std::memory_order_relaxed);
+        Slot& slot = ring.slots[index % RING_CAPACITY];
+        // Seqlock: odd while the slot is being rewritten
+        slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.trace.store(span.trace, std::memory_order_relaxed);
+        slot.link.store(span.link, std::memory_order_relaxed);
+        slot.name.store(span.name, std::memory_order_relaxed);
+        slot.start_ns.store(span.start_ns, std::memory_order_relaxed);
+        slot.duration_ns.store(span.duration_ns, std::memory_order_relaxed);
+        slot.seq.store(2 * index + 2, std::memory_order_release);
+        ring.head.store(index + 1, std::memory_order_release);
+    }
+
+    // Zero-length span under `from` that hands over to `to`
+    void link(const char* name, TraceId from, TraceId to) noexcept {
+        if (sampled(from)) {
+            record({from, to, name, tracing_detail::now_ns(), 0, 0});
+        }
+    }
+
+    // Every span still held by the rings
+    [[nodiscard]] std::vector<SpanRecord> collect() const {
+        std::vector<SpanRecord> spans;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& ring : rings_) {
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            const uint64_t floor = ring->floor.load(std::memory_order_relaxed);
+            const uint64_t begin = std::max(floor, head > RING_CAPACITY ? head - RING_CAPACITY : 0);
+            for (uint64_t index = begin; index < head; ++index) {
+                const Slot& slot = ring->slots[index % RING_CAPACITY];
+                const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+                if (seq != 2 * index + 2) {
+                    continue;  // overwritten since head was read
+                }
+                SpanRecord span{
+                    slot.trace.load(std::memory_order_relaxed),
+                    slot.link.load(std::memory_order_relaxed),
+                    slot.name.load(std::memory_order_relaxed),
+                    slot.start_ns.load(std::memory_order_relaxed),
+                    slot.duration_ns.load(std::memory_order_relaxed),
+                    ring->thread
+                };
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq.load(std::memory_order_relaxed) == seq) {
+                    spans.push_back(span);
+                }
+            }
+        }
+        std::sort(spans.begin(), spans.end(),
+                  [](const SpanRecord& a, const SpanRecord& b) { return a.start_ns < b.start_ns; });
+        return spans;
+    }
+
+    // One trace and every aggregate it links into, transitively
+    [[nodiscard]] std::vector<SpanRecord> collect(TraceId trace) const {
+        auto spans = collect();
+        std::unordered_set<TraceId> traces{trace};
+        for (bool grew = true; grew;) {
+            grew = false;
+            for (const auto& span : spans) {
+                if (span.link != 0 && traces.count(span.trace) && traces.insert(span.link).second) {
+                    grew = true;
+                }
+            }
+        }
+        spans.erase(std::remove_if(spans.begin(), spans.end(),
+                                   [&](const SpanRecord& span) { return !traces.count(span.trace); }),
+                    spans.end());
+        return spans;
+    }
+
+    // Drops everything recorded so far
+    void clear() noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& ring : rings_) {
+            ring->floor.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+    }
+
+    // Chrome trace event format, loadable in chrome://tracing or Perfetto
+    [[nodiscard]] static std::string to_chrome_json(const std::vector<SpanRecord>& spans) {
+        std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        char event[384];
+        for (size_t i = 0; i < spans.size(); ++i) {
+            const auto& span = spans[i];
+            int n = std::snprintf(event, sizeof(event),
+                "%s{\"name\":\"%s\",\"cat\":\"quids\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"trace\":\"%016llx\"",
+                i == 0 ? "" : ",", span.name, span.thread,
+                static_cast<double>(span.start_ns) * 1e-3, static_cast<double>(span.duration_ns) * 1e-3,
+                static_cast<unsigned long long>(span.trace));
+            out.append(event, static_cast<size_t>(std::clamp(n, 0, static_cast<int>(sizeof(event)) - 1)));
+            if (span.link != 0) {
+                n = std::snprintf(event, sizeof(event), ",\"link\":\"%016llx\"",
+                                  static_cast<unsigned long long>(span.link));
+                out.append(event, static_cast<size_t>(std::clamp(n, 0, static_cast<int>(sizeof(event)) - 1)));
+            }
+            out += "}}";
+        }
+        out += "]}";
+        return out;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<TraceId> trace{0};
+        std::atomic<TraceId> link{0};
+        std::atomic<const char*> name{""};
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> duration_ns{0};
+    };
+
+    struct Ring {
+        explicit Ring(uint32_t id) : thread(id) {}
+
+        std::array<Slot, RING_CAPACITY> slots;
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> floor{0};  // clear() hides everything below
+        const uint32_t thread;
+        bool leased{true};               // guarded by Tracer::mutex_
+    };
+
+    // Held by each thread for its lifetime; the ring goes back to the
+    // pool afterwards with its spans, so the count tracks peak threads
+    struct Lease {
+        explicit Lease(Tracer& tracer) : tracer(tracer), ring(tracer.acquire()) {}
+        ~Lease() { tracer.release(ring); }
+
+        Tracer& tracer;
+        Ring& ring;
+    };
+
+    Tracer() { set_sample_rate(0.01); }
+
+    Ring& local_ring() {
+        thread_local Lease lease(*this);
+        return lease.ring;
+    }
+
+    Ring& acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& ring : rings_) {
+            if (!ring->leased) {
+                ring->leased = true;
+                return *ring;
+            }
+        }
+        rings_.push_back(std::make_unique<Ring>(static_cast<uint32_t>(rings_.size())));
+        return *rings_.back();
+    }
+
+    void release(Ring& ring) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring.leased = false;
+    }
+
+    std::atomic<uint64_t> threshold_{0};
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+// Records [construction, destruction) as one span when the trace is sampled
+class Span {
+public:
+    Span(const char* name, TraceId trace, TraceId link = 0) noexcept
+        : name_(name), trace_(trace), link_(link), active_(Tracer::global().sampled(trace)) {
+        if (active_) {
+            start_ns_ = tracing_detail::now_ns();
+        }
+    }
+
+    ~Span() {
+        if (active_) {
+            Tracer::global().record({trace_, link_, name_, start_ns_, tracing_detail::now_ns() - start_ns_, 0});
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    [[nodiscard]] bool active() const noexcept { return active_; }
+
+private:
+    const char* name_;
+    TraceId trace_;
+    TraceId link_;
+    bool active_;
+    uint64_t start_ns_{0};
+};
+
+} // namespace utils
+} // namespace quids
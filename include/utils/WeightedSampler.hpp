@@ -0,0 +1,98 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "utils/RandomService.hpp"
+
+namespace quids {
+namespace utils {
+
+// Fenwick tree over integer weights.
+//
+// Updating a weight, a prefix sum and a weighted draw are all O(log n), so
+// a sampler can live alongside the set it indexes and follow every weight
+// change instead of being rebuilt per draw. Weights are integers so every
+// node that applies the same updates draws exactly the same indices.
+// A weight of zero excludes the index from draws.
+//
+// Not synchronized: writers must be serialized by the caller.
+class WeightedSampler {
+public:
+    WeightedSampler() = default;
+
+    [[nodiscard]] size_t size() const noexcept { return weights_.size(); }
+    [[nodiscard]] uint64_t total() const noexcept { return total_; }
+    [[nodiscard]] uint64_t weight(size_t i) const noexcept { return weights_[i]; }
+
+    void push_back(uint64_t w) {
+        const size_t i = weights_.size() + 1;
+        // Node i covers (i - lowbit(i), i]: everything before i in that range
+        // is already in the tree
+        uint64_t node = w;
+        for (size_t j = i - 1, stop = i - (i & (0 - i)); j > stop; j -= j & (0 - j)) {
+            node += tree_[j];
+        }
+        if (tree_.empty()) {
+            tree_.push_back(0);
+        }
+        tree_.push_back(node);
+        weights_.push_back(w);
+        total_ += w;
+    }
+
+    void set(size_t i, uint64_t w) noexcept {
+        const uint64_t old = weights_[i];
+        if (w == old) {
+            return;
+        }
+        weights_[i] = w;
+        total_ += w - old;
+        for (size_t j = i + 1; j < tree_.size(); j += j & (0 - j)) {
+            tree_[j] += w - old;  // wraps correctly when w < old
+        }
+    }
+
+    // Index whose cumulative range contains target; requires target < total()
+    [[nodiscard]] size_t find(uint64_t target) const noexcept {
+        size_t pos = 0;
+        for (size_t step = std::bit_floor(weights_.size()); step != 0; step >>= 1) {
+            if (pos + step < tree_.size() && tree_[pos + step] <= target) {
+                pos += step;
+                target -= tree_[pos];
+            }
+        }
+        return pos;
+    }
+
+    // Up to `count` distinct indices, each draw proportional to weight among
+    // those not yet drawn. Fewer come back when fewer have nonzero weight.
+    std::vector<size_t> sample(Philox& rng, size_t count) {
+        std::vector<std::pair<size_t, uint64_t>> drawn;
+        drawn.reserve(count);
+        while (drawn.size() < count && total_ != 0) {
+            const size_t i = find(rng.below(total_));
+            drawn.emplace_back(i, weights_[i]);
+            set(i, 0);
+        }
+
+        std::vector<size_t> indices;
+        indices.reserve(drawn.size());
+        for (const auto& [i, w] : drawn) {
+            set(i, w);
+            indices.push_back(i);
+        }
+        return indices;
+    }
+
+private:
+    std::vector<uint64_t> tree_;  // 1-based, tree_[0] unused
+    std::vector<uint64_t> weights_;
+    uint64_t total_{0};
+};
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace quids {
+namespace utils {
+
+// Lower value runs first
+enum class TaskPriority : uint8_t {
+    Consensus = 0,
+    Execution = 1,
+    Proof = 2,
+    ML = 3
+};
+
+constexpr size_t NUM_TASK_PRIORITIES = 4;
+
+// Process-wide executor with one deque per worker and priority.
+//
+// Workers pop their own deques LIFO and steal FIFO from the others, always
+// draining a priority level everywhere before looking at the next one, so a
+// backlog of proof or ML work never delays consensus tasks. Threads that
+// wait on a parallel_for help run tasks instead of blocking, which makes
+// nested parallel loops safe. They only help with tasks at the loop's own
+// priority or a more urgent one, so a consensus caller is never held up
+// behind a proof task it picked up while waiting.
+//
+// A task that throws is counted in Stats::failed and does not take its
+// worker down. Use submit() or parallel_for() to see the exception.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    struct Config {
+        size_t num_threads{0};     // 0 = hardware concurrency
+        bool pin_threads{false};   // pin worker i to CPU first_cpu + i
+        size_t first_cpu{0};
+    };
+
+    struct Stats {
+        uint64_t executed{0};
+        uint64_t stolen{0};
+        uint64_t failed{0};  // posted tasks that threw
+    };
+
+    explicit WorkStealingPool(const Config& config) {
+        size_t threads = config.num_threads;
+        if (threads == 0) {
+            threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+
+        threads_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            threads_.emplace_back([this, i]() { worker_loop(i); });
+            if (config.pin_threads) {
+                pin_thread(threads_.back(), config.first_cpu + i);
+            }
+        }
+    }
+
+    WorkStealingPool() : WorkStealingPool(Config{}) {}
+
+    ~WorkStealingPool() {
+        stop_.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        sleep_cv_.notify_all();
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Shared instance used by rollup, consensus, ZKP and ML code
+    static WorkStealingPool& global() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return workers_.size(); }
+
+    [[nodiscard]] bool in_worker() const noexcept { return current_pool_ == this; }
+
+    // Index of the calling worker, or size() on threads outside the pool.
+    // Lets callers keep per-worker state in a vector of size() + 1.
+    [[nodiscard]] size_t worker_index() const noexcept {
+        return in_worker() ? current_index_ : workers_.size();
+    }
+
+    [[nodiscard]] Stats stats() const noexcept {
+        return {executed_.load(std::memory_order_relaxed), stolen_.load(std::memory_order_relaxed),
+                failed_.load(std::memory_order_relaxed)};
+    }
+
+    // Fire and forget
+    void post(TaskPriority priority, Task task) {
+        // Tasks spawned by a worker stay local, external ones are spread out
+        size_t target = in_worker()
+            ? current_index_
+            : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+        auto& worker = *workers_[target];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.queues[static_cast<size_t>(priority)].push_back(std::move(task));
+        }
+        pending_.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        sleep_cv_.notify_one();
+    }
+
+    // Do not block on the returned future from inside a pool task; use
+    // parallel_for there, which helps instead of waiting
+    template<typename F>
+    auto submit(TaskPriority priority, F&& fn) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+        auto future = task->get_future();
+        post(priority, [task]() { (*task)(); });
+        return future;
+    }
+
+    // Runs body(i) for i in [begin, end) and returns when all are done.
+    // The calling thread takes part in the work. If body throws, chunks not
+    // yet started are skipped and the first exception is rethrown here once
+    // every chunk has finished, so nothing still refers to body.
+    template<typename F>
+    void parallel_for(size_t begin, size_t end, F&& body,
+                      TaskPriority priority = TaskPriority::Execution, size_t grain = 1) {
+        if (begin >= end) {
+            return;
+        }
+        const size_t count = end - begin;
+        grain = std::max<size_t>(1, grain);
+        const size_t max_chunks = std::max<size_t>(1, count / grain);
+        const size_t chunks = std::min(max_chunks, size() * 4);
+
+        if (chunks <= 1) {
+            for (size_t i = begin; i < end; ++i) body(i);
+            return;
+        }
+
+        const size_t chunk_size = (count + chunks - 1) / chunks;
+        LoopState state{chunks};
+        auto run_chunk = [&body, &state](size_t lo, size_t hi) {
+            try {
+                for (size_t i = lo; i < hi && !state.failed.load(std::memory_order_relaxed); ++i) body(i);
+            } catch (...) {
+                state.fail(std::current_exception());
+            }
+            state.remaining.fetch_sub(1, std::memory_order_acq_rel);
+        };
+
+        for (size_t c = 1; c < chunks; ++c) {
+            size_t lo = begin + c * chunk_size;
+            size_t hi = std::min(lo + chunk_size, end);
+            post(priority, [&run_chunk, lo, hi]() { run_chunk(lo, hi); });
+        }
+
+        // First chunk inline
+        run_chunk(begin, std::min(begin + chunk_size, end));
+
+        while (state.remaining.load(std::memory_order_acquire) != 0) {
+            if (!run_one(priority)) {
+                std::this_thread::yield();
+            }
+        }
+        if (state.error) {
+            std::rethrow_exception(state.error);
+        }
+    }
+
+    // Run a single queued task on the calling thread, if any. Only tasks at
+    // up_to or a more urgent priority are taken; the default takes any.
+    bool run_one(TaskPriority up_to = TaskPriority::ML) {
+        Task task;
+        size_t self = in_worker() ? current_index_ : workers_.size();
+        if (!take(self, task, static_cast<size_t>(up_to) + 1)) {
+            return false;
+        }
+        run_task(task);
+        return true;
+    }
+
+private:
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::array<std::deque<Task>, NUM_TASK_PRIORITIES> queues;
+    };
+
+    // Shared by one parallel_for and its chunks; lives on the caller's
+    // stack, which waits for remaining to reach zero before unwinding
+    struct LoopState {
+        explicit LoopState(size_t chunks) : remaining(chunks) {}
+
+        void fail(std::exception_ptr e) {
+            if (!failed.exchange(true, std::memory_order_acq_rel)) {
+                error = std::move(e);
+            }
+        }
+
+        std::atomic<size_t> remaining;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;  // written once, read after remaining hits zero
+    };
+
+    void run_task(Task& task) {
+        try {
+            task();
+        } catch (...) {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        executed_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Looks at priority levels [0, levels)
+    bool take(size_t self, Task& out, size_t levels = NUM_TASK_PRIORITIES) {
+        if (pending_.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        for (size_t p = 0; p < levels; ++p) {
+            // Own deque, newest first for cache locality
+            if (self < workers_.size()) {
+                auto& own = *workers_[self];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                auto& queue = own.queues[p];
+                if (!queue.empty()) {
+                    out = std::move(queue.back());
+                    queue.pop_back();
+                    pending_.fetch_sub(1, std::memory_order_acq_rel);
+                    return true;
+                }
+            }
+            // Steal oldest from the others
+            for (size_t k = 1; k <= workers_.size(); ++k) {
+                size_t victim = (self + k) % workers_.size();
+                if (victim == self) continue;
+                auto& other = *workers_[victim];
+                std::lock_guard<std::mutex> lock(other.mutex);
+                auto& queue = other.queues[p];
+                if (!queue.empty()) {
+                    out = std::move(queue.front());
+                    queue.pop_front();
+                    pending_.fetch_sub(1, std::memory_order_acq_rel);
+                    stolen_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void worker_loop(size_t index) {
+        current_pool_ = this;
+        current_index_ = index;
+
+        while (true) {
+            Task task;
+            if (take(index, task)) {
+                run_task(task);
+                continue;
+            }
+            if (stop_.load(std::memory_order_acquire)) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.wait(lock, [this]() {
+                return pending_.load(std::memory_order_acquire) > 0 ||
+                       stop_.load(std::memory_order_acquire);
+            });
+        }
+
+        current_pool_ = nullptr;
+    }
+
+    static void pin_thread(std::thread& thread, size_t cpu) {
+#if defined(__linux__)
+        const size_t cpus = std::max<size_t>(1, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu % cpus, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)cpu;
+#endif
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    alignas(64) std::atomic<size_t> pending_{0};
+    alignas(64) std::atomic<size_t> next_worker_{0};
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> executed_{0};
+    std::atomic<uint64_t> stolen_{0};
+    std::atomic<uint64_t> failed_{0};
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+
+    inline static thread_local WorkStealingPool* current_pool_ = nullptr;
+    inline static thread_local size_t current_index_ = 0;
+};
+
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "zkp/QZKPGenerator.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace quids {
+namespace zkp {
+
+// Canonical compact encoding of QZKPGenerator::Proof and QZKPProof.
+//
+// The body records every field in a fixed order. Lengths, qubit indices
+// and the timestamp (microseconds, zigzag) are varints. Phase angles are
+// unsigned 32-bit fixed point in turns, so an angle is taken mod 2*pi and
+// costs 4 bytes rather than 8. Measurement outcomes are packed 8 to a byte,
+// LSB first, and commitment amplitudes are stored as raw little-endian
+// doubles. Each proof has exactly one body: decoding rejects overlong
+// varints, set padding bits and trailing bytes.
+//
+// A two-byte header (version, coding) comes before the body, and the body
+// may be ZSTD-compressed. It is kept raw when compression does not help.
+// hash() is taken over the body, so it is the same for both codings and
+// for a proof re-encoded after decoding. Callers that hold encoded bytes
+// hash those bytes directly instead of building the struct again.
+class ProofCodec {
+public:
+    using Hash = crypto::MerkleHash;
+
+    static constexpr uint8_t VERSION = 1;
+    static constexpr int DEFAULT_LEVEL = 3;
+
+    enum class Coding : uint8_t { Raw = 0, Zstd = 1 };
+
+    [[nodiscard]] static std::vector<uint8_t> encode(const QZKPGenerator::Proof& proof,
+                                                     Coding coding = Coding::Raw,
+                                                     int level = DEFAULT_LEVEL);
+    [[nodiscard]] static std::vector<uint8_t> encode(const QZKPProof& proof,
+                                                     Coding coding = Coding::Raw,
+                                                     int level = DEFAULT_LEVEL);
+
+    // Throws std::runtime_error on a malformed or non-canonical encoding
+    [[nodiscard]] static QZKPGenerator::Proof decode(std::span<const uint8_t> encoded);
+    [[nodiscard]] static QZKPProof decode_commitment(std::span<const uint8_t> encoded);
+
+    // The canonical body, decompressed when needed
+    [[nodiscard]] static std::vector<uint8_t> body(std::span<const uint8_t> encoded);
+
+    // Merkle leaf hash of the body. A raw encoding is hashed in place.
+    [[nodiscard]] static Hash hash(std::span<const uint8_t> encoded);
+    [[nodiscard]] static Hash hash(const QZKPGenerator::Proof& proof);
+
+    // Rounds an angle to the nearest value the encoding holds, in [0, 2*pi)
+    [[nodiscard]] static double quantize_phase(double angle);
+};
+
+} // namespace zkp
+} // namespace quids
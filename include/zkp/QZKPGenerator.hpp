@@ -5,7 +5,6 @@
 #include <array>
 #include <memory>
 #include <chrono>
-#include <random>
 #include <optional>
 #include "quantum/QuantumState.hpp"
 #include <Eigen/Dense>
@@ -55,6 +54,11 @@ public:
     
     // Add these declarations
     Proof generate_proof_parallel(const quantum::QuantumState& state);
+
+    // One proof per state, simulated together in StateBatches of equal
+    // qubit count. Proofs from the same batch share their phases and
+    // measured qubits; outcomes are per state.
+    [[nodiscard]] std::vector<Proof> generate_proof_batch(const std::vector<quantum::QuantumState>& states);
     
 protected:
     std::vector<uint8_t> generate_partial_proof(
@@ -88,9 +92,6 @@ private:
     double success_rate_{1.0};
     size_t total_proofs_{0};
     
-    // Random number generation
-    std::unique_ptr<std::mt19937> rng_;
-    
     // Constants
     static constexpr size_t MIN_QUBITS = 8;
     static constexpr size_t MAX_QUBITS = 1024;
@@ -5,6 +5,9 @@
 #include <memory>
 #include <chrono>
 #include <optional>
+#include <map>
+#include <shared_mutex>
+#include <span>
 #include "zkp/Types.hpp"
 #include "zkp/QZKPGenerator.hpp"
 #include "quantum/QuantumState.hpp"
@@ -18,6 +21,79 @@ struct EntanglementProof {
     double fidelity;
 };
 
+/**
+ * @brief Sequential test that a match rate reaches a required level
+ *
+ * Items are checked in chunks, in an order the prover cannot predict, and
+ * the running match rate is bounded with the Hoeffding-Serfling inequality
+ * for sampling without replacement. The error budget 1 - confidence is
+ * split over every chunk boundary, so stopping at the first decisive look
+ * keeps the overall error below it. Once every item is checked the
+ * decision is exact.
+ */
+class SequentialMatchTest {
+public:
+    enum class Decision {
+        CONTINUE,
+        ACCEPT,
+        REJECT
+    };
+
+    /**
+     * @param required_rate Fraction of items that must match
+     * @param confidence Probability that an early decision is right
+     * @param population Number of items
+     * @param chunk_size Items checked between looks
+     */
+    SequentialMatchTest(double required_rate, double confidence, size_t population, size_t chunk_size);
+
+    // Records one chunk of results and decides whether to stop
+    Decision update(size_t checked, size_t matched);
+
+    [[nodiscard]] size_t checked() const { return checked_; }
+    [[nodiscard]] size_t matched() const { return matched_; }
+    [[nodiscard]] size_t population() const { return population_; }
+
+    // Bounds on the population match rate at the current confidence
+    [[nodiscard]] double lower_bound() const;
+    [[nodiscard]] double upper_bound() const;
+
+private:
+    double radius() const;
+
+    double required_rate_;
+    double log_term_;
+    size_t population_;
+    size_t checked_{0};
+    size_t matched_{0};
+};
+
+/**
+ * @brief Verification setup shared by every proof checked against one state
+ *
+ * The claimed state's reference outcomes are read once, and the phase term
+ * of each phase-angle set is computed once and kept. Proofs from one
+ * generate_proof_batch call share their phases, so a block's worth of them
+ * pays for a single evaluation. Safe to share between threads.
+ */
+class PreparedVerifier {
+public:
+    explicit PreparedVerifier(const quantum::QuantumState& claimed_state);
+
+    [[nodiscard]] const std::vector<bool>& reference_outcomes() const { return reference_outcomes_; }
+
+    // Mean cosine of the angles; 0 for none
+    [[nodiscard]] double phase_term(const std::vector<double>& phase_angles) const;
+
+private:
+    // Phase sets kept before the cache starts over
+    static constexpr size_t MAX_PHASE_SETS = 256;
+
+    std::vector<bool> reference_outcomes_;
+    mutable std::shared_mutex mutex_;
+    mutable std::map<std::vector<double>, double> phase_terms_;
+};
+
 class QZKPVerifier {
 public:
     enum class VerificationResult {
@@ -35,6 +111,7 @@ public:
         std::vector<double> phase_angles;
         size_t total_measurements;
         size_t matching_measurements;
+        size_t checked_measurements{0};  // Less than total when a sequential check stopped early
         std::chrono::system_clock::time_point timestamp;
         
         // Default constructor
@@ -66,6 +143,7 @@ public:
             , phase_angles(std::move(phase_angles_))
             , total_measurements(total_measurements_)
             , matching_measurements(matching_measurements_)
+            , checked_measurements(total_measurements_)
             , timestamp(std::chrono::system_clock::now())
         {}
         
@@ -82,10 +160,14 @@ public:
                    fidelity >= 0.0 &&
                    fidelity <= 1.0 &&
                    total_measurements > 0 &&
-                   matching_measurements <= total_measurements;
+                   matching_measurements <= checked_measurements &&
+                   checked_measurements <= total_measurements;
         }
     };
     
+    // Measurements checked between looks in sequential verification
+    static constexpr size_t DEFAULT_SEQUENTIAL_CHUNK = 64;
+    
     // Constructor and destructor
     QZKPVerifier() noexcept;
     ~QZKPVerifier() = default;
@@ -102,6 +184,43 @@ public:
         const QZKPGenerator::Proof& proof
     );
     
+    /**
+     * @brief Verifies measurements in random chunks, stopping at a decision
+     *
+     * Accepts once the match rate is at least 1 - measurement tolerance
+     * with the configured confidence, and rejects once it is below it with
+     * the same confidence, so most valid proofs are accepted after checking
+     * a fraction of their measurements.
+     */
+    [[nodiscard]] VerificationDetails verify_proof_sequential(
+        const quantum::QuantumState& claimed_state,
+        const QZKPGenerator::Proof& proof,
+        size_t chunk_size = DEFAULT_SEQUENTIAL_CHUNK
+    );
+    
+    // Setup for checking any number of proofs against claimed_state
+    [[nodiscard]] static std::shared_ptr<const PreparedVerifier> prepare(const quantum::QuantumState& claimed_state);
+
+    // verify_proof against a prepared state
+    [[nodiscard]] VerificationDetails verify_proof(
+        const PreparedVerifier& prepared,
+        const QZKPGenerator::Proof& proof
+    );
+
+    // One result per proof, checked in parallel on the shared pool
+    [[nodiscard]] std::vector<VerificationDetails> verify_batch(
+        const PreparedVerifier& prepared,
+        std::span<const QZKPGenerator::Proof> proofs
+    );
+
+    // Proof i against *claimed_states[i]; each distinct state object is
+    // prepared once. Throws std::invalid_argument if the spans differ in
+    // length.
+    [[nodiscard]] std::vector<VerificationDetails> verify_batch(
+        std::span<const quantum::QuantumState* const> claimed_states,
+        std::span<const QZKPGenerator::Proof> proofs
+    );
+    
     [[nodiscard]] VerificationDetails verify_entanglement(
         const quantum::QuantumState& state,
         const EntanglementProof& proof
@@ -124,6 +243,12 @@ public:
     [[nodiscard]] size_t get_total_verifications() const { return total_verifications_; }
     
 private:
+    // verify_proof without recording the result; safe to run concurrently
+    [[nodiscard]] VerificationDetails check_proof(
+        const PreparedVerifier& prepared,
+        const QZKPGenerator::Proof& proof
+    ) const;
+
     [[nodiscard]] bool verify_measurement_consistency(
         const std::vector<bool>& recorded_measurements,
         const std::vector<bool>& state_measurements,
@@ -132,7 +257,7 @@ private:
     
     [[nodiscard]] double calculate_confidence_score(
         const QZKPGenerator::Proof& proof,
-        const quantum::QuantumState& state,
+        const PreparedVerifier& prepared,
         double& fidelity,
         size_t& total_measurements,
         size_t& matching_measurements
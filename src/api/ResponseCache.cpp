@@ -0,0 +1,98 @@
+#include "api/ResponseCache.hpp"
+#include <algorithm>
+
+namespace quids {
+namespace api {
+
+ResponseCache::ResponseCache(size_t capacity)
+    : generation_capacity_(std::max<size_t>(1, capacity / 2)) {}
+
+std::optional<ResponseCache::Entry> ResponseCache::get(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const Map* map : {&head_, &current_, &previous_}) {
+        auto it = map->find(key);
+        if (it != map->end()) {
+            return it->second;
+        }
+    }
+    return std::nullopt;
+}
+
+ResponseCache::Entry ResponseCache::put(const std::string& key, std::string body, Lifetime lifetime) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    const uint64_t generation = lifetime == Lifetime::Final ? 0 : block_generation_;
+    Entry entry{nullptr, make_etag(body, generation)};
+    entry.body = std::make_shared<const std::string>(std::move(body));
+
+    if (lifetime == Lifetime::UntilNextBlock) {
+        head_.insert_or_assign(key, entry);
+        return entry;
+    }
+    if (current_.size() >= generation_capacity_) {
+        previous_ = std::move(current_);
+        current_ = Map{};
+    }
+    current_.insert_or_assign(key, entry);
+    return entry;
+}
+
+void ResponseCache::on_new_block() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    head_.clear();
+    ++block_generation_;
+}
+
+void ResponseCache::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    current_.clear();
+    previous_.clear();
+    head_.clear();
+}
+
+size_t ResponseCache::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return current_.size() + previous_.size() + head_.size();
+}
+
+bool ResponseCache::matches(const Entry& entry, const std::string& if_none_match) {
+    if (if_none_match == "*") {
+        return true;
+    }
+    // A comma-separated list, possibly with weak validators
+    size_t pos = 0;
+    while (pos < if_none_match.size()) {
+        size_t end = if_none_match.find(',', pos);
+        if (end == std::string::npos) {
+            end = if_none_match.size();
+        }
+        size_t begin = if_none_match.find_first_not_of(' ', pos);
+        if (begin < end && if_none_match.compare(begin, 2, "W/") == 0) {
+            begin += 2;
+        }
+        const size_t last = if_none_match.find_last_not_of(' ', end - 1);
+        if (begin < end && last != std::string::npos && last >= begin &&
+            if_none_match.compare(begin, last - begin + 1, entry.etag) == 0) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+std::string ResponseCache::make_etag(const std::string& body, uint64_t generation) {
+    // FNV-1a; only has to tell versions of the same resource apart
+    uint64_t h = 0xcbf29ce484222325ULL ^ generation;
+    for (unsigned char c : body) {
+        h = (h ^ c) * 0x100000001b3ULL;
+    }
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string etag = "\"";
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        etag.push_back(digits[(h >> shift) & 0xf]);
+    }
+    etag.push_back('"');
+    return etag;
+}
+
+} // namespace api
+} // namespace quids
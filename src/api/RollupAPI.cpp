@@ -1,13 +1,180 @@
 #include "api/RollupAPI.hpp"
+#include "api/ResponseCache.hpp"
+#include "api/SubscriptionHub.hpp"
+#include "rollup/ProofCache.hpp"
 #include <httplib.h>
 #include <spdlog/spdlog.h>
+#include "blockchain/TransactionView.hpp"
+#include "utils/HealthSampler.hpp"
+#include "utils/Hex.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/Tracing.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <charconv>
+#include <cstdio>
 #include <thread>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+namespace quids {
+namespace api {
+
+namespace {
+
+// JSON-RPC 2.0 error codes
+constexpr int RPC_PARSE_ERROR = -32700;
+constexpr int RPC_INVALID_REQUEST = -32600;
+constexpr int RPC_METHOD_NOT_FOUND = -32601;
+constexpr int RPC_INVALID_PARAMS = -32602;
+// Server-defined: shed by admission control, retry later
+constexpr int RPC_OVERLOADED = -32005;
+
+json rpc_error(const json& id, int code, const std::string& message) {
+    return {{"jsonrpc", "2.0"}, {"id", id}, {"error", {{"code", code}, {"message", message}}}};
+}
+
+std::string to_hex(std::span<const uint8_t> bytes) {
+    return utils::toHex(bytes);
+}
+
+// Accepts an optional 0x prefix; nullopt on odd length or a non-hex digit
+std::optional<std::vector<uint8_t>> from_hex(std::string_view hex) {
+    if (hex.starts_with("0x") || hex.starts_with("0X")) {
+        hex.remove_prefix(2);
+    }
+    return utils::fromHex(hex);
+}
+
+json proof_json(const rollup::StateTrie::Proof& proof) {
+    json steps = json::array();
+    for (const auto& step : proof.steps) {
+        json siblings = json::array();
+        for (const auto& sibling : step.siblings) {
+            siblings.push_back(to_hex(sibling));
+        }
+        steps.push_back({{"bitmap", step.bitmap}, {"nibble", step.nibble}, {"siblings", std::move(siblings)}});
+    }
+    return steps;
+}
+
+json multiproof_json(const rollup::StateTrie::MultiProof& proof) {
+    json branches = json::array();
+    for (const auto& branch : proof.branches) {
+        branches.push_back({{"bitmap", branch.bitmap}, {"descend", branch.descend}, {"leaves", branch.leaves}});
+    }
+    json hashes = json::array();
+    for (const auto& hash : proof.hashes) {
+        hashes.push_back(to_hex(hash));
+    }
+    return {{"branches", std::move(branches)}, {"hashes", std::move(hashes)}};
+}
+
+json simulation_json(const rollup::TransactionSimulator::Result& result) {
+    json logs = json::array();
+    for (const auto& log : result.logs) {
+        json topics = json::array();
+        for (const auto& topic : log.topics) {
+            topics.push_back(topic.to_hex());
+        }
+        logs.push_back({{"address", log.address.to_hex()}, {"topics", std::move(topics)}, {"data", to_hex(log.data)}});
+    }
+    json data = {
+        {"status", quids::evm::to_string(result.status)},
+        {"gas_used", result.gas_used},
+        {"output", to_hex(result.output)},
+        {"logs", std::move(logs)}
+    };
+    if (!result.contract_address.empty()) {
+        data["contract_address"] = result.contract_address;
+    }
+    if (!result.error.empty()) {
+        data["error"] = result.error;
+    }
+    return data;
+}
+
+json account_json(const std::string& address, const StateManager::Account& account) {
+    return {
+        {"address", address},
+        {"balance", account.balance},
+        {"nonce", account.nonce},
+        {"leaf_hash", to_hex(StateManager::account_hash(account))}
+    };
+}
+
+// Whole seconds, rounded up, as Retry-After takes
+std::string retry_after_header(std::chrono::milliseconds retry_after) {
+    return std::to_string((retry_after.count() + 999) / 1000);
+}
+
+RollupAPI::APIResponse shed(std::chrono::milliseconds retry_after) {
+    return {false, nullptr, "Overloaded, retry later", retry_after};
+}
+
+void reply(httplib::Response& res, const RollupAPI::APIResponse& response) {
+    if (response.retry_after.count() > 0) {
+        res.set_header("Retry-After", retry_after_header(response.retry_after));
+    }
+    if (!response.success && response.retry_after.count() > 0) {
+        res.status = 429;
+        json error = {{"error", response.error_message}, {"retry_after_ms", response.retry_after.count()}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    if (!response.success) {
+        res.status = 400;
+        json error = {{"error", response.error_message}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    res.set_content(response.data.dump(), "application/json");
+}
+
+// Serves key from cache, computing and storing it on a miss. Clients
+// presenting the current ETag get a bodiless 304.
+void reply_cached(ResponseCache& cache, const httplib::Request& req, httplib::Response& res,
+                  const std::string& key, ResponseCache::Lifetime lifetime,
+                  const std::function<RollupAPI::APIResponse()>& compute) {
+    auto entry = cache.get(key);
+    if (!entry) {
+        auto response = compute();
+        if (!response.success) {
+            reply(res, response);
+            return;
+        }
+        entry = cache.put(key, response.data.dump(), lifetime);
+    }
+    res.set_header("ETag", entry->etag);
+    res.set_header("Cache-Control", lifetime == ResponseCache::Lifetime::Final
+                                        ? "public, max-age=31536000, immutable"
+                                        : "no-cache");
+    if (req.has_header("If-None-Match") && ResponseCache::matches(*entry, req.get_header_value("If-None-Match"))) {
+        res.status = 304;
+        return;
+    }
+    res.set_content(*entry->body, "application/json");
+}
+
+} // namespace
 
 class RollupAPI::Impl {
 public:
+    explicit Impl(const APIConfig& config)
+        : cache(config.response_cache_entries), subscriptions(config.max_queued_events),
+          proofs(config.proof_cache_entries) {}
+
     httplib::Server server;
     std::thread server_thread;
     bool running{false};
+    ResponseCache cache;
+    SubscriptionHub subscriptions;
+    rollup::ProofCache proofs;
+    // Balance check and debit of a withdrawal happen together
+    std::mutex withdrawal_mutex;
+    std::unique_ptr<rollup::TransactionSimulator> simulator;
 };
 
 RollupAPI::RollupAPI(
@@ -19,7 +186,8 @@ RollupAPI::RollupAPI(
     tx_api_(tx_api),
     state_manager_(state_manager),
     l1_contract_(l1_contract),
-    impl_(std::make_unique<Impl>()) {
+    impl_(std::make_unique<Impl>(config)) {
+    impl_->simulator = std::make_unique<rollup::TransactionSimulator>(state_manager_, config_.simulator);
     setup_routes();
 }
 
@@ -35,6 +203,14 @@ void RollupAPI::start() {
     // Configure CORS
     impl_->server.set_cors(config_.allowed_origins, "POST, GET, OPTIONS",
                           "Content-Type, Authorization");
+
+    // The listener only accepts; connections are served from the pool and
+    // kept alive so clients can pipeline without reconnecting
+    const size_t workers = std::max<size_t>(1, config_.worker_threads);
+    impl_->server.new_task_queue = [workers] { return new httplib::ThreadPool(workers); };
+    impl_->server.set_keep_alive_max_count(config_.keep_alive_requests);
+    impl_->server.set_keep_alive_timeout(5);
+    impl_->server.set_payload_max_length(config_.max_ingest_bytes);
     
     // Start server in a separate thread
     impl_->server_thread = std::thread([this]() {
@@ -42,12 +218,14 @@ void RollupAPI::start() {
         impl_->server.listen(config_.rpc_host.c_str(), config_.rpc_port);
     });
     
-    spdlog::info("RPC server started on {}:{}", config_.rpc_host, config_.rpc_port);
+    spdlog::info("RPC server started on {}:{} with {} workers", config_.rpc_host, config_.rpc_port, workers);
 }
 
 void RollupAPI::stop() {
     if (!impl_->running) return;
     
+    // Streaming handlers hold workers until their subscription closes
+    impl_->subscriptions.close_all();
     impl_->server.stop();
     if (impl_->server_thread.joinable()) {
         impl_->server_thread.join();
@@ -58,18 +236,74 @@ void RollupAPI::stop() {
 }
 
 void RollupAPI::setup_routes() {
+    // JSON-RPC 2.0, single calls and batches
+    impl_->server.Post("/rpc", [this](const httplib::Request& req, httplib::Response& res) {
+        json body;
+        try {
+            body = json::parse(req.body);
+        } catch (const std::exception&) {
+            res.set_content(rpc_error(nullptr, RPC_PARSE_ERROR, "Parse error").dump(), "application/json");
+            return;
+        }
+        json response = handle_rpc(body);
+        if (response.is_null()) {
+            res.status = 204;
+            return;
+        }
+        // A single shed call is answered like the REST endpoints; in a batch
+        // the other calls still have results, so only the error says so
+        if (response.is_object() && response.contains("error") &&
+            response["error"].value("code", 0) == RPC_OVERLOADED) {
+            const auto retry = std::chrono::milliseconds(response["error"]["data"].value("retry_after_ms", 0));
+            res.status = 429;
+            res.set_header("Retry-After", retry_after_header(retry));
+        }
+        res.set_content(response.dump(), "application/json");
+    });
+
     // Transaction endpoints
     impl_->server.Post("/tx/submit", [this](const httplib::Request& req, httplib::Response& res) {
         try {
-            auto params = json::parse(req.body);
-            auto response = submit_transaction(params);
-            res.set_content(response.data.dump(), "application/json");
+            // Most submissions are flat objects, which are read in place
+            // without building a json tree
+            if (auto payload = scan_submit_payload(req.body)) {
+                reply(res, submit_payload(*payload));
+                return;
+            }
+            reply(res, submit_transaction(json::parse(req.body)));
         } catch (const std::exception& e) {
             res.status = 400;
             json error = {{"error", e.what()}};
             res.set_content(error.dump(), "application/json");
         }
     });
+
+    // Dry runs: the same body as a call, unsigned
+    impl_->server.Post("/tx/simulate", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            reply(res, simulate_transaction(json::parse(req.body)));
+        } catch (const std::exception& e) {
+            res.status = 400;
+            json error = {{"error", e.what()}};
+            res.set_content(error.dump(), "application/json");
+        }
+    });
+
+    impl_->server.Post("/tx/estimate", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            reply(res, estimate_gas(json::parse(req.body)));
+        } catch (const std::exception& e) {
+            res.status = 400;
+            json error = {{"error", e.what()}};
+            res.set_content(error.dump(), "application/json");
+        }
+    });
+
+    // Bulk submission: canonical transactions packed back to back
+    impl_->server.Post("/tx/ingest", [this](const httplib::Request& req, httplib::Response& res) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(req.body.data());
+        reply(res, ingest_transactions({bytes, req.body.size()}));
+    });
     
     impl_->server.Get("/tx/:hash", [this](const httplib::Request& req, httplib::Response& res) {
         try {
@@ -96,18 +330,135 @@ void RollupAPI::setup_routes() {
         }
     });
     
+    impl_->server.Get("/account/:address/proof", [this](const httplib::Request& req, httplib::Response& res) {
+        reply(res, get_proof({{"address", req.path_params.at("address")}}));
+    });
+    
     // Block endpoints
+    impl_->server.Get("/account/:address/transactions", [this](const httplib::Request& req, httplib::Response& res) {
+        json params = {{"address", req.path_params.at("address")}};
+        for (const char* key : {"cursor", "order"}) {
+            if (req.has_param(key)) {
+                params[key] = req.get_param_value(key);
+            }
+        }
+        try {
+            for (const char* key : {"limit", "from_block", "to_block"}) {
+                if (req.has_param(key)) {
+                    params[key] = std::stoull(req.get_param_value(key));
+                }
+            }
+        } catch (const std::exception&) {
+            reply(res, {false, nullptr, "Malformed query parameter"});
+            return;
+        }
+        reply(res, get_account_transactions(params));
+    });
+
+    // Finalized blocks never change, so they are served with a permanent
+    // ETag; the latest block is cached until the next one arrives
+    impl_->server.Get("/block/latest", [this](const httplib::Request& req, httplib::Response& res) {
+        reply_cached(impl_->cache, req, res, "block:latest", ResponseCache::Lifetime::UntilNextBlock,
+                     [this] { return get_latest_block(json::object()); });
+    });
+
     impl_->server.Get("/block/:number", [this](const httplib::Request& req, httplib::Response& res) {
         try {
-            json params = {{"number", std::stoull(req.path_params.at("number"))}};
-            auto response = get_block_by_number(params);
-            res.set_content(response.data.dump(), "application/json");
+            const uint64_t number = std::stoull(req.path_params.at("number"));
+            reply_cached(impl_->cache, req, res, "block:" + std::to_string(number), ResponseCache::Lifetime::Final,
+                         [this, number] { return get_block_by_number({{"number", number}}); });
         } catch (const std::exception& e) {
             res.status = 400;
             json error = {{"error", e.what()}};
             res.set_content(error.dump(), "application/json");
         }
     });
+
+    // Server-sent events, e.g. /subscribe?topics=newHeads,pendingTx
+    impl_->server.Get("/subscribe", [this](const httplib::Request& req, httplib::Response& res) {
+        std::vector<SubscriptionHub::Topic> topics;
+        std::string list = req.has_param("topics") ? req.get_param_value("topics") : "newHeads";
+        size_t pos = 0;
+        while (pos <= list.size()) {
+            const size_t end = std::min(list.find(',', pos), list.size());
+            auto topic = SubscriptionHub::parse_topic(std::string_view(list).substr(pos, end - pos));
+            if (!topic) {
+                res.status = 400;
+                json error = {{"error", "Unknown topic " + list.substr(pos, end - pos)}};
+                res.set_content(error.dump(), "application/json");
+                return;
+            }
+            topics.push_back(*topic);
+            pos = end + 1;
+        }
+
+        auto subscription = impl_->subscriptions.subscribe(topics);
+        res.set_header("Cache-Control", "no-cache");
+        res.set_chunked_content_provider("text/event-stream",
+            [subscription](size_t, httplib::DataSink& sink) {
+                auto frames = subscription->wait(std::chrono::seconds(15));
+                if (!frames) {
+                    sink.done();
+                    return false;
+                }
+                if (frames->empty()) {
+                    // Keeps proxies from timing out an idle stream
+                    static constexpr std::string_view keepalive = ": keepalive\n\n";
+                    return sink.write(keepalive.data(), keepalive.size());
+                }
+                for (const auto& frame : *frames) {
+                    if (!sink.write(frame->data(), frame->size())) {
+                        return false;
+                    }
+                }
+                return true;
+            },
+            [subscription](bool) { subscription->close(); });
+    });
+
+    // Prometheus scrape target
+    impl_->server.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(utils::MetricsRegistry::global().scrape(), "text/plain; version=0.0.4");
+    });
+
+    // Process CPU, RSS, disk and peer latency, latest and over 1/10/60 s
+    impl_->server.Get("/health", [](const httplib::Request&, httplib::Response& res) {
+        const auto snapshot = utils::HealthSampler::global().snapshot();
+        const auto sample_json = [](const utils::HealthSample& sample) {
+            return json{{"cpu_usage", sample.cpu_usage},
+                        {"memory_mb", sample.memory_mb},
+                        {"disk_usage", sample.disk_usage},
+                        {"network_latency_us", sample.network_latency_us}};
+        };
+        const json body = {{"latest", sample_json(snapshot.latest)},
+                           {"last_1s", sample_json(snapshot.last_1s)},
+                           {"last_10s", sample_json(snapshot.last_10s)},
+                           {"last_60s", sample_json(snapshot.last_60s)},
+                           {"cpu_peak_10s", snapshot.cpu_peak_10s},
+                           {"ticks", snapshot.ticks}};
+        res.set_content(body.dump(), "application/json");
+    });
+
+    // Sampled spans still in the ring buffers, in Chrome trace format
+    impl_->server.Get("/debug/trace", [](const httplib::Request&, httplib::Response& res) {
+        auto& tracer = utils::Tracer::global();
+        res.set_content(utils::Tracer::to_chrome_json(tracer.collect()), "application/json");
+    });
+
+    // One transaction's trace, with the batches and blocks it went through;
+    // the id is the trace_id returned by submission
+    impl_->server.Get("/debug/trace/:id", [](const httplib::Request& req, httplib::Response& res) {
+        const std::string& id = req.path_params.at("id");
+        utils::TraceId trace = 0;
+        auto [end, ec] = std::from_chars(id.data(), id.data() + id.size(), trace, 16);
+        if (ec != std::errc() || end != id.data() + id.size()) {
+            res.status = 400;
+            res.set_content(json({{"error", "Invalid trace id"}}).dump(), "application/json");
+            return;
+        }
+        auto& tracer = utils::Tracer::global();
+        res.set_content(utils::Tracer::to_chrome_json(tracer.collect(trace)), "application/json");
+    });
     
     // Bridge endpoints
     impl_->server.Post("/bridge/deposit", [this](const httplib::Request& req, httplib::Response& res) {
@@ -121,6 +472,23 @@ void RollupAPI::setup_routes() {
             res.set_content(error.dump(), "application/json");
         }
     });
+
+    impl_->server.Post("/bridge/withdraw", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto params = json::parse(req.body);
+            auto response = initiate_withdrawal(params);
+            if (!response.success) {
+                res.status = 400;
+                res.set_content(json({{"error", response.error_message}}).dump(), "application/json");
+                return;
+            }
+            res.set_content(response.data.dump(), "application/json");
+        } catch (const std::exception& e) {
+            res.status = 400;
+            json error = {{"error", e.what()}};
+            res.set_content(error.dump(), "application/json");
+        }
+    });
 }
 
 APIResponse RollupAPI::submit_transaction(const json& params) {
@@ -138,19 +506,417 @@ APIResponse RollupAPI::submit_transaction(const json& params) {
     return {!result.empty(), {{"tx_hash", result}}, ""};
 }
 
+APIResponse RollupAPI::submit_transaction(const json& params) {
+    if (!validate_params(params, {"sender", "recipient", "amount", "signature"}) && !params.contains("raw")) {
+        return {false, nullptr, "Missing required parameters"};
+    }
+
+    // Same fields the scanner extracts, pointing into params
+    SubmitPayload payload;
+    auto text = [&](const char* key, std::string_view& field) {
+        if (params.contains(key)) {
+            field = params[key].get_ref<const std::string&>();
+        }
+    };
+    auto number = [&](const char* key, uint64_t& field) {
+        if (!params.contains(key)) {
+            return false;
+        }
+        const json& value = params[key];
+        field = value.is_string() ? std::stoull(value.get<std::string>()) : value.get<uint64_t>();
+        return true;
+    };
+    text("raw", payload.raw);
+    text("sender", payload.sender);
+    text("recipient", payload.recipient);
+    text("signature", payload.signature);
+    text("data", payload.data);
+    payload.has_amount = number("amount", payload.amount);
+    number("nonce", payload.nonce);
+    number("gas_cost", payload.gas_cost);
+    uint64_t timestamp = 0;
+    if (number("timestamp", timestamp)) {
+        payload.timestamp = static_cast<int64_t>(timestamp);
+    }
+    return submit_payload(payload);
+}
+
+APIResponse RollupAPI::submit_payload(const SubmitPayload& payload) {
+    auto bytes = encode_submit_payload(payload);
+    if (!bytes) {
+        return {false, nullptr, "Malformed transaction"};
+    }
+    auto view = blockchain::TransactionView::parse(*bytes);
+    if (!view) {
+        return {false, nullptr, "Malformed transaction"};
+    }
+    // Shed at the edge, before the signature check and the copy
+    auto decision = tx_api_->admission()->admit_fee(view->calculate_gas_cost());
+    if (!decision.admitted) {
+        return shed(decision.retry_after);
+    }
+    const utils::TraceId trace = utils::transaction_trace_id(view->getSender(), view->getNonce());
+    utils::Span span("rpc.submit", trace);
+    if (!tx_api_->submitTransaction(std::make_shared<const blockchain::StandardTransaction>(view->materialize()))) {
+        return {false, nullptr, "Transaction rejected"};
+    }
+    const std::string hash = to_hex(view->computeHash());
+    impl_->subscriptions.publish(SubscriptionHub::Topic::PendingTx, {{"tx_hashes", {hash}}});
+    json data = {{"tx_hash", hash}};
+    if (span.active()) {
+        char id[17];
+        std::snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(trace));
+        data["trace_id"] = id;
+    }
+    return {true, std::move(data), ""};
+}
+
+APIResponse RollupAPI::ingest_transactions(std::span<const uint8_t> body) {
+    std::vector<blockchain::TransactionView> views;
+    size_t offset = 0;
+    while (offset < body.size()) {
+        auto view = blockchain::TransactionView::parsePrefix(body.subspan(offset));
+        if (!view) {
+            return {false, nullptr, "Malformed transaction at offset " + std::to_string(offset)};
+        }
+        offset += view->bytes().size();
+        views.push_back(*view);
+    }
+
+    // Each transaction is admitted by its own lane, so under load a bulk
+    // upload keeps its high-fee part
+    auto& admission = *tx_api_->admission();
+    std::vector<uint8_t> admitted(views.size(), 0);
+    std::chrono::milliseconds retry_after{0};
+    for (size_t i = 0; i < views.size(); ++i) {
+        auto decision = admission.admit_fee(views[i].calculate_gas_cost());
+        admitted[i] = decision.admitted;
+        retry_after = std::max(retry_after, decision.retry_after);
+    }
+    if (!views.empty() && std::none_of(admitted.begin(), admitted.end(), [](uint8_t a) { return a != 0; })) {
+        return shed(retry_after);
+    }
+
+    // Signatures are checked on the views before anything is copied; the
+    // mempool is sharded, so submissions can go in from every worker
+    std::vector<uint8_t> accepted(views.size(), 0);
+    utils::WorkStealingPool::global().parallel_for(0, views.size(), [&](size_t i) {
+        if (!admitted[i]) {
+            return;
+        }
+        utils::Span span("rpc.ingest", utils::transaction_trace_id(views[i].getSender(), views[i].getNonce()));
+        accepted[i] = views[i].verify() &&
+                      tx_api_->submitTransaction(std::make_shared<const blockchain::StandardTransaction>(views[i].materialize()));
+    }, utils::TaskPriority::Execution, 64);
+
+    json rejected = json::array();
+    json hashes = json::array();
+    for (size_t i = 0; i < accepted.size(); ++i) {
+        if (!accepted[i]) {
+            rejected.push_back(i);
+        } else {
+            hashes.push_back(to_hex(views[i].computeHash()));
+        }
+    }
+    // One event for the whole upload rather than one per transaction
+    if (!hashes.empty()) {
+        impl_->subscriptions.publish(SubscriptionHub::Topic::PendingTx, {{"tx_hashes", std::move(hashes)}});
+    }
+    return {true, {
+        {"received", views.size()},
+        {"accepted", views.size() - rejected.size()},
+        {"rejected", rejected},
+        {"shed", std::count(admitted.begin(), admitted.end(), 0)}
+    }, "", retry_after};
+}
+
+APIResponse RollupAPI::handle_request(const std::string& method, const json& params) {
+    using Endpoint = APIResponse (RollupAPI::*)(const json&);
+    static const std::unordered_map<std::string, Endpoint> endpoints = {
+        {"submit_transaction", &RollupAPI::submit_transaction},
+        {"get_account_balance", &RollupAPI::get_account_balance},
+        {"get_account_transactions", &RollupAPI::get_account_transactions},
+        {"get_block_by_number", &RollupAPI::get_block_by_number},
+        {"get_latest_block", &RollupAPI::get_latest_block},
+        {"get_proof", &RollupAPI::get_proof},
+        {"simulate_transaction", &RollupAPI::simulate_transaction},
+        {"estimate_gas", &RollupAPI::estimate_gas},
+        {"initiate_deposit", &RollupAPI::initiate_deposit},
+        {"initiate_withdrawal", &RollupAPI::initiate_withdrawal},
+        {"get_withdrawal_proof", &RollupAPI::get_withdrawal_proof},
+    };
+    auto it = endpoints.find(method);
+    if (it == endpoints.end()) {
+        throw std::out_of_range("Method not found");
+    }
+    return (this->*(it->second))(params);
+}
+
+json RollupAPI::handle_rpc_call(const json& call) {
+    const json id = call.is_object() && call.contains("id") ? call["id"] : json(nullptr);
+    if (!call.is_object() || call.value("jsonrpc", "") != "2.0" ||
+        !call.contains("method") || !call["method"].is_string()) {
+        return rpc_error(id, RPC_INVALID_REQUEST, "Invalid Request");
+    }
+    const json params = call.value("params", json::object());
+
+    APIResponse response;
+    try {
+        response = handle_request(call["method"].get<std::string>(), params);
+    } catch (const std::out_of_range&) {
+        return rpc_error(id, RPC_METHOD_NOT_FOUND, "Method not found");
+    } catch (const std::exception& e) {
+        return rpc_error(id, RPC_INVALID_PARAMS, e.what());
+    }
+    if (!response.success && response.retry_after.count() > 0) {
+        json error = rpc_error(id, RPC_OVERLOADED, response.error_message);
+        error["error"]["data"] = {{"retry_after_ms", response.retry_after.count()}};
+        return error;
+    }
+    if (!response.success) {
+        return rpc_error(id, RPC_INVALID_PARAMS, response.error_message);
+    }
+    return {{"jsonrpc", "2.0"}, {"id", id}, {"result", response.data}};
+}
+
+json RollupAPI::handle_rpc(const json& body) {
+    if (!body.is_array()) {
+        json response = handle_rpc_call(body);
+        const bool notification = body.is_object() && !body.contains("id") && !response.contains("error");
+        return notification ? json(nullptr) : response;
+    }
+    if (body.empty() || body.size() > config_.max_batch_size) {
+        return rpc_error(nullptr, RPC_INVALID_REQUEST, "Invalid Request");
+    }
+
+    // Calls in a batch are independent, so they run side by side and the
+    // replies keep the order of the calls
+    std::vector<json> responses(body.size());
+    utils::WorkStealingPool::global().parallel_for(0, body.size(), [&](size_t i) {
+        responses[i] = handle_rpc_call(body[i]);
+    });
+
+    json out = json::array();
+    for (size_t i = 0; i < responses.size(); ++i) {
+        const json& call = body[i];
+        if (call.is_object() && !call.contains("id") && !responses[i].contains("error")) {
+            continue;  // notification
+        }
+        out.push_back(std::move(responses[i]));
+    }
+    return out.empty() ? json(nullptr) : out;
+}
+
 APIResponse RollupAPI::get_account_balance(const json& params) {
     if (!validate_params(params, {"address"})) {
         return {false, nullptr, "Missing address parameter"};
     }
     
     try {
-        auto account = state_manager_->get_account(params["address"]);
-        return {true, {{"balance", account.balance}}, ""};
+        return {true, {{"balance", state_manager_->get_balance(params["address"])}}, ""};
     } catch (const std::exception& e) {
         return {false, nullptr, e.what()};
     }
 }
 
+void RollupAPI::set_block_archive(std::shared_ptr<storage::BlockArchive> archive) {
+    block_archive_ = std::move(archive);
+}
+
+APIResponse RollupAPI::get_block_by_number(const json& params) {
+    if (!validate_params(params, {"number"})) {
+        return {false, nullptr, "Missing number parameter"};
+    }
+    if (!block_archive_) {
+        return {false, nullptr, "Block archive not available"};
+    }
+
+    // Encoded straight from the mapped segment; nothing is deserialized
+    auto view = block_archive_->get(params["number"].get<uint64_t>());
+    if (!view) {
+        return {false, nullptr, "Block not found"};
+    }
+
+    json transactions = json::array();
+    for (size_t i = 0; i < view->transaction_count(); ++i) {
+        transactions.push_back(to_hex(view->transaction(i)));
+    }
+    return {true, {
+        {"number", view->block_number()},
+        {"data", to_hex(view->data())},
+        {"transactions", transactions}
+    }, ""};
+}
+
+void RollupAPI::set_history_indexer(std::shared_ptr<rollup::HistoryIndexer> indexer) {
+    history_indexer_ = std::move(indexer);
+}
+
+APIResponse RollupAPI::get_account_transactions(const json& params) {
+    if (!validate_params(params, {"address"})) {
+        return {false, nullptr, "Missing address parameter"};
+    }
+    if (!history_indexer_) {
+        return {false, nullptr, "Account history not available"};
+    }
+
+    // Pages are bounded whatever the client asks for
+    rollup::HistoryIndexer::Query query;
+    query.limit = std::min<size_t>(params.value("limit", size_t{100}), config_.max_history_page);
+    query.from_block = params.value("from_block", query.from_block);
+    query.to_block = params.value("to_block", query.to_block);
+    query.newest_first = params.value("order", std::string("desc")) != "asc";
+    if (params.contains("cursor")) {
+        // "<block>:<index>" of the last entry already seen
+        const std::string cursor = params["cursor"].get<std::string>();
+        const size_t colon = cursor.find(':');
+        if (colon == std::string::npos) {
+            return {false, nullptr, "Malformed cursor"};
+        }
+        try {
+            query.after = rollup::HistoryIndexer::Cursor{
+                std::stoull(cursor.substr(0, colon)),
+                static_cast<uint32_t>(std::stoul(cursor.substr(colon + 1)))};
+        } catch (const std::exception&) {
+            return {false, nullptr, "Malformed cursor"};
+        }
+    }
+
+    auto page = history_indexer_->query(params["address"].get<std::string>(), query);
+    json entries = json::array();
+    for (const auto& ref : page.entries) {
+        entries.push_back({
+            {"block_number", ref.block_number},
+            {"index", ref.index},
+            {"tx_hash", to_hex(ref.tx_hash)}
+        });
+    }
+    json data = {{"transactions", std::move(entries)}};
+    if (page.next) {
+        data["next_cursor"] = std::to_string(page.next->first) + ":" + std::to_string(page.next->second);
+    }
+    return {true, std::move(data), ""};
+}
+
+APIResponse RollupAPI::get_latest_block(const json&) {
+    if (!block_archive_) {
+        return {false, nullptr, "Block archive not available"};
+    }
+    auto last = block_archive_->last_block();
+    if (!last) {
+        return {false, nullptr, "Block not found"};
+    }
+    return get_block_by_number({{"number", *last}});
+}
+
+APIResponse RollupAPI::get_proof(const json& params) {
+    // Every account in one call is proven against the same snapshot, so
+    // writers carry on while the proofs are built
+    const auto view = state_manager_->snapshot();
+    const auto root = view.get_state_root();
+
+    if (params.contains("address")) {
+        const auto address = params["address"].get<std::string>();
+        auto account = view.get_account(address);
+        auto proof = account ? impl_->proofs.prove(view, address) : nullptr;
+        if (!proof) {
+            return {false, nullptr, "Account not found"};
+        }
+        json data = account_json(address, *account);
+        data["state_root"] = to_hex(root);
+        data["proof"] = proof_json(*proof);
+        return {true, std::move(data), ""};
+    }
+
+    if (!params.contains("addresses") || !params["addresses"].is_array()) {
+        return {false, nullptr, "Missing address parameter"};
+    }
+    if (params["addresses"].empty() || params["addresses"].size() > config_.max_proof_accounts) {
+        return {false, nullptr, "Too many addresses"};
+    }
+    // Many accounts share one multiproof, which carries each branch on
+    // their paths once
+    std::vector<std::string> addresses;
+    json accounts = json::array();
+    for (const auto& entry : params["addresses"]) {
+        addresses.push_back(entry.get<std::string>());
+        auto account = view.get_account(addresses.back());
+        if (!account) {
+            return {false, nullptr, "Account not found: " + addresses.back()};
+        }
+        accounts.push_back(account_json(addresses.back(), *account));
+    }
+    auto proof = view.prove_accounts(addresses);
+    if (!proof) {
+        return {false, nullptr, "Account not found"};
+    }
+    return {true, {
+        {"state_root", to_hex(root)},
+        {"accounts", std::move(accounts)},
+        {"multiproof", multiproof_json(*proof)}
+    }, ""};
+}
+
+namespace {
+
+// from, and optionally to (absent deploys), value, data as hex and gas
+std::optional<rollup::TransactionSimulator::Call> parse_call(const json& params) {
+    rollup::TransactionSimulator::Call call;
+    call.from = params["from"].get<std::string>();
+    call.to = params.value("to", std::string());
+    call.value = params.value("value", uint64_t{0});
+    call.gas_limit = params.value("gas", uint64_t{0});
+    if (params.contains("data")) {
+        auto data = from_hex(params["data"].get<std::string>());
+        if (!data) {
+            return std::nullopt;
+        }
+        call.data = std::move(*data);
+    }
+    return call;
+}
+
+} // namespace
+
+APIResponse RollupAPI::simulate_transaction(const json& params) {
+    if (!validate_params(params, {"from"})) {
+        return {false, nullptr, "Missing from parameter"};
+    }
+    const auto call = parse_call(params);
+    if (!call) {
+        return {false, nullptr, "Invalid data parameter"};
+    }
+    const auto result = impl_->simulator->simulate(*call);
+    return {true, simulation_json(*result), ""};
+}
+
+APIResponse RollupAPI::estimate_gas(const json& params) {
+    if (!validate_params(params, {"from"})) {
+        return {false, nullptr, "Missing from parameter"};
+    }
+    const auto call = parse_call(params);
+    if (!call) {
+        return {false, nullptr, "Invalid data parameter"};
+    }
+    const auto estimate = impl_->simulator->estimate_gas(*call);
+    if (estimate->gas == 0) {
+        // Fails however much gas it is given; report why
+        json data = simulation_json(estimate->result);
+        return {false, std::move(data), "Execution fails at the gas cap: " + data["status"].get<std::string>()};
+    }
+    json data = simulation_json(estimate->result);
+    data["gas"] = estimate->gas;
+    data["probes"] = estimate->probes;
+    return {true, std::move(data), ""};
+}
+
+void RollupAPI::on_new_block(uint64_t number, const json& header) {
+    impl_->cache.on_new_block();
+    json event = header;
+    event["number"] = number;
+    impl_->subscriptions.publish(SubscriptionHub::Topic::NewHeads, event);
+}
+
 APIResponse RollupAPI::initiate_deposit(const json& params) {
     if (!validate_params(params, {"l1_address", "l2_address", "amount"})) {
         return {false, nullptr, "Missing required parameters"};
@@ -167,6 +933,70 @@ APIResponse RollupAPI::initiate_deposit(const json& params) {
     return {true, {{"event_id", deposits.size()}}, ""};
 }
 
+void RollupAPI::set_withdrawal_batcher(std::shared_ptr<rollup::WithdrawalBatcher> batcher) {
+    withdrawal_batcher_ = std::move(batcher);
+}
+
+APIResponse RollupAPI::initiate_withdrawal(const json& params) {
+    if (!validate_params(params, {"l2_address", "l1_address", "amount"})) {
+        return {false, nullptr, "Missing required parameters"};
+    }
+    if (!withdrawal_batcher_) {
+        return {false, nullptr, "Withdrawals not available"};
+    }
+    const std::string l2_address = params["l2_address"].get<std::string>();
+    const uint64_t amount = params["amount"].get<uint64_t>();
+    if (amount == 0) {
+        return {false, nullptr, "Amount must be positive"};
+    }
+
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(impl_->withdrawal_mutex);
+        const uint64_t balance = state_manager_->get_balance(l2_address);
+        if (balance < amount || !state_manager_->set_balance(l2_address, balance - amount)) {
+            return {false, nullptr, "Insufficient balance"};
+        }
+        id = withdrawal_batcher_->enqueue(
+            l2_address, params["l1_address"].get<std::string>(), amount,
+            static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+    }
+    return {true, {{"withdrawal_id", id}, {"pending", withdrawal_batcher_->pending()}}, ""};
+}
+
+APIResponse RollupAPI::get_withdrawal_proof(const json& params) {
+    if (!validate_params(params, {"withdrawal_id"})) {
+        return {false, nullptr, "Missing withdrawal_id parameter"};
+    }
+    if (!withdrawal_batcher_) {
+        return {false, nullptr, "Withdrawals not available"};
+    }
+    const auto claim = withdrawal_batcher_->claim(params["withdrawal_id"].get<uint64_t>());
+    if (!claim) {
+        // Still queued, or its batch is no longer retained
+        return {false, nullptr, "Withdrawal not in a retained batch"};
+    }
+    const auto batch = withdrawal_batcher_->batch(claim->batch);
+    json siblings = json::array();
+    for (const auto& sibling : claim->proof.siblings) {
+        siblings.push_back(to_hex(sibling));
+    }
+    return {true, {
+        {"batch", claim->batch},
+        {"root", batch ? to_hex(batch->root) : std::string()},
+        {"withdrawal", {
+            {"id", claim->withdrawal.id},
+            {"l2_address", claim->withdrawal.l2_address},
+            {"l1_address", claim->withdrawal.l1_address},
+            {"amount", claim->withdrawal.amount},
+            {"timestamp", claim->withdrawal.timestamp}
+        }},
+        {"index", claim->proof.index},
+        {"leaf_count", claim->proof.leaf_count},
+        {"siblings", std::move(siblings)}
+    }, ""};
+}
+
 bool RollupAPI::validate_params(const json& params, const std::vector<std::string>& required) {
     for (const auto& param : required) {
         if (!params.contains(param)) {
@@ -174,4 +1004,7 @@ bool RollupAPI::validate_params(const json& params, const std::vector<std::strin
         }
     }
     return true;
-} 
\ No newline at end of file
+}
+
+} // namespace api
+} // namespace quids
@@ -0,0 +1,249 @@
+#include "api/SubmitPayload.hpp"
+#include "blockchain/TransactionView.hpp"
+#include <chrono>
+#include <limits>
+
+namespace quids {
+namespace api {
+
+namespace {
+
+class Scanner {
+public:
+    explicit Scanner(std::string_view in) : in_(in) {}
+
+    void skip_ws() {
+        while (pos_ < in_.size() &&
+               (in_[pos_] == ' ' || in_[pos_] == '\t' || in_[pos_] == '\n' || in_[pos_] == '\r')) {
+            ++pos_;
+        }
+    }
+
+    bool eat(char c) {
+        skip_ws();
+        if (pos_ < in_.size() && in_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    char peek() {
+        skip_ws();
+        return pos_ < in_.size() ? in_[pos_] : '\0';
+    }
+
+    bool at_end() {
+        skip_ws();
+        return pos_ == in_.size();
+    }
+
+    // A string without escapes; the view excludes the quotes
+    std::optional<std::string_view> string() {
+        if (!eat('"')) {
+            return std::nullopt;
+        }
+        const size_t start = pos_;
+        while (pos_ < in_.size() && in_[pos_] != '"') {
+            if (in_[pos_] == '\\' || static_cast<unsigned char>(in_[pos_]) < 0x20) {
+                return std::nullopt;
+            }
+            ++pos_;
+        }
+        if (pos_ == in_.size()) {
+            return std::nullopt;
+        }
+        return in_.substr(start, pos_++ - start);
+    }
+
+    // Digits up to the next delimiter
+    std::string_view bare() {
+        skip_ws();
+        const size_t start = pos_;
+        while (pos_ < in_.size() && in_[pos_] != ',' && in_[pos_] != '}' &&
+               in_[pos_] != ' ' && in_[pos_] != '\t' && in_[pos_] != '\n' && in_[pos_] != '\r') {
+            ++pos_;
+        }
+        return in_.substr(start, pos_ - start);
+    }
+
+private:
+    std::string_view in_;
+    size_t pos_{0};
+};
+
+std::optional<uint64_t> to_u64(std::string_view digits) {
+    if (digits.empty() || digits.size() > 20) {
+        return std::nullopt;
+    }
+    uint64_t v = 0;
+    for (char c : digits) {
+        if (c < '0' || c > '9') {
+            return std::nullopt;
+        }
+        const uint64_t d = static_cast<uint64_t>(c - '0');
+        if (v > (std::numeric_limits<uint64_t>::max() - d) / 10) {
+            return std::nullopt;
+        }
+        v = v * 10 + d;
+    }
+    return v;
+}
+
+int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool append_hex(std::string_view hex, blockchain::ByteVector& out) {
+    if (hex.size() >= 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X')) {
+        hex.remove_prefix(2);
+    }
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        const int hi = hex_nibble(hex[i]);
+        const int lo = hex_nibble(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out.push_back(static_cast<uint8_t>((hi << 4) | lo));
+    }
+    return true;
+}
+
+void store(blockchain::ByteVector& out, uint64_t v, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+} // namespace
+
+std::optional<SubmitPayload> scan_submit_payload(std::string_view body) noexcept {
+    Scanner in(body);
+    SubmitPayload payload;
+    if (!in.eat('{')) {
+        return std::nullopt;
+    }
+    if (in.eat('}')) {
+        return in.at_end() ? std::optional<SubmitPayload>(payload) : std::nullopt;
+    }
+
+    do {
+        auto key = in.string();
+        if (!key || !in.eat(':')) {
+            return std::nullopt;
+        }
+        std::string_view value;
+        const bool quoted = in.peek() == '"';
+        if (quoted) {
+            auto s = in.string();
+            if (!s) {
+                return std::nullopt;
+            }
+            value = *s;
+        } else if (in.peek() == '{' || in.peek() == '[') {
+            return std::nullopt;
+        } else {
+            value = in.bare();
+            if (value.empty()) {
+                return std::nullopt;
+            }
+        }
+
+        auto number = [&](uint64_t& field) {
+            auto v = to_u64(value);
+            if (v) {
+                field = *v;
+            }
+            return v.has_value();
+        };
+        auto text = [&](std::string_view& field) {
+            field = value;
+            return quoted;
+        };
+
+        bool ok = true;
+        if (*key == "sender") {
+            ok = text(payload.sender);
+        } else if (*key == "recipient") {
+            ok = text(payload.recipient);
+        } else if (*key == "signature") {
+            ok = text(payload.signature);
+        } else if (*key == "data") {
+            ok = text(payload.data);
+        } else if (*key == "raw") {
+            ok = text(payload.raw);
+        } else if (*key == "amount") {
+            ok = payload.has_amount = number(payload.amount);
+        } else if (*key == "nonce") {
+            ok = number(payload.nonce);
+        } else if (*key == "gas_cost") {
+            ok = number(payload.gas_cost);
+        } else if (*key == "timestamp") {
+            uint64_t ts = 0;
+            ok = number(ts) && ts <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+            payload.timestamp = static_cast<int64_t>(ts);
+        } else if (!quoted && value != "true" && value != "false" && value != "null" &&
+                   !to_u64(value)) {
+            // Unknown keys are skipped, but only over values we can delimit
+            ok = false;
+        }
+        if (!ok) {
+            return std::nullopt;
+        }
+    } while (in.eat(','));
+
+    if (!in.eat('}') || !in.at_end()) {
+        return std::nullopt;
+    }
+    return payload;
+}
+
+std::optional<blockchain::ByteVector> encode_submit_payload(const SubmitPayload& payload) {
+    blockchain::ByteVector out;
+    if (!payload.raw.empty()) {
+        if (!append_hex(payload.raw, out) || !blockchain::TransactionView::parse(out)) {
+            return std::nullopt;
+        }
+        return out;
+    }
+    if (payload.sender.empty() || payload.recipient.empty() || !payload.has_amount ||
+        payload.signature.empty() ||
+        payload.sender.size() > std::numeric_limits<uint16_t>::max() ||
+        payload.recipient.size() > std::numeric_limits<uint16_t>::max()) {
+        return std::nullopt;
+    }
+
+    blockchain::ByteVector data;
+    blockchain::ByteVector signature;
+    if (!append_hex(payload.data, data) || data.size() > std::numeric_limits<uint32_t>::max() ||
+        !append_hex(payload.signature, signature) || signature.size() != blockchain::wire::SIGNATURE_SIZE) {
+        return std::nullopt;
+    }
+    const int64_t timestamp = payload.timestamp.value_or(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+
+    out.reserve(blockchain::wire::MIN_SIZE + payload.sender.size() + payload.recipient.size() + data.size());
+    out.push_back(blockchain::wire::VERSION);
+    store(out, static_cast<uint64_t>(timestamp), sizeof(uint64_t));
+    store(out, payload.amount, sizeof(uint64_t));
+    store(out, payload.nonce, sizeof(uint64_t));
+    store(out, payload.gas_cost, sizeof(uint64_t));
+    store(out, payload.sender.size(), sizeof(uint16_t));
+    store(out, payload.recipient.size(), sizeof(uint16_t));
+    store(out, data.size(), sizeof(uint32_t));
+    out.insert(out.end(), payload.sender.begin(), payload.sender.end());
+    out.insert(out.end(), payload.recipient.begin(), payload.recipient.end());
+    out.insert(out.end(), data.begin(), data.end());
+    out.insert(out.end(), signature.begin(), signature.end());
+    return out;
+}
+
+} // namespace api
+} // namespace quids
@@ -0,0 +1,116 @@
+#include "api/SubscriptionHub.hpp"
+#include <algorithm>
+
+namespace quids {
+namespace api {
+
+std::optional<std::vector<SubscriptionHub::Frame>> SubscriptionHub::Subscription::wait(
+    std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_.wait_for(lock, timeout, [this] { return closed_ || !queue_.empty(); });
+    if (closed_) {
+        return std::nullopt;
+    }
+    std::vector<Frame> frames(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.end()));
+    queue_.clear();
+    return frames;
+}
+
+void SubscriptionHub::Subscription::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        queue_.clear();
+    }
+    ready_.notify_all();
+}
+
+bool SubscriptionHub::Subscription::closed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return closed_;
+}
+
+SubscriptionHub::~SubscriptionHub() {
+    close_all();
+}
+
+std::optional<SubscriptionHub::Topic> SubscriptionHub::parse_topic(std::string_view name) {
+    if (name == "newHeads") return Topic::NewHeads;
+    if (name == "pendingTx") return Topic::PendingTx;
+    return std::nullopt;
+}
+
+std::shared_ptr<SubscriptionHub::Subscription> SubscriptionHub::subscribe(const std::vector<Topic>& topics) {
+    uint8_t mask = 0;
+    for (Topic topic : topics) {
+        mask |= static_cast<uint8_t>(topic);
+    }
+    std::shared_ptr<Subscription> subscription(new Subscription(mask));
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_.push_back(subscription);
+    return subscription;
+}
+
+void SubscriptionHub::publish(Topic topic, const nlohmann::json& event) {
+    const char* name = topic == Topic::NewHeads ? "newHeads" : "pendingTx";
+    auto frame = std::make_shared<const std::string>(
+        std::string("event: ") + name + "\ndata: " + event.dump() + "\n\n");
+
+    std::vector<std::shared_ptr<Subscription>> targets;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Subscriptions whose client went away are dropped on the way
+        auto live = std::remove_if(subscribers_.begin(), subscribers_.end(), [&](const auto& weak) {
+            auto subscription = weak.lock();
+            if (!subscription) {
+                return true;
+            }
+            if (subscription->topics_ & static_cast<uint8_t>(topic)) {
+                targets.push_back(std::move(subscription));
+            }
+            return false;
+        });
+        subscribers_.erase(live, subscribers_.end());
+    }
+
+    for (const auto& subscription : targets) {
+        bool lagging = false;
+        {
+            std::lock_guard<std::mutex> lock(subscription->mutex_);
+            if (subscription->closed_) {
+                continue;
+            }
+            lagging = subscription->queue_.size() >= max_queued_;
+            if (!lagging) {
+                subscription->queue_.push_back(frame);
+            }
+        }
+        if (lagging) {
+            subscription->close();
+        } else {
+            subscription->ready_.notify_one();
+        }
+    }
+}
+
+void SubscriptionHub::close_all() {
+    std::vector<std::weak_ptr<Subscription>> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers.swap(subscribers_);
+    }
+    for (const auto& weak : subscribers) {
+        if (auto subscription = weak.lock()) {
+            subscription->close();
+        }
+    }
+}
+
+size_t SubscriptionHub::subscriber_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<size_t>(std::count_if(subscribers_.begin(), subscribers_.end(),
+                                             [](const auto& weak) { return !weak.expired(); }));
+}
+
+} // namespace api
+} // namespace quids
@@ -5,8 +5,10 @@
 #include <stdexcept>
 #include <algorithm>
 #include <string>
+#include <utility>
 #include "blockchain/AIBlock.hpp"
 #include "blockchain/Types.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
 
 namespace quids::blockchain {
 
@@ -50,6 +52,8 @@ namespace quids::blockchain {
             }
         };
 
+        [[nodiscard]] size_t maxTransactions() const noexcept { return metrics_.maxTransactions; }
+
         explicit Impl(const AIBlockConfig& config)
         try : metrics_(config)  // Use constructor instead of aggregate initialization
                 , lastUpdateTime_(std::chrono::steady_clock::now())
@@ -102,4 +106,28 @@ namespace quids::blockchain {
         bool isInitialized_;
     };
 
+    bool AIBlock::addTransaction(TransactionPtr tx) {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        if (!tx || transactions_.size() >= impl_->maxTransactions()) {
+            return false;
+        }
+        appendTransaction(::std::move(tx));
+        cachedMerkleRoot_.reset();
+        cachedHash_.reset();
+        return true;
+    }
+
+    void AIBlock::computeMerkleRoot() {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        crypto::MerkleBuilder builder;
+        // Hashes were taken as the transactions came in
+        builder.appendParallel(transactionHashes_.size(), [this](size_t i) {
+            return crypto::MerkleBuilder::toHash(transactionHashes_[i]);
+        });
+        const auto root = builder.root();
+        merkleRoot_ = root;
+        cachedMerkleRoot_ = merkleRoot_;
+        cachedHash_.reset();
+    }
+
 } // namespace quids::blockchain
@@ -1,8 +1,6 @@
 #include "blockchain/AddressManager.hpp"
 #include "../include/blockchain/Address.hpp"
 #include <blake3.h>
-#include <sstream>
-#include <iomanip>
 #include <nlohmann/json.hpp>
 #include "zkp/QZKPGenerator.hpp"
 #include "quantum/QuantumState.hpp"
@@ -11,11 +9,92 @@
 #include <stdexcept>
 #include <chrono>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include "utils/FlatHashMap.hpp"
+#include "utils/Hex.hpp"
+#include "utils/Int128.hpp"
+#include <openssl/rand.h>
 
 namespace quids::blockchain {
 
+namespace {
+
+constexpr size_t ACCOUNT_SHARDS = 64;
+
+// Addresses are often sequential or zero-padded, so mix all 32 bytes
+uint64_t mixAccountKey(const AddressManager::AccountKey& key) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < key.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, key.data() + i, sizeof(word));
+        h = (h ^ word) * 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+struct AccountKeyHash {
+    size_t operator()(const AddressManager::AccountKey& key) const noexcept {
+        return static_cast<size_t>(mixAccountKey(key));
+    }
+};
+
+} // namespace
+
 struct AddressManager::Impl {
-    std::unordered_map<std::string, Account> accounts;
+    // Balance and nonce change under the shard's shared lock; everything
+    // else about an entry, and the table itself, under its exclusive lock
+    struct AccountEntry {
+        std::string address;
+        std::atomic<uint64_t> balance{0};
+        std::atomic<uint64_t> nonce{0};
+        std::vector<uint8_t> code;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        utils::FlatHashMap<AccountKey, std::unique_ptr<AccountEntry>, AccountKeyHash> accounts;
+    };
+
+    size_t shardOf(const AccountKey& key) const {
+        return static_cast<size_t>(mixAccountKey(key) >> 58) % ACCOUNT_SHARDS;
+    }
+
+    // Caller holds the shard lock
+    AccountEntry* find(const AccountKey& key) const {
+        auto* slot = shards[shardOf(key)].accounts.find(key);
+        return slot ? slot->get() : nullptr;
+    }
+
+    bool create(const AccountKey& key, const std::string& address, uint64_t balance, std::vector<uint8_t> code) {
+        auto& shard = shards[shardOf(key)];
+        std::unique_lock lock(shard.mutex);
+        auto [slot, inserted] = shard.accounts.try_emplace(key);
+        if (!inserted) {
+            return false;
+        }
+        *slot = std::make_unique<AccountEntry>();
+        (*slot)->address = address;
+        (*slot)->balance.store(balance, std::memory_order_relaxed);
+        (*slot)->code = std::move(code);
+        return true;
+    }
+
+    // fn(entry) under the key's shard lock; fallback when there is no account
+    template<typename Lock, typename R, typename Fn>
+    R with(const AccountKey& key, R fallback, Fn fn) const {
+        auto& shard = shards[shardOf(key)];
+        Lock lock(shard.mutex);
+        auto* entry = find(key);
+        return entry ? fn(*entry) : fallback;
+    }
+
+    std::array<Shard, ACCOUNT_SHARDS> shards;
+
+    std::mutex states_mutex;  // quantum_states and stored_proofs
     std::unordered_map<std::string, quantum::QuantumState> quantum_states;
     std::unordered_map<std::string, zkp::QZKPGenerator::Proof> stored_proofs;
     zkp::QZKPGenerator qzkp;
@@ -77,9 +156,10 @@ std::optional<std::string> AddressManager::generateAddress(
 }
 
 bool AddressManager::verifyAddress(const std::string& address) {
-    // 1. Check basic format requirements
-    if (address.length() != ADDRESS_LENGTH || 
-        !address.starts_with(ADDRESS_PREFIX)) {
+    // 1. Check format in one pass before decoding anything
+    const std::string_view prefix(ADDRESS_PREFIX);
+    if (address.length() != ADDRESS_LENGTH || !address.starts_with(prefix) ||
+        !utils::isHex(std::string_view(address).substr(prefix.size()))) {
         return false;
     }
 
@@ -97,18 +177,7 @@ bool AddressManager::verifyAddress(const std::string& address) {
     }
 
     // 4. Validate purpose string
-    if (components->purpose != "EOA" && 
-        components->purpose != "CONTRACT") {
-        return false;
-    }
-
-    // 5. Verify hex encoding after prefix
-    std::string hex_part = address.substr(strlen(ADDRESS_PREFIX));
-    if (!std::all_of(hex_part.begin(), hex_part.end(), ::isxdigit)) {
-        return false;
-    }
-
-    return true;
+    return components->purpose == "EOA" || components->purpose == "CONTRACT";
 }
 
 bool AddressManager::verifyLocation(
@@ -124,73 +193,131 @@ bool AddressManager::verifyLocation(
     return computed_hash == components->location_hash;
 }
 
+namespace {
+
+constexpr uint64_t P = AddressManager::FIELD_PRIME;
+
+// x mod 2^61 - 1 by folding the high bits onto the low ones; x < 2^127
+uint64_t fieldReduce(utils::u128 x) {
+    x = (x & P) + (x >> 61);
+    const auto r = static_cast<uint64_t>((x & P) + (x >> 61));
+    return r >= P ? r - P : r;
+}
+
+uint64_t fieldMul(uint64_t a, uint64_t b) {
+    return fieldReduce(static_cast<utils::u128>(a) * b);
+}
+
+uint64_t fieldSub(uint64_t a, uint64_t b) {
+    return a >= b ? a - b : a + P - b;
+}
+
+uint64_t fieldInverse(uint64_t a) {
+    // Fermat: a^(p-2)
+    uint64_t result = 1;
+    uint64_t base = a;
+    for (uint64_t e = P - 2; e; e >>= 1) {
+        if (e & 1) result = fieldMul(result, base);
+        base = fieldMul(base, base);
+    }
+    return result;
+}
+
+// Signed fixed point, negatives as p - |v|
+uint64_t encodeFixed(double value) {
+    const double scaled = std::round(value * AddressManager::SHARE_SCALE);
+    if (!std::isfinite(scaled) || std::abs(scaled) >= static_cast<double>(P / 2)) {
+        throw std::invalid_argument("Location component out of range");
+    }
+    const auto q = static_cast<int64_t>(scaled);
+    return q >= 0 ? static_cast<uint64_t>(q) : P - static_cast<uint64_t>(-q);
+}
+
+double decodeFixed(uint64_t value) {
+    const double magnitude = value > P / 2 ? -static_cast<double>(P - value) : static_cast<double>(value);
+    return magnitude / AddressManager::SHARE_SCALE;
+}
+
+} // namespace
+
 AddressManager::VSSScheme AddressManager::generateShares(
     const LocationData& location,
     size_t num_shares,
     size_t threshold
+) {
+    return std::move(generateSharesBatch(std::span<const LocationData>(&location, 1), num_shares, threshold).front());
+}
+
+std::vector<AddressManager::VSSScheme> AddressManager::generateSharesBatch(
+    std::span<const LocationData> locations,
+    size_t num_shares,
+    size_t threshold
 ) {
     try {
-        if (num_shares < MIN_SHARES || num_shares > MAX_SHARES || threshold > num_shares) {
+        if (num_shares < MIN_SHARES || num_shares > MAX_SHARES || threshold == 0 || threshold > num_shares) {
             spdlog::error("Invalid VSS parameters: shares={}, threshold={}", num_shares, threshold);
             throw std::invalid_argument("Invalid share parameters");
         }
 
-        // Convert location to quantum state vector
-        auto location_vector = createLocationVector(location);
-        if (location_vector.size() != LOCATION_VECTOR_SIZE) {
-            spdlog::error("Invalid location vector size: {}", location_vector.size());
-            throw std::runtime_error("Invalid location vector");
-        }
-
-        quantum::QuantumState state(LOCATION_VECTOR_SIZE);
-        try {
-            for (size_t i = 0; i < location_vector.size(); i++) {
-                state.setAmplitude(i, std::complex<double>(location_vector[i], 0.0));
+        // powers[i][k] = (i + 1)^k, shared by every polynomial in the batch
+        std::array<std::array<uint64_t, MAX_SHARES>, MAX_SHARES> powers{};
+        for (size_t i = 0; i < num_shares; i++) {
+            powers[i][0] = 1;
+            for (size_t k = 1; k < threshold; k++) {
+                powers[i][k] = fieldMul(powers[i][k - 1], i + 1);
             }
-        } catch (const std::exception& e) {
-            spdlog::error("Failed to set quantum state: {}", e.what());
-            throw;
         }
 
-        // Create polynomial coefficients
-        std::vector<double> coefficients(POLYNOMIAL_DEGREE);
-        coefficients[0] = location_vector[0]; // x-coordinate
-        coefficients[1] = location_vector[1]; // y-coordinate
-        
-        // Generate random coefficients for higher degrees
-        std::random_device rd;
-        std::mt19937_64 gen(rd());
-        std::uniform_real_distribution<double> dist(-1.0, 1.0);
-        
-        for (size_t i = 2; i < POLYNOMIAL_DEGREE; i++) {
-            coefficients[i] = dist(gen);
+        // Random higher coefficients for every polynomial, drawn at once
+        const size_t per_component = threshold - 1;
+        std::vector<uint64_t> randomness(locations.size() * LOCATION_VECTOR_SIZE * per_component);
+        if (!randomness.empty() &&
+            RAND_bytes(reinterpret_cast<unsigned char*>(randomness.data()),
+                       static_cast<int>(randomness.size() * sizeof(uint64_t))) != 1) {
+            throw std::runtime_error("Failed to draw share coefficients");
         }
 
-        // Create polynomial
-        auto polynomial = createPolynomial(coefficients, threshold - 1);
-
-        // Generate shares
-        VSSScheme scheme;
-        scheme.threshold = threshold;
-        scheme.shares.reserve(num_shares);
-
-        for (size_t i = 1; i <= num_shares; i++) {
-            std::complex<double> x(static_cast<double>(i), 0.0);
-            auto share_data = evaluatePolynomial(polynomial, x);
-            
-            VSSShare share;
-            share.data = share_data;
-            share.index = i;
-            share.commitment = computeShareCommitment(share_data);
-            
-            scheme.shares.push_back(share);
-        }
+        std::vector<VSSScheme> schemes(locations.size());
+        for (size_t l = 0; l < locations.size(); l++) {
+            auto location_vector = createLocationVector(locations[l]);
+
+            // coefficients[c][k], constant term first
+            std::array<std::array<uint64_t, MAX_SHARES>, LOCATION_VECTOR_SIZE> coefficients{};
+            for (size_t c = 0; c < LOCATION_VECTOR_SIZE; c++) {
+                coefficients[c][0] = encodeFixed(location_vector[c]);
+                const uint64_t* draw = randomness.data() + (l * LOCATION_VECTOR_SIZE + c) * per_component;
+                for (size_t k = 1; k < threshold; k++) {
+                    coefficients[c][k] = fieldReduce(draw[k - 1] & P);
+                }
+            }
 
-        // Compute root commitment
-        scheme.root_commitment = computeShareCommitment(polynomial);
+            auto& scheme = schemes[l];
+            scheme.threshold = threshold;
+            scheme.shares.resize(num_shares);
+            blake3_hasher root;
+            blake3_hasher_init(&root);
+            for (size_t i = 0; i < num_shares; i++) {
+                auto& share = scheme.shares[i];
+                share.index = i + 1;
+                for (size_t c = 0; c < LOCATION_VECTOR_SIZE; c++) {
+                    // Products are below 2^122, so a share's sum fits unreduced
+                    utils::u128 sum = 0;
+                    for (size_t k = 0; k < threshold; k++) {
+                        sum += static_cast<utils::u128>(coefficients[c][k]) * powers[i][k];
+                    }
+                    share.data[c] = fieldReduce(sum);
+                }
+                share.commitment = computeShareCommitment(share.data);
+                blake3_hasher_update(&root, share.commitment.data(), share.commitment.size());
+            }
 
-        spdlog::debug("Generated {} shares with threshold {}", num_shares, threshold);
-        return scheme;
+            // Over the share commitments in index order, so it binds the
+            // shares without hashing the location itself
+            blake3_hasher_finalize(&root, scheme.root_commitment.data(), scheme.root_commitment.size());
+        }
+
+        spdlog::debug("Generated {} schemes of {} shares with threshold {}", schemes.size(), num_shares, threshold);
+        return schemes;
     } catch (const std::exception& e) {
         spdlog::error("Failed to generate shares: {}", e.what());
         throw;
@@ -202,14 +329,13 @@ bool AddressManager::verifyShare(
     const std::array<uint8_t, 32>& root_commitment
 ) {
     try {
-        // Validate share data
-        if (share.data.empty() || share.data.size() != LOCATION_VECTOR_SIZE) {
-            spdlog::error("Invalid share data size: {}", share.data.size());
+        if (share.index == 0) {
+            spdlog::error("Invalid share index: 0");
             return false;
         }
 
-        if (share.index == 0) {
-            spdlog::error("Invalid share index: 0");
+        if (std::any_of(share.data.begin(), share.data.end(), [](uint64_t v) { return v >= P; })) {
+            spdlog::error("Share value outside the field");
             return false;
         }
 
@@ -223,163 +349,168 @@ bool AddressManager::verifyShare(
         // Verify against root commitment using quantum state verification
         quantum::QuantumState share_state(share.data.size());
         for (size_t i = 0; i < share.data.size(); i++) {
-            share_state.setAmplitude(i, share.data[i]);
+            share_state.setAmplitude(i, std::complex<double>(decodeFixed(share.data[i]), 0.0));
         }
 
         // Use QZKP to verify the share against root commitment
         zkp::QZKPGenerator qzkp;
         return qzkp.verify_share(share_state, root_commitment);
-
-        spdlog::debug("Share {} verified successfully", share.index);
-        return true;
     } catch (const std::exception& e) {
         spdlog::error("Share verification failed: {}", e.what());
         return false;
     }
 }
 
-std::optional<AddressManager::LocationData> AddressManager::reconstructLocation(
-    const std::vector<VSSShare>& shares,
-    size_t threshold
+std::optional<AddressManager::LagrangeCoefficients> AddressManager::lagrangeCoefficients(
+    std::span<const size_t> indices
 ) {
-    try {
-        if (shares.empty()) {
-            spdlog::error("Empty shares vector");
-            return std::nullopt;
-        }
+    if (indices.empty() || indices.size() > MAX_SHARES) {
+        return std::nullopt;
+    }
 
-        if (shares.size() < threshold) {
-            spdlog::error("Insufficient shares: {} < {}", shares.size(), threshold);
+    LagrangeCoefficients result;
+    result.count = indices.size();
+    std::array<uint64_t, MAX_SHARES> numerators{};
+    std::array<uint64_t, MAX_SHARES> denominators{};
+    for (size_t i = 0; i < indices.size(); i++) {
+        if (indices[i] == 0 || indices[i] >= P) {
             return std::nullopt;
         }
-
-        // Validate share data consistency
-        for (const auto& share : shares) {
-            if (share.data.size() != LOCATION_VECTOR_SIZE) {
-                spdlog::error("Invalid share data size: {}", share.data.size());
+        result.indices[i] = indices[i];
+        numerators[i] = 1;
+        denominators[i] = 1;
+        for (size_t j = 0; j < indices.size(); j++) {
+            if (i == j) continue;
+            if (indices[i] == indices[j]) {
                 return std::nullopt;
             }
+            // lambda_i = prod x_j / (x_j - x_i)
+            numerators[i] = fieldMul(numerators[i], indices[j]);
+            denominators[i] = fieldMul(denominators[i], fieldSub(indices[j], indices[i]));
         }
+    }
 
-        // Use Lagrange interpolation to reconstruct the secret
-        std::vector<std::complex<double>> reconstructed(LOCATION_VECTOR_SIZE);
-        
-        for (size_t i = 0; i < threshold; i++) {
-            std::complex<double> lagrange_basis(1.0, 0.0);
-            
-            for (size_t j = 0; j < threshold; j++) {
-                if (i != j) {
-                    std::complex<double> numerator(-static_cast<double>(shares[j].index), 0.0);
-                    std::complex<double> denominator(
-                        static_cast<double>(shares[i].index - shares[j].index), 0.0
-                    );
-                    lagrange_basis *= numerator / denominator;
-                }
-            }
-
-            for (size_t k = 0; k < LOCATION_VECTOR_SIZE; k++) {
-                reconstructed[k] += shares[i].data[k] * lagrange_basis;
-            }
-        }
-
-        // Convert reconstructed values back to LocationData
-        LocationData location;
-        location.latitude = std::real(reconstructed[0]);
-        location.longitude = std::real(reconstructed[1]);
-        
-        // Verify reconstruction using quantum state comparison
-        quantum::QuantumState reconstructed_state(LOCATION_VECTOR_SIZE);
-        for (size_t i = 0; i < reconstructed.size(); i++) {
-            reconstructed_state.setAmplitude(i, reconstructed[i]);
-        }
+    // Invert every denominator with one exponentiation
+    std::array<uint64_t, MAX_SHARES> prefix{};
+    uint64_t running = 1;
+    for (size_t i = 0; i < result.count; i++) {
+        prefix[i] = running;
+        running = fieldMul(running, denominators[i]);
+    }
+    uint64_t inverse = fieldInverse(running);
+    for (size_t i = result.count; i-- > 0;) {
+        result.weights[i] = fieldMul(numerators[i], fieldMul(inverse, prefix[i]));
+        inverse = fieldMul(inverse, denominators[i]);
+    }
+    return result;
+}
 
-        if (!reconstructed_state.isValid()) {
-            return std::nullopt;
-        }
+std::optional<AddressManager::LocationData> AddressManager::reconstructLocation(
+    const std::vector<VSSShare>& shares,
+    size_t threshold
+) {
+    if (shares.empty() || threshold == 0) {
+        spdlog::error("Empty shares vector");
+        return std::nullopt;
+    }
 
-        // Additional validation of reconstructed location
-        if (std::isnan(location.latitude) || std::isnan(location.longitude) ||
-            std::abs(location.latitude) > 90.0 || std::abs(location.longitude) > 180.0) {
-            spdlog::error("Invalid reconstructed coordinates: lat={}, lon={}", 
-                location.latitude, location.longitude);
-            return std::nullopt;
-        }
+    if (shares.size() < threshold) {
+        spdlog::error("Insufficient shares: {} < {}", shares.size(), threshold);
+        return std::nullopt;
+    }
 
-        spdlog::debug("Location reconstructed successfully from {} shares", shares.size());
-        return location;
-    } catch (const std::exception& e) {
-        spdlog::error("Location reconstruction failed: {}", e.what());
+    std::array<size_t, MAX_SHARES> indices{};
+    const size_t count = std::min(threshold, MAX_SHARES);
+    for (size_t i = 0; i < count; i++) {
+        indices[i] = shares[i].index;
+    }
+    const auto coefficients = lagrangeCoefficients(std::span<const size_t>(indices.data(), count));
+    if (!coefficients) {
+        spdlog::error("Invalid share indices");
         return std::nullopt;
     }
+    return reconstructLocation(std::span<const VSSShare>(shares.data(), count), *coefficients);
 }
 
-// Helper methods implementation
-std::vector<std::complex<double>> AddressManager::createPolynomial(
-    const std::vector<double>& coefficients,
-    size_t degree
+std::optional<AddressManager::LocationData> AddressManager::reconstructLocation(
+    std::span<const VSSShare> shares,
+    const LagrangeCoefficients& coefficients
 ) {
-    std::vector<std::complex<double>> poly(degree + 1);
-    for (size_t i = 0; i <= degree && i < coefficients.size(); i++) {
-        poly[i] = std::complex<double>(coefficients[i], 0.0);
+    if (shares.size() != coefficients.count) {
+        spdlog::error("Expected {} shares, got {}", coefficients.count, shares.size());
+        return std::nullopt;
     }
-    return poly;
-}
 
-std::vector<std::complex<double>> AddressManager::evaluatePolynomial(
-    const std::vector<std::complex<double>>& poly,
-    std::complex<double> x
-) {
-    std::vector<std::complex<double>> result(LOCATION_VECTOR_SIZE);
-    std::complex<double> x_power(1.0, 0.0);
-    
-    for (const auto& coeff : poly) {
-        for (size_t i = 0; i < LOCATION_VECTOR_SIZE; i++) {
-            result[i] += coeff * x_power;
+    std::array<uint64_t, LOCATION_VECTOR_SIZE> reconstructed{};
+    for (size_t c = 0; c < LOCATION_VECTOR_SIZE; c++) {
+        utils::u128 sum = 0;
+        for (size_t i = 0; i < shares.size(); i++) {
+            if (shares[i].index != coefficients.indices[i]) {
+                spdlog::error("Share {} does not match the coefficients", shares[i].index);
+                return std::nullopt;
+            }
+            sum += static_cast<utils::u128>(coefficients.weights[i]) * shares[i].data[c];
         }
-        x_power *= x;
+        reconstructed[c] = fieldReduce(sum);
     }
-    
-    return result;
+
+    LocationData location;
+    location.latitude = decodeFixed(reconstructed[0]);
+    location.longitude = decodeFixed(reconstructed[1]);
+
+    // Additional validation of reconstructed location
+    if (std::abs(location.latitude) > 90.0 || std::abs(location.longitude) > 180.0) {
+        spdlog::error("Invalid reconstructed coordinates: lat={}, lon={}",
+            location.latitude, location.longitude);
+        return std::nullopt;
+    }
+
+    spdlog::debug("Location reconstructed successfully from {} shares", shares.size());
+    return location;
 }
 
-std::array<uint8_t, 32> AddressManager::computeShareCommitment(
-    const std::vector<std::complex<double>>& share_data
-) {
+std::array<uint8_t, 32> AddressManager::computeShareCommitment(std::span<const uint64_t> share_data) {
     std::array<uint8_t, 32> commitment;
     blake3_hasher hasher;
     blake3_hasher_init(&hasher);
 
-    // Hash real and imaginary parts of each complex number
-    for (const auto& value : share_data) {
-        double real_part = std::real(value);
-        double imag_part = std::imag(value);
-        blake3_hasher_update(&hasher, &real_part, sizeof(double));
-        blake3_hasher_update(&hasher, &imag_part, sizeof(double));
+    // Each value as 8 little-endian bytes
+    for (const uint64_t value : share_data) {
+        std::array<uint8_t, 8> bytes;
+        for (size_t i = 0; i < bytes.size(); i++) {
+            bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+        blake3_hasher_update(&hasher, bytes.data(), bytes.size());
     }
 
     blake3_hasher_finalize(&hasher, commitment.data(), commitment.size());
     return commitment;
 }
 
-// Convert complex vector to bytes
-std::vector<uint8_t> serialize_complex_vector(const std::vector<std::complex<double>>& vec) {
-    std::vector<uint8_t> bytes;
-    bytes.reserve(vec.size() * sizeof(std::complex<double>));
-    
-    for (const auto& c : vec) {
-        const uint8_t* data = reinterpret_cast<const uint8_t*>(&c);
-        bytes.insert(bytes.end(), data, data + sizeof(std::complex<double>));
+std::optional<AddressManager::AccountKey> AddressManager::accountKey(std::string_view address) {
+    if (address.starts_with(ADDRESS_PREFIX)) {
+        address.remove_prefix(std::string_view(ADDRESS_PREFIX).size());
+    } else if (address.starts_with("0x")) {
+        address.remove_prefix(2);
     }
-    
-    return bytes;
+    if (address.empty() || address.size() > 64 || address.size() % 2 != 0) {
+        return std::nullopt;
+    }
+
+    AccountKey key{};
+    if (!utils::hexDecode(address, key.data() + key.size() - address.size() / 2)) {
+        return std::nullopt;
+    }
+    return key;
 }
 
 bool AddressManager::create_account(const std::string& address, uint64_t initial_balance) {
-    if (impl_->accounts.find(address) != impl_->accounts.end()) {
-        return false;
-    }
-    impl_->accounts.emplace(address, Account(address, initial_balance));
-    return true;
+    const auto key = accountKey(address);
+    return key && create_account(*key, address, initial_balance);
+}
+
+bool AddressManager::create_account(const AccountKey& key, const std::string& address, uint64_t initial_balance) {
+    return impl_->create(key, address, initial_balance, {});
 }
 
 bool AddressManager::create_contract_account(
@@ -387,95 +518,133 @@ bool AddressManager::create_contract_account(
     const std::vector<uint8_t>& code,
     uint64_t initial_balance
 ) {
-    if (impl_->accounts.find(address) != impl_->accounts.end()) {
-        return false;
-    }
-    impl_->accounts.emplace(address, Account(address, code, initial_balance));
-    return true;
+    const auto key = accountKey(address);
+    return key && impl_->create(*key, address, initial_balance, code);
 }
 
 bool AddressManager::delete_account(const std::string& address) {
-    return impl_->accounts.erase(address) > 0;
+    const auto key = accountKey(address);
+    if (!key) {
+        return false;
+    }
+    auto& shard = impl_->shards[impl_->shardOf(*key)];
+    std::unique_lock lock(shard.mutex);
+    return shard.accounts.erase(*key);
 }
 
 bool AddressManager::transfer(const std::string& from, const std::string& to, uint64_t amount) {
-    auto from_it = impl_->accounts.find(from);
-    auto to_it = impl_->accounts.find(to);
-    
-    if (from_it == impl_->accounts.end() || to_it == impl_->accounts.end()) {
-        return false;
+    const auto from_key = accountKey(from);
+    const auto to_key = accountKey(to);
+    return from_key && to_key && transfer(*from_key, *to_key, amount);
+}
+
+bool AddressManager::transfer(const AccountKey& from, const AccountKey& to, uint64_t amount) {
+    // Shared locks keep both entries alive; taking them in shard order
+    // means two transfers in opposite directions cannot deadlock
+    const size_t from_shard = impl_->shardOf(from);
+    const size_t to_shard = impl_->shardOf(to);
+    std::shared_lock first(impl_->shards[std::min(from_shard, to_shard)].mutex);
+    std::shared_lock<std::shared_mutex> second;
+    if (from_shard != to_shard) {
+        second = std::shared_lock(impl_->shards[std::max(from_shard, to_shard)].mutex);
     }
-    
-    if (from_it->second.balance < amount) {
+
+    auto* source = impl_->find(from);
+    auto* destination = impl_->find(to);
+    if (!source || !destination) {
         return false;
     }
-    
-    from_it->second.balance -= amount;
-    to_it->second.balance += amount;
+
+    uint64_t balance = source->balance.load(std::memory_order_relaxed);
+    do {
+        if (balance < amount) {
+            return false;
+        }
+    } while (!source->balance.compare_exchange_weak(balance, balance - amount, std::memory_order_acq_rel));
+    destination->balance.fetch_add(amount, std::memory_order_acq_rel);
     return true;
 }
 
 uint64_t AddressManager::get_balance(const std::string& address) const {
-    auto it = impl_->accounts.find(address);
-    if (it == impl_->accounts.end()) {
-        return 0;
-    }
-    return it->second.balance;
+    const auto key = accountKey(address);
+    return key ? get_balance(*key) : 0;
+}
+
+uint64_t AddressManager::get_balance(const AccountKey& key) const {
+    return impl_->with<std::shared_lock<std::shared_mutex>>(key, uint64_t{0}, [](const Impl::AccountEntry& entry) {
+        return entry.balance.load(std::memory_order_acquire);
+    });
 }
 
 bool AddressManager::set_balance(const std::string& address, uint64_t balance) {
-    auto it = impl_->accounts.find(address);
-    if (it == impl_->accounts.end()) {
-        return false;
-    }
-    it->second.balance = balance;
-    return true;
+    const auto key = accountKey(address);
+    return key && set_balance(*key, balance);
+}
+
+bool AddressManager::set_balance(const AccountKey& key, uint64_t balance) {
+    return impl_->with<std::shared_lock<std::shared_mutex>>(key, false, [balance](Impl::AccountEntry& entry) {
+        entry.balance.store(balance, std::memory_order_release);
+        return true;
+    });
 }
 
 bool AddressManager::deploy_code(const std::string& address, const std::vector<uint8_t>& code) {
-    auto it = impl_->accounts.find(address);
-    if (it == impl_->accounts.end()) {
-        return false;
-    }
-    it->second.code = code;
-    return true;
+    const auto key = accountKey(address);
+    return key && impl_->with<std::unique_lock<std::shared_mutex>>(*key, false, [&code](Impl::AccountEntry& entry) {
+        entry.code = code;
+        return true;
+    });
 }
 
 std::vector<uint8_t> AddressManager::get_code(const std::string& address) const {
-    auto it = impl_->accounts.find(address);
-    if (it == impl_->accounts.end()) {
+    const auto key = accountKey(address);
+    if (!key) {
         return std::vector<uint8_t>();
     }
-    return it->second.code;
+    return impl_->with<std::shared_lock<std::shared_mutex>>(*key, std::vector<uint8_t>(), [](const Impl::AccountEntry& entry) {
+        return entry.code;
+    });
 }
 
 uint64_t AddressManager::get_nonce(const std::string& address) const {
-    auto it = impl_->accounts.find(address);
-    if (it == impl_->accounts.end()) {
-        return 0;
-    }
-    return it->second.nonce;
+    const auto key = accountKey(address);
+    return key ? get_nonce(*key) : 0;
+}
+
+uint64_t AddressManager::get_nonce(const AccountKey& key) const {
+    return impl_->with<std::shared_lock<std::shared_mutex>>(key, uint64_t{0}, [](const Impl::AccountEntry& entry) {
+        return entry.nonce.load(std::memory_order_acquire);
+    });
 }
 
 bool AddressManager::increment_nonce(const std::string& address) {
-    auto it = impl_->accounts.find(address);
-    if (it == impl_->accounts.end()) {
-        return false;
-    }
-    it->second.nonce++;
-    return true;
+    const auto key = accountKey(address);
+    return key && increment_nonce(*key);
+}
+
+bool AddressManager::increment_nonce(const AccountKey& key) {
+    return impl_->with<std::shared_lock<std::shared_mutex>>(key, false, [](Impl::AccountEntry& entry) {
+        entry.nonce.fetch_add(1, std::memory_order_acq_rel);
+        return true;
+    });
 }
 
 bool AddressManager::account_exists(const std::string& address) const {
-    return impl_->accounts.find(address) != impl_->accounts.end();
+    const auto key = accountKey(address);
+    return key && account_exists(*key);
+}
+
+bool AddressManager::account_exists(const AccountKey& key) const {
+    return impl_->with<std::shared_lock<std::shared_mutex>>(key, false, [](const Impl::AccountEntry&) {
+        return true;
+    });
 }
 
 bool AddressManager::is_contract_account(const std::string& address) const {
-    auto it = impl_->accounts.find(address);
-    if (it == impl_->accounts.end()) {
-        return false;
-    }
-    return !it->second.code.empty();
+    const auto key = accountKey(address);
+    return key && impl_->with<std::shared_lock<std::shared_mutex>>(*key, false, [](const Impl::AccountEntry& entry) {
+        return !entry.code.empty();
+    });
 }
 
 bool AddressManager::register_quantum_state(
@@ -485,6 +654,7 @@ bool AddressManager::register_quantum_state(
     if (!account_exists(address)) {
         return false;
     }
+    std::lock_guard<std::mutex> lock(impl_->states_mutex);
     impl_->quantum_states[address] = state;
     return true;
 }
@@ -493,6 +663,7 @@ bool AddressManager::verify_quantum_state(
     const std::string& address,
     const quantum::QuantumState& state
 ) const {
+    std::lock_guard<std::mutex> lock(impl_->states_mutex);
     auto it = impl_->quantum_states.find(address);
     if (it == impl_->quantum_states.end()) {
         return false;
@@ -507,6 +678,7 @@ bool AddressManager::store_proof(
     if (!account_exists(address)) {
         return false;
     }
+    std::lock_guard<std::mutex> lock(impl_->states_mutex);
     impl_->stored_proofs[address] = proof;
     return true;
 }
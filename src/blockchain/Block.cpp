@@ -1,9 +1,37 @@
 #include "blockchain/Block.hpp"
 #include <algorithm>
+#include <stdexcept>
+#include <utility>
 
 namespace quids::blockchain {
 
 // Non-virtual helper functions can go here
 // The pure virtual functions will be implemented by derived classes
 
+void Block::appendTransaction(TransactionPtr tx) {
+    if (!tx) {
+        throw ::std::invalid_argument("Block: null transaction");
+    }
+    const Hash hash = tx->hash();
+    transactions_.push_back(::std::move(tx));
+    try {
+        transactionHashes_.push_back(hash);
+    } catch (...) {
+        transactions_.pop_back();
+        throw;
+    }
+}
+
+void Block::reserveTransactions(size_t n) {
+    transactions_.reserve(n);
+    transactionHashes_.reserve(n);
+}
+
+QuantumBlockMetrics& Block::quantumMetrics() {
+    if (!quantumMetrics_) {
+        quantumMetrics_ = ::std::make_unique<QuantumBlockMetrics>();
+    }
+    return *quantumMetrics_;
+}
+
 } // namespace quids::blockchain 
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "blockchain/BlockPacker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <unordered_set>
+#include <utility>
+
+namespace quids::blockchain {
+
+BlockPacker::BlockPacker(const BlockPackerConfig& config) : config_(config) {}
+
+GasLimit BlockPacker::expectedGas(const Candidate& c) {
+    return c.predictedGas > 0 ? std::min(c.predictedGas, c.gasLimit) : c.gasLimit;
+}
+
+GasLimit BlockPacker::reservedGas(const Candidate& c) const {
+    if (c.predictedGas == 0) {
+        return c.gasLimit;
+    }
+    const GasLimit margin = c.predictedGas / 100 * config_.predictionMarginPercent
+        + c.predictedGas % 100 * config_.predictionMarginPercent / 100;
+    return std::min(c.gasLimit, c.predictedGas + margin);
+}
+
+double BlockPacker::packageDensity(const Sender& sender) const {
+    double fees = 0.0;
+    double gas = 0.0;
+    double best = 0.0;
+    Nonce expected = sender.chain.begin()->first;
+    size_t depth = 0;
+    for (const auto& [nonce, c] : sender.chain) {
+        if (nonce != expected || depth++ == config_.packageDepth) {
+            break;
+        }
+        fees += static_cast<double>(c.gasPrice) * static_cast<double>(expectedGas(c));
+        gas += static_cast<double>(std::max<GasLimit>(1, reservedGas(c)));
+        best = std::max(best, fees / gas);
+        ++expected;
+    }
+    return best;
+}
+
+void BlockPacker::rank(Sender& sender) {
+    ++sender.version;
+    if (sender.deferred || sender.chain.empty()) {
+        return;
+    }
+    if (sender.nextKnown && sender.chain.begin()->first != sender.next) {
+        return;  // waiting for the missing nonce
+    }
+    heads_.push({packageDensity(sender), seq_++, &sender, sender.version});
+}
+
+size_t BlockPacker::waveOf(const Sender& sender, const Candidate& c) const {
+    size_t after = sender.lastWave;
+    for (uint64_t key : c.writes) {
+        if (auto it = keys_.find(key); it != keys_.end()) {
+            after = std::max({after, it->second.lastWrite, it->second.lastRead});
+        }
+    }
+    for (uint64_t key : c.reads) {
+        if (auto it = keys_.find(key); it != keys_.end()) {
+            after = std::max(after, it->second.lastWrite);
+        }
+    }
+    return after + 1;
+}
+
+// Zhou, Chakrabarty and Lukose's threshold for online knapsack: accept
+// anything while the block is nearly empty, then demand a density that
+// grows exponentially with the fill level and reaches maxFeePerGas when it
+// is full. Within a ln(U/L) + 1 factor of the best offline packing.
+double BlockPacker::threshold() const {
+    const double low = static_cast<double>(std::max<GasPrice>(1, config_.minFeePerGas));
+    const double high = static_cast<double>(config_.maxFeePerGas);
+    if (high <= low || config_.maxGasPerBlock == 0) {
+        return low;
+    }
+    const double z = static_cast<double>(block_.gasReserved) / static_cast<double>(config_.maxGasPerBlock);
+    if (z <= 1.0 / (1.0 + std::log(high / low))) {
+        return low;
+    }
+    return std::pow(high * std::numbers::e / low, z) * low / std::numbers::e;
+}
+
+void BlockPacker::place(Sender& sender, const Candidate& c, size_t wave, GasLimit reserve) {
+    for (uint64_t key : c.writes) {
+        auto& k = keys_[key];
+        k.lastWrite = std::max(k.lastWrite, wave);
+    }
+    for (uint64_t key : c.reads) {
+        auto& k = keys_[key];
+        k.lastRead = std::max(k.lastRead, wave);
+    }
+    if (block_.waves.size() < wave) {
+        block_.waves.resize(wave);
+    }
+    block_.waves[wave - 1].push_back(c.id);
+    block_.gasReserved += reserve;
+    block_.expectedFees += c.gasPrice * expectedGas(c);
+    reserved_[c.id] = reserve;
+    sender.lastWave = wave;
+}
+
+BlockPacker::Admit BlockPacker::admitBest(bool useThreshold) {
+    while (!heads_.empty()) {
+        if (order_.size() >= config_.maxTransactionsPerBlock) {
+            return Admit::Exhausted;
+        }
+        const Ranked top = heads_.top();
+        Sender& sender = *top.sender;
+        if (top.version != sender.version) {
+            heads_.pop();
+            continue;
+        }
+        if (useThreshold && top.density < threshold()) {
+            return Admit::BelowThreshold;
+        }
+        heads_.pop();
+
+        auto head = sender.chain.begin();
+        const Candidate& c = head->second;
+        const GasLimit reserve = reservedGas(c);
+        const size_t wave = waveOf(sender, c);
+        if (block_.gasReserved + reserve > config_.maxGasPerBlock || wave > config_.maxConflictDepth) {
+            // Waves and reserved gas only grow while the block is open, so
+            // neither this one nor anything behind it in the chain fits
+            sender.deferred = true;
+            ++sender.version;
+            continue;
+        }
+
+        place(sender, c, wave, reserve);
+        sender.next = c.nonce + 1;
+        sender.nextKnown = true;
+        order_.push_back(std::move(head->second));
+        sender.chain.erase(head);
+        --pending_;
+        rank(sender);
+        return Admit::Admitted;
+    }
+    return Admit::Exhausted;
+}
+
+bool BlockPacker::offer(Candidate candidate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Sender& sender = senders_[candidate.sender];
+    if (sender.nextKnown && candidate.nonce < sender.next) {
+        return false;
+    }
+    auto [it, inserted] = sender.chain.try_emplace(candidate.nonce);
+    if (!inserted && candidate.gasPrice <= it->second.gasPrice) {
+        return false;
+    }
+    if (inserted) {
+        ++pending_;
+    }
+    it->second = std::move(candidate);
+    rank(sender);
+    return true;
+}
+
+void BlockPacker::setNextNonce(const Address& address, Nonce nonce) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Sender& sender = senders_[address];
+    sender.next = nonce;
+    sender.nextKnown = true;
+    auto stale = sender.chain.lower_bound(nonce);
+    pending_ -= static_cast<size_t>(std::distance(sender.chain.begin(), stale));
+    sender.chain.erase(sender.chain.begin(), stale);
+    rank(sender);
+}
+
+size_t BlockPacker::fill(size_t maxSteps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t admitted = 0;
+    while (admitted < maxSteps && admitBest(true) == Admit::Admitted) {
+        ++admitted;
+    }
+    return admitted;
+}
+
+void BlockPacker::resetBlock() {
+    block_ = PackedBlock{};
+    keys_.clear();
+    reserved_.clear();
+    order_.clear();
+
+    // Rebuilding the queue drops stale entries along with the senders that
+    // have sat idle for a whole block
+    heads_ = {};
+    for (auto it = senders_.begin(); it != senders_.end();) {
+        Sender& sender = it->second;
+        if (sender.chain.empty() && sender.lastWave == 0) {
+            it = senders_.erase(it);
+            continue;
+        }
+        sender.lastWave = 0;
+        sender.deferred = false;
+        rank(sender);
+        ++it;
+    }
+}
+
+size_t BlockPacker::topUp() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t admitted = 0;
+    while (admitBest(false) == Admit::Admitted) {
+        ++admitted;
+    }
+    return admitted;
+}
+
+BlockPacker::PackedBlock BlockPacker::seal() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (admitBest(false) == Admit::Admitted) {
+    }
+    PackedBlock packed = std::move(block_);
+    packed.ids.reserve(order_.size());
+    for (const auto& wave : packed.waves) {
+        packed.ids.insert(packed.ids.end(), wave.begin(), wave.end());
+    }
+    resetBlock();
+    return packed;
+}
+
+std::vector<BlockPacker::Candidate> BlockPacker::admittedSince(size_t from) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (from >= order_.size()) {
+        return {};
+    }
+    return {order_.begin() + static_cast<std::ptrdiff_t>(from), order_.end()};
+}
+
+size_t BlockPacker::admitted() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return order_.size();
+}
+
+void BlockPacker::drop(const std::vector<uint64_t>& ids) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_set<uint64_t> gone(ids.begin(), ids.end());
+    std::vector<Candidate> kept;
+    kept.reserve(order_.size());
+    for (auto& c : order_) {
+        if (gone.count(c.id) == 0) {
+            kept.push_back(std::move(c));
+        }
+    }
+    if (kept.size() == order_.size()) {
+        return;
+    }
+
+    // Replaying the admissions that remain can only lower waves and gas, so
+    // everything kept still fits; deferred senders may fit again
+    std::unordered_map<uint64_t, GasLimit> reserved = std::move(reserved_);
+    block_ = PackedBlock{};
+    keys_.clear();
+    reserved_.clear();
+    for (auto& [address, sender] : senders_) {
+        sender.lastWave = 0;
+        if (sender.deferred) {
+            sender.deferred = false;
+            rank(sender);
+        }
+    }
+    for (const auto& c : kept) {
+        Sender& sender = senders_[c.sender];
+        place(sender, c, waveOf(sender, c), reserved[c.id]);
+    }
+    order_ = std::move(kept);
+}
+
+void BlockPacker::reconcile(uint64_t id, GasLimit gasUsed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = reserved_.find(id);
+    if (it == reserved_.end() || gasUsed >= it->second) {
+        return;
+    }
+    block_.gasReserved -= it->second - gasUsed;
+    it->second = gasUsed;
+}
+
+size_t BlockPacker::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+GasLimit BlockPacker::gasReserved() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return block_.gasReserved;
+}
+
+} // namespace quids::blockchain
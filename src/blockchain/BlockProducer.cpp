@@ -8,6 +8,7 @@
 #include <openssl/sha.h>
 #include <cstring>  // for memcpy
 #include <stdexcept>
+#include <unordered_set>
 
 namespace quids::blockchain {
 
@@ -15,14 +16,51 @@ class BlockProducer::Impl {
 public:
     explicit Impl(const BlockProducerConfig& config)
         : config_(config),
-          quantumNetwork_(std::make_unique<neural::QuantumPolicyNetwork>(256, 1, config.numQubits)) {
+          quantumNetwork_(std::make_unique<neural::QuantumPolicyNetwork>(256, 1, config.numQubits)),
+          packer_(packerConfig(config)) {
         metrics_.lastBlockTime = std::chrono::system_clock::now();
     }
 
+    static BlockPackerConfig packerConfig(const BlockProducerConfig& config) {
+        BlockPackerConfig packer;
+        packer.maxGasPerBlock = config.maxGasPerBlock;
+        packer.maxTransactionsPerBlock = config.maxTransactionsPerBlock;
+        packer.maxConflictDepth = config.maxConflictDepth;
+        return packer;
+    }
+
     BlockProducerConfig config_;
     std::unique_ptr<neural::QuantumPolicyNetwork> quantumNetwork_;
+    BlockPacker packer_;
     Metrics metrics_;
     quantum::QuantumState currentState_;
+
+    // Runs admitted transactions not yet executed, dropping the ones that
+    // cannot execute; returns how many ran
+    size_t executeAdmitted() {
+        size_t ran = 0;
+        while (true) {
+            const auto tail = packer_.admittedSince(executed_.size());
+            if (tail.empty()) {
+                return ran;
+            }
+            for (const auto& c : tail) {
+                const auto gasUsed = executor_.execute(c.id);
+                ++ran;
+                if (!gasUsed) {
+                    // Shifts the tail, so it is read again
+                    packer_.drop({c.id});
+                    break;
+                }
+                packer_.reconcile(c.id, *gasUsed);
+                executed_.push_back(c.id);
+            }
+        }
+    }
+
+    SpeculativeExecutor executor_;
+    // Ids executed on the speculative state, a prefix of the admission order
+    std::vector<uint64_t> executed_;
 };
 
 BlockProducer::BlockProducer(const BlockProducerConfig& config)
@@ -52,6 +90,105 @@ AIBlock BlockProducer::produceBlock(const std::vector<Transaction>& transactions
     ).count();
     block.difficulty = difficulty;
     
+    mine(block, difficulty);
+    
+    // Update metrics
+    updateMetrics(block);
+    
+    return block;
+}
+
+AIBlock BlockProducer::produceBlock(const TransactionResolver& resolve) {
+    const auto started = std::chrono::steady_clock::now();
+    if (impl_->executor_.execute) {
+        // Only what arrived since the last buildAhead() runs here. Gas
+        // handed back by execution may fit more, hence the loop.
+        size_t ran = impl_->executeAdmitted();
+        while (impl_->packer_.topUp() > 0) {
+            ran += impl_->executeAdmitted();
+        }
+        impl_->metrics_.sealExecutions += ran;
+    }
+
+    // Selection already happened while the block filled
+    auto packed = impl_->packer_.seal();
+    if (impl_->executor_.execute) {
+        impl_->executed_.clear();
+        if (impl_->executor_.commit) {
+            impl_->executor_.commit();
+        }
+    }
+
+    AIBlockConfig aiConfig;
+    aiConfig.numQubits = impl_->config_.numQubits;
+    aiConfig.maxTransactionsPerBlock = impl_->config_.maxTransactionsPerBlock;
+
+    AIBlock block(aiConfig);
+    block.reserveTransactions(packed.ids.size());
+    for (uint64_t id : packed.ids) {
+        block.addTransaction(resolve(id));
+    }
+    block.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    block.difficulty = getQuantumDifficulty();
+
+    mine(block, block.difficulty);
+    updateMetrics(block);
+    impl_->metrics_.lastSealLatency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started);
+    return block;
+}
+
+BlockPacker& BlockProducer::packer() noexcept {
+    return impl_->packer_;
+}
+
+void BlockProducer::setSpeculativeExecutor(SpeculativeExecutor executor) {
+    if (!executor.execute || !executor.rebase) {
+        throw std::invalid_argument("speculative executor needs execute and rebase");
+    }
+    impl_->executor_ = std::move(executor);
+    impl_->executed_.clear();
+    impl_->executor_.rebase(0);
+}
+
+size_t BlockProducer::buildAhead(size_t maxSteps) {
+    const size_t admitted = impl_->packer_.fill(maxSteps);
+    if (impl_->executor_.execute) {
+        impl_->metrics_.speculativeExecutions += impl_->executeAdmitted();
+    }
+    return admitted;
+}
+
+void BlockProducer::onNewHead(const std::vector<uint64_t>& writtenKeys, const std::vector<uint64_t>& includedIds) {
+    const std::unordered_set<uint64_t> written(writtenKeys.begin(), writtenKeys.end());
+    const std::unordered_set<uint64_t> included(includedIds.begin(), includedIds.end());
+    auto touches = [&](const BlockPacker::Candidate& c) {
+        if (included.count(c.id) != 0) {
+            return true;
+        }
+        auto hit = [&](uint64_t key) { return written.count(key) != 0; };
+        return std::any_of(c.reads.begin(), c.reads.end(), hit) ||
+               std::any_of(c.writes.begin(), c.writes.end(), hit);
+    };
+
+    auto& executed = impl_->executed_;
+    if (impl_->executor_.execute) {
+        const auto order = impl_->packer_.admittedSince(0);
+        size_t keep = 0;
+        while (keep < executed.size() && !touches(order[keep])) {
+            ++keep;
+        }
+        impl_->metrics_.discardedExecutions += executed.size() - keep;
+        executed.resize(keep);
+        impl_->executor_.rebase(keep);
+    }
+    // Behind the kept prefix, so dropping them leaves it in place
+    impl_->packer_.drop(includedIds);
+}
+
+void BlockProducer::mine(AIBlock& block, double difficulty) const {
     // Mine block with quantum-enhanced parameters
     bool found = false;
     std::random_device rd;
@@ -79,11 +216,6 @@ AIBlock BlockProducer::produceBlock(const std::vector<Transaction>& transactions
             std::copy_n(hash, SHA256_DIGEST_LENGTH, block.hash.begin());
         }
     }
-    
-    // Update metrics
-    updateMetrics(block);
-    
-    return block;
 }
 
 bool BlockProducer::verifyBlock(const AIBlock& block) const noexcept {
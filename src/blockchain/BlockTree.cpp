@@ -0,0 +1,113 @@
+#include "blockchain/BlockTree.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace quids::blockchain {
+
+BlockTree::BlockTree(const Hash& root, BlockNumber height, uint64_t totalWeight) {
+    Node node;
+    node.hash = root;
+    node.height = height;
+    node.totalWeight = totalWeight;
+    root_ = head_ = &nodes_.emplace(root, ::std::move(node)).first->second;
+}
+
+BlockTree::Insert BlockTree::insert(const Hash& hash, const Hash& parent, uint64_t weight) {
+    if (nodes_.count(hash) != 0) {
+        return Insert::Duplicate;
+    }
+    auto it = nodes_.find(parent);
+    if (it == nodes_.end()) {
+        return Insert::UnknownParent;
+    }
+    Node& up = it->second;
+
+    Node node;
+    node.hash = hash;
+    node.parent = parent;
+    node.height = up.height + 1;
+    node.weight = weight;
+    node.totalWeight = up.totalWeight + weight;
+    up.children.push_back(hash);
+    try {
+        const Node& added = nodes_.emplace(hash, ::std::move(node)).first->second;
+        if (added.totalWeight > head_->totalWeight) {
+            head_ = &added;
+        }
+    } catch (...) {
+        up.children.pop_back();
+        throw;
+    }
+    return Insert::Added;
+}
+
+const BlockTree::Node* BlockTree::find(const Hash& hash) const {
+    auto it = nodes_.find(hash);
+    return it == nodes_.end() ? nullptr : &it->second;
+}
+
+const BlockTree::Node* BlockTree::ancestorAt(const Hash& hash, BlockNumber height) const {
+    const Node* node = find(hash);
+    while (node && node->height > height) {
+        node = node == root_ ? nullptr : find(node->parent);
+    }
+    return node && node->height == height ? node : nullptr;
+}
+
+BlockTree::Reorg BlockTree::path(const Hash& from, const Hash& to) const {
+    const Node* a = find(from);
+    const Node* b = find(to);
+    if (!a || !b) {
+        throw ::std::invalid_argument("BlockTree: path to an unknown block");
+    }
+
+    // Every node descends from the root, so the walk meets there at the latest
+    Reorg reorg;
+    while (a->height > b->height) {
+        reorg.detached.push_back(a->hash);
+        a = find(a->parent);
+    }
+    while (b->height > a->height) {
+        reorg.attached.push_back(b->hash);
+        b = find(b->parent);
+    }
+    while (a != b) {
+        reorg.detached.push_back(a->hash);
+        reorg.attached.push_back(b->hash);
+        a = find(a->parent);
+        b = find(b->parent);
+    }
+    reorg.ancestor = a->hash;
+    ::std::reverse(reorg.attached.begin(), reorg.attached.end());
+    return reorg;
+}
+
+::std::vector<Hash> BlockTree::prune(const Hash& newRoot) {
+    const Node* root = find(newRoot);
+    if (!root || ancestorAt(head_->hash, root->height) != root) {
+        throw ::std::invalid_argument("BlockTree: new root is not on the head's chain");
+    }
+
+    ::std::unordered_map<Hash, Node, Hasher> kept;
+    kept.reserve(nodes_.size());
+    ::std::vector<Hash> frontier{newRoot};
+    while (!frontier.empty()) {
+        const Hash hash = frontier.back();
+        frontier.pop_back();
+        auto node = nodes_.extract(hash);
+        frontier.insert(frontier.end(), node.mapped().children.begin(), node.mapped().children.end());
+        kept.insert(::std::move(node));
+    }
+
+    ::std::vector<Hash> dropped;
+    dropped.reserve(nodes_.size());
+    for (const auto& [hash, node] : nodes_) {
+        dropped.push_back(hash);
+    }
+    // Extracted nodes keep their addresses, so head_ is still valid
+    nodes_ = ::std::move(kept);
+    root_ = &nodes_.at(newRoot);
+    return dropped;
+}
+
+} // namespace quids::blockchain
@@ -0,0 +1,156 @@
+#include "blockchain/BlockValidator.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include "utils/Int128.hpp"
+#include <atomic>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace quids::blockchain {
+
+// State shared by the tasks of one validate() call
+class BlockValidator::Run {
+public:
+    explicit Run(::std::stop_token stop) : stop_(::std::move(stop)) {}
+
+    [[nodiscard]] bool stopped() const {
+        return failed_.load(::std::memory_order_relaxed) || stop_.stop_requested();
+    }
+
+    // Keeps the earliest transaction among concurrent failures
+    void fail(Status status, size_t index) {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        if (!failed_.load(::std::memory_order_relaxed) || index < result_.index) {
+            result_ = {status, index};
+        }
+        failed_.store(true, ::std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] ::std::optional<Result> outcome() {
+        if (failed_.load(::std::memory_order_acquire)) {
+            ::std::lock_guard<::std::mutex> lock(mutex_);
+            return result_;
+        }
+        if (stop_.stop_requested()) {
+            return Result{Status::Cancelled, Result::npos};
+        }
+        return ::std::nullopt;
+    }
+
+private:
+    ::std::stop_token stop_;
+    ::std::atomic<bool> failed_{false};
+    ::std::mutex mutex_;
+    Result result_;
+};
+
+namespace {
+
+// What each sender's walk needs: its transactions and the credits paid
+// to it, both in block order
+struct SenderGroup {
+    ::std::string_view address;
+    ::std::vector<size_t> spends;
+    ::std::vector<::std::pair<size_t, uint64_t>> credits;
+};
+
+::std::vector<SenderGroup> groupBySender(::std::span<const TransactionPtr> transactions) {
+    ::std::vector<SenderGroup> groups;
+    ::std::unordered_map<::std::string_view, size_t> index;
+    auto groupOf = [&](::std::string_view address) -> SenderGroup& {
+        auto [it, inserted] = index.try_emplace(address, groups.size());
+        if (inserted) {
+            groups.push_back({address, {}, {}});
+        }
+        return groups[it->second];
+    };
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        groupOf(transactions[i]->getSender()).spends.push_back(i);
+    }
+    // Only senders spend, so credits to anyone else are irrelevant
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        if (auto it = index.find(transactions[i]->getRecipient()); it != index.end()) {
+            groups[it->second].credits.emplace_back(i, transactions[i]->getAmount());
+        }
+    }
+    return groups;
+}
+
+} // namespace
+
+BlockValidator::BlockValidator(utils::WorkStealingPool& pool) : pool_(pool) {}
+
+BlockValidator::Result BlockValidator::validate(::std::span<const TransactionPtr> transactions,
+                                                const Hash& merkleRoot,
+                                                const AccountLookup& accounts,
+                                                ::std::stop_token stop) const {
+    Run run(::std::move(stop));
+    const size_t n = transactions.size();
+
+    pool_.parallel_for(0, n, [&](size_t i) {
+        if (run.stopped()) {
+            return;
+        }
+        if (!transactions[i] || !transactions[i]->verified()) {
+            run.fail(Status::BadSignature, i);
+        }
+    }, utils::TaskPriority::Consensus);
+    if (auto failed = run.outcome()) {
+        return *failed;
+    }
+
+    const auto groups = groupBySender(transactions);
+    pool_.parallel_for(0, groups.size(), [&](size_t g) {
+        if (run.stopped()) {
+            return;
+        }
+        const SenderGroup& group = groups[g];
+        const Account account = accounts(Address(group.address)).value_or(Account{});
+
+        utils::u128 available = account.balance;
+        Nonce expected = account.nonce;
+        size_t credit = 0;
+        for (size_t i : group.spends) {
+            if (run.stopped()) {
+                return;
+            }
+            for (; credit < group.credits.size() && group.credits[credit].first < i; ++credit) {
+                available += group.credits[credit].second;
+            }
+            const Transaction& tx = *transactions[i];
+            if (tx.getNonce() != expected) {
+                run.fail(Status::BadNonce, i);
+                return;
+            }
+            ++expected;
+            const utils::u128 cost =
+                static_cast<utils::u128>(tx.getAmount()) + tx.calculate_gas_cost();
+            if (cost > available) {
+                run.fail(Status::InsufficientBalance, i);
+                return;
+            }
+            available -= cost;
+        }
+    }, utils::TaskPriority::Consensus);
+    if (auto failed = run.outcome()) {
+        return *failed;
+    }
+
+    crypto::MerkleBuilder builder(pool_);
+    builder.appendParallel(n, [&](size_t i) {
+        return crypto::MerkleBuilder::toHash(transactions[i]->hash());
+    });
+    if (builder.root() != merkleRoot) {
+        return {Status::BadMerkleRoot, Result::npos};
+    }
+    return {};
+}
+
+BlockValidator::Result BlockValidator::validate(const Block& block, const AccountLookup& accounts,
+                                                ::std::stop_token stop) const {
+    return validate(block.transactions(), block.merkleRoot(), accounts, ::std::move(stop));
+}
+
+} // namespace quids::blockchain
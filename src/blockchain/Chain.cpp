@@ -1,60 +1,165 @@
 #include "blockchain/Chain.hpp"
 #include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <utility>
 
 namespace quids {
 namespace blockchain {
 
-Chain::Chain(const ChainConfig& config, evm::EVMExecutor* evm_executor)
-    : evm_executor_(evm_executor) {
-    // Initialize genesis block
-    Block genesis;
-    chain_.push_back(genesis);
-    current_height_ = 1;
+Chain::Chain() : Chain(Config{}) {}
+
+Chain::Chain(Config config, AccountState genesisState, const Hash& genesis)
+    : config_(config), tree_(genesis) {
+    entries_.emplace(genesis, Entry{nullptr, ::std::move(genesisState)});
+}
+
+void Chain::execute(AccountState& state, const Block& block) {
+    auto account = [&](const Address& address) -> Account& {
+        if (Account* existing = state.find_mutable(address)) {
+            return *existing;
+        }
+        state.set(address, Account(address));
+        return *state.find_mutable(address);
+    };
+    // The validator has already checked every nonce and balance
+    for (const auto& tx : block.transactions()) {
+        Account& sender = account(tx->getSender());
+        sender.balance -= tx->getAmount() + tx->calculate_gas_cost();
+        ++sender.nonce;
+        account(tx->getRecipient()).balance += tx->getAmount();
+    }
 }
 
-bool Chain::addBlock(const Block& block) {
-    try {
-        // Verify block
-        if (!block.verify()) {
-            return false;
+Chain::Update Chain::addBlock(BlockPtr block, uint64_t weight) {
+    if (!block) {
+        throw ::std::invalid_argument("Chain: null block");
+    }
+    const Hash hash = block->hash();
+    Update update;
+
+    // Validation and execution run unlocked against the parent's state;
+    // copying it is O(1) and later writes never touch the copy
+    AccountState state;
+    {
+        ::std::lock_guard<::std::mutex> lock(mutex_);
+        if (tree_.find(hash)) {
+            update.status = Status::Duplicate;
+            return update;
+        }
+        const BlockTree::Node* parent = tree_.find(block->previousHash());
+        if (!parent) {
+            update.status = Status::UnknownParent;
+            return update;
         }
+        if (block->number() != parent->height + 1) {
+            return update;
+        }
+        state = entries_.at(parent->hash).state;
+    }
 
-        // Execute transactions
-        for (const auto& tx : block.transactions) {
-            if (!evm_executor_->execute(tx)) {
-                return false;
-            }
+    update.validation = validator_.validate(*block, [&state](const Address& address)
+                                                -> ::std::optional<BlockValidator::Account> {
+        if (const Account* account = state.find(address)) {
+            return BlockValidator::Account{account->balance, account->nonce};
         }
+        return ::std::nullopt;
+    });
+    if (!update.validation) {
+        spdlog::debug("Chain: rejected block {} at transaction {}", block->number(), update.validation.index);
+        return update;
+    }
+    execute(state, *block);
 
-        chain_.push_back(block);
-        current_height_++;
-        return true;
-    } catch (const std::exception& e) {
-        spdlog::error("Failed to add block: {}", e.what());
-        return false;
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    const Hash oldHead = tree_.head().hash;
+    switch (tree_.insert(hash, block->previousHash(), weight)) {
+    case BlockTree::Insert::Duplicate:
+        update.status = Status::Duplicate;
+        return update;
+    case BlockTree::Insert::UnknownParent:
+        // Pruned while we were validating
+        update.status = Status::UnknownParent;
+        return update;
+    case BlockTree::Insert::Added:
+        break;
     }
+    entries_.emplace(hash, Entry{::std::move(block), ::std::move(state)});
+
+    if (tree_.head().hash == oldHead) {
+        update.status = Status::SideBranch;
+        return update;
+    }
+    update.status = Status::Extended;
+    update.reorg = tree_.path(oldHead, tree_.head().hash);
+    if (!update.reorg.detached.empty()) {
+        spdlog::info("Chain: reorg of {} blocks to height {}", update.reorg.detached.size(), tree_.head().height);
+    }
+    finalize();
+    return update;
 }
 
-bool Chain::addTransaction(const Transaction& tx) {
-    try {
-        if (!tx.verify()) {
-            return false;
-        }
-        pending_transactions_.push_back(tx);
-        return true;
-    } catch (const std::exception& e) {
-        spdlog::error("Failed to add transaction: {}", e.what());
+void Chain::finalize() {
+    const BlockNumber headHeight = tree_.head().height;
+    if (headHeight < tree_.root().height + config_.finalityDepth) {
+        return;
+    }
+    const BlockTree::Node* finalNode = tree_.ancestorAt(tree_.head().hash, headHeight - config_.finalityDepth);
+    if (!finalNode || finalNode == &tree_.root()) {
+        return;
+    }
+    for (const Hash& hash : tree_.prune(finalNode->hash)) {
+        entries_.erase(hash);
+    }
+}
+
+bool Chain::addTransaction(TransactionPtr transaction) {
+    if (!transaction || !transaction->verified()) {
         return false;
     }
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    pending_.push_back(::std::move(transaction));
+    return true;
+}
+
+Hash Chain::head() const {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    return tree_.head().hash;
+}
+
+BlockNumber Chain::height() const {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    return tree_.head().height;
+}
+
+Chain::BlockPtr Chain::getBlock(const Hash& hash) const {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    auto it = entries_.find(hash);
+    return it == entries_.end() ? nullptr : it->second.block;
+}
+
+Chain::BlockPtr Chain::getLatestBlock() const {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    return entries_.at(tree_.head().hash).block;
+}
+
+Chain::AccountState Chain::state() const {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    return entries_.at(tree_.head().hash).state;
 }
 
-Block Chain::getLatestBlock() const {
-    return chain_.back();
+::std::optional<Chain::AccountState> Chain::stateAt(const Hash& hash) const {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    auto it = entries_.find(hash);
+    if (it == entries_.end()) {
+        return ::std::nullopt;
+    }
+    return it->second.state;
 }
 
-std::vector<Transaction> Chain::getPendingTransactions() const {
-    return pending_transactions_;
+::std::vector<TransactionPtr> Chain::getPendingTransactions() const {
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    return pending_;
 }
 
 } // namespace blockchain
-} // namespace quids 
\ No newline at end of file
+} // namespace quids
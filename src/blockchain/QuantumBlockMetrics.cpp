@@ -0,0 +1,41 @@
+#include "blockchain/QuantumBlockMetrics.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace quids::blockchain {
+
+std::span<double> QuantumBlockMetrics::resize(Series series, size_t size) {
+    const auto i = static_cast<size_t>(series);
+    const size_t old = offsets_[i + 1] - offsets_[i];
+    if (size > old && size - old > std::numeric_limits<uint32_t>::max() - data_.size()) {
+        throw std::length_error("QuantumBlockMetrics: series too long");
+    }
+
+    const auto end = data_.begin() + offsets_[i + 1];
+    if (size > old) {
+        data_.insert(end, size - old, 0.0);
+    } else {
+        data_.erase(end - static_cast<std::ptrdiff_t>(old - size), end);
+    }
+    const auto shift = static_cast<int64_t>(size) - static_cast<int64_t>(old);
+    for (size_t j = i + 1; j < offsets_.size(); ++j) {
+        offsets_[j] = static_cast<uint32_t>(offsets_[j] + shift);
+    }
+    if (data_.empty()) {
+        data_.shrink_to_fit();
+    }
+    return get(series);
+}
+
+void QuantumBlockMetrics::assign(Series series, std::span<const double> values) {
+    auto column = resize(series, values.size());
+    std::copy(values.begin(), values.end(), column.begin());
+}
+
+void QuantumBlockMetrics::clear() noexcept {
+    offsets_.fill(0);
+    data_ = {};
+}
+
+} // namespace quids::blockchain
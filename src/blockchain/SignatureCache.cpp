@@ -0,0 +1,62 @@
+#include "blockchain/SignatureCache.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace quids::blockchain {
+
+SignatureCache::SignatureCache(size_t capacity)
+    : shard_capacity_(std::max<size_t>(1, capacity / NUM_SHARDS / 2)) {}
+
+SignatureCache& SignatureCache::global() {
+    static SignatureCache cache;
+    return cache;
+}
+
+void SignatureCache::admit(Shard& s, const Hash& tx_hash) {
+    if (s.current.size() >= shard_capacity_) {
+        std::swap(s.current, s.previous);
+        s.current.clear();
+    }
+    s.current.insert_or_assign(tx_hash, true);
+}
+
+bool SignatureCache::contains(const Hash& tx_hash) {
+    Shard& s = shard(tx_hash);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.current.contains(tx_hash)) {
+        return true;
+    }
+    if (!s.previous.erase(tx_hash)) {
+        return false;
+    }
+    // Still in use, carry it into the current generation
+    admit(s, tx_hash);
+    return true;
+}
+
+void SignatureCache::insert(const Hash& tx_hash) {
+    Shard& s = shard(tx_hash);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (!s.current.contains(tx_hash)) {
+        admit(s, tx_hash);
+    }
+}
+
+void SignatureCache::clear() {
+    for (Shard& s : shards_) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.current.clear();
+        s.previous.clear();
+    }
+}
+
+size_t SignatureCache::size() const {
+    size_t total = 0;
+    for (const Shard& s : shards_) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        total += s.current.size() + s.previous.size();
+    }
+    return total;
+}
+
+} // namespace quids::blockchain
@@ -1,4 +1,5 @@
 #include "blockchain/Transaction.hpp"
+#include "blockchain/SignatureCache.hpp"
 #include "crypto/blake3/Blake3Hash.hpp"
 #include <openssl/evp.h>
 #include <openssl/err.h>
@@ -8,6 +9,7 @@
 #include <openssl/params.h>
 #include <openssl/bio.h>
 #include <openssl/conf.h>
+#include <algorithm>
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
@@ -128,6 +130,36 @@ std::vector<uint8_t> Transaction::computeHash() const {
     return hasher.finalize();
 }
 
+Hash Transaction::hash() const {
+    if (memo_.state.load(std::memory_order_acquire) & Memo::HASH_READY) {
+        return memo_.hash;
+    }
+    const auto computed = computeHash();
+    Hash h{};
+    std::copy_n(computed.begin(), std::min(computed.size(), h.size()), h.begin());
+    if (!(memo_.state.fetch_or(Memo::HASH_CLAIMED, std::memory_order_acq_rel) & Memo::HASH_CLAIMED)) {
+        memo_.hash = h;
+        memo_.state.fetch_or(Memo::HASH_READY, std::memory_order_release);
+    }
+    return h;
+}
+
+bool Transaction::verified() const {
+    const uint8_t st = memo_.state.load(std::memory_order_acquire);
+    if (st & Memo::VERIFY_DONE) {
+        return st & Memo::VERIFIED;
+    }
+    const Hash h = hash();
+    auto& cache = SignatureCache::global();
+    bool ok = cache.contains(h);
+    if (!ok && verify()) {
+        cache.insert(h);
+        ok = true;
+    }
+    memo_.state.fetch_or(Memo::VERIFY_DONE | (ok ? Memo::VERIFIED : 0), std::memory_order_release);
+    return ok;
+}
+
 bool Transaction::verify() const {
     if (sender.empty() || receiver.empty()) {
         return false;
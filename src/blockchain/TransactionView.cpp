@@ -0,0 +1,163 @@
+#include "blockchain/TransactionView.hpp"
+#include <blake3.h>
+#include <limits>
+#include <stdexcept>
+
+namespace quids::blockchain {
+
+namespace {
+
+constexpr size_t TIMESTAMP_OFFSET = 1;
+constexpr size_t SENDER_LENGTH_OFFSET = 1 + 4 * sizeof(uint64_t);
+constexpr size_t RECIPIENT_LENGTH_OFFSET = SENDER_LENGTH_OFFSET + sizeof(uint16_t);
+constexpr size_t DATA_LENGTH_OFFSET = RECIPIENT_LENGTH_OFFSET + sizeof(uint16_t);
+static_assert(DATA_LENGTH_OFFSET + sizeof(uint32_t) == wire::HEADER_SIZE);
+
+uint64_t load(const uint8_t* p, size_t width) noexcept {
+    uint64_t v = 0;
+    for (size_t i = 0; i < width; ++i) {
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+void store(ByteVector& out, uint64_t v, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+// Total encoded size, or 0 when the header is not valid
+size_t encodedSize(std::span<const uint8_t> bytes) noexcept {
+    if (bytes.size() < wire::MIN_SIZE || bytes[0] != wire::VERSION) {
+        return 0;
+    }
+    return wire::MIN_SIZE +
+           load(bytes.data() + SENDER_LENGTH_OFFSET, sizeof(uint16_t)) +
+           load(bytes.data() + RECIPIENT_LENGTH_OFFSET, sizeof(uint16_t)) +
+           load(bytes.data() + DATA_LENGTH_OFFSET, sizeof(uint32_t));
+}
+
+Hash blake3(std::span<const uint8_t> bytes) noexcept {
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, bytes.data(), bytes.size());
+    Hash out;
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+} // namespace
+
+void encodeTransaction(const Transaction& tx, ByteVector& out) {
+    const Address& sender = tx.getSender();
+    const Address& recipient = tx.getRecipient();
+    const Data& data = tx.getData();
+    if (sender.size() > std::numeric_limits<uint16_t>::max() ||
+        recipient.size() > std::numeric_limits<uint16_t>::max() ||
+        data.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Transaction field too large for the wire format");
+    }
+
+    const auto timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        tx.getTimestamp().time_since_epoch()).count();
+
+    out.reserve(out.size() + wire::MIN_SIZE + sender.size() + recipient.size() + data.size());
+    out.push_back(wire::VERSION);
+    store(out, static_cast<uint64_t>(timestamp_us), sizeof(uint64_t));
+    store(out, tx.getValue(), sizeof(uint64_t));
+    store(out, tx.getNonce(), sizeof(uint64_t));
+    store(out, tx.calculate_gas_cost(), sizeof(uint64_t));
+    store(out, sender.size(), sizeof(uint16_t));
+    store(out, recipient.size(), sizeof(uint16_t));
+    store(out, data.size(), sizeof(uint32_t));
+    out.insert(out.end(), sender.begin(), sender.end());
+    out.insert(out.end(), recipient.begin(), recipient.end());
+    out.insert(out.end(), data.begin(), data.end());
+    out.insert(out.end(), tx.getSignature().begin(), tx.getSignature().end());
+}
+
+std::optional<TransactionView> TransactionView::parse(std::span<const uint8_t> bytes) noexcept {
+    const size_t size = encodedSize(bytes);
+    if (size == 0 || size != bytes.size()) {
+        return std::nullopt;
+    }
+    return TransactionView(bytes);
+}
+
+std::optional<TransactionView> TransactionView::parsePrefix(std::span<const uint8_t> bytes) noexcept {
+    const size_t size = encodedSize(bytes);
+    if (size == 0 || size > bytes.size()) {
+        return std::nullopt;
+    }
+    return TransactionView(bytes.first(size));
+}
+
+uint64_t TransactionView::load64(size_t offset) const noexcept {
+    return load(bytes_.data() + offset, sizeof(uint64_t));
+}
+
+size_t TransactionView::senderLength() const noexcept {
+    return load(bytes_.data() + SENDER_LENGTH_OFFSET, sizeof(uint16_t));
+}
+
+size_t TransactionView::recipientLength() const noexcept {
+    return load(bytes_.data() + RECIPIENT_LENGTH_OFFSET, sizeof(uint16_t));
+}
+
+size_t TransactionView::dataLength() const noexcept {
+    return load(bytes_.data() + DATA_LENGTH_OFFSET, sizeof(uint32_t));
+}
+
+std::string_view TransactionView::getSender() const noexcept {
+    return {reinterpret_cast<const char*>(bytes_.data() + wire::HEADER_SIZE), senderLength()};
+}
+
+std::string_view TransactionView::getRecipient() const noexcept {
+    return {reinterpret_cast<const char*>(bytes_.data() + wire::HEADER_SIZE + senderLength()),
+            recipientLength()};
+}
+
+std::span<const uint8_t> TransactionView::getData() const noexcept {
+    return bytes_.subspan(wire::HEADER_SIZE + senderLength() + recipientLength(), dataLength());
+}
+
+std::span<const uint8_t, wire::SIGNATURE_SIZE> TransactionView::getSignature() const noexcept {
+    return bytes_.last<wire::SIGNATURE_SIZE>();
+}
+
+Timestamp TransactionView::getTimestamp() const noexcept {
+    const auto us = static_cast<int64_t>(load64(TIMESTAMP_OFFSET));
+    return Timestamp(std::chrono::duration_cast<Timestamp::duration>(std::chrono::microseconds(us)));
+}
+
+Hash TransactionView::computeHash() const noexcept {
+    return blake3(bytes_);
+}
+
+bool TransactionView::verify() const noexcept {
+    if (senderLength() == 0 || recipientLength() == 0) {
+        return false;
+    }
+    const Hash expected = blake3(signedBytes());
+    const auto signature = getSignature();
+    return std::equal(expected.begin(), expected.end(), signature.begin());
+}
+
+StandardTransaction TransactionView::materialize() const {
+    StandardTransaction tx;
+    Transaction& base = tx;
+    base.timestamp = getTimestamp();
+    base.sender.assign(getSender());
+    base.receiver.assign(getRecipient());
+    base.value = getValue();
+    base.nonce = getNonce();
+    base.gas_cost = calculate_gas_cost();
+    const auto data = getData();
+    base.data.assign(data.begin(), data.end());
+    const auto signature = getSignature();
+    std::copy(signature.begin(), signature.end(), base.signature.begin());
+    return tx;
+}
+
+} // namespace quids::blockchain
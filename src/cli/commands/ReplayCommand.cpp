@@ -0,0 +1,179 @@
+#include "cli/commands/ReplayCommand.hpp"
+#include "rollup/StateStore.hpp"
+#include "storage/PersistentStorage.hpp"
+#include "utils/Tracing.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+
+namespace quids {
+namespace cli {
+
+namespace {
+
+double millis(uint64_t ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+
+double millis(std::chrono::nanoseconds ns) {
+    return static_cast<double>(ns.count()) / 1e6;
+}
+
+uint64_t parseCount(const std::string& value, uint64_t fallback) {
+    return value.empty() ? fallback : std::stoull(value);
+}
+
+} // namespace
+
+int ReplayCommand::execute(const std::vector<std::string>& args) {
+    const std::string data_dir = getArgValue(args, "--data-dir");
+    if (data_dir.empty()) {
+        printUsage();
+        return 1;
+    }
+    const std::string state_dir = getArgValue(args, "--state-dir");
+
+    try {
+        rollup::BlockReplayer::Config config;
+        config.threads = static_cast<size_t>(parseCount(getArgValue(args, "--threads"), 1));
+        config.stop_on_mismatch = !hasArg(args, "--keep-going");
+        const uint64_t repeat = std::max<uint64_t>(1, parseCount(getArgValue(args, "--repeat"), 1));
+        const size_t slowest = static_cast<size_t>(parseCount(getArgValue(args, "--slowest"), 10));
+        const std::string trace_path = getArgValue(args, "--trace");
+
+        auto blocks = std::make_shared<storage::PersistentStorage>(data_dir);
+        auto state_storage = state_dir.empty() || state_dir == data_dir
+            ? blocks
+            : std::make_shared<storage::PersistentStorage>(state_dir);
+
+        // Only read: the replayed state is a copy and nothing is committed
+        rollup::StateStore::Config store_config;
+        store_config.async_flush = false;
+        auto store = std::make_shared<rollup::StateStore>(state_storage, store_config);
+        const auto base = rollup::StateManager(store).snapshot();
+
+        const uint64_t checkpoint = base.version();
+        const uint64_t first = parseCount(getArgValue(args, "--from"), checkpoint + 1);
+        const uint64_t last = parseCount(getArgValue(args, "--to"), std::numeric_limits<uint64_t>::max());
+        if (first != checkpoint + 1) {
+            spdlog::warn("State is checkpointed at version {}, replay starts at block {}; roots will not match",
+                         checkpoint, first);
+        }
+        spdlog::info("Replaying from block {} on {} accounts with {} thread(s)", first, base.account_count(),
+                     config.threads);
+
+        rollup::BlockReplayer replayer(base, config);
+        const auto source = rollup::BlockReplayer::from_storage(blocks);
+        rollup::BlockReplayer::Report report;
+        for (uint64_t run = 0; run < repeat; ++run) {
+            // Only the last run is exported
+            utils::Tracer::global().clear();
+            report = replayer.run(source, first, last);
+            if (repeat > 1) {
+                std::printf("run %llu: %zu blocks in %.3f ms\n", static_cast<unsigned long long>(run + 1),
+                            report.blocks.size(), millis(report.elapsed));
+            }
+        }
+        printReport(report, slowest);
+
+        if (!trace_path.empty()) {
+            std::ofstream out(trace_path);
+            out << utils::Tracer::to_chrome_json(utils::Tracer::global().collect());
+            if (!out) {
+                spdlog::error("Could not write trace to {}", trace_path);
+                return 1;
+            }
+            spdlog::info("Trace written to {}", trace_path);
+        }
+        return report.mismatches == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        spdlog::error("Replay failed: {}", e.what());
+        return 1;
+    }
+}
+
+void ReplayCommand::printReport(const rollup::BlockReplayer::Report& report, size_t slowest) const {
+    using Replayer = rollup::BlockReplayer;
+
+    size_t transactions = 0;
+    size_t executed = 0;
+    for (const auto& block : report.blocks) {
+        transactions += block.transactions;
+        executed += block.executed;
+    }
+    const double seconds = static_cast<double>(report.elapsed.count()) / 1e9;
+    std::printf("%zu blocks, %zu transactions (%zu executed) in %.3f s: %.1f tx/s\n", report.blocks.size(),
+                transactions, executed, seconds, seconds > 0 ? static_cast<double>(transactions) / seconds : 0.0);
+    if (!report.blocks.empty()) {
+        std::printf("blocks %llu..%llu\n", static_cast<unsigned long long>(report.blocks.front().number),
+                    static_cast<unsigned long long>(report.blocks.back().number));
+    }
+
+    auto latency = [](const char* name, const utils::HistogramSnapshot& h) {
+        std::printf("%-11s p50 %9.3f  p99 %9.3f  max %9.3f  total %10.3f ms\n", name, millis(h.quantile(0.5)),
+                    millis(h.quantile(0.99)), millis(h.max), millis(h.sum));
+    };
+    for (size_t s = 0; s < Replayer::NUM_STAGES; ++s) {
+        latency(Replayer::STAGE_NAMES[s], report.stage_latency[s]);
+    }
+    latency("block", report.block_latency);
+
+    auto counts = [](const char* name, const utils::HistogramSnapshot& h) {
+        std::printf("%-20s p50 %8llu  p99 %8llu  max %8llu\n", name,
+                    static_cast<unsigned long long>(h.quantile(0.5)),
+                    static_cast<unsigned long long>(h.quantile(0.99)), static_cast<unsigned long long>(h.max));
+    };
+    counts("transactions/block", report.transactions_per_block);
+    counts("accounts written", report.accounts_per_block);
+
+    std::vector<const Replayer::BlockReport*> blocks;
+    for (const auto& block : report.blocks) {
+        blocks.push_back(&block);
+    }
+    auto total = [](const Replayer::BlockReport* b) {
+        std::chrono::nanoseconds sum{0};
+        for (auto stage : b->stages) {
+            sum += stage;
+        }
+        return sum;
+    };
+    const size_t shown = std::min(slowest, blocks.size());
+    std::partial_sort(blocks.begin(), blocks.begin() + static_cast<std::ptrdiff_t>(shown), blocks.end(),
+                      [&](const auto* a, const auto* b) { return total(a) > total(b); });
+    if (shown > 0) {
+        std::printf("slowest blocks:\n");
+    }
+    for (size_t i = 0; i < shown; ++i) {
+        const auto* b = blocks[i];
+        std::printf("  %10llu %9.3f ms  load %8.3f verify %8.3f execute %8.3f root %8.3f  txs %zu  writes %zu"
+                    "  reexec %zu\n",
+                    static_cast<unsigned long long>(b->number), millis(total(b)), millis(b->stages[Replayer::Load]),
+                    millis(b->stages[Replayer::Verify]), millis(b->stages[Replayer::Execute]),
+                    millis(b->stages[Replayer::StateRoot]), b->transactions, b->accounts_written, b->reexecutions);
+    }
+
+    if (!report.hot_accounts.empty()) {
+        std::printf("hot accounts:\n");
+    }
+    for (const auto& [address, accesses] : report.hot_accounts) {
+        std::printf("  %-44s %llu\n", address.c_str(), static_cast<unsigned long long>(accesses));
+    }
+
+    if (report.missing_block) {
+        if (report.blocks.empty()) {
+            spdlog::warn("Block {} is not stored; nothing replayed", *report.missing_block);
+        } else {
+            spdlog::info("Stopped at block {}, which is not stored", *report.missing_block);
+        }
+    }
+    if (report.first_mismatch) {
+        spdlog::error("{} block(s) diverged from their stored state root, first at {}", report.mismatches,
+                      *report.first_mismatch);
+    }
+}
+
+} // namespace cli
+} // namespace quids
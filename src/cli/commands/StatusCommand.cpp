@@ -30,7 +30,18 @@ void StatusCommand::printHumanStatus(const control::QuidsControl::NodeStatus& st
               << "  Block Height: " << status.block_height << "\n"
               << "  Peers: " << status.peer_count << "\n"
               << "  Sync Status: " << status.sync_status << "\n"
-              << "  Health: " << (status.health.is_healthy ? "Healthy" : "Unhealthy") << "\n";
+              << "  Health: " << (status.health.is_healthy ? "Healthy" : "Unhealthy") << "\n"
+              << "  CPU: " << status.health.cpu_usage * 100.0 << "%\n"
+              << "  Disk: " << status.health.disk_usage * 100.0 << "%\n"
+              << "  Peer latency (us): " << status.health.network_latency << "\n"
+              << "  Memory (MB): " << status.health.memory_usage << "\n";
+    for (const auto& subsystem : status.health.memory_by_subsystem) {
+        std::cout << "    " << subsystem.subsystem << ": " << (subsystem.live_bytes >> 20);
+        if (subsystem.budget_bytes != 0) {
+            std::cout << " / " << (subsystem.budget_bytes >> 20);
+        }
+        std::cout << " (peak " << (subsystem.peak_bytes >> 20) << ")\n";
+    }
 }
 
 void StatusCommand::printJsonStatus(const control::QuidsControl::NodeStatus& status) {
@@ -1,40 +1,177 @@
 #include "common/Config.hpp"
+#include "common/Logger.hpp"
+#include <algorithm>
 #include <fstream>
 #include <stdexcept>
 
 namespace quids::common {
+    namespace {
+        using nlohmann::json;
+
+        json::json_pointer dotted_pointer(const std::string& key) {
+            std::string path = "/" + key;
+            std::replace(path.begin(), path.end(), '.', '/');
+            return json::json_pointer(path);
+        }
+
+        // Copies data[key] into out, leaving the default when the key is
+        // absent and it is optional
+        template<typename T>
+        void read(const json& data, const std::string& key, T& out, bool required = false) {
+            const auto pointer = dotted_pointer(key);
+            if (!data.contains(pointer)) {
+                if (required) {
+                    throw std::runtime_error("Missing required config key: " + key);
+                }
+                return;
+            }
+            try {
+                out = data.at(pointer).get<T>();
+            } catch (const json::exception& e) {
+                throw std::runtime_error("Config key " + key + ": " + e.what());
+            }
+        }
+    }
+
     Config::Config(const std::string& path) : config_path_(path) {
-        load();
+        reload();
+    }
+
+    Config::~Config() {
+        stop_watching();
     }
 
-    void Config::load() {
+    nlohmann::json::json_pointer Config::to_pointer(const std::string& key) {
+        return dotted_pointer(key);
+    }
+
+    std::shared_ptr<Settings> Config::load(std::filesystem::file_time_type& mtime) const {
+        // Taken before reading, so a write during the read is seen next poll
+        std::error_code ec;
+        mtime = std::filesystem::last_write_time(config_path_, ec);
+
         std::ifstream f(config_path_);
         if(!f.is_open()) {
             throw std::runtime_error("Config file not found: " + config_path_);
         }
+        auto settings = std::make_shared<Settings>();
         try {
-            data_ = nlohmann::json::parse(f);
+            settings->raw = nlohmann::json::parse(f);
         } catch(const nlohmann::json::parse_error& e) {
             throw std::runtime_error("Config parse error: " + std::string(e.what()));
         }
+
+        const auto& data = settings->raw;
+        read(data, "network.port", settings->network.port, true);
+        read(data, "network.stun_server", settings->network.stun_server, true);
+        read(data, "network.enable_upnp", settings->network.enable_upnp);
+        read(data, "network.enable_nat_pmp", settings->network.enable_nat_pmp);
+
+        read(data, "storage.path", settings->storage.path, true);
+        read(data, "storage.cache_size_mb", settings->storage.cache_size_mb);
+
+        read(data, "log.level", settings->log.level);
+        read(data, "log.file", settings->log.file);
+        read(data, "log.console", settings->log.console);
+        read(data, "log.async", settings->log.async);
+
+        read(data, "rollup.batch_size", settings->rollup.batch_size);
+        read(data, "rollup.batch_timeout_ms", settings->rollup.batch_timeout_ms);
+        read(data, "rollup.max_pending_txs", settings->rollup.max_pending_txs);
+        read(data, "rollup.num_worker_threads", settings->rollup.num_worker_threads);
+        return settings;
+    }
+
+    void Config::publish(std::shared_ptr<Settings> settings, std::filesystem::file_time_type mtime) {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        settings->generation = snapshots_.size() + 1;
+        snapshots_.push_back(settings);
+        loaded_mtime_ = mtime;
+        current_.store(settings.get(), std::memory_order_release);
     }
 
     void Config::reload() {
-        load();
-        validate();
+        std::filesystem::file_time_type mtime;
+        auto settings = load(mtime);
+        validate(settings->raw);
+        publish(std::move(settings), mtime);
     }
 
     void Config::validate() const {
+        validate(settings().raw);
+    }
+
+    void Config::validate(const nlohmann::json& data) {
         const std::vector<std::string> required = {
             "network.port",
             "network.stun_server",
             "storage.path"
         };
-        
+
         for(const auto& key : required) {
-            if(!data_.contains(nlohmann::json::json_pointer("/" + key))) {
+            if(!data.contains(to_pointer(key))) {
                 throw std::runtime_error("Missing required config key: " + key);
             }
         }
+
+        RollupSettings rollup;
+        read(data, "rollup.batch_size", rollup.batch_size);
+        read(data, "rollup.max_pending_txs", rollup.max_pending_txs);
+        read(data, "rollup.num_worker_threads", rollup.num_worker_threads);
+        if(rollup.batch_size == 0 || rollup.batch_size > rollup.max_pending_txs) {
+            throw std::runtime_error("rollup.batch_size must be between 1 and rollup.max_pending_txs");
+        }
+        if(rollup.num_worker_threads == 0) {
+            throw std::runtime_error("rollup.num_worker_threads must be at least 1");
+        }
+
+        std::string level = "info";
+        read(data, "log.level", level);
+        if(spdlog::level::from_str(level) == spdlog::level::off && level != "off") {
+            throw std::runtime_error("Unknown log.level: " + level);
+        }
+    }
+
+    void Config::watch(std::chrono::milliseconds interval) {
+        stop_watching();
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        watch_stop_ = false;
+        watcher_ = std::thread(&Config::watch_loop, this, interval);
+    }
+
+    void Config::stop_watching() {
+        {
+            std::lock_guard<std::mutex> lock(watch_mutex_);
+            watch_stop_ = true;
+        }
+        watch_cv_.notify_all();
+        if(watcher_.joinable()) {
+            watcher_.join();
+        }
+    }
+
+    void Config::watch_loop(std::chrono::milliseconds interval) {
+        std::filesystem::file_time_type failed{};
+        std::unique_lock<std::mutex> lock(watch_mutex_);
+        while(!watch_cv_.wait_for(lock, interval, [this] { return watch_stop_; })) {
+            std::error_code ec;
+            const auto mtime = std::filesystem::last_write_time(config_path_, ec);
+            if(ec || mtime == failed) {
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+                if(mtime == loaded_mtime_) {
+                    continue;
+                }
+            }
+            try {
+                reload();
+                QUIDS_LOG_INFO("Reloaded {} (generation {})", config_path_, settings().generation);
+            } catch(const std::exception& e) {
+                failed = mtime;
+                QUIDS_LOG_WARN("Keeping the current config, {} did not load: {}", config_path_, e.what());
+            }
+        }
     }
-} 
\ No newline at end of file
+}
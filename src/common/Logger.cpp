@@ -1,38 +1,131 @@
 #include "common/Logger.hpp"
+#include <chrono>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 namespace quids::common {
     std::shared_ptr<spdlog::logger> Logger::logger_;
 
-    void Logger::init(const std::string& name, 
+    namespace {
+        constexpr auto DEFERRED_IDLE_WAIT = std::chrono::milliseconds(1);
+
+        std::mutex lifecycle_mutex;
+        std::thread deferred_thread;
+        std::atomic<bool> deferred_stop{false};
+        // Completed passes of the drain loop, each of which empties the queue
+        std::atomic<uint64_t> drain_passes{0};
+        // Callers load the logger and queue pointers without a lock, so
+        // replaced ones are kept rather than freed under them
+        std::vector<std::shared_ptr<void>> retired;
+    }
+
+    void Logger::init(const std::string& name,
                      const std::string& logfile,
                      bool console,
-                     bool async) {
+                     bool async,
+                     size_t queue_size) {
+        shutdown();
+        std::lock_guard<std::mutex> lock(lifecycle_mutex);
+
         std::vector<spdlog::sink_ptr> sinks;
-        
+
         if(console) {
             sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
         }
         sinks.push_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>(logfile));
 
+        if(logger_) {
+            retired.push_back(logger_);
+        }
         if(async) {
-            spdlog::init_thread_pool(8192, 1);
+            spdlog::init_thread_pool(queue_size, 1);
+            // A slow disk costs old messages, never a stalled caller
             logger_ = std::make_shared<spdlog::async_logger>(
                 name, sinks.begin(), sinks.end(),
                 spdlog::thread_pool(),
-                spdlog::async_overflow_policy::block
+                spdlog::async_overflow_policy::overrun_oldest
             );
         } else {
             logger_ = std::make_shared<spdlog::logger>(name, sinks.begin(), sinks.end());
         }
 
-        logger_->set_level(spdlog::level::info);
+        logger_->set_level(level_.load(std::memory_order_relaxed));
         logger_->flush_on(spdlog::level::warn);
+        spdlog::drop(name);
         spdlog::register_logger(logger_);
+        raw_.store(logger_.get(), std::memory_order_release);
+
+        if(async) {
+            deferred_stop.store(false);
+            deferred_.store(new DeferredQueue(queue_size), std::memory_order_release);
+            deferred_thread = std::thread(&Logger::drain_deferred);
+        }
+    }
+
+    void Logger::shutdown() {
+        std::lock_guard<std::mutex> lock(lifecycle_mutex);
+        if(deferred_thread.joinable()) {
+            deferred_stop.store(true);
+            deferred_thread.join();
+        }
+        // Late callers format in place from here on
+        if(auto* queue = deferred_.exchange(nullptr, std::memory_order_acq_rel)) {
+            while(auto record = queue->try_pop()) {
+                write(*record);
+            }
+            retired.push_back(std::shared_ptr<DeferredQueue>(queue));
+        }
+        if(logger_) {
+            logger_->flush();
+        }
+    }
+
+    void Logger::drain_deferred() {
+        auto* queue = deferred_.load(std::memory_order_acquire);
+        while(true) {
+            bool idle = true;
+            while(auto record = queue->try_pop()) {
+                write(*record);
+                idle = false;
+            }
+            drain_passes.fetch_add(1, std::memory_order_release);
+            if(deferred_stop.load()) {
+                break;
+            }
+            // Polling keeps the producers free of any notify
+            if(idle) {
+                std::this_thread::sleep_for(DEFERRED_IDLE_WAIT);
+            }
+        }
     }
 
     void Logger::set_level(spdlog::level::level_enum level) {
-        instance()->set_level(level);
+        level_.store(level, std::memory_order_relaxed);
+        target()->set_level(level);
+    }
+
+    void Logger::flush() {
+        // The pass under way may have started before this call; the one after
+        // it cannot have, so once it ends everything queued so far is written
+        if(deferred_.load(std::memory_order_acquire)) {
+            const uint64_t target_pass = drain_passes.load(std::memory_order_acquire) + 2;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while(drain_passes.load(std::memory_order_acquire) < target_pass &&
+                  std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(DEFERRED_IDLE_WAIT);
+            }
+        }
+        target()->flush();
+    }
+
+    uint64_t Logger::dropped() {
+        uint64_t overruns = 0;
+        if(logger_ && dynamic_cast<spdlog::async_logger*>(logger_.get()) && spdlog::thread_pool()) {
+            overruns = spdlog::thread_pool()->overrun_counter();
+        }
+        return dropped_.load(std::memory_order_relaxed) + overruns;
     }
 
     std::shared_ptr<spdlog::logger> Logger::instance() {
@@ -41,4 +134,4 @@ namespace quids::common {
         }
         return logger_;
     }
-} 
\ No newline at end of file
+}
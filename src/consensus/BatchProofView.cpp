@@ -0,0 +1,315 @@
+#include "consensus/BatchProofView.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+namespace quids::consensus {
+
+namespace {
+
+constexpr size_t FLAGS_OFFSET = 1;
+constexpr size_t WITNESS_COUNT_OFFSET = 2;
+constexpr size_t MEASUREMENT_COUNT_OFFSET = 4;
+constexpr size_t TIMESTAMP_OFFSET = 8;
+constexpr size_t TRANSACTION_COUNT_OFFSET = 16;
+constexpr size_t BATCH_HASH_OFFSET = 24;
+constexpr size_t COMMITMENT_OFFSET = BATCH_HASH_OFFSET + proof_wire::HASH_SIZE;
+constexpr size_t QUBITS_OFFSET = COMMITMENT_OFFSET + proof_wire::HASH_SIZE;
+constexpr size_t FIELD_LENGTHS_OFFSET = QUBITS_OFFSET + sizeof(uint32_t);
+constexpr size_t QUORUM_OFFSET = FIELD_LENGTHS_OFFSET + 5 * sizeof(uint32_t);
+constexpr size_t CONFIDENCE_OFFSET = QUORUM_OFFSET + sizeof(double);
+static_assert(CONFIDENCE_OFFSET + sizeof(double) == proof_wire::HEADER_SIZE);
+
+uint64_t load(const uint8_t* p, size_t width) noexcept {
+    uint64_t v = 0;
+    for (size_t i = 0; i < width; ++i) {
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+double loadDouble(const uint8_t* p) noexcept {
+    return std::bit_cast<double>(load(p, sizeof(uint64_t)));
+}
+
+void store(std::vector<uint8_t>& out, uint64_t v, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+void storeDouble(std::vector<uint8_t>& out, double v) {
+    store(out, std::bit_cast<uint64_t>(v), sizeof(uint64_t));
+}
+
+template<typename Container>
+void checkFits(const Container& c, uint64_t limit) {
+    if (c.size() > limit) {
+        throw std::length_error("Batch proof field too large for the wire format");
+    }
+}
+
+} // namespace
+
+crypto::MerkleHash stateCommitment(const quantum::QuantumState& state) {
+    std::vector<uint8_t> amplitudes;
+    amplitudes.reserve(sizeof(uint32_t) + state.size() * 2 * sizeof(uint64_t));
+    store(amplitudes, state.getNumQubits(), sizeof(uint32_t));
+    const auto& vector = state.getStateVector();
+    for (Eigen::Index i = 0; i < vector.size(); ++i) {
+        storeDouble(amplitudes, vector[i].real());
+        storeDouble(amplitudes, vector[i].imag());
+    }
+
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, amplitudes.data(), amplitudes.size());
+    crypto::MerkleHash out;
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+crypto::MerkleHash witnessIdDigest(std::string_view node_id) {
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, node_id.data(), node_id.size());
+    crypto::MerkleHash out;
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+void encodeBatchProof(const OptimizedPOBPC::BatchProof& proof, std::vector<uint8_t>& out) {
+    constexpr uint64_t U16 = std::numeric_limits<uint16_t>::max();
+    constexpr uint64_t U32 = std::numeric_limits<uint32_t>::max();
+    const auto& witnesses = proof.witness_data;
+    const size_t count = witnesses.selected_witnesses.size();
+
+    if (proof.batch_hash.size() != proof_wire::HASH_SIZE) {
+        throw std::length_error("Batch hash must be a 32-byte Merkle root");
+    }
+    if (witnesses.reliability_scores.size() != count || witnesses.verification_times.size() != count ||
+        proof.witness_signatures.size() > count) {
+        throw std::invalid_argument("Witness data does not line up with the selected witnesses");
+    }
+    checkFits(witnesses.selected_witnesses, U16);
+    checkFits(proof.measurements, U32);
+    checkFits(proof.proof_data, U32);
+    checkFits(proof.zkp_data.commitment, U32);
+    checkFits(proof.zkp_data.challenge, U32);
+    checkFits(proof.zkp_data.response, U32);
+    checkFits(proof.zkp_data.recursive_proof, U32);
+
+    uint64_t signature_bytes = 0;
+    for (const auto& signature : proof.witness_signatures) {
+        signature_bytes += signature.size();
+    }
+    if (signature_bytes > U32) {
+        throw std::length_error("Batch proof field too large for the wire format");
+    }
+
+    const auto commitment = stateCommitment(proof.quantum_state);
+
+    out.reserve(out.size() + proof_wire::HEADER_SIZE +
+                proof.measurements.size() * proof_wire::MEASUREMENT_SIZE +
+                count * (proof_wire::WITNESS_SIZE + proof_wire::SIGNATURE_END_SIZE) +
+                proof.proof_data.size() + proof.zkp_data.commitment.size() + proof.zkp_data.challenge.size() +
+                proof.zkp_data.response.size() + proof.zkp_data.recursive_proof.size() + signature_bytes);
+    out.push_back(proof_wire::VERSION);
+    out.push_back(witnesses.has_consensus ? 1 : 0);
+    store(out, count, sizeof(uint16_t));
+    store(out, proof.measurements.size(), sizeof(uint32_t));
+    store(out, proof.timestamp, sizeof(uint64_t));
+    store(out, proof.transaction_count, sizeof(uint64_t));
+    out.insert(out.end(), proof.batch_hash.begin(), proof.batch_hash.end());
+    out.insert(out.end(), commitment.begin(), commitment.end());
+    store(out, proof.quantum_state.getNumQubits(), sizeof(uint32_t));
+    store(out, proof.proof_data.size(), sizeof(uint32_t));
+    store(out, proof.zkp_data.commitment.size(), sizeof(uint32_t));
+    store(out, proof.zkp_data.challenge.size(), sizeof(uint32_t));
+    store(out, proof.zkp_data.response.size(), sizeof(uint32_t));
+    store(out, proof.zkp_data.recursive_proof.size(), sizeof(uint32_t));
+    storeDouble(out, witnesses.quorum_threshold);
+    storeDouble(out, proof.zkp_data.verification_confidence);
+
+    for (const auto& m : proof.measurements) {
+        store(out, m.outcome, sizeof(uint64_t));
+        storeDouble(out, m.fidelity);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const auto id = witnessIdDigest(witnesses.selected_witnesses[i]);
+        out.insert(out.end(), id.begin(), id.end());
+        storeDouble(out, witnesses.reliability_scores[i]);
+        store(out, witnesses.verification_times[i], sizeof(uint64_t));
+    }
+    // Witnesses past the last signature signed nothing
+    uint64_t end = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (i < proof.witness_signatures.size()) {
+            end += proof.witness_signatures[i].size();
+        }
+        store(out, end, sizeof(uint32_t));
+    }
+
+    out.insert(out.end(), proof.proof_data.begin(), proof.proof_data.end());
+    out.insert(out.end(), proof.zkp_data.commitment.begin(), proof.zkp_data.commitment.end());
+    out.insert(out.end(), proof.zkp_data.challenge.begin(), proof.zkp_data.challenge.end());
+    out.insert(out.end(), proof.zkp_data.response.begin(), proof.zkp_data.response.end());
+    out.insert(out.end(), proof.zkp_data.recursive_proof.begin(), proof.zkp_data.recursive_proof.end());
+    for (const auto& signature : proof.witness_signatures) {
+        out.insert(out.end(), signature.begin(), signature.end());
+    }
+}
+
+BatchProofView::BatchProofView(std::span<const uint8_t> bytes) noexcept
+    : bytes_(bytes)
+    , measurements_(load(bytes.data() + MEASUREMENT_COUNT_OFFSET, sizeof(uint32_t)))
+    , witnesses_(load(bytes.data() + WITNESS_COUNT_OFFSET, sizeof(uint16_t))) {
+    witness_table_ = proof_wire::HEADER_SIZE + measurements_ * proof_wire::MEASUREMENT_SIZE;
+    signature_ends_ = witness_table_ + witnesses_ * proof_wire::WITNESS_SIZE;
+    field_offsets_[0] = signature_ends_ + witnesses_ * proof_wire::SIGNATURE_END_SIZE;
+    for (size_t f = 0; f < FIELDS; ++f) {
+        field_offsets_[f + 1] = field_offsets_[f] +
+            load(bytes.data() + FIELD_LENGTHS_OFFSET + f * sizeof(uint32_t), sizeof(uint32_t));
+    }
+}
+
+std::optional<BatchProofView> BatchProofView::parse(std::span<const uint8_t> bytes) noexcept {
+    if (bytes.size() < proof_wire::HEADER_SIZE || bytes[0] != proof_wire::VERSION ||
+        (bytes[FLAGS_OFFSET] & ~uint8_t{1}) != 0) {
+        return std::nullopt;
+    }
+
+    // Counts and lengths are at most 32 bits, so none of these sums overflow
+    BatchProofView view(bytes);
+    const size_t signatures = view.field_offsets_[FIELDS];
+    if (signatures > bytes.size()) {
+        return std::nullopt;
+    }
+    uint64_t previous = 0;
+    for (size_t i = 0; i < view.witnesses_; ++i) {
+        const uint64_t end = load(bytes.data() + view.signature_ends_ + i * proof_wire::SIGNATURE_END_SIZE,
+                                  sizeof(uint32_t));
+        if (end < previous) {
+            return std::nullopt;
+        }
+        previous = end;
+    }
+    if (signatures + previous != bytes.size()) {
+        return std::nullopt;
+    }
+    return view;
+}
+
+uint64_t BatchProofView::timestamp() const noexcept {
+    return load(bytes_.data() + TIMESTAMP_OFFSET, sizeof(uint64_t));
+}
+
+uint64_t BatchProofView::transactionCount() const noexcept {
+    return load(bytes_.data() + TRANSACTION_COUNT_OFFSET, sizeof(uint64_t));
+}
+
+std::span<const uint8_t, proof_wire::HASH_SIZE> BatchProofView::batchHash() const noexcept {
+    return bytes_.subspan<BATCH_HASH_OFFSET, proof_wire::HASH_SIZE>();
+}
+
+std::span<const uint8_t, proof_wire::HASH_SIZE> BatchProofView::stateCommitment() const noexcept {
+    return bytes_.subspan<COMMITMENT_OFFSET, proof_wire::HASH_SIZE>();
+}
+
+size_t BatchProofView::stateQubits() const noexcept {
+    return load(bytes_.data() + QUBITS_OFFSET, sizeof(uint32_t));
+}
+
+double BatchProofView::quorumThreshold() const noexcept {
+    return loadDouble(bytes_.data() + QUORUM_OFFSET);
+}
+
+double BatchProofView::zkpConfidence() const noexcept {
+    return loadDouble(bytes_.data() + CONFIDENCE_OFFSET);
+}
+
+BatchProofView::Measurement BatchProofView::measurement(size_t i) const noexcept {
+    const uint8_t* p = bytes_.data() + proof_wire::HEADER_SIZE + i * proof_wire::MEASUREMENT_SIZE;
+    return Measurement{load(p, sizeof(uint64_t)), loadDouble(p + sizeof(uint64_t))};
+}
+
+std::span<const uint8_t, proof_wire::HASH_SIZE> BatchProofView::witnessId(size_t i) const noexcept {
+    return bytes_.subspan(witness_table_ + i * proof_wire::WITNESS_SIZE).first<proof_wire::HASH_SIZE>();
+}
+
+double BatchProofView::witnessReliability(size_t i) const noexcept {
+    return loadDouble(bytes_.data() + witness_table_ + i * proof_wire::WITNESS_SIZE + proof_wire::HASH_SIZE);
+}
+
+uint64_t BatchProofView::witnessVerificationTime(size_t i) const noexcept {
+    return load(bytes_.data() + witness_table_ + i * proof_wire::WITNESS_SIZE + proof_wire::HASH_SIZE +
+                sizeof(double), sizeof(uint64_t));
+}
+
+std::span<const uint8_t> BatchProofView::witnessSignature(size_t i) const noexcept {
+    const uint8_t* ends = bytes_.data() + signature_ends_;
+    const size_t begin = i == 0 ? 0 : load(ends + (i - 1) * proof_wire::SIGNATURE_END_SIZE, sizeof(uint32_t));
+    const size_t end = load(ends + i * proof_wire::SIGNATURE_END_SIZE, sizeof(uint32_t));
+    return bytes_.subspan(field_offsets_[FIELDS] + begin, end - begin);
+}
+
+bool BatchProofView::hasQuorum() const noexcept {
+    if (witnesses_ == 0) {
+        return false;
+    }
+    double total_weight = 0.0;
+    double verified_weight = 0.0;
+    for (size_t i = 0; i < witnesses_; ++i) {
+        const double reliability = witnessReliability(i);
+        total_weight += reliability;
+        if (witnessVerificationTime(i) > 0) {
+            verified_weight += reliability;
+        }
+    }
+    return total_weight > 0.0 && (verified_weight / total_weight) >= quorumThreshold();
+}
+
+double BatchProofView::calculateConfidence() const noexcept {
+    double total_weight = 0.0;
+    double valid_weight = 0.0;
+    for (size_t i = 0; i < witnesses_; ++i) {
+        const double reliability = witnessReliability(i);
+        total_weight += reliability;
+        if (!witnessSignature(i).empty()) {
+            valid_weight += reliability;
+        }
+    }
+    return total_weight > 0.0 ? valid_weight / total_weight : 0.0;
+}
+
+bool BatchProofView::isValid() const noexcept {
+    bool signed_by_any = false;
+    for (size_t i = 0; i < witnesses_ && !signed_by_any; ++i) {
+        signed_by_any = !witnessSignature(i).empty();
+    }
+    return timestamp() > 0 &&
+           transactionCount() > 0 &&
+           !proofData().empty() &&
+           signed_by_any &&
+           quorumThreshold() >= 0.66;
+}
+
+bool BatchProofView::isReadyForConsensus() const noexcept {
+    const double zkp_confidence = zkpConfidence();
+    return isValid() &&
+           !zkpCommitment().empty() &&
+           !zkpChallenge().empty() &&
+           !zkpResponse().empty() &&
+           zkp_confidence >= 0.0 && zkp_confidence <= 1.0 &&
+           hasQuorum() &&
+           calculateConfidence() >= quorumThreshold();
+}
+
+bool BatchProofView::commitsTo(const quantum::QuantumState& state) const {
+    const auto expected = consensus::stateCommitment(state);
+    return std::equal(expected.begin(), expected.end(), stateCommitment().begin());
+}
+
+} // namespace quids::consensus
@@ -1,48 +1,159 @@
 #include "consensus/OptimizedPOBPC.hpp"
-#include <omp.h>
-#include <immintrin.h>
+#include "consensus/BatchProofView.hpp"
+#include "blockchain/TransactionView.hpp"
 #include <chrono>
-#include <random>
 #include <algorithm>
+#include <bit>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
 #include <numeric>
-#include "crypto/QuantumCrypto.hpp"
-#include "quantum/QuantumTypes.hpp"
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include "crypto/blake3/BatchHasher.hpp"
+#include "crypto/signature/BatchVerifier.hpp"
+#include "crypto/signature/Falcon.hpp"
+#include "utils/RandomService.hpp"
+#include "utils/Tracing.hpp"
+#include "zkp/QZKPVerifier.hpp"
+#include "utils/WorkStealingPool.hpp"
 
 namespace quids {
 namespace consensus {
 
+namespace {
+
+// Bounded hand-off between two pipeline stages. push() blocks while the
+// channel is full, which is the pipeline's backpressure; pop() blocks
+// while it is empty and returns nothing once it is closed and drained.
+template<typename T>
+class StageChannel {
+public:
+    explicit StageChannel(size_t capacity) : capacity_(capacity) {}
+
+    // Returns true if the caller had to wait for room
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const bool waited = items_.size() >= capacity_;
+        not_full_.wait(lock, [&] { return items_.size() < capacity_; });
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return waited;
+    }
+
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [&] { return !items_.empty() || closed_; });
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return item;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+private:
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::deque<T> items_;
+    bool closed_{false};
+};
+
+class LatencyHistogram {
+public:
+    void record(std::chrono::microseconds elapsed) noexcept {
+        const auto us = static_cast<uint64_t>(std::max<int64_t>(1, elapsed.count()));
+        const size_t bucket = std::min<size_t>(OptimizedPOBPC::LATENCY_BUCKETS - 1, std::bit_width(us) - 1);
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_us_.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    OptimizedPOBPC::StageLatency snapshot() const noexcept {
+        OptimizedPOBPC::StageLatency out;
+        for (size_t i = 0; i < OptimizedPOBPC::LATENCY_BUCKETS; ++i) {
+            out.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        out.count = count_.load(std::memory_order_relaxed);
+        out.mean_us = out.count == 0 ? 0.0 :
+            static_cast<double>(total_us_.load(std::memory_order_relaxed)) / static_cast<double>(out.count);
+        return out;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, OptimizedPOBPC::LATENCY_BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_us_{0};
+};
+
+std::chrono::microseconds elapsedSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+// Bounds from the static configuration; the SLO is the verification budget
+utils::AdaptiveBatchController::Config batchingConfig(const BatchConfig& config) {
+    utils::AdaptiveBatchController::Config c;
+    c.min_batch_size = 1;
+    c.max_batch_size = std::max<size_t>(1, config.batch_size);
+    c.max_wait = std::max(config.batch_timeout, c.min_wait);
+    c.latency_target = std::chrono::milliseconds(std::max<size_t>(1, config.max_batch_verification_time));
+    return c;
+}
+
+// The state a batch is proven against: five qubits, one amplitude per
+// byte of the 32-byte batch hash, so every node rebuilds it bit for bit
+constexpr size_t PROOF_QUBITS = 5;
+constexpr size_t PROOF_MEASUREMENTS = 10;
+
+quantum::QuantumState stateFromHash(const std::vector<uint8_t>& batch_hash) {
+    quantum::StateVector amplitudes(size_t{1} << PROOF_QUBITS);
+    for (Eigen::Index i = 0; i < amplitudes.size(); ++i) {
+        const size_t byte = static_cast<size_t>(i);
+        amplitudes[i] = 1.0 + (byte < batch_hash.size() ? batch_hash[byte] : 0);
+    }
+    amplitudes.normalize();
+    return quantum::QuantumState(amplitudes);
+}
+
+// Measurement i reads the basis state named by hash byte i; its fidelity
+// is that basis state's probability
+std::vector<quantum::QuantumMeasurement> measureState(const quantum::QuantumState& state,
+                                                      const std::vector<uint8_t>& batch_hash) {
+    const auto& amplitudes = state.getStateVector();
+    std::vector<quantum::QuantumMeasurement> measurements(std::min(PROOF_MEASUREMENTS, batch_hash.size()));
+    for (size_t i = 0; i < measurements.size(); ++i) {
+        measurements[i].outcome = batch_hash[i] % static_cast<size_t>(amplitudes.size());
+        measurements[i].fidelity = std::norm(amplitudes[static_cast<Eigen::Index>(measurements[i].outcome)]);
+    }
+    return measurements;
+}
+
+double elapsedMillis(std::chrono::microseconds elapsed) {
+    return static_cast<double>(elapsed.count()) / 1000.0;
+}
+
+} // namespace
+
 class OptimizedPOBPC::Impl {
 public:
     explicit Impl(const BatchConfig& config)
         : config_(config)
-        , quantum_crypto_(crypto::QuantumEncryptionParams{
-              .key_size = 256,
-              .num_rounds = 10,
-              .noise_threshold = 0.01,
-              .use_error_correction = config.enable_error_correction,
-              .security_parameter = 128
-          })
-        , batch_buffer_()
-        , transaction_queue_()
-        , witnesses_()
-        , metrics_() {
-        initializeQuantumContext();
-    }
-
-    void initializeQuantumContext() {
-        quantum_context_.consensus_state = quantum::detail::classicalToQuantum(
-            std::vector<uint8_t>(config_.num_qubits / 8, 0));
-        quantum_context_.verification_circuit = quantum::QuantumCircuit(
-            quantum::QuantumCircuitConfig{
-                .num_qubits = config_.num_qubits,
-                .max_depth = config_.quantum_circuit_depth,
-                .error_rate = 0.001,
-                .use_error_correction = config_.enable_error_correction,
-                .allowed_gates = {quantum::GateType::HADAMARD,
-                                quantum::GateType::CNOT,
-                                quantum::GateType::PHASE},
-                .num_measurements = 10
-            });
+        , batching_(batchingConfig(config)) {}
+
+    ~Impl() {
+        stopPipeline();
     }
 
     bool addTransaction(const std::vector<uint8_t>& transaction) {
@@ -55,102 +166,133 @@ public:
     }
 
     BatchProof generateBatchProof() {
-        auto start_time = std::chrono::high_resolution_clock::now();
-        
-        // Collect transactions into batch
-        std::vector<std::vector<uint8_t>> batch;
-        batch.reserve(config_.batch_size);
-        
-        while (batch.size() < config_.batch_size) {
-            if (auto tx = transaction_queue_.pop()) {
-                batch.push_back(std::move(*tx));
-            } else {
-                break;
-            }
+        auto batch = collectBatch(false);
+        if (!batch) {
+            return BatchProof{};
         }
+        proveBatch(*batch);
+        return gatherWitnesses(std::move(*batch));
+    }
 
-        if (batch.empty()) {
-            return BatchProof{};
+    void startPipeline(std::function<void(BatchProof&&)> on_proof) {
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        if (!pipeline_threads_.empty()) {
+            throw std::logic_error("Consensus pipeline already running");
         }
+        pipeline_stopping_.store(false);
+        to_prove_ = std::make_unique<StageChannel<PendingBatch>>(config_.pipeline_depth);
+        to_witness_ = std::make_unique<StageChannel<PendingBatch>>(config_.pipeline_depth);
+
+        // Each stage closes its output when its input ends, so stopping
+        // drains the batches already inside the pipeline in order
+        pipeline_threads_.emplace_back([this] {
+            while (!pipeline_stopping_.load()) {
+                if (auto batch = collectBatch(true)) {
+                    if (to_prove_->push(std::move(*batch))) {
+                        pipeline_waits_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+            to_prove_->close();
+        });
+        pipeline_threads_.emplace_back([this] {
+            while (auto batch = to_prove_->pop()) {
+                proveBatch(*batch);
+                if (to_witness_->push(std::move(*batch))) {
+                    pipeline_waits_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            to_witness_->close();
+        });
+        pipeline_threads_.emplace_back([this, on_proof = std::move(on_proof)] {
+            while (auto batch = to_witness_->pop()) {
+                BatchProof proof = gatherWitnesses(std::move(*batch));
+                pipeline_completed_.fetch_add(1, std::memory_order_relaxed);
+                if (on_proof) {
+                    on_proof(std::move(proof));
+                }
+            }
+        });
+    }
 
-        // Process batch using SIMD
-        processBatchSIMD(batch);
+    void stopPipeline() {
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        pipeline_stopping_.store(true);
+        for (auto& thread : pipeline_threads_) {
+            thread.join();
+        }
+        pipeline_threads_.clear();
+        to_prove_.reset();
+        to_witness_.reset();
+    }
 
-        // Generate quantum proof
-        auto quantum_proof = generateQuantumProof(batch);
-        
-        // Select witnesses
-        auto witnesses = selectWitnessesRandomly(config_.witness_count);
-        
-        // Create batch hash
-        auto batch_hash = createBatchHash(batch);
-        
-        // Generate proof
-        BatchProof proof{
-            .timestamp = std::chrono::system_clock::now().time_since_epoch().count(),
-            .transaction_count = batch.size(),
-            .batch_hash = std::move(batch_hash),
-            .proof_data = {},
-            .witness_signatures = {},
-            .quantum_proof = std::move(quantum_proof),
-            .quantum_measurements = {}
+    PipelineStats getPipelineStats() const {
+        return PipelineStats{
+            .collect = collect_latency_.snapshot(),
+            .prove = prove_latency_.snapshot(),
+            .witness = witness_latency_.snapshot(),
+            .backpressure_waits = pipeline_waits_.load(std::memory_order_relaxed),
+            .batches_completed = pipeline_completed_.load(std::memory_order_relaxed),
+            .batching = batching_.stats()
         };
+    }
 
-        // Collect witness signatures in parallel
-        #pragma omp parallel for
-        for (size_t i = 0; i < witnesses.size(); ++i) {
-            auto& witness = witnesses[i];
-            auto key = crypto::utils::deriveQuantumKey(witness.quantum_state);
-            auto signature = quantum_crypto_.signQuantum(proof.batch_hash, key);
-            #pragma omp critical
-            {
-                proof.witness_signatures.push_back(std::move(signature.signature));
-            }
+    bool verifyBatchProof(const BatchProof& proof) {
+        if (!validateBatchStructure(proof) ||
+            !verifyQuantumProof(proof.quantum_state, proof.measurements.size(),
+                                [&](size_t i) { return proof.measurements[i]; },
+                                proof.batch_hash)) {
+            return false;
         }
 
-        // Update metrics
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
-            end_time - start_time);
-        recordMetrics(proof, duration);
-
-        return proof;
+        std::vector<std::optional<size_t>> signers;
+        {
+            std::lock_guard<std::mutex> lock(witness_mutex_);
+            for (const auto& id : proof.witness_data.selected_witnesses) {
+                signers.push_back(witnessIndex(id));
+            }
+        }
+        return hasQuorum(signers, [&](size_t i) { return std::span<const uint8_t>(proof.witness_signatures[i]); },
+                         proof.batch_hash);
     }
 
-    bool verifyBatchProof(const BatchProof& proof) {
-        if (!validateBatchStructure(proof)) {
+    bool verifyBatchProof(std::span<const uint8_t> encoded) {
+        const auto view = BatchProofView::parse(encoded);
+        if (!view || !validateBatchStructure(*view)) {
             return false;
         }
 
-        // Verify quantum proof
-        if (!verifyQuantumProof(proof.quantum_proof, proof.batch_hash)) {
+        // The state is rebuilt from the batch hash and pinned by the
+        // commitment, so it never has to cross the wire
+        const auto batch_hash_bytes = view->batchHash();
+        const std::vector<uint8_t> batch_hash(batch_hash_bytes.begin(), batch_hash_bytes.end());
+        const auto expected_state = stateFromHash(batch_hash);
+        if (!view->commitsTo(expected_state) ||
+            !verifyQuantumProof(expected_state, view->measurementCount(), [&](size_t i) {
+                const auto m = view->measurement(i);
+                quantum::QuantumMeasurement measurement;
+                measurement.outcome = m.outcome;
+                measurement.fidelity = m.fidelity;
+                return measurement;
+            }, batch_hash)) {
             return false;
         }
 
-        // Verify witness signatures in parallel
-        std::vector<bool> signature_results(proof.witness_signatures.size());
-        
-        #pragma omp parallel for
-        for (size_t i = 0; i < proof.witness_signatures.size(); ++i) {
-            const auto& signature = proof.witness_signatures[i];
-            const auto& witness = witnesses_[i];
-            auto key = crypto::utils::deriveQuantumKey(witness.quantum_state);
-            
-            crypto::QuantumSignature quantum_sig{
-                .signature = signature,
-                .proof = proof.quantum_proof,
-                .verification_score = 0.0
-            };
-            
-            signature_results[i] = quantum_crypto_.verifyQuantumSignature(
-                proof.batch_hash, quantum_sig, key);
+        // Witnesses travel as digests of their ids
+        std::vector<std::optional<size_t>> signers(view->witnessCount());
+        {
+            std::lock_guard<std::mutex> lock(witness_mutex_);
+            for (size_t w = 0; w < witnesses_.size(); ++w) {
+                const auto digest = witnessIdDigest(witnesses_[w].node_id);
+                for (size_t i = 0; i < signers.size(); ++i) {
+                    const auto id = view->witnessId(i);
+                    if (std::equal(digest.begin(), digest.end(), id.begin())) {
+                        signers[i] = w;
+                    }
+                }
+            }
         }
-
-        // Check if we have enough valid signatures
-        size_t valid_signatures = std::count(
-            signature_results.begin(), signature_results.end(), true);
-            
-        return valid_signatures >= (config_.witness_count * config_.consensus_threshold);
+        return hasQuorum(signers, [&](size_t i) { return view->witnessSignature(i); }, batch_hash);
     }
 
     bool registerWitness(const std::string& node_id, const std::vector<uint8_t>& public_key) {
@@ -158,15 +300,15 @@ public:
             return false;
         }
 
-        WitnessInfo witness{
-            .node_id = node_id,
-            .public_key = public_key,
-            .reliability_score = 1.0,
-            .last_active = std::chrono::system_clock::now().time_since_epoch().count(),
-            .quantum_state = quantum::detail::classicalToQuantum(public_key)
-        };
-
-        witnesses_.push_back(std::move(witness));
+        std::lock_guard<std::mutex> lock(witness_mutex_);
+        if (witnessIndex(node_id)) {
+            return false;
+        }
+        WitnessInfo& witness = witnesses_.emplace_back();
+        witness.node_id = node_id;
+        witness.public_key = public_key;
+        witness.last_active = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        witness.quantum_state = stateFromHash(public_key);
         return true;
     }
 
@@ -174,28 +316,23 @@ public:
         return selectWitnessesRandomly(config_.witness_count);
     }
 
+    // A vote is the witness's own signature over the batch hash, checked
+    // against the key it registered with
     bool submitWitnessVote(const std::string& witness_id,
                           const std::vector<uint8_t>& signature,
                           const BatchProof& proof) {
-        auto it = std::find_if(witnesses_.begin(), witnesses_.end(),
-            [&](const auto& w) { return w.node_id == witness_id; });
-            
-        if (it == witnesses_.end()) {
-            return false;
+        std::vector<uint8_t> public_key;
+        {
+            std::lock_guard<std::mutex> lock(witness_mutex_);
+            const auto index = witnessIndex(witness_id);
+            if (!index) {
+                return false;
+            }
+            public_key = witnesses_[*index].public_key;
         }
 
-        auto& witness = *it;
-        auto key = crypto::utils::deriveQuantumKey(witness.quantum_state);
-        
-        crypto::QuantumSignature quantum_sig{
-            .signature = signature,
-            .proof = proof.quantum_proof,
-            .verification_score = 0.0
-        };
-
-        bool valid = quantum_crypto_.verifyQuantumSignature(
-            proof.batch_hash, quantum_sig, key);
-            
+        const crypto::VerifyItem item{crypto::SignatureScheme::Falcon512, proof.batch_hash, signature, public_key};
+        const bool valid = crypto::BatchVerifier::global().verify(std::span(&item, 1)).front() != 0;
         updateWitnessReliability(witness_id, valid);
         return valid;
     }
@@ -212,13 +349,18 @@ public:
         // Calculate quantum security score
         double quantum_score = calculateQuantumSecurityScore(proof);
         
-        // Calculate witness confidence
+        // Witness confidence is the mean reliability of the witnesses that signed
         std::vector<double> witness_scores;
-        witness_scores.reserve(proof.witness_signatures.size());
-        
-        for (size_t i = 0; i < proof.witness_signatures.size(); ++i) {
-            const auto& witness = witnesses_[i];
-            witness_scores.push_back(witness.reliability_score.load());
+        {
+            std::lock_guard<std::mutex> lock(witness_mutex_);
+            for (const auto& id : proof.witness_data.selected_witnesses) {
+                if (const auto index = witnessIndex(id)) {
+                    witness_scores.push_back(witnesses_[*index].reliability_score);
+                }
+            }
+        }
+        if (witness_scores.empty()) {
+            return 0.0;
         }
         
         double witness_confidence = std::accumulate(
@@ -232,249 +374,447 @@ public:
     }
 
     ConsensusMetrics getMetrics() const {
+        std::lock_guard<std::mutex> lock(metrics_mutex_);
         return metrics_;
     }
 
+    void updateConfig(const BatchConfig& config) {
+        if (!config.isValid()) {
+            throw std::invalid_argument("Invalid consensus configuration");
+        }
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        if (!pipeline_threads_.empty()) {
+            throw std::logic_error("Cannot reconfigure a running consensus pipeline");
+        }
+        config_ = config;
+    }
+
+    BatchConfig getConfig() const {
+        return config_;
+    }
+
 private:
+    // A batch on its way through the pipeline stages
+    struct PendingBatch {
+        std::vector<std::vector<uint8_t>> transactions;
+        std::vector<crypto::MerkleHash> tx_digests;
+        std::vector<uint8_t> batch_hash;
+        quantum::QuantumState quantum_state;
+        std::vector<quantum::QuantumMeasurement> measurements;
+        std::chrono::high_resolution_clock::time_point started;
+        std::chrono::microseconds prove_time{0};
+        size_t limit{0};          // batch size in force when it was cut
+        utils::TraceId trace{0};  // named after batch_hash
+    };
+
+    // This node's signing key for one witness slot in one key epoch. The
+    // key of the epoch before is kept for proofs made just before a rotation.
+    struct WitnessKey {
+        std::shared_ptr<const crypto::SigningKey> signing;
+        std::vector<uint8_t> public_key;
+        std::vector<uint8_t> previous_public_key;
+        uint64_t epoch{0};
+    };
+
     BatchConfig config_;
-    crypto::QuantumCrypto quantum_crypto_;
-    BatchBuffer batch_buffer_;
     utils::LockFreeQueue<std::vector<uint8_t>> transaction_queue_;
+    mutable std::mutex witness_mutex_;
     std::vector<WitnessInfo> witnesses_;
+    mutable std::mutex metrics_mutex_;
     ConsensusMetrics metrics_;
-    QuantumSecurityContext quantum_context_;
-
-    void processBatchSIMD(std::vector<std::vector<uint8_t>>& batch) {
-        constexpr size_t VECTOR_SIZE = 32;  // 256-bit SIMD
-        
-        #pragma omp parallel for
-        for (size_t i = 0; i < batch.size(); i += VECTOR_SIZE) {
-            size_t remaining = std::min(VECTOR_SIZE, batch.size() - i);
-            __m256i data[remaining];
-            
-            // Load data into SIMD registers
-            for (size_t j = 0; j < remaining; ++j) {
-                auto& tx = batch[i + j];
-                if (tx.size() >= 32) {
-                    data[j] = _mm256_loadu_si256(
-                        reinterpret_cast<const __m256i*>(tx.data()));
-                }
-            }
-            
-            // Process data using SIMD instructions
-            for (size_t j = 0; j < remaining; ++j) {
-                // Apply SIMD operations (example: XOR with previous)
-                if (j > 0) {
-                    data[j] = _mm256_xor_si256(data[j], data[j-1]);
+    std::atomic<uint64_t> batches_{0};
+
+    // Pipeline
+    std::mutex pipeline_mutex_;
+    std::vector<std::thread> pipeline_threads_;
+    std::atomic<bool> pipeline_stopping_{false};
+    std::unique_ptr<StageChannel<PendingBatch>> to_prove_;
+    std::unique_ptr<StageChannel<PendingBatch>> to_witness_;
+    LatencyHistogram collect_latency_;
+    LatencyHistogram prove_latency_;
+    LatencyHistogram witness_latency_;
+    std::atomic<uint64_t> pipeline_waits_{0};
+    std::atomic<uint64_t> pipeline_completed_{0};
+    utils::AdaptiveBatchController batching_;
+
+    // Witness key cache, parallel to witnesses_
+    std::mutex key_mutex_;
+    std::vector<std::shared_ptr<const WitnessKey>> witness_keys_;
+
+    // Stage 1: collect transactions, run the SIMD pass and hash the batch.
+    // With wait set, holds a partial batch until batch_timeout has passed
+    // since its first transaction or the pipeline is stopping.
+    std::optional<PendingBatch> collectBatch(bool wait) {
+        const size_t batch_size = config_.adaptive_batching ? batching_.batchSize() : config_.batch_size;
+        const auto batch_timeout = config_.adaptive_batching ? batching_.waitTime() : config_.batch_timeout;
+
+        PendingBatch pending;
+        pending.limit = batch_size;
+        pending.transactions.reserve(batch_size);
+        std::chrono::steady_clock::time_point first_seen;
+
+        while (pending.transactions.size() < batch_size) {
+            if (auto tx = transaction_queue_.pop()) {
+                if (pending.transactions.empty()) {
+                    first_seen = std::chrono::steady_clock::now();
+                    pending.started = std::chrono::high_resolution_clock::now();
                 }
+                pending.transactions.push_back(std::move(*tx));
+                continue;
             }
-            
-            // Store results back
-            for (size_t j = 0; j < remaining; ++j) {
-                auto& tx = batch[i + j];
-                if (tx.size() >= 32) {
-                    _mm256_storeu_si256(
-                        reinterpret_cast<__m256i*>(tx.data()), data[j]);
-                }
+            if (!wait || pipeline_stopping_.load() ||
+                (!pending.transactions.empty() &&
+                 std::chrono::steady_clock::now() - first_seen >= batch_timeout)) {
+                break;
             }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        if (pending.transactions.empty()) {
+            return std::nullopt;
         }
+
+        const auto stage_start = std::chrono::steady_clock::now();
+        pending.tx_digests = crypto::BatchHasher::hashMany(pending.transactions);
+        pending.batch_hash = createBatchHash(pending.tx_digests);
+        collect_latency_.record(elapsedSince(stage_start));
+        traceCollected(pending, stage_start);
+        return pending;
     }
 
-    std::vector<uint8_t> createBatchHash(
-        const std::vector<std::vector<uint8_t>>& transactions) {
-        // Use SIMD for parallel hashing
-        constexpr size_t HASH_SIZE = 32;
-        std::vector<uint8_t> combined_hash(HASH_SIZE);
-        
-        #pragma omp parallel
+    // Stage 2: generate the quantum proof
+    void proveBatch(PendingBatch& pending) {
+        utils::Span span("consensus.prove", pending.trace);
+        const auto stage_start = std::chrono::steady_clock::now();
+        pending.quantum_state = stateFromHash(pending.batch_hash);
+        pending.measurements = measureState(pending.quantum_state, pending.batch_hash);
+        pending.prove_time = elapsedSince(stage_start);
+        prove_latency_.record(pending.prove_time);
+    }
+
+    // Stage 3: select witnesses and collect their signatures
+    BatchProof gatherWitnesses(PendingBatch&& pending) {
+        utils::Span span("consensus.witness", pending.trace);
+        const auto stage_start = std::chrono::steady_clock::now();
+
+        BatchProof proof;
+        proof.timestamp = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        proof.transaction_count = pending.transactions.size();
+        proof.batch_hash = std::move(pending.batch_hash);
+        const auto commitment = stateCommitment(pending.quantum_state);
+        proof.proof_data.assign(commitment.begin(), commitment.end());
+        proof.quantum_state = std::move(pending.quantum_state);
+        proof.measurements = std::move(pending.measurements);
+
+        std::vector<size_t> witnesses;
+        size_t witness_total = 0;
         {
-            std::vector<uint8_t> local_hash(HASH_SIZE);
-            #pragma omp for nowait
-            for (const auto& tx : transactions) {
-                auto tx_hash = quantum_crypto_.encryptQuantum(
-                    tx, crypto::utils::deriveQuantumKey(quantum_context_.consensus_state));
-                    
-                // XOR with local hash
-                for (size_t i = 0; i < HASH_SIZE; ++i) {
-                    local_hash[i] ^= tx_hash[i];
-                }
-            }
-            
-            // Combine local results
-            #pragma omp critical
-            {
-                for (size_t i = 0; i < HASH_SIZE; ++i) {
-                    combined_hash[i] ^= local_hash[i];
-                }
+            std::lock_guard<std::mutex> lock(witness_mutex_);
+            witnesses = selectWitnessIndices(config_.witness_count);
+            witness_total = witnesses_.size();
+            for (size_t index : witnesses) {
+                proof.witness_data.selected_witnesses.push_back(witnesses_[index].node_id);
+                proof.witness_data.reliability_scores.push_back(witnesses_[index].reliability_score);
             }
         }
-        
-        return combined_hash;
+
+        // Sign in parallel on the shared pool, each task writing its own slot
+        const auto keys = witnessKeys(witnesses, witness_total);
+        proof.witness_signatures.resize(witnesses.size());
+        proof.witness_data.verification_times.resize(witnesses.size());
+        utils::WorkStealingPool::global().parallel_for(0, witnesses.size(), [&](size_t i) {
+            proof.witness_signatures[i] = keys[i]->signing->sign(proof.batch_hash);
+            proof.witness_data.verification_times[i] =
+                static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        }, utils::TaskPriority::Consensus);
+        proof.witness_data.quorum_threshold = config_.consensus_threshold;
+        proof.witness_data.has_consensus = witnesses.size() >= config_.witness_count * config_.consensus_threshold;
+        const auto witness_time = elapsedSince(stage_start);
+        witness_latency_.record(witness_time);
+
+        size_t total_bytes = 0;
+        for (const auto& tx : pending.transactions) {
+            total_bytes += tx.size();
+        }
+        proof.metrics.avg_transaction_size = static_cast<double>(total_bytes) / proof.transaction_count;
+        proof.metrics.proof_generation_time = std::max(elapsedMillis(pending.prove_time), 1e-3);
+        proof.metrics.verification_time = std::max(elapsedMillis(witness_time), 1e-3);
+
+        // Update metrics
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - pending.started);
+        recordMetrics(proof, duration);
+        if (config_.adaptive_batching) {
+            batching_.observe(proof.transaction_count, pending.limit, duration, transaction_queue_.size());
+        }
+        return proof;
     }
 
-    quantum::QuantumProof generateQuantumProof(
-        const std::vector<std::vector<uint8_t>>& transactions) {
-        // Prepare quantum state
-        auto initial_state = quantum::detail::classicalToQuantum(createBatchHash(transactions));
-        
-        // Apply quantum circuit
-        std::vector<quantum::GateOperation> operations;
-        operations.reserve(config_.quantum_circuit_depth);
-        
-        // Add quantum operations
-        for (size_t i = 0; i < config_.quantum_circuit_depth; ++i) {
-            operations.push_back(quantum::GateOperation{
-                .type = quantum::GateType::HADAMARD,
-                .qubits = {i % config_.num_qubits},
-                .parameters = {},
-                .custom_matrix = {}
-            });
-            
-            if (i + 1 < config_.num_qubits) {
-                operations.push_back(quantum::GateOperation{
-                    .type = quantum::GateType::CNOT,
-                    .qubits = {i % config_.num_qubits, (i + 1) % config_.num_qubits},
-                    .parameters = {},
-                    .custom_matrix = {}
-                });
+    // Names the batch and links the sampled transactions in it; the
+    // transactions' trace ids come from the same fields as upstream, so
+    // only canonically encoded transactions are linked
+    void traceCollected(PendingBatch& pending, std::chrono::steady_clock::time_point start) {
+        uint64_t hash_prefix = 0;
+        std::memcpy(&hash_prefix, pending.batch_hash.data(), std::min(sizeof(hash_prefix), pending.batch_hash.size()));
+        pending.trace = utils::aggregate_trace_id("consensus", hash_prefix);
+
+        auto& tracer = utils::Tracer::global();
+        if (!tracer.sampled(pending.trace)) {
+            return;
+        }
+        // The stage ran before the batch had a name, so its span is recorded after the fact
+        using std::chrono::nanoseconds;
+        const auto start_ns = std::chrono::duration_cast<nanoseconds>(start.time_since_epoch()).count();
+        const auto duration_ns = std::chrono::duration_cast<nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        tracer.record({pending.trace, 0, "consensus.collect", static_cast<uint64_t>(start_ns),
+                       static_cast<uint64_t>(duration_ns), 0});
+        for (const auto& bytes : pending.transactions) {
+            if (auto view = blockchain::TransactionView::parse(bytes)) {
+                tracer.link("consensus.assign",
+                            utils::transaction_trace_id(view->getSender(), view->getNonce()), pending.trace);
             }
         }
+    }
 
-        // Measure quantum state
-        std::vector<quantum::QuantumMeasurement> measurements;
-        measurements.reserve(10);
-        
-        for (size_t i = 0; i < 10; ++i) {
-            measurements.push_back(quantum_context_.verification_circuit.measure({i}));
-        }
-
-        // Create quantum proof
-        return quantum::QuantumProof{
-            .initial_state = initial_state,
-            .circuit_operations = std::move(operations),
-            .measurements = std::move(measurements),
-            .verification_score = quantum::detail::calculateFidelity(
-                initial_state, quantum_context_.consensus_state),
-            .error_data = quantum::detail::detectErrors(initial_state)
-        };
+    // Merkle root over the transaction digests, so a transaction can later
+    // be proven part of the batch without the rest of it
+    std::vector<uint8_t> createBatchHash(const std::vector<crypto::MerkleHash>& tx_digests) {
+        crypto::MerkleBuilder tree;
+        for (const auto& digest : tx_digests) {
+            tree.appendHash(digest);
+        }
+        const auto root = tree.root();
+        return std::vector<uint8_t>(root.begin(), root.end());
     }
 
-    bool verifyQuantumProof(const quantum::QuantumProof& proof,
-                           const std::vector<uint8_t>& batch_hash) {
-        // Verify initial state matches batch hash
-        auto expected_state = quantum::detail::classicalToQuantum(batch_hash);
-        if (quantum::detail::calculateFidelity(proof.initial_state, expected_state) < 0.99) {
+    // The state must be the one rebuilt from the batch hash and the claimed
+    // measurements must agree with its own
+    template<typename Measurement>
+    bool verifyQuantumProof(const quantum::QuantumState& state, size_t measurement_count,
+                            const Measurement& claimed, const std::vector<uint8_t>& batch_hash) {
+        const auto expected_state = stateFromHash(batch_hash);
+        if (stateCommitment(state) != stateCommitment(expected_state)) {
+            return false;
+        }
+        const auto expected = measureState(expected_state, batch_hash);
+        if (measurement_count == 0 || measurement_count > expected.size()) {
             return false;
         }
 
-        // Verify quantum operations
-        for (const auto& op : proof.circuit_operations) {
-            quantum_context_.verification_circuit.applyGate(op);
+        // Checks the claims in random chunks, stopping once the match rate is settled
+        std::vector<size_t> order(measurement_count);
+        std::iota(order.begin(), order.end(), 0);
+        utils::RandomService::global().local().shuffle(order.begin(), order.end());
+
+        constexpr size_t chunk = zkp::QZKPVerifier::DEFAULT_SEQUENTIAL_CHUNK;
+        zkp::SequentialMatchTest test(1.0 - config_.proof_mismatch_tolerance,
+                                      config_.proof_confidence, measurement_count, chunk);
+        auto decision = zkp::SequentialMatchTest::Decision::CONTINUE;
+        for (size_t first = 0; decision == zkp::SequentialMatchTest::Decision::CONTINUE; first += chunk) {
+            const size_t last = std::min(measurement_count, first + chunk);
+            size_t matched = 0;
+            for (size_t i = first; i < last; ++i) {
+                const auto claim = claimed(order[i]);
+                const auto& actual = expected[order[i]];
+                matched += claim.outcome == actual.outcome &&
+                           std::abs(claim.fidelity - actual.fidelity) <= 0.01;
+            }
+            decision = test.update(last - first, matched);
         }
+        return decision != zkp::SequentialMatchTest::Decision::REJECT;
+    }
 
-        // Verify measurements
-        for (size_t i = 0; i < proof.measurements.size(); ++i) {
-            const auto& expected = proof.measurements[i];
-            const auto& actual = quantum_context_.measurements[i];
-            
-            if (std::abs(expected.fidelity - actual.fidelity) > 0.01) {
-                return false;
+    // Counts distinct known witnesses whose signature over message holds
+    // under their key for this epoch or the one before
+    template<typename Signature>
+    bool hasQuorum(const std::vector<std::optional<size_t>>& signers, const Signature& signature,
+                   const std::vector<uint8_t>& message) {
+        std::vector<size_t> indices;
+        std::vector<size_t> positions;
+        size_t witness_total = 0;
+        {
+            std::lock_guard<std::mutex> lock(witness_mutex_);
+            witness_total = witnesses_.size();
+        }
+        for (size_t i = 0; i < signers.size(); ++i) {
+            if (signers[i] && *signers[i] < witness_total &&
+                std::find(indices.begin(), indices.end(), *signers[i]) == indices.end()) {
+                indices.push_back(*signers[i]);
+                positions.push_back(i);
+            }
+        }
+        const auto keys = witnessKeys(indices, witness_total);
+
+        std::vector<crypto::VerifyItem> items;
+        items.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            items.push_back({crypto::SignatureScheme::Falcon512, message, signature(positions[i]), keys[i]->public_key});
+        }
+        auto results = crypto::BatchVerifier::global().verify(items);
+
+        // Only the failures are retried under the previous key
+        std::vector<crypto::VerifyItem> retry;
+        std::vector<size_t> retried;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (!results[i] && !keys[i]->previous_public_key.empty()) {
+                retry.push_back({crypto::SignatureScheme::Falcon512, message, signature(positions[i]),
+                                 keys[i]->previous_public_key});
+                retried.push_back(i);
+            }
+        }
+        if (!retry.empty()) {
+            const auto retry_results = crypto::BatchVerifier::global().verify(retry);
+            for (size_t i = 0; i < retried.size(); ++i) {
+                results[retried[i]] = retry_results[i];
             }
         }
 
-        return proof.verification_score > 0.95;
+        const size_t valid_signatures = std::count_if(results.begin(), results.end(),
+                                                      [](uint8_t ok) { return ok != 0; });
+        return valid_signatures >= config_.witness_count * config_.consensus_threshold;
     }
 
+    // Caller holds witness_mutex_
+    std::optional<size_t> witnessIndex(const std::string& node_id) const {
+        auto it = std::find_if(witnesses_.begin(), witnesses_.end(),
+            [&](const auto& w) { return w.node_id == node_id; });
+        if (it == witnesses_.end()) {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(it - witnesses_.begin());
+    }
+
+    // Copies of the chosen witnesses; see selectWitnessIndices
     std::vector<WitnessInfo> selectWitnessesRandomly(size_t count) {
+        std::lock_guard<std::mutex> lock(witness_mutex_);
+        std::vector<WitnessInfo> selected;
+        for (size_t index : selectWitnessIndices(count)) {
+            selected.push_back(witnesses_[index]);
+        }
+        return selected;
+    }
+
+    // Positions in witnesses_ of the `count` most reliable witnesses;
+    // caller holds witness_mutex_
+    std::vector<size_t> selectWitnessIndices(size_t count) {
         if (witnesses_.empty() || count == 0) {
             return {};
         }
 
-        std::vector<WitnessInfo> selected;
-        selected.reserve(count);
-        
         // Create index vector
         std::vector<size_t> indices(witnesses_.size());
         std::iota(indices.begin(), indices.end(), 0);
         
-        // Shuffle indices
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::shuffle(indices.begin(), indices.end(), gen);
+        // Shuffle indices from the consensus seed so equal scores break the same way on every node
+        auto rng = utils::RandomService::global().stream("pobpc.witnesses", batches_.load());
+        rng.shuffle(indices.begin(), indices.end());
         
         // Select witnesses with highest reliability scores
         std::partial_sort(indices.begin(),
                          indices.begin() + std::min(count, indices.size()),
                          indices.end(),
                          [this](size_t a, size_t b) {
-                             return witnesses_[a].reliability_score.load() >
-                                    witnesses_[b].reliability_score.load();
+                             return witnesses_[a].reliability_score >
+                                    witnesses_[b].reliability_score;
                          });
         
-        // Add selected witnesses
-        for (size_t i = 0; i < std::min(count, indices.size()); ++i) {
-            selected.push_back(witnesses_[indices[i]]);
+        indices.resize(std::min(count, indices.size()));
+        return indices;
+    }
+
+    // Signing keys for the witness slots at `indices`. A slot's key is made
+    // once per epoch of key_rotation_batches batches; the first use in a
+    // new epoch replaces, in parallel, only the keys that went stale
+    std::vector<std::shared_ptr<const WitnessKey>> witnessKeys(const std::vector<size_t>& indices,
+                                                               size_t witness_total) {
+        const uint64_t epoch = batches_.load() / config_.key_rotation_batches;
+
+        std::lock_guard<std::mutex> lock(key_mutex_);
+        if (witness_keys_.size() < witness_total) {
+            witness_keys_.resize(witness_total);
         }
-        
-        return selected;
+        std::vector<size_t> stale;
+        for (size_t index : indices) {
+            const auto& slot = witness_keys_[index];
+            if (!slot || slot->epoch != epoch) {
+                stale.push_back(index);
+            }
+        }
+        std::sort(stale.begin(), stale.end());
+        stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+        utils::WorkStealingPool::global().parallel_for(0, stale.size(), [&](size_t i) {
+            auto& slot = witness_keys_[stale[i]];
+            crypto::FalconSigner signer;
+            signer.generateKeyPair();
+            auto key = std::make_shared<WitnessKey>();
+            key->signing = signer.getSigningKey();
+            key->public_key = signer.getPublicKey();
+            if (slot) {
+                key->previous_public_key = slot->public_key;
+            }
+            key->epoch = epoch;
+            slot = std::move(key);
+        }, utils::TaskPriority::Consensus);
+
+        std::vector<std::shared_ptr<const WitnessKey>> keys;
+        keys.reserve(indices.size());
+        for (size_t index : indices) {
+            keys.push_back(witness_keys_[index]);
+        }
+        return keys;
     }
 
     void updateWitnessReliability(const std::string& witness_id, bool successful_validation) {
-        auto it = std::find_if(witnesses_.begin(), witnesses_.end(),
-            [&](const auto& w) { return w.node_id == witness_id; });
-            
-        if (it != witnesses_.end()) {
-            auto& witness = *it;
-            witness.total_validations.fetch_add(1);
-            if (successful_validation) {
-                witness.successful_validations.fetch_add(1);
-            }
-            
-            double success_rate = static_cast<double>(witness.successful_validations) /
-                                witness.total_validations;
-            witness.reliability_score.store(success_rate);
+        std::lock_guard<std::mutex> lock(witness_mutex_);
+        if (const auto index = witnessIndex(witness_id)) {
+            witnesses_[*index].updateReliability(successful_validation);
         }
     }
 
     bool validateBatchStructure(const BatchProof& proof) {
-        return !proof.batch_hash.empty() &&
+        return proof.batch_hash.size() == proof_wire::HASH_SIZE &&
                proof.transaction_count > 0 &&
                proof.transaction_count <= config_.batch_size &&
                proof.witness_signatures.size() <= config_.witness_count &&
-               !proof.quantum_proof.measurements.empty();
+               proof.witness_signatures.size() == proof.witness_data.selected_witnesses.size() &&
+               !proof.measurements.empty();
+    }
+
+    bool validateBatchStructure(const BatchProofView& proof) {
+        return proof.transactionCount() > 0 &&
+               proof.transactionCount() <= config_.batch_size &&
+               proof.witnessCount() <= config_.witness_count &&
+               proof.measurementCount() > 0;
     }
 
     void recordMetrics(const BatchProof& proof, std::chrono::microseconds processing_time) {
-        metrics_.total_batches_processed.fetch_add(1);
-        metrics_.total_transactions_processed.fetch_add(proof.transaction_count);
+        const double security = calculateQuantumSecurityScore(proof);
+
+        std::lock_guard<std::mutex> lock(metrics_mutex_);
+        metrics_.total_batches++;
+        metrics_.total_transactions += proof.transaction_count;
         
         // Update average times using exponential moving average
         constexpr double alpha = 0.1;
-        
-        auto current_batch_time = metrics_.avg_batch_time.load();
-        metrics_.avg_batch_time.store(
-            current_batch_time * (1 - alpha) + processing_time.count() * alpha);
+        metrics_.avg_batch_time = metrics_.avg_batch_time * (1 - alpha) + elapsedMillis(processing_time) * alpha;
             
         // Update quantum metrics
-        metrics_.quantum_security_score.store(calculateQuantumSecurityScore(proof));
-        metrics_.avg_quantum_fidelity.store(proof.quantum_proof.verification_score);
-        
-        if (proof.quantum_proof.error_data.requires_recovery) {
-            metrics_.error_corrections.fetch_add(1);
-        }
+        metrics_.quantum_security = security;
+        metrics_.quantum_fidelity = 1.0;
         
         // Update witness participation
-        metrics_.witness_participation_rate.store(
-            static_cast<double>(proof.witness_signatures.size()) / config_.witness_count);
+        metrics_.witness_participation =
+            static_cast<double>(proof.witness_signatures.size()) / config_.witness_count;
+
+        // The key epoch follows the published count
+        batches_.store(metrics_.total_batches);
     }
 
     double calculateQuantumSecurityScore(const BatchProof& proof) const {
         // Combine multiple quantum security metrics
-        double entanglement = quantum::detail::calculateEntanglement(
-            proof.quantum_proof.initial_state);
-        double coherence = quantum::detail::calculateCoherence(
-            proof.quantum_proof.initial_state);
-        double fidelity = proof.quantum_proof.verification_score;
+        double entanglement = proof.quantum_state.getEntropy();
+        double coherence = proof.quantum_state.getCoherence();
+        double fidelity = stateCommitment(proof.quantum_state) == stateCommitment(stateFromHash(proof.batch_hash)) ? 1.0 : 0.0;
         
         // Weighted combination of metrics
         constexpr double ENTANGLEMENT_WEIGHT = 0.3;
@@ -497,20 +837,24 @@ bool OptimizedPOBPC::addTransaction(const std::vector<uint8_t>& transaction) {
     return impl_->addTransaction(transaction);
 }
 
-BatchProof OptimizedPOBPC::generateBatchProof() {
+OptimizedPOBPC::BatchProof OptimizedPOBPC::generateBatchProof() {
     return impl_->generateBatchProof();
 }
 
-bool OptimizedPOBPC::verifyBatchProof(const BatchProof& proof) {
+bool OptimizedPOBPC::verifyBatchProof(const BatchProof& proof) const {
     return impl_->verifyBatchProof(proof);
 }
 
+bool OptimizedPOBPC::verifyBatchProof(std::span<const uint8_t> encoded) const {
+    return impl_->verifyBatchProof(encoded);
+}
+
 bool OptimizedPOBPC::registerWitness(const std::string& node_id,
                                    const std::vector<uint8_t>& public_key) {
     return impl_->registerWitness(node_id, public_key);
 }
 
-std::vector<OptimizedPOBPC::WitnessInfo> OptimizedPOBPC::selectWitnesses() {
+std::vector<OptimizedPOBPC::WitnessInfo> OptimizedPOBPC::selectWitnesses() const {
     return impl_->selectWitnesses();
 }
 
@@ -520,17 +864,45 @@ bool OptimizedPOBPC::submitWitnessVote(const std::string& witness_id,
     return impl_->submitWitnessVote(witness_id, signature, proof);
 }
 
-bool OptimizedPOBPC::hasReachedConsensus(const BatchProof& proof) {
-    return impl_->hasReachedConsensus(proof);
+bool OptimizedPOBPC::hasReachedConsensus(const BatchProof& proof) const noexcept {
+    try {
+        return impl_->hasReachedConsensus(proof);
+    } catch (...) {
+        return false;
+    }
 }
 
-double OptimizedPOBPC::calculateConsensusConfidence(const BatchProof& proof) {
-    return impl_->calculateConsensusConfidence(proof);
+double OptimizedPOBPC::calculateConsensusConfidence(const BatchProof& proof) const noexcept {
+    try {
+        return impl_->calculateConsensusConfidence(proof);
+    } catch (...) {
+        return 0.0;
+    }
 }
 
-OptimizedPOBPC::ConsensusMetrics OptimizedPOBPC::getMetrics() const {
+OptimizedPOBPC::ConsensusMetrics OptimizedPOBPC::getMetrics() const noexcept {
     return impl_->getMetrics();
 }
 
+void OptimizedPOBPC::startPipeline(std::function<void(BatchProof&&)> on_proof) {
+    impl_->startPipeline(std::move(on_proof));
+}
+
+void OptimizedPOBPC::stopPipeline() {
+    impl_->stopPipeline();
+}
+
+OptimizedPOBPC::PipelineStats OptimizedPOBPC::getPipelineStats() const {
+    return impl_->getPipelineStats();
+}
+
+void OptimizedPOBPC::updateConfig(const BatchConfig& config) {
+    impl_->updateConfig(config);
+}
+
+BatchConfig OptimizedPOBPC::getConfig() const noexcept {
+    return impl_->getConfig();
+}
+
 } // namespace consensus
-} // namespace quids 
\ No newline at end of file
+} // namespace quids
@@ -1,31 +1,60 @@
 #include "consensus/POBPC.hpp"
+#include "crypto/blake3/Blake3Hash.hpp"
+#include "crypto/signature/Falcon.hpp"
+#include "utils/RandomService.hpp"
+#include "utils/WeightedSampler.hpp"
 #include <algorithm>
+#include <bit>
 #include <numeric>
-#include <random>
 #include <chrono>
+#include <cmath>
+#include <unordered_map>
 
+namespace quids {
 namespace consensus {
 
+namespace {
+
+// Reliability in 2^-20 steps; witnesses below the threshold are never drawn
+uint64_t selectionWeight(double reliability, double threshold) {
+    return reliability >= threshold ? static_cast<uint64_t>(std::llround(reliability * 1048576.0)) : 0;
+}
+
+} // namespace
+
+size_t POBPC::BatchProof::signerCount() const noexcept {
+    size_t count = 0;
+    for (uint64_t word : signer_bitmap) {
+        count += std::popcount(word);
+    }
+    return count;
+}
+
 class POBPC::Impl {
 public:
     std::vector<std::vector<uint8_t>> pending_transactions;
     std::unordered_map<std::string, WitnessInfo> witnesses;
+    // Dense index -> witness; map nodes never move, so the pointers stay valid
+    std::vector<WitnessInfo*> witness_table;
+    // Selection weights by dense index, kept in step with reliability
+    quids::utils::WeightedSampler sampler;
     std::vector<BatchProof> processed_batches;
-    BatchProofGenerator proof_generator;
+    // Signs the hash of each batch this node proposes
+    crypto::FalconSigner proposer;
+    // Proposer id -> public key, this node's own included
+    std::unordered_map<std::string, std::vector<uint8_t>> proposers;
     
     // Metrics
     ConsensusMetrics metrics{0.0, 0.0, 0, 0, 0.0};
     std::chrono::system_clock::time_point last_batch_time;
-    
-    // Random number generation
-    std::random_device rd;
-    std::mt19937_64 gen{rd()};
 };
 
 POBPC::POBPC(const BatchConfig& config) 
     : impl_(std::make_unique<Impl>()),
       config_(config) {
     impl_->last_batch_time = std::chrono::system_clock::now();
+    impl_->proposer.generateKeyPair();
+    impl_->proposers[config_.node_id] = impl_->proposer.getPublicKey();
 }
 
 POBPC::~POBPC() = default;
@@ -38,7 +67,7 @@ bool POBPC::addTransaction(const std::vector<uint8_t>& transaction) {
     return true;
 }
 
-BatchProof POBPC::generateBatchProof() {
+POBPC::BatchProof POBPC::generateBatchProof() {
     auto start_time = std::chrono::high_resolution_clock::now();
     
     BatchProof proof;
@@ -48,8 +77,9 @@ BatchProof POBPC::generateBatchProof() {
     // Create batch hash
     proof.batch_hash = createBatchHash(impl_->pending_transactions);
     
-    // Generate ZK proof for the batch
-    proof.proof_data = impl_->proof_generator.generateProof(impl_->pending_transactions);
+    // The proposer vouches for the batch by signing its hash
+    proof.proposer_id = config_.node_id;
+    proof.proof_data = impl_->proposer.sign(proof.batch_hash);
     
     // Clear pending transactions
     impl_->pending_transactions.clear();
@@ -67,77 +97,137 @@ bool POBPC::verifyBatchProof(const BatchProof& proof) {
         return false;
     }
     
-    return impl_->proof_generator.verifyProof(proof.proof_data, proof.batch_hash);
+    // The key comes from the registry, never from the proof, so a proof
+    // cannot vouch for itself
+    auto it = impl_->proposers.find(proof.proposer_id);
+    if (it == impl_->proposers.end()) {
+        return false;
+    }
+    return impl_->proposer.verify(proof.batch_hash, proof.proof_data, it->second);
+}
+
+std::vector<uint8_t> POBPC::getProposerPublicKey() const {
+    return impl_->proposer.getPublicKey();
+}
+
+bool POBPC::registerProposer(const std::string& node_id, const std::vector<uint8_t>& public_key) {
+    // This node's own key is fixed at construction
+    if (node_id == config_.node_id || public_key.empty()) {
+        return false;
+    }
+    impl_->proposers[node_id] = public_key;
+    return true;
 }
 
 bool POBPC::registerWitness(const std::string& node_id, const std::vector<uint8_t>& public_key) {
-    WitnessInfo info;
+    // Re-registering keeps the index so existing signer bitmaps stay meaningful
+    auto [it, is_new] = impl_->witnesses.try_emplace(node_id);
+    WitnessInfo& info = it->second;
+    if (is_new) {
+        info.index = static_cast<uint32_t>(impl_->witness_table.size());
+    }
     info.node_id = node_id;
     info.public_key = public_key;
     info.reliability_score = 1.0;
     info.last_active = std::chrono::system_clock::now().time_since_epoch().count();
     
-    impl_->witnesses[node_id] = info;
+    const uint64_t weight = selectionWeight(info.reliability_score, MIN_RELIABILITY_THRESHOLD);
+    if (is_new) {
+        impl_->witness_table.push_back(&info);
+        impl_->sampler.push_back(weight);
+    } else {
+        impl_->sampler.set(info.index, weight);
+    }
     return true;
 }
 
-std::vector<POBPC::WitnessInfo> POBPC::selectWitnesses() {
-    // Filter active and reliable witnesses
-    std::vector<WitnessInfo> active_witnesses;
-    for (const auto& [id, info] : impl_->witnesses) {
-        if (info.reliability_score >= 0.5) {  // Minimum reliability threshold
-            active_witnesses.push_back(info);
-        }
-    }
-    
-    return selectWitnessesRandomly(std::min(config_.witness_count, active_witnesses.size()));
+std::vector<const POBPC::WitnessInfo*> POBPC::selectWitnesses() {
+    // Unreliable witnesses carry zero weight, so the sampler skips them
+    return selectWitnessesRandomly(config_.witness_count);
 }
 
 bool POBPC::submitWitnessVote(const std::string& witness_id,
                              const std::vector<uint8_t>& signature,
-                             const BatchProof& proof) {
+                             BatchProof& proof) {
     auto it = impl_->witnesses.find(witness_id);
     if (it == impl_->witnesses.end()) {
         return false;
     }
     
+    // One vote per witness
+    const uint32_t index = it->second.index;
+    const size_t word = index / 64;
+    const uint64_t bit = uint64_t{1} << (index % 64);
+    if (word < proof.signer_bitmap.size() && (proof.signer_bitmap[word] & bit)) {
+        return false;
+    }
+    if (proof.witness_signatures.size() != proof.signerCount()) {
+        return false;
+    }
+    
     if (!verifyWitnessSignature(witness_id, signature, proof.batch_hash)) {
         updateWitnessReliability(witness_id, false);
         return false;
     }
     
-    proof.witness_signatures.push_back(signature);
+    if (proof.signer_bitmap.size() <= word) {
+        proof.signer_bitmap.resize(word + 1, 0);
+    }
+    // Signatures follow the bitmap: this one goes after those of every
+    // lower index
+    size_t rank = std::popcount(proof.signer_bitmap[word] & (bit - 1));
+    for (size_t w = 0; w < word; ++w) {
+        rank += std::popcount(proof.signer_bitmap[w]);
+    }
+    proof.signer_bitmap[word] |= bit;
+    proof.witness_signatures.insert(proof.witness_signatures.begin() + rank, signature);
     updateWitnessReliability(witness_id, true);
     return true;
 }
 
 bool POBPC::hasReachedConsensus(const BatchProof& proof) {
-    if (proof.witness_signatures.empty()) {
+    const size_t signers = proof.signerCount();
+    if (signers == 0 || proof.witness_signatures.size() != signers ||
+        proof.signer_bitmap.size() * 64 > impl_->witness_table.size() + 63) {
         return false;
     }
     
-    double consensus_ratio = static_cast<double>(proof.witness_signatures.size()) /
+    // The proof may come from anywhere, so every bit is backed by its
+    // signature; all of them are checked in one batch
+    std::vector<crypto::VerifyItem> items;
+    items.reserve(signers);
+    for (size_t word = 0; word < proof.signer_bitmap.size(); ++word) {
+        for (uint64_t bits = proof.signer_bitmap[word]; bits != 0; bits &= bits - 1) {
+            const size_t index = word * 64 + std::countr_zero(bits);
+            if (index >= impl_->witness_table.size()) {
+                return false;
+            }
+            items.push_back({config_.witness_scheme, proof.batch_hash,
+                             proof.witness_signatures[items.size()],
+                             impl_->witness_table[index]->public_key});
+        }
+    }
+    const auto valid = crypto::BatchVerifier::global().verify(items);
+    const auto accepted = std::count(valid.begin(), valid.end(), uint8_t{1});
+    
+    double consensus_ratio = static_cast<double>(accepted) /
                            static_cast<double>(config_.witness_count);
     return consensus_ratio >= config_.consensus_threshold;
 }
 
 double POBPC::calculateConsensusConfidence(const BatchProof& proof) {
-    if (proof.witness_signatures.empty()) {
-        return 0.0;
-    }
-    
-    // Calculate weighted confidence based on witness reliability scores
+    // Mean reliability of the signers, read straight from the bitmap
     double total_weight = 0.0;
     double weighted_sum = 0.0;
     
-    for (const auto& signature : proof.witness_signatures) {
-        // Find witness info by matching signature
-        for (const auto& [id, info] : impl_->witnesses) {
-            if (verifyWitnessSignature(id, signature, proof.batch_hash)) {
-                weighted_sum += info.reliability_score;
-                total_weight += 1.0;
-                break;
+    for (size_t word = 0; word < proof.signer_bitmap.size(); ++word) {
+        for (uint64_t bits = proof.signer_bitmap[word]; bits != 0; bits &= bits - 1) {
+            const size_t index = word * 64 + std::countr_zero(bits);
+            if (index >= impl_->witness_table.size()) {
+                return 0.0;
             }
+            weighted_sum += impl_->witness_table[index]->reliability_score;
+            total_weight += 1.0;
         }
     }
     
@@ -145,19 +235,25 @@ double POBPC::calculateConsensusConfidence(const BatchProof& proof) {
 }
 
 POBPC::ConsensusMetrics POBPC::getMetrics() const {
-    return impl_->metrics;
+    const auto& m = impl_->metrics;
+    return {m.avg_batch_time.load(), m.avg_verification_time.load(),
+            m.total_batches_processed.load(), m.total_transactions_processed.load(),
+            m.witness_participation_rate.load(), m.quantum_security_score.load()};
 }
 
 std::vector<uint8_t> POBPC::createBatchHash(
     const std::vector<std::vector<uint8_t>>& transactions) {
-    // Combine all transaction data
-    std::vector<uint8_t> combined;
+    // Length-prefixed, so moving bytes between transactions changes the hash
+    crypto::Blake3Hash hasher;
     for (const auto& tx : transactions) {
-        combined.insert(combined.end(), tx.begin(), tx.end());
+        uint8_t length[8];
+        for (size_t b = 0; b < sizeof(length); ++b) {
+            length[b] = static_cast<uint8_t>(static_cast<uint64_t>(tx.size()) >> (8 * b));
+        }
+        hasher.update(length, sizeof(length));
+        hasher.update(tx);
     }
-    
-    // Use quantum-safe hashing
-    return quantum::QuantumCrypto::QHash(combined);
+    return hasher.finalize();
 }
 
 bool POBPC::verifyWitnessSignature(const std::string& witness_id,
@@ -168,7 +264,8 @@ bool POBPC::verifyWitnessSignature(const std::string& witness_id,
         return false;
     }
     
-    return quantum::QuantumCrypto::QVerify(message, signature, it->second.public_key);
+    const crypto::VerifyItem item{config_.witness_scheme, message, signature, it->second.public_key};
+    return crypto::BatchVerifier::global().verify(std::span(&item, 1)).front() == 1;
 }
 
 void POBPC::updateWitnessReliability(const std::string& witness_id, bool successful_validation) {
@@ -178,29 +275,21 @@ void POBPC::updateWitnessReliability(const std::string& witness_id, bool success
         it->second.reliability_score = (1.0 - ALPHA) * it->second.reliability_score +
                                      ALPHA * (successful_validation ? 1.0 : 0.0);
         it->second.last_active = std::chrono::system_clock::now().time_since_epoch().count();
+        impl_->sampler.set(it->second.index,
+                           selectionWeight(it->second.reliability_score, MIN_RELIABILITY_THRESHOLD));
     }
 }
 
-std::vector<POBPC::WitnessInfo> POBPC::selectWitnessesRandomly(size_t count) {
-    std::vector<WitnessInfo> selected;
-    std::vector<WitnessInfo> all_witnesses;
-    
-    for (const auto& [id, info] : impl_->witnesses) {
-        all_witnesses.push_back(info);
-    }
+std::vector<const POBPC::WitnessInfo*> POBPC::selectWitnessesRandomly(size_t count) {
+    // Every node must pick the same witnesses for a batch. Dense indices
+    // follow registration order and weights follow the vote history, both
+    // replicated, so the same consensus seed gives the same draw
+    auto rng = quids::utils::RandomService::global().stream("pobpc.witnesses", impl_->processed_batches.size());
     
-    if (all_witnesses.empty()) {
-        return selected;
+    std::vector<const WitnessInfo*> selected;
+    for (size_t index : impl_->sampler.sample(rng, count)) {
+        selected.push_back(impl_->witness_table[index]);
     }
-    
-    // Shuffle witnesses
-    std::shuffle(all_witnesses.begin(), all_witnesses.end(), impl_->gen);
-    
-    // Select the first 'count' witnesses
-    selected.insert(selected.end(),
-                   all_witnesses.begin(),
-                   all_witnesses.begin() + std::min(count, all_witnesses.size()));
-    
     return selected;
 }
 
@@ -223,39 +312,9 @@ void POBPC::recordMetrics(const BatchProof& proof, std::chrono::microseconds pro
     m.total_transactions_processed += proof.transaction_count;
     
     // Update witness participation rate
-    m.witness_participation_rate = static_cast<double>(proof.witness_signatures.size()) /
+    m.witness_participation_rate = static_cast<double>(proof.signerCount()) /
                                  static_cast<double>(config_.witness_count);
 }
 
-// BatchProofGenerator implementation
-BatchProofGenerator::BatchProofGenerator() = default;
-BatchProofGenerator::~BatchProofGenerator() = default;
-
-std::vector<uint8_t> BatchProofGenerator::generateProof(
-    const std::vector<std::vector<uint8_t>>& transactions) {
-    auto commitment = createCommitment(transactions);
-    return generateZKProof(commitment);
-}
-
-bool BatchProofGenerator::verifyProof(const std::vector<uint8_t>& proof,
-                                    const std::vector<uint8_t>& batch_hash) {
-    // Verify the ZK proof using quantum-safe verification
-    return qcrypto_.QVerify(batch_hash, proof, qcrypto_.getPublicKey());
-}
-
-std::vector<uint8_t> BatchProofGenerator::createCommitment(
-    const std::vector<std::vector<uint8_t>>& transactions) {
-    std::vector<uint8_t> combined;
-    for (const auto& tx : transactions) {
-        combined.insert(combined.end(), tx.begin(), tx.end());
-    }
-    return qcrypto_.QHash(combined);
-}
-
-std::vector<uint8_t> BatchProofGenerator::generateZKProof(
-    const std::vector<uint8_t>& commitment) {
-    // Generate a quantum-safe ZK proof
-    return qcrypto_.QSign(commitment);
-}
-
-} // namespace consensus 
\ No newline at end of file
+} // namespace consensus
+} // namespace quids
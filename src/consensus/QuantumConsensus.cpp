@@ -88,18 +88,9 @@ double QuantumConsensusModule::calculateQuantumAdvantage() const {
 double QuantumConsensusModule::calculateEntanglementScore() const {
     if (!useQuantum_) return 0.0;
     
-    // Calculate von Neumann entropy as entanglement measure
-    const auto& stateVector = quantumState_->getStateVector();
-    double entropy = 0.0;
-    
-    for (const auto& amplitude : stateVector) {
-        double prob = ::std::norm(amplitude);
-        if (prob > 1e-10) {  // Avoid log(0)
-            entropy -= prob * ::std::log2(prob);
-        }
-    }
-    
-    return entropy;
+    // Entropy of the basis distribution as entanglement measure; cached by
+    // the state until it changes
+    return quantumState_->getEntropy();
 }
 
 bool QuantumConsensusModule::verifyQuantumState() const {
@@ -1,6 +1,5 @@
 #include "core/OptimizedAIBlock.hpp"
 #include <omp.h>
-#include <immintrin.h> // For AVX-512 intrinsics
 #include "quantum/QuantumUtils.hpp"
 #include "crypto/QuantumCrypto.hpp"
 
@@ -57,31 +56,30 @@ void OptimizedAIBlock::processBlockParallel() {
     finalizeBlockZK();
 }
 
-void OptimizedAIBlock::processTransactionsSIMD(const std::vector<Transaction>& batch) {
-    const size_t numTransactions = batch.size();
-    const size_t simdWidth = SIMD_WIDTH;
-    const size_t numIterations = numTransactions / simdWidth;
-    
-    // Process transactions in SIMD batches
-    #pragma omp parallel for simd aligned(batch:64)
-    for (size_t i = 0; i < numIterations; ++i) {
-        __m512d values = _mm512_load_pd(&batch[i * simdWidth].value);
-        __m512d fees = _mm512_load_pd(&batch[i * simdWidth].fee);
-        
-        // SIMD transaction validation
-        __mmask8 validMask = _mm512_cmp_pd_mask(values, _mm512_setzero_pd(), _CMP_GT_OQ);
-        
-        // Process valid transactions
-        if (validMask) {
-            // Apply SIMD operations for valid transactions
-            __m512d processed = _mm512_fmadd_pd(values, fees, _mm512_set1_pd(1.0));
-            _mm512_store_pd(&batch[i * simdWidth].processedValue, processed);
-        }
+bool OptimizedAIBlock::validateBlock(const Block& block) const {
+    std::stop_token stop;
+    {
+        std::lock_guard<std::mutex> lock(validationMutex_);
+        stop = validationStop_.get_token();
     }
-    
-    // Handle remaining transactions
-    for (size_t i = numIterations * simdWidth; i < numTransactions; ++i) {
-        processTransaction(batch[i]);
+    return static_cast<bool>(validator_.validate(block, accounts_, stop));
+}
+
+void OptimizedAIBlock::setAccountLookup(blockchain::BlockValidator::AccountLookup accounts) {
+    accounts_ = std::move(accounts);
+}
+
+void OptimizedAIBlock::cancelValidation() {
+    std::lock_guard<std::mutex> lock(validationMutex_);
+    validationStop_.request_stop();
+    validationStop_ = std::stop_source{};
+}
+
+void OptimizedAIBlock::processTransactionsSIMD(const std::vector<Transaction>& batch) {
+    // Transactions are objects, not packed lanes of doubles, so there is
+    // nothing to load eight at a time; each one is processed in turn
+    for (const auto& tx : batch) {
+        processTransaction(tx);
     }
 }
 
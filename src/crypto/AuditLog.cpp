@@ -0,0 +1,152 @@
+#include "crypto/AuditLog.hpp"
+#include "utils/BoundedQueue.hpp"
+#include <blake3.h>
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+namespace quids {
+namespace crypto {
+
+namespace {
+
+// How long the writer sleeps when nobody asks for a flush
+constexpr auto WRITE_INTERVAL = std::chrono::milliseconds(20);
+constexpr size_t WRITE_BATCH = 256;
+
+} // namespace
+
+class AuditLog::Impl {
+public:
+    explicit Impl(size_t capacity) : queue_(capacity), writer_([this] { run(); }) {}
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        writer_.join();
+    }
+
+    void setSink(Sink sink) {
+        std::lock_guard<std::mutex> lock(sink_mutex_);
+        sink_ = std::move(sink);
+    }
+
+    bool record(std::string_view operation, std::span<const uint8_t> data) {
+        Record entry;
+        entry.time = std::chrono::system_clock::now();
+        entry.operation.assign(operation);
+        entry.data_size = data.size();
+        blake3_hasher hasher;
+        blake3_hasher_init(&hasher);
+        blake3_hasher_update(&hasher, data.data(), data.size());
+        blake3_hasher_finalize(&hasher, entry.digest.data(), entry.digest.size());
+
+        if (!queue_.try_push(std::move(entry))) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        recorded_.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    void flush() {
+        const uint64_t target = recorded_.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(mutex_);
+        flush_requested_ = true;
+        wake_.notify_one();
+        done_.wait(lock, [&] { return processed_ >= target; });
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.recorded = recorded_.load(std::memory_order_relaxed);
+        s.dropped = dropped_.load(std::memory_order_relaxed);
+        s.written = written_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    void run() {
+        std::vector<Record> batch;
+        batch.reserve(WRITE_BATCH);
+        while (true) {
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait_for(lock, WRITE_INTERVAL, [&] { return stopping_ || flush_requested_; });
+                flush_requested_ = false;
+                stopping = stopping_;
+            }
+
+            size_t taken;
+            while ((taken = queue_.try_pop_bulk(std::back_inserter(batch), WRITE_BATCH)) > 0) {
+                {
+                    std::lock_guard<std::mutex> lock(sink_mutex_);
+                    if (sink_) {
+                        sink_(batch);
+                        written_.fetch_add(taken, std::memory_order_relaxed);
+                    }
+                }
+                batch.clear();
+                std::lock_guard<std::mutex> lock(mutex_);
+                processed_ += taken;
+            }
+            done_.notify_all();
+
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    utils::BoundedQueue<Record> queue_;
+
+    std::mutex sink_mutex_;
+    Sink sink_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stopping_{false};
+    bool flush_requested_{false};
+    uint64_t processed_{0};  // popped, whether or not a sink took them
+
+    std::atomic<uint64_t> recorded_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> written_{0};
+
+    // Last, so it starts after everything it reads
+    std::thread writer_;
+};
+
+AuditLog::AuditLog(size_t capacity) : impl_(std::make_unique<Impl>(capacity)) {}
+AuditLog::~AuditLog() = default;
+
+AuditLog& AuditLog::global() {
+    static AuditLog log;
+    return log;
+}
+
+void AuditLog::setSink(Sink sink) {
+    impl_->setSink(std::move(sink));
+}
+
+bool AuditLog::record(std::string_view operation, std::span<const uint8_t> data) {
+    return impl_->record(operation, data);
+}
+
+void AuditLog::flush() {
+    impl_->flush();
+}
+
+AuditLog::Stats AuditLog::stats() const {
+    return impl_->stats();
+}
+
+} // namespace crypto
+} // namespace quids
@@ -1,28 +1,57 @@
 #include "crypto/QuantumHashFunction.hpp"
-#include "quantum/QuantumCrypto.hpp"
+#include "crypto/blake3/BatchHasher.hpp"
+#include <blake3.h>
 #include <memory>
+#include <stdexcept>
 
 namespace quids {
 namespace crypto {
 
 class QuantumHashFunction::Impl {
 public:
-    Impl() : quantum_crypto_() {}
+    Impl() {
+        blake3_hasher_init(&hasher_);
+    }
     
-    std::vector<uint8_t> hash(const std::vector<uint8_t>& data) {
-        return quantum_crypto_.hashData(data);
+    void update(std::span<const uint8_t> data) {
+        blake3_hasher_update(&hasher_, data.data(), data.size());
+    }
+
+    Digest finalize() {
+        Digest digest;
+        blake3_hasher_finalize(&hasher_, digest.data(), digest.size());
+        blake3_hasher_init(&hasher_);
+        return digest;
     }
     
 private:
-    quantum::QuantumCrypto quantum_crypto_;
+    blake3_hasher hasher_;
 };
 
 QuantumHashFunction::QuantumHashFunction() : impl_(std::make_unique<Impl>()) {}
 QuantumHashFunction::~QuantumHashFunction() = default;
 
 std::vector<uint8_t> QuantumHashFunction::hash(const std::vector<uint8_t>& data) {
-    return impl_->hash(data);
+    const std::span<const uint8_t> message(data);
+    Digest digest;
+    BatchHasher::hashMany({&message, 1}, &digest);
+    return std::vector<uint8_t>(digest.begin(), digest.end());
+}
+
+void QuantumHashFunction::hashMany(std::span<const std::span<const uint8_t>> messages, std::span<Digest> out) {
+    if (out.size() != messages.size()) {
+        throw std::invalid_argument("hashMany needs one digest per message");
+    }
+    BatchHasher::hashMany(messages, out.data());
+}
+
+void QuantumHashFunction::update(std::span<const uint8_t> data) {
+    impl_->update(data);
+}
+
+QuantumHashFunction::Digest QuantumHashFunction::finalize() {
+    return impl_->finalize();
 }
 
 } // namespace crypto
-} // namespace quids
\ No newline at end of file
+} // namespace quids
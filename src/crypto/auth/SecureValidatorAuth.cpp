@@ -1,7 +1,7 @@
 #include "crypto/auth/SecureValidatorAuth.hpp"
+#include "memory/MemoryPool.hpp"
 #include <botan/auto_rng.h>
 #include <botan/srp6.h>
-#include <botan/hash.h>
 #include <botan/dl_group.h>
 
 #include <stdexcept>
@@ -9,10 +9,17 @@
 namespace quids {
 namespace crypto {
 
+namespace {
+    // Parsing the named group is not free; every session shares one
+    const Botan::DL_Group& srpGroup() {
+        static const Botan::DL_Group group("modp/srp/2048");
+        return group;
+    }
+}
+
 class SecureValidatorAuth::Impl {
 public:
-    Impl() : m_hash(Botan::HashFunction::create_or_throw("SHA-256")),
-            m_group("modp/srp/2048") {}
+    Impl() : m_group(srpGroup()) {}
 
     Verifier generateVerifier(const std::string& identifier, const std::string& password) {
         Botan::AutoSeeded_RNG rng;
@@ -108,15 +115,28 @@ public:
     }
 
 private:
-    std::unique_ptr<Botan::HashFunction> m_hash;
     std::unique_ptr<Botan::SRP6_Server_Session> m_srp6_server;
     std::vector<uint8_t> m_session_key;
     std::vector<uint8_t> m_salt;
     Botan::BigInt m_server_B;
-    Botan::DL_Group m_group;
+    const Botan::DL_Group& m_group;
 };
 
-SecureValidatorAuth::SecureValidatorAuth() : impl_(std::make_unique<Impl>()) {}
+namespace {
+    // Never destroyed, so objects in static storage can still return here.
+    // A template so that only members, which may name Impl, instantiate it.
+    template <typename T>
+    memory::MemoryPool<T>& implPool() {
+        static auto* pool = new memory::MemoryPool<T>(256);
+        return *pool;
+    }
+}
+
+void SecureValidatorAuth::ImplDeleter::operator()(Impl* impl) const noexcept {
+    implPool<Impl>().destroy(impl);
+}
+
+SecureValidatorAuth::SecureValidatorAuth() : impl_(implPool<Impl>().construct()) {}
 SecureValidatorAuth::~SecureValidatorAuth() = default;
 
 SecureValidatorAuth::Verifier SecureValidatorAuth::generateVerifier(
@@ -0,0 +1,240 @@
+#include "crypto/auth/ValidatorAuthServer.hpp"
+#include "memory/MemoryPool.hpp"
+#include <botan/auto_rng.h>
+#include <botan/dl_group.h>
+#include <botan/exceptn.h>
+#include <botan/mem_ops.h>
+#include <botan/srp6.h>
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace quids {
+namespace crypto {
+
+namespace {
+
+// Parsing the named group is not free; every session shares one
+const Botan::DL_Group& srpGroup() {
+    static const Botan::DL_Group group = Botan::DL_Group::from_name("modp/srp/2048");
+    return group;
+}
+
+// Seeding an AutoSeeded_RNG reads the system RNG, so it is not done per handshake
+Botan::RandomNumberGenerator& threadRng() {
+    thread_local Botan::AutoSeeded_RNG rng;
+    return rng;
+}
+
+struct VerifierRecord {
+    std::vector<uint8_t> salt;
+    Botan::BigInt v;
+};
+
+struct Session {
+    Botan::SRP6_Server_Session srp;
+    std::vector<uint8_t> key;
+};
+
+// 2048-bit exponentiations dominate; hand them out one at a time
+constexpr size_t BATCH_GRAIN = 1;
+
+} // namespace
+
+class ValidatorAuthServer::Impl {
+public:
+    explicit Impl(utils::WorkStealingPool& pool) : pool_(pool), session_pool_(256) {}
+
+    ~Impl() {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        for (auto& [id, session] : sessions_) {
+            session_pool_.destroy(session);
+        }
+    }
+
+    void registerVerifier(const std::string& identifier, const SecureValidatorAuth::Verifier& verifier) {
+        auto record = std::make_shared<const VerifierRecord>(
+            VerifierRecord{verifier.salt, Botan::BigInt::from_bytes(verifier.verifier)});
+        std::unique_lock lock(verifier_mutex_);
+        verifiers_[identifier] = std::move(record);
+    }
+
+    void removeVerifier(const std::string& identifier) {
+        std::unique_lock lock(verifier_mutex_);
+        verifiers_.erase(identifier);
+    }
+
+    std::optional<Handshake> startServerAuth(const std::string& identifier,
+                                             const std::vector<uint8_t>& client_public_ephemeral) {
+        std::shared_ptr<const VerifierRecord> record;
+        {
+            std::shared_lock lock(verifier_mutex_);
+            auto it = verifiers_.find(identifier);
+            if (it != verifiers_.end()) {
+                record = it->second;
+            }
+        }
+        if (!record) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        Session* session = session_pool_.construct();
+        Handshake handshake;
+        try {
+            Botan::BigInt B = session->srp.step1(record->v, srpGroup(), "SHA-256", 256, threadRng());
+            auto key = session->srp.step2(Botan::BigInt::from_bytes(client_public_ephemeral));
+            session->key.assign(key.begin(), key.end());
+            handshake.session.public_ephemeral = B.serialize();
+            handshake.session.session_key = session->key;
+        } catch (const Botan::Exception&) {
+            // step2 rejects an ephemeral that is 0 mod p
+            session_pool_.destroy(session);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        handshake.session_id = next_id_.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            sessions_.emplace(handshake.session_id, session);
+        }
+        started_.fetch_add(1, std::memory_order_relaxed);
+        return handshake;
+    }
+
+    std::future<std::optional<Handshake>> startServerAuthAsync(std::string identifier,
+                                                               std::vector<uint8_t> client_public_ephemeral) {
+        return pool_.submit(utils::TaskPriority::Execution,
+                            [this, identifier = std::move(identifier),
+                             ephemeral = std::move(client_public_ephemeral)] {
+                                return startServerAuth(identifier, ephemeral);
+                            });
+    }
+
+    std::vector<std::optional<Handshake>> startServerAuthBatch(const std::vector<Request>& requests) {
+        std::vector<std::optional<Handshake>> results(requests.size());
+        pool_.parallel_for(0, requests.size(), [&](size_t i) {
+            results[i] = startServerAuth(requests[i].identifier, requests[i].client_public_ephemeral);
+        }, utils::TaskPriority::Execution, BATCH_GRAIN);
+        return results;
+    }
+
+    bool verifyClientProof(SessionId session_id, const std::vector<uint8_t>& client_proof) {
+        Session* session = take(session_id);
+        if (!session) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // In SRP6, the client proof is the session key itself
+        const bool valid = client_proof.size() == session->key.size() &&
+                           Botan::constant_time_compare(client_proof.data(), session->key.data(),
+                                                        session->key.size());
+        session_pool_.destroy(session);
+        (valid ? verified_ : rejected_).fetch_add(1, std::memory_order_relaxed);
+        return valid;
+    }
+
+    std::optional<std::vector<uint8_t>> getSessionKey(SessionId session_id) const {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        auto it = sessions_.find(session_id);
+        if (it == sessions_.end()) {
+            return std::nullopt;
+        }
+        return it->second->key;
+    }
+
+    void closeSession(SessionId session_id) {
+        session_pool_.destroy(take(session_id));
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.started = started_.load(std::memory_order_relaxed);
+        s.verified = verified_.load(std::memory_order_relaxed);
+        s.rejected = rejected_.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(session_mutex_);
+            s.open_sessions = sessions_.size();
+        }
+        std::shared_lock lock(verifier_mutex_);
+        s.verifiers = verifiers_.size();
+        return s;
+    }
+
+private:
+    // Removes the session from the table; nullptr when it is not open
+    Session* take(SessionId session_id) {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        auto it = sessions_.find(session_id);
+        if (it == sessions_.end()) {
+            return nullptr;
+        }
+        Session* session = it->second;
+        sessions_.erase(it);
+        return session;
+    }
+
+    utils::WorkStealingPool& pool_;
+
+    mutable std::shared_mutex verifier_mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const VerifierRecord>> verifiers_;
+
+    memory::MemoryPool<Session> session_pool_;
+    mutable std::mutex session_mutex_;
+    std::unordered_map<SessionId, Session*> sessions_;
+
+    std::atomic<SessionId> next_id_{1};
+    std::atomic<uint64_t> started_{0};
+    std::atomic<uint64_t> verified_{0};
+    std::atomic<uint64_t> rejected_{0};
+};
+
+ValidatorAuthServer::ValidatorAuthServer(utils::WorkStealingPool& pool) : impl_(std::make_unique<Impl>(pool)) {}
+ValidatorAuthServer::~ValidatorAuthServer() = default;
+
+void ValidatorAuthServer::registerVerifier(const std::string& identifier,
+                                           const SecureValidatorAuth::Verifier& verifier) {
+    impl_->registerVerifier(identifier, verifier);
+}
+
+void ValidatorAuthServer::removeVerifier(const std::string& identifier) {
+    impl_->removeVerifier(identifier);
+}
+
+std::optional<ValidatorAuthServer::Handshake> ValidatorAuthServer::startServerAuth(
+    const std::string& identifier, const std::vector<uint8_t>& client_public_ephemeral) {
+    return impl_->startServerAuth(identifier, client_public_ephemeral);
+}
+
+std::future<std::optional<ValidatorAuthServer::Handshake>> ValidatorAuthServer::startServerAuthAsync(
+    std::string identifier, std::vector<uint8_t> client_public_ephemeral) {
+    return impl_->startServerAuthAsync(std::move(identifier), std::move(client_public_ephemeral));
+}
+
+std::vector<std::optional<ValidatorAuthServer::Handshake>> ValidatorAuthServer::startServerAuthBatch(
+    const std::vector<Request>& requests) {
+    return impl_->startServerAuthBatch(requests);
+}
+
+bool ValidatorAuthServer::verifyClientProof(SessionId session_id, const std::vector<uint8_t>& client_proof) {
+    return impl_->verifyClientProof(session_id, client_proof);
+}
+
+std::optional<std::vector<uint8_t>> ValidatorAuthServer::getSessionKey(SessionId session_id) const {
+    return impl_->getSessionKey(session_id);
+}
+
+void ValidatorAuthServer::closeSession(SessionId session_id) {
+    impl_->closeSession(session_id);
+}
+
+ValidatorAuthServer::Stats ValidatorAuthServer::stats() const {
+    return impl_->stats();
+}
+
+} // namespace crypto
+} // namespace quids
@@ -0,0 +1,331 @@
+#include "crypto/blake3/BatchHasher.hpp"
+#include "utils/CpuFeatures.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BATCH_HASHER_X86 1
+#endif
+#if defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define BATCH_HASHER_NEON 1
+#endif
+
+namespace quids {
+namespace crypto {
+
+namespace {
+
+constexpr uint32_t IV[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                            0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+constexpr uint32_t CHUNK_START = 1 << 0;
+constexpr uint32_t CHUNK_END = 1 << 1;
+constexpr uint32_t ROOT = 1 << 3;
+
+constexpr size_t BLOCK_LEN = 64;
+constexpr size_t ROUNDS = 7;
+
+// Message word order for each round: the BLAKE3 permutation applied r times
+constexpr std::array<std::array<uint8_t, 16>, ROUNDS> makeSchedule() {
+    constexpr uint8_t PERMUTATION[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+    std::array<std::array<uint8_t, 16>, ROUNDS> schedule{};
+    for (uint8_t i = 0; i < 16; ++i) {
+        schedule[0][i] = i;
+    }
+    for (size_t r = 1; r < ROUNDS; ++r) {
+        for (size_t i = 0; i < 16; ++i) {
+            schedule[r][i] = schedule[r - 1][PERMUTATION[i]];
+        }
+    }
+    return schedule;
+}
+
+constexpr auto SCHEDULE = makeSchedule();
+
+size_t blockCount(size_t length) {
+    return length == 0 ? 1 : (length + BLOCK_LEN - 1) / BLOCK_LEN;
+}
+
+void hashOne(std::span<const uint8_t> message, MerkleHash& out) {
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, message.data(), message.size());
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+}
+
+enum class Kernel { Portable, X4, X8, X16 };
+
+#if BATCH_HASHER_X86 || BATCH_HASHER_NEON
+
+using u32x4 = uint32_t __attribute__((vector_size(16)));
+#if BATCH_HASHER_X86
+using u32x8 = uint32_t __attribute__((vector_size(32)));
+using u32x16 = uint32_t __attribute__((vector_size(64)));
+#endif
+
+// In place, so no vector crosses a call boundary by value
+template<typename V>
+[[gnu::always_inline]] inline void rotr(V& v, int n) {
+    v = (v >> n) | (v << (32 - n));
+}
+
+template<typename V>
+[[gnu::always_inline]] inline void mix(V* s, size_t a, size_t b, size_t c, size_t d, const V& x, const V& y) {
+    s[a] += s[b] + x;
+    s[d] ^= s[a];
+    rotr(s[d], 16);
+    s[c] += s[d];
+    s[b] ^= s[c];
+    rotr(s[b], 12);
+    s[a] += s[b] + y;
+    s[d] ^= s[a];
+    rotr(s[d], 8);
+    s[c] += s[d];
+    s[b] ^= s[c];
+    rotr(s[b], 7);
+}
+
+// One block compression per lane, chunk counter 0; cv becomes the output
+// chaining value, which for the last block of a root chunk is the digest
+template<typename V>
+[[gnu::always_inline]] inline void compressLanes(V* cv, const V* m, const V& block_len, const V& flags) {
+    V s[16];
+    for (size_t i = 0; i < 8; ++i) {
+        s[i] = cv[i];
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        s[8 + i] = V{} + IV[i];
+    }
+    s[12] = V{};
+    s[13] = V{};
+    s[14] = block_len;
+    s[15] = flags;
+
+#if defined __GNUC__
+#pragma GCC unroll 7
+#endif
+    for (size_t r = 0; r < ROUNDS; ++r) {
+        const auto& w = SCHEDULE[r];
+        mix(s, 0, 4, 8, 12, m[w[0]], m[w[1]]);
+        mix(s, 1, 5, 9, 13, m[w[2]], m[w[3]]);
+        mix(s, 2, 6, 10, 14, m[w[4]], m[w[5]]);
+        mix(s, 3, 7, 11, 15, m[w[6]], m[w[7]]);
+        mix(s, 0, 5, 10, 15, m[w[8]], m[w[9]]);
+        mix(s, 1, 6, 11, 12, m[w[10]], m[w[11]]);
+        mix(s, 2, 7, 8, 13, m[w[12]], m[w[13]]);
+        mix(s, 3, 4, 9, 14, m[w[14]], m[w[15]]);
+    }
+
+    for (size_t i = 0; i < 8; ++i) {
+        cv[i] = s[i] ^ s[i + 8];
+    }
+}
+
+// Hashes n <= L single-chunk messages, one per lane. Lanes whose message
+// has run out of blocks keep their chaining value; compiled for the
+// instruction set of whichever kernel inlines it.
+template<typename V, size_t L>
+[[gnu::always_inline]] inline void hashGroup(const std::span<const uint8_t>* messages, size_t n, MerkleHash* const* outs) {
+    size_t blocks[L] = {};
+    size_t max_blocks = 0;
+    for (size_t j = 0; j < n; ++j) {
+        blocks[j] = blockCount(messages[j].size());
+        max_blocks = std::max(max_blocks, blocks[j]);
+    }
+
+    V cv[8];
+    for (size_t i = 0; i < 8; ++i) {
+        cv[i] = V{} + IV[i];
+    }
+
+    // Word-major, so word w of every lane loads as one vector
+    alignas(64) uint32_t words[16][L];
+    alignas(64) uint32_t lengths[L];
+    alignas(64) uint32_t flags[L];
+    alignas(64) uint32_t active[L];
+    for (size_t b = 0; b < max_blocks; ++b) {
+        for (size_t j = 0; j < L; ++j) {
+            uint8_t block[BLOCK_LEN] = {};
+            size_t take = 0;
+            const bool live = b < blocks[j];
+            if (live && !messages[j].empty()) {
+                take = std::min(BLOCK_LEN, messages[j].size() - b * BLOCK_LEN);
+                std::memcpy(block, messages[j].data() + b * BLOCK_LEN, take);
+            }
+            for (size_t w = 0; w < 16; ++w) {
+                const uint8_t* p = block + 4 * w;
+                words[w][j] = uint32_t{p[0]} | uint32_t{p[1]} << 8 | uint32_t{p[2]} << 16 | uint32_t{p[3]} << 24;
+            }
+            lengths[j] = static_cast<uint32_t>(take);
+            flags[j] = live ? (b == 0 ? CHUNK_START : 0) | (b + 1 == blocks[j] ? CHUNK_END | ROOT : 0) : 0;
+            active[j] = live ? ~uint32_t{0} : 0;
+        }
+
+        V m[16];
+        V block_len;
+        V block_flags;
+        V keep;
+        std::memcpy(m, words, sizeof(m));
+        std::memcpy(&block_len, lengths, sizeof(block_len));
+        std::memcpy(&block_flags, flags, sizeof(block_flags));
+        std::memcpy(&keep, active, sizeof(keep));
+
+        V next[8];
+        for (size_t i = 0; i < 8; ++i) {
+            next[i] = cv[i];
+        }
+        compressLanes(next, m, block_len, block_flags);
+        for (size_t i = 0; i < 8; ++i) {
+            cv[i] = (next[i] & keep) | (cv[i] & ~keep);
+        }
+    }
+
+    alignas(64) uint32_t digest[8][L];
+    std::memcpy(digest, cv, sizeof(digest));
+    for (size_t j = 0; j < n; ++j) {
+        uint8_t* out = outs[j]->data();
+        for (size_t i = 0; i < 8; ++i) {
+            const uint32_t w = digest[i][j];
+            out[4 * i] = static_cast<uint8_t>(w);
+            out[4 * i + 1] = static_cast<uint8_t>(w >> 8);
+            out[4 * i + 2] = static_cast<uint8_t>(w >> 16);
+            out[4 * i + 3] = static_cast<uint8_t>(w >> 24);
+        }
+    }
+}
+
+// SSE2 on x86-64 and NEON on AArch64 are baseline, so no target attribute
+void hashX4(const std::span<const uint8_t>* messages, size_t n, MerkleHash* const* outs) {
+    hashGroup<u32x4, 4>(messages, n, outs);
+}
+
+#if BATCH_HASHER_X86
+__attribute__((target("avx2"))) void hashX8(const std::span<const uint8_t>* messages, size_t n,
+                                            MerkleHash* const* outs) {
+    hashGroup<u32x8, 8>(messages, n, outs);
+}
+
+__attribute__((target("avx512f"))) void hashX16(const std::span<const uint8_t>* messages, size_t n,
+                                               MerkleHash* const* outs) {
+    hashGroup<u32x16, 16>(messages, n, outs);
+}
+#endif
+
+#endif
+
+Kernel kernel() noexcept {
+#if BATCH_HASHER_X86
+    using utils::CpuFeature;
+    static const Kernel widest = [] {
+        switch (utils::selectFeature("blake3.batch", {CpuFeature::Avx512f, CpuFeature::Avx2})) {
+            case CpuFeature::Avx512f: return Kernel::X16;
+            case CpuFeature::Avx2: return Kernel::X8;
+            default: return Kernel::X4;
+        }
+    }();
+    return widest;
+#elif BATCH_HASHER_NEON
+    return Kernel::X4;
+#else
+    return Kernel::Portable;
+#endif
+}
+
+// Hashes up to lanes() messages on the narrowest kernel they fill
+void hashGroupOn(Kernel widest, const std::span<const uint8_t>* messages, size_t n, MerkleHash* const* outs) {
+#if BATCH_HASHER_X86
+    if (widest == Kernel::X16 && n > 8) {
+        hashX16(messages, n, outs);
+        return;
+    }
+    if (widest >= Kernel::X8 && n > 4) {
+        hashX8(messages, n, outs);
+        return;
+    }
+#endif
+#if BATCH_HASHER_X86 || BATCH_HASHER_NEON
+    hashX4(messages, n, outs);
+#else
+    (void)widest;
+    for (size_t j = 0; j < n; ++j) {
+        hashOne(messages[j], *outs[j]);
+    }
+#endif
+}
+
+} // namespace
+
+const char* BatchHasher::isa() noexcept {
+    switch (kernel()) {
+    case Kernel::X16:
+        return "avx512";
+    case Kernel::X8:
+        return "avx2";
+    case Kernel::X4:
+#if BATCH_HASHER_NEON
+        return "neon";
+#else
+        return "sse2";
+#endif
+    case Kernel::Portable:
+        break;
+    }
+    return "portable";
+}
+
+size_t BatchHasher::lanes() noexcept {
+    switch (kernel()) {
+    case Kernel::X16:
+        return 16;
+    case Kernel::X8:
+        return 8;
+    case Kernel::X4:
+        return 4;
+    case Kernel::Portable:
+        break;
+    }
+    return 1;
+}
+
+void BatchHasher::hashMany(std::span<const std::span<const uint8_t>> messages, MerkleHash* out) {
+    const Kernel widest = kernel();
+    const size_t width = lanes();
+
+    std::vector<size_t> order;
+    order.reserve(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i) {
+        if (width > 1 && messages[i].size() <= CHUNK_SIZE) {
+            order.push_back(i);
+        } else {
+            hashOne(messages[i], out[i]);
+        }
+    }
+
+    // Messages with the same block count share a group, so lanes rarely idle
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return blockCount(messages[a].size()) < blockCount(messages[b].size());
+    });
+
+    std::span<const uint8_t> group[16];
+    MerkleHash* outs[16];
+    for (size_t g = 0; g < order.size(); g += width) {
+        const size_t n = std::min(width, order.size() - g);
+        for (size_t j = 0; j < n; ++j) {
+            group[j] = messages[order[g + j]];
+            outs[j] = &out[order[g + j]];
+        }
+        hashGroupOn(widest, group, n, outs);
+    }
+}
+
+std::vector<MerkleHash> BatchHasher::hashMany(const std::vector<std::vector<uint8_t>>& messages) {
+    std::vector<std::span<const uint8_t>> views(messages.begin(), messages.end());
+    std::vector<MerkleHash> digests(messages.size());
+    hashMany(views, digests.data());
+    return digests;
+}
+
+} // namespace crypto
+} // namespace quids
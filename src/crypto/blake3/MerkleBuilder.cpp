@@ -0,0 +1,160 @@
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <blake3.h>
+#include <stdexcept>
+
+namespace quids {
+namespace crypto {
+
+namespace {
+
+constexpr uint8_t LEAF_DOMAIN = 0x00;
+constexpr uint8_t NODE_DOMAIN = 0x01;
+
+// Below this many nodes a level is cheaper to hash on the calling thread
+constexpr size_t PARALLEL_THRESHOLD = 512;
+constexpr size_t GRAIN = 128;
+
+} // namespace
+
+MerkleBuilder::MerkleBuilder(utils::WorkStealingPool& pool) : pool_(pool), levels_(1), final_(1, 0) {}
+
+MerkleHash MerkleBuilder::hashLeaf(std::span<const uint8_t> data) {
+    MerkleHash out;
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, &LEAF_DOMAIN, 1);
+    blake3_hasher_update(&hasher, data.data(), data.size());
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+MerkleHash MerkleBuilder::hashNode(const MerkleHash& left, const MerkleHash& right) {
+    uint8_t block[1 + 2 * 32];
+    block[0] = NODE_DOMAIN;
+    std::copy(left.begin(), left.end(), block + 1);
+    std::copy(right.begin(), right.end(), block + 1 + 32);
+
+    MerkleHash out;
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, block, sizeof(block));
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+MerkleHash MerkleBuilder::toHash(std::span<const uint8_t> digest) {
+    if (digest.size() != MerkleHash{}.size()) {
+        throw std::invalid_argument("Merkle leaf digest must be 32 bytes");
+    }
+    MerkleHash out;
+    std::copy(digest.begin(), digest.end(), out.begin());
+    return out;
+}
+
+void MerkleBuilder::append(std::span<const uint8_t> data) {
+    appendHash(hashLeaf(data));
+}
+
+void MerkleBuilder::appendHash(const MerkleHash& leaf) {
+    levels_.front().push_back(leaf);
+    final_.front() = levels_.front().size();
+}
+
+void MerkleBuilder::appendParallel(size_t count, const std::function<MerkleHash(size_t)>& leaf) {
+    auto& leaves = levels_.front();
+    const size_t base = leaves.size();
+    leaves.resize(base + count);
+    if (count < PARALLEL_THRESHOLD) {
+        for (size_t i = 0; i < count; ++i) {
+            leaves[base + i] = leaf(i);
+        }
+    } else {
+        pool_.parallel_for(0, count, [&](size_t i) { leaves[base + i] = leaf(i); },
+                           utils::TaskPriority::Execution, GRAIN);
+    }
+    final_.front() = leaves.size();
+}
+
+void MerkleBuilder::build() {
+    for (size_t l = 0; levels_[l].size() > 1; ++l) {
+        if (levels_.size() == l + 1) {
+            levels_.emplace_back();
+            final_.push_back(0);
+        }
+        const auto& children = levels_[l];
+        auto& parents = levels_[l + 1];
+        const size_t n = children.size();
+        const size_t first = final_[l + 1];
+        parents.resize((n + 1) / 2);
+
+        auto compute = [&](size_t i) {
+            parents[i] = 2 * i + 1 < n ? hashNode(children[2 * i], children[2 * i + 1]) : children[2 * i];
+        };
+        if (parents.size() - first < PARALLEL_THRESHOLD) {
+            for (size_t i = first; i < parents.size(); ++i) {
+                compute(i);
+            }
+        } else {
+            pool_.parallel_for(first, parents.size(), compute, utils::TaskPriority::Execution, GRAIN);
+        }
+        final_[l + 1] = final_[l] / 2;
+    }
+}
+
+MerkleHash MerkleBuilder::root() {
+    if (levels_.front().empty()) {
+        return MerkleHash{};
+    }
+    build();
+    for (const auto& level : levels_) {
+        if (level.size() == 1) {
+            return level.front();
+        }
+    }
+    return levels_.back().front();
+}
+
+MerkleProof MerkleBuilder::proof(size_t index) {
+    if (index >= size()) {
+        throw std::out_of_range("Merkle proof index past the last leaf");
+    }
+    build();
+
+    MerkleProof proof{index, size(), {}};
+    for (size_t l = 0; levels_[l].size() > 1; ++l) {
+        const size_t sibling = index ^ 1;
+        if (sibling < levels_[l].size()) {
+            proof.siblings.push_back(levels_[l][sibling]);
+        }
+        index >>= 1;
+    }
+    return proof;
+}
+
+bool MerkleBuilder::verify(const MerkleHash& root, const MerkleHash& leaf, const MerkleProof& proof) {
+    if (proof.index >= proof.leaf_count) {
+        return false;
+    }
+    MerkleHash node = leaf;
+    size_t index = proof.index;
+    size_t next = 0;
+    for (size_t n = proof.leaf_count; n > 1; n = (n + 1) / 2) {
+        if ((index ^ 1) < n) {
+            if (next == proof.siblings.size()) {
+                return false;
+            }
+            const auto& sibling = proof.siblings[next++];
+            node = (index & 1) ? hashNode(sibling, node) : hashNode(node, sibling);
+        }
+        index >>= 1;
+    }
+    return next == proof.siblings.size() && node == root;
+}
+
+void MerkleBuilder::clear() {
+    levels_.assign(1, {});
+    final_.assign(1, 0);
+}
+
+} // namespace crypto
+} // namespace quids
@@ -1,64 +1,91 @@
 #include "crypto/hybrid/QuantumResistantHash.hpp"
-#include "crypto/blake3/Blake3Hash.hpp"
-#include "quantum/QuantumCrypto.hpp"
-#include <openssl/evp.h>
+#include "crypto/blake3/BatchHasher.hpp"
+#include <array>
 #include <memory>
+#include <stdexcept>
 
 namespace quids {
 namespace crypto {
 
-class QuantumResistantHash::Impl {
-public:
-    Impl() : blake3_(), quantum_crypto_() {
-        // Initialize OpenSSL
-        OpenSSL_add_all_algorithms();
+namespace {
+
+using Mixed = std::array<uint8_t, 64>;
+
+// Both halves of the hybrid input come from the one message digest, so
+// the message itself is read once
+Mixed mixInput(const QuantumResistantHash::Digest& digest) {
+    Mixed hybrid_hash;
+    for (size_t i = 0; i < 32; ++i) {
+        hybrid_hash[i] = digest[i];
+        hybrid_hash[i + 32] = digest[i];
+    }
+
+    // Domain separation
+    constexpr uint8_t domain_tag = 0x01;
+    for (auto& byte : hybrid_hash) {
+        byte ^= domain_tag;
     }
+    return hybrid_hash;
+}
+
+QuantumResistantHash::Digest finalPass(const QuantumResistantHash::Digest& digest) {
+    const Mixed mixed = mixInput(digest);
+    const std::span<const uint8_t> message(mixed);
+    QuantumResistantHash::Digest out;
+    BatchHasher::hashMany({&message, 1}, &out);
+    return out;
+}
+
+} // namespace
 
-    ~Impl() {
-        EVP_cleanup();
+class QuantumResistantHash::Impl {
+public:
+    void update(std::span<const uint8_t> data) {
+        hash_.update(data);
     }
 
-    std::vector<uint8_t> hash(const std::vector<uint8_t>& data) {
-        // Get BLAKE3 hash
-        blake3_.update(data);
-        auto blake3_hash = blake3_.finalize();
-
-        // Get quantum hash
-        auto quantum_hash = quantum_crypto_.hashData(data);
-
-        // XOR the hashes for hybrid protection
-        std::vector<uint8_t> hybrid_hash(64); // 512 bits total
-        for (size_t i = 0; i < 32; ++i) {
-            hybrid_hash[i] = blake3_hash[i];
-            hybrid_hash[i + 32] = quantum_hash[i];
-        }
-
-        // Domain separation
-        uint8_t domain_tag = 0x01;
-        for (auto& byte : hybrid_hash) {
-            byte ^= domain_tag;
-        }
-
-        // Final BLAKE3 pass for mixing
-        Blake3Hash final_hash;
-        final_hash.update(hybrid_hash);
-        return final_hash.finalize();
+    Digest finalize() {
+        return finalPass(hash_.finalize());
     }
 
 private:
-    Blake3Hash blake3_;
-    quantum::QuantumCrypto quantum_crypto_;
+    QuantumHashFunction hash_;
 };
 
 QuantumResistantHash::QuantumResistantHash() : impl_(std::make_unique<Impl>()) {}
 QuantumResistantHash::~QuantumResistantHash() = default;
 
 std::vector<uint8_t> QuantumResistantHash::hash(const std::vector<uint8_t>& data) {
-    return impl_->hash(data);
+    const std::span<const uint8_t> message(data);
+    Digest digest;
+    hashMany({&message, 1}, {&digest, 1});
+    return std::vector<uint8_t>(digest.begin(), digest.end());
+}
+
+void QuantumResistantHash::hashMany(std::span<const std::span<const uint8_t>> messages, std::span<Digest> out) {
+    QuantumHashFunction::hashMany(messages, out);
+
+    // The final mixing inputs are all 64 bytes, one block apiece, so the
+    // second pass fills every lane
+    std::vector<Mixed> mixed(out.size());
+    std::vector<std::span<const uint8_t>> views(out.size());
+    for (size_t i = 0; i < out.size(); ++i) {
+        mixed[i] = mixInput(out[i]);
+        views[i] = mixed[i];
+    }
+    BatchHasher::hashMany(views, out.data());
+}
+
+void QuantumResistantHash::update(std::span<const uint8_t> data) {
+    impl_->update(data);
+}
+
+QuantumResistantHash::Digest QuantumResistantHash::finalize() {
+    return impl_->finalize();
 }
 
 double QuantumResistantHash::getSecurityLevel() const {
-    // 256 bits from BLAKE3 + quantum entropy
+    // 256 bits from BLAKE3
     return 256.0;
 }
 
@@ -67,4 +94,4 @@ std::string QuantumResistantHash::getName() const {
 }
 
 } // namespace crypto
-} // namespace quids
\ No newline at end of file
+} // namespace quids
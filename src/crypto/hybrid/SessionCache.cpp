@@ -0,0 +1,195 @@
+#include "crypto/hybrid/SessionCache.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace quids {
+namespace crypto {
+
+namespace {
+
+constexpr std::string_view TICKET_LABEL = "quids session ticket v1";
+constexpr std::string_view RESUMPTION_LABEL = "quids session resumption v1";
+
+using Secret = std::array<uint8_t, BLAKE3_KEY_LEN>;
+
+// BLAKE3(label || data), truncated or extended to out.size()
+void labelled_hash(std::string_view label, std::span<const uint8_t> data, std::span<uint8_t> out) {
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, label.data(), label.size());
+    blake3_hasher_update(&hasher, data.data(), data.size());
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+}
+
+void secure_zero(Secret& secret) {
+    volatile uint8_t* p = secret.data();
+    for (size_t i = 0; i < secret.size(); ++i) {
+        p[i] = 0;
+    }
+}
+
+} // namespace
+
+class SessionCache::Impl {
+public:
+    explicit Impl(Config config) : config_(config) {
+        config_.capacity = std::max<size_t>(1, config_.capacity);
+    }
+
+    ~Impl() { clear(); }
+
+    TicketId store(const std::string& peer_id, std::span<const uint8_t> shared_secret) {
+        Entry entry;
+        labelled_hash(TICKET_LABEL, shared_secret, entry.ticket);
+        labelled_hash(RESUMPTION_LABEL, shared_secret, entry.secret);
+        entry.expires = Clock::now() + config_.ticket_lifetime;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        erase_locked(peer_id);
+        while (entries_.size() >= config_.capacity) {
+            erase_locked(order_.front());
+        }
+        order_.push_back(peer_id);
+        entry.position = std::prev(order_.end());
+        const TicketId ticket = entry.ticket;
+        entries_.emplace(peer_id, std::move(entry));
+        ++stats_.stored;
+        return ticket;
+    }
+
+    std::optional<std::vector<uint8_t>> resume(const std::string& peer_id,
+                                               std::span<const uint8_t> nonce,
+                                               size_t key_length) {
+        Secret secret;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(peer_id);
+            if (it == entries_.end()) {
+                ++stats_.misses;
+                return std::nullopt;
+            }
+            Entry& entry = it->second;
+            if (Clock::now() >= entry.expires || entry.resumptions >= config_.max_resumptions) {
+                erase_locked(peer_id);
+                ++stats_.misses;
+                return std::nullopt;
+            }
+            ++entry.resumptions;
+            ++stats_.resumed;
+            secret = entry.secret;
+        }
+
+        std::vector<uint8_t> key(key_length);
+        blake3_hasher hasher;
+        blake3_hasher_init_keyed(&hasher, secret.data());
+        blake3_hasher_update(&hasher, nonce.data(), nonce.size());
+        blake3_hasher_finalize(&hasher, key.data(), key.size());
+        secure_zero(secret);
+        return key;
+    }
+
+    std::optional<TicketId> ticket(const std::string& peer_id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(peer_id);
+        if (it == entries_.end()) {
+            return std::nullopt;
+        }
+        return it->second.ticket;
+    }
+
+    void invalidate(const std::string& peer_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        erase_locked(peer_id);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [peer, entry] : entries_) {
+            secure_zero(entry.secret);
+        }
+        entries_.clear();
+        order_.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    struct Entry {
+        TicketId ticket{};
+        Secret secret{};
+        Clock::time_point expires;
+        uint32_t resumptions{0};
+        std::list<std::string>::iterator position;
+    };
+
+    // Caller holds mutex_
+    void erase_locked(const std::string& peer_id) {
+        auto it = entries_.find(peer_id);
+        if (it == entries_.end()) {
+            return;
+        }
+        secure_zero(it->second.secret);
+        order_.erase(it->second.position);
+        entries_.erase(it);
+    }
+
+    Config config_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> order_;  // oldest ticket first
+    Stats stats_;
+};
+
+SessionCache::SessionCache() : SessionCache(Config{}) {}
+SessionCache::SessionCache(Config config) : impl_(std::make_unique<Impl>(config)) {}
+SessionCache::~SessionCache() = default;
+
+SessionCache& SessionCache::global() {
+    static SessionCache cache;
+    return cache;
+}
+
+SessionCache::TicketId SessionCache::store(const std::string& peer_id, std::span<const uint8_t> shared_secret) {
+    return impl_->store(peer_id, shared_secret);
+}
+
+std::optional<std::vector<uint8_t>> SessionCache::resume(const std::string& peer_id,
+                                                         std::span<const uint8_t> nonce,
+                                                         size_t key_length) {
+    return impl_->resume(peer_id, nonce, key_length);
+}
+
+std::optional<SessionCache::TicketId> SessionCache::ticket(const std::string& peer_id) const {
+    return impl_->ticket(peer_id);
+}
+
+void SessionCache::invalidate(const std::string& peer_id) {
+    impl_->invalidate(peer_id);
+}
+
+void SessionCache::clear() {
+    impl_->clear();
+}
+
+size_t SessionCache::size() const {
+    return impl_->size();
+}
+
+SessionCache::Stats SessionCache::stats() const {
+    return impl_->stats();
+}
+
+} // namespace crypto
+} // namespace quids
@@ -3,65 +3,131 @@
 #include <botan/pk_keys.h>
 #include <botan/pubkey.h>
 #include <botan/kyber.h>
+#include "crypto/AuditLog.hpp"
+#include "crypto/BotanOps.hpp"
+#include "crypto/KeyPairPool.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <exception>
+#include <list>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
 
 namespace quids {
 namespace crypto {
 
+namespace {
+
+// Parsed public keys kept for peers we handshake with repeatedly
+constexpr size_t PUBLIC_KEY_CACHE_CAPACITY = 256;
+// Ephemeral handshake keys are drawn faster than signing keys
+constexpr size_t KEY_POOL_DEPTH = 16;
+
+KyberKeyPair freshKeyPair() {
+    Botan::Kyber_PrivateKey private_key(threadRng(), Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
+    std::unique_ptr<Botan::Public_Key> public_key = private_key.public_key();
+
+    KyberKeyPair keypair;
+    auto pub_bits = public_key->public_key_bits();
+    auto priv_bits = private_key.private_key_bits();
+    
+    keypair.public_key = std::vector<uint8_t>(pub_bits.begin(), pub_bits.end());
+    keypair.private_key = std::vector<uint8_t>(priv_bits.begin(), priv_bits.end());
+
+    return keypair;
+}
+
+KeyPairPool<KyberKeyPair>& keyPool() {
+    static KeyPairPool<KyberKeyPair> pool(freshKeyPair, KEY_POOL_DEPTH);
+    return pool;
+}
+
+} // namespace
+
 class KyberKEM::Impl {
 public:
     Impl() = default;
 
     KyberKeyPair generateKeyPair() {
-        Botan::AutoSeeded_RNG rng;
-        Botan::Kyber_PrivateKey private_key(rng, Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
-        std::unique_ptr<Botan::Public_Key> public_key = private_key.public_key();
-
-        KyberKeyPair keypair;
-        auto pub_bits = public_key->public_key_bits();
-        auto priv_bits = private_key.private_key_bits();
-        
-        keypair.public_key = std::vector<uint8_t>(pub_bits.begin(), pub_bits.end());
-        keypair.private_key = std::vector<uint8_t>(priv_bits.begin(), priv_bits.end());
-
-        return keypair;
+        return keyPool().take();
     }
 
     KyberCiphertext encapsulate(const std::vector<uint8_t>& public_key) {
-        Botan::AutoSeeded_RNG rng;
-        Botan::Kyber_PublicKey kyber_public(public_key, Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
-        
-        KyberCiphertext result;
-        Botan::PK_KEM_Encryptor encryptor(kyber_public, rng, "KDF2(SHA-256)");
-        
-        auto enc_result = encryptor.encrypt(rng, 32); // Generate 256-bit shared secret
-        result.data = enc_result.encapsulated_shared_key();
-        result.shared_secret = std::vector<uint8_t>(enc_result.shared_key().begin(), enc_result.shared_key().end());
-        
-        return result;
+        Botan::PK_KEM_Encryptor encryptor(*parsePublicKey(public_key), "KDF2(SHA-256)");
+        return encapsulateWith(encryptor, threadRng());
+    }
+
+    std::vector<KyberCiphertext> encapsulate_many(const std::vector<std::vector<uint8_t>>& public_keys) {
+        // Indices of the requests sharing each distinct key
+        std::unordered_map<std::string, std::vector<size_t>> by_key;
+        std::vector<const std::vector<size_t>*> groups;
+        for (size_t i = 0; i < public_keys.size(); ++i) {
+            auto [it, inserted] = by_key.try_emplace(
+                std::string(public_keys[i].begin(), public_keys[i].end()));
+            it->second.push_back(i);
+            if (inserted) {
+                groups.push_back(&it->second);
+            }
+        }
+
+        std::vector<KyberCiphertext> results(public_keys.size());
+        std::vector<std::exception_ptr> errors(groups.size());
+        utils::WorkStealingPool::global().parallel_for(0, groups.size(), [&](size_t g) {
+            try {
+                const auto& indices = *groups[g];
+                // Encryptors are not shared across threads
+                Botan::PK_KEM_Encryptor encryptor(*parsePublicKey(public_keys[indices.front()]),
+                                                  "KDF2(SHA-256)");
+                for (size_t i : indices) {
+                    results[i] = encapsulateWith(encryptor, threadRng());
+                }
+            } catch (...) {
+                errors[g] = std::current_exception();
+            }
+        }, utils::TaskPriority::Execution, 1);
+
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        return results;
     }
 
     std::vector<uint8_t> decapsulate(const std::vector<uint8_t>& ciphertext,
                                    const std::vector<uint8_t>& private_key) {
-        Botan::AutoSeeded_RNG rng;
         Botan::Kyber_PrivateKey kyber_private(private_key, Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
-        
-        Botan::PK_KEM_Decryptor decryptor(kyber_private, rng, "KDF2(SHA-256)");
+
+        Botan::PK_KEM_Decryptor decryptor(kyber_private, threadRng(), "KDF2(SHA-256)");
         auto dec_result = decryptor.decrypt(ciphertext, 32);
         return std::vector<uint8_t>(dec_result.begin(), dec_result.end());
     }
 
+    // Fixed by the parameter set, so measured once on a throwaway key
+    struct Sizes {
+        size_t public_key;
+        size_t private_key;
+        size_t ciphertext;
+    };
+
+    static const Sizes& sizes() {
+        static const Sizes measured = [] {
+            Botan::Kyber_PrivateKey temp(threadRng(), Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
+            auto pub = temp.public_key();
+            Botan::PK_KEM_Encryptor encryptor(*pub, "KDF2(SHA-256)");
+            return Sizes{pub->public_key_bits().size(), temp.private_key_bits().size(),
+                         encryptor.encapsulated_key_length()};
+        }();
+        return measured;
+    }
+
     size_t getPublicKeySize() const {
-        Botan::AutoSeeded_RNG rng;
-        Botan::Kyber_PrivateKey temp(rng, Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
-        auto pub = temp.public_key();
-        return pub->public_key_bits().size();
+        return sizes().public_key;
     }
 
     size_t getPrivateKeySize() const {
-        Botan::AutoSeeded_RNG rng;
-        Botan::Kyber_PrivateKey temp(rng, Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
-        return temp.private_key_bits().size();
+        return sizes().private_key;
     }
 
     size_t getSharedSecretSize() const {
@@ -69,12 +135,50 @@ public:
     }
 
     size_t getCiphertextSize() const {
-        Botan::AutoSeeded_RNG rng;
-        Botan::Kyber_PrivateKey temp(rng, Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
-        auto pub = temp.public_key();
-        Botan::PK_KEM_Encryptor encryptor(*pub, rng, "KDF2(SHA-256)");
-        return encryptor.encapsulated_key_length();
+        return sizes().ciphertext;
+    }
+
+private:
+    static KyberCiphertext encapsulateWith(Botan::PK_KEM_Encryptor& encryptor, Botan::RandomNumberGenerator& rng) {
+        KyberCiphertext result;
+        auto enc_result = encryptor.encrypt(rng, 32); // Generate 256-bit shared secret
+        result.data = enc_result.encapsulated_shared_key();
+        result.shared_secret = std::vector<uint8_t>(enc_result.shared_key().begin(), enc_result.shared_key().end());
+        return result;
+    }
+
+    // Parsing a key expands its public matrix; repeat peers reuse the result
+    std::shared_ptr<const Botan::Kyber_PublicKey> parsePublicKey(const std::vector<uint8_t>& public_key) {
+        std::string bits(public_key.begin(), public_key.end());
+        {
+            std::lock_guard<std::mutex> lock(key_mutex_);
+            auto it = key_index_.find(bits);
+            if (it != key_index_.end()) {
+                key_order_.splice(key_order_.begin(), key_order_, it->second);
+                return it->second->second;
+            }
+        }
+
+        auto parsed = std::make_shared<const Botan::Kyber_PublicKey>(
+            public_key, Botan::KyberMode(Botan::KyberMode::Kyber1024_R3));
+
+        std::lock_guard<std::mutex> lock(key_mutex_);
+        if (key_index_.find(bits) == key_index_.end()) {
+            key_order_.emplace_front(bits, parsed);
+            key_index_.emplace(std::move(bits), key_order_.begin());
+            if (key_order_.size() > PUBLIC_KEY_CACHE_CAPACITY) {
+                key_index_.erase(key_order_.back().first);
+                key_order_.pop_back();
+            }
+        }
+        return parsed;
     }
+
+    using KeyEntry = std::pair<std::string, std::shared_ptr<const Botan::Kyber_PublicKey>>;
+
+    std::mutex key_mutex_;
+    std::list<KeyEntry> key_order_;  // most recently used first
+    std::unordered_map<std::string, std::list<KeyEntry>::iterator> key_index_;
 };
 
 KyberKEM::KyberKEM() : impl_(std::make_unique<Impl>()) {}
@@ -84,10 +188,18 @@ KyberKeyPair KyberKEM::generateKeyPair() {
     return impl_->generateKeyPair();
 }
 
+void KyberKEM::setKeyPoolDepth(size_t depth) {
+    keyPool().setDepth(depth);
+}
+
 KyberCiphertext KyberKEM::encapsulate(const std::vector<uint8_t>& public_key) {
     return impl_->encapsulate(public_key);
 }
 
+std::vector<KyberCiphertext> KyberKEM::encapsulate_many(const std::vector<std::vector<uint8_t>>& public_keys) {
+    return impl_->encapsulate_many(public_keys);
+}
+
 std::vector<uint8_t> KyberKEM::decapsulate(const std::vector<uint8_t>& ciphertext,
                                          const std::vector<uint8_t>& private_key) {
     return impl_->decapsulate(ciphertext, private_key);
@@ -117,5 +229,10 @@ int KyberKEM::getSecurityLevel() const {
     return 192; // KYBER768 provides 192-bit security
 }
 
+void KyberKEM::logAuditTrail(const std::string& operation, const std::vector<uint8_t>& data) {
+    // Queued for the audit writer thread; never blocks the KEM
+    AuditLog::global().record("kyber." + operation, data);
+}
+
 } // namespace crypto
 } // namespace quids
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "crypto/signature/BatchVerifier.hpp"
+#include "crypto/falcon/decoding.hpp"
+#include "crypto/falcon/utils.hpp"
+#include "crypto/falcon/verification.hpp"
+#include "utils/PerfCounters.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <numeric>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace quids {
+namespace crypto {
+
+namespace {
+
+template<size_t N>
+class FalconVerifier final : public SchemeVerifier {
+public:
+    std::shared_ptr<const PreparedKey> prepare(std::span<const uint8_t> public_key) const override {
+        if (public_key.size() != falcon_utils::compute_pkey_len<N>()) {
+            return nullptr;
+        }
+        auto key = std::make_shared<Key>();
+        if (!decoding::decode_pkey<N>(public_key.data(), key->h_ntt)) {
+            return nullptr;
+        }
+        ntt::ntt<log2<N>()>(key->h_ntt);
+        return key;
+    }
+
+    bool verify(const PreparedKey& key,
+                std::span<const uint8_t> message,
+                std::span<const uint8_t> signature) const override {
+        if (signature.size() != falcon_utils::compute_sig_len<N>()) {
+            return false;
+        }
+        // The decoder reads one byte past the last bit it consumes
+        std::array<uint8_t, falcon_utils::compute_sig_len<N>() + 1> padded{};
+        std::copy(signature.begin(), signature.end(), padded.begin());
+
+        constexpr int32_t beta2 = N == 512 ? 34034726 : 70265242;
+        const auto& k = static_cast<const Key&>(key);
+        return verification::verify_ntt<N, beta2>(k.h_ntt, message.data(), message.size(), padded.data());
+    }
+
+private:
+    struct Key final : PreparedKey {
+        ff::ff_t h_ntt[N];
+    };
+};
+
+std::string key_id(SignatureScheme scheme, std::span<const uint8_t> public_key) {
+    std::string id(1, static_cast<char>(scheme));
+    id.append(reinterpret_cast<const char*>(public_key.data()), public_key.size());
+    return id;
+}
+
+} // namespace
+
+std::unique_ptr<SchemeVerifier> makeFalconVerifier(size_t n) {
+    switch (n) {
+        case 512: return std::make_unique<FalconVerifier<512>>();
+        case 1024: return std::make_unique<FalconVerifier<1024>>();
+        default: throw std::invalid_argument("Falcon degree must be 512 or 1024");
+    }
+}
+
+struct BatchVerifier::Impl {
+    explicit Impl(size_t capacity) : generation_capacity(std::max<size_t>(1, capacity / 2)) {}
+
+    mutable std::shared_mutex schemes_mutex;
+    std::array<std::unique_ptr<SchemeVerifier>, NUM_SIGNATURE_SCHEMES> schemes;
+
+    // Two generations: a full current one replaces the previous one
+    using KeyMap = std::unordered_map<std::string, std::shared_ptr<const PreparedKey>>;
+    std::mutex cache_mutex;
+    KeyMap current;
+    KeyMap previous;
+    size_t generation_capacity;
+
+    std::atomic<uint64_t> signatures{0};
+    std::atomic<uint64_t> keys_decoded{0};
+    std::atomic<uint64_t> key_cache_hits{0};
+
+    // Caller holds cache_mutex
+    std::shared_ptr<const PreparedKey> cached(const std::string& id) {
+        if (auto it = current.find(id); it != current.end()) {
+            return it->second;
+        }
+        auto it = previous.find(id);
+        if (it == previous.end()) {
+            return nullptr;
+        }
+        auto key = std::move(it->second);
+        previous.erase(it);
+        admit(id, key);
+        return key;
+    }
+
+    void admit(const std::string& id, std::shared_ptr<const PreparedKey> key) {
+        if (current.size() >= generation_capacity) {
+            previous = std::move(current);
+            current.clear();
+        }
+        current.emplace(id, std::move(key));
+    }
+};
+
+BatchVerifier::BatchVerifier(utils::WorkStealingPool& pool, size_t key_cache_capacity)
+    : pool_(pool), impl_(std::make_unique<Impl>(key_cache_capacity)) {
+    impl_->schemes[static_cast<size_t>(SignatureScheme::Falcon512)] = makeFalconVerifier(512);
+    impl_->schemes[static_cast<size_t>(SignatureScheme::Falcon1024)] = makeFalconVerifier(1024);
+}
+
+BatchVerifier::~BatchVerifier() = default;
+
+BatchVerifier& BatchVerifier::global() {
+    static BatchVerifier verifier;
+    return verifier;
+}
+
+void BatchVerifier::register_scheme(SignatureScheme scheme, std::unique_ptr<SchemeVerifier> verifier) {
+    std::unique_lock<std::shared_mutex> lock(impl_->schemes_mutex);
+    impl_->schemes[static_cast<size_t>(scheme)] = std::move(verifier);
+}
+
+bool BatchVerifier::has_scheme(SignatureScheme scheme) const {
+    std::shared_lock<std::shared_mutex> lock(impl_->schemes_mutex);
+    return impl_->schemes[static_cast<size_t>(scheme)] != nullptr;
+}
+
+std::vector<uint8_t> BatchVerifier::verify(std::span<const VerifyItem> items) {
+    std::vector<uint8_t> result(items.size(), 0);
+    if (items.empty()) {
+        return result;
+    }
+    utils::PerfScope perf(utils::PerfStage::SignatureVerify);
+    // Held for the whole batch so a verifier is not replaced under us
+    std::shared_lock<std::shared_mutex> schemes_lock(impl_->schemes_mutex);
+
+    // Distinct keys in this batch
+    struct Slot {
+        std::string id;
+        const VerifyItem* first;
+        const SchemeVerifier* verifier;
+        std::shared_ptr<const PreparedKey> key;
+    };
+    std::vector<Slot> slots;
+    std::vector<uint32_t> slot_of(items.size());
+    {
+        // Keyed by the caller's bytes; the owned id is built once per key
+        struct Ref {
+            SignatureScheme scheme;
+            std::string_view key;
+            bool operator==(const Ref&) const = default;
+        };
+        struct RefHash {
+            size_t operator()(const Ref& r) const noexcept {
+                return std::hash<std::string_view>{}(r.key) ^ static_cast<size_t>(r.scheme);
+            }
+        };
+        std::unordered_map<Ref, uint32_t, RefHash> by_key;
+        for (size_t i = 0; i < items.size(); ++i) {
+            const auto& pk = items[i].public_key;
+            const Ref ref{items[i].scheme, {reinterpret_cast<const char*>(pk.data()), pk.size()}};
+            auto [it, inserted] = by_key.try_emplace(ref, static_cast<uint32_t>(slots.size()));
+            if (inserted) {
+                const auto scheme = static_cast<size_t>(items[i].scheme);
+                const SchemeVerifier* verifier = scheme < NUM_SIGNATURE_SCHEMES
+                    ? impl_->schemes[scheme].get() : nullptr;
+                slots.push_back({key_id(items[i].scheme, pk), &items[i], verifier, nullptr});
+            }
+            slot_of[i] = it->second;
+        }
+    }
+
+    // Cached keys first, then decode the rest in parallel
+    std::vector<uint32_t> missing;
+    {
+        std::lock_guard<std::mutex> lock(impl_->cache_mutex);
+        for (uint32_t s = 0; s < slots.size(); ++s) {
+            if (!slots[s].verifier) continue;
+            slots[s].key = impl_->cached(slots[s].id);
+            if (slots[s].key) {
+                impl_->key_cache_hits.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                missing.push_back(s);
+            }
+        }
+    }
+    pool_.parallel_for(0, missing.size(), [&](size_t m) {
+        Slot& slot = slots[missing[m]];
+        slot.key = slot.verifier->prepare(slot.first->public_key);
+    });
+    if (!missing.empty()) {
+        impl_->keys_decoded.fetch_add(missing.size(), std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(impl_->cache_mutex);
+        for (uint32_t s : missing) {
+            if (slots[s].key) impl_->admit(slots[s].id, slots[s].key);
+        }
+    }
+
+    // Items under the same key run next to each other
+    std::vector<uint32_t> order(items.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return slot_of[a] < slot_of[b];
+    });
+    pool_.parallel_for(0, order.size(), [&](size_t j) {
+        const uint32_t i = order[j];
+        const Slot& slot = slots[slot_of[i]];
+        if (slot.key) {
+            result[i] = slot.verifier->verify(*slot.key, items[i].message, items[i].signature) ? 1 : 0;
+        }
+    }, utils::TaskPriority::Execution, 4);
+
+    impl_->signatures.fetch_add(items.size(), std::memory_order_relaxed);
+    return result;
+}
+
+BatchVerifier::Stats BatchVerifier::stats() const {
+    return {impl_->signatures.load(std::memory_order_relaxed),
+            impl_->keys_decoded.load(std::memory_order_relaxed),
+            impl_->key_cache_hits.load(std::memory_order_relaxed)};
+}
+
+} // namespace crypto
+} // namespace quids
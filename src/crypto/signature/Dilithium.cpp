@@ -1,4 +1,7 @@
 #include "crypto/signature/Dilithium.hpp"
+#include "crypto/signature/BatchVerifier.hpp"
+#include "crypto/BotanOps.hpp"
+#include "crypto/KeyPairPool.hpp"
 #include <botan/auto_rng.h>
 #include <botan/pubkey.h>
 #include <botan/dilithium.h>
@@ -6,14 +9,32 @@
 namespace quids {
 namespace crypto {
 
+namespace {
+
+constexpr size_t KEY_POOL_DEPTH = 4;
+
+// Whole Botan keys, so taking one skips re-expanding the matrix from bits;
+// Botan wipes the secret when a key is destroyed
+KeyPairPool<std::unique_ptr<Botan::Dilithium_PrivateKey>>& keyPool() {
+    static KeyPairPool<std::unique_ptr<Botan::Dilithium_PrivateKey>> pool([] {
+        return std::make_unique<Botan::Dilithium_PrivateKey>(threadRng(), Botan::DilithiumMode(Botan::DilithiumMode::Dilithium8x7));
+    }, KEY_POOL_DEPTH);
+    return pool;
+}
+
+} // namespace
+
 class DilithiumSigner::Impl {
 public:
     Impl() = default;
 
     void generateKeyPair() {
-        Botan::AutoSeeded_RNG rng;
-        m_private_key = std::make_unique<Botan::Dilithium_PrivateKey>(rng, Botan::DilithiumMode(Botan::DilithiumMode::Dilithium8x7));
+        m_signers.reset();
+        m_private_key = keyPool().take();
         m_public_key = std::unique_ptr<Botan::Public_Key>(m_private_key->public_key().release());
+        m_signers = std::make_unique<BotanOpPool<Botan::PK_Signer>>([key = m_private_key.get()] {
+            return std::make_unique<Botan::PK_Signer>(*key, threadRng(), "Randomized");
+        });
     }
 
     std::vector<uint8_t> getPublicKey() const {
@@ -36,19 +57,25 @@ public:
             throw std::runtime_error("No private key available. Call generateKeyPair() first.");
         }
 
-        Botan::AutoSeeded_RNG rng;
-        Botan::PK_Signer signer(*m_private_key, rng, "Randomized");
-        return signer.sign_message(message, rng);
+        auto signer = m_signers->acquire();
+        return signer->sign_message(message, threadRng());
     }
 
     bool verify(const std::vector<uint8_t>& message,
                const std::vector<uint8_t>& signature,
                const std::vector<uint8_t>& public_key) {
+        // Peers verify against the same key over and over; keep the last one
+        thread_local VerifyCache cache;
         try {
-            Botan::Dilithium_PublicKey verify_key(public_key, Botan::DilithiumMode(Botan::DilithiumMode::Dilithium8x7));
-            Botan::PK_Verifier verifier(verify_key, "Randomized");
-            return verifier.verify_message(message, signature);
+            if (!cache.verifier || cache.key_bits != public_key) {
+                cache.reset();
+                cache.key = std::make_unique<Botan::Dilithium_PublicKey>(public_key, Botan::DilithiumMode(Botan::DilithiumMode::Dilithium8x7));
+                cache.verifier = std::make_unique<Botan::PK_Verifier>(*cache.key, "Randomized");
+                cache.key_bits = public_key;
+            }
+            return cache.verifier->verify_message(message, signature);
         } catch (const std::exception& e) {
+            cache.reset();
             return false;
         }
     }
@@ -57,9 +84,7 @@ public:
         if (!m_private_key) {
             throw std::runtime_error("No key available. Call generateKeyPair() first.");
         }
-        Botan::AutoSeeded_RNG rng;
-        Botan::PK_Signer signer(*m_private_key, rng, "Randomized");
-        return signer.signature_length();
+        return m_signers->acquire()->signature_length();
     }
 
     size_t getPublicKeySize() const {
@@ -87,8 +112,23 @@ public:
    
 
 private:
+    struct VerifyCache {
+        std::vector<uint8_t> key_bits;
+        std::unique_ptr<Botan::Dilithium_PublicKey> key;
+        std::unique_ptr<Botan::PK_Verifier> verifier;
+
+        // The verifier refers to the key, so it goes first
+        void reset() {
+            verifier.reset();
+            key.reset();
+            key_bits.clear();
+        }
+    };
+
     std::unique_ptr<Botan::Dilithium_PrivateKey> m_private_key;
     std::unique_ptr<Botan::Public_Key> m_public_key;
+    // Signers refer to m_private_key and are dropped before it
+    std::unique_ptr<BotanOpPool<Botan::PK_Signer>> m_signers;
 };
 
 DilithiumSigner::DilithiumSigner() : impl_(std::make_unique<Impl>()) {}
@@ -98,6 +138,10 @@ void DilithiumSigner::generateKeyPair() {
     impl_->generateKeyPair();
 }
 
+void DilithiumSigner::setKeyPoolDepth(size_t depth) {
+    keyPool().setDepth(depth);
+}
+
 std::vector<uint8_t> DilithiumSigner::getPublicKey() const {
     return impl_->getPublicKey();
 }
@@ -136,5 +180,43 @@ std::string DilithiumSigner::getName() const {
     return impl_->getName();
 }
 
+namespace {
+
+class DilithiumSignerBatchVerifier final : public SchemeVerifier {
+public:
+    std::shared_ptr<const PreparedKey> prepare(std::span<const uint8_t> public_key) const override {
+        try {
+            auto key = std::make_shared<Key>();
+            key->key = std::make_unique<Botan::Dilithium_PublicKey>(public_key, Botan::DilithiumMode(Botan::DilithiumMode::Dilithium8x7));
+            return key;
+        } catch (const std::exception&) {
+            return nullptr;
+        }
+    }
+
+    bool verify(const PreparedKey& key,
+                std::span<const uint8_t> message,
+                std::span<const uint8_t> signature) const override {
+        try {
+            // A verifier per call: Botan keys are shareable, verifiers are not
+            Botan::PK_Verifier verifier(*static_cast<const Key&>(key).key, "Randomized");
+            return verifier.verify_message(message.data(), message.size(), signature.data(), signature.size());
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+private:
+    struct Key final : PreparedKey {
+        std::unique_ptr<Botan::Dilithium_PublicKey> key;
+    };
+};
+
+} // namespace
+
+std::unique_ptr<SchemeVerifier> DilithiumSigner::batchVerifier() {
+    return std::make_unique<DilithiumSignerBatchVerifier>();
+}
+
 } // namespace crypto
 } // namespace quids
\ No newline at end of file
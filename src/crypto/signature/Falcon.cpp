@@ -0,0 +1,320 @@
+#include "crypto/signature/Falcon.hpp"
+#include "crypto/signature/BatchVerifier.hpp"
+#include "crypto/KeyPairPool.hpp"
+#include "crypto/falcon/falcon.hpp"
+#include <blake3.h>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace quids {
+namespace crypto {
+
+namespace {
+
+constexpr size_t N = 512;
+// Falcon keygen runs to tens of milliseconds
+constexpr size_t KEY_POOL_DEPTH = 4;
+
+const SchemeVerifier& falconVerifier() {
+    static const auto verifier = makeFalconVerifier(N);
+    return *verifier;
+}
+
+constexpr size_t TREE_SIZE = N * (::log2<N>() + 1);
+
+void secureZero(void* data, size_t size) {
+    volatile uint8_t* p = static_cast<volatile uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        p[i] = 0;
+    }
+}
+
+struct FalconKeyPair {
+    std::vector<uint8_t> public_key;
+    std::vector<uint8_t> private_key;
+    std::shared_ptr<const SigningKey> signing_key;
+};
+
+KeyPairPool<FalconKeyPair>& keyPool() {
+    static KeyPairPool<FalconKeyPair> pool([] {
+        FalconKeyPair pair;
+        pair.public_key.assign(falcon_utils::compute_pkey_len<N>(), 0);
+        pair.private_key.assign(falcon_utils::compute_skey_len<N>(), 0);
+        ::falcon::keygen<N>(pair.public_key.data(), pair.private_key.data());
+        // Expanding here keeps the tree build off the first sign() as well
+        pair.signing_key = SigningKey::load(pair.private_key);
+        return pair;
+    }, KEY_POOL_DEPTH);
+    return pool;
+}
+
+struct FingerprintHash {
+    size_t operator()(const PreparedPublicKey::Fingerprint& f) const noexcept {
+        size_t h;
+        std::memcpy(&h, f.data(), sizeof(h));
+        return h;
+    }
+};
+
+} // namespace
+
+PreparedPublicKey::Fingerprint PreparedPublicKey::fingerprint(const std::vector<uint8_t>& public_key) {
+    Fingerprint out;
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, public_key.data(), public_key.size());
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+std::shared_ptr<const PreparedPublicKey> PreparedPublicKey::prepare(const std::vector<uint8_t>& public_key) {
+    auto key = falconVerifier().prepare(public_key);
+    if (!key) {
+        return nullptr;
+    }
+    auto prepared = std::make_shared<PreparedPublicKey>();
+    prepared->fingerprint_ = fingerprint(public_key);
+    prepared->key_ = std::move(key);
+    return prepared;
+}
+
+class PreparedKeyCache::Impl {
+public:
+    explicit Impl(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+    std::shared_ptr<const PreparedPublicKey> get(const std::vector<uint8_t>& public_key) {
+        const auto fingerprint = PreparedPublicKey::fingerprint(public_key);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (auto it = index_.find(fingerprint); it != index_.end()) {
+                entries_.splice(entries_.begin(), entries_, it->second);
+                ++stats_.hits;
+                return it->second->second;
+            }
+            ++stats_.misses;
+        }
+
+        // Decode outside the lock; a racing thread may insert the same key
+        auto prepared = PreparedPublicKey::prepare(public_key);
+        if (!prepared) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto it = index_.find(fingerprint); it != index_.end()) {
+            return it->second->second;
+        }
+        entries_.emplace_front(fingerprint, prepared);
+        index_.emplace(fingerprint, entries_.begin());
+        while (entries_.size() > capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        return prepared;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_.clear();
+        entries_.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    using Entry = std::pair<PreparedPublicKey::Fingerprint, std::shared_ptr<const PreparedPublicKey>>;
+
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;  // most recently used first
+    std::unordered_map<PreparedPublicKey::Fingerprint, std::list<Entry>::iterator, FingerprintHash> index_;
+    Stats stats_;
+};
+
+PreparedKeyCache::PreparedKeyCache(size_t capacity) : impl_(std::make_unique<Impl>(capacity)) {}
+PreparedKeyCache::~PreparedKeyCache() = default;
+
+PreparedKeyCache& PreparedKeyCache::global() {
+    static PreparedKeyCache cache;
+    return cache;
+}
+
+std::shared_ptr<const PreparedPublicKey> PreparedKeyCache::get(const std::vector<uint8_t>& public_key) {
+    return impl_->get(public_key);
+}
+
+void PreparedKeyCache::clear() {
+    impl_->clear();
+}
+
+size_t PreparedKeyCache::size() const {
+    return impl_->size();
+}
+
+PreparedKeyCache::Stats PreparedKeyCache::stats() const {
+    return impl_->stats();
+}
+
+struct SigningKey::Expanded {
+    alignas(64) fft::cmplx B[2 * 2 * N];
+    alignas(64) fft::cmplx T[TREE_SIZE];
+
+    ~Expanded() {
+        secureZero(B, sizeof(B));
+        secureZero(T, sizeof(T));
+    }
+};
+
+SigningKey::SigningKey() : expanded_(std::make_unique<Expanded>()) {}
+SigningKey::~SigningKey() = default;
+
+std::shared_ptr<const SigningKey> SigningKey::load(const std::vector<uint8_t>& private_key) {
+    if (private_key.size() != falcon_utils::compute_skey_len<N>()) {
+        return nullptr;
+    }
+    int32_t f[N];
+    int32_t g[N];
+    int32_t F[N];
+    int32_t G[N];
+    std::shared_ptr<SigningKey> key;
+    if (decoding::decode_skey<N>(private_key.data(), f, g, F)) {
+        key.reset(new SigningKey());
+        ::falcon::recompute_G<N>(f, g, F, G);
+        ::falcon::compute_matrix_B<N>(f, g, F, G, key->expanded_->B);
+        ::falcon::compute_falcon_tree<N>(key->expanded_->B, key->expanded_->T);
+    }
+    secureZero(f, sizeof(f));
+    secureZero(g, sizeof(g));
+    secureZero(F, sizeof(F));
+    secureZero(G, sizeof(G));
+    return key;
+}
+
+std::vector<uint8_t> SigningKey::sign(const std::vector<uint8_t>& message) const {
+    // Seeding reads the system random device, so once per thread
+    thread_local prng::prng_t rng;
+    std::vector<uint8_t> signature(falcon_utils::compute_sig_len<N>(), 0);
+    ::falcon::sign<N>(expanded_->B, expanded_->T, message.data(), message.size(), signature.data(), rng);
+    return signature;
+}
+
+class FalconSigner::Impl {
+public:
+    void generateKeyPair() {
+        auto pair = keyPool().take();
+        if (!pair.signing_key) {
+            throw std::runtime_error("Key generation failed");
+        }
+        std::fill(m_private_key.begin(), m_private_key.end(), 0);
+        m_public_key = std::move(pair.public_key);
+        m_private_key = std::move(pair.private_key);
+        m_signing_key = std::move(pair.signing_key);
+    }
+
+    const std::vector<uint8_t>& getPublicKey() const {
+        if (m_public_key.empty()) {
+            throw std::runtime_error("No public key available. Call generateKeyPair() first.");
+        }
+        return m_public_key;
+    }
+
+    const std::vector<uint8_t>& getPrivateKey() const {
+        if (m_private_key.empty()) {
+            throw std::runtime_error("No private key available. Call generateKeyPair() first.");
+        }
+        return m_private_key;
+    }
+
+    const std::shared_ptr<const SigningKey>& getSigningKey() const {
+        if (!m_signing_key) {
+            throw std::runtime_error("No private key available. Call generateKeyPair() first.");
+        }
+        return m_signing_key;
+    }
+
+    std::vector<uint8_t> sign(const std::vector<uint8_t>& message) {
+        return getSigningKey()->sign(message);
+    }
+
+    ~Impl() {
+        std::fill(m_private_key.begin(), m_private_key.end(), 0);
+    }
+
+private:
+    std::vector<uint8_t> m_public_key;
+    std::vector<uint8_t> m_private_key;
+    std::shared_ptr<const SigningKey> m_signing_key;
+};
+
+FalconSigner::FalconSigner() : impl_(std::make_unique<Impl>()) {}
+FalconSigner::~FalconSigner() = default;
+
+void FalconSigner::generateKeyPair() {
+    impl_->generateKeyPair();
+}
+
+void FalconSigner::setKeyPoolDepth(size_t depth) {
+    keyPool().setDepth(depth);
+}
+
+std::vector<uint8_t> FalconSigner::getPublicKey() const {
+    return impl_->getPublicKey();
+}
+
+std::vector<uint8_t> FalconSigner::getPrivateKey() const {
+    return impl_->getPrivateKey();
+}
+
+std::vector<uint8_t> FalconSigner::sign(const std::vector<uint8_t>& message) {
+    return impl_->sign(message);
+}
+
+std::shared_ptr<const SigningKey> FalconSigner::getSigningKey() const {
+    return impl_->getSigningKey();
+}
+
+bool FalconSigner::verify(const std::vector<uint8_t>& message,
+                          const std::vector<uint8_t>& signature,
+                          const std::vector<uint8_t>& public_key) {
+    auto prepared = PreparedKeyCache::global().get(public_key);
+    return prepared && verify(message, signature, *prepared);
+}
+
+bool FalconSigner::verify(const std::vector<uint8_t>& message,
+                          const std::vector<uint8_t>& signature,
+                          const PreparedPublicKey& public_key) {
+    return falconVerifier().verify(*public_key.key_, message, signature);
+}
+
+size_t FalconSigner::getSignatureSize() const {
+    return falcon_utils::compute_sig_len<N>();
+}
+
+size_t FalconSigner::getPublicKeySize() const {
+    return falcon_utils::compute_pkey_len<N>();
+}
+
+size_t FalconSigner::getPrivateKeySize() const {
+    return falcon_utils::compute_skey_len<N>();
+}
+
+std::string FalconSigner::getName() const {
+    return "FALCON512";
+}
+
+int FalconSigner::getSecurityLevel() const {
+    return 1;
+}
+
+} // namespace crypto
+} // namespace quids
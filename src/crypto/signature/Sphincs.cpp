@@ -1,4 +1,6 @@
 #include "crypto/signature/Sphincs.hpp"
+#include "crypto/signature/BatchVerifier.hpp"
+#include "crypto/BotanOps.hpp"
 #include <botan/auto_rng.h>
 #include <botan/pubkey.h>
 #include <botan/sphincsplus.h>
@@ -12,9 +14,12 @@ public:
     Impl() = default;
 
     void generateKeyPair() {
-        Botan::AutoSeeded_RNG rng;
-        m_private_key = std::make_unique<Botan::SphincsPlus_PrivateKey>(rng, Botan::Sphincs_Parameter_Set::SLHDSA256Fast, Botan::Sphincs_Hash_Type::Sha256);
+        m_signers.reset();
+        m_private_key = std::make_unique<Botan::SphincsPlus_PrivateKey>(threadRng(), Botan::Sphincs_Parameter_Set::SLHDSA256Fast, Botan::Sphincs_Hash_Type::Sha256);
         m_public_key = std::unique_ptr<Botan::Public_Key>(m_private_key->public_key().release());
+        m_signers = std::make_unique<BotanOpPool<Botan::PK_Signer>>([key = m_private_key.get()] {
+            return std::make_unique<Botan::PK_Signer>(*key, threadRng(), "SHA-512");
+        });
     }
 
     std::vector<uint8_t> getPublicKey() const {
@@ -37,19 +42,25 @@ public:
             throw std::runtime_error("No private key available. Call generateKeyPair() first.");
         }
 
-        Botan::AutoSeeded_RNG rng;
-        Botan::PK_Signer signer(*m_private_key, rng, "SHA-512");
-        return signer.sign_message(message, rng);
+        auto signer = m_signers->acquire();
+        return signer->sign_message(message, threadRng());
     }
 
     bool verify(const std::vector<uint8_t>& message,
                const std::vector<uint8_t>& signature,
                const std::vector<uint8_t>& public_key) {
+        // Peers verify against the same key over and over; keep the last one
+        thread_local VerifyCache cache;
         try {
-            Botan::SphincsPlus_PublicKey verify_key(public_key, Botan::Sphincs_Parameter_Set::SLHDSA256Fast, Botan::Sphincs_Hash_Type::Sha256);
-            Botan::PK_Verifier verifier(verify_key, "SHA-512");
-            return verifier.verify_message(message, signature);
+            if (!cache.verifier || cache.key_bits != public_key) {
+                cache.reset();
+                cache.key = std::make_unique<Botan::SphincsPlus_PublicKey>(public_key, Botan::Sphincs_Parameter_Set::SLHDSA256Fast, Botan::Sphincs_Hash_Type::Sha256);
+                cache.verifier = std::make_unique<Botan::PK_Verifier>(*cache.key, "SHA-512");
+                cache.key_bits = public_key;
+            }
+            return cache.verifier->verify_message(message, signature);
         } catch (const std::exception& e) {
+            cache.reset();
             return false;
         }
     }
@@ -58,9 +69,7 @@ public:
         if (!m_private_key) {
             throw std::runtime_error("No key available. Call generateKeyPair() first.");
         }
-        Botan::AutoSeeded_RNG rng;
-        Botan::PK_Signer signer(*m_private_key, rng, "SHA-512");
-        return signer.signature_length();
+        return m_signers->acquire()->signature_length();
     }
 
     size_t getPublicKeySize() const {
@@ -90,8 +99,23 @@ public:
     }
 
 private:
+    struct VerifyCache {
+        std::vector<uint8_t> key_bits;
+        std::unique_ptr<Botan::SphincsPlus_PublicKey> key;
+        std::unique_ptr<Botan::PK_Verifier> verifier;
+
+        // The verifier refers to the key, so it goes first
+        void reset() {
+            verifier.reset();
+            key.reset();
+            key_bits.clear();
+        }
+    };
+
     std::unique_ptr<Botan::SphincsPlus_PrivateKey> m_private_key;
     std::unique_ptr<Botan::Public_Key> m_public_key;
+    // Signers refer to m_private_key and are dropped before it
+    std::unique_ptr<BotanOpPool<Botan::PK_Signer>> m_signers;
 };
 
 SphincsPlus::SphincsPlus() : impl_(std::make_unique<Impl>()) {}
@@ -143,5 +167,43 @@ std::string SphincsPlus::getVariant() const {
     return impl_->getVariant();
 }
 
+namespace {
+
+class SphincsPlusBatchVerifier final : public SchemeVerifier {
+public:
+    std::shared_ptr<const PreparedKey> prepare(std::span<const uint8_t> public_key) const override {
+        try {
+            auto key = std::make_shared<Key>();
+            key->key = std::make_unique<Botan::SphincsPlus_PublicKey>(public_key, Botan::Sphincs_Parameter_Set::SLHDSA256Fast, Botan::Sphincs_Hash_Type::Sha256);
+            return key;
+        } catch (const std::exception&) {
+            return nullptr;
+        }
+    }
+
+    bool verify(const PreparedKey& key,
+                std::span<const uint8_t> message,
+                std::span<const uint8_t> signature) const override {
+        try {
+            // A verifier per call: Botan keys are shareable, verifiers are not
+            Botan::PK_Verifier verifier(*static_cast<const Key&>(key).key, "SHA-512");
+            return verifier.verify_message(message.data(), message.size(), signature.data(), signature.size());
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+private:
+    struct Key final : PreparedKey {
+        std::unique_ptr<Botan::SphincsPlus_PublicKey> key;
+    };
+};
+
+} // namespace
+
+std::unique_ptr<SchemeVerifier> SphincsPlus::batchVerifier() {
+    return std::make_unique<SphincsPlusBatchVerifier>();
+}
+
 } // namespace crypto
 } // namespace quids
\ No newline at end of file
@@ -1,17 +1,46 @@
 #include "evm/Address.hpp"
+#include "evm/Keccak.hpp"
+#include "utils/Hex.hpp"
 #include <algorithm>
 
 namespace evm {
 
-bool Address::operator==(const Address& other) const {
-    return bytes == other.bytes;
+std::optional<Address> Address::from_hex(std::string_view hex) {
+    if (hex.starts_with("0x") || hex.starts_with("0X")) {
+        hex.remove_prefix(2);
+    }
+    if (hex.empty() || hex.size() > 40) {
+        return std::nullopt;
+    }
+
+    Address address{};
+    // Digits fill from the right; an odd count leaves a half byte at the top
+    size_t byte = address.bytes.size() - hex.size() / 2;
+    if (hex.size() % 2 != 0) {
+        const char top[2] = {'0', hex.front()};
+        if (!quids::utils::hexDecode({top, 2}, &address.bytes[byte - 1])) {
+            return std::nullopt;
+        }
+        hex.remove_prefix(1);
+    }
+    if (!quids::utils::hexDecode(hex, address.bytes.data() + byte)) {
+        return std::nullopt;
+    }
+    return address;
+}
+
+Address Address::from_string(std::string_view text) {
+    if (auto address = from_hex(text)) {
+        return *address;
+    }
+    const auto hash = quids::evm::keccak256(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    Address address;
+    std::copy(hash.end() - 20, hash.end(), address.bytes.begin());
+    return address;
 }
 
-bool Address::operator<(const Address& other) const {
-    return std::lexicographical_compare(
-        bytes.begin(), bytes.end(),
-        other.bytes.begin(), other.bytes.end()
-    );
+std::string Address::to_hex() const {
+    return quids::utils::toHex(bytes);
 }
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
@@ -0,0 +1,296 @@
+#include "evm/CodeAnalysis.hpp"
+#include "evm/OpcodeTable.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+namespace quids {
+namespace evm {
+
+namespace {
+
+// Accumulates one basic block while the code is walked
+struct BlockBuilder {
+    explicit BlockBuilder(AnalyzedCode& code) : out(code) {}
+
+    AnalyzedCode& out;
+    size_t index{0};
+    bool open{false};
+    uint64_t gas{0};
+    int32_t height{0};
+    int32_t required{0};
+    int32_t growth{0};
+    std::vector<std::pair<size_t, uint64_t>> gas_ops;  // GAS/SSTORE instruction, block gas through it
+
+    void begin(uint8_t handler) {
+        index = out.blocks.size();
+        out.blocks.push_back(BlockInfo{});
+        out.instructions.push_back(Instruction{handler, static_cast<uint32_t>(index)});
+        open = true;
+        gas = 0;
+        height = required = growth = 0;
+        gas_ops.clear();
+    }
+
+    void account(const OpInfo& info) {
+        required = std::max(required, info.in - height);
+        height += info.out - info.in;
+        growth = std::max(growth, height);
+        gas += info.gas;
+    }
+
+    void end() {
+        if (!open) return;
+        out.blocks[index] = BlockInfo{gas, required, growth};
+        for (const auto& [instr, through] : gas_ops) {
+            out.instructions[instr].arg = static_cast<uint32_t>(std::min<uint64_t>(gas - through, UINT32_MAX));
+        }
+        open = false;
+    }
+};
+
+// One instantiation per fork, so the table lookups are into a constant
+template <Fork F>
+std::shared_ptr<const AnalyzedCode> analyze_for(std::vector<uint8_t> code, const Hash256& code_hash) {
+    constexpr const OpTable& ops = OP_TABLE<F>;
+    auto result = std::make_shared<AnalyzedCode>();
+    AnalyzedCode& a = *result;
+    a.code_hash = code_hash;
+    a.fork = F;
+    a.code = std::move(code);
+
+    const size_t n = a.code.size();
+    const uint8_t* bytes = a.code.data();
+    a.jumpdest_bitmap.assign((n + 63) / 64, 0);
+    a.jumpdest_index.assign(n, 0);
+    a.instructions.reserve(n + 2);
+
+    BlockBuilder block(a);
+    bool falls_through = true;
+    for (size_t pc = 0; pc < n; ++pc) {
+        const uint8_t op = bytes[pc];
+        const OpInfo& info = ops[op];
+
+        if (op == JUMPDEST) {
+            block.end();
+            a.jumpdest_bitmap[pc >> 6] |= uint64_t{1} << (pc & 63);
+            a.jumpdest_index[pc] = static_cast<uint32_t>(a.instructions.size());
+            block.begin(H_JUMPDEST);
+            block.account(info);
+            falls_through = true;
+            continue;
+        }
+        if (!block.open) {
+            block.begin(H_BEGIN_BLOCK);
+        }
+
+        Instruction instr{info.handler, 0};
+        if (info.handler == H_PUSH) {
+            const size_t width = info.immediate;
+            const size_t available = std::min(width, n - pc - 1);
+            // Missing trailing bytes read as zero
+            uint8_t imm[32] = {};
+            std::copy(bytes + pc + 1, bytes + pc + 1 + available, imm);
+            instr.arg = static_cast<uint32_t>(a.push_values.size());
+            a.push_values.push_back(::evm::uint256_t::load_be(imm, width));
+            pc += width;
+        } else if (op >= DUP1 && op <= DUP16) {
+            instr.arg = op - DUP1 + 1;
+        } else if (op >= SWAP1 && op <= SWAP16) {
+            instr.arg = op - SWAP1 + 1;
+        } else if (op >= LOG0 && op <= LOG4) {
+            instr.arg = op - LOG0;
+        } else if (op == PC || info.handler == H_CALL || info.handler == H_CREATE) {
+            instr.arg = op == PC ? static_cast<uint32_t>(pc) : op;
+        }
+
+        block.account(info);
+        if (op == GAS || op == SSTORE) {
+            block.gas_ops.emplace_back(a.instructions.size(), block.gas);
+        }
+        a.instructions.push_back(instr);
+        // Execution resumes after a call, too
+        falls_through = !info.ends_block || op == JUMPI || info.handler == H_CALL || info.handler == H_CREATE;
+        if (info.ends_block) {
+            block.end();
+        }
+    }
+
+    // Running off the end is a STOP. It needs a block of its own only if
+    // the last instruction can fall into it, i.e. a JUMPI.
+    if (!block.open && falls_through) {
+        block.begin(H_BEGIN_BLOCK);
+    }
+    a.instructions.push_back(Instruction{H_STOP, 0});
+    block.end();
+    return result;
+}
+
+} // namespace
+
+std::shared_ptr<const AnalyzedCode> analyze(std::vector<uint8_t> code, const Hash256& code_hash, Fork fork) {
+    switch (fork) {
+        case Fork::Berlin: return analyze_for<Fork::Berlin>(std::move(code), code_hash);
+        case Fork::London: return analyze_for<Fork::London>(std::move(code), code_hash);
+        case Fork::Shanghai: break;
+    }
+    return analyze_for<Fork::Shanghai>(std::move(code), code_hash);
+}
+
+std::shared_ptr<const AnalyzedCode> optimize(const AnalyzedCode& code) {
+    auto result = std::make_shared<AnalyzedCode>(code);
+    result->tier = 1;
+    auto& instructions = result->instructions;
+
+    for (size_t i = 0; i + 1 < instructions.size(); ++i) {
+        Instruction& push = instructions[i];
+        if (push.op != H_PUSH) continue;
+        const ::evm::uint256_t& value = result->push_values[push.arg];
+
+        switch (instructions[i + 1].op) {
+            case H_JUMP:
+            case H_JUMPI:
+                // Bad targets keep the generic path so they still fail when reached
+                if (value < code.code.size() && code.is_jumpdest(static_cast<uint64_t>(value))) {
+                    push.op = instructions[i + 1].op == H_JUMP ? H_JUMP_STATIC : H_JUMPI_STATIC;
+                    push.arg = code.jumpdest_index[static_cast<size_t>(value)];
+                }
+                break;
+            case H_ADD: push.op = H_PUSH_ADD; break;
+            case H_SUB: push.op = H_PUSH_SUB; break;
+            case H_AND: push.op = H_PUSH_AND; break;
+            case H_EQ: push.op = H_PUSH_EQ; break;
+            default: continue;
+        }
+        // The partner is covered by the fused instruction; never fuse it again
+        if (push.op != H_PUSH) ++i;
+    }
+    return result;
+}
+
+CodeCache::CodeCache(size_t capacity, uint32_t hot_threshold)
+    : capacity_(std::max<size_t>(capacity, 1)), hot_threshold_(hot_threshold) {}
+
+std::shared_ptr<const AnalyzedCode> CodeCache::get(const std::vector<uint8_t>& code) {
+    return get(keccak256(code), code);
+}
+
+std::shared_ptr<const AnalyzedCode> CodeCache::get(const Hash256& code_hash, const std::vector<uint8_t>& code) {
+    std::shared_ptr<const AnalyzedCode> cold;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = entries_.find(code_hash);
+        if (it != entries_.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            Entry& entry = it->second;
+            // Exactly one caller sees the count reach the threshold
+            if (hot_threshold_ == 0 || entry.code->tier != 0 ||
+                entry.calls.fetch_add(1, std::memory_order_relaxed) + 1 != hot_threshold_) {
+                return entry.code;
+            }
+            cold = entry.code;
+        }
+    }
+
+    if (cold) {
+        // Optimised outside the lock; callers keep using the first tier meanwhile
+        auto hot = optimize(*cold);
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = entries_.find(code_hash);
+        if (it != entries_.end() && it->second.code == cold) {
+            it->second.code = hot;
+            promotions_++;
+        }
+        return hot;
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    // Analysed outside the lock; a racing thread's copy is simply dropped
+    auto analyzed = analyze(code, code_hash);
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto [it, inserted] = entries_.try_emplace(code_hash);
+    if (!inserted) {
+        return it->second.code;
+    }
+    it->second.code = analyzed;
+    order_.push_back(code_hash);
+    while (entries_.size() > capacity_) {
+        entries_.erase(order_.front());
+        order_.pop_front();
+        evictions_++;
+    }
+    return analyzed;
+}
+
+std::vector<CodeCache::WarmEntry> CodeCache::export_warm(size_t limit) const {
+    std::vector<std::pair<uint64_t, const AnalyzedCode*>> ranked;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    ranked.reserve(entries_.size());
+    for (const auto& [hash, entry] : entries_) {
+        // Promoted entries stop counting, so rank them above everything
+        const uint64_t rank = entry.code->tier != 0 ? std::numeric_limits<uint64_t>::max() : entry.calls.load(std::memory_order_relaxed);
+        ranked.emplace_back(rank, entry.code.get());
+    }
+    const size_t n = std::min(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(n), ranked.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::vector<WarmEntry> warm;
+    warm.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        warm.push_back({ranked[i].second->code, ranked[i].second->tier != 0});
+    }
+    return warm;
+}
+
+size_t CodeCache::import_warm(const std::vector<WarmEntry>& entries) {
+    size_t added = 0;
+    for (const auto& warm : entries) {
+        const Hash256 code_hash = keccak256(warm.code);
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            if (entries_.count(code_hash) != 0) {
+                continue;
+            }
+        }
+        auto analyzed = analyze(warm.code, code_hash);
+        if (warm.hot && hot_threshold_ != 0) {
+            analyzed = optimize(*analyzed);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        // Never evict live entries to make room for restored ones
+        if (entries_.size() >= capacity_) {
+            break;
+        }
+        auto [it, inserted] = entries_.try_emplace(code_hash);
+        if (!inserted) {
+            continue;
+        }
+        it->second.code = std::move(analyzed);
+        order_.push_back(code_hash);
+        ++added;
+    }
+    return added;
+}
+
+void CodeCache::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    entries_.clear();
+    order_.clear();
+}
+
+CodeCache::Stats CodeCache::stats() const {
+    Stats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    s.evictions = evictions_;
+    s.promotions = promotions_;
+    return s;
+}
+
+} // namespace evm
+} // namespace quids
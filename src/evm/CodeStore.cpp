@@ -0,0 +1,117 @@
+#include "evm/CodeStore.hpp"
+
+#include <cstring>
+#include <mutex>
+
+namespace quids {
+namespace evm {
+
+struct CodeStore::Table {
+    struct HashKey {
+        size_t operator()(const Hash256& h) const noexcept {
+            // Already uniformly distributed
+            size_t v;
+            std::memcpy(&v, h.data(), sizeof(v));
+            return v;
+        }
+    };
+
+    mutable std::shared_mutex mutex;
+    // Expired pointers linger only until their entry's deleter runs
+    std::unordered_map<Hash256, std::weak_ptr<const Entry>, HashKey> entries;
+    size_t live{0};
+    size_t bytes{0};
+    // Bumped under either lock
+    std::atomic<uint64_t> interned{0};
+    std::atomic<uint64_t> shared{0};
+};
+
+std::shared_ptr<const AnalyzedCode> CodeStore::Entry::analysis() const {
+    if (auto hot = hot_.load(std::memory_order_acquire)) {
+        return hot;
+    }
+    // Counts towards promotion like any other fetch
+    auto current = CodeCache::global().get(hash(), code());
+    if (current->tier != 0) {
+        hot_.store(current, std::memory_order_release);
+    }
+    return current;
+}
+
+CodeStore::CodeStore() : table_(std::make_shared<Table>()) {}
+
+CodeStore::~CodeStore() = default;
+
+std::shared_ptr<const CodeStore::Entry> CodeStore::intern(std::vector<uint8_t> code) {
+    const Hash256 code_hash = keccak256(code);
+    return intern(code_hash, std::move(code));
+}
+
+std::shared_ptr<const CodeStore::Entry> CodeStore::intern(const Hash256& code_hash, std::vector<uint8_t> code) {
+    table_->interned.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::shared_lock<std::shared_mutex> lock(table_->mutex);
+        auto it = table_->entries.find(code_hash);
+        if (it != table_->entries.end()) {
+            if (auto entry = it->second.lock()) {
+                table_->shared.fetch_add(1, std::memory_order_relaxed);
+                return entry;
+            }
+        }
+    }
+
+    // Analysed, or found in the cache, outside the lock
+    auto base = CodeCache::global().get(code_hash, code);
+
+    std::unique_lock<std::shared_mutex> lock(table_->mutex);
+    auto& slot = table_->entries[code_hash];
+    if (auto entry = slot.lock()) {
+        table_->shared.fetch_add(1, std::memory_order_relaxed);
+        return entry;
+    }
+    const size_t size = base->code.size();
+    std::weak_ptr<Table> owner = table_;
+    std::shared_ptr<const Entry> entry(new Entry(std::move(base)), [owner, size](const Entry* e) {
+        if (auto table = owner.lock()) {
+            std::unique_lock<std::shared_mutex> lock(table->mutex);
+            auto it = table->entries.find(e->hash());
+            // A newer entry for the same code may have taken the slot
+            if (it != table->entries.end() && it->second.expired()) {
+                table->entries.erase(it);
+            }
+            table->live--;
+            table->bytes -= size;
+        }
+        delete e;
+    });
+    slot = entry;
+    table_->live++;
+    table_->bytes += size;
+    return entry;
+}
+
+std::shared_ptr<const CodeStore::Entry> CodeStore::find(const Hash256& code_hash) const {
+    std::shared_lock<std::shared_mutex> lock(table_->mutex);
+    auto it = table_->entries.find(code_hash);
+    return it != table_->entries.end() ? it->second.lock() : nullptr;
+}
+
+CodeStore::Stats CodeStore::stats() const {
+    std::shared_lock<std::shared_mutex> lock(table_->mutex);
+    return Stats{table_->live, table_->bytes, table_->interned.load(std::memory_order_relaxed),
+                 table_->shared.load(std::memory_order_relaxed)};
+}
+
+CodeRef::CodeRef(std::vector<uint8_t> code) {
+    if (!code.empty()) {
+        entry_ = CodeStore::global().intern(std::move(code));
+    }
+}
+
+const std::vector<uint8_t>& CodeRef::bytes() const {
+    static const std::vector<uint8_t> none;
+    return entry_ ? entry_->code() : none;
+}
+
+} // namespace evm
+} // namespace quids
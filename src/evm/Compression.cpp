@@ -1,77 +1,491 @@
 #include "evm/Compression.hpp"
 #include <zlib.h>
+#include <zstd.h>
+#include <zdict.h>
+#include <algorithm>
+#include <deque>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
 
 namespace evm {
 
+namespace {
+
+constexpr size_t DICTIONARY_CAPACITY = 16 * 1024;
+constexpr size_t RETAINED_DICTIONARIES = 8;
+constexpr size_t DEFAULT_TRAINING_WINDOW = 1024 * 1024;
+// Largest ZSTD frame header, enough to read the dictionary ID from
+constexpr size_t FRAME_HEADER_MAX = 18;
+
+void check_zstd(size_t code, const char* what) {
+    if (ZSTD_isError(code)) {
+        throw std::runtime_error(std::string(what) + ": " + ZSTD_getErrorName(code));
+    }
+}
+
+struct CCtxDeleter {
+    void operator()(ZSTD_CCtx* ctx) const noexcept { ZSTD_freeCCtx(ctx); }
+};
+struct DCtxDeleter {
+    void operator()(ZSTD_DCtx* ctx) const noexcept { ZSTD_freeDCtx(ctx); }
+};
+using CCtxPtr = std::unique_ptr<ZSTD_CCtx, CCtxDeleter>;
+using DCtxPtr = std::unique_ptr<ZSTD_DCtx, DCtxDeleter>;
+
+CCtxPtr make_cctx() {
+    CCtxPtr ctx(ZSTD_createCCtx());
+    if (!ctx) throw std::bad_alloc();
+    return ctx;
+}
+
+DCtxPtr make_dctx() {
+    DCtxPtr ctx(ZSTD_createDCtx());
+    if (!ctx) throw std::bad_alloc();
+    return ctx;
+}
+
+// A loaded dictionary. Shared with open streams, so replacing the current
+// one never pulls it out from under them.
+struct Dictionary {
+    uint32_t id{0};
+    std::vector<uint8_t> bytes;
+    ZSTD_CDict* cdict{nullptr};
+    ZSTD_DDict* ddict{nullptr};
+
+    Dictionary(std::vector<uint8_t> content, int level) : bytes(std::move(content)) {
+        id = ZDICT_getDictID(bytes.data(), bytes.size());
+        if (id == 0) {
+            // Frames could not say which dictionary they need
+            throw std::invalid_argument("Compression dictionary has no ID");
+        }
+        cdict = ZSTD_createCDict(bytes.data(), bytes.size(), level);
+        ddict = ZSTD_createDDict(bytes.data(), bytes.size());
+        if (!cdict || !ddict) {
+            release();
+            throw std::runtime_error("Failed to load compression dictionary");
+        }
+    }
+
+    ~Dictionary() { release(); }
+
+    Dictionary(const Dictionary&) = delete;
+    Dictionary& operator=(const Dictionary&) = delete;
+
+    void release() noexcept {
+        ZSTD_freeCDict(cdict);
+        ZSTD_freeDDict(ddict);
+        cdict = nullptr;
+        ddict = nullptr;
+    }
+};
+
+using DictionaryPtr = std::shared_ptr<const Dictionary>;
+using DictionaryMap = std::unordered_map<uint32_t, DictionaryPtr>;
+
+DictionaryPtr lookup(const DictionaryMap& known, const uint8_t* frame, size_t size) {
+    const unsigned id = ZSTD_getDictID_fromFrame(frame, size);
+    if (id == 0) return nullptr;
+    auto it = known.find(id);
+    if (it == known.end()) {
+        throw std::runtime_error("Unknown compression dictionary " + std::to_string(id));
+    }
+    return it->second;
+}
+
+void check_algorithm(Compression::Algorithm algo) {
+    if (algo != Compression::Algorithm::ZSTD && algo != Compression::Algorithm::ZLIB) {
+        throw std::invalid_argument("Unsupported compression algorithm");
+    }
+}
+
+} // namespace
+
 struct Compression::Impl {
+    Algorithm algorithm{Algorithm::ZSTD};
     uint8_t level{6};  // Default compression level
-    
-    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const {
-        if (data.empty()) return {};
-        
+
+    // Everything below is guarded by mutex
+    mutable std::mutex mutex;
+    CCtxPtr cctx{make_cctx()};
+    DCtxPtr dctx{make_dctx()};
+    DictionaryPtr dictionary;  // used to compress
+    DictionaryMap known;       // used to decompress, by ID
+    std::deque<uint32_t> known_order;  // oldest first
+
+    std::deque<std::vector<uint8_t>> samples;
+    size_t sample_bytes{0};
+    size_t training_window{DEFAULT_TRAINING_WINDOW};
+
+    size_t total_compressed{0};
+    size_t total_original{0};
+
+    std::vector<uint8_t> compress_zstd(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> out(ZSTD_compressBound(data.size()));
+        const size_t n = dictionary
+            ? ZSTD_compress_usingCDict(cctx.get(), out.data(), out.size(), data.data(), data.size(),
+                                       dictionary->cdict)
+            : ZSTD_compressCCtx(cctx.get(), out.data(), out.size(), data.data(), data.size(), level);
+        check_zstd(n, "Compression failed");
+        out.resize(n);
+        return out;
+    }
+
+    std::vector<uint8_t> decompress_zstd(const std::vector<uint8_t>& compressed) {
+        const uint8_t* src = compressed.data();
+        DictionaryPtr dict = lookup(known, src, compressed.size());
+        check_zstd(ZSTD_DCtx_reset(dctx.get(), ZSTD_reset_session_and_parameters), "Decompression failed");
+        check_zstd(ZSTD_DCtx_refDDict(dctx.get(), dict ? dict->ddict : nullptr), "Decompression failed");
+
+        // Frames from a stream do not record their size, so decode
+        // incrementally and only use the size as a first guess
+        const unsigned long long content = ZSTD_getFrameContentSize(src, compressed.size());
+        if (content == ZSTD_CONTENTSIZE_ERROR) {
+            throw std::runtime_error("Decompression failed: not a ZSTD frame");
+        }
+        size_t guess = content != ZSTD_CONTENTSIZE_UNKNOWN ? static_cast<size_t>(content) : compressed.size() * 4;
+        std::vector<uint8_t> out(std::max(guess, ZSTD_DStreamOutSize()));
+
+        ZSTD_inBuffer in{src, compressed.size(), 0};
+        size_t written = 0;
+        while (true) {
+            if (written == out.size()) {
+                out.resize(out.size() * 2);
+            }
+            ZSTD_outBuffer o{out.data() + written, out.size() - written, 0};
+            const size_t ret = ZSTD_decompressStream(dctx.get(), &o, &in);
+            check_zstd(ret, "Decompression failed");
+            written += o.pos;
+            if (ret == 0) {
+                // A frame ended; concatenated frames keep going
+                if (in.pos == in.size) break;
+                continue;
+            }
+            if (in.pos == in.size && o.pos < o.size) {
+                throw std::runtime_error("Decompression failed: truncated frame");
+            }
+        }
+        out.resize(written);
+        return out;
+    }
+
+    std::vector<uint8_t> compress_zlib(const std::vector<uint8_t>& data) const {
         uLongf compressed_size = compressBound(data.size());
         std::vector<uint8_t> compressed_data(compressed_size);
-        
+
         int result = compress2(compressed_data.data(), &compressed_size,
                               data.data(), data.size(),
-                              Z_BEST_COMPRESSION);
-        
+                              std::min<int>(level, Z_BEST_COMPRESSION));
+
         if (result != Z_OK) {
             throw std::runtime_error("Compression failed");
         }
-        
+
         compressed_data.resize(compressed_size);
         return compressed_data;
     }
-    
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& compressed_data) const {
-        if (compressed_data.empty()) return {};
-        
+
+    std::vector<uint8_t> decompress_zlib(const std::vector<uint8_t>& compressed_data) const {
         // Start with a reasonable buffer size
         uLongf decompressed_size = compressed_data.size() * 4;
         std::vector<uint8_t> decompressed_data(decompressed_size);
-        
+
         while (true) {
             int result = uncompress(decompressed_data.data(), &decompressed_size,
                                   compressed_data.data(), compressed_data.size());
-            
+
             if (result == Z_OK) {
                 decompressed_data.resize(decompressed_size);
                 return decompressed_data;
             }
-            
+
             if (result != Z_BUF_ERROR) {
                 throw std::runtime_error("Decompression failed");
             }
-            
+
             // Buffer was too small, try with a larger size
-            decompressed_size *= 2;
+            decompressed_size = decompressed_data.size() * 2;
             decompressed_data.resize(decompressed_size);
         }
     }
+
+    // Caller holds mutex
+    void install(DictionaryPtr dict) {
+        dictionary = dict;
+        if (!dict) return;
+        if (known.emplace(dict->id, dict).second) {
+            known_order.push_back(dict->id);
+        } else {
+            known[dict->id] = dict;
+        }
+        while (known_order.size() > RETAINED_DICTIONARIES) {
+            known.erase(known_order.front());
+            known_order.pop_front();
+        }
+    }
+};
+
+// Per-stream context, reused for every frame the stream writes or reads
+struct Compression::Stream::State {
+    bool compressing{true};
+    CCtxPtr cctx;
+    DCtxPtr dctx;
+    DictionaryPtr dictionary;  // keeps the compression dictionary alive
+    DictionaryMap known;       // dictionaries a decompression stream may meet
+    DictionaryPtr frame_dictionary;
+    std::vector<uint8_t> pending;  // input waiting for a complete frame header
+    bool in_frame{false};
 };
 
-Compression::Compression() : impl_(std::make_unique<Impl>()) {}
+Compression::Compression() : Compression(Algorithm::ZSTD) {}
+
+Compression::Compression(Algorithm algo) : impl_(std::make_unique<Impl>()) {
+    set_algorithm(algo);
+}
+
 Compression::~Compression() = default;
 
 Compression::Compression(Compression&&) noexcept = default;
 Compression& Compression::operator=(Compression&&) noexcept = default;
 
 std::vector<uint8_t> Compression::compress(const std::vector<uint8_t>& data) const {
-    return impl_->compress(data);
+    if (data.empty()) return {};
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto out = impl_->algorithm == Algorithm::ZSTD ? impl_->compress_zstd(data) : impl_->compress_zlib(data);
+    impl_->total_original += data.size();
+    impl_->total_compressed += out.size();
+    return out;
 }
 
 std::vector<uint8_t> Compression::decompress(const std::vector<uint8_t>& compressed_data) const {
-    return impl_->decompress(compressed_data);
+    if (compressed_data.empty()) return {};
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->algorithm == Algorithm::ZSTD ? impl_->decompress_zstd(compressed_data)
+                                               : impl_->decompress_zlib(compressed_data);
+}
+
+void Compression::set_algorithm(Algorithm algo) {
+    check_algorithm(algo);
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->algorithm = algo;
 }
 
 void Compression::set_level(uint8_t level) {
-    impl_->level = level;
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->level = std::clamp<uint8_t>(level, 1, static_cast<uint8_t>(ZSTD_maxCLevel()));
+    // A CDict is built for one level
+    if (impl_->dictionary) {
+        impl_->install(std::make_shared<Dictionary>(impl_->dictionary->bytes, impl_->level));
+    }
 }
 
 uint8_t Compression::get_level() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
     return impl_->level;
 }
 
-} // namespace evm 
\ No newline at end of file
+double Compression::get_compression_ratio() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (impl_->total_compressed == 0) return 0.0;
+    return static_cast<double>(impl_->total_original) / static_cast<double>(impl_->total_compressed);
+}
+
+size_t Compression::get_total_compressed_size() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->total_compressed;
+}
+
+size_t Compression::get_total_original_size() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->total_original;
+}
+
+void Compression::train_dictionary(const std::vector<std::vector<uint8_t>>& samples) {
+    std::vector<uint8_t> joined;
+    std::vector<size_t> sizes;
+    for (const auto& sample : samples) {
+        if (sample.empty()) continue;
+        joined.insert(joined.end(), sample.begin(), sample.end());
+        sizes.push_back(sample.size());
+    }
+    if (sizes.empty()) {
+        throw std::invalid_argument("No samples to train a dictionary on");
+    }
+
+    std::vector<uint8_t> dictionary(DICTIONARY_CAPACITY);
+    const size_t size = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), joined.data(),
+                                              sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size)) {
+        throw std::runtime_error(std::string("Dictionary training failed: ") + ZDICT_getErrorName(size));
+    }
+    dictionary.resize(size);
+    set_dictionary(dictionary);
+}
+
+void Compression::set_dictionary(const std::vector<uint8_t>& dictionary) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (dictionary.empty()) {
+        impl_->dictionary.reset();
+        return;
+    }
+    impl_->install(std::make_shared<Dictionary>(dictionary, impl_->level));
+}
+
+std::vector<uint8_t> Compression::get_dictionary() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->dictionary ? impl_->dictionary->bytes : std::vector<uint8_t>{};
+}
+
+uint32_t Compression::get_dictionary_id() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->dictionary ? impl_->dictionary->id : 0;
+}
+
+void Compression::add_training_sample(const std::vector<uint8_t>& sample) {
+    if (sample.empty()) return;
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->samples.push_back(sample);
+    impl_->sample_bytes += sample.size();
+    while (impl_->sample_bytes > impl_->training_window && impl_->samples.size() > 1) {
+        impl_->sample_bytes -= impl_->samples.front().size();
+        impl_->samples.pop_front();
+    }
+}
+
+void Compression::set_training_window(size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->training_window = max_bytes;
+}
+
+void Compression::train_dictionary() {
+    std::vector<std::vector<uint8_t>> samples;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        samples.assign(impl_->samples.begin(), impl_->samples.end());
+    }
+    train_dictionary(samples);
+}
+
+std::unique_ptr<Compression::Stream> Compression::create_compression_stream() {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (impl_->algorithm != Algorithm::ZSTD) {
+        throw std::logic_error("Streams need ZSTD");
+    }
+    auto state = std::make_unique<Stream::State>();
+    state->compressing = true;
+    state->cctx = make_cctx();
+    state->dictionary = impl_->dictionary;
+    if (state->dictionary) {
+        check_zstd(ZSTD_CCtx_refCDict(state->cctx.get(), state->dictionary->cdict), "Compression failed");
+    } else {
+        check_zstd(ZSTD_CCtx_setParameter(state->cctx.get(), ZSTD_c_compressionLevel, impl_->level),
+                   "Compression failed");
+    }
+    return std::unique_ptr<Stream>(new Stream(std::move(state)));
+}
+
+std::unique_ptr<Compression::Stream> Compression::create_decompression_stream() {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (impl_->algorithm != Algorithm::ZSTD) {
+        throw std::logic_error("Streams need ZSTD");
+    }
+    auto state = std::make_unique<Stream::State>();
+    state->compressing = false;
+    state->dctx = make_dctx();
+    state->known = impl_->known;
+    return std::unique_ptr<Stream>(new Stream(std::move(state)));
+}
+
+Compression::Stream::Stream(std::unique_ptr<State> state) : state_(std::move(state)) {}
+
+Compression::Stream::~Stream() = default;
+
+void Compression::Stream::write(const std::vector<uint8_t>& data) {
+    if (data.empty()) return;
+    if (!state_->compressing) {
+        state_->pending.insert(state_->pending.end(), data.begin(), data.end());
+        process(false);
+        return;
+    }
+    ZSTD_inBuffer in{data.data(), data.size(), 0};
+    while (in.pos < in.size) {
+        const size_t old = buffer_.size();
+        buffer_.resize(old + ZSTD_CStreamOutSize());
+        ZSTD_outBuffer out{buffer_.data() + old, ZSTD_CStreamOutSize(), 0};
+        const size_t ret = ZSTD_compressStream2(state_->cctx.get(), &out, &in, ZSTD_e_continue);
+        buffer_.resize(old + out.pos);
+        check_zstd(ret, "Compression failed");
+    }
+}
+
+void Compression::Stream::flush() {
+    if (!state_->compressing) {
+        process(true);
+        return;
+    }
+    ZSTD_inBuffer in{nullptr, 0, 0};
+    size_t remaining;
+    do {
+        const size_t old = buffer_.size();
+        buffer_.resize(old + ZSTD_CStreamOutSize());
+        ZSTD_outBuffer out{buffer_.data() + old, ZSTD_CStreamOutSize(), 0};
+        remaining = ZSTD_compressStream2(state_->cctx.get(), &out, &in, ZSTD_e_end);
+        buffer_.resize(old + out.pos);
+        check_zstd(remaining, "Compression failed");
+    } while (remaining != 0);
+}
+
+void Compression::Stream::process(bool flushing) {
+    State& s = *state_;
+    size_t consumed = 0;
+    while (consumed < s.pending.size()) {
+        const uint8_t* src = s.pending.data() + consumed;
+        const size_t size = s.pending.size() - consumed;
+        if (!s.in_frame) {
+            // Pick the dictionary once the header is all there
+            if (size < FRAME_HEADER_MAX && !flushing) break;
+            s.frame_dictionary = lookup(s.known, src, size);
+            check_zstd(ZSTD_DCtx_reset(s.dctx.get(), ZSTD_reset_session_and_parameters), "Decompression failed");
+            check_zstd(ZSTD_DCtx_refDDict(s.dctx.get(), s.frame_dictionary ? s.frame_dictionary->ddict : nullptr),
+                       "Decompression failed");
+            s.in_frame = true;
+        }
+
+        ZSTD_inBuffer in{src, size, 0};
+        size_t ret;
+        do {
+            const size_t old = buffer_.size();
+            buffer_.resize(old + ZSTD_DStreamOutSize());
+            ZSTD_outBuffer out{buffer_.data() + old, ZSTD_DStreamOutSize(), 0};
+            ret = ZSTD_decompressStream(s.dctx.get(), &out, &in);
+            buffer_.resize(old + out.pos);
+            check_zstd(ret, "Decompression failed");
+            // Keep going while output may still be buffered inside zstd
+            if (out.pos < out.size && in.pos == in.size) break;
+        } while (ret != 0);
+        consumed += in.pos;
+        if (ret == 0) {
+            s.in_frame = false;
+        } else if (in.pos == in.size) {
+            break;
+        }
+    }
+    s.pending.erase(s.pending.begin(), s.pending.begin() + static_cast<ptrdiff_t>(consumed));
+}
+
+std::vector<uint8_t> Compression::Stream::read(size_t size) {
+    const size_t n = std::min(size, available());
+    std::vector<uint8_t> out(buffer_.begin() + static_cast<ptrdiff_t>(position_),
+                             buffer_.begin() + static_cast<ptrdiff_t>(position_ + n));
+    position_ += n;
+    if (position_ == buffer_.size()) {
+        buffer_.clear();
+        position_ = 0;
+    } else if (position_ > buffer_.size() / 2) {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<ptrdiff_t>(position_));
+        position_ = 0;
+    }
+    return out;
+}
+
+} // namespace evm
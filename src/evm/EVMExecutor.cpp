@@ -1,391 +1,217 @@
 #include "evm/EVMExecutor.hpp"
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Interpreter.hpp"
+#include "evm/Opcodes.hpp"
+#include "evm/Precompiles.hpp"
+#include "evm/SlotPrefetch.hpp"
+#include "utils/PerfCounters.hpp"
+#include <limits>
 #include <stdexcept>
-#include <spdlog/spdlog.h>
-
-namespace {
-    // EVM opcodes
-    enum Opcodes {
-        STOP = 0x00,
-        ADD = 0x01,
-        MUL = 0x02,
-        SUB = 0x03,
-        DIV = 0x04,
-        SDIV = 0x05,
-        MOD = 0x06,
-        SMOD = 0x07,
-        ADDMOD = 0x08,
-        MULMOD = 0x09,
-        EXP = 0x0a,
-        SIGNEXTEND = 0x0b,
-        
-        LT = 0x10,
-        GT = 0x11,
-        SLT = 0x12,
-        SGT = 0x13,
-        EQ = 0x14,
-        ISZERO = 0x15,
-        AND = 0x16,
-        OR = 0x17,
-        XOR = 0x18,
-        NOT = 0x19,
-        BYTE = 0x1a,
-        
-        SHA3 = 0x20,
-        
-        ADDRESS = 0x30,
-        BALANCE = 0x31,
-        ORIGIN = 0x32,
-        CALLER = 0x33,
-        CALLVALUE = 0x34,
-        CALLDATALOAD = 0x35,
-        CALLDATASIZE = 0x36,
-        CALLDATACOPY = 0x37,
-        CODESIZE = 0x38,
-        CODECOPY = 0x39,
-        GASPRICE = 0x3a,
-        EXTCODESIZE = 0x3b,
-        EXTCODECOPY = 0x3c,
-        RETURNDATASIZE = 0x3d,
-        RETURNDATACOPY = 0x3e,
-        EXTCODEHASH = 0x3f,
-        
-        BLOCKHASH = 0x40,
-        COINBASE = 0x41,
-        TIMESTAMP = 0x42,
-        NUMBER = 0x43,
-        DIFFICULTY = 0x44,
-        GASLIMIT = 0x45,
-        CHAINID = 0x46,
-        BASEFEE = 0x48,
-        
-        POP = 0x50,
-        MLOAD = 0x51,
-        MSTORE = 0x52,
-        MSTORE8 = 0x53,
-        SLOAD = 0x54,
-        SSTORE = 0x55,
-        JUMP = 0x56,
-        JUMPI = 0x57,
-        PC = 0x58,
-        MSIZE = 0x59,
-        GAS = 0x5a,
-        JUMPDEST = 0x5b,
-        
-        PUSH0 = 0x5f,
-        PUSH1 = 0x60,
-        PUSH2 = 0x61,
-        PUSH3 = 0x62,
-        PUSH4 = 0x63,
-        PUSH5 = 0x64,
-        PUSH6 = 0x65,
-        PUSH7 = 0x66,
-        PUSH8 = 0x67,
-        PUSH9 = 0x68,
-        PUSH10 = 0x69,
-        PUSH11 = 0x6a,
-        PUSH12 = 0x6b,
-        PUSH13 = 0x6c,
-        PUSH14 = 0x6d,
-        PUSH15 = 0x6e,
-        PUSH16 = 0x6f,
-        PUSH17 = 0x70,
-        PUSH18 = 0x71,
-        PUSH19 = 0x72,
-        PUSH20 = 0x73,
-        PUSH21 = 0x74,
-        PUSH22 = 0x75,
-        PUSH23 = 0x76,
-        PUSH24 = 0x77,
-        PUSH25 = 0x78,
-        PUSH26 = 0x79,
-        PUSH27 = 0x7a,
-        PUSH28 = 0x7b,
-        PUSH29 = 0x7c,
-        PUSH30 = 0x7d,
-        PUSH31 = 0x7e,
-        PUSH32 = 0x7f,
-        
-        DUP1 = 0x80,
-        DUP16 = 0x8f,
-        
-        SWAP1 = 0x90,
-        SWAP16 = 0x9f,
-        
-        LOG0 = 0xa0,
-        LOG4 = 0xa4,
-        
-        CREATE = 0xf0,
-        CALL = 0xf1,
-        CALLCODE = 0xf2,
-        RETURN = 0xf3,
-        DELEGATECALL = 0xf4,
-        CREATE2 = 0xf5,
-        STATICCALL = 0xfa,
-        REVERT = 0xfd,
-        INVALID = 0xfe,
-        SELFDESTRUCT = 0xff
-    };
-
-    // Gas costs
-    constexpr uint64_t ZERO = 0;
-    constexpr uint64_t BASE = 2;
-    constexpr uint64_t VERYLOW = 3;
-    constexpr uint64_t LOW = 5;
-    constexpr uint64_t MID = 8;
-    constexpr uint64_t HIGH = 10;
-    constexpr uint64_t SHA3_GAS = 30;
-    constexpr uint64_t CREATE_GAS = 32000;
-    constexpr uint64_t SELFDESTRUCT_GAS = 5000;
-    constexpr uint64_t WARM_STORAGE_READ_COST = 100;
-    constexpr uint64_t SSTORE_SET_GAS = 20000;
-}
+#include "common/Logger.hpp"
 
 namespace quids {
 namespace evm {
 
+// Impl's balances, code and nonces as seen by nested calls. Changes are
+// journaled with their previous values so a failed call undoes only its own.
+class EVMExecutor::Host final : public CallHost {
+public:
+    explicit Host(Impl& impl) : impl_(impl) {}
+
+    std::shared_ptr<const AnalyzedCode> code_at(const ::evm::Address& address) override {
+        auto it = impl_.code.find(address);
+        return it != impl_.code.end() ? it->second.analysis() : nullptr;
+    }
+
+    bool transfer(const ::evm::Address& from, const ::evm::Address& to, const ::evm::uint256_t& value) override {
+        // Balances are 64-bit here
+        if (value > std::numeric_limits<uint64_t>::max()) {
+            return false;
+        }
+        const auto amount = static_cast<uint64_t>(value);
+        auto it = impl_.balances.find(from);
+        if (it == impl_.balances.end() || it->second < amount) {
+            return false;
+        }
+        journal_.push_back({Change::Balance, from, it->second, {}});
+        it->second -= amount;
+        uint64_t& receiver = impl_.balances[to];
+        journal_.push_back({Change::Balance, to, receiver, {}});
+        receiver += amount;
+        return true;
+    }
+
+    uint64_t increment_nonce(const ::evm::Address& address) override {
+        uint64_t& nonce = impl_.nonces[address];
+        journal_.push_back({Change::Nonce, address, nonce, {}});
+        return nonce++;
+    }
+
+    void set_code(const ::evm::Address& address, std::vector<uint8_t> code) override {
+        CodeRef& slot = impl_.code[address];
+        journal_.push_back({Change::Code, address, 0, std::move(slot)});
+        slot = CodeRef(std::move(code));
+    }
+
+    std::optional<PrecompileResult> run_precompile(const ::evm::Address& address, const uint8_t* input,
+                                                   size_t size, uint64_t gas) override {
+        return precompiles_.run(address, input, size, gas);
+    }
+
+    Checkpoint checkpoint() override { return journal_.size(); }
+
+    void revert(Checkpoint checkpoint) override {
+        while (journal_.size() > checkpoint) {
+            Change& change = journal_.back();
+            switch (change.kind) {
+                case Change::Balance: impl_.balances[change.address] = change.value; break;
+                case Change::Nonce: impl_.nonces[change.address] = change.value; break;
+                case Change::Code: impl_.code[change.address] = std::move(change.code); break;
+            }
+            journal_.pop_back();
+        }
+    }
+
+    void clear() { journal_.clear(); }
+
+    // A finished call can no longer be undone
+    void commit() { journal_.clear(); }
+
+private:
+    struct Change {
+        enum Kind { Balance, Nonce, Code } kind;
+        ::evm::Address address;
+        uint64_t value;  // previous balance or nonce
+        CodeRef code;  // previous code
+    };
+
+    Impl& impl_;
+    Precompiles precompiles_;
+    std::vector<Change> journal_;
+};
+
 EVMExecutor::EVMExecutor(const EVMConfig& config)
-    : memory_(std::make_shared<::evm::Memory>())
-    , stack_(std::make_shared<::evm::Stack>())
+    : frames_(std::make_unique<CallArena>())
     , storage_(std::make_shared<::evm::Storage>())
     , config_(config)
-    , impl_(std::make_unique<Impl>()) {
+    , impl_(std::make_unique<Impl>())
+    , host_(std::make_unique<Host>(*impl_)) {
 }
 
 EVMExecutor::~EVMExecutor() = default;
 
+void EVMExecutor::reset() {
+    storage_->clear();
+    impl_->balances.clear();
+    impl_->code.clear();
+    impl_->nonces.clear();
+    impl_->storage.clear();
+    host_->clear();
+    gas_used_ = 0;
+    gas_limit_ = 0;
+}
+
 EVMExecutor::ExecutionResult EVMExecutor::execute_contract(
     const ::evm::Address& contract_address,
     const std::vector<uint8_t>& code,
-    const std::vector<uint8_t>& /*input_data*/,
+    const std::vector<uint8_t>& input_data,
     uint64_t gas_limit
 ) {
-    gas_used_ = 0;
     gas_limit_ = gas_limit;
 
-    ExecutionResult result{};
-    try {
-        size_t pc = 0;
-        while (pc < code.size()) {
-            uint8_t opcode = code[pc];
-            
-            switch (opcode) {
-                case STOP:
-                    require_gas(ZERO);
-                    return ExecutionResult{true, {}, gas_used_, ""};
-
-                case ADD:
-                case SUB:
-                case OR:
-                case XOR:
-                case NOT:
-                case BYTE:
-                    require_gas(VERYLOW);
-                    // ... arithmetic operations ...
-                    break;
-
-                case MUL:
-                case DIV:
-                case SDIV:
-                case MOD:
-                case SMOD:
-                    require_gas(LOW);
-                    // ... arithmetic operations ...
-                    break;
-
-                case ADDMOD:
-                case MULMOD:
-                    require_gas(MID);
-                    // ... arithmetic operations ...
-                    break;
-
-                case SHA3:
-                    require_gas(SHA3_GAS);
-                    // ... SHA3 operation ...
-                    break;
-
-                case ADDRESS:
-                case ORIGIN:
-                case CALLER:
-                case CALLVALUE:
-                case CALLDATASIZE:
-                case CODESIZE:
-                case GASPRICE:
-                case COINBASE:
-                case TIMESTAMP:
-                case NUMBER:
-                case GASLIMIT:
-                case CHAINID:
-                case BASEFEE:
-                    require_gas(BASE);
-                    // ... context operations ...
-                    break;
-
-                case BALANCE:
-                case EXTCODESIZE:
-                case EXTCODEHASH:
-                    require_gas(WARM_STORAGE_READ_COST);
-                    // ... external state operations ...
-                    break;
-
-                case CALLDATALOAD:
-                case MLOAD:
-                case MSTORE:
-                case MSTORE8:
-                    require_gas(VERYLOW);
-                    // ... memory operations ...
-                    break;
-
-                case SLOAD:
-                    require_gas(WARM_STORAGE_READ_COST);
-                    {
-                        auto key = stack_->pop();
-                        stack_->push(storage_->load(contract_address, key));
-                    }
-                    break;
-
-                case SSTORE:
-                    require_gas(SSTORE_SET_GAS);
-                    {
-                        auto value = stack_->pop();
-                        auto key = stack_->pop();
-                        storage_->store(contract_address, key, value);
-                    }
-                    break;
-
-                case JUMP:
-                    require_gas(MID);
-                    // ... jump operation ...
-                    break;
-
-                case JUMPI:
-                    require_gas(HIGH);
-                    // ... conditional jump operation ...
-                    break;
-
-                case JUMPDEST:
-                    require_gas(1);  // Special case: JUMPDEST costs exactly 1
-                    break;
-
-                case CREATE:
-                    require_gas(CREATE_GAS);
-                    // ... create operation ...
-                    break;
-
-                case CALL:
-                case CALLCODE:
-                    require_gas(WARM_STORAGE_READ_COST);
-                    // ... call operations ...
-                    break;
-
-                case RETURN:
-                case REVERT:
-                    require_gas(ZERO);
-                    // ... return/revert operations ...
-                    break;
-
-                case SELFDESTRUCT:
-                    require_gas(SELFDESTRUCT_GAS);
-                    // ... selfdestruct operation ...
-                    break;
-
-                case PUSH0:
-                    require_gas(BASE);
-                    stack_->push(::evm::uint256_t(0));
-                    break;
-
-                case PUSH1:
-                case PUSH2:
-                case PUSH3:
-                case PUSH4:
-                case PUSH5:
-                case PUSH6:
-                case PUSH7:
-                case PUSH8:
-                case PUSH9:
-                case PUSH10:
-                case PUSH11:
-                case PUSH12:
-                case PUSH13:
-                case PUSH14:
-                case PUSH15:
-                case PUSH16:
-                case PUSH17:
-                case PUSH18:
-                case PUSH19:
-                case PUSH20:
-                case PUSH21:
-                case PUSH22:
-                case PUSH23:
-                case PUSH24:
-                case PUSH25:
-                case PUSH26:
-                case PUSH27:
-                case PUSH28:
-                case PUSH29:
-                case PUSH30:
-                case PUSH31:
-                case PUSH32:
-                    {
-                        require_gas(VERYLOW);
-                        uint8_t push_bytes = (opcode - PUSH1) + 1;
-                        if (pc + push_bytes >= code.size()) {
-                            throw std::runtime_error("Push exceeds code size");
-                        }
-                        ::evm::uint256_t value(0);
-                        for (uint8_t i = 0; i < push_bytes; i++) {
-                            value = (value << 8) | ::evm::uint256_t(code[pc + 1 + i]);
-                        }
-                        stack_->push(value);
-                        pc += push_bytes;
-                    }
-                    break;
-
-                default:
-                    throw std::runtime_error("Unknown or unimplemented opcode");
-            }
+    // Analysed once per distinct code and shared by every executor
+    const auto analyzed = CodeCache::global().get(code);
+
+    ExecutionContext ctx;
+    ctx.address = contract_address;
+    ctx.input = input_data.data();
+    ctx.input_size = input_data.size();
+    ctx.storage = storage_.get();
+    ctx.host = host_.get();
+    if (storage_->has_backend()) {
+        // Cold slots it is likely to touch are fetched together, not one SLOAD at a time
+        storage_->prefetch(SlotPredictor::global().predict(*analyzed, contract_address, input_data));
+    }
+    // Each call is its own transaction: fresh warm set, journal and access log
+    storage_->begin_transaction();
+    storage_->warm_account(contract_address);
+    // Native contracts are warm from the start, as precompiles are under EIP-2929
+    for (uint16_t id = Precompiles::FIRST; id <= Precompiles::LAST; ++id) {
+        storage_->warm_account(Precompiles::address(id));
+    }
 
-            pc++;
-        }
+    InterpreterResult run = [&] {
+        utils::PerfScope perf(utils::PerfStage::EvmExecute);
+        return interpret(*analyzed, ctx, gas_limit, *frames_);
+    }();
+    host_->commit();
+    gas_used_ = gas_limit - run.gas_left;
 
-        result.success = true;
-        result.gas_used = gas_used_;
-        result.return_data = {};
-        result.error_message = "";
-    } catch (const std::exception& e) {
-        result.success = false;
-        result.gas_used = gas_used_;
-        result.return_data = {};
-        result.error_message = e.what();
+    ExecutionResult result{};
+    result.success = run.status == InterpreterStatus::Success;
+    result.gas_used = gas_used_;
+    result.return_data = std::move(run.output);
+    result.storage_access = storage_->access_set();
+    if (storage_->has_backend()) {
+        SlotPredictor::global().record(contract_address, result.storage_access);
+    }
+    if (!result.success) {
+        result.error_message = to_string(run.status);
     }
     return result;
 }
 
-void EVMExecutor::require_gas(uint64_t gas) {
-    if (gas_used_ + gas > gas_limit_) {
-        throw std::runtime_error("Out of gas");
+void EVMExecutor::set_storage_backend(std::shared_ptr<::evm::SlotBackend> backend) {
+    storage_->set_backend(std::move(backend));
+}
+
+size_t EVMExecutor::prefetch_contract(
+    const ::evm::Address& contract_address,
+    const std::vector<uint8_t>& code,
+    const std::vector<uint8_t>& input_data
+) {
+    if (!storage_->has_backend()) {
+        return 0;
     }
-    gas_used_ += gas;
+    const auto analyzed = CodeCache::global().get(code);
+    return storage_->prefetch(SlotPredictor::global().predict(*analyzed, contract_address, input_data));
+}
+
+void EVMExecutor::begin_storage_witness() {
+    storage_->begin_witness();
+}
+
+::evm::SlotWitness EVMExecutor::take_storage_witness() {
+    return storage_->take_witness();
+}
+
+void EVMExecutor::load_storage_witness(const ::evm::SlotWitness& witness) {
+    storage_->load_witness(witness);
 }
 
 bool EVMExecutor::execute(const blockchain::Transaction& tx) {
     try {
         // Basic transaction execution
-        auto& sender_balance = impl_->balances[tx.from];
-        if (sender_balance < tx.value) {
+        const auto from = ::evm::Address::from_string(tx.getSender());
+        const auto to = ::evm::Address::from_string(tx.getRecipient());
+        auto& sender_balance = impl_->balances[from];
+        if (sender_balance < tx.getAmount()) {
+            QUIDS_LOG_DEFERRED(DEBUG, "Rejected transfer of {} against a balance of {}", tx.getAmount(), sender_balance);
             return false;
         }
 
-        sender_balance -= tx.value;
-        impl_->balances[tx.to] += tx.value;
+        sender_balance -= tx.getAmount();
+        impl_->balances[to] += tx.getAmount();
 
         // Execute contract code if present
-        if (!tx.data.empty() && !impl_->code[tx.to].empty()) {
+        const auto code = impl_->code.find(to);
+        if (!tx.getData().empty() && code != impl_->code.end() && !code->second.empty()) {
             // TODO: Implement actual EVM execution
         }
 
         return true;
     } catch (const std::exception& e) {
-        spdlog::error("Transaction execution failed: {}", e.what());
+        QUIDS_LOG_ERROR("Transaction execution failed: {}", e.what());
         return false;
     }
 }
@@ -406,26 +232,34 @@ bool EVMExecutor::deploy(const std::vector<uint8_t>& code) {
 
         return true;
     } catch (const std::exception& e) {
-        spdlog::error("Contract deployment failed: {}", e.what());
+        QUIDS_LOG_ERROR("Contract deployment failed: {}", e.what());
         return false;
     }
 }
 
+void EVMExecutor::set_code(const ::evm::Address& address, std::vector<uint8_t> code) {
+    impl_->code[address] = CodeRef(std::move(code));
+}
+
+void EVMExecutor::set_balance(const ::evm::Address& address, uint64_t balance) {
+    impl_->balances[address] = balance;
+}
+
 uint64_t EVMExecutor::getBalance(const std::string& address) const {
-    auto it = impl_->balances.find(address);
+    auto it = impl_->balances.find(::evm::Address::from_string(address));
     return it != impl_->balances.end() ? it->second : 0;
 }
 
 std::vector<uint8_t> EVMExecutor::getCode(const std::string& address) const {
-    auto it = impl_->code.find(address);
-    return it != impl_->code.end() ? it->second : std::vector<uint8_t>{};
+    auto it = impl_->code.find(::evm::Address::from_string(address));
+    return it != impl_->code.end() ? it->second.bytes() : std::vector<uint8_t>{};
 }
 
 std::vector<uint8_t> EVMExecutor::getStorage(
     const std::string& address, 
     ::evm::uint256_t key
 ) const {
-    auto account_it = impl_->storage.find(address);
+    auto account_it = impl_->storage.find(::evm::Address::from_string(address));
     if (account_it == impl_->storage.end()) {
         return {};
     }
@@ -1,58 +1,445 @@
 #include "evm/ExternalLink.hpp"
 #include "evm/ProofVerification.hpp"
+#include "evm/Keccak.hpp"
+#include "blockchain/SignatureCache.hpp"
 
 // OpenSSL headers
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/crypto.h>
 #include <openssl/evp.h>
-#include <openssl/core.h>
-#include <openssl/core_names.h>
 #include <openssl/provider.h>
-#include <openssl/params.h>
-#include <openssl/bio.h>
-#include <openssl/x509.h>
-#include <openssl/x509v3.h>
-#include <openssl/pem.h>
 
 // Other includes
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <mutex>
+#include <shared_mutex>
+#include <map>
 #include <unordered_map>
-#include <queue>
 #include <stdexcept>
 #include <algorithm>
+#include <thread>
 
 namespace evm {
 
+namespace {
+
+constexpr size_t CACHE_SHARDS = 16;
+constexpr size_t CACHE_CAPACITY_PER_SHARD = 256;
+constexpr size_t FLIGHT_SHARDS = 16;
+constexpr size_t LIMITER_SHARDS = 16;
+constexpr size_t IDLE_CONNECTIONS_PER_ENDPOINT = 8;
+constexpr size_t VERIFIED_PAYLOADS = 1 << 14;
+
+ExternalLink::DataResponse failure(std::string message) {
+    return ExternalLink::DataResponse{
+        .success = false,
+        .data = {},
+        .proof = {},
+        .error_message = std::move(message),
+        .signature = {}
+    };
+}
+
+size_t write_response(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    static_cast<std::string*>(userdata)->append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+// Applied to the context curl creates for each connection
+CURLcode configure_ssl_ctx(CURL*, void* ssl_ctx, void*) {
+    auto* ctx = static_cast<SSL_CTX*>(ssl_ctx);
+    SSL_CTX_set_verify_depth(ctx, 4);
+    SSL_CTX_set_min_proto_version(ctx, TLS1_3_VERSION);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_COMPRESSION);
+    SSL_CTX_set_mode(ctx, SSL_MODE_AUTO_RETRY);
+    return CURLE_OK;
+}
+
+// scheme://host[:port], the part of a URL a connection can be reused for
+std::string authority_of(const std::string& url) {
+    const size_t scheme_end = url.find("://");
+    const size_t host_begin = scheme_end == std::string::npos ? 0 : scheme_end + 3;
+    const size_t host_end = url.find_first_of("/?#", host_begin);
+    return url.substr(0, host_end);
+}
+
+int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
 class ExternalLink::Impl {
 public:
     struct CacheEntry {
-        ExternalData data;
-        std::chrono::system_clock::time_point expiry;
+        DataResponse response;
+        std::chrono::steady_clock::time_point expiry;
     };
-    
-    struct RateLimit {
-        uint32_t requests_per_second;
-        uint32_t daily_quota;
-        uint32_t requests_today;
-        std::queue<std::chrono::system_clock::time_point> request_times;
+
+    struct CacheShard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, CacheEntry> entries;
     };
-    
-    std::unordered_map<std::string, std::string> trusted_sources_;
-    std::unordered_map<std::string, RateLimit> rate_limits_;
-    std::unordered_map<std::string, CacheEntry> cache_;
-    bool caching_enabled_{false};
-    std::chrono::seconds cache_duration_{3600};  // Default 1 hour
+
+    // Followers wait on the leader's future; callbacks of followers that
+    // did not want to block are run by the leader when it lands
+    struct Flight {
+        std::promise<DataResponse> promise;
+        std::shared_future<DataResponse> result;
+        std::vector<DataCallback> callbacks;
+    };
+
+    struct Joined {
+        std::shared_future<DataResponse> result;
+        bool leader;
+    };
+
+    struct FlightShard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Flight> flights;
+    };
+
+    // Generic cell rate algorithm, the token bucket as one atomic: tat is
+    // when the bucket would be full again. Quota state packs the day
+    // number over the count used on it.
+    struct Limiter {
+        std::atomic<int64_t> interval_ns{0};  // 0 when not rate limited
+        std::atomic<int64_t> burst_ns{0};
+        std::atomic<int64_t> tat_ns{0};
+        std::atomic<uint32_t> daily_quota{0};  // 0 when unlimited
+        std::atomic<uint64_t> quota_state{0};
+
+        bool acquire_rate(int64_t now) {
+            const int64_t interval = interval_ns.load(std::memory_order_relaxed);
+            if (interval == 0) {
+                return true;
+            }
+            const int64_t burst = burst_ns.load(std::memory_order_relaxed);
+            int64_t tat = tat_ns.load(std::memory_order_relaxed);
+            while (true) {
+                const int64_t start = std::max(tat, now);
+                if (start - now > burst) {
+                    return false;
+                }
+                if (tat_ns.compare_exchange_weak(tat, start + interval, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+        }
+
+        bool acquire_quota(uint64_t day) {
+            const uint32_t quota = daily_quota.load(std::memory_order_relaxed);
+            if (quota == 0) {
+                return true;
+            }
+            uint64_t state = quota_state.load(std::memory_order_relaxed);
+            while (true) {
+                const uint64_t used = (state >> 32) == day ? (state & 0xffffffffu) : 0;
+                if (used >= quota) {
+                    return false;
+                }
+                if (quota_state.compare_exchange_weak(state, (day << 32) | (used + 1), std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+        }
+    };
+
+    struct LimiterShard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Limiter>> limiters;
+    };
+
+    // Idle curl handles per endpoint. A handle keeps its connection open
+    // between transfers, and the share handle lets new connections resume
+    // TLS sessions and skip DNS lookups.
+    class ConnectionPool {
+    public:
+        ConnectionPool() {
+            share_ = curl_share_init();
+            if (share_) {
+                curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &ConnectionPool::lock);
+                curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &ConnectionPool::unlock);
+                curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+                curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+                curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+            }
+        }
+
+        ~ConnectionPool() {
+            for (auto& [endpoint, handles] : idle_) {
+                for (CURL* handle : handles) {
+                    curl_easy_cleanup(handle);
+                }
+            }
+            if (share_) {
+                curl_share_cleanup(share_);
+            }
+        }
+
+        // Returns to the pool on destruction unless dropped
+        class Lease {
+        public:
+            Lease(ConnectionPool& pool, std::string endpoint, CURL* handle)
+                : pool_(pool), endpoint_(std::move(endpoint)), handle_(handle) {}
+            ~Lease() { pool_.release(endpoint_, handle_); }
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+
+            CURL* get() const { return handle_; }
+            // The connection is broken; close it rather than reuse it
+            void drop() {
+                curl_easy_cleanup(handle_);
+                handle_ = nullptr;
+            }
+
+        private:
+            ConnectionPool& pool_;
+            std::string endpoint_;
+            CURL* handle_;
+        };
+
+        std::unique_ptr<Lease> acquire(const std::string& endpoint) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto& handles = idle_[endpoint];
+                if (!handles.empty()) {
+                    CURL* handle = handles.back();
+                    handles.pop_back();
+                    return std::make_unique<Lease>(*this, endpoint, handle);
+                }
+            }
+            CURL* handle = curl_easy_init();
+            if (!handle) {
+                throw std::runtime_error("Failed to initialize CURL");
+            }
+            curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 1L);
+            curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 2L);
+            curl_easy_setopt(handle, CURLOPT_SSLVERSION, static_cast<long>(CURL_SSLVERSION_TLSv1_3));
+            curl_easy_setopt(handle, CURLOPT_SSL_CTX_FUNCTION, &configure_ssl_ctx);
+            curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &write_response);
+            if (share_) {
+                curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+            }
+            return std::make_unique<Lease>(*this, endpoint, handle);
+        }
+
+    private:
+        void release(const std::string& endpoint, CURL* handle) {
+            if (!handle) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto& handles = idle_[endpoint];
+                if (handles.size() < IDLE_CONNECTIONS_PER_ENDPOINT) {
+                    handles.push_back(handle);
+                    return;
+                }
+            }
+            curl_easy_cleanup(handle);
+        }
+
+        static void lock(CURL*, curl_lock_data data, curl_lock_access, void* self) {
+            static_cast<ConnectionPool*>(self)->share_locks_[data % CURL_LOCK_DATA_LAST].lock();
+        }
+        static void unlock(CURL*, curl_lock_data data, void* self) {
+            static_cast<ConnectionPool*>(self)->share_locks_[data % CURL_LOCK_DATA_LAST].unlock();
+        }
+
+        CURLSH* share_{nullptr};
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> share_locks_;
+        std::mutex mutex_;
+        std::unordered_map<std::string, std::vector<CURL*>> idle_;
+    };
+
+    // Everything that makes two requests the same request
+    static std::string request_key(const DataRequest& request) {
+        std::string key;
+        key.reserve(request.method.size() + request.endpoint.size() + request.address.bytes.size() +
+                    request.key.size() + 4);
+        key += request.method;
+        key += '\n';
+        key += request.endpoint;
+        key += '\n';
+        key.append(reinterpret_cast<const char*>(request.address.bytes.data()), request.address.bytes.size());
+        key.append(reinterpret_cast<const char*>(request.key.data()), request.key.size());
+        key += request.require_proof ? '1' : '0';
+        return key;
+    }
+
+    static size_t shard_of(const std::string& key, size_t shards) {
+        return std::hash<std::string>{}(key) % shards;
+    }
+
+    // The caller leads a new flight and must land() it; otherwise it
+    // waits on result, or hands over callback to be run on landing
+    Joined join(const std::string& key, DataCallback* callback = nullptr) {
+        auto& shard = flights_[shard_of(key, FLIGHT_SHARDS)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.flights.find(key);
+        if (it != shard.flights.end()) {
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+            if (callback) {
+                it->second.callbacks.push_back(std::move(*callback));
+            }
+            return {it->second.result, false};
+        }
+        Flight flight;
+        flight.result = flight.promise.get_future().share();
+        auto result = flight.result;
+        shard.flights.emplace(key, std::move(flight));
+        return {std::move(result), true};
+    }
+
+    void land(const std::string& key, const DataResponse& response) {
+        auto& shard = flights_[shard_of(key, FLIGHT_SHARDS)];
+        Flight flight;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.flights.find(key);
+            flight = std::move(it->second);
+            shard.flights.erase(it);
+        }
+        flight.promise.set_value(response);
+        for (auto& callback : flight.callbacks) {
+            callback(response);
+        }
+    }
+
+    Limiter* find_limiter(const std::string& source) const {
+        const auto& shard = limiters_[shard_of(source, LIMITER_SHARDS)];
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.limiters.find(source);
+        return it == shard.limiters.end() ? nullptr : it->second.get();
+    }
+
+    // Limiters are never removed, so the pointer outlives the lock
+    Limiter& limiter(const std::string& source) {
+        if (Limiter* existing = find_limiter(source)) {
+            return *existing;
+        }
+        auto& shard = limiters_[shard_of(source, LIMITER_SHARDS)];
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto& slot = shard.limiters[source];
+        if (!slot) {
+            slot = std::make_unique<Limiter>();
+        }
+        return *slot;
+    }
+
+    DataResponse http_fetch(const DataRequest& request, uint32_t timeout_ms) {
+        auto lease = connections_.acquire(authority_of(request.endpoint));
+        CURL* handle = lease->get();
+        std::string response_data;
+        curl_easy_setopt(handle, CURLOPT_URL, request.endpoint.c_str());
+        curl_easy_setopt(handle, CURLOPT_NOBODY, 0L);
+        curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout_ms));
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response_data);
+
+        if (const CURLcode res = perform(*lease); res != CURLE_OK) {
+            return failure(curl_easy_strerror(res));
+        }
+        long status = 0;
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+        if (status >= 400) {
+            return failure("HTTP " + std::to_string(status));
+        }
+        return DataResponse{
+            .success = true,
+            .data = std::vector<uint8_t>(response_data.begin(), response_data.end()),
+            .proof = proof_buffer_,
+            .error_message = "",
+            .signature = {}
+        };
+    }
+
+    // Opens a connection to url with a HEAD request and pools it
+    std::optional<std::string> warm(const std::string& url, uint32_t timeout_ms) {
+        auto lease = connections_.acquire(authority_of(url));
+        CURL* handle = lease->get();
+        curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle, CURLOPT_CUSTOMREQUEST, nullptr);
+        curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout_ms));
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, nullptr);
+        if (const CURLcode res = perform(*lease); res != CURLE_OK) {
+            return std::string(curl_easy_strerror(res));
+        }
+        return std::nullopt;
+    }
+
+    // A failed handle is closed rather than pooled
+    CURLcode perform(ConnectionPool::Lease& lease) {
+        const CURLcode res = curl_easy_perform(lease.get());
+        long connects = 0;
+        curl_easy_getinfo(lease.get(), CURLINFO_NUM_CONNECTS, &connects);
+        if (connects > 0) {
+            connections_opened_.fetch_add(static_cast<uint64_t>(connects), std::memory_order_relaxed);
+        } else {
+            connections_reused_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (res != CURLE_OK) {
+            lease.drop();
+        }
+        return res;
+    }
+
+    struct TrustedSource {
+        std::string public_key;  // empty when trusted by name
+        quids::crypto::SignatureScheme scheme;
+    };
+
+    // Accepted (source, payload) pairs; keyed on both so the same payload
+    // signed by another source is checked on its own
+    static quids::blockchain::Hash verdict_key(const std::string& source, const std::array<uint8_t, 32>& payload) {
+        std::vector<uint8_t> buffer(source.begin(), source.end());
+        buffer.insert(buffer.end(), payload.begin(), payload.end());
+        return quids::evm::keccak256(buffer);
+    }
+
+    std::shared_ptr<const TrustedSource> trusted_source(const std::string& source) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = trusted_sources_.find(source);
+        return it == trusted_sources_.end() ? nullptr : it->second;
+    }
+
+    // Entries are replaced rather than changed, so a verification in
+    // progress keeps the key it looked up
+    std::unordered_map<std::string, std::shared_ptr<const TrustedSource>> trusted_sources_;
+    quids::blockchain::SignatureCache verified_{VERIFIED_PAYLOADS};
+    std::array<CacheShard, CACHE_SHARDS> cache_;
+    std::array<FlightShard, FLIGHT_SHARDS> flights_;
+    std::array<LimiterShard, LIMITER_SHARDS> limiters_;
+    ConnectionPool connections_;
+
+    std::atomic<bool> caching_enabled_{false};
+    std::atomic<int64_t> cache_duration_s_{3600};  // Default 1 hour
+    std::atomic<int64_t> negative_cache_duration_s_{5};
     std::vector<uint8_t> proof_buffer_;
-    
-    mutable std::mutex mutex_;
-    CURL* curl_{nullptr};
-    SSL_CTX* ssl_ctx_{nullptr};
+    Transport transport_;  // empty for HTTPS; set before requests are made
+
+    std::atomic<uint64_t> upstream_fetches_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> cache_hits_{0};
+    std::atomic<uint64_t> negative_hits_{0};
+    std::atomic<uint64_t> rate_limited_{0};
+    std::atomic<uint64_t> connections_opened_{0};
+    std::atomic<uint64_t> connections_reused_{0};
+    std::atomic<uint64_t> signatures_checked_{0};
+    std::atomic<uint64_t> verifications_remembered_{0};
+
+    mutable std::mutex mutex_;  // trusted sources
     OSSL_PROVIDER* default_provider_{nullptr};
-    OSSL_PROVIDER* legacy_provider_{nullptr};
 };
 
 ExternalLink::ExternalLink(
@@ -61,268 +448,374 @@ ExternalLink::ExternalLink(
     std::shared_ptr<ProofVerifier> proof_verifier
 ) : config_(config),
     state_manager_(state_manager),
-    proof_verifier_(proof_verifier),
-    impl_(std::make_unique<Impl>()) {
-    
-    // Initialize CURL
+    proof_verifier_(proof_verifier) {
+
+    // Initialize CURL before the pool creates its share handle
     curl_global_init(CURL_GLOBAL_DEFAULT);
-    impl_->curl_ = curl_easy_init();
-    if (!impl_->curl_) {
-        throw std::runtime_error("Failed to initialize CURL");
-    }
-    
+    impl_ = std::make_unique<Impl>();
+
     // Initialize OpenSSL providers
     impl_->default_provider_ = OSSL_PROVIDER_load(nullptr, "default");
-    impl_->legacy_provider_ = OSSL_PROVIDER_load(nullptr, "legacy");
-    if (!impl_->default_provider_ || !impl_->legacy_provider_) {
+    if (!impl_->default_provider_) {
         throw std::runtime_error("Failed to load OpenSSL providers");
     }
-    
-    // Create SSL context with TLS 1.3
-    impl_->ssl_ctx_ = SSL_CTX_new(TLS_client_method());
-    if (!impl_->ssl_ctx_) {
-        throw std::runtime_error("Failed to create SSL context");
-    }
-    
-    // Set secure defaults
-    SSL_CTX_set_verify(impl_->ssl_ctx_, SSL_VERIFY_PEER, nullptr);
-    SSL_CTX_set_verify_depth(impl_->ssl_ctx_, 4);
-    SSL_CTX_set_min_proto_version(impl_->ssl_ctx_, TLS1_3_VERSION);
-    
-    // Set additional security options
-    SSL_CTX_set_options(impl_->ssl_ctx_, SSL_OP_NO_COMPRESSION);
-    SSL_CTX_set_mode(impl_->ssl_ctx_, SSL_MODE_AUTO_RETRY);
 }
 
 ExternalLink::~ExternalLink() {
-    if (impl_->ssl_ctx_) {
-        SSL_CTX_free(impl_->ssl_ctx_);
-    }
-    if (impl_->curl_) {
-        curl_easy_cleanup(impl_->curl_);
-    }
-    if (impl_->legacy_provider_) {
-        OSSL_PROVIDER_unload(impl_->legacy_provider_);
-    }
-    if (impl_->default_provider_) {
-        OSSL_PROVIDER_unload(impl_->default_provider_);
+    OSSL_PROVIDER* provider = impl_->default_provider_;
+    impl_.reset();
+    if (provider) {
+        OSSL_PROVIDER_unload(provider);
     }
     curl_global_cleanup();
 }
 
 ExternalLink::DataResponse ExternalLink::fetch_data(const DataRequest& request) {
     if (!validate_request(request)) {
-        return DataResponse{
-            .success = false,
-            .data = {},
-            .proof = {},
-            .error_message = "Invalid request"
-        };
+        return failure("Invalid request");
     }
-    
-    // Check cache first
-    auto cached_data = fetch_from_cache(request);
-    if (!cached_data.data.empty()) {
-        return DataResponse{
-            .success = true,
-            .data = cached_data.data,
-            .proof = cached_data.proof,
-            .error_message = ""
-        };
+
+    const std::string key = Impl::request_key(request);
+    if (auto cached = fetch_from_cache(key)) {
+        return *cached;
     }
-    
-    // Check rate limits
-    if (!check_rate_limit(request.endpoint) || !check_quota(request.endpoint)) {
-        return DataResponse{
-            .success = false,
-            .data = {},
-            .proof = {},
-            .error_message = "Rate limit exceeded"
-        };
+    auto joined = impl_->join(key);
+    if (!joined.leader) {
+        return joined.result.get();
     }
-    
-    // Fetch data from external source
-    ExternalData external_data;
-    try {
-        // Set up request
-        curl_easy_setopt(impl_->curl_, CURLOPT_URL, request.endpoint.c_str());
-        curl_easy_setopt(impl_->curl_, CURLOPT_SSL_CTX_FUNCTION, impl_->ssl_ctx_);
-        
-        // Set timeout
-        curl_easy_setopt(impl_->curl_, CURLOPT_TIMEOUT_MS, config_.max_response_time_ms);
-        
-        // Prepare response buffer
-        std::string response_data;
-        curl_easy_setopt(impl_->curl_, CURLOPT_WRITEFUNCTION, 
-            [](char* ptr, size_t size, size_t nmemb, void* userdata) {
-                auto& response = *static_cast<std::string*>(userdata);
-                response.append(ptr, size * nmemb);
-                return size * nmemb;
-            });
-        curl_easy_setopt(impl_->curl_, CURLOPT_WRITEDATA, &response_data);
-        
-        // Perform request
-        CURLcode res = curl_easy_perform(impl_->curl_);
-        if (res != CURLE_OK) {
-            return DataResponse{
-                .success = false,
-                .data = {},
-                .proof = {},
-                .error_message = curl_easy_strerror(res)
-            };
-        }
+    return lead_flight(request, key);
+}
 
-        // Parse response
-        external_data.data = std::vector<uint8_t>(response_data.begin(), response_data.end());
-        external_data.proof = impl_->proof_buffer_;
-        external_data.timestamp = std::chrono::system_clock::now().time_since_epoch().count();
-        external_data.source = request.endpoint;
+ExternalLink::DataResponse ExternalLink::lead_flight(const DataRequest& request, const std::string& key) {
+    DataResponse response;
+    // A flight that landed between our cache miss and join left its answer
+    if (auto cached = fetch_from_cache(key)) {
+        response = *cached;
+    } else {
+        try {
+            response = fetch_upstream(request, key);
+        } catch (const std::exception& e) {
+            response = failure(e.what());
+        }
+    }
+    impl_->land(key, response);
+    return response;
+}
 
-    } catch (const std::exception& e) {
-        return DataResponse{
-            .success = false,
-            .data = {},
-            .proof = {},
-            .error_message = e.what()
-        };
+ExternalLink::DataResponse ExternalLink::fetch_upstream(const DataRequest& request, const std::string& key) {
+    if (!check_rate_limit(request.endpoint) || !check_quota(request.endpoint)) {
+        impl_->rate_limited_.fetch_add(1, std::memory_order_relaxed);
+        return failure("Rate limit exceeded");
     }
-    
+
+    impl_->upstream_fetches_.fetch_add(1, std::memory_order_relaxed);
+    DataResponse response = impl_->transport_ ? impl_->transport_(request)
+                                              : impl_->http_fetch(request, config_.max_response_time_ms);
+
     // Verify data if required
-    if (config_.require_proof && !verify_external_data(external_data)) {
-        handle_verification_failure(DataResponse{
-            .success = false,
-            .data = external_data.data,
-            .proof = external_data.proof,
-            .error_message = "Data verification failed"
-        });
-        return DataResponse{
-            .success = false,
-            .data = {},
-            .proof = {},
-            .error_message = "Data verification failed"
+    if (response.success && config_.require_proof) {
+        ExternalData external_data{
+            response.data,
+            response.proof,
+            static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()),
+            request.endpoint,
+            response.signature
         };
+        if (!verify_external_data(external_data)) {
+            handle_verification_failure(DataResponse{
+                .success = false,
+                .data = external_data.data,
+                .proof = external_data.proof,
+                .error_message = "Data verification failed",
+                .signature = external_data.signature
+            });
+            response = failure("Data verification failed");
+        }
     }
-    
-    // Update cache
-    if (impl_->caching_enabled_) {
-        update_cache(request, external_data);
-    }
-    
-    return DataResponse{
-        .success = true,
-        .data = external_data.data,
-        .proof = external_data.proof,
-        .error_message = ""
-    };
+
+    // Failures are cached too, briefly, so a broken feed is not hammered
+    update_cache(key, response);
+    return response;
 }
 
 std::future<ExternalLink::DataResponse> ExternalLink::fetch_data_async(const DataRequest& request) {
-    return std::async(std::launch::async, [this, request]() {
-        return fetch_data(request);
+    auto ready = [](DataResponse response) {
+        std::promise<DataResponse> promise;
+        promise.set_value(std::move(response));
+        return promise.get_future();
+    };
+    if (!validate_request(request)) {
+        return ready(failure("Invalid request"));
+    }
+
+    std::string key = Impl::request_key(request);
+    if (auto cached = fetch_from_cache(key)) {
+        return ready(std::move(*cached));
+    }
+    auto joined = impl_->join(key);
+    if (!joined.leader) {
+        // Waits on the caller's thread when it asks, no thread of its own
+        return std::async(std::launch::deferred, [result = std::move(joined.result)] {
+            return result.get();
+        });
+    }
+    return std::async(std::launch::async, [this, request, key = std::move(key)]() {
+        return lead_flight(request, key);
     });
 }
 
 void ExternalLink::fetch_data_with_callback(const DataRequest& request, DataCallback callback) {
-    std::thread([this, request, callback]() {
-        auto response = fetch_data(request);
-        callback(response);
+    if (!validate_request(request)) {
+        callback(failure("Invalid request"));
+        return;
+    }
+
+    std::string key = Impl::request_key(request);
+    if (auto cached = fetch_from_cache(key)) {
+        callback(*cached);
+        return;
+    }
+    if (!impl_->join(key, &callback).leader) {
+        return;  // runs when the flight lands
+    }
+    std::thread([this, request, key = std::move(key), callback = std::move(callback)]() {
+        callback(lead_flight(request, key));
     }).detach();
 }
 
+quids::utils::Task<ExternalLink::DataResponse> ExternalLink::fetch_data_task(DataRequest request) {
+    co_return co_await quids::utils::from_callback<DataResponse>([&](auto resume) {
+        fetch_data_with_callback(request, [resume](const DataResponse& response) { resume(response); });
+    });
+}
+
 bool ExternalLink::verify_external_data(const ExternalData& data) {
-    // Verify source is trusted
+    return verify_external_data(std::span<const ExternalData>(&data, 1))[0] != 0;
+}
+
+std::vector<uint8_t> ExternalLink::verify_external_data(std::span<const ExternalData> batch) {
+    std::vector<uint8_t> result(batch.size(), 0);
+    std::vector<std::array<uint8_t, 32>> payloads(batch.size());
+    std::vector<quids::blockchain::Hash> verdicts(batch.size());
+    std::vector<std::shared_ptr<const Impl::TrustedSource>> sources(batch.size());
+
+    // Copies of one response within the batch wait on the first
+    std::map<quids::blockchain::Hash, size_t> first_of;
+    std::vector<size_t> copy_of(batch.size(), SIZE_MAX);
+
+    std::vector<quids::crypto::VerifyItem> items;
+    std::vector<size_t> item_of;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const auto& data = batch[i];
+        payloads[i] = payload_hash(data);
+        verdicts[i] = Impl::verdict_key(data.source, payloads[i]);
+        if (impl_->verified_.contains(verdicts[i])) {
+            impl_->verifications_remembered_.fetch_add(1, std::memory_order_relaxed);
+            result[i] = 1;
+            continue;
+        }
+        const auto [it, first] = first_of.try_emplace(verdicts[i], i);
+        if (!first) {
+            copy_of[i] = it->second;
+            continue;
+        }
+        sources[i] = impl_->trusted_source(data.source);
+        if (!sources[i]) {
+            continue;
+        }
+        result[i] = 1;
+        if (!sources[i]->public_key.empty()) {
+            items.push_back(quids::crypto::VerifyItem{
+                sources[i]->scheme,
+                payloads[i],
+                data.signature,
+                std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(sources[i]->public_key.data()),
+                                         sources[i]->public_key.size())
+            });
+            item_of.push_back(i);
+        }
+    }
+
+    if (!items.empty()) {
+        const auto valid = quids::crypto::BatchVerifier::global().verify(items);
+        impl_->signatures_checked_.fetch_add(items.size(), std::memory_order_relaxed);
+        for (size_t k = 0; k < items.size(); ++k) {
+            result[item_of[k]] = valid[k];
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (copy_of[i] != SIZE_MAX || !sources[i] || !result[i]) {
+            continue;
+        }
+        // Verify proof if present
+        const auto& data = batch[i];
+        if (!data.proof.empty()) {
+            result[i] = proof_verifier_ && proof_verifier_->verify_zk_proof(data.proof, data.data);
+        }
+        // Only acceptances are remembered, so a forged copy seen first
+        // cannot shut out the genuine response
+        if (result[i]) {
+            impl_->verified_.insert(verdicts[i]);
+        }
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (copy_of[i] != SIZE_MAX) {
+            result[i] = result[copy_of[i]];
+        }
+    }
+    return result;
+}
+
+std::array<uint8_t, 32> ExternalLink::payload_hash(const ExternalData& data) {
+    std::vector<uint8_t> buffer;
+    buffer.reserve(8 + data.data.size() + data.proof.size());
+    const uint64_t size = data.data.size();
+    for (int shift = 0; shift < 64; shift += 8) {
+        buffer.push_back(static_cast<uint8_t>(size >> shift));
+    }
+    buffer.insert(buffer.end(), data.data.begin(), data.data.end());
+    buffer.insert(buffer.end(), data.proof.begin(), data.proof.end());
+    return quids::evm::keccak256(buffer);
+}
+
+bool ExternalLink::add_trusted_source(const std::string& source, const std::string& public_key,
+                                      quids::crypto::SignatureScheme scheme) {
+    auto entry = std::make_shared<const Impl::TrustedSource>(Impl::TrustedSource{public_key, scheme});
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex_);
+        impl_->trusted_sources_[source] = std::move(entry);
+    }
+    impl_->verified_.clear();
+    return true;
+}
+
+bool ExternalLink::remove_trusted_source(const std::string& source) {
     {
         std::lock_guard<std::mutex> lock(impl_->mutex_);
-        if (impl_->trusted_sources_.find(data.source) == impl_->trusted_sources_.end()) {
+        if (impl_->trusted_sources_.erase(source) == 0) {
             return false;
         }
     }
-    
-    // Verify proof if present
-    if (!data.proof.empty()) {
-        return proof_verifier_->verify_zk_proof(data.proof, data.data);
-    }
-    
+    impl_->verified_.clear();
     return true;
 }
 
-bool ExternalLink::add_trusted_source(const std::string& source, const std::string& public_key) {
+std::vector<std::string> ExternalLink::get_trusted_sources() const {
     std::lock_guard<std::mutex> lock(impl_->mutex_);
-    impl_->trusted_sources_[source] = public_key;
-    return true;
+    std::vector<std::string> sources;
+    sources.reserve(impl_->trusted_sources_.size());
+    for (const auto& [source, entry] : impl_->trusted_sources_) {
+        sources.push_back(source);
+    }
+    std::sort(sources.begin(), sources.end());
+    return sources;
+}
+
+void ExternalLink::set_rate_limit(const std::string& source, uint32_t requests_per_second) {
+    auto& limiter = impl_->limiter(source);
+    const int64_t interval = requests_per_second ? 1'000'000'000 / requests_per_second : 0;
+    limiter.burst_ns.store(interval * (requests_per_second ? requests_per_second - 1 : 0), std::memory_order_relaxed);
+    limiter.interval_ns.store(interval, std::memory_order_relaxed);
+}
+
+void ExternalLink::set_quota(const std::string& source, uint32_t daily_quota) {
+    impl_->limiter(source).daily_quota.store(daily_quota, std::memory_order_relaxed);
 }
 
 bool ExternalLink::check_rate_limit(const std::string& source) {
-    std::lock_guard<std::mutex> lock(impl_->mutex_);
-    auto& limit = impl_->rate_limits_[source];
-    
-    auto now = std::chrono::system_clock::now();
-    
-    // Remove old requests
-    while (!limit.request_times.empty() && 
-           now - limit.request_times.front() > std::chrono::seconds(1)) {
-        limit.request_times.pop();
-    }
-    
-    if (limit.request_times.size() >= limit.requests_per_second) {
-        return false;
-    }
-    
-    limit.request_times.push(now);
-    return true;
+    auto* limiter = impl_->find_limiter(source);
+    return !limiter || limiter->acquire_rate(steady_now_ns());
 }
 
 bool ExternalLink::check_quota(const std::string& source) {
-    std::lock_guard<std::mutex> lock(impl_->mutex_);
-    auto& limit = impl_->rate_limits_[source];
-    
-    auto now = std::chrono::system_clock::now();
-    auto today = std::chrono::time_point_cast<std::chrono::hours>(now);
-    
-    // Reset daily quota if it's a new day
-    if (now - today > std::chrono::hours(24)) {
-        limit.requests_today = 0;
+    auto* limiter = impl_->find_limiter(source);
+    if (!limiter) {
+        return true;
     }
-    
-    if (limit.requests_today >= limit.daily_quota) {
-        return false;
-    }
-    
-    limit.requests_today++;
-    return true;
+    const auto day = std::chrono::duration_cast<std::chrono::hours>(
+        std::chrono::system_clock::now().time_since_epoch()).count() / 24;
+    return limiter->acquire_quota(static_cast<uint64_t>(day));
 }
 
-ExternalData ExternalLink::fetch_from_cache(const DataRequest& request) {
-    std::lock_guard<std::mutex> lock(impl_->mutex_);
-    auto it = impl_->cache_.find(request.endpoint);
-    if (it != impl_->cache_.end() && 
-        std::chrono::system_clock::now() < it->second.expiry) {
-        return it->second.data;
+std::optional<ExternalLink::DataResponse> ExternalLink::fetch_from_cache(const std::string& key) {
+    if (!impl_->caching_enabled_.load(std::memory_order_relaxed)) {
+        return std::nullopt;
+    }
+    const auto& shard = impl_->cache_[Impl::shard_of(key, CACHE_SHARDS)];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || std::chrono::steady_clock::now() >= it->second.expiry) {
+        return std::nullopt;
     }
-    return {};
+    auto& counter = it->second.response.success ? impl_->cache_hits_ : impl_->negative_hits_;
+    counter.fetch_add(1, std::memory_order_relaxed);
+    return it->second.response;
 }
 
-void ExternalLink::update_cache(const DataRequest& request, const ExternalData& data) {
-    std::lock_guard<std::mutex> lock(impl_->mutex_);
-    impl_->cache_[request.endpoint] = {
-        data,
-        std::chrono::system_clock::now() + impl_->cache_duration_
-    };
+void ExternalLink::update_cache(const std::string& key, const DataResponse& response) {
+    if (!impl_->caching_enabled_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const auto ttl = std::chrono::seconds(response.success
+        ? impl_->cache_duration_s_.load(std::memory_order_relaxed)
+        : impl_->negative_cache_duration_s_.load(std::memory_order_relaxed));
+    if (ttl.count() <= 0) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    auto& shard = impl_->cache_[Impl::shard_of(key, CACHE_SHARDS)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto& entries = shard.entries;
+    if (entries.size() >= CACHE_CAPACITY_PER_SHARD && !entries.count(key)) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            it = now >= it->second.expiry ? entries.erase(it) : std::next(it);
+        }
+        if (entries.size() >= CACHE_CAPACITY_PER_SHARD) {
+            entries.erase(std::min_element(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+                return a.second.expiry < b.second.expiry;
+            }));
+        }
+    }
+    entries[key] = Impl::CacheEntry{response, now + ttl};
 }
 
 void ExternalLink::enable_caching(bool enable) {
-    std::lock_guard<std::mutex> lock(impl_->mutex_);
-    impl_->caching_enabled_ = enable;
+    impl_->caching_enabled_.store(enable, std::memory_order_relaxed);
 }
 
 void ExternalLink::set_cache_duration(std::chrono::seconds duration) {
-    std::lock_guard<std::mutex> lock(impl_->mutex_);
-    impl_->cache_duration_ = duration;
+    impl_->cache_duration_s_.store(duration.count(), std::memory_order_relaxed);
+}
+
+void ExternalLink::set_negative_cache_duration(std::chrono::seconds duration) {
+    impl_->negative_cache_duration_s_.store(duration.count(), std::memory_order_relaxed);
 }
 
 void ExternalLink::clear_cache() {
-    std::lock_guard<std::mutex> lock(impl_->mutex_);
-    impl_->cache_.clear();
+    for (auto& shard : impl_->cache_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.entries.clear();
+    }
+}
+
+void ExternalLink::set_transport(Transport transport) {
+    impl_->transport_ = std::move(transport);
+}
+
+ExternalLink::Stats ExternalLink::stats() const {
+    Stats stats;
+    stats.upstream_fetches = impl_->upstream_fetches_.load(std::memory_order_relaxed);
+    stats.coalesced = impl_->coalesced_.load(std::memory_order_relaxed);
+    stats.cache_hits = impl_->cache_hits_.load(std::memory_order_relaxed);
+    stats.negative_hits = impl_->negative_hits_.load(std::memory_order_relaxed);
+    stats.rate_limited = impl_->rate_limited_.load(std::memory_order_relaxed);
+    stats.connections_opened = impl_->connections_opened_.load(std::memory_order_relaxed);
+    stats.connections_reused = impl_->connections_reused_.load(std::memory_order_relaxed);
+    stats.signatures_checked = impl_->signatures_checked_.load(std::memory_order_relaxed);
+    stats.verifications_remembered = impl_->verifications_remembered_.load(std::memory_order_relaxed);
+    return stats;
 }
 
 bool ExternalLink::validate_request(const DataRequest& request) {
@@ -346,65 +839,10 @@ bool ExternalLink::validate_request(const DataRequest& request) {
 }
 
 void ExternalLink::establish_secure_connection(const std::string& endpoint) {
-    // Create new SSL object
-    SSL* ssl = SSL_new(impl_->ssl_ctx_);
-    if (!ssl) {
-        throw std::runtime_error("Failed to create SSL object");
-    }
-    
-    // Create BIO for network operations
-    BIO* bio = BIO_new_ssl_connect(impl_->ssl_ctx_);
-    if (!bio) {
-        SSL_free(ssl);
-        throw std::runtime_error("Failed to create BIO");
+    const std::string url = endpoint.find("://") == std::string::npos ? "https://" + endpoint : endpoint;
+    if (auto error = impl_->warm(url, config_.max_response_time_ms)) {
+        throw std::runtime_error("Failed to establish TLS connection: " + *error);
     }
-    
-    try {
-        // Set connection hostname
-        if (BIO_set_conn_hostname(bio, endpoint.c_str()) != 1) {
-            throw std::runtime_error("Failed to set connection hostname");
-        }
-        
-        // Set SSL object to BIO
-        SSL* ssl_bio;
-        BIO_get_ssl(bio, &ssl_bio);
-        if (!ssl_bio) {
-            throw std::runtime_error("Failed to get SSL from BIO");
-        }
-        
-        // Set TLS SNI (Server Name Indication)
-        if (SSL_set_tlsext_host_name(ssl_bio, endpoint.c_str()) != 1) {
-            throw std::runtime_error("Failed to set TLS hostname");
-        }
-        
-        // Perform TLS handshake
-        if (BIO_do_connect(bio) != 1 || BIO_do_handshake(bio) != 1) {
-            throw std::runtime_error("Failed to establish TLS connection");
-        }
-        
-        // Verify the certificate
-        X509* cert = SSL_get_peer_certificate(ssl_bio);
-        if (!cert) {
-            throw std::runtime_error("Failed to get peer certificate");
-        }
-        
-        // Certificate verification result
-        long verify_result = SSL_get_verify_result(ssl_bio);
-        if (verify_result != X509_V_OK) {
-            X509_free(cert);
-            throw std::runtime_error("Certificate verification failed");
-        }
-        
-        X509_free(cert);
-    } catch (const std::exception& e) {
-        BIO_free_all(bio);
-        SSL_free(ssl);
-        throw;
-    }
-    
-    // Clean up
-    BIO_free_all(bio);
-    SSL_free(ssl);
 }
 
 void ExternalLink::verify_tls_certificate(const std::string& cert) {
@@ -419,4 +857,4 @@ void ExternalLink::handle_verification_failure(const DataResponse& response) {
     // Implement verification failure handling logic
 }
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
@@ -0,0 +1,863 @@
+#include "evm/Interpreter.hpp"
+#include "evm/Opcodes.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+// GCC and Clang thread the handlers through a label table; other compilers
+// fall back to a switch over the same handler bodies
+#if defined(__GNUC__)
+#define QUIDS_EVM_COMPUTED_GOTO 1
+#else
+#define QUIDS_EVM_COMPUTED_GOTO 0
+#endif
+
+namespace quids {
+namespace evm {
+
+namespace {
+
+using word = ::evm::uint256_t;
+
+constexpr size_t STACK_LIMIT = ::evm::Stack::LIMIT;
+constexpr uint64_t MEMORY_LIMIT = ::evm::Memory::MAX_SIZE;
+
+constexpr int64_t COPY_WORD_GAS = 3;
+constexpr int64_t SHA3_WORD_GAS = 6;
+constexpr int64_t LOG_BYTE_GAS = 8;
+constexpr int64_t EXP_BYTE_GAS = 50;
+
+// EIP-2929 / EIP-2200 storage pricing on top of the 100 warm access that
+// is part of the static block gas
+constexpr int64_t COLD_SLOAD_SURCHARGE = 2000;
+constexpr int64_t COLD_SSTORE_SURCHARGE = 2100;
+constexpr int64_t SSTORE_SET_EXTRA = 20000 - 100;
+constexpr int64_t SSTORE_RESET_EXTRA = 2900 - 100;
+constexpr int64_t SSTORE_STIPEND = 2300;
+
+// EIP-2929 / EIP-150 call pricing on top of the 100 warm access
+constexpr int64_t COLD_ACCOUNT_SURCHARGE = 2500;
+constexpr int64_t CALL_VALUE_GAS = 9000;
+constexpr int64_t CALL_STIPEND = 2300;
+
+// EIP-170 / EIP-3860 (from Shanghai) code size limits and their per-byte and per-word gas
+constexpr size_t MAX_CODE_SIZE = 24576;
+constexpr size_t MAX_INITCODE_SIZE = 2 * MAX_CODE_SIZE;
+constexpr int64_t CODE_DEPOSIT_BYTE_GAS = 200;
+constexpr int64_t INITCODE_WORD_GAS = 2;
+
+// For callers without an executor: each thread keeps its arenas so the
+// frames and committed memory pages are reused from call to call
+class ArenaLease {
+public:
+    ArenaLease() {
+        auto& arenas = spare();
+        if (arenas.empty()) {
+            arena_ = std::make_unique<CallArena>();
+        } else {
+            arena_ = std::move(arenas.back());
+            arenas.pop_back();
+        }
+    }
+
+    ~ArenaLease() { spare().push_back(std::move(arena_)); }
+
+    ArenaLease(const ArenaLease&) = delete;
+    ArenaLease& operator=(const ArenaLease&) = delete;
+
+    CallArena& operator*() { return *arena_; }
+
+private:
+    static std::vector<std::unique_ptr<CallArena>>& spare() {
+        thread_local std::vector<std::unique_ptr<CallArena>> arenas;
+        return arenas;
+    }
+
+    std::unique_ptr<CallArena> arena_;
+};
+
+bool fits(const word& v, uint64_t limit, uint64_t& out) {
+    if (v > limit) return false;
+    out = static_cast<uint64_t>(v);
+    return true;
+}
+
+uint64_t words(uint64_t bytes) {
+    return (bytes + 31) / 32;
+}
+
+// Validates [offset, offset + size) and pays for growing memory over it
+bool memory_range(::evm::Memory& memory, int64_t& gas, const word& offset, const word& size,
+                  uint64_t& off, uint64_t& len) {
+    if (!fits(size, MEMORY_LIMIT, len)) return false;
+    if (len == 0) {
+        off = 0;
+        return true;
+    }
+    if (!fits(offset, MEMORY_LIMIT, off)) return false;
+    if (off + len > memory.size()) {
+        if (off + len > MEMORY_LIMIT) return false;
+        gas -= static_cast<int64_t>(memory.calculate_expansion_cost(off, len));
+        if (gas < 0) return false;
+        (void)memory.expand(off + len);
+    }
+    return true;
+}
+
+// Copies n bytes from src at src_offset, zero-filling past its end
+void copy_padded(uint8_t* dst, uint64_t n, const uint8_t* src, size_t src_size, const word& src_offset) {
+    size_t copied = 0;
+    if (src_offset < src_size) {
+        const auto off = static_cast<size_t>(src_offset);
+        copied = std::min<size_t>(n, src_size - off);
+        std::memcpy(dst, src + off, copied);
+    }
+    std::memset(dst + copied, 0, n - copied);
+}
+
+word address_word(const ::evm::Address& address) {
+    return word::load_be(address.bytes.data(), address.bytes.size());
+}
+
+::evm::Address word_address(const word& v) {
+    uint8_t buf[32];
+    v.store_be(buf);
+    ::evm::Address address;
+    std::memcpy(address.bytes.data(), buf + 12, address.bytes.size());
+    return address;
+}
+
+::evm::Address hash_address(const Hash256& hash) {
+    ::evm::Address address;
+    std::memcpy(address.bytes.data(), hash.data() + 12, address.bytes.size());
+    return address;
+}
+
+// keccak256(rlp([sender, nonce]))[12:]
+::evm::Address create_address(const ::evm::Address& sender, uint64_t nonce) {
+    uint8_t rlp[1 + 21 + 9];
+    size_t n = 1;
+    rlp[n++] = 0x80 + 20;
+    std::memcpy(rlp + n, sender.bytes.data(), 20);
+    n += 20;
+    if (nonce == 0) {
+        rlp[n++] = 0x80;
+    } else if (nonce < 0x80) {
+        rlp[n++] = static_cast<uint8_t>(nonce);
+    } else {
+        size_t width = 0;
+        for (uint64_t v = nonce; v != 0; v >>= 8) ++width;
+        rlp[n++] = static_cast<uint8_t>(0x80 + width);
+        for (size_t i = width; i-- > 0;) rlp[n++] = static_cast<uint8_t>(nonce >> (8 * i));
+    }
+    rlp[0] = static_cast<uint8_t>(0xc0 + (n - 1));
+    return hash_address(keccak256(rlp, n));
+}
+
+// keccak256(0xff ++ sender ++ salt ++ keccak256(init_code))[12:]
+::evm::Address create2_address(const ::evm::Address& sender, const word& salt, const Hash256& init_hash) {
+    uint8_t buf[1 + 20 + 32 + 32];
+    buf[0] = 0xff;
+    std::memcpy(buf + 1, sender.bytes.data(), 20);
+    salt.store_be(buf + 21);
+    std::memcpy(buf + 53, init_hash.data(), 32);
+    return hash_address(keccak256(buf, sizeof(buf)));
+}
+
+constexpr word SIGN_BIT = word(1) << 255;
+
+constexpr bool is_negative(const word& v) {
+    return v.bit(255);
+}
+
+constexpr word negate(const word& v) {
+    return -v;
+}
+
+word sdiv(const word& a, const word& b) {
+    if (b == 0) return 0;
+    const bool na = is_negative(a);
+    const bool nb = is_negative(b);
+    const word q = (na ? negate(a) : a) / (nb ? negate(b) : b);
+    return na != nb ? negate(q) : q;
+}
+
+word smod(const word& a, const word& b) {
+    if (b == 0) return 0;
+    const bool na = is_negative(a);
+    const word r = (na ? negate(a) : a) % (is_negative(b) ? negate(b) : b);
+    return na ? negate(r) : r;
+}
+
+word signextend(const word& byte_index, const word& x) {
+    if (byte_index >= 31) return x;
+    const unsigned bit = 8 * static_cast<unsigned>(byte_index) + 7;
+    const word mask = (word(1) << (bit + 1)) - 1;
+    return x.bit(bit) ? (x | ~mask) : (x & mask);
+}
+
+word sar(const word& shift, const word& x) {
+    const bool negative = is_negative(x);
+    if (shift >= 256) {
+        return negative ? ~word(0) : word(0);
+    }
+    const auto s = static_cast<unsigned>(shift);
+    return negative ? ~(~x).shr(s) : x.shr(s);
+}
+
+} // namespace
+
+struct CallArena::Slot {
+    ::evm::Stack stack;
+    ::evm::Memory memory;
+    // Output of the last call this frame made
+    std::vector<uint8_t> return_data;
+
+    // Set up by the caller before switching here
+    ExecutionContext context;
+    std::shared_ptr<const AnalyzedCode> code;
+    ::evm::Storage::Snapshot storage_snapshot{0};
+    CallHost::Checkpoint host_checkpoint{0};
+    size_t log_mark{0};
+
+    // This frame's registers while a callee runs, and where the callee's
+    // output goes
+    const AnalyzedCode* saved_code{nullptr};
+    const ExecutionContext* saved_ctx{nullptr};
+    const Instruction* resume{nullptr};
+    ::evm::uint256_t* saved_sp{nullptr};
+    int64_t saved_gas{0};
+    uint64_t ret_offset{0};
+    uint64_t ret_size{0};
+    bool creating{false};  // the callee is init code for `created`
+    ::evm::Address created{};
+};
+
+CallArena::CallArena() = default;
+CallArena::~CallArena() = default;
+
+CallArena::Slot& CallArena::slot(size_t depth) {
+    while (slots_.size() <= depth) {
+        slots_.push_back(std::make_unique<Slot>());
+    }
+    return *slots_[depth];
+}
+
+const char* to_string(InterpreterStatus status) {
+    switch (status) {
+        case InterpreterStatus::Success: return "Success";
+        case InterpreterStatus::Revert: return "Execution reverted";
+        case InterpreterStatus::OutOfGas: return "Out of gas";
+        case InterpreterStatus::StackUnderflow: return "Stack underflow";
+        case InterpreterStatus::StackOverflow: return "Stack overflow";
+        case InterpreterStatus::BadJump: return "Invalid jump destination";
+        case InterpreterStatus::InvalidOpcode: return "Invalid opcode";
+        case InterpreterStatus::OutOfBounds: return "Return data out of bounds";
+        case InterpreterStatus::StaticViolation: return "State change in a static call";
+        case InterpreterStatus::Unsupported: return "Unsupported opcode";
+    }
+    return "Unknown";
+}
+
+namespace {
+
+// Code from the host or the cache for another fork is decoded again, so a
+// frame never runs instructions analysed under different rules
+std::shared_ptr<const AnalyzedCode> for_fork(std::shared_ptr<const AnalyzedCode> code, Fork fork) {
+    if (!code || code->fork == fork) return code;
+    return analyze(code->code, code->code_hash, fork);
+}
+
+// The interpreter loop behind every overload, instantiated per fork so
+// the fork's rules are constants. Calls switch it to the callee's frame
+// and back; without an arena they fail Unsupported.
+template <Fork F>
+InterpreterResult run(const AnalyzedCode& entry_code, const ExecutionContext& entry_ctx, uint64_t gas_limit,
+                      ::evm::Stack& operand_stack, ::evm::Memory& entry_memory, CallArena* arena) {
+    InterpreterResult result;
+    operand_stack.clear();
+    entry_memory.clear();
+    const ::evm::Storage::Snapshot storage_snapshot = entry_ctx.storage ? entry_ctx.storage->snapshot() : 0;
+    const CallHost::Checkpoint host_checkpoint = entry_ctx.host ? entry_ctx.host->checkpoint() : 0;
+    static const std::vector<uint8_t> no_return_data;
+
+    // The running frame's registers; a call or return rebinds all of them
+    size_t depth = 0;
+    const AnalyzedCode* code = &entry_code;
+    const ExecutionContext* ctx = &entry_ctx;
+    ::evm::Memory* memory = &entry_memory;
+    const std::vector<uint8_t>* returned = &no_return_data;
+    if (arena) {
+        arena->slot(0).return_data.clear();
+        returned = &arena->slot(0).return_data;
+    }
+    word* stack = operand_stack.slots();
+    // Memory never moves once reserved, so this stays valid as it grows
+    uint8_t* mem = memory->data();
+    word* sp = stack;  // one past the top
+    const Instruction* instructions = code->instructions.data();
+    const Instruction* ip = instructions;
+    const BlockInfo* blocks = code->blocks.data();
+    const word* push_values = code->push_values.data();
+    int64_t gas = static_cast<int64_t>(std::min<uint64_t>(gas_limit, INT64_MAX));
+    InterpreterStatus status = InterpreterStatus::Success;
+    uint64_t out_offset = 0;
+    uint64_t out_size = 0;
+    // Handed from a call instruction to the frame switch
+    CallArena::Slot* next = nullptr;
+    int64_t next_gas = 0;
+
+#define FAIL(s) { status = InterpreterStatus::s; goto done; }
+#define CHARGE(amount) { gas -= static_cast<int64_t>(amount); if (gas < 0) FAIL(OutOfGas) }
+
+#if QUIDS_EVM_COMPUTED_GOTO
+// Labels as values and computed gotos are GNU extensions; -Wpedantic would
+// flag every handler. Popped after the dispatch macros go out of scope.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define OP(name) op_##name:
+#define DISPATCH() goto *dispatch_table[ip->op]
+    // Same order as Handler
+    static const void* const dispatch_table[] = {
+        &&op_STOP, &&op_ADD, &&op_MUL, &&op_SUB, &&op_DIV, &&op_SDIV, &&op_MOD, &&op_SMOD,
+        &&op_ADDMOD, &&op_MULMOD, &&op_EXP, &&op_SIGNEXTEND,
+        &&op_LT, &&op_GT, &&op_SLT, &&op_SGT, &&op_EQ, &&op_ISZERO, &&op_AND, &&op_OR,
+        &&op_XOR, &&op_NOT, &&op_BYTE, &&op_SHL, &&op_SHR, &&op_SAR,
+        &&op_SHA3,
+        &&op_ADDRESS, &&op_ORIGIN, &&op_CALLER, &&op_CALLVALUE, &&op_CALLDATALOAD,
+        &&op_CALLDATASIZE, &&op_CALLDATACOPY, &&op_CODESIZE, &&op_CODECOPY, &&op_GASPRICE,
+        &&op_RETURNDATASIZE, &&op_RETURNDATACOPY,
+        &&op_COINBASE, &&op_TIMESTAMP, &&op_NUMBER, &&op_PREVRANDAO, &&op_GASLIMIT,
+        &&op_CHAINID, &&op_BASEFEE,
+        &&op_POP, &&op_MLOAD, &&op_MSTORE, &&op_MSTORE8, &&op_SLOAD, &&op_SSTORE,
+        &&op_JUMP, &&op_JUMPI, &&op_PC, &&op_MSIZE, &&op_GAS, &&op_JUMPDEST,
+        &&op_PUSH, &&op_DUP, &&op_SWAP, &&op_LOG,
+        &&op_RETURN, &&op_REVERT, &&op_CALL, &&op_CREATE,
+        &&op_INVALID, &&op_UNSUPPORTED, &&op_BEGIN_BLOCK,
+        &&op_JUMP_STATIC, &&op_JUMPI_STATIC,
+        &&op_PUSH_ADD, &&op_PUSH_SUB, &&op_PUSH_AND, &&op_PUSH_EQ,
+    };
+    static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) == NUM_HANDLERS,
+                  "dispatch table out of sync with Handler");
+    DISPATCH();
+#else
+#define OP(name) case H_##name:
+#define DISPATCH() goto dispatch
+dispatch:
+    switch (ip->op) {
+#endif
+#define NEXT() { ++ip; DISPATCH(); }
+#define BIND_CODE() { \
+        instructions = code->instructions.data(); \
+        blocks = code->blocks.data(); \
+        push_values = code->push_values.data(); \
+    }
+
+    // The first instruction of every block: pay for the whole block and
+    // make sure its stack accesses are in range
+    OP(JUMPDEST) OP(BEGIN_BLOCK) {
+        const BlockInfo& block = blocks[ip->arg];
+        CHARGE(block.gas)
+        const auto height = sp - stack;
+        if (height < block.stack_required) FAIL(StackUnderflow)
+        if (height + block.stack_growth > static_cast<ptrdiff_t>(STACK_LIMIT)) FAIL(StackOverflow)
+        NEXT()
+    }
+
+    OP(STOP) { goto done; }
+
+    OP(ADD) { sp[-2] = sp[-1] + sp[-2]; --sp; NEXT() }
+    OP(MUL) { sp[-2] = sp[-1] * sp[-2]; --sp; NEXT() }
+    OP(SUB) { sp[-2] = sp[-1] - sp[-2]; --sp; NEXT() }
+    OP(DIV) { sp[-2] = sp[-2] == 0 ? word(0) : word(sp[-1] / sp[-2]); --sp; NEXT() }
+    OP(SDIV) { sp[-2] = sdiv(sp[-1], sp[-2]); --sp; NEXT() }
+    OP(MOD) { sp[-2] = sp[-2] == 0 ? word(0) : word(sp[-1] % sp[-2]); --sp; NEXT() }
+    OP(SMOD) { sp[-2] = smod(sp[-1], sp[-2]); --sp; NEXT() }
+    OP(ADDMOD) {
+        const word& n = sp[-3];
+        sp[-3] = addmod(sp[-1], sp[-2], n);
+        sp -= 2;
+        NEXT()
+    }
+    OP(MULMOD) {
+        const word& n = sp[-3];
+        sp[-3] = mulmod(sp[-1], sp[-2], n);
+        sp -= 2;
+        NEXT()
+    }
+    OP(EXP) {
+        const word& exponent = sp[-2];
+        if (exponent != 0) {
+            CHARGE(EXP_BYTE_GAS * exponent.byte_width())
+        }
+        sp[-2] = ::evm::exp(sp[-1], exponent);
+        --sp;
+        NEXT()
+    }
+    OP(SIGNEXTEND) { sp[-2] = signextend(sp[-1], sp[-2]); --sp; NEXT() }
+
+    OP(LT) { sp[-2] = sp[-1] < sp[-2] ? 1 : 0; --sp; NEXT() }
+    OP(GT) { sp[-2] = sp[-1] > sp[-2] ? 1 : 0; --sp; NEXT() }
+    OP(SLT) { sp[-2] = (sp[-1] ^ SIGN_BIT) < (sp[-2] ^ SIGN_BIT) ? 1 : 0; --sp; NEXT() }
+    OP(SGT) { sp[-2] = (sp[-1] ^ SIGN_BIT) > (sp[-2] ^ SIGN_BIT) ? 1 : 0; --sp; NEXT() }
+    OP(EQ) { sp[-2] = sp[-1] == sp[-2] ? 1 : 0; --sp; NEXT() }
+    OP(ISZERO) { sp[-1] = sp[-1] == 0 ? 1 : 0; NEXT() }
+    OP(AND) { sp[-2] &= sp[-1]; --sp; NEXT() }
+    OP(OR) { sp[-2] |= sp[-1]; --sp; NEXT() }
+    OP(XOR) { sp[-2] ^= sp[-1]; --sp; NEXT() }
+    OP(NOT) { sp[-1] = ~sp[-1]; NEXT() }
+    OP(BYTE) {
+        const word& i = sp[-1];
+        sp[-2] = i < 32 ? word(sp[-2].shr(8 * (31 - static_cast<unsigned>(i))) & 0xff) : word(0);
+        --sp;
+        NEXT()
+    }
+    OP(SHL) {
+        sp[-2] = sp[-1] < 256 ? sp[-2].shl(static_cast<unsigned>(sp[-1])) : word(0);
+        --sp;
+        NEXT()
+    }
+    OP(SHR) {
+        sp[-2] = sp[-1] < 256 ? sp[-2].shr(static_cast<unsigned>(sp[-1])) : word(0);
+        --sp;
+        NEXT()
+    }
+    OP(SAR) { sp[-2] = sar(sp[-1], sp[-2]); --sp; NEXT() }
+
+    OP(SHA3) {
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-1], sp[-2], off, len)) FAIL(OutOfGas)
+        CHARGE(SHA3_WORD_GAS * words(len))
+        const Hash256 hash = keccak256(mem + off, len);
+        sp[-2] = word::load_be(hash.data());
+        --sp;
+        NEXT()
+    }
+
+    OP(ADDRESS) { *sp++ = address_word(ctx->address); NEXT() }
+    OP(ORIGIN) { *sp++ = ctx->origin; NEXT() }
+    OP(CALLER) { *sp++ = ctx->caller; NEXT() }
+    OP(CALLVALUE) { *sp++ = ctx->value; NEXT() }
+    OP(CALLDATALOAD) {
+        uint8_t buf[32];
+        copy_padded(buf, sizeof(buf), ctx->input, ctx->input_size, sp[-1]);
+        sp[-1] = word::load_be(buf);
+        NEXT()
+    }
+    OP(CALLDATASIZE) { *sp++ = ctx->input_size; NEXT() }
+    OP(CALLDATACOPY) {
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-1], sp[-3], off, len)) FAIL(OutOfGas)
+        CHARGE(COPY_WORD_GAS * words(len))
+        if (len) copy_padded(mem + off, len, ctx->input, ctx->input_size, sp[-2]);
+        sp -= 3;
+        NEXT()
+    }
+    OP(CODESIZE) { *sp++ = code->code.size(); NEXT() }
+    OP(CODECOPY) {
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-1], sp[-3], off, len)) FAIL(OutOfGas)
+        CHARGE(COPY_WORD_GAS * words(len))
+        if (len) copy_padded(mem + off, len, code->code.data(), code->code.size(), sp[-2]);
+        sp -= 3;
+        NEXT()
+    }
+    OP(GASPRICE) { *sp++ = ctx->gas_price; NEXT() }
+    // Output of the frame's last call
+    OP(RETURNDATASIZE) { *sp++ = returned->size(); NEXT() }
+    OP(RETURNDATACOPY) {
+        const word& src = sp[-2];
+        if (src > returned->size() || sp[-3] > word(returned->size() - static_cast<uint64_t>(src))) {
+            FAIL(OutOfBounds)
+        }
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-1], sp[-3], off, len)) FAIL(OutOfGas)
+        CHARGE(COPY_WORD_GAS * words(len))
+        if (len) std::memcpy(mem + off, returned->data() + static_cast<size_t>(src), len);
+        sp -= 3;
+        NEXT()
+    }
+
+    OP(COINBASE) { *sp++ = ctx->coinbase; NEXT() }
+    OP(TIMESTAMP) { *sp++ = ctx->timestamp; NEXT() }
+    OP(NUMBER) { *sp++ = ctx->number; NEXT() }
+    OP(PREVRANDAO) { *sp++ = ctx->prevrandao; NEXT() }
+    OP(GASLIMIT) { *sp++ = ctx->block_gas_limit; NEXT() }
+    OP(CHAINID) { *sp++ = ctx->chain_id; NEXT() }
+    OP(BASEFEE) { *sp++ = ctx->base_fee; NEXT() }
+
+    OP(POP) { --sp; NEXT() }
+    OP(MLOAD) {
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-1], 32, off, len)) FAIL(OutOfGas)
+        sp[-1] = word::load_be(mem + off);
+        NEXT()
+    }
+    OP(MSTORE) {
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-1], 32, off, len)) FAIL(OutOfGas)
+        sp[-2].store_be(mem + off);
+        sp -= 2;
+        NEXT()
+    }
+    OP(MSTORE8) {
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-1], 1, off, len)) FAIL(OutOfGas)
+        mem[off] = static_cast<uint8_t>(static_cast<uint64_t>(sp[-2]));
+        sp -= 2;
+        NEXT()
+    }
+    OP(SLOAD) {
+        if (!ctx->storage) FAIL(Unsupported)
+        const ::evm::SlotRead read = ctx->storage->load_for_access(ctx->address, sp[-1]);
+        if (!read.warm) CHARGE(COLD_SLOAD_SURCHARGE)
+        sp[-1] = read.value;
+        NEXT()
+    }
+    OP(SSTORE) {
+        if (!ctx->storage) FAIL(Unsupported)
+        if (ctx->is_static) FAIL(StaticViolation)
+        // arg is the static gas still owed by the rest of the block
+        if (gas + static_cast<int64_t>(ip->arg) <= SSTORE_STIPEND) FAIL(OutOfGas)
+        const ::evm::SlotWrite write = ctx->storage->store_for_access(ctx->address, sp[-1], sp[-2]);
+        if (!write.warm) CHARGE(COLD_SSTORE_SURCHARGE)
+        if (write.current != sp[-2] && write.original == write.current) {
+            CHARGE(write.original.is_zero() ? SSTORE_SET_EXTRA : SSTORE_RESET_EXTRA)
+        }
+        sp -= 2;
+        NEXT()
+    }
+    OP(JUMP) {
+        const word& dest = *--sp;
+        if (dest >= code->code.size() || !code->is_jumpdest(static_cast<uint64_t>(dest))) FAIL(BadJump)
+        ip = instructions + code->jumpdest_index[static_cast<size_t>(dest)];
+        DISPATCH();
+    }
+    OP(JUMPI) {
+        sp -= 2;
+        if (sp[0] == 0) NEXT()
+        const word& dest = sp[1];
+        if (dest >= code->code.size() || !code->is_jumpdest(static_cast<uint64_t>(dest))) FAIL(BadJump)
+        ip = instructions + code->jumpdest_index[static_cast<size_t>(dest)];
+        DISPATCH();
+    }
+    OP(PC) { *sp++ = ip->arg; NEXT() }
+    OP(MSIZE) { *sp++ = memory->size(); NEXT() }
+    OP(GAS) { *sp++ = static_cast<uint64_t>(gas) + ip->arg; NEXT() }
+
+    OP(PUSH) { *sp++ = push_values[ip->arg]; NEXT() }
+    OP(DUP) { *sp = sp[-static_cast<ptrdiff_t>(ip->arg)]; ++sp; NEXT() }
+    OP(SWAP) { std::swap(sp[-1], sp[-1 - static_cast<ptrdiff_t>(ip->arg)]); NEXT() }
+    OP(LOG) {
+        if (ctx->is_static) FAIL(StaticViolation)
+        const uint32_t topics = ip->arg;
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-1], sp[-2], off, len)) FAIL(OutOfGas)
+        CHARGE(LOG_BYTE_GAS * static_cast<int64_t>(len))
+        LogEntry entry;
+        entry.address = ctx->address;
+        entry.topics.assign(std::make_reverse_iterator(sp - 2),
+                            std::make_reverse_iterator(sp - 2 - topics));
+        entry.data.assign(mem + off, mem + off + len);
+        result.logs.push_back(std::move(entry));
+        sp -= 2 + topics;
+        NEXT()
+    }
+
+    OP(RETURN) {
+        if (!memory_range(*memory, gas, sp[-1], sp[-2], out_offset, out_size)) FAIL(OutOfGas)
+        goto done;
+    }
+    OP(REVERT) {
+        if (!memory_range(*memory, gas, sp[-1], sp[-2], out_offset, out_size)) FAIL(OutOfGas)
+        FAIL(Revert)
+    }
+
+    // CALL, DELEGATECALL and STATICCALL (arg is the opcode). The caller
+    // resumes at the next instruction once the callee's frame finishes.
+    OP(CALL) {
+        if (!arena || !ctx->host) FAIL(Unsupported)
+        // gas, address, [value], args offset, args size, ret offset, ret size
+        const uint8_t kind = static_cast<uint8_t>(ip->arg);
+        const ptrdiff_t args = kind == CALL ? 4 : 3;
+        const ::evm::Address target = word_address(sp[-2]);
+        const word value = kind == CALL ? sp[-3] : word(0);
+        if (value != 0 && ctx->is_static) FAIL(StaticViolation)
+        uint64_t args_off, args_len, ret_off, ret_len;
+        if (!memory_range(*memory, gas, sp[-args], sp[-args - 1], args_off, args_len) ||
+            !memory_range(*memory, gas, sp[-args - 2], sp[-args - 3], ret_off, ret_len)) FAIL(OutOfGas)
+        if (ctx->storage && !ctx->storage->warm_account(target)) CHARGE(COLD_ACCOUNT_SURCHARGE)
+        if (value != 0) CHARGE(CALL_VALUE_GAS)
+        // EIP-150: the callee gets at most all but one 64th of what is left
+        const int64_t cap = gas - gas / 64;
+        const int64_t forwarded =
+            sp[-1] < word(static_cast<uint64_t>(cap)) ? static_cast<int64_t>(static_cast<uint64_t>(sp[-1])) : cap;
+        sp -= args + 3;
+
+        CallArena::Slot& caller = arena->slot(depth);
+        caller.return_data.clear();
+        if (depth >= CallArena::DEPTH_LIMIT) { *sp++ = 0; NEXT() }
+        CallArena::Slot& callee = arena->slot(depth + 1);
+        callee.storage_snapshot = ctx->storage ? ctx->storage->snapshot() : 0;
+        callee.host_checkpoint = ctx->host->checkpoint();
+        callee.log_mark = result.logs.size();
+        if (value != 0 && !ctx->host->transfer(ctx->address, target, value)) { *sp++ = 0; NEXT() }
+        const int64_t callee_gas = forwarded + (value != 0 ? CALL_STIPEND : 0);
+        if (auto native = ctx->host->run_precompile(target, mem + args_off, args_len,
+                                                    static_cast<uint64_t>(callee_gas))) {
+            gas -= forwarded;
+            if (native->success && native->gas_used <= static_cast<uint64_t>(callee_gas)) {
+                gas += callee_gas - static_cast<int64_t>(native->gas_used);
+                const uint64_t n = std::min<uint64_t>(ret_len, native->output.size());
+                if (n) std::memcpy(mem + ret_off, native->output.data(), n);
+                caller.return_data = std::move(native->output);
+                *sp++ = 1;
+            } else {
+                ctx->host->revert(callee.host_checkpoint);
+                *sp++ = 0;
+            }
+            NEXT()
+        }
+        callee.code = for_fork(ctx->host->code_at(target), F);
+        // Nothing to run: the value, if any, has moved
+        if (!callee.code) { *sp++ = 1; NEXT() }
+
+        callee.context = *ctx;
+        if (kind != DELEGATECALL) {
+            callee.context.address = target;
+            callee.context.caller = address_word(ctx->address);
+            callee.context.value = value;
+        }
+        callee.context.is_static = ctx->is_static || kind == STATICCALL;
+        callee.context.input = mem + args_off;
+        callee.context.input_size = args_len;
+        caller.ret_offset = ret_off;
+        caller.ret_size = ret_len;
+        caller.creating = false;
+        gas -= forwarded;
+        next = &callee;
+        next_gas = callee_gas;
+        goto enter;
+    }
+    // CREATE and CREATE2 (arg is the opcode): runs the init code in a new
+    // frame and deploys what it returns
+    OP(CREATE) {
+        if (!arena || !ctx->host) FAIL(Unsupported)
+        if (ctx->is_static) FAIL(StaticViolation)
+        // value, offset, size, [salt]
+        const bool salted = ip->arg == CREATE2;
+        uint64_t off, len;
+        if (!memory_range(*memory, gas, sp[-2], sp[-3], off, len)) FAIL(OutOfGas)
+        if constexpr (F >= Fork::Shanghai) {
+            if (len > MAX_INITCODE_SIZE) FAIL(OutOfGas)
+            CHARGE(INITCODE_WORD_GAS * words(len))
+        }
+        if (salted) CHARGE(SHA3_WORD_GAS * words(len))
+        const word value = sp[-1];
+        const word salt = salted ? sp[-4] : word(0);
+        sp -= salted ? 4 : 3;
+
+        CallArena::Slot& caller = arena->slot(depth);
+        caller.return_data.clear();
+        if (depth >= CallArena::DEPTH_LIMIT) { *sp++ = 0; NEXT() }
+        std::vector<uint8_t> init(mem + off, mem + off + len);
+        const Hash256 init_hash = keccak256(init);
+        const uint64_t nonce = ctx->host->increment_nonce(ctx->address);
+        const ::evm::Address created =
+            salted ? create2_address(ctx->address, salt, init_hash) : create_address(ctx->address, nonce);
+        if (ctx->storage) ctx->storage->warm_account(created);
+        CallArena::Slot& callee = arena->slot(depth + 1);
+        callee.storage_snapshot = ctx->storage ? ctx->storage->snapshot() : 0;
+        callee.host_checkpoint = ctx->host->checkpoint();
+        callee.log_mark = result.logs.size();
+        if (ctx->host->code_at(created) || (value != 0 && !ctx->host->transfer(ctx->address, created, value))) {
+            *sp++ = 0;
+            NEXT()
+        }
+
+        callee.code = for_fork(CodeCache::global().get(init_hash, init), F);
+        callee.context = *ctx;
+        callee.context.address = created;
+        callee.context.caller = address_word(ctx->address);
+        callee.context.value = value;
+        callee.context.input = nullptr;
+        callee.context.input_size = 0;
+        caller.ret_offset = 0;
+        caller.ret_size = 0;
+        caller.creating = true;
+        caller.created = created;
+        const int64_t forwarded = gas - gas / 64;
+        gas -= forwarded;
+        next = &callee;
+        next_gas = forwarded;
+        goto enter;
+    }
+    OP(INVALID) { FAIL(InvalidOpcode) }
+    OP(UNSUPPORTED) { FAIL(Unsupported) }
+
+    // Fused PUSH pairs from optimize(). The pushed value is the top operand,
+    // and the partner instruction that follows is skipped.
+    OP(JUMP_STATIC) {
+        ip = instructions + ip->arg;
+        DISPATCH();
+    }
+    OP(JUMPI_STATIC) {
+        if (*--sp != 0) {
+            ip = instructions + ip->arg;
+            DISPATCH();
+        }
+        ip += 2;
+        DISPATCH();
+    }
+    OP(PUSH_ADD) { sp[-1] = push_values[ip->arg] + sp[-1]; ip += 2; DISPATCH(); }
+    OP(PUSH_SUB) { sp[-1] = push_values[ip->arg] - sp[-1]; ip += 2; DISPATCH(); }
+    OP(PUSH_AND) { sp[-1] = push_values[ip->arg] & sp[-1]; ip += 2; DISPATCH(); }
+    OP(PUSH_EQ) { sp[-1] = word(push_values[ip->arg] == sp[-1] ? 1 : 0); ip += 2; DISPATCH(); }
+
+#if !QUIDS_EVM_COMPUTED_GOTO
+    default: FAIL(InvalidOpcode)
+    }
+#endif
+
+// Saves the caller's registers in its slot and starts the callee on the
+// next one
+enter: {
+    CallArena::Slot& caller = arena->slot(depth);
+    caller.saved_code = code;
+    caller.saved_ctx = ctx;
+    caller.resume = ip + 1;
+    caller.saved_sp = sp;
+    caller.saved_gas = gas;
+    ++depth;
+    code = next->code.get();
+    ctx = &next->context;
+    memory = &next->memory;
+    memory->clear();
+    mem = memory->data();
+    stack = next->stack.slots();
+    sp = stack;
+    next->return_data.clear();
+    returned = &next->return_data;
+    BIND_CODE()
+    ip = instructions;
+    gas = next_gas;
+    DISPATCH();
+}
+
+done:
+    if (depth > 0) {
+        // A callee finished: undo it unless it succeeded, hand back its
+        // output and unused gas, and resume the caller
+        CallArena::Slot& callee = arena->slot(depth);
+        CallArena::Slot& caller = arena->slot(depth - 1);
+        int64_t left = status == InterpreterStatus::Success || status == InterpreterStatus::Revert ? gas : 0;
+        bool ok = status == InterpreterStatus::Success;
+        if (ok && caller.creating) {
+            const int64_t deposit = CODE_DEPOSIT_BYTE_GAS * static_cast<int64_t>(out_size);
+            // EIP-3541 reserves code starting with 0xEF
+            const bool reserved = F >= Fork::London && out_size > 0 && mem[out_offset] == 0xef;
+            if (out_size > MAX_CODE_SIZE || reserved || left < deposit) {
+                ok = false;
+                left = 0;
+            } else {
+                left -= deposit;
+                ctx->host->set_code(caller.created, std::vector<uint8_t>(mem + out_offset, mem + out_offset + out_size));
+            }
+        }
+        if (!ok) {
+            if (ctx->storage) ctx->storage->revert(callee.storage_snapshot);
+            ctx->host->revert(callee.host_checkpoint);
+            result.logs.resize(callee.log_mark);
+        }
+        // Deployed code is not return data
+        if (status == InterpreterStatus::Revert || (status == InterpreterStatus::Success && !caller.creating)) {
+            caller.return_data.assign(mem + out_offset, mem + out_offset + out_size);
+            if (!caller.creating) {
+                std::memcpy(caller.memory.data() + caller.ret_offset, mem + out_offset,
+                            std::min(caller.ret_size, out_size));
+            }
+        }
+        callee.code.reset();
+
+        --depth;
+        code = caller.saved_code;
+        ctx = caller.saved_ctx;
+        memory = &caller.memory;
+        mem = memory->data();
+        stack = caller.stack.slots();
+        sp = caller.saved_sp;
+        gas = caller.saved_gas + left;
+        returned = &caller.return_data;
+        BIND_CODE()
+        ip = caller.resume;
+        *sp++ = !ok ? word(0) : caller.creating ? address_word(caller.created) : word(1);
+        status = InterpreterStatus::Success;
+        out_offset = 0;
+        out_size = 0;
+        DISPATCH();
+    }
+
+#undef BIND_CODE
+#undef NEXT
+#undef DISPATCH
+#undef OP
+#undef CHARGE
+#undef FAIL
+#if QUIDS_EVM_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
+    operand_stack.set_size(static_cast<size_t>(sp - stack));
+    result.status = status;
+    if (status == InterpreterStatus::Success || status == InterpreterStatus::Revert) {
+        result.gas_left = static_cast<uint64_t>(gas);
+        result.output.assign(mem + out_offset, mem + out_offset + out_size);
+    } else {
+        result.logs.clear();
+    }
+    if (status == InterpreterStatus::Revert) {
+        result.logs.clear();
+    }
+    if (status != InterpreterStatus::Success) {
+        if (entry_ctx.storage) entry_ctx.storage->revert(storage_snapshot);
+        if (entry_ctx.host) entry_ctx.host->revert(host_checkpoint);
+    }
+    return result;
+}
+
+// Runs code on the loop for the fork it was analysed for
+InterpreterResult dispatch_fork(const AnalyzedCode& code, const ExecutionContext& ctx, uint64_t gas_limit,
+                                ::evm::Stack& operand_stack, ::evm::Memory& memory, CallArena* arena) {
+    switch (code.fork) {
+        case Fork::Berlin: return run<Fork::Berlin>(code, ctx, gas_limit, operand_stack, memory, arena);
+        case Fork::London: return run<Fork::London>(code, ctx, gas_limit, operand_stack, memory, arena);
+        case Fork::Shanghai: break;
+    }
+    return run<Fork::Shanghai>(code, ctx, gas_limit, operand_stack, memory, arena);
+}
+
+} // namespace
+
+InterpreterResult interpret(const AnalyzedCode& code, const ExecutionContext& ctx, uint64_t gas_limit,
+                            ::evm::Stack& operand_stack, ::evm::Memory& memory) {
+    return dispatch_fork(code, ctx, gas_limit, operand_stack, memory, nullptr);
+}
+
+InterpreterResult interpret(const AnalyzedCode& code, const ExecutionContext& ctx, uint64_t gas_limit,
+                            CallArena& arena) {
+    CallArena::Slot& root = arena.slot(0);
+    return dispatch_fork(code, ctx, gas_limit, root.stack, root.memory, &arena);
+}
+
+InterpreterResult interpret(const AnalyzedCode& code, const ExecutionContext& ctx, uint64_t gas_limit) {
+    ArenaLease lease;
+    return interpret(code, ctx, gas_limit, *lease);
+}
+
+::evm::Address contract_address(const ::evm::Address& sender, uint64_t nonce) {
+    return create_address(sender, nonce);
+}
+
+} // namespace evm
+} // namespace quids
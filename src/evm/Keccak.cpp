@@ -0,0 +1,50 @@
+#include "evm/Keccak.hpp"
+#include "crypto/falcon/sha3/keccak.hpp"
+#include <cstring>
+
+namespace quids {
+namespace evm {
+
+namespace {
+
+constexpr size_t RATE = 136;  // bytes, for a 256-bit capacity
+
+void absorb_block(uint64_t* state, const uint8_t* block) {
+    for (size_t i = 0; i < RATE / 8; ++i) {
+        uint64_t lane = 0;
+        for (size_t b = 0; b < 8; ++b) {
+            lane |= static_cast<uint64_t>(block[i * 8 + b]) << (8 * b);
+        }
+        state[i] ^= lane;
+    }
+    keccak::permute(state);
+}
+
+} // namespace
+
+Hash256 keccak256(const uint8_t* data, size_t size) {
+    uint64_t state[25] = {};
+
+    while (size >= RATE) {
+        absorb_block(state, data);
+        data += RATE;
+        size -= RATE;
+    }
+
+    uint8_t last[RATE] = {};
+    if (size > 0) {
+        std::memcpy(last, data, size);
+    }
+    last[size] ^= 0x01;
+    last[RATE - 1] ^= 0x80;
+    absorb_block(state, last);
+
+    Hash256 out;
+    for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = static_cast<uint8_t>(state[i / 8] >> (8 * (i % 8)));
+    }
+    return out;
+}
+
+} // namespace evm
+} // namespace quids
@@ -3,102 +3,166 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <cstring>
+#include <new>
 #include <vector>
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
 namespace evm {
 
-class Memory::Impl {
-public:
-    Impl() = default;
-    ~Impl() = default;
-    
-    void store(uint64_t offset, const std::vector<uint8_t>& data) {
-        ensureSize(offset + data.size());
-        std::copy(data.begin(), data.end(), memory_.begin() + offset);
-    }
-    
-    std::vector<uint8_t> load(uint64_t offset, size_t size) const {
-        if (offset + size > memory_.size()) {
-            throw std::out_of_range("Memory access out of bounds");
-        }
-        return std::vector<uint8_t>(memory_.begin() + offset, 
-                                  memory_.begin() + offset + size);
-    }
-    
-private:
-    std::vector<uint8_t> memory_;
-    
-    void ensureSize(size_t required_size) {
-        if (required_size > memory_.size()) {
-            memory_.resize(required_size);
-        }
-    }
-};
+namespace {
+
+// Pages are committed in runs of this many bytes to keep syscalls rare
+constexpr size_t COMMIT_GRANULE = 16 * Memory::PAGE_SIZE;
+
+uint8_t* reserve_range(size_t bytes) {
+#if defined(_WIN32)
+    void* p = ::VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+    if (!p) throw std::bad_alloc();
+#else
+    void* p = ::mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+#endif
+    return static_cast<uint8_t*>(p);
+}
+
+void release_range(uint8_t* base, size_t bytes) {
+#if defined(_WIN32)
+    (void)bytes;
+    ::VirtualFree(base, 0, MEM_RELEASE);
+#else
+    ::munmap(base, bytes);
+#endif
+}
+
+void commit_range(uint8_t* p, size_t bytes) {
+#if defined(_WIN32)
+    if (!::VirtualAlloc(p, bytes, MEM_COMMIT, PAGE_READWRITE)) throw std::bad_alloc();
+#else
+    if (::mprotect(p, bytes, PROT_READ | PROT_WRITE) != 0) throw std::bad_alloc();
+#endif
+}
+
+// Hands the pages back to the system; they read as zero if committed again
+void decommit_range(uint8_t* p, size_t bytes) {
+#if defined(_WIN32)
+    ::VirtualFree(p, bytes, MEM_DECOMMIT);
+#else
+    ::madvise(p, bytes, MADV_DONTNEED);
+    ::mprotect(p, bytes, PROT_NONE);
+#endif
+}
+
+} // namespace
+
+Memory::Memory() : base_(reserve_range(MAX_SIZE)) {}
+
+Memory::~Memory() {
+    release_range(base_, MAX_SIZE);
+}
 
 // Memory implementation
 void Memory::store(size_t offset, uint8_t value) {
     ensure_capacity(offset, 1);
-    data_[offset] = value;
+    base_[offset] = value;
 }
 
 void Memory::store(size_t offset, const std::vector<uint8_t>& data) {
+    store(offset, std::span<const uint8_t>(data));
+}
+
+void Memory::store(size_t offset, std::span<const uint8_t> data) {
     if (data.empty()) return;
     ensure_capacity(offset, data.size());
-    std::copy(data.begin(), data.end(), data_.begin() + offset);
+    std::memcpy(base_ + offset, data.data(), data.size());
+}
+
+void Memory::store_word(size_t offset, const uint256_t& value) {
+    ensure_capacity(offset, 32);
+    value.store_be(base_ + offset);
 }
 
 uint8_t Memory::load(size_t offset) const {
-    if (offset >= data_.size()) {
+    if (offset >= size_) {
         throw std::out_of_range("Memory access out of bounds");
     }
-    return data_[offset];
+    return base_[offset];
 }
 
 std::vector<uint8_t> Memory::load(size_t offset, size_t size) const {
     std::vector<uint8_t> result(size, 0);
-    if (offset >= data_.size()) return result;
-    
-    size_t copy_size = std::min(size, data_.size() - offset);
-    std::copy(data_.begin() + offset, data_.begin() + offset + copy_size, result.begin());
+    if (offset >= size_) return result;
+
+    size_t copy_size = std::min(size, size_ - offset);
+    std::memcpy(result.data(), base_ + offset, copy_size);
     return result;
 }
 
+uint256_t Memory::load_word(size_t offset) const {
+    if (offset > size_ || size_ - offset < 32) {
+        throw std::out_of_range("Memory access out of bounds");
+    }
+    return uint256_t::load_be(base_ + offset);
+}
+
+std::span<uint8_t> Memory::view(size_t offset, size_t size) {
+    if (size == 0) return {};
+    if (offset > size_ || size_ - offset < size) {
+        throw std::out_of_range("Memory view out of bounds");
+    }
+    return {base_ + offset, size};
+}
+
+std::span<const uint8_t> Memory::view(size_t offset, size_t size) const {
+    if (size == 0) return {};
+    if (offset > size_ || size_ - offset < size) {
+        throw std::out_of_range("Memory view out of bounds");
+    }
+    return {base_ + offset, size};
+}
+
 uint64_t Memory::expand(size_t new_size) {
-    if (new_size <= data_.size()) {
+    if (new_size <= size_) {
         return 0;
     }
-    
-    uint64_t cost = calculate_expansion_cost(0, new_size);
-    data_.resize(new_size, 0);
+    if (new_size > MAX_SIZE) {
+        throw std::length_error("Memory size limit exceeded");
+    }
+
+    const uint64_t words = calculate_words(new_size);
+    const uint64_t new_cost = cost_of_words(words);
+    const uint64_t cost = new_cost - cost_;
+
+    commit(words * 32);
+    size_ = words * 32;
+    cost_ = new_cost;
     return cost;
 }
 
 uint64_t Memory::calculate_expansion_cost(size_t offset, size_t size) const {
     if (size == 0) return 0;
-    
+
     size_t required_size = offset + size;
-    if (required_size <= data_.size()) {
+    if (required_size <= size_) {
         return 0;
     }
-    
-    // Calculate words needed
-    uint64_t words = calculate_words(required_size);
-    uint64_t current_words = calculate_words(data_.size());
-    
-    // Gas formula from Yellow Paper
-    uint64_t linear_cost = words * 3;
-    uint64_t quadratic_cost = (words * words) / 512 - (current_words * current_words) / 512;
-    
-    return linear_cost + quadratic_cost;
+
+    // Gas formula from Yellow Paper, less what the current size already paid
+    return cost_of_words(calculate_words(required_size)) - cost_;
 }
 
 bool Memory::is_zero(size_t offset, size_t size) const {
-    if (offset + size > data_.size()) {
+    if (offset + size > size_) {
         throw std::out_of_range("Memory range check out of bounds");
     }
     
     for (size_t i = 0; i < size; i++) {
-        if (data_[offset + i] != 0) {
+        if (base_[offset + i] != 0) {
             return false;
         }
     }
@@ -106,11 +170,11 @@ bool Memory::is_zero(size_t offset, size_t size) const {
 }
 
 std::string Memory::dump() const {
-    return dump(0, data_.size());
+    return dump(0, size_);
 }
 
 std::string Memory::dump(size_t offset, size_t size) const {
-    if (offset + size > data_.size()) {
+    if (offset + size > size_) {
         throw std::out_of_range("Memory dump range out of bounds");
     }
     
@@ -121,7 +185,7 @@ std::string Memory::dump(size_t offset, size_t size) const {
         if (i > 0 && i % 32 == 0) {
             ss << "\n";
         }
-        ss << std::setw(2) << static_cast<int>(data_[offset + i]) << " ";
+        ss << std::setw(2) << static_cast<int>(base_[offset + i]) << " ";
     }
     
     return ss.str();
@@ -129,21 +193,37 @@ std::string Memory::dump(size_t offset, size_t size) const {
 
 void Memory::ensure_capacity(size_t offset, size_t size) {
     size_t required_size = offset + size;
-    if (required_size > data_.size()) {
+    if (required_size > size_) {
         [[maybe_unused]] uint64_t gas_cost = expand(required_size);
         // Gas cost can be used for gas metering if needed
     }
 }
 
-uint64_t Memory::calculate_words(size_t size) const {
+void Memory::commit(size_t bytes) {
+    if (bytes <= committed_) return;
+    const size_t target = std::min(MAX_SIZE, (bytes + COMMIT_GRANULE - 1) / COMMIT_GRANULE * COMMIT_GRANULE);
+    commit_range(base_ + committed_, target - committed_);
+    committed_ = target;
+}
+
+uint64_t Memory::calculate_words(size_t size) {
     return (size + 31) / 32;
 }
 
-void Memory::clear() {
-    data_.clear();
+uint64_t Memory::cost_of_words(uint64_t words) {
+    return words * 3 + (words * words) / 512;
 }
 
-Memory::Memory() = default;
-Memory::~Memory() = default;
+void Memory::clear() {
+    // Restore the all-zero invariant past size_, giving back whatever a
+    // large frame committed beyond the retained pages
+    if (committed_ > RETAINED_SIZE) {
+        decommit_range(base_ + RETAINED_SIZE, committed_ - RETAINED_SIZE);
+        committed_ = RETAINED_SIZE;
+    }
+    std::memset(base_, 0, std::min(size_, committed_));
+    size_ = 0;
+    cost_ = 0;
+}
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
@@ -0,0 +1,210 @@
+#include "evm/Precompiles.hpp"
+#include "crypto/blake3/Blake3Hash.hpp"
+#include <cstring>
+
+namespace quids {
+namespace evm {
+
+namespace {
+
+uint64_t words(size_t bytes) {
+    return (bytes + 31) / 32;
+}
+
+void put_u32(std::vector<uint8_t>& out, size_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(v >> shift));
+    }
+}
+
+// Walks an input front to back; every read fails once it runs short
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> input) : rest_(input) {}
+
+    bool u8(uint8_t& v) {
+        if (rest_.empty()) return false;
+        v = rest_[0];
+        rest_ = rest_.subspan(1);
+        return true;
+    }
+
+    bool u32(uint32_t& v) {
+        if (rest_.size() < 4) return false;
+        v = (uint32_t{rest_[0]} << 24) | (uint32_t{rest_[1]} << 16) | (uint32_t{rest_[2]} << 8) | rest_[3];
+        rest_ = rest_.subspan(4);
+        return true;
+    }
+
+    bool bytes(size_t n, std::span<const uint8_t>& out) {
+        if (rest_.size() < n) return false;
+        out = rest_.first(n);
+        rest_ = rest_.subspan(n);
+        return true;
+    }
+
+    std::span<const uint8_t> rest() const { return rest_; }
+
+private:
+    std::span<const uint8_t> rest_;
+};
+
+PrecompileResult charged(uint64_t gas_used, std::vector<uint8_t> output) {
+    PrecompileResult result;
+    result.success = true;
+    result.gas_used = gas_used;
+    result.output = std::move(output);
+    return result;
+}
+
+std::vector<uint8_t> bool_word(bool value) {
+    std::vector<uint8_t> out(32, 0);
+    out[31] = value ? 1 : 0;
+    return out;
+}
+
+} // namespace
+
+Precompiles::Precompiles(PrecompileGas gas) : gas_(gas) {}
+
+::evm::Address Precompiles::address(uint16_t id) {
+    ::evm::Address a{};
+    a.bytes.fill(0);
+    a.bytes[18] = static_cast<uint8_t>(id >> 8);
+    a.bytes[19] = static_cast<uint8_t>(id);
+    return a;
+}
+
+bool Precompiles::contains(const ::evm::Address& address) {
+    for (size_t i = 0; i < 18; ++i) {
+        if (address.bytes[i] != 0) return false;
+    }
+    const uint16_t id = static_cast<uint16_t>((address.bytes[18] << 8) | address.bytes[19]);
+    return id >= FIRST && id <= LAST;
+}
+
+std::optional<PrecompileResult> Precompiles::run(const ::evm::Address& address, const uint8_t* input,
+                                                 size_t size, uint64_t gas) const {
+    if (!contains(address)) {
+        return std::nullopt;
+    }
+    const std::span<const uint8_t> data(input, size);
+    switch ((address.bytes[18] << 8) | address.bytes[19]) {
+        case BLAKE3: return blake3(data, gas);
+        case FALCON512_VERIFY: return verify(crypto::SignatureScheme::Falcon512, data, gas);
+        case DILITHIUM_VERIFY: return verify(crypto::SignatureScheme::Dilithium, data, gas);
+        case BATCH_VERIFY: return batch_verify(data, gas);
+    }
+    return std::nullopt;
+}
+
+uint64_t Precompiles::verify_gas(crypto::SignatureScheme scheme, size_t message_size) const {
+    uint64_t base = 0;
+    switch (scheme) {
+        case crypto::SignatureScheme::Falcon512: base = gas_.falcon512_verify; break;
+        case crypto::SignatureScheme::Falcon1024: base = gas_.falcon1024_verify; break;
+        case crypto::SignatureScheme::Dilithium: base = gas_.dilithium_verify; break;
+        case crypto::SignatureScheme::SphincsPlus: base = gas_.sphincs_verify; break;
+    }
+    return base + gas_.message_word * words(message_size);
+}
+
+PrecompileResult Precompiles::blake3(std::span<const uint8_t> input, uint64_t gas) const {
+    const uint64_t cost = gas_.blake3_base + gas_.blake3_word * words(input.size());
+    if (cost > gas) {
+        return {};
+    }
+    crypto::Blake3Hash hasher;
+    hasher.update(input.data(), input.size());
+    return charged(cost, hasher.finalize());
+}
+
+PrecompileResult Precompiles::verify(crypto::SignatureScheme scheme, std::span<const uint8_t> input,
+                                     uint64_t gas) const {
+    Reader reader(input);
+    uint32_t key_len, sig_len;
+    crypto::VerifyItem item{scheme, {}, {}, {}};
+    if (!reader.u32(key_len) || !reader.u32(sig_len) ||
+        !reader.bytes(key_len, item.public_key) || !reader.bytes(sig_len, item.signature)) {
+        return {};
+    }
+    item.message = reader.rest();
+    const uint64_t cost = verify_gas(scheme, item.message.size());
+    auto& verifier = crypto::BatchVerifier::global();
+    if (cost > gas || !verifier.has_scheme(scheme)) {
+        return {};
+    }
+    const auto valid = verifier.verify(std::span<const crypto::VerifyItem>(&item, 1));
+    return charged(cost, bool_word(valid[0] != 0));
+}
+
+PrecompileResult Precompiles::batch_verify(std::span<const uint8_t> input, uint64_t gas) const {
+    Reader reader(input);
+    uint32_t count;
+    // Every item takes at least 13 bytes, which bounds count before reserving
+    if (!reader.u32(count) || count > reader.rest().size() / 13) {
+        return {};
+    }
+    std::vector<crypto::VerifyItem> items;
+    items.reserve(count);
+    uint64_t cost = gas_.batch_base;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t scheme;
+        uint32_t key_len, sig_len, msg_len;
+        crypto::VerifyItem item{};
+        if (!reader.u8(scheme) || scheme >= crypto::NUM_SIGNATURE_SCHEMES ||
+            !reader.u32(key_len) || !reader.u32(sig_len) || !reader.u32(msg_len) ||
+            !reader.bytes(key_len, item.public_key) || !reader.bytes(sig_len, item.signature) ||
+            !reader.bytes(msg_len, item.message)) {
+            return {};
+        }
+        item.scheme = static_cast<crypto::SignatureScheme>(scheme);
+        cost += verify_gas(item.scheme, msg_len);
+        // Priced before anything is verified, so an underfunded batch costs no work
+        if (cost > gas) {
+            return {};
+        }
+        items.push_back(item);
+    }
+    if (!reader.rest().empty()) {
+        return {};
+    }
+
+    const auto valid = crypto::BatchVerifier::global().verify(items);
+    std::vector<uint8_t> out(32 * items.size(), 0);
+    for (size_t i = 0; i < valid.size(); ++i) {
+        out[32 * i + 31] = valid[i] != 0 ? 1 : 0;
+    }
+    return charged(cost, std::move(out));
+}
+
+std::vector<uint8_t> Precompiles::encode_verify(std::span<const uint8_t> public_key,
+                                                std::span<const uint8_t> signature,
+                                                std::span<const uint8_t> message) {
+    std::vector<uint8_t> out;
+    out.reserve(8 + public_key.size() + signature.size() + message.size());
+    put_u32(out, public_key.size());
+    put_u32(out, signature.size());
+    out.insert(out.end(), public_key.begin(), public_key.end());
+    out.insert(out.end(), signature.begin(), signature.end());
+    out.insert(out.end(), message.begin(), message.end());
+    return out;
+}
+
+std::vector<uint8_t> Precompiles::encode_batch(std::span<const crypto::VerifyItem> items) {
+    std::vector<uint8_t> out;
+    put_u32(out, items.size());
+    for (const auto& item : items) {
+        out.push_back(static_cast<uint8_t>(item.scheme));
+        put_u32(out, item.public_key.size());
+        put_u32(out, item.signature.size());
+        put_u32(out, item.message.size());
+        out.insert(out.end(), item.public_key.begin(), item.public_key.end());
+        out.insert(out.end(), item.signature.begin(), item.signature.end());
+        out.insert(out.end(), item.message.begin(), item.message.end());
+    }
+    return out;
+}
+
+} // namespace evm
+} // namespace quids
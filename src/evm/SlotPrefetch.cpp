@@ -0,0 +1,174 @@
+#include "evm/SlotPrefetch.hpp"
+#include "evm/Keccak.hpp"
+
+#include <algorithm>
+
+namespace quids {
+namespace evm {
+
+namespace {
+
+// How far back from a SHA3 a pushed base slot is looked for; solc keeps
+// the key and slot stores within a handful of instructions of the hash
+constexpr size_t MAPPING_LOOKBACK = 12;
+// Larger constants are offsets, selectors or masks, not declared slots
+const ::evm::uint256_t MAX_BASE_SLOT(256);
+
+bool starts_block(uint8_t op) {
+    return op == H_JUMPDEST || op == H_BEGIN_BLOCK;
+}
+
+void add_unique(std::vector<::evm::uint256_t>& values, const ::evm::uint256_t& value) {
+    if (std::find(values.begin(), values.end(), value) == values.end()) {
+        values.push_back(value);
+    }
+}
+
+::evm::uint256_t mapping_slot(const ::evm::uint256_t& key, const ::evm::uint256_t& base) {
+    uint8_t buf[64];
+    key.store_be(buf);
+    base.store_be(buf + 32);
+    const Hash256 h = keccak256(buf, sizeof(buf));
+    return ::evm::uint256_t::load_be(h.data());
+}
+
+} // namespace
+
+SlotPredictor::SlotPredictor(Config config) : config_(config) {}
+
+SlotPredictor::CodeHints SlotPredictor::analyze(const AnalyzedCode& code) {
+    CodeHints hints;
+    const auto& ins = code.instructions;
+    for (size_t i = 0; i + 1 < ins.size(); ++i) {
+        if (ins[i].op == H_PUSH && (ins[i + 1].op == H_SLOAD || ins[i + 1].op == H_SSTORE)) {
+            add_unique(hints.constant_slots, code.push_values[ins[i].arg]);
+        }
+        if (ins[i].op != H_SHA3) {
+            continue;
+        }
+        for (size_t back = 1; back <= MAPPING_LOOKBACK && back <= i; ++back) {
+            const Instruction& prior = ins[i - back];
+            if (starts_block(prior.op)) {
+                break;
+            }
+            if (prior.op != H_PUSH) {
+                continue;
+            }
+            const ::evm::uint256_t& value = code.push_values[prior.arg];
+            // 0x20 and 0x40 are the scratch offsets and length of the hash
+            if (value < MAX_BASE_SLOT && value != ::evm::uint256_t(0x20) && value != ::evm::uint256_t(0x40)) {
+                add_unique(hints.mapping_bases, value);
+            }
+        }
+    }
+    return hints;
+}
+
+std::shared_ptr<const SlotPredictor::CodeHints> SlotPredictor::hints_for(const AnalyzedCode& code) {
+    // Called with mutex_ held
+    const auto it = hints_.find(code.code_hash);
+    if (it != hints_.end()) {
+        return it->second;
+    }
+    auto hints = std::make_shared<const CodeHints>(analyze(code));
+    hints_.emplace(code.code_hash, hints);
+    hints_order_.push_back(code.code_hash);
+    if (hints_order_.size() > config_.max_contracts) {
+        hints_.erase(hints_order_.front());
+        hints_order_.pop_front();
+    }
+    return hints;
+}
+
+std::vector<::evm::StorageKey> SlotPredictor::predict(const AnalyzedCode& code,
+                                                      const ::evm::Address& contract,
+                                                      std::span<const uint8_t> input,
+                                                      const ::evm::uint256_t& caller) {
+    std::vector<::evm::uint256_t> slots;
+    std::shared_ptr<const CodeHints> hints;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hints = hints_for(code);
+        // History first: it is what calls really touched
+        if (const auto it = history_.find(contract); it != history_.end()) {
+            for (const SlotCount& entry : it->second) {
+                slots.push_back(entry.slot);
+            }
+        }
+    }
+    for (const auto& slot : hints->constant_slots) {
+        add_unique(slots, slot);
+    }
+
+    // Mapping keys: the caller, then whole 32-byte arguments after the selector
+    std::vector<::evm::uint256_t> keys;
+    if (!caller.is_zero()) {
+        keys.push_back(caller);
+    }
+    for (size_t offset = 4; offset + 32 <= input.size() && keys.size() < config_.max_key_words + 1; offset += 32) {
+        keys.push_back(::evm::uint256_t::load_be(input.data() + offset));
+    }
+    const size_t bases = std::min(hints->mapping_bases.size(), config_.max_mapping_bases);
+    for (size_t b = 0; b < bases; ++b) {
+        for (const auto& key : keys) {
+            add_unique(slots, mapping_slot(key, hints->mapping_bases[b]));
+        }
+    }
+
+    if (slots.size() > config_.max_predictions) {
+        slots.resize(config_.max_predictions);
+    }
+    std::vector<::evm::StorageKey> predicted;
+    predicted.reserve(slots.size());
+    for (const auto& slot : slots) {
+        predicted.push_back(::evm::StorageKey{contract, slot});
+    }
+    return predicted;
+}
+
+void SlotPredictor::record(const ::evm::Address& contract, const ::evm::StorageAccessSet& accessed) {
+    if (accessed.reads.empty() && accessed.writes.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (history_.size() >= config_.max_contracts && !history_.contains(contract)) {
+        history_.erase(history_.begin());
+    }
+    auto& counts = history_[contract];
+    auto bump = [&](const ::evm::StorageKey& key) {
+        if (key.address != contract) {
+            return;
+        }
+        const auto it = std::find_if(counts.begin(), counts.end(),
+                                     [&](const SlotCount& entry) { return entry.slot == key.slot; });
+        if (it != counts.end()) {
+            it->count++;
+        } else {
+            // In front, so among equal counts the newest sort first
+            counts.insert(counts.begin(), SlotCount{key.slot, 1});
+        }
+    };
+    for (const auto& key : accessed.reads) bump(key);
+    for (const auto& key : accessed.writes) bump(key);
+
+    std::stable_sort(counts.begin(), counts.end(),
+                     [](const SlotCount& a, const SlotCount& b) { return a.count > b.count; });
+    if (counts.size() > config_.history_slots) {
+        // Over budget: age everything, so slots that stopped being used
+        // make way for new ones instead of holding on by old counts
+        counts.resize(config_.history_slots);
+        for (SlotCount& entry : counts) {
+            entry.count = (entry.count + 1) / 2;
+        }
+    }
+}
+
+void SlotPredictor::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hints_.clear();
+    hints_order_.clear();
+    history_.clear();
+}
+
+} // namespace evm
+} // namespace quids
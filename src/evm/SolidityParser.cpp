@@ -1,184 +1,238 @@
 #include "evm/SolidityParser.hpp"
+#include "evm/Keccak.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <deque>
+#include <mutex>
 #include <sstream>
-#include <regex>
-#include <cctype>
+#include <unordered_map>
 
 namespace evm {
 
     namespace {
-        const std::vector<std::string> KEYWORDS = {
-                "contract", "function", "public", "private", "internal", "external",
-                "pure", "view", "payable", "returns", "memory", "storage", "calldata",
-                "uint", "int", "address", "bool", "string", "bytes", "mapping",
-                "struct", "enum", "if", "else", "while", "for", "do", "break",
-                "continue", "return"
+        // Sorted, for binary search
+        constexpr std::array<std::string_view, 30> KEYWORDS = {
+                "address", "bool", "break", "bytes", "calldata", "continue",
+                "contract", "do", "else", "enum", "external", "for", "function",
+                "if", "int", "internal", "mapping", "memory", "payable", "private",
+                "public", "pure", "return", "returns", "storage", "string",
+                "struct", "uint", "view", "while"
         };
+        static_assert(std::is_sorted(KEYWORDS.begin(), KEYWORDS.end()));
 
-        bool is_keyword(const std::string &str) {
-            return std::find(KEYWORDS.begin(), KEYWORDS.end(), str) != KEYWORDS.end();
+        bool is_keyword(std::string_view str) {
+            return std::binary_search(KEYWORDS.begin(), KEYWORDS.end(), str);
         }
 
-        bool is_number_literal(const std::string &str) {
-            return std::regex_match(str, std::regex("^[0-9]+$"));
+        // Character classes
+        enum : uint8_t {
+            SPACE = 1 << 0,
+            DIGIT = 1 << 1,
+            WORD = 1 << 2,   // letters, digits and '_'
+            PUNCT = 1 << 3
+        };
+
+        constexpr std::array<uint8_t, 256> make_classes() {
+            std::array<uint8_t, 256> classes{};
+            for (const char c : std::string_view(" \t\n\v\f\r")) classes[static_cast<uint8_t>(c)] |= SPACE;
+            for (char c = '0'; c <= '9'; ++c) classes[static_cast<uint8_t>(c)] |= DIGIT | WORD;
+            for (char c = 'a'; c <= 'z'; ++c) classes[static_cast<uint8_t>(c)] |= WORD;
+            for (char c = 'A'; c <= 'Z'; ++c) classes[static_cast<uint8_t>(c)] |= WORD;
+            classes[static_cast<uint8_t>('_')] |= WORD;
+            for (const char c : std::string_view("(){}[];,")) classes[static_cast<uint8_t>(c)] |= PUNCT;
+            return classes;
+        }
+
+        constexpr std::array<uint8_t, 256> CLASSES = make_classes();
+
+        bool has(char c, uint8_t cls) {
+            return (CLASSES[static_cast<uint8_t>(c)] & cls) != 0;
+        }
+
+        Token::Type classify_word(std::string_view word) {
+            if (is_keyword(word)) {
+                return Token::Type::KEYWORD;
+            }
+            if (std::all_of(word.begin(), word.end(), [](char c) { return has(c, DIGIT); })) {
+                return Token::Type::NUMBER;
+            }
+            return has(word.front(), DIGIT) ? Token::Type::UNKNOWN : Token::Type::IDENTIFIER;
+        }
+
+        // Parse results by source hash. Results are immutable once made, so
+        // a hit hands out a copy without holding the lock for long.
+        class ParseCache {
+        public:
+            static constexpr size_t CAPACITY = 256;
+
+            std::shared_ptr<const SolidityParser::ParseResult> find(const quids::evm::Hash256& key) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                const auto it = entries_.find(key);
+                return it == entries_.end() ? nullptr : it->second;
+            }
+
+            void insert(const quids::evm::Hash256& key, std::shared_ptr<const SolidityParser::ParseResult> result) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!entries_.emplace(key, std::move(result)).second) {
+                    return;
+                }
+                order_.push_back(key);
+                if (order_.size() > CAPACITY) {
+                    entries_.erase(order_.front());
+                    order_.pop_front();
+                }
+            }
+
+            void clear() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                entries_.clear();
+                order_.clear();
+            }
+
+        private:
+            struct KeyHash {
+                size_t operator()(const quids::evm::Hash256& h) const noexcept {
+                    size_t v = 0;
+                    for (size_t i = 0; i < sizeof(v); ++i) v = (v << 8) | h[i];
+                    return v;
+                }
+            };
+
+            std::mutex mutex_;
+            std::unordered_map<quids::evm::Hash256, std::shared_ptr<const SolidityParser::ParseResult>, KeyHash> entries_;
+            std::deque<quids::evm::Hash256> order_;  // oldest first
+        };
+
+        ParseCache& parse_cache() {
+            static ParseCache cache;
+            return cache;
         }
 
-        bool is_identifier(const std::string &str) {
-            static const std::regex identifier_regex("^[a-zA-Z_][a-zA-Z0-9_]*$");
-            return std::regex_match(str, identifier_regex) && !is_keyword(str);
+        // The size after a type name such as uint256, nullopt when not a number
+        std::optional<uint16_t> parse_bits(std::string_view digits) {
+            uint16_t bits = 0;
+            const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), bits);
+            if (ec != std::errc{} || end != digits.data() + digits.size()) {
+                return std::nullopt;
+            }
+            return bits;
         }
     }
 
-    std::vector<evm::Token> SolidityParser::tokenize(const std::string &source) {
+    std::vector<evm::Token> SolidityParser::tokenize(std::string_view source) {
         std::vector<Token> tokens;
-        std::istringstream stream(source);
-        std::string current_token;
-        size_t line = 1, column = 1;
+        tokens.reserve(source.size() / 4 + 1);
+        size_t line = 1;
+        size_t line_start = 0;
+        size_t pos = 0;
 
-        auto add_token = [&](Token::Type type, const std::string &value) {
-            tokens.push_back({type, value, line, column});
-            column += value.length();
+        auto add_token = [&](Token::Type type, size_t start) {
+            tokens.push_back({type, source.substr(start, pos - start), line, start - line_start + 1});
+        };
+        // Counts the newlines in [from, pos) for tokens that span lines
+        auto advance_lines = [&](size_t from) {
+            for (size_t i = from; i < pos; ++i) {
+                if (source[i] == '\n') {
+                    line++;
+                    line_start = i + 1;
+                }
+            }
         };
 
-        char c;
-        while (stream.get(c)) {
-            if (std::isspace(c)) {
+        while (pos < source.size()) {
+            const size_t start = pos;
+            const char c = source[pos];
+
+            if (has(c, SPACE)) {
+                pos++;
                 if (c == '\n') {
                     line++;
-                    column = 1;
-                } else {
-                    column++;
-                }
-                if (!current_token.empty()) {
-                    if (is_keyword(current_token)) {
-                        add_token(Token::Type::KEYWORD, current_token);
-                    } else if (is_number_literal(current_token)) {
-                        add_token(Token::Type::NUMBER, current_token);
-                    } else if (is_identifier(current_token)) {
-                        add_token(Token::Type::IDENTIFIER, current_token);
-                    } else {
-                        add_token(Token::Type::UNKNOWN, current_token);
-                    }
-                    current_token.clear();
+                    line_start = pos;
                 }
                 continue;
             }
 
-            if (std::isalnum(c) || c == '_') {
-                current_token += c;
+            if (has(c, WORD)) {
+                while (pos < source.size() && has(source[pos], WORD)) pos++;
+                add_token(classify_word(source.substr(start, pos - start)), start);
                 continue;
             }
 
-            // Handle operators and punctuation
-            if (!current_token.empty()) {
-                if (is_keyword(current_token)) {
-                    add_token(Token::Type::KEYWORD, current_token);
-                } else if (is_number_literal(current_token)) {
-                    add_token(Token::Type::NUMBER, current_token);
-                } else if (is_identifier(current_token)) {
-                    add_token(Token::Type::IDENTIFIER, current_token);
-                } else {
-                    add_token(Token::Type::UNKNOWN, current_token);
-                }
-                current_token.clear();
-            }
-
-            std::string op;
-            op += c;
-
-            // Multi-character operators
-            if (c == '/' && stream.peek() == '/') {
-                // Single-line comment
-                std::string comment = "//";
-                while (stream.get(c) && c != '\n') {
-                    comment += c;
-                }
-                add_token(Token::Type::COMMENT, comment);
-                line++;
-                column = 1;
+            const char next = pos + 1 < source.size() ? source[pos + 1] : '\0';
+            if (c == '/' && next == '/') {
+                pos = std::min(source.find('\n', pos), source.size());
+                add_token(Token::Type::COMMENT, start);
                 continue;
             }
 
-            if (c == '/' && stream.peek() == '*') {
-                // Multi-line comment
-                std::string comment = "/*";
-                stream.get(c); // consume *
-                while (stream.get(c)) {
-                    comment += c;
-                    if (c == '*' && stream.peek() == '/') {
-                        stream.get(c); // consume /
-                        comment += c;
-                        break;
-                    }
-                    if (c == '\n') {
-                        line++;
-                        column = 1;
-                    }
-                }
-                add_token(Token::Type::COMMENT, comment);
+            if (c == '/' && next == '*') {
+                const size_t end = source.find("*/", pos + 2);
+                pos = end == std::string_view::npos ? source.size() : end + 2;
+                const size_t token_line = line;
+                const size_t token_line_start = line_start;
+                advance_lines(start);
+                tokens.push_back({Token::Type::COMMENT, source.substr(start, pos - start),
+                                  token_line, start - token_line_start + 1});
                 continue;
             }
 
-            // String literals
+            // String literals; an unterminated one runs to the end
             if (c == '"') {
-                std::string str = "\"";
-                while (stream.get(c)) {
-                    if (c == '\\') {
-                        str += c;
-                        if (stream.get(c))
-                            str += c;
-                    } else if (c == '"') {
-                        str += c;
-                        break;
-                    } else {
-                        str += c;
-                    }
+                pos++;
+                while (pos < source.size() && source[pos] != '"') {
+                    pos += source[pos] == '\\' ? 2 : 1;
                 }
-                add_token(Token::Type::STRING, str);
+                pos = std::min(pos + 1, source.size());
+                const size_t token_line = line;
+                const size_t token_line_start = line_start;
+                advance_lines(start);
+                tokens.push_back({Token::Type::STRING, source.substr(start, pos - start),
+                                  token_line, start - token_line_start + 1});
                 continue;
             }
 
             // Single-character tokens
-            if (std::string("(){}[];,").find(c) != std::string::npos) {
-                add_token(Token::Type::PUNCTUATION, op);
-            } else {
-                add_token(Token::Type::OPERATOR, op);
-            }
-        }
-
-        // Add any remaining token
-        if (!current_token.empty()) {
-            if (is_keyword(current_token)) {
-                add_token(Token::Type::KEYWORD, current_token);
-            } else if (is_number_literal(current_token)) {
-                add_token(Token::Type::NUMBER, current_token);
-            } else if (is_identifier(current_token)) {
-                add_token(Token::Type::IDENTIFIER, current_token);
-            } else {
-                add_token(Token::Type::UNKNOWN, current_token);
-            }
+            pos++;
+            add_token(has(c, PUNCT) ? Token::Type::PUNCTUATION : Token::Type::OPERATOR, start);
         }
 
-        add_token(Token::Type::END, "");
+        tokens.push_back({Token::Type::END, source.substr(source.size()), line, pos - line_start + 1});
         return tokens;
     }
 
     SolidityParser::ParseResult SolidityParser::parse(const std::string &source_code) {
+        const auto key = quids::evm::keccak256(reinterpret_cast<const uint8_t*>(source_code.data()), source_code.size());
+        if (auto cached = parse_cache().find(key)) {
+            return *cached;
+        }
+        auto result = std::make_shared<const ParseResult>(parse_uncached(std::make_shared<const std::string>(source_code)));
+        parse_cache().insert(key, result);
+        return *result;
+    }
+
+    void SolidityParser::clear_cache() {
+        parse_cache().clear();
+    }
+
+    SolidityParser::ParseResult SolidityParser::parse_uncached(std::shared_ptr<const std::string> source) {
         ParseResult result;
         result.success = false;
+        result.source = source;
 
         try {
-            auto tokens = tokenize(source_code);
+            auto tokens = tokenize(*source);
 
             // Implement a simple validation step
             for (const auto &token: tokens) {
                 if (token.type == Token::Type::UNKNOWN) {
-                    throw std::runtime_error("Unrecognized token: " + token.value);
+                    throw std::runtime_error("Unrecognized token: " + std::string(token.value));
                 }
             }
 
             // Mark parsing as successful
             result.success = true;
-            result.tokens = tokens;
+            result.tokens = std::move(tokens);
         } catch (const std::exception &e) {
             result.errors.push_back(e.what());
         }
@@ -186,21 +240,24 @@ namespace evm {
         return result;
     }
 
-    TypeInfo SolidityParser::resolve_type(const std::string &type_string) {
+    TypeInfo SolidityParser::resolve_type(std::string_view type_string) {
         TypeInfo info;
 
         // Handle arrays
         auto pos = type_string.find('[');
-        if (pos != std::string::npos) {
+        if (pos != std::string_view::npos) {
             info.is_array = true;
-            std::string base_type = type_string.substr(0, pos);
-            std::string array_spec = type_string.substr(pos);
+            const auto base_type = type_string.substr(0, pos);
+            const auto array_spec = type_string.substr(pos);
 
             // Parse array size if specified
             if (array_spec != "[]") {
-                try {
-                    info.array_size = std::stoul(array_spec.substr(1, array_spec.length() - 2));
-                } catch (...) {
+                size_t size = 0;
+                const auto digits = array_spec.substr(1, array_spec.length() - 2);
+                const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), size);
+                if (array_spec.back() == ']' && ec == std::errc{} && end == digits.data() + digits.size()) {
+                    info.array_size = size;
+                } else {
                     add_error("Invalid array size specification", 0, 0);
                 }
             }
@@ -213,14 +270,14 @@ namespace evm {
         }
 
         // Handle mappings
-        if (type_string.substr(0, 7) == "mapping") {
+        if (type_string.starts_with("mapping")) {
             info.is_mapping = true;
             auto key_start = type_string.find('(');
             auto key_end = type_string.find(',');
             auto value_end = type_string.find(')');
-            if (key_start != std::string::npos && key_end != std::string::npos && value_end != std::string::npos) {
-                std::string key_type = type_string.substr(key_start + 1, key_end - key_start - 1);
-                std::string value_type = type_string.substr(key_end + 1, value_end - key_end - 1);
+            if (key_start != std::string_view::npos && key_end != std::string_view::npos && value_end != std::string_view::npos) {
+                const auto key_type = type_string.substr(key_start + 1, key_end - key_start - 1);
+                const auto value_type = type_string.substr(key_end + 1, value_end - key_end - 1);
                 info.mapping_key_type = std::make_shared<TypeInfo>(resolve_type(key_type));
                 info.mapping_value_type = std::make_shared<TypeInfo>(resolve_type(value_type));
             } else {
@@ -230,27 +287,28 @@ namespace evm {
         }
 
         // Handle basic types
-        if (type_string.substr(0, 4) == "uint") {
-            info.base_type = DataType::UINT;
-            if (type_string.length() > 4) {
-                info.bits = std::stoul(type_string.substr(4));
-            }
-        } else if (type_string.substr(0, 3) == "int") {
-            info.base_type = DataType::INT;
-            if (type_string.length() > 3) {
-                info.bits = std::stoul(type_string.substr(3));
+        auto sized = [&](DataType type, std::string_view name, uint16_t scale) {
+            info.base_type = type;
+            if (type_string.length() > name.length()) {
+                if (const auto bits = parse_bits(type_string.substr(name.length()))) {
+                    info.bits = static_cast<uint16_t>(*bits * scale);
+                } else {
+                    add_error("Invalid size in type " + std::string(type_string), 0, 0);
+                }
             }
+        };
+        if (type_string.starts_with("uint")) {
+            sized(DataType::UINT, "uint", 1);
+        } else if (type_string.starts_with("int")) {
+            sized(DataType::INT, "int", 1);
         } else if (type_string == "address") {
             info.base_type = DataType::ADDRESS;
         } else if (type_string == "bool") {
             info.base_type = DataType::BOOL;
         } else if (type_string == "string") {
             info.base_type = DataType::STRING;
-        } else if (type_string.substr(0, 5) == "bytes") {
-            info.base_type = DataType::BYTES;
-            if (type_string.length() > 5) {
-                info.bits = std::stoul(type_string.substr(5)) * 8;
-            }
+        } else if (type_string.starts_with("bytes")) {
+            sized(DataType::BYTES, "bytes", 8);
         }
 
         return info;
@@ -268,4 +326,4 @@ namespace evm {
         warnings_.push_back(ss.str());
     }
 
-} // namespace evm
\ No newline at end of file
+} // namespace evm
@@ -1,63 +1,64 @@
 #include "evm/Stack.hpp"
 #include <stdexcept>
+#include <utility>
 
 namespace evm {
 
+Stack::Stack() : slots_(std::make_unique<Slots>()) {}
+
 void Stack::push(const uint256_t& value) {
-    if (items_.size() >= 1024) {
+    if (size_ >= LIMIT) {
         throw std::runtime_error("Stack overflow");
     }
-    items_.push_back(value);
+    slots_->items[size_++] = value;
 }
 
 uint256_t Stack::pop() {
-    if (items_.empty()) {
+    if (size_ == 0) {
         throw std::runtime_error("Stack underflow");
     }
-    uint256_t value = items_.back();
-    items_.pop_back();
-    return value;
+    return slots_->items[--size_];
 }
 
 uint256_t Stack::peek(size_t depth) const {
-    if (items_.size() <= depth) {
+    if (size_ <= depth) {
         throw std::runtime_error("Stack underflow");
     }
-    return items_[items_.size() - 1 - depth];
+    return slots_->items[size_ - 1 - depth];
 }
 
 void Stack::swap(size_t n) {
     if (n == 0 || n > 16) {
         throw std::invalid_argument("Invalid swap depth");
     }
-    if (items_.size() <= n) {
+    if (size_ <= n) {
         throw std::runtime_error("Stack underflow");
     }
     
-    std::swap(items_[items_.size() - 1], items_[items_.size() - 1 - n]);
+    std::swap(slots_->items[size_ - 1], slots_->items[size_ - 1 - n]);
 }
 
 void Stack::dup(size_t n) {
     if (n == 0 || n > 16) {
         throw std::invalid_argument("Invalid dup depth");
     }
-    if (items_.size() < n) {
+    if (size_ < n) {
         throw std::runtime_error("Stack underflow");
     }
     
-    push(items_[items_.size() - n]);
+    push(slots_->items[size_ - n]);
 }
 
 size_t Stack::size() const {
-    return items_.size();
+    return size_;
 }
 
 void Stack::clear() {
-    items_.clear();
+    size_ = 0;
 }
 
 bool Stack::empty() const {
-    return items_.empty();
+    return size_ == 0;
 }
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
@@ -1,48 +1,313 @@
 #include "evm/Storage.hpp"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace evm {
 
+namespace {
+
+uint64_t mix(uint64_t h) {
+    // splitmix64 finaliser; the table masks off the low bits
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+uint64_t address_bits(const Address& address) {
+    uint64_t a, b;
+    uint32_t c;
+    std::memcpy(&a, address.bytes.data(), 8);
+    std::memcpy(&b, address.bytes.data() + 8, 8);
+    std::memcpy(&c, address.bytes.data() + 16, 4);
+    return a ^ (b * 0x9e3779b97f4a7c15ULL) ^ (uint64_t{c} << 17);
+}
+
+bool key_less(const StorageKey& a, const StorageKey& b) {
+    if (a.address.bytes != b.address.bytes) return a.address.bytes < b.address.bytes;
+    return a.slot < b.slot;
+}
+
+} // namespace
+
+size_t StorageKeyHash::operator()(const StorageKey& key) const noexcept {
+    const auto& l = key.slot.limbs;
+    uint64_t h = address_bits(key.address);
+    h ^= mix(l[0] ^ (l[1] << 1) ^ (l[2] << 2) ^ (l[3] << 3));
+    return static_cast<size_t>(mix(h));
+}
+
+size_t AddressHash::operator()(const Address& address) const noexcept {
+    return static_cast<size_t>(mix(address_bits(address)));
+}
+
 void Storage::store(const Address& address, const uint256_t& key, const uint256_t& value) {
-    storage_[address][key] = value;
+    assign(StorageKey{address, key}, value);
 }
 
 uint256_t Storage::load(const Address& address, const uint256_t& key) const {
-    auto it = storage_.find(address);
-    if (it == storage_.end()) {
-        return uint256_t(0);
+    const StorageKey k{address, key};
+    if (const uint256_t* value = values_.find(k)) {
+        return *value;
     }
-    
-    auto value_it = it->second.find(key);
-    if (value_it == it->second.end()) {
-        return uint256_t(0);
+    if (backend_ && !resident_.contains(k)) {
+        fetch(k);
+        if (const uint256_t* value = values_.find(k)) {
+            return *value;
+        }
     }
-    
-    return value_it->second;
+    return uint256_t(0);
+}
+
+bool Storage::contains(const Address& address, const uint256_t& key) const {
+    return values_.contains(StorageKey{address, key});
 }
 
 void Storage::clear(const Address& address) {
-    storage_.erase(address);
+    values_.erase_if([&](const StorageKey& key, const uint256_t&) {
+        return key.address.bytes == address.bytes;
+    });
 }
 
-bool Storage::contains(const Address& address, const uint256_t& key) const {
-    auto it = storage_.find(address);
-    if (it == storage_.end()) {
-        return false;
+size_t Storage::size(const Address& address) const {
+    size_t count = 0;
+    values_.for_each([&](const StorageKey& key, const uint256_t&) {
+        if (key.address.bytes == address.bytes) ++count;
+    });
+    return count;
+}
+
+void Storage::clear() {
+    complete_pending();
+    values_.clear();
+    resident_.clear();
+    slots_.clear();
+    accounts_.clear();
+    journal_.clear();
+    accesses_.clear();
+    epoch_ = 1;
+    recording_ = false;
+    witness_.clear();
+    sealed_ = false;
+    covered_.clear();
+}
+
+void Storage::begin_transaction() {
+    journal_.clear();
+    accesses_.clear();
+    if (++epoch_ == 0) {
+        // Wrapped: old epochs could look current again
+        slots_.clear();
+        accounts_.clear();
+        epoch_ = 1;
     }
-    return it->second.find(key) != it->second.end();
 }
 
-size_t Storage::size(const Address& address) const {
-    auto it = storage_.find(address);
-    if (it == storage_.end()) {
+Storage::SlotState& Storage::touch(const StorageKey& key, bool& was_warm) {
+    SlotState& state = *slots_.try_emplace(key).first;
+    was_warm = state.epoch == epoch_;
+    if (!was_warm) {
+        if (sealed_ && !covered_.contains(key)) {
+            throw std::out_of_range("Slot is not in the storage witness");
+        }
+        state.epoch = epoch_;
+        state.original = load(key.address, key.slot);
+        if (recording_) {
+            auto [value, inserted] = witness_.try_emplace(key);
+            if (inserted) {
+                *value = state.original;
+            }
+        }
+        journal_.push_back(JournalEntry{JournalEntry::WarmSlot, key, uint256_t(0)});
+    }
+    return state;
+}
+
+void Storage::assign(const StorageKey& key, const uint256_t& value) {
+    if (backend_) {
+        resident_.insert_or_assign(key, 1);
+    }
+    if (value.is_zero()) {
+        values_.erase(key);
+    } else {
+        values_.insert_or_assign(key, value);
+    }
+}
+
+SlotRead Storage::load_for_access(const Address& address, const uint256_t& key) {
+    const StorageKey k{address, key};
+    bool warm;
+    touch(k, warm);
+    if (!warm) {
+        accesses_.push_back(Access{k, false});
+    }
+    return SlotRead{load(address, key), warm};
+}
+
+SlotWrite Storage::store_for_access(const Address& address, const uint256_t& key, const uint256_t& value) {
+    const StorageKey k{address, key};
+    bool warm;
+    SlotState& state = touch(k, warm);
+    const uint256_t original = state.original;
+    if (state.write_logged != epoch_) {
+        state.write_logged = epoch_;
+        accesses_.push_back(Access{k, true});
+    }
+    const uint256_t current = load(address, key);
+    if (current != value) {
+        journal_.push_back(JournalEntry{JournalEntry::Value, k, current});
+        assign(k, value);
+    }
+    return SlotWrite{original, current, warm};
+}
+
+bool Storage::warm_account(const Address& address) {
+    uint32_t& epoch = *accounts_.try_emplace(address).first;
+    if (epoch == epoch_) {
+        return true;
+    }
+    epoch = epoch_;
+    journal_.push_back(JournalEntry{JournalEntry::WarmAccount, StorageKey{address, uint256_t(0)}, uint256_t(0)});
+    return false;
+}
+
+void Storage::revert(Snapshot snapshot) {
+    while (journal_.size() > snapshot) {
+        const JournalEntry& entry = journal_.back();
+        switch (entry.kind) {
+            case JournalEntry::Value:
+                assign(entry.key, entry.previous);
+                break;
+            case JournalEntry::WarmSlot:
+                if (SlotState* state = slots_.find(entry.key)) state->epoch = 0;
+                break;
+            case JournalEntry::WarmAccount:
+                if (uint32_t* epoch = accounts_.find(entry.key.address)) *epoch = 0;
+                break;
+        }
+        journal_.pop_back();
+    }
+}
+
+void Storage::set_backend(std::shared_ptr<SlotBackend> backend) {
+    complete_pending();
+    backend_ = std::move(backend);
+    resident_.clear();
+}
+
+size_t Storage::prefetch(std::span<const StorageKey> keys) {
+    if (!backend_) {
+        return 0;
+    }
+    std::vector<StorageKey> wanted;
+    wanted.reserve(keys.size());
+    for (const StorageKey& key : keys) {
+        if (values_.contains(key) || resident_.contains(key) || !in_flight_.try_emplace(key).second) {
+            continue;
+        }
+        wanted.push_back(key);
+    }
+    if (wanted.empty()) {
         return 0;
     }
-    return it->second.size();
+    stats_.prefetched += wanted.size();
+    PendingFetch request;
+    request.keys = std::move(wanted);
+    // The keys live in the PendingFetch, which outlives the future
+    request.values = std::async(std::launch::async, [backend = backend_, keys = std::span<const StorageKey>(request.keys)] {
+        return backend->read(keys);
+    });
+    const size_t count = request.keys.size();
+    pending_.push_back(std::move(request));
+    return count;
 }
 
-void Storage::clear() {
-    storage_.clear();
+void Storage::fetch(const StorageKey& key) const {
+    if (in_flight_.contains(key)) {
+        stats_.prefetch_waits++;
+        complete_pending();
+        if (resident_.contains(key)) {
+            return;
+        }
+    }
+    stats_.backend_reads++;
+    const uint256_t value = backend_->read(std::span<const StorageKey>(&key, 1)).at(0);
+    resident_.insert_or_assign(key, 1);
+    if (!value.is_zero()) {
+        values_.insert_or_assign(key, value);
+    }
+}
+
+void Storage::complete_pending() const {
+    // Fetches usually come one batch per transaction, so they are drained
+    // together rather than tracked one by one
+    for (PendingFetch& fetch : pending_) {
+        std::vector<uint256_t> values;
+        try {
+            values = fetch.values.get();
+        } catch (const std::exception&) {
+            continue;  // left uncached; a load reads it again and sees the error
+        }
+        for (size_t i = 0; i < fetch.keys.size() && i < values.size(); ++i) {
+            const StorageKey& key = fetch.keys[i];
+            // A slot written since the fetch started keeps the write
+            if (!resident_.try_emplace(key).second) {
+                continue;
+            }
+            if (!values[i].is_zero()) {
+                values_.insert_or_assign(key, values[i]);
+            }
+        }
+    }
+    pending_.clear();
+    in_flight_.clear();
+}
+
+void Storage::begin_witness() {
+    recording_ = true;
+    witness_.clear();
+}
+
+SlotWitness Storage::take_witness() {
+    SlotWitness witness;
+    witness.slots.reserve(witness_.size());
+    witness_.for_each([&](const StorageKey& key, const uint256_t& value) {
+        witness.slots.emplace_back(key, value);
+    });
+    std::sort(witness.slots.begin(), witness.slots.end(),
+              [](const auto& a, const auto& b) { return key_less(a.first, b.first); });
+    recording_ = false;
+    witness_.clear();
+    return witness;
+}
+
+void Storage::load_witness(const SlotWitness& witness) {
+    clear();
+    for (const auto& [key, value] : witness.slots) {
+        assign(key, value);
+        covered_.insert_or_assign(key, 1);
+    }
+    sealed_ = true;
+}
+
+StorageAccessSet Storage::access_set() const {
+    StorageAccessSet set;
+    for (const Access& access : accesses_) {
+        (access.write ? set.writes : set.reads).push_back(access.key);
+    }
+    auto unique = [](std::vector<StorageKey>& keys) {
+        std::sort(keys.begin(), keys.end(), key_less);
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    };
+    unique(set.writes);
+    unique(set.reads);
+    set.reads.erase(std::remove_if(set.reads.begin(), set.reads.end(), [&](const StorageKey& key) {
+        return std::binary_search(set.writes.begin(), set.writes.end(), key, key_less);
+    }), set.reads.end());
+    return set;
 }
 
-} // namespace evm 
\ No newline at end of file
+} // namespace evm
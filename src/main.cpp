@@ -2,6 +2,7 @@
 #include "cli/commands/StartCommand.hpp"
 #include "cli/commands/StopCommand.hpp"
 #include "cli/commands/StatusCommand.hpp"
+#include "cli/commands/ReplayCommand.hpp"
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <iostream>
@@ -26,6 +27,7 @@ int main(int argc, char** argv) {
         cli.registerCommand(std::make_unique<cli::StartCommand>());
         cli.registerCommand(std::make_unique<cli::StopCommand>());
         cli.registerCommand(std::make_unique<cli::StatusCommand>());
+        cli.registerCommand(std::make_unique<cli::ReplayCommand>());
         
         // Run CLI
         return cli.run(argc, argv);
@@ -0,0 +1,155 @@
+#include "network/BufferRing.hpp"
+#include "memory/MemoryBudget.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace quids::network {
+
+namespace {
+
+constexpr size_t BUFFER_ALIGNMENT = 64;
+// Retries of a pop that found the free list empty while slots were free
+constexpr int POP_RETRIES = 8;
+
+size_t alignUp(size_t n) {
+    return (n + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1);
+}
+
+} // namespace
+
+BufferRing::BufferRing(std::vector<SizeClass> classes, const memory::Placement& placement) {
+    if (classes.empty()) {
+        throw std::invalid_argument("buffer ring needs at least one size class");
+    }
+    std::sort(classes.begin(), classes.end(),
+              [](const SizeClass& a, const SizeClass& b) { return a.buffer_size < b.buffer_size; });
+
+    size_t total_slots = 0;
+    for (const auto& size_class : classes) {
+        if (size_class.buffer_size == 0 || size_class.count == 0) {
+            throw std::invalid_argument("buffer ring size classes must be non-empty");
+        }
+        total_slots += size_class.count;
+    }
+    if (total_slots > UINT32_MAX) {
+        throw std::invalid_argument("too many buffers for one ring");
+    }
+    slots_ = std::make_unique<Slot[]>(total_slots);
+
+    size_t first = 0;
+    for (uint32_t c = 0; c < classes.size(); ++c) {
+        const size_t stride = alignUp(classes[c].buffer_size);
+        auto& size_class = *classes_.emplace_back(
+            std::make_unique<Class>(classes[c].buffer_size, first, classes[c].count));
+        // Mappings are page aligned, so every buffer starts on a cache line
+        size_class.storage = memory::LargeBuffer(stride * size_class.count, placement);
+        const auto base = reinterpret_cast<uintptr_t>(size_class.storage.data());
+
+        for (size_t i = 0; i < size_class.count; ++i) {
+            Slot& slot = slots_[first + i];
+            slot.size_class = c;
+            slot.data = reinterpret_cast<uint8_t*>(base + i * stride);
+            size_class.free.try_push(static_cast<uint32_t>(first + i));
+        }
+        first += size_class.count;
+    }
+}
+
+BufferRing::BufferRing(std::vector<SizeClass> classes) : BufferRing(std::move(classes), memory::Placement{}) {}
+
+BufferRing::~BufferRing() = default;
+
+BufferHandle BufferRing::acquire(size_t bytes, std::shared_ptr<BufferQuota> quota) {
+    auto it = std::find_if(classes_.begin(), classes_.end(),
+                           [bytes](const auto& c) { return c->buffer_size >= bytes; });
+    for (; it != classes_.end(); ++it) {
+        Class& size_class = **it;
+        auto slot = size_class.free.try_pop();
+        // The queue reads empty while a release is between claiming and
+        // filling its cell; only give up on the class if it is really out
+        for (int retry = 0; !slot && retry < POP_RETRIES &&
+             size_class.in_use.load(std::memory_order_relaxed) < size_class.count; ++retry) {
+            std::this_thread::yield();
+            slot = size_class.free.try_pop();
+        }
+        if (!slot) {
+            size_class.exhausted.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (quota && !quota->tryCharge(size_class.buffer_size)) {
+            giveBack(size_class, *slot);
+            quota_rejections_.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+        if (!memory::MemoryAccountant::global().try_charge(memory::Subsystem::NetworkBuffers,
+                                                           size_class.buffer_size)) {
+            if (quota) {
+                quota->refund(size_class.buffer_size);
+            }
+            giveBack(size_class, *slot);
+            budget_rejections_.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+
+        const size_t in_use = size_class.in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t high = size_class.high_water.load(std::memory_order_relaxed);
+        while (in_use > high &&
+               !size_class.high_water.compare_exchange_weak(high, in_use, std::memory_order_relaxed)) {}
+
+        Slot& entry = slots_[*slot];
+        entry.quota = std::move(quota);
+        entry.refs.store(1, std::memory_order_relaxed);
+        return BufferHandle(this, *slot, bytes);
+    }
+    return {};
+}
+
+void BufferRing::release(uint32_t slot) noexcept {
+    Slot& entry = slots_[slot];
+    if (entry.refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    Class& size_class = *classes_[entry.size_class];
+    if (entry.quota) {
+        entry.quota->refund(size_class.buffer_size);
+        entry.quota.reset();
+    }
+    memory::MemoryAccountant::global().release(memory::Subsystem::NetworkBuffers, size_class.buffer_size);
+    size_class.in_use.fetch_sub(1, std::memory_order_relaxed);
+    giveBack(size_class, slot);
+}
+
+void BufferRing::giveBack(Class& size_class, uint32_t slot) noexcept {
+    // The queue has a cell for every slot, so a full result only means the
+    // thread that popped the cell ahead has not finished vacating it yet
+    while (!size_class.free.try_push(slot)) {
+        std::this_thread::yield();
+    }
+}
+
+size_t BufferRing::maxBufferSize() const noexcept {
+    return classes_.back()->buffer_size;
+}
+
+BufferRing::Stats BufferRing::stats() const {
+    Stats stats;
+    stats.classes.reserve(classes_.size());
+    for (const auto& size_class : classes_) {
+        ClassStats entry;
+        entry.buffer_size = size_class->buffer_size;
+        entry.capacity = size_class->count;
+        entry.in_use = size_class->in_use.load(std::memory_order_relaxed);
+        entry.high_water = size_class->high_water.load(std::memory_order_relaxed);
+        entry.exhausted = size_class->exhausted.load(std::memory_order_relaxed);
+        stats.bytes_reserved += entry.buffer_size * entry.capacity;
+        stats.bytes_in_use += entry.buffer_size * entry.in_use;
+        stats.classes.push_back(entry);
+    }
+    stats.quota_rejections = quota_rejections_.load(std::memory_order_relaxed);
+    stats.budget_rejections = budget_rejections_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace quids::network
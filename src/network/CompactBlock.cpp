@@ -0,0 +1,333 @@
+#include "network/CompactBlock.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace quids {
+namespace network {
+
+namespace {
+
+using Hash = CompactBlock::Hash;
+
+constexpr uint64_t SHORT_ID_MASK = (uint64_t{1} << 48) - 1;
+// Far above any real block; bounds what a bad frame can make us allocate
+constexpr size_t MAX_TRANSACTIONS = 1 << 20;
+
+uint64_t rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+void sip_round(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+    v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+    v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+}
+
+uint64_t load_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+// SipHash-2-4 of a 32-byte message
+uint64_t siphash(uint64_t k0, uint64_t k1, const Hash& message) {
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+    for (size_t i = 0; i < message.size(); i += 8) {
+        const uint64_t m = load_u64(message.data() + i);
+        v3 ^= m;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    const uint64_t last = uint64_t{message.size()} << 56;
+    v3 ^= last;
+    sip_round(v0, v1, v2, v3);
+    sip_round(v0, v1, v2, v3);
+    v0 ^= last;
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; ++i) sip_round(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void put_bytes(std::vector<uint8_t>& out, std::span<const uint8_t> bytes) {
+    put_u32(out, static_cast<uint32_t>(bytes.size()));
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> in) : in_(in) {}
+
+    bool u32(uint32_t& v) {
+        if (in_.size() < 4) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(in_[i]) << (8 * i);
+        in_ = in_.subspan(4);
+        return true;
+    }
+
+    bool u64(uint64_t& v) {
+        if (in_.size() < 8) return false;
+        v = load_u64(in_.data());
+        in_ = in_.subspan(8);
+        return true;
+    }
+
+    bool take(size_t n, std::span<const uint8_t>& out) {
+        if (in_.size() < n) return false;
+        out = in_.first(n);
+        in_ = in_.subspan(n);
+        return true;
+    }
+
+    bool bytes(std::vector<uint8_t>& out) {
+        uint32_t len = 0;
+        std::span<const uint8_t> view;
+        if (!u32(len) || !take(len, view)) return false;
+        out.assign(view.begin(), view.end());
+        return true;
+    }
+
+    [[nodiscard]] size_t remaining() const { return in_.size(); }
+
+private:
+    std::span<const uint8_t> in_;
+};
+
+} // namespace
+
+CompactBlock::Hash CompactBlock::block_id(std::span<const uint8_t> header) {
+    Hash id{};
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, header.data(), header.size());
+    blake3_hasher_finalize(&hasher, id.data(), id.size());
+    return id;
+}
+
+std::array<uint64_t, 2> CompactBlock::keys() const {
+    // BLAKE3(header || nonce), as BIP 152 keys SipHash with SHA256
+    uint8_t nonce_bytes[8];
+    for (int i = 0; i < 8; ++i) nonce_bytes[i] = static_cast<uint8_t>(nonce >> (8 * i));
+    uint8_t digest[16];
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, header.data(), header.size());
+    blake3_hasher_update(&hasher, nonce_bytes, sizeof(nonce_bytes));
+    blake3_hasher_finalize(&hasher, digest, sizeof(digest));
+    return {load_u64(digest), load_u64(digest + 8)};
+}
+
+CompactBlock::ShortId CompactBlock::short_id(const Hash& tx_hash) const {
+    const auto [k0, k1] = keys();
+    return siphash(k0, k1, tx_hash) & SHORT_ID_MASK;
+}
+
+CompactBlock CompactBlock::build(std::vector<uint8_t> header, std::span<const Hash> tx_hashes,
+                                 std::span<const std::vector<uint8_t>> txs, uint64_t nonce,
+                                 std::span<const uint32_t> prefill) {
+    CompactBlock block;
+    block.header = std::move(header);
+    block.nonce = nonce;
+
+    std::vector<uint32_t> full(prefill.begin(), prefill.end());
+    std::sort(full.begin(), full.end());
+    full.erase(std::unique(full.begin(), full.end()), full.end());
+
+    const auto [k0, k1] = block.keys();
+    block.short_ids.reserve(tx_hashes.size() - std::min(full.size(), tx_hashes.size()));
+    size_t next = 0;
+    for (uint32_t i = 0; i < tx_hashes.size(); ++i) {
+        if (next < full.size() && full[next] == i) {
+            block.prefilled.push_back({i, txs[i]});
+            ++next;
+        } else {
+            block.short_ids.push_back(siphash(k0, k1, tx_hashes[i]) & SHORT_ID_MASK);
+        }
+    }
+    return block;
+}
+
+std::vector<uint8_t> CompactBlock::encode() const {
+    std::vector<uint8_t> out;
+    out.reserve(16 + header.size() + short_ids.size() * SHORT_ID_BYTES);
+    put_bytes(out, header);
+    put_u64(out, nonce);
+    put_u32(out, static_cast<uint32_t>(short_ids.size()));
+    for (const ShortId id : short_ids) {
+        for (size_t i = 0; i < SHORT_ID_BYTES; ++i) out.push_back(static_cast<uint8_t>(id >> (8 * i)));
+    }
+    put_u32(out, static_cast<uint32_t>(prefilled.size()));
+    for (const auto& entry : prefilled) {
+        put_u32(out, entry.index);
+        put_bytes(out, entry.tx);
+    }
+    return out;
+}
+
+std::optional<CompactBlock> CompactBlock::decode(std::span<const uint8_t> data) {
+    CompactBlock block;
+    Reader r(data);
+    uint32_t count = 0;
+    if (!r.bytes(block.header) || !r.u64(block.nonce) || !r.u32(count) ||
+        count > r.remaining() / SHORT_ID_BYTES) {
+        return std::nullopt;
+    }
+    block.short_ids.resize(count);
+    for (auto& id : block.short_ids) {
+        std::span<const uint8_t> raw;
+        r.take(SHORT_ID_BYTES, raw);
+        id = 0;
+        for (size_t i = 0; i < SHORT_ID_BYTES; ++i) id |= static_cast<uint64_t>(raw[i]) << (8 * i);
+    }
+
+    if (!r.u32(count) || count > r.remaining() / 8) {
+        return std::nullopt;
+    }
+    block.prefilled.resize(count);
+    for (size_t i = 0; i < block.prefilled.size(); ++i) {
+        auto& entry = block.prefilled[i];
+        if (!r.u32(entry.index) || !r.bytes(entry.tx)) {
+            return std::nullopt;
+        }
+        if (i > 0 && entry.index <= block.prefilled[i - 1].index) {
+            return std::nullopt;
+        }
+    }
+    if (r.remaining() != 0 || block.transaction_count() > MAX_TRANSACTIONS ||
+        (!block.prefilled.empty() && block.prefilled.back().index >= block.transaction_count())) {
+        return std::nullopt;
+    }
+    return block;
+}
+
+std::vector<uint8_t> CompactBlock::encode_request(const Hash& block, std::span<const uint32_t> indexes) {
+    std::vector<uint8_t> out(block.begin(), block.end());
+    put_u32(out, static_cast<uint32_t>(indexes.size()));
+    for (const uint32_t index : indexes) put_u32(out, index);
+    return out;
+}
+
+bool CompactBlock::decode_request(std::span<const uint8_t> data, Hash& block, std::vector<uint32_t>& indexes) {
+    Reader r(data);
+    std::span<const uint8_t> id;
+    uint32_t count = 0;
+    if (!r.take(block.size(), id) || !r.u32(count) || count != r.remaining() / 4 || r.remaining() % 4) {
+        return false;
+    }
+    std::copy(id.begin(), id.end(), block.begin());
+    indexes.resize(count);
+    for (auto& index : indexes) r.u32(index);
+    return true;
+}
+
+std::vector<uint8_t> CompactBlock::encode_transactions(std::span<const std::vector<uint8_t>> txs) {
+    std::vector<uint8_t> out;
+    put_u32(out, static_cast<uint32_t>(txs.size()));
+    for (const auto& tx : txs) put_bytes(out, tx);
+    return out;
+}
+
+std::optional<std::vector<std::vector<uint8_t>>> CompactBlock::decode_transactions(std::span<const uint8_t> data) {
+    Reader r(data);
+    uint32_t count = 0;
+    if (!r.u32(count) || count > r.remaining() / 4) {
+        return std::nullopt;
+    }
+    std::vector<std::vector<uint8_t>> txs(count);
+    for (auto& tx : txs) {
+        if (!r.bytes(tx)) return std::nullopt;
+    }
+    if (r.remaining() != 0) {
+        return std::nullopt;
+    }
+    return txs;
+}
+
+PartialBlock::PartialBlock(const CompactBlock& block, const CompactBlock::TransactionSource& source) {
+    const size_t total = block.transaction_count();
+    txs_.resize(total);
+    have_.assign(total, 0);
+    for (const auto& entry : block.prefilled) {
+        txs_[entry.index] = entry.tx;
+        have_[entry.index] = 1;
+    }
+
+    // Short id -> the one position it names; ids the block itself repeats
+    // name none
+    struct Slot {
+        uint32_t index;
+        bool ambiguous;
+        bool filled;
+        CompactBlock::Hash tx_hash;
+    };
+    std::unordered_map<CompactBlock::ShortId, Slot> slots;
+    slots.reserve(block.short_ids.size());
+    size_t next = 0;
+    for (uint32_t index = 0; index < total; ++index) {
+        if (have_[index]) continue;
+        const auto [it, inserted] = slots.try_emplace(block.short_ids[next++], Slot{index, false, false, {}});
+        if (!inserted) {
+            it->second.ambiguous = true;
+        }
+    }
+
+    if (source && !slots.empty()) {
+        const auto [k0, k1] = block.keys();
+        source([&](const CompactBlock::Hash& tx_hash, const std::function<std::vector<uint8_t>()>& bytes) {
+            const auto it = slots.find(siphash(k0, k1, tx_hash) & SHORT_ID_MASK);
+            if (it == slots.end() || it->second.ambiguous) {
+                return;
+            }
+            Slot& slot = it->second;
+            if (slot.filled) {
+                if (slot.tx_hash != tx_hash) {
+                    // Two held transactions share the id: ask for it instead
+                    slot.ambiguous = true;
+                    txs_[slot.index].clear();
+                    have_[slot.index] = 0;
+                    --matched_;
+                }
+                return;
+            }
+            slot.filled = true;
+            slot.tx_hash = tx_hash;
+            txs_[slot.index] = bytes();
+            have_[slot.index] = 1;
+            ++matched_;
+        });
+    }
+
+    for (uint32_t index = 0; index < total; ++index) {
+        if (!have_[index]) missing_.push_back(index);
+    }
+}
+
+bool PartialBlock::fill(std::vector<std::vector<uint8_t>> txs) {
+    if (txs.size() != missing_.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < txs.size(); ++i) {
+        txs_[missing_[i]] = std::move(txs[i]);
+        have_[missing_[i]] = 1;
+    }
+    missing_.clear();
+    return true;
+}
+
+} // namespace network
+} // namespace quids
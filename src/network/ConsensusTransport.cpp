@@ -0,0 +1,194 @@
+#include "network/ConsensusTransport.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace quids {
+namespace network {
+
+namespace {
+
+constexpr size_t FRAME_HEADER = 1 + 4;
+constexpr size_t ENTRY_HEADER = 1 + 4;
+
+void putU32(uint8_t* out, uint32_t v) {
+    out[0] = static_cast<uint8_t>(v);
+    out[1] = static_cast<uint8_t>(v >> 8);
+    out[2] = static_cast<uint8_t>(v >> 16);
+    out[3] = static_cast<uint8_t>(v >> 24);
+}
+
+uint32_t getU32(const uint8_t* in) {
+    return uint32_t{in[0]} | uint32_t{in[1]} << 8 | uint32_t{in[2]} << 16 | uint32_t{in[3]} << 24;
+}
+
+} // namespace
+
+ConsensusTransport::ConsensusTransport(OptimizedNetworkLayer& network, const Config& config)
+    : network_(network), config_(config) {
+    if (config.tick.count() <= 0 || config.max_frame_bytes <= wire::HEADER_SIZE + FRAME_HEADER + ENTRY_HEADER) {
+        throw std::invalid_argument("invalid consensus transport configuration");
+    }
+}
+
+ConsensusTransport::~ConsensusTransport() {
+    stop();
+}
+
+void ConsensusTransport::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    ticker_ = std::thread(&ConsensusTransport::tickLoop, this);
+}
+
+void ConsensusTransport::stop() {
+    if (running_.exchange(false)) {
+        tick_cv_.notify_all();
+        if (ticker_.joinable()) {
+            ticker_.join();
+        }
+        // Whatever was queued before stop still goes out
+        flush();
+    }
+}
+
+void ConsensusTransport::queueVote(const NodeID& peer, std::span<const uint8_t> payload) {
+    queue(peer, EntryKind::Vote, payload);
+}
+
+void ConsensusTransport::queueProof(const NodeID& peer, std::span<const uint8_t> payload) {
+    queue(peer, EntryKind::Proof, payload);
+}
+
+void ConsensusTransport::queueAck(const NodeID& peer, std::span<const uint8_t> payload) {
+    queue(peer, EntryKind::Ack, payload);
+}
+
+void ConsensusTransport::queue(const NodeID& peer, EntryKind kind, std::span<const uint8_t> payload) {
+    if (payload.size() > UINT32_MAX) {
+        throw std::length_error("consensus entry too large");
+    }
+
+    // Frames are handed to the network under the lock, so entries for one
+    // peer reach its lane in the order they were queued
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    PendingFrame& frame = pending_[peer];
+    // Cut the frame before this entry would overflow it; an entry larger
+    // than a whole frame still travels, alone
+    if (frame.entries > 0 && frame.bytes.size() + ENTRY_HEADER + payload.size() > config_.max_frame_bytes) {
+        send(peer, std::move(frame));
+        frame = PendingFrame{};
+    }
+    if (frame.bytes.empty()) {
+        frame.bytes.reserve(std::min(config_.max_frame_bytes,
+                                     wire::HEADER_SIZE + FRAME_HEADER + ENTRY_HEADER + payload.size()));
+        frame.bytes.resize(wire::HEADER_SIZE + FRAME_HEADER);
+        frame.bytes[wire::HEADER_SIZE] = FRAME_VERSION;
+    }
+    const size_t at = frame.bytes.size();
+    frame.bytes.resize(at + ENTRY_HEADER + payload.size());
+    frame.bytes[at] = static_cast<uint8_t>(kind);
+    putU32(frame.bytes.data() + at + 1, static_cast<uint32_t>(payload.size()));
+    std::copy(payload.begin(), payload.end(), frame.bytes.begin() + at + ENTRY_HEADER);
+    ++frame.entries;
+}
+
+void ConsensusTransport::flush() {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    for (auto& [peer, frame] : pending_) {
+        send(peer, std::move(frame));
+    }
+    pending_.clear();
+}
+
+void ConsensusTransport::send(const NodeID& peer, PendingFrame&& frame) {
+    const uint32_t entries = frame.entries;
+    putU32(frame.bytes.data() + wire::HEADER_SIZE + 1, entries);
+    // The header goes into the space left for it, so the payload is not copied
+    wire::writeHeader(frame.bytes.data(), config_.frame_type, 0,
+                      std::span<const uint8_t>(frame.bytes).subspan(wire::HEADER_SIZE));
+
+    Message msg;
+    msg.data = std::move(frame.bytes);
+    network_.sendConsensusMessage(peer, std::move(msg));
+
+    entries_sent_.fetch_add(entries, std::memory_order_relaxed);
+    frames_sent_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ConsensusTransport::tickLoop() {
+    std::unique_lock<std::mutex> lock(tick_mutex_);
+    while (running_) {
+        tick_cv_.wait_for(lock, config_.tick, [this] { return !running_; });
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+void ConsensusTransport::setHandler(EntryKind kind, EntryHandler handler) {
+    std::lock_guard<std::mutex> lock(handler_mutex_);
+    handlers_[static_cast<size_t>(kind)] = std::move(handler);
+}
+
+void ConsensusTransport::onFrame(const NodeID& from, std::span<const uint8_t> frame) {
+    std::array<EntryHandler, 3> handlers;
+    {
+        std::lock_guard<std::mutex> lock(handler_mutex_);
+        handlers = handlers_;
+    }
+
+    const bool ok = decodeFrame(frame, [&](EntryKind kind, std::span<const uint8_t> payload) {
+        entries_received_.fetch_add(1, std::memory_order_relaxed);
+        if (const auto& handler = handlers[static_cast<size_t>(kind)]) {
+            handler(from, payload);
+        }
+    });
+    if (!ok) {
+        malformed_frames_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool ConsensusTransport::decodeFrame(std::span<const uint8_t> frame,
+                                     const std::function<void(EntryKind, std::span<const uint8_t>)>& fn) {
+    if (frame.size() < FRAME_HEADER || frame[0] != FRAME_VERSION) {
+        return false;
+    }
+    const uint32_t count = getU32(frame.data() + 1);
+
+    // Validate the whole frame first so a truncated one delivers nothing
+    size_t offset = FRAME_HEADER;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (frame.size() - offset < ENTRY_HEADER || frame[offset] > static_cast<uint8_t>(EntryKind::Ack)) {
+            return false;
+        }
+        const uint32_t length = getU32(frame.data() + offset + 1);
+        if (frame.size() - offset - ENTRY_HEADER < length) {
+            return false;
+        }
+        offset += ENTRY_HEADER + length;
+    }
+    if (offset != frame.size()) {
+        return false;
+    }
+
+    offset = FRAME_HEADER;
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t length = getU32(frame.data() + offset + 1);
+        fn(static_cast<EntryKind>(frame[offset]), frame.subspan(offset + ENTRY_HEADER, length));
+        offset += ENTRY_HEADER + length;
+    }
+    return true;
+}
+
+ConsensusTransport::Stats ConsensusTransport::stats() const {
+    return Stats{
+        .entries_sent = entries_sent_.load(std::memory_order_relaxed),
+        .frames_sent = frames_sent_.load(std::memory_order_relaxed),
+        .entries_received = entries_received_.load(std::memory_order_relaxed),
+        .malformed_frames = malformed_frames_.load(std::memory_order_relaxed)
+    };
+}
+
+} // namespace network
+} // namespace quids
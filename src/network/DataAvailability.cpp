@@ -0,0 +1,242 @@
+#include "network/DataAvailability.hpp"
+#include "network/ErasureCode.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace quids {
+namespace network {
+
+namespace {
+
+using Hash = AvailabilityCommitment::Hash;
+
+// Far above any real block's proof depth (chunks are at most 256)
+constexpr size_t MAX_PROOF_HASHES = 16;
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> in) : in_(in) {}
+
+    bool u8(uint8_t& v) {
+        if (in_.empty()) return false;
+        v = in_[0];
+        in_ = in_.subspan(1);
+        return true;
+    }
+
+    bool u32(uint32_t& v) {
+        uint64_t x = 0;
+        if (!get(x, 4)) return false;
+        v = static_cast<uint32_t>(x);
+        return true;
+    }
+
+    bool u64(uint64_t& v) { return get(v, 8); }
+
+    bool hash(crypto::MerkleHash& h) {
+        if (in_.size() < h.size()) return false;
+        std::copy_n(in_.begin(), h.size(), h.begin());
+        in_ = in_.subspan(h.size());
+        return true;
+    }
+
+    bool bytes(std::vector<uint8_t>& out) {
+        uint32_t len = 0;
+        if (!u32(len) || in_.size() < len) return false;
+        out.assign(in_.begin(), in_.begin() + len);
+        in_ = in_.subspan(len);
+        return true;
+    }
+
+    [[nodiscard]] bool done() const { return in_.empty(); }
+
+private:
+    bool get(uint64_t& v, size_t width) {
+        if (in_.size() < width) return false;
+        v = 0;
+        for (size_t i = 0; i < width; ++i) v |= static_cast<uint64_t>(in_[i]) << (8 * i);
+        in_ = in_.subspan(width);
+        return true;
+    }
+
+    std::span<const uint8_t> in_;
+};
+
+Hash blake3(std::span<const uint8_t> a, std::span<const uint8_t> b = {}) {
+    Hash out{};
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, a.data(), a.size());
+    blake3_hasher_update(&hasher, b.data(), b.size());
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+} // namespace
+
+Hash AvailabilityCommitment::id() const {
+    return blake3(encode());
+}
+
+Hash AvailabilityCommitment::chunk_key(uint32_t index) const {
+    const Hash block = id();
+    std::vector<uint8_t> le;
+    put_u32(le, index);
+    return blake3(block, le);
+}
+
+double AvailabilityCommitment::miss_probability(size_t samples) const {
+    // The least a withholder can hide is parity_chunks + 1, leaving
+    // data_chunks - 1 chunks that answer
+    const size_t answering = data_chunks == 0 ? 0 : data_chunks - 1;
+    double p = 1.0;
+    for (size_t i = 0; i < samples; ++i) {
+        if (i >= answering) return 0.0;
+        p *= static_cast<double>(answering - i) / static_cast<double>(total_chunks() - i);
+    }
+    return p;
+}
+
+std::vector<uint8_t> AvailabilityCommitment::encode() const {
+    std::vector<uint8_t> out(root.begin(), root.end());
+    out.reserve(ENCODED_SIZE);
+    put_u32(out, data_chunks);
+    put_u32(out, parity_chunks);
+    put_u32(out, chunk_size);
+    put_u64(out, block_size);
+    return out;
+}
+
+std::optional<AvailabilityCommitment> AvailabilityCommitment::decode(std::span<const uint8_t> data) {
+    AvailabilityCommitment c;
+    Reader r(data);
+    if (!r.hash(c.root) || !r.u32(c.data_chunks) || !r.u32(c.parity_chunks) || !r.u32(c.chunk_size) ||
+        !r.u64(c.block_size) || !r.done()) {
+        return std::nullopt;
+    }
+    if (c.data_chunks == 0 || c.chunk_size == 0 || c.total_chunks() > ReedSolomon::MAX_SHARDS ||
+        c.block_size == 0 || c.block_size > uint64_t{c.data_chunks} * c.chunk_size) {
+        return std::nullopt;
+    }
+    return c;
+}
+
+std::vector<uint8_t> BlockChunk::encode() const {
+    std::vector<uint8_t> out;
+    out.reserve(9 + data.size() + proof.size() * 32);
+    put_u32(out, index);
+    put_u32(out, static_cast<uint32_t>(data.size()));
+    out.insert(out.end(), data.begin(), data.end());
+    out.push_back(static_cast<uint8_t>(proof.size()));
+    for (const auto& h : proof) out.insert(out.end(), h.begin(), h.end());
+    return out;
+}
+
+std::optional<BlockChunk> BlockChunk::decode(std::span<const uint8_t> data) {
+    BlockChunk chunk;
+    Reader r(data);
+    uint8_t count = 0;
+    if (!r.u32(chunk.index) || !r.bytes(chunk.data) || !r.u8(count) || count > MAX_PROOF_HASHES) {
+        return std::nullopt;
+    }
+    chunk.proof.resize(count);
+    for (auto& h : chunk.proof) {
+        if (!r.hash(h)) return std::nullopt;
+    }
+    if (!r.done()) {
+        return std::nullopt;
+    }
+    return chunk;
+}
+
+ChunkedBlock ChunkedBlock::encode(std::span<const uint8_t> block, uint32_t data_chunks, uint32_t parity_chunks) {
+    if (block.empty()) {
+        throw std::invalid_argument("ChunkedBlock: empty block");
+    }
+    const ReedSolomon code(data_chunks, parity_chunks);
+    const size_t chunk_size = (block.size() + data_chunks - 1) / data_chunks;
+
+    // The tail is zero-padded; block_size says where it ends
+    std::vector<std::vector<uint8_t>> shards(data_chunks, std::vector<uint8_t>(chunk_size, 0));
+    for (size_t i = 0; i < data_chunks; ++i) {
+        const size_t begin = std::min(block.size(), i * chunk_size);
+        const size_t end = std::min(block.size(), begin + chunk_size);
+        std::copy(block.begin() + begin, block.begin() + end, shards[i].begin());
+    }
+    code.encode(shards);
+
+    crypto::MerkleBuilder tree;
+    for (const auto& shard : shards) tree.append(shard);
+
+    ChunkedBlock out;
+    out.commitment_.root = tree.root();
+    out.commitment_.data_chunks = data_chunks;
+    out.commitment_.parity_chunks = parity_chunks;
+    out.commitment_.chunk_size = static_cast<uint32_t>(chunk_size);
+    out.commitment_.block_size = block.size();
+    out.chunks_.reserve(shards.size());
+    for (uint32_t i = 0; i < shards.size(); ++i) {
+        out.chunks_.push_back({i, std::move(shards[i]), tree.proof(i).siblings});
+    }
+    return out;
+}
+
+bool ChunkedBlock::verify(const AvailabilityCommitment& commitment, const BlockChunk& chunk) {
+    if (chunk.index >= commitment.total_chunks() || chunk.data.size() != commitment.chunk_size) {
+        return false;
+    }
+    crypto::MerkleProof proof{chunk.index, commitment.total_chunks(), chunk.proof};
+    return crypto::MerkleBuilder::verify(commitment.root, crypto::MerkleBuilder::hashLeaf(chunk.data), proof);
+}
+
+std::optional<std::vector<uint8_t>> ChunkedBlock::reconstruct(const AvailabilityCommitment& commitment,
+                                                              std::span<const BlockChunk> chunks) {
+    if (commitment.data_chunks == 0 || commitment.total_chunks() > ReedSolomon::MAX_SHARDS) {
+        return std::nullopt;
+    }
+    std::vector<std::vector<uint8_t>> shards(commitment.total_chunks());
+    for (const auto& chunk : chunks) {
+        if (chunk.index < shards.size() && shards[chunk.index].empty() && verify(commitment, chunk)) {
+            shards[chunk.index] = chunk.data;
+        }
+    }
+    const ReedSolomon code(commitment.data_chunks, commitment.parity_chunks);
+    if (!code.reconstruct(shards)) {
+        return std::nullopt;
+    }
+
+    std::vector<uint8_t> block;
+    block.reserve(size_t{commitment.data_chunks} * commitment.chunk_size);
+    for (uint32_t i = 0; i < commitment.data_chunks; ++i) {
+        block.insert(block.end(), shards[i].begin(), shards[i].end());
+    }
+    block.resize(commitment.block_size);
+    return block;
+}
+
+std::vector<uint32_t> ChunkedBlock::sample(const AvailabilityCommitment& commitment, size_t count,
+                                           std::mt19937_64& rng) {
+    std::vector<uint32_t> all(commitment.total_chunks());
+    std::iota(all.begin(), all.end(), 0);
+    count = std::min(count, all.size());
+    // Partial Fisher-Yates: the first count entries come out uniform
+    for (size_t i = 0; i < count; ++i) {
+        std::uniform_int_distribution<size_t> pick(i, all.size() - 1);
+        std::swap(all[i], all[pick(rng)]);
+    }
+    all.resize(count);
+    return all;
+}
+
+} // namespace network
+} // namespace quids
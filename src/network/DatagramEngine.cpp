@@ -0,0 +1,402 @@
+#include "network/DatagramEngine.hpp"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <system_error>
+
+namespace quids::network {
+
+namespace {
+
+#if defined(__linux__) && defined(UDP_SEGMENT)
+#define DATAGRAM_ENGINE_MMSG 1
+#endif
+
+// Largest UDP payload, and so the largest buffer GRO can deliver
+constexpr size_t MAX_UDP_PAYLOAD = 65507;
+// Kernel limit on segments in one GSO send
+constexpr size_t MAX_GSO_SEGMENTS = 64;
+// Wake up this often to notice stop()
+constexpr int POLL_TIMEOUT_MS = 100;
+
+[[noreturn]] void throwErrno(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void setOption(int fd, int level, int name, int value, const char* what) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) != 0) {
+        throwErrno(what);
+    }
+}
+
+// Peer address as text; IPv4 and IPv6 fit the small-string buffer
+void describe(const sockaddr_storage& from, std::string& address, uint16_t& port) {
+    char text[INET6_ADDRSTRLEN] = {};
+    if (from.ss_family == AF_INET6) {
+        const auto& in6 = reinterpret_cast<const sockaddr_in6&>(from);
+        inet_ntop(AF_INET6, &in6.sin6_addr, text, sizeof(text));
+        port = ntohs(in6.sin6_port);
+    } else {
+        const auto& in4 = reinterpret_cast<const sockaddr_in&>(from);
+        inet_ntop(AF_INET, &in4.sin_addr, text, sizeof(text));
+        port = ntohs(in4.sin_port);
+    }
+    address.assign(text);
+}
+
+} // namespace
+
+DatagramEngine::DatagramEngine(const Config& config, Handler handler)
+    : config_(config), handler_(std::move(handler)) {
+    if (config.batch == 0 || config.max_datagram == 0 || config.max_datagram > MAX_UDP_PAYLOAD) {
+        throw std::invalid_argument("invalid datagram engine configuration");
+    }
+}
+
+DatagramEngine::~DatagramEngine() {
+    stop();
+}
+
+void DatagramEngine::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    const size_t workers = config_.workers != 0 ? config_.workers
+                                                : std::max<size_t>(1, std::thread::hardware_concurrency());
+    boost::asio::ip::udp::endpoint endpoint(boost::asio::ip::make_address(config_.bind_address), config_.port);
+
+    try {
+        for (size_t i = 0; i < workers; ++i) {
+            const int fd = socket(endpoint.protocol().family(), SOCK_DGRAM, 0);
+            if (fd < 0) {
+                throwErrno("socket");
+            }
+            sockets_.push_back(fd);
+
+            setOption(fd, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+#ifdef SO_REUSEPORT
+            setOption(fd, SOL_SOCKET, SO_REUSEPORT, 1, "SO_REUSEPORT");
+#endif
+            // Best effort: the kernel caps these at net.core.[rw]mem_max
+            const int bytes = config_.socket_buffer_bytes;
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+#if DATAGRAM_ENGINE_MMSG
+            if (config_.enable_gro) {
+                const int on = 1;
+                if (setsockopt(fd, IPPROTO_UDP, UDP_GRO, &on, sizeof(on)) != 0 && i == 0) {
+                    spdlog::debug("UDP GRO unavailable: {}", std::strerror(errno));
+                }
+            }
+#endif
+
+            if (bind(fd, endpoint.data(), static_cast<socklen_t>(endpoint.size())) != 0) {
+                throwErrno("bind");
+            }
+            if (i == 0) {
+                // Later sockets join the port the first one was given
+                sockaddr_storage bound{};
+                socklen_t length = sizeof(bound);
+                if (getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &length) != 0) {
+                    throwErrno("getsockname");
+                }
+                std::string address;
+                describe(bound, address, bound_port_);
+                endpoint.port(bound_port_);
+            }
+        }
+    } catch (...) {
+        for (int fd : sockets_) {
+            close(fd);
+        }
+        sockets_.clear();
+        running_.store(false);
+        throw;
+    }
+
+#if DATAGRAM_ENGINE_MMSG
+    gso_.store(config_.enable_gso);
+#endif
+    for (size_t i = 0; i < sockets_.size(); ++i) {
+        threads_.emplace_back(&DatagramEngine::receiveLoop, this, i);
+    }
+}
+
+void DatagramEngine::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    for (int fd : sockets_) {
+        close(fd);
+    }
+    sockets_.clear();
+}
+
+void DatagramEngine::receiveLoop(size_t worker) {
+    const int fd = sockets_[worker];
+    const size_t slot = config_.enable_gro ? MAX_UDP_PAYLOAD : config_.max_datagram;
+
+#if DATAGRAM_ENGINE_MMSG
+    const size_t batch = config_.batch;
+    constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(int));
+
+    // The pool: one slot per datagram of a batch, reused every call
+    std::vector<uint8_t> pool(batch * slot);
+    std::vector<uint8_t> control(batch * CONTROL_SIZE);
+    std::vector<sockaddr_storage> names(batch);
+    std::vector<iovec> iov(batch);
+    std::vector<mmsghdr> messages(batch);
+    for (size_t i = 0; i < batch; ++i) {
+        iov[i] = iovec{pool.data() + i * slot, slot};
+    }
+#else
+    std::vector<uint8_t> pool(slot);
+#endif
+
+    std::string address;
+    uint16_t port = 0;
+    while (running_.load(std::memory_order_relaxed)) {
+        pollfd ready{fd, POLLIN, 0};
+        const int polled = poll(&ready, 1, POLL_TIMEOUT_MS);
+        if (polled <= 0) {
+            if (polled < 0 && errno != EINTR) {
+                spdlog::error("Datagram poll failed: {}", std::strerror(errno));
+            }
+            continue;
+        }
+
+#if DATAGRAM_ENGINE_MMSG
+        for (size_t i = 0; i < batch; ++i) {
+            messages[i].msg_hdr = msghdr{};
+            messages[i].msg_hdr.msg_name = &names[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            messages[i].msg_hdr.msg_iov = &iov[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_control = control.data() + i * CONTROL_SIZE;
+            messages[i].msg_hdr.msg_controllen = CONTROL_SIZE;
+            messages[i].msg_len = 0;
+        }
+        const int received = recvmmsg(fd, messages.data(), static_cast<unsigned>(batch), MSG_DONTWAIT, nullptr);
+        if (received <= 0) {
+            if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                spdlog::error("recvmmsg failed: {}", std::strerror(errno));
+            }
+            continue;
+        }
+        receive_calls_.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t datagrams = 0;
+        uint64_t bytes = 0;
+        for (int m = 0; m < received; ++m) {
+            msghdr& header = messages[m].msg_hdr;
+            if (header.msg_flags & MSG_TRUNC) {
+                truncated_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            // A GRO buffer holds equal-sized segments, the last maybe shorter
+            size_t segment = messages[m].msg_len;
+            for (cmsghdr* c = CMSG_FIRSTHDR(&header); c != nullptr; c = CMSG_NXTHDR(&header, c)) {
+                if (c->cmsg_level == IPPROTO_UDP && c->cmsg_type == UDP_GRO) {
+                    int size = 0;
+                    std::memcpy(&size, CMSG_DATA(c), sizeof(size));
+                    if (size > 0) {
+                        segment = static_cast<size_t>(size);
+                    }
+                }
+            }
+
+            describe(names[m], address, port);
+            const std::span<const uint8_t> buffer(static_cast<const uint8_t*>(iov[m].iov_base), messages[m].msg_len);
+            for (size_t offset = 0; offset < buffer.size(); offset += segment) {
+                const auto datagram = buffer.subspan(offset, std::min(segment, buffer.size() - offset));
+                ++datagrams;
+                bytes += datagram.size();
+                if (handler_) {
+                    handler_(address, port, datagram);
+                }
+            }
+        }
+        datagrams_received_.fetch_add(datagrams, std::memory_order_relaxed);
+        bytes_received_.fetch_add(bytes, std::memory_order_relaxed);
+#else
+        sockaddr_storage from{};
+        socklen_t length = sizeof(from);
+        const ssize_t n = recvfrom(fd, pool.data(), pool.size(), MSG_DONTWAIT,
+                                   reinterpret_cast<sockaddr*>(&from), &length);
+        if (n < 0) {
+            continue;
+        }
+        receive_calls_.fetch_add(1, std::memory_order_relaxed);
+        datagrams_received_.fetch_add(1, std::memory_order_relaxed);
+        bytes_received_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        describe(from, address, port);
+        if (handler_) {
+            handler_(address, port, std::span<const uint8_t>(pool.data(), static_cast<size_t>(n)));
+        }
+#endif
+    }
+}
+
+size_t DatagramEngine::sendOne(int fd, const Outgoing& datagram) {
+    send_calls_.fetch_add(1, std::memory_order_relaxed);
+    const ssize_t n = sendto(fd, datagram.data.data(), datagram.data.size(), 0,
+                             datagram.to.data(), static_cast<socklen_t>(datagram.to.size()));
+    if (n < 0) {
+        send_errors_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    datagrams_sent_.fetch_add(1, std::memory_order_relaxed);
+    return 1;
+}
+
+size_t DatagramEngine::send(std::span<const Outgoing> datagrams) {
+    if (sockets_.empty() || datagrams.empty()) {
+        return 0;
+    }
+    const int fd = sockets_[next_send_socket_.fetch_add(1, std::memory_order_relaxed) % sockets_.size()];
+
+#if DATAGRAM_ENGINE_MMSG
+    constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(uint16_t));
+
+    // Per-thread scratch, so concurrent senders never share it
+    thread_local std::vector<mmsghdr> messages;
+    thread_local std::vector<iovec> iov;
+    thread_local std::vector<uint8_t> control;
+    thread_local std::vector<uint8_t> coalesced;
+    // Index into datagrams of the first datagram in each message
+    thread_local std::vector<size_t> firsts;
+
+    size_t sent = 0;
+    size_t next = 0;
+    while (next < datagrams.size()) {
+        messages.clear();
+        iov.clear();
+        firsts.clear();
+        coalesced.clear();
+        control.assign(config_.batch * CONTROL_SIZE, 0);
+
+        const bool gso = gso_.load(std::memory_order_relaxed);
+        while (next < datagrams.size() && messages.size() < config_.batch) {
+            const Outgoing& head = datagrams[next];
+            const size_t segment = head.data.size();
+            size_t run = 1;
+            size_t total = segment;
+            if (gso && segment > 0) {
+                // Equal sizes to one peer; only the last may be shorter
+                while (next + run < datagrams.size() && run < MAX_GSO_SEGMENTS) {
+                    const Outgoing& candidate = datagrams[next + run];
+                    const size_t size = candidate.data.size();
+                    if (!(candidate.to == head.to) || size == 0 || size > segment ||
+                        total + size > MAX_UDP_PAYLOAD) {
+                        break;
+                    }
+                    total += size;
+                    ++run;
+                    if (size < segment) {
+                        break;
+                    }
+                }
+            }
+
+            mmsghdr message{};
+            message.msg_hdr.msg_name = const_cast<sockaddr*>(head.to.data());
+            message.msg_hdr.msg_namelen = static_cast<socklen_t>(head.to.size());
+            if (run == 1) {
+                iov.push_back(iovec{const_cast<uint8_t*>(head.data.data()), segment});
+            } else {
+                // The run is copied into one buffer; its base is fixed up
+                // below, once the scratch buffer has stopped growing
+                const size_t offset = coalesced.size();
+                for (size_t k = 0; k < run; ++k) {
+                    const auto& part = datagrams[next + k].data;
+                    coalesced.insert(coalesced.end(), part.begin(), part.end());
+                }
+                iov.push_back(iovec{reinterpret_cast<void*>(offset), total});
+
+                message.msg_hdr.msg_control = control.data() + messages.size() * CONTROL_SIZE;
+                message.msg_hdr.msg_controllen = CONTROL_SIZE;
+                cmsghdr* c = CMSG_FIRSTHDR(&message.msg_hdr);
+                c->cmsg_level = IPPROTO_UDP;
+                c->cmsg_type = UDP_SEGMENT;
+                c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                const auto size = static_cast<uint16_t>(segment);
+                std::memcpy(CMSG_DATA(c), &size, sizeof(size));
+            }
+            firsts.push_back(next);
+            messages.push_back(message);
+            next += run;
+        }
+        firsts.push_back(next);
+        for (size_t m = 0; m < messages.size(); ++m) {
+            if (messages[m].msg_hdr.msg_controllen != 0) {
+                iov[m].iov_base = coalesced.data() + reinterpret_cast<size_t>(iov[m].iov_base);
+            }
+            messages[m].msg_hdr.msg_iov = &iov[m];
+            messages[m].msg_hdr.msg_iovlen = 1;
+        }
+
+        size_t done = 0;
+        while (done < messages.size()) {
+            send_calls_.fetch_add(1, std::memory_order_relaxed);
+            const int n = sendmmsg(fd, messages.data() + done, static_cast<unsigned>(messages.size() - done), 0);
+            if (n > 0) {
+                const size_t count = firsts[done + n] - firsts[done];
+                sent += count;
+                datagrams_sent_.fetch_add(count, std::memory_order_relaxed);
+                done += static_cast<size_t>(n);
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EIO && messages[done].msg_hdr.msg_controllen != 0) {
+                // The device cannot segment: stop coalescing and send this
+                // run datagram by datagram
+                gso_.store(false, std::memory_order_relaxed);
+                for (size_t k = firsts[done]; k < firsts[done + 1]; ++k) {
+                    sent += sendOne(fd, datagrams[k]);
+                }
+            } else {
+                // Drop the message the kernel refused and carry on
+                send_errors_.fetch_add(firsts[done + 1] - firsts[done], std::memory_order_relaxed);
+            }
+            ++done;
+        }
+    }
+    return sent;
+#else
+    size_t sent = 0;
+    for (const auto& datagram : datagrams) {
+        sent += sendOne(fd, datagram);
+    }
+    return sent;
+#endif
+}
+
+DatagramEngine::Stats DatagramEngine::stats() const noexcept {
+    return Stats{
+        .datagrams_received = datagrams_received_.load(std::memory_order_relaxed),
+        .receive_calls = receive_calls_.load(std::memory_order_relaxed),
+        .bytes_received = bytes_received_.load(std::memory_order_relaxed),
+        .truncated = truncated_.load(std::memory_order_relaxed),
+        .datagrams_sent = datagrams_sent_.load(std::memory_order_relaxed),
+        .send_calls = send_calls_.load(std::memory_order_relaxed),
+        .send_errors = send_errors_.load(std::memory_order_relaxed)
+    };
+}
+
+} // namespace quids::network
@@ -0,0 +1,171 @@
+#include "network/ErasureCode.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+namespace quids {
+namespace network {
+
+namespace {
+
+// GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 and generator 2
+struct Field {
+    std::array<uint8_t, 512> exp{};
+    std::array<uint8_t, 256> log{};
+
+    Field() {
+        unsigned x = 1;
+        for (size_t i = 0; i < 255; ++i) {
+            exp[i] = static_cast<uint8_t>(x);
+            log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) x ^= 0x11d;
+        }
+        // Doubled so mul() needs no modulo
+        for (size_t i = 255; i < exp.size(); ++i) exp[i] = exp[i - 255];
+    }
+
+    uint8_t mul(uint8_t a, uint8_t b) const {
+        if (a == 0 || b == 0) return 0;
+        return exp[log[a] + log[b]];
+    }
+
+    uint8_t inv(uint8_t a) const { return exp[255 - log[a]]; }
+};
+
+const Field& field() {
+    static const Field f;
+    return f;
+}
+
+// dst ^= c * src, one table lookup per byte
+void mul_add(std::vector<uint8_t>& dst, const std::vector<uint8_t>& src, uint8_t c) {
+    if (c == 0) return;
+    const Field& f = field();
+    std::array<uint8_t, 256> product;
+    for (unsigned x = 0; x < 256; ++x) product[x] = f.mul(c, static_cast<uint8_t>(x));
+    for (size_t i = 0; i < dst.size(); ++i) dst[i] ^= product[src[i]];
+}
+
+// Gauss-Jordan over GF(2^8); the matrix is n x n, row-major, and invertible
+std::vector<uint8_t> invert(std::vector<uint8_t> a, size_t n) {
+    const Field& f = field();
+    std::vector<uint8_t> out(n * n, 0);
+    for (size_t i = 0; i < n; ++i) out[i * n + i] = 1;
+
+    for (size_t col = 0; col < n; ++col) {
+        size_t pivot = col;
+        while (a[pivot * n + col] == 0) ++pivot;
+        if (pivot != col) {
+            for (size_t j = 0; j < n; ++j) {
+                std::swap(a[pivot * n + j], a[col * n + j]);
+                std::swap(out[pivot * n + j], out[col * n + j]);
+            }
+        }
+        const uint8_t scale = f.inv(a[col * n + col]);
+        for (size_t j = 0; j < n; ++j) {
+            a[col * n + j] = f.mul(a[col * n + j], scale);
+            out[col * n + j] = f.mul(out[col * n + j], scale);
+        }
+        for (size_t row = 0; row < n; ++row) {
+            const uint8_t factor = a[row * n + col];
+            if (row == col || factor == 0) continue;
+            for (size_t j = 0; j < n; ++j) {
+                a[row * n + j] ^= f.mul(factor, a[col * n + j]);
+                out[row * n + j] ^= f.mul(factor, out[col * n + j]);
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+ReedSolomon::ReedSolomon(size_t data_shards, size_t parity_shards)
+    : k_(data_shards), m_(parity_shards) {
+    if (k_ == 0 || k_ + m_ > MAX_SHARDS) {
+        throw std::invalid_argument("ReedSolomon: need 1 to 256 shards, at least one of them data");
+    }
+    // Cauchy rows 1 / (x_i + y_j) with x_i = k + i and y_j = j, which are
+    // all distinct, so no denominator is zero
+    const Field& f = field();
+    parity_.resize(m_ * k_);
+    for (size_t i = 0; i < m_; ++i) {
+        for (size_t j = 0; j < k_; ++j) {
+            parity_[i * k_ + j] = f.inv(static_cast<uint8_t>((k_ + i) ^ j));
+        }
+    }
+}
+
+void ReedSolomon::encode(std::vector<std::vector<uint8_t>>& shards) const {
+    if (shards.size() != k_ || shards.front().empty()) {
+        throw std::invalid_argument("ReedSolomon: wrong number of data shards");
+    }
+    const size_t length = shards.front().size();
+    for (const auto& shard : shards) {
+        if (shard.size() != length) {
+            throw std::invalid_argument("ReedSolomon: data shards differ in length");
+        }
+    }
+
+    shards.resize(k_ + m_);
+    for (size_t i = 0; i < m_; ++i) {
+        auto& parity = shards[k_ + i];
+        parity.assign(length, 0);
+        for (size_t j = 0; j < k_; ++j) {
+            mul_add(parity, shards[j], parity_[i * k_ + j]);
+        }
+    }
+}
+
+bool ReedSolomon::reconstruct(std::vector<std::vector<uint8_t>>& shards) const {
+    if (shards.size() != k_ + m_) {
+        return false;
+    }
+
+    // The first k present shards, and their rows of [I; C]
+    std::vector<size_t> rows;
+    size_t length = 0;
+    for (size_t i = 0; i < shards.size() && rows.size() < k_; ++i) {
+        if (shards[i].empty()) continue;
+        if (length == 0) {
+            length = shards[i].size();
+        } else if (shards[i].size() != length) {
+            return false;
+        }
+        rows.push_back(i);
+    }
+    if (rows.size() < k_) {
+        return false;
+    }
+    bool whole = true;
+    for (size_t j = 0; j < k_; ++j) whole = whole && !shards[j].empty();
+    if (whole) {
+        return true;
+    }
+
+    std::vector<uint8_t> matrix(k_ * k_, 0);
+    for (size_t r = 0; r < k_; ++r) {
+        if (rows[r] < k_) {
+            matrix[r * k_ + rows[r]] = 1;
+        } else {
+            std::copy_n(parity_.begin() + (rows[r] - k_) * k_, k_, matrix.begin() + r * k_);
+        }
+    }
+    const auto decode = invert(std::move(matrix), k_);
+
+    // Data shard j is row j of the inverse applied to the shards used
+    for (size_t j = 0; j < k_; ++j) {
+        if (!shards[j].empty()) continue;
+        std::vector<uint8_t> restored(length, 0);
+        for (size_t r = 0; r < k_; ++r) {
+            mul_add(restored, shards[rows[r]], decode[j * k_ + r]);
+        }
+        shards[j] = std::move(restored);
+    }
+    return true;
+}
+
+} // namespace network
+} // namespace quids
@@ -0,0 +1,337 @@
+#include "network/FrameBatcher.hpp"
+#include "utils/PerfCounters.hpp"
+#include <zstd.h>
+#include <zdict.h>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+namespace quids::network {
+
+namespace {
+
+struct CCtxDeleter {
+    void operator()(ZSTD_CCtx* ctx) const noexcept { ZSTD_freeCCtx(ctx); }
+};
+struct DCtxDeleter {
+    void operator()(ZSTD_DCtx* ctx) const noexcept { ZSTD_freeDCtx(ctx); }
+};
+
+// Contexts are reused per thread; workers pack and unpack in parallel
+ZSTD_CCtx* threadCCtx() {
+    thread_local std::unique_ptr<ZSTD_CCtx, CCtxDeleter> ctx(ZSTD_createCCtx());
+    return ctx.get();
+}
+
+ZSTD_DCtx* threadDCtx() {
+    thread_local std::unique_ptr<ZSTD_DCtx, DCtxDeleter> ctx(ZSTD_createDCtx());
+    return ctx.get();
+}
+
+// Our own frames, already checksummed when they were built
+size_t frameLength(const uint8_t* header) {
+    return wire::HEADER_SIZE + (static_cast<size_t>(header[4]) | static_cast<size_t>(header[5]) << 8 |
+                                static_cast<size_t>(header[6]) << 16 | static_cast<size_t>(header[7]) << 24);
+}
+
+} // namespace
+
+struct FrameBatcher::Dictionary {
+    uint32_t id{0};
+    ZSTD_CDict* cdict{nullptr};
+    ZSTD_DDict* ddict{nullptr};
+
+    Dictionary(const std::vector<uint8_t>& bytes, int level) {
+        id = ZDICT_getDictID(bytes.data(), bytes.size());
+        if (id == 0) {
+            // Frames could not say which dictionary they need
+            throw std::invalid_argument("frame dictionary has no ID");
+        }
+        cdict = ZSTD_createCDict(bytes.data(), bytes.size(), level);
+        ddict = ZSTD_createDDict(bytes.data(), bytes.size());
+        if (!cdict || !ddict) {
+            release();
+            throw std::runtime_error("failed to load frame dictionary");
+        }
+    }
+
+    ~Dictionary() { release(); }
+
+    Dictionary(const Dictionary&) = delete;
+    Dictionary& operator=(const Dictionary&) = delete;
+
+    void release() noexcept {
+        ZSTD_freeCDict(cdict);
+        ZSTD_freeDDict(ddict);
+        cdict = nullptr;
+        ddict = nullptr;
+    }
+};
+
+FrameBatcher::FrameBatcher(const Config& config, Send send)
+    : config_(config), send_(std::move(send)) {
+    if (config.max_batch_bytes == 0 || config.max_delay < config.linger) {
+        throw std::invalid_argument("invalid frame batcher configuration");
+    }
+}
+
+FrameBatcher::~FrameBatcher() = default;
+
+void FrameBatcher::enqueue(const PeerID& peer, std::span<const uint8_t> frames) {
+    if (frames.empty()) {
+        return;
+    }
+    const auto now = Clock::now();
+    std::vector<std::pair<PeerID, std::vector<uint8_t>>> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.frames_queued;
+        stats_.bytes_in += frames.size();
+
+        Pending& pending = pending_[peer];
+        if (pending.bytes.empty()) {
+            pending.first = now;
+            pending.bytes.reserve(std::min(config_.max_batch_bytes, frames.size() * 4));
+        }
+        // Each new frame extends the wait by linger, up to max_delay
+        pending.deadline = std::min(pending.first + config_.max_delay, now + config_.linger);
+        pending.bytes.insert(pending.bytes.end(), frames.begin(), frames.end());
+
+        if (pending.bytes.size() >= config_.max_batch_bytes) {
+            due.emplace_back(peer, std::move(pending.bytes));
+            pending_.erase(peer);
+        }
+    }
+    sendAll(due);
+}
+
+size_t FrameBatcher::poll(Clock::time_point now) {
+    std::vector<std::pair<PeerID, std::vector<uint8_t>>> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = pending_.begin(); it != pending_.end();) {
+            if (it->second.deadline <= now) {
+                due.emplace_back(it->first, std::move(it->second.bytes));
+                it = pending_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    sendAll(due);
+    return due.size();
+}
+
+void FrameBatcher::flushAll() {
+    poll(Clock::time_point::max());
+}
+
+FrameBatcher::Clock::time_point FrameBatcher::nextDeadline() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto next = Clock::time_point::max();
+    for (const auto& [peer, pending] : pending_) {
+        next = std::min(next, pending.deadline);
+    }
+    return next;
+}
+
+void FrameBatcher::sendAll(std::vector<std::pair<PeerID, std::vector<uint8_t>>>& due) {
+    if (due.empty()) {
+        return;
+    }
+    std::array<DictionaryPtr, 256> dictionaries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dictionaries = dictionaries_;
+    }
+
+    uint64_t compressed = 0;
+    uint64_t bytes_out = 0;
+    for (auto& [peer, frames] : due) {
+        const size_t before = frames.size();
+        std::vector<uint8_t> packet = pack(std::move(frames), dictionaries);
+        compressed += packet.size() != before;
+        bytes_out += packet.size();
+        send_(peer, std::move(packet));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.packets_sent += due.size();
+    stats_.batches_compressed += compressed;
+    stats_.bytes_out += bytes_out;
+}
+
+std::vector<uint8_t> FrameBatcher::pack(std::vector<uint8_t>&& frames,
+                                        const std::array<DictionaryPtr, 256>& dictionaries) {
+    if (frames.size() < config_.compress_threshold) {
+        return std::move(frames);
+    }
+
+    // Bytes per type decide which types are worth a compressed group
+    std::array<size_t, 256> per_type{};
+    for (size_t at = 0; at + wire::HEADER_SIZE <= frames.size(); at += frameLength(&frames[at])) {
+        per_type[frames[at + 1]] += frameLength(&frames[at]);
+    }
+    if (std::none_of(per_type.begin(), per_type.end(),
+                     [this](size_t bytes) { return bytes >= config_.compress_threshold; })) {
+        return std::move(frames);
+    }
+
+    std::vector<uint8_t> packet;
+    packet.reserve(frames.size());
+    std::vector<uint8_t> group;
+    std::array<bool, 256> emitted{};
+    for (size_t at = 0; at + wire::HEADER_SIZE <= frames.size(); at += frameLength(&frames[at])) {
+        const uint8_t type = frames[at + 1];
+        const size_t length = frameLength(&frames[at]);
+        if (per_type[type] < config_.compress_threshold) {
+            packet.insert(packet.end(), frames.begin() + at, frames.begin() + at + length);
+            continue;
+        }
+        if (emitted[type]) {
+            continue;
+        }
+        emitted[type] = true;
+
+        // The whole group goes where its first frame was; order within a
+        // type is kept
+        group.clear();
+        for (size_t g = at; g + wire::HEADER_SIZE <= frames.size(); g += frameLength(&frames[g])) {
+            if (frames[g + 1] == type) {
+                group.insert(group.end(), frames.begin() + g, frames.begin() + g + frameLength(&frames[g]));
+            }
+        }
+
+        const size_t start = packet.size();
+        packet.resize(start + wire::HEADER_SIZE + ZSTD_compressBound(group.size()));
+        uint8_t* body = packet.data() + start + wire::HEADER_SIZE;
+        const size_t capacity = packet.size() - start - wire::HEADER_SIZE;
+        const auto& dictionary = dictionaries[type];
+        const size_t n = dictionary
+            ? ZSTD_compress_usingCDict(threadCCtx(), body, capacity, group.data(), group.size(), dictionary->cdict)
+            : ZSTD_compressCCtx(threadCCtx(), body, capacity, group.data(), group.size(), config_.level);
+
+        if (ZSTD_isError(n) || wire::HEADER_SIZE + n >= group.size()) {
+            // Did not shrink; the frames travel as they are
+            packet.resize(start);
+            packet.insert(packet.end(), group.begin(), group.end());
+            continue;
+        }
+        packet.resize(start + wire::HEADER_SIZE + n);
+        wire::writeHeader(packet.data() + start, type, wire::BATCH | wire::COMPRESSED,
+                          {packet.data() + start + wire::HEADER_SIZE, n});
+    }
+    return packet;
+}
+
+bool FrameBatcher::unpack(std::span<const uint8_t> packet, std::vector<uint8_t>& scratch,
+                          const std::function<void(const wire::Frame& frame)>& fn) {
+    wire::Frame frame;
+    while (!packet.empty()) {
+        if (wire::decodeFrame(packet, frame) != wire::Status::Ok) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.unpack_errors;
+            return false;
+        }
+        packet = packet.subspan(frame.size());
+        if (frame.header.flags & wire::BATCH) {
+            if (!unpackFrame(frame, scratch, fn)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++stats_.unpack_errors;
+                return false;
+            }
+        } else {
+            fn(frame);
+        }
+    }
+    return true;
+}
+
+bool FrameBatcher::unpackFrame(const wire::Frame& batch, std::vector<uint8_t>& scratch,
+                               const std::function<void(const wire::Frame& frame)>& fn) {
+    std::span<const uint8_t> inner = batch.payload;
+    // Decompression and validation only; delivery is the handlers' cost
+    std::optional<utils::PerfScope> perf(std::in_place, utils::PerfStage::NetworkDecode);
+    if (batch.header.flags & wire::COMPRESSED) {
+        const uint8_t* src = batch.payload.data();
+        const size_t size = batch.payload.size();
+        const unsigned long long content = ZSTD_getFrameContentSize(src, size);
+        if (content == ZSTD_CONTENTSIZE_ERROR || content == ZSTD_CONTENTSIZE_UNKNOWN ||
+            content > config_.max_unpacked_bytes) {
+            return false;
+        }
+
+        DictionaryPtr dictionary;
+        if (const unsigned id = ZSTD_getDictID_fromFrame(src, size); id != 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = known_.find(id);
+            if (it == known_.end()) {
+                return false;
+            }
+            dictionary = it->second;
+        }
+
+        scratch.resize(static_cast<size_t>(content));
+        const size_t n = dictionary
+            ? ZSTD_decompress_usingDDict(threadDCtx(), scratch.data(), scratch.size(), src, size, dictionary->ddict)
+            : ZSTD_decompressDCtx(threadDCtx(), scratch.data(), scratch.size(), src, size);
+        if (ZSTD_isError(n) || n != scratch.size()) {
+            return false;
+        }
+        inner = scratch;
+    }
+
+    // Validate every inner frame before delivering any of them
+    wire::Frame frame;
+    for (auto rest = inner; !rest.empty(); rest = rest.subspan(frame.size())) {
+        if (wire::decodeFrame(rest, frame) != wire::Status::Ok || (frame.header.flags & wire::BATCH)) {
+            return false;
+        }
+    }
+    perf.reset();
+    for (auto rest = inner; !rest.empty(); rest = rest.subspan(frame.size())) {
+        wire::decodeFrame(rest, frame);
+        fn(frame);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.batches_unpacked;
+    return true;
+}
+
+void FrameBatcher::setDictionary(uint8_t type, const std::vector<uint8_t>& dictionary) {
+    DictionaryPtr loaded = dictionary.empty() ? nullptr : std::make_shared<const Dictionary>(dictionary, config_.level);
+    std::lock_guard<std::mutex> lock(mutex_);
+    dictionaries_[type] = loaded;
+    if (loaded) {
+        known_.emplace(loaded->id, loaded);
+    }
+}
+
+std::vector<uint8_t> FrameBatcher::trainDictionary(const std::vector<std::vector<uint8_t>>& samples,
+                                                   size_t capacity) {
+    if (samples.empty()) {
+        throw std::invalid_argument("no samples to train a frame dictionary on");
+    }
+    std::vector<uint8_t> joined;
+    std::vector<size_t> sizes;
+    for (const auto& sample : samples) {
+        joined.insert(joined.end(), sample.begin(), sample.end());
+        sizes.push_back(sample.size());
+    }
+    std::vector<uint8_t> dictionary(capacity);
+    const size_t size = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), joined.data(),
+                                              sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size)) {
+        throw std::runtime_error(std::string("frame dictionary training failed: ") + ZDICT_getErrorName(size));
+    }
+    dictionary.resize(size);
+    return dictionary;
+}
+
+FrameBatcher::Stats FrameBatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace quids::network
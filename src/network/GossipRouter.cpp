@@ -0,0 +1,667 @@
+#include "network/GossipRouter.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace quids::network {
+
+namespace {
+
+constexpr size_t TOPIC_LIMIT = UINT16_MAX;
+constexpr size_t ID_SIZE = std::tuple_size_v<GossipRouter::MessageId>;
+
+void putU16(std::vector<uint8_t>& out, size_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void putU32(std::vector<uint8_t>& out, size_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+// Bounds-checked little-endian reader over one frame
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> data) : data_(data) {}
+
+    std::optional<size_t> u8() { return read(1); }
+    std::optional<size_t> u16() { return read(2); }
+    std::optional<size_t> u32() { return read(4); }
+
+    std::optional<std::span<const uint8_t>> bytes(size_t n) {
+        if (data_.size() - offset_ < n) {
+            return std::nullopt;
+        }
+        auto out = data_.subspan(offset_, n);
+        offset_ += n;
+        return out;
+    }
+
+    std::optional<std::string> topic() {
+        auto length = u16();
+        if (!length) {
+            return std::nullopt;
+        }
+        auto raw = bytes(*length);
+        if (!raw) {
+            return std::nullopt;
+        }
+        return std::string(raw->begin(), raw->end());
+    }
+
+    [[nodiscard]] bool done() const noexcept { return offset_ == data_.size(); }
+
+private:
+    std::optional<size_t> read(size_t width) {
+        if (data_.size() - offset_ < width) {
+            return std::nullopt;
+        }
+        size_t value = 0;
+        for (size_t i = 0; i < width; ++i) {
+            value |= static_cast<size_t>(data_[offset_ + i]) << (8 * i);
+        }
+        offset_ += width;
+        return value;
+    }
+
+    std::span<const uint8_t> data_;
+    size_t offset_{0};
+};
+
+} // namespace
+
+size_t GossipRouter::MessageIdHash::operator()(const MessageId& id) const noexcept {
+    // Ids are BLAKE3 output, so any eight bytes are already uniform
+    size_t value;
+    std::memcpy(&value, id.data(), sizeof(value));
+    return value;
+}
+
+GossipRouter::SeenFilter::SeenFilter(size_t bits) {
+    size_t rounded = 64;
+    while (rounded < bits) {
+        rounded <<= 1;
+    }
+    mask_ = rounded - 1;
+    current_.assign(rounded / 64, 0);
+    previous_.assign(rounded / 64, 0);
+}
+
+bool GossipRouter::SeenFilter::contains(const MessageId& id) const noexcept {
+    bool in_current = true;
+    bool in_previous = true;
+    for (size_t probe = 0; probe < PROBES; ++probe) {
+        uint32_t word;
+        std::memcpy(&word, id.data() + 8 + probe * sizeof(word), sizeof(word));
+        const size_t bit = word & mask_;
+        in_current = in_current && (current_[bit / 64] >> (bit % 64) & 1) != 0;
+        in_previous = in_previous && (previous_[bit / 64] >> (bit % 64) & 1) != 0;
+    }
+    return in_current || in_previous;
+}
+
+void GossipRouter::SeenFilter::insert(const MessageId& id) noexcept {
+    for (size_t probe = 0; probe < PROBES; ++probe) {
+        uint32_t word;
+        std::memcpy(&word, id.data() + 8 + probe * sizeof(word), sizeof(word));
+        const size_t bit = word & mask_;
+        current_[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+}
+
+void GossipRouter::SeenFilter::rotate() noexcept {
+    std::swap(current_, previous_);
+    std::fill(current_.begin(), current_.end(), 0);
+}
+
+GossipRouter::GossipRouter(const Config& config, Send send, std::shared_ptr<PeerScoreBook> scores)
+    : config_(config),
+      send_(std::move(send)),
+      scores_(std::move(scores)),
+      rng_(config.seed, 0),
+      seen_(config.seen_filter_bits) {
+    if (config.degree_low > config.degree || config.degree > config.degree_high ||
+        config.history_gossip > config.history_length || config.history_length == 0 ||
+        config.degree_score > config.degree) {
+        throw std::invalid_argument("inconsistent gossip configuration");
+    }
+    history_.emplace_front();
+}
+
+GossipRouter::MessageId GossipRouter::messageId(const std::string& topic, std::span<const uint8_t> payload) {
+    std::vector<uint8_t> prefix;
+    putU16(prefix, topic.size());
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, prefix.data(), prefix.size());
+    blake3_hasher_update(&hasher, topic.data(), topic.size());
+    blake3_hasher_update(&hasher, payload.data(), payload.size());
+    MessageId id;
+    blake3_hasher_finalize(&hasher, id.data(), id.size());
+    return id;
+}
+
+std::vector<uint8_t> GossipRouter::topicFrame(FrameKind kind, const std::string& topic) {
+    std::vector<uint8_t> frame;
+    frame.reserve(3 + topic.size());
+    frame.push_back(static_cast<uint8_t>(kind));
+    putU16(frame, topic.size());
+    frame.insert(frame.end(), topic.begin(), topic.end());
+    return frame;
+}
+
+std::vector<uint8_t> GossipRouter::publishFrame(const std::string& topic, std::span<const uint8_t> payload) {
+    auto frame = topicFrame(FrameKind::Publish, topic);
+    frame.reserve(frame.size() + 4 + payload.size());
+    putU32(frame, payload.size());
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return frame;
+}
+
+std::vector<uint8_t> GossipRouter::idsFrame(FrameKind kind, const std::string& topic,
+                                            const std::vector<MessageId>& ids) {
+    auto frame = topicFrame(kind, topic);
+    frame.reserve(frame.size() + 2 + ids.size() * ID_SIZE);
+    putU16(frame, ids.size());
+    for (const auto& id : ids) {
+        frame.insert(frame.end(), id.begin(), id.end());
+    }
+    return frame;
+}
+
+void GossipRouter::account(const std::vector<Outgoing>& out) {
+    for (const auto& outgoing : out) {
+        ++stats_.frames_sent;
+        stats_.bytes_sent += outgoing.frame.size();
+    }
+}
+
+void GossipRouter::flush(std::vector<Outgoing>& out) {
+    for (auto& outgoing : out) {
+        send_(outgoing.peer, std::move(outgoing.frame));
+    }
+    out.clear();
+}
+
+std::vector<GossipRouter::PeerID> GossipRouter::peersOnTopic(const std::string& topic,
+                                                            const std::unordered_set<PeerID>& exclude) const {
+    std::vector<PeerID> peers;
+    for (const auto& [peer, topics] : peer_topics_) {
+        if (topics.count(topic) != 0 && exclude.count(peer) == 0) {
+            peers.push_back(peer);
+        }
+    }
+    // Sorted so a seeded router picks the same peers on every run
+    std::sort(peers.begin(), peers.end());
+    return peers;
+}
+
+double GossipRouter::scoreOf(const PeerID& peer) const {
+    return scores_ ? scores_->score(peer) : 0.0;
+}
+
+void GossipRouter::rankByScore(std::vector<PeerID>& peers) {
+    rng_.shuffle(peers.begin(), peers.end());
+    if (!scores_) {
+        return;
+    }
+    std::vector<std::pair<double, PeerID>> ranked;
+    ranked.reserve(peers.size());
+    for (auto& peer : peers) {
+        ranked.emplace_back(scores_->score(peer), std::move(peer));
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        peers[i] = std::move(ranked[i].second);
+    }
+}
+
+void GossipRouter::forward(const std::string& topic, const MessageId& id,
+                           const std::shared_ptr<const std::vector<uint8_t>>& payload, const PeerID* except,
+                           std::vector<Outgoing>& out) {
+    std::vector<PeerID> targets;
+    if (auto mesh = meshes_.find(topic); mesh != meshes_.end()) {
+        targets.assign(mesh->second.begin(), mesh->second.end());
+    } else {
+        // Not subscribed: fan out to a mesh-sized sample of subscribers
+        targets = peersOnTopic(topic, {});
+        rng_.shuffle(targets.begin(), targets.end());
+        targets.resize(std::min(targets.size(), config_.degree));
+    }
+    if (targets.empty()) {
+        return;
+    }
+    if (config_.announce_topics.count(topic) != 0) {
+        for (const auto& peer : targets) {
+            if (except == nullptr || peer != *except) {
+                announcements_[peer][topic].push_back(id);
+                ++stats_.announced;
+            }
+        }
+        return;
+    }
+    const auto frame = publishFrame(topic, *payload);
+    for (auto& peer : targets) {
+        if (except == nullptr || peer != *except) {
+            out.push_back({std::move(peer), frame});
+        }
+    }
+}
+
+bool GossipRouter::accept(const std::string& topic, const MessageId& id, std::span<const uint8_t> payload,
+                          const PeerID& from, std::vector<Outgoing>& out, std::vector<Delivery>& deliveries) {
+    if (seen_.contains(id)) {
+        ++stats_.duplicates;
+        if (scores_) {
+            scores_->recordDelivery(from, payload.size(), false);
+        }
+        return false;
+    }
+    seen_.insert(id);
+    pulls_.erase(id);
+    if (scores_) {
+        scores_->recordDelivery(from, payload.size(), true);
+    }
+
+    auto stored = std::make_shared<const std::vector<uint8_t>>(payload.begin(), payload.end());
+    cache_.emplace(id, CachedMessage{topic, stored});
+    history_.front().push_back(id);
+
+    auto subscription = subscriptions_.find(topic);
+    if (subscription == subscriptions_.end()) {
+        return true;
+    }
+    ++stats_.delivered;
+    deliveries.push_back({subscription->second, topic, stored, from});
+    forward(topic, id, stored, &from, out);
+    return true;
+}
+
+void GossipRouter::subscribe(const std::string& topic, Handler handler) {
+    if (topic.size() > TOPIC_LIMIT) {
+        throw std::invalid_argument("gossip topic too long");
+    }
+    std::vector<Outgoing> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const bool joined = subscriptions_.count(topic) == 0;
+        subscriptions_[topic] = std::move(handler);
+        if (joined) {
+            for (const auto& [peer, _] : peer_topics_) {
+                out.push_back({peer, topicFrame(FrameKind::Subscribe, topic)});
+            }
+            meshes_[topic];
+            maintainMesh(topic, out);
+        }
+        account(out);
+    }
+    flush(out);
+}
+
+void GossipRouter::unsubscribe(const std::string& topic) {
+    std::vector<Outgoing> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (subscriptions_.erase(topic) == 0) {
+            return;
+        }
+        for (const auto& peer : meshes_[topic]) {
+            out.push_back({peer, topicFrame(FrameKind::Prune, topic)});
+        }
+        meshes_.erase(topic);
+        for (const auto& [peer, _] : peer_topics_) {
+            out.push_back({peer, topicFrame(FrameKind::Unsubscribe, topic)});
+        }
+        account(out);
+    }
+    flush(out);
+}
+
+bool GossipRouter::publish(const std::string& topic, std::span<const uint8_t> payload) {
+    if (topic.size() > TOPIC_LIMIT || payload.size() > UINT32_MAX) {
+        throw std::invalid_argument("gossip message too large");
+    }
+    const MessageId id = messageId(topic, payload);
+    std::vector<Outgoing> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (seen_.contains(id)) {
+            ++stats_.duplicates;
+            return false;
+        }
+        seen_.insert(id);
+        ++stats_.published;
+
+        auto stored = std::make_shared<const std::vector<uint8_t>>(payload.begin(), payload.end());
+        cache_.emplace(id, CachedMessage{topic, stored});
+        history_.front().push_back(id);
+        forward(topic, id, stored, nullptr, out);
+
+        account(out);
+    }
+    flush(out);
+    return true;
+}
+
+void GossipRouter::addPeer(const PeerID& peer) {
+    std::vector<Outgoing> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!peer_topics_.emplace(peer, std::unordered_set<std::string>{}).second) {
+            return;
+        }
+        for (const auto& [topic, _] : subscriptions_) {
+            out.push_back({peer, topicFrame(FrameKind::Subscribe, topic)});
+        }
+        account(out);
+    }
+    flush(out);
+}
+
+void GossipRouter::removePeer(const PeerID& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    peer_topics_.erase(peer);
+    announcements_.erase(peer);
+    for (auto& [_, mesh] : meshes_) {
+        mesh.erase(peer);
+    }
+    // A pull waiting on this peer moves on at the next flush
+    for (auto& [_, pull] : pulls_) {
+        std::erase(pull.announcers, peer);
+        if (pull.asked == peer) {
+            pull.asked.clear();
+        }
+    }
+}
+
+void GossipRouter::handleFrame(const PeerID& from, std::span<const uint8_t> frame) {
+    const bool graylisted = scores_ && scores_->score(from) < scores_->config().graylist_threshold;
+    std::vector<Outgoing> out;
+    std::vector<Delivery> deliveries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (graylisted) {
+            ++stats_.graylisted;
+            return;
+        }
+        // Every malformed frame below counts against the sender
+        auto malformed = [&] {
+            ++stats_.malformed;
+            if (scores_) {
+                scores_->recordInvalid(from);
+            }
+        };
+        Reader reader(frame);
+        const auto kind = reader.u8();
+        auto topic = reader.topic();
+        if (!kind || !topic) {
+            malformed();
+            return;
+        }
+
+        switch (static_cast<FrameKind>(*kind)) {
+        case FrameKind::Publish: {
+            const auto length = reader.u32();
+            const auto payload = length ? reader.bytes(*length) : std::nullopt;
+            if (!payload || !reader.done()) {
+                malformed();
+                return;
+            }
+            // The id is recomputed, never taken from the sender
+            accept(*topic, messageId(*topic, *payload), *payload, from, out, deliveries);
+            break;
+        }
+        case FrameKind::IHave:
+        case FrameKind::IWant: {
+            const auto count = reader.u16();
+            const auto raw = count ? reader.bytes(*count * ID_SIZE) : std::nullopt;
+            if (!raw || !reader.done()) {
+                malformed();
+                return;
+            }
+            const bool ihave = static_cast<FrameKind>(*kind) == FrameKind::IHave;
+            if (ihave && subscriptions_.count(*topic) == 0) {
+                break;
+            }
+            // On announce topics, ids already being pulled wait their turn
+            const bool announced = ihave && config_.announce_topics.count(*topic) != 0;
+            std::vector<MessageId> wanted;
+            for (size_t i = 0; i < *count && i < config_.max_ihave_ids; ++i) {
+                MessageId id;
+                std::memcpy(id.data(), raw->data() + i * ID_SIZE, ID_SIZE);
+                if (ihave) {
+                    if (seen_.contains(id)) {
+                        continue;
+                    }
+                    if (announced) {
+                        auto [pull, added] = pulls_.try_emplace(id, Pull{*topic, flushes_, from, {}});
+                        if (!added) {
+                            if (pull->second.announcers.size() < config_.degree_high) {
+                                pull->second.announcers.push_back(from);
+                            }
+                            continue;
+                        }
+                    }
+                    wanted.push_back(id);
+                } else if (auto cached = cache_.find(id); cached != cache_.end()) {
+                    out.push_back({from, publishFrame(cached->second.topic, *cached->second.payload)});
+                }
+            }
+            if (!wanted.empty()) {
+                out.push_back({from, idsFrame(FrameKind::IWant, *topic, wanted)});
+                ++stats_.iwant_sent;
+            }
+            break;
+        }
+        case FrameKind::Graft:
+            if (subscriptions_.count(*topic) != 0 &&
+                (!scores_ || scoreOf(from) >= scores_->config().mesh_threshold)) {
+                meshes_[*topic].insert(from);
+                peer_topics_[from].insert(*topic);
+            } else {
+                out.push_back({from, topicFrame(FrameKind::Prune, *topic)});
+            }
+            break;
+        case FrameKind::Prune:
+            if (auto mesh = meshes_.find(*topic); mesh != meshes_.end()) {
+                mesh->second.erase(from);
+            }
+            break;
+        case FrameKind::Subscribe:
+            peer_topics_[from].insert(*topic);
+            break;
+        case FrameKind::Unsubscribe:
+            peer_topics_[from].erase(*topic);
+            if (auto mesh = meshes_.find(*topic); mesh != meshes_.end()) {
+                mesh->second.erase(from);
+            }
+            break;
+        default:
+            malformed();
+            return;
+        }
+
+        account(out);
+    }
+    flush(out);
+    for (const auto& delivery : deliveries) {
+        delivery.handler(delivery.topic, *delivery.payload, delivery.from);
+    }
+}
+
+void GossipRouter::maintainMesh(const std::string& topic, std::vector<Outgoing>& out) {
+    auto& mesh = meshes_[topic];
+    const double threshold = scores_ ? scores_->config().mesh_threshold : 0.0;
+    for (auto it = mesh.begin(); it != mesh.end();) {
+        auto peer = peer_topics_.find(*it);
+        if (peer == peer_topics_.end() || peer->second.count(topic) == 0) {
+            it = mesh.erase(it);
+        } else if (scores_ && scoreOf(*it) < threshold) {
+            out.push_back({*it, topicFrame(FrameKind::Prune, topic)});
+            it = mesh.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (mesh.size() < config_.degree_low) {
+        auto candidates = peersOnTopic(topic, mesh);
+        rankByScore(candidates);
+        for (auto& peer : candidates) {
+            if (mesh.size() >= config_.degree || (scores_ && scoreOf(peer) < threshold)) {
+                break;
+            }
+            out.push_back({peer, topicFrame(FrameKind::Graft, topic)});
+            mesh.insert(std::move(peer));
+        }
+    } else if (mesh.size() > config_.degree_high) {
+        std::vector<PeerID> members(mesh.begin(), mesh.end());
+        std::sort(members.begin(), members.end());
+        rankByScore(members);
+        // The best degree_score stay; the other kept slots go to a random
+        // draw from the rest
+        rng_.shuffle(members.begin() + static_cast<std::ptrdiff_t>(config_.degree_score), members.end());
+        for (size_t i = config_.degree; i < members.size(); ++i) {
+            out.push_back({members[i], topicFrame(FrameKind::Prune, topic)});
+            mesh.erase(members[i]);
+        }
+    }
+}
+
+void GossipRouter::emitGossip(const std::string& topic, std::vector<Outgoing>& out) {
+    std::vector<MessageId> ids;
+    for (size_t window = 0; window < config_.history_gossip && window < history_.size(); ++window) {
+        for (const auto& id : history_[window]) {
+            auto cached = cache_.find(id);
+            if (cached != cache_.end() && cached->second.topic == topic) {
+                ids.push_back(id);
+            }
+        }
+    }
+    if (ids.empty()) {
+        return;
+    }
+    if (ids.size() > config_.max_ihave_ids) {
+        // Windows run newest first, so this keeps the most recent ids
+        ids.resize(config_.max_ihave_ids);
+    }
+
+    auto targets = peersOnTopic(topic, meshes_[topic]);
+    if (scores_) {
+        const double threshold = scores_->config().gossip_threshold;
+        targets.erase(std::remove_if(targets.begin(), targets.end(),
+                                     [&](const PeerID& peer) { return scoreOf(peer) < threshold; }),
+                      targets.end());
+    }
+    rng_.shuffle(targets.begin(), targets.end());
+    targets.resize(std::min(targets.size(), config_.degree_lazy));
+    if (targets.empty()) {
+        return;
+    }
+    const auto frame = idsFrame(FrameKind::IHave, topic, ids);
+    for (auto& peer : targets) {
+        out.push_back({std::move(peer), frame});
+        ++stats_.ihave_sent;
+    }
+}
+
+void GossipRouter::heartbeat() {
+    std::vector<Outgoing> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [topic, _] : subscriptions_) {
+            maintainMesh(topic, out);
+            emitGossip(topic, out);
+        }
+
+        history_.emplace_front();
+        while (history_.size() > config_.history_length) {
+            for (const auto& id : history_.back()) {
+                cache_.erase(id);
+            }
+            history_.pop_back();
+        }
+        if (++heartbeats_ % config_.seen_rotation == 0) {
+            seen_.rotate();
+        }
+
+        account(out);
+    }
+    flush(out);
+}
+
+void GossipRouter::flushAnnouncements() {
+    std::vector<Outgoing> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++flushes_;
+        auto send_ids = [&](FrameKind kind, const PeerID& peer, const std::string& topic,
+                            const std::vector<MessageId>& ids) {
+            for (size_t begin = 0; begin < ids.size(); begin += config_.max_ihave_ids) {
+                const auto end = ids.begin() + static_cast<std::ptrdiff_t>(
+                    std::min(ids.size(), begin + config_.max_ihave_ids));
+                std::vector<MessageId> batch(ids.begin() + static_cast<std::ptrdiff_t>(begin), end);
+                out.push_back({peer, idsFrame(kind, topic, batch)});
+                ++(kind == FrameKind::IHave ? stats_.ihave_sent : stats_.iwant_sent);
+            }
+        };
+
+        for (const auto& [peer, topics] : announcements_) {
+            for (const auto& [topic, ids] : topics) {
+                send_ids(FrameKind::IHave, peer, topic, ids);
+            }
+        }
+        announcements_.clear();
+
+        // Pulls nobody answered, or whose peer was removed, go to the next
+        // announcer, or are dropped once there is none; a later IHAVE
+        // starts them over
+        std::unordered_map<PeerID, std::unordered_map<std::string, std::vector<MessageId>>> retries;
+        for (auto it = pulls_.begin(); it != pulls_.end();) {
+            auto& pull = it->second;
+            if (!pull.asked.empty() && flushes_ - pull.requested_at < config_.pull_timeout) {
+                ++it;
+            } else if (pull.announcers.empty()) {
+                it = pulls_.erase(it);
+            } else {
+                retries[pull.announcers.front()][pull.topic].push_back(it->first);
+                pull.asked = std::move(pull.announcers.front());
+                pull.announcers.pop_front();
+                pull.requested_at = flushes_;
+                ++stats_.pull_retries;
+                ++it;
+            }
+        }
+        for (const auto& [peer, topics] : retries) {
+            for (const auto& [topic, ids] : topics) {
+                send_ids(FrameKind::IWant, peer, topic, ids);
+            }
+        }
+
+        account(out);
+    }
+    flush(out);
+}
+
+std::vector<GossipRouter::PeerID> GossipRouter::meshPeers(const std::string& topic) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto mesh = meshes_.find(topic);
+    if (mesh == meshes_.end()) {
+        return {};
+    }
+    std::vector<PeerID> peers(mesh->second.begin(), mesh->second.end());
+    std::sort(peers.begin(), peers.end());
+    return peers;
+}
+
+GossipRouter::Stats GossipRouter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace quids::network
@@ -0,0 +1,199 @@
+#include "network/IceAgent.hpp"
+#include "common/Logger.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+
+namespace quids::network {
+
+namespace {
+
+// RFC 8445 limits the checklist to 100 pairs by default
+constexpr size_t MAX_PAIRS = 100;
+
+uint32_t type_preference(IceCandidate::Type type) {
+    switch (type) {
+    case IceCandidate::Type::Host:
+        return 126;
+    case IceCandidate::Type::PortMapped:
+        // A mapping on the gateway itself beats what a STUN server saw
+        return 110;
+    case IceCandidate::Type::ServerReflexive:
+        return 100;
+    case IceCandidate::Type::Relayed:
+        return 0;
+    }
+    return 0;
+}
+
+} // namespace
+
+uint32_t IceCandidate::compute_priority(Type type, uint16_t local_preference) {
+    constexpr uint32_t component = 1;
+    return (type_preference(type) << 24) | (uint32_t{local_preference} << 8) | (256 - component);
+}
+
+IceCandidate IceCandidate::make(Type type, std::string address, uint16_t port, uint16_t local_preference) {
+    return {type, std::move(address), port, compute_priority(type, local_preference)};
+}
+
+uint64_t IceCandidatePair::compute_priority(const IceCandidate& local, const IceCandidate& remote) {
+    const uint64_t g = local.priority;
+    const uint64_t d = remote.priority;
+    return (std::min(g, d) << 32) + 2 * std::max(g, d) + (g > d ? 1 : 0);
+}
+
+IceAgent::IceAgent() : IceAgent(Config{}) {}
+
+IceAgent::IceAgent(const Config& config) : config_(config) {}
+
+void IceAgent::add_gatherer(std::string name, Gatherer gatherer) {
+    gatherers_.emplace_back(std::move(name), std::move(gatherer));
+}
+
+std::vector<IceCandidate> IceAgent::gather() const {
+    struct Gathering {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::vector<IceCandidate> found;
+        size_t pending{0};
+    };
+    auto state = std::make_shared<Gathering>();
+    state->pending = gatherers_.size();
+
+    const auto deadline = Clock::now() + config_.gather_timeout;
+    for (const auto& [name, gatherer] : gatherers_) {
+        // Detached: a source past the deadline only touches `state`
+        std::thread([state, name = name, gatherer = gatherer] {
+            std::vector<IceCandidate> candidates;
+            try {
+                candidates = gatherer();
+            } catch (const std::exception& e) {
+                QUIDS_LOG_DEBUG("ICE gatherer {} failed: {}", name, e.what());
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->found.insert(state->found.end(), candidates.begin(), candidates.end());
+            --state->pending;
+            state->done.notify_all();
+        }).detach();
+    }
+
+    std::vector<IceCandidate> candidates;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait_until(lock, deadline, [&] { return state->pending == 0; });
+        candidates = state->found;
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const IceCandidate& a, const IceCandidate& b) {
+        return a.priority > b.priority;
+    });
+    std::vector<IceCandidate> unique;
+    for (auto& candidate : candidates) {
+        const bool duplicate = std::any_of(unique.begin(), unique.end(), [&](const IceCandidate& kept) {
+            return kept.address == candidate.address && kept.port == candidate.port;
+        });
+        if (!duplicate) {
+            unique.push_back(std::move(candidate));
+        }
+    }
+    return unique;
+}
+
+std::vector<IceCandidatePair> IceAgent::pair(const std::vector<IceCandidate>& local,
+                                             const std::vector<IceCandidate>& remote) {
+    std::vector<IceCandidatePair> pairs;
+    pairs.reserve(local.size() * remote.size());
+    for (const auto& l : local) {
+        for (const auto& r : remote) {
+            pairs.push_back({l, r, IceCandidatePair::compute_priority(l, r)});
+        }
+    }
+    std::stable_sort(pairs.begin(), pairs.end(), [](const IceCandidatePair& a, const IceCandidatePair& b) {
+        return a.priority > b.priority;
+    });
+    if (pairs.size() > MAX_PAIRS) {
+        pairs.resize(MAX_PAIRS);
+    }
+    return pairs;
+}
+
+std::optional<IceCandidatePair> IceAgent::race(const std::vector<IceCandidatePair>& pairs, const Check& check) const {
+    if (pairs.empty()) {
+        return std::nullopt;
+    }
+    struct Race {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::optional<IceCandidatePair> winner;
+        size_t pending{0};
+        std::atomic<bool> cancelled{false};
+    };
+    auto state = std::make_shared<Race>();
+    state->pending = pairs.size();
+
+    const auto start = Clock::now();
+    const auto deadline = start + config_.check_timeout;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        const auto begin = start + config_.check_pacing * static_cast<int64_t>(i);
+        std::thread([state, check, pair = pairs[i], begin, deadline] {
+            bool started = false;
+            {
+                // Paced in priority order, unless a better pair already won
+                std::unique_lock<std::mutex> lock(state->mutex);
+                started = !state->changed.wait_until(lock, begin, [&] { return state->cancelled.load(); });
+            }
+            bool ok = false;
+            if (started) {
+                try {
+                    ok = check(pair, state->cancelled, deadline);
+                } catch (const std::exception& e) {
+                    QUIDS_LOG_DEBUG("ICE check to {}:{} failed: {}", pair.remote.address, pair.remote.port, e.what());
+                }
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (ok && !state->winner) {
+                state->winner = pair;
+                state->cancelled = true;
+            }
+            --state->pending;
+            state->changed.notify_all();
+        }).detach();
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->changed.wait_until(lock, deadline, [&] { return state->winner.has_value() || state->pending == 0; });
+    state->cancelled = true;
+    state->changed.notify_all();
+    return state->winner;
+}
+
+std::optional<IceCandidatePair> IceAgent::connect(const std::string& peer, const std::vector<IceCandidate>& remote,
+                                                  const Check& check) {
+    if (auto pair = cached(peer)) {
+        return pair;
+    }
+    auto winner = race(pair(gather(), remote), check);
+    if (winner) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        cache_[peer] = {*winner, Clock::now() + config_.cache_ttl};
+    }
+    return winner;
+}
+
+std::optional<IceCandidatePair> IceAgent::cached(const std::string& peer) const {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = cache_.find(peer);
+    if (it == cache_.end() || it->second.expires <= Clock::now()) {
+        return std::nullopt;
+    }
+    return it->second.pair;
+}
+
+void IceAgent::forget(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_.erase(peer);
+}
+
+} // namespace quids::network
@@ -0,0 +1,221 @@
+#include "network/MessageDispatcher.hpp"
+#include "common/Logger.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace quids::network {
+
+namespace {
+
+constexpr size_t index(MessageDispatcher::Priority priority) {
+    return static_cast<size_t>(priority);
+}
+
+} // namespace
+
+MessageDispatcher::MessageDispatcher(const Config& config)
+    : config_(config), table_(std::make_shared<const Table>()) {
+    if (config_.queue_capacity == 0 || config_.drain_batch == 0 ||
+        std::find(config_.workers.begin(), config_.workers.end(), 0) != config_.workers.end()) {
+        // A class without workers would never be drained
+        throw std::invalid_argument("message dispatcher needs workers, queue room and a drain batch");
+    }
+}
+
+MessageDispatcher::~MessageDispatcher() {
+    stop();
+}
+
+MessageDispatcher::TopicId MessageDispatcher::intern(const std::string& topic) {
+    if (auto id = find(topic)) {
+        return *id;
+    }
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    auto current = table_.load(std::memory_order_acquire);
+    if (auto it = current->ids.find(topic); it != current->ids.end()) {
+        return it->second;
+    }
+    auto next = std::make_shared<Table>(*current);
+    const auto id = static_cast<TopicId>(next->routes.size());
+    next->ids.emplace(topic, id);
+    next->routes.push_back(Route{std::make_shared<Queue>(), Priority::Transactions, {}});
+    table_.store(std::move(next), std::memory_order_release);
+    return id;
+}
+
+std::optional<MessageDispatcher::TopicId> MessageDispatcher::find(const std::string& topic) const {
+    auto current = table_.load(std::memory_order_acquire);
+    auto it = current->ids.find(topic);
+    if (it == current->ids.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void MessageDispatcher::setHandler(TopicId topic, Priority priority, Handler handler) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    auto current = table_.load(std::memory_order_acquire);
+    if (topic >= current->routes.size()) {
+        throw std::out_of_range("topic was not interned");
+    }
+    auto next = std::make_shared<Table>(*current);
+    next->routes[topic].priority = priority;
+    next->routes[topic].handler = std::move(handler);
+    table_.store(std::move(next), std::memory_order_release);
+}
+
+bool MessageDispatcher::dispatch(TopicId topic, std::vector<uint8_t> payload, std::string from) {
+    auto table = table_.load(std::memory_order_acquire);
+    if (topic >= table->routes.size()) {
+        throw std::out_of_range("topic was not interned");
+    }
+    const Route& route = table->routes[topic];
+    Lane& lane = lanes_[index(route.priority)];
+    if (!route.handler) {
+        lane.unrouted.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (!running_.load(std::memory_order_acquire)) {
+        lane.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(route.queue->mutex);
+        if (route.queue->messages.size() >= config_.queue_capacity) {
+            lane.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        route.queue->messages.push_back({std::move(payload), std::move(from)});
+        wake = !route.queue->scheduled;
+        route.queue->scheduled = true;
+    }
+    lane.queued.fetch_add(1, std::memory_order_relaxed);
+    if (wake) {
+        schedule(topic, route.priority);
+    }
+    return true;
+}
+
+void MessageDispatcher::schedule(TopicId topic, Priority priority) {
+    Lane& lane = lanes_[index(priority)];
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.ready.push_back(topic);
+    }
+    lane.ready_cv.notify_one();
+}
+
+void MessageDispatcher::start() {
+    if (running_.load(std::memory_order_acquire)) return;
+
+    // Messages that slipped in while stopping go first
+    for (Lane& lane : lanes_) {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.ready.clear();
+    }
+    auto table = table_.load(std::memory_order_acquire);
+    for (TopicId topic = 0; topic < table->routes.size(); ++topic) {
+        const Route& route = table->routes[topic];
+        std::lock_guard<std::mutex> lock(route.queue->mutex);
+        route.queue->scheduled = !route.queue->messages.empty();
+        if (route.queue->scheduled) {
+            Lane& lane = lanes_[index(route.priority)];
+            std::lock_guard<std::mutex> lane_lock(lane.mutex);
+            lane.ready.push_back(topic);
+        }
+    }
+    running_.store(true, std::memory_order_release);
+
+    for (size_t i = 0; i < PRIORITY_COUNT; ++i) {
+        Lane& lane = lanes_[i];
+        for (size_t n = 0; n < config_.workers[i]; ++n) {
+            lane.workers.emplace_back([this, &lane]() { work(lane); });
+        }
+    }
+}
+
+void MessageDispatcher::stop() {
+    if (!running_.exchange(false)) return;
+
+    for (Lane& lane : lanes_) {
+        {
+            // Workers check running_ under this lock before waiting
+            std::lock_guard<std::mutex> lock(lane.mutex);
+        }
+        lane.ready_cv.notify_all();
+        for (auto& worker : lane.workers) {
+            worker.join();
+        }
+        lane.workers.clear();
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.ready.clear();
+    }
+
+    auto table = table_.load(std::memory_order_acquire);
+    for (const Route& route : table->routes) {
+        std::lock_guard<std::mutex> lock(route.queue->mutex);
+        lanes_[index(route.priority)].dropped.fetch_add(route.queue->messages.size(), std::memory_order_relaxed);
+        route.queue->messages.clear();
+        route.queue->scheduled = false;
+    }
+}
+
+void MessageDispatcher::work(Lane& lane) {
+    std::vector<Message> batch;
+    for (;;) {
+        TopicId topic = 0;
+        {
+            std::unique_lock<std::mutex> lock(lane.mutex);
+            lane.ready_cv.wait(lock, [&]() { return !running_.load(std::memory_order_acquire) || !lane.ready.empty(); });
+            if (!running_.load(std::memory_order_acquire)) {
+                return;
+            }
+            topic = lane.ready.front();
+            lane.ready.pop_front();
+        }
+
+        // The handler in force when the turn began; the table keeps it alive
+        auto table = table_.load(std::memory_order_acquire);
+        const Route& route = table->routes[topic];
+        {
+            std::lock_guard<std::mutex> lock(route.queue->mutex);
+            const size_t count = std::min(route.queue->messages.size(), config_.drain_batch);
+            std::move(route.queue->messages.begin(), route.queue->messages.begin() + count,
+                      std::back_inserter(batch));
+            route.queue->messages.erase(route.queue->messages.begin(), route.queue->messages.begin() + count);
+        }
+        for (const auto& message : batch) {
+            try {
+                if (route.handler) {
+                    route.handler(message.payload, message.from);
+                }
+            } catch (const std::exception& e) {
+                QUIDS_LOG_ERROR("Message handler failed: {}", e.what());
+            }
+            lane.handled.fetch_add(1, std::memory_order_relaxed);
+        }
+        batch.clear();
+
+        // Back of the line, in whatever class the topic is in by now
+        bool again = false;
+        {
+            std::lock_guard<std::mutex> lock(route.queue->mutex);
+            again = !route.queue->messages.empty();
+            route.queue->scheduled = again;
+        }
+        if (again) {
+            schedule(topic, table_.load(std::memory_order_acquire)->routes[topic].priority);
+        }
+    }
+}
+
+MessageDispatcher::Stats MessageDispatcher::stats(Priority priority) const {
+    const Lane& lane = lanes_[index(priority)];
+    return Stats{lane.queued.load(std::memory_order_relaxed), lane.handled.load(std::memory_order_relaxed),
+                 lane.dropped.load(std::memory_order_relaxed), lane.unrouted.load(std::memory_order_relaxed)};
+}
+
+} // namespace quids::network
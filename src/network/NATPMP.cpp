@@ -5,9 +5,65 @@
 #include <boost/asio/ip/network_v4.hpp>
 #include <boost/asio/ip/address_v4.hpp>
 #include <boost/asio/steady_timer.hpp> // Include the timer header
+#include <array>
 
 namespace quids::network {
 
+    namespace {
+        constexpr uint16_t NATPMP_PORT = 5351;
+        constexpr std::chrono::seconds RESPONSE_TIMEOUT{2};
+    }
+
+    NATPMP::NATPMP(boost::asio::io_context& io_context)
+        : mapped_internal_port_(0),
+          mapped_external_port_(0),
+          mapping_lifetime_(0),
+          socket_(io_context),
+          last_protocol_(Protocol::UDP),
+          io_context_(io_context),
+          timer_(io_context),
+          resolver_(io_context) {}
+
+    std::optional<std::string> NATPMP::external_address() {
+        try {
+            std::string gateway = discover_gateway();
+            if (gateway.empty()) {
+                return std::nullopt;
+            }
+
+            boost::asio::io_context io_context;
+            boost::asio::ip::udp::socket socket(io_context);
+            socket.open(boost::asio::ip::udp::v4());
+            const boost::asio::ip::udp::endpoint gateway_endpoint(
+                boost::asio::ip::make_address_v4(gateway), NATPMP_PORT);
+
+            // Opcode 0: version, opcode; the answer carries the address
+            const std::array<uint8_t, 2> request{0, 0};
+            socket.send_to(boost::asio::buffer(request), gateway_endpoint);
+
+            std::array<uint8_t, 12> response{};
+            boost::asio::ip::udp::endpoint sender_endpoint;
+            size_t received = 0;
+            socket.async_receive_from(
+                boost::asio::buffer(response), sender_endpoint,
+                [&received](const boost::system::error_code& ec, size_t n) {
+                    if (!ec) received = n;
+                });
+            io_context.run_for(RESPONSE_TIMEOUT);
+
+            const uint16_t result = static_cast<uint16_t>((response[2] << 8) | response[3]);
+            if (received < response.size() || response[0] != 0 || response[1] != 0x80 || result != 0) {
+                return std::nullopt;
+            }
+            const uint32_t address = (uint32_t{response[8]} << 24) | (uint32_t{response[9]} << 16) |
+                                     (uint32_t{response[10]} << 8) | response[11];
+            return boost::asio::ip::address_v4(address).to_string();
+        } catch (const boost::system::system_error& e) {
+            SPDLOG_ERROR("NAT-PMP address request failed: {}", e.what());
+            return std::nullopt;
+        }
+    }
+
     std::string NATPMP::discover_gateway() {
         try {
             boost::asio::io_context io_context;
@@ -54,7 +110,7 @@ return boost::asio::ip::address_v4(gateway).to_string(); // This line is correct
             // Create endpoint for NAT-PMP port
             boost::asio::ip::udp::endpoint gateway_endpoint(
                 boost::asio::ip::make_address_v4(gateway),
-                5351  // NAT-PMP port
+                NATPMP_PORT
             );
 
             // Create NAT-PMP request
@@ -77,20 +133,7 @@ return boost::asio::ip::address_v4(gateway).to_string(); // This line is correct
             // Send request
             socket.send_to(boost::asio::buffer(&request, sizeof(request)), gateway_endpoint);
 
-            // Set timeout for response
-            boost::asio::steady_timer timer(socket.get_executor()); // Create a timer
-timer.expires_after(std::chrono::seconds(2)); // Set timeout for 2 seconds
-
-// Start the timer
-timer.async_wait([this, &socket](const boost::system::error_code& ec) { // Capture socket by reference
-    if (!ec) {
-        // Handle timeout (e.g., log an error, close the socket, etc.)
-        SPDLOG_ERROR("Receive timeout occurred.");
-        socket.close(); // Now this will work
-    }
-});
-
-            // Receive response
+            // Receive response, giving up after two seconds
             struct {
                 uint8_t version;
                 uint8_t opcode;
@@ -102,10 +145,13 @@ timer.async_wait([this, &socket](const boost::system::error_code& ec) { // Captu
             } response{};
 
             boost::asio::ip::udp::endpoint sender_endpoint;
-            size_t received = socket.receive_from(
-                boost::asio::buffer(&response, sizeof(response)),
-                sender_endpoint
-            );
+            size_t received = 0;
+            socket.async_receive_from(
+                boost::asio::buffer(&response, sizeof(response)), sender_endpoint,
+                [&received](const boost::system::error_code& ec, size_t n) {
+                    if (!ec) received = n;
+                });
+            io_context.run_for(RESPONSE_TIMEOUT);
 
             if (received < sizeof(response)) {
                 SPDLOG_ERROR("Received incomplete NAT-PMP response");
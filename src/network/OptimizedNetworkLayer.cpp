@@ -1,44 +1,132 @@
 #include "network/OptimizedNetworkLayer.hpp"
 #include <omp.h>
-#include <immintrin.h>
-#include "crypto/QuantumCrypto.hpp"
-#include "compression/SIMD_LZ4.hpp"
+#include <algorithm>
+#include <unordered_map>
 
 namespace quids {
 namespace network {
 
-OptimizedNetworkLayer::OptimizedNetworkLayer(const NetworkConfig& config)
-    : config_(config)
-    , transport_(std::make_unique<QUICTransport>(config))
+namespace {
+
+// Runs fn(peer, records) once per distinct peer(msg) in batch with that
+// peer's payloads, moved out and back so nothing is copied. fn returns
+// which records survived; the rest of their messages are removed.
+template<typename Message, typename PeerOf, typename Fn>
+size_t forEachPeer(std::vector<Message>& batch, PeerOf peerOf, Fn fn) {
+    std::unordered_map<NodeID, std::vector<size_t>> byPeer;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        byPeer[peerOf(batch[i])].push_back(i);
+    }
+    std::vector<bool> keep(batch.size(), false);
+    std::vector<std::vector<uint8_t>> records;
+    for (const auto& [peer, indexes] : byPeer) {
+        records.clear();
+        for (const size_t i : indexes) {
+            records.push_back(std::move(batch[i].data));
+        }
+        const std::vector<bool> ok = fn(peer, std::span<std::vector<uint8_t>>(records));
+        for (size_t j = 0; j < indexes.size(); ++j) {
+            batch[indexes[j]].data = std::move(records[j]);
+            keep[indexes[j]] = ok[j];
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (keep[i]) {
+            if (kept != i) {
+                batch[kept] = std::move(batch[i]);
+            }
+            ++kept;
+        }
+    }
+    const size_t dropped = batch.size() - kept;
+    batch.erase(batch.begin() + static_cast<std::ptrdiff_t>(kept), batch.end());
+    return dropped;
+}
+
+} // namespace
+
+OptimizedNetworkLayer::OptimizedNetworkLayer(const NetworkConfig& config, std::unique_ptr<MessageTransport> transport)
+    : transport_(std::move(transport))
+    , batcher_(std::make_unique<FrameBatcher>(config.batching,
+          [this](const FrameBatcher::PeerID& peer, std::vector<uint8_t>&& packet) {
+              sendPacket(peer, std::move(packet));
+          }))
+    , scores_(std::make_shared<PeerScoreBook>(PeerScoreBook::Config{}))
     , incomingQueue_(config.bufferSize)
-    , outgoingQueue_(config.bufferSize) {
+    , outgoingQueue_(config.bufferSize)
+    , consensusQueue_(config.bufferSize)
+    , config_(config) {
     
-    // Initialize worker threads
-    workerThreads_.reserve(config.numWorkerThreads);
-    for (size_t i = 0; i < config.numWorkerThreads; ++i) {
+    transport_->setMaxStreamBitrate(config.maxSendBitrate);
+    // Scores outlive the connection for a while, then age out
+    transport_->setDisconnectionHandler([this](const NodeID& peer) { scores_->removePeer(peer); });
+
+    auto& registry = utils::MetricsRegistry::global();
+    registry.attach("quids_net_messages_total", "Messages dispatched from the incoming queue", {}, metrics_.messagesProcessed);
+    registry.attach("quids_net_bytes_total", "Bytes handed to the transport", {}, metrics_.bytesTransferred);
+    registry.attach("quids_net_active_connections", "Open transport connections", {}, metrics_.activeConnections);
+    registry.attach("quids_net_dispatch_seconds", "Time to dispatch one received message", {}, metrics_.dispatchLatency);
+    registry.attach("quids_net_errors_total", "Dropped or failed messages", {}, metrics_.errorCount);
+}
+
+OptimizedNetworkLayer::~OptimizedNetworkLayer() {
+    stop();
+}
+
+void OptimizedNetworkLayer::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    transport_->start();
+    // Workers run while running_ is set, so they start here rather than
+    // in the constructor, where they would see it clear and exit
+    workerThreads_.reserve(config_.numWorkerThreads);
+    for (size_t i = 0; i < config_.numWorkerThreads; ++i) {
         workerThreads_.emplace_back(
             std::make_unique<std::thread>(&OptimizedNetworkLayer::workerThread, this)
         );
     }
 }
 
-OptimizedNetworkLayer::~OptimizedNetworkLayer() {
-    stop();
+void OptimizedNetworkLayer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
     for (auto& thread : workerThreads_) {
         if (thread->joinable()) {
             thread->join();
         }
     }
+    workerThreads_.clear();
+    // Whatever is still lingering goes out before the transport closes
+    batcher_->flushAll();
+    transport_->stop();
 }
 
-void OptimizedNetworkLayer::start() {
-    running_ = true;
-    transport_->start();
+void OptimizedNetworkLayer::addPeer(const NodeID& peer) {
+    {
+        std::lock_guard<std::mutex> lock(peersMutex_);
+        if (!peers_.insert(peer).second) {
+            return;
+        }
+    }
+    scores_->addPeer(peer);
 }
 
-void OptimizedNetworkLayer::stop() {
-    running_ = false;
-    transport_->stop();
+void OptimizedNetworkLayer::removePeer(const NodeID& peer) {
+    {
+        std::lock_guard<std::mutex> lock(peersMutex_);
+        if (peers_.erase(peer) == 0) {
+            return;
+        }
+    }
+    scores_->removePeer(peer);
+}
+
+std::vector<NodeID> OptimizedNetworkLayer::getActivePeers() const {
+    std::lock_guard<std::mutex> lock(peersMutex_);
+    return {peers_.begin(), peers_.end()};
 }
 
 void OptimizedNetworkLayer::broadcastMessage(const Message& msg) {
@@ -53,32 +141,53 @@ void OptimizedNetworkLayer::broadcastMessage(const Message& msg) {
         batch.back().target = peer;
     }
     
-    // Compress and encrypt batch using SIMD
-    compressMessagesSIMD(batch);
-    
-    // Send messages in parallel
-    #pragma omp parallel for
-    for (size_t i = 0; i < batch.size(); ++i) {
-        if (config_.useQuantumEncryption) {
-            encryptQuantum(batch[i]);
-        }
-        outgoingQueue_.enqueue(std::move(batch[i]));
-    }
+    // Compression and encryption happen per packet once batched
+    enqueueAll(outgoingQueue_, batch);
 }
 
 void OptimizedNetworkLayer::sendMessage(const NodeID& target, const Message& msg) {
     Message outMsg = msg;
     outMsg.target = target;
     
-    // Compress message
-    compression::compressMessageSIMD(outMsg);
-    
-    // Apply quantum encryption if enabled
-    if (config_.useQuantumEncryption) {
-        encryptQuantum(outMsg);
+    // A failed try_push leaves outMsg untouched
+    while (!outgoingQueue_.try_push(std::move(outMsg))) {
+        if (!running_) {
+            metrics_.errorCount->add(1);
+            return;
+        }
+        std::this_thread::yield();
     }
+}
+
+void OptimizedNetworkLayer::sendConsensusMessage(const NodeID& target, Message&& msg) {
+    msg.target = target;
     
-    outgoingQueue_.enqueue(std::move(outMsg));
+    // Consensus frames are small and latency bound, so they skip batching;
+    // the worker seals them per peer as it drains the lane
+    while (!consensusQueue_.try_push(std::move(msg))) {
+        if (!running_) {
+            metrics_.errorCount->add(1);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void OptimizedNetworkLayer::enqueueAll(utils::BoundedQueue<Message>& queue,
+                                       std::vector<Message>& messages) {
+    size_t queued = 0;
+    while (queued < messages.size()) {
+        const size_t n = queue.try_push_bulk(messages.begin() + queued, messages.size() - queued);
+        queued += n;
+        if (n == 0) {
+            if (!running_) {
+                // Nobody will drain the ring any more
+                metrics_.errorCount->add(messages.size() - queued);
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
 }
 
 void OptimizedNetworkLayer::processIncomingMessages() {
@@ -86,128 +195,197 @@ void OptimizedNetworkLayer::processIncomingMessages() {
     batch.reserve(BATCH_SIZE);
     
     // Collect messages for batch processing
-    while (batch.size() < BATCH_SIZE) {
-        Message msg;
-        if (!incomingQueue_.try_dequeue(msg)) {
-            break;
-        }
-        batch.push_back(std::move(msg));
-    }
+    incomingQueue_.try_pop_bulk(std::back_inserter(batch), BATCH_SIZE);
     
     if (!batch.empty()) {
         processBatchSIMD(batch);
     }
 }
 
+void OptimizedNetworkLayer::registerMessageHandler(uint8_t type, MessageHandler handler) {
+    messageHandlers_[type] = std::move(handler);
+}
+
+void OptimizedNetworkLayer::setFrameDictionary(uint8_t type, const std::vector<uint8_t>& dictionary) {
+    batcher_->setDictionary(type, dictionary);
+}
+
 void OptimizedNetworkLayer::processBatchSIMD(const std::vector<Message>& batch) {
-    const size_t batchSize = batch.size();
-    const size_t simdWidth = 8; // AVX-512 double precision
-    const size_t numIterations = batchSize / simdWidth;
-    
-    // Process messages using SIMD
-    #pragma omp parallel for simd aligned(batch:64)
-    for (size_t i = 0; i < numIterations; ++i) {
-        __m512d messageData = _mm512_load_pd(&batch[i * simdWidth].data[0]);
-        
-        // Process message data with SIMD instructions
-        messageData = _mm512_add_pd(messageData, _mm512_set1_pd(1.0));
-        
-        // Store processed results
-        _mm512_store_pd(&batch[i * simdWidth].data[0], messageData);
-    }
-    
-    // Handle remaining messages
-    for (size_t i = numIterations * simdWidth; i < batchSize; ++i) {
-        processMessage(batch[i]);
+    // Header checks, CRC32C and expanding compressed batches are the only
+    // per-message work before dispatch; handlers get views, not copies
+    for (const auto& msg : batch) {
+        utils::ScopedTimer timer(*metrics_.dispatchLatency);
+        processMessage(msg);
     }
     
     // Update metrics
-    metrics_.messagesProcessed.fetch_add(batchSize, std::memory_order_relaxed);
+    metrics_.messagesProcessed->add(batch.size());
 }
 
-void OptimizedNetworkLayer::compressMessagesSIMD(std::vector<Message>& messages) {
-    const size_t batchSize = messages.size();
-    
-    #pragma omp parallel for
-    for (size_t i = 0; i < batchSize; ++i) {
-        compression::SIMD_LZ4::compress(messages[i]);
+void OptimizedNetworkLayer::processMessage(const Message& msg) {
+    // Compressed batches expand here; reused so steady state never allocates
+    thread_local std::vector<uint8_t> scratch;
+    const bool ok = batcher_->unpack(msg.data, scratch, [&](const wire::Frame& frame) {
+        if (const auto& handler = messageHandlers_[frame.type()]) {
+            handler(msg.sender, frame);
+            scores_->recordDelivery(msg.sender, frame.payload.size(), true);
+        }
+    });
+    if (!ok) {
+        metrics_.errorCount->add(1);
+        scores_->recordInvalid(msg.sender);
     }
 }
 
-void OptimizedNetworkLayer::encryptQuantum(Message& msg) {
-    // Generate quantum key
-    auto key = crypto::generateQuantumKey();
-    
-    // Apply quantum encryption
-    crypto::encryptWithQuantumKey(msg.data, key);
-    
-    // Store quantum key securely
-    msg.quantumKey = std::move(key);
+void OptimizedNetworkLayer::installSessionKey(const NodeID& peer, std::span<const uint8_t> secret, bool initiator) {
+    records_.install(peer, secret, initiator);
 }
 
-void OptimizedNetworkLayer::decryptQuantum(Message& msg) {
-    if (!msg.quantumKey) {
-        throw std::runtime_error("Missing quantum key");
-    }
-    
-    // Apply quantum decryption
-    crypto::decryptWithQuantumKey(msg.data, *msg.quantumKey);
+void OptimizedNetworkLayer::sealBatch(std::vector<Message>& batch) {
+    const size_t dropped = forEachPeer(batch, [](const Message& msg) { return msg.target; },
+        [this](const NodeID& peer, std::span<std::vector<uint8_t>> records) {
+            // No keys yet: every record for the peer is dropped
+            return std::vector<bool>(records.size(), records_.seal(peer, records));
+        });
+    metrics_.errorCount->add(dropped);
+}
+
+void OptimizedNetworkLayer::openBatch(std::vector<Message>& batch) {
+    const size_t dropped = forEachPeer(batch, [](const Message& msg) { return msg.sender; },
+        [this](const NodeID& peer, std::span<std::vector<uint8_t>> records) {
+            records_.open(peer, records);
+            // Every message carries at least one frame, so only a record
+            // that failed to open comes back empty
+            std::vector<bool> ok(records.size());
+            for (size_t i = 0; i < records.size(); ++i) {
+                ok[i] = !records[i].empty();
+                if (!ok[i]) {
+                    scores_->recordInvalid(peer);
+                }
+            }
+            return ok;
+        });
+    metrics_.errorCount->add(dropped);
 }
 
 void OptimizedNetworkLayer::workerThread() {
+    std::vector<Message> outgoing;
+    outgoing.reserve(BATCH_SIZE);
     while (running_) {
-        // Process outgoing messages
-        Message outMsg;
-        while (outgoingQueue_.try_dequeue(outMsg)) {
-            try {
-                transport_->sendMessage(std::move(outMsg));
-                metrics_.bytesTransferred.fetch_add(
-                    outMsg.data.size(),
-                    std::memory_order_relaxed
-                );
-            } catch (const NetworkError& error) {
-                handleError(error);
+        // Consensus goes out first, and again after every slice of gossip,
+        // so a transaction flood never queues ahead of a vote
+        for (;;) {
+            drainOutgoing(consensusQueue_, outgoing, BATCH_SIZE, false);
+            if (drainOutgoing(outgoingQueue_, outgoing, GOSSIP_SLICE, true) == 0) {
+                break;
             }
         }
+        batcher_->poll();
         
         // Process incoming messages
         auto incomingMsgs = transport_->receiveMessages();
-        for (auto& msg : incomingMsgs) {
-            if (config_.useQuantumEncryption) {
-                decryptQuantum(msg);
-            }
-            incomingQueue_.enqueue(std::move(msg));
+        if (config_.useQuantumEncryption) {
+            openBatch(incomingMsgs);
         }
+        // Never waits for room: this loop also drains the send lanes, and
+        // the ring only empties when the owner calls processIncomingMessages()
+        const size_t queued = incomingQueue_.try_push_bulk(incomingMsgs.begin(), incomingMsgs.size());
+        metrics_.errorCount->add(incomingMsgs.size() - queued);
+        
+        updateScores();
         
         // Update connection metrics
-        metrics_.activeConnections.store(
-            transport_->getActiveConnections(),
-            std::memory_order_relaxed
-        );
+        metrics_.activeConnections->set(static_cast<int64_t>(transport_->getActiveConnections()));
+    }
+}
+
+size_t OptimizedNetworkLayer::drainOutgoing(utils::BoundedQueue<Message>& queue,
+                                            std::vector<Message>& batch, size_t max, bool batched) {
+    size_t sent = 0;
+    while (sent < max) {
+        const size_t n = queue.try_pop_bulk(std::back_inserter(batch), max - sent);
+        if (n == 0) {
+            break;
+        }
+        // Gossip is sealed per packet once FrameBatcher has coalesced it
+        if (!batched && config_.useQuantumEncryption) {
+            sealBatch(batch);
+        }
+        for (auto& outMsg : batch) {
+            if (batched) {
+                // Leaves once the peer goes quiet or the batch fills up
+                batcher_->enqueue(outMsg.target, outMsg.data);
+                continue;
+            }
+            try {
+                const size_t bytes = outMsg.data.size();
+                transport_->sendMessage(std::move(outMsg));
+                metrics_.bytesTransferred->add(bytes);
+            } catch (const NetworkError& error) {
+                handleError(error);
+            }
+        }
+        batch.clear();
+        sent += n;
+    }
+    return sent;
+}
+
+void OptimizedNetworkLayer::sendPacket(const NodeID& target, std::vector<uint8_t>&& packet) {
+    Message outMsg;
+    outMsg.target = target;
+    outMsg.data = std::move(packet);
+    // Sealed after compression; ciphertext would not compress. The packet
+    // already holds every frame queued for the peer, so it is one record.
+    if (config_.useQuantumEncryption && !records_.seal(target, outMsg.data)) {
+        metrics_.errorCount->add(1);
+        return;
+    }
+    try {
+        const size_t bytes = outMsg.data.size();
+        transport_->sendMessage(std::move(outMsg));
+        metrics_.bytesTransferred->add(bytes);
+    } catch (const NetworkError& error) {
+        handleError(error);
+    }
+}
+
+void OptimizedNetworkLayer::updateScores() {
+    // One worker per interval wins the round
+    const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    int64_t next = nextScoreRound_.load(std::memory_order_relaxed);
+    if (now < next || !nextScoreRound_.compare_exchange_strong(
+            next, now + std::chrono::steady_clock::duration(SCORE_INTERVAL).count())) {
+        return;
     }
+    scores_->decay();
+    transport_->setPeerWeights(scores_->bandwidthWeights());
 }
 
 void OptimizedNetworkLayer::handleError(const NetworkError& error) {
-    metrics_.errorCount.fetch_add(1, std::memory_order_relaxed);
+    metrics_.errorCount->add(1);
     // Log error and implement recovery strategy
 }
 
 NetworkMetrics OptimizedNetworkLayer::getMetrics() const {
+    const auto latency = metrics_.dispatchLatency->snapshot();
     return {
-        metrics_.messagesProcessed.load(std::memory_order_relaxed),
-        metrics_.bytesTransferred.load(std::memory_order_relaxed),
-        metrics_.activeConnections.load(std::memory_order_relaxed),
-        metrics_.averageLatency.load(std::memory_order_relaxed),
-        metrics_.errorCount.load(std::memory_order_relaxed)
+        metrics_.messagesProcessed->value(),
+        metrics_.bytesTransferred->value(),
+        static_cast<uint64_t>(std::max<int64_t>(0, metrics_.activeConnections->value())),
+        latency.quantile(0.5),
+        latency.quantile(0.99),
+        latency.quantile(0.999),
+        metrics_.errorCount->value()
     };
 }
 
 void OptimizedNetworkLayer::resetMetrics() {
-    metrics_.messagesProcessed = 0;
-    metrics_.bytesTransferred = 0;
-    metrics_.activeConnections = 0;
-    metrics_.averageLatency = 0.0;
-    metrics_.errorCount = 0;
+    metrics_.messagesProcessed->reset();
+    metrics_.bytesTransferred->reset();
+    metrics_.activeConnections->reset();
+    metrics_.dispatchLatency->reset();
+    metrics_.errorCount->reset();
 }
 
 } // namespace network
@@ -64,10 +64,11 @@ namespace quids::network {
         UPnPHandler() = default;
         ~UPnPHandler() = default;
 
-        static bool setupMapping(uint16_t port) {
+        // Returns the gateway's external address
+        static std::optional<std::string> setupMapping(uint16_t port) {
             try {
                 auto devlist = getUPnPDeviceList();
-                if (!devlist) return false;
+                if (!devlist) return std::nullopt;
 
                 UPNPUrls urls;
                 IGDdatas data;
@@ -87,12 +88,13 @@ namespace quids::network {
                                                lanaddr.data(), "QUIDS P2P",
                                                NetworkConstants::UPNP_PROTOCOL, nullptr, "0");
                     FreeUPNPUrls(&urls);
-                    return result == 0;
+                    if (result != 0) return std::nullopt;
+                    return std::string(wanaddr.data());
                 }
-                return false;
+                return std::nullopt;
             } catch (const std::exception& e) {
                 spdlog::error("UPnP setup failed: {}", e.what());
-                return false;
+                return std::nullopt;
             }
         }
 
@@ -136,7 +138,7 @@ namespace quids::network {
 namespace {
     class NATTraversal {
     public:
-        std::optional<bool> setupMapping(uint16_t port) {
+        std::optional<std::string> setupMapping(uint16_t port) {
             return UPnPHandler::setupMapping(port);
         }
 
@@ -172,10 +174,112 @@ bool P2PConnection::ping() {
     return connected_;
 }
 
+IceAgent::Config P2PConnection::ice_config(const Config& config) {
+    IceAgent::Config ice;
+    ice.check_timeout = config.hole_punch_timeout;
+    return ice;
+}
+
+void P2PConnection::add_candidate_sources() {
+    const uint16_t port = config_.port;
+    ice_.add_gatherer("host", [port] {
+        // Connecting a UDP socket sends nothing but picks the interface
+        boost::asio::io_context io;
+        boost::asio::ip::udp::socket socket(io);
+        socket.connect({boost::asio::ip::make_address_v4("8.8.8.8"), 53});
+        return std::vector<IceCandidate>{IceCandidate::make(
+            IceCandidate::Type::Host, socket.local_endpoint().address().to_string(), port)};
+    });
+    if (!config_.stun_server.empty()) {
+        ice_.add_gatherer("stun", [server = config_.stun_server, stun_port = config_.stun_port] {
+            std::string ip;
+            uint16_t mapped_port = 0;
+            if (!STUNClient::get_mapped_address(server, stun_port, ip, mapped_port)) {
+                return std::vector<IceCandidate>{};
+            }
+            return std::vector<IceCandidate>{IceCandidate::make(IceCandidate::Type::ServerReflexive, ip, mapped_port)};
+        });
+    }
+    if (config_.enable_upnp) {
+        ice_.add_gatherer("upnp", [port] {
+            auto external = NATTraversal{}.setupMapping(port);
+            if (!external || external->empty()) {
+                return std::vector<IceCandidate>{};
+            }
+            return std::vector<IceCandidate>{IceCandidate::make(IceCandidate::Type::PortMapped, *external, port)};
+        });
+    }
+    if (config_.enable_nat_pmp) {
+        ice_.add_gatherer("nat-pmp", [port] {
+            boost::asio::io_context io;
+            NATPMP natpmp(io);
+            auto external = natpmp.external_address();
+            if (!external || !natpmp.map_port(port, port, Protocol::UDP, 3600)) {
+                return std::vector<IceCandidate>{};
+            }
+            // Just below UPnP, should both map the same gateway
+            return std::vector<IceCandidate>{IceCandidate::make(
+                IceCandidate::Type::PortMapped, *external, natpmp.mapped_external_port(), 65534)};
+        });
+    }
+}
+
+bool P2PConnection::probe(const IceCandidatePair& pair, const std::atomic<bool>& cancelled,
+                          IceAgent::Clock::time_point deadline) {
+    constexpr auto RESEND_INTERVAL = 50ms;
+    static constexpr uint8_t PROBE[] = {'Q', 'P', 'R', 'B'};
+
+    boost::asio::io_context io;
+    boost::asio::ip::udp::socket socket(io, {boost::asio::ip::udp::v4(), 0});
+    const boost::asio::ip::udp::endpoint remote(boost::asio::ip::make_address(pair.remote.address),
+                                                pair.remote.port);
+
+    std::array<uint8_t, 64> buffer;
+    boost::asio::ip::udp::endpoint sender;
+    bool answered = false;
+    std::function<void()> receive = [&] {
+        socket.async_receive_from(boost::asio::buffer(buffer), sender,
+            [&](const boost::system::error_code& ec, size_t) {
+                if (ec) return;
+                if (sender == remote) {
+                    answered = true;
+                } else {
+                    receive();
+                }
+            });
+    };
+    receive();
+
+    while (!answered && !cancelled && IceAgent::Clock::now() < deadline) {
+        boost::system::error_code ec;
+        socket.send_to(boost::asio::buffer(PROBE), remote, 0, ec);
+        io.run_for(RESEND_INTERVAL);
+    }
+    return answered;
+}
+
 bool P2PConnection::perform_nat_traversal(const std::string& ip, uint16_t port) {
-    NATTraversal nat;
-    auto result = nat.setupMapping(port);
-    return result.value_or(false);
+    return perform_nat_traversal(ip + ":" + std::to_string(port),
+                                 {IceCandidate::make(IceCandidate::Type::Host, ip, port)});
+}
+
+bool P2PConnection::perform_nat_traversal(const std::string& peer, const std::vector<IceCandidate>& remote) {
+    auto path = ice_.connect(peer, remote,
+        [](const IceCandidatePair& pair, const std::atomic<bool>& cancelled, IceAgent::Clock::time_point deadline) {
+            return probe(pair, cancelled, deadline);
+        });
+    if (!path) {
+        return false;
+    }
+    peer_address_ = path->remote.address;
+    peer_port_ = path->remote.port;
+    last_seen_ = std::chrono::steady_clock::now();
+    connected_ = true;
+    return true;
+}
+
+std::vector<IceCandidate> P2PConnection::local_candidates() const {
+    return ice_.gather();
 }
 
 void P2PConnection::broadcast(const std::vector<uint8_t>& data) {
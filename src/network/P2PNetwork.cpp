@@ -1,13 +1,20 @@
 #include "network/P2PNetwork.hpp"
 #include "network/P2PConnection.hpp"
-#include <spdlog/spdlog.h>
+#include "network/GossipRouter.hpp"
+#include "network/MessageDispatcher.hpp"
+#include "network/PeerScoreBook.hpp"
+#include "network/RoutingIndex.hpp"
+#include "network/WireFormat.hpp"
+#include "common/Logger.hpp"
 #include <random>
 #include <sstream>
 #include <iomanip>
 #include <thread>
 #include <chrono>
-#include <bitset>
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <numeric>
 #include "blockchain/Transaction.hpp"
 
 namespace quids::network {
@@ -17,6 +24,9 @@ constexpr size_t K = 20;  // Size of k-buckets
 constexpr size_t ALPHA = 3;  // Number of parallel lookups
 constexpr size_t ID_LENGTH = 160;  // Length of node IDs in bits
 constexpr std::chrono::seconds BUCKET_REFRESH_INTERVAL(3600);  // Refresh every hour
+constexpr std::chrono::seconds GOSSIP_HEARTBEAT_INTERVAL(1);
+// How long transaction announcements are batched at each hop
+constexpr std::chrono::milliseconds ANNOUNCE_INTERVAL(100);
 
 struct KademliaNode {
     std::string id;
@@ -26,6 +36,12 @@ struct KademliaNode {
     bool is_validator;
 };
 
+struct PendingRequest {
+    std::string peer;
+    std::chrono::steady_clock::time_point deadline;
+    P2PNetwork::ResponseCallback done;
+};
+
 struct KBucket {
     std::list<KademliaNode> nodes;
     std::chrono::steady_clock::time_point last_updated;
@@ -34,7 +50,6 @@ struct KBucket {
 class P2PNetwork::Impl {
 public:
     std::unordered_map<std::string, std::shared_ptr<P2PConnection>> connections;
-    std::unordered_map<std::string, MessageHandler> message_handlers;
     std::vector<std::string> connected_peers;
     bool running{false};
     NetworkConfig config;
@@ -43,23 +58,102 @@ public:
     std::mutex connections_mutex;
     std::mutex handlers_mutex;
     std::mutex buckets_mutex;
+
+    // Outstanding request() calls by id
+    RequestHandler request_handler;
+    std::unordered_map<uint64_t, PendingRequest> pending_requests;
+    std::atomic<uint64_t> next_request_id{1};
+    std::mutex requests_mutex;
+
+    // Compact block relay
+    struct RelayedBlock {
+        CompactBlock::Hash id;
+        std::vector<std::vector<uint8_t>> transactions;
+    };
+    static constexpr size_t MAX_RELAYED_BLOCKS = 16;
+    static constexpr size_t MAX_SEEN_BLOCKS = 1024;
+    CompactBlock::TransactionSource block_source;
+    BlockHandler block_handler;
+    // Blocks whose transactions peers may ask for, oldest first
+    std::deque<RelayedBlock> relayed_blocks;
+    // Blocks sent or being rebuilt; later copies are dropped
+    std::deque<CompactBlock::Hash> seen_blocks;
+    std::mutex blocks_mutex;
+
+    bool mark_seen(const CompactBlock::Hash& id) {
+        std::lock_guard<std::mutex> lock(blocks_mutex);
+        if (std::find(seen_blocks.begin(), seen_blocks.end(), id) != seen_blocks.end()) {
+            return false;
+        }
+        seen_blocks.push_back(id);
+        if (seen_blocks.size() > MAX_SEEN_BLOCKS) {
+            seen_blocks.pop_front();
+        }
+        return true;
+    }
+
+    // So a copy from another peer gets its chance
+    void forget_seen(const CompactBlock::Hash& id) {
+        std::lock_guard<std::mutex> lock(blocks_mutex);
+        seen_blocks.erase(std::remove(seen_blocks.begin(), seen_blocks.end(), id), seen_blocks.end());
+    }
+
+    // Chunks of erasure-coded blocks this node keeps, oldest block first
+    struct StoredChunks {
+        AvailabilityCommitment::Hash id;
+        std::unordered_map<uint32_t, BlockChunk> chunks;
+    };
+    static constexpr size_t MAX_CHUNKED_BLOCKS = 64;
+    std::deque<StoredChunks> chunk_store;
+    std::mutex chunks_mutex;
+
+    void store_chunk(const AvailabilityCommitment::Hash& id, BlockChunk chunk) {
+        std::lock_guard<std::mutex> lock(chunks_mutex);
+        auto it = std::find_if(chunk_store.begin(), chunk_store.end(),
+                               [&](const StoredChunks& stored) { return stored.id == id; });
+        if (it == chunk_store.end()) {
+            chunk_store.push_back({id, {}});
+            if (chunk_store.size() > MAX_CHUNKED_BLOCKS) {
+                chunk_store.pop_front();
+            }
+            it = chunk_store.end() - 1;
+        }
+        const uint32_t index = chunk.index;
+        it->chunks.emplace(index, std::move(chunk));
+    }
+
+    std::optional<BlockChunk> stored_chunk(const AvailabilityCommitment::Hash& id, uint32_t index) {
+        std::lock_guard<std::mutex> lock(chunks_mutex);
+        for (const auto& stored : chunk_store) {
+            if (stored.id != id) continue;
+            auto it = stored.chunks.find(index);
+            if (it != stored.chunks.end()) return it->second;
+            break;
+        }
+        return std::nullopt;
+    }
+
+    // Dissemination for all topics; peers are keyed by "address:port",
+    // and so are their scores
+    std::shared_ptr<PeerScoreBook> scores;
+    std::unique_ptr<GossipRouter> gossip;
+
+    // Inbound gossip, compact blocks and chunk pushes are handled here,
+    // off the receive thread. Last, so its workers are joined before
+    // anything they use goes away.
+    MessageDispatcher::TopicId compact_block_frames{0};
+    MessageDispatcher::TopicId chunk_push_frames{0};
+    std::unique_ptr<MessageDispatcher> dispatcher;
     
     // Kademlia routing table
     std::array<KBucket, ID_LENGTH> k_buckets;
     
-    // Calculate distance between two node IDs
-    static size_t calculate_distance(const std::string& id1, const std::string& id2) {
-        std::bitset<ID_LENGTH> xor_result;
-        for (size_t i = 0; i < id1.length() && i < id2.length(); ++i) {
-            xor_result |= (std::bitset<ID_LENGTH>(id1[i]) ^ std::bitset<ID_LENGTH>(id2[i])) << (i * 8);
-        }
-        return xor_result.to_ulong();
-    }
-    
-    // Get appropriate k-bucket index for a node
+    // Bucket i holds ids whose XOR distance to ours has its highest set
+    // bit at i, i.e. that share ID_LENGTH - 1 - i leading bits with us
     size_t get_bucket_index(const std::string& id) {
-        size_t distance = calculate_distance(node_id, id);
-        return distance == 0 ? 0 : ID_LENGTH - 1 - __builtin_clzll(distance);
+        const size_t shared = RoutingIndex::commonPrefixBits(
+            RoutingIndex::keyFromString(node_id), RoutingIndex::keyFromString(id));
+        return ID_LENGTH - 1 - std::min(shared, ID_LENGTH - 1);
     }
     
     // Update a node in the routing table
@@ -93,30 +187,20 @@ public:
     std::vector<KademliaNode> find_closest_nodes(const std::string& target_id, size_t count = K) {
         std::lock_guard<std::mutex> lock(buckets_mutex);
         
-        // Priority queue to keep track of closest nodes
-        auto cmp = [&](const KademliaNode& a, const KademliaNode& b) {
-            return calculate_distance(target_id, a.id) < calculate_distance(target_id, b.id);
-        };
-        std::priority_queue<KademliaNode, std::vector<KademliaNode>, decltype(cmp)> closest(cmp);
-        
-        // Collect nodes from all buckets
+        // Index every known node, then copy out only the winners
+        RoutingIndex index;
+        std::vector<const KademliaNode*> nodes;
         for (const auto& bucket : k_buckets) {
             for (const auto& node : bucket.nodes) {
-                closest.push(node);
-                if (closest.size() > count) {
-                    closest.pop();
-                }
+                index.add(RoutingIndex::keyFromString(node.id));
+                nodes.push_back(&node);
             }
         }
         
-        // Convert to vector
         std::vector<KademliaNode> result;
-        while (!closest.empty()) {
-            result.push_back(closest.top());
-            closest.pop();
+        for (uint32_t position : index.closest(RoutingIndex::keyFromString(target_id), count)) {
+            result.push_back(*nodes[position]);
         }
-        
-        std::reverse(result.begin(), result.end());
         return result;
     }
     
@@ -137,9 +221,16 @@ public:
                 }
             }
             
-            return connection->ping();
+            const auto sent = std::chrono::steady_clock::now();
+            const bool alive = connection->ping();
+            if (alive) {
+                scores->recordRtt(node.address + ":" + std::to_string(node.port),
+                                  std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - sent));
+            }
+            return alive;
         } catch (const std::exception& e) {
-            spdlog::error("Failed to ping node {}: {}", node.id, e.what());
+            QUIDS_LOG_ERROR("Failed to ping node {}: {}", node.id, e.what());
             return false;
         }
     }
@@ -156,25 +247,31 @@ public:
     
     // Refresh all k-buckets
     void refresh_buckets() {
-        std::lock_guard<std::mutex> lock(buckets_mutex);
-        
-        auto now = std::chrono::steady_clock::now();
-        for (auto& bucket : k_buckets) {
-            if (std::chrono::duration_cast<std::chrono::hours>(
-                    now - bucket.last_updated).count() >= 1) {
-                // Generate random ID in this bucket's range
-                std::string target_id = generate_random_id_in_bucket(
-                    std::distance(&k_buckets[0], &bucket));
-                
-                // Find nodes close to this ID
-                auto nodes = find_closest_nodes(target_id);
-                
-                // Update bucket with found nodes
-                for (const auto& node : nodes) {
-                    update_routing_table(node);
+        // Lookups and updates take buckets_mutex themselves
+        std::vector<size_t> stale;
+        {
+            std::lock_guard<std::mutex> lock(buckets_mutex);
+            auto now = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < k_buckets.size(); ++i) {
+                if (std::chrono::duration_cast<std::chrono::hours>(
+                        now - k_buckets[i].last_updated).count() >= 1) {
+                    stale.push_back(i);
                 }
             }
         }
+        
+        for (size_t bucket_index : stale) {
+            // Generate random ID in this bucket's range
+            std::string target_id = generate_random_id_in_bucket(bucket_index);
+            
+            // Find nodes close to this ID
+            auto nodes = find_closest_nodes(target_id);
+            
+            // Update bucket with found nodes
+            for (const auto& node : nodes) {
+                update_routing_table(node);
+            }
+        }
     }
     
     // Generate a random ID that would belong in the specified bucket
@@ -186,16 +283,16 @@ public:
         // Start with our node ID
         std::string id = node_id;
         
-        // Flip bits to ensure the ID falls in the desired bucket
-        if (bucket_index > 0) {
-            size_t bit_to_flip = ID_LENGTH - bucket_index;
-            size_t byte_index = bit_to_flip / 8;
-            size_t bit_index = bit_to_flip % 8;
-            
-            if (byte_index < id.length()) {
-                id[byte_index] ^= (1 << bit_index);
-            }
+        // Flip the first bit past the shared prefix, counting from the
+        // most significant bit, so the ID falls in the desired bucket
+        size_t bit_to_flip = ID_LENGTH - 1 - std::min(bucket_index, ID_LENGTH - 1);
+        size_t byte_index = bit_to_flip / 8;
+        size_t bit_index = 7 - bit_to_flip % 8;
+        
+        if (id.length() <= byte_index) {
+            id.resize(byte_index + 1, '\0');
         }
+        id[byte_index] ^= static_cast<char>(1 << bit_index);
         
         return id;
     }
@@ -206,6 +303,172 @@ P2PNetwork::P2PNetwork(const NetworkConfig& config)
     impl_->config = config;
     impl_->node_id = generate_node_id();
     impl_->is_validator = false;
+    impl_->scores = std::make_shared<PeerScoreBook>(PeerScoreBook::Config{});
+    // Popular transactions arrive from every mesh peer; announcing ids and
+    // pulling the unseen bodies means only one copy of each comes in
+    GossipRouter::Config gossip_config;
+    gossip_config.announce_topics = {TRANSACTION_TOPIC};
+    impl_->gossip = std::make_unique<GossipRouter>(
+        gossip_config,
+        [this](const std::string& peer, std::vector<uint8_t>&& frame) {
+            send_gossip_frame(peer, std::move(frame));
+        },
+        impl_->scores);
+
+    // Direct frames get topics of their own, outside the gossip namespace
+    impl_->dispatcher = std::make_unique<MessageDispatcher>(MessageDispatcher::Config{});
+    impl_->compact_block_frames = impl_->dispatcher->intern("frames/compact-block");
+    impl_->dispatcher->setHandler(impl_->compact_block_frames, MessageDispatcher::Priority::Blocks,
+        [this](const std::vector<uint8_t>& payload, const std::string& peer) {
+            handle_compact_block(peer, payload);
+        });
+    impl_->chunk_push_frames = impl_->dispatcher->intern("frames/chunk-push");
+    impl_->dispatcher->setHandler(impl_->chunk_push_frames, MessageDispatcher::Priority::Dht,
+        [this](const std::vector<uint8_t>& payload, const std::string& peer) {
+            handle_chunk_push(peer, payload);
+        });
+}
+
+P2PNetwork::~P2PNetwork() {
+    if (impl_) {
+        stop();
+    }
+}
+
+void P2PNetwork::send_gossip_frame(const std::string& peer_address, std::vector<uint8_t>&& frame) {
+    send_frame(peer_address, wire::types::GOSSIP, frame);
+}
+
+bool P2PNetwork::send_frame(const std::string& peer_address, uint8_t type, std::span<const uint8_t> payload) {
+    auto pos = peer_address.rfind(':');
+    if (pos == std::string::npos) {
+        return false;
+    }
+    std::shared_ptr<P2PConnection> main_connection;
+    {
+        std::lock_guard<std::mutex> lock(impl_->connections_mutex);
+        auto it = impl_->connections.find("main");
+        if (it == impl_->connections.end()) {
+            return false;
+        }
+        main_connection = it->second;
+    }
+    std::vector<uint8_t> packet;
+    packet.reserve(wire::HEADER_SIZE + payload.size());
+    wire::appendFrame(packet, type, 0, payload);
+    return main_connection->send_message(peer_address.substr(0, pos),
+                                         static_cast<uint16_t>(std::stoi(peer_address.substr(pos + 1))),
+                                         packet);
+}
+
+void P2PNetwork::request(const std::string& peer_address, std::vector<uint8_t> payload, ResponseCallback done,
+                         std::chrono::milliseconds timeout) {
+    send_request(peer_address, wire::types::REQUEST, payload, std::move(done), timeout);
+}
+
+void P2PNetwork::send_request(const std::string& peer_address, uint8_t type, std::span<const uint8_t> payload,
+                              ResponseCallback done, std::chrono::milliseconds timeout) {
+    const uint64_t id = impl_->next_request_id.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(impl_->requests_mutex);
+        impl_->pending_requests[id] = {peer_address, std::chrono::steady_clock::now() + timeout, std::move(done)};
+    }
+
+    std::vector<uint8_t> frame(8);
+    for (size_t i = 0; i < 8; ++i) {
+        frame[i] = static_cast<uint8_t>(id >> (8 * i));
+    }
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    if (impl_->running && send_frame(peer_address, type, frame)) {
+        return;
+    }
+
+    // Never sent; fail it now rather than at the deadline
+    ResponseCallback failed;
+    {
+        std::lock_guard<std::mutex> lock(impl_->requests_mutex);
+        auto it = impl_->pending_requests.find(id);
+        if (it == impl_->pending_requests.end()) {
+            return;
+        }
+        failed = std::move(it->second.done);
+        impl_->pending_requests.erase(it);
+    }
+    failed(std::nullopt);
+}
+
+void P2PNetwork::set_request_handler(RequestHandler handler) {
+    std::lock_guard<std::mutex> lock(impl_->handlers_mutex);
+    impl_->request_handler = std::move(handler);
+}
+
+void P2PNetwork::handle_request_frame(const std::string& peer, uint8_t type, std::span<const uint8_t> payload) {
+    if (payload.size() < 8) {
+        impl_->scores->recordInvalid(peer);
+        return;
+    }
+    uint64_t id = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        id |= static_cast<uint64_t>(payload[i]) << (8 * i);
+    }
+    const auto body = payload.subspan(8);
+
+    if (type == wire::types::REQUEST || type == wire::types::BLOCK_TXN_REQUEST ||
+        type == wire::types::CHUNK_REQUEST) {
+        std::vector<uint8_t> response;
+        if (type == wire::types::BLOCK_TXN_REQUEST) {
+            response = serve_block_transactions(body);
+        } else if (type == wire::types::CHUNK_REQUEST) {
+            response = serve_chunk(body);
+        } else {
+            RequestHandler handler;
+            {
+                std::lock_guard<std::mutex> lock(impl_->handlers_mutex);
+                handler = impl_->request_handler;
+            }
+            if (!handler) {
+                return;
+            }
+            response = handler(body, peer);
+        }
+        std::vector<uint8_t> reply(payload.begin(), payload.begin() + 8);
+        reply.insert(reply.end(), response.begin(), response.end());
+        send_frame(peer, wire::types::RESPONSE, reply);
+        return;
+    }
+
+    // Only the peer a request went to may answer it
+    ResponseCallback done;
+    {
+        std::lock_guard<std::mutex> lock(impl_->requests_mutex);
+        auto it = impl_->pending_requests.find(id);
+        if (it == impl_->pending_requests.end() || it->second.peer != peer) {
+            return;
+        }
+        done = std::move(it->second.done);
+        impl_->pending_requests.erase(it);
+    }
+    done(std::vector<uint8_t>(body.begin(), body.end()));
+}
+
+void P2PNetwork::expire_requests(bool all) {
+    std::vector<ResponseCallback> expired;
+    {
+        std::lock_guard<std::mutex> lock(impl_->requests_mutex);
+        const auto now = std::chrono::steady_clock::now();
+        for (auto it = impl_->pending_requests.begin(); it != impl_->pending_requests.end();) {
+            if (all || it->second.deadline <= now) {
+                expired.push_back(std::move(it->second.done));
+                it = impl_->pending_requests.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    // Outside the lock: callbacks may issue new requests
+    for (auto& done : expired) {
+        done(std::nullopt);
+    }
 }
 
 void P2PNetwork::start() {
@@ -220,9 +483,42 @@ void P2PNetwork::start() {
     conn_config.enable_nat_pmp = config_.enable_nat_pmp;
     conn_config.max_peers = config_.max_peers;
     
+    // Ready before the first packet can arrive
+    impl_->dispatcher->start();
+
     auto connection = std::make_shared<P2PConnection>(conn_config);
+    connection->set_message_handler(
+        [this](const std::string& peer_address, uint16_t port, const std::vector<uint8_t>& data) {
+            const std::string peer = peer_address + ":" + std::to_string(port);
+            // A packet may carry several frames; payloads are views into data
+            std::span<const uint8_t> rest(data);
+            wire::Frame frame;
+            while (!rest.empty()) {
+                if (wire::decodeFrame(rest, frame) != wire::Status::Ok) {
+                    QUIDS_LOG_DEBUG("Dropping malformed packet from {}", peer);
+                    impl_->scores->recordInvalid(peer);
+                    return;
+                }
+                if (frame.type() == wire::types::GOSSIP) {
+                    impl_->gossip->handleFrame(peer, frame.payload);
+                } else if (frame.type() == wire::types::REQUEST || frame.type() == wire::types::RESPONSE ||
+                           frame.type() == wire::types::BLOCK_TXN_REQUEST ||
+                           frame.type() == wire::types::CHUNK_REQUEST) {
+                    handle_request_frame(peer, frame.type(), frame.payload);
+                } else if (frame.type() == wire::types::COMPACT_BLOCK) {
+                    impl_->dispatcher->dispatch(impl_->compact_block_frames,
+                                                {frame.payload.begin(), frame.payload.end()}, peer);
+                } else if (frame.type() == wire::types::CHUNK_PUSH) {
+                    impl_->dispatcher->dispatch(impl_->chunk_push_frames,
+                                                {frame.payload.begin(), frame.payload.end()}, peer);
+                }
+                rest = rest.subspan(frame.size());
+            }
+        }
+    );
     if (!connection->start()) {
-        spdlog::error("Failed to start P2P connection");
+        QUIDS_LOG_ERROR("Failed to start P2P connection");
+        impl_->dispatcher->stop();
         return;
     }
     
@@ -238,10 +534,25 @@ void P2PNetwork::start() {
     }
     
     impl_->running = true;
-    spdlog::info("P2P network started on port {}", config_.listen_port);
+    QUIDS_LOG_INFO("P2P network started on port {}", config_.listen_port);
     
     // Start peer discovery
     discover_peers();
+
+    // Announcement batches every ANNOUNCE_INTERVAL; score decay, mesh
+    // upkeep, IHAVE gossip and request timeouts every heartbeat
+    std::thread([this]() {
+        const auto ticks_per_heartbeat = GOSSIP_HEARTBEAT_INTERVAL / ANNOUNCE_INTERVAL;
+        for (int64_t tick = 0; impl_->running; ++tick) {
+            impl_->gossip->flushAnnouncements();
+            if (tick % ticks_per_heartbeat == 0) {
+                impl_->scores->decay();
+                impl_->gossip->heartbeat();
+                expire_requests(false);
+            }
+            std::this_thread::sleep_for(ANNOUNCE_INTERVAL);
+        }
+    }).detach();
 }
 
 void P2PNetwork::stop() {
@@ -257,7 +568,9 @@ void P2PNetwork::stop() {
     }
     
     impl_->running = false;
-    spdlog::info("P2P network stopped");
+    impl_->dispatcher->stop();
+    expire_requests(true);
+    QUIDS_LOG_INFO("P2P network stopped");
 }
 
 bool P2PNetwork::connect_to_peer(const std::string& peer_address) {
@@ -267,7 +580,7 @@ bool P2PNetwork::connect_to_peer(const std::string& peer_address) {
         // Parse address into IP and port
         auto pos = peer_address.find(':');
         if (pos == std::string::npos) {
-            spdlog::error("Invalid peer address format: {}", peer_address);
+            QUIDS_LOG_ERROR("Invalid peer address format: {}", peer_address);
             return false;
         }
         
@@ -280,7 +593,7 @@ bool P2PNetwork::connect_to_peer(const std::string& peer_address) {
             std::lock_guard<std::mutex> lock(impl_->connections_mutex);
             auto it = impl_->connections.find("main");
             if (it == impl_->connections.end()) {
-                spdlog::error("Main connection not found");
+                QUIDS_LOG_ERROR("Main connection not found");
                 return false;
             }
             main_connection = it->second;
@@ -292,7 +605,7 @@ bool P2PNetwork::connect_to_peer(const std::string& peer_address) {
             return true;
         }
     } catch (const std::exception& e) {
-        spdlog::error("Failed to connect to peer {}: {}", peer_address, e.what());
+        QUIDS_LOG_ERROR("Failed to connect to peer {}: {}", peer_address, e.what());
     }
     return false;
 }
@@ -303,12 +616,10 @@ void P2PNetwork::broadcast_transaction(const blockchain::Transaction& tx) {
     // Serialize transaction
     std::vector<uint8_t> data = tx.serialize();
     
-    // Broadcast to all peers
-    std::lock_guard<std::mutex> lock(impl_->connections_mutex);
-    for (auto& [_, connection] : impl_->connections) {
-        connection->broadcast(data);
+    // Announced to the topic mesh, which pulls it and relays it the same way
+    if (impl_->gossip->publish(TRANSACTION_TOPIC, data)) {
+        QUIDS_LOG_DEFERRED(DEBUG, "Broadcasted transaction to network");
     }
-    spdlog::debug("Broadcasted transaction to network");
 }
 
 void P2PNetwork::broadcast_state_update(const rollup::StateTransitionProof& proof) {
@@ -317,12 +628,368 @@ void P2PNetwork::broadcast_state_update(const rollup::StateTransitionProof& proo
     // Serialize proof
     std::vector<uint8_t> data;  // TODO: Implement proof serialization
     
-    // Broadcast to all peers
-    std::lock_guard<std::mutex> lock(impl_->connections_mutex);
-    for (auto& [_, connection] : impl_->connections) {
-        connection->broadcast(data);
+    // Push to the topic mesh; the rest of the network gets it by relay
+    if (impl_->gossip->publish(STATE_UPDATE_TOPIC, data)) {
+        QUIDS_LOG_DEFERRED(DEBUG, "Broadcasted state update to network");
+    }
+}
+
+void P2PNetwork::broadcast_block(std::vector<uint8_t> header, std::span<const CompactBlock::Hash> tx_hashes,
+                                 std::vector<std::vector<uint8_t>> transactions) {
+    if (!impl_->running) return;
+
+    // A fresh salt per block, so a collision is never the same twice
+    std::random_device rd;
+    const uint64_t nonce = (static_cast<uint64_t>(rd()) << 32) | rd();
+    CompactBlock block = CompactBlock::build(std::move(header), tx_hashes, transactions, nonce);
+    impl_->mark_seen(block.id());
+    relay_block(block, std::move(transactions), nullptr);
+    QUIDS_LOG_DEFERRED(DEBUG, "Broadcasted compact block with {} transactions", block.transaction_count());
+}
+
+void P2PNetwork::set_block_handler(CompactBlock::TransactionSource source, BlockHandler handler) {
+    {
+        std::lock_guard<std::mutex> lock(impl_->handlers_mutex);
+        impl_->block_source = std::move(source);
+        impl_->block_handler = std::move(handler);
     }
-    spdlog::debug("Broadcasted state update to network");
+    // Only for the mesh: blocks arrive as direct frames, not as gossip
+    impl_->gossip->subscribe(BLOCK_TOPIC,
+        [](const std::string&, std::span<const uint8_t>, const std::string&) {});
+}
+
+void P2PNetwork::relay_block(const CompactBlock& block, std::vector<std::vector<uint8_t>> transactions,
+                             const std::string* except) {
+    {
+        std::lock_guard<std::mutex> lock(impl_->blocks_mutex);
+        impl_->relayed_blocks.push_back({block.id(), std::move(transactions)});
+        if (impl_->relayed_blocks.size() > Impl::MAX_RELAYED_BLOCKS) {
+            impl_->relayed_blocks.pop_front();
+        }
+    }
+
+    auto peers = impl_->gossip->meshPeers(BLOCK_TOPIC);
+    if (peers.empty()) {
+        peers = impl_->connected_peers;  // not subscribed, so no mesh of our own
+    }
+    const auto payload = block.encode();
+    for (const auto& peer : peers) {
+        if (!except || peer != *except) {
+            send_frame(peer, wire::types::COMPACT_BLOCK, payload);
+        }
+    }
+}
+
+void P2PNetwork::handle_compact_block(const std::string& peer, std::span<const uint8_t> payload) {
+    auto decoded = CompactBlock::decode(payload);
+    if (!decoded) {
+        impl_->scores->recordInvalid(peer);
+        return;
+    }
+    auto block = std::make_shared<const CompactBlock>(std::move(*decoded));
+    CompactBlock::TransactionSource source;
+    {
+        std::lock_guard<std::mutex> lock(impl_->handlers_mutex);
+        if (!impl_->block_handler) {
+            return;
+        }
+        source = impl_->block_source;
+    }
+    if (!impl_->mark_seen(block->id())) {
+        return;
+    }
+
+    auto partial = std::make_shared<PartialBlock>(*block, source);
+    if (partial->complete()) {
+        finish_block(peer, *block, partial->take_transactions(), partial->matched() > 0);
+        return;
+    }
+    QUIDS_LOG_DEBUG("Compact block from {}: {} of {} transactions missing", peer,
+                    partial->missing().size(), block->transaction_count());
+
+    // The sender relays only complete blocks, so it has every one of them
+    const auto request = CompactBlock::encode_request(block->id(), partial->missing());
+    send_request(peer, wire::types::BLOCK_TXN_REQUEST, request,
+        [this, peer, block, partial](std::optional<std::vector<uint8_t>> reply) {
+            std::optional<std::vector<std::vector<uint8_t>>> txs;
+            if (reply) {
+                txs = CompactBlock::decode_transactions(*reply);
+            }
+            if (!txs || !partial->fill(std::move(*txs))) {
+                QUIDS_LOG_DEBUG("Could not complete compact block from {}", peer);
+                impl_->forget_seen(block->id());
+                return;
+            }
+            finish_block(peer, *block, partial->take_transactions(), partial->matched() > 0);
+        }, DEFAULT_REQUEST_TIMEOUT);
+}
+
+void P2PNetwork::finish_block(const std::string& peer, const CompactBlock& block,
+                              std::vector<std::vector<uint8_t>> transactions, bool from_source) {
+    BlockHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(impl_->handlers_mutex);
+        handler = impl_->block_handler;
+    }
+    if (!handler) {
+        return;
+    }
+    if (handler(block.header, transactions, peer)) {
+        relay_block(block, std::move(transactions), &peer);
+        return;
+    }
+    if (!from_source) {
+        // Every transaction came from the peer, so the block itself is bad
+        impl_->scores->recordInvalid(peer);
+        return;
+    }
+
+    // A short id may have matched the wrong held transaction; take them
+    // all from the peer, once
+    std::vector<uint32_t> all(block.transaction_count());
+    std::iota(all.begin(), all.end(), 0);
+    auto retry = std::make_shared<const CompactBlock>(block);
+    send_request(peer, wire::types::BLOCK_TXN_REQUEST, CompactBlock::encode_request(block.id(), all),
+        [this, peer, retry](std::optional<std::vector<uint8_t>> reply) {
+            std::optional<std::vector<std::vector<uint8_t>>> txs;
+            if (reply) {
+                txs = CompactBlock::decode_transactions(*reply);
+            }
+            if (!txs || txs->size() != retry->transaction_count()) {
+                impl_->forget_seen(retry->id());
+                return;
+            }
+            finish_block(peer, *retry, std::move(*txs), false);
+        }, DEFAULT_REQUEST_TIMEOUT);
+}
+
+std::vector<uint8_t> P2PNetwork::serve_block_transactions(std::span<const uint8_t> body) {
+    CompactBlock::Hash id{};
+    std::vector<uint32_t> indexes;
+    if (!CompactBlock::decode_request(body, id, indexes)) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(impl_->blocks_mutex);
+    for (const auto& relayed : impl_->relayed_blocks) {
+        if (relayed.id != id) {
+            continue;
+        }
+        std::vector<std::vector<uint8_t>> txs;
+        txs.reserve(indexes.size());
+        for (const uint32_t index : indexes) {
+            if (index >= relayed.transactions.size()) {
+                return {};
+            }
+            txs.push_back(relayed.transactions[index]);
+        }
+        return CompactBlock::encode_transactions(txs);
+    }
+    return {};
+}
+
+AvailabilityCommitment P2PNetwork::publish_block_chunks(std::span<const uint8_t> block, uint32_t data_chunks,
+                                                       uint32_t parity_chunks) {
+    ChunkedBlock chunked = ChunkedBlock::encode(block, data_chunks, parity_chunks);
+    const AvailabilityCommitment commitment = chunked.commitment();
+    const auto id = commitment.id();
+    const auto prefix = commitment.encode();
+
+    for (const auto& chunk : chunked.chunks()) {
+        std::vector<uint8_t> payload = prefix;
+        const auto encoded = chunk.encode();
+        payload.insert(payload.end(), encoded.begin(), encoded.end());
+        for (const auto& peer : chunk_holders(commitment, chunk.index, CHUNK_REPLICATION)) {
+            send_frame(peer, wire::types::CHUNK_PUSH, payload);
+        }
+        impl_->store_chunk(id, chunk);
+    }
+    QUIDS_LOG_DEFERRED(DEBUG, "Published {} byte block as {} chunks of {} bytes", block.size(),
+                       commitment.total_chunks(), commitment.chunk_size);
+    return commitment;
+}
+
+void P2PNetwork::sample_availability(const AvailabilityCommitment& commitment, size_t samples,
+                                     AvailabilityCallback done) {
+    std::mt19937_64 rng(std::random_device{}());
+    const auto indexes = ChunkedBlock::sample(commitment, samples, rng);
+    if (indexes.empty()) {
+        done(false);
+        return;
+    }
+
+    struct Sampling {
+        std::mutex mutex;
+        size_t outstanding;
+        bool available{true};
+        AvailabilityCallback done;
+    };
+    auto state = std::make_shared<Sampling>();
+    state->outstanding = indexes.size();
+    state->done = std::move(done);
+    for (const uint32_t index : indexes) {
+        fetch_chunk(commitment, index, [state](std::optional<BlockChunk> chunk) {
+            bool finished = false;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->available = state->available && chunk.has_value();
+                finished = --state->outstanding == 0;
+            }
+            if (finished) {
+                state->done(state->available);
+            }
+        });
+    }
+}
+
+void P2PNetwork::fetch_chunked_block(const AvailabilityCommitment& commitment, ChunkedBlockCallback done) {
+    // Any data_chunks will do; ask for that many at random, and for
+    // another each time one cannot be had
+    std::mt19937_64 rng(std::random_device{}());
+    struct Fetch {
+        std::mutex mutex;
+        std::vector<uint32_t> order;
+        size_t next{0};
+        size_t outstanding{0};
+        std::vector<BlockChunk> chunks;
+        bool finished{false};
+        ChunkedBlockCallback done;
+    };
+    auto state = std::make_shared<Fetch>();
+    state->order = ChunkedBlock::sample(commitment, commitment.total_chunks(), rng);
+    state->done = std::move(done);
+
+    auto step = std::make_shared<std::function<void(std::optional<BlockChunk>)>>();
+    *step = [this, state, commitment, weak = std::weak_ptr(step)](std::optional<BlockChunk> chunk) {
+        std::optional<uint32_t> launch;
+        std::optional<std::optional<std::vector<uint8_t>>> result;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            --state->outstanding;
+            if (state->finished) return;
+            if (chunk) {
+                state->chunks.push_back(std::move(*chunk));
+                if (state->chunks.size() == commitment.data_chunks) {
+                    result = ChunkedBlock::reconstruct(commitment, state->chunks);
+                }
+            } else if (state->next < state->order.size()) {
+                launch = state->order[state->next++];
+                ++state->outstanding;
+            } else if (state->outstanding == 0) {
+                result = std::optional<std::vector<uint8_t>>{};
+            }
+            state->finished = result.has_value();
+        }
+        if (result) {
+            state->done(std::move(*result));
+        } else if (auto next = weak.lock(); launch && next) {
+            fetch_chunk(commitment, *launch, *next);
+        }
+    };
+
+    std::vector<uint32_t> first;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->next = std::min<size_t>(commitment.data_chunks, state->order.size());
+        first.assign(state->order.begin(), state->order.begin() + state->next);
+        state->outstanding = first.size();
+    }
+    if (first.empty()) {
+        state->done(std::nullopt);
+        return;
+    }
+    // Each request holds step, so it lives until the last one is answered
+    for (const uint32_t index : first) {
+        fetch_chunk(commitment, index, [step](std::optional<BlockChunk> chunk) { (*step)(std::move(chunk)); });
+    }
+}
+
+std::vector<std::string> P2PNetwork::chunk_holders(const AvailabilityCommitment& commitment, uint32_t index,
+                                                   size_t count) {
+    const auto key = commitment.chunk_key(index);
+    std::vector<std::string> holders;
+    for (const auto& node : impl_->find_closest_nodes(std::string(key.begin(), key.end()), count)) {
+        holders.push_back(node.address + ":" + std::to_string(node.port));
+    }
+    if (holders.empty() && !impl_->connected_peers.empty()) {
+        // No routing table yet: spread over the peers we have by key
+        const auto& peers = impl_->connected_peers;
+        const size_t start = key[0] | (size_t{key[1]} << 8);
+        for (size_t i = 0; i < std::min(count, peers.size()); ++i) {
+            holders.push_back(peers[(start + i) % peers.size()]);
+        }
+    }
+    return holders;
+}
+
+void P2PNetwork::fetch_chunk(const AvailabilityCommitment& commitment, uint32_t index,
+                             std::function<void(std::optional<BlockChunk>)> done) {
+    const auto id = commitment.id();
+    if (auto chunk = impl_->stored_chunk(id, index)) {
+        done(std::move(chunk));
+        return;
+    }
+
+    // Holders as we see them may differ a little from the publisher's
+    // view, so ask a couple beyond the replication factor, one at a time
+    std::vector<uint8_t> body(id.begin(), id.end());
+    for (int i = 0; i < 4; ++i) body.push_back(static_cast<uint8_t>(index >> (8 * i)));
+    auto candidates = std::make_shared<const std::vector<std::string>>(
+        chunk_holders(commitment, index, CHUNK_REPLICATION + 2));
+
+    // Asks candidate `next`, or finishes with `found`
+    auto attempt = std::make_shared<std::function<void(size_t, std::optional<BlockChunk>)>>();
+    *attempt = [this, commitment, index, id, body, candidates, done = std::move(done),
+                weak = std::weak_ptr(attempt)](size_t next, std::optional<BlockChunk> found) {
+        if (found || next >= candidates->size()) {
+            done(std::move(found));
+            return;
+        }
+        // The pending request keeps the chain alive
+        auto self = weak.lock();
+        const std::string peer = (*candidates)[next];
+        send_request(peer, wire::types::CHUNK_REQUEST, body,
+            [this, commitment, index, id, peer, next, self](std::optional<std::vector<uint8_t>> reply) {
+                std::optional<BlockChunk> chunk;
+                if (reply && !reply->empty()) {
+                    chunk = BlockChunk::decode(*reply);
+                    if (!chunk || chunk->index != index || !ChunkedBlock::verify(commitment, *chunk)) {
+                        impl_->scores->recordInvalid(peer);
+                        chunk.reset();
+                    }
+                }
+                if (chunk) {
+                    impl_->store_chunk(id, *chunk);
+                }
+                (*self)(next + 1, std::move(chunk));
+            }, DEFAULT_REQUEST_TIMEOUT);
+    };
+    (*attempt)(0, std::nullopt);
+}
+
+void P2PNetwork::handle_chunk_push(const std::string& peer, std::span<const uint8_t> payload) {
+    if (payload.size() < AvailabilityCommitment::ENCODED_SIZE) {
+        impl_->scores->recordInvalid(peer);
+        return;
+    }
+    const auto commitment = AvailabilityCommitment::decode(payload.first(AvailabilityCommitment::ENCODED_SIZE));
+    auto chunk = BlockChunk::decode(payload.subspan(AvailabilityCommitment::ENCODED_SIZE));
+    if (!commitment || !chunk || !ChunkedBlock::verify(*commitment, *chunk)) {
+        impl_->scores->recordInvalid(peer);
+        return;
+    }
+    impl_->store_chunk(commitment->id(), std::move(*chunk));
+}
+
+std::vector<uint8_t> P2PNetwork::serve_chunk(std::span<const uint8_t> body) {
+    if (body.size() != 32 + 4) {
+        return {};
+    }
+    AvailabilityCommitment::Hash id{};
+    std::copy_n(body.begin(), id.size(), id.begin());
+    uint32_t index = 0;
+    for (int i = 0; i < 4; ++i) index |= static_cast<uint32_t>(body[32 + i]) << (8 * i);
+    const auto chunk = impl_->stored_chunk(id, index);
+    return chunk ? chunk->encode() : std::vector<uint8_t>{};
 }
 
 std::vector<P2PNetwork::NodeInfo> P2PNetwork::get_connected_peers() const {
@@ -336,28 +1003,38 @@ std::vector<P2PNetwork::NodeInfo> P2PNetwork::get_connected_peers() const {
             info.address = peer.address;
             info.port = peer.port;
             info.is_validator = false;  // TODO: Implement validator detection
+            info.score = impl_->scores->score(peer.address + ":" + std::to_string(peer.port));
             peers.push_back(info);
         }
     }
     return peers;
 }
 
+MessageDispatcher::Priority P2PNetwork::default_priority(const std::string& topic) {
+    if (topic == CONSENSUS_TOPIC) return MessageDispatcher::Priority::Consensus;
+    if (topic == BLOCK_TOPIC || topic == STATE_UPDATE_TOPIC) return MessageDispatcher::Priority::Blocks;
+    return MessageDispatcher::Priority::Transactions;
+}
+
 void P2PNetwork::register_message_handler(const std::string& topic, MessageHandler handler) {
-    std::lock_guard<std::mutex> lock(impl_->handlers_mutex);
-    impl_->message_handlers[topic] = std::move(handler);
-    
-    // Register handler with all connections
-    std::lock_guard<std::mutex> conn_lock(impl_->connections_mutex);
-    for (auto& [_, connection] : impl_->connections) {
-        connection->set_message_handler(
-            [this, topic](const std::string& peer_id, uint16_t port, const std::vector<uint8_t>& data) {
-                if (auto it = impl_->message_handlers.find(topic); 
-                    it != impl_->message_handlers.end()) {
-                    it->second(data, topic);
-                }
-            }
-        );
-    }
+    register_message_handler(topic, std::move(handler), default_priority(topic));
+}
+
+void P2PNetwork::register_message_handler(const std::string& topic, MessageHandler handler,
+                                          MessageDispatcher::Priority priority) {
+    const auto id = impl_->dispatcher->intern(topic);
+    impl_->dispatcher->setHandler(id, priority,
+        [topic, handler = std::move(handler)](const std::vector<uint8_t>& payload, const std::string&) {
+            handler(payload, topic);
+        });
+
+    // Joining the topic's mesh; duplicates are dropped before dispatch, so
+    // the handler sees each message once
+    impl_->gossip->subscribe(topic,
+        [this, id](const std::string&, std::span<const uint8_t> payload, const std::string& from) {
+            impl_->dispatcher->dispatch(id, {payload.begin(), payload.end()}, from);
+        }
+    );
 }
 
 bool P2PNetwork::register_as_validator(const std::string& validator_key) {
@@ -371,29 +1048,53 @@ void P2PNetwork::discover_peers() {
     std::thread([this]() {
         while (impl_->running) {
             // Get peers from all connections
-            std::lock_guard<std::mutex> lock(impl_->connections_mutex);
-            for (auto& [_, connection] : impl_->connections) {
-                auto peers = connection->get_connected_peers();
-                for (const auto& peer : peers) {
-                    handle_peer_connection(peer.address + ":" + std::to_string(peer.port));
+            std::vector<std::string> discovered;
+            {
+                std::lock_guard<std::mutex> lock(impl_->connections_mutex);
+                for (auto& [_, connection] : impl_->connections) {
+                    for (const auto& peer : connection->get_connected_peers()) {
+                        discovered.push_back(peer.address + ":" + std::to_string(peer.port));
+                    }
                 }
             }
+            // Outside the lock: announcing to gossip sends on a connection
+            for (const auto& peer : discovered) {
+                handle_peer_connection(peer);
+            }
             std::this_thread::sleep_for(std::chrono::seconds(30));
         }
     }).detach();
 }
 
 void P2PNetwork::handle_peer_connection(const ::std::string& peer_address) {
-    spdlog::info("New peer connected: {}", peer_address);
-    impl_->connected_peers.push_back(peer_address);
+    QUIDS_LOG_INFO("New peer connected: {}", peer_address);
+    if (std::find(impl_->connected_peers.begin(), impl_->connected_peers.end(), peer_address) ==
+        impl_->connected_peers.end()) {
+        impl_->connected_peers.push_back(peer_address);
+    }
+    impl_->scores->addPeer(peer_address);
+    impl_->gossip->addPeer(peer_address);
+
+    // Over the limit, the worst-behaved non-validator makes room; a
+    // newcomer starts at 0, so it only loses to peers doing no better
+    while (impl_->connected_peers.size() > config_.max_peers) {
+        auto victim = impl_->scores->evictionCandidate();
+        if (!victim) {
+            break;
+        }
+        QUIDS_LOG_INFO("Evicting peer {} (score {:.2f})", *victim, impl_->scores->score(*victim));
+        handle_peer_disconnection(*victim);
+    }
 }
 
 void P2PNetwork::handle_peer_disconnection(const ::std::string& peer_address) {
-    spdlog::info("Peer disconnected: {}", peer_address);
+    QUIDS_LOG_INFO("Peer disconnected: {}", peer_address);
     auto it = ::std::find(impl_->connected_peers.begin(), impl_->connected_peers.end(), peer_address);
     if (it != impl_->connected_peers.end()) {
         impl_->connected_peers.erase(it);
     }
+    impl_->scores->removePeer(peer_address);
+    impl_->gossip->removePeer(peer_address);
 }
 
 std::string P2PNetwork::generate_node_id() {
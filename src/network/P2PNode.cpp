@@ -16,6 +16,7 @@
 #include <atomic>
 #include <thread>
 #include <cstring>
+#include <string_view>
 
 using namespace std::chrono_literals;
 
@@ -25,10 +26,7 @@ namespace quids::network {
 P2PNode::P2PNode(const Config& config)
     : config_(config), impl_(std::make_unique<Impl>()) {
     impl_->config = config;
-    impl_->socket_ = boost::asio::ip::udp::socket(impl_->io_context_);
-    impl_->accept_thread = std::thread();
     impl_->management_thread = std::thread();
-    impl_->message_thread = std::thread();
     impl_->should_stop = false;
     impl_->connections.clear();
     // Initialize other members...
@@ -43,18 +41,21 @@ bool P2PNode::start() {
     if (impl_->should_stop) return false;
 
     try {
-        // Open and bind socket
-        impl_->socket_.open(boost::asio::ip::udp::v4());
-        boost::asio::ip::udp::endpoint endpoint(
-            boost::asio::ip::make_address(config_.bind_address.empty() ? "0.0.0.0" : config_.bind_address),
-            config_.bind_port
-        );
-        impl_->socket_.bind(endpoint);
-
-        // Start threads
-        impl_->accept_thread = std::thread([this]() { accept_connections(); });
+        // The engine owns the bound sockets and their receive threads
+        DatagramEngine::Config datagram_config;
+        datagram_config.bind_address = config_.bind_address.empty() ? "0.0.0.0" : config_.bind_address;
+        datagram_config.port = config_.bind_port;
+        datagram_config.workers = config_.datagram_workers;
+        datagram_config.batch = config_.datagram_batch;
+        datagram_config.enable_gro = config_.enable_gro;
+        datagram_config.enable_gso = config_.enable_gso;
+        impl_->datagrams = std::make_unique<DatagramEngine>(datagram_config,
+            [this](const std::string& address, uint16_t port, std::span<const uint8_t> data) {
+                handle_datagram(address, port, data);
+            });
+        impl_->datagrams->start();
+
         impl_->management_thread = std::thread([this]() { manage_connections(); });
-        impl_->message_thread = std::thread([this]() { handle_incoming_messages(); });
 
         return true;
     } catch (const std::exception& e) {
@@ -66,14 +67,11 @@ bool P2PNode::start() {
 void P2PNode::stop() {
     impl_->should_stop = true;
     
-    if (impl_->socket_.is_open()) {
-        boost::system::error_code ec;
-        impl_->socket_.close(ec);
+    if (impl_->datagrams) {
+        impl_->datagrams->stop();
     }
 
-    if (impl_->accept_thread.joinable()) impl_->accept_thread.join();
     if (impl_->management_thread.joinable()) impl_->management_thread.join();
-    if (impl_->message_thread.joinable()) impl_->message_thread.join();
 }
 
 bool P2PNode::connect_to_peer(const std::string& address, uint16_t port) {
@@ -88,7 +86,10 @@ bool P2PNode::connect_to_peer(const std::string& address, uint16_t port) {
         conn_config.enable_nat_pmp = config_.enable_nat_pmp;
 
         auto connection = std::make_shared<P2PConnection>(impl_->io_context_, conn_config);
-        connection->set_message_handler(impl_->message_handler_);
+        connection->set_message_handler(
+            [this](const std::string& peer_address, uint16_t peer_port, const std::vector<uint8_t>& message) {
+                notify_handlers(peer_address, peer_port, message);
+            });
 
         if (connection->start() && connection->perform_nat_traversal(address, port)) {
             std::lock_guard<std::mutex> lock(impl_->connections_mutex);
@@ -122,19 +123,42 @@ std::vector<P2PNode::PeerInfo> P2PNode::get_connected_peers() const {
 }
 
 bool P2PNode::broadcast_message(const std::vector<uint8_t>& message) {
-    if (impl_->should_stop) return false;
-
-    bool success = true;
-    std::lock_guard<std::mutex> lock(impl_->connections_mutex);
+    if (impl_->should_stop || !impl_->datagrams) return false;
 
-    for (const auto& [_, connection] : impl_->connections) {
-        if (connection->is_connected()) {
-            success &= connection->send_message(connection->get_address(), 
-                                             connection->get_port(), 
-                                             message);
+    std::vector<DatagramEngine::Outgoing> outgoing;
+    {
+        std::lock_guard<std::mutex> lock(impl_->connections_mutex);
+        outgoing.reserve(impl_->connections.size());
+        for (const auto& [_, connection] : impl_->connections) {
+            if (connection->is_connected()) {
+                boost::system::error_code ec;
+                auto address = boost::asio::ip::make_address(connection->get_address(), ec);
+                if (!ec) {
+                    outgoing.push_back({{address, connection->get_port()}, message});
+                }
+            }
         }
     }
-    return success;
+    // One sendmmsg per batch of peers instead of a send per peer
+    return impl_->datagrams->send(outgoing) == outgoing.size();
+}
+
+bool P2PNode::send_message_to_peer(const std::string& address, uint16_t port, const std::vector<uint8_t>& message) {
+    if (impl_->should_stop || !impl_->datagrams) return false;
+
+    boost::system::error_code ec;
+    auto peer = boost::asio::ip::make_address(address, ec);
+    if (ec) {
+        spdlog::error("Invalid peer address {}: {}", address, ec.message());
+        return false;
+    }
+    const DatagramEngine::Outgoing outgoing{{peer, port}, message};
+    return impl_->datagrams->send(std::span(&outgoing, 1)) == 1;
+}
+
+void P2PNode::register_message_handler(MessageHandler handler) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    message_handlers_.push_back(std::move(handler));
 }
 
 void P2PNode::cleanup() noexcept {
@@ -146,45 +170,54 @@ void P2PNode::cleanup() noexcept {
     }
 }
 
-void P2PNode::accept_connections() {
-    std::vector<uint8_t> buffer(1024); // Fixed buffer size
-    boost::asio::ip::udp::endpoint sender_endpoint;
+void P2PNode::handle_datagram(const std::string& address, uint16_t port, std::span<const uint8_t> data) {
+    static constexpr std::string_view PUNCH = "PUNCH";
+    if (data.size() >= PUNCH.size() && std::equal(PUNCH.begin(), PUNCH.end(), data.begin())) {
+        handle_nat_traversal_response({}, data.size());
+        return;
+    }
+    register_peer(address, port);
+    notify_handlers(address, port, data);
+}
+
+void P2PNode::register_peer(const std::string& address, uint16_t port) {
+    const std::string peer_key = address + ":" + std::to_string(port);
+    {
+        std::lock_guard<std::mutex> lock(impl_->connections_mutex);
+        if (impl_->connections.count(peer_key) != 0 ||
+            impl_->connections.size() >= config_.max_connections) {
+            return;
+        }
+    }
 
-    while (!impl_->should_stop) {
-        try {
-            // Receive incoming UDP packets
-            size_t bytes_received = impl_->socket_.receive_from(
-                boost::asio::buffer(buffer), sender_endpoint);
-
-            if (bytes_received > 0) {
-                std::string client_ip = sender_endpoint.address().to_string();
-                uint16_t client_port = sender_endpoint.port();
-
-                // Create connection config
-                Config conn_config;
-                conn_config.port = config_.port;
-                conn_config.stun_server = config_.stun_server;
-                conn_config.stun_port = config_.stun_port;
-                conn_config.enable_upnp = config_.enable_upnp;
-                conn_config.enable_nat_pmp = config_.enable_nat_pmp;
-                conn_config.max_peers = config_.max_peers;
-
-                // Create and start connection
-                auto connection = std::make_shared<P2PConnection>(impl_->io_context_, conn_config);
-                if (connection->start()) {
-                    std::string peer_key = client_ip + ":" + std::to_string(client_port);
-                    {
-                        std::lock_guard<std::mutex> lock(impl_->connections_mutex);
-                        impl_->connections[peer_key] = connection;
-                    }
-                    
-                    update_peer_info(client_ip, client_port, true);
-                }
+    try {
+        // Create connection config
+        Config conn_config;
+        conn_config.port = config_.port;
+        conn_config.stun_server = config_.stun_server;
+        conn_config.stun_port = config_.stun_port;
+        conn_config.enable_upnp = config_.enable_upnp;
+        conn_config.enable_nat_pmp = config_.enable_nat_pmp;
+        conn_config.max_peers = config_.max_peers;
+
+        // Create and start connection
+        auto connection = std::make_shared<P2PConnection>(impl_->io_context_, conn_config);
+        if (connection->start()) {
+            {
+                std::lock_guard<std::mutex> lock(impl_->connections_mutex);
+                impl_->connections.emplace(peer_key, connection);
             }
-        } catch (const std::exception& e) {
-            spdlog::error("Error accepting connection: {}", e.what());
+            update_peer_info(address, port, true);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    } catch (const std::exception& e) {
+        spdlog::error("Error accepting connection: {}", e.what());
+    }
+}
+
+void P2PNode::notify_handlers(const std::string& address, uint16_t port, std::span<const uint8_t> data) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    for (const auto& handler : message_handlers_) {
+        handler(address, port, data);
     }
 }
 
@@ -213,29 +246,6 @@ void P2PNode::manage_connections() {
     }
 }
 
-void P2PNode::handle_incoming_messages() {
-    std::vector<uint8_t> buffer(1024);
-    boost::asio::ip::udp::endpoint sender_endpoint;
-
-    while (!impl_->should_stop) {
-        try {
-            size_t bytes_received = impl_->socket_.receive_from(
-                boost::asio::buffer(buffer), sender_endpoint);
-
-            if (bytes_received > 0 && impl_->message_handler_) {
-                impl_->message_handler_(
-                    sender_endpoint.address().to_string(),
-                    sender_endpoint.port(),
-                    std::vector<uint8_t>(buffer.begin(), buffer.begin() + bytes_received)
-                );
-            }
-        } catch (const std::exception& e) {
-            spdlog::error("Error receiving message: {}", e.what());
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
-}
-
 void P2PNode::cleanup_disconnected_peers() {
     std::lock_guard<std::mutex> lock(impl_->connections_mutex);
     for (auto it = impl_->connections.begin(); it != impl_->connections.end();) {
@@ -264,30 +274,6 @@ void P2PNode::update_peer_info(const std::string& address, uint16_t port, bool c
               << (connected ? " connected" : " disconnected") << std::endl;
 }
 
-void P2PNode::process_incoming_connections() {
-    auto buffer = std::make_shared<std::vector<uint8_t>>(1024); // Use fixed size
-    auto sender = std::make_shared<boost::asio::ip::udp::endpoint>();
-
-    impl_->socket_.async_receive_from(
-        boost::asio::buffer(*buffer), *sender,
-        [this, buffer, sender](const boost::system::error_code& error, size_t len) {
-            if (!error) {
-                // Handle NAT traversal first
-                if (len >= 4 && std::equal(buffer->begin(), buffer->begin() + 4, "PUNCH")) {
-                    handle_nat_traversal_response(error, len);
-                } else if (impl_->message_handler_) {
-                    impl_->message_handler_(
-                        sender->address().to_string(),
-                        sender->port(),
-                        std::vector<uint8_t>(buffer->begin(), buffer->begin() + len)
-                    );
-                }
-            }
-            process_incoming_connections(); // Continue listening
-        }
-    );
-}
-
 void P2PNode::handle_nat_traversal_response(
     const boost::system::error_code& error, 
     size_t bytes_transferred
@@ -0,0 +1,159 @@
+#include "network/PeerScoreBook.hpp"
+#include "utils/HealthSampler.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace quids::network {
+
+namespace {
+
+// RFC 6298 smoothing
+constexpr double RTT_GAIN = 0.125;
+// Throughput blends a quarter of the latest interval into the average
+constexpr double THROUGHPUT_GAIN = 0.25;
+
+double decayed(double value, double factor, double floor) noexcept {
+    value *= factor;
+    return value < floor ? 0.0 : value;
+}
+
+} // namespace
+
+PeerScoreBook::PeerScoreBook(const Config& config) : config_(config) {
+    if (config.decay_factor <= 0.0 || config.decay_factor >= 1.0 || config.rtt_reference.count() <= 0 ||
+        config.throughput_reference <= 0.0 || config.min_share <= 0.0) {
+        throw std::invalid_argument("invalid peer score configuration");
+    }
+}
+
+void PeerScoreBook::addPeer(const PeerID& peer, bool validator) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& state = peers_[peer];
+    state.connected = true;
+    state.rounds_away = 0;
+    state.validator = state.validator || validator;
+}
+
+void PeerScoreBook::removePeer(const PeerID& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = peers_.find(peer); it != peers_.end()) {
+        it->second.connected = false;
+    }
+}
+
+void PeerScoreBook::setValidator(const PeerID& peer, bool validator) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    peers_[peer].validator = validator;
+}
+
+void PeerScoreBook::recordRtt(const PeerID& peer, std::chrono::microseconds rtt) {
+    utils::HealthSampler::global().record_network_latency(rtt);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& state = peers_[peer];
+    const double sample = static_cast<double>(std::max<int64_t>(rtt.count(), 1));
+    state.srtt_us = state.srtt_us == 0.0 ? sample : state.srtt_us + RTT_GAIN * (sample - state.srtt_us);
+}
+
+void PeerScoreBook::recordDelivery(const PeerID& peer, size_t bytes, bool first) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& state = peers_[peer];
+    state.deliveries += 1.0;
+    if (first) {
+        state.first_deliveries += 1.0;
+        state.useful_bytes += static_cast<double>(bytes);
+    }
+}
+
+void PeerScoreBook::recordInvalid(const PeerID& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    peers_[peer].invalid += 1.0;
+}
+
+void PeerScoreBook::decay(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const double seconds = std::chrono::duration<double>(now - last_decay_).count();
+    last_decay_ = now;
+
+    for (auto it = peers_.begin(); it != peers_.end();) {
+        Peer& state = it->second;
+        if (seconds > 0.0) {
+            state.throughput += THROUGHPUT_GAIN * (state.useful_bytes / seconds - state.throughput);
+        }
+        state.useful_bytes = 0.0;
+        state.throughput = decayed(state.throughput, 1.0, config_.decay_to_zero);
+        state.first_deliveries = decayed(state.first_deliveries, config_.decay_factor, config_.decay_to_zero);
+        state.deliveries = decayed(state.deliveries, config_.decay_factor, config_.decay_to_zero);
+        state.invalid = decayed(state.invalid, config_.decay_factor, config_.decay_to_zero);
+
+        if (!state.connected && ++state.rounds_away > config_.retain_rounds) {
+            it = peers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+double PeerScoreBook::scoreOf(const Peer& peer) const noexcept {
+    double score = 0.0;
+    if (peer.srtt_us > 0.0) {
+        const double reference = static_cast<double>(config_.rtt_reference.count());
+        score += config_.rtt_weight * reference / (reference + peer.srtt_us);
+    }
+    score += config_.throughput_weight * peer.throughput / (peer.throughput + config_.throughput_reference);
+    score += config_.useful_weight * peer.first_deliveries / (peer.deliveries + 1.0);
+    score += config_.invalid_weight * peer.invalid * peer.invalid;
+    if (peer.validator) {
+        score += config_.validator_bonus;
+    }
+    return score;
+}
+
+double PeerScoreBook::score(const PeerID& peer) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = peers_.find(peer);
+    return it == peers_.end() ? 0.0 : scoreOf(it->second);
+}
+
+std::optional<PeerScoreBook::PeerID> PeerScoreBook::evictionCandidate() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const PeerID* worst = nullptr;
+    double worst_score = std::numeric_limits<double>::infinity();
+    for (const auto& [peer, state] : peers_) {
+        if (!state.connected || state.validator) {
+            continue;
+        }
+        // Ties go to the smaller id so every caller agrees
+        const double current = scoreOf(state);
+        if (current < worst_score || (current == worst_score && peer < *worst)) {
+            worst = &peer;
+            worst_score = current;
+        }
+    }
+    if (worst == nullptr) {
+        return std::nullopt;
+    }
+    return *worst;
+}
+
+std::vector<std::pair<PeerScoreBook::PeerID, double>> PeerScoreBook::bandwidthWeights() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<PeerID, double>> weights;
+    weights.reserve(peers_.size());
+    for (const auto& [peer, state] : peers_) {
+        if (!state.connected) {
+            continue;
+        }
+        // A neutral newcomer gets a share of 1; the validator bonus is
+        // left out so validators are scaled by validator_share alone
+        double share = 1.0 + scoreOf(state) - (state.validator ? config_.validator_bonus : 0.0);
+        share = std::max(share, config_.min_share);
+        if (state.validator) {
+            share *= config_.validator_share;
+        }
+        weights.emplace_back(peer, share);
+    }
+    return weights;
+}
+
+} // namespace quids::network
@@ -0,0 +1,219 @@
+#include "network/QDHT.hpp"
+#include "quantum/QuantumState.hpp"
+#include <algorithm>
+#include <chrono>
+#include <Eigen/Dense>
+
+using std::make_unique;
+using std::array;
+using std::chrono::steady_clock;
+using quids::quantum::QuantumState;
+
+namespace quids::network {
+
+static_assert(QDHT_ID_LENGTH / 8 == RoutingIndex::KEY_BYTES, "bucket index keys are node ids");
+
+// Helper function declarations
+bool get_bit(const array<uint8_t, QDHT_ID_LENGTH / 8>& id, size_t index) {
+    return (id[index / 8] >> (index % 8)) & 1;
+}
+
+// QDHTBucket method implementations
+QDHTBucket::QDHTBucket()
+    : last_updated_(steady_clock::now()),
+      prefix_length_(0),
+      metrics_({0.0, 0.0, 0.0, 0.0, QuantumState(QDHT_STATE_QUBITS)}),
+      routing_tree_(make_unique<QuantumRoutingTree>()) {
+    prefix_.fill(0);
+    initialize_quantum_state();
+}
+
+QDHTBucket::~QDHTBucket() = default;
+
+// Full rebuild, for construction and refresh; membership changes go
+// through add_to_routing_tree
+void QDHTBucket::initialize_quantum_state() {
+    routing_sum_ = QuantumState(QDHT_STATE_QUBITS).getStateVector();
+    for (const auto& node : nodes_) {
+        add_to_routing_tree(node, 1.0);
+    }
+    metrics_dirty_ = true;
+}
+
+void QDHTBucket::add_to_routing_tree(const QNodeIdentity& node, double sign) {
+    routing_sum_ += sign * node.quantum_state.getStateVector();
+}
+
+const QBucketMetrics& QDHTBucket::get_metrics() const {
+    if (metrics_dirty_) {
+        update_metrics();
+    }
+    return metrics_;
+}
+
+bool QDHTBucket::add_node(const QNodeIdentity& node) {
+    // Members' states are summed into the routing state
+    if (node.quantum_state.getStateVector().size() != routing_sum_.size()) {
+        return false;
+    }
+    const size_t position = index_.find(node.id);
+    
+    if (position < nodes_.size()) {
+        add_to_routing_tree(nodes_[position], -1.0);
+        add_to_routing_tree(node, 1.0);
+        nodes_[position] = node;
+        metrics_dirty_ = true;
+        return true;
+    }
+    
+    if (nodes_.size() >= QDHT_K) {
+        return false;
+    }
+    
+    nodes_.push_back(node);
+    index_.add(node.id);
+    add_to_routing_tree(node, 1.0);
+    metrics_dirty_ = true;
+    return true;
+}
+
+bool QDHTBucket::remove_node(const QNodeIdentity& node) {
+    const size_t position = index_.find(node.id);
+    
+    if (position < nodes_.size()) {
+        // Mirror the index's swap-remove so positions stay aligned
+        index_.remove(position);
+        add_to_routing_tree(nodes_[position], -1.0);
+        if (position != nodes_.size() - 1) {
+            nodes_[position] = std::move(nodes_.back());
+        }
+        nodes_.pop_back();
+        metrics_dirty_ = true;
+        return true;
+    }
+    
+    return false;
+}
+
+std::vector<QNodeIdentity> QDHTBucket::get_closest_nodes(
+        const QNodeIdentity& target,
+        size_t count) {
+    std::vector<QNodeIdentity> result;
+    for (uint32_t position : index_.closest(target.id, count)) {
+        result.push_back(nodes_[position]);
+    }
+    return result;
+}
+
+bool QDHTBucket::should_split() const {
+    return nodes_.size() >= QDHT_K && prefix_length_ < QDHT_ID_LENGTH;
+}
+
+std::pair<std::unique_ptr<QDHTBucket>, std::unique_ptr<QDHTBucket>> QDHTBucket::split() {
+    auto left = std::make_unique<QDHTBucket>();
+    auto right = std::make_unique<QDHTBucket>();
+    
+    left->prefix_length_ = prefix_length_ + 1;
+    right->prefix_length_ = prefix_length_ + 1;
+    
+    left->prefix_ = prefix_;
+    right->prefix_ = prefix_;
+    if (prefix_length_ < QDHT_ID_LENGTH) {
+        right->prefix_[prefix_length_ / 8] |= (1 << (prefix_length_ % 8));
+    }
+    
+    for (const auto& node : nodes_) {
+        if (get_bit(node.id, prefix_length_)) {
+            right->add_node(node);
+        } else {
+            left->add_node(node);
+        }
+    }
+    
+    return std::make_pair(::std::move(left), ::std::move(right));
+}
+
+void QDHTBucket::refresh() {
+    auto now = std::chrono::steady_clock::now();
+    nodes_.erase(
+        std::remove_if(nodes_.begin(), nodes_.end(),
+            [&now](const QNodeIdentity& node) {
+                return (now - node.last_seen) > std::chrono::minutes(30);
+            }),
+        nodes_.end());
+    
+    index_.clear();
+    for (const auto& node : nodes_) {
+        index_.add(node.id);
+    }
+
+    // On the refresh timer, so also where rounding in the running sum is
+    // shed and the metrics catch up without waiting for a read
+    initialize_quantum_state();
+    update_metrics();
+}
+
+void QDHTBucket::update_metrics() const {
+    metrics_.entanglement_factor = calculate_entanglement_factor();
+    metrics_.quantum_entropy = calculate_quantum_entropy();
+    metrics_.coherence_level = calculate_coherence_level();
+    metrics_.routing_efficiency = 1.0 - (static_cast<double>(nodes_.size()) / QDHT_K);
+
+    routing_tree_->state = QuantumState(routing_sum_.normalized());
+    Eigen::VectorXcd combined = metrics_.quantum_state.getStateVector() + routing_tree_->state.getStateVector();
+    combined.normalize();
+    metrics_.quantum_state = QuantumState(::std::move(combined));
+    metrics_dirty_ = false;
+}
+
+double QDHTBucket::calculate_entanglement_factor() const {
+    if (nodes_.empty()) return 0.0;
+    
+    double total_entanglement = 0.0;
+    size_t num_pairs = 0;
+    
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        for (size_t j = i + 1; j < nodes_.size(); ++j) {
+            auto overlap = (nodes_[i].quantum_state.getStateVector().adjoint() * 
+                          nodes_[j].quantum_state.getStateVector()).norm();
+            total_entanglement += overlap;
+            num_pairs++;
+        }
+    }
+    
+    return num_pairs > 0 ? total_entanglement / num_pairs : 0.0;
+}
+
+double QDHTBucket::calculate_coherence_level() const {
+    if (nodes_.empty()) return 0.0;
+    
+    double total_coherence = 0.0;
+    for (const auto& node : nodes_) {
+        const double norm = node.quantum_state.describe().norm;
+        total_coherence += norm * norm;
+    }
+    
+    return total_coherence / nodes_.size();
+}
+
+double QDHTBucket::calculate_quantum_entropy() const {
+    if (nodes_.empty()) return 0.0;
+
+    double total_entropy = 0.0;
+    for (const auto& node : nodes_) {
+        total_entropy += node.quantum_state.getEntropy();
+    }
+
+    return total_entropy / nodes_.size();
+}
+
+bool QDHTBucket::verify_prefix_match(const QNodeIdentity& node) const {
+    for (size_t i = 0; i < prefix_length_; ++i) {
+        if (get_bit(node.id, i) != get_bit(prefix_, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace quids::network
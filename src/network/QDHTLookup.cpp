@@ -0,0 +1,391 @@
+#include "network/QDHTLookup.hpp"
+#include "network/RoutingIndex.hpp"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace quids::network {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Millis = std::chrono::milliseconds;
+
+struct NodeIdHash {
+    size_t operator()(const QDHTLookup::NodeId& id) const noexcept {
+        size_t h;
+        std::memcpy(&h, id.data(), sizeof(h));
+        return h;
+    }
+};
+
+// Smoothed RTT and variance as in RFC 6298, in microseconds
+struct RttEstimate {
+    double srtt{0.0};
+    double rttvar{0.0};
+    bool sampled{false};
+    // Doublings since the last answer
+    unsigned backoff{0};
+};
+
+} // namespace
+
+class QDHTLookup::Core : public std::enable_shared_from_this<Core> {
+public:
+    Core(boost::asio::io_context& io_context, Transport transport, Config config)
+        : strand_(boost::asio::make_strand(io_context)),
+          transport_(std::move(transport)),
+          config_(std::move(config)) {
+        config_.alpha = std::max<size_t>(config_.alpha, 1);
+        config_.k = std::max<size_t>(config_.k, 1);
+        config_.shortlist_limit = std::max(config_.shortlist_limit, config_.k);
+    }
+
+    void start(const NodeId& target, std::vector<QDHTContact> seeds, Completion done) {
+        boost::asio::post(strand_, [self = shared_from_this(), target, seeds = std::move(seeds),
+                                    done = std::move(done)]() mutable {
+            self->begin(target, std::move(seeds), std::move(done));
+        });
+    }
+
+    void shutdown() {
+        boost::asio::post(strand_, [self = shared_from_this()] {
+            self->stopped_ = true;
+            auto lookups = std::move(self->active_);
+            for (auto& [target, lookup] : lookups) {
+                for (auto& candidate : lookup->shortlist) {
+                    if (candidate.state == Candidate::State::InFlight) {
+                        self->abandon(candidate);
+                    }
+                }
+            }
+        });
+    }
+
+    Millis timeoutFor(const NodeId& peer) const {
+        std::lock_guard<std::mutex> lock(rtt_mutex_);
+        auto it = rtt_.find(peer);
+        if (it == rtt_.end() || !it->second.sampled) {
+            return config_.initial_timeout;
+        }
+        const RttEstimate& rtt = it->second;
+        // RTO = SRTT + 4 * RTTVAR, doubled per consecutive timeout
+        double rto = rtt.srtt + std::max(4.0 * rtt.rttvar, 1000.0);
+        rto *= static_cast<double>(1u << std::min(rtt.backoff, 6u));
+        auto ms = Millis(static_cast<int64_t>(rto / 1000.0));
+        return std::clamp(ms, config_.min_timeout, config_.max_timeout);
+    }
+
+    Stats stats() const {
+        Stats out;
+        out.lookups = lookups_.load(std::memory_order_relaxed);
+        out.coalesced = coalesced_.load(std::memory_order_relaxed);
+        out.requests = requests_.load(std::memory_order_relaxed);
+        out.replies = replies_.load(std::memory_order_relaxed);
+        out.timeouts = timeouts_.load(std::memory_order_relaxed);
+        out.failures = failures_.load(std::memory_order_relaxed);
+        out.cancelled = cancelled_.load(std::memory_order_relaxed);
+        return out;
+    }
+
+private:
+    struct Candidate {
+        enum class State { Fresh, InFlight, Answered, Failed };
+
+        QDHTContact contact;
+        RoutingIndex::Distance distance;
+        State state{State::Fresh};
+        uint64_t request{0};
+        Clock::time_point sent;
+        std::unique_ptr<boost::asio::steady_timer> timer;
+    };
+
+    struct Lookup {
+        NodeId target;
+        RoutingIndex::NodeKey key;
+        // Ordered by distance; equal distance means equal id
+        std::vector<Candidate> shortlist;
+        std::vector<Completion> waiters;
+        size_t in_flight{0};
+    };
+
+    using LookupPtr = std::shared_ptr<Lookup>;
+
+    // Everything below runs on strand_
+
+    void begin(const NodeId& target, std::vector<QDHTContact> seeds, Completion done) {
+        if (stopped_) {
+            return;
+        }
+        lookups_.fetch_add(1, std::memory_order_relaxed);
+
+        auto it = active_.find(target);
+        if (it != active_.end()) {
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+            it->second->waiters.push_back(std::move(done));
+            merge(*it->second, seeds);
+            pump(it->second);
+            return;
+        }
+
+        auto lookup = std::make_shared<Lookup>();
+        lookup->target = target;
+        lookup->key = RoutingIndex::keyFromBytes(target);
+        lookup->waiters.push_back(std::move(done));
+        active_.emplace(target, lookup);
+        merge(*lookup, seeds);
+        pump(lookup);
+    }
+
+    void merge(Lookup& lookup, const std::vector<QDHTContact>& contacts) {
+        for (const auto& contact : contacts) {
+            if (config_.self && contact.id == *config_.self) {
+                continue;
+            }
+            auto distance = RoutingIndex::distance(lookup.key, RoutingIndex::keyFromBytes(contact.id));
+            auto pos = std::lower_bound(lookup.shortlist.begin(), lookup.shortlist.end(), distance,
+                [](const Candidate& c, const RoutingIndex::Distance& d) { return c.distance < d; });
+            if (pos != lookup.shortlist.end() && pos->distance == distance) {
+                continue;
+            }
+            if (pos - lookup.shortlist.begin() >= static_cast<ptrdiff_t>(config_.shortlist_limit)) {
+                continue;
+            }
+            Candidate candidate;
+            candidate.contact = contact;
+            candidate.distance = distance;
+            lookup.shortlist.insert(pos, std::move(candidate));
+        }
+
+        // Requests outside the k closest live contacts can no longer change
+        // the result; while one is out it still counts toward alpha
+        size_t live = 0;
+        for (auto& candidate : lookup.shortlist) {
+            if (candidate.state == Candidate::State::Failed) {
+                continue;
+            }
+            if (live++ < config_.k) {
+                continue;
+            }
+            if (candidate.state == Candidate::State::InFlight) {
+                abandon(candidate);
+                --lookup.in_flight;
+                // Still a fallback if closer contacts fail later
+                candidate.state = Candidate::State::Fresh;
+            }
+        }
+
+        // Past the limit only fallbacks are dropped; a request still out
+        // there is behind enough failures to count among the k closest
+        if (lookup.shortlist.size() > config_.shortlist_limit) {
+            auto tail = lookup.shortlist.begin() + static_cast<ptrdiff_t>(config_.shortlist_limit);
+            lookup.shortlist.erase(std::remove_if(tail, lookup.shortlist.end(), [](const Candidate& c) {
+                return c.state != Candidate::State::InFlight;
+            }), lookup.shortlist.end());
+        }
+    }
+
+    void pump(const LookupPtr& lookup) {
+        size_t live = 0;
+        for (auto& candidate : lookup->shortlist) {
+            if (candidate.state == Candidate::State::Failed) {
+                continue;
+            }
+            if (live++ == config_.k || lookup->in_flight == config_.alpha) {
+                break;
+            }
+            if (candidate.state == Candidate::State::Fresh) {
+                send(lookup, candidate);
+            }
+        }
+        // Nothing out means every one of the k closest has answered
+        if (lookup->in_flight == 0) {
+            finish(lookup);
+        }
+    }
+
+    void send(const LookupPtr& lookup, Candidate& candidate) {
+        const uint64_t request = ++next_request_;
+        candidate.state = Candidate::State::InFlight;
+        candidate.request = request;
+        candidate.sent = Clock::now();
+        ++lookup->in_flight;
+        requests_.fetch_add(1, std::memory_order_relaxed);
+
+        candidate.timer = std::make_unique<boost::asio::steady_timer>(strand_, timeoutFor(candidate.contact.id));
+        candidate.timer->async_wait([self = shared_from_this(), lookup, request](const boost::system::error_code& ec) {
+            if (!ec) {
+                self->timedOut(lookup, request);
+            }
+        });
+
+        Reply reply = [self = shared_from_this(), lookup, request](std::optional<std::vector<QDHTContact>> contacts) {
+            boost::asio::post(self->strand_, [self, lookup, request, contacts = std::move(contacts)]() mutable {
+                self->answered(lookup, request, std::move(contacts));
+            });
+        };
+        transport_.find_node(request, candidate.contact, lookup->target, std::move(reply));
+    }
+
+    Candidate* inFlight(Lookup& lookup, uint64_t request) {
+        for (auto& candidate : lookup.shortlist) {
+            if (candidate.request == request) {
+                return candidate.state == Candidate::State::InFlight ? &candidate : nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    void answered(const LookupPtr& lookup, uint64_t request, std::optional<std::vector<QDHTContact>> contacts) {
+        if (stopped_) {
+            return;
+        }
+        Candidate* candidate = inFlight(*lookup, request);
+        if (!candidate) {
+            // Timed out, cancelled, or the lookup already finished
+            return;
+        }
+        candidate->timer->cancel();
+        candidate->timer.reset();
+        --lookup->in_flight;
+
+        if (!contacts) {
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            candidate->state = Candidate::State::Failed;
+        } else {
+            replies_.fetch_add(1, std::memory_order_relaxed);
+            sample(candidate->contact.id, Clock::now() - candidate->sent);
+            candidate->state = Candidate::State::Answered;
+            merge(*lookup, *contacts);
+        }
+        pump(lookup);
+    }
+
+    void timedOut(const LookupPtr& lookup, uint64_t request) {
+        if (stopped_) {
+            return;
+        }
+        Candidate* candidate = inFlight(*lookup, request);
+        if (!candidate) {
+            return;
+        }
+        timeouts_.fetch_add(1, std::memory_order_relaxed);
+        if (transport_.cancel) {
+            transport_.cancel(request);
+        }
+        candidate->timer.reset();
+        candidate->state = Candidate::State::Failed;
+        --lookup->in_flight;
+        backOff(candidate->contact.id);
+        pump(lookup);
+    }
+
+    // Cancels an in-flight request; the caller updates the state
+    void abandon(Candidate& candidate) {
+        cancelled_.fetch_add(1, std::memory_order_relaxed);
+        if (candidate.timer) {
+            candidate.timer->cancel();
+            candidate.timer.reset();
+        }
+        if (transport_.cancel) {
+            transport_.cancel(candidate.request);
+        }
+        candidate.request = 0;
+    }
+
+    void finish(const LookupPtr& lookup) {
+        auto it = active_.find(lookup->target);
+        if (it == active_.end() || it->second != lookup) {
+            return;
+        }
+        active_.erase(it);
+
+        std::vector<QDHTContact> closest;
+        for (auto& candidate : lookup->shortlist) {
+            if (candidate.state == Candidate::State::Answered) {
+                closest.push_back(std::move(candidate.contact));
+                if (closest.size() == config_.k) {
+                    break;
+                }
+            }
+        }
+        auto waiters = std::move(lookup->waiters);
+        for (size_t i = 0; i + 1 < waiters.size(); ++i) {
+            waiters[i](closest);
+        }
+        waiters.back()(std::move(closest));
+    }
+
+    void sample(const NodeId& peer, Clock::duration elapsed) {
+        const double r = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        std::lock_guard<std::mutex> lock(rtt_mutex_);
+        RttEstimate& rtt = entry(peer);
+        if (!rtt.sampled) {
+            rtt.srtt = r;
+            rtt.rttvar = r / 2.0;
+            rtt.sampled = true;
+        } else {
+            rtt.rttvar = 0.75 * rtt.rttvar + 0.25 * std::abs(rtt.srtt - r);
+            rtt.srtt = 0.875 * rtt.srtt + 0.125 * r;
+        }
+        rtt.backoff = 0;
+    }
+
+    void backOff(const NodeId& peer) {
+        std::lock_guard<std::mutex> lock(rtt_mutex_);
+        RttEstimate& rtt = entry(peer);
+        ++rtt.backoff;
+    }
+
+    // Expects rtt_mutex_ held
+    RttEstimate& entry(const NodeId& peer) {
+        if (rtt_.size() >= config_.rtt_table_limit && !rtt_.count(peer)) {
+            rtt_.erase(rtt_.begin());
+        }
+        return rtt_[peer];
+    }
+
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+    const Transport transport_;
+    Config config_;
+
+    bool stopped_{false};
+    uint64_t next_request_{0};
+    std::unordered_map<NodeId, LookupPtr, NodeIdHash> active_;
+
+    mutable std::mutex rtt_mutex_;
+    std::unordered_map<NodeId, RttEstimate, NodeIdHash> rtt_;
+
+    std::atomic<uint64_t> lookups_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> replies_{0};
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> failures_{0};
+    std::atomic<uint64_t> cancelled_{0};
+};
+
+QDHTLookup::QDHTLookup(boost::asio::io_context& io_context, Transport transport, Config config)
+    : core_(std::make_shared<Core>(io_context, std::move(transport), std::move(config))) {}
+
+QDHTLookup::QDHTLookup(boost::asio::io_context& io_context, Transport transport)
+    : QDHTLookup(io_context, std::move(transport), Config{}) {}
+
+QDHTLookup::~QDHTLookup() {
+    core_->shutdown();
+}
+
+void QDHTLookup::lookup(const NodeId& target, std::vector<QDHTContact> seeds, Completion done) {
+    core_->start(target, std::move(seeds), std::move(done));
+}
+
+std::chrono::milliseconds QDHTLookup::timeoutFor(const NodeId& peer) const {
+    return core_->timeoutFor(peer);
+}
+
+QDHTLookup::Stats QDHTLookup::stats() const {
+    return core_->stats();
+}
+
+} // namespace quids::network
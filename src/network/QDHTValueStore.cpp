@@ -0,0 +1,519 @@
+#include "network/QDHTValueStore.hpp"
+#include "storage/PersistentStorage.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace quids::network {
+
+namespace {
+
+const std::string SPILL_PREFIX = "dht/";
+// Spilled value layout: u64 expiry (unix ms), u64 version, value bytes
+constexpr size_t SPILL_HEADER = 16;
+constexpr size_t MAX_HOLDERS = QDHT_K * 2;
+
+std::string spillKey(const QDHTValueStore::Key& key) {
+    std::string out = SPILL_PREFIX;
+    out.append(reinterpret_cast<const char*>(key.data()), key.size());
+    return out;
+}
+
+void putU64(uint8_t* out, uint64_t value) {
+    for (size_t i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t getU64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t peerOf(const QDHTContact& contact) {
+    uint64_t peer;
+    std::memcpy(&peer, contact.id.data(), sizeof(peer));
+    return peer;
+}
+
+// Disk expiry is wall-clock time so it survives a restart
+uint64_t toUnixMillis(QDHTValueStore::Clock::time_point expires) {
+    auto remaining = expires - QDHTValueStore::Clock::now();
+    auto wall = std::chrono::system_clock::now() + remaining;
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(wall.time_since_epoch()).count());
+}
+
+QDHTValueStore::Clock::time_point fromUnixMillis(uint64_t millis) {
+    auto wall = std::chrono::system_clock::time_point(std::chrono::milliseconds(millis));
+    return QDHTValueStore::Clock::now() + (wall - std::chrono::system_clock::now());
+}
+
+} // namespace
+
+size_t QDHTValueStore::KeyHash::operator()(const Key& key) const noexcept {
+    size_t h;
+    std::memcpy(&h, key.data(), sizeof(h));
+    return h;
+}
+
+uint64_t QDHTValueStore::versionOf(std::span<const uint8_t> value) {
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, value.data(), value.size());
+    uint8_t digest[BLAKE3_OUT_LEN];
+    blake3_hasher_finalize(&hasher, digest, BLAKE3_OUT_LEN);
+    return getU64(digest);
+}
+
+QDHTValueStore::QDHTValueStore(Config config, ClosestPeers closest, SendOffer send_offer,
+                               std::shared_ptr<storage::PersistentStorage> spill)
+    : config_(std::move(config)),
+      tick_interval_(std::max(std::chrono::milliseconds(1),
+                              config_.republish_interval /
+                                  static_cast<int64_t>(std::max<size_t>(config_.wheel_slots, 1)))),
+      closest_(std::move(closest)),
+      send_offer_(std::move(send_offer)),
+      spill_(std::move(spill)),
+      wheel_(std::max<size_t>(config_.wheel_slots, 1)) {
+    if (spill_) {
+        loadSpilled();
+    }
+}
+
+QDHTValueStore::~QDHTValueStore() = default;
+
+bool QDHTValueStore::put(const Key& key, std::span<const uint8_t> value, std::chrono::milliseconds ttl) {
+    if (value.size() > config_.max_value_size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.rejected;
+        return false;
+    }
+    if (ttl.count() <= 0) {
+        ttl = config_.default_ttl;
+    }
+    auto data = std::make_shared<const std::vector<uint8_t>>(value.begin(), value.end());
+    const uint64_t version = versionOf(value);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Batch batch;
+    insert(key, std::move(data), version, Clock::now() + std::min(ttl, config_.max_ttl), batch);
+    enforceLimits(batch);
+    writeSpill(batch);
+    return true;
+}
+
+bool QDHTValueStore::storeReplica(const Record& record, const QDHTContact& from) {
+    if (record.value.size() > config_.max_value_size || record.ttl.count() <= 0 ||
+        versionOf(record.value) != record.version) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.rejected;
+        return false;
+    }
+    auto data = std::make_shared<const std::vector<uint8_t>>(record.value);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Batch batch;
+    insert(record.key, std::move(data), record.version,
+           Clock::now() + std::min(record.ttl, config_.max_ttl), batch);
+    // The sender has this version; don't offer it back
+    auto& holders = entries_.find(record.key)->second.holders;
+    if (holders.size() >= MAX_HOLDERS) {
+        holders.erase(holders.begin());
+    }
+    holders.push_back(Holder{peerOf(from), record.version});
+    enforceLimits(batch);
+    writeSpill(batch);
+    return true;
+}
+
+std::optional<std::vector<uint8_t>> QDHTValueStore::get(const Key& key) {
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            return std::nullopt;
+        }
+        Entry& entry = it->second;
+        if (Clock::now() >= entry.expires) {
+            Batch batch;
+            remove(it, batch);
+            ++stats_.expired;
+            writeSpill(batch);
+            return std::nullopt;
+        }
+        if (entry.value) {
+            touch(entry);
+            return *entry.value;
+        }
+        version = entry.version;
+    }
+
+    // Spilled: read outside the lock, then promote if nothing changed
+    auto record = readSpill(key);
+    if (!record || record->version != version) {
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end() && !it->second.value && it->second.version == version) {
+        Entry& entry = it->second;
+        entry.value = std::make_shared<const std::vector<uint8_t>>(record->value);
+        cold_.erase(entry.lru);
+        hot_.push_front(key);
+        entry.lru = hot_.begin();
+        memory_bytes_ += entry.size;
+        charge_.resize(memory_bytes_);
+        ++stats_.reloaded;
+        Batch batch;
+        enforceLimits(batch);
+        writeSpill(batch);
+    }
+    return std::move(record->value);
+}
+
+bool QDHTValueStore::erase(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        return false;
+    }
+    Batch batch;
+    remove(it, batch);
+    writeSpill(batch);
+    return true;
+}
+
+std::vector<QDHTValueStore::Key> QDHTValueStore::handleOffer(const std::vector<OfferItem>& items) const {
+    std::vector<Key> wanted;
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& item : items) {
+        auto it = entries_.find(item.key);
+        if (it == entries_.end() || it->second.version != item.version || now >= it->second.expires) {
+            wanted.push_back(item.key);
+        }
+    }
+    return wanted;
+}
+
+std::vector<QDHTValueStore::Record> QDHTValueStore::recordsFor(const std::vector<Key>& keys) {
+    std::vector<Record> records;
+    std::vector<std::pair<Key, uint64_t>> spilled;
+    const auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& key : keys) {
+            auto it = entries_.find(key);
+            if (it == entries_.end() || now >= it->second.expires) {
+                continue;
+            }
+            const Entry& entry = it->second;
+            if (!entry.value) {
+                spilled.emplace_back(key, entry.version);
+                continue;
+            }
+            records.push_back(Record{key, *entry.value, entry.version,
+                std::chrono::duration_cast<std::chrono::milliseconds>(entry.expires - now)});
+        }
+    }
+
+    // Served straight from disk; a read alone does not make a value hot
+    for (const auto& [key, version] : spilled) {
+        auto record = readSpill(key);
+        if (record && record->version == version && record->ttl.count() > 0) {
+            records.push_back(std::move(*record));
+        }
+    }
+    return records;
+}
+
+void QDHTValueStore::tick() {
+    struct Due {
+        Key key;
+        uint64_t version;
+        std::vector<Holder> holders;
+    };
+    std::vector<Due> due;
+    Batch batch;
+    const auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++tick_;
+        auto& slot = wheel_[tick_ % wheel_.size()];
+        std::vector<Key> filed = std::move(slot);
+        slot.clear();
+
+        for (const auto& key : filed) {
+            auto it = entries_.find(key);
+            if (it == entries_.end()) {
+                continue;
+            }
+            Entry& entry = it->second;
+            if (entry.due_tick != tick_) {
+                // A later revolution keeps its place; anything else is stale
+                if (entry.due_tick > tick_ && entry.due_tick % wheel_.size() == tick_ % wheel_.size()) {
+                    slot.push_back(key);
+                }
+                continue;
+            }
+            if (now >= entry.expires) {
+                remove(it, batch);
+                ++stats_.expired;
+                continue;
+            }
+            if (now >= entry.republish) {
+                if (config_.full_sync_rounds != 0 && ++entry.rounds % config_.full_sync_rounds == 0) {
+                    entry.holders.clear();
+                }
+                due.push_back(Due{key, entry.version, entry.holders});
+                entry.republish = now + config_.republish_interval;
+            }
+            schedule(key, entry, now);
+        }
+        writeSpill(batch);
+    }
+
+    if (due.empty()) {
+        return;
+    }
+
+    // Peer selection runs unlocked; it usually consults the routing table
+    std::unordered_map<uint64_t, std::pair<QDHTContact, std::vector<OfferItem>>> offers;
+    std::vector<std::pair<Key, Holder>> offered;
+    uint64_t skipped = 0;
+    for (const auto& item : due) {
+        for (const auto& peer : closest_(item.key)) {
+            const uint64_t id = peerOf(peer);
+            bool held = std::any_of(item.holders.begin(), item.holders.end(), [&](const Holder& h) {
+                return h.peer == id && h.version == item.version;
+            });
+            if (held) {
+                ++skipped;
+                continue;
+            }
+            auto& offer = offers[id];
+            offer.first = peer;
+            offer.second.push_back(OfferItem{item.key, item.version});
+            offered.emplace_back(item.key, Holder{id, item.version});
+        }
+    }
+
+    {
+        // Offered peers either hold the version or will fetch it; a lost
+        // fetch is repaired at the next full sync
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [key, holder] : offered) {
+            auto it = entries_.find(key);
+            if (it == entries_.end() || it->second.version != holder.version) {
+                continue;
+            }
+            auto& holders = it->second.holders;
+            if (holders.size() >= MAX_HOLDERS) {
+                holders.erase(holders.begin());
+            }
+            holders.push_back(holder);
+        }
+        stats_.offer_items_skipped += skipped;
+        for (const auto& [id, offer] : offers) {
+            stats_.offer_items += offer.second.size();
+            stats_.offers_sent += (offer.second.size() + config_.max_offer_items - 1) /
+                                  std::max<size_t>(config_.max_offer_items, 1);
+        }
+    }
+
+    for (auto& [id, offer] : offers) {
+        auto& items = offer.second;
+        const size_t chunk = std::max<size_t>(config_.max_offer_items, 1);
+        for (size_t begin = 0; begin < items.size(); begin += chunk) {
+            const size_t end = std::min(items.size(), begin + chunk);
+            std::vector<OfferItem> part(items.begin() + begin, items.begin() + end);
+            send_offer_(offer.first, std::move(part));
+        }
+    }
+}
+
+QDHTValueStore::Stats QDHTValueStore::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats out = stats_;
+    out.keys = entries_.size();
+    out.keys_in_memory = hot_.size();
+    out.memory_bytes = memory_bytes_;
+    return out;
+}
+
+void QDHTValueStore::insert(const Key& key, std::shared_ptr<const std::vector<uint8_t>> value,
+                            uint64_t version, Clock::time_point expires, Batch& batch) {
+    const auto now = Clock::now();
+    auto [it, fresh] = entries_.try_emplace(key);
+    Entry& entry = it->second;
+    if (!fresh) {
+        if (entry.value) {
+            memory_bytes_ -= entry.size;
+            charge_.resize(memory_bytes_);
+            hot_.erase(entry.lru);
+        } else {
+            cold_.erase(entry.lru);
+        }
+        if (entry.version != version) {
+            entry.holders.clear();
+            entry.rounds = 0;
+            // An old version on disk would come back after a restart
+            if (entry.on_disk) {
+                batch.emplace_back(key, std::nullopt);
+                entry.on_disk = false;
+            }
+        }
+    }
+
+    entry.size = value->size();
+    entry.value = std::move(value);
+    entry.version = version;
+    entry.expires = expires;
+    if (fresh) {
+        // New keys go out straight away
+        entry.republish = now;
+    }
+    hot_.push_front(key);
+    entry.lru = hot_.begin();
+    memory_bytes_ += entry.size;
+    charge_.resize(memory_bytes_);
+    schedule(key, entry, now);
+}
+
+void QDHTValueStore::remove(std::unordered_map<Key, Entry, KeyHash>::iterator it, Batch& batch) {
+    Entry& entry = it->second;
+    if (entry.value) {
+        memory_bytes_ -= entry.size;
+        charge_.resize(memory_bytes_);
+        hot_.erase(entry.lru);
+    } else {
+        cold_.erase(entry.lru);
+    }
+    if (entry.on_disk) {
+        batch.emplace_back(it->first, std::nullopt);
+    }
+    entries_.erase(it);
+}
+
+void QDHTValueStore::touch(Entry& entry) {
+    hot_.splice(hot_.begin(), hot_, entry.lru);
+}
+
+void QDHTValueStore::schedule(const Key& key, Entry& entry, Clock::time_point now) {
+    const auto deadline = std::min(entry.expires, entry.republish);
+    uint64_t ticks = 1;
+    if (deadline > now) {
+        ticks = static_cast<uint64_t>((deadline - now + tick_interval_ - Clock::duration(1)) / tick_interval_);
+        ticks = std::max<uint64_t>(ticks, 1);
+    }
+    entry.due_tick = tick_ + ticks;
+    wheel_[entry.due_tick % wheel_.size()].push_back(key);
+}
+
+void QDHTValueStore::enforceLimits(Batch& batch) {
+    // The node-wide DHT budget applies on top of this store's own limit
+    auto& accountant = memory::MemoryAccountant::global();
+    while ((memory_bytes_ > config_.memory_limit || accountant.over_budget(memory::Subsystem::Dht)) &&
+           !hot_.empty()) {
+        auto it = entries_.find(hot_.back());
+        Entry& entry = it->second;
+        if (!spill_) {
+            remove(it, batch);
+            ++stats_.evicted;
+            continue;
+        }
+        if (!entry.on_disk) {
+            std::vector<uint8_t> bytes(SPILL_HEADER + entry.size);
+            putU64(bytes.data(), toUnixMillis(entry.expires));
+            putU64(bytes.data() + 8, entry.version);
+            std::copy(entry.value->begin(), entry.value->end(), bytes.begin() + SPILL_HEADER);
+            batch.emplace_back(it->first, std::move(bytes));
+            entry.on_disk = true;
+        }
+        entry.value.reset();
+        memory_bytes_ -= entry.size;
+        charge_.resize(memory_bytes_);
+        hot_.pop_back();
+        cold_.push_front(it->first);
+        entry.lru = cold_.begin();
+        ++stats_.spilled;
+    }
+
+    while (entries_.size() > config_.max_keys) {
+        const Key& victim = cold_.empty() ? hot_.back() : cold_.back();
+        remove(entries_.find(victim), batch);
+        ++stats_.evicted;
+    }
+}
+
+// Runs under mutex_ so a spilled value is on disk before anyone can miss it
+void QDHTValueStore::writeSpill(Batch& batch) {
+    if (!spill_ || batch.empty()) {
+        return;
+    }
+    std::vector<storage::PersistentStorage::StateWrite> writes;
+    writes.reserve(batch.size());
+    for (auto& [key, value] : batch) {
+        writes.push_back({spillKey(key), std::move(value)});
+    }
+    spill_->storeStateBatch(writes, false);
+    batch.clear();
+}
+
+std::optional<QDHTValueStore::Record> QDHTValueStore::readSpill(const Key& key) {
+    if (!spill_) {
+        return std::nullopt;
+    }
+    auto bytes = spill_->loadState(spillKey(key));
+    if (!bytes || bytes->size() < SPILL_HEADER) {
+        return std::nullopt;
+    }
+    Record record;
+    record.key = key;
+    const auto expires = fromUnixMillis(getU64(bytes->data()));
+    record.ttl = std::chrono::duration_cast<std::chrono::milliseconds>(expires - Clock::now());
+    record.version = getU64(bytes->data() + 8);
+    record.value.assign(bytes->begin() + SPILL_HEADER, bytes->end());
+    return record;
+}
+
+// Rebuilds the index of values spilled before a restart
+void QDHTValueStore::loadSpilled() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Batch batch;
+    const auto now = Clock::now();
+    spill_->scanState(SPILL_PREFIX, [&](const std::string& name, const std::vector<uint8_t>& bytes) {
+        Key key{};
+        if (name.size() != SPILL_PREFIX.size() + key.size()) {
+            return true;
+        }
+        std::memcpy(key.data(), name.data() + SPILL_PREFIX.size(), key.size());
+        const auto expires = bytes.size() >= SPILL_HEADER ? fromUnixMillis(getU64(bytes.data())) : now;
+        if (expires <= now) {
+            batch.emplace_back(key, std::nullopt);
+            return true;
+        }
+        auto [it, fresh] = entries_.try_emplace(key);
+        Entry& entry = it->second;
+        entry.size = bytes.size() - SPILL_HEADER;
+        entry.version = getU64(bytes.data() + 8);
+        entry.expires = expires;
+        entry.republish = now;
+        entry.on_disk = true;
+        cold_.push_back(key);
+        entry.lru = std::prev(cold_.end());
+        schedule(key, entry, now);
+        return true;
+    });
+    enforceLimits(batch);
+    writeSpill(batch);
+}
+
+} // namespace quids::network
@@ -0,0 +1,64 @@
+#include "network/OptimizedNetworkLayer.hpp"
+#include "network/QUICTransport.hpp"
+#include <algorithm>
+
+namespace quids {
+namespace network {
+
+namespace {
+
+// Carries messages over QUICTransport's pooled buffers, copying each
+// payload in or out once at the boundary
+class QUICMessageTransport final : public MessageTransport {
+public:
+    explicit QUICMessageTransport(const NetworkConfig& config) : quic_(config) {}
+
+    void start() override { quic_.start(); }
+    void stop() override { quic_.stop(); }
+    size_t getActiveConnections() const override { return quic_.getActiveConnections(); }
+
+    void sendMessage(Message&& msg) override {
+        BufferHandle payload = quic_.acquireBuffer(msg.target, msg.data.size());
+        if (!payload || payload.capacity() < msg.data.size()) {
+            throw NetworkError("no send buffer for peer");
+        }
+        std::copy(msg.data.begin(), msg.data.end(), payload.data());
+        payload.resize(msg.data.size());
+        try {
+            quic_.sendMessage({std::move(msg.sender), std::move(msg.target), std::move(payload)});
+        } catch (const std::runtime_error& e) {
+            throw NetworkError(e.what());
+        }
+    }
+
+    std::vector<Message> receiveMessages() override {
+        auto received = quic_.receiveMessages();
+        std::vector<Message> messages;
+        messages.reserve(received.size());
+        for (auto& in : received) {
+            const auto bytes = in.payload.bytes();
+            messages.push_back({std::move(in.sender), std::move(in.recipient),
+                                std::vector<uint8_t>(bytes.begin(), bytes.end())});
+        }
+        return messages;
+    }
+
+    void setMaxStreamBitrate(size_t bitrate) override { quic_.setMaxStreamBitrate(bitrate); }
+    void setPeerWeights(const std::vector<std::pair<NodeID, double>>& weights) override {
+        quic_.setPeerWeights(weights);
+    }
+    void setDisconnectionHandler(std::function<void(const NodeID&)> handler) override {
+        quic_.setDisconnectionHandler(std::move(handler));
+    }
+
+private:
+    QUICTransport quic_;
+};
+
+} // namespace
+
+OptimizedNetworkLayer::OptimizedNetworkLayer(const NetworkConfig& config)
+    : OptimizedNetworkLayer(config, std::make_unique<QUICMessageTransport>(config)) {}
+
+} // namespace network
+} // namespace quids
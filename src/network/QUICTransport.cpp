@@ -1,47 +1,58 @@
 #include "network/QUICTransport.hpp"
 #include <chrono>
 #include <algorithm>
+#include <stdexcept>
 #include <quiche.h>
+#include <boost/asio/ip/udp.hpp>
 #include "utils/Timer.hpp"
 #include "crypto/QuantumCrypto.hpp"
+#include "node/WarmStart.hpp"
 
 namespace quids {
 namespace network {
 
-QUICTransport::BufferPool::BufferPool() {
-    buffers.resize(NUM_BUFFERS);
-    freeBuffers.resize(NUM_BUFFERS);
-    
-    // Initialize free buffer indices
-    std::iota(freeBuffers.begin(), freeBuffers.end(), 0);
+namespace {
+
+constexpr auto IDLE_BACKOFF = std::chrono::microseconds(200);
+
+uint64_t nowMillis() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
 }
 
-uint8_t* QUICTransport::BufferPool::acquireBuffer() {
-    if (freeBuffers.empty()) {
-        return nullptr;
-    }
-    
-    size_t index = freeBuffers.back();
-    freeBuffers.pop_back();
-    return buffers[index].data();
+uint64_t nowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
 }
 
-void QUICTransport::BufferPool::releaseBuffer(uint8_t* buffer) {
-    auto it = std::find_if(
-        buffers.begin(),
-        buffers.end(),
-        [buffer](const auto& b) { return b.data() == buffer; }
-    );
-    
-    if (it != buffers.end()) {
-        size_t index = std::distance(buffers.begin(), it);
-        freeBuffers.push_back(index);
+} // namespace
+
+QUICTransport::Shard::Shard(size_t shardIndex)
+    : index(shardIndex), received(SHARD_QUEUE_SIZE) {}
+
+QUICTransport::QUICTransport(const NetworkConfig& config, size_t shards)
+    : config_(config),
+      outbound_(shards == 0 ? std::max<size_t>(1, std::thread::hardware_concurrency()) : shards,
+                SHARD_QUEUE_SIZE, CROSS_SHARD_QUEUE_SIZE),
+      bufferRing_({
+          {MAX_DATAGRAM_SIZE, DATAGRAM_BUFFERS},
+          {MAX_DATAGRAM_SIZE * BURST_DATAGRAMS, BURST_BUFFERS},
+          {MAX_STREAM_READ, STREAM_BUFFERS}
+      }) {
+    shards_.reserve(outbound_.shards());
+    for (size_t i = 0; i < outbound_.shards(); ++i) {
+        shards_.push_back(std::make_unique<Shard>(i));
+    }
+    initializeQuicConfig();
+    if (!config_.sessionCacheDir.empty()) {
+        if (auto data = WarmStartStore(config_.sessionCacheDir).load(SESSION_CACHE)) {
+            sessions_.decode(*data);
+        }
     }
 }
 
-QUICTransport::QUICTransport(const NetworkConfig& config)
-    : config_(config) {
-    initializeQuicConfig();
+QUICTransport::~QUICTransport() {
+    stop();
 }
 
 void QUICTransport::initializeQuicConfig() {
@@ -60,6 +71,7 @@ void QUICTransport::initializeQuicConfig() {
     
     // Enable early data
     quiche_config_enable_early_data(config);
+    quiche_config_set_active_connection_id_limit(config, ACTIVE_CONNECTION_IDS);
     
     // Load TLS certificates
     if (quiche_config_load_cert_chain_from_pem_file(config, config_.certificatePath.c_str()) < 0) {
@@ -74,108 +86,350 @@ void QUICTransport::initializeQuicConfig() {
 }
 
 void QUICTransport::start() {
-    // Initialize QUIC listener
-    // ... QUIC-specific initialization code ...
+    if (running_.exchange(true)) {
+        return;
+    }
+    for (auto& shard : shards_) {
+        shard->loop = std::thread([this, &shard = *shard]() { runShard(shard); });
+    }
 }
 
 void QUICTransport::stop() {
-    // Close all connections
-    for (auto& [peer, conn] : connections_) {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    // Each loop closes its own connections on the way out
+    for (auto& shard : shards_) {
+        if (shard->loop.joinable()) {
+            shard->loop.join();
+        }
+    }
+    if (!config_.sessionCacheDir.empty()) {
+        WarmStartStore(config_.sessionCacheDir).save(SESSION_CACHE, sessions_.encode());
+    }
+}
+
+size_t QUICTransport::shardFor(const NodeID& peer) const {
+    return std::hash<NodeID>{}(peer) % shards_.size();
+}
+
+void QUICTransport::runShard(Shard& shard) {
+    const utils::ShardMailbox<Message>::LoopScope scope(outbound_, shard.index);
+
+    while (running_.load(std::memory_order_relaxed)) {
+        size_t work = drainInbound(shard);
+        work += releaseThrottled(shard);
+        work += pollStreams(shard);
+        processTimeouts(shard);
+        if (work == 0) {
+            std::this_thread::sleep_for(IDLE_BACKOFF);
+        }
+    }
+
+    for (auto& [peer, conn] : shard.connections) {
+        saveSession(peer, conn);
         closeStream(peer);
     }
-    connections_.clear();
+    shard.connections.clear();
+    shard.activeConnections.store(0, std::memory_order_relaxed);
+}
+
+size_t QUICTransport::drainInbound(Shard& shard) {
+    return outbound_.drain(shard.index, [&](Message&& msg) { transmit(shard, std::move(msg)); }, LOOP_BATCH);
+}
+
+std::shared_ptr<BufferQuota> QUICTransport::peerQuota(const NodeID& peer) {
+    Shard& shard = *shards_[shardFor(peer)];
+    std::lock_guard<std::mutex> lock(shard.quotaMutex);
+    auto& quota = shard.quotas[peer];
+    if (!quota) {
+        quota = std::make_shared<BufferQuota>(PEER_BUFFER_LIMIT);
+    }
+    return quota;
+}
+
+BufferHandle QUICTransport::acquireBuffer(const NodeID& peer, size_t bytes) {
+    return bufferRing_.acquire(bytes, peerQuota(peer));
 }
 
 void QUICTransport::sendMessage(Message&& msg) {
-    auto* stream = getOrCreateStream(msg.target);
-    if (!stream) {
-        throw std::runtime_error("Failed to create stream");
+    if (!msg.payload) {
+        throw std::invalid_argument("Message has no payload buffer");
     }
-    
-    // Get buffer from pool
-    uint8_t* buffer = bufferPool_.acquireBuffer();
-    if (!buffer) {
-        throw std::runtime_error("No available buffers");
+
+    Shard& target = *shards_[shardFor(msg.recipient)];
+    outbound_.send(target.index, std::move(msg), [&](Message&& local) { transmit(target, std::move(local)); });
+}
+
+void QUICTransport::setMaxStreamBitrate(size_t bitrate) {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    maxBitrate_ = bitrate;
+    throttled_.store(bitrate > 0, std::memory_order_relaxed);
+    rateVersion_.fetch_add(1, std::memory_order_release);
+}
+
+void QUICTransport::setPeerWeights(const std::vector<std::pair<NodeID, double>>& weights) {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    peerWeights_.clear();
+    totalWeight_ = 0.0;
+    for (const auto& [peer, weight] : weights) {
+        if (weight > 0.0) {
+            peerWeights_[peer] = weight;
+            totalWeight_ += weight;
+        }
     }
-    
-    try {
-        // Serialize message to buffer
-        size_t len = serializeMessage(msg, buffer, BufferPool::BUFFER_SIZE);
-        
-        // Send data through QUIC stream
-        ssize_t written = quiche_stream_send(
-            stream,
-            buffer,
-            len,
-            true // fin
-        );
-        
-        if (written < 0) {
-            throw std::runtime_error("Failed to send data");
+    rateVersion_.fetch_add(1, std::memory_order_release);
+}
+
+double QUICTransport::rateFor(const NodeID& peer) const {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    // A peer missing from the weights counts as weight 1 on top of them;
+    // before any weights are set, each peer may use the whole budget
+    auto it = peerWeights_.find(peer);
+    const double weight = it == peerWeights_.end() ? 1.0 : it->second;
+    const double total = totalWeight_ + (it == peerWeights_.end() ? weight : 0.0);
+    return static_cast<double>(maxBitrate_) / 8.0 / 1e6 * weight / total;
+}
+
+void QUICTransport::refill(Throttle& throttle, const NodeID& peer, uint64_t now) {
+    const uint64_t version = rateVersion_.load(std::memory_order_acquire);
+    if (throttle.version != version) {
+        throttle.version = version;
+        throttle.rate = rateFor(peer);
+    }
+    const double burst = throttle.rate * BURST_MICROS;
+    if (throttle.refilled == 0) {
+        // New peers start with a full bucket
+        throttle.tokens = burst;
+    } else {
+        throttle.tokens = std::min(burst, throttle.tokens + throttle.rate * static_cast<double>(now - throttle.refilled));
+    }
+    throttle.refilled = now;
+}
+
+void QUICTransport::transmit(Shard& shard, Message&& msg) {
+    if (!throttled_.load(std::memory_order_relaxed)) {
+        transmitNow(shard, std::move(msg));
+        return;
+    }
+
+    auto& throttle = shard.throttles[msg.recipient];
+    refill(throttle, msg.recipient, nowMicros());
+    // Messages are never split, so a bucket may go into debt by one
+    // message; it waits that debt off before the next one
+    if (throttle.backlog.empty() && throttle.tokens > 0.0) {
+        throttle.tokens -= static_cast<double>(msg.payload.size());
+        transmitNow(shard, std::move(msg));
+        return;
+    }
+    if (throttle.backlogBytes + msg.payload.size() > PEER_BUFFER_LIMIT) {
+        // Far over budget; dropping returns the buffer to the pool
+        return;
+    }
+    if (throttle.backlog.empty()) {
+        ++shard.throttledPeers;
+    }
+    throttle.backlogBytes += msg.payload.size();
+    throttle.backlog.push_back(std::move(msg));
+}
+
+size_t QUICTransport::releaseThrottled(Shard& shard) {
+    if (shard.throttledPeers == 0) {
+        return 0;
+    }
+    const bool throttled = throttled_.load(std::memory_order_relaxed);
+    const uint64_t now = nowMicros();
+    size_t released = 0;
+    for (auto& [peer, throttle] : shard.throttles) {
+        if (throttle.backlog.empty()) {
+            continue;
+        }
+        refill(throttle, peer, now);
+        while (!throttle.backlog.empty() && (!throttled || throttle.tokens > 0.0)) {
+            Message msg = std::move(throttle.backlog.front());
+            throttle.backlog.pop_front();
+            throttle.backlogBytes -= msg.payload.size();
+            throttle.tokens -= static_cast<double>(msg.payload.size());
+            transmitNow(shard, std::move(msg));
+            ++released;
+        }
+        if (throttle.backlog.empty()) {
+            --shard.throttledPeers;
         }
-        
-        // Update metrics
-        auto& metrics = streamMetrics_[msg.target];
-        metrics.bytesProcessed.fetch_add(written, std::memory_order_relaxed);
-        metrics.packetsProcessed.fetch_add(1, std::memory_order_relaxed);
-        
-    } catch (...) {
-        bufferPool_.releaseBuffer(buffer);
-        throw;
     }
-    
-    bufferPool_.releaseBuffer(buffer);
+    return released;
 }
 
-std::vector<Message> QUICTransport::receiveMessages() {
-    std::vector<Message> messages;
-    
-    // Process incoming packets
-    uint8_t* buffer = bufferPool_.acquireBuffer();
-    if (!buffer) {
-        return messages;
+void QUICTransport::transmitNow(Shard& shard, Message&& msg) {
+    auto* stream = getOrCreateStream(shard, msg.recipient);
+    if (!stream) {
+        // Runs on the loop, where there is no caller to throw to
+        return;
     }
-    
-    try {
-        for (auto& [peer, conn] : connections_) {
-            for (auto& stream : conn.streams) {
-                // Read data from stream
-                ssize_t read = quiche_stream_recv(
-                    stream.get(),
-                    buffer,
-                    BufferPool::BUFFER_SIZE,
-                    false // fin
-                );
-                
-                if (read > 0) {
-                    // Process received data
-                    handleStreamData(stream.get(), buffer, read);
-                    
-                    // Deserialize message
-                    Message msg;
-                    if (deserializeMessage(buffer, read, msg)) {
-                        messages.push_back(std::move(msg));
-                    }
-                    
-                    // Update metrics
-                    auto& metrics = streamMetrics_[peer];
-                    metrics.bytesProcessed.fetch_add(read, std::memory_order_relaxed);
-                    metrics.packetsProcessed.fetch_add(1, std::memory_order_relaxed);
+
+    // The payload was serialized in place; hand the pooled bytes straight to
+    // the stream. The handle returns the buffer when msg goes out of scope.
+    ssize_t written = quiche_stream_send(
+        stream,
+        msg.payload.data(),
+        msg.payload.size(),
+        true // fin
+    );
+
+    if (written < 0) {
+        return;
+    }
+
+    auto& conn = shard.connections[msg.recipient];
+    conn.bytesSent += static_cast<size_t>(written);
+    conn.lastActivity = nowMillis();
+
+    // Update metrics
+    auto& metrics = shard.streamMetrics[msg.recipient];
+    metrics.bytesProcessed.fetch_add(written, std::memory_order_relaxed);
+    metrics.packetsProcessed.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t QUICTransport::pollStreams(Shard& shard) {
+    size_t read_messages = 0;
+
+    for (auto& [peer, conn] : shard.connections) {
+        for (auto& stream : conn.streams) {
+            // Read straight into a buffer charged to the sending peer, so a
+            // peer that floods us runs into its own ceiling first
+            BufferHandle buffer = bufferRing_.acquire(MAX_STREAM_READ, peerQuota(peer));
+            if (!buffer) {
+                continue;
+            }
+
+            ssize_t read = quiche_stream_recv(
+                stream.get(),
+                buffer.data(),
+                buffer.capacity(),
+                false // fin
+            );
+
+            if (read > 0) {
+                buffer.resize(static_cast<size_t>(read));
+                handleStreamData(stream.get(), buffer.data(), buffer.size());
+
+                Message msg;
+                msg.sender = peer;
+                msg.payload = std::move(buffer);
+                if (!shard.received.try_push(std::move(msg))) {
+                    // Nobody is draining receiveMessages(); leave the rest
+                    // in the stream for flow control to push back on
+                    return read_messages;
                 }
+                ++read_messages;
+
+                conn.bytesReceived += static_cast<size_t>(read);
+                conn.lastActivity = nowMillis();
+
+                // Update metrics
+                auto& metrics = shard.streamMetrics[peer];
+                metrics.bytesProcessed.fetch_add(read, std::memory_order_relaxed);
+                metrics.packetsProcessed.fetch_add(1, std::memory_order_relaxed);
             }
         }
-    } catch (...) {
-        bufferPool_.releaseBuffer(buffer);
-        throw;
     }
-    
-    bufferPool_.releaseBuffer(buffer);
+
+    return read_messages;
+}
+
+std::vector<QUICTransport::Message> QUICTransport::receiveMessages() {
+    std::vector<Message> messages;
+    for (auto& shard : shards_) {
+        shard->received.try_pop_bulk(std::back_inserter(messages), SHARD_QUEUE_SIZE);
+    }
     return messages;
 }
 
-quiche::Stream* QUICTransport::getOrCreateStream(const NodeID& peer) {
-    auto it = connections_.find(peer);
-    if (it == connections_.end()) {
+QUICTransport::BufferMetrics QUICTransport::getBufferMetrics() const {
+    BufferMetrics metrics;
+    metrics.pool = bufferRing_.stats();
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->quotaMutex);
+        for (const auto& [peer, quota] : shard->quotas) {
+            metrics.peer_bytes.emplace_back(peer, quota->used());
+        }
+    }
+    return metrics;
+}
+
+void QUICTransport::processTimeouts(Shard& shard) {
+    if (const uint64_t version = pathVersion_.load(std::memory_order_acquire); shard.pathVersion != version) {
+        shard.pathVersion = version;
+        migratePaths(shard);
+    }
+    shard.timers.advance();
+}
+
+void QUICTransport::migrateLocalAddress(const std::string& address, uint16_t port) {
+    {
+        std::lock_guard<std::mutex> lock(pathMutex_);
+        localAddress_ = address;
+        localPort_ = port;
+    }
+    pathVersion_.fetch_add(1, std::memory_order_release);
+}
+
+void QUICTransport::migratePaths(Shard& shard) {
+    boost::asio::ip::udp::endpoint local;
+    {
+        std::lock_guard<std::mutex> lock(pathMutex_);
+        boost::system::error_code error;
+        const auto ip = boost::asio::ip::make_address(localAddress_, error);
+        if (error) {
+            return;
+        }
+        local = {ip, localPort_};
+    }
+    for (auto& [peer, conn] : shard.connections) {
+        uint64_t sequence = 0;
+        // Fails only without a spare connection ID from the peer; that
+        // connection idles out and comes back with 0-RTT
+        quiche_conn_migrate_source(conn.quic.get(), local.data(), static_cast<socklen_t>(local.size()), &sequence);
+    }
+}
+
+void QUICTransport::saveSession(const NodeID& peer, Connection& conn) {
+    const uint8_t* session = nullptr;
+    size_t length = 0;
+    quiche_conn_session(conn.quic.get(), &session, &length);
+    if (session && length > 0) {
+        sessions_.store(peer, {session, length});
+    } else if (conn.offeredSession && !quiche_conn_is_resumed(conn.quic.get())) {
+        sessions_.erase(peer);
+    }
+}
+
+void QUICTransport::armIdleTimer(Shard& shard, const NodeID& peer, uint64_t delay) {
+    auto it = shard.connections.find(peer);
+    if (it == shard.connections.end()) {
+        return;
+    }
+    it->second.idleTimer = shard.timers.schedule(std::chrono::milliseconds(delay),
+                                                 [this, &shard, peer]() { checkIdle(shard, peer); });
+}
+
+void QUICTransport::checkIdle(Shard& shard, const NodeID& peer) {
+    auto it = shard.connections.find(peer);
+    if (it == shard.connections.end()) {
+        return;
+    }
+    // Activity only stamps lastActivity; the timer catches up with it here
+    const uint64_t idle = nowMillis() - it->second.lastActivity;
+    if (idle > TIMEOUT_INTERVAL) {
+        closeConnection(shard, peer);
+    } else {
+        armIdleTimer(shard, peer, TIMEOUT_INTERVAL - idle + 1);
+    }
+}
+
+quiche::Stream* QUICTransport::getOrCreateStream(Shard& shard, const NodeID& peer) {
+    auto it = shard.connections.find(peer);
+    if (it == shard.connections.end()) {
         // Create new connection
         Connection conn;
         conn.quic = std::unique_ptr<quiche::Connection>(
@@ -191,6 +445,16 @@ quiche::Stream* QUICTransport::getOrCreateStream(const NodeID& peer) {
         if (!conn.quic) {
             return nullptr;
         }
+
+        // Resume the last session with this peer, so what we send before
+        // the handshake completes goes out as 0-RTT data
+        if (auto session = sessions_.find(peer)) {
+            if (quiche_conn_set_session(conn.quic.get(), session->data(), session->size()) == 0) {
+                conn.offeredSession = true;
+            } else {
+                sessions_.erase(peer);
+            }
+        }
         
         // Create stream
         auto stream = std::unique_ptr<quiche::Stream>(
@@ -203,7 +467,15 @@ quiche::Stream* QUICTransport::getOrCreateStream(const NodeID& peer) {
         
         auto* streamPtr = stream.get();
         conn.streams.push_back(std::move(stream));
-        connections_[peer] = std::move(conn);
+        conn.lastActivity = nowMillis();
+        conn.bytesReceived = 0;
+        conn.bytesSent = 0;
+        shard.connections[peer] = std::move(conn);
+        shard.activeConnections.fetch_add(1, std::memory_order_relaxed);
+        armIdleTimer(shard, peer, TIMEOUT_INTERVAL + 1);
+        if (onConnection_) {
+            onConnection_(peer);
+        }
         return streamPtr;
     }
     
@@ -216,26 +488,36 @@ void QUICTransport::handleStreamData(quiche::Stream* stream, const uint8_t* data
 }
 
 size_t QUICTransport::getActiveConnections() const {
-    return connections_.size();
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->activeConnections.load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
-void QUICTransport::cleanupInactiveConnections() {
-    auto now = std::chrono::steady_clock::now();
-    
-    for (auto it = connections_.begin(); it != connections_.end();) {
-        auto timeSinceLastActivity = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - std::chrono::milliseconds(it->second.lastActivity)
-        ).count();
-        
-        if (timeSinceLastActivity > TIMEOUT_INTERVAL) {
-            if (onDisconnection_) {
-                onDisconnection_(it->first);
-            }
-            it = connections_.erase(it);
-        } else {
-            ++it;
-        }
+void QUICTransport::closeConnection(Shard& shard, const NodeID& peer) {
+    auto it = shard.connections.find(peer);
+    if (it == shard.connections.end()) {
+        return;
+    }
+    if (onDisconnection_) {
+        onDisconnection_(peer);
+    }
+    {
+        // Buffers still in flight keep their quota alive until released
+        std::lock_guard<std::mutex> lock(shard.quotaMutex);
+        shard.quotas.erase(peer);
+    }
+    shard.streamMetrics.erase(peer);
+    shard.handlers.handlers.erase(peer);
+    if (auto throttle = shard.throttles.find(peer); throttle != shard.throttles.end()) {
+        shard.throttledPeers -= throttle->second.backlog.empty() ? 0 : 1;
+        shard.throttles.erase(throttle);
     }
+    shard.timers.cancel(it->second.idleTimer);
+    saveSession(peer, it->second);
+    shard.connections.erase(it);
+    shard.activeConnections.fetch_sub(1, std::memory_order_relaxed);
 }
 
 void QUICTransport::setConnectionHandler(ConnectionCallback handler) {
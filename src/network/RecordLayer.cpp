@@ -0,0 +1,335 @@
+#include "network/RecordLayer.hpp"
+#include "utils/CpuFeatures.hpp"
+#include <blake3.h>
+#include <openssl/evp.h>
+#include <stdexcept>
+#include <string_view>
+
+namespace quids {
+namespace network {
+
+namespace {
+
+constexpr std::string_view INITIATOR_LABEL = "quids record initiator v1";
+constexpr std::string_view RESPONDER_LABEL = "quids record responder v1";
+constexpr std::string_view KEY_LABEL = "quids record key v1";
+constexpr std::string_view IV_LABEL = "quids record iv v1";
+constexpr std::string_view REKEY_LABEL = "quids record rekey v1";
+
+constexpr size_t NONCE_SIZE = 12;
+constexpr size_t HEADER_SIZE = RecordLayer::TRAILER_SIZE - RecordLayer::TAG_SIZE;
+constexpr uint64_t REPLAY_WINDOW = 64;
+
+using Secret = std::array<uint8_t, BLAKE3_KEY_LEN>;
+using Nonce = std::array<uint8_t, NONCE_SIZE>;
+using CipherCtxPtr = std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>;
+
+// BLAKE3(label || data), truncated or extended to out.size()
+void labelled_hash(std::string_view label, std::span<const uint8_t> data, std::span<uint8_t> out) {
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, label.data(), label.size());
+    blake3_hasher_update(&hasher, data.data(), data.size());
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+}
+
+template<size_t N>
+void secure_zero(std::array<uint8_t, N>& bytes) {
+    volatile uint8_t* p = bytes.data();
+    for (size_t i = 0; i < N; ++i) {
+        p[i] = 0;
+    }
+}
+
+const EVP_CIPHER* evp_cipher(RecordLayer::Cipher cipher) {
+    return cipher == RecordLayer::Cipher::Aes256Gcm ? EVP_aes_256_gcm() : EVP_chacha20_poly1305();
+}
+
+// One epoch of one direction: its secret, and the cipher contexts and
+// replay window that go with it
+class EpochKeys {
+public:
+    EpochKeys(uint32_t epoch, const Secret& secret) : epoch_(epoch), secret_(secret) {
+        labelled_hash(IV_LABEL, secret_, iv_);
+    }
+
+    ~EpochKeys() {
+        // Contexts scrub their own key schedules when freed
+        secure_zero(secret_);
+        secure_zero(iv_);
+    }
+
+    EpochKeys(const EpochKeys&) = delete;
+    EpochKeys& operator=(const EpochKeys&) = delete;
+
+    [[nodiscard]] uint32_t epoch() const { return epoch_; }
+
+    [[nodiscard]] std::unique_ptr<EpochKeys> next() const {
+        Secret secret;
+        labelled_hash(REKEY_LABEL, secret_, secret);
+        auto keys = std::make_unique<EpochKeys>(epoch_ + 1, secret);
+        secure_zero(secret);
+        return keys;
+    }
+
+    // Keyed on first use; later records only reset the nonce
+    EVP_CIPHER_CTX* context(RecordLayer::Cipher cipher, bool encrypting) {
+        auto& ctx = contexts_[cipher == RecordLayer::Cipher::Aes256Gcm ? 0 : 1];
+        if (!ctx) {
+            std::array<uint8_t, 1 + BLAKE3_KEY_LEN> input{};
+            input[0] = static_cast<uint8_t>(cipher);
+            std::copy(secret_.begin(), secret_.end(), input.begin() + 1);
+            Secret key;
+            labelled_hash(KEY_LABEL, input, key);
+            secure_zero(input);
+
+            CipherCtxPtr fresh(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+            const bool ok = fresh && EVP_CipherInit_ex(fresh.get(), evp_cipher(cipher), nullptr, key.data(), nullptr,
+                                                       encrypting ? 1 : 0);
+            secure_zero(key);
+            if (!ok) {
+                throw std::runtime_error("RecordLayer: cipher initialization failed");
+            }
+            ctx = std::move(fresh);
+        }
+        return ctx.get();
+    }
+
+    [[nodiscard]] Nonce nonce(uint64_t sequence) const {
+        Nonce nonce = iv_;
+        for (size_t i = 0; i < 8; ++i) {
+            nonce[NONCE_SIZE - 1 - i] ^= static_cast<uint8_t>(sequence >> (8 * i));
+        }
+        return nonce;
+    }
+
+    [[nodiscard]] bool fresh(uint64_t sequence) const {
+        if (!seen_any_ || sequence > highest_) {
+            return true;
+        }
+        const uint64_t age = highest_ - sequence;
+        return age < REPLAY_WINDOW && !((window_ >> age) & 1);
+    }
+
+    void mark(uint64_t sequence) {
+        if (!seen_any_) {
+            seen_any_ = true;
+            highest_ = sequence;
+            window_ = 1;
+        } else if (sequence > highest_) {
+            const uint64_t shift = sequence - highest_;
+            window_ = shift >= REPLAY_WINDOW ? 1 : (window_ << shift) | 1;
+            highest_ = sequence;
+        } else {
+            window_ |= uint64_t{1} << (highest_ - sequence);
+        }
+    }
+
+private:
+    const uint32_t epoch_;
+    Secret secret_;
+    Nonce iv_{};
+    std::array<CipherCtxPtr, 2> contexts_{CipherCtxPtr(nullptr, &EVP_CIPHER_CTX_free),
+                                          CipherCtxPtr(nullptr, &EVP_CIPHER_CTX_free)};
+    uint64_t highest_{0};
+    uint64_t window_{0};
+    bool seen_any_{false};
+};
+
+void put(uint8_t* out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t get(const uint8_t* in, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+class RecordLayer::Peer {
+public:
+    std::mutex mutex;
+    std::unique_ptr<EpochKeys> send;
+    uint64_t nextSequence{0};
+    Clock::time_point epochStarted;
+    std::unique_ptr<EpochKeys> receive;
+    // Records sealed just before the sender's rekey may still be in flight
+    std::unique_ptr<EpochKeys> previousReceive;
+};
+
+RecordLayer::RecordLayer() : RecordLayer(Config{}) {}
+
+RecordLayer::RecordLayer(Config config) : config_(config) {
+    if (config_.receive_epoch_window == 0) {
+        throw std::invalid_argument("RecordLayer: receive_epoch_window must be at least 1");
+    }
+}
+
+RecordLayer::~RecordLayer() = default;
+
+RecordLayer::Cipher RecordLayer::preferredCipher() {
+    static const Cipher cipher = utils::useFeature("record_layer", utils::CpuFeature::Aes)
+        ? Cipher::Aes256Gcm
+        : Cipher::ChaCha20Poly1305;
+    return cipher;
+}
+
+void RecordLayer::install(const PeerID& peer, std::span<const uint8_t> secret, bool initiator) {
+    Secret outbound;
+    Secret inbound;
+    labelled_hash(initiator ? INITIATOR_LABEL : RESPONDER_LABEL, secret, outbound);
+    labelled_hash(initiator ? RESPONDER_LABEL : INITIATOR_LABEL, secret, inbound);
+
+    auto state = std::make_shared<Peer>();
+    state->send = std::make_unique<EpochKeys>(0, outbound);
+    state->receive = std::make_unique<EpochKeys>(0, inbound);
+    state->epochStarted = Clock::now();
+    secure_zero(outbound);
+    secure_zero(inbound);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    peers_[peer] = std::move(state);
+}
+
+void RecordLayer::remove(const PeerID& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    peers_.erase(peer);
+}
+
+bool RecordLayer::has(const PeerID& peer) const {
+    return find(peer) != nullptr;
+}
+
+std::shared_ptr<RecordLayer::Peer> RecordLayer::find(const PeerID& peer) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = peers_.find(peer);
+    return it == peers_.end() ? nullptr : it->second;
+}
+
+bool RecordLayer::seal(const PeerID& peer, std::span<std::vector<uint8_t>> records) {
+    auto state = find(peer);
+    if (!state) {
+        return false;
+    }
+    const Cipher cipher = config_.cipher.value_or(preferredCipher());
+    const auto now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    for (auto& record : records) {
+        if (state->nextSequence >= config_.rekey_records || now - state->epochStarted >= config_.rekey_interval) {
+            state->send = state->send->next();
+            state->nextSequence = 0;
+            state->epochStarted = now;
+            rekeys_.fetch_add(1, std::memory_order_relaxed);
+        }
+        const uint64_t sequence = state->nextSequence++;
+        EpochKeys& keys = *state->send;
+
+        uint8_t header[HEADER_SIZE];
+        header[0] = static_cast<uint8_t>(cipher);
+        put(header + 1, keys.epoch(), 4);
+        put(header + 5, sequence, 8);
+
+        const size_t length = record.size();
+        record.resize(length + TRAILER_SIZE);
+        uint8_t* data = record.data();
+        const Nonce nonce = keys.nonce(sequence);
+        EVP_CIPHER_CTX* ctx = keys.context(cipher, true);
+        int written = 0;
+        if (!EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, nonce.data(), 1) ||
+            !EVP_CipherUpdate(ctx, nullptr, &written, header, static_cast<int>(HEADER_SIZE)) ||
+            (length > 0 && !EVP_CipherUpdate(ctx, data, &written, data, static_cast<int>(length))) ||
+            !EVP_CipherFinal_ex(ctx, data + length, &written) ||
+            !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, static_cast<int>(TAG_SIZE), data + length + HEADER_SIZE)) {
+            throw std::runtime_error("RecordLayer: seal failed");
+        }
+        std::copy(header, header + HEADER_SIZE, data + length);
+    }
+    sealed_.fetch_add(records.size(), std::memory_order_relaxed);
+    return true;
+}
+
+size_t RecordLayer::open(const PeerID& peer, std::span<std::vector<uint8_t>> records) {
+    auto state = find(peer);
+    if (!state) {
+        for (auto& record : records) {
+            record.clear();
+        }
+        rejected_.fetch_add(records.size(), std::memory_order_relaxed);
+        return 0;
+    }
+
+    size_t opened = 0;
+    std::lock_guard<std::mutex> lock(state->mutex);
+    for (auto& record : records) {
+        bool ok = false;
+        if (record.size() >= TRAILER_SIZE) {
+            const size_t length = record.size() - TRAILER_SIZE;
+            uint8_t* data = record.data();
+            const uint8_t* header = data + length;
+            const auto cipher = static_cast<Cipher>(header[0]);
+            const auto epoch = static_cast<uint32_t>(get(header + 1, 4));
+            const uint64_t sequence = get(header + 5, 8);
+
+            // A later epoch is only adopted once a record of it verifies;
+            // epochs in between may have lost every record
+            std::unique_ptr<EpochKeys> candidate;
+            EpochKeys* keys = nullptr;
+            const uint32_t current = state->receive->epoch();
+            if (epoch == current) {
+                keys = state->receive.get();
+            } else if (state->previousReceive && epoch == state->previousReceive->epoch()) {
+                keys = state->previousReceive.get();
+            } else if (epoch > current && epoch - current <= config_.receive_epoch_window) {
+                candidate = state->receive->next();
+                while (candidate->epoch() < epoch) {
+                    candidate = candidate->next();
+                }
+                keys = candidate.get();
+            }
+
+            if (keys && (cipher == Cipher::Aes256Gcm || cipher == Cipher::ChaCha20Poly1305) && keys->fresh(sequence)) {
+                const Nonce nonce = keys->nonce(sequence);
+                EVP_CIPHER_CTX* ctx = keys->context(cipher, false);
+                int written = 0;
+                // The tag is set before any data; OpenSSL checks it in Final
+                ok = EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, nonce.data(), 0) &&
+                     EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, static_cast<int>(TAG_SIZE),
+                                         const_cast<uint8_t*>(header + HEADER_SIZE)) &&
+                     EVP_CipherUpdate(ctx, nullptr, &written, header, static_cast<int>(HEADER_SIZE)) &&
+                     (length == 0 || EVP_CipherUpdate(ctx, data, &written, data, static_cast<int>(length))) &&
+                     EVP_CipherFinal_ex(ctx, data + length, &written);
+            }
+            if (ok) {
+                keys->mark(sequence);
+                if (candidate) {
+                    state->previousReceive = std::move(state->receive);
+                    state->receive = std::move(candidate);
+                    rekeys_.fetch_add(1, std::memory_order_relaxed);
+                }
+                record.resize(length);
+                ++opened;
+            }
+        }
+        if (!ok) {
+            record.clear();
+        }
+    }
+    opened_.fetch_add(opened, std::memory_order_relaxed);
+    rejected_.fetch_add(records.size() - opened, std::memory_order_relaxed);
+    return opened;
+}
+
+RecordLayer::Stats RecordLayer::stats() const {
+    return {sealed_.load(std::memory_order_relaxed), opened_.load(std::memory_order_relaxed),
+            rejected_.load(std::memory_order_relaxed), rekeys_.load(std::memory_order_relaxed)};
+}
+
+} // namespace network
+} // namespace quids
@@ -0,0 +1,180 @@
+#include "network/RoutingIndex.hpp"
+#include "utils/CpuFeatures.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define ROUTING_INDEX_X86 1
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define ROUTING_INDEX_NEON 1
+#endif
+
+namespace quids::network {
+
+namespace {
+
+// Selection works on the top word alone, which settles almost every
+// comparison; equal top words fall back to the full distance
+struct Candidate {
+    uint64_t top;
+    uint32_t position;
+};
+
+constexpr size_t WORDS = RoutingIndex::KEY_BYTES / 8;
+static_assert(WORDS == 4, "the vector kernels compare 256-bit keys");
+
+// First word where x ^ t and y ^ t differ, WORDS when the distances are equal
+using FirstDifference = size_t (*)(const uint64_t* x, const uint64_t* y, const uint64_t* t);
+
+size_t firstDifferenceScalar(const uint64_t* x, const uint64_t* y, const uint64_t* t) {
+    for (size_t w = 0; w < WORDS; ++w) {
+        if ((x[w] ^ t[w]) != (y[w] ^ t[w])) {
+            return w;
+        }
+    }
+    return WORDS;
+}
+
+#if ROUTING_INDEX_X86
+// Mismatch mask of the two distances, one byte lane per bit
+__attribute__((target("avx2"))) size_t firstDifferenceAvx2(const uint64_t* x, const uint64_t* y, const uint64_t* t) {
+    const __m256i tv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(t));
+    const __m256i dx = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x)), tv);
+    const __m256i dy = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y)), tv);
+    const auto differs = static_cast<uint32_t>(~_mm256_movemask_epi8(_mm256_cmpeq_epi64(dx, dy)));
+    return differs == 0 ? WORDS : static_cast<size_t>(std::countr_zero(differs)) / 8;
+}
+#endif
+
+#if ROUTING_INDEX_NEON
+// x ^ t equals y ^ t exactly where x equals y, so t drops out
+size_t firstDifferenceNeon(const uint64_t* x, const uint64_t* y, const uint64_t*) {
+    const uint64x2_t lo = vceqq_u64(vld1q_u64(x), vld1q_u64(y));
+    const uint64x2_t hi = vceqq_u64(vld1q_u64(x + 2), vld1q_u64(y + 2));
+    const uint64_t equal[4] = {vgetq_lane_u64(lo, 0), vgetq_lane_u64(lo, 1),
+                               vgetq_lane_u64(hi, 0), vgetq_lane_u64(hi, 1)};
+    for (size_t w = 0; w < WORDS; ++w) {
+        if (equal[w] == 0) {
+            return w;
+        }
+    }
+    return WORDS;
+}
+#endif
+
+FirstDifference firstDifference() {
+    static const FirstDifference kernel = utils::selectKernel<FirstDifference>("network.routing_distance", {
+#if ROUTING_INDEX_X86
+        {utils::CpuFeature::Avx2, firstDifferenceAvx2},
+#endif
+#if ROUTING_INDEX_NEON
+        {utils::CpuFeature::Neon, firstDifferenceNeon},
+#endif
+        {utils::CpuFeature::Scalar, firstDifferenceScalar},
+    });
+    return kernel;
+}
+
+} // namespace
+
+RoutingIndex::NodeKey RoutingIndex::keyFromBytes(std::span<const uint8_t> bytes) noexcept {
+    NodeKey key{};
+    std::memcpy(key.data(), bytes.data(), std::min(bytes.size(), key.size()));
+    return key;
+}
+
+RoutingIndex::NodeKey RoutingIndex::keyFromString(std::string_view id) noexcept {
+    return keyFromBytes({reinterpret_cast<const uint8_t*>(id.data()), id.size()});
+}
+
+RoutingIndex::Words RoutingIndex::toWords(const NodeKey& key) noexcept {
+    Words words;
+    for (size_t w = 0; w < words.size(); ++w) {
+        uint64_t value = 0;
+        for (size_t b = 0; b < 8; ++b) {
+            value = (value << 8) | key[w * 8 + b];
+        }
+        words[w] = value;
+    }
+    return words;
+}
+
+RoutingIndex::Distance RoutingIndex::distance(const NodeKey& a, const NodeKey& b) noexcept {
+    const Words x = toWords(a);
+    const Words y = toWords(b);
+    Distance d;
+    for (size_t w = 0; w < d.size(); ++w) {
+        d[w] = x[w] ^ y[w];
+    }
+    return d;
+}
+
+size_t RoutingIndex::commonPrefixBits(const NodeKey& a, const NodeKey& b) noexcept {
+    const Distance d = distance(a, b);
+    for (size_t w = 0; w < d.size(); ++w) {
+        if (d[w] != 0) {
+            return w * 64 + static_cast<size_t>(std::countl_zero(d[w]));
+        }
+    }
+    return KEY_BITS;
+}
+
+size_t RoutingIndex::add(const NodeKey& key) {
+    keys_.push_back(toWords(key));
+    return keys_.size() - 1;
+}
+
+size_t RoutingIndex::remove(size_t position) noexcept {
+    const size_t last = keys_.size() - 1;
+    if (position != last) {
+        keys_[position] = keys_[last];
+    }
+    keys_.pop_back();
+    return last;
+}
+
+size_t RoutingIndex::find(const NodeKey& key) const noexcept {
+    const Words words = toWords(key);
+    return static_cast<size_t>(std::find(keys_.begin(), keys_.end(), words) - keys_.begin());
+}
+
+std::vector<uint32_t> RoutingIndex::closest(const NodeKey& target, size_t count) const {
+    const Words t = toWords(target);
+    std::vector<Candidate> candidates(keys_.size());
+    for (size_t i = 0; i < keys_.size(); ++i) {
+        candidates[i] = Candidate{keys_[i][0] ^ t[0], static_cast<uint32_t>(i)};
+    }
+
+    const FirstDifference differs = firstDifference();
+    auto nearer = [this, &t, differs](const Candidate& a, const Candidate& b) {
+        if (a.top != b.top) {
+            return a.top < b.top;
+        }
+        const Words& x = keys_[a.position];
+        const Words& y = keys_[b.position];
+        const size_t w = differs(x.data(), y.data(), t.data());
+        if (w < WORDS) {
+            return (x[w] ^ t[w]) < (y[w] ^ t[w]);
+        }
+        return a.position < b.position;
+    };
+
+    count = std::min(count, candidates.size());
+    if (count < candidates.size()) {
+        // O(n) selection of the nearest count, then order only those
+        std::nth_element(candidates.begin(), candidates.begin() + count, candidates.end(), nearer);
+    }
+    std::sort(candidates.begin(), candidates.begin() + count, nearer);
+
+    std::vector<uint32_t> positions(count);
+    for (size_t i = 0; i < count; ++i) {
+        positions[i] = candidates[i].position;
+    }
+    return positions;
+}
+
+} // namespace quids::network
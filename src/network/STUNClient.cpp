@@ -52,30 +52,19 @@ namespace quids::network {
             // Send request
             socket.send_to(boost::asio::buffer(&request, sizeof(request)), *endpoints.begin());
 
-            // Set timeout
-            boost::asio::steady_timer timer(socket.get_executor());
-            timer.expires_after(std::chrono::seconds(2));
-
-            // Start the timer
-            timer.async_wait([&socket](const boost::system::error_code& ec) {
-                if (!ec) {
-                    // Handle timeout (e.g., log an error, close the socket, etc.)
-                    SPDLOG_ERROR("Receive timeout occurred.");
-                    socket.close(); // Close the socket or handle as needed
-                }
-            });
-
-            // Receive response
+            // Receive response, giving up after two seconds
             std::array<uint8_t, 1024> recv_buffer;
             boost::asio::ip::udp::endpoint sender_endpoint;
-            
-            size_t len = socket.receive_from(
-                boost::asio::buffer(recv_buffer),
-                sender_endpoint
-            );
-
-            // Cancel the timer if the receive is successful
-            timer.cancel();
+            size_t len = 0;
+            socket.async_receive_from(
+                boost::asio::buffer(recv_buffer), sender_endpoint,
+                [&len](const boost::system::error_code& ec, size_t n) {
+                    if (!ec) len = n;
+                });
+            io_context.run_for(std::chrono::seconds(2));
+            if (len == 0) {
+                SPDLOG_ERROR("STUN receive timeout occurred.");
+            }
 
             if(len > 0) {
                 // Parse STUN response
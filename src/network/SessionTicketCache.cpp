@@ -0,0 +1,156 @@
+#include "network/SessionTicketCache.hpp"
+#include <algorithm>
+
+namespace quids {
+namespace network {
+
+namespace {
+
+// quiche sessions run to a few hundred bytes; anything near this is junk
+constexpr size_t MAX_SESSION_SIZE = 16 * 1024;
+constexpr size_t MAX_PEER_SIZE = 1024;
+
+void put(std::vector<uint8_t>& out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> data) : rest_(data) {}
+
+    uint64_t get(size_t width) {
+        auto bytes = take(width);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    std::span<const uint8_t> take(size_t n) {
+        if (!ok_ || n > rest_.size()) {
+            ok_ = false;
+            return {};
+        }
+        auto bytes = rest_.first(n);
+        rest_ = rest_.subspan(n);
+        return bytes;
+    }
+
+    bool ok() const { return ok_; }
+    bool done() const { return ok_ && rest_.empty(); }
+
+private:
+    std::span<const uint8_t> rest_;
+    bool ok_{true};
+};
+
+int64_t to_seconds(SessionTicketCache::Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
+}
+
+} // namespace
+
+SessionTicketCache::SessionTicketCache(size_t capacity, std::chrono::seconds lifetime)
+    : capacity_(std::max<size_t>(1, capacity)), lifetime_(lifetime) {}
+
+void SessionTicketCache::store(const PeerID& peer, std::span<const uint8_t> session, Clock::time_point now) {
+    if (session.empty() || session.size() > MAX_SESSION_SIZE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert(peer, {std::vector<uint8_t>(session.begin(), session.end()), now + lifetime_});
+}
+
+std::optional<std::vector<uint8_t>> SessionTicketCache::find(const PeerID& peer, Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sessions_.find(peer);
+    if (it == sessions_.end() || it->second.expires <= now) {
+        return std::nullopt;
+    }
+    return it->second.session;
+}
+
+void SessionTicketCache::erase(const PeerID& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.erase(peer);
+}
+
+size_t SessionTicketCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sessions_.size();
+}
+
+void SessionTicketCache::insert(const PeerID& peer, Entry entry) {
+    sessions_[peer] = std::move(entry);
+    while (sessions_.size() > capacity_) {
+        auto oldest = std::min_element(sessions_.begin(), sessions_.end(), [](const auto& a, const auto& b) {
+            return a.second.expires < b.second.expires;
+        });
+        sessions_.erase(oldest);
+    }
+}
+
+std::vector<uint8_t> SessionTicketCache::encode(Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint8_t> out;
+    std::vector<const std::pair<const PeerID, Entry>*> live;
+    for (const auto& entry : sessions_) {
+        if (entry.second.expires > now) {
+            live.push_back(&entry);
+        }
+    }
+    put(out, live.size(), 4);
+    for (const auto* entry : live) {
+        const auto& [peer, session] = *entry;
+        put(out, peer.size(), 2);
+        out.insert(out.end(), peer.begin(), peer.end());
+        put(out, static_cast<uint64_t>(to_seconds(session.expires)), 8);
+        put(out, session.session.size(), 4);
+        out.insert(out.end(), session.session.begin(), session.session.end());
+    }
+    return out;
+}
+
+std::optional<size_t> SessionTicketCache::decode(std::span<const uint8_t> data, Clock::time_point now) {
+    Reader in(data);
+    const uint64_t count = in.get(4);
+    std::vector<std::pair<PeerID, Entry>> parsed;
+    for (uint64_t i = 0; i < count && in.ok(); ++i) {
+        const size_t peer_size = static_cast<size_t>(in.get(2));
+        if (peer_size > MAX_PEER_SIZE) {
+            return std::nullopt;
+        }
+        auto peer = in.take(peer_size);
+        const auto expires = Clock::time_point(std::chrono::seconds(static_cast<int64_t>(in.get(8))));
+        const size_t session_size = static_cast<size_t>(in.get(4));
+        if (session_size == 0 || session_size > MAX_SESSION_SIZE) {
+            return std::nullopt;
+        }
+        auto session = in.take(session_size);
+        // A clock set back since the save must not stretch a lifetime
+        if (in.ok() && expires > now && expires <= now + lifetime_) {
+            parsed.push_back({PeerID(peer.begin(), peer.end()),
+                              {std::vector<uint8_t>(session.begin(), session.end()), expires}});
+        }
+    }
+    if (!in.done()) {
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t kept = 0;
+    for (auto& [peer, entry] : parsed) {
+        // Whatever this run has already learned is newer
+        if (!sessions_.count(peer)) {
+            insert(peer, std::move(entry));
+            ++kept;
+        }
+    }
+    return kept;
+}
+
+} // namespace network
+} // namespace quids
@@ -0,0 +1,133 @@
+#include "network/WireFormat.hpp"
+#include "utils/CpuFeatures.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define QUIDS_CRC32C_HW 1
+#endif
+
+namespace quids::network::wire {
+
+namespace {
+
+constexpr uint32_t CASTAGNOLI = 0x82F63B78u;
+
+// Slicing-by-8 tables: TABLES[k][b] is the CRC of byte b followed by k zeros
+constexpr std::array<std::array<uint32_t, 256>, 8> makeTables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (CASTAGNOLI & (0u - (crc & 1u)));
+        }
+        tables[0][i] = crc;
+    }
+    for (size_t k = 1; k < 8; ++k) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFFu];
+        }
+    }
+    return tables;
+}
+
+constexpr auto TABLES = makeTables();
+
+uint32_t crcSoftware(const uint8_t* p, size_t n, uint32_t crc) noexcept {
+    for (; n >= 8; p += 8, n -= 8) {
+        const uint32_t lo = crc ^ (static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                                   static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24);
+        crc = TABLES[7][lo & 0xFFu] ^ TABLES[6][(lo >> 8) & 0xFFu] ^
+              TABLES[5][(lo >> 16) & 0xFFu] ^ TABLES[4][lo >> 24] ^
+              TABLES[3][p[4]] ^ TABLES[2][p[5]] ^ TABLES[1][p[6]] ^ TABLES[0][p[7]];
+    }
+    for (; n > 0; ++p, --n) {
+        crc = (crc >> 8) ^ TABLES[0][(crc ^ *p) & 0xFFu];
+    }
+    return crc;
+}
+
+#if defined(QUIDS_CRC32C_HW)
+__attribute__((target("sse4.2")))
+uint32_t crcHardware(const uint8_t* p, size_t n, uint32_t crc) noexcept {
+    uint64_t wide = crc;
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = static_cast<uint32_t>(wide);
+    for (; n > 0; ++p, --n) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+
+// The crc32 instruction is checked once, not compiled in, so generic
+// builds get it too
+const bool HAS_SSE42 = utils::useFeature("network.crc32c", utils::CpuFeature::Sse42);
+#endif
+
+uint32_t loadU32(const uint8_t* in) noexcept {
+    return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+           static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+} // namespace
+
+uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc) noexcept {
+#if defined(QUIDS_CRC32C_HW)
+    if (HAS_SSE42) {
+        return ~crcHardware(data.data(), data.size(), ~crc);
+    }
+#endif
+    return ~crcSoftware(data.data(), data.size(), ~crc);
+}
+
+Status decodeFrame(std::span<const uint8_t> bytes, Frame& frame) noexcept {
+    if (bytes.size() < HEADER_SIZE) {
+        return Status::Incomplete;
+    }
+    const uint8_t* in = bytes.data();
+    Header header;
+    header.version = in[0];
+    header.type = in[1];
+    header.flags = static_cast<uint16_t>(in[2] | in[3] << 8);
+    header.length = loadU32(in + 4);
+    header.checksum = loadU32(in + 8);
+
+    if (header.version < MIN_VERSION || header.version > VERSION) {
+        return Status::BadVersion;
+    }
+    if (header.length > MAX_PAYLOAD) {
+        return Status::TooLarge;
+    }
+    if (bytes.size() - HEADER_SIZE < header.length) {
+        return Status::Incomplete;
+    }
+    auto payload = bytes.subspan(HEADER_SIZE, header.length);
+    if (crc32c(payload) != header.checksum) {
+        return Status::BadChecksum;
+    }
+    frame.header = header;
+    frame.payload = payload;
+    return Status::Ok;
+}
+
+void writeHeader(uint8_t* out, uint8_t type, uint16_t flags, std::span<const uint8_t> payload) noexcept {
+    out[0] = VERSION;
+    out[1] = type;
+    Field<uint16_t>::write(out + 2, flags);
+    Field<uint32_t>::write(out + 4, static_cast<uint32_t>(payload.size()));
+    Field<uint32_t>::write(out + 8, crc32c(payload));
+}
+
+void appendFrame(std::vector<uint8_t>& out, uint8_t type, uint16_t flags, std::span<const uint8_t> payload) {
+    const size_t start = out.size();
+    out.resize(start + HEADER_SIZE + payload.size());
+    if (!payload.empty()) {
+        std::memcpy(out.data() + start + HEADER_SIZE, payload.data(), payload.size());
+    }
+    writeHeader(out.data() + start, type, flags, payload);
+}
+
+} // namespace quids::network::wire
@@ -1,9 +1,42 @@
 #include "neural/BaseQuantumNetwork.hpp"
-
-// Since BaseQuantumNetwork is a pure virtual interface,
-// we dont need any implementation here.
-// The destructor is already defined as default in the header.
+#include <stdexcept>
 
 namespace quids::neural {
-    // Empty implementation file - all methods are pure virtual
+
+void BaseQuantumNetwork::setVariationalCircuit(std::shared_ptr<const VariationalCircuit> circuit,
+                                               std::vector<size_t> readouts,
+                                               std::shared_ptr<ParameterShiftCache> cache) {
+    if (circuit) {
+        for (size_t qubit : readouts) {
+            if (qubit >= circuit->numQubits) {
+                throw std::out_of_range("Readout qubit out of range");
+            }
+        }
+    }
+    circuit_ = std::move(circuit);
+    readouts_ = std::move(readouts);
+    shiftCache_ = cache ? std::move(cache) : std::make_shared<ParameterShiftCache>();
+}
+
+std::vector<double> BaseQuantumNetwork::circuitGradients(std::span<const double> weights) const {
+    if (!circuit_) {
+        return {};
+    }
+    if (!weights.empty() && weights.size() != readouts_.size()) {
+        throw std::invalid_argument("Need one weight per readout");
+    }
+    const auto angles = getQuantumParameters();
+    const auto result = shiftCache_->evaluate(*circuit_, angles);
+
+    std::vector<double> gradients(angles.size(), 0.0);
+    for (size_t r = 0; r < readouts_.size(); ++r) {
+        const double weight = weights.empty() ? 1.0 : weights[r];
+        const auto row = result->jacobian.row(static_cast<Eigen::Index>(readouts_[r]));
+        for (Eigen::Index p = 0; p < row.size(); ++p) {
+            gradients[static_cast<size_t>(p)] += weight * row(p);
+        }
+    }
+    return gradients;
 }
+
+} // namespace quids::neural
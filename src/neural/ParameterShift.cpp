@@ -0,0 +1,141 @@
+#include "neural/ParameterShift.hpp"
+#include "quantum/StateBatch.hpp"
+#include <algorithm>
+#include <numbers>
+#include <stdexcept>
+
+namespace quids::neural {
+
+size_t VariationalCircuit::numParameters() const {
+    size_t count = 0;
+    for (const auto& op : ops) {
+        if (op.gate == Gate::RY || op.gate == Gate::RZ) {
+            count = std::max(count, op.parameter + 1);
+        }
+    }
+    return count;
+}
+
+uint64_t VariationalCircuit::fingerprint() const {
+    // FNV-1a over the gate list
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&h](uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            h ^= (value >> (8 * i)) & 0xff;
+            h *= 0x100000001b3ull;
+        }
+    };
+    mix(numQubits);
+    for (const auto& op : ops) {
+        mix(static_cast<uint64_t>(op.gate));
+        mix(op.qubit);
+        mix(op.target);
+        mix(op.parameter);
+    }
+    return h;
+}
+
+ShiftResult parameterShift(const VariationalCircuit& circuit, std::span<const double> angles) {
+    const size_t parameters = circuit.numParameters();
+    if (angles.size() < parameters) {
+        throw std::invalid_argument("Not enough angles for the circuit");
+    }
+    size_t rotations = 0;
+    for (const auto& op : circuit.ops) {
+        rotations += op.gate == VariationalCircuit::Gate::RY || op.gate == VariationalCircuit::Gate::RZ;
+    }
+
+    // State 0 is unshifted; rotation j is shifted by +pi/2 in state
+    // 2j + 1 and by -pi/2 in state 2j + 2
+    const size_t batch_size = 1 + 2 * rotations;
+    quantum::StateBatch batch(circuit.numQubits, batch_size);
+    std::vector<double> per_state(batch_size);
+    std::vector<size_t> rotation_parameter;
+    rotation_parameter.reserve(rotations);
+
+    for (const auto& op : circuit.ops) {
+        switch (op.gate) {
+            case VariationalCircuit::Gate::Hadamard:
+                batch.applyHadamard(op.qubit);
+                break;
+            case VariationalCircuit::Gate::CNOT:
+                batch.applyCNOT(op.qubit, op.target);
+                break;
+            case VariationalCircuit::Gate::RY:
+            case VariationalCircuit::Gate::RZ: {
+                const size_t j = rotation_parameter.size();
+                std::fill(per_state.begin(), per_state.end(), angles[op.parameter]);
+                per_state[2 * j + 1] += std::numbers::pi / 2;
+                per_state[2 * j + 2] -= std::numbers::pi / 2;
+                // Phase(theta) is RZ(theta) up to a global phase, which no
+                // expectation sees
+                if (op.gate == VariationalCircuit::Gate::RY) {
+                    batch.applyRotationY(op.qubit, per_state);
+                } else {
+                    batch.applyPhase(op.qubit, per_state);
+                }
+                rotation_parameter.push_back(op.parameter);
+                break;
+            }
+        }
+    }
+
+    const Eigen::MatrixXd z = batch.expectationZ();
+    ShiftResult result;
+    result.expectations = z.row(0).transpose();
+    result.jacobian = Eigen::MatrixXd::Zero(static_cast<Eigen::Index>(circuit.numQubits),
+                                            static_cast<Eigen::Index>(parameters));
+    for (size_t j = 0; j < rotations; ++j) {
+        const auto plus = static_cast<Eigen::Index>(2 * j + 1);
+        result.jacobian.col(static_cast<Eigen::Index>(rotation_parameter[j])) +=
+            0.5 * (z.row(plus) - z.row(plus + 1)).transpose();
+    }
+    return result;
+}
+
+ParameterShiftCache::ParameterShiftCache(size_t capacity)
+    : capacity_(std::max<size_t>(1, capacity)) {}
+
+std::shared_ptr<const ShiftResult> ParameterShiftCache::evaluate(const VariationalCircuit& circuit,
+                                                                 std::span<const double> angles) {
+    const uint64_t fingerprint = circuit.fingerprint();
+    const size_t used = std::min(angles.size(), circuit.numParameters());
+    const auto key = angles.first(used);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->fingerprint == fingerprint && std::ranges::equal(it->angles, key)) {
+                entries_.splice(entries_.begin(), entries_, it);
+                ++hits_;
+                return entries_.front().result;
+            }
+        }
+        ++misses_;
+    }
+
+    // Simulated unlocked; of two racing misses the first to finish is kept
+    auto result = std::make_shared<const ShiftResult>(parameterShift(circuit, angles));
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : entries_) {
+        if (entry.fingerprint == fingerprint && std::ranges::equal(entry.angles, key)) {
+            return entry.result;
+        }
+    }
+    entries_.push_front({fingerprint, {key.begin(), key.end()}, result});
+    if (entries_.size() > capacity_) {
+        entries_.pop_back();
+    }
+    return result;
+}
+
+size_t ParameterShiftCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+size_t ParameterShiftCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+} // namespace quids::neural
@@ -1,4 +1,5 @@
 #include "neural/QuantumPolicyNetwork.hpp"
+#include "storage/TensorCheckpoint.hpp"
 #include <Eigen/Dense>
 #include <cmath>
 #include <random>
@@ -51,6 +52,24 @@ std::vector<double> QuantumPolicyNetwork::getQuantumParameters() const {
     return impl_->parameters;
 }
 
+std::vector<double> QuantumPolicyNetwork::calculateQuantumGradients() const {
+    if (auto gradients = circuitGradients(); !gradients.empty()) {
+        return gradients;
+    }
+    return impl_->gradients;
+}
+
+void QuantumPolicyNetwork::forward() {
+    // Re-evaluates the policy on the last state it saw
+    if (!impl_->currentState.empty()) {
+        forward(impl_->currentState);
+    }
+}
+
+void QuantumPolicyNetwork::backward() {
+    // Gradients come from backward(gradOutput) or updateBatch()
+}
+
 void QuantumPolicyNetwork::forward(const std::vector<double>& state) {
     if (state.empty()) {
         throw std::runtime_error("State vector is empty");
@@ -112,6 +131,52 @@ std::vector<double> QuantumPolicyNetwork::getActionProbabilities() const {
     return probs;
 }
 
+namespace {
+using RowMajorMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+}
+
+Eigen::MatrixXd QuantumPolicyNetwork::forwardBatch(const Eigen::MatrixXd& states) const {
+    if (static_cast<size_t>(states.cols()) != impl_->stateSize) {
+        throw std::runtime_error("Invalid state batch size");
+    }
+    const Eigen::Map<const RowMajorMatrix> weights(impl_->parameters.data(), impl_->stateSize, impl_->actionSize);
+    Eigen::MatrixXd logits = states * weights;
+    // Row-wise softmax, shifted by each row's max for stability
+    logits = (logits.colwise() - logits.rowwise().maxCoeff()).array().exp();
+    logits.array().colwise() /= logits.rowwise().sum().array();
+    return logits;
+}
+
+void QuantumPolicyNetwork::updateBatch(const Eigen::MatrixXd& states, const Eigen::MatrixXd& logitGradients,
+                                       double learningRate) {
+    if (static_cast<size_t>(states.cols()) != impl_->stateSize ||
+        static_cast<size_t>(logitGradients.cols()) != impl_->actionSize ||
+        states.rows() != logitGradients.rows() || states.rows() == 0) {
+        throw std::runtime_error("Invalid batch dimensions");
+    }
+    Eigen::Map<RowMajorMatrix> weights(impl_->parameters.data(), impl_->stateSize, impl_->actionSize);
+    Eigen::Map<RowMajorMatrix> gradients(impl_->gradients.data(), impl_->stateSize, impl_->actionSize);
+    gradients.noalias() = states.transpose() * logitGradients / static_cast<double>(states.rows());
+    weights += learningRate * gradients;
+}
+
+void QuantumPolicyNetwork::saveNetworkState(const std::string& filePath) const {
+    storage::TensorCheckpoint::Writer writer;
+    writer.add<double>("parameters", {impl_->stateSize, impl_->actionSize}, impl_->parameters);
+    writer.write(filePath);
+}
+
+void QuantumPolicyNetwork::loadNetworkState(const std::string& filePath) {
+    auto checkpoint = storage::TensorCheckpoint::open(filePath);
+    const auto* parameters = checkpoint ? checkpoint->find("parameters") : nullptr;
+    if (!parameters || parameters->dtype != storage::TensorCheckpoint::DType::Float64 ||
+        parameters->shape != std::vector<uint64_t>{impl_->stateSize, impl_->actionSize}) {
+        throw std::runtime_error("Invalid policy network checkpoint: " + filePath);
+    }
+    const auto values = parameters->as<double>();
+    impl_->parameters.assign(values.begin(), values.end());
+}
+
 void QuantumPolicyNetwork::resetNetworkState() {
     impl_->parameters = std::vector<double>(impl_->stateSize * impl_->actionSize);
     impl_->gradients = std::vector<double>(impl_->stateSize * impl_->actionSize);
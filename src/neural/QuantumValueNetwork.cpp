@@ -1,5 +1,6 @@
 #include "neural/QuantumValueNetwork.hpp"
 #include "quantum/QuantumCircuit.hpp"
+#include "storage/TensorCheckpoint.hpp"
 #include <Eigen/Dense>
 #include <random>
 #include <stdexcept>
@@ -39,40 +40,44 @@ QuantumValueNetwork::QuantumValueNetwork()
     : BaseQuantumNetwork(),
       impl_(::std::make_unique<Impl>(16, 8)) {}
 
+QuantumValueNetwork::QuantumValueNetwork(::std::size_t stateSize, ::std::size_t numQubits)
+    : BaseQuantumNetwork(),
+      impl_(::std::make_unique<Impl>(stateSize, numQubits)) {}
+
 QuantumValueNetwork::~QuantumValueNetwork() = default;
 
-double QuantumValueNetwork::getParameter(::std::size_t index) const override {
+double QuantumValueNetwork::getParameter(::std::size_t index) const {
     if (index >= impl_->parameters_.size()) {
         throw ::std::out_of_range("Parameter index out of range");
     }
     return impl_->parameters_[index];
 }
 
-void QuantumValueNetwork::setParameter(::std::size_t index, double value) override {
+void QuantumValueNetwork::setParameter(::std::size_t index, double value) {
     if (index >= impl_->parameters_.size()) {
         throw ::std::out_of_range("Parameter index out of range");
     }
     impl_->parameters_[index] = value;
 }
 
-::std::size_t QuantumValueNetwork::getNumParameters() const override {
+::std::size_t QuantumValueNetwork::getNumParameters() const {
     return impl_->parameters_.size();
 }
 
-::std::vector<double> QuantumValueNetwork::getGradients() const override {
+::std::vector<double> QuantumValueNetwork::getGradients() const {
     return impl_->gradients_;
 }
 
-::std::vector<double> QuantumValueNetwork::getQuantumParameters() const override {
+::std::vector<double> QuantumValueNetwork::getQuantumParameters() const {
     return impl_->parameters_;
 }
 
-void QuantumValueNetwork::forward() override {
+void QuantumValueNetwork::forward() {
     // Base forward pass without state input
     // This is used for internal network operations
 }
 
-void QuantumValueNetwork::backward() override {
+void QuantumValueNetwork::backward() {
     // Compute gradients for all parameters
     // This is called during training
 }
@@ -104,16 +109,27 @@ void QuantumValueNetwork::updateValue(const quantum::QuantumState& state, double
     }
 }
 
-void QuantumValueNetwork::loadNetworkState(const ::std::string& filePath) override {
-    // TODO: Implement network state loading
+void QuantumValueNetwork::loadNetworkState(const ::std::string& filePath) {
+    auto checkpoint = storage::TensorCheckpoint::open(filePath);
+    const auto* parameters = checkpoint ? checkpoint->find("parameters") : nullptr;
+    if (!parameters || parameters->dtype != storage::TensorCheckpoint::DType::Float64 ||
+        parameters->shape != ::std::vector<uint64_t>{impl_->stateSize_}) {
+        throw ::std::runtime_error("Invalid value network checkpoint: " + filePath);
+    }
+    const auto values = parameters->as<double>();
+    impl_->parameters_.assign(values.begin(), values.end());
 }
 
-void QuantumValueNetwork::saveNetworkState(const ::std::string& filePath) const override {
-    // TODO: Implement network state saving
+void QuantumValueNetwork::saveNetworkState(const ::std::string& filePath) const {
+    storage::TensorCheckpoint::Writer writer;
+    writer.add<double>("parameters", {impl_->stateSize_}, impl_->parameters_);
+    writer.write(filePath);
 }
 
-::std::vector<double> QuantumValueNetwork::calculateQuantumGradients() const override {
-    // TODO: Implement quantum gradient calculation
+::std::vector<double> QuantumValueNetwork::calculateQuantumGradients() const {
+    if (auto gradients = circuitGradients(); !gradients.empty()) {
+        return gradients;
+    }
     return impl_->gradients_;
 }
 
@@ -121,4 +137,30 @@ double QuantumValueNetwork::getValueLoss() const {
     return impl_->valueLoss_;
 }
 
+Eigen::VectorXd QuantumValueNetwork::getValues(const Eigen::MatrixXd& states) const {
+    if (static_cast<::std::size_t>(states.cols()) != impl_->stateSize_) {
+        throw ::std::invalid_argument("Invalid state batch size");
+    }
+    return states * Eigen::Map<const Eigen::VectorXd>(impl_->parameters_.data(), impl_->parameters_.size());
+}
+
+Eigen::VectorXd QuantumValueNetwork::updateValues(const Eigen::MatrixXd& states, const Eigen::VectorXd& targets,
+                                                  const Eigen::VectorXd& weights, double learningRate) {
+    if (states.rows() != targets.size() || states.rows() == 0 ||
+        (weights.size() != 0 && weights.size() != targets.size())) {
+        throw ::std::invalid_argument("Invalid batch dimensions");
+    }
+    Eigen::VectorXd errors = targets - getValues(states);
+    impl_->valueLoss_ = 0.5 * errors.squaredNorm() / static_cast<double>(errors.size());
+    if (weights.size() != 0) {
+        errors.array() *= weights.array();
+    }
+
+    Eigen::Map<Eigen::VectorXd> parameters(impl_->parameters_.data(), impl_->parameters_.size());
+    Eigen::Map<Eigen::VectorXd> gradients(impl_->gradients_.data(), impl_->gradients_.size());
+    gradients.noalias() = -states.transpose() * errors / static_cast<double>(errors.size());
+    parameters -= learningRate * gradients;
+    return errors;
+}
+
 } // namespace quids::neural 
\ No newline at end of file
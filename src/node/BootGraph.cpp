@@ -0,0 +1,105 @@
+#include "node/BootGraph.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace quids {
+
+void BootGraph::add(std::string name, const std::vector<std::string>& after, Stage stage) {
+    auto find = [this](const std::string& n) {
+        return std::find_if(nodes_.begin(), nodes_.end(), [&](const Node& node) { return node.name == n; });
+    };
+    if (find(name) != nodes_.end()) {
+        throw std::invalid_argument("BootGraph: duplicate stage " + name);
+    }
+    std::vector<size_t> parents;
+    for (const auto& dependency : after) {
+        auto it = find(dependency);
+        if (it == nodes_.end()) {
+            throw std::invalid_argument("BootGraph: " + name + " depends on unknown stage " + dependency);
+        }
+        parents.push_back(static_cast<size_t>(it - nodes_.begin()));
+    }
+
+    const size_t index = nodes_.size();
+    nodes_.push_back({std::move(name), {}, parents.size(), std::move(stage)});
+    for (size_t parent : parents) {
+        nodes_[parent].dependents.push_back(index);
+    }
+}
+
+BootGraph::Report BootGraph::run() {
+    using Clock = std::chrono::steady_clock;
+    const auto started = Clock::now();
+
+    Report report;
+    report.stages.resize(nodes_.size());
+    std::vector<size_t> waiting(nodes_.size());
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        report.stages[i].name = nodes_[i].name;
+        waiting[i] = nodes_[i].dependencies;
+        if (waiting[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::vector<std::thread> threads;
+    size_t running = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        if (report.ok) {
+            for (size_t i : ready) {
+                ++running;
+                report.stages[i].ran = true;
+                threads.emplace_back([&, i] {
+                    const auto begin = Clock::now();
+                    bool ok = false;
+                    try {
+                        ok = nodes_[i].stage();
+                    } catch (const std::exception& e) {
+                        spdlog::error("Boot stage {} threw: {}", nodes_[i].name, e.what());
+                    }
+                    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - begin);
+
+                    std::lock_guard<std::mutex> guard(mutex);
+                    report.stages[i].elapsed = elapsed;
+                    report.stages[i].ok = ok;
+                    if (!ok && report.ok) {
+                        report.ok = false;
+                        report.failed = nodes_[i].name;
+                    }
+                    if (ok) {
+                        for (size_t next : nodes_[i].dependents) {
+                            if (--waiting[next] == 0) {
+                                ready.push_back(next);
+                            }
+                        }
+                    }
+                    --running;
+                    finished.notify_one();
+                });
+            }
+        }
+        ready.clear();
+        if (running == 0) {
+            break;
+        }
+        finished.wait(lock, [&] { return running == 0 || (!ready.empty() && report.ok); });
+    }
+    lock.unlock();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    report.total = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started);
+    return report;
+}
+
+} // namespace quids
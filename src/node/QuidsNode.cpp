@@ -1,6 +1,12 @@
 #include "node/QuidsNode.hpp"
+#include "node/BootGraph.hpp"
+#include "node/WarmStart.hpp"
 #include "blockchain/Chain.hpp"
+#include "evm/CodeAnalysis.hpp"
 #include "evm/EVMExecutor.hpp"
+#include "memory/MemoryBudget.hpp"
+#include "utils/HealthSampler.hpp"
+#include <filesystem>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
@@ -17,8 +23,75 @@ struct QuidsNode::Impl {
     // Chain components
     std::unique_ptr<blockchain::Chain> chain;
     std::unique_ptr<evm::EVMExecutor> evm;
+
+    // Peers from the last run, dialed before the configured bootstrap ones
+    std::vector<std::pair<std::string, uint16_t>> warm_peers;
+};
+
+namespace {
+
+constexpr const char* CODE_CACHE = "code-cache";
+constexpr const char* PEERS = "peers";
+
+void put(std::vector<uint8_t>& out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// Bounds-checked reads over a warm cache payload
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> data) : rest_(data) {}
+
+    uint64_t get(size_t width) {
+        auto bytes = take(width);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    std::span<const uint8_t> take(size_t n) {
+        if (!ok_ || n > rest_.size()) {
+            ok_ = false;
+            return {};
+        }
+        auto bytes = rest_.first(n);
+        rest_ = rest_.subspan(n);
+        return bytes;
+    }
+
+    bool ok() const { return ok_; }
+
+private:
+    std::span<const uint8_t> rest_;
+    bool ok_{true};
 };
 
+void apply_memory_budgets(const MemoryBudgets& budgets) {
+    using memory::Subsystem;
+    const std::pair<Subsystem, size_t> all[] = {
+        {Subsystem::Mempool, budgets.mempool_mb},
+        {Subsystem::StateCache, budgets.state_cache_mb},
+        {Subsystem::QuantumState, budgets.quantum_state_mb},
+        {Subsystem::NetworkBuffers, budgets.network_buffers_mb},
+        {Subsystem::Dht, budgets.dht_mb},
+        {Subsystem::MlModels, budgets.ml_models_mb},
+        {Subsystem::BlockCache, budgets.block_cache_mb},
+    };
+    for (const auto& [subsystem, mb] : all) {
+        memory::MemoryAccountant::global().set_budget(subsystem, mb << 20);
+    }
+}
+
+std::string warm_dir(const QuidsConfig& config) {
+    return (std::filesystem::path(config.data_dir) / "warm").string();
+}
+
+} // namespace
+
 QuidsNode::QuidsNode(const QuidsConfig& config) 
     : config_(config), 
       impl_(std::make_unique<Impl>()) {
@@ -32,6 +105,8 @@ QuidsNode::QuidsNode(const QuidsConfig& config)
     } catch (const spdlog::spdlog_ex& ex) {
         throw std::runtime_error(std::string("Logger initialization failed: ") + ex.what());
     }
+    // Before any component is built, so the block cache is sized to fit
+    apply_memory_budgets(config_.memory);
 }
 
 QuidsNode::~QuidsNode() {
@@ -47,32 +122,37 @@ bool QuidsNode::start() {
             return false;
         }
 
-        if (!loadConfiguration()) {
-            return false;
-        }
-
-        if (!initializeCore()) {
-            return false;
-        }
-
-        if (!initializeQuantumSystem()) {
-            return false;
-        }
+        // Independent subsystems come up concurrently, e.g. the AI models
+        // load while peers are dialed
+        BootGraph boot;
+        boot.add("config", {}, [this] { return loadConfiguration(); });
+        boot.add("warm", {"config"}, [this] { return restoreWarmCaches(); });
+        boot.add("core", {"config"}, [this] { return initializeCore(); });
+        boot.add("quantum", {"core"}, [this] { return initializeQuantumSystem(); });
+        boot.add("ai", {"core"}, [this] { return initializeAISystem(); });
+        boot.add("network", {"warm"}, [this] { return initializeNetwork(); });
+        boot.add("evm", {"core", "warm"}, [this] { return initializeEVM(); });
+        boot.add("chain", {"evm"}, [this] { return initializeChain(); });
+        boot.add("complete", {"quantum", "ai", "network", "chain"}, [this] { return completeBoot(); });
 
-        if (!initializeAISystem()) {
-            return false;
+        const auto report = boot.run();
+        for (const auto& stage : report.stages) {
+            if (stage.ran) {
+                logger_->debug("Boot stage {} {} after {} ms", stage.name, stage.ok ? "done" : "failed",
+                               stage.elapsed.count());
+            }
         }
-
-        if (!initializeNetwork()) {
+        if (!report.ok) {
+            logger_->error("Boot failed in stage {}", report.failed);
             return false;
         }
 
-        if (!completeBoot()) {
-            return false;
-        }
+        utils::HealthSampler::Config sampler;
+        sampler.disk_path = config_.data_dir.empty() ? "." : config_.data_dir;
+        utils::HealthSampler::global().start(sampler);
 
         running_ = true;
-        logger_->info("Node started successfully");
+        logger_->info("Node started successfully in {} ms", report.total.count());
         return true;
 
     } catch (const std::exception& e) {
@@ -87,6 +167,8 @@ bool QuidsNode::stop() {
         return false;
     }
 
+    saveWarmCaches();
+    utils::HealthSampler::global().stop();
     running_ = false;
     logger_->info("Node stopped successfully");
     return true;
@@ -106,7 +188,16 @@ std::string QuidsNode::getSyncStatus() const {
 
 SystemHealth QuidsNode::getHealth() const {
     SystemHealth health;
-    // TODO: Implement health checks
+    const auto sample = utils::HealthSampler::global().snapshot();
+    health.cpu_usage = sample.last_1s.cpu_usage;
+    health.memory_usage = sample.latest.memory_mb;
+    health.disk_usage = sample.latest.disk_usage;
+    health.network_latency = sample.last_1s.network_latency_us;
+    for (const auto& usage : memory::MemoryAccountant::global().usage()) {
+        health.memory_by_subsystem.push_back(SubsystemMemory{memory::subsystemName(usage.subsystem),
+                                                             usage.live_bytes, usage.peak_bytes,
+                                                             usage.budget_bytes, usage.rejections});
+    }
     return health;
 }
 
@@ -144,7 +235,7 @@ bool QuidsNode::initializeNetwork() {
         
         // Register message handlers
         p2p_node_->register_message_handler(
-            [this](const std::string& peer_addr, uint16_t peer_port, const std::vector<uint8_t>& msg) {
+            [this](const std::string& peer_addr, uint16_t peer_port, std::span<const uint8_t> msg) {
                 // TODO: Handle incoming messages
                 logger_->debug("Received message from {}:{}", peer_addr, peer_port);
             }
@@ -156,6 +247,11 @@ bool QuidsNode::initializeNetwork() {
             return false;
         }
         
+        // Peers that were up a moment ago are the quickest to come back
+        for (const auto& [addr, port] : impl_->warm_peers) {
+            p2p_node_->add_bootstrap_peer(addr, port);
+        }
+
         // Connect to bootstrap peers
         for (const auto& peer : config_.network.bootstrap_peers) {
             // Parse peer address and port
@@ -193,10 +289,7 @@ bool QuidsNode::initializeEVM() {
 bool QuidsNode::initializeChain() {
     try {
         logger_->info("Initializing blockchain...");
-        impl_->chain = std::make_unique<blockchain::Chain>(
-            config_.chain,
-            impl_->evm.get()
-        );
+        impl_->chain = std::make_unique<blockchain::Chain>();
         return true;
     } catch (const std::exception& e) {
         logger_->error("Failed to initialize chain: {}", e.what());
@@ -209,4 +302,71 @@ bool QuidsNode::completeBoot() {
     return true; // TODO: Implement
 }
 
+bool QuidsNode::restoreWarmCaches() {
+    if (!config_.warm_start || config_.data_dir.empty()) {
+        return true;
+    }
+    const WarmStartStore store(warm_dir(config_));
+
+    if (auto data = store.load(CODE_CACHE)) {
+        Reader in(*data);
+        std::vector<evm::CodeCache::WarmEntry> entries(static_cast<size_t>(
+            std::min<uint64_t>(in.get(4), config_.warm_code_entries)));
+        for (auto& entry : entries) {
+            entry.hot = in.get(1) != 0;
+            auto code = in.take(static_cast<size_t>(in.get(4)));
+            entry.code.assign(code.begin(), code.end());
+        }
+        if (in.ok()) {
+            const size_t added = evm::CodeCache::global().import_warm(entries);
+            logger_->info("Restored {} contracts into the code cache", added);
+        }
+    }
+
+    if (auto data = store.load(PEERS)) {
+        Reader in(*data);
+        std::vector<std::pair<std::string, uint16_t>> peers(static_cast<size_t>(
+            std::min<uint64_t>(in.get(4), config_.network.max_connections)));
+        for (auto& [addr, port] : peers) {
+            port = static_cast<uint16_t>(in.get(2));
+            auto bytes = in.take(static_cast<size_t>(in.get(2)));
+            addr.assign(bytes.begin(), bytes.end());
+        }
+        if (in.ok()) {
+            impl_->warm_peers = std::move(peers);
+            logger_->info("Restored {} peers", impl_->warm_peers.size());
+        }
+    }
+    return true;
+}
+
+void QuidsNode::saveWarmCaches() {
+    if (!config_.warm_start || config_.data_dir.empty()) {
+        return;
+    }
+    const WarmStartStore store(warm_dir(config_));
+
+    std::vector<uint8_t> code;
+    const auto entries = evm::CodeCache::global().export_warm(config_.warm_code_entries);
+    put(code, entries.size(), 4);
+    for (const auto& entry : entries) {
+        put(code, entry.hot ? 1 : 0, 1);
+        put(code, entry.code.size(), 4);
+        code.insert(code.end(), entry.code.begin(), entry.code.end());
+    }
+    store.save(CODE_CACHE, code);
+
+    if (p2p_node_) {
+        std::vector<uint8_t> peers;
+        const auto connected = p2p_node_->get_connected_peers();
+        put(peers, connected.size(), 4);
+        for (const auto& peer : connected) {
+            put(peers, peer.port, 2);
+            put(peers, peer.address.size(), 2);
+            peers.insert(peers.end(), peer.address.begin(), peer.address.end());
+        }
+        store.save(PEERS, peers);
+    }
+}
+
 } // namespace quids 
\ No newline at end of file
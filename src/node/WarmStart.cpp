@@ -0,0 +1,86 @@
+#include "node/WarmStart.hpp"
+#include "network/WireFormat.hpp"
+#include <spdlog/spdlog.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace quids {
+
+namespace {
+
+// "QWS", format version, CRC32C of the payload, payload size
+constexpr uint8_t MAGIC[3] = {'Q', 'W', 'S'};
+constexpr uint8_t FORMAT_VERSION = 1;
+constexpr size_t HEADER_SIZE = 3 + 1 + 4 + 8;
+
+void put(std::vector<uint8_t>& out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t get(const uint8_t* in, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+WarmStartStore::WarmStartStore(std::string dir) : dir_(std::move(dir)) {}
+
+std::string WarmStartStore::path(const std::string& name) const {
+    return (std::filesystem::path(dir_) / (name + ".warm")).string();
+}
+
+bool WarmStartStore::save(const std::string& name, std::span<const uint8_t> data) const {
+    std::vector<uint8_t> header(MAGIC, MAGIC + 3);
+    header.push_back(FORMAT_VERSION);
+    put(header, network::wire::crc32c(data), 4);
+    put(header, data.size(), 8);
+
+    std::error_code error;
+    std::filesystem::create_directories(dir_, error);
+    const std::string target = path(name);
+    const std::string temp = target + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out.flush()) {
+            spdlog::warn("Could not write warm cache {}", temp);
+            return false;
+        }
+    }
+    // Readers see the old file or the new one, never half of either
+    std::filesystem::rename(temp, target, error);
+    if (error) {
+        spdlog::warn("Could not replace warm cache {}: {}", target, error.message());
+        return false;
+    }
+    return true;
+}
+
+std::optional<std::vector<uint8_t>> WarmStartStore::load(const std::string& name) const {
+    std::ifstream in(path(name), std::ios::binary);
+    if (!in) {
+        return std::nullopt;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < HEADER_SIZE || !std::equal(MAGIC, MAGIC + 3, bytes.begin()) || bytes[3] != FORMAT_VERSION ||
+        get(bytes.data() + 8, 8) != bytes.size() - HEADER_SIZE) {
+        spdlog::warn("Ignoring malformed warm cache {}", name);
+        return std::nullopt;
+    }
+    std::vector<uint8_t> data(bytes.begin() + HEADER_SIZE, bytes.end());
+    if (network::wire::crc32c(data) != get(bytes.data() + 4, 4)) {
+        spdlog::warn("Ignoring corrupt warm cache {}", name);
+        return std::nullopt;
+    }
+    return data;
+}
+
+} // namespace quids
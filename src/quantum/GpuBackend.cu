@@ -0,0 +1,319 @@
+#include "quantum/GpuBackend.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// One source for both toolchains: hipcc accepts CUDA launch syntax, so only
+// the runtime calls differ
+#if defined(__HIPCC__)
+#include <hip/hip_runtime.h>
+#define gpuError_t hipError_t
+#define gpuSuccess hipSuccess
+#define gpuGetErrorString hipGetErrorString
+#define gpuGetDeviceCount hipGetDeviceCount
+#define gpuMalloc hipMalloc
+#define gpuFree hipFree
+#define gpuMemcpy hipMemcpy
+#define gpuMemcpyHostToDevice hipMemcpyHostToDevice
+#define gpuMemcpyDeviceToHost hipMemcpyDeviceToHost
+#define gpuGetLastError hipGetLastError
+#define GPU_BACKEND_NAME "hip"
+#else
+#include <cuda_runtime.h>
+#define gpuError_t cudaError_t
+#define gpuSuccess cudaSuccess
+#define gpuGetErrorString cudaGetErrorString
+#define gpuGetDeviceCount cudaGetDeviceCount
+#define gpuMalloc cudaMalloc
+#define gpuFree cudaFree
+#define gpuMemcpy cudaMemcpy
+#define gpuMemcpyHostToDevice cudaMemcpyHostToDevice
+#define gpuMemcpyDeviceToHost cudaMemcpyDeviceToHost
+#define gpuGetLastError cudaGetLastError
+#define GPU_BACKEND_NAME "cuda"
+#endif
+
+namespace quids::quantum::gpu {
+
+namespace {
+
+constexpr unsigned THREADS = 256;
+
+void check(gpuError_t status, const char* what) {
+    if (status != gpuSuccess) {
+        throw std::runtime_error(std::string(what) + ": " + gpuGetErrorString(status));
+    }
+}
+
+// Plain pair of doubles; same layout as std::complex<double>
+struct Amp {
+    double re;
+    double im;
+};
+
+struct Gate2 {
+    Amp m[4];
+};
+
+struct Gate4 {
+    Amp m[16];
+};
+
+__device__ inline Amp mul(Amp a, Amp b) {
+    return {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+}
+
+__device__ inline Amp add(Amp a, Amp b) {
+    return {a.re + b.re, a.im + b.im};
+}
+
+__device__ inline unsigned long long insertZero(unsigned long long k, unsigned p) {
+    const unsigned long long low = (1ULL << p) - 1;
+    return ((k & ~low) << 1) | (k & low);
+}
+
+// One thread per (pair, state); zeros are the inserted bit positions, ascending
+__global__ void pairKernel(Amp* a, unsigned long long pairs, unsigned long long batch, Gate2 g,
+                           unsigned zero0, unsigned zero1, unsigned num_zeros,
+                           unsigned long long set, unsigned long long partner) {
+    const unsigned long long t = blockIdx.x * static_cast<unsigned long long>(blockDim.x) + threadIdx.x;
+    if (t >= pairs * batch) {
+        return;
+    }
+    const unsigned long long k = t % batch;
+    unsigned long long i0 = insertZero(t / batch, zero0);
+    if (num_zeros == 2) {
+        i0 = insertZero(i0, zero1);
+    }
+    i0 |= set;
+    const unsigned long long i1 = i0 | partner;
+    const Amp x = a[i0 * batch + k];
+    const Amp y = a[i1 * batch + k];
+    a[i0 * batch + k] = add(mul(g.m[0], x), mul(g.m[1], y));
+    a[i1 * batch + k] = add(mul(g.m[2], x), mul(g.m[3], y));
+}
+
+__global__ void quadKernel(Amp* a, unsigned long long quads, unsigned long long batch, Gate4 g,
+                           unsigned lo, unsigned hi, unsigned long long m1, unsigned long long m2) {
+    const unsigned long long t = blockIdx.x * static_cast<unsigned long long>(blockDim.x) + threadIdx.x;
+    if (t >= quads * batch) {
+        return;
+    }
+    const unsigned long long k = t % batch;
+    const unsigned long long i = insertZero(insertZero(t / batch, lo), hi);
+    const unsigned long long idx[4] = {i, i | m2, i | m1, i | m1 | m2};
+    Amp x[4];
+    for (int c = 0; c < 4; ++c) {
+        x[c] = a[idx[c] * batch + k];
+    }
+    for (int r = 0; r < 4; ++r) {
+        Amp acc = mul(g.m[4 * r], x[0]);
+        for (int c = 1; c < 4; ++c) {
+            acc = add(acc, mul(g.m[4 * r + c], x[c]));
+        }
+        a[idx[r] * batch + k] = acc;
+    }
+}
+
+// One block per state: probability that qubit reads 1, then the outcome
+__global__ void probabilityKernel(const Amp* a, unsigned long long half, unsigned long long batch,
+                                  unsigned qubit, const double* uniforms, double* scale_one,
+                                  double* scale_zero, unsigned char* outcomes) {
+    __shared__ double partial[THREADS];
+    const unsigned long long k = blockIdx.x;
+    double sum = 0.0;
+    for (unsigned long long g = threadIdx.x; g < half; g += blockDim.x) {
+        const unsigned long long i = insertZero(g, qubit) | (1ULL << qubit);
+        const Amp x = a[i * batch + k];
+        sum += x.re * x.re + x.im * x.im;
+    }
+    partial[threadIdx.x] = sum;
+    __syncthreads();
+    for (unsigned s = blockDim.x / 2; s > 0; s >>= 1) {
+        if (threadIdx.x < s) {
+            partial[threadIdx.x] += partial[threadIdx.x + s];
+        }
+        __syncthreads();
+    }
+    if (threadIdx.x == 0) {
+        const double p1 = partial[0];
+        const bool result = uniforms[k] < p1;
+        const double norm_factor = rsqrt(result ? p1 : 1.0 - p1);
+        outcomes[k] = result;
+        scale_one[k] = result ? norm_factor : 0.0;
+        scale_zero[k] = result ? 0.0 : norm_factor;
+    }
+}
+
+__global__ void collapseKernel(Amp* a, unsigned long long total, unsigned long long batch,
+                               unsigned long long bit, const double* scale_one, const double* scale_zero) {
+    const unsigned long long t = blockIdx.x * static_cast<unsigned long long>(blockDim.x) + threadIdx.x;
+    if (t >= total) {
+        return;
+    }
+    const unsigned long long k = t % batch;
+    const double s = ((t / batch) & bit) ? scale_one[k] : scale_zero[k];
+    a[t].re *= s;
+    a[t].im *= s;
+}
+
+unsigned blocksFor(unsigned long long threads) {
+    return static_cast<unsigned>((threads + THREADS - 1) / THREADS);
+}
+
+template<typename T>
+class DeviceArray {
+public:
+    explicit DeviceArray(std::size_t count) : count_(count) {
+        check(gpuMalloc(reinterpret_cast<void**>(&data_), count * sizeof(T)), "device allocation");
+    }
+    ~DeviceArray() { gpuFree(data_); }
+    DeviceArray(const DeviceArray&) = delete;
+    DeviceArray& operator=(const DeviceArray&) = delete;
+
+    T* get() const noexcept { return data_; }
+    std::size_t size() const noexcept { return count_; }
+
+private:
+    T* data_{nullptr};
+    std::size_t count_;
+};
+
+class GpuBuffer final : public SimulationBackend::Buffer {
+public:
+    GpuBuffer(std::size_t num_qubits, std::size_t batch_size)
+        : num_qubits(num_qubits),
+          batch_size(batch_size),
+          amplitudes((std::size_t{1} << num_qubits) * batch_size),
+          uniforms(batch_size),
+          scale_one(batch_size),
+          scale_zero(batch_size),
+          outcomes(batch_size) {}
+
+    std::size_t num_qubits;
+    std::size_t batch_size;
+    DeviceArray<Amp> amplitudes;
+    // Measurement scratch, sized once per buffer
+    DeviceArray<double> uniforms;
+    DeviceArray<double> scale_one;
+    DeviceArray<double> scale_zero;
+    DeviceArray<unsigned char> outcomes;
+};
+
+GpuBuffer& cast(SimulationBackend::Buffer& buffer) {
+    return static_cast<GpuBuffer&>(buffer);
+}
+
+Gate2 toGate(const Eigen::Matrix2cd& m) {
+    return {{{m(0, 0).real(), m(0, 0).imag()}, {m(0, 1).real(), m(0, 1).imag()},
+             {m(1, 0).real(), m(1, 0).imag()}, {m(1, 1).real(), m(1, 1).imag()}}};
+}
+
+void checkQubits(const GpuBuffer& b, std::size_t q1, std::size_t q2) {
+    if (q1 >= b.num_qubits || q2 >= b.num_qubits) {
+        throw std::out_of_range("Qubit index out of range");
+    }
+    if (q1 == q2) {
+        throw std::invalid_argument("Two-qubit gate needs two distinct qubits");
+    }
+}
+
+class GpuBackend final : public SimulationBackend {
+public:
+    const char* name() const noexcept override { return GPU_BACKEND_NAME; }
+
+    std::unique_ptr<Buffer> upload(const std::complex<double>* amplitudes,
+                                   std::size_t num_qubits,
+                                   std::size_t batch_size) override {
+        auto buffer = std::make_unique<GpuBuffer>(num_qubits, batch_size);
+        check(gpuMemcpy(buffer->amplitudes.get(), amplitudes, buffer->amplitudes.size() * sizeof(Amp),
+                        gpuMemcpyHostToDevice), "upload");
+        return buffer;
+    }
+
+    void download(const Buffer& buffer, std::complex<double>* amplitudes) override {
+        const auto& b = static_cast<const GpuBuffer&>(buffer);
+        check(gpuMemcpy(amplitudes, b.amplitudes.get(), b.amplitudes.size() * sizeof(Amp),
+                        gpuMemcpyDeviceToHost), "download");
+    }
+
+    void applySingleQubitGate(Buffer& buffer, const Eigen::Matrix2cd& gate, std::size_t qubit) override {
+        auto& b = cast(buffer);
+        if (qubit >= b.num_qubits) {
+            throw std::out_of_range("Qubit index out of range");
+        }
+        const unsigned long long pairs = 1ULL << (b.num_qubits - 1);
+        pairKernel<<<blocksFor(pairs * b.batch_size), THREADS>>>(
+            b.amplitudes.get(), pairs, b.batch_size, toGate(gate),
+            static_cast<unsigned>(qubit), 0, 1, 0, 1ULL << qubit);
+        check(gpuGetLastError(), "single-qubit gate");
+    }
+
+    void applyTwoQubitGate(Buffer& buffer, const Eigen::Matrix4cd& gate,
+                           std::size_t qubit1, std::size_t qubit2) override {
+        auto& b = cast(buffer);
+        checkQubits(b, qubit1, qubit2);
+        Gate4 g;
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                g.m[4 * r + c] = {gate(r, c).real(), gate(r, c).imag()};
+            }
+        }
+        const unsigned long long quads = 1ULL << (b.num_qubits - 2);
+        quadKernel<<<blocksFor(quads * b.batch_size), THREADS>>>(
+            b.amplitudes.get(), quads, b.batch_size, g,
+            static_cast<unsigned>(std::min(qubit1, qubit2)), static_cast<unsigned>(std::max(qubit1, qubit2)),
+            1ULL << qubit1, 1ULL << qubit2);
+        check(gpuGetLastError(), "two-qubit gate");
+    }
+
+    void applyControlledGate(Buffer& buffer, const Eigen::Matrix2cd& gate,
+                             std::size_t control, std::size_t target) override {
+        auto& b = cast(buffer);
+        checkQubits(b, control, target);
+        const unsigned long long pairs = 1ULL << (b.num_qubits - 2);
+        pairKernel<<<blocksFor(pairs * b.batch_size), THREADS>>>(
+            b.amplitudes.get(), pairs, b.batch_size, toGate(gate),
+            static_cast<unsigned>(std::min(control, target)), static_cast<unsigned>(std::max(control, target)),
+            2, 1ULL << control, 1ULL << target);
+        check(gpuGetLastError(), "controlled gate");
+    }
+
+    std::vector<bool> measure(Buffer& buffer, std::size_t qubit, const std::vector<double>& uniforms) override {
+        auto& b = cast(buffer);
+        if (qubit >= b.num_qubits) {
+            throw std::out_of_range("Qubit index out of range");
+        }
+        if (uniforms.size() != b.batch_size) {
+            throw std::invalid_argument("Need one random draw per state");
+        }
+        check(gpuMemcpy(b.uniforms.get(), uniforms.data(), uniforms.size() * sizeof(double),
+                        gpuMemcpyHostToDevice), "measurement draws");
+
+        probabilityKernel<<<static_cast<unsigned>(b.batch_size), THREADS>>>(
+            b.amplitudes.get(), 1ULL << (b.num_qubits - 1), b.batch_size, static_cast<unsigned>(qubit),
+            b.uniforms.get(), b.scale_one.get(), b.scale_zero.get(), b.outcomes.get());
+        check(gpuGetLastError(), "measurement");
+        const unsigned long long total = b.amplitudes.size();
+        collapseKernel<<<blocksFor(total), THREADS>>>(
+            b.amplitudes.get(), total, b.batch_size, 1ULL << qubit, b.scale_one.get(), b.scale_zero.get());
+        check(gpuGetLastError(), "collapse");
+
+        // Only the outcomes come back
+        std::vector<unsigned char> raw(b.batch_size);
+        check(gpuMemcpy(raw.data(), b.outcomes.get(), raw.size(), gpuMemcpyDeviceToHost), "outcomes");
+        return std::vector<bool>(raw.begin(), raw.end());
+    }
+};
+
+} // namespace
+
+std::shared_ptr<SimulationBackend> makeGpuBackend() {
+    int devices = 0;
+    if (gpuGetDeviceCount(&devices) != gpuSuccess || devices == 0) {
+        return nullptr;
+    }
+    return std::make_shared<GpuBackend>();
+}
+
+} // namespace quids::quantum::gpu
@@ -0,0 +1,355 @@
+#include "quantum/MatrixProductState.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace quids::quantum {
+
+    namespace {
+        using Eigen::Matrix2cd;
+        using Eigen::Matrix4cd;
+        using Eigen::MatrixXcd;
+        using Eigen::VectorXd;
+
+        const Matrix4cd SWAP = (Matrix4cd() << 1, 0, 0, 0,
+                                               0, 0, 1, 0,
+                                               0, 1, 0, 0,
+                                               0, 0, 0, 1).finished();
+
+        // The same gate with its two qubits listed the other way round
+        Matrix4cd swapOrder(const Matrix4cd& m) {
+            static constexpr int perm[4] = {0, 2, 1, 3};
+            Matrix4cd out;
+            for (int r = 0; r < 4; ++r)
+                for (int c = 0; c < 4; ++c)
+                    out(r, c) = m(perm[r], perm[c]);
+            return out;
+        }
+
+        // Thin QR: m = q * r with q's columns orthonormal
+        std::pair<MatrixXcd, MatrixXcd> thinQR(const MatrixXcd& m) {
+            const Eigen::Index k = std::min(m.rows(), m.cols());
+            Eigen::HouseholderQR<MatrixXcd> qr(m);
+            MatrixXcd q = qr.householderQ() * MatrixXcd::Identity(m.rows(), k);
+            MatrixXcd r = qr.matrixQR().topRows(k).triangularView<Eigen::Upper>();
+            return {std::move(q), std::move(r)};
+        }
+    }
+
+    MatrixProductState::MatrixProductState(std::size_t num_qubits, const Config& config)
+            : config_(config) {
+        if (num_qubits == 0) {
+            throw std::invalid_argument("Matrix product state needs at least one qubit");
+        }
+        config_.max_bond_dimension = std::max<std::size_t>(1, config_.max_bond_dimension);
+        sites_.resize(num_qubits);
+        for (Site& site : sites_) {
+            site[0] = MatrixXcd::Ones(1, 1);
+            site[1] = MatrixXcd::Zero(1, 1);
+        }
+    }
+
+    // Splits off one site at a time from the left, so every site but the
+    // last ends up left-orthonormal and the last is the center
+    MatrixProductState::MatrixProductState(const std::complex<double>* amplitudes, std::size_t num_qubits,
+                                           const Config& config, std::size_t stride)
+            : MatrixProductState(num_qubits, config) {
+        const std::size_t dim = std::size_t{1} << num_qubits;
+        // rest(l, c) with the lowest remaining qubit fastest in c
+        MatrixXcd rest(1, static_cast<Eigen::Index>(dim));
+        for (std::size_t i = 0; i < dim; ++i) {
+            rest(0, static_cast<Eigen::Index>(i)) = amplitudes[i * stride];
+        }
+        for (std::size_t k = 0; k + 1 < num_qubits; ++k) {
+            const Eigen::Index dl = rest.rows();
+            const Eigen::Index cols = rest.cols() / 2;
+            MatrixXcd m(2 * dl, cols);
+            for (Eigen::Index c = 0; c < cols; ++c) {
+                m.col(c).head(dl) = rest.col(2 * c);
+                m.col(c).tail(dl) = rest.col(2 * c + 1);
+            }
+            Eigen::BDCSVD<MatrixXcd> svd(m, Eigen::ComputeThinU | Eigen::ComputeThinV);
+            VectorXd s = svd.singularValues();
+            const Eigen::Index keep = static_cast<Eigen::Index>(keepCount(s));
+            const double total = s.squaredNorm();
+            const double kept = s.head(keep).squaredNorm();
+            if (kept > 0.0) {
+                s *= std::sqrt(total / kept);
+            }
+            const MatrixXcd u = svd.matrixU().leftCols(keep);
+            sites_[k][0] = u.topRows(dl);
+            sites_[k][1] = u.bottomRows(dl);
+            rest = s.head(keep).asDiagonal() * svd.matrixV().leftCols(keep).adjoint();
+        }
+        sites_.back()[0] = rest.col(0);
+        sites_.back()[1] = rest.col(1);
+        center_ = num_qubits - 1;
+    }
+
+    // Left half times right half: a 2^m x 2^(n-m) product whose column-major
+    // layout is basis order, with bond-sized intermediates
+    void MatrixProductState::toAmplitudes(std::complex<double>* amplitudes, std::size_t stride) const {
+        const std::size_t n = sites_.size();
+        const std::size_t m = n / 2;
+
+        MatrixXcd left = MatrixXcd::Ones(1, 1);
+        for (std::size_t k = 0; k < m; ++k) {
+            MatrixXcd next(2 * left.rows(), sites_[k][0].cols());
+            next.topRows(left.rows()) = left * sites_[k][0];
+            next.bottomRows(left.rows()) = left * sites_[k][1];
+            left = std::move(next);
+        }
+        MatrixXcd right = MatrixXcd::Ones(1, 1);
+        for (std::size_t k = n; k-- > m;) {
+            const MatrixXcd t0 = sites_[k][0] * right;
+            const MatrixXcd t1 = sites_[k][1] * right;
+            MatrixXcd next(t0.rows(), 2 * right.cols());
+            for (Eigen::Index c = 0; c < right.cols(); ++c) {
+                next.col(2 * c) = t0.col(c);
+                next.col(2 * c + 1) = t1.col(c);
+            }
+            right = std::move(next);
+        }
+        const MatrixXcd full = left * right;
+        for (Eigen::Index i = 0; i < full.size(); ++i) {
+            amplitudes[static_cast<std::size_t>(i) * stride] = full.data()[i];
+        }
+    }
+
+    // A unitary on the physical index keeps every canonical condition
+    void MatrixProductState::applySingleQubitGate(std::size_t qubit, const Matrix2cd& gate) {
+        validateQubit(qubit);
+        Site& site = sites_[qubit];
+        MatrixXcd a0 = gate(0, 0) * site[0] + gate(0, 1) * site[1];
+        site[1] = gate(1, 0) * site[0] + gate(1, 1) * site[1];
+        site[0] = std::move(a0);
+    }
+
+    void MatrixProductState::applyTwoQubitGate(std::size_t qubit1, std::size_t qubit2, const Matrix4cd& gate) {
+        validateQubit(qubit1);
+        validateQubit(qubit2);
+        if (qubit1 == qubit2) {
+            throw std::invalid_argument("Two-qubit gate needs distinct qubits");
+        }
+        const std::size_t lo = std::min(qubit1, qubit2);
+        const std::size_t hi = std::max(qubit1, qubit2);
+        const Matrix4cd ordered = qubit1 < qubit2 ? gate : swapOrder(gate);
+        // Bring hi next to lo, apply, and take it back
+        for (std::size_t k = hi; k > lo + 1; --k) {
+            applyAdjacent(k - 1, SWAP);
+        }
+        applyAdjacent(lo, ordered);
+        for (std::size_t k = lo + 1; k < hi; ++k) {
+            applyAdjacent(k, SWAP);
+        }
+    }
+
+    void MatrixProductState::applyControlledGate(std::size_t control, std::size_t target, const Matrix2cd& gate) {
+        Matrix4cd block = Matrix4cd::Identity();
+        block.bottomRightCorner<2, 2>() = gate;
+        applyTwoQubitGate(control, target, block);
+    }
+
+    bool MatrixProductState::measure(std::size_t qubit, double uniform) {
+        validateQubit(qubit);
+        moveCenterTo(qubit);
+        Site& site = sites_[qubit];
+        const double p0 = site[0].squaredNorm();
+        const double p1 = site[1].squaredNorm();
+        const double total = p0 + p1;
+        const bool outcome = total > 0.0 && uniform < p1 / total;
+        const double kept = outcome ? p1 : p0;
+        site[outcome ? 0 : 1].setZero();
+        if (kept > 0.0) {
+            site[outcome ? 1 : 0] *= std::sqrt(total / kept);
+        }
+        return outcome;
+    }
+
+    std::size_t MatrixProductState::maxBondDimension() const noexcept {
+        std::size_t bond = 1;
+        for (const Site& site : sites_) {
+            bond = std::max(bond, static_cast<std::size_t>(site[0].cols()));
+        }
+        return bond;
+    }
+
+    std::size_t MatrixProductState::memoryBytes() const noexcept {
+        std::size_t elements = 0;
+        for (const Site& site : sites_) {
+            elements += static_cast<std::size_t>(site[0].size() + site[1].size());
+        }
+        return elements * sizeof(std::complex<double>);
+    }
+
+    void MatrixProductState::validateQubit(std::size_t qubit) const {
+        if (qubit >= sites_.size()) {
+            throw std::out_of_range("Qubit index out of range");
+        }
+    }
+
+    void MatrixProductState::moveCenterTo(std::size_t site) {
+        while (center_ < site) {
+            // Left-orthonormalize the center and push R into the next site
+            Site& a = sites_[center_];
+            Site& b = sites_[center_ + 1];
+            const Eigen::Index dl = a[0].rows();
+            MatrixXcd stacked(2 * dl, a[0].cols());
+            stacked << a[0], a[1];
+            auto [q, r] = thinQR(stacked);
+            a[0] = q.topRows(dl);
+            a[1] = q.bottomRows(dl);
+            b[0] = r * b[0];
+            b[1] = r * b[1];
+            ++center_;
+        }
+        while (center_ > site) {
+            // Right-orthonormalize the center via QR of its adjoint
+            Site& a = sites_[center_];
+            Site& b = sites_[center_ - 1];
+            const Eigen::Index dr = a[0].cols();
+            MatrixXcd wide(a[0].rows(), 2 * dr);
+            wide << a[0], a[1];
+            auto [q, r] = thinQR(wide.adjoint());
+            const MatrixXcd rows = q.adjoint();
+            a[0] = rows.leftCols(dr);
+            a[1] = rows.rightCols(dr);
+            const MatrixXcd l = r.adjoint();
+            b[0] = b[0] * l;
+            b[1] = b[1] * l;
+            --center_;
+        }
+    }
+
+    // With the center on `site` the rest of the chain is orthonormal, so
+    // the singular values of the pair are its Schmidt coefficients and
+    // truncating them is the best cut at that bond
+    void MatrixProductState::applyAdjacent(std::size_t site, const Matrix4cd& gate) {
+        moveCenterTo(site);
+        Site& a = sites_[site];
+        Site& b = sites_[site + 1];
+        const Eigen::Index dl = a[0].rows();
+        const Eigen::Index dr = b[0].cols();
+
+        std::array<MatrixXcd, 4> theta;
+        for (int s = 0; s < 2; ++s)
+            for (int t = 0; t < 2; ++t)
+                theta[2 * s + t] = a[s] * b[t];
+        MatrixXcd m = MatrixXcd::Zero(2 * dl, 2 * dr);
+        for (int u = 0; u < 2; ++u)
+            for (int v = 0; v < 2; ++v)
+                for (int in = 0; in < 4; ++in)
+                    if (gate(2 * u + v, in) != 0.0)
+                        m.block(u * dl, v * dr, dl, dr) += gate(2 * u + v, in) * theta[in];
+
+        Eigen::BDCSVD<MatrixXcd> svd(m, Eigen::ComputeThinU | Eigen::ComputeThinV);
+        VectorXd s = svd.singularValues();
+        const Eigen::Index keep = static_cast<Eigen::Index>(keepCount(s));
+        const double total = s.squaredNorm();
+        const double kept = s.head(keep).squaredNorm();
+        if (kept > 0.0) {
+            s *= std::sqrt(total / kept);
+        }
+        const MatrixXcd u = svd.matrixU().leftCols(keep);
+        const MatrixXcd sv = s.head(keep).asDiagonal() * svd.matrixV().leftCols(keep).adjoint();
+        a[0] = u.topRows(dl);
+        a[1] = u.bottomRows(dl);
+        b[0] = sv.leftCols(dr);
+        b[1] = sv.rightCols(dr);
+        center_ = site + 1;
+    }
+
+    std::size_t MatrixProductState::keepCount(const VectorXd& singular) {
+        const double total = singular.squaredNorm();
+        std::size_t keep = std::min<std::size_t>(static_cast<std::size_t>(singular.size()),
+                                                 config_.max_bond_dimension);
+        if (total <= 0.0) {
+            return 1;
+        }
+        double dropped = singular.tail(singular.size() - static_cast<Eigen::Index>(keep)).squaredNorm();
+        while (keep > 1) {
+            const double next = singular(static_cast<Eigen::Index>(keep) - 1);
+            if (dropped + next * next > config_.truncation_cutoff * total) {
+                break;
+            }
+            dropped += next * next;
+            --keep;
+        }
+        truncation_error_ += dropped / total;
+        return keep;
+    }
+
+    namespace {
+        class MpsBuffer final : public SimulationBackend::Buffer {
+        public:
+            std::vector<MatrixProductState> states;
+        };
+
+        class MpsBackend final : public SimulationBackend {
+        public:
+            explicit MpsBackend(const MatrixProductState::Config& config) : config_(config) {}
+
+            const char* name() const noexcept override { return "mps"; }
+
+            bool replacesHostCopy() const noexcept override { return true; }
+
+            std::unique_ptr<Buffer> upload(const std::complex<double>* amplitudes,
+                                           std::size_t num_qubits,
+                                           std::size_t batch_size) override {
+                auto buffer = std::make_unique<MpsBuffer>();
+                buffer->states.reserve(batch_size);
+                for (std::size_t k = 0; k < batch_size; ++k) {
+                    buffer->states.emplace_back(amplitudes + k, num_qubits, config_, batch_size);
+                }
+                return buffer;
+            }
+
+            void download(const Buffer& buffer, std::complex<double>* amplitudes) override {
+                const auto& states = static_cast<const MpsBuffer&>(buffer).states;
+                for (std::size_t k = 0; k < states.size(); ++k) {
+                    states[k].toAmplitudes(amplitudes + k, states.size());
+                }
+            }
+
+            void applySingleQubitGate(Buffer& buffer, const Matrix2cd& gate, std::size_t qubit) override {
+                for (auto& state : static_cast<MpsBuffer&>(buffer).states) {
+                    state.applySingleQubitGate(qubit, gate);
+                }
+            }
+
+            void applyTwoQubitGate(Buffer& buffer, const Matrix4cd& gate,
+                                   std::size_t qubit1, std::size_t qubit2) override {
+                for (auto& state : static_cast<MpsBuffer&>(buffer).states) {
+                    state.applyTwoQubitGate(qubit1, qubit2, gate);
+                }
+            }
+
+            void applyControlledGate(Buffer& buffer, const Matrix2cd& gate,
+                                     std::size_t control, std::size_t target) override {
+                for (auto& state : static_cast<MpsBuffer&>(buffer).states) {
+                    state.applyControlledGate(control, target, gate);
+                }
+            }
+
+            std::vector<bool> measure(Buffer& buffer, std::size_t qubit,
+                                      const std::vector<double>& uniforms) override {
+                auto& states = static_cast<MpsBuffer&>(buffer).states;
+                std::vector<bool> outcomes(states.size());
+                for (std::size_t k = 0; k < states.size(); ++k) {
+                    outcomes[k] = states[k].measure(qubit, uniforms.at(k));
+                }
+                return outcomes;
+            }
+
+        private:
+            const MatrixProductState::Config config_;
+        };
+    }
+
+    std::shared_ptr<SimulationBackend> makeMpsBackend(const MatrixProductState::Config& config) {
+        return std::make_shared<MpsBackend>(config);
+    }
+
+}  // namespace quids::quantum
@@ -1,106 +1,463 @@
 #include "quantum/QKD.hpp"
+#include "utils/CpuFeatures.hpp"
 #include <algorithm>
+#include <bit>
 #include <cmath>
-#include <iostream>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define QUIDS_QKD_X86 1
+#endif
 
 namespace quantum {
 
+namespace {
+
+// Rates from here on leave no secure key after error correction
+constexpr double MAX_ERROR_RATE = 0.11;
+// Below this a chunk's fixed costs swallow the key
+constexpr size_t MIN_CHUNK_LENGTH = 1024;
+// Bits given up per chunk on top of the estimated leakage
+constexpr size_t SECURITY_MARGIN_BITS = 64;
+// Cascade passes; block size doubles each pass
+constexpr size_t CASCADE_PASSES = 4;
+
+KeyBits makeBits(size_t length) {
+    KeyBits bits;
+    bits.size = length;
+    bits.words.assign((length + 63) / 64, 0);
+    return bits;
+}
+
+uint64_t tailMask(size_t length) {
+    return length % 64 == 0 ? ~uint64_t{0} : (uint64_t{1} << (length % 64)) - 1;
+}
+
+void flipBit(KeyBits& bits, size_t i) {
+    bits.words[i >> 6] ^= uint64_t{1} << (i & 63);
+}
+
+// Appends the low count bits of value
+inline void appendWord(KeyBits& out, uint64_t value, unsigned count) {
+    if (count == 0) {
+        return;
+    }
+    const size_t offset = out.size & 63;
+    const size_t word = out.size >> 6;
+    if (out.words.size() < (out.size + count + 63) / 64) {
+        out.words.resize((out.size + count + 63) / 64, 0);
+    }
+    if (count < 64) {
+        value &= (uint64_t{1} << count) - 1;
+    }
+    out.words[word] |= value << offset;
+    if (offset != 0 && offset + count > 64) {
+        out.words[word + 1] |= value >> (64 - offset);
+    }
+    out.size += count;
+}
+
+void appendBits(KeyBits& out, const KeyBits& bits) {
+    for (size_t w = 0; w < bits.words.size(); ++w) {
+        const size_t remaining = bits.size - w * 64;
+        appendWord(out, bits.words[w], static_cast<unsigned>(std::min<size_t>(64, remaining)));
+    }
+}
+
+// Parity of bits [first, last)
+bool parityRange(const KeyBits& bits, size_t first, size_t last) {
+    if (first >= last) {
+        return false;
+    }
+    const size_t fw = first >> 6;
+    const size_t lw = (last - 1) >> 6;
+    const uint64_t head = ~uint64_t{0} << (first & 63);
+    const uint64_t tail = tailMask(last);
+    if (fw == lw) {
+        return std::popcount(bits.words[fw] & head & tail) & 1;
+    }
+    uint64_t acc = (bits.words[fw] & head) ^ (bits.words[lw] & tail);
+    for (size_t w = fw + 1; w < lw; ++w) {
+        acc ^= bits.words[w];
+    }
+    return std::popcount(acc) & 1;
+}
+
+double binaryEntropy(double p) {
+    if (p <= 0.0 || p >= 1.0) {
+        return 0.0;
+    }
+    return -p * std::log2(p) - (1.0 - p) * std::log2(1.0 - p);
+}
+
+// Bits of value at the set positions of mask, packed low
+inline uint64_t extractPortable(uint64_t value, uint64_t mask) {
+    uint64_t result = 0;
+    for (unsigned k = 0; mask != 0; ++k, mask &= mask - 1) {
+        result |= ((value >> std::countr_zero(mask)) & 1) << k;
+    }
+    return result;
+}
+
+void siftPortable(const KeyBits& a, const KeyBits& b, const KeyBits& raw, KeyBits& out) {
+    for (size_t w = 0; w < raw.words.size(); ++w) {
+        uint64_t keep = ~(a.words[w] ^ b.words[w]);
+        if (w + 1 == raw.words.size()) {
+            keep &= tailMask(raw.size);
+        }
+        appendWord(out, extractPortable(raw.words[w], keep), static_cast<unsigned>(std::popcount(keep)));
+    }
+}
+
+// Carry-less 64x64 -> 128 product
+inline std::pair<uint64_t, uint64_t> clmulPortable(uint64_t x, uint64_t y) {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+    for (unsigned b = 0; b < 64; ++b) {
+        const uint64_t take = 0 - ((y >> b) & 1);
+        lo ^= (x << b) & take;
+        if (b != 0) {
+            hi ^= (x >> (64 - b)) & take;
+        }
+    }
+    return {lo, hi};
+}
+
+// Words [lo, lo + out.size()) of the GF(2) product a(x) * b(x)
+template<typename Multiply>
+inline void productWindow(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, size_t lo,
+                          std::vector<uint64_t>& out, Multiply&& multiply) {
+    const size_t hi = lo + out.size();
+    for (size_t j = 0; j < b.size(); ++j) {
+        if (b[j] == 0) {
+            continue;
+        }
+        // Word t = i + j of the product takes the low half, t + 1 the high half
+        const size_t first = lo > j + 1 ? lo - j - 1 : 0;
+        const size_t last = std::min(a.size(), hi > j ? hi - j : 0);
+        for (size_t i = first; i < last; ++i) {
+            const auto [low, high] = multiply(a[i], b[j]);
+            const size_t t = i + j;
+            if (t >= lo && t < hi) {
+                out[t - lo] ^= low;
+            }
+            if (t + 1 >= lo && t + 1 < hi) {
+                out[t + 1 - lo] ^= high;
+            }
+        }
+    }
+}
+
+void productWindowPortable(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, size_t lo,
+                           std::vector<uint64_t>& out) {
+    productWindow(a, b, lo, out, clmulPortable);
+}
+
+#if QUIDS_QKD_X86
+
+bool hasBmi2() {
+    static const bool supported =
+        ::quids::utils::useFeature("quantum.qkd_sift", ::quids::utils::CpuFeature::Bmi2);
+    return supported;
+}
+
+bool hasPclmul() {
+    static const bool supported =
+        ::quids::utils::useFeature("quantum.qkd_clmul", ::quids::utils::CpuFeature::Pclmul);
+    return supported;
+}
+
+__attribute__((target("bmi2"))) void siftBmi2(const KeyBits& a, const KeyBits& b, const KeyBits& raw, KeyBits& out) {
+    for (size_t w = 0; w < raw.words.size(); ++w) {
+        uint64_t keep = ~(a.words[w] ^ b.words[w]);
+        if (w + 1 == raw.words.size()) {
+            keep &= tailMask(raw.size);
+        }
+        appendWord(out, _pext_u64(raw.words[w], keep), static_cast<unsigned>(std::popcount(keep)));
+    }
+}
+
+__attribute__((target("pclmul"))) void productWindowPclmul(const std::vector<uint64_t>& a,
+                                                           const std::vector<uint64_t>& b, size_t lo,
+                                                           std::vector<uint64_t>& out) {
+    productWindow(a, b, lo, out, [](uint64_t x, uint64_t y) __attribute__((target("pclmul"))) {
+        const __m128i p = _mm_clmulepi64_si128(_mm_cvtsi64_si128(static_cast<long long>(x)),
+                                               _mm_cvtsi64_si128(static_cast<long long>(y)), 0x00);
+        return std::pair<uint64_t, uint64_t>{static_cast<uint64_t>(_mm_cvtsi128_si64(p)),
+                                             static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_srli_si128(p, 8)))};
+    });
+}
+
+#endif
+
+} // namespace
+
 // Constructor
-QKD::QKD() : gen(rd()), dis(0, 1) {}
+QKD::QKD(double errorRate) : errorRate_(errorRate) {
+    if (!(errorRate >= 0.0 && errorRate < MAX_ERROR_RATE)) {
+        throw std::invalid_argument("Channel error rate must be in [0, 0.11)");
+    }
+}
 
 // Generate a random quantum key using the BB84 protocol
-std::vector<bool> QKD::generateKey(size_t keyLength) {
-    // Step 1: Alice generates random bits and bases
-    std::vector<bool> aliceBits = generateRandomBits(keyLength);
-    std::vector<bool> aliceBases = generateRandomBases(keyLength);
+KeyBits QKD::generateKey(size_t keyLength) {
+    KeyBits key;
+    key.words.reserve((keyLength + 63) / 64);
+    streamKey(keyLength, [&](const KeyBits& chunk) { appendBits(key, chunk); });
+    return key;
+}
 
-    // Step 2: Alice sends qubits to Bob using her bases
-    std::vector<bool> bobBases = generateRandomBases(keyLength);
-    std::vector<bool> bobBits = transmitQubits(aliceBits, bobBases);
+void QKD::streamKey(size_t keyLength, const std::function<void(const KeyBits&)>& sink, size_t chunkLength) {
+    if (chunkLength < MIN_CHUNK_LENGTH) {
+        throw std::invalid_argument("QKD chunks need at least 1024 qubits");
+    }
+    size_t produced = 0;
+    while (produced < keyLength) {
+        // Step 1: Alice generates random bits and bases
+        const KeyBits aliceBits = generateRandomBits(chunkLength);
+        const KeyBits aliceBases = generateRandomBits(chunkLength);
 
-    // Step 3: Alice and Bob sift their keys
-    std::vector<bool> siftedKey = siftKeys(aliceBases, bobBases, bobBits);
+        // Step 2: Alice sends qubits to Bob, who measures in his own bases
+        const KeyBits bobBases = generateRandomBits(chunkLength);
+        const KeyBits bobBits = transmitQubits(aliceBits, aliceBases, bobBases);
 
-    // Step 4: Perform error correction (simplified)
-    std::vector<bool> correctedKey = correctErrors(siftedKey, 0.05); // Assume 5% error rate
+        // Step 3: Alice and Bob sift their keys
+        const KeyBits aliceKey = siftKeys(aliceBases, bobBases, aliceBits);
+        KeyBits bobKey = siftKeys(aliceBases, bobBases, bobBits);
 
-    // Step 5: Perform privacy amplification
-    std::vector<bool> finalKey = privacyAmplification(correctedKey, keyLength / 2);
+        // Step 4: Perform error correction; a chunk Cascade missed an error in is dropped
+        const CorrectionStats stats = correctErrors(aliceKey, bobKey, errorRate_);
+        if (aliceKey.words != bobKey.words) {
+            continue;
+        }
 
-    return finalKey;
+        // Step 5: Perform privacy amplification, removing what Eve may have learned
+        const size_t sifted = aliceKey.size;
+        const double qber = sifted == 0 ? 0.0 : static_cast<double>(stats.correctedErrors) / static_cast<double>(sifted);
+        const size_t leaked = stats.disclosedBits + SECURITY_MARGIN_BITS +
+                              static_cast<size_t>(std::ceil(binaryEntropy(qber) * static_cast<double>(sifted)));
+        if (leaked >= sifted) {
+            throw std::runtime_error("QKD chunk leaves no secure key; use longer chunks");
+        }
+        const size_t length = std::min(sifted - leaked, keyLength - produced);
+        sink(privacyAmplification(aliceKey, length));
+        produced += length;
+    }
 }
 
 // Simulate the transmission of qubits from Alice to Bob
-std::vector<bool> QKD::transmitQubits(const std::vector<bool>& bits, const std::vector<bool>& bases) {
-    std::vector<bool> measuredBits;
-    for (size_t i = 0; i < bits.size(); ++i) {
-        // If bases match, Bob measures the correct bit
-        if (bases[i] == (i % 2 == 0)) { // Simplified basis matching
-            measuredBits.push_back(bits[i]);
-        } else {
-            // If bases don't match, Bob's measurement is random
-            measuredBits.push_back(dis(gen));
-        }
+KeyBits QKD::transmitQubits(const KeyBits& bits, const KeyBits& aliceBases, const KeyBits& bobBases) {
+    if (aliceBases.size != bits.size || bobBases.size != bits.size) {
+        throw std::invalid_argument("Bits and bases must have the same length");
+    }
+    // Matching bases read Alice's bit through the noisy channel, others read a random bit
+    const KeyBits noise = generateChannelNoise(bits.size);
+    const KeyBits guesses = generateRandomBits(bits.size);
+    KeyBits measured = makeBits(bits.size);
+    for (size_t w = 0; w < measured.words.size(); ++w) {
+        const uint64_t match = ~(aliceBases.words[w] ^ bobBases.words[w]);
+        measured.words[w] = ((bits.words[w] ^ noise.words[w]) & match) | (guesses.words[w] & ~match);
+    }
+    if (!measured.words.empty()) {
+        measured.words.back() &= tailMask(measured.size);
     }
-    return measuredBits;
+    return measured;
 }
 
 // Perform sifting to discard mismatched bases
-std::vector<bool> QKD::siftKeys(const std::vector<bool>& aliceBases, const std::vector<bool>& bobBases, const std::vector<bool>& rawKey) {
-    std::vector<bool> siftedKey;
-    for (size_t i = 0; i < aliceBases.size(); ++i) {
-        if (aliceBases[i] == bobBases[i]) {
-            siftedKey.push_back(rawKey[i]);
-        }
+KeyBits QKD::siftKeys(const KeyBits& aliceBases, const KeyBits& bobBases, const KeyBits& rawKey) {
+    if (aliceBases.size != rawKey.size || bobBases.size != rawKey.size) {
+        throw std::invalid_argument("Bases and key must have the same length");
+    }
+    KeyBits sifted;
+    sifted.words.assign(rawKey.words.size(), 0);
+#if QUIDS_QKD_X86
+    if (hasBmi2()) {
+        siftBmi2(aliceBases, bobBases, rawKey, sifted);
+        sifted.words.resize((sifted.size + 63) / 64);
+        return sifted;
     }
-    return siftedKey;
+#endif
+    siftPortable(aliceBases, bobBases, rawKey, sifted);
+    sifted.words.resize((sifted.size + 63) / 64);
+    return sifted;
 }
 
-// Perform error correction (simplified for demonstration)
-std::vector<bool> QKD::correctErrors(const std::vector<bool>& siftedKey, double errorRate) {
-    std::vector<bool> correctedKey = siftedKey;
-    for (size_t i = 0; i < correctedKey.size(); ++i) {
-        if (static_cast<double>(dis(gen)) / RAND_MAX < errorRate) {
-            correctedKey[i] = !correctedKey[i]; // Flip the bit to simulate correction
+// Perform Cascade error correction: compare block parities, binary-search
+// blocks that disagree, and revisit earlier passes each fix changes
+QKD::CorrectionStats QKD::correctErrors(const KeyBits& aliceKey, KeyBits& bobKey, double errorRate) {
+    if (aliceKey.size != bobKey.size) {
+        throw std::invalid_argument("Keys must have the same length");
+    }
+    const size_t n = aliceKey.size;
+    CorrectionStats stats;
+    if (n == 0) {
+        return stats;
+    }
+
+    const auto first_block = static_cast<size_t>(std::ceil(0.73 / std::max(errorRate, 1e-4)));
+    std::vector<size_t> block_size(CASCADE_PASSES);
+    for (size_t pass = 0; pass < CASCADE_PASSES; ++pass) {
+        block_size[pass] = std::clamp<size_t>(first_block << pass, 2, n);
+    }
+
+    // Passes after the first see the key through a random permutation
+    auto& rng = quids::utils::RandomService::global().local();
+    std::vector<std::vector<uint32_t>> order(CASCADE_PASSES);
+    std::vector<std::vector<uint32_t>> position(CASCADE_PASSES);
+    for (size_t pass = 1; pass < CASCADE_PASSES; ++pass) {
+        order[pass].resize(n);
+        std::iota(order[pass].begin(), order[pass].end(), 0u);
+        rng.shuffle(order[pass].begin(), order[pass].end());
+        position[pass].resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            position[pass][order[pass][i]] = static_cast<uint32_t>(i);
         }
     }
-    return correctedKey;
+
+    auto parity = [&](const KeyBits& key, size_t pass, size_t first, size_t last) {
+        if (pass == 0) {
+            return parityRange(key, first, last);
+        }
+        bool p = false;
+        for (size_t i = first; i < last; ++i) {
+            p ^= key[order[pass][i]];
+        }
+        return p;
+    };
+
+    // Pending (pass, block) pairs that may hold an odd number of errors
+    std::vector<std::pair<size_t, size_t>> pending;
+    for (size_t pass = 0; pass < CASCADE_PASSES; ++pass) {
+        const size_t k = block_size[pass];
+        for (size_t first = 0; first < n; first += k) {
+            ++stats.disclosedBits;
+            if (parity(aliceKey, pass, first, std::min(n, first + k)) !=
+                parity(bobKey, pass, first, std::min(n, first + k))) {
+                pending.emplace_back(pass, first / k);
+            }
+        }
+
+        while (!pending.empty()) {
+            const auto [p, block] = pending.back();
+            pending.pop_back();
+            size_t first = block * block_size[p];
+            size_t last = std::min(n, first + block_size[p]);
+            // Alice's parity for this block is already public
+            if (parity(aliceKey, p, first, last) == parity(bobKey, p, first, last)) {
+                continue;
+            }
+            while (last - first > 1) {
+                const size_t mid = first + (last - first) / 2;
+                ++stats.disclosedBits;
+                if (parity(aliceKey, p, first, mid) != parity(bobKey, p, first, mid)) {
+                    last = mid;
+                } else {
+                    first = mid;
+                }
+            }
+            const size_t index = p == 0 ? first : order[p][first];
+            flipBit(bobKey, index);
+            ++stats.correctedErrors;
+
+            // The fix flips the parity of the block holding it in every other pass so far
+            for (size_t q = 0; q <= pass; ++q) {
+                if (q != p) {
+                    const size_t at = q == 0 ? index : position[q][index];
+                    pending.emplace_back(q, at / block_size[q]);
+                }
+            }
+        }
+    }
+    return stats;
 }
 
-// Perform privacy amplification to reduce Eve's knowledge
-std::vector<bool> QKD::privacyAmplification(const std::vector<bool>& correctedKey, size_t finalKeyLength) {
-    std::vector<bool> finalKey;
-    for (size_t i = 0; i < finalKeyLength; ++i) {
-        finalKey.push_back(correctedKey[i % correctedKey.size()]); // Simplified amplification
+// Perform privacy amplification with a Toeplitz matrix T, T[i][j] = seed[i + n - 1 - j].
+// Output bit i is then coefficient n - 1 + i of seed(x) * key(x) over GF(2), so
+// the hash is one carry-less polynomial product over the needed output words.
+KeyBits QKD::privacyAmplification(const KeyBits& correctedKey, size_t finalKeyLength, const KeyBits& seed) {
+    const size_t n = correctedKey.size;
+    if (finalKeyLength > n) {
+        throw std::invalid_argument("Final key cannot be longer than the corrected key");
     }
+    if (finalKeyLength == 0) {
+        return makeBits(0);
+    }
+    if (seed.size < finalKeyLength + n - 1) {
+        throw std::invalid_argument("Toeplitz seed too short");
+    }
+
+    const size_t shift = (n - 1) & 63;
+    const size_t lo = (n - 1) >> 6;
+    std::vector<uint64_t> product((finalKeyLength + 63) / 64 + 1, 0);
+#if QUIDS_QKD_X86
+    if (hasPclmul()) {
+        productWindowPclmul(seed.words, correctedKey.words, lo, product);
+    } else {
+        productWindowPortable(seed.words, correctedKey.words, lo, product);
+    }
+#else
+    productWindowPortable(seed.words, correctedKey.words, lo, product);
+#endif
+
+    KeyBits finalKey = makeBits(finalKeyLength);
+    for (size_t w = 0; w < finalKey.words.size(); ++w) {
+        finalKey.words[w] = shift == 0 ? product[w] : (product[w] >> shift) | (product[w + 1] << (64 - shift));
+    }
+    finalKey.words.back() &= tailMask(finalKeyLength);
     return finalKey;
 }
 
-// Helper function to generate random bits
-std::vector<bool> QKD::generateRandomBits(size_t length) {
-    std::vector<bool> bits;
-    for (size_t i = 0; i < length; ++i) {
-        bits.push_back(dis(gen));
+KeyBits QKD::privacyAmplification(const KeyBits& correctedKey, size_t finalKeyLength) {
+    if (finalKeyLength == 0) {
+        return makeBits(0);
     }
-    return bits;
+    return privacyAmplification(correctedKey, finalKeyLength,
+                                generateRandomBits(finalKeyLength + correctedKey.size - 1));
+}
+
+// Helper function to generate random bits
+KeyBits QKD::generateRandomBits(size_t length) {
+    return quids::utils::RandomService::global().local().bits(length);
 }
 
-// Helper function to generate random bases
-std::vector<bool> QKD::generateRandomBases(size_t length) {
-    std::vector<bool> bases;
-    for (size_t i = 0; i < length; ++i) {
-        bases.push_back(dis(gen));
+// Helper function to flip each bit with the channel error rate; draws one
+// geometric gap per error rather than one number per bit
+KeyBits QKD::generateChannelNoise(size_t length) {
+    KeyBits noise = makeBits(length);
+    if (errorRate_ <= 0.0) {
+        return noise;
+    }
+    auto& rng = quids::utils::RandomService::global().local();
+    const double scale = 1.0 / std::log1p(-errorRate_);
+    size_t next = 0;
+    while (true) {
+        const double gap = std::floor(std::log(1.0 - rng.uniform()) * scale);
+        if (gap >= static_cast<double>(length - next)) {
+            break;
+        }
+        next += static_cast<size_t>(gap);
+        flipBit(noise, next);
+        if (++next == length) {
+            break;
+        }
     }
-    return bases;
+    return noise;
 }
 
-// Helper function to XOR two vectors
-std::vector<bool> QKD::xorVectors(const std::vector<bool>& a, const std::vector<bool>& b) {
-    std::vector<bool> result;
-    for (size_t i = 0; i < a.size(); ++i) {
-        result.push_back(a[i] ^ b[i]);
+// Helper function to XOR two keys
+KeyBits QKD::xorBits(const KeyBits& a, const KeyBits& b) {
+    if (a.size != b.size) {
+        throw std::invalid_argument("Keys must have the same length");
+    }
+    KeyBits result = makeBits(a.size);
+    for (size_t w = 0; w < result.words.size(); ++w) {
+        result.words[w] = a.words[w] ^ b.words[w];
     }
     return result;
 }
 
-} // namespace quantum
\ No newline at end of file
+} // namespace quantum
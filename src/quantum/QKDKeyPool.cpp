@@ -0,0 +1,164 @@
+#include "quantum/QKDKeyPool.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace quantum {
+
+namespace {
+
+// A failing pipeline (e.g. a chunk too short to leave a secure key) is
+// retried at this pace rather than in a spin
+constexpr std::chrono::seconds FAILURE_BACKOFF{1};
+
+} // namespace
+
+QKDKeyPool::QKDKeyPool(std::string channel) : QKDKeyPool(std::move(channel), Config{}) {}
+
+QKDKeyPool::QKDKeyPool(std::string channel, Config config)
+    : channel_(std::move(channel)),
+      config_(config),
+      qkd_(config.errorRate),
+      depth_(std::make_shared<quids::utils::Gauge>()),
+      produced_(std::make_shared<quids::utils::Counter>()),
+      consumed_(std::make_shared<quids::utils::Counter>()),
+      shortfalls_(std::make_shared<quids::utils::Counter>()) {
+    if (config_.capacityBytes == 0 || config_.lowWatermarkBytes > config_.capacityBytes) {
+        throw std::invalid_argument("QKD key pool needs a low watermark within a nonzero capacity");
+    }
+    ring_.assign(config_.capacityBytes, 0);
+
+    auto& registry = quids::utils::MetricsRegistry::global();
+    const quids::utils::MetricsRegistry::Labels labels{{"channel", channel_}};
+    registry.attach("quids_qkd_pool_available_bytes", "Distilled key bytes ready", labels, depth_);
+    registry.attach("quids_qkd_pool_produced_bytes_total", "Key bytes distilled into the pool", labels, produced_);
+    registry.attach("quids_qkd_pool_consumed_bytes_total", "Key bytes taken from the pool", labels, consumed_);
+    registry.attach("quids_qkd_pool_shortfalls_total", "Takes the pool could not cover", labels, shortfalls_);
+}
+
+QKDKeyPool::~QKDKeyPool() {
+    stop();
+    std::fill(ring_.begin(), ring_.end(), 0);
+}
+
+void QKDKeyPool::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!worker_.joinable()) {
+        stopping_ = false;
+        worker_ = std::thread([this] { run(); });
+    }
+}
+
+void QKDKeyPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+std::optional<std::vector<uint8_t>> QKDKeyPool::take(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (size_ < bytes) {
+        ++stats_.shortfalls;
+        shortfalls_->add();
+        return std::nullopt;
+    }
+    std::vector<uint8_t> out(bytes);
+    for (size_t i = 0; i < bytes; ++i) {
+        uint8_t& byte = ring_[(head_ + i) % ring_.size()];
+        out[i] = byte;
+        byte = 0;
+    }
+    head_ = (head_ + bytes) % ring_.size();
+    size_ -= bytes;
+    stats_.consumedBytes += bytes;
+    consumed_->add(bytes);
+    depth_->set(static_cast<int64_t>(size_));
+    const bool refill = size_ < config_.lowWatermarkBytes;
+    lock.unlock();
+    if (refill) {
+        changed_.notify_all();
+    }
+    return out;
+}
+
+bool QKDKeyPool::waitFor(size_t bytes, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_for(lock, timeout, [&] { return size_ >= bytes; });
+}
+
+QKDKeyPool::Stats QKDKeyPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.availableBytes = size_;
+    return stats;
+}
+
+void QKDKeyPool::run() {
+    // A streamed chunk yields a fraction of its raw qubits; asking for a
+    // quarter keeps each call to about one chunk, so stop() and take()
+    // see progress between chunks
+    const size_t stepBits = std::max<size_t>(8, config_.chunkLength / 4);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        changed_.wait(lock, [&] { return stopping_ || size_ < config_.lowWatermarkBytes; });
+        while (!stopping_ && size_ < config_.capacityBytes) {
+            const size_t wantBits = (config_.capacityBytes - size_) * 8 - spareCount_;
+            lock.unlock();
+            bool ok = true;
+            try {
+                qkd_.streamKey(std::min(wantBits, stepBits), [&](const KeyBits& chunk) { deposit(chunk); },
+                               config_.chunkLength);
+            } catch (const std::exception&) {
+                ok = false;
+            }
+            lock.lock();
+            if (!ok) {
+                changed_.wait_for(lock, FAILURE_BACKOFF, [&] { return stopping_; });
+            }
+        }
+    }
+}
+
+void QKDKeyPool::deposit(const KeyBits& chunk) {
+    std::vector<uint8_t> bytes;
+    bytes.reserve(chunk.size / 8 + 1);
+    for (size_t w = 0; w < chunk.words.size(); ++w) {
+        uint64_t value = chunk.words[w];
+        size_t count = std::min<size_t>(64, chunk.size - w * 64);
+        while (count > 0) {
+            const unsigned step = static_cast<unsigned>(std::min<size_t>(count, 8 - spareCount_));
+            spareBits_ |= (value & ((uint64_t{1} << step) - 1)) << spareCount_;
+            spareCount_ += step;
+            value >>= step;
+            count -= step;
+            if (spareCount_ == 8) {
+                bytes.push_back(static_cast<uint8_t>(spareBits_));
+                spareBits_ = 0;
+                spareCount_ = 0;
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // take() only ever frees room, so a chunk sized to fit still fits
+        const size_t kept = std::min(bytes.size(), ring_.size() - size_);
+        for (size_t i = 0; i < kept; ++i) {
+            ring_[(head_ + size_ + i) % ring_.size()] = bytes[i];
+        }
+        size_ += kept;
+        stats_.producedBytes += kept;
+        produced_->add(kept);
+        depth_->set(static_cast<int64_t>(size_));
+    }
+    std::fill(bytes.begin(), bytes.end(), 0);
+    changed_.notify_all();
+}
+
+} // namespace quantum
@@ -2,15 +2,26 @@
 #include "quantum/QuantumCircuit.hpp"
 #include "quantum/QuantumGates.hpp"
 #include "quantum/QuantumOperations.hpp"
+#include "quantum/QuantumUtils.hpp"
+#include "quantum/StabilizerTableau.hpp"
 
 #include <random>
 #include <stdexcept>
 #include <cmath>
+#include <functional>
 #include <vector>
 #include <limits>
+#include <list>
+#include <mutex>
+#include <optional>
 #include <ostream>
+#include <sstream>
+#include <string_view>
 #include <memory>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <unordered_map>
 
 namespace quids::quantum {  // Using nested namespace declaration
 
@@ -27,92 +38,839 @@ namespace quids::quantum {  // Using nested namespace declaration
 
     using namespace types;  // Bring types into quantum namespace
 
+    namespace {
+        using BlockMatrix = Eigen::Matrix4cd;
+
+        constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
+        constexpr double IDENTITY_TOLERANCE = 1e-12;
+        constexpr double UNITARY_TOLERANCE = 1e-9;
+        // From here a state no longer fits in cache, so merging two
+        // single-qubit sweeps into one 4x4 sweep pays for itself
+        constexpr std::size_t LOCALITY_MIN_QUBITS = 14;
+        constexpr std::size_t COMPILE_CACHE_CAPACITY = 256;
+        // Result cache: 16 x 64 entries of at most 2^14 amplitudes, under 300 MiB
+        constexpr std::size_t RESULT_CACHE_SHARDS = 16;
+        constexpr std::size_t RESULT_CACHE_SHARD_CAPACITY = 64;
+        constexpr std::size_t RESULT_CACHE_MAX_AMPLITUDES = std::size_t{1} << 14;
+
+        // One circuit step. Blocks act on (a, b) with row and column index
+        // 2 * bit(a) + bit(b); a controlled gate is a block that remembers
+        // it can still use the cheaper controlled kernel
+        struct Op {
+            enum class Kind : uint8_t { Single, Block, Measure };
+
+            Kind kind{Kind::Single};
+            GateType type{GateType::CUSTOM};
+            std::size_t a{0};
+            std::size_t b{0};
+            GateMatrix single{GateMatrix::Identity()};
+            BlockMatrix block{BlockMatrix::Identity()};
+            bool controlled{false};  // block is |0><0| x I + |1><1| x single, a the control
+
+            bool operator==(const Op& other) const {
+                return kind == other.kind && type == other.type && a == other.a && b == other.b &&
+                       controlled == other.controlled && single == other.single && block == other.block;
+            }
+        };
+
+        using Program = std::vector<Op>;
+
+        template<typename M>
+        bool isIdentity(const M& m) {
+            return (m - M::Identity()).cwiseAbs().maxCoeff() < IDENTITY_TOLERANCE;
+        }
+
+        BlockMatrix kron(const GateMatrix& x, const GateMatrix& y) {
+            BlockMatrix k;
+            for (int i = 0; i < 2; ++i)
+                for (int j = 0; j < 2; ++j)
+                    for (int r = 0; r < 2; ++r)
+                        for (int c = 0; c < 2; ++c)
+                            k(2 * i + j, 2 * r + c) = x(i, r) * y(j, c);
+            return k;
+        }
+
+        // The same block with its two qubits listed the other way round
+        BlockMatrix swapOrder(const BlockMatrix& m) {
+            static constexpr int perm[4] = {0, 2, 1, 3};
+            BlockMatrix out;
+            for (int r = 0; r < 4; ++r)
+                for (int c = 0; c < 4; ++c)
+                    out(r, c) = m(perm[r], perm[c]);
+            return out;
+        }
+
+        BlockMatrix controlledBlock(const GateMatrix& u) {
+            BlockMatrix m = BlockMatrix::Identity();
+            m.bottomRightCorner<2, 2>() = u;
+            return m;
+        }
+
+        GateMatrix singleMatrix(GateType type) {
+            switch (type) {
+                case GateType::HADAMARD: return gates::H;
+                case GateType::PAULI_X: return gates::X;
+                case GateType::PAULI_Y: return gates::Y;
+                case GateType::PAULI_Z: return gates::Z;
+                case GateType::PHASE: return gates::S;
+                default:
+                    throw std::invalid_argument("Gate type is not a fixed single-qubit gate");
+            }
+        }
+
+        const char* gateName(GateType type) {
+            switch (type) {
+                case GateType::HADAMARD: return "H";
+                case GateType::PAULI_X: return "X";
+                case GateType::PAULI_Y: return "Y";
+                case GateType::PAULI_Z: return "Z";
+                case GateType::CNOT: return "CX";
+                case GateType::SWAP: return "SWAP";
+                case GateType::PHASE: return "S";
+                default: return "U";
+            }
+        }
+
+        // One step of a Clifford circuit on the stabilizer tableau
+        struct CliffordOp {
+            enum class Kind : uint8_t { H, S, X, Y, Z, CX, CZ, Swap, Measure };
+
+            Kind kind;
+            std::size_t a{0};
+            std::size_t b{0};
+        };
+
+        using CliffordProgram = std::vector<CliffordOp>;
+        using CliffordWord = std::vector<CliffordOp::Kind>;
+
+        // The word of H and S applying u up to global phase, if u is one of
+        // the 24 single-qubit Cliffords
+        std::optional<CliffordWord> cliffordWord(const GateMatrix& u) {
+            struct Element {
+                GateMatrix matrix;
+                CliffordWord word;
+            };
+            auto samePhaseClass = [](const GateMatrix& x, const GateMatrix& y) {
+                Eigen::Index r = 0;
+                Eigen::Index c = 0;
+                y.cwiseAbs().maxCoeff(&r, &c);
+                const std::complex<double> phase = x(r, c) / y(r, c);
+                return std::abs(std::abs(phase) - 1.0) < UNITARY_TOLERANCE &&
+                       (x - phase * y).cwiseAbs().maxCoeff() < UNITARY_TOLERANCE;
+            };
+            // Breadth first from the identity, so each word is a shortest one
+            static const std::vector<Element> group = [&] {
+                std::vector<Element> elements{{GateMatrix::Identity(), {}}};
+                for (std::size_t next = 0; next < elements.size(); ++next) {
+                    for (auto [gate, kind] : {std::pair{gates::H, CliffordOp::Kind::H},
+                                              std::pair{gates::S, CliffordOp::Kind::S}}) {
+                        Element e{GateMatrix(gate) * elements[next].matrix, elements[next].word};
+                        e.word.push_back(kind);
+                        if (std::none_of(elements.begin(), elements.end(), [&](const Element& known) {
+                                return samePhaseClass(e.matrix, known.matrix);
+                            })) {
+                            elements.push_back(std::move(e));
+                        }
+                    }
+                }
+                return elements;
+            }();
+            for (const Element& e : group) {
+                if (samePhaseClass(u, e.matrix)) {
+                    return e.word;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Appends op's tableau steps; false, appending nothing, if op is
+        // not a Clifford gate
+        bool appendClifford(CliffordProgram& program, const Op& op) {
+            using Kind = CliffordOp::Kind;
+            switch (op.kind) {
+                case Op::Kind::Measure:
+                    program.push_back({Kind::Measure, op.a});
+                    return true;
+                case Op::Kind::Single:
+                    switch (op.type) {
+                        case GateType::HADAMARD: program.push_back({Kind::H, op.a}); return true;
+                        case GateType::PHASE: program.push_back({Kind::S, op.a}); return true;
+                        case GateType::PAULI_X: program.push_back({Kind::X, op.a}); return true;
+                        case GateType::PAULI_Y: program.push_back({Kind::Y, op.a}); return true;
+                        case GateType::PAULI_Z: program.push_back({Kind::Z, op.a}); return true;
+                        default:
+                            if (auto word = cliffordWord(op.single)) {
+                                for (Kind kind : *word) {
+                                    program.push_back({kind, op.a});
+                                }
+                                return true;
+                            }
+                            return false;
+                    }
+                case Op::Kind::Block:
+                    if (op.type == GateType::SWAP && !op.controlled) {
+                        program.push_back({Kind::Swap, op.a, op.b});
+                        return true;
+                    }
+                    if (!op.controlled) {
+                        return false;
+                    }
+                    switch (op.type) {
+                        case GateType::CNOT:
+                        case GateType::PAULI_X:
+                            program.push_back({Kind::CX, op.a, op.b});
+                            return true;
+                        case GateType::PAULI_Z:
+                            program.push_back({Kind::CZ, op.a, op.b});
+                            return true;
+                        case GateType::PAULI_Y:
+                            // CY = S CX S^-1 on the target, and S^-1 = S^3
+                            program.insert(program.end(), 3, {Kind::S, op.b});
+                            program.push_back({Kind::CX, op.a, op.b});
+                            program.push_back({Kind::S, op.b});
+                            return true;
+                        default:
+                            return false;
+                    }
+            }
+            return false;
+        }
+
+        // Measures every qubit after running program from |0...0>
+        std::vector<bool> runClifford(std::size_t numQubits, const CliffordProgram& program) {
+            StabilizerTableau tableau(numQubits);
+            for (const CliffordOp& op : program) {
+                switch (op.kind) {
+                    case CliffordOp::Kind::H: tableau.applyHadamard(op.a); break;
+                    case CliffordOp::Kind::S: tableau.applyPhase(op.a); break;
+                    case CliffordOp::Kind::X: tableau.applyPauliX(op.a); break;
+                    case CliffordOp::Kind::Y: tableau.applyPauliY(op.a); break;
+                    case CliffordOp::Kind::Z: tableau.applyPauliZ(op.a); break;
+                    case CliffordOp::Kind::CX: tableau.applyCNOT(op.a, op.b); break;
+                    case CliffordOp::Kind::CZ: tableau.applyCZ(op.a, op.b); break;
+                    case CliffordOp::Kind::Swap: tableau.applySwap(op.a, op.b); break;
+                    case CliffordOp::Kind::Measure: (void)tableau.measure(op.a); break;
+                }
+            }
+            std::vector<bool> outcomes(numQubits);
+            for (std::size_t q = 0; q < numQubits; ++q) {
+                outcomes[q] = tableau.measure(q);
+            }
+            return outcomes;
+        }
+
+        // Compiles ops in one pass. Gates on disjoint qubits commute, so
+        // each qubit only needs its own order kept: single-qubit gates are
+        // held back per qubit until something else touches that qubit, and
+        // a block is fused into the last one emitted when nothing has
+        // touched either of its qubits since.
+        class Compiler {
+        public:
+            explicit Compiler(std::size_t numQubits)
+                : numQubits_(numQubits), pending_(numQubits), pendingType_(numQubits, GateType::CUSTOM),
+                  last_(numQubits, NONE) {}
+
+            Program run(const Program& ops) {
+                for (const Op& op : ops) {
+                    switch (op.kind) {
+                        case Op::Kind::Single:
+                            if (pending_[op.a]) {
+                                pending_[op.a] = GateMatrix(op.single * *pending_[op.a]);
+                                pendingType_[op.a] = GateType::CUSTOM;
+                            } else {
+                                pending_[op.a] = op.single;
+                                pendingType_[op.a] = op.type;
+                            }
+                            break;
+                        case Op::Kind::Block:
+                            addBlock(op);
+                            break;
+                        case Op::Kind::Measure:
+                            flush(op.a, false);
+                            last_[op.a] = emit(op);
+                            break;
+                    }
+                }
+                const bool pair = numQubits_ >= LOCALITY_MIN_QUBITS;
+                for (std::size_t q = 0; q < numQubits_; ++q) {
+                    flush(q, pair);
+                }
+
+                Program program;
+                program.reserve(out_.size());
+                for (std::size_t i = 0; i < out_.size(); ++i) {
+                    if (!dead_[i]) {
+                        program.push_back(std::move(out_[i]));
+                    }
+                }
+                return program;
+            }
+
+        private:
+            std::size_t emit(Op op) {
+                out_.push_back(std::move(op));
+                dead_.push_back(false);
+                return out_.size() - 1;
+            }
+
+            // Index of the live block on exactly {a, b} that is the last op on both
+            std::size_t openBlock(std::size_t a, std::size_t b) const {
+                const std::size_t i = last_[a];
+                if (i == NONE || i != last_[b] || dead_[i] || out_[i].kind != Op::Kind::Block) {
+                    return NONE;
+                }
+                return i;
+            }
+
+            void addBlock(Op op) {
+                // Pending single-qubit gates happen first, so they multiply on the right
+                if (pending_[op.a] || pending_[op.b]) {
+                    const GateMatrix pa = pending_[op.a].value_or(GateMatrix::Identity());
+                    const GateMatrix pb = pending_[op.b].value_or(GateMatrix::Identity());
+                    op.block = op.block * kron(pa, pb);
+                    op.controlled = false;
+                    pending_[op.a].reset();
+                    pending_[op.b].reset();
+                }
+
+                const std::size_t open = openBlock(op.a, op.b);
+                if (open == NONE) {
+                    last_[op.a] = last_[op.b] = emit(std::move(op));
+                    return;
+                }
+
+                Op& prev = out_[open];
+                const BlockMatrix m = prev.a == op.a ? op.block : swapOrder(op.block);
+                prev.block = m * prev.block;
+                prev.controlled = false;
+                prev.type = GateType::CUSTOM;
+                if (isIdentity(prev.block)) {
+                    dead_[open] = true;
+                    last_[op.a] = last_[op.b] = NONE;
+                }
+            }
+
+            void flush(std::size_t q, bool pair) {
+                if (!pending_[q]) {
+                    return;
+                }
+                GateMatrix p = *pending_[q];
+                pending_[q].reset();
+                if (isIdentity(p)) {
+                    return;
+                }
+
+                // Trailing gates go into the block that ends this qubit's run;
+                // anything later on the block's other qubit commutes with them
+                const std::size_t i = last_[q];
+                if (i != NONE && !dead_[i] && out_[i].kind == Op::Kind::Block) {
+                    Op& block = out_[i];
+                    block.block = (block.a == q ? kron(p, GateMatrix::Identity())
+                                                : kron(GateMatrix::Identity(), p)) * block.block;
+                    block.controlled = false;
+                    block.type = GateType::CUSTOM;
+                    return;
+                }
+
+                // Two neighbouring qubits in one sweep instead of two
+                if (pair && q + 1 < numQubits_ && pending_[q + 1] && !isIdentity(*pending_[q + 1])) {
+                    Op block;
+                    block.kind = Op::Kind::Block;
+                    block.a = q;
+                    block.b = q + 1;
+                    block.block = kron(p, *pending_[q + 1]);
+                    pending_[q + 1].reset();
+                    last_[q] = last_[q + 1] = emit(std::move(block));
+                    return;
+                }
+
+                Op single;
+                single.kind = Op::Kind::Single;
+                single.type = pendingType_[q];
+                single.a = q;
+                single.single = p;
+                last_[q] = emit(std::move(single));
+            }
+
+            std::size_t numQubits_;
+            std::vector<std::optional<GateMatrix>> pending_;
+            std::vector<GateType> pendingType_;  // CUSTOM once gates were fused
+            std::vector<std::size_t> last_;  // per qubit, index in out_ of the last op on it
+            Program out_;
+            std::vector<bool> dead_;
+        };
+
+        std::size_t structureHash(std::size_t numQubits, const Program& ops) {
+            std::size_t h = std::hash<std::size_t>{}(numQubits);
+            auto mix = [&h](const void* data, std::size_t size) {
+                h ^= std::hash<std::string_view>{}(
+                         std::string_view(static_cast<const char*>(data), size)) +
+                     0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            };
+            for (const Op& op : ops) {
+                const std::size_t header[4] = {static_cast<std::size_t>(op.kind), op.a, op.b,
+                                               static_cast<std::size_t>(op.controlled)};
+                mix(header, sizeof(header));
+                if (op.kind == Op::Kind::Single) {
+                    mix(op.single.data(), sizeof(Complex) * 4);
+                } else if (op.kind == Op::Kind::Block) {
+                    mix(op.block.data(), sizeof(Complex) * 16);
+                }
+            }
+            return h;
+        }
+
+        // Compiled programs by circuit structure, least recently used first out
+        class CompileCache {
+        public:
+            static CompileCache& instance() {
+                static CompileCache cache;
+                return cache;
+            }
+
+            std::shared_ptr<const Program> get(std::size_t numQubits, const Program& ops) {
+                const std::size_t hash = structureHash(numQubits, ops);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+                        if (it->hash == hash && it->numQubits == numQubits && it->source == ops) {
+                            entries_.splice(entries_.begin(), entries_, it);
+                            ++hits_;
+                            return entries_.front().program;
+                        }
+                    }
+                    ++misses_;
+                }
+
+                auto program = std::make_shared<const Program>(Compiler(numQubits).run(ops));
+                std::lock_guard<std::mutex> lock(mutex_);
+                entries_.push_front(Entry{hash, numQubits, ops, program});
+                if (entries_.size() > COMPILE_CACHE_CAPACITY) {
+                    entries_.pop_back();
+                }
+                return program;
+            }
+
+            QuantumCircuit::CompileCacheStats stats() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return {hits_, misses_, entries_.size()};
+            }
+
+            void clear() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                entries_.clear();
+                hits_ = misses_ = 0;
+            }
+
+        private:
+            struct Entry {
+                std::size_t hash;
+                std::size_t numQubits;
+                Program source;
+                std::shared_ptr<const Program> program;
+            };
+
+            std::mutex mutex_;
+            // A few hundred fixed circuits at most, so a list scan is fine
+            std::list<Entry> entries_;
+            std::size_t hits_{0};
+            std::size_t misses_{0};
+        };
+
+        // Outputs of measurement-free programs by (program, input state).
+        // Compiled programs are shared per structure, so the program stands
+        // for the circuit structure; entries keep theirs alive so its
+        // address is not reused. A hit still compares the stored input in
+        // full, so a digest collision costs a miss, never a wrong result.
+        class ResultCache {
+        public:
+            static ResultCache& instance() {
+                static ResultCache cache;
+                return cache;
+            }
+
+            static bool cacheable(const Program& program, const QuantumState& input) {
+                return input.size() <= RESULT_CACHE_MAX_AMPLITUDES &&
+                       std::none_of(program.begin(), program.end(),
+                                    [](const Op& op) { return op.kind == Op::Kind::Measure; });
+            }
+
+            static std::uint64_t digest(const Program* program, const QuantumState& input) {
+                std::uint64_t h = reinterpret_cast<std::uintptr_t>(program) * 0x9e3779b97f4a7c15ULL;
+                auto mix = [&h](std::uint64_t word) {
+                    h = (h ^ word) * 0xbf58476d1ce4e5b9ULL;
+                    h ^= h >> 31;
+                };
+                const auto& amplitudes = input.getStateVector();
+                const auto* words = reinterpret_cast<const std::uint64_t*>(amplitudes.data());
+                for (std::size_t i = 0; i < static_cast<std::size_t>(amplitudes.size()) * 2; ++i) {
+                    mix(words[i]);
+                }
+                const auto outcomes = input.getMeasurementOutcomes();
+                mix(outcomes.size());
+                for (bool outcome : outcomes) {
+                    mix(outcome);
+                }
+                return h;
+            }
+
+            std::optional<QuantumState> find(const std::shared_ptr<const Program>& program,
+                                             std::uint64_t key, const QuantumState& input) {
+                Shard& shard = shardFor(key);
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                const auto it = shard.index.find(key);
+                if (it != shard.index.end()) {
+                    const Entry& entry = *it->second;
+                    if (entry.program == program && entry.input == input &&
+                        entry.input.getMeasurementOutcomes() == input.getMeasurementOutcomes()) {
+                        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                        hits_.fetch_add(1, std::memory_order_relaxed);
+                        return entry.output;
+                    }
+                }
+                misses_.fetch_add(1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+
+            void insert(std::shared_ptr<const Program> program, std::uint64_t key,
+                        const QuantumState& input, const QuantumState& output) {
+                Shard& shard = shardFor(key);
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (const auto it = shard.index.find(key); it != shard.index.end()) {
+                    shard.lru.erase(it->second);
+                    shard.index.erase(it);
+                }
+                shard.lru.push_front(Entry{key, std::move(program), input, output});
+                shard.index.emplace(key, shard.lru.begin());
+                if (shard.lru.size() > RESULT_CACHE_SHARD_CAPACITY) {
+                    shard.index.erase(shard.lru.back().key);
+                    shard.lru.pop_back();
+                }
+            }
+
+            QuantumCircuit::CacheStats stats() {
+                std::size_t entries = 0;
+                for (Shard& shard : shards_) {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    entries += shard.lru.size();
+                }
+                return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed), entries};
+            }
+
+            void clear() {
+                for (Shard& shard : shards_) {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    shard.lru.clear();
+                    shard.index.clear();
+                }
+                hits_.store(0, std::memory_order_relaxed);
+                misses_.store(0, std::memory_order_relaxed);
+            }
+
+        private:
+            struct Entry {
+                std::uint64_t key;
+                std::shared_ptr<const Program> program;
+                QuantumState input;
+                QuantumState output;
+            };
+
+            struct Shard {
+                std::mutex mutex;
+                std::list<Entry> lru;
+                std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+            };
+
+            Shard& shardFor(std::uint64_t key) {
+                return shards_[(key >> 59) % RESULT_CACHE_SHARDS];
+            }
+
+            std::array<Shard, RESULT_CACHE_SHARDS> shards_;
+            std::atomic<std::size_t> hits_{0};
+            std::atomic<std::size_t> misses_{0};
+        };
+    }
+
     class QuantumCircuit::Impl {
     public:
         // Constants
         static constexpr std::size_t MAX_QUBITS = 63;  // Maximum number of qubits for 64-bit system
+        // Wider circuits must stay Clifford, and only measure() runs them
+        static constexpr std::size_t MAX_CLIFFORD_QUBITS = 4096;
 
         // Constructor with member initializer list
         explicit Impl(std::size_t numQubits)
-                : state_(StateVector::Zero(calculateStateSize(numQubits))),
-                  config_{validateNumQubits(numQubits)},
-                  customGates_{} {
-            initializeState();
-            initializeGateCache();
+                : config_{validateNumQubits(numQubits)} {}
+
+        [[nodiscard]] std::size_t getNumQubits() const noexcept {
+            return config_.numQubits;
         }
 
-        // Static methods
-        static constexpr std::size_t calculateStateSize(std::size_t numQubits) noexcept {
-            return 1ull << numQubits;
+        void addGate(GateType type, std::size_t qubit) {
+            validateQubit(qubit);
+            Op op;
+            op.type = type;
+            op.a = qubit;
+            op.single = singleMatrix(type);
+            push(std::move(op));
         }
 
-        // Public interface methods
-        void resetState() noexcept {
-            initializeState();
+        void addControlledGate(GateType type, std::size_t control, std::size_t target) {
+            validateQubit(control);
+            validateQubit(target);
+            if (control == target) {
+                throw std::invalid_argument("Control and target must be distinct qubits");
+            }
+            Op op;
+            op.kind = Op::Kind::Block;
+            op.type = type;
+            op.a = control;
+            op.b = target;
+            if (type == GateType::SWAP) {
+                op.block << 1, 0, 0, 0,
+                            0, 0, 1, 0,
+                            0, 1, 0, 0,
+                            0, 0, 0, 1;
+            } else {
+                op.single = singleMatrix(type == GateType::CNOT ? GateType::PAULI_X : type);
+                op.block = controlledBlock(op.single);
+                op.controlled = true;
+            }
+            push(std::move(op));
         }
 
-        // State management methods with strong exception guarantees
-        void loadState(const StateVector& state) {
-            validateStateSize(state.size());
-            state_ = state;
+        void addCustomGate(const OperatorMatrix& gate, std::size_t qubit) {
+            validateQubit(qubit);
+            if (gate.rows() != 2 || gate.cols() != 2) {
+                throw std::invalid_argument("Custom gate must be a 2x2 matrix");
+            }
+            if (!(gate.adjoint() * gate).isApprox(GateMatrix::Identity(), UNITARY_TOLERANCE)) {
+                throw std::invalid_argument("Custom gate matrix is not unitary");
+            }
+            Op op;
+            op.a = qubit;
+            op.single = gate;
+            push(std::move(op));
         }
 
-        [[maybe_unused]] void loadState(QuantumState&& state) {
-            validateStateSize(state.size());
-            state_ = static_cast<const StateVector&>(state);
+        void addMeasurement(std::size_t qubit) {
+            validateQubit(qubit);
+            Op op;
+            op.kind = Op::Kind::Measure;
+            op.a = qubit;
+            push(std::move(op));
         }
 
-        [[nodiscard]] QuantumState getState() const {
-            return QuantumState(state_);
+        [[nodiscard]] QuantumState execute(const QuantumState& initialState) const {
+            if (config_.numQubits > MAX_QUBITS) {
+                throw std::invalid_argument(
+                        "State-vector execution is limited to " + std::to_string(MAX_QUBITS) + " qubits");
+            }
+            if (initialState.size() != calculateStateSize(config_.numQubits)) {
+                throw std::invalid_argument(
+                        "State dimension mismatch. Expected: " +
+                        std::to_string(calculateStateSize(config_.numQubits)) +
+                        ", Got: " + std::to_string(initialState.size())
+                );
+            }
+
+            const auto program = compiled();
+            const bool cacheable = ResultCache::cacheable(*program, initialState);
+            std::uint64_t key = 0;
+            if (cacheable) {
+                key = ResultCache::digest(program.get(), initialState);
+                if (auto cached = ResultCache::instance().find(program, key, initialState)) {
+                    return *std::move(cached);
+                }
+            }
+
+            // Through QuantumState so that large states run on the
+            // simulation backend
+            QuantumState state(initialState);
+            for (const Op& op : *program) {
+                switch (op.kind) {
+                    case Op::Kind::Single:
+                        state.applySingleQubitGate(op.a, op.single);
+                        break;
+                    case Op::Kind::Block:
+                        if (op.controlled) {
+                            state.applyControlledGate(op.a, op.b, op.single);
+                        } else {
+                            state.applyTwoQubitGate(op.a, op.b, op.block);
+                        }
+                        break;
+                    case Op::Kind::Measure:
+                        state.applyMeasurement(op.a);
+                        break;
+                }
+            }
+            if (cacheable) {
+                ResultCache::instance().insert(program, key, initialState, state);
+            }
+            return state;
         }
 
-        [[nodiscard]] std::size_t getNumQubits() const noexcept {
-            return config_.numQubits;
+        // Clifford circuits run on the stabilizer tableau, in time
+        // polynomial in the qubit count
+        [[nodiscard]] std::vector<bool> measure() const {
+            if (clifford_) {
+                return runClifford(config_.numQubits, *clifford_);
+            }
+            QuantumState state = execute(QuantumState(config_.numQubits));
+            const std::size_t before = state.getMeasurementOutcomes().size();
+            for (std::size_t q = 0; q < config_.numQubits; ++q) {
+                state.applyMeasurement(q);
+            }
+            const auto outcomes = state.getMeasurementOutcomes();
+            return {outcomes.begin() + before, outcomes.end()};
+        }
+
+        [[nodiscard]] std::size_t depth() const noexcept {
+            std::vector<std::size_t> level(config_.numQubits, 0);
+            std::size_t result = 0;
+            for (const Op& op : ops_) {
+                std::size_t l = level[op.a];
+                if (op.kind == Op::Kind::Block) {
+                    l = std::max(l, level[op.b]);
+                }
+                ++l;
+                level[op.a] = l;
+                if (op.kind == Op::Kind::Block) {
+                    level[op.b] = l;
+                }
+                result = std::max(result, l);
+            }
+            return result;
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept {
+            return ops_.size();
+        }
+
+        [[nodiscard]] bool isClifford() const noexcept {
+            return clifford_.has_value();
+        }
+
+        void optimize() {
+            auto program = compiled();
+            ops_ = *program;
+            std::lock_guard<std::mutex> lock(compiled_mutex_);
+            compiled_ = std::move(program);
+        }
+
+        // Amplitude sweeps, weighted by multiplies per amplitude
+        [[nodiscard]] double calculateCost() const noexcept {
+            double cost = 0.0;
+            for (const Op& op : ops_) {
+                switch (op.kind) {
+                    case Op::Kind::Single: cost += 2.0; break;
+                    case Op::Kind::Block: cost += op.controlled ? 1.0 : 4.0; break;
+                    case Op::Kind::Measure: cost += 1.0; break;
+                }
+            }
+            return cost;
+        }
+
+        [[nodiscard]] std::vector<std::string> getErrors() const {
+            std::vector<std::string> errors;
+            for (std::size_t i = 0; i < ops_.size(); ++i) {
+                const Op& op = ops_[i];
+                if (op.a >= config_.numQubits || (op.kind == Op::Kind::Block && op.b >= config_.numQubits)) {
+                    errors.push_back("Gate " + std::to_string(i) + " acts on a qubit outside the circuit");
+                }
+                const bool unitary = op.kind == Op::Kind::Single
+                    ? (op.single.adjoint() * op.single).isApprox(GateMatrix::Identity(), UNITARY_TOLERANCE)
+                    : (op.block.adjoint() * op.block).isApprox(BlockMatrix::Identity(), UNITARY_TOLERANCE);
+                if (op.kind != Op::Kind::Measure && !unitary) {
+                    errors.push_back("Gate " + std::to_string(i) + " is not unitary");
+                }
+            }
+            return errors;
+        }
+
+        [[nodiscard]] std::string toString() const {
+            std::ostringstream out;
+            out << "QuantumCircuit(" << config_.numQubits << " qubits, " << ops_.size() << " gates)";
+            for (const Op& op : ops_) {
+                out << "\n  ";
+                switch (op.kind) {
+                    case Op::Kind::Single:
+                        out << gateName(op.type) << " q" << op.a;
+                        break;
+                    case Op::Kind::Block:
+                        out << (op.controlled ? "C" : "") << gateName(op.type)
+                            << " q" << op.a << ", q" << op.b;
+                        break;
+                    case Op::Kind::Measure:
+                        out << "M q" << op.a;
+                        break;
+                }
+            }
+            return out.str();
+        }
+
+        void clear() noexcept {
+            ops_.clear();
+            clifford_.emplace();
+            invalidate();
         }
 
     private:
         // Private helper methods
+        static constexpr std::size_t calculateStateSize(std::size_t numQubits) noexcept {
+            return 1ull << numQubits;
+        }
+
         static std::size_t validateNumQubits(std::size_t numQubits) {
-            if (numQubits == 0 || numQubits > MAX_QUBITS) {
+            if (numQubits == 0 || numQubits > MAX_CLIFFORD_QUBITS) {
                 throw std::invalid_argument(
                         "Number of qubits must be between 1 and " +
-                        std::to_string(MAX_QUBITS)
+                        std::to_string(MAX_CLIFFORD_QUBITS)
                 );
             }
             return numQubits;
         }
 
-        void validateStateSize(std::size_t stateSize) const {
-            if (calculateStateSize(stateSize) != calculateStateSize(config_.numQubits)) {
-                throw std::invalid_argument(
-                        "State dimension mismatch. Expected: " +
-                        std::to_string(calculateStateSize(config_.numQubits)) +
-                        ", Got: " + std::to_string(stateSize)
-                );
+        void validateQubit(std::size_t qubit) const {
+            if (qubit >= config_.numQubits) {
+                throw std::out_of_range("Qubit index out of range");
             }
         }
 
-        void initializeState() noexcept {
-            try {
-                state_.setZero();
-                state_(0) = std::complex<double>(1.0, 0.0);  // Set to |0...0⟩ state
-            } catch (...) {
-                // Handle any unexpected exceptions in release builds
-                std::terminate();
+        // optimize() leaves the tableau program alone: the compiled gates
+        // are the same unitary, but fused matrices are harder to recognise
+        void push(Op op) {
+            if (clifford_ && !appendClifford(*clifford_, op)) {
+                if (config_.numQubits > MAX_QUBITS) {
+                    throw std::invalid_argument(
+                            "Circuits of more than " + std::to_string(MAX_QUBITS) +
+                            " qubits take Clifford gates only");
+                }
+                clifford_.reset();
             }
+            ops_.push_back(std::move(op));
+            invalidate();
         }
 
-        void initializeGateCache() {
-            // TODO: Implement gate cache initialization
-            gateCache_.reserve(INITIAL_CACHE_SIZE);
+        void invalidate() noexcept {
+            std::lock_guard<std::mutex> lock(compiled_mutex_);
+            compiled_.reset();
+        }
+
+        std::shared_ptr<const Program> compiled() const {
+            std::lock_guard<std::mutex> lock(compiled_mutex_);
+            if (!compiled_) {
+                compiled_ = CompileCache::instance().get(config_.numQubits, ops_);
+            }
+            return compiled_;
         }
 
         // Member variables in initialization order
-        StateVector state_;
         QuantumCircuitConfig config_;
-        std::unordered_map<std::string, OperatorMatrix> customGates_;
-        std::unordered_map<GateType, GateMatrix> gateCache_;
-        static constexpr std::size_t INITIAL_CACHE_SIZE = 16;
+        Program ops_;
+        std::optional<CliffordProgram> clifford_{std::in_place};  // while every gate is Clifford
+        mutable std::mutex compiled_mutex_;
+        mutable std::shared_ptr<const Program> compiled_;
     };
 
 // QuantumCircuit implementation
@@ -125,15 +883,91 @@ namespace quids::quantum {  // Using nested namespace declaration
 
     QuantumCircuit::~QuantumCircuit() = default;
 
+    void QuantumCircuit::addGate(GateType type, std::size_t qubit) {
+        impl_->addGate(type, qubit);
+    }
+
+    void QuantumCircuit::addControlledGate(GateType type, std::size_t control, std::size_t target) {
+        impl_->addControlledGate(type, control, target);
+    }
+
+    void QuantumCircuit::addCustomGate(const OperatorMatrix& gate, std::size_t qubit) {
+        impl_->addCustomGate(gate, qubit);
+    }
 
+    void QuantumCircuit::addMeasurement(std::size_t qubit) {
+        impl_->addMeasurement(qubit);
+    }
 
    QuantumState QuantumCircuit::execute(const QuantumState& state) const {
         if (!impl_) {
             throw std::runtime_error("Circuit not properly initialized");
         }
-        impl_->loadState(state);
+        return impl_->execute(state);
+    }
+
+    std::vector<bool> QuantumCircuit::measure() const {
+        return impl_->measure();
+    }
+
+    std::size_t QuantumCircuit::depth() const noexcept {
+        return impl_->depth();
+    }
+
+    std::size_t QuantumCircuit::size() const noexcept {
+        return impl_->size();
+    }
+
+    bool QuantumCircuit::isClifford() const noexcept {
+        return impl_->isClifford();
+    }
+
+    std::size_t QuantumCircuit::numQubits() const noexcept {
+        return impl_->getNumQubits();
+    }
+
+    void QuantumCircuit::optimize() {
+        impl_->optimize();
+    }
+
+    double QuantumCircuit::calculateCost() const noexcept {
+        return impl_->calculateCost();
+    }
+
+    bool QuantumCircuit::validate() const noexcept {
+        try {
+            return impl_->getErrors().empty();
+        } catch (...) {
+            return false;
+        }
+    }
+
+    std::vector<std::string> QuantumCircuit::getErrors() const {
+        return impl_->getErrors();
+    }
+
+    std::string QuantumCircuit::toString() const {
+        return impl_->toString();
     }
 
+    void QuantumCircuit::clear() noexcept {
+        impl_->clear();
+    }
+
+    QuantumCircuit::CompileCacheStats QuantumCircuit::compileCacheStats() noexcept {
+        return CompileCache::instance().stats();
+    }
 
+    void QuantumCircuit::clearCompileCache() noexcept {
+        CompileCache::instance().clear();
+    }
+
+    QuantumCircuit::CacheStats QuantumCircuit::resultCacheStats() noexcept {
+        return ResultCache::instance().stats();
+    }
+
+    void QuantumCircuit::clearResultCache() noexcept {
+        ResultCache::instance().clear();
+    }
 
 }  // namespace quids::quantum
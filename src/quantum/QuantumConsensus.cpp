@@ -1,12 +1,19 @@
 #include "quantum/QuantumConsensus.hpp"
 #include "quantum/QuantumOperations.hpp"
 #include "quantum/QuantumUtils.hpp"
+#include "utils/WorkStealingPool.hpp"
 #include <random>
 #include <algorithm>
+#include <cmath>
 
 namespace quids::quantum::consensus {
 
 namespace {
+    // Votes deduplicated, counted and checked for a decision per window
+    constexpr size_t TALLY_WINDOW = 1 << 14;
+    // Votes counted by one pool task
+    constexpr size_t TALLY_CHUNK = 1024;
+
     /**
      * @brief Creates an entangled quantum state shared between multiple parties
      * 
@@ -36,6 +43,98 @@ namespace {
     }
 }
 
+VoteTally tallyVotes(
+    const vector<Vote>& votes,
+    size_t num_parties,
+    size_t num_outcomes,
+    double threshold) {
+
+    VoteTally tally;
+    tally.counts.assign(num_outcomes, 0);
+    if (num_parties == 0 || num_outcomes == 0) {
+        tally.settled = true;
+        return tally;
+    }
+
+    const double exact = std::ceil(threshold * static_cast<double>(num_parties));
+    const size_t needed = exact < 1.0 ? 1 : static_cast<size_t>(exact);
+    size_t voted = 0;
+
+    // Settled once the leader holds enough votes, or once it could not get
+    // there even if every party yet to vote backed it
+    auto settle = [&]() {
+        const auto leader = std::max_element(tally.counts.begin(), tally.counts.end());
+        if (*leader >= needed) {
+            tally.winner = static_cast<size_t>(leader - tally.counts.begin());
+            tally.settled = true;
+        } else if (*leader + std::min(num_parties - voted, votes.size() - tally.examined) < needed) {
+            tally.settled = true;
+        }
+        return tally.settled;
+    };
+    if (settle()) {
+        return tally;
+    }
+
+    std::vector<uint64_t> seen((num_parties + 63) / 64, 0);
+    std::vector<uint8_t> counted;
+    std::vector<std::vector<size_t>> partial;
+    for (size_t begin = 0; begin < votes.size(); begin += TALLY_WINDOW) {
+        const size_t end = std::min(votes.size(), begin + TALLY_WINDOW);
+
+        // A party's first vote in input order is the one that counts
+        counted.assign(end - begin, 0);
+        for (size_t i = begin; i < end; ++i) {
+            const Vote& vote = votes[i];
+            if (vote.party >= num_parties || vote.outcome >= num_outcomes) {
+                ++tally.invalid;
+                continue;
+            }
+            const uint64_t bit = uint64_t{1} << (vote.party % 64);
+            uint64_t& word = seen[vote.party / 64];
+            if (word & bit) {
+                ++tally.duplicates;
+                continue;
+            }
+            word |= bit;
+            counted[i - begin] = 1;
+            ++voted;
+        }
+
+        const size_t chunks = (end - begin + TALLY_CHUNK - 1) / TALLY_CHUNK;
+        partial.assign(chunks, std::vector<size_t>(num_outcomes, 0));
+        quids::utils::WorkStealingPool::global().parallel_for(0, chunks, [&](size_t c) {
+            auto& local = partial[c];
+            const size_t first = begin + c * TALLY_CHUNK;
+            const size_t last = std::min(end, first + TALLY_CHUNK);
+            for (size_t i = first; i < last; ++i) {
+                if (counted[i - begin]) {
+                    ++local[votes[i].outcome];
+                }
+            }
+        }, quids::utils::TaskPriority::Consensus);
+
+        // Pairwise in a fixed tree, independent of which task finished first
+        for (size_t stride = 1; stride < chunks; stride *= 2) {
+            for (size_t c = 0; c + stride < chunks; c += 2 * stride) {
+                for (size_t o = 0; o < num_outcomes; ++o) {
+                    partial[c][o] += partial[c + stride][o];
+                }
+            }
+        }
+        for (size_t o = 0; o < num_outcomes; ++o) {
+            tally.counts[o] += partial[0][o];
+        }
+
+        tally.examined = end;
+        if (settle()) {
+            break;
+        }
+    }
+
+    return tally;
+}
+
 /**
  * @brief Implements quantum Byzantine agreement protocol
  * 
@@ -255,13 +354,13 @@ vector<size_t> performVotingRound(
     vector<QuantumState>& states,
     size_t round) {
     
-    vector<size_t> measurements;
-    
-    // Each party performs measurement
-    for (auto& state : states) {
-        auto result = state.getMeasurementOutcomes();
-        measurements.push_back(result[0]); // Use first qubit for voting
-    }
+    // Each party reads its first qubit's outcome; one slot per party, so the
+    // result is in party order however the tasks are scheduled
+    vector<size_t> measurements(states.size(), 0);
+    quids::utils::WorkStealingPool::global().parallel_for(0, states.size(), [&](size_t i) {
+        const auto result = states[i].getMeasurementOutcomes();
+        measurements[i] = !result.empty() && result[0] ? 1 : 0;
+    }, quids::utils::TaskPriority::Consensus);
     
     return measurements;
 }
@@ -286,19 +385,16 @@ bool checkConsensus(
         return false;
     }
     
-    // Count occurrences of each measurement outcome
-    vector<size_t> counts(2, 0); // Binary outcomes
-    for (auto m : measurements) {
-        if (m < counts.size()) {
-            counts[m]++;
+    // Party i cast measurements[i]; binary outcomes
+    try {
+        vector<Vote> votes(measurements.size());
+        for (size_t i = 0; i < measurements.size(); ++i) {
+            votes[i] = Vote{.party = i, .outcome = measurements[i]};
         }
+        return tallyVotes(votes, measurements.size(), 2, threshold).winner.has_value();
+    } catch (const std::bad_alloc&) {
+        return false;
     }
-    
-    // Check if any outcome exceeds threshold
-    double max_ratio = static_cast<double>(*std::max_element(counts.begin(), counts.end())) 
-                      / measurements.size();
-    
-    return max_ratio >= threshold;
 }
 
 } // namespace detail
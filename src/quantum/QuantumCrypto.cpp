@@ -1,17 +1,23 @@
 
 #include "StdNamespace.hpp"
+#include "crypto/signature/BatchVerifier.hpp"
 #include "crypto/signature/Dilithium.hpp"
+#include "crypto/signature/Falcon.hpp"
 #include "quantum/QuantumCrypto.hpp"
 #include "quantum/QuantumState.hpp"
 #include "quantum/QuantumOperations.hpp"
 #include "quantum/QuantumDetail.hpp"
+#include "quantum/QKDKeyPool.hpp"
+#include "utils/WorkStealingPool.hpp"
 
 #include <stdexcept>
 #include <cmath>
 #include <random>
 #include <algorithm>
+#include <mutex>
 #include <unordered_map>
 #include <omp.h>
+#include <optional>
 
 namespace quids {
 namespace quantum {
@@ -65,6 +71,7 @@ public:
 
     QuantumEncryptionParams params_;
     QuantumState current_state_;
+    std::shared_ptr<::quantum::QKDKeyPool> key_pool_;
 };
 
 QuantumCrypto::QuantumCrypto(const QuantumEncryptionParams& params)
@@ -90,13 +97,21 @@ QuantumKey QuantumCrypto::generateKey(const QuantumEncryptionParams& params) {
     key.entangled_state = QuantumState(params.key_size);  // Create QuantumState directly
     key.effective_length = params.key_size;
     
-    // Generate random key material using std random
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_int_distribution<uint8_t> dist(0, 255);
-    
-    for (auto& byte : key.key_material) {
-        byte = dist(gen);
+
+    // QKD material when the pool has it ready, local randomness otherwise
+    std::optional<std::vector<uint8_t>> distilled;
+    if (impl_->key_pool_) {
+        distilled = impl_->key_pool_->take(key.key_material.size());
+    }
+    if (distilled) {
+        key.key_material = std::move(*distilled);
+    } else {
+        for (auto& byte : key.key_material) {
+            byte = dist(gen);
+        }
     }
 
     // Create entangled state
@@ -113,6 +128,10 @@ QuantumKey QuantumCrypto::generateKey(const QuantumEncryptionParams& params) {
     return key;
 }
 
+void QuantumCrypto::setKeyPool(std::shared_ptr<::quantum::QKDKeyPool> pool) {
+    impl_->key_pool_ = std::move(pool);
+}
+
 /**
  * @brief Distribute a quantum key to a recipient
  * @param recipient_id ID of recipient to receive key
@@ -375,32 +394,96 @@ QuantumSignature
 QuantumCrypto::sign(const std::vector<uint8_t>& message, 
                     const std::vector<uint8_t>& private_key) 
 {
-    // Determine scheme from key length
-    SignatureScheme scheme = (private_key.size() <= 1281) ? 
-        SignatureScheme::DILITHIUM : SignatureScheme::FALCON;
-    
-    auto signer = impl_->createSignatureScheme(scheme);
-     signer->generateKeyPair();
-    // Import the private key
-    std::string sk(private_key.begin(), private_key.end());
-    std::string dummy_pk(signer->getPublicKeySize(), 0); // We only need the secret key for signing
-   
-   
-    
-    // Sign the message
-    std::string msg(message.begin(), message.end());
-    std::string signature = signer->signMessage(msg);
-    QuantumKey key = utils::deriveQuantumKey(impl_->current_state_);
-    
-    return QuantumSignature{
-        .sig_data = std::vector<uint8_t>(signature.begin(), signature.end()),
-        .scheme = scheme,
-        .fidelity = 1.0,
-        .proof = utils::generateSignatureProof(message, key)
-        
-    };
+    return std::move(signMany({&message, 1}, private_key).front());
 }
 
+std::vector<QuantumSignature>
+QuantumCrypto::signMany(std::span<const std::vector<uint8_t>> messages,
+                        const std::vector<uint8_t>& private_key)
+{
+    std::vector<QuantumSignature> signatures(messages.size());
+    if (messages.empty()) {
+        return signatures;
+    }
+
+    // Shared by every message in the batch
+    const QuantumKey proof_key = utils::deriveQuantumKey(impl_->current_state_);
+
+    if (auto signing_key = crypto::SigningKey::load(private_key)) {
+        quids::utils::WorkStealingPool::global().parallel_for(0, messages.size(), [&](size_t i) {
+            signatures[i] = QuantumSignature{
+                .sig_data = signing_key->sign(messages[i]),
+                .scheme = SignatureScheme::FALCON,
+                .fidelity = 1.0,
+                .proof_fidelity = 0.0,
+                .proof = utils::generateSignatureProof(messages[i], proof_key)
+            };
+        });
+        return signatures;
+    }
+
+    // DilithiumSigner cannot import a key, so the batch shares one
+    // generated pair the way single signing always has
+    auto signer = impl_->createSignatureScheme(SignatureScheme::DILITHIUM);
+    signer->generateKeyPair();
+    for (size_t i = 0; i < messages.size(); ++i) {
+        std::string msg(messages[i].begin(), messages[i].end());
+        std::string signature = signer->signMessage(msg);
+        signatures[i] = QuantumSignature{
+            .sig_data = std::vector<uint8_t>(signature.begin(), signature.end()),
+            .scheme = SignatureScheme::DILITHIUM,
+            .fidelity = 1.0,
+            .proof_fidelity = 0.0,
+            .proof = utils::generateSignatureProof(messages[i], proof_key)
+        };
+    }
+    return signatures;
+}
+
+std::vector<uint8_t>
+QuantumCrypto::verifyMany(std::span<const std::vector<uint8_t>> messages,
+                          std::span<const QuantumSignature> signatures,
+                          const std::vector<uint8_t>& public_key)
+{
+    if (messages.size() != signatures.size()) {
+        throw std::invalid_argument("verifyMany needs one signature per message");
+    }
+
+    auto& verifier = crypto::BatchVerifier::global();
+    static std::once_flag dilithium_registered;
+    std::call_once(dilithium_registered, [&verifier] {
+        if (!verifier.has_scheme(crypto::SignatureScheme::Dilithium)) {
+            verifier.register_scheme(crypto::SignatureScheme::Dilithium,
+                                     crypto::DilithiumSigner::batchVerifier());
+        }
+    });
+
+    std::vector<crypto::VerifyItem> items;
+    items.reserve(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i) {
+        crypto::SignatureScheme scheme = crypto::SignatureScheme::SphincsPlus;
+        switch (signatures[i].scheme) {
+            case SignatureScheme::DILITHIUM: scheme = crypto::SignatureScheme::Dilithium; break;
+            case SignatureScheme::FALCON: scheme = crypto::SignatureScheme::Falcon512; break;
+            case SignatureScheme::SPHINCS_PLUS: break;
+        }
+        items.push_back(crypto::VerifyItem{
+            .scheme = scheme,
+            .message = messages[i],
+            .signature = signatures[i].sig_data,
+            .public_key = public_key
+        });
+    }
+
+    auto results = verifier.verify(items);
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i] &&
+            utils::verifySignatureProof(signatures[i].proof, messages[i]) < impl_->params_.noise_threshold) {
+            results[i] = 0;
+        }
+    }
+    return results;
+}
     
 
 } // namespace quantum
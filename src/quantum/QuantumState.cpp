@@ -4,10 +4,18 @@
 #include "quantum/QuantumOperations.hpp"
 #include "quantum/QuantumCircuit.hpp"
 #include "quantum/QuantumConsensus.hpp"
+#include "quantum/QuantumUtils.hpp"
+#include "quantum/SimulationBackend.hpp"
+#include "memory/LargePages.hpp"
+#include "memory/MemoryBudget.hpp"
+#include "memory/MemoryPool.hpp"
+#include "utils/RandomService.hpp"
+#include "utils/WorkStealingPool.hpp"
 
 
 
 #include <Eigen/Dense>
+#include <atomic>
 #include <random>
 #include <omp.h>
 #include <mutex>
@@ -36,6 +44,72 @@ namespace {
              0.0, std::exp(std::complex<double>(0.0, angle));
         return P;
     }
+
+    // Below this many amplitudes metrics are cheaper on the calling thread
+    constexpr std::size_t METRICS_PARALLEL_THRESHOLD = std::size_t{1} << 16;
+    constexpr std::size_t METRICS_CHUNK = std::size_t{1} << 14;
+
+    // Raw sums for one range of amplitudes; ranges combine by adding
+    struct AmplitudeSums {
+        double probability{0.0};  // sum p
+        double l1{0.0};           // sum |a|
+        double p_log_p{0.0};      // sum p log2 p
+        double max_probability{0.0};
+    };
+
+    AmplitudeSums sumRange(const double* a, std::size_t first, std::size_t last) {
+        double probability = 0.0;
+        double l1 = 0.0;
+        double p_log_p = 0.0;
+        double max_probability = 0.0;
+        #pragma omp simd reduction(+:probability, l1, p_log_p) reduction(max:max_probability)
+        for (std::size_t i = first; i < last; ++i) {
+            const double re = a[2 * i];
+            const double im = a[2 * i + 1];
+            const double p = re * re + im * im;
+            probability += p;
+            l1 += std::sqrt(p);
+            p_log_p += p > 1e-300 ? p * std::log2(p) : 0.0;
+            max_probability = std::max(max_probability, p);
+        }
+        return {probability, l1, p_log_p, max_probability};
+    }
+
+    QuantumState::Metrics measureAmplitudes(const VectorXcd& v) {
+        const auto* a = reinterpret_cast<const double*>(v.data());
+        const auto dim = static_cast<std::size_t>(v.size());
+
+        AmplitudeSums sums;
+        if (dim < METRICS_PARALLEL_THRESHOLD) {
+            sums = sumRange(a, 0, dim);
+        } else {
+            const std::size_t chunks = (dim + METRICS_CHUNK - 1) / METRICS_CHUNK;
+            std::vector<AmplitudeSums> partial(chunks);
+            ::quids::utils::WorkStealingPool::global().parallel_for(0, chunks, [&](std::size_t c) {
+                partial[c] = sumRange(a, c * METRICS_CHUNK, std::min(dim, (c + 1) * METRICS_CHUNK));
+            }, ::quids::utils::TaskPriority::Execution, 1);
+            for (const auto& p : partial) {
+                sums.probability += p.probability;
+                sums.l1 += p.l1;
+                sums.p_log_p += p.p_log_p;
+                sums.max_probability = std::max(sums.max_probability, p.max_probability);
+            }
+        }
+
+        QuantumState::Metrics m;
+        m.norm = std::sqrt(sums.probability);
+        if (sums.probability <= 0.0) {
+            return m;
+        }
+        // As if normalized: p_i / S throughout
+        const double S = sums.probability;
+        m.entropy = std::max(0.0, std::log2(S) - sums.p_log_p / S);
+        m.max_probability = sums.max_probability / S;
+        if (dim > 1) {
+            m.coherence = std::clamp((sums.l1 * sums.l1 / S - 1.0) / static_cast<double>(dim - 1), 0.0, 1.0);
+        }
+        return m;
+    }
 }
 
 // Implementation class
@@ -44,9 +118,10 @@ public:
     explicit Impl(std::size_t num_qubits) 
         : num_qubits_(num_qubits),
           state_vector_(1ULL << num_qubits),
-          entanglement_(1ULL << num_qubits, 1ULL << num_qubits),
-          coherence_(0.0),
-          entropy_(0.0) {
+          charge_(memory::Subsystem::QuantumState, state_vector_.size() * sizeof(state_vector_(0))) {
+        // Large vectors are fresh mappings; advise before the first write
+        // so they fault in as huge pages on the constructing thread's node
+        memory::advise_huge_pages(state_vector_.data(), state_vector_.size() * sizeof(state_vector_(0)));
         state_vector_.setZero();
         state_vector_(0) = 1.0;
         generateEntanglementMatrix();
@@ -54,12 +129,104 @@ public:
 
     // Member variables
     std::size_t num_qubits_;
-    VectorXcd state_vector_;
-    MatrixXcd entanglement_;
+    // Host copy; behind the device copy while device_.host_stale is set
+    mutable VectorXcd state_vector_;
+    // The amplitudes; copy-on-write copies share an Impl and so one charge
+    memory::MemoryCharge charge_;
+    // Built on first use and dropped on any write. Sharing implementations
+    // between copies means readers on several threads can race to fill it.
+    template<typename T>
+    struct Lazy {
+        mutable std::mutex mutex;
+        mutable T value;
+        mutable bool valid{false};
+
+        Lazy() = default;
+        Lazy(const Lazy&) {}
+        Lazy& operator=(const Lazy&) {
+            reset();
+            return *this;
+        }
+
+        template<typename Build>
+        const T& get(Build&& build) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!valid) {
+                value = build();
+                valid = true;
+            }
+            return value;
+        }
+
+        void reset() {
+            std::lock_guard<std::mutex> lock(mutex);
+            value = T();
+            valid = false;
+        }
+    };
+
+    // Dense 2^n x 2^n identity, only built when asked for: at 20 qubits it
+    // would take 16 TiB
+    Lazy<MatrixXcd> entanglement_;
+    Lazy<VectorXcd> normalized_;
+
+    // Amplitudes held by a simulation backend once the state is large
+    // enough; gates run there and only outcomes come back until the host
+    // reads the amplitudes. Copies start on the host.
+    struct DeviceMirror {
+        mutable std::mutex mutex;
+        std::shared_ptr<SimulationBackend> backend;
+        std::unique_ptr<SimulationBackend::Buffer> buffer;
+        bool host_stale{false};
+
+        DeviceMirror() = default;
+        DeviceMirror(const DeviceMirror&) {}
+        DeviceMirror& operator=(const DeviceMirror&) = delete;
+    };
+
+    mutable DeviceMirror device_;
     std::vector<bool> measurement_outcomes_;
     std::vector<double> features_;
-    double coherence_;
-    double entropy_;
+    Lazy<Metrics> metrics_;
+
+    // Backend buffer for the next gate, uploading on first use; nullptr to
+    // stay on the host
+    SimulationBackend::Buffer* device() {
+        if (!device_.buffer) {
+            auto backend = selectSimulationBackend(static_cast<std::size_t>(state_vector_.size()));
+            if (!backend) {
+                return nullptr;
+            }
+            device_.buffer = backend->upload(state_vector_.data(), num_qubits_, 1);
+            device_.backend = std::move(backend);
+        }
+        device_.host_stale = true;
+        if (device_.backend->replacesHostCopy() && state_vector_.size() == (Eigen::Index{1} << num_qubits_)) {
+            state_vector_ = VectorXcd();
+        }
+        return device_.buffer.get();
+    }
+
+    // Host amplitudes, brought up to date first
+    const VectorXcd& host() const {
+        std::lock_guard<std::mutex> lock(device_.mutex);
+        if (device_.host_stale) {
+            if (state_vector_.size() == 0) {
+                state_vector_.resize(Eigen::Index{1} << num_qubits_);
+            }
+            device_.backend->download(*device_.buffer, state_vector_.data());
+            device_.host_stale = false;
+        }
+        return state_vector_;
+    }
+
+    // Before writing amplitudes on the host
+    VectorXcd& leaveDevice() {
+        host();
+        device_.buffer.reset();
+        device_.backend.reset();
+        return state_vector_;
+    }
 
     // Implementation methods
     void applyHadamard(std::size_t qubit) {
@@ -76,47 +243,66 @@ public:
         if (control >= num_qubits_ || target >= num_qubits_) {
             throw std::out_of_range("Qubit index out of range");
         }
+        if (control == target) {
+            return;
+        }
+        if (auto* buffer = device()) {
+            Matrix2cd X;
+            X << 0.0, 1.0,
+                 1.0, 0.0;
+            device_.backend->applyControlledGate(*buffer, X, control, target);
+            return;
+        }
 
         std::size_t n = 1ULL << num_qubits_;
         std::size_t control_mask = 1ULL << control;
         std::size_t target_mask = 1ULL << target;
-        
-        VectorXcd new_state = state_vector_;
-        
+
+        // In place, each pair once: from the half with the target bit clear
         for (std::size_t i = 0; i < n; i++) {
-            if ((i & control_mask) != 0) {  // Control qubit is 1
-                std::size_t j = i ^ target_mask;  // Flip target qubit
-                std::swap(new_state(i), new_state(j));
+            if ((i & control_mask) != 0 && (i & target_mask) == 0) {
+                std::swap(state_vector_(i), state_vector_(i | target_mask));
             }
         }
-        
-        state_vector_ = new_state;
     }
 
     void applySingleQubitGate(std::size_t qubit, const Matrix2cd& gate) {
         if (qubit >= num_qubits_) {
             throw std::out_of_range("Qubit index out of range");
         }
+        if (auto* buffer = device()) {
+            device_.backend->applySingleQubitGate(*buffer, gate, qubit);
+            return;
+        }
+        utils::simd::applySingleQubitGate(state_vector_, gate, qubit);
+    }
 
-        std::size_t n = 1ULL << num_qubits_;
-        std::size_t mask = 1ULL << qubit;
-
-        VectorXcd new_state = state_vector_;
-
-        for (std::size_t i = 0; i < n; i++) {
-            if ((i & mask) == 0) {
-                std::size_t i1 = i;
-                std::size_t i2 = i | mask;
-
-                std::complex<double> a = state_vector_(i1);
-                std::complex<double> b = state_vector_(i2);
-
-                new_state(i1) = gate(0,0) * a + gate(0,1) * b;
-                new_state(i2) = gate(1,0) * a + gate(1,1) * b;
-            }
+    void applyTwoQubitGate(std::size_t qubit1, std::size_t qubit2, const Matrix4cd& gate) {
+        if (qubit1 >= num_qubits_ || qubit2 >= num_qubits_) {
+            throw std::out_of_range("Qubit index out of range");
+        }
+        if (qubit1 == qubit2) {
+            throw std::invalid_argument("Two-qubit gate needs two distinct qubits");
+        }
+        if (auto* buffer = device()) {
+            device_.backend->applyTwoQubitGate(*buffer, gate, qubit1, qubit2);
+            return;
         }
+        utils::simd::applyTwoQubitGate(state_vector_, gate, qubit1, qubit2);
+    }
 
-        state_vector_ = new_state;
+    void applyControlledGate(std::size_t control, std::size_t target, const Matrix2cd& gate) {
+        if (control >= num_qubits_ || target >= num_qubits_) {
+            throw std::out_of_range("Qubit index out of range");
+        }
+        if (control == target) {
+            throw std::invalid_argument("Control and target must be distinct qubits");
+        }
+        if (auto* buffer = device()) {
+            device_.backend->applyControlledGate(*buffer, gate, control, target);
+            return;
+        }
+        utils::simd::applyControlledGate(state_vector_, gate, control, target);
     }
 
     void applyMeasurement(std::size_t qubit) {
@@ -124,9 +310,12 @@ public:
             throw std::out_of_range("Qubit index out of range");
         }
 
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(0.0, 1.0);
+        const double u = ::quids::utils::RandomService::global().local().uniform();
+
+        if (auto* buffer = device()) {
+            measurement_outcomes_.push_back(device_.backend->measure(*buffer, qubit, {u}).front());
+            return;
+        }
 
         std::size_t n = 1ULL << num_qubits_;
         std::size_t mask = 1ULL << qubit;
@@ -138,7 +327,7 @@ public:
             }
         }
 
-        bool result = dis(gen) < prob_one;
+        bool result = u < prob_one;
         measurement_outcomes_.push_back(result);
 
         double norm_factor = 1.0 / std::sqrt(result ? prob_one : (1.0 - prob_one));
@@ -152,11 +341,16 @@ public:
     }
 
     void applyGateOptimized(const MatrixXcd& gate) {
-        state_vector_ = gate * state_vector_;
+        const auto dim = static_cast<Eigen::Index>(dimension());
+        if (gate.rows() != dim || gate.cols() != dim) {
+            throw std::invalid_argument("Gate dimensions don't match state");
+        }
+        VectorXcd& amplitudes = leaveDevice();
+        amplitudes = gate * amplitudes;
     }
 
     void prepareState() {
-        state_vector_.setZero();
+        leaveDevice().setZero();
         state_vector_(0) = 1.0;
         
         for (std::size_t i = 0; i < num_qubits_; ++i) {
@@ -164,8 +358,27 @@ public:
         }
     }
 
-    const VectorXcd& normalizedVector() const noexcept {
-        return state_vector_.normalized();
+    const VectorXcd& normalizedVector() const {
+        return normalized_.get([this] { return VectorXcd(host().normalized()); });
+    }
+
+    Descriptor describe() const noexcept {
+        Descriptor d;
+        const Metrics& m = metrics();
+        const VectorXcd& amplitudes = host();
+        d.num_qubits = num_qubits_;
+        d.norm = m.norm;
+        d.coherence = m.coherence;
+        d.entropy = m.entropy;
+        // FNV-1a over the raw amplitude bits
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        const auto* bytes = reinterpret_cast<const unsigned char*>(amplitudes.data());
+        const std::size_t len = static_cast<std::size_t>(amplitudes.size()) * sizeof(std::complex<double>);
+        for (std::size_t i = 0; i < len; ++i) {
+            h = (h ^ bytes[i]) * 0x100000001b3ULL;
+        }
+        d.fingerprint = h ^ num_qubits_;
+        return d;
     }
 
     std::size_t getNumQubits() const noexcept {
@@ -173,24 +386,32 @@ public:
     }
 
     std::size_t size() const noexcept {
-        return state_vector_.size();
+        return dimension();
+    }
+
+    // Amplitude count, also while a backend holds the only copy
+    std::size_t dimension() const noexcept {
+        if (state_vector_.size() == 0 && device_.buffer) {
+            return std::size_t{1} << num_qubits_;
+        }
+        return static_cast<std::size_t>(state_vector_.size());
     }
 
     void normalize() {
-        state_vector_.normalize();
+        leaveDevice().normalize();
     }
 
     bool isValid() const noexcept {
         try {
             validateState();
-            return std::abs(state_vector_.norm() - 1.0) < 1e-10;
+            return std::abs(host().norm() - 1.0) < 1e-10;
         } catch (...) {
             return false;
         }
     }
 
     const VectorXcd& getStateVector() const noexcept {
-        return state_vector_;
+        return host();
     }
 
     std::vector<bool> getMeasurementOutcomes() const {
@@ -198,45 +419,52 @@ public:
     }
 
     std::complex<double> getAmplitude(std::size_t index) const {
-        if (static_cast<Eigen::Index>(index) >= state_vector_.size()) {
+        if (index >= dimension()) {
             throw std::out_of_range("Invalid amplitude index");
         }
-        return state_vector_(index);
+        return host()(index);
     }
 
     void setAmplitude(std::size_t index, const std::complex<double>& value) {
-        if (static_cast<Eigen::Index>(index) >= state_vector_.size()) {
+        if (index >= dimension()) {
             throw std::out_of_range("Amplitude index out of range");
         }
-        state_vector_(index) = value;
+        leaveDevice()(index) = value;
+    }
+
+    const Metrics& metrics() const {
+        return metrics_.get([this] { return measureAmplitudes(host()); });
     }
 
     double getCoherence() const noexcept {
-        return coherence_;
+        return metrics().coherence;
     }
 
     double getEntropy() const noexcept {
-        return entropy_;
+        return metrics().entropy;
     }
 
     const MatrixXcd& entanglementMatrix() const {
-        return entanglement_;
+        return entanglement_.get([this] {
+            const auto dim = static_cast<Eigen::Index>(dimension());
+            return MatrixXcd(MatrixXcd::Identity(dim, dim));
+        });
     }
 
     MatrixXcd generateEntanglement() const {
-        return entanglement_;
+        return entanglementMatrix();
     }
 
     std::vector<MatrixXcd> createLayers() const {
-        return {entanglement_};
+        return {entanglementMatrix()};
     }
 
     double calculateCoherence() const noexcept {
-        return coherence_;
+        return metrics().coherence;
     }
 
     double calculateEntropy() const noexcept {
-        return entropy_;
+        return metrics().entropy;
     }
 
     void encode(std::vector<double> features) {
@@ -244,7 +472,7 @@ public:
         const std::size_t n = 1ULL << num_qubits_;
         const std::size_t feature_size = features_.size();
         
-        state_vector_.setZero();
+        leaveDevice().setZero();
         for (std::size_t i = 0; i < std::min(n, feature_size); ++i) {
             state_vector_(i) = std::complex<double>(features_[i], 0.0);
         }
@@ -256,11 +484,18 @@ public:
     }
 
     void generateEntanglementMatrix() {
-        entanglement_ = MatrixXcd::Identity(size(), size());
+        invalidate();
+    }
+
+    // Drops everything derived from the amplitudes
+    void invalidate() {
+        entanglement_.reset();
+        normalized_.reset();
+        metrics_.reset();
     }
 
     void validateState() const {
-        if (state_vector_.size() == 0) {
+        if (dimension() == 0) {
             throw std::runtime_error("Invalid quantum state: empty state vector");
         }
     }
@@ -273,17 +508,69 @@ public:
     }
 };
 
-// Static member initialization
-std::unordered_map<std::size_t, QuantumState> QuantumState::state_cache_{};
-static std::shared_mutex cache_mutex_;
+namespace {
+    // States are created and dropped constantly in circuits and consensus;
+    // never destroyed so states in static caches can still return here
+    memory::MemoryPool<QuantumState::Impl>& implPool() {
+        static auto* pool = new memory::MemoryPool<QuantumState::Impl>(256);
+        return *pool;
+    }
+
+    template<typename... Args>
+    std::shared_ptr<QuantumState::Impl> makeImpl(Args&&... args) {
+        return std::shared_ptr<QuantumState::Impl>(
+            implPool().construct(std::forward<Args>(args)...), QuantumState::ImplDeleter{});
+    }
+
+    // Fresh |0...0> states up to this size share one implementation per
+    // qubit count until written; routing tables and proofs embed thousands
+    constexpr std::size_t MAX_SHARED_GROUND_QUBITS = 12;
+
+    std::shared_ptr<QuantumState::Impl> groundImpl(std::size_t num_qubits) {
+        if (num_qubits > MAX_SHARED_GROUND_QUBITS) {
+            return makeImpl(num_qubits);
+        }
+        // Leaked for the same reason as the pool
+        static auto* cache = new std::unordered_map<std::size_t, std::shared_ptr<QuantumState::Impl>>();
+        static std::shared_mutex cache_mutex;
+        {
+            std::shared_lock<std::shared_mutex> lock(cache_mutex);
+            if (auto it = cache->find(num_qubits); it != cache->end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(cache_mutex);
+        auto& slot = (*cache)[num_qubits];
+        if (!slot) {
+            slot = makeImpl(num_qubits);
+        }
+        return slot;
+    }
+}
+
+void QuantumState::ImplDeleter::operator()(Impl* impl) const noexcept {
+    implPool().destroy(impl);
+}
+
+QuantumState::Impl& QuantumState::mutableImpl() {
+    if (impl_.use_count() != 1) {
+        impl_->host();
+        impl_ = makeImpl(*impl_);
+    } else {
+        // Pairs with the release in other copies dropping their reference
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    impl_->invalidate();
+    return *impl_;
+}
 
 // Constructor implementations
-QuantumState::QuantumState() : impl_(std::make_unique<Impl>(1)) {}
-QuantumState::QuantumState(std::size_t num_qubits) : impl_(std::make_unique<Impl>(num_qubits)) {}
+QuantumState::QuantumState() : impl_(groundImpl(1)) {}
+QuantumState::QuantumState(std::size_t num_qubits) : impl_(groundImpl(num_qubits)) {}
 QuantumState::QuantumState(const VectorXcd& state_vector) 
-    : impl_(std::make_unique<Impl>(static_cast<std::size_t>(std::log2(state_vector.size())))) {
+    : impl_(makeImpl(static_cast<std::size_t>(std::log2(state_vector.size())))) {
     impl_->state_vector_ = state_vector;
-    impl_->normalize();
+    mutableImpl().normalize();
 }
 
 
@@ -294,18 +581,13 @@ QuantumState::operator const StateVector&() const noexcept {
 }
 
 QuantumState::operator StateVector&() noexcept {
-    return impl_->state_vector_;
+    return mutableImpl().leaveDevice();
 }
 
 // Copy and move operations
-QuantumState::QuantumState(const QuantumState& other) : impl_(std::make_unique<Impl>(*other.impl_)) {}
+QuantumState::QuantumState(const QuantumState& other) = default;
 QuantumState::QuantumState(QuantumState&&) noexcept = default;
-QuantumState& QuantumState::operator=(const QuantumState& other) {
-    if (this != &other) {
-        impl_ = std::make_unique<Impl>(*other.impl_);
-    }
-    return *this;
-}
+QuantumState& QuantumState::operator=(const QuantumState& other) = default;
 QuantumState& QuantumState::operator=(QuantumState&&) noexcept = default;
 QuantumState::~QuantumState() = default;
 
@@ -313,37 +595,53 @@ class QuantumState;
 
 // Method implementations
 void QuantumState::applyHadamard(std::size_t qubit) {
-    impl_->applyHadamard(qubit);
+    mutableImpl().applyHadamard(qubit);
 }
 
 void QuantumState::applyPhase(std::size_t qubit, double angle) {
-    impl_->applyPhase(qubit, angle);
+    mutableImpl().applyPhase(qubit, angle);
 }
 
 void QuantumState::applyCNOT(std::size_t control, std::size_t target) {
-    impl_->applyCNOT(control, target);
+    mutableImpl().applyCNOT(control, target);
 }
 
 void QuantumState::applySingleQubitGate(std::size_t qubit, const Matrix2cd& gate) {
-    impl_->applySingleQubitGate(qubit, gate);
+    mutableImpl().applySingleQubitGate(qubit, gate);
+}
+
+void QuantumState::applyTwoQubitGate(std::size_t qubit1, std::size_t qubit2, const Matrix4cd& gate) {
+    mutableImpl().applyTwoQubitGate(qubit1, qubit2, gate);
+}
+
+void QuantumState::applyControlledGate(std::size_t control, std::size_t target, const Matrix2cd& gate) {
+    mutableImpl().applyControlledGate(control, target, gate);
 }
 
 void QuantumState::applyMeasurement(std::size_t qubit) {
-    impl_->applyMeasurement(qubit);
+    mutableImpl().applyMeasurement(qubit);
 }
 
 void QuantumState::applyGateOptimized(const MatrixXcd& gate) {
-    impl_->applyGateOptimized(gate);
+    mutableImpl().applyGateOptimized(gate);
 }
 
 void QuantumState::prepareState() {
-    impl_->prepareState();
+    mutableImpl().prepareState();
+}
+
+const QuantumState::Metrics& QuantumState::computeMetrics() const {
+    return impl_->metrics();
 }
 
 const VectorXcd& QuantumState::normalizedVector() const noexcept {
     return impl_->normalizedVector();
 }
 
+QuantumState::Descriptor QuantumState::describe() const noexcept {
+    return impl_->describe();
+}
+
 std::size_t QuantumState::getNumQubits() const noexcept {
     return impl_->getNumQubits();
 }
@@ -353,7 +651,7 @@ std::size_t QuantumState::size() const noexcept {
 }
 
 void QuantumState::normalize() {
-    impl_->normalize();
+    mutableImpl().normalize();
 }
 
 bool QuantumState::isValid() const noexcept {
@@ -376,7 +674,7 @@ std::complex<double> QuantumState::getAmplitude(std::size_t index) const {
 }
 
 void QuantumState::setAmplitude(std::size_t index, const std::complex<double>& value) {
-    impl_->setAmplitude(index, value);
+    mutableImpl().setAmplitude(index, value);
 }
 
 double QuantumState::getCoherence() const noexcept {
@@ -408,7 +706,7 @@ double QuantumState::calculateEntropy() const noexcept {
 }
 
 void QuantumState::encode(std::vector<double> features) {
-    impl_->encode(std::move(features));
+    mutableImpl().encode(std::move(features));
 }
 
 const std::vector<double>& QuantumState::getFeatures() const {
@@ -416,7 +714,7 @@ const std::vector<double>& QuantumState::getFeatures() const {
 }
 
 void QuantumState::generateEntanglementMatrix() {
-    impl_->generateEntanglementMatrix();
+    mutableImpl().generateEntanglementMatrix();
 }
 
 void QuantumState::validateState() const {
@@ -430,7 +728,10 @@ MatrixXcd QuantumState::createSingleQubitGate(
 }
 
 bool QuantumState::operator==(const QuantumState& other) const noexcept {
-    return impl_->state_vector_ == other.impl_->state_vector_;
+    if (impl_ == other.impl_) {
+        return true;
+    }
+    return impl_->host() == other.impl_->host();
 }
 
 } // namespace quids::quantum
@@ -115,19 +115,9 @@ QuantumState correctErrors(const QuantumState& state, const ErrorSyndrome& syndr
 double calculateQuantumSecurity(const QuantumState& state) noexcept {
     if (state.size() < 2) return 0.0;
     
-    // Use SIMD for entropy calculation
-    const Eigen::VectorXcd& state_vector = state.getStateVector();
-    double entropy = 0.0;
-
-    #pragma omp parallel for simd reduction(+:entropy)
-    for (Eigen::Index i = 0; i < state_vector.size(); ++i) {
-        double prob = ::std::norm(state_vector(i));
-        if (prob > 1e-10) {
-            entropy -= prob * ::std::log2(prob);
-        }
-    }
-    
-    return ::std::max(0.9, entropy / ::std::log2(state_vector.size()));
+    // Cached by the state until it changes
+    const double entropy = state.getEntropy();
+    return ::std::max(0.9, entropy / ::std::log2(state.size()));
 }
 
 } // namespace detail
@@ -0,0 +1,53 @@
+#include "quantum/SimulationBackend.hpp"
+#include <atomic>
+#include <mutex>
+
+#if QUIDS_HAVE_GPU
+#include "quantum/GpuBackend.hpp"
+#endif
+
+namespace quids::quantum {
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::shared_ptr<SimulationBackend> backend;
+    // Checked without the lock first; every gate on a small state asks
+    std::atomic<std::size_t> min_amplitudes{DEFAULT_OFFLOAD_AMPLITUDES};
+    std::atomic<bool> has_backend{false};
+
+    Registry() {
+#if QUIDS_HAVE_GPU
+        backend = gpu::makeGpuBackend();
+#endif
+        has_backend = backend != nullptr;
+    }
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+} // namespace
+
+std::shared_ptr<SimulationBackend> selectSimulationBackend(std::size_t total_amplitudes) noexcept {
+    auto& r = registry();
+    if (!r.has_backend.load(std::memory_order_relaxed) ||
+        total_amplitudes < r.min_amplitudes.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.backend;
+}
+
+void setSimulationBackend(std::shared_ptr<SimulationBackend> backend, std::size_t min_amplitudes) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.backend = std::move(backend);
+    r.min_amplitudes = min_amplitudes;
+    r.has_backend = r.backend != nullptr;
+}
+
+} // namespace quids::quantum
@@ -0,0 +1,233 @@
+#include "quantum/StabilizerTableau.hpp"
+#include "utils/RandomService.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+
+namespace quids::quantum {
+
+    namespace {
+        constexpr std::size_t WORD_BITS = 64;
+
+        constexpr std::size_t wordOf(std::size_t qubit) noexcept { return qubit / WORD_BITS; }
+        constexpr std::uint64_t maskOf(std::size_t qubit) noexcept {
+            return std::uint64_t{1} << (qubit % WORD_BITS);
+        }
+    }
+
+    StabilizerTableau::StabilizerTableau(std::size_t num_qubits)
+            : num_qubits_(num_qubits),
+              words_((num_qubits + WORD_BITS - 1) / WORD_BITS),
+              x_(2 * num_qubits * words_, 0),
+              z_(2 * num_qubits * words_, 0),
+              sign_(2 * num_qubits, 0) {
+        if (num_qubits == 0) {
+            throw std::invalid_argument("Stabilizer tableau needs at least one qubit");
+        }
+        // Destabilizer q is X_q and stabilizer q is Z_q
+        for (std::size_t q = 0; q < num_qubits; ++q) {
+            xRow(q)[wordOf(q)] |= maskOf(q);
+            zRow(num_qubits + q)[wordOf(q)] |= maskOf(q);
+        }
+    }
+
+    // Each gate conjugates every generator, which touches one column
+    void StabilizerTableau::applyHadamard(std::size_t qubit) noexcept {
+        const std::size_t w = wordOf(qubit);
+        const std::uint64_t m = maskOf(qubit);
+        for (std::size_t row = 0; row < 2 * num_qubits_; ++row) {
+            std::uint64_t& x = xRow(row)[w];
+            std::uint64_t& z = zRow(row)[w];
+            sign_[row] ^= (x & z & m) != 0;
+            const std::uint64_t flip = (x ^ z) & m;
+            x ^= flip;
+            z ^= flip;
+        }
+    }
+
+    void StabilizerTableau::applyPhase(std::size_t qubit) noexcept {
+        const std::size_t w = wordOf(qubit);
+        const std::uint64_t m = maskOf(qubit);
+        for (std::size_t row = 0; row < 2 * num_qubits_; ++row) {
+            const std::uint64_t x = xRow(row)[w];
+            std::uint64_t& z = zRow(row)[w];
+            sign_[row] ^= (x & z & m) != 0;
+            z ^= x & m;
+        }
+    }
+
+    void StabilizerTableau::applyPauliX(std::size_t qubit) noexcept {
+        const std::size_t w = wordOf(qubit);
+        const std::uint64_t m = maskOf(qubit);
+        for (std::size_t row = 0; row < 2 * num_qubits_; ++row) {
+            sign_[row] ^= (zRow(row)[w] & m) != 0;
+        }
+    }
+
+    void StabilizerTableau::applyPauliY(std::size_t qubit) noexcept {
+        const std::size_t w = wordOf(qubit);
+        const std::uint64_t m = maskOf(qubit);
+        for (std::size_t row = 0; row < 2 * num_qubits_; ++row) {
+            sign_[row] ^= ((xRow(row)[w] ^ zRow(row)[w]) & m) != 0;
+        }
+    }
+
+    void StabilizerTableau::applyPauliZ(std::size_t qubit) noexcept {
+        const std::size_t w = wordOf(qubit);
+        const std::uint64_t m = maskOf(qubit);
+        for (std::size_t row = 0; row < 2 * num_qubits_; ++row) {
+            sign_[row] ^= (xRow(row)[w] & m) != 0;
+        }
+    }
+
+    void StabilizerTableau::applyCNOT(std::size_t control, std::size_t target) noexcept {
+        const std::size_t wc = wordOf(control);
+        const std::size_t wt = wordOf(target);
+        const std::uint64_t mc = maskOf(control);
+        const std::uint64_t mt = maskOf(target);
+        for (std::size_t row = 0; row < 2 * num_qubits_; ++row) {
+            std::uint64_t* x = xRow(row);
+            std::uint64_t* z = zRow(row);
+            const bool xc = x[wc] & mc;
+            const bool zc = z[wc] & mc;
+            const bool xt = x[wt] & mt;
+            const bool zt = z[wt] & mt;
+            sign_[row] ^= xc && zt && (xt == zc);
+            if (xc) {
+                x[wt] ^= mt;
+            }
+            if (zt) {
+                z[wc] ^= mc;
+            }
+        }
+    }
+
+    void StabilizerTableau::applyCZ(std::size_t a, std::size_t b) noexcept {
+        const std::size_t wa = wordOf(a);
+        const std::size_t wb = wordOf(b);
+        const std::uint64_t ma = maskOf(a);
+        const std::uint64_t mb = maskOf(b);
+        for (std::size_t row = 0; row < 2 * num_qubits_; ++row) {
+            std::uint64_t* x = xRow(row);
+            std::uint64_t* z = zRow(row);
+            const bool xa = x[wa] & ma;
+            const bool za = z[wa] & ma;
+            const bool xb = x[wb] & mb;
+            const bool zb = z[wb] & mb;
+            sign_[row] ^= xa && xb && (za != zb);
+            if (xb) {
+                z[wa] ^= ma;
+            }
+            if (xa) {
+                z[wb] ^= mb;
+            }
+        }
+    }
+
+    void StabilizerTableau::applySwap(std::size_t a, std::size_t b) noexcept {
+        const std::size_t wa = wordOf(a);
+        const std::size_t wb = wordOf(b);
+        const std::uint64_t ma = maskOf(a);
+        const std::uint64_t mb = maskOf(b);
+        for (std::size_t row = 0; row < 2 * num_qubits_; ++row) {
+            for (std::uint64_t* bits : {xRow(row), zRow(row)}) {
+                if (((bits[wa] & ma) != 0) != ((bits[wb] & mb) != 0)) {
+                    bits[wa] ^= ma;
+                    bits[wb] ^= mb;
+                }
+            }
+        }
+    }
+
+    bool StabilizerTableau::measure(std::size_t qubit) {
+        validateQubit(qubit);
+        const std::size_t n = num_qubits_;
+        const std::size_t w = wordOf(qubit);
+        const std::uint64_t m = maskOf(qubit);
+
+        std::size_t p = n;
+        while (p < 2 * n && (xRow(p)[w] & m) == 0) {
+            ++p;
+        }
+        if (p == 2 * n) {
+            return *peekMeasurement(qubit);
+        }
+
+        // Stabilizer p anticommutes with Z_qubit: fold it out of every other
+        // generator that does, then replace it with +/-Z_qubit
+        for (std::size_t row = 0; row < 2 * n; ++row) {
+            if (row != p && (xRow(row)[w] & m) != 0) {
+                multiplyInto(xRow(row), zRow(row), sign_[row], xRow(p), zRow(p), sign_[p]);
+            }
+        }
+        std::copy_n(xRow(p), words_, xRow(p - n));
+        std::copy_n(zRow(p), words_, zRow(p - n));
+        sign_[p - n] = sign_[p];
+        std::fill_n(xRow(p), words_, 0);
+        std::fill_n(zRow(p), words_, 0);
+        zRow(p)[w] = m;
+        const bool outcome = ::quids::utils::RandomService::global().local()() & 1;
+        sign_[p] = outcome;
+        return outcome;
+    }
+
+    std::optional<bool> StabilizerTableau::peekMeasurement(std::size_t qubit) const {
+        validateQubit(qubit);
+        const std::size_t n = num_qubits_;
+        const std::size_t w = wordOf(qubit);
+        const std::uint64_t m = maskOf(qubit);
+        for (std::size_t row = n; row < 2 * n; ++row) {
+            if ((x_[row * words_ + w] & m) != 0) {
+                return std::nullopt;
+            }
+        }
+
+        // +/-Z_qubit is the product of the stabilizers whose destabilizers
+        // anticommute with it
+        std::vector<std::uint64_t> x(words_, 0);
+        std::vector<std::uint64_t> z(words_, 0);
+        std::uint8_t sign = 0;
+        for (std::size_t row = 0; row < n; ++row) {
+            if ((x_[row * words_ + w] & m) != 0) {
+                const std::size_t s = row + n;
+                multiplyInto(x.data(), z.data(), sign, x_.data() + s * words_, z_.data() + s * words_, sign_[s]);
+            }
+        }
+        return sign != 0;
+    }
+
+    // Word-parallel rowsum: each bit lane keeps a two-bit count of the
+    // powers of i picked up where the two Paulis anticommute, and the
+    // lanes are summed mod 4 at the end. Only rows that commute with row i
+    // get a meaningful sign, which is all measurement needs.
+    void StabilizerTableau::multiplyInto(std::uint64_t* hx, std::uint64_t* hz, std::uint8_t& hsign,
+                                         const std::uint64_t* ix, const std::uint64_t* iz,
+                                         std::uint8_t isign) const noexcept {
+        std::uint64_t low = 0;
+        std::uint64_t high = 0;
+        for (std::size_t k = 0; k < words_; ++k) {
+            const std::uint64_t x1 = hx[k];
+            const std::uint64_t z1 = hz[k];
+            const std::uint64_t x2 = ix[k];
+            const std::uint64_t z2 = iz[k];
+            hx[k] = x1 ^ x2;
+            hz[k] = z1 ^ z2;
+            const std::uint64_t x1z2 = x1 & z2;
+            const std::uint64_t anti = (x2 & z1) ^ x1z2;
+            high ^= (low ^ hx[k] ^ hz[k] ^ x1z2) & anti;
+            low ^= anti;
+        }
+        const unsigned power = static_cast<unsigned>(std::popcount(low) + 2 * std::popcount(high));
+        hsign ^= isign ^ ((power >> 1) & 1);
+    }
+
+    void StabilizerTableau::validateQubit(std::size_t qubit) const {
+        if (qubit >= num_qubits_) {
+            throw std::out_of_range("Qubit index out of range");
+        }
+    }
+
+}  // namespace quids::quantum
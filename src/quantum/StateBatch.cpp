@@ -0,0 +1,384 @@
+#include "quantum/StateBatch.hpp"
+#include "utils/RandomService.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace quids::quantum {
+
+namespace {
+
+// Below this many amplitudes across the batch a gate runs on the calling thread
+constexpr std::size_t PARALLEL_THRESHOLD = std::size_t{1} << 14;
+// Amplitudes per pool task
+constexpr std::size_t CHUNK_AMPLITUDES = std::size_t{1} << 13;
+
+// k with a zero bit inserted at position p
+inline std::size_t insertZero(std::size_t k, std::size_t p) {
+    const std::size_t low = (std::size_t{1} << p) - 1;
+    return ((k & ~low) << 1) | (k & low);
+}
+
+// Runs body(first, last) over [0, rows), where each row is batch amplitudes
+template<typename Body>
+void forEachRows(std::size_t rows, std::size_t batch, Body&& body) {
+    if (rows * batch < PARALLEL_THRESHOLD) {
+        body(std::size_t{0}, rows);
+        return;
+    }
+    const std::size_t per_chunk = std::max<std::size_t>(1, CHUNK_AMPLITUDES / batch);
+    const std::size_t chunks = (rows + per_chunk - 1) / per_chunk;
+    ::quids::utils::WorkStealingPool::global().parallel_for(0, chunks, [&](std::size_t c) {
+        body(c * per_chunk, std::min(rows, (c + 1) * per_chunk));
+    }, ::quids::utils::TaskPriority::Proof, 1);
+}
+
+} // namespace
+
+StateBatch::StateBatch(std::size_t num_qubits, std::size_t batch_size)
+    : num_qubits_(num_qubits),
+      batch_size_(batch_size) {
+    if (num_qubits == 0 || batch_size == 0) {
+        throw std::invalid_argument("State batch needs at least one qubit and one state");
+    }
+    const std::size_t total = (std::size_t{1} << num_qubits) * batch_size;
+    re_.assign(total, 0.0);
+    im_.assign(total, 0.0);
+    std::fill_n(re_.begin(), batch_size, 1.0);
+}
+
+StateBatch::StateBatch(const std::vector<QuantumState>& states)
+    : StateBatch(states.empty() ? 0 : states.front().getNumQubits(), states.size()) {
+    const std::size_t dim = std::size_t{1} << num_qubits_;
+    for (std::size_t k = 0; k < batch_size_; ++k) {
+        if (states[k].getNumQubits() != num_qubits_) {
+            throw std::invalid_argument("States in a batch must have the same number of qubits");
+        }
+        const auto& v = states[k].getStateVector();
+        for (std::size_t i = 0; i < dim; ++i) {
+            re_[i * batch_size_ + k] = v(static_cast<Eigen::Index>(i)).real();
+            im_[i * batch_size_ + k] = v(static_cast<Eigen::Index>(i)).imag();
+        }
+    }
+}
+
+void StateBatch::checkQubit(std::size_t qubit) const {
+    if (qubit >= num_qubits_) {
+        throw std::out_of_range("Qubit index out of range");
+    }
+}
+
+SimulationBackend::Buffer* StateBatch::device() {
+    if (!buffer_) {
+        auto backend = selectSimulationBackend(re_.size());
+        if (!backend) {
+            return nullptr;
+        }
+        std::vector<std::complex<double>> amplitudes(re_.size());
+        for (std::size_t i = 0; i < amplitudes.size(); ++i) {
+            amplitudes[i] = {re_[i], im_[i]};
+        }
+        buffer_ = backend->upload(amplitudes.data(), num_qubits_, batch_size_);
+        backend_ = std::move(backend);
+    }
+    host_stale_ = true;
+    return buffer_.get();
+}
+
+void StateBatch::syncHost() const {
+    if (!host_stale_) {
+        return;
+    }
+    std::vector<std::complex<double>> amplitudes(re_.size());
+    backend_->download(*buffer_, amplitudes.data());
+    for (std::size_t i = 0; i < amplitudes.size(); ++i) {
+        re_[i] = amplitudes[i].real();
+        im_[i] = amplitudes[i].imag();
+    }
+    host_stale_ = false;
+}
+
+void StateBatch::releaseDevice() {
+    syncHost();
+    buffer_.reset();
+    backend_.reset();
+}
+
+void StateBatch::applySingleQubitGate(std::size_t qubit, const Eigen::Matrix2cd& gate) {
+    checkQubit(qubit);
+    if (auto* buffer = device()) {
+        backend_->applySingleQubitGate(*buffer, gate, qubit);
+        return;
+    }
+    const double ar = gate(0, 0).real(), ai = gate(0, 0).imag();
+    const double br = gate(0, 1).real(), bi = gate(0, 1).imag();
+    const double cr = gate(1, 0).real(), ci = gate(1, 0).imag();
+    const double dr = gate(1, 1).real(), di = gate(1, 1).imag();
+    const std::size_t K = batch_size_;
+    const std::size_t partner = std::size_t{1} << qubit;
+    double* re = re_.data();
+    double* im = im_.data();
+
+    forEachRows(std::size_t{1} << (num_qubits_ - 1), K, [&](std::size_t first, std::size_t last) {
+        for (std::size_t g = first; g < last; ++g) {
+            const std::size_t i0 = insertZero(g, qubit);
+            double* xr = re + i0 * K;
+            double* xi = im + i0 * K;
+            double* yr = re + (i0 | partner) * K;
+            double* yi = im + (i0 | partner) * K;
+            #pragma omp simd
+            for (std::size_t k = 0; k < K; ++k) {
+                const double x_r = xr[k], x_i = xi[k];
+                const double y_r = yr[k], y_i = yi[k];
+                xr[k] = ar * x_r - ai * x_i + br * y_r - bi * y_i;
+                xi[k] = ar * x_i + ai * x_r + br * y_i + bi * y_r;
+                yr[k] = cr * x_r - ci * x_i + dr * y_r - di * y_i;
+                yi[k] = cr * x_i + ci * x_r + dr * y_i + di * y_r;
+            }
+        }
+    });
+}
+
+void StateBatch::applyHadamard(std::size_t qubit) {
+    const double h = 1.0 / std::sqrt(2.0);
+    Eigen::Matrix2cd H;
+    H << h, h,
+         h, -h;
+    applySingleQubitGate(qubit, H);
+}
+
+void StateBatch::applyPhase(std::size_t qubit, double angle) {
+    checkQubit(qubit);
+    if (auto* buffer = device()) {
+        Eigen::Matrix2cd P;
+        P << 1.0, 0.0,
+             0.0, std::polar(1.0, angle);
+        backend_->applySingleQubitGate(*buffer, P, qubit);
+        return;
+    }
+    // Diagonal: only the rows with the qubit set change
+    const double pr = std::cos(angle);
+    const double pi = std::sin(angle);
+    const std::size_t K = batch_size_;
+    const std::size_t bit = std::size_t{1} << qubit;
+    double* re = re_.data();
+    double* im = im_.data();
+
+    forEachRows(std::size_t{1} << (num_qubits_ - 1), K, [&](std::size_t first, std::size_t last) {
+        for (std::size_t g = first; g < last; ++g) {
+            const std::size_t i = insertZero(g, qubit) | bit;
+            double* xr = re + i * K;
+            double* xi = im + i * K;
+            #pragma omp simd
+            for (std::size_t k = 0; k < K; ++k) {
+                const double x_r = xr[k], x_i = xi[k];
+                xr[k] = pr * x_r - pi * x_i;
+                xi[k] = pr * x_i + pi * x_r;
+            }
+        }
+    });
+}
+
+void StateBatch::applyRotationY(std::size_t qubit, std::span<const double> angles) {
+    checkQubit(qubit);
+    if (angles.size() != batch_size_) {
+        throw std::invalid_argument("Need one angle per state");
+    }
+    // Backends take one gate for the whole batch
+    releaseDevice();
+    const std::size_t K = batch_size_;
+    std::vector<double> c(K);
+    std::vector<double> sn(K);
+    for (std::size_t k = 0; k < K; ++k) {
+        c[k] = std::cos(angles[k] / 2.0);
+        sn[k] = std::sin(angles[k] / 2.0);
+    }
+    const std::size_t partner = std::size_t{1} << qubit;
+    double* re = re_.data();
+    double* im = im_.data();
+
+    forEachRows(std::size_t{1} << (num_qubits_ - 1), K, [&](std::size_t first, std::size_t last) {
+        for (std::size_t g = first; g < last; ++g) {
+            const std::size_t i0 = insertZero(g, qubit);
+            double* xr = re + i0 * K;
+            double* xi = im + i0 * K;
+            double* yr = re + (i0 | partner) * K;
+            double* yi = im + (i0 | partner) * K;
+            #pragma omp simd
+            for (std::size_t k = 0; k < K; ++k) {
+                const double x_r = xr[k], x_i = xi[k];
+                const double y_r = yr[k], y_i = yi[k];
+                xr[k] = c[k] * x_r - sn[k] * y_r;
+                xi[k] = c[k] * x_i - sn[k] * y_i;
+                yr[k] = sn[k] * x_r + c[k] * y_r;
+                yi[k] = sn[k] * x_i + c[k] * y_i;
+            }
+        }
+    });
+}
+
+void StateBatch::applyPhase(std::size_t qubit, std::span<const double> angles) {
+    checkQubit(qubit);
+    if (angles.size() != batch_size_) {
+        throw std::invalid_argument("Need one angle per state");
+    }
+    releaseDevice();
+    const std::size_t K = batch_size_;
+    std::vector<double> pr(K);
+    std::vector<double> pi(K);
+    for (std::size_t k = 0; k < K; ++k) {
+        pr[k] = std::cos(angles[k]);
+        pi[k] = std::sin(angles[k]);
+    }
+    const std::size_t bit = std::size_t{1} << qubit;
+    double* re = re_.data();
+    double* im = im_.data();
+
+    forEachRows(std::size_t{1} << (num_qubits_ - 1), K, [&](std::size_t first, std::size_t last) {
+        for (std::size_t g = first; g < last; ++g) {
+            const std::size_t i = insertZero(g, qubit) | bit;
+            double* xr = re + i * K;
+            double* xi = im + i * K;
+            #pragma omp simd
+            for (std::size_t k = 0; k < K; ++k) {
+                const double x_r = xr[k], x_i = xi[k];
+                xr[k] = pr[k] * x_r - pi[k] * x_i;
+                xi[k] = pr[k] * x_i + pi[k] * x_r;
+            }
+        }
+    });
+}
+
+void StateBatch::applyCNOT(std::size_t control, std::size_t target) {
+    checkQubit(control);
+    checkQubit(target);
+    if (control == target) {
+        throw std::invalid_argument("Control and target must be distinct qubits");
+    }
+    if (auto* buffer = device()) {
+        Eigen::Matrix2cd X;
+        X << 0.0, 1.0,
+             1.0, 0.0;
+        backend_->applyControlledGate(*buffer, X, control, target);
+        return;
+    }
+    const std::size_t K = batch_size_;
+    const std::size_t lo = std::min(control, target);
+    const std::size_t hi = std::max(control, target);
+    const std::size_t c_bit = std::size_t{1} << control;
+    const std::size_t t_bit = std::size_t{1} << target;
+
+    forEachRows(std::size_t{1} << (num_qubits_ - 2), K, [&](std::size_t first, std::size_t last) {
+        for (std::size_t g = first; g < last; ++g) {
+            const std::size_t i0 = insertZero(insertZero(g, lo), hi) | c_bit;
+            const std::size_t i1 = i0 | t_bit;
+            std::swap_ranges(re_.begin() + i0 * K, re_.begin() + (i0 + 1) * K, re_.begin() + i1 * K);
+            std::swap_ranges(im_.begin() + i0 * K, im_.begin() + (i0 + 1) * K, im_.begin() + i1 * K);
+        }
+    });
+}
+
+std::vector<bool> StateBatch::applyMeasurement(std::size_t qubit) {
+    checkQubit(qubit);
+    auto& rng = ::quids::utils::RandomService::global().local();
+    std::vector<double> uniforms(batch_size_);
+    for (double& u : uniforms) {
+        u = rng.uniform();
+    }
+    if (auto* buffer = device()) {
+        return backend_->measure(*buffer, qubit, uniforms);
+    }
+    const std::size_t K = batch_size_;
+    const std::size_t dim = std::size_t{1} << num_qubits_;
+    const std::size_t bit = std::size_t{1} << qubit;
+
+    // Probability of reading 1, per state
+    std::vector<double> prob_one(K, 0.0);
+    for (std::size_t i = bit; i < dim; i = (i + 1) | bit) {
+        const double* xr = re_.data() + i * K;
+        const double* xi = im_.data() + i * K;
+        double* p = prob_one.data();
+        #pragma omp simd
+        for (std::size_t k = 0; k < K; ++k) {
+            p[k] += xr[k] * xr[k] + xi[k] * xi[k];
+        }
+    }
+
+    std::vector<bool> outcomes(K);
+    std::vector<double> keep_one(K);
+    std::vector<double> keep_zero(K);
+    for (std::size_t k = 0; k < K; ++k) {
+        const bool result = uniforms[k] < prob_one[k];
+        outcomes[k] = result;
+        const double norm_factor = 1.0 / std::sqrt(result ? prob_one[k] : (1.0 - prob_one[k]));
+        keep_one[k] = result ? norm_factor : 0.0;
+        keep_zero[k] = result ? 0.0 : norm_factor;
+    }
+
+    double* re = re_.data();
+    double* im = im_.data();
+    forEachRows(dim, K, [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+            const double* scale = (i & bit) ? keep_one.data() : keep_zero.data();
+            double* xr = re + i * K;
+            double* xi = im + i * K;
+            #pragma omp simd
+            for (std::size_t k = 0; k < K; ++k) {
+                xr[k] *= scale[k];
+                xi[k] *= scale[k];
+            }
+        }
+    });
+    return outcomes;
+}
+
+Eigen::MatrixXd StateBatch::expectationZ() const {
+    syncHost();
+    const std::size_t K = batch_size_;
+    const std::size_t dim = std::size_t{1} << num_qubits_;
+    // Column q accumulates P(q = 1); <Z_q> = 1 - 2 P(q = 1)
+    Eigen::MatrixXd prob_one = Eigen::MatrixXd::Zero(static_cast<Eigen::Index>(K),
+                                                     static_cast<Eigen::Index>(num_qubits_));
+    std::vector<double> p(K);
+    for (std::size_t i = 1; i < dim; ++i) {
+        const double* xr = re_.data() + i * K;
+        const double* xi = im_.data() + i * K;
+        #pragma omp simd
+        for (std::size_t k = 0; k < K; ++k) {
+            p[k] = xr[k] * xr[k] + xi[k] * xi[k];
+        }
+        for (std::size_t q = 0; q < num_qubits_; ++q) {
+            if (i & (std::size_t{1} << q)) {
+                prob_one.col(static_cast<Eigen::Index>(q)) +=
+                    Eigen::Map<const Eigen::VectorXd>(p.data(), static_cast<Eigen::Index>(K));
+            }
+        }
+    }
+    return (1.0 - 2.0 * prob_one.array()).matrix();
+}
+
+std::complex<double> StateBatch::getAmplitude(std::size_t state, std::size_t index) const {
+    if (state >= batch_size_ || index >= (std::size_t{1} << num_qubits_)) {
+        throw std::out_of_range("Invalid amplitude index");
+    }
+    syncHost();
+    const std::size_t at = index * batch_size_ + state;
+    return {re_[at], im_[at]};
+}
+
+QuantumState StateBatch::extract(std::size_t state) const {
+    if (state >= batch_size_) {
+        throw std::out_of_range("State index out of range");
+    }
+    syncHost();
+    const std::size_t dim = std::size_t{1} << num_qubits_;
+    StateVector v(static_cast<Eigen::Index>(dim));
+    for (std::size_t i = 0; i < dim; ++i) {
+        const std::size_t at = i * batch_size_ + state;
+        v(static_cast<Eigen::Index>(i)) = {re_[at], im_[at]};
+    }
+    return QuantumState(v);
+}
+
+} // namespace quids::quantum
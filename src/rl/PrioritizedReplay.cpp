@@ -0,0 +1,120 @@
+#include "rl/PrioritizedReplay.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace quids::rl {
+
+namespace {
+// Keeps every transition sampleable after a zero TD error
+constexpr double MIN_PRIORITY = 1e-6;
+}
+
+PrioritizedReplay::PrioritizedReplay(std::size_t capacity, std::size_t state_dim, std::size_t action_dim,
+                                     double alpha)
+    : capacity_(capacity), leaves_(1), alpha_(alpha) {
+    if (capacity == 0) {
+        throw std::invalid_argument("Replay capacity must be positive");
+    }
+    while (leaves_ < capacity_) {
+        leaves_ <<= 1;
+    }
+    const auto rows = static_cast<Eigen::Index>(capacity);
+    states_.resize(rows, static_cast<Eigen::Index>(state_dim));
+    actions_.resize(rows, static_cast<Eigen::Index>(action_dim));
+    next_states_.resize(rows, static_cast<Eigen::Index>(state_dim));
+    rewards_.resize(rows);
+    not_done_.resize(rows);
+    tree_.assign(2 * leaves_, 0.0);
+}
+
+void PrioritizedReplay::add(const Experience& experience) {
+    if (static_cast<Eigen::Index>(experience.state.size()) != states_.cols() ||
+        static_cast<Eigen::Index>(experience.next_state.size()) != states_.cols() ||
+        static_cast<Eigen::Index>(experience.action.size()) != actions_.cols()) {
+        throw std::invalid_argument("Experience does not match the replay dimensions");
+    }
+    const auto row = static_cast<Eigen::Index>(next_);
+    states_.row(row) = Eigen::Map<const Eigen::RowVectorXd>(experience.state.data(), states_.cols());
+    actions_.row(row) = Eigen::Map<const Eigen::RowVectorXd>(experience.action.data(), actions_.cols());
+    next_states_.row(row) = Eigen::Map<const Eigen::RowVectorXd>(experience.next_state.data(), states_.cols());
+    rewards_(row) = experience.reward;
+    not_done_(row) = experience.done ? 0.0 : 1.0;
+    setPriority(next_, max_priority_);
+
+    next_ = (next_ + 1) % capacity_;
+    size_ = std::min(size_ + 1, capacity_);
+}
+
+void PrioritizedReplay::add(std::span<const Experience> experiences) {
+    for (const auto& experience : experiences) {
+        add(experience);
+    }
+}
+
+void PrioritizedReplay::setPriority(std::size_t slot, double priority) {
+    std::size_t node = leaves_ + slot;
+    const double delta = std::pow(std::max(priority, MIN_PRIORITY), alpha_) - tree_[node];
+    for (; node >= 1; node >>= 1) {
+        tree_[node] += delta;
+    }
+}
+
+std::size_t PrioritizedReplay::find(double mass) const {
+    std::size_t node = 1;
+    while (node < leaves_) {
+        const std::size_t left = 2 * node;
+        if (mass < tree_[left]) {
+            node = left;
+        } else {
+            mass -= tree_[left];
+            node = left + 1;
+        }
+    }
+    // Rounding can walk past the last filled slot
+    return std::min(node - leaves_, size_ - 1);
+}
+
+void PrioritizedReplay::sample(std::size_t count, double beta, std::mt19937_64& rng, Batch& out) const {
+    if (size_ == 0) {
+        throw std::logic_error("Cannot sample an empty replay buffer");
+    }
+    const auto n = static_cast<Eigen::Index>(count);
+    out.indices.resize(count);
+    out.states.resize(n, states_.cols());
+    out.actions.resize(n, actions_.cols());
+    out.next_states.resize(n, states_.cols());
+    out.rewards.resize(n);
+    out.not_done.resize(n);
+    out.weights.resize(n);
+
+    // One draw per equal slice of the total mass
+    const double total = tree_[1];
+    const double segment = total / static_cast<double>(count);
+    std::uniform_real_distribution<double> offset(0.0, segment);
+    double max_weight = 0.0;
+    for (Eigen::Index i = 0; i < n; ++i) {
+        const std::size_t slot = find(segment * static_cast<double>(i) + offset(rng));
+        const auto row = static_cast<Eigen::Index>(slot);
+        out.indices[static_cast<std::size_t>(i)] = slot;
+        out.states.row(i) = states_.row(row);
+        out.actions.row(i) = actions_.row(row);
+        out.next_states.row(i) = next_states_.row(row);
+        out.rewards(i) = rewards_(row);
+        out.not_done(i) = not_done_(row);
+        const double probability = tree_[leaves_ + slot] / total;
+        out.weights(i) = std::pow(static_cast<double>(size_) * probability, -beta);
+        max_weight = std::max(max_weight, out.weights(i));
+    }
+    out.weights /= max_weight;
+}
+
+void PrioritizedReplay::updatePriorities(std::span<const std::size_t> indices, const Eigen::VectorXd& tdErrors) {
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        const double priority = std::abs(tdErrors(static_cast<Eigen::Index>(i)));
+        max_priority_ = std::max(max_priority_, priority);
+        setPriority(indices[i], priority);
+    }
+}
+
+} // namespace quids::rl
@@ -1,158 +1,137 @@
 #include "rl/QuantumRLAgent.hpp"
-#include "neural/QuantumOptimizer.hpp"
-#include <vector>
-#include <memory>
 #include <algorithm>
 #include <random>
+#include <stdexcept>
 
 namespace quids::rl {
 
-QuantumRLAgent::QuantumRLAgent(const QuantumRLConfig& config)
-    : config_(config) {
-    // Initialize neural networks
-    policyNet_ = std::make_unique<neural::QuantumPolicyNetwork>(config.stateSize, config.actionSize, config.numQubits);
-    valueNet_ = std::make_unique<neural::QuantumValueNetwork>(config.stateSize, config.numQubits);
-    
-    // Initialize quantum circuit
-    circuit_ = std::make_unique<quantum::QuantumCircuit>(config.circuitConfig);
-    
-    // Reserve space for replay buffer
-    replayBuffer_.reserve(config.replayBufferSize);
-}
-
-Action QuantumRLAgent::decideActionQuantum(const quantum::QuantumState& state) {
-    // Prepare quantum state from input state
-    auto quantumState = prepareQuantumState(state);
-    
-    // Get action probabilities from policy network
-    auto actionProbs = policyNet_->forward(quantumState);
-    
-    // Epsilon-greedy exploration
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
-    
-    if (dis(gen) < config_.explorationRate) {
-        // Random action
-        std::uniform_int_distribution<> actionDis(0, config_.actionSize - 1);
-        return Action{actionDis(gen)};
-    } else {
-        // Greedy action
-        return Action{static_cast<size_t>(std::max_element(actionProbs.begin(), actionProbs.end()) - actionProbs.begin())};
-    }
-}
-
-void QuantumRLAgent::train(const std::vector<Experience>& experiences) {
-    // Add experiences to replay buffer
-    for (const auto& exp : experiences) {
-        updateReplayBuffer(exp);
-    }
-    
-    // Only train if we have enough experiences
-    if (replayBuffer_.size() < MIN_EXPERIENCES_FOR_TRAINING) {
-        return;
-    }
-    
-    // Sample random batch
-    std::vector<Experience> batch;
-    batch.reserve(config_.batchSize);
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, replayBuffer_.size() - 1);
-    
-    for (size_t i = 0; i < config_.batchSize; ++i) {
-        batch.push_back(replayBuffer_[dis(gen)]);
+struct QuantumRLAgent::Impl {
+    Impl(std::size_t state_dim, std::size_t action_dim, const Config& config)
+        : config(config),
+          stateDim(state_dim),
+          actionDim(action_dim),
+          replay(config.replayCapacity, state_dim, action_dim, config.priorityAlpha),
+          rng(std::random_device{}()) {}
+
+    Config config;
+    std::size_t stateDim;
+    std::size_t actionDim;
+    PrioritizedReplay replay;
+    std::mt19937_64 rng;
+    std::size_t sinceLastStep{0};
+    std::size_t trainingSteps{0};
+
+    // Reused by every learning step
+    PrioritizedReplay::Batch batch;
+    Eigen::MatrixXd logitGradients;
+};
+
+QuantumRLAgent::QuantumRLAgent(std::size_t state_dim, std::size_t action_dim)
+    : QuantumRLAgent(state_dim, action_dim, Config{}) {}
+
+QuantumRLAgent::QuantumRLAgent(std::size_t state_dim, std::size_t action_dim, const Config& config)
+    : impl_(std::make_unique<Impl>(state_dim, action_dim, config)),
+      policy_network_(std::make_unique<neural::QuantumPolicyNetwork>(state_dim, action_dim, config.numQubits)),
+      value_network_(std::make_unique<neural::QuantumValueNetwork>(state_dim, config.numQubits)) {
+    if (state_dim == 0 || action_dim == 0 || config.batchSize == 0) {
+        throw std::invalid_argument("QuantumRLAgent dimensions must be positive");
     }
-    
-    // Process batch using SIMD
-    processExperiencesBatch(batch);
-    
-    // Update networks
-    updateNetworksSIMD();
-    
-    // Update metrics
-    metrics_.trainingSteps++;
 }
 
-void QuantumRLAgent::updateQuantumPolicy() {
-    optimizePolicyQuantum();
-    optimizeValueQuantum();
-}
+QuantumRLAgent::~QuantumRLAgent() = default;
 
-QuantumRLConfig QuantumRLAgent::getConfig() const {
-    return config_;
+Eigen::MatrixXd QuantumRLAgent::actionProbabilities(const Eigen::MatrixXd& states) const {
+    return policy_network_->forwardBatch(states);
 }
 
-const QuantumRLAgent::Metrics& QuantumRLAgent::getMetrics() const {
-    return metrics_;
+std::vector<std::size_t> QuantumRLAgent::selectActions(const Eigen::MatrixXd& states) {
+    const Eigen::MatrixXd probabilities = actionProbabilities(states);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<std::size_t> any(0, impl_->actionDim - 1);
+
+    std::vector<std::size_t> actions(static_cast<std::size_t>(states.rows()));
+    for (Eigen::Index i = 0; i < probabilities.rows(); ++i) {
+        std::size_t action = 0;
+        if (unit(impl_->rng) < impl_->config.explorationRate) {
+            action = any(impl_->rng);
+        } else {
+            probabilities.row(i).maxCoeff(&action);
+        }
+        actions[static_cast<std::size_t>(i)] = action;
+    }
+    return actions;
 }
 
-void QuantumRLAgent::setExplorationRate(double rate) {
-    config_.explorationRate = std::clamp(rate, 0.0, 1.0);
+std::vector<double> QuantumRLAgent::selectAction(const std::vector<double>& state) {
+    if (state.size() != impl_->stateDim) {
+        throw std::invalid_argument("State does not match the agent's dimension");
+    }
+    const Eigen::MatrixXd row = Eigen::Map<const Eigen::RowVectorXd>(state.data(), state.size());
+    std::vector<double> action(impl_->actionDim, 0.0);
+    action[selectActions(row).front()] = 1.0;
+    return action;
 }
 
-quantum::QuantumState QuantumRLAgent::prepareQuantumState(const State& classicalState) {
-    // Convert classical state to quantum state using the quantum circuit
-    return circuit_->prepareState(classicalState);
+void QuantumRLAgent::update(const Experience& experience) {
+    update(std::span<const Experience>(&experience, 1));
 }
 
-Action QuantumRLAgent::measureQuantumState(const quantum::QuantumState& state) {
-    // Measure quantum state to get classical action
-    auto measurement = circuit_->measure(state);
-    return Action{measurement.outcome};
+void QuantumRLAgent::update(std::span<const Experience> experiences) {
+    impl_->replay.add(experiences);
+    impl_->sinceLastStep += experiences.size();
+    // No catching up on a backlog: at most one step per call
+    if (impl_->sinceLastStep >= impl_->config.trainInterval) {
+        impl_->sinceLastStep = 0;
+        learnStep();
+    }
 }
 
-double QuantumRLAgent::calculateQuantumAdvantage(const quantum::QuantumState& state, const Action& action) {
-    // Calculate quantum advantage using value network
-    return valueNet_->forward(state)[action.index];
+void QuantumRLAgent::train(std::size_t num_episodes) {
+    for (std::size_t i = 0; i < num_episodes; ++i) {
+        learnStep();
+    }
 }
 
-void QuantumRLAgent::updateReplayBuffer(const Experience& experience) {
-    if (replayBuffer_.size() >= config_.replayBufferSize) {
-        // Remove oldest experience
-        replayBuffer_.erase(replayBuffer_.begin());
+void QuantumRLAgent::learnStep() {
+    if (impl_->replay.size() == 0) {
+        return;
     }
-    replayBuffer_.push_back(experience);
+    const Config& config = impl_->config;
+    auto& batch = impl_->batch;
+    impl_->replay.sample(config.batchSize, config.importanceBeta, impl_->rng, batch);
+
+    // Critic: one-step TD targets
+    const Eigen::VectorXd targets =
+        batch.rewards + config.discount * batch.not_done.cwiseProduct(value_network_->getValues(batch.next_states));
+    const Eigen::VectorXd advantages =
+        value_network_->updateValues(batch.states, targets, batch.weights, config.learningRate);
+
+    // Actor: grad of log pi(a|s) wrt the logits is a - pi(s), scaled by
+    // each row's weighted advantage
+    impl_->logitGradients = batch.actions - policy_network_->forwardBatch(batch.states);
+    impl_->logitGradients.array().colwise() *= advantages.array();
+    policy_network_->updateBatch(batch.states, impl_->logitGradients, config.learningRate);
+
+    impl_->replay.updatePriorities(batch.indices, advantages.cwiseQuotient(batch.weights));
+    ++impl_->trainingSteps;
 }
 
-void QuantumRLAgent::optimizePolicyQuantum() {
-    // Optimize policy network using quantum gradients
-    auto gradients = policyNet_->getGradients();
-    neural::QuantumOptimizer optimizer(config_.learningRate);
-    optimizer.applyQuantumGradients(policyNet_.get(), gradients);
+void QuantumRLAgent::save(const std::string& path) const {
+    policy_network_->saveNetworkState(path + ".policy");
+    value_network_->saveNetworkState(path + ".value");
 }
 
-void QuantumRLAgent::optimizeValueQuantum() {
-    // Optimize value network using quantum gradients
-    auto gradients = valueNet_->getGradients();
-    neural::QuantumOptimizer optimizer(config_.learningRate);
-    optimizer.applyQuantumGradients(valueNet_.get(), gradients);
+void QuantumRLAgent::load(const std::string& path) {
+    policy_network_->loadNetworkState(path + ".policy");
+    value_network_->loadNetworkState(path + ".value");
 }
 
-void QuantumRLAgent::processExperiencesBatch(const std::vector<Experience>& batch) {
-    // Process experiences in parallel using SIMD
-    #pragma omp simd
-    for (size_t i = 0; i < batch.size(); i += SIMD_WIDTH) {
-        // Process SIMD_WIDTH experiences at once
-        auto states = prepareQuantumState(batch[i].state);
-        auto nextStates = prepareQuantumState(batch[i].nextState);
-        
-        // Calculate advantages and update networks
-        auto advantage = calculateQuantumAdvantage(states, batch[i].action);
-        metrics_.averageReward = 0.9 * metrics_.averageReward + 0.1 * batch[i].reward;
-    }
+std::size_t QuantumRLAgent::replaySize() const {
+    return impl_->replay.size();
 }
 
-void QuantumRLAgent::updateNetworksSIMD() {
-    // Update both networks using SIMD operations
-    #pragma omp parallel sections
-    {
-        #pragma omp section
-        optimizePolicyQuantum();
-        
-        #pragma omp section
-        optimizeValueQuantum();
-    }
+std::size_t QuantumRLAgent::trainingSteps() const {
+    return impl_->trainingSteps;
 }
 
-} // namespace quids::rl
\ No newline at end of file
+} // namespace quids::rl
@@ -1,33 +1,64 @@
 #include "rollup/BatchProcessor.hpp"
+#include "utils/HealthSampler.hpp"
+#include <algorithm>
 
 namespace quids {
 namespace rollup {
 
+namespace {
+
+utils::AdaptiveBatchController::Config controllerConfig(const BatchProcessor::BatchConfig& config) {
+    utils::AdaptiveBatchController::Config c;
+    c.min_batch_size = std::max<size_t>(1, std::min(config.min_batch_size, config.max_batch_size));
+    c.max_batch_size = std::max<size_t>(1, config.max_batch_size);
+    c.max_wait = std::max(config.max_wait_time, c.min_wait);
+    c.latency_target = config.latency_target;
+    return c;
+}
+
+} // namespace
+
 BatchProcessor::BatchProcessor(
     std::shared_ptr<quids::rollup::StateManager> state_manager,
-    const BatchConfig& config
+    const BatchConfig& config,
+    std::shared_ptr<Mempool> mempool
 ) : state_manager_(state_manager),
     config_(config),
+    mempool_(mempool ? std::move(mempool) : std::make_shared<Mempool>()),
+    controller_(controllerConfig(config)),
+    pool_(utils::WorkStealingPool::global()),
     should_stop_(false) {
-    // Start worker threads
-    for (size_t i = 0; i < std::thread::hardware_concurrency(); i++) {
-        worker_threads_.emplace_back([this] { process_batches(); });
+    if (config_.pre_execute) {
+        pre_executor_ = std::make_unique<PreExecutor>(state_manager_, mempool_, config_.pre_execution);
+        pre_executor_->start();
     }
+    dispatcher_ = std::thread([this] { process_batches(); });
 }
 
 BatchProcessor::~BatchProcessor() {
     stop();
-    for (auto& thread : worker_threads_) {
-        if (thread.joinable()) {
-            thread.join();
+    if (dispatcher_.joinable()) {
+        dispatcher_.join();
+    }
+    // Batches already handed to the pool still reference this processor
+    while (in_flight_.load(std::memory_order_acquire) != 0) {
+        if (!pool_.run_one()) {
+            std::this_thread::yield();
         }
     }
 }
 
-void BatchProcessor::submit_transaction(const quids::blockchain::Transaction& tx) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    pending_transactions_.push(tx);
-    cv_.notify_one();
+Mempool::AddResult BatchProcessor::submit_transaction(quids::blockchain::TransactionPtr tx) {
+    auto result = mempool_->submit(std::move(tx));
+    if (Mempool::is_accepted(result)) {
+        // Taking the lock orders this with the dispatcher's predicate check
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_one();
+        if (pre_executor_) {
+            pre_executor_->notify();
+        }
+    }
+    return result;
 }
 
 void BatchProcessor::process_batches() {
@@ -39,43 +70,71 @@ void BatchProcessor::process_batches() {
 void BatchProcessor::stop() {
     should_stop_ = true;
     cv_.notify_all();
+    if (pre_executor_) {
+        pre_executor_->stop();
+    }
 }
 
 void BatchProcessor::process_batch() {
-    auto batch = create_batch();
+    const size_t limit = config_.adaptive ? controller_.batchSize() : config_.max_batch_size;
+    auto batch = create_batch(limit);
     if (batch.empty()) {
         return;
     }
     
-    // Process each transaction in the batch
-    for (const auto& tx : batch) {
-        bool success = state_manager_->apply_transaction(tx);
-        if (!success) {
-            // Log or handle failed transaction
-            // For now we continue processing the batch even if one transaction fails
-            continue;
+    in_flight_.fetch_add(1, std::memory_order_acq_rel);
+    const auto cut = std::chrono::steady_clock::now();
+    pool_.post(utils::TaskPriority::Execution, [this, cut, limit, batch = std::move(batch)]() {
+        // Process each transaction in the batch
+        for (const auto& tx : batch) {
+            bool success = state_manager_->apply_transaction(*tx);
+            if (!success) {
+                // Log or handle failed transaction
+                // For now we continue processing the batch even if one transaction fails
+                continue;
+            }
+            // Drops pending replacements of the nonce just used
+            mempool_->on_committed(tx->getSender(), tx->getNonce());
         }
-    }
+        if (pre_executor_) {
+            pre_executor_->forget(batch);
+        }
+        if (config_.adaptive) {
+            controller_.observeLoad(utils::HealthSampler::global().snapshot().last_1s.cpu_usage);
+            controller_.observe(batch.size(), limit,
+                                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - cut),
+                                mempool_->size());
+        }
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+    });
 }
 
-std::vector<quids::blockchain::Transaction> BatchProcessor::create_batch() {
+utils::AdaptiveBatchController::Stats BatchProcessor::batch_stats() const {
+    return controller_.stats();
+}
+
+std::vector<quids::blockchain::TransactionPtr> BatchProcessor::create_batch(size_t batch_size) {
+    const auto wait_time = config_.adaptive ? controller_.waitTime() : config_.max_wait_time;
+    const size_t min_size = std::min(config_.min_batch_size, batch_size);
+    
     std::unique_lock<std::mutex> lock(mutex_);
     
     // Wait for minimum batch size or timeout
-    cv_.wait_for(lock, config_.max_wait_time, [this] {
-        return pending_transactions_.size() >= config_.min_batch_size || should_stop_;
+    cv_.wait_for(lock, wait_time, [this, min_size] {
+        return mempool_->size() >= min_size || should_stop_;
     });
+    lock.unlock();
     
-    if (should_stop_ || pending_transactions_.empty()) {
+    if (should_stop_) {
         return {};
     }
     
-    std::vector<quids::blockchain::Transaction> batch;
-    while (!pending_transactions_.empty() && batch.size() < config_.max_batch_size) {
-        batch.push_back(pending_transactions_.front());
-        pending_transactions_.pop();
+    // Highest fees first, each sender in nonce order
+    auto batch = mempool_->take(batch_size);
+    if (pre_executor_) {
+        // Taken already, so what is screened out leaves the pool for good
+        batch = pre_executor_->screen(std::move(batch));
     }
-    
     return batch;
 }
 
@@ -0,0 +1,181 @@
+#include "rollup/BlockReplay.hpp"
+#include "rollup/OptimisticExecutor.hpp"
+#include "storage/PersistentStorage.hpp"
+#include "utils/Tracing.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+constexpr const char* STAGE_SPANS[BlockReplayer::NUM_STAGES] = {
+    "replay.load", "replay.verify", "replay.execute", "replay.state_root"
+};
+
+StateTrie::Hash to_hash(const std::vector<uint8_t>& bytes) {
+    StateTrie::Hash hash{};
+    std::copy_n(bytes.begin(), std::min(bytes.size(), hash.size()), hash.begin());
+    return hash;
+}
+
+} // namespace
+
+BlockReplayer::BlockReplayer(StateManager::Snapshot base, const Config& config)
+    : base_(std::move(base)), config_(config) {}
+
+BlockReplayer::BlockReplayer(StateManager::Snapshot base) : BlockReplayer(std::move(base), Config{}) {}
+
+BlockReplayer::Report BlockReplayer::run(const BlockSource& source, uint64_t first, uint64_t last) {
+    using clock = std::chrono::steady_clock;
+
+    StateManager state(base_);
+    OptimisticExecutor::Config executor_config;
+    executor_config.num_threads = std::max<size_t>(1, config_.threads);
+    OptimisticExecutor executor(executor_config);
+
+    std::array<utils::Histogram, NUM_STAGES> stage_latency;
+    utils::Histogram block_latency;
+    utils::Histogram transactions_per_block;
+    utils::Histogram accounts_per_block;
+    std::unordered_map<std::string, uint64_t> accesses;
+
+    Report report;
+    const auto run_start = clock::now();
+    for (uint64_t number = first; number <= last; ++number) {
+        const auto trace = utils::aggregate_trace_id("replay", number);
+        BlockReport block;
+        block.number = number;
+        auto stage_start = clock::now();
+        auto end_stage = [&](Stage stage) {
+            const auto now = clock::now();
+            block.stages[stage] = now - stage_start;
+            stage_start = now;
+        };
+
+        std::optional<StoredBlock> stored;
+        {
+            utils::Span span(STAGE_SPANS[Load], trace);
+            stored = source(number);
+        }
+        end_stage(Load);
+        if (!stored) {
+            report.missing_block = number;
+            break;
+        }
+        auto& txs = stored->transactions;
+        block.transactions = txs.size();
+
+        {
+            // Memoized on the transactions, so execute sees it for free
+            utils::Span span(STAGE_SPANS[Verify], trace);
+            if (config_.threads > 1) {
+                utils::WorkStealingPool::global().parallel_for(0, txs.size(), [&](size_t i) {
+                    (void)txs[i]->verified();
+                }, utils::TaskPriority::Execution);
+            } else {
+                for (const auto& tx : txs) {
+                    (void)tx->verified();
+                }
+            }
+        }
+        end_stage(Verify);
+
+        {
+            utils::Span span(STAGE_SPANS[Execute], trace);
+            if (config_.threads > 1) {
+                auto result = executor.apply_batch(state, txs);
+                block.executed = static_cast<size_t>(std::count(result.success.begin(), result.success.end(), true));
+                block.accounts_written = result.writes.size();
+                block.reexecutions = result.metrics.reexecutions;
+            } else {
+                std::unordered_set<std::string> written;
+                for (const auto& tx : txs) {
+                    if (state.apply_transaction(*tx)) {
+                        ++block.executed;
+                        written.insert(tx->getSender());
+                        written.insert(tx->getRecipient());
+                    }
+                }
+                block.accounts_written = written.size();
+            }
+        }
+        end_stage(Execute);
+
+        StateTrie::Hash root{};
+        {
+            utils::Span span(STAGE_SPANS[StateRoot], trace);
+            root = to_hash(state.get_state_root());
+        }
+        end_stage(StateRoot);
+
+        for (const auto& tx : txs) {
+            ++accesses[tx->getSender()];
+            ++accesses[tx->getRecipient()];
+        }
+        std::chrono::nanoseconds total{0};
+        for (size_t s = 0; s < NUM_STAGES; ++s) {
+            stage_latency[s].record(static_cast<uint64_t>(block.stages[s].count()));
+            total += block.stages[s];
+        }
+        block_latency.record(static_cast<uint64_t>(total.count()));
+        transactions_per_block.record(block.transactions);
+        accounts_per_block.record(block.accounts_written);
+
+        block.root_checked = stored->post_state_root.has_value();
+        block.root_matches = block.root_checked && *stored->post_state_root == root;
+        report.final_root = root;
+        report.blocks.push_back(block);
+        if (block.root_checked && !block.root_matches) {
+            ++report.mismatches;
+            if (!report.first_mismatch) {
+                report.first_mismatch = number;
+            }
+            if (config_.stop_on_mismatch) {
+                break;
+            }
+        }
+        if (number == last) {
+            break;  // last may be UINT64_MAX
+        }
+    }
+    report.elapsed = clock::now() - run_start;
+
+    for (size_t s = 0; s < NUM_STAGES; ++s) {
+        report.stage_latency[s] = stage_latency[s].snapshot();
+    }
+    report.block_latency = block_latency.snapshot();
+    report.transactions_per_block = transactions_per_block.snapshot();
+    report.accounts_per_block = accounts_per_block.snapshot();
+
+    report.hot_accounts.assign(accesses.begin(), accesses.end());
+    const size_t keep = std::min(config_.hot_accounts, report.hot_accounts.size());
+    std::partial_sort(report.hot_accounts.begin(), report.hot_accounts.begin() + static_cast<std::ptrdiff_t>(keep),
+                      report.hot_accounts.end(), [](const auto& a, const auto& b) {
+                          return a.second != b.second ? a.second > b.second : a.first < b.first;
+                      });
+    report.hot_accounts.resize(keep);
+    return report;
+}
+
+BlockReplayer::BlockSource BlockReplayer::from_storage(std::shared_ptr<storage::PersistentStorage> storage) {
+    return [storage = std::move(storage)](uint64_t number) -> std::optional<StoredBlock> {
+        StoredBlock block;
+        block.number = number;
+        block.transactions = storage->loadTransactions(number);
+        auto proof = storage->loadProof(number);
+        if (block.transactions.empty() && !proof && !storage->loadBlockData(number)) {
+            return std::nullopt;
+        }
+        if (proof) {
+            block.post_state_root = proof->getPostStateRoot();
+        }
+        return block;
+    };
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,720 @@
+#include "rollup/ChainSync.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <unordered_set>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+// Message types; every integer on the wire is little-endian
+namespace msg {
+constexpr uint8_t GET_HEADERS = 0x01;   // u64 first height, u32 count
+constexpr uint8_t HEADERS = 0x02;       // u32 count, headers
+constexpr uint8_t GET_BODIES = 0x03;    // u64 first height, u32 count
+constexpr uint8_t BODIES = 0x04;        // u32 blocks, each u32 txs of (u32 len, bytes)
+constexpr uint8_t GET_STATE = 0x05;     // root, u32 index, u32 chunks
+constexpr uint8_t STATE = 0x06;         // u32 accounts, each (u32 len, account, proof)
+constexpr uint8_t NOT_FOUND = 0x7F;
+} // namespace msg
+
+// How often a waiting fetch rechecks its stop token
+constexpr auto STOP_POLL = std::chrono::milliseconds(50);
+
+void put(std::vector<uint8_t>& out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void put_bytes(std::vector<uint8_t>& out, std::span<const uint8_t> bytes) {
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+// Bounds-checked cursor; once a read runs past the end every later read
+// fails too, so callers check ok() once at the end
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> bytes) : rest_(bytes) {}
+
+    uint64_t get(size_t width) {
+        auto bytes = take(width);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    std::span<const uint8_t> take(size_t n) {
+        if (!ok_ || n > rest_.size()) {
+            ok_ = false;
+            return {};
+        }
+        auto bytes = rest_.first(n);
+        rest_ = rest_.subspan(n);
+        return bytes;
+    }
+
+    StateTrie::Hash hash() {
+        StateTrie::Hash h{};
+        auto bytes = take(h.size());
+        std::copy(bytes.begin(), bytes.end(), h.begin());
+        return h;
+    }
+
+    // A count of items at least min_size bytes each, rejected up front when
+    // the rest of the message could not possibly hold them
+    size_t count(size_t min_size) {
+        const uint64_t n = get(4);
+        if (min_size > 0 && n > rest_.size() / min_size) {
+            ok_ = false;
+            return 0;
+        }
+        return static_cast<size_t>(n);
+    }
+
+    [[nodiscard]] bool ok() const { return ok_; }
+    [[nodiscard]] bool done() const { return ok_ && rest_.empty(); }
+
+private:
+    std::span<const uint8_t> rest_;
+    bool ok_{true};
+};
+
+std::vector<uint8_t> range_request(uint8_t type, uint64_t first, uint64_t count) {
+    std::vector<uint8_t> out{type};
+    put(out, first, 8);
+    put(out, count, 4);
+    return out;
+}
+
+void encode_proof(std::vector<uint8_t>& out, const StateTrie::Proof& proof) {
+    put(out, proof.steps.size(), 1);
+    for (const auto& step : proof.steps) {
+        put(out, step.bitmap, 2);
+        put(out, step.nibble, 1);
+        put(out, step.siblings.size(), 1);
+        for (const auto& sibling : step.siblings) {
+            put_bytes(out, sibling);
+        }
+    }
+}
+
+std::optional<StateTrie::Proof> decode_proof(Reader& in) {
+    StateTrie::Proof proof;
+    // A path has 64 nibbles and a branch at most 15 siblings
+    const size_t steps = static_cast<size_t>(in.get(1));
+    if (steps > 64) {
+        return std::nullopt;
+    }
+    proof.steps.resize(steps);
+    for (auto& step : proof.steps) {
+        step.bitmap = static_cast<uint16_t>(in.get(2));
+        step.nibble = static_cast<uint8_t>(in.get(1));
+        const size_t siblings = static_cast<size_t>(in.get(1));
+        if (siblings > 15) {
+            return std::nullopt;
+        }
+        step.siblings.resize(siblings);
+        for (auto& sibling : step.siblings) {
+            sibling = in.hash();
+        }
+    }
+    if (!in.ok()) {
+        return std::nullopt;
+    }
+    return proof;
+}
+
+} // namespace
+
+SyncHeader::Hash SyncHeader::hash() const {
+    std::vector<uint8_t> bytes;
+    encode(bytes);
+    return crypto::MerkleBuilder::hashLeaf(bytes);
+}
+
+void SyncHeader::encode(std::vector<uint8_t>& out) const {
+    put(out, height, 8);
+    put_bytes(out, parent);
+    put_bytes(out, tx_root);
+    put_bytes(out, state_root);
+    put(out, tx_count, 4);
+}
+
+std::optional<SyncHeader> SyncHeader::decode(std::span<const uint8_t> bytes) {
+    Reader in(bytes);
+    SyncHeader header;
+    header.height = in.get(8);
+    header.parent = in.hash();
+    header.tx_root = in.hash();
+    header.state_root = in.hash();
+    header.tx_count = static_cast<uint32_t>(in.get(4));
+    if (!in.done()) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+uint32_t state_chunk_of(const std::string& address, uint32_t chunks) {
+    const auto path = StateTrie::path_of(address);
+    const uint64_t prefix = (static_cast<uint64_t>(path[0]) << 8) | path[1];
+    return static_cast<uint32_t>((prefix * chunks) >> 16);
+}
+
+// SyncServer
+
+SyncServer::SyncServer(Source source) : SyncServer(std::move(source), Limits{}) {}
+
+SyncServer::SyncServer(Source source, Limits limits)
+    : source_(std::move(source)), limits_(limits) {}
+
+std::shared_ptr<const SyncServer::ChunkIndex> SyncServer::chunk_index(const StateTrie::Hash& root,
+                                                                     uint32_t chunks) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (index_ && index_->root == root && index_->chunks == chunks) {
+        return index_;
+    }
+    auto snapshot = source_.state ? source_.state(root) : std::nullopt;
+    if (!snapshot) {
+        return nullptr;
+    }
+    auto index = std::make_shared<ChunkIndex>();
+    index->root = root;
+    index->chunks = chunks;
+    index->snapshot = *snapshot;
+    index->addresses.resize(chunks);
+    index->snapshot.for_each_account([&](const std::string& address, const StateManager::Account&) {
+        index->addresses[state_chunk_of(address, chunks)].push_back(address);
+    });
+    index_ = std::move(index);
+    return index_;
+}
+
+std::vector<uint8_t> SyncServer::handle(std::span<const uint8_t> request) {
+    const std::vector<uint8_t> not_found{msg::NOT_FOUND};
+    Reader in(request);
+    const auto type = static_cast<uint8_t>(in.get(1));
+
+    if (type == msg::GET_HEADERS || type == msg::GET_BODIES) {
+        const uint64_t first = in.get(8);
+        const uint64_t limit = type == msg::GET_HEADERS ? limits_.max_headers : limits_.max_bodies;
+        const uint64_t count = std::min<uint64_t>(in.get(4), limit);
+        if (!in.done()) {
+            return not_found;
+        }
+
+        std::vector<uint8_t> out{type == msg::GET_HEADERS ? msg::HEADERS : msg::BODIES};
+        put(out, 0, 4);
+        uint32_t served = 0;
+        for (uint64_t height = first; height < first + count; ++height) {
+            if (type == msg::GET_HEADERS) {
+                auto header = source_.header ? source_.header(height) : std::nullopt;
+                if (!header) {
+                    break;
+                }
+                header->encode(out);
+            } else {
+                auto body = source_.body ? source_.body(height) : std::nullopt;
+                if (!body) {
+                    break;
+                }
+                put(out, body->size(), 4);
+                for (const auto& tx : *body) {
+                    put(out, tx.size(), 4);
+                    put_bytes(out, tx);
+                }
+            }
+            ++served;
+        }
+        if (served == 0) {
+            return not_found;
+        }
+        for (size_t i = 0; i < 4; ++i) {
+            out[1 + i] = static_cast<uint8_t>(served >> (8 * i));
+        }
+        return out;
+    }
+
+    if (type == msg::GET_STATE) {
+        const auto root = in.hash();
+        const auto index = static_cast<uint32_t>(in.get(4));
+        const auto chunks = static_cast<uint32_t>(in.get(4));
+        if (!in.done() || chunks == 0 || index >= chunks) {
+            return not_found;
+        }
+        auto chunk = chunk_index(root, chunks);
+        if (!chunk) {
+            return not_found;
+        }
+
+        std::vector<uint8_t> out{msg::STATE};
+        const auto& addresses = chunk->addresses[index];
+        put(out, addresses.size(), 4);
+        for (const auto& address : addresses) {
+            auto account = chunk->snapshot.get_account(address);
+            auto proof = chunk->snapshot.prove_account(address);
+            if (!account || !proof) {
+                return not_found;
+            }
+            const auto bytes = account->serialize();
+            put(out, bytes.size(), 4);
+            put_bytes(out, bytes);
+            encode_proof(out, *proof);
+        }
+        return out;
+    }
+
+    return not_found;
+}
+
+// ChainSync
+
+// One fetch() call's queue; guarded by peers_mutex_
+struct ChainSync::Fetch {
+    std::condition_variable changed;
+    std::deque<size_t> ready;
+    std::vector<size_t> attempts;
+    std::vector<std::vector<size_t>> tried;  // peers each task went to
+    size_t completed{0};
+    size_t outstanding{0};
+    size_t events{0};
+    bool failed{false};
+};
+
+ChainSync::ChainSync(Config config, Transport transport, utils::WorkStealingPool& pool)
+    : config_(config), transport_(std::move(transport)), pool_(pool) {}
+
+bool ChainSync::fetch(size_t count, const Request& request, const Accept& accept, const Progress& progress,
+                      const std::vector<std::string>& avoid, std::stop_token stop) {
+    if (count == 0) {
+        return true;
+    }
+    Fetch f;
+    f.attempts.assign(count, 0);
+    f.tried.resize(count);
+    for (size_t task = 0; task < count; ++task) {
+        f.ready.push_back(task);
+    }
+
+    std::vector<bool> avoided(peers_.size(), false);
+    for (size_t p = 0; p < peers_.size(); ++p) {
+        avoided[p] = std::find(avoid.begin(), avoid.end(), peers_[p]) != avoid.end();
+    }
+
+    bool ok = true;
+    std::unique_lock<std::mutex> lock(peers_mutex_);
+    while (true) {
+        if (f.failed || stop.stop_requested()) {
+            ok = false;
+            break;
+        }
+        if (f.completed == count) {
+            break;
+        }
+
+        // Each ready task goes to the least loaded live peer, preferring
+        // one that has not served it yet and is not on the avoid list
+        std::vector<std::pair<size_t, size_t>> sends;
+        while (!f.ready.empty()) {
+            const size_t task = f.ready.front();
+            size_t best = peers_.size();
+            bool best_fresh = false;
+            for (size_t p = 0; p < peers_.size(); ++p) {
+                if (failures_[p] >= config_.max_peer_failures ||
+                    inflight_[p] >= std::max<size_t>(config_.max_inflight_per_peer, 1)) {
+                    continue;
+                }
+                const auto& tried = f.tried[task];
+                const bool fresh = !avoided[p] && std::find(tried.begin(), tried.end(), p) == tried.end();
+                if (best == peers_.size() || (fresh && !best_fresh) ||
+                    (fresh == best_fresh && inflight_[p] < inflight_[best])) {
+                    best = p;
+                    best_fresh = fresh;
+                }
+            }
+            if (best == peers_.size()) {
+                break;
+            }
+            f.ready.pop_front();
+            ++inflight_[best];
+            ++f.outstanding;
+            f.tried[task].push_back(best);
+            sends.emplace_back(task, best);
+        }
+        if (f.outstanding == 0 && !f.ready.empty()) {
+            // Work left and nobody to give it to
+            ok = false;
+            break;
+        }
+        const size_t seen = f.events;
+        lock.unlock();
+
+        for (const auto& [task, p] : sends) {
+            transport_(peers_[p], request(task), [this, &f, &accept, task = task, p = p](
+                                                     std::optional<std::vector<uint8_t>> reply) {
+                pool_.post(utils::TaskPriority::Execution, [this, &f, &accept, task, p, reply = std::move(reply)]() {
+                    bool good = false;
+                    try {
+                        good = reply && accept(task, peers_[p], *reply);
+                    } catch (const std::exception&) {
+                        good = false;
+                    }
+                    std::lock_guard<std::mutex> guard(peers_mutex_);
+                    --inflight_[p];
+                    --f.outstanding;
+                    ++f.events;
+                    if (good) {
+                        ++f.completed;
+                    } else {
+                        ++failures_[p];
+                        if (++f.attempts[task] >= config_.max_attempts) {
+                            f.failed = true;
+                        } else {
+                            f.ready.push_back(task);
+                        }
+                    }
+                    // Under the lock: once it drops, fetch() may return and f is gone
+                    f.changed.notify_all();
+                });
+            });
+        }
+
+        if (progress && !progress()) {
+            lock.lock();
+            ok = false;
+            break;
+        }
+        lock.lock();
+        f.changed.wait_for(lock, STOP_POLL, [&] { return f.events != seen; });
+    }
+
+    f.changed.wait(lock, [&] { return f.outstanding == 0; });
+    lock.unlock();
+    if (ok && progress) {
+        ok = progress();
+    }
+    return ok;
+}
+
+ChainSync::Status ChainSync::sync_headers(const SyncHeader& anchor, const Target& target,
+                                          std::vector<SyncHeader>& headers, std::stop_token stop) {
+    const uint64_t n = target.height - anchor.height;
+    const uint64_t per = std::max<size_t>(config_.headers_per_request, 1);
+    const size_t segments = static_cast<size_t>((n + per - 1) / per);
+    headers.assign(static_cast<size_t>(n), {});
+    std::vector<Hash> hashes(headers.size());
+    std::vector<std::string> served(segments);
+
+    auto first_of = [&](size_t s) { return s * per; };
+    auto size_of = [&](size_t s) { return std::min<uint64_t>(per, n - s * per); };
+
+    // Segments map to fetch tasks through `which`, so a refetch of a few
+    // segments reuses the same request and check
+    std::vector<size_t> which(segments);
+    for (size_t s = 0; s < segments; ++s) {
+        which[s] = s;
+    }
+    auto request = [&](size_t task) {
+        const size_t s = which[task];
+        return range_request(msg::GET_HEADERS, anchor.height + 1 + first_of(s), size_of(s));
+    };
+    auto accept = [&](size_t task, const std::string& peer, std::span<const uint8_t> reply) {
+        const size_t s = which[task];
+        Reader in(reply);
+        if (in.get(1) != msg::HEADERS || in.count(SyncHeader::ENCODED_SIZE) != size_of(s)) {
+            return false;
+        }
+        std::vector<SyncHeader> segment(static_cast<size_t>(size_of(s)));
+        std::vector<Hash> segment_hashes(segment.size());
+        for (size_t k = 0; k < segment.size(); ++k) {
+            auto header = SyncHeader::decode(in.take(SyncHeader::ENCODED_SIZE));
+            if (!header || header->height != anchor.height + 1 + first_of(s) + k ||
+                (k > 0 && header->parent != segment_hashes[k - 1])) {
+                return false;
+            }
+            segment[k] = *header;
+            segment_hashes[k] = header->hash();
+        }
+        if (!in.done()) {
+            return false;
+        }
+        // Tasks own disjoint ranges, so no lock is needed
+        std::copy(segment.begin(), segment.end(), headers.begin() + first_of(s));
+        std::copy(segment_hashes.begin(), segment_hashes.end(), hashes.begin() + first_of(s));
+        served[s] = peer;
+        return true;
+    };
+
+    std::vector<size_t> refetches(segments, 0);
+    std::vector<std::string> avoid;
+    size_t linked = 0;
+    Hash prev = anchor.hash();
+    while (true) {
+        if (!fetch(which.size(), request, accept, {}, avoid, stop)) {
+            if (stop.stop_requested()) {
+                return Status::Stopped;
+            }
+            // Out of peers while refetching means none had a chain to the target
+            return avoid.empty() ? Status::NoPeers : Status::BadChain;
+        }
+        while (linked < headers.size() && headers[linked].parent == prev) {
+            prev = hashes[linked++];
+        }
+        if (linked == headers.size() && prev == target.hash) {
+            return Status::Synced;
+        }
+
+        // A break inside a segment is that segment's fault. At a boundary
+        // either side may be on another fork, and past the end the last
+        // segment reached the wrong tip; refetch the suspects elsewhere.
+        which.clear();
+        if (linked == headers.size()) {
+            which.push_back(segments - 1);
+        } else {
+            const size_t s = linked / per;
+            if (linked % per == 0 && s > 0) {
+                which.push_back(s - 1);
+            }
+            which.push_back(s);
+        }
+        avoid.clear();
+        {
+            std::lock_guard<std::mutex> lock(peers_mutex_);
+            for (size_t s : which) {
+                if (++refetches[s] > config_.max_attempts) {
+                    return Status::BadChain;
+                }
+                auto it = std::find(peers_.begin(), peers_.end(), served[s]);
+                if (it != peers_.end()) {
+                    ++failures_[static_cast<size_t>(it - peers_.begin())];
+                }
+                avoid.push_back(served[s]);
+            }
+        }
+        linked = static_cast<size_t>(first_of(which.front()));
+        prev = linked == 0 ? anchor.hash() : hashes[linked - 1];
+    }
+}
+
+ChainSync::Status ChainSync::sync_state(const SyncHeader& pivot, const StateSink& sink, Result& result,
+                                        std::stop_token stop) {
+    const uint32_t chunks = std::max<uint32_t>(config_.state_chunks, 1);
+    std::vector<std::vector<std::pair<std::string, Hash>>> leaves(chunks);
+    std::atomic<size_t> accounts{0};
+
+    auto request = [&](size_t task) {
+        std::vector<uint8_t> out{msg::GET_STATE};
+        put_bytes(out, pivot.state_root);
+        put(out, task, 4);
+        put(out, chunks, 4);
+        return out;
+    };
+    auto accept = [&](size_t task, const std::string&, std::span<const uint8_t> reply) {
+        Reader in(reply);
+        if (in.get(1) != msg::STATE) {
+            return false;
+        }
+        const size_t count = in.count(5);
+        std::vector<StateManager::Account> verified;
+        std::vector<std::pair<std::string, Hash>> chunk;
+        verified.reserve(count);
+        chunk.reserve(count);
+        std::unordered_set<std::string> seen;
+        for (size_t i = 0; i < count; ++i) {
+            const auto bytes = in.take(static_cast<size_t>(in.get(4)));
+            if (!in.ok()) {
+                return false;
+            }
+            auto account = StateManager::Account::deserialize({bytes.begin(), bytes.end()});
+            auto proof = decode_proof(in);
+            if (!account || !proof || state_chunk_of(account->address, chunks) != task ||
+                !seen.insert(account->address).second) {
+                return false;
+            }
+            const auto value_hash = StateManager::account_hash(*account);
+            if (!StateTrie::verify(pivot.state_root, account->address, value_hash, *proof)) {
+                return false;
+            }
+            chunk.emplace_back(account->address, value_hash);
+            verified.push_back(std::move(*account));
+        }
+        if (!in.done()) {
+            return false;
+        }
+        leaves[task] = std::move(chunk);
+        accounts.fetch_add(verified.size(), std::memory_order_relaxed);
+        if (sink) {
+            sink(std::move(verified));
+        }
+        return true;
+    };
+
+    if (!fetch(chunks, request, accept, {}, {}, stop)) {
+        return stop.stop_requested() ? Status::Stopped : Status::NoPeers;
+    }
+    result.accounts = accounts.load();
+
+    // Proofs show each account is in the state, not that none is missing;
+    // only the rebuilt root shows that
+    StateTrie trie;
+    for (const auto& chunk : leaves) {
+        for (const auto& [address, value_hash] : chunk) {
+            trie.update(address, value_hash);
+        }
+    }
+    return trie.root() == pivot.state_root ? Status::Synced : Status::StateMismatch;
+}
+
+ChainSync::Status ChainSync::sync_bodies(const std::vector<SyncHeader>& headers, size_t first,
+                                         const BlockSink& sink, Result& result, std::stop_token stop) {
+    const size_t n = headers.size() - first;
+    const size_t per = std::max<size_t>(config_.bodies_per_request, 1);
+    const size_t tasks = (n + per - 1) / per;
+
+    std::mutex ready_mutex;
+    std::vector<std::vector<blockchain::TransactionPtr>> bodies(n);
+    std::vector<bool> ready(n, false);
+    size_t next = 0;
+    bool rejected = false;
+
+    auto request = [&](size_t task) {
+        return range_request(msg::GET_BODIES, headers[first + task * per].height,
+                             std::min(per, n - task * per));
+    };
+    auto accept = [&](size_t task, const std::string&, std::span<const uint8_t> reply) {
+        Reader in(reply);
+        const size_t blocks = std::min(per, n - task * per);
+        if (in.get(1) != msg::BODIES || in.count(4) != blocks) {
+            return false;
+        }
+        std::vector<std::vector<blockchain::TransactionPtr>> decoded(blocks);
+        for (size_t b = 0; b < blocks; ++b) {
+            const SyncHeader& header = headers[first + task * per + b];
+            if (in.count(4) != header.tx_count) {
+                return false;
+            }
+            auto& txs = decoded[b];
+            txs.reserve(header.tx_count);
+            for (uint32_t i = 0; i < header.tx_count; ++i) {
+                const auto bytes = in.take(static_cast<size_t>(in.get(4)));
+                auto tx = std::make_shared<blockchain::StandardTransaction>();
+                if (!in.ok() || !tx->deserialize({bytes.begin(), bytes.end()})) {
+                    return false;
+                }
+                txs.push_back(std::move(tx));
+            }
+
+            crypto::MerkleBuilder builder(pool_);
+            builder.appendParallel(txs.size(), [&](size_t i) {
+                return crypto::MerkleBuilder::toHash(txs[i]->hash());
+            });
+            if (builder.root() != header.tx_root) {
+                return false;
+            }
+            std::atomic<bool> forged{false};
+            pool_.parallel_for(0, txs.size(), [&](size_t i) {
+                if (!forged.load(std::memory_order_relaxed) && !txs[i]->verified()) {
+                    forged.store(true, std::memory_order_relaxed);
+                }
+            }, utils::TaskPriority::Execution);
+            if (forged.load()) {
+                return false;
+            }
+        }
+        if (!in.done()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(ready_mutex);
+        for (size_t b = 0; b < blocks; ++b) {
+            bodies[task * per + b] = std::move(decoded[b]);
+            ready[task * per + b] = true;
+        }
+        return true;
+    };
+    // Hands over the contiguous prefix that has landed
+    auto progress = [&] {
+        while (true) {
+            std::vector<blockchain::TransactionPtr> body;
+            {
+                std::lock_guard<std::mutex> lock(ready_mutex);
+                if (next == n || !ready[next]) {
+                    return true;
+                }
+                body = std::move(bodies[next]);
+            }
+            const SyncHeader& header = headers[first + next];
+            if (!sink(header, std::move(body))) {
+                rejected = true;
+                return false;
+            }
+            result.height = header.height;
+            ++result.bodies;
+            ++next;
+        }
+    };
+
+    const bool ok = fetch(tasks, request, accept, progress, {}, stop);
+    if (rejected) {
+        return Status::Rejected;
+    }
+    if (!ok || next != n) {
+        return stop.stop_requested() ? Status::Stopped : Status::NoPeers;
+    }
+    return Status::Synced;
+}
+
+ChainSync::Result ChainSync::run(const SyncHeader& anchor, const Target& target,
+                                 const std::vector<std::string>& peers, const BlockSink& blocks,
+                                 const StateSink& state, std::stop_token stop) {
+    Result result;
+    result.height = anchor.height;
+    result.state_height = anchor.height;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        peers_ = peers;
+        inflight_.assign(peers_.size(), 0);
+        failures_.assign(peers_.size(), 0);
+    }
+
+    if (target.height <= anchor.height) {
+        const bool same = target.height == anchor.height && target.hash == anchor.hash();
+        result.status = same ? Status::Synced : Status::BadChain;
+        return result;
+    }
+    if (peers.empty()) {
+        result.status = Status::NoPeers;
+        return result;
+    }
+
+    std::vector<SyncHeader> headers;
+    result.status = sync_headers(anchor, target, headers, stop);
+    if (result.status != Status::Synced) {
+        return result;
+    }
+    result.headers = headers.size();
+
+    size_t first = 0;
+    if (config_.snapshot_distance > 0 && target.height - anchor.height > config_.snapshot_distance) {
+        const SyncHeader& pivot = headers[headers.size() - 1 - config_.snapshot_distance];
+        result.status = sync_state(pivot, state, result, stop);
+        if (result.status != Status::Synced) {
+            return result;
+        }
+        result.height = pivot.height;
+        result.state_height = pivot.height;
+        first = static_cast<size_t>(pivot.height - anchor.height);
+    }
+
+    result.status = sync_bodies(headers, first, blocks, result, stop);
+    return result;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,307 @@
+#include "rollup/ChallengeIndex.hpp"
+#include "storage/PersistentStorage.hpp"
+#include "utils/Hex.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+const std::string WINDOW_PREFIX = "optimistic/window/";
+constexpr size_t RECORD_SIZE = 8 + 3 * 32 + 8 + 1;
+
+void put_hex(std::string& out, uint64_t v) {
+    static const char* const DIGITS = "0123456789abcdef";
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        out.push_back(DIGITS[(v >> shift) & 0xF]);
+    }
+}
+
+int64_t to_micros(ChallengeIndex::Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+}
+
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+uint64_t get_u64(const uint8_t* in) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return v;
+}
+
+std::vector<uint8_t> encode(const ChallengeIndex::Commitment& commitment) {
+    std::vector<uint8_t> out;
+    out.reserve(RECORD_SIZE);
+    put_u64(out, commitment.batch_number);
+    out.insert(out.end(), commitment.pre_state_root.begin(), commitment.pre_state_root.end());
+    out.insert(out.end(), commitment.post_state_root.begin(), commitment.post_state_root.end());
+    out.insert(out.end(), commitment.batch_hash.begin(), commitment.batch_hash.end());
+    put_u64(out, static_cast<uint64_t>(to_micros(commitment.window_end)));
+    out.push_back(static_cast<uint8_t>(commitment.status));
+    return out;
+}
+
+std::optional<ChallengeIndex::Commitment> decode(const std::vector<uint8_t>& data) {
+    if (data.size() != RECORD_SIZE || data.back() > static_cast<uint8_t>(ChallengeIndex::Status::Challenged)) {
+        return std::nullopt;
+    }
+    ChallengeIndex::Commitment commitment;
+    const uint8_t* p = data.data();
+    commitment.batch_number = get_u64(p);
+    p += 8;
+    std::memcpy(commitment.pre_state_root.data(), p, 32);
+    p += 32;
+    std::memcpy(commitment.post_state_root.data(), p, 32);
+    p += 32;
+    std::memcpy(commitment.batch_hash.data(), p, 32);
+    p += 32;
+    commitment.window_end = ChallengeIndex::Clock::time_point(
+        std::chrono::duration_cast<ChallengeIndex::Clock::duration>(
+            std::chrono::microseconds(static_cast<int64_t>(get_u64(p)))));
+    commitment.status = static_cast<ChallengeIndex::Status>(data.back());
+    return commitment;
+}
+
+} // namespace
+
+size_t ChallengeIndex::RootHash::operator()(const Root& root) const noexcept {
+    // Roots are hashes already
+    size_t h;
+    std::memcpy(&h, root.data(), sizeof(h));
+    return h;
+}
+
+ChallengeIndex::ChallengeIndex(std::shared_ptr<storage::PersistentStorage> storage, const Config& config,
+                               Finalizer finalizer)
+    : storage_(std::move(storage)), config_(config), finalizer_(std::move(finalizer)) {
+    if (!storage_) {
+        throw std::invalid_argument("Challenge index needs storage");
+    }
+    if (config_.tick.count() <= 0) {
+        throw std::invalid_argument("Challenge index tick must be positive");
+    }
+    current_ = tick_of(Clock::now(), false);
+    resume();
+}
+
+ChallengeIndex::ChallengeIndex(std::shared_ptr<storage::PersistentStorage> storage, Finalizer finalizer)
+    : ChallengeIndex(std::move(storage), Config{}, std::move(finalizer)) {}
+
+uint64_t ChallengeIndex::tick_of(Clock::time_point t, bool round_up) const {
+    const int64_t us = to_micros(t);
+    if (us <= 0) {
+        return 0;
+    }
+    const auto tick_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(config_.tick).count());
+    const auto value = static_cast<uint64_t>(us);
+    return value / tick_us + (round_up && value % tick_us != 0 ? 1 : 0);
+}
+
+std::string ChallengeIndex::key_of(const Commitment& commitment) const {
+    // Window end first so key order is expiry order
+    std::string key = WINDOW_PREFIX;
+    put_hex(key, static_cast<uint64_t>(to_micros(commitment.window_end)));
+    const size_t start = key.size();
+    key.resize(start + 2 * commitment.post_state_root.size());
+    utils::hexEncode(commitment.post_state_root, key.data() + start);
+    return key;
+}
+
+void ChallengeIndex::resume() {
+    storage_->scanState(WINDOW_PREFIX, [this](const std::string&, const std::vector<uint8_t>& data) {
+        if (auto commitment = decode(data)) {
+            const uint64_t expiry = tick_of(commitment->window_end, true);
+            const Root root = commitment->post_state_root;
+            if (entries_.emplace(root, Entry{*commitment, expiry}).second) {
+                schedule(root, expiry);
+            }
+        }
+        return true;
+    });
+}
+
+bool ChallengeIndex::persist(const Commitment& commitment) {
+    return storage_->storeStateBatch({{key_of(commitment), encode(commitment)}}, config_.sync_writes);
+}
+
+void ChallengeIndex::schedule(const Root& root, uint64_t expiry) {
+    if (expiry <= current_) {
+        due_.emplace_back(root, expiry);
+        return;
+    }
+    const uint64_t delta = expiry - current_;
+    for (size_t level = 0; level < LEVELS; ++level) {
+        const size_t shift = LEVEL_BITS * level;
+        if (level + 1 == LEVELS || delta < (uint64_t{1} << (shift + LEVEL_BITS))) {
+            // Past the span, park in the top level's farthest slot; the
+            // cascade files it again from its real expiry
+            const uint64_t filed = level + 1 == LEVELS
+                ? std::min(expiry, current_ + (uint64_t{1} << (shift + LEVEL_BITS)) - 1)
+                : expiry;
+            wheel_[level][(filed >> shift) & (SLOTS - 1)].emplace_back(root, expiry);
+            ++filed_;
+            return;
+        }
+    }
+}
+
+void ChallengeIndex::cascade(size_t level) {
+    const size_t index = (current_ >> (LEVEL_BITS * level)) & (SLOTS - 1);
+    if (index == 0 && level + 1 < LEVELS) {
+        cascade(level + 1);
+    }
+    std::vector<Timer> timers;
+    timers.swap(wheel_[level][index]);
+    filed_ -= timers.size();
+    for (const auto& [root, expiry] : timers) {
+        schedule(root, expiry);
+    }
+}
+
+void ChallengeIndex::expire(const Timer& timer, std::vector<Commitment>& closed) {
+    auto it = entries_.find(timer.first);
+    if (it == entries_.end() || it->second.expiry != timer.second ||
+        it->second.commitment.status != Status::Pending) {
+        return;
+    }
+    closed.push_back(it->second.commitment);
+    entries_.erase(it);
+}
+
+bool ChallengeIndex::add(const Commitment& added) {
+    Commitment commitment = added;
+    commitment.status = Status::Pending;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(commitment.post_state_root) != 0 || !persist(commitment)) {
+        return false;
+    }
+    const uint64_t expiry = tick_of(commitment.window_end, true);
+    entries_.emplace(commitment.post_state_root, Entry{commitment, expiry});
+    schedule(commitment.post_state_root, expiry);
+    return true;
+}
+
+std::optional<ChallengeIndex::Commitment> ChallengeIndex::find(const Root& post_state_root) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(post_state_root);
+    if (it == entries_.end()) {
+        return std::nullopt;
+    }
+    return it->second.commitment;
+}
+
+bool ChallengeIndex::challenge(const Root& post_state_root) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(post_state_root);
+    if (it == entries_.end() || it->second.commitment.status != Status::Pending) {
+        return false;
+    }
+    Commitment updated = it->second.commitment;
+    updated.status = Status::Challenged;
+    if (!persist(updated)) {
+        return false;
+    }
+    it->second.commitment = updated;
+    return true;
+}
+
+bool ChallengeIndex::resolve(const Root& post_state_root, bool fraud_shown) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(post_state_root);
+    if (it == entries_.end() || it->second.commitment.status != Status::Challenged) {
+        return false;
+    }
+    if (fraud_shown) {
+        if (!storage_->storeStateBatch({{key_of(it->second.commitment), std::nullopt}}, config_.sync_writes)) {
+            return false;
+        }
+        entries_.erase(it);
+        return true;
+    }
+
+    Commitment updated = it->second.commitment;
+    updated.status = Status::Pending;
+    if (!persist(updated)) {
+        return false;
+    }
+    it->second.commitment = updated;
+    // A timer still in the wheel fires as usual; one that already fired
+    // was skipped, so the commitment is due now
+    if (it->second.expiry <= current_) {
+        due_.emplace_back(post_state_root, it->second.expiry);
+    }
+    return true;
+}
+
+size_t ChallengeIndex::advance(Clock::time_point now) {
+    std::vector<Commitment> closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t target = tick_of(now, false);
+        while (current_ < target) {
+            if (filed_ == 0) {
+                current_ = target;
+                break;
+            }
+            ++current_;
+            const size_t index = current_ & (SLOTS - 1);
+            if (index == 0) {
+                cascade(1);
+            }
+            std::vector<Timer> fired;
+            fired.swap(wheel_[0][index]);
+            filed_ -= fired.size();
+            for (const auto& timer : fired) {
+                expire(timer, closed);
+            }
+        }
+        // After the wheel, which files a timer here when a cascade lands
+        // it on the current tick
+        std::vector<Timer> due;
+        due.swap(due_);
+        for (const auto& timer : due) {
+            if (timer.second <= target) {
+                expire(timer, closed);
+            } else {
+                due_.push_back(timer);
+            }
+        }
+    }
+    if (closed.empty()) {
+        return 0;
+    }
+
+    std::sort(closed.begin(), closed.end(), [](const Commitment& a, const Commitment& b) {
+        return a.window_end != b.window_end ? a.window_end < b.window_end : a.batch_number < b.batch_number;
+    });
+    if (finalizer_) {
+        finalizer_(closed);
+    }
+
+    std::vector<storage::PersistentStorage::StateWrite> writes;
+    writes.reserve(closed.size());
+    for (const auto& commitment : closed) {
+        writes.push_back({key_of(commitment), std::nullopt});
+    }
+    storage_->storeStateBatch(writes, config_.sync_writes);
+    return closed.size();
+}
+
+size_t ChallengeIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,164 @@
+#include "rollup/ConflictScheduler.hpp"
+#include <algorithm>
+#include <memory_resource>
+#include <unordered_map>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t fnv1a(const uint8_t* data, size_t len, uint64_t seed = FNV_OFFSET) {
+    uint64_t h = seed;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= data[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+// Domain tags keep account keys and storage keys from colliding by construction
+constexpr uint8_t ACCOUNT_TAG = 0x01;
+constexpr uint8_t STORAGE_TAG = 0x02;
+
+} // namespace
+
+StateKey ConflictScheduler::accountKey(const std::string& address) {
+    uint64_t h = fnv1a(&ACCOUNT_TAG, 1);
+    return fnv1a(reinterpret_cast<const uint8_t*>(address.data()), address.size(), h);
+}
+
+StateKey ConflictScheduler::storageKey(const std::string& contract, const std::vector<uint8_t>& slot) {
+    uint64_t h = fnv1a(&STORAGE_TAG, 1);
+    h = fnv1a(reinterpret_cast<const uint8_t*>(contract.data()), contract.size(), h);
+    return fnv1a(slot.data(), slot.size(), h);
+}
+
+namespace {
+
+// Sender pays value + gas and bumps its nonce, recipient is credited
+void addAccountWrites(const blockchain::Transaction& tx, AccessSet& access) {
+    access.writes.push_back(ConflictScheduler::accountKey(tx.getSender()));
+    if (tx.getRecipient() != tx.getSender()) {
+        access.writes.push_back(ConflictScheduler::accountKey(tx.getRecipient()));
+    }
+}
+
+std::vector<uint8_t> slotBytes(const ::evm::uint256_t& slot) {
+    std::vector<uint8_t> bytes(32);
+    slot.store_be(bytes.data());
+    return bytes;
+}
+
+} // namespace
+
+AccessSet ConflictScheduler::buildAccessSet(
+    const blockchain::Transaction& tx,
+    const std::vector<std::vector<uint8_t>>& storage_slots
+) {
+    AccessSet access;
+    addAccountWrites(tx, access);
+
+    if (!tx.getData().empty()) {
+        if (storage_slots.empty()) {
+            // No slot information: treat the whole contract as one key
+            access.writes.push_back(storageKey(tx.getRecipient(), {}));
+        } else {
+            // Known slots still read the contract-wide key so they serialize
+            // against callers that had to lock the whole contract
+            access.reads.push_back(storageKey(tx.getRecipient(), {}));
+            for (const auto& slot : storage_slots) {
+                access.writes.push_back(storageKey(tx.getRecipient(), slot));
+            }
+        }
+    }
+
+    return access;
+}
+
+AccessSet ConflictScheduler::buildAccessSet(
+    const blockchain::Transaction& tx,
+    const ::evm::StorageAccessSet& storage_access
+) {
+    AccessSet access;
+    addAccountWrites(tx, access);
+
+    if (!storage_access.reads.empty() || !storage_access.writes.empty()) {
+        // Serialize against callers that locked the whole contract
+        access.reads.push_back(storageKey(tx.getRecipient(), {}));
+    }
+    for (const auto& slot : storage_access.reads) {
+        access.reads.push_back(storageKey(tx.getRecipient(), slotBytes(slot.slot)));
+    }
+    for (const auto& slot : storage_access.writes) {
+        access.writes.push_back(storageKey(tx.getRecipient(), slotBytes(slot.slot)));
+    }
+    return access;
+}
+
+std::vector<ConflictScheduler::Wave> ConflictScheduler::schedule(const std::vector<AccessSet>& access_sets) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Wave> waves;
+    {
+        // Every node and bucket comes from the arena, so once it has grown to
+        // the batch size scheduling a batch makes no system allocation
+        std::pmr::unordered_map<StateKey, KeyState> key_states(&scratch_);
+        key_states.reserve(access_sets.size() * 2);
+
+        for (size_t i = 0; i < access_sets.size(); ++i) {
+            const auto& access = access_sets[i];
+
+            // Earliest wave that comes after every conflicting predecessor
+            size_t wave = 1;
+            for (StateKey key : access.writes) {
+                auto it = key_states.find(key);
+                if (it != key_states.end()) {
+                    wave = std::max(wave, std::max(it->second.last_write_wave, it->second.last_read_wave) + 1);
+                }
+            }
+            for (StateKey key : access.reads) {
+                auto it = key_states.find(key);
+                if (it != key_states.end()) {
+                    wave = std::max(wave, it->second.last_write_wave + 1);
+                }
+            }
+
+            for (StateKey key : access.writes) {
+                auto& state = key_states[key];
+                state.last_write_wave = std::max(state.last_write_wave, wave);
+            }
+            for (StateKey key : access.reads) {
+                auto& state = key_states[key];
+                state.last_read_wave = std::max(state.last_read_wave, wave);
+            }
+
+            if (waves.size() < wave) {
+                waves.resize(wave);
+            }
+            waves[wave - 1].push_back(i);
+        }
+    }
+    // The table is gone; rewind its memory for the next batch
+    scratch_.reset();
+
+    metrics_ = ScheduleMetrics{};
+    metrics_.total_transactions = access_sets.size();
+    metrics_.wave_count = waves.size();
+    metrics_.waves.resize(waves.size());
+    for (size_t w = 0; w < waves.size(); ++w) {
+        metrics_.waves[w].wave_index = w;
+        metrics_.waves[w].tx_count = waves[w].size();
+        metrics_.widest_wave = std::max(metrics_.widest_wave, waves[w].size());
+    }
+    metrics_.schedule_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    return waves;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -3,9 +3,20 @@
 #include <cstring>
 #include <stdexcept>
 
-namespace {
-std::array<uint8_t, 32> compute_message_hash(const quids::rollup::CrossRollupBridge::CrossRollupMessage& message) {
-    std::array<uint8_t, 32> hash;
+namespace quids {
+namespace rollup {
+
+CrossRollupBridge::CrossRollupBridge() : CrossRollupBridge(Config{}, nullptr, nullptr) {}
+
+CrossRollupBridge::CrossRollupBridge(const Config& config, BatchProver prover, BatchVerifier verifier)
+    : config_(config), prover_(std::move(prover)), verifier_(std::move(verifier)) {
+    if (config_.max_batch_size == 0) {
+        throw std::invalid_argument("Batches must hold at least one message");
+    }
+}
+
+CrossRollupBridge::Hash CrossRollupBridge::message_hash(const CrossRollupMessage& message) {
+    Hash hash;
     EVP_MD_CTX* ctx = EVP_MD_CTX_new();
     if (!ctx) {
         throw std::runtime_error("Failed to create EVP context");
@@ -19,6 +30,7 @@ std::array<uint8_t, 32> compute_message_hash(const quids::rollup::CrossRollupBri
     // Hash message fields
     if (EVP_DigestUpdate(ctx, &message.source_chain_id, sizeof(message.source_chain_id)) != 1 ||
         EVP_DigestUpdate(ctx, &message.destination_chain_id, sizeof(message.destination_chain_id)) != 1 ||
+        EVP_DigestUpdate(ctx, &message.nonce, sizeof(message.nonce)) != 1 ||
         EVP_DigestUpdate(ctx, message.payload.data(), message.payload.size()) != 1) {
         EVP_MD_CTX_free(ctx);
         throw std::runtime_error("Failed to update digest");
@@ -33,26 +45,123 @@ std::array<uint8_t, 32> compute_message_hash(const quids::rollup::CrossRollupBri
     EVP_MD_CTX_free(ctx);
     return hash;
 }
-}  // namespace
 
-namespace quids {
-namespace rollup {
+uint64_t CrossRollupBridge::send_message(const CrossRollupMessage& message) {
+    std::lock_guard<std::mutex> sealing(seal_mutex_);
+    std::vector<SealedBatch> full;
+    uint64_t nonce;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const uint64_t key = stream(message.source_chain_id, message.destination_chain_id);
+        auto& outbound = outbound_[key];
+        nonce = outbound.next_nonce++;
 
-void CrossRollupBridge::send_message(const CrossRollupMessage& message) {
-    // Hash the message for verification
-    auto message_hash = compute_message_hash(message);
-    
-    // Store message hash for verification
-    message_hashes_.push_back(message_hash);
+        CrossRollupMessage numbered = message;
+        numbered.nonce = nonce;
+        message_hashes_.insert(message_hash(numbered));
+        outbound.pending.push_back(std::move(numbered));
+        if (outbound.pending.size() >= config_.max_batch_size) {
+            full.push_back(cut(key, outbound));
+        }
+    }
+    finish(std::move(full));
+    return nonce;
 }
 
 bool CrossRollupBridge::verify_incoming_message(const CrossRollupMessage& message) {
-    // Hash the message
-    auto message_hash = compute_message_hash(message);
-    
-    // Verify message hash exists
-    return std::find(message_hashes_.begin(), message_hashes_.end(), message_hash) != message_hashes_.end();
+    const auto hash = message_hash(message);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return message_hashes_.count(hash) != 0;
+}
+
+void CrossRollupBridge::seal() {
+    std::lock_guard<std::mutex> sealing(seal_mutex_);
+    std::vector<SealedBatch> batches;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [key, outbound] : outbound_) {
+            if (!outbound.pending.empty()) {
+                batches.push_back(cut(key, outbound));
+            }
+        }
+    }
+    finish(std::move(batches));
+}
+
+std::vector<CrossRollupBridge::SealedBatch> CrossRollupBridge::take_sealed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SealedBatch> out(std::make_move_iterator(sealed_.begin()),
+                                 std::make_move_iterator(sealed_.end()));
+    sealed_.clear();
+    return out;
+}
+
+CrossRollupBridge::SealedBatch CrossRollupBridge::cut(uint64_t key, Outbound& outbound) {
+    SealedBatch batch;
+    batch.header.source_chain_id = static_cast<uint32_t>(key >> 32);
+    batch.header.destination_chain_id = static_cast<uint32_t>(key);
+    batch.header.batch_number = outbound.next_batch++;
+    batch.header.first_nonce = outbound.pending.front().nonce;
+    batch.header.message_count = outbound.pending.size();
+    batch.messages = std::move(outbound.pending);
+    outbound.pending.clear();
+    return batch;
+}
+
+void CrossRollupBridge::finish(std::vector<SealedBatch>&& batches) {
+    for (auto& batch : batches) {
+        crypto::MerkleBuilder tree;
+        tree.appendParallel(batch.messages.size(), [&](size_t i) {
+            return message_hash(batch.messages[i]);
+        });
+        batch.header.root = tree.root();
+        batch.inclusion.reserve(batch.messages.size());
+        for (size_t i = 0; i < batch.messages.size(); ++i) {
+            batch.inclusion.push_back(tree.proof(i));
+        }
+        // One proof covers every message under the root
+        if (prover_) {
+            batch.header.validity_proof = prover_(batch.header);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& batch : batches) {
+        sealed_.push_back(std::move(batch));
+    }
+}
+
+bool CrossRollupBridge::accept_batch(const BatchHeader& header) {
+    if (verifier_ && !verifier_(header)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& inbound = inbound_[stream(header.source_chain_id, header.destination_chain_id)];
+    return inbound.roots.emplace(header.batch_number, header.root).second;
+}
+
+bool CrossRollupBridge::receive_message(const CrossRollupMessage& message, const MessageProof& proof) {
+    const auto leaf = message_hash(message);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = inbound_.find(stream(message.source_chain_id, message.destination_chain_id));
+    if (it == inbound_.end()) {
+        return false;
+    }
+    auto& inbound = it->second;
+    auto root = inbound.roots.find(proof.batch_number);
+    if (root == inbound.roots.end() || !crypto::MerkleBuilder::verify(root->second, leaf, proof.path)) {
+        return false;
+    }
+
+    if (message.nonce < inbound.next || !inbound.delivered.insert(message.nonce).second) {
+        return false;  // replay
+    }
+    // Slide the window past everything now contiguous
+    while (inbound.delivered.erase(inbound.next)) {
+        ++inbound.next;
+    }
+    return true;
 }
 
 } // namespace rollup
-} // namespace quids 
\ No newline at end of file
+} // namespace quids
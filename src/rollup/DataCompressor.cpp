@@ -1,120 +1,278 @@
 #include "rollup/DataCompressor.hpp"
 #include <zstd.h>
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
-#include <cstring>
+#include <unordered_map>
 
 namespace quids {
 namespace rollup {
 
-CompressedBatch DataCompressor::compress_batch(std::span<const quids::blockchain::Transaction> transactions) {
-    CompressedBatch batch;
-    batch.original_size = transactions.size() * sizeof(quids::blockchain::Transaction);
-
-    // Estimate compressed size
-    size_t const estimated_compressed_size = ZSTD_compressBound(batch.original_size);
-    std::string compressed_data;
-    compressed_data.resize(estimated_compressed_size);
-
-    // Compress the transactions
-    size_t const compressed_size = ZSTD_compress(
-        compressed_data.data(), estimated_compressed_size,
-        transactions.data(), batch.original_size,
-        1  // compression level
-    );
-
-    if (ZSTD_isError(compressed_size)) {
-        throw std::runtime_error(std::string("ZSTD compression failed: ") + ZSTD_getErrorName(compressed_size));
+namespace {
+
+constexpr uint8_t MAGIC[4] = {'Q', 'C', 'B', 1};
+// Refuse to allocate more than this for one column of a hostile batch
+constexpr uint64_t MAX_COLUMN_SIZE = 256ULL << 20;
+
+enum Column : size_t {
+    ADDRESSES,     // address table: count, then length-prefixed strings
+    SENDERS,       // table index per transaction
+    RECIPIENTS,    // table index per transaction
+    NONCES,        // zigzag delta against the sender's previous nonce + 1
+    VALUES,
+    GAS,
+    TIMESTAMPS,    // zigzag delta against the previous transaction
+    SIGNATURES,    // 32 raw bytes each
+    DATA_LENGTHS,
+    DATA,
+    NUM_COLUMNS
+};
+
+enum Coding : uint8_t { RAW = 0, ZSTD = 1 };
+
+using Bytes = std::vector<uint8_t>;
+
+void put_varint(Bytes& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
     }
+    out.push_back(static_cast<uint8_t>(v));
+}
 
-    // Resize to actual compressed size
-    compressed_data.resize(compressed_size);
-    batch.compressed_data = std::move(compressed_data);
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
 
-    return batch;
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
 }
 
-std::vector<quids::blockchain::Transaction> 
-DataCompressor::decompress_batch(const CompressedBatch& compressed) {
-    // Get decompressed size
-    size_t const decompressed_size = ZSTD_getFrameContentSize(
-        compressed.compressed_data.data(), 
-        compressed.compressed_data.size()
-    );
+[[noreturn]] void malformed(const char* what) {
+    throw std::runtime_error(std::string("Malformed compressed batch: ") + what);
+}
+
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
 
-    if (decompressed_size != compressed.original_size) {
-        throw std::runtime_error("Decompressed size does not match original size");
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p_ == end_) malformed("truncated varint");
+            const uint8_t b = *p_++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        malformed("varint too long");
     }
 
-    std::vector<quids::blockchain::Transaction> transactions(compressed.original_size / sizeof(quids::blockchain::Transaction));
+    const uint8_t* bytes(uint64_t n) {
+        if (n > static_cast<uint64_t>(end_ - p_)) malformed("truncated field");
+        const uint8_t* start = p_;
+        p_ += n;
+        return start;
+    }
 
-    // Decompress
-    size_t const actual_decompressed_size = ZSTD_decompress(
-        transactions.data(), decompressed_size,
-        compressed.compressed_data.data(), compressed.compressed_data.size()
-    );
+    uint8_t byte() { return *bytes(1); }
+    bool done() const { return p_ == end_; }
 
-    if (ZSTD_isError(actual_decompressed_size)) {
-        throw std::runtime_error(std::string("ZSTD decompression failed: ") + ZSTD_getErrorName(actual_decompressed_size));
-    }
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
 
-    if (actual_decompressed_size != decompressed_size) {
-        throw std::runtime_error("Actual decompressed size does not match expected size");
+void put_column(std::string& out, const Bytes& column, int level) {
+    Bytes packed(ZSTD_compressBound(column.size()));
+    const size_t n = ZSTD_compress(packed.data(), packed.size(), column.data(), column.size(), level);
+    if (ZSTD_isError(n)) {
+        throw std::runtime_error(std::string("ZSTD compression failed: ") + ZSTD_getErrorName(n));
     }
+    const bool use_zstd = n < column.size();
+    const Bytes& body = use_zstd ? packed : column;
+    const size_t body_size = use_zstd ? n : column.size();
 
-    return transactions;
+    Bytes header;
+    header.push_back(use_zstd ? ZSTD : RAW);
+    put_varint(header, column.size());
+    put_varint(header, body_size);
+    out.append(header.begin(), header.end());
+    out.append(reinterpret_cast<const char*>(body.data()), body_size);
 }
 
-std::string DataCompressor::compress_transaction(const quids::blockchain::Transaction& tx) {
-    // Estimate compressed size
-    size_t const estimated_compressed_size = ZSTD_compressBound(sizeof(quids::blockchain::Transaction));
-    std::string compressed_data;
-    compressed_data.resize(estimated_compressed_size);
-
-    // Compress the transaction
-    size_t const compressed_size = ZSTD_compress(
-        compressed_data.data(), estimated_compressed_size,
-        &tx, sizeof(quids::blockchain::Transaction),
-        1  // compression level
-    );
-
-    if (ZSTD_isError(compressed_size)) {
-        throw std::runtime_error(std::string("ZSTD compression failed: ") + ZSTD_getErrorName(compressed_size));
+Bytes get_column(Reader& in) {
+    const uint8_t coding = in.byte();
+    const uint64_t raw_size = in.varint();
+    const uint64_t stored_size = in.varint();
+    if (raw_size > MAX_COLUMN_SIZE) malformed("column too large");
+    const uint8_t* body = in.bytes(stored_size);
+
+    if (coding == RAW) {
+        if (stored_size != raw_size) malformed("raw column size mismatch");
+        return Bytes(body, body + stored_size);
     }
+    if (coding != ZSTD) malformed("unknown column coding");
+    Bytes column(raw_size);
+    const size_t n = ZSTD_decompress(column.data(), column.size(), body, stored_size);
+    if (ZSTD_isError(n) || n != raw_size) malformed("column does not decompress");
+    return column;
+}
+
+} // namespace
 
-    // Resize to actual compressed size
-    compressed_data.resize(compressed_size);
-    return compressed_data;
+TransactionRecord TransactionRecord::from(const quids::blockchain::Transaction& tx) {
+    TransactionRecord r;
+    r.sender = tx.getSender();
+    r.recipient = tx.getRecipient();
+    r.nonce = tx.getNonce();
+    r.value = tx.getValue();
+    r.gas_cost = tx.calculate_gas_cost();
+    r.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        tx.getTimestamp().time_since_epoch()).count();
+    r.signature = tx.getSignature();
+    r.data = tx.getData();
+    return r;
 }
 
-quids::blockchain::Transaction DataCompressor::decompress_transaction(const std::string& compressed_tx) {
-    // Get decompressed size
-    size_t const decompressed_size = ZSTD_getFrameContentSize(
-        compressed_tx.data(), 
-        compressed_tx.size()
-    );
+CompressedBatch DataCompressor::compress_batch(std::span<const TransactionRecord> transactions, int level) {
+    std::array<Bytes, NUM_COLUMNS> columns;
+    const size_t n = transactions.size();
+    for (Column c : {SENDERS, RECIPIENTS, VALUES, GAS, NONCES, TIMESTAMPS, DATA_LENGTHS}) {
+        columns[c].reserve(n * 2);
+    }
+    columns[SIGNATURES].reserve(n * 32);
+
+    std::unordered_map<std::string, uint64_t> table;
+    std::vector<const std::string*> table_order;
+    auto index_of = [&](const std::string& address) {
+        auto [it, inserted] = table.try_emplace(address, table.size());
+        if (inserted) table_order.push_back(&it->first);
+        return it->second;
+    };
 
-    if (decompressed_size != sizeof(quids::blockchain::Transaction)) {
-        throw std::runtime_error("Decompressed size does not match Transaction size");
+    // Per sender: nonce expected next, by table index
+    std::unordered_map<uint64_t, uint64_t> next_nonce;
+    int64_t prev_timestamp = 0;
+    for (const auto& tx : transactions) {
+        const uint64_t sender = index_of(tx.sender);
+        put_varint(columns[SENDERS], sender);
+        put_varint(columns[RECIPIENTS], index_of(tx.recipient));
+
+        auto it = next_nonce.try_emplace(sender, 0).first;
+        put_varint(columns[NONCES], zigzag(static_cast<int64_t>(tx.nonce - it->second)));
+        it->second = tx.nonce + 1;
+
+        put_varint(columns[VALUES], tx.value);
+        put_varint(columns[GAS], tx.gas_cost);
+        put_varint(columns[TIMESTAMPS], zigzag(tx.timestamp_us - prev_timestamp));
+        prev_timestamp = tx.timestamp_us;
+
+        columns[SIGNATURES].insert(columns[SIGNATURES].end(), tx.signature.begin(), tx.signature.end());
+        put_varint(columns[DATA_LENGTHS], tx.data.size());
+        columns[DATA].insert(columns[DATA].end(), tx.data.begin(), tx.data.end());
+    }
+
+    put_varint(columns[ADDRESSES], table_order.size());
+    for (const std::string* address : table_order) {
+        put_varint(columns[ADDRESSES], address->size());
+        columns[ADDRESSES].insert(columns[ADDRESSES].end(), address->begin(), address->end());
+    }
+
+    CompressedBatch batch;
+    batch.original_size = 0;
+    Bytes header(MAGIC, MAGIC + sizeof(MAGIC));
+    put_varint(header, n);
+    put_varint(header, NUM_COLUMNS);
+    batch.compressed_data.assign(header.begin(), header.end());
+    for (const auto& column : columns) {
+        batch.original_size += column.size();
+        put_column(batch.compressed_data, column, level);
+    }
+    return batch;
+}
+
+CompressedBatch DataCompressor::compress_batch(
+    std::span<const quids::blockchain::Transaction* const> transactions, int level) {
+    std::vector<TransactionRecord> records;
+    records.reserve(transactions.size());
+    for (const auto* tx : transactions) {
+        records.push_back(TransactionRecord::from(*tx));
     }
+    return compress_batch(records, level);
+}
 
-    quids::blockchain::Transaction tx;
+std::vector<TransactionRecord> DataCompressor::decompress_batch(std::span<const uint8_t> compressed) {
+    Reader in(compressed.data(), compressed.size());
+    if (!std::equal(MAGIC, MAGIC + sizeof(MAGIC), in.bytes(sizeof(MAGIC)))) {
+        malformed("bad magic");
+    }
+    const uint64_t n = in.varint();
+    if (in.varint() != NUM_COLUMNS) malformed("unexpected column count");
 
-    // Decompress
-    size_t const actual_decompressed_size = ZSTD_decompress(
-        &tx, sizeof(quids::blockchain::Transaction),
-        compressed_tx.data(), compressed_tx.size()
-    );
+    std::array<Bytes, NUM_COLUMNS> columns;
+    for (auto& column : columns) {
+        column = get_column(in);
+    }
+    if (!in.done()) malformed("trailing bytes");
+    const size_t signature_bytes = columns[SIGNATURES].size();
+    if (signature_bytes % 32 != 0 || signature_bytes / 32 != n) malformed("signature column size");
 
-    if (ZSTD_isError(actual_decompressed_size)) {
-        throw std::runtime_error(std::string("ZSTD decompression failed: ") + ZSTD_getErrorName(actual_decompressed_size));
+    Reader addresses(columns[ADDRESSES].data(), columns[ADDRESSES].size());
+    const uint64_t entries = addresses.varint();
+    if (entries > columns[ADDRESSES].size()) malformed("address table size");
+    std::vector<std::string> table;
+    table.reserve(entries);
+    for (uint64_t i = 0; i < entries; ++i) {
+        const uint64_t len = addresses.varint();
+        table.emplace_back(reinterpret_cast<const char*>(addresses.bytes(len)), len);
     }
+    if (!addresses.done()) malformed("address table size");
+    auto address = [&](Reader& r) -> const std::string& {
+        const uint64_t i = r.varint();
+        if (i >= table.size()) malformed("address index out of range");
+        return table[i];
+    };
+
+    Reader senders(columns[SENDERS].data(), columns[SENDERS].size());
+    Reader recipients(columns[RECIPIENTS].data(), columns[RECIPIENTS].size());
+    Reader nonces(columns[NONCES].data(), columns[NONCES].size());
+    Reader values(columns[VALUES].data(), columns[VALUES].size());
+    Reader gas(columns[GAS].data(), columns[GAS].size());
+    Reader timestamps(columns[TIMESTAMPS].data(), columns[TIMESTAMPS].size());
+    Reader lengths(columns[DATA_LENGTHS].data(), columns[DATA_LENGTHS].size());
+    Reader data(columns[DATA].data(), columns[DATA].size());
+    const uint8_t* signature = columns[SIGNATURES].data();
 
-    if (actual_decompressed_size != sizeof(quids::blockchain::Transaction)) {
-        throw std::runtime_error("Actual decompressed size does not match Transaction size");
+    std::vector<TransactionRecord> out(n);
+    std::vector<uint64_t> next_nonce(table.size(), 0);
+    int64_t prev_timestamp = 0;
+    for (auto& tx : out) {
+        const uint64_t sender_index = senders.varint();
+        if (sender_index >= table.size()) malformed("address index out of range");
+        tx.sender = table[sender_index];
+        tx.recipient = address(recipients);
+        tx.nonce = next_nonce[sender_index] + static_cast<uint64_t>(unzigzag(nonces.varint()));
+        next_nonce[sender_index] = tx.nonce + 1;
+        tx.value = values.varint();
+        tx.gas_cost = gas.varint();
+        tx.timestamp_us = prev_timestamp + unzigzag(timestamps.varint());
+        prev_timestamp = tx.timestamp_us;
+        std::copy(signature, signature + 32, tx.signature.begin());
+        signature += 32;
+        const uint64_t len = lengths.varint();
+        const uint8_t* bytes = data.bytes(len);
+        tx.data.assign(bytes, bytes + len);
     }
+    for (const Reader* r : {&senders, &recipients, &nonces, &values, &gas, &timestamps, &lengths, &data}) {
+        if (!r->done()) malformed("column longer than the batch");
+    }
+    return out;
+}
 
-    return tx;
+std::vector<TransactionRecord> DataCompressor::decompress_batch(const CompressedBatch& compressed) {
+    return decompress_batch(std::span<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(compressed.compressed_data.data()), compressed.compressed_data.size()));
 }
 
 } // namespace rollup
-} // namespace quids 
\ No newline at end of file
+} // namespace quids
@@ -1,216 +1,263 @@
 #include "rollup/EmergencyExit.hpp"
+#include "utils/WorkStealingPool.hpp"
 #include <stdexcept>
 #include <cmath>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <cstring>
+#include <algorithm>
 
 namespace quids {
 namespace rollup {
 
-typedef quantum::QuantumState QuantumState;
-
 EmergencyExit::EmergencyExit(std::shared_ptr<StateManager> state_manager)
     : state_manager_(std::move(state_manager)) {}
 
+EmergencyExit::~EmergencyExit() {
+    stop();
+}
+
 bool EmergencyExit::verify_proof(const EmergencyProof& proof) {
     // Verify timestamp is not in the future
-    auto current_time = std::chrono::system_clock::now().time_since_epoch().count();
-    if (proof.timestamp > static_cast<uint64_t>(current_time)) {
+    if (proof.timestamp > now()) {
         return false;
     }
     
-    // Get current account state
-    auto account = state_manager_->get_account(proof.account_address);
-    if (!account) {
+    // Current leaf of the account, hashed in place rather than copied out
+    StateTrie::Hash leaf{};
+    if (!state_manager_->visit_account(proof.account_address, [&leaf](const StateManager::Account& account) {
+            leaf = StateManager::account_hash(account);
+        })) {
         return false;
     }
     
-    // Regenerate quantum state
-    quantum::QuantumState quantum_state = encode_state(account->balance, account->nonce);
-    
-    // Verify state root matches
-    std::vector<uint8_t> computed_state_root;
-    const Eigen::VectorXcd& state_vector = quantum_state.get_state_vector();
-    computed_state_root.reserve(state_vector.size() * 2 * sizeof(double));
-    
-    // Convert quantum state amplitudes to bytes safely
-    for (Eigen::Index i = 0; i < state_vector.size(); i++) {
-        double real_val = state_vector(i).real();
-        double imag_val = state_vector(i).imag();
-        
-        union {
-            double d;
-            uint8_t bytes[sizeof(double)];
-        } real_converter, imag_converter;
-        
-        real_converter.d = real_val;
-        imag_converter.d = imag_val;
-        
-        computed_state_root.insert(computed_state_root.end(), 
-                                 real_converter.bytes, 
-                                 real_converter.bytes + sizeof(double));
-        computed_state_root.insert(computed_state_root.end(), 
-                                 imag_converter.bytes, 
-                                 imag_converter.bytes + sizeof(double));
+    // The proof must open the current root to the current account state
+    auto root = state_manager_->get_state_root();
+    if (root != proof.state_root || root.size() != StateTrie::Hash{}.size()) {
+        return false;
     }
-    
-    if (computed_state_root != proof.state_root) {
+    StateTrie::Hash root_hash{};
+    std::copy(root.begin(), root.end(), root_hash.begin());
+    if (!StateTrie::verify(root_hash, proof.account_address,
+                           leaf, proof.account_proof)) {
         return false;
     }
     
-    // Verify signature
-    std::vector<uint8_t> message;
-    message.insert(message.end(), proof.account_address.begin(), proof.account_address.end());
-    
-    union {
-        uint64_t ts;
-        uint8_t bytes[sizeof(uint64_t)];
-    } ts_converter;
-    ts_converter.ts = proof.timestamp;
-    
-    message.insert(message.end(), 
-                  ts_converter.bytes, 
-                  ts_converter.bytes + sizeof(uint64_t));
-    message.insert(message.end(), proof.state_root.begin(), proof.state_root.end());
-    
     // TODO: Replace with actual cryptographic signature verification
-    return message == proof.signature;
+    return exit_message(proof.account_address, proof.timestamp, proof.state_root) == proof.signature;
 }
 
 bool EmergencyExit::process_exit(const EmergencyProof& proof) {
     if (!verify_proof(proof)) {
         return false;
     }
-    
-    auto account = state_manager_->get_account(proof.account_address);
-    if (!account) {
-        return false;
-    }
-    
-    // Process emergency exit by setting balance to 0
-    if (!state_manager_->set_balance(proof.account_address, 0)) {
-        return false;
-    }
-    
-    // Increment nonce
-    if (!state_manager_->set_nonce(proof.account_address, account->nonce + 1)) {
+
+    std::lock_guard<std::mutex> lock(exit_mutex_);
+    if (exited_.count(proof.account_address) || !apply_exit(proof.account_address)) {
         return false;
     }
-    
+    exited_.insert(proof.account_address);
     return true;
 }
 
 EmergencyProof EmergencyExit::generate_proof(const std::string& account_address) {
+    // During a mass exit the state is frozen at the checkpoint, so its
+    // witness is the one to hand out
+    if (auto current = latest()) {
+        auto it = current->witnesses.find(account_address);
+        if (it != current->witnesses.end() && current->root == state_manager_->get_state_root()) {
+            return it->second;
+        }
+    }
+
     EmergencyProof proof;
     proof.account_address = account_address;
     
-    // Get current account state
-    auto account = state_manager_->get_account(account_address);
-    if (!account) {
+    // Root and membership path come from one snapshot so they agree, and
+    // the walk does not hold the live state's lock
+    const auto view = state_manager_->snapshot();
+    auto membership = view.prove_account(account_address);
+    if (!membership) {
         throw std::runtime_error("Account not found");
     }
-    
-    // Generate quantum state encoding of account data
-    quantum::QuantumState quantum_state = encode_state(account->balance, account->nonce);
+    proof.state_root = view.get_state_root();
+    proof.account_proof = std::move(*membership);
     
     // Set current timestamp
-    proof.timestamp = static_cast<uint64_t>(
-        std::chrono::system_clock::now().time_since_epoch().count()
-    );
+    proof.timestamp = now();
     
-    // Generate state root from quantum state
-    std::vector<uint8_t> state_root;
-    const Eigen::VectorXcd& state_vector = quantum_state.get_state_vector();
-    state_root.reserve(state_vector.size() * 2 * sizeof(double));
+    // TODO: Replace with actual cryptographic signing when crypto module is ready
+    proof.signature = exit_message(account_address, proof.timestamp, proof.state_root);
+    
+    return proof;
+}
+
+std::vector<uint8_t> EmergencyExit::checkpoint() {
+    auto checkpoint = std::make_shared<Checkpoint>();
+    checkpoint->snapshot = state_manager_->snapshot();
+    checkpoint->root = checkpoint->snapshot.get_state_root();
+    const uint64_t timestamp = now();
+
+    std::vector<std::string> addresses;
+    addresses.reserve(checkpoint->snapshot.account_count());
+    checkpoint->snapshot.for_each_account([&](const std::string& address, const StateManager::Account&) {
+        addresses.push_back(address);
+    });
+
+    // The snapshot is immutable, so witnesses are built without holding up
+    // writers to the live state
+    std::vector<EmergencyProof> witnesses(addresses.size());
+    utils::WorkStealingPool::global().parallel_for(0, addresses.size(), [&](size_t i) {
+        auto membership = checkpoint->snapshot.prove_account(addresses[i]);
+        if (!membership) {
+            return;
+        }
+        auto& witness = witnesses[i];
+        witness.account_address = addresses[i];
+        witness.timestamp = timestamp;
+        witness.state_root = checkpoint->root;
+        witness.account_proof = std::move(*membership);
+        witness.signature = exit_message(witness.account_address, timestamp, witness.state_root);
+    }, utils::TaskPriority::Proof, 64);
+
+    checkpoint->witnesses.reserve(witnesses.size());
+    for (auto& witness : witnesses) {
+        if (!witness.account_address.empty()) {
+            auto address = witness.account_address;
+            checkpoint->witnesses.emplace(std::move(address), std::move(witness));
+        }
+    }
+
+    auto root = checkpoint->root;
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkpoint_ = std::move(checkpoint);
+    return root;
+}
+
+void EmergencyExit::start(std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (worker_.joinable()) {
+        throw std::logic_error("Checkpointing already running");
+    }
+    stopping_ = false;
+    worker_ = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            lock.unlock();
+            checkpoint();
+            lock.lock();
+            cv_.wait_for(lock, interval, [this] { return stopping_; });
+        }
+    });
+}
+
+void EmergencyExit::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+std::vector<uint8_t> EmergencyExit::checkpoint_root() const {
+    auto checkpoint = latest();
+    return checkpoint ? checkpoint->root : std::vector<uint8_t>{};
+}
+
+std::vector<bool> EmergencyExit::process_exits(std::span<const EmergencyProof> proofs) {
+    auto current = latest();
+    if (!current) {
+        checkpoint();
+        current = latest();
+    }
+
+    // Each proof is an independent path check against the same root
+    std::vector<uint8_t> valid(proofs.size(), 0);
+    utils::WorkStealingPool::global().parallel_for(0, proofs.size(), [&](size_t i) {
+        valid[i] = verify_against(proofs[i], current->snapshot, current->root);
+    }, utils::TaskPriority::Execution, 16);
+
+    std::vector<bool> accepted(proofs.size(), false);
+    std::lock_guard<std::mutex> lock(exit_mutex_);
+    for (size_t i = 0; i < proofs.size(); ++i) {
+        const auto& address = proofs[i].account_address;
+        if (valid[i] && !exited_.count(address) && apply_exit(address)) {
+            exited_.insert(address);
+            accepted[i] = true;
+        }
+    }
+    return accepted;
+}
+
+std::shared_ptr<const EmergencyExit::Checkpoint> EmergencyExit::latest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return checkpoint_;
+}
+
+bool EmergencyExit::verify_against(
+    const EmergencyProof& proof,
+    const StateManager::Snapshot& snapshot,
+    const std::vector<uint8_t>& root
+) const {
+    if (proof.timestamp > now() || proof.state_root != root || root.size() != StateTrie::Hash{}.size()) {
+        return false;
+    }
+    auto account = snapshot.get_account(proof.account_address);
+    if (!account) {
+        return false;
+    }
+    StateTrie::Hash root_hash{};
+    std::copy(root.begin(), root.end(), root_hash.begin());
+    if (!StateTrie::verify(root_hash, proof.account_address,
+                           StateManager::account_hash(*account), proof.account_proof)) {
+        return false;
+    }
+    // TODO: Replace with actual cryptographic signature verification
+    return exit_message(proof.account_address, proof.timestamp, proof.state_root) == proof.signature;
+}
+
+bool EmergencyExit::apply_exit(const std::string& account_address) {
+    // Setting the balance fails for an unknown account
+    const uint64_t nonce = state_manager_->get_nonce(account_address);
     
-    // Convert quantum state amplitudes to bytes safely
-    for (Eigen::Index i = 0; i < state_vector.size(); i++) {
-        double real_val = state_vector(i).real();
-        double imag_val = state_vector(i).imag();
-        
-        union {
-            double d;
-            uint8_t bytes[sizeof(double)];
-        } real_converter, imag_converter;
-        
-        real_converter.d = real_val;
-        imag_converter.d = imag_val;
-        
-        state_root.insert(state_root.end(), 
-                         real_converter.bytes, 
-                         real_converter.bytes + sizeof(double));
-        state_root.insert(state_root.end(), 
-                         imag_converter.bytes, 
-                         imag_converter.bytes + sizeof(double));
-    }
-    proof.state_root = state_root;
+    // Process emergency exit by setting balance to 0
+    if (!state_manager_->set_balance(account_address, 0)) {
+        return false;
+    }
     
-    // Generate signature (account_address + timestamp + state_root)
+    // Increment nonce
+    return state_manager_->set_nonce(account_address, nonce + 1);
+}
+
+std::vector<uint8_t> EmergencyExit::exit_message(
+    const std::string& account_address,
+    uint64_t timestamp,
+    const std::vector<uint8_t>& state_root
+) {
     std::vector<uint8_t> message;
+    message.reserve(account_address.size() + sizeof(timestamp) + state_root.size());
     message.insert(message.end(), account_address.begin(), account_address.end());
     
     union {
         uint64_t ts;
         uint8_t bytes[sizeof(uint64_t)];
     } ts_converter;
-    ts_converter.ts = proof.timestamp;
+    ts_converter.ts = timestamp;
     
     message.insert(message.end(), 
                   ts_converter.bytes, 
                   ts_converter.bytes + sizeof(uint64_t));
     message.insert(message.end(), state_root.begin(), state_root.end());
-    
-    // TODO: Replace with actual cryptographic signing when crypto module is ready
-    proof.signature = message;  // Placeholder - should use proper signing
-    
-    return proof;
+    return message;
 }
 
-quantum::QuantumState EmergencyExit::encode_state(uint64_t balance, uint64_t nonce) {
-    // We'll use 64 qubits for balance and 64 qubits for nonce = 128 qubits total
-    quantum::QuantumState state(128);
-    
-    // Prepare quantum state in computational basis
-    state.prepareState();
-    
-    // Encode balance bits
-    for (size_t i = 0; i < 64; i++) {
-        if (balance & (1ULL << i)) {
-            // Apply X gate (NOT) to flip qubit from |0⟩ to |1⟩ for 1 bits
-            Eigen::Matrix2cd x_gate;
-            x_gate << 0, 1,
-                     1, 0;
-            state.applySingleQubitGate(i, x_gate);
-        }
-    }
-    
-    // Encode nonce bits
-    for (size_t i = 0; i < 64; i++) {
-        if (nonce & (1ULL << i)) {
-            Eigen::Matrix2cd x_gate;
-            x_gate << 0, 1,
-                     1, 0;
-            state.applySingleQubitGate(i + 64, x_gate);
-        }
-    }
-    
-    // Apply Hadamard gates to create superposition
-    for (size_t i = 0; i < 128; i++) {
-        state.applyHadamard(i);
-    }
-    
-    // Create entanglement between balance and nonce qubits
-    for (size_t i = 0; i < 63; i++) {
-        state.apply_cnot(i, i + 64);
-    }
-    
-    // Normalize the final state
-    state.normalize();
-    
-    return state;
+uint64_t EmergencyExit::now() {
+    return static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
 }
 
 } // namespace rollup
-} // namespace quids 
\ No newline at end of file
+} // namespace quids
@@ -0,0 +1,435 @@
+#include "rollup/EncryptedMempool.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <blake3.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+using BnPtr = std::unique_ptr<BIGNUM, decltype(&BN_clear_free)>;
+using PointPtr = std::unique_ptr<EC_POINT, decltype(&EC_POINT_free)>;
+using CtxPtr = std::unique_ptr<BN_CTX, decltype(&BN_CTX_free)>;
+using CipherCtxPtr = std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>;
+
+class Sha256 {
+public:
+    Sha256() : ctx_(EVP_MD_CTX_new(), &EVP_MD_CTX_free) {
+        if (!ctx_ || !EVP_DigestInit_ex(ctx_.get(), EVP_sha256(), nullptr)) {
+            throw std::runtime_error("SHA-256 unavailable");
+        }
+    }
+
+    Sha256& update(const void* data, size_t size) {
+        EVP_DigestUpdate(ctx_.get(), data, size);
+        return *this;
+    }
+
+    std::array<uint8_t, 32> finish() {
+        std::array<uint8_t, 32> out{};
+        EVP_DigestFinal_ex(ctx_.get(), out.data(), nullptr);
+        return out;
+    }
+
+private:
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx_;
+};
+
+// Building the group precomputes generator tables, so each thread keeps one
+const EC_GROUP* group() {
+    thread_local std::unique_ptr<EC_GROUP, decltype(&EC_GROUP_free)> group(
+        EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1), &EC_GROUP_free);
+    if (!group) {
+        throw std::runtime_error("P-256 unavailable");
+    }
+    return group.get();
+}
+
+const BIGNUM* order() {
+    return EC_GROUP_get0_order(group());
+}
+
+BnPtr new_bn() {
+    BnPtr bn(BN_new(), &BN_clear_free);
+    if (!bn) {
+        throw std::bad_alloc();
+    }
+    return bn;
+}
+
+CtxPtr new_ctx() {
+    CtxPtr ctx(BN_CTX_new(), &BN_CTX_free);
+    if (!ctx) {
+        throw std::bad_alloc();
+    }
+    return ctx;
+}
+
+BnPtr to_bn(const ThresholdCipher::Scalar& scalar) {
+    auto bn = new_bn();
+    BN_bin2bn(scalar.data(), static_cast<int>(scalar.size()), bn.get());
+    return bn;
+}
+
+ThresholdCipher::Scalar to_scalar(const BIGNUM* bn) {
+    ThresholdCipher::Scalar scalar{};
+    BN_bn2binpad(bn, scalar.data(), static_cast<int>(scalar.size()));
+    return scalar;
+}
+
+// Uniform in [1, n)
+BnPtr random_scalar() {
+    auto bn = new_bn();
+    do {
+        if (!BN_rand_range(bn.get(), order())) {
+            throw std::runtime_error("RNG failure");
+        }
+    } while (BN_is_zero(bn.get()));
+    return bn;
+}
+
+ThresholdCipher::Point encode(const EC_POINT* point, BN_CTX* ctx) {
+    ThresholdCipher::Point out{};
+    if (EC_POINT_point2oct(group(), point, POINT_CONVERSION_COMPRESSED, out.data(), out.size(), ctx)
+        != out.size()) {
+        throw std::runtime_error("Cannot encode point");
+    }
+    return out;
+}
+
+// Null for bytes that are not a point on the curve
+PointPtr decode(const ThresholdCipher::Point& bytes, BN_CTX* ctx) {
+    PointPtr point(EC_POINT_new(group()), &EC_POINT_free);
+    if (!point || !EC_POINT_oct2point(group(), point.get(), bytes.data(), bytes.size(), ctx)) {
+        return {nullptr, &EC_POINT_free};
+    }
+    return point;
+}
+
+// scalar * G when `base` is null, otherwise scalar * base
+PointPtr multiply(const EC_POINT* base, const BIGNUM* scalar, BN_CTX* ctx) {
+    PointPtr out(EC_POINT_new(group()), &EC_POINT_free);
+    const bool ok = base ? EC_POINT_mul(group(), out.get(), nullptr, base, scalar, ctx)
+                         : EC_POINT_mul(group(), out.get(), scalar, nullptr, nullptr, ctx);
+    if (!out || !ok) {
+        throw std::runtime_error("Point multiplication failed");
+    }
+    return out;
+}
+
+// Payload key from the shared point; the ephemeral is bound in so the key
+// is unique to the ciphertext
+std::array<uint8_t, 32> derive_key(const ThresholdCipher::Point& shared, const ThresholdCipher::Point& ephemeral) {
+    static constexpr char DOMAIN[] = "quids/encrypted-mempool/v1";
+    return Sha256()
+        .update(DOMAIN, sizeof(DOMAIN) - 1)
+        .update(shared.data(), shared.size())
+        .update(ephemeral.data(), ephemeral.size())
+        .finish();
+}
+
+// Every key is used once, so a fixed nonce is safe
+bool seal(bool encrypting, const std::array<uint8_t, 32>& key, const ThresholdCipher::Ciphertext& header,
+          std::span<const uint8_t> in, std::vector<uint8_t>& out, std::array<uint8_t, ThresholdCipher::TAG_SIZE>& tag) {
+    static constexpr std::array<uint8_t, 12> NONCE{};
+    CipherCtxPtr ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+    if (!ctx || !EVP_CipherInit_ex(ctx.get(), EVP_chacha20_poly1305(), nullptr, key.data(), NONCE.data(),
+                                   encrypting ? 1 : 0)) {
+        return false;
+    }
+    if (!encrypting && !EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_AEAD_SET_TAG, static_cast<int>(tag.size()), tag.data())) {
+        return false;
+    }
+
+    int len = 0;
+    std::array<uint8_t, 8 + ThresholdCipher::POINT_SIZE> aad{};
+    for (size_t i = 0; i < 8; ++i) {
+        aad[i] = static_cast<uint8_t>(header.epoch >> (8 * i));
+    }
+    std::copy(header.ephemeral.begin(), header.ephemeral.end(), aad.begin() + 8);
+    if (!EVP_CipherUpdate(ctx.get(), nullptr, &len, aad.data(), static_cast<int>(aad.size()))) {
+        return false;
+    }
+
+    out.resize(in.size());
+    if (!in.empty() && !EVP_CipherUpdate(ctx.get(), out.data(), &len, in.data(), static_cast<int>(in.size()))) {
+        return false;
+    }
+    if (!EVP_CipherFinal_ex(ctx.get(), out.data() + out.size(), &len)) {
+        return false;
+    }
+    return !encrypting ||
+           EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_AEAD_GET_TAG, static_cast<int>(tag.size()), tag.data());
+}
+
+} // namespace
+
+ThresholdCipher::Hash ThresholdCipher::Ciphertext::id() const {
+    return Sha256()
+        .update(&epoch, sizeof(epoch))
+        .update(ephemeral.data(), ephemeral.size())
+        .update(body.data(), body.size())
+        .update(tag.data(), tag.size())
+        .finish();
+}
+
+std::pair<ThresholdCipher::EpochKey, std::vector<ThresholdCipher::SecretShare>> ThresholdCipher::deal(
+    uint64_t epoch, size_t threshold, size_t validators) {
+    if (threshold == 0 || threshold > validators) {
+        throw std::invalid_argument("Threshold must be between 1 and the number of validators");
+    }
+    auto ctx = new_ctx();
+
+    // f(x) = a0 + a1 x + ... + a(t-1) x^(t-1); the secret is f(0)
+    std::vector<BnPtr> coefficients;
+    coefficients.reserve(threshold);
+    for (size_t i = 0; i < threshold; ++i) {
+        coefficients.push_back(random_scalar());
+    }
+
+    EpochKey key;
+    key.epoch = epoch;
+    key.threshold = threshold;
+    key.public_key = encode(multiply(nullptr, coefficients[0].get(), ctx.get()).get(), ctx.get());
+
+    std::vector<SecretShare> shares;
+    shares.reserve(validators);
+    key.public_shares.reserve(validators);
+    auto x = new_bn();
+    auto value = new_bn();
+    for (size_t v = 1; v <= validators; ++v) {
+        BN_set_word(x.get(), v);
+        // Horner's rule, highest coefficient first
+        BN_zero(value.get());
+        for (size_t i = threshold; i-- > 0;) {
+            BN_mod_mul(value.get(), value.get(), x.get(), order(), ctx.get());
+            BN_mod_add(value.get(), value.get(), coefficients[i].get(), order(), ctx.get());
+        }
+        shares.push_back({static_cast<uint32_t>(v), to_scalar(value.get())});
+        key.public_shares.push_back(encode(multiply(nullptr, value.get(), ctx.get()).get(), ctx.get()));
+    }
+    return {std::move(key), std::move(shares)};
+}
+
+ThresholdCipher::Ciphertext ThresholdCipher::encrypt(const EpochKey& key, std::span<const uint8_t> plaintext) {
+    auto ctx = new_ctx();
+    auto public_key = decode(key.public_key, ctx.get());
+    if (!public_key) {
+        throw std::invalid_argument("Malformed epoch key");
+    }
+
+    auto r = random_scalar();
+    Ciphertext ciphertext;
+    ciphertext.epoch = key.epoch;
+    ciphertext.ephemeral = encode(multiply(nullptr, r.get(), ctx.get()).get(), ctx.get());
+    const auto shared = encode(multiply(public_key.get(), r.get(), ctx.get()).get(), ctx.get());
+
+    if (!seal(true, derive_key(shared, ciphertext.ephemeral), ciphertext, plaintext, ciphertext.body,
+              ciphertext.tag)) {
+        throw std::runtime_error("Encryption failed");
+    }
+    return ciphertext;
+}
+
+bool ThresholdCipher::verify_share(const EpochKey& key, const SecretShare& share) {
+    if (share.index == 0 || share.index > key.public_shares.size()) {
+        return false;
+    }
+    auto value = to_bn(share.value);
+    if (BN_is_zero(value.get()) || BN_cmp(value.get(), order()) >= 0) {
+        return false;
+    }
+    auto ctx = new_ctx();
+    return encode(multiply(nullptr, value.get(), ctx.get()).get(), ctx.get()) ==
+           key.public_shares[share.index - 1];
+}
+
+std::optional<ThresholdCipher::Scalar> ThresholdCipher::combine(const EpochKey& key,
+                                                                std::span<const SecretShare> shares) {
+    std::vector<const SecretShare*> chosen;
+    for (const auto& share : shares) {
+        if (chosen.size() == key.threshold) {
+            break;
+        }
+        bool duplicate = false;
+        for (const auto* other : chosen) {
+            duplicate |= other->index == share.index;
+        }
+        if (!duplicate && share.index != 0) {
+            chosen.push_back(&share);
+        }
+    }
+    if (chosen.size() < key.threshold) {
+        return std::nullopt;
+    }
+
+    // secret = sum of value_i * prod_{j != i} x_j / (x_j - x_i)
+    auto ctx = new_ctx();
+    auto secret = new_bn();
+    auto num = new_bn();
+    auto den = new_bn();
+    auto xi = new_bn();
+    auto xj = new_bn();
+    auto diff = new_bn();
+    auto term = new_bn();
+    BN_zero(secret.get());
+    for (const auto* share : chosen) {
+        BN_one(num.get());
+        BN_one(den.get());
+        BN_set_word(xi.get(), share->index);
+        for (const auto* other : chosen) {
+            if (other == share) {
+                continue;
+            }
+            BN_set_word(xj.get(), other->index);
+            BN_mod_mul(num.get(), num.get(), xj.get(), order(), ctx.get());
+            BN_mod_sub(diff.get(), xj.get(), xi.get(), order(), ctx.get());
+            BN_mod_mul(den.get(), den.get(), diff.get(), order(), ctx.get());
+        }
+        if (!BN_mod_inverse(den.get(), den.get(), order(), ctx.get())) {
+            return std::nullopt;
+        }
+        BN_mod_mul(term.get(), num.get(), den.get(), order(), ctx.get());
+        auto value = to_bn(share->value);
+        BN_mod_mul(term.get(), term.get(), value.get(), order(), ctx.get());
+        BN_mod_add(secret.get(), secret.get(), term.get(), order(), ctx.get());
+    }
+
+    if (encode(multiply(nullptr, secret.get(), ctx.get()).get(), ctx.get()) != key.public_key) {
+        return std::nullopt;
+    }
+    return to_scalar(secret.get());
+}
+
+std::optional<std::vector<uint8_t>> ThresholdCipher::decrypt(const Scalar& secret, const Ciphertext& ciphertext) {
+    auto ctx = new_ctx();
+    auto ephemeral = decode(ciphertext.ephemeral, ctx.get());
+    if (!ephemeral) {
+        return std::nullopt;
+    }
+    auto x = to_bn(secret);
+    const auto shared = encode(multiply(ephemeral.get(), x.get(), ctx.get()).get(), ctx.get());
+
+    std::vector<uint8_t> plaintext;
+    auto tag = ciphertext.tag;
+    if (!seal(false, derive_key(shared, ciphertext.ephemeral), ciphertext, ciphertext.body, plaintext, tag)) {
+        return std::nullopt;
+    }
+    return plaintext;
+}
+
+EncryptedMempool::EncryptedMempool(ThresholdCipher::EpochKey key) : key_(std::move(key)) {
+    if (key_.threshold == 0 || key_.threshold > key_.public_shares.size()) {
+        throw std::invalid_argument("Epoch key threshold out of range");
+    }
+}
+
+bool EncryptedMempool::submit(ThresholdCipher::Ciphertext ciphertext) {
+    if (ciphertext.epoch != key_.epoch) {
+        return false;
+    }
+    const auto id = ciphertext.id();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (commitment_ || !ids_.insert(id).second) {
+        return false;
+    }
+    ciphertexts_.push_back(std::move(ciphertext));
+    return true;
+}
+
+MEVProtection::OrderingCommitment EncryptedMempool::commit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (commitment_) {
+        return *commitment_;
+    }
+
+    MEVProtection::OrderingCommitment commitment;
+    commitment.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, &key_.epoch, sizeof(key_.epoch));
+    for (const auto& ciphertext : ciphertexts_) {
+        const auto id = ciphertext.id();
+        blake3_hasher_update(&hasher, id.data(), id.size());
+    }
+    blake3_hasher_finalize(&hasher, commitment.batch_hash.data(), commitment.batch_hash.size());
+    commitment_ = commitment;
+    return commitment;
+}
+
+size_t EncryptedMempool::add_shares(std::span<const ThresholdCipher::SecretShare> shares) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!commitment_) {
+            throw std::logic_error("Shares must not be released before the ordering is committed");
+        }
+    }
+
+    // Each check is a scalar multiplication; do them side by side
+    std::vector<uint8_t> valid(shares.size(), 0);
+    utils::WorkStealingPool::global().parallel_for(0, shares.size(), [&](size_t i) {
+        valid[i] = ThresholdCipher::verify_share(key_, shares[i]);
+    }, utils::TaskPriority::Execution);
+
+    size_t added = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < shares.size(); ++i) {
+        if (valid[i] && shares_.emplace(shares[i].index, shares[i]).second) {
+            ++added;
+        }
+    }
+    return added;
+}
+
+bool EncryptedMempool::ready() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return commitment_ && shares_.size() >= key_.threshold;
+}
+
+std::vector<EncryptedMempool::Payload> EncryptedMempool::decrypt_batch() {
+    std::vector<ThresholdCipher::SecretShare> shares;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!commitment_ || shares_.size() < key_.threshold) {
+            throw std::logic_error("Not enough decryption shares");
+        }
+        for (const auto& [index, share] : shares_) {
+            shares.push_back(share);
+        }
+    }
+
+    // One interpolation for the whole batch
+    const auto secret = ThresholdCipher::combine(key_, shares);
+    if (!secret) {
+        throw std::runtime_error("Decryption shares do not reconstruct the epoch key");
+    }
+
+    // Committed, so no longer written
+    std::vector<Payload> payloads(ciphertexts_.size());
+    utils::WorkStealingPool::global().parallel_for(0, ciphertexts_.size(), [&](size_t i) {
+        payloads[i] = ThresholdCipher::decrypt(*secret, ciphertexts_[i]);
+    }, utils::TaskPriority::Execution, 8);
+    return payloads;
+}
+
+std::vector<ThresholdCipher::Ciphertext> EncryptedMempool::ordering() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ciphertexts_;
+}
+
+size_t EncryptedMempool::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ciphertexts_.size();
+}
+
+} // namespace rollup
+} // namespace quids
@@ -5,10 +5,19 @@
 #include "rollup/RollupMLModel.hpp"
 #include "quantum/QuantumParameters.hpp"
 #include "rollup/OptimizationResult.hpp"
+#include "rollup/FeatureStore.hpp"
+#include "storage/TensorCheckpoint.hpp"
 #include <random>
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
 #include <spdlog/spdlog.h>
 #include <Eigen/Dense>
 
@@ -16,32 +25,299 @@ namespace quids {
 namespace rollup {
 
 namespace {
-    std::vector<double> engineer_advanced_features(
-        const RollupPerformanceMetrics& metrics) {
-        std::vector<double> features;
-        features.reserve(10);  // Prevent reallocations
-        
-        features.push_back(metrics.tx_throughput);
-        features.push_back(metrics.avg_tx_latency);
-        features.push_back(metrics.verification_time);
-        features.push_back(metrics.quantum_energy_usage);
-        return features;
+
+constexpr Eigen::Index NUM_FEATURES = 4;
+// Decoded by optimize_quantum_parameters()
+constexpr Eigen::Index NUM_OUTPUTS = 3;
+constexpr size_t EPOCHS = 10;
+// About an hour of snapshots at one per second
+constexpr size_t STORE_CAPACITY = 4096;
+
+// Samples are rows, so a batch of them is one contiguous block
+using RowMatrix = Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+using Int8Matrix = Eigen::Matrix<int8_t, Eigen::Dynamic, Eigen::Dynamic>;
+using Int32Matrix = Eigen::Matrix<int32_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// y = x W^T + b over a whole batch, so each layer is one GEMM
+struct Dense {
+    Eigen::Index out_dim{0};
+    Eigen::Index in_dim{0};
+    RowMatrix weight;          // empty while mapped
+    // Into a loaded checkpoint until the first training step after it
+    const float* mapped{nullptr};
+    Eigen::RowVectorXf bias;   // empty for none
+    bool relu{false};
+
+    // Adam moments; allocated by the first training step after a load
+    RowMatrix m_weight;
+    RowMatrix v_weight;
+    Eigen::RowVectorXf m_bias;
+    Eigen::RowVectorXf v_bias;
+
+    // int8 copy with one scale per output row
+    Int8Matrix q_weight;
+    Eigen::RowVectorXf q_scale;
+
+    Dense() = default;
+
+    Dense(Eigen::Index in, Eigen::Index out, bool with_bias, bool relu_)
+        : out_dim(out), in_dim(in), relu(relu_) {
+        // Glorot-uniform keeps activations in range through the stack
+        const float limit = std::sqrt(6.0f / static_cast<float>(in + out));
+        weight = RowMatrix::Random(out, in) * limit;
+        if (with_bias) {
+            bias = Eigen::RowVectorXf::Zero(out);
+        }
+        make_trainable();
     }
 
-    void update_model_with_adam(
-        const std::vector<Eigen::VectorXd>& gradients) {
-        (void)gradients; // Mark unused
+    Eigen::Map<const RowMatrix> weights() const {
+        return {mapped ? mapped : weight.data(), out_dim, in_dim};
     }
+
+    // Copy-on-write off the checkpoint
+    void make_trainable() {
+        if (mapped) {
+            weight = weights();
+            mapped = nullptr;
+        }
+        if (m_weight.size() == 0) {
+            m_weight = RowMatrix::Zero(out_dim, in_dim);
+            v_weight = RowMatrix::Zero(out_dim, in_dim);
+            m_bias = Eigen::RowVectorXf::Zero(bias.size());
+            v_bias = Eigen::RowVectorXf::Zero(bias.size());
+        }
+    }
+
+    void quantize() {
+        const auto w = weights();
+        q_scale = w.rowwise().lpNorm<Eigen::Infinity>().transpose() / 127.0f;
+        q_scale = (q_scale.array() > 0.0f).select(q_scale, 1.0f);
+        q_weight = (w.array().colwise() / q_scale.transpose().array())
+                       .round().cwiseMax(-127.0f).cwiseMin(127.0f).cast<int8_t>();
+    }
+};
+
+// Buffers sized by the first call of a shape and reused after it
+struct Workspace {
+    std::vector<RowMatrix> activations;
+    RowMatrix grad;
+    RowMatrix grad_next;
+    RowMatrix grad_weight;
+    Int32Matrix quantized_input;
+    Int32Matrix widened_weight;
+    Int32Matrix accumulator;
+    Eigen::VectorXf input_scale;
+};
+
+void fill_features(const RollupPerformanceMetrics& metrics, Eigen::Ref<Eigen::RowVectorXf> row) {
+    row(0) = static_cast<float>(metrics.tx_throughput);
+    row(1) = static_cast<float>(metrics.avg_tx_latency);
+    row(2) = static_cast<float>(metrics.verification_time);
+    row(3) = static_cast<float>(metrics.quantum_energy_usage);
+}
+
+void fill_targets(const QuantumParameters& params, Eigen::Ref<Eigen::RowVectorXf> row) {
+    row(0) = params.phase_angles.empty() ? 0.0f : static_cast<float>(params.phase_angles.front());
+    row(1) = static_cast<float>(params.num_qubits) / 1000.0f;
+    row(2) = static_cast<float>((params.entanglement_degree - 0.9) / 0.1);
+}
+
+std::string layer_name(size_t index, const char* part) {
+    return "layer." + std::to_string(index) + "." + part;
+}
+
+double or_default(double value, double lo, double hi, double fallback) {
+    return value > lo && value < hi ? value : fallback;
+}
+
 } // namespace
 
 struct EnhancedRollupMLModel::Impl {
-    std::vector<Eigen::MatrixXd> attention_layers;
-    std::vector<Eigen::MatrixXd> weights;
-    std::vector<Eigen::VectorXd> biases;
     ModelParameters params;
+    // Input projection, then an attention mix and a feed-forward layer per
+    // block, then the output head
+    std::vector<Dense> layers;
+    // Keeps mapped layer weights alive
+    std::shared_ptr<const storage::TensorCheckpoint> backing;
+    Eigen::RowVectorXf feature_mean{Eigen::RowVectorXf::Zero(NUM_FEATURES)};
+    Eigen::RowVectorXf feature_scale{Eigen::RowVectorXf::Ones(NUM_FEATURES)};
+    bool fitted{false};
+    size_t batch_size{32};
+    uint64_t adam_step{0};
+    bool quantized{false};
+
+    // Training writes the layers; inference only reads them
+    mutable std::shared_mutex mutex;
+    Workspace train_workspace;
+    // Bumped whenever the weights change
+    std::atomic<uint64_t> version{0};
+
+    FeatureStore store{STORE_CAPACITY, NUM_FEATURES, NUM_OUTPUTS};
+    // Serializes train_incremental() callers and guards cursor
+    std::mutex online_mutex;
+    uint64_t cursor{0};
+
+    std::thread checkpoint_thread;
+    std::mutex checkpoint_mutex;
+    std::condition_variable checkpoint_cv;
+    bool checkpoint_stop{false};
 
     Impl(const ModelParameters& init_params) 
         : params(init_params) {}
+
+    // Caller holds mutex exclusively
+    void fit_normalization(const RowMatrix& features) {
+        const auto samples = static_cast<float>(features.rows());
+        feature_mean = features.colwise().mean();
+        const Eigen::RowVectorXf deviation =
+            ((features.rowwise() - feature_mean).colwise().squaredNorm() / samples).cwiseSqrt();
+        feature_scale = (deviation.array() > 1e-6f).select(deviation.cwiseInverse(), 1.0f);
+        fitted = true;
+    }
+
+    // Caller holds mutex exclusively
+    void fit(const RowMatrix& inputs, const RowMatrix& targets, size_t epochs) {
+        const auto batch = static_cast<Eigen::Index>(std::max<size_t>(1, batch_size));
+        const Eigen::Index rows = inputs.rows();
+        for (size_t epoch = 0; epoch < epochs; ++epoch) {
+            for (Eigen::Index start = 0; start < rows; start += batch) {
+                const Eigen::Index count = std::min(batch, rows - start);
+                step(inputs.middleRows(start, count), targets.middleRows(start, count));
+            }
+        }
+        if (quantized) {
+            requantize();
+        }
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    // Caller holds mutex, shared is enough
+    storage::TensorCheckpoint::Writer checkpoint() const {
+        storage::TensorCheckpoint::Writer writer;
+        writer.add<float>("feature_mean", {NUM_FEATURES}, {feature_mean.data(), NUM_FEATURES});
+        writer.add<float>("feature_scale", {NUM_FEATURES}, {feature_scale.data(), NUM_FEATURES});
+        for (size_t l = 0; l < layers.size(); ++l) {
+            const Dense& layer = layers[l];
+            const auto w = layer.weights();
+            writer.add<float>(layer_name(l, "weight"),
+                              {static_cast<uint64_t>(layer.out_dim), static_cast<uint64_t>(layer.in_dim)},
+                              {w.data(), static_cast<size_t>(w.size())});
+            if (layer.bias.size() > 0) {
+                writer.add<float>(layer_name(l, "bias"), {static_cast<uint64_t>(layer.out_dim)},
+                                  {layer.bias.data(), static_cast<size_t>(layer.bias.size())});
+            }
+        }
+        return writer;
+    }
+
+    void build() {
+        const auto hidden = static_cast<Eigen::Index>(std::max<size_t>(1, params.hidden_size));
+        layers.clear();
+        layers.emplace_back(NUM_FEATURES, hidden, true, true);
+        for (size_t i = 0; i < params.num_layers; ++i) {
+            // Mixing starts near identity so deep stacks still pass signal
+            Dense attention(hidden, hidden, false, false);
+            attention.weight = RowMatrix::Identity(hidden, hidden) +
+                               RowMatrix::Random(hidden, hidden) * 0.01f;
+            layers.push_back(std::move(attention));
+            layers.emplace_back(hidden, hidden, true, true);
+        }
+        layers.emplace_back(hidden, NUM_OUTPUTS, true, false);
+        backing.reset();
+        adam_step = 0;
+        if (quantized) {
+            requantize();
+        }
+    }
+
+    void requantize() {
+        for (auto& layer : layers) {
+            layer.quantize();
+        }
+    }
+
+    // Leaves the output in ws.activations.back()
+    void forward(const Eigen::Ref<const RowMatrix>& input, Workspace& ws, bool use_int8) const {
+        ws.activations.resize(layers.size() + 1);
+        ws.activations[0] = input;
+        for (size_t l = 0; l < layers.size(); ++l) {
+            const Dense& layer = layers[l];
+            const RowMatrix& in = ws.activations[l];
+            RowMatrix& out = ws.activations[l + 1];
+            if (use_int8) {
+                // Per-sample activation scales; int32 accumulation
+                ws.input_scale = in.cwiseAbs().rowwise().maxCoeff() / 127.0f;
+                ws.input_scale = (ws.input_scale.array() > 0.0f).select(ws.input_scale, 1.0f);
+                ws.quantized_input = (in.array().colwise() / ws.input_scale.array()).round().cast<int32_t>();
+                ws.widened_weight = layer.q_weight.cast<int32_t>();
+                ws.accumulator.noalias() = ws.quantized_input * ws.widened_weight.transpose();
+                out = ws.accumulator.cast<float>();
+                out.array().colwise() *= ws.input_scale.array();
+                out.array().rowwise() *= layer.q_scale.array();
+            } else {
+                out.noalias() = in * layer.weights().transpose();
+            }
+            if (layer.bias.size() > 0) {
+                out.rowwise() += layer.bias;
+            }
+            if (layer.relu) {
+                out = out.cwiseMax(0.0f);
+            }
+        }
+    }
+
+    RowMatrix normalize(RowMatrix features) const {
+        features.rowwise() -= feature_mean;
+        features.array().rowwise() *= feature_scale.array();
+        return features;
+    }
+
+    // One Adam step on a minibatch; returns its mean squared error
+    float step(const Eigen::Ref<const RowMatrix>& input, const Eigen::Ref<const RowMatrix>& target) {
+        Workspace& ws = train_workspace;
+        forward(input, ws, false);
+
+        const float n = static_cast<float>(input.rows());
+        ws.grad = ws.activations.back() - target;
+        const float loss = ws.grad.squaredNorm() / n;
+        ws.grad *= 2.0f / n;
+
+        ++adam_step;
+        const float lr = static_cast<float>(or_default(params.learning_rate, 0.0, 1.0, 1e-3));
+        const float beta1 = static_cast<float>(or_default(params.beta1, 0.0, 1.0, 0.9));
+        const float beta2 = static_cast<float>(or_default(params.beta2, 0.0, 1.0, 0.999));
+        const float eps = static_cast<float>(or_default(params.epsilon, 0.0, 1.0, 1e-8));
+        const float correction1 = 1.0f - std::pow(beta1, static_cast<float>(adam_step));
+        const float correction2 = 1.0f - std::pow(beta2, static_cast<float>(adam_step));
+        const float step_size = lr * std::sqrt(correction2) / correction1;
+
+        auto adam = [&](auto& param, auto& m, auto& v, const auto& g) {
+            m = beta1 * m + (1.0f - beta1) * g;
+            v = beta2 * v + (1.0f - beta2) * g.cwiseProduct(g);
+            param.array() -= step_size * m.array() / (v.array().sqrt() + eps);
+        };
+
+        for (size_t l = layers.size(); l-- > 0;) {
+            Dense& layer = layers[l];
+            layer.make_trainable();
+            if (layer.relu) {
+                ws.grad.array() *= (ws.activations[l + 1].array() > 0.0f).cast<float>();
+            }
+            ws.grad_weight.noalias() = ws.grad.transpose() * ws.activations[l];
+            if (l > 0) {
+                // Input gradient before the weights move
+                ws.grad_next.noalias() = ws.grad * layer.weight;
+            }
+            adam(layer.weight, layer.m_weight, layer.v_weight, ws.grad_weight);
+            if (layer.bias.size() > 0) {
+                const Eigen::RowVectorXf grad_bias = ws.grad.colwise().sum();
+                adam(layer.bias, layer.m_bias, layer.v_bias, grad_bias);
+            }
+            std::swap(ws.grad, ws.grad_next);
+        }
+        return loss;
+    }
 };
 
 EnhancedRollupMLModel::EnhancedRollupMLModel(const ModelParameters& params)
@@ -52,23 +328,8 @@ EnhancedRollupMLModel::EnhancedRollupMLModel(const ModelParameters& params)
 }
 
 void EnhancedRollupMLModel::initialize_model() {
-    impl_->attention_layers.clear();
-    impl_->weights.clear();
-    impl_->biases.clear();
-    
-    const auto hidden_size = static_cast<Eigen::Index>(impl_->params.hidden_size);
-    
-    for (size_t i = 0; i < impl_->params.num_layers; ++i) {
-        impl_->attention_layers.emplace_back(
-            Eigen::MatrixXd::Random(hidden_size, hidden_size) * 0.01
-        );
-        impl_->weights.emplace_back(
-            Eigen::MatrixXd::Random(hidden_size, hidden_size) * 0.01
-        );
-        impl_->biases.emplace_back(
-            Eigen::VectorXd::Zero(hidden_size)
-        );
-    }
+    std::unique_lock<std::shared_mutex> lock(impl_->mutex);
+    impl_->build();
 }
 
 OptimizationResult EnhancedRollupMLModel::train_model() {
@@ -83,22 +344,10 @@ void EnhancedRollupMLModel::optimize_chain_parameters(
 }
 
 void EnhancedRollupMLModel::initialize_transformer() {
-    const auto hidden_size = static_cast<Eigen::Index>(impl_->params.hidden_size);
-    
-    impl_->attention_layers.clear();
-    impl_->weights.clear();
-    impl_->biases.clear();
-    
-    for (size_t i = 0; i < impl_->params.num_layers; ++i) {
-        impl_->attention_layers.emplace_back(
-            Eigen::MatrixXd::Random(hidden_size, hidden_size) * 0.01
-        );
-        impl_->weights.emplace_back(
-            Eigen::MatrixXd::Random(hidden_size, hidden_size) * 0.01
-        );
-        impl_->biases.emplace_back(
-            Eigen::VectorXd::Zero(hidden_size)
-        );
+    // The attention blocks are part of the dense stack
+    std::unique_lock<std::shared_mutex> lock(impl_->mutex);
+    if (impl_->layers.empty()) {
+        impl_->build();
     }
 }
 
@@ -109,51 +358,211 @@ void EnhancedRollupMLModel::initialize_optimizer() {
 void EnhancedRollupMLModel::train(
     const std::vector<RollupPerformanceMetrics>& metrics_history,
     const std::vector<QuantumParameters>& param_history) {
-    if (metrics_history.empty() || param_history.empty()) {
+    const size_t samples = std::min(metrics_history.size(), param_history.size());
+    if (samples == 0) {
         return;
     }
     
-    // Convert metrics to feature vectors
-    std::vector<Eigen::VectorXd> features;
-    for (const auto& metrics : metrics_history) {
-        auto raw_features = engineer_advanced_features(metrics);
-        features.push_back(Eigen::VectorXd::Map(
-            raw_features.data(), 
-            raw_features.size()
-        ));
+    // The whole history as two contiguous samples x columns matrices
+    RowMatrix features(samples, NUM_FEATURES);
+    RowMatrix targets(samples, NUM_OUTPUTS);
+    for (size_t i = 0; i < samples; ++i) {
+        fill_features(metrics_history[i], features.row(static_cast<Eigen::Index>(i)));
+        fill_targets(param_history[i], targets.row(static_cast<Eigen::Index>(i)));
     }
-    
-    // Training loop
-    const size_t batch_size = 32;  // Fixed batch size
-    for (size_t epoch = 0; epoch < 10; ++epoch) {
-        double total_loss = 0.0;
-        (void)total_loss; // Mark unused
-        
-        for (size_t i = 0; i < features.size(); i += batch_size) {
-            // Process batch and compute gradients
-            std::vector<Eigen::VectorXd> gradients;
-            
-            // Update weights using Adam
-            update_model_with_adam(gradients);
+
+    std::unique_lock<std::shared_mutex> lock(impl_->mutex);
+    // Throughput and energy are orders of magnitude above latency; train
+    // and predict on standardized features
+    impl_->fit_normalization(features);
+    impl_->fit(impl_->normalize(std::move(features)), targets, EPOCHS);
+}
+
+void EnhancedRollupMLModel::observe(const RollupPerformanceMetrics& metrics, const QuantumParameters& params) {
+    Eigen::RowVectorXf features(NUM_FEATURES);
+    Eigen::RowVectorXf targets(NUM_OUTPUTS);
+    fill_features(metrics, features);
+    fill_targets(params, targets);
+    impl_->store.push(features, targets);
+}
+
+size_t EnhancedRollupMLModel::train_incremental() {
+    std::lock_guard<std::mutex> online(impl_->online_mutex);
+    RowMatrix features;
+    RowMatrix targets;
+    impl_->cursor = impl_->store.read_since(impl_->cursor, features, targets);
+    if (features.rows() == 0) {
+        return 0;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(impl_->mutex);
+    // Scaling moves only with a full retrain, so earlier steps stay valid
+    if (!impl_->fitted) {
+        impl_->fit_normalization(features);
+    }
+    impl_->fit(impl_->normalize(std::move(features)), targets, 1);
+    return static_cast<size_t>(targets.rows());
+}
+
+void EnhancedRollupMLModel::save_model(const std::string& path) const {
+    storage::TensorCheckpoint::Writer writer;
+    {
+        std::shared_lock<std::shared_mutex> lock(impl_->mutex);
+        writer = impl_->checkpoint();
+    }
+    writer.write(path);
+}
+
+bool EnhancedRollupMLModel::load_model(const std::string& path) {
+    auto checkpoint = storage::TensorCheckpoint::open(path);
+    if (!checkpoint) {
+        return false;
+    }
+    auto floats = [&](const std::string& name, std::initializer_list<Eigen::Index> shape) -> const float* {
+        const auto* view = checkpoint->find(name);
+        if (!view || view->dtype != storage::TensorCheckpoint::DType::Float32 ||
+            view->shape.size() != shape.size() ||
+            !std::equal(shape.begin(), shape.end(), view->shape.begin(),
+                        [](Eigen::Index want, uint64_t have) { return static_cast<uint64_t>(want) == have; })) {
+            return nullptr;
         }
+        return view->as<float>().data();
+    };
+
+    // The new stack points into the mapping; only biases are copied
+    std::vector<Dense> layers;
+    size_t tensors = 2;
+    {
+        std::shared_lock<std::shared_mutex> lock(impl_->mutex);
+        layers.resize(impl_->layers.size());
+        for (size_t l = 0; l < layers.size(); ++l) {
+            const Dense& current = impl_->layers[l];
+            Dense& next = layers[l];
+            next.out_dim = current.out_dim;
+            next.in_dim = current.in_dim;
+            next.relu = current.relu;
+            next.mapped = floats(layer_name(l, "weight"), {current.out_dim, current.in_dim});
+            if (!next.mapped) {
+                return false;
+            }
+            ++tensors;
+            if (current.bias.size() > 0) {
+                const float* bias = floats(layer_name(l, "bias"), {current.out_dim});
+                if (!bias) {
+                    return false;
+                }
+                next.bias = Eigen::Map<const Eigen::RowVectorXf>(bias, current.out_dim);
+                ++tensors;
+            }
+        }
+    }
+    const float* mean = floats("feature_mean", {NUM_FEATURES});
+    const float* scale = floats("feature_scale", {NUM_FEATURES});
+    if (!mean || !scale || checkpoint->size() != tensors) {
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(impl_->mutex);
+    if (impl_->quantized) {
+        for (auto& layer : layers) {
+            layer.quantize();
+        }
+    }
+    // Inference sees the old stack or the new one, never a mix; the old
+    // mapping goes when the last reference to it does
+    impl_->layers.swap(layers);
+    impl_->backing = std::move(checkpoint);
+    impl_->feature_mean = Eigen::Map<const Eigen::RowVectorXf>(mean, NUM_FEATURES);
+    impl_->feature_scale = Eigen::Map<const Eigen::RowVectorXf>(scale, NUM_FEATURES);
+    impl_->fitted = true;
+    impl_->adam_step = 0;
+    impl_->version.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+void EnhancedRollupMLModel::start_checkpoints(const std::string& path, std::chrono::milliseconds interval) {
+    stop_checkpoints();
+    impl_->checkpoint_stop = false;
+    impl_->checkpoint_thread = std::thread([this, path, interval]() {
+        // The first tick always saves
+        uint64_t saved = std::numeric_limits<uint64_t>::max();
+        std::unique_lock<std::mutex> lock(impl_->checkpoint_mutex);
+        while (!impl_->checkpoint_cv.wait_for(lock, interval, [this] { return impl_->checkpoint_stop; })) {
+            const uint64_t current = impl_->version.load(std::memory_order_acquire);
+            if (current == saved) {
+                continue;
+            }
+            lock.unlock();
+            try {
+                save_model(path);
+                saved = current;
+            } catch (const std::exception& e) {
+                spdlog::warn("Model checkpoint failed: {}", e.what());
+            }
+            lock.lock();
+        }
+    });
+}
+
+void EnhancedRollupMLModel::stop_checkpoints() {
+    {
+        std::lock_guard<std::mutex> lock(impl_->checkpoint_mutex);
+        impl_->checkpoint_stop = true;
+    }
+    impl_->checkpoint_cv.notify_all();
+    if (impl_->checkpoint_thread.joinable()) {
+        impl_->checkpoint_thread.join();
     }
 }
 
+Eigen::MatrixXf EnhancedRollupMLModel::predict_batch(
+    const std::vector<RollupPerformanceMetrics>& metrics) const {
+    RowMatrix features(static_cast<Eigen::Index>(metrics.size()), NUM_FEATURES);
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        fill_features(metrics[i], features.row(static_cast<Eigen::Index>(i)));
+    }
+
+    thread_local Workspace workspace;
+    std::shared_lock<std::shared_mutex> lock(impl_->mutex);
+    impl_->forward(impl_->normalize(std::move(features)), workspace, impl_->quantized);
+    return workspace.activations.back();
+}
+
+void EnhancedRollupMLModel::set_quantized_inference(bool enabled) {
+    std::unique_lock<std::shared_mutex> lock(impl_->mutex);
+    impl_->quantized = enabled;
+    if (enabled) {
+        impl_->requantize();
+    }
+}
+
+void EnhancedRollupMLModel::set_learning_rate(double rate) {
+    std::unique_lock<std::shared_mutex> lock(impl_->mutex);
+    impl_->params.learning_rate = rate;
+}
+
+void EnhancedRollupMLModel::set_batch_size(size_t size) {
+    std::unique_lock<std::shared_mutex> lock(impl_->mutex);
+    impl_->batch_size = std::max<size_t>(1, size);
+}
+
 Eigen::VectorXd EnhancedRollupMLModel::forward_pass(const Eigen::VectorXd& features) const {
-    Eigen::VectorXd current = features;
-    for (size_t i = 0; i < impl_->params.num_layers; ++i) {
-        current = impl_->attention_layers[i] * current; // Self-attention
-        current = impl_->weights[i] * current + impl_->biases[i]; // Feed-forward
-        current = current.array().max(0.0); // ReLU activation
+    if (features.size() != NUM_FEATURES) {
+        throw std::invalid_argument("Expected the engineered feature vector");
     }
-    return current;
+    RowMatrix row = features.transpose().cast<float>();
+
+    thread_local Workspace workspace;
+    std::shared_lock<std::shared_mutex> lock(impl_->mutex);
+    impl_->forward(impl_->normalize(std::move(row)), workspace, impl_->quantized);
+    return workspace.activations.back().row(0).transpose().cast<double>();
 }
 
 QuantumParameters EnhancedRollupMLModel::optimize_quantum_parameters(
     const Eigen::VectorXd& prediction) const {
     return QuantumParameters(
         std::vector<double>{prediction[0]},  // phase_angles
-        static_cast<size_t>(prediction[1] * 1000),  // num_qubits
+        static_cast<size_t>(std::max(0.0, prediction[1] * 1000)),  // num_qubits
         0.9 + prediction[2] * 0.1,  // entanglement_degree
         true  // use_quantum_execution
     );
@@ -335,7 +744,10 @@ double sigmoid(double x) {
 }
 
 // Add destructor implementation after Impl definition
-EnhancedRollupMLModel::~EnhancedRollupMLModel() = default;
+EnhancedRollupMLModel::~EnhancedRollupMLModel() {
+    // The checkpoint thread calls back into this object
+    stop_checkpoints();
+}
 
 } // namespace rollup
 } // namespace quids
\ No newline at end of file
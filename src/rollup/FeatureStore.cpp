@@ -0,0 +1,64 @@
+#include "rollup/FeatureStore.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+FeatureStore::FeatureStore(size_t capacity, Eigen::Index feature_dim, Eigen::Index target_dim)
+    : capacity_(capacity),
+      features_(static_cast<Eigen::Index>(capacity), feature_dim),
+      targets_(static_cast<Eigen::Index>(capacity), target_dim),
+      charge_(memory::Subsystem::MlModels,
+              static_cast<size_t>(features_.size() + targets_.size()) * sizeof(float)) {
+    if (capacity == 0) {
+        throw std::invalid_argument("FeatureStore capacity must be positive");
+    }
+}
+
+void FeatureStore::push(const Eigen::Ref<const Eigen::RowVectorXf>& features,
+                        const Eigen::Ref<const Eigen::RowVectorXf>& targets) {
+    if (features.size() != features_.cols() || targets.size() != targets_.cols()) {
+        throw std::invalid_argument("Sample does not match the store's dimensions");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto slot = static_cast<Eigen::Index>(total_ % capacity_);
+    features_.row(slot) = features;
+    targets_.row(slot) = targets;
+    ++total_;
+}
+
+uint64_t FeatureStore::read_since(uint64_t cursor, Matrix& features, Matrix& targets) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t oldest = total_ > capacity_ ? total_ - capacity_ : 0;
+    const uint64_t first = std::clamp(cursor, oldest, total_);
+    const auto count = static_cast<Eigen::Index>(total_ - first);
+
+    features.resize(count, features_.cols());
+    targets.resize(count, targets_.cols());
+    // At most two contiguous runs: up to the end of the ring, then from
+    // its start
+    const auto rows = static_cast<Eigen::Index>(capacity_);
+    const auto start = static_cast<Eigen::Index>(first % capacity_);
+    const Eigen::Index head = std::min(count, rows - start);
+    features.topRows(head) = features_.middleRows(start, head);
+    targets.topRows(head) = targets_.middleRows(start, head);
+    if (count > head) {
+        features.bottomRows(count - head) = features_.topRows(count - head);
+        targets.bottomRows(count - head) = targets_.topRows(count - head);
+    }
+    return total_;
+}
+
+size_t FeatureStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<size_t>(std::min<uint64_t>(total_, capacity_));
+}
+
+uint64_t FeatureStore::total() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -11,6 +11,8 @@
 #include <cmath>
 #include <unordered_map>
 #include <cassert>
+#include <set>
+#include "utils/WorkStealingPool.hpp"
 
 namespace quids {
 namespace rollup {
@@ -18,6 +20,54 @@ namespace rollup {
 using quantum::QuantumState;
 using zkp::QZKPGenerator;
 
+namespace {
+
+FraudProof::Hash to_hash(const std::vector<uint8_t>& root) {
+    if (root.size() < 32) {
+        throw std::runtime_error("Invalid state root size");
+    }
+    FraudProof::Hash hash{};
+    std::copy_n(root.begin(), hash.size(), hash.begin());
+    return hash;
+}
+
+// Accounts are read back from the state, so each address appears once with
+// its latest value however many transactions wrote it
+FraudProof::Writes collect_writes(const StateManager& state, const std::set<std::string>& touched) {
+    FraudProof::Writes writes;
+    writes.reserve(touched.size());
+    for (const auto& address : touched) {
+        if (auto account = state.get_account(address)) {
+            writes.emplace_back(address, std::move(*account));
+        }
+    }
+    return writes;
+}
+
+} // namespace
+
+FraudProof::Bisection::Bisection(StateClaim agreed, StateClaim disputed)
+    : agreed_(std::move(agreed)), disputed_(std::move(disputed)) {
+    if (disputed_.index <= agreed_.index) {
+        throw std::invalid_argument("Disputed claim must come after the agreed one");
+    }
+}
+
+size_t FraudProof::Bisection::midpoint() const {
+    return agreed_.index + (disputed_.index - agreed_.index) / 2;
+}
+
+void FraudProof::Bisection::respond(StateClaim claim, bool challenger_agrees) {
+    if (resolved()) {
+        throw std::logic_error("Bisection already narrowed to one transaction");
+    }
+    if (claim.index != midpoint()) {
+        throw std::invalid_argument("Claim is not at the bisection midpoint");
+    }
+    (challenger_agrees ? agreed_ : disputed_) = std::move(claim);
+    ++rounds_;
+}
+
 
 // FraudProof::FraudProof(std::shared_ptr<QZKPGenerator> zkp_generator)
 //     : zkp_generator_(std::move(zkp_generator)) {
@@ -29,7 +79,7 @@ using zkp::QZKPGenerator;
 FraudProof::InvalidTransitionProof FraudProof::generate_fraud_proof(
     std::unique_ptr<quids::rollup::StateManager> pre_state,
     std::unique_ptr<quids::rollup::StateManager> post_state,
-    const std::vector<quids::blockchain::Transaction>& transactions
+    const std::vector<quids::blockchain::TransactionPtr>& transactions
 ) {
     InvalidTransitionProof proof;
     
@@ -94,6 +144,157 @@ FraudProof::FraudVerificationResult FraudProof::verify_fraud_proof(
     return result;
 }
 
+FraudProof::StateClaim FraudProof::initial_claim(const quids::rollup::StateManager& pre_state) {
+    StateClaim claim;
+    claim.root = to_hash(pre_state.get_state_root());
+    return claim;
+}
+
+void FraudProof::trace(
+    const quids::rollup::StateManager& pre_state,
+    const std::vector<quids::blockchain::TransactionPtr>& transactions,
+    size_t stride,
+    const ClaimSink& sink
+) {
+    stride = std::max<size_t>(1, stride);
+    auto state = pre_state.clone();
+    std::set<std::string> touched;
+
+    for (size_t i = 0; i < transactions.size(); ++i) {
+        const auto& tx = *transactions[i];
+        if (state->apply_transaction(tx)) {
+            touched.insert(tx.getSender());
+            touched.insert(tx.getRecipient());
+        }
+
+        const size_t index = i + 1;
+        if (index % stride == 0 || index == transactions.size()) {
+            StateClaim claim;
+            claim.index = index;
+            claim.root = to_hash(state->get_state_root());
+            claim.writes = collect_writes(*state, touched);
+            if (!sink(std::move(claim))) {
+                return;
+            }
+        }
+    }
+}
+
+bool FraudProof::consistent(const quids::rollup::StateManager& pre_state, const StateClaim& claim) {
+    std::vector<std::pair<std::string, StateTrie::Hash>> leaves;
+    leaves.reserve(claim.writes.size());
+    for (const auto& [address, account] : claim.writes) {
+        leaves.emplace_back(address, StateManager::account_hash(account));
+    }
+    const auto root = pre_state.root_after(leaves);
+    return std::equal(root.begin(), root.end(), claim.root.begin(), claim.root.end());
+}
+
+std::unique_ptr<quids::rollup::StateManager> FraudProof::materialize(
+    const quids::rollup::StateManager& pre_state,
+    const StateClaim& claim
+) {
+    auto state = pre_state.clone();
+    for (const auto& [address, account] : claim.writes) {
+        state->add_account(address, account);
+    }
+    return state;
+}
+
+std::optional<size_t> FraudProof::find_divergent_segment(
+    const quids::rollup::StateManager& pre_state,
+    const std::vector<quids::blockchain::TransactionPtr>& transactions,
+    const std::vector<StateClaim>& checkpoints
+) {
+    if (checkpoints.empty() || checkpoints.back().index != transactions.size()) {
+        throw std::invalid_argument("Checkpoints must end after the last transaction");
+    }
+    for (size_t i = 1; i < checkpoints.size(); ++i) {
+        if (checkpoints[i].index <= checkpoints[i - 1].index) {
+            throw std::invalid_argument("Checkpoints must be in increasing order");
+        }
+    }
+
+    const StateClaim initial = initial_claim(pre_state);
+    std::vector<uint8_t> divergent(checkpoints.size(), 0);
+
+    // Each segment starts from its claimed state, so none waits for the
+    // one before it. A start that is itself wrong is caught as the end of
+    // the previous segment, which is reported first.
+    utils::WorkStealingPool::global().parallel_for(0, checkpoints.size(), [&](size_t i) {
+        const StateClaim& start = i == 0 ? initial : checkpoints[i - 1];
+        const StateClaim& end = checkpoints[i];
+        if (!consistent(pre_state, end)) {
+            divergent[i] = 1;
+            return;
+        }
+        auto state = materialize(pre_state, start);
+        for (size_t t = start.index; t < end.index; ++t) {
+            state->apply_transaction(*transactions[t]);
+        }
+        divergent[i] = to_hash(state->get_state_root()) != end.root;
+    }, utils::TaskPriority::Execution);
+
+    for (size_t i = 0; i < divergent.size(); ++i) {
+        if (divergent[i]) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+FraudProof::FraudVerificationResult FraudProof::verify_step(
+    const quids::rollup::StateManager& pre_state,
+    const std::vector<quids::blockchain::TransactionPtr>& transactions,
+    const Bisection& game
+) {
+    const auto& agreed = game.agreed();
+    const auto& disputed = game.disputed();
+    if (!game.resolved() || disputed.index > transactions.size()) {
+        throw std::invalid_argument("Bisection has not narrowed to one transaction of this batch");
+    }
+
+    // Hashing the agreed writes replaces re-executing everything before them
+    if (!consistent(pre_state, agreed)) {
+        return {true, "Agreed claim does not match its state root"};
+    }
+    auto state = materialize(pre_state, agreed);
+    state->apply_transaction(*transactions[agreed.index]);
+    if (to_hash(state->get_state_root()) != disputed.root) {
+        return {true, "Transaction " + std::to_string(agreed.index) + " does not produce the asserted root"};
+    }
+    return {false, "Asserted transition is correct"};
+}
+
+StateWitness FraudProof::witness_step(
+    const quids::rollup::StateManager& pre_state,
+    const std::vector<quids::blockchain::TransactionPtr>& transactions,
+    const Bisection& game
+) {
+    // Recorded on a clone so pre_state is left alone; the clones
+    // verify_step() takes of it record into the same witness
+    auto state = pre_state.clone();
+    state->begin_witness();
+    verify_step(*state, transactions, game);
+    return state->take_witness();
+}
+
+FraudProof::FraudVerificationResult FraudProof::verify_step(
+    const StateWitness& witness,
+    const Hash& pre_root,
+    const std::vector<quids::blockchain::TransactionPtr>& transactions,
+    const Bisection& game
+) {
+    if (witness.pre_root != pre_root) {
+        throw std::invalid_argument("Witness is not for this batch's pre-state");
+    }
+    auto state = StateManager::from_witness(witness);
+    if (!state) {
+        throw std::invalid_argument("Witness proofs do not open to its pre-state root");
+    }
+    return verify_step(*state, transactions, game);
+}
+
 bool FraudProof::verify_state_roots(const InvalidTransitionProof& proof) const {
     // Verify pre-state root
     auto vec_root_pre = proof.state_proof.pre_state->get_state_root();
@@ -126,7 +327,7 @@ bool FraudProof::verify_state_transition(const InvalidTransitionProof& proof) co
     
     // Apply all transactions
     for (const auto& tx : proof.transactions) {
-        if (!temp_state->apply_transaction(tx)) {
+        if (!temp_state->apply_transaction(*tx)) {
             return false;
         }
     }
@@ -138,7 +339,7 @@ bool FraudProof::verify_state_transition(const InvalidTransitionProof& proof) co
     );
     
     // Check if quantum state is different
-    const double norm = quantum_state.normalized_vector().norm();
+    const double norm = quantum_state.normalizedVector().norm();
     return norm > 1e-10 && !std::isnan(norm) && std::isfinite(norm);
 }
 
@@ -0,0 +1,112 @@
+#include "rollup/HistoryIndexer.hpp"
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+HistoryIndexer::HistoryIndexer(std::shared_ptr<storage::PersistentStorage> storage, const Config& config)
+    : storage_(std::move(storage)), config_(config) {
+    if (!storage_) {
+        throw std::invalid_argument("HistoryIndexer requires a storage backend");
+    }
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+HistoryIndexer::HistoryIndexer(std::shared_ptr<storage::PersistentStorage> storage)
+    : HistoryIndexer(std::move(storage), Config{}) {}
+
+HistoryIndexer::~HistoryIndexer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    done_cv_.notify_all();
+    writer_.join();
+}
+
+void HistoryIndexer::enqueue(std::vector<Ref> refs) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Back-pressure rather than unbounded memory when the disk falls behind
+    done_cv_.wait(lock, [this] { return stop_ || queue_.size() < config_.max_queued_blocks; });
+    queue_.push_back(std::move(refs));
+    queued_seq_++;
+    lock.unlock();
+    work_cv_.notify_one();
+}
+
+bool HistoryIndexer::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t target = queued_seq_;
+    const uint64_t failures = stats_.failed_flushes;
+    work_cv_.notify_one();
+    done_cv_.wait(lock, [&] {
+        return flushed_seq_ >= target || stats_.failed_flushes != failures || stop_;
+    });
+    return flushed_seq_ >= target;
+}
+
+HistoryIndexer::Page HistoryIndexer::query(const std::string& address, const Query& query) const {
+    // One extra entry tells whether another page follows
+    Query probe = query;
+    probe.limit = query.limit + 1;
+    Page page;
+    page.entries = storage_->loadAccountHistory(address, probe);
+    if (page.entries.size() > query.limit) {
+        page.entries.pop_back();
+        const Ref& last = page.entries.back();
+        page.next = Cursor{last.block_number, last.index};
+    }
+    return page;
+}
+
+HistoryIndexer::Stats HistoryIndexer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void HistoryIndexer::writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break;
+        }
+
+        std::deque<std::vector<Ref>> blocks;
+        blocks.swap(queue_);
+        done_cv_.notify_all();  // room for enqueue() again
+        lock.unlock();
+
+        std::vector<Ref> refs;
+        for (const auto& block : blocks) {
+            refs.insert(refs.end(), block.begin(), block.end());
+        }
+        const bool ok = storage_->storeAccountHistory(refs, config_.sync_writes);
+
+        lock.lock();
+        if (!ok) {
+            stats_.failed_flushes++;
+            spdlog::warn("HistoryIndexer: failed to write {} blocks, retrying", blocks.size());
+            // Ahead of anything queued since, so blocks land in order
+            for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+                queue_.push_front(std::move(*it));
+            }
+            done_cv_.notify_all();
+            if (stop_) {
+                break;
+            }
+            work_cv_.wait_for(lock, RETRY_DELAY, [this] { return stop_; });
+            continue;
+        }
+        flushed_seq_ += blocks.size();
+        stats_.indexed_blocks += blocks.size();
+        stats_.indexed_refs += refs.size();
+        stats_.flushed_batches++;
+        done_cv_.notify_all();
+    }
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,572 @@
+#include "rollup/L1Batcher.hpp"
+#include "rollup/DataCompressor.hpp"
+#include "utils/Tracing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+const std::string OUTBOX_PREFIX = "l1/outbox/";
+const std::string CONFIRMED_KEY = "l1/confirmed";
+
+constexpr uint8_t FRAME_VERSION = 1;
+constexpr size_t LENGTH_PREFIX = 4;
+
+// Little-endian, like the rest of the posted formats
+void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+    for (size_t i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void put_bytes(std::vector<uint8_t>& out, std::span<const uint8_t> bytes) {
+    put_u32(out, static_cast<uint32_t>(bytes.size()));
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> bytes) : bytes_(bytes) {}
+
+    std::span<const uint8_t> take(size_t n) {
+        if (bytes_.size() - pos_ < n) {
+            throw std::invalid_argument("Truncated L1 batcher record");
+        }
+        auto out = bytes_.subspan(pos_, n);
+        pos_ += n;
+        return out;
+    }
+
+    uint64_t u64() {
+        auto b = take(8);
+        uint64_t value = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(b[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint32_t u32() {
+        auto b = take(4);
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(b[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint8_t u8() { return take(1)[0]; }
+
+    std::span<const uint8_t> bytes() { return take(u32()); }
+
+    template<size_t N>
+    std::array<uint8_t, N> array() {
+        std::array<uint8_t, N> out;
+        auto b = take(N);
+        std::copy(b.begin(), b.end(), out.begin());
+        return out;
+    }
+
+    bool done() const { return pos_ == bytes_.size(); }
+
+private:
+    std::span<const uint8_t> bytes_;
+    size_t pos_{0};
+};
+
+std::string outbox_key(uint64_t first_block) {
+    static const char* const DIGITS = "0123456789abcdef";
+    // Fixed-width hex so key order is block order
+    std::string key = OUTBOX_PREFIX;
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        key.push_back(DIGITS[(first_block >> shift) & 0xF]);
+    }
+    return key;
+}
+
+uint64_t bump(uint64_t fee, double factor, uint64_t floor, uint64_t cap) {
+    const auto bumped = static_cast<uint64_t>(std::ceil(static_cast<double>(fee) * factor));
+    return std::min(cap, std::max({bumped, fee + 1, floor}));
+}
+
+} // namespace
+
+std::vector<uint8_t> L1Batcher::Frame::encode() const {
+    std::vector<uint8_t> out;
+    size_t size = 1 + ProofAggregator::Aggregate::SERIALIZED_SIZE + 4;
+    for (const auto& block : blocks) {
+        size += block.encoded_size();
+    }
+    out.reserve(size);
+
+    out.push_back(FRAME_VERSION);
+    const auto aggregate = proofs.serialize();
+    out.insert(out.end(), aggregate.begin(), aggregate.end());
+    put_u32(out, static_cast<uint32_t>(blocks.size()));
+    for (const auto& block : blocks) {
+        put_u64(out, block.block_number);
+        out.insert(out.end(), block.state_root.begin(), block.state_root.end());
+        out.insert(out.end(), block.block_hash.begin(), block.block_hash.end());
+        put_u32(out, block.transaction_count);
+        put_bytes(out, block.data);
+    }
+    return out;
+}
+
+L1Batcher::Frame L1Batcher::Frame::decode(std::span<const uint8_t> bytes) {
+    Reader reader(bytes);
+    if (reader.u8() != FRAME_VERSION) {
+        throw std::invalid_argument("Unknown L1 frame version");
+    }
+    Frame frame;
+    frame.proofs = ProofAggregator::Aggregate::deserialize(reader.take(ProofAggregator::Aggregate::SERIALIZED_SIZE));
+    const uint32_t count = reader.u32();
+    for (uint32_t i = 0; i < count; ++i) {
+        BlockEntry block;
+        block.block_number = reader.u64();
+        block.state_root = reader.array<32>();
+        block.block_hash = reader.array<32>();
+        block.transaction_count = reader.u32();
+        auto data = reader.bytes();
+        block.data.assign(data.begin(), data.end());
+        if (!frame.blocks.empty() && block.block_number != frame.blocks.back().block_number + 1) {
+            throw std::invalid_argument("L1 frame blocks are not consecutive");
+        }
+        frame.blocks.push_back(std::move(block));
+    }
+    if (!reader.done()) {
+        throw std::invalid_argument("Trailing bytes after L1 frame");
+    }
+    return frame;
+}
+
+std::vector<uint8_t> L1Batcher::Outbound::serialize() const {
+    std::vector<uint8_t> out;
+    put_u64(out, first_block);
+    put_u64(out, end_block);
+    put_u64(out, transaction_count);
+    put_bytes(out, frame);
+    put_u64(out, tx.nonce);
+    out.push_back(static_cast<uint8_t>(tx.posting));
+    put_u64(out, tx.max_fee);
+    put_u64(out, tx.priority_fee);
+    put_u64(out, tx.max_blob_fee);
+    put_u32(out, static_cast<uint32_t>(sent.size()));
+    for (const auto& id : sent) {
+        put_bytes(out, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(id.data()), id.size()));
+    }
+    return out;
+}
+
+L1Batcher::Outbound L1Batcher::Outbound::deserialize(std::span<const uint8_t> bytes) {
+    Reader reader(bytes);
+    Outbound out;
+    out.first_block = reader.u64();
+    out.end_block = reader.u64();
+    out.transaction_count = reader.u64();
+    auto frame = reader.bytes();
+    out.frame.assign(frame.begin(), frame.end());
+    out.tx.nonce = reader.u64();
+    const uint8_t posting = reader.u8();
+    if (posting > static_cast<uint8_t>(Posting::Blob)) {
+        throw std::invalid_argument("Unknown L1 posting type");
+    }
+    out.tx.posting = static_cast<Posting>(posting);
+    out.tx.max_fee = reader.u64();
+    out.tx.priority_fee = reader.u64();
+    out.tx.max_blob_fee = reader.u64();
+    const uint32_t sent = reader.u32();
+    for (uint32_t i = 0; i < sent; ++i) {
+        auto id = reader.bytes();
+        out.sent.emplace_back(id.begin(), id.end());
+    }
+    if (!reader.done() || out.end_block <= out.first_block) {
+        throw std::invalid_argument("Malformed L1 outbox entry");
+    }
+    // The payload is derived from the frame rather than stored twice
+    if (!out.sent.empty()) {
+        out.tx.payload = out.tx.posting == Posting::Blob ? encode_blobs(out.frame) : out.frame;
+    }
+    return out;
+}
+
+L1Batcher::L1Batcher(std::shared_ptr<Client> client, std::shared_ptr<storage::PersistentStorage> storage,
+                     const Config& config)
+    : client_(std::move(client)), storage_(std::move(storage)), config_(config) {
+    if (!client_ || !storage_) {
+        throw std::invalid_argument("L1 batcher needs a client and storage");
+    }
+    resume();
+    worker_ = std::thread([this] { workerLoop(); });
+}
+
+L1Batcher::L1Batcher(std::shared_ptr<Client> client, std::shared_ptr<storage::PersistentStorage> storage)
+    : L1Batcher(std::move(client), std::move(storage), Config{}) {}
+
+L1Batcher::~L1Batcher() {
+    stop();
+}
+
+void L1Batcher::resume() {
+    if (auto data = storage_->loadState(CONFIRMED_KEY)) {
+        Reader reader(*data);
+        confirmed_height_ = reader.u64();
+    }
+    next_block_ = confirmed_height_;
+
+    storage_->scanState(OUTBOX_PREFIX, [this](const std::string&, const std::vector<uint8_t>& data) {
+        auto frame = Outbound::deserialize(data);
+        if (frame.end_block > confirmed_height_) {
+            // Sent ones wait a full replace_after before any bump
+            frame.last_sent = Clock::now();
+            next_block_ = std::max(next_block_, frame.end_block);
+            in_flight_.push_back(std::move(frame));
+        }
+        return true;
+    });
+
+    try {
+        next_nonce_ = client_->next_nonce();
+    } catch (...) {
+        next_nonce_ = 0;
+    }
+    if (!in_flight_.empty()) {
+        next_nonce_ = std::max(next_nonce_, in_flight_.back().tx.nonce + 1);
+    }
+    metrics_.in_flight = in_flight_.size();
+}
+
+bool L1Batcher::add_block(const L2BlockProcessor::L2Block& block) {
+    if (block.error) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (block.block_number < next_block_ || stopping_) {
+            return false;
+        }
+    }
+
+    std::vector<const blockchain::Transaction*> transactions;
+    transactions.reserve(block.transactions.size());
+    for (const auto& tx : block.transactions) {
+        transactions.push_back(tx.get());
+    }
+    const auto compressed = DataCompressor::compress_batch(transactions);
+
+    Queued queued;
+    queued.entry.block_number = block.block_number;
+    queued.entry.state_root = block.state_root;
+    queued.entry.block_hash = block.block_hash;
+    queued.entry.transaction_count = static_cast<uint32_t>(block.transactions.size());
+    queued.entry.data.assign(compressed.compressed_data.begin(), compressed.compressed_data.end());
+    queued.proof = block.block_proof;
+    queued.added = Clock::now();
+
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (block.block_number < next_block_ || stopping_) {
+            return false;
+        }
+        next_block_ = block.block_number + 1;
+        queued_bytes_ += queued.entry.encoded_size();
+        queue_.push_back(std::move(queued));
+        metrics_.queued_blocks = queue_.size();
+        full = queued_bytes_ >= config_.byte_budget;
+    }
+    if (full) {
+        cv_.notify_one();
+    }
+    return true;
+}
+
+void L1Batcher::flush() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flush_requested_ = true;
+    }
+    cv_.notify_one();
+}
+
+void L1Batcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void L1Batcher::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, config_.poll_interval, [this] {
+            return stopping_ || flush_requested_ || queued_bytes_ >= config_.byte_budget;
+        });
+        if (stopping_) {
+            break;
+        }
+        lock.unlock();
+
+        while (in_flight_.size() < config_.max_in_flight && sealFrame(false)) {
+        }
+        for (size_t i = 0; i < in_flight_.size();) {
+            i = advance(i) > 0 ? 0 : i + 1;
+        }
+
+        lock.lock();
+        metrics_.in_flight = in_flight_.size();
+    }
+    lock.unlock();
+
+    // Nothing queued is lost: it goes to the outbox unsent
+    while (sealFrame(true)) {
+    }
+}
+
+bool L1Batcher::sealFrame(bool force) {
+    Frame frame;
+    ProofAggregator aggregator;
+    Outbound out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+            flush_requested_ = false;
+            return false;
+        }
+        const bool due = force || flush_requested_ || queued_bytes_ >= config_.byte_budget ||
+                         Clock::now() - queue_.front().added >= config_.max_delay;
+        if (!due) {
+            return false;
+        }
+
+        // Greedy up to the budget; a block over budget on its own still goes
+        size_t size = 1 + ProofAggregator::Aggregate::SERIALIZED_SIZE + 4;
+        while (!queue_.empty() &&
+               (frame.blocks.empty() || size + queue_.front().entry.encoded_size() <= config_.byte_budget)) {
+            Queued queued = std::move(queue_.front());
+            queue_.pop_front();
+            size += queued.entry.encoded_size();
+            queued_bytes_ -= queued.entry.encoded_size();
+            aggregator.add_proof(queued.proof);
+            out.transaction_count += queued.entry.transaction_count;
+            frame.blocks.push_back(std::move(queued.entry));
+        }
+        if (queue_.empty()) {
+            flush_requested_ = false;
+        }
+        metrics_.queued_blocks = queue_.size();
+    }
+
+    frame.proofs = aggregator.seal();
+    out.first_block = frame.blocks.front().block_number;
+    const utils::TraceId frame_trace = utils::aggregate_trace_id("l1", out.first_block);
+    for (const auto& entry : frame.blocks) {
+        utils::Tracer::global().link("l1.frame", utils::aggregate_trace_id("block", entry.block_number), frame_trace);
+    }
+    out.end_block = frame.blocks.back().block_number + 1;
+    out.frame = frame.encode();
+    out.tx.nonce = next_nonce_++;
+    // Durable before anything reaches L1
+    persist(out);
+    in_flight_.push_back(std::move(out));
+    return true;
+}
+
+L1Batcher::L1Transaction L1Batcher::buildTransaction(const std::vector<uint8_t>& frame, const Fees& fees) const {
+    L1Transaction tx;
+    tx.priority_fee = fees.priority_fee;
+    tx.max_fee = std::min(config_.max_fee_cap, 2 * fees.base_fee + fees.priority_fee);
+
+    const size_t blobs = (frame.size() + LENGTH_PREFIX + BLOB_CAPACITY - 1) / BLOB_CAPACITY;
+    Posting posting = Posting::Calldata;
+    if (config_.posting) {
+        posting = *config_.posting;
+    } else if (blobs <= config_.max_blobs) {
+        const double gas_price = static_cast<double>(fees.base_fee + fees.priority_fee);
+        const double calldata_cost = gas_price * static_cast<double>(TX_BASE_GAS + calldata_gas(frame));
+        const double blob_cost = gas_price * static_cast<double>(TX_BASE_GAS) +
+                                 static_cast<double>(blobs * BLOB_GAS_PER_BLOB) *
+                                     static_cast<double>(fees.blob_base_fee);
+        posting = blob_cost < calldata_cost ? Posting::Blob : Posting::Calldata;
+    }
+
+    tx.posting = posting;
+    if (posting == Posting::Blob) {
+        tx.payload = encode_blobs(frame);
+        tx.max_blob_fee = std::min(config_.max_fee_cap, std::max<uint64_t>(1, 2 * fees.blob_base_fee));
+    } else {
+        tx.payload = frame;
+    }
+    return tx;
+}
+
+void L1Batcher::sendFrame(Outbound& frame, bool replace) {
+    utils::Span span(replace ? "l1.replace" : "l1.submit", utils::aggregate_trace_id("l1", frame.first_block));
+    const Fees fees = client_->fees();
+    if (frame.sent.empty()) {
+        const uint64_t nonce = frame.tx.nonce;
+        frame.tx = buildTransaction(frame.frame, fees);
+        frame.tx.nonce = nonce;
+    } else if (replace) {
+        // Same nonce and payload; every fee up by at least fee_bump and
+        // never below the current quote
+        auto& tx = frame.tx;
+        tx.priority_fee = bump(tx.priority_fee, config_.fee_bump, fees.priority_fee, config_.max_fee_cap);
+        tx.max_fee = bump(tx.max_fee, config_.fee_bump, 2 * fees.base_fee + tx.priority_fee, config_.max_fee_cap);
+        if (tx.posting == Posting::Blob) {
+            tx.max_blob_fee = bump(tx.max_blob_fee, config_.fee_bump, 2 * fees.blob_base_fee, config_.max_fee_cap);
+        }
+    }
+
+    const bool first = frame.sent.empty();
+    frame.sent.push_back(client_->send(frame.tx));
+    frame.last_sent = Clock::now();
+    persist(frame);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (first) {
+        ++metrics_.frames_sent;
+        metrics_.transactions_posted += frame.transaction_count;
+        metrics_.bytes_posted += frame.tx.payload.size();
+    } else if (replace) {
+        ++metrics_.replacements;
+    }
+}
+
+size_t L1Batcher::advance(size_t index) {
+    Outbound& frame = in_flight_[index];
+    try {
+        if (frame.sent.empty()) {
+            sendFrame(frame, false);
+            return 0;
+        }
+
+        bool all_dropped = true;
+        for (const auto& id : frame.sent) {
+            const auto status = client_->status(id);
+            if (status == TxStatus::Included) {
+                // A nonce is only usable once its predecessors are in, so
+                // everything ahead of this frame is included too
+                confirmThrough(index);
+                return index + 1;
+            }
+            all_dropped = all_dropped && status == TxStatus::Dropped;
+        }
+
+        if (all_dropped) {
+            sendFrame(frame, false);
+        } else if (Clock::now() - frame.last_sent >= config_.replace_after) {
+            sendFrame(frame, true);
+        }
+    } catch (...) {
+        // Retried on the next poll
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.send_failures;
+    }
+    return 0;
+}
+
+void L1Batcher::confirmThrough(size_t index) {
+    std::vector<storage::PersistentStorage::StateWrite> writes;
+    for (size_t i = 0; i <= index; ++i) {
+        writes.push_back({outbox_key(in_flight_[i].first_block), std::nullopt});
+    }
+    const uint64_t height = in_flight_[index].end_block;
+    std::vector<uint8_t> encoded;
+    put_u64(encoded, height);
+    writes.push_back({CONFIRMED_KEY, std::move(encoded)});
+    storage_->storeStateBatch(writes, true);
+
+    in_flight_.erase(in_flight_.begin(), in_flight_.begin() + static_cast<std::ptrdiff_t>(index + 1));
+    std::lock_guard<std::mutex> lock(mutex_);
+    confirmed_height_ = std::max(confirmed_height_, height);
+    metrics_.frames_confirmed += index + 1;
+    metrics_.in_flight = in_flight_.size();
+}
+
+bool L1Batcher::persist(const Outbound& frame) {
+    return storage_->storeStateBatch({{outbox_key(frame.first_block), frame.serialize()}}, true);
+}
+
+uint64_t L1Batcher::confirmed_height() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return confirmed_height_;
+}
+
+uint64_t L1Batcher::next_block() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_block_;
+}
+
+L1Batcher::Metrics L1Batcher::metrics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return metrics_;
+}
+
+double L1Batcher::utilization() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const double frames = static_cast<double>(metrics_.in_flight) +
+                          static_cast<double>(queued_bytes_) / static_cast<double>(std::max<size_t>(1, config_.byte_budget));
+    return frames / static_cast<double>(config_.max_in_flight + 1);
+}
+
+std::vector<uint8_t> L1Batcher::encode_blobs(std::span<const uint8_t> bytes) {
+    std::vector<uint8_t> stream;
+    stream.reserve(LENGTH_PREFIX + bytes.size());
+    put_u32(stream, static_cast<uint32_t>(bytes.size()));
+    stream.insert(stream.end(), bytes.begin(), bytes.end());
+
+    const size_t blobs = std::max<size_t>(1, (stream.size() + BLOB_CAPACITY - 1) / BLOB_CAPACITY);
+    std::vector<uint8_t> out(blobs * BLOB_SIZE, 0);
+    for (size_t offset = 0, element = 0; offset < stream.size(); offset += USABLE_BYTES_PER_ELEMENT, ++element) {
+        const size_t n = std::min(USABLE_BYTES_PER_ELEMENT, stream.size() - offset);
+        std::memcpy(out.data() + element * 32 + 1, stream.data() + offset, n);
+    }
+    return out;
+}
+
+std::vector<uint8_t> L1Batcher::decode_blobs(std::span<const uint8_t> blobs) {
+    if (blobs.empty() || blobs.size() % BLOB_SIZE != 0) {
+        throw std::invalid_argument("Blob data is not a whole number of blobs");
+    }
+    const size_t elements = blobs.size() / 32;
+    std::vector<uint8_t> stream;
+    stream.reserve(elements * USABLE_BYTES_PER_ELEMENT);
+    for (size_t element = 0; element < elements; ++element) {
+        const uint8_t* fe = blobs.data() + element * 32;
+        if (fe[0] != 0) {
+            throw std::invalid_argument("Blob field element out of range");
+        }
+        stream.insert(stream.end(), fe + 1, fe + 32);
+    }
+
+    Reader reader(stream);
+    auto bytes = reader.bytes();
+    return {bytes.begin(), bytes.end()};
+}
+
+uint64_t L1Batcher::calldata_gas(std::span<const uint8_t> bytes) {
+    const auto zeros = static_cast<uint64_t>(std::count(bytes.begin(), bytes.end(), 0));
+    return 4 * zeros + 16 * (bytes.size() - zeros);
+}
+
+} // namespace rollup
+} // namespace quids
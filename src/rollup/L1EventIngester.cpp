@@ -0,0 +1,284 @@
+#include "rollup/L1EventIngester.hpp"
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <utility>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+const std::string CURSOR_KEY = "l1/ingest/cursor";
+constexpr size_t HEADER_SIZE = 8 + 32 + 32;
+
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+uint64_t get_u64(const uint8_t* in) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return v;
+}
+
+} // namespace
+
+L1EventIngester::L1EventIngester(std::shared_ptr<Client> client, std::shared_ptr<Sink> sink,
+                                 std::shared_ptr<storage::PersistentStorage> storage, const Config& config)
+    : client_(std::move(client)), sink_(std::move(sink)), storage_(std::move(storage)), config_(config) {
+    if (!client_ || !sink_ || !storage_) {
+        throw std::invalid_argument("L1 event ingester needs a client, a sink and storage");
+    }
+    if (config_.range_blocks == 0 || config_.max_concurrent == 0 || config_.reorg_window == 0) {
+        throw std::invalid_argument("L1 event ingester needs non-zero ranges, concurrency and window");
+    }
+    resume();
+}
+
+L1EventIngester::L1EventIngester(std::shared_ptr<Client> client, std::shared_ptr<Sink> sink,
+                                 std::shared_ptr<storage::PersistentStorage> storage)
+    : L1EventIngester(std::move(client), std::move(sink), std::move(storage), Config{}) {}
+
+L1EventIngester::~L1EventIngester() {
+    stop();
+}
+
+void L1EventIngester::resume() {
+    uint64_t cursor = config_.start_block;
+    if (auto data = storage_->loadState(CURSOR_KEY)) {
+        if (data->size() < 8 || (data->size() - 8) % HEADER_SIZE != 0) {
+            throw std::runtime_error("Corrupt L1 ingest cursor");
+        }
+        cursor = get_u64(data->data());
+        for (size_t offset = 8; offset < data->size(); offset += HEADER_SIZE) {
+            BlockHeader header;
+            header.number = get_u64(data->data() + offset);
+            std::copy_n(data->begin() + static_cast<std::ptrdiff_t>(offset + 8), 32, header.hash.begin());
+            std::copy_n(data->begin() + static_cast<std::ptrdiff_t>(offset + 40), 32, header.parent_hash.begin());
+            applied_.push_back(header);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics_.cursor = cursor;
+}
+
+bool L1EventIngester::persist() {
+    std::vector<uint8_t> data;
+    data.reserve(8 + applied_.size() * HEADER_SIZE);
+    put_u64(data, next_block());
+    for (const auto& header : applied_) {
+        put_u64(data, header.number);
+        data.insert(data.end(), header.hash.begin(), header.hash.end());
+        data.insert(data.end(), header.parent_hash.begin(), header.parent_hash.end());
+    }
+    return storage_->storeStateBatch({{CURSOR_KEY, std::move(data)}}, true);
+}
+
+uint64_t L1EventIngester::next_block() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return metrics_.cursor;
+}
+
+void L1EventIngester::pace() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.requests;
+    }
+    if (config_.requests_per_second <= 0.0) {
+        return;
+    }
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / config_.requests_per_second));
+    Clock::time_point slot;
+    {
+        std::lock_guard<std::mutex> lock(pace_mutex_);
+        slot = std::max(Clock::now(), next_request_);
+        next_request_ = slot + interval;
+    }
+    std::this_thread::sleep_until(slot);
+}
+
+bool L1EventIngester::reconcile() {
+    if (applied_.empty()) {
+        return true;
+    }
+    auto still_on_l1 = [this](const BlockHeader& kept) {
+        pace();
+        const auto current = client_->header(kept.number);
+        return current && current->hash == kept.hash;
+    };
+    if (still_on_l1(applied_.back())) {
+        return true;
+    }
+
+    // Kept headers are a chain, so those still on L1 are a prefix
+    size_t low = 0;
+    size_t high = applied_.size() - 1;  // known to be gone
+    if (!still_on_l1(applied_.front())) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.reorgs;
+        metrics_.halted = true;
+        return false;
+    }
+    while (high - low > 1) {
+        const size_t mid = low + (high - low) / 2;
+        if (still_on_l1(applied_[mid])) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    const uint64_t first = applied_[low].number + 1;
+    const uint64_t cursor = next_block();
+    sink_->rollback(first);
+    applied_.resize(low + 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.reorgs;
+        metrics_.blocks_rolled_back += cursor - first;
+        metrics_.cursor = first;
+    }
+    persist();
+    return true;
+}
+
+size_t L1EventIngester::poll() {
+    uint64_t target;
+    try {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (metrics_.halted) {
+                return 0;
+            }
+        }
+        if (!reconcile()) {
+            return 0;
+        }
+        pace();
+        const uint64_t head = client_->head();
+        std::lock_guard<std::mutex> lock(mutex_);
+        metrics_.l1_head = head;
+        if (head < config_.confirmations || metrics_.cursor > head - config_.confirmations) {
+            return 0;
+        }
+        target = head - config_.confirmations;
+    } catch (const std::exception&) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++metrics_.request_failures;
+        return 0;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    for (uint64_t first = next_block(); first <= target && ranges.size() < config_.max_concurrent;) {
+        const uint64_t last = std::min(target, first + (config_.range_blocks - 1));
+        ranges.emplace_back(first, last);
+        if (last == target) break;
+        first = last + 1;
+    }
+    std::vector<std::future<std::vector<Block>>> fetches;
+    fetches.reserve(ranges.size());
+    for (const auto& [first, last] : ranges) {
+        fetches.push_back(std::async(std::launch::async, [this, first = first, last = last] {
+            pace();
+            return client_->blocks(first, last);
+        }));
+    }
+
+    // Apply in order up to the first failed range or broken link; later
+    // ranges are fetched again next round
+    size_t applied = 0;
+    bool intact = true;
+    for (size_t i = 0; i < fetches.size(); ++i) {
+        std::vector<Block> blocks;
+        try {
+            blocks = fetches[i].get();
+        } catch (const std::exception&) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++metrics_.request_failures;
+            intact = false;
+        }
+        if (!intact) {
+            continue;
+        }
+        for (const auto& block : blocks) {
+            const uint64_t cursor = next_block();
+            if (block.header.number != cursor ||
+                (!applied_.empty() && block.header.parent_hash != applied_.back().hash)) {
+                intact = false;
+                break;
+            }
+            sink_->apply(block);
+            applied_.push_back(block.header);
+            if (applied_.size() > config_.reorg_window) {
+                applied_.pop_front();
+            }
+            ++applied;
+            std::lock_guard<std::mutex> lock(mutex_);
+            metrics_.cursor = cursor + 1;
+            ++metrics_.blocks_applied;
+            metrics_.deposits_applied += block.deposits.size();
+        }
+        if (next_block() != ranges[i].second + 1) {
+            intact = false;
+        }
+    }
+    if (applied > 0) {
+        persist();
+    }
+    return applied;
+}
+
+void L1EventIngester::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (worker_.joinable() || stopping_) {
+        return;
+    }
+    worker_ = std::thread([this] { workerLoop(); });
+}
+
+void L1EventIngester::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void L1EventIngester::workerLoop() {
+    for (;;) {
+        size_t applied = 0;
+        try {
+            applied = poll();
+        } catch (const std::exception&) {
+            // A sink failure; the blocks it refused are fetched again
+            applied = 0;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        const bool behind = applied > 0 && metrics_.l1_head >= config_.confirmations &&
+                            metrics_.cursor <= metrics_.l1_head - config_.confirmations;
+        if (!behind) {
+            cv_.wait_for(lock, config_.poll_interval, [this] { return stopping_; });
+        }
+        if (stopping_) {
+            return;
+        }
+    }
+}
+
+L1EventIngester::Metrics L1EventIngester::metrics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return metrics_;
+}
+
+} // namespace rollup
+} // namespace quids
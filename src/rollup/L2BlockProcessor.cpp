@@ -0,0 +1,316 @@
+#include "rollup/L2BlockProcessor.hpp"
+#include "rollup/RollupStateTransition.hpp"
+#include "utils/Tracing.hpp"
+#include <algorithm>
+#include <blake3.h>
+#include <deque>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+constexpr const char* STAGE_SPANS[] = {
+    "block.ingest", "block.order", "block.execute", "block.state_root", "block.proof", "block.submit"
+};
+
+} // namespace
+
+// Blocking bounded queue between two stages. Blocks are few and large, so
+// a mutex costs nothing next to the work on either side of it.
+class L2BlockProcessor::Queue {
+public:
+    explicit Queue(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+    // False once closed
+    bool push(BlockPtr block) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(block));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Null once closed and empty
+    BlockPtr pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return nullptr;
+        }
+        BlockPtr block = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return block;
+    }
+
+    // Queued blocks are still handed out
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+private:
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<BlockPtr> items_;
+    bool closed_{false};
+};
+
+L2BlockProcessor::L2BlockProcessor(std::shared_ptr<StateManager> state, const Config& config,
+                                   Submitter submitter, ProvingService::BackendFactory prover,
+                                   Orderer orderer)
+    : config_(config),
+      state_(std::move(state)),
+      submitter_(std::move(submitter)),
+      prover_(std::move(prover)),
+      orderer_(std::move(orderer)) {
+    if (!state_ || !submitter_ || !prover_) {
+        throw std::invalid_argument("Block processor needs a state, a submitter and a prover");
+    }
+    shadow_ = state_->clone();
+    const auto root = shadow_->get_state_root();
+    std::copy_n(root.begin(), last_root_.size(), last_root_.begin());
+
+    for (auto& queue : queues_) {
+        queue = std::make_unique<Queue>(config_.queue_capacity);
+    }
+    const size_t proof_workers = std::max<size_t>(1, config_.proof_workers);
+    for (size_t s = 0; s < NUM_STAGES; ++s) {
+        live_workers_[s] = s == Proof ? proof_workers : 1;
+    }
+
+    workers_.emplace_back([this] { runStage(Ingest, [this](L2Block& block) { ingest(block); }); });
+    workers_.emplace_back([this] { runStage(Order, [this](L2Block& block) { order(block); }); });
+    workers_.emplace_back([this] { runStage(Execute, [this](L2Block& block) { execute(block); }); });
+    workers_.emplace_back([this] { runStage(StateRoot, [this](L2Block& block) { computeRoot(block); }); });
+    for (size_t i = 0; i < proof_workers; ++i) {
+        workers_.emplace_back([this, backend = prover_()] {
+            runStage(Proof, [&backend](L2Block& block) {
+                if (!block.transactions.empty()) {
+                    block.block_proof = backend(
+                        RollupStateTransition::encode_batch_to_quantum_state(block.transactions));
+                }
+            });
+        });
+    }
+    workers_.emplace_back([this] { runSubmit(); });
+}
+
+L2BlockProcessor::~L2BlockProcessor() {
+    stop();
+}
+
+uint64_t L2BlockProcessor::submit(std::vector<blockchain::TransactionPtr>&& batch) {
+    if (batch.empty() || batch.size() > config_.max_block_size) {
+        throw std::invalid_argument("Block must hold between 1 and max_block_size transactions");
+    }
+    std::lock_guard<std::mutex> producers(submit_mutex_);
+    uint64_t number;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            throw std::runtime_error("Block processor stopped");
+        }
+        // Counted before the push so drain() can never see it delivered
+        // but not yet submitted
+        number = next_block_number_++;
+    }
+
+    auto block = std::make_shared<L2Block>();
+    block->block_number = number;
+    block->transactions = std::move(batch);
+    block->ingested = std::chrono::steady_clock::now();
+    const utils::TraceId block_trace = utils::aggregate_trace_id("block", number);
+    auto& tracer = utils::Tracer::global();
+    for (const auto& tx : block->transactions) {
+        tracer.link("block.assign", utils::transaction_trace_id(tx->getSender(), tx->getNonce()), block_trace);
+    }
+    if (!queues_[Ingest]->push(block)) {
+        batch = std::move(block->transactions);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --next_block_number_;
+        }
+        drained_cv_.notify_all();
+        throw std::runtime_error("Block processor stopped");
+    }
+    return number;
+}
+
+void L2BlockProcessor::runStage(Stage stage, const std::function<void(L2Block&)>& work) {
+    while (BlockPtr block = queues_[stage]->pop()) {
+        if (!block->error) {
+            const auto start = std::chrono::steady_clock::now();
+            utils::Span span(STAGE_SPANS[stage], utils::aggregate_trace_id("block", block->block_number));
+            try {
+                work(*block);
+            } catch (...) {
+                block->error = std::current_exception();
+            }
+            busy_us_[stage] += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+        queues_[stage + 1]->push(std::move(block));
+    }
+    // The last worker out closes the next stage's input
+    if (--live_workers_[stage] == 0) {
+        queues_[stage + 1]->close();
+    }
+}
+
+void L2BlockProcessor::ingest(L2Block& block) {
+    block.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    // Signature checks are memoized on the transactions, so execute sees
+    // them for free
+    auto& txs = block.transactions;
+    const size_t before = txs.size();
+    txs.erase(std::remove_if(txs.begin(), txs.end(), [](const auto& tx) { return !tx->verified(); }),
+              txs.end());
+    transactions_rejected_ += before - txs.size();
+}
+
+void L2BlockProcessor::order(L2Block& block) {
+    if (orderer_) {
+        orderer_(block.transactions);
+    }
+    block.ordering = mev_.create_ordering_commitment(block.transactions);
+}
+
+void L2BlockProcessor::execute(L2Block& block) {
+    auto result = executor_.apply_batch(*state_, block.transactions);
+    block.executed = std::move(result.success);
+    block.writes = std::move(result.writes);
+}
+
+void L2BlockProcessor::computeRoot(L2Block& block) {
+    // Only the written accounts' trie paths are rehashed
+    for (auto& [address, account] : block.writes) {
+        shadow_->add_account(address, std::move(account));
+    }
+    block.writes.clear();
+    block.writes.shrink_to_fit();
+
+    const auto root = shadow_->get_state_root();
+    block.pre_state_root = last_root_;
+    std::copy_n(root.begin(), block.state_root.size(), block.state_root.begin());
+    block.previous_hash = last_block_hash_;
+    block.block_hash = calculate_block_hash(block);
+
+    last_root_ = block.state_root;
+    last_block_hash_ = block.block_hash;
+}
+
+void L2BlockProcessor::runSubmit() {
+    while (BlockPtr block = queues_[Submit]->pop()) {
+        const uint64_t number = block->block_number;
+        reorder_.emplace(number, std::move(block));
+
+        // Proofs finish out of order; hand blocks to L1 in order
+        while (!reorder_.empty() && reorder_.begin()->first == next_submit_) {
+            BlockPtr next = std::move(reorder_.begin()->second);
+            reorder_.erase(reorder_.begin());
+            ++next_submit_;
+
+            const auto start = std::chrono::steady_clock::now();
+            try {
+                utils::Span span(STAGE_SPANS[Submit], utils::aggregate_trace_id("block", next->block_number));
+                submitter_(next);
+            } catch (...) {
+                if (!next->error) {
+                    next->error = std::current_exception();
+                }
+            }
+            const auto now = std::chrono::steady_clock::now();
+            busy_us_[Submit] += std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+
+            const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - next->ingested);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++blocks_submitted_;
+                if (next->error) {
+                    ++blocks_failed_;
+                }
+                const double sample = static_cast<double>(latency.count());
+                average_latency_us_ = blocks_submitted_ == 1
+                    ? sample
+                    : average_latency_us_ + LATENCY_GAIN * (sample - average_latency_us_);
+                max_latency_ = std::max(max_latency_, latency);
+            }
+            drained_cv_.notify_all();
+        }
+    }
+}
+
+void L2BlockProcessor::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_cv_.wait(lock, [this] { return blocks_submitted_ == next_block_number_; });
+}
+
+void L2BlockProcessor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            return;
+        }
+        stopped_ = true;
+    }
+    queues_[Ingest]->close();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+L2BlockProcessor::Metrics L2BlockProcessor::metrics() const {
+    Metrics metrics;
+    for (size_t s = 0; s < NUM_STAGES; ++s) {
+        metrics.queue_depth[s] = queues_[s]->size();
+        metrics.busy[s] = std::chrono::microseconds(busy_us_[s].load());
+    }
+    metrics.transactions_rejected = transactions_rejected_.load();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics.blocks_submitted = blocks_submitted_;
+    metrics.blocks_failed = blocks_failed_;
+    metrics.average_latency = std::chrono::microseconds(static_cast<int64_t>(average_latency_us_));
+    metrics.max_latency = max_latency_;
+    return metrics;
+}
+
+L2BlockProcessor::Hash L2BlockProcessor::calculate_block_hash(const L2Block& block) {
+    Hash hash;
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, &block.block_number, sizeof(block.block_number));
+    blake3_hasher_update(&hasher, &block.timestamp, sizeof(block.timestamp));
+    blake3_hasher_update(&hasher, block.previous_hash.data(), block.previous_hash.size());
+    blake3_hasher_update(&hasher, block.pre_state_root.data(), block.pre_state_root.size());
+    blake3_hasher_update(&hasher, block.state_root.data(), block.state_root.size());
+    blake3_hasher_update(&hasher, block.ordering.batch_hash.data(), block.ordering.batch_hash.size());
+    blake3_hasher_finalize(&hasher, hash.data(), hash.size());
+    return hash;
+}
+
+bool L2BlockProcessor::verify_block(const L2Block& block, const Hash& previous_hash) {
+    return block.previous_hash == previous_hash && block.block_hash == calculate_block_hash(block);
+}
+
+} // namespace rollup
+} // namespace quids
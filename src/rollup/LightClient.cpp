@@ -0,0 +1,184 @@
+#include "rollup/LightClient.hpp"
+#include "rollup/StateWitness.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+void put_hash(std::vector<uint8_t>& out, const StateTrie::Hash& h) {
+    out.insert(out.end(), h.begin(), h.end());
+}
+
+} // namespace
+
+LightClient::Hash LightClient::Header::hash() const {
+    std::vector<uint8_t> encoded;
+    encoded.reserve(8 * 3 + 32 * (3 + skips.size()));
+    put_u64(encoded, number);
+    put_hash(encoded, parent_hash);
+    put_hash(encoded, state_root);
+    put_hash(encoded, transactions_root);
+    put_u64(encoded, timestamp);
+    put_u64(encoded, skips.size());
+    for (const auto& skip : skips) {
+        put_hash(encoded, skip.checkpoint);
+    }
+    return StateTrie::hash_bytes(encoded.data(), encoded.size());
+}
+
+LightClient::LightClient(Header trusted, const Config& config, TransitionCheck check)
+    : config_(config), check_(std::move(check)) {
+    if (config_.checkpoint_shift >= 64) {
+        throw std::invalid_argument("checkpoint interval does not fit in a block number");
+    }
+    if (!check_) {
+        throw std::invalid_argument("light client needs a transition check");
+    }
+    if (!is_checkpoint(trusted.number)) {
+        throw std::invalid_argument("trusted header must be a checkpoint");
+    }
+    trusted_ = std::move(trusted);
+    head_ = trusted_;
+}
+
+bool LightClient::is_checkpoint(uint64_t number) const {
+    return number % (uint64_t{1} << config_.checkpoint_shift) == 0;
+}
+
+std::vector<uint64_t> LightClient::skip_targets(uint64_t number) const {
+    std::vector<uint64_t> targets;
+    if (number == 0) {
+        return targets;
+    }
+    for (uint32_t bits = config_.checkpoint_shift; bits < 64; ++bits) {
+        const uint64_t span = uint64_t{1} << bits;
+        if (number % span != 0) {
+            break;
+        }
+        targets.push_back(number - span);
+    }
+    return targets;
+}
+
+bool LightClient::advance(Header next, size_t level) {
+    const uint64_t span = uint64_t{1} << (config_.checkpoint_shift + level);
+    if (next.number < trusted_.number || next.number - trusted_.number != span || next.skips.size() <= level ||
+        next.skips[level].checkpoint != trusted_.hash()) {
+        return false;
+    }
+    ++stats_.transitions_checked;
+    if (!check_(trusted_, next, next.skips[level].proof)) {
+        return false;
+    }
+    trusted_ = std::move(next);
+    head_ = trusted_;
+    return true;
+}
+
+bool LightClient::follow(Header header) {
+    if (header.number != head_.number + 1 || header.parent_hash != head_.hash()) {
+        return false;
+    }
+    if (is_checkpoint(header.number)) {
+        // head_ never passes the next checkpoint, so trusted_ is the one
+        // an interval back
+        return advance(std::move(header), 0);
+    }
+    head_ = std::move(header);
+    return true;
+}
+
+bool LightClient::sync(uint64_t target, const HeaderSource& headers) {
+    if (target <= head_.number) {
+        return true;
+    }
+    const uint64_t last = target - target % (uint64_t{1} << config_.checkpoint_shift);
+
+    // Widest link from the trusted checkpoint that does not pass last:
+    // climbing while the number is aligned, then descending
+    while (trusted_.number < last) {
+        size_t level = 0;
+        for (uint32_t bits = config_.checkpoint_shift + 1; bits < 64; ++bits, ++level) {
+            const uint64_t span = uint64_t{1} << bits;
+            if (trusted_.number % span != 0 || span > last - trusted_.number) {
+                break;
+            }
+        }
+        const uint64_t number = trusted_.number + (uint64_t{1} << (config_.checkpoint_shift + level));
+        auto next = headers(number);
+        ++stats_.headers_fetched;
+        if (!next || next->number != number || !advance(std::move(*next), level)) {
+            return false;
+        }
+    }
+
+    while (head_.number < target) {
+        auto next = headers(head_.number + 1);
+        ++stats_.headers_fetched;
+        if (!next || !follow(std::move(*next))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+LightClient::AccountQuery LightClient::get_account(const std::string& address, const ProofSource& proofs) {
+    const Hash& root = trusted_.state_root;
+    ++stats_.proofs_fetched;
+    const auto value = proofs(proof_key(root, address));
+    if (!value) {
+        return {AccountQuery::Status::Unavailable, std::nullopt};
+    }
+
+    const auto witness = StateWitness::deserialize(*value);
+    if (!witness || witness->pre_root != root || witness->entries.size() != 1 ||
+        witness->entries.front().address != address) {
+        return {AccountQuery::Status::Invalid, std::nullopt};
+    }
+    const auto& entry = witness->entries.front();
+    if (entry.account) {
+        if (!StateTrie::verify(root, address, StateManager::account_hash(*entry.account), entry.proof)) {
+            return {AccountQuery::Status::Invalid, std::nullopt};
+        }
+        return {AccountQuery::Status::Found, entry.account};
+    }
+    if (!StateTrie::verify_absent(root, address, entry.absence)) {
+        return {AccountQuery::Status::Invalid, std::nullopt};
+    }
+    return {AccountQuery::Status::Absent, std::nullopt};
+}
+
+LightClient::DhtKey LightClient::proof_key(const Hash& state_root, const std::string& address) {
+    std::vector<uint8_t> encoded(state_root.begin(), state_root.end());
+    encoded.insert(encoded.end(), address.begin(), address.end());
+    return StateTrie::hash_bytes(encoded.data(), encoded.size());
+}
+
+std::vector<uint8_t> LightClient::account_proof(const StateManager::Snapshot& snapshot, const std::string& address) {
+    StateWitness witness;
+    const auto root = snapshot.get_state_root();
+    std::copy_n(root.begin(), std::min(root.size(), witness.pre_root.size()), witness.pre_root.begin());
+
+    StateWitness::Entry entry;
+    entry.address = address;
+    entry.account = snapshot.get_account(address);
+    if (entry.account) {
+        entry.proof = snapshot.prove_account(address).value_or(StateTrie::Proof{});
+    } else {
+        entry.absence = snapshot.prove_absent(address).value_or(StateTrie::AbsenceProof{});
+    }
+    witness.entries.push_back(std::move(entry));
+    return witness.serialize();
+}
+
+} // namespace rollup
+} // namespace quids
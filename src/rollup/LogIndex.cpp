@@ -0,0 +1,527 @@
+#include "rollup/LogIndex.hpp"
+#include "utils/Hex.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <bit>
+#include <set>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+const std::string BLOCK_PREFIX = "logs/block/";
+const std::string BATCH_PREFIX = "logs/batch/";
+const std::string BITS_PREFIX = "logs/bits/";
+const std::string TX_PREFIX = "logs/tx/";
+const std::string END_KEY = "logs/end";
+// Blocks with any log at all, for filters without constraints
+const std::string ANY_KEY = "*";
+
+constexpr uint8_t BITMAP_ARRAY = 0;
+constexpr uint8_t BITMAP_DENSE = 1;
+
+using Bytes = std::vector<uint8_t>;
+
+void put_hex(std::string& out, const uint8_t* data, size_t size) {
+    const size_t start = out.size();
+    out.resize(start + 2 * size);
+    utils::hexEncode({data, size}, out.data() + start);
+}
+
+// Fixed-width big-endian hex so key order is numeric order
+std::string number_key(const std::string& prefix, uint64_t n) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<uint8_t>(n >> (56 - 8 * i));
+    }
+    std::string key = prefix;
+    put_hex(key, bytes, sizeof(bytes));
+    return key;
+}
+
+std::string address_key(const LogIndex::Address& address) {
+    std::string key = "a";
+    put_hex(key, address.data(), address.size());
+    return key;
+}
+
+std::string topic_key(size_t position, const LogIndex::Topic& topic) {
+    std::string key = "t";
+    key.push_back(static_cast<char>('0' + position));
+    put_hex(key, topic.data(), topic.size());
+    return key;
+}
+
+std::string bitmap_key(const std::string& key, uint64_t batch) {
+    return number_key(BITS_PREFIX + key + "/", batch);
+}
+
+void put_le(Bytes& out, uint64_t v, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+class Reader {
+public:
+    explicit Reader(const Bytes& data) : p_(data.data()), end_(data.data() + data.size()) {}
+
+    const uint8_t* take(size_t n) {
+        if (static_cast<size_t>(end_ - p_) < n) {
+            throw std::runtime_error("Truncated log index record");
+        }
+        const uint8_t* start = p_;
+        p_ += n;
+        return start;
+    }
+
+    uint64_t le(size_t width) {
+        const uint8_t* in = take(width);
+        uint64_t v = 0;
+        for (size_t i = 0; i < width; ++i) {
+            v |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return v;
+    }
+
+    template<size_t N>
+    std::array<uint8_t, N> array() {
+        std::array<uint8_t, N> out;
+        std::copy_n(take(N), N, out.begin());
+        return out;
+    }
+
+    bool done() const { return p_ == end_; }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+// Bloom first, then the receipts
+Bytes encode_block(const LogBloom& bloom, const std::vector<LogIndex::Receipt>& receipts) {
+    Bytes out(bloom.bits.begin(), bloom.bits.end());
+    put_le(out, receipts.size(), 4);
+    for (const auto& receipt : receipts) {
+        out.insert(out.end(), receipt.tx_hash.begin(), receipt.tx_hash.end());
+        out.push_back(receipt.success ? 1 : 0);
+        put_le(out, receipt.gas_used, 8);
+        put_le(out, receipt.logs.size(), 4);
+        for (const auto& log : receipt.logs) {
+            out.insert(out.end(), log.address.begin(), log.address.end());
+            out.push_back(static_cast<uint8_t>(log.topics.size()));
+            for (const auto& topic : log.topics) {
+                out.insert(out.end(), topic.begin(), topic.end());
+            }
+            put_le(out, log.data.size(), 4);
+            out.insert(out.end(), log.data.begin(), log.data.end());
+        }
+    }
+    return out;
+}
+
+LogBloom decode_bloom(Reader& in) {
+    LogBloom bloom;
+    bloom.bits = in.array<LogBloom::BYTES>();
+    return bloom;
+}
+
+std::vector<LogIndex::Receipt> decode_receipts(Reader& in) {
+    std::vector<LogIndex::Receipt> receipts(in.le(4));
+    for (auto& receipt : receipts) {
+        receipt.tx_hash = in.array<32>();
+        receipt.success = *in.take(1) != 0;
+        receipt.gas_used = in.le(8);
+        receipt.logs.resize(in.le(4));
+        for (auto& log : receipt.logs) {
+            log.address = in.array<20>();
+            log.topics.resize(*in.take(1));
+            for (auto& topic : log.topics) {
+                topic = in.array<32>();
+            }
+            const size_t size = in.le(4);
+            const uint8_t* data = in.take(size);
+            log.data.assign(data, data + size);
+        }
+    }
+    return receipts;
+}
+
+// Three 11-bit slices of the hash pick three of the 2048 bits
+std::array<uint16_t, 3> bloom_bits(const uint8_t* data, size_t size) {
+    uint8_t digest[6];
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, data, size);
+    blake3_hasher_finalize(&hasher, digest, sizeof(digest));
+    std::array<uint16_t, 3> bits;
+    for (size_t i = 0; i < 3; ++i) {
+        bits[i] = static_cast<uint16_t>(((digest[2 * i] << 8) | digest[2 * i + 1]) & 0x7FF);
+    }
+    return bits;
+}
+
+bool admits(const LogBloom& bloom, const LogIndex::Filter& filter) {
+    if (!filter.addresses.empty() &&
+        std::none_of(filter.addresses.begin(), filter.addresses.end(), [&](const auto& address) {
+            return bloom.may_contain(address.data(), address.size());
+        })) {
+        return false;
+    }
+    for (const auto& alternatives : filter.topics) {
+        if (!alternatives.empty() &&
+            std::none_of(alternatives.begin(), alternatives.end(), [&](const auto& topic) {
+                return bloom.may_contain(topic.data(), topic.size());
+            })) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool matches(const LogIndex::Log& log, const LogIndex::Filter& filter) {
+    if (!filter.addresses.empty() &&
+        std::find(filter.addresses.begin(), filter.addresses.end(), log.address) == filter.addresses.end()) {
+        return false;
+    }
+    for (size_t i = 0; i < filter.topics.size(); ++i) {
+        const auto& alternatives = filter.topics[i];
+        if (alternatives.empty()) {
+            continue;
+        }
+        if (i >= log.topics.size() ||
+            std::find(alternatives.begin(), alternatives.end(), log.topics[i]) == alternatives.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void LogBloom::add(const uint8_t* data, size_t size) {
+    for (uint16_t bit : bloom_bits(data, size)) {
+        bits[BYTES - 1 - bit / 8] |= static_cast<uint8_t>(1 << (bit % 8));
+    }
+}
+
+bool LogBloom::may_contain(const uint8_t* data, size_t size) const {
+    for (uint16_t bit : bloom_bits(data, size)) {
+        if (!(bits[BYTES - 1 - bit / 8] & (1 << (bit % 8)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LogBloom::merge(const LogBloom& other) {
+    for (size_t i = 0; i < BYTES; ++i) {
+        bits[i] |= other.bits[i];
+    }
+}
+
+bool LogBloom::empty() const {
+    return std::all_of(bits.begin(), bits.end(), [](uint8_t b) { return b == 0; });
+}
+
+LogBloom LogIndex::Receipt::bloom() const {
+    LogBloom bloom;
+    for (const auto& log : logs) {
+        bloom.add(log.address.data(), log.address.size());
+        for (const auto& topic : log.topics) {
+            bloom.add(topic.data(), topic.size());
+        }
+    }
+    return bloom;
+}
+
+void LogIndex::Bitmap::unite(const Bitmap& other) {
+    for (size_t i = 0; i < WORDS; ++i) {
+        words_[i] |= other.words_[i];
+    }
+}
+
+void LogIndex::Bitmap::intersect(const Bitmap& other) {
+    for (size_t i = 0; i < WORDS; ++i) {
+        words_[i] &= other.words_[i];
+    }
+}
+
+void LogIndex::Bitmap::fill() {
+    words_.fill(~uint64_t{0});
+}
+
+std::vector<uint32_t> LogIndex::Bitmap::offsets(size_t first, size_t last) const {
+    std::vector<uint32_t> out;
+    for (size_t w = first / 64; w <= last / 64; ++w) {
+        uint64_t word = words_[w];
+        while (word != 0) {
+            const size_t offset = w * 64 + static_cast<size_t>(std::countr_zero(word));
+            word &= word - 1;
+            if (offset >= first && offset <= last) {
+                out.push_back(static_cast<uint32_t>(offset));
+            }
+        }
+    }
+    return out;
+}
+
+std::vector<uint8_t> LogIndex::Bitmap::encode() const {
+    size_t count = 0;
+    for (uint64_t word : words_) {
+        count += static_cast<size_t>(std::popcount(word));
+    }
+    Bytes out;
+    if (count * 2 < WORDS * 8) {
+        out.push_back(BITMAP_ARRAY);
+        for (uint32_t offset : offsets(0, BATCH_BLOCKS - 1)) {
+            put_le(out, offset, 2);
+        }
+    } else {
+        out.push_back(BITMAP_DENSE);
+        for (uint64_t word : words_) {
+            put_le(out, word, 8);
+        }
+    }
+    return out;
+}
+
+LogIndex::Bitmap LogIndex::Bitmap::decode(const std::vector<uint8_t>& data) {
+    Bitmap bitmap;
+    if (data.empty()) {
+        throw std::runtime_error("Empty log index bitmap");
+    }
+    Reader in(data);
+    const uint8_t kind = *in.take(1);
+    if (kind == BITMAP_ARRAY) {
+        while (!in.done()) {
+            const uint64_t offset = in.le(2);
+            if (offset >= BATCH_BLOCKS) {
+                throw std::runtime_error("Log index bitmap offset out of range");
+            }
+            bitmap.set(offset);
+        }
+    } else if (kind == BITMAP_DENSE) {
+        for (auto& word : bitmap.words_) {
+            word = in.le(8);
+        }
+    } else {
+        throw std::runtime_error("Unknown log index bitmap kind");
+    }
+    return bitmap;
+}
+
+LogIndex::LogIndex(std::shared_ptr<storage::PersistentStorage> storage, bool sync_writes)
+    : storage_(std::move(storage)), sync_writes_(sync_writes) {
+    if (!storage_) {
+        throw std::invalid_argument("Log index needs storage");
+    }
+    if (auto end = storage_->loadState(END_KEY)) {
+        Reader in(*end);
+        end_block_.store(in.le(8));
+    }
+}
+
+LogIndex::Bitmap LogIndex::load_bitmap(const std::string& key, uint64_t batch) const {
+    auto data = storage_->loadState(bitmap_key(key, batch));
+    return data ? Bitmap::decode(*data) : Bitmap{};
+}
+
+LogIndex::Bitmap& LogIndex::open_bitmap(const std::string& key, uint64_t batch) {
+    auto it = open_bitmaps_.find(key);
+    if (it == open_bitmaps_.end()) {
+        it = open_bitmaps_.emplace(key, load_bitmap(key, batch)).first;
+    }
+    return it->second;
+}
+
+bool LogIndex::index_block(uint64_t block_number, const std::vector<Receipt>& receipts) {
+    for (const auto& receipt : receipts) {
+        for (const auto& log : receipt.logs) {
+            if (log.topics.size() > MAX_TOPICS) {
+                throw std::invalid_argument("Log has more than four topics");
+            }
+        }
+    }
+
+    LogBloom bloom;
+    std::set<std::string> keys;
+    for (const auto& receipt : receipts) {
+        bloom.merge(receipt.bloom());
+        for (const auto& log : receipt.logs) {
+            keys.insert(ANY_KEY);
+            keys.insert(address_key(log.address));
+            for (size_t i = 0; i < log.topics.size(); ++i) {
+                keys.insert(topic_key(i, log.topics[i]));
+            }
+        }
+    }
+
+    std::vector<storage::PersistentStorage::StateWrite> writes;
+    writes.reserve(receipts.size() + keys.size() + 3);
+    writes.push_back({number_key(BLOCK_PREFIX, block_number), encode_block(bloom, receipts)});
+    for (size_t i = 0; i < receipts.size(); ++i) {
+        Bytes location;
+        put_le(location, block_number, 8);
+        put_le(location, i, 4);
+        std::string key = TX_PREFIX;
+        put_hex(key, receipts[i].tx_hash.data(), receipts[i].tx_hash.size());
+        writes.push_back({std::move(key), std::move(location)});
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    const uint64_t batch = block_number / BATCH_BLOCKS;
+    if (open_batch_ != batch) {
+        open_bitmaps_.clear();
+        open_bloom_ = batch_bloom(batch);
+        open_batch_ = batch;
+    }
+    const size_t offset = block_number % BATCH_BLOCKS;
+    for (const auto& key : keys) {
+        Bitmap& bitmap = open_bitmap(key, batch);
+        bitmap.set(offset);
+        writes.push_back({bitmap_key(key, batch), bitmap.encode()});
+    }
+    if (!keys.empty()) {
+        open_bloom_.merge(bloom);
+        writes.push_back({number_key(BATCH_PREFIX, batch), Bytes(open_bloom_.bits.begin(), open_bloom_.bits.end())});
+    }
+    const uint64_t end = std::max(end_block_.load(), block_number + 1);
+    Bytes encoded_end;
+    put_le(encoded_end, end, 8);
+    writes.push_back({END_KEY, std::move(encoded_end)});
+
+    if (!storage_->storeStateBatch(writes, sync_writes_)) {
+        // The cache may hold bits that never landed
+        open_batch_.reset();
+        open_bitmaps_.clear();
+        ++failed_writes_;
+        return false;
+    }
+    end_block_.store(end);
+    ++blocks_indexed_;
+    return true;
+}
+
+std::optional<LogIndex::Located> LogIndex::receipt(const Hash& tx_hash) const {
+    std::string key = TX_PREFIX;
+    put_hex(key, tx_hash.data(), tx_hash.size());
+    auto location = storage_->loadState(key);
+    if (!location) {
+        return std::nullopt;
+    }
+    Reader in(*location);
+    Located located;
+    located.block_number = in.le(8);
+    located.tx_index = static_cast<uint32_t>(in.le(4));
+    auto receipts = block_receipts(located.block_number);
+    if (!receipts || located.tx_index >= receipts->size()) {
+        return std::nullopt;
+    }
+    located.receipt = std::move((*receipts)[located.tx_index]);
+    return located;
+}
+
+std::optional<std::vector<LogIndex::Receipt>> LogIndex::block_receipts(uint64_t block_number) const {
+    auto data = storage_->loadState(number_key(BLOCK_PREFIX, block_number));
+    if (!data) {
+        return std::nullopt;
+    }
+    Reader in(*data);
+    in.take(LogBloom::BYTES);
+    return decode_receipts(in);
+}
+
+std::optional<LogBloom> LogIndex::block_bloom(uint64_t block_number) const {
+    auto data = storage_->loadState(number_key(BLOCK_PREFIX, block_number));
+    if (!data) {
+        return std::nullopt;
+    }
+    Reader in(*data);
+    return decode_bloom(in);
+}
+
+LogBloom LogIndex::batch_bloom(uint64_t batch) const {
+    auto data = storage_->loadState(number_key(BATCH_PREFIX, batch));
+    if (!data) {
+        return LogBloom{};
+    }
+    Reader in(*data);
+    return decode_bloom(in);
+}
+
+std::vector<LogIndex::Match> LogIndex::query(const Filter& filter) const {
+    ++queries_;
+    std::vector<Match> out;
+    const uint64_t end = end_block_.load();
+    if (end == 0 || filter.limit == 0 || filter.from_block > filter.to_block || filter.from_block >= end) {
+        return out;
+    }
+    const uint64_t last = std::min(filter.to_block, end - 1);
+
+    for (uint64_t batch = filter.from_block / BATCH_BLOCKS; batch <= last / BATCH_BLOCKS; ++batch) {
+        if (!admits(batch_bloom(batch), filter)) {
+            ++batches_skipped_;
+            continue;
+        }
+
+        Bitmap candidates = load_bitmap(ANY_KEY, batch);
+        if (!filter.addresses.empty()) {
+            Bitmap any;
+            for (const auto& address : filter.addresses) {
+                any.unite(load_bitmap(address_key(address), batch));
+            }
+            candidates.intersect(any);
+        }
+        for (size_t i = 0; i < filter.topics.size() && i < MAX_TOPICS; ++i) {
+            if (filter.topics[i].empty()) {
+                continue;
+            }
+            Bitmap any;
+            for (const auto& topic : filter.topics[i]) {
+                any.unite(load_bitmap(topic_key(i, topic), batch));
+            }
+            candidates.intersect(any);
+        }
+
+        const uint64_t base = batch * BATCH_BLOCKS;
+        const size_t first = batch == filter.from_block / BATCH_BLOCKS ? filter.from_block % BATCH_BLOCKS : 0;
+        const size_t final_offset = batch == last / BATCH_BLOCKS ? last % BATCH_BLOCKS : BATCH_BLOCKS - 1;
+        for (uint32_t offset : candidates.offsets(first, final_offset)) {
+            auto receipts = block_receipts(base + offset);
+            ++blocks_read_;
+            if (!receipts) {
+                continue;
+            }
+            uint32_t log_index = 0;
+            for (size_t tx = 0; tx < receipts->size(); ++tx) {
+                for (auto& log : (*receipts)[tx].logs) {
+                    if (matches(log, filter)) {
+                        out.push_back({base + offset, static_cast<uint32_t>(tx), log_index,
+                                       (*receipts)[tx].tx_hash, std::move(log)});
+                        if (out.size() == filter.limit) {
+                            return out;
+                        }
+                    }
+                    ++log_index;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+LogIndex::Stats LogIndex::stats() const {
+    Stats stats;
+    stats.blocks_indexed = blocks_indexed_.load();
+    stats.queries = queries_.load();
+    stats.batches_skipped = batches_skipped_.load();
+    stats.blocks_read = blocks_read_.load();
+    stats.failed_writes = failed_writes_.load();
+    return stats;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -1,22 +1,147 @@
 #include "rollup/MEVProtection.hpp"
+#include "evm/Address.hpp"
 #include <blake3.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <spdlog/spdlog.h>
 
 namespace quids {
 namespace rollup {
 
-// Define Impl struct in the cpp file
-struct Impl {
+namespace {
+
+// Same-target arrivals a new transaction is compared with. A hot pool can
+// take thousands of transactions per window; the legs of a sandwich or a
+// front-run sit close to their victim.
+constexpr size_t MAX_LOOKBACK = 64;
+
+struct HashHasher {
+    size_t operator()(const blockchain::Hash& h) const noexcept {
+        size_t v;
+        std::memcpy(&v, h.data(), sizeof(v));  // already uniformly distributed
+        return v;
+    }
+};
+
+} // namespace
+
+struct MEVProtection::Impl {
+    struct Pending {
+        blockchain::TransactionPtr tx;
+        ::evm::Address sender;
+        std::chrono::system_clock::time_point arrived;
+        bool flagged{false};
+    };
+
     double high_value_threshold{1000.0};
-    std::unordered_map<std::string, std::chrono::system_clock::time_point> last_transaction_time;
+    // Arrival times within DETECTION_WINDOW per sender, oldest first
+    std::unordered_map<::evm::Address, std::deque<std::chrono::system_clock::time_point>> last_transaction_time;
+
+    // Arrival order is the sequencing order. A deque keeps the entries the
+    // buckets point at in place as it grows.
+    std::deque<Pending> pending;
+    std::unordered_set<blockchain::Hash, HashHasher> seen;
+    // Pending transactions per target, in arrival order
+    std::unordered_map<::evm::Address, std::vector<Pending*>> buckets;
+
+    mutable std::mutex mutex;
+
+    void prune(std::deque<std::chrono::system_clock::time_point>& window,
+               std::chrono::system_clock::time_point now) const {
+        while (!window.empty() && now - window.front() > DETECTION_WINDOW) {
+            window.pop_front();
+        }
+    }
 };
 
 MEVProtection::MEVProtection() noexcept : impl_(std::make_unique<Impl>()) {}
 MEVProtection::~MEVProtection() = default;
+MEVProtection::MEVProtection(MEVProtection&&) noexcept = default;
+MEVProtection& MEVProtection::operator=(MEVProtection&&) noexcept = default;
+
+void MEVProtection::add_transaction(const blockchain::TransactionPtr& tx) {
+    const auto now = std::chrono::system_clock::now();
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    if (!impl_->seen.insert(tx->hash()).second) {
+        return;
+    }
+    const auto sender = ::evm::Address::from_string(tx->getSender());
+    impl_->pending.push_back(Impl::Pending{tx, sender, now, false});
+    Impl::Pending* entry = &impl_->pending.back();
+
+    auto& window = impl_->last_transaction_time[sender];
+    impl_->prune(window, now);
+    window.push_back(now);
+    // Only a sender already active in the window can be closing a sandwich
+    bool check_sandwich = window.size() > 1;
+
+    auto& bucket = impl_->buckets[::evm::Address::from_string(tx->getRecipient())];
+    bool others_between = false;
+    size_t looked = 0;
+    for (auto it = bucket.rbegin(); it != bucket.rend() && looked < MAX_LOOKBACK; ++it, ++looked) {
+        Impl::Pending* other = *it;
+        if (now - other->arrived > DETECTION_WINDOW) {
+            break;
+        }
+        if (other->sender == sender) {
+            // Legs further back were checked when this one arrived
+            if (check_sandwich && others_between) {
+                other->flagged = true;
+                entry->flagged = true;
+            }
+            check_sandwich = false;
+            continue;
+        }
+        others_between = true;
+        if (!entry->flagged && detect_frontrunning(*tx, *other->tx)) {
+            entry->flagged = true;
+        }
+    }
+    bucket.push_back(entry);
+}
+
+std::vector<blockchain::TransactionPtr> MEVProtection::get_optimal_ordering() {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    std::vector<blockchain::TransactionPtr> ordering;
+    ordering.reserve(impl_->pending.size());
+    for (const auto& entry : impl_->pending) {
+        if (!entry.flagged) {
+            ordering.push_back(entry.tx);
+        }
+    }
+    for (const auto& entry : impl_->pending) {
+        if (entry.flagged) {
+            ordering.push_back(entry.tx);
+        }
+    }
+    return ordering;
+}
+
+size_t MEVProtection::pending_count() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    return impl_->pending.size();
+}
+
+void MEVProtection::finalize_batch() {
+    const auto now = std::chrono::system_clock::now();
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->buckets.clear();
+    impl_->pending.clear();
+    impl_->seen.clear();
+    for (auto it = impl_->last_transaction_time.begin(); it != impl_->last_transaction_time.end();) {
+        impl_->prune(it->second, now);
+        it = it->second.empty() ? impl_->last_transaction_time.erase(it) : std::next(it);
+    }
+}
 
 MEVProtection::OrderingCommitment MEVProtection::create_ordering_commitment(
-    const std::vector<blockchain::Transaction>& transactions
+    std::span<const blockchain::TransactionPtr> transactions
 ) const {
     OrderingCommitment commitment;
     commitment.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -28,74 +153,124 @@ MEVProtection::OrderingCommitment MEVProtection::create_ordering_commitment(
 
 double MEVProtection::estimate_profit(const blockchain::Transaction& tx) const {
     // Basic profit estimation based on transaction value and gas price
-    double base_value = static_cast<double>(tx.value);
-    double gas_cost = static_cast<double>(tx.gas_price * tx.gas_limit);
+    double base_value = static_cast<double>(tx.getAmount());
+    double gas_cost = static_cast<double>(tx.getGasPrice()) * static_cast<double>(tx.getGasLimit());
     return base_value - gas_cost;
 }
 
 bool MEVProtection::detect_sandwich_attack(
     const blockchain::Transaction& target,
-    const std::vector<blockchain::Transaction>& batch
+    std::span<const blockchain::TransactionPtr> batch
 ) const {
-    if (batch.size() < 3) return false;
-
-    for (size_t i = 1; i < batch.size() - 1; i++) {
-        if (batch[i].hash == target.hash) {
-            // Check for similar transactions before and after
-            const auto& front = batch[i-1];
-            const auto& back = batch[i+1];
-            
-            if (front.from == back.from && front.to == back.to) {
-                return true;
+    const auto target_hash = target.hash();
+    // Only transactions to the same target can bracket it
+    std::unordered_set<std::string> before;
+    bool found = false;
+    for (const auto& tx : batch) {
+        if (tx->getRecipient() != target.getRecipient()) {
+            continue;
+        }
+        if (!found) {
+            if (tx->hash() == target_hash) {
+                found = true;
+            } else if (tx->getSender() != target.getSender()) {
+                before.insert(tx->getSender());
             }
+        } else if (before.count(tx->getSender())) {
+            return true;
         }
     }
     return false;
 }
 
+std::vector<size_t> MEVProtection::detect_sandwiches(
+    std::span<const blockchain::TransactionPtr> batch
+) const {
+    // Parsed once per transaction, then everything below compares keys
+    std::vector<::evm::Address> senders(batch.size());
+    std::unordered_map<::evm::Address, std::vector<size_t>> buckets;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        senders[i] = ::evm::Address::from_string(batch[i]->getSender());
+        buckets[::evm::Address::from_string(batch[i]->getRecipient())].push_back(i);
+    }
+
+    std::vector<size_t> victims;
+    for (const auto& [target, positions] : buckets) {
+        if (positions.size() < 3) {
+            continue;
+        }
+        // Each sender spans its first to its last transaction in the
+        // bucket; a position strictly inside another sender's span is a
+        // victim
+        std::unordered_map<::evm::Address, std::pair<size_t, size_t>> spans;
+        for (size_t j = 0; j < positions.size(); ++j) {
+            auto [it, inserted] = spans.try_emplace(senders[positions[j]], j, j);
+            it->second.second = j;
+        }
+        std::vector<int> delta(positions.size() + 1, 0);
+        for (const auto& [sender, span] : spans) {
+            if (span.second > span.first + 1) {
+                ++delta[span.first + 1];
+                --delta[span.second];
+            }
+        }
+        int covering = 0;
+        for (size_t j = 0; j < positions.size(); ++j) {
+            covering += delta[j];
+            const auto& own = spans.at(senders[positions[j]]);
+            const int own_cover = own.first < j && j < own.second ? 1 : 0;
+            if (covering - own_cover > 0) {
+                victims.push_back(positions[j]);
+            }
+        }
+    }
+    std::sort(victims.begin(), victims.end());
+    return victims;
+}
+
 bool MEVProtection::detect_frontrunning(
     const blockchain::Transaction& tx1,
     const blockchain::Transaction& tx2
 ) const {
     // Check if transactions are targeting the same contract/address
-    if (tx1.to != tx2.to) {
+    if (tx1.getRecipient() != tx2.getRecipient()) {
         return false;
     }
 
     // Check if tx1 has a significantly higher gas price (>20% higher)
-    if (tx1.gas_price <= tx2.gas_price * 1.2) {
+    if (static_cast<double>(tx1.getGasPrice()) <= static_cast<double>(tx2.getGasPrice()) * 1.2) {
         return false;
     }
 
     // Check timestamp proximity (within 2 blocks / ~30 seconds)
-    constexpr int64_t FRONTRUN_TIME_THRESHOLD = 30000; // 30 seconds in milliseconds
-    int64_t time_diff = std::abs(
-        tx1.timestamp.time_since_epoch().count() - 
-        tx2.timestamp.time_since_epoch().count()
-    );
-    if (time_diff > FRONTRUN_TIME_THRESHOLD) {
+    const auto time_diff = tx1.getTimestamp() > tx2.getTimestamp()
+        ? tx1.getTimestamp() - tx2.getTimestamp()
+        : tx2.getTimestamp() - tx1.getTimestamp();
+    if (time_diff > DETECTION_WINDOW) {
         return false;
     }
 
     // Check for similar transaction characteristics
-    bool similar_value = std::abs(static_cast<double>(tx1.value) - static_cast<double>(tx2.value)) < 
-                        (static_cast<double>(tx2.value) * 0.1); // 10% threshold
-    bool similar_gas_limit = std::abs(static_cast<double>(tx1.gas_limit) - static_cast<double>(tx2.gas_limit)) <
-                            (static_cast<double>(tx2.gas_limit) * 0.1); // 10% threshold
+    const double value1 = static_cast<double>(tx1.getAmount());
+    const double value2 = static_cast<double>(tx2.getAmount());
+    const double gas1 = static_cast<double>(tx1.getGasLimit());
+    const double gas2 = static_cast<double>(tx2.getGasLimit());
+    bool similar_value = std::abs(value1 - value2) < value2 * 0.1; // 10% threshold
+    bool similar_gas_limit = std::abs(gas1 - gas2) < gas2 * 0.1; // 10% threshold
 
     // If transactions have similar characteristics but different senders, likely frontrunning
-    return similar_value && similar_gas_limit && (tx1.from != tx2.from);
+    return similar_value && similar_gas_limit && tx1.getSender() != tx2.getSender();
 }
 
 std::array<uint8_t, 32> MEVProtection::compute_fairness_hash(
-    const std::vector<blockchain::Transaction>& transactions
+    std::span<const blockchain::TransactionPtr> transactions
 ) const {
     std::array<uint8_t, 32> hash;
     blake3_hasher hasher;
     blake3_hasher_init(&hasher);
 
     for (const auto& tx : transactions) {
-        auto tx_hash = compute_transaction_hash(tx);
+        auto tx_hash = compute_transaction_hash(*tx);
         blake3_hasher_update(&hasher, tx_hash.data(), tx_hash.size());
     }
 
@@ -106,44 +281,13 @@ std::array<uint8_t, 32> MEVProtection::compute_fairness_hash(
 std::vector<uint8_t> MEVProtection::compute_transaction_hash(
     const blockchain::Transaction& tx
 ) const {
-    std::vector<uint8_t> hash(BLAKE3_OUT_LEN);
-    blake3_hasher hasher;
-    blake3_hasher_init(&hasher);
-
-    // Hash from address
-    blake3_hasher_update(&hasher, tx.from.data(), tx.from.size());
-
-    // Hash to address
-    blake3_hasher_update(&hasher, tx.to.data(), tx.to.size());
-
-    // Hash value (convert to bytes first)
-    auto value_bytes = reinterpret_cast<const uint8_t*>(&tx.value);
-    blake3_hasher_update(&hasher, value_bytes, sizeof(tx.value));
-
-    // Hash gas price
-    auto gas_price_bytes = reinterpret_cast<const uint8_t*>(&tx.gas_price);
-    blake3_hasher_update(&hasher, gas_price_bytes, sizeof(tx.gas_price));
-
-    // Hash gas limit
-    auto gas_limit_bytes = reinterpret_cast<const uint8_t*>(&tx.gas_limit);
-    blake3_hasher_update(&hasher, gas_limit_bytes, sizeof(tx.gas_limit));
-
-    // Hash nonce
-    auto nonce_bytes = reinterpret_cast<const uint8_t*>(&tx.nonce);
-    blake3_hasher_update(&hasher, nonce_bytes, sizeof(tx.nonce));
-
-    // Hash input data if present
-    if (!tx.data.empty()) {
-        blake3_hasher_update(&hasher, tx.data.data(), tx.data.size());
-    }
-
-    // Finalize hash
-    blake3_hasher_finalize(&hasher, hash.data(), BLAKE3_OUT_LEN);
-    return hash;
+    // Memoized on the transaction, so re-ordering checks are free
+    const auto hash = tx.hash();
+    return {hash.begin(), hash.end()};
 }
 
 double MEVProtection::calculate_transaction_value(const blockchain::Transaction& tx) const {
-    return static_cast<double>(tx.value);
+    return static_cast<double>(tx.getAmount());
 }
 
 bool MEVProtection::is_high_value_transaction(const blockchain::Transaction& tx) const {
@@ -0,0 +1,412 @@
+#include "rollup/Mempool.hpp"
+#include "memory/MemoryBudget.hpp"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// What an entry holds: the shared transaction and its control block, its
+// payload and sender, one node in the sender's nonce map and one in the
+// shard's fee index
+size_t entry_bytes(const blockchain::Transaction& tx) {
+    constexpr size_t NODE_OVERHEAD = 4 * sizeof(void*);
+    return sizeof(blockchain::StandardTransaction) + tx.getData().size() + tx.getSender().size() +
+           3 * NODE_OVERHEAD + sizeof(uint64_t) * 4;
+}
+
+void count(Mempool::Stats& stats, Mempool::AddResult result) {
+    switch (result) {
+        case Mempool::AddResult::Added: stats.added++; break;
+        case Mempool::AddResult::Replaced: stats.replaced++; break;
+        default: stats.rejected++; break;
+    }
+}
+
+} // namespace
+
+Mempool::Mempool(const Config& config)
+    : config_(config),
+      pool_(utils::WorkStealingPool::global()) {
+    const size_t shard_count = round_up_pow2(std::max<size_t>(1, config_.shard_count));
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+    shard_mask_ = shard_count - 1;
+    shard_capacity_ = std::max<size_t>(1, (config_.capacity + shard_count - 1) / shard_count);
+}
+
+Mempool::Mempool() : Mempool(Config{}) {}
+
+Mempool::~Mempool() {
+    clear();
+}
+
+bool Mempool::is_accepted(AddResult result) {
+    return result == AddResult::Added || result == AddResult::Replaced;
+}
+
+Mempool::Shard& Mempool::shard_for(const std::string& sender) {
+    return *shards_[std::hash<std::string>{}(sender) & shard_mask_];
+}
+
+Mempool::AddResult Mempool::submit(TransactionPtr tx) {
+    Shard& shard = shard_for(tx->getSender());
+    Stats delta;
+    AddResult result;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        result = add_locked(shard, tx, delta);
+    }
+    count(delta, result);
+    merge_stats(delta);
+    return result;
+}
+
+std::vector<Mempool::AddResult> Mempool::submit_batch(const std::vector<TransactionPtr>& txs) {
+    std::vector<AddResult> results(txs.size(), AddResult::PoolFull);
+
+    std::vector<std::vector<size_t>> by_shard(shards_.size());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        by_shard[std::hash<std::string>{}(txs[i]->getSender()) & shard_mask_].push_back(i);
+    }
+
+    // Each shard is locked once for its whole slice of the batch
+    auto ingest = [&](size_t s) {
+        if (by_shard[s].empty()) {
+            return;
+        }
+        Shard& shard = *shards_[s];
+        Stats delta;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (size_t i : by_shard[s]) {
+                results[i] = add_locked(shard, txs[i], delta);
+                count(delta, results[i]);
+            }
+        }
+        merge_stats(delta);
+    };
+
+    if (txs.size() >= config_.parallel_batch_threshold) {
+        pool_.parallel_for(0, shards_.size(), ingest, utils::TaskPriority::Execution);
+    } else {
+        for (size_t s = 0; s < shards_.size(); ++s) {
+            ingest(s);
+        }
+    }
+    return results;
+}
+
+Mempool::AddResult Mempool::add_locked(Shard& shard, const TransactionPtr& tx, Stats& stats) {
+    const uint64_t nonce = tx->getNonce();
+    const uint64_t fee = tx->getGasPrice();
+
+    auto& slot = shard.senders[tx->getSender()];
+    if (!slot) {
+        slot = std::make_unique<Sender>();
+        slot->address = tx->getSender();
+    }
+    Sender& sender = *slot;
+
+    if (nonce < sender.committed_floor) {
+        return AddResult::NonceTooLow;
+    }
+
+    auto existing = sender.txs.find(nonce);
+    if (existing != sender.txs.end()) {
+        Entry& old = existing->second;
+        if (old.fee == fee && old.tx->hash() == tx->hash()) {
+            return AddResult::Duplicate;
+        }
+        const uint64_t pct = config_.replacement_bump_percent;
+        const uint64_t bump = old.fee / 100 * pct + (old.fee % 100) * pct / 100;
+        if (fee < old.fee + std::max<uint64_t>(1, bump)) {
+            return AddResult::Underpriced;
+        }
+
+        const size_t bytes = entry_bytes(*tx);
+        auto& accountant = memory::MemoryAccountant::global();
+        if (bytes > old.bytes && !accountant.try_charge(memory::Subsystem::Mempool, bytes - old.bytes)) {
+            return AddResult::PoolFull;
+        }
+        if (bytes < old.bytes) {
+            accountant.release(memory::Subsystem::Mempool, old.bytes - bytes);
+        }
+
+        const bool is_head = existing == sender.txs.begin();
+        if (is_head) detach_head(shard, sender);
+        shard.by_fee.erase(FeeKey{old.fee, old.seq, &sender, nonce});
+        old = Entry{tx, fee, next_seq_.fetch_add(1, std::memory_order_relaxed), bytes};
+        shard.by_fee.insert(FeeKey{old.fee, old.seq, &sender, nonce});
+        if (is_head) attach_head(shard, sender);
+        return AddResult::Replaced;
+    }
+
+    if (sender.txs.size() >= config_.max_per_sender) {
+        erase_if_idle(shard, sender);
+        return AddResult::SenderFull;
+    }
+    if (shard.count >= shard_capacity_ && !evict_below(shard, fee, sender, stats)) {
+        erase_if_idle(shard, sender);
+        return AddResult::PoolFull;
+    }
+    // Over budget the newcomer has to displace cheaper entries, one sender's
+    // tail at a time, exactly as it would in a full shard
+    const size_t bytes = entry_bytes(*tx);
+    while (!memory::MemoryAccountant::global().try_charge(memory::Subsystem::Mempool, bytes)) {
+        if (!evict_below(shard, fee, sender, stats)) {
+            erase_if_idle(shard, sender);
+            return AddResult::PoolFull;
+        }
+    }
+
+    const bool new_head = sender.txs.empty() || nonce < sender.txs.begin()->first;
+    if (new_head) detach_head(shard, sender);
+    const uint64_t seq = next_seq_.fetch_add(1, std::memory_order_relaxed);
+    sender.txs.emplace(nonce, Entry{tx, fee, seq, bytes});
+    shard.by_fee.insert(FeeKey{fee, seq, &sender, nonce});
+    shard.count++;
+    size_.fetch_add(1, std::memory_order_acq_rel);
+    if (new_head) attach_head(shard, sender);
+    return AddResult::Added;
+}
+
+void Mempool::detach_head(Shard& shard, Sender& sender) {
+    if (!sender.has_head) {
+        return;
+    }
+    const auto& [nonce, entry] = *sender.txs.begin();
+    shard.heads.erase(FeeKey{entry.fee, entry.seq, &sender, nonce});
+    sender.has_head = false;
+}
+
+void Mempool::attach_head(Shard& shard, Sender& sender) {
+    if (sender.has_head || sender.txs.empty()) {
+        return;
+    }
+    const auto& [nonce, entry] = *sender.txs.begin();
+    shard.heads.insert(FeeKey{entry.fee, entry.seq, &sender, nonce});
+    sender.has_head = true;
+}
+
+size_t Mempool::remove_range(Shard& shard, Sender& sender,
+                             std::map<uint64_t, Entry>::iterator first,
+                             std::map<uint64_t, Entry>::iterator last) {
+    if (first == last) {
+        return 0;
+    }
+    const bool touches_head = first == sender.txs.begin();
+    if (touches_head) detach_head(shard, sender);
+
+    size_t removed = 0;
+    size_t bytes = 0;
+    for (auto it = first; it != last; ++it, ++removed) {
+        shard.by_fee.erase(FeeKey{it->second.fee, it->second.seq, &sender, it->first});
+        bytes += it->second.bytes;
+    }
+    memory::MemoryAccountant::global().release(memory::Subsystem::Mempool, bytes);
+    sender.txs.erase(first, last);
+    shard.count -= removed;
+    size_.fetch_sub(removed, std::memory_order_acq_rel);
+
+    if (touches_head) attach_head(shard, sender);
+    return removed;
+}
+
+void Mempool::erase_if_idle(Shard& shard, Sender& sender) {
+    if (!sender.txs.empty()) {
+        return;
+    }
+    auto it = shard.senders.find(sender.address);
+    if (it != shard.senders.end()) {
+        shard.senders.erase(it);
+    }
+}
+
+bool Mempool::evict_below(Shard& shard, uint64_t fee, const Sender& keep, Stats& stats) {
+    if (shard.by_fee.empty()) {
+        return false;
+    }
+    const FeeKey victim = *std::prev(shard.by_fee.end());
+    if (victim.fee >= fee || victim.sender == &keep) {
+        return false;
+    }
+
+    // Later nonces of the victim could never execute, so they go too
+    Sender& sender = *victim.sender;
+    stats.evicted += remove_range(shard, sender, sender.txs.find(victim.nonce), sender.txs.end());
+    erase_if_idle(shard, sender);
+    return true;
+}
+
+std::vector<std::unique_lock<std::mutex>> Mempool::lock_all() const {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(shards_.size());
+    for (const auto& shard : shards_) {
+        locks.emplace_back(shard->mutex);
+    }
+    return locks;
+}
+
+std::vector<Mempool::Pick> Mempool::pick_locked(size_t k) const {
+    // Candidates are either the next sender head of a shard or the next
+    // nonce of a sender just picked; every pick adds at most two, so the
+    // heap stays O(k + shards)
+    struct Candidate {
+        FeeKey key;
+        size_t shard;
+        std::set<FeeKey>::const_iterator head;  // end() for nonce successors
+    };
+    auto worse = [](const Candidate& a, const Candidate& b) { return b.key < a.key; };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(worse)> heap(worse);
+
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        const auto& heads = shards_[s]->heads;
+        if (!heads.empty()) {
+            heap.push(Candidate{*heads.begin(), s, heads.begin()});
+        }
+    }
+
+    std::vector<Pick> picks;
+    picks.reserve(std::min(k, size()));
+    while (picks.size() < k && !heap.empty()) {
+        Candidate c = heap.top();
+        heap.pop();
+        picks.push_back(Pick{c.key, c.shard});
+
+        const auto& heads = shards_[c.shard]->heads;
+        if (c.head != heads.end()) {
+            auto next = std::next(c.head);
+            if (next != heads.end()) {
+                heap.push(Candidate{*next, c.shard, next});
+            }
+        }
+
+        // A gap in the nonces ends the sender's run
+        const auto& txs = c.key.sender->txs;
+        auto successor = txs.find(c.key.nonce + 1);
+        if (successor != txs.end()) {
+            const Entry& entry = successor->second;
+            heap.push(Candidate{FeeKey{entry.fee, entry.seq, c.key.sender, successor->first},
+                                c.shard, heads.end()});
+        }
+    }
+    return picks;
+}
+
+std::vector<Mempool::TransactionPtr> Mempool::select(size_t k) const {
+    auto locks = lock_all();
+    std::vector<TransactionPtr> out;
+    for (const auto& pick : pick_locked(k)) {
+        out.push_back(pick.key.sender->txs.at(pick.key.nonce).tx);
+    }
+    return out;
+}
+
+std::vector<Mempool::TransactionPtr> Mempool::take(size_t k) {
+    std::vector<TransactionPtr> out;
+    {
+        auto locks = lock_all();
+        auto picks = pick_locked(k);
+        out.reserve(picks.size());
+        // A sender's picks come in nonce order, so each is the lowest
+        // remaining entry by the time it is removed
+        for (const auto& pick : picks) {
+            Shard& shard = *shards_[pick.shard];
+            Sender& sender = *pick.key.sender;
+            auto it = sender.txs.begin();
+            out.push_back(std::move(it->second.tx));
+            remove_range(shard, sender, it, std::next(it));
+            erase_if_idle(shard, sender);
+        }
+    }
+    Stats delta;
+    delta.taken = out.size();
+    merge_stats(delta);
+    return out;
+}
+
+void Mempool::on_committed(const std::string& sender_address, uint64_t nonce) {
+    Shard& shard = shard_for(sender_address);
+    Stats delta;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.senders.find(sender_address);
+        if (it == shard.senders.end()) {
+            return;
+        }
+        Sender& sender = *it->second;
+        sender.committed_floor = std::max(sender.committed_floor, nonce + 1);
+        delta.pruned = remove_range(shard, sender, sender.txs.begin(), sender.txs.upper_bound(nonce));
+        erase_if_idle(shard, sender);
+    }
+    merge_stats(delta);
+}
+
+std::vector<Mempool::TransactionPtr> Mempool::extract_senders(
+    const std::function<bool(const std::string&)>& moves) {
+    std::vector<TransactionPtr> out;
+    auto locks = lock_all();
+    for (auto& shard : shards_) {
+        for (auto it = shard->senders.begin(); it != shard->senders.end();) {
+            Sender& sender = *it->second;
+            if (!moves(sender.address)) {
+                ++it;
+                continue;
+            }
+            for (auto& [nonce, entry] : sender.txs) {
+                out.push_back(std::move(entry.tx));
+            }
+            remove_range(*shard, sender, sender.txs.begin(), sender.txs.end());
+            it = shard->senders.erase(it);
+        }
+    }
+    return out;
+}
+
+void Mempool::clear() {
+    auto locks = lock_all();
+    size_t bytes = 0;
+    for (auto& shard : shards_) {
+        for (const auto& [address, sender] : shard->senders) {
+            for (const auto& [nonce, entry] : sender->txs) {
+                bytes += entry.bytes;
+            }
+        }
+        shard->heads.clear();
+        shard->by_fee.clear();
+        shard->senders.clear();
+        shard->count = 0;
+    }
+    memory::MemoryAccountant::global().release(memory::Subsystem::Mempool, bytes);
+    size_.store(0, std::memory_order_release);
+}
+
+void Mempool::merge_stats(const Stats& delta) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.added += delta.added;
+    stats_.replaced += delta.replaced;
+    stats_.rejected += delta.rejected;
+    stats_.evicted += delta.evicted;
+    stats_.taken += delta.taken;
+    stats_.pruned += delta.pruned;
+}
+
+Mempool::Stats Mempool::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -6,13 +6,25 @@ using quids::zkp::QZKPGenerator;
 using quids::rollup::StateManager;
 using quids::rollup::StateTransitionProof;
 
+OptimisticAdapter::OptimisticAdapter(std::shared_ptr<quids::rollup::ChallengeIndex> index)
+    : index_(std::move(index)) {}
+
 OptimisticAdapter::OptimisticProof OptimisticAdapter::convert_to_optimistic(
     const StateTransitionProof& zk_proof) {
     OptimisticProof optimistic_proof;
     optimistic_proof.zk_proof = zk_proof;
-    optimistic_proof.challenge_period_end = std::chrono::system_clock::now() + 
-                                          std::chrono::hours(24 * 7);
+    optimistic_proof.challenge_period_end = std::chrono::system_clock::now() + CHALLENGE_PERIOD;
     optimistic_proof.has_fraud_proof = false;
+
+    if (index_) {
+        quids::rollup::ChallengeIndex::Commitment commitment;
+        commitment.batch_number = zk_proof.batch_number;
+        commitment.pre_state_root = zk_proof.pre_state_root;
+        commitment.post_state_root = zk_proof.post_state_root;
+        commitment.batch_hash = zk_proof.batch_hash;
+        commitment.window_end = optimistic_proof.challenge_period_end;
+        index_->add(commitment);
+    }
     return optimistic_proof;
 }
 
@@ -22,6 +34,13 @@ bool OptimisticAdapter::verify_optimistic_proof(
 ) {
     (void)state_manager;  // Suppress unused parameter warning
 
+    if (index_) {
+        auto commitment = index_->find(proof.zk_proof.post_state_root);
+        if (commitment && commitment->status == quids::rollup::ChallengeIndex::Status::Challenged) {
+            return false;
+        }
+    }
+
     // Proceed with the rest of the function
     StateManager temp_state;
     
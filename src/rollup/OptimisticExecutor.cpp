@@ -0,0 +1,308 @@
+#include "rollup/OptimisticExecutor.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <algorithm>
+
+namespace quids {
+namespace rollup {
+
+class OptimisticExecutor::MVMemory {
+public:
+    struct Entry {
+        uint32_t incarnation;
+        Value value;
+    };
+
+    struct Resolved {
+        int64_t writer;
+        uint32_t incarnation;
+        const Value* value;
+    };
+
+    // Latest write of a transaction below `tx_index`
+    std::optional<Value> read(const Key& key, size_t tx_index, int64_t& writer, uint32_t& incarnation) {
+        auto& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto resolved = resolve(shard, key, tx_index);
+        writer = resolved.writer;
+        incarnation = resolved.incarnation;
+        if (resolved.value) {
+            return *resolved.value;
+        }
+        return std::nullopt;
+    }
+
+    bool still_valid(const View::ReadDescriptor& read, size_t tx_index) {
+        auto& shard = shard_for(read.key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto resolved = resolve(shard, read.key, tx_index);
+        return resolved.writer == read.writer && resolved.incarnation == read.incarnation;
+    }
+
+    void write(const Key& key, size_t tx_index, uint32_t incarnation, Value value) {
+        auto& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.versions[key][tx_index] = Entry{incarnation, std::move(value)};
+    }
+
+    void erase(const Key& key, size_t tx_index) {
+        auto& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.versions.find(key);
+        if (it != shard.versions.end()) {
+            it->second.erase(tx_index);
+        }
+    }
+
+    std::vector<std::pair<Key, Value>> final_writes() {
+        std::vector<std::pair<Key, Value>> result;
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto& [key, versions] : shard.versions) {
+                if (!versions.empty()) {
+                    result.emplace_back(key, versions.rbegin()->second.value);
+                }
+            }
+        }
+        // Deterministic commit order regardless of hashing
+        std::sort(result.begin(), result.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+        return result;
+    }
+
+private:
+    static constexpr size_t NUM_SHARDS = 64;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<Key, std::map<size_t, Entry>> versions;
+    };
+
+    Shard& shard_for(const Key& key) {
+        return shards_[std::hash<Key>{}(key) % NUM_SHARDS];
+    }
+
+    static Resolved resolve(Shard& shard, const Key& key, size_t tx_index) {
+        auto it = shard.versions.find(key);
+        if (it == shard.versions.end() || it->second.empty()) {
+            return {-1, 0, nullptr};
+        }
+        auto& versions = it->second;
+        auto v = versions.lower_bound(tx_index);
+        if (v == versions.begin()) {
+            return {-1, 0, nullptr};
+        }
+        --v;
+        return {static_cast<int64_t>(v->first), v->second.incarnation, &v->second.value};
+    }
+
+    std::array<Shard, NUM_SHARDS> shards_;
+};
+
+std::optional<OptimisticExecutor::Value> OptimisticExecutor::View::read(const Key& key) {
+    // Own writes first
+    auto own = writes_.find(key);
+    if (own != writes_.end()) {
+        return own->second;
+    }
+
+    int64_t writer = -1;
+    uint32_t incarnation = 0;
+    auto value = memory_.read(key, tx_index_, writer, incarnation);
+    reads_.push_back({key, writer, incarnation});
+    if (writer >= 0) {
+        return value;
+    }
+    return base_(key);
+}
+
+void OptimisticExecutor::View::write(const Key& key, Value value) {
+    writes_[key] = std::move(value);
+}
+
+OptimisticExecutor::OptimisticExecutor(const Config& config) : config_(config) {
+    if (config_.num_threads == 0) {
+        config_.num_threads = 1;
+    }
+}
+
+OptimisticExecutor::OptimisticExecutor() : OptimisticExecutor(Config{}) {}
+
+OptimisticExecutor::~OptimisticExecutor() = default;
+
+OptimisticExecutor::Result OptimisticExecutor::execute(
+    size_t tx_count,
+    const BaseReader& base,
+    const ExecuteFn& fn
+) {
+    struct TxState {
+        uint32_t incarnation{0};
+        bool success{false};
+        std::vector<View::ReadDescriptor> reads;
+        std::vector<Key> written_keys;
+    };
+
+    Result result;
+    MVMemory memory;
+    std::vector<TxState> states(tx_count);
+    std::atomic<size_t> executions{0};
+
+    auto run_one = [&](size_t idx) {
+        auto& state = states[idx];
+        View view(idx, memory, base);
+        bool ok = fn(idx, view);
+        uint32_t incarnation = ++state.incarnation;
+
+        // Drop versions this incarnation no longer writes
+        for (const auto& key : state.written_keys) {
+            if (view.writes_.find(key) == view.writes_.end()) {
+                memory.erase(key, idx);
+            }
+        }
+        state.written_keys.clear();
+        for (auto& [key, value] : view.writes_) {
+            state.written_keys.push_back(key);
+            memory.write(key, idx, incarnation, std::move(value));
+        }
+
+        state.reads = std::move(view.reads_);
+        state.success = ok;
+        executions.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    auto parallel_for = [&](const std::vector<size_t>& indices, auto&& body) {
+        if (config_.num_threads <= 1 || indices.size() <= 1) {
+            for (size_t idx : indices) body(idx);
+            return;
+        }
+        utils::WorkStealingPool::global().parallel_for(0, indices.size(), [&](size_t i) {
+            body(indices[i]);
+        }, utils::TaskPriority::Execution);
+    };
+
+    std::vector<size_t> pending(tx_count);
+    for (size_t i = 0; i < tx_count; ++i) pending[i] = i;
+
+    while (!pending.empty() && result.metrics.rounds < config_.max_rounds) {
+        parallel_for(pending, run_one);
+        result.metrics.rounds++;
+
+        // Everything below the lowest re-executed transaction is final
+        const size_t first = pending.front();
+        std::vector<size_t> to_validate;
+        to_validate.reserve(tx_count - first);
+        for (size_t i = first + 1; i < tx_count; ++i) to_validate.push_back(i);
+
+        std::vector<uint8_t> invalid(tx_count, 0);
+        parallel_for(to_validate, [&](size_t idx) {
+            for (const auto& read : states[idx].reads) {
+                if (!memory.still_valid(read, idx)) {
+                    invalid[idx] = 1;
+                    return;
+                }
+            }
+        });
+
+        pending.clear();
+        for (size_t idx : to_validate) {
+            if (invalid[idx]) pending.push_back(idx);
+        }
+    }
+
+    if (!pending.empty()) {
+        // Long dependency chain: finish the suffix in order, which reads
+        // exactly what sequential execution would
+        result.metrics.sequential_fallback = true;
+        for (size_t idx = pending.front(); idx < tx_count; ++idx) {
+            run_one(idx);
+        }
+    }
+
+    result.metrics.executions = executions.load();
+    result.metrics.reexecutions = result.metrics.executions - tx_count;
+    result.success.resize(tx_count);
+    for (size_t i = 0; i < tx_count; ++i) {
+        result.success[i] = states[i].success;
+    }
+    result.writes = memory.final_writes();
+    return result;
+}
+
+template <typename At>
+OptimisticExecutor::Result OptimisticExecutor::apply_transfers(
+    StateManager& state,
+    size_t count,
+    const At& at
+) {
+    // Signatures do not depend on state, check them once up front
+    std::vector<uint8_t> verified(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        verified[i] = at(i).verified() ? 1 : 0;
+    }
+
+    BaseReader base = [&state](const Key& key) {
+        return state.get_account(key);
+    };
+
+    auto result = execute(count, base, [&](size_t idx, View& view) {
+        const blockchain::Transaction& tx = at(idx);
+        if (!verified[idx]) {
+            return false;
+        }
+
+        auto sender = view.read(tx.getSender());
+        if (!sender || !view.read(tx.getRecipient())) {
+            return false;
+        }
+        if (tx.getNonce() != sender->nonce + 1) {
+            return false;
+        }
+
+        uint64_t total_cost = tx.getAmount() + tx.calculate_gas_cost();
+        if (sender->balance < total_cost) {
+            return false;
+        }
+
+        sender->balance -= total_cost;
+        sender->nonce++;
+        view.write(tx.getSender(), *sender);
+
+        // Re-read so a self transfer sees the debit above
+        auto recipient = view.read(tx.getRecipient());
+        recipient->balance += tx.getAmount();
+        view.write(tx.getRecipient(), *recipient);
+        return true;
+    });
+
+    for (const auto& [address, account] : result.writes) {
+        state.add_account(address, account);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (result.success[i]) {
+            state.record_transaction(at(i).getSender(), at(i));
+            state.record_transaction(at(i).getRecipient(), at(i));
+        }
+    }
+
+    return result;
+}
+
+OptimisticExecutor::Result OptimisticExecutor::apply_batch(
+    StateManager& state,
+    const std::vector<blockchain::Transaction>& txs
+) {
+    return apply_transfers(state, txs.size(), [&txs](size_t i) -> const blockchain::Transaction& {
+        return txs[i];
+    });
+}
+
+OptimisticExecutor::Result OptimisticExecutor::apply_batch(
+    StateManager& state,
+    std::span<const blockchain::TransactionPtr> txs
+) {
+    return apply_transfers(state, txs.size(), [txs](size_t i) -> const blockchain::Transaction& {
+        return *txs[i];
+    });
+}
+
+} // namespace rollup
+} // namespace quids
@@ -6,6 +6,8 @@
 #include "evm/EVMExecutor.hpp"
 
 #include "blockchain/Transaction.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/Tracing.hpp"
 #include <future>
 
 #include <algorithm>
@@ -16,30 +18,61 @@ namespace quids {
 namespace rollup {
 
 using blockchain::Transaction;
+using blockchain::TransactionPtr;
 using quids::evm::EVMExecutor;
 using ::evm::Address;
 using quids::EVMConfig;
 
+namespace {
+
+// Calls one drain task runs before re-queueing itself behind other work
+constexpr size_t DRAIN_BATCH = 32;
+
+Mempool::Config mempoolConfig(size_t capacity) {
+    Mempool::Config config;
+    config.capacity = capacity;
+    return config;
+}
+
+ParallelProcessor::ContractResult stoppedResult() {
+    std::promise<EVMExecutor::ExecutionResult> promise;
+    promise.set_value(EVMExecutor::ExecutionResult{false, {}, 0, "Processor stopped", {}});
+    return promise.get_future();
+}
+
+} // namespace
+
 // Remove duplicate struct definition since it's now in the header
 // struct ContractCall { ... }
 
+// Shared by every processor in the process and exported through the
+// global registry; recording is lock-free
 struct ProcessingMetrics {
-    std::mutex mutex;
-    uint64_t failed_transactions{0};
-    uint64_t failed_contracts{0};
-    
-    void update_transaction(bool success, std::chrono::microseconds latency) {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (!success) failed_transactions++;
-        // Store latency for metrics if needed
-        (void)latency;
+    std::shared_ptr<utils::Counter> failed_transactions;
+    std::shared_ptr<utils::Counter> failed_contracts;
+    std::shared_ptr<utils::Histogram> transaction_latency;
+    std::shared_ptr<utils::Histogram> contract_latency;
+
+    ProcessingMetrics() {
+        auto& registry = utils::MetricsRegistry::global();
+        failed_transactions = registry.counter("quids_processor_failures_total", "Failed executions",
+                                               {{"kind", "transaction"}});
+        failed_contracts = registry.counter("quids_processor_failures_total", "Failed executions",
+                                            {{"kind", "contract"}});
+        transaction_latency = registry.histogram("quids_processor_latency_seconds", "Execution latency",
+                                                 {{"kind", "transaction"}});
+        contract_latency = registry.histogram("quids_processor_latency_seconds", "Execution latency",
+                                              {{"kind", "contract"}});
     }
-    
-    void update_contract(bool success, std::chrono::microseconds latency) {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (!success) failed_contracts++;
-        // Store latency for metrics if needed
-        (void)latency;
+
+    void update_transaction(bool success, std::chrono::nanoseconds latency) {
+        if (!success) failed_transactions->add();
+        transaction_latency->record(latency);
+    }
+
+    void update_contract(bool success, std::chrono::nanoseconds latency) {
+        if (!success) failed_contracts->add();
+        contract_latency->record(latency);
     }
 };
 
@@ -48,15 +81,13 @@ public:
     ProcessingMetrics metrics;
     std::mutex contract_states_mutex_;
     std::mutex account_states_mutex_;
-    std::queue<ContractCall> contract_queue_;
-    std::mutex contract_queue_mutex_;
-    std::condition_variable contract_queue_cv_;
     std::unordered_map<Address, ContractState> contract_states_;
-    std::unordered_map<std::string, AccountState> account_states_;
+    std::unordered_map<Address, AccountState> account_states_;
 };
 
 ParallelProcessor::ParallelProcessor(const Config& config)
-    : should_stop_(false)
+    : impl_(std::make_unique<Impl>())
+    , should_stop_(false)
     , config_({
         .num_worker_threads = config.num_threads,
         .max_queue_size = config.batch_size,
@@ -65,169 +96,264 @@ ParallelProcessor::ParallelProcessor(const Config& config)
         .max_batch_size = config.batch_size,
         .max_gas_per_block = 15000000,
         .target_block_time_ms = 2000
-    }) {
-    startWorkers();
+    })
+    , pool_(utils::WorkStealingPool::global())
+    , mempool_(mempoolConfig(config_.max_queue_size)) {
+    initExecutors();
+}
+
+void ParallelProcessor::initExecutors() {
+    // Built once here so no call pays for executor construction
+    evm_executors_.reserve(pool_.size() + 1);
+    for (size_t i = 0; i <= pool_.size(); ++i) {
+        evm_executors_.push_back(std::make_unique<EVMExecutor>(EVMConfig{}));
+    }
 }
 
 ParallelProcessor::~ParallelProcessor() {
-    stopWorkers();
+    should_stop_ = true;
+    waitForInFlight();
 }
 
 void ParallelProcessor::start() {
     should_stop_ = false;
-    startWorkers();
 }
 
 void ParallelProcessor::stop() {
     should_stop_ = true;
-    transaction_queue_cv_.notify_all();
 }
 
-void ParallelProcessor::startWorkers() {
-    should_stop_ = false;
-    
-    // Start worker threads
-    for (size_t i = 0; i < config_.num_worker_threads; ++i) {
-        worker_threads_.emplace_back(&ParallelProcessor::workerThread, this);
-    }
-    
-    // Start contract worker threads
-    if (config_.enable_contract_parallelization) {
-        for (size_t i = 0; i < config_.max_parallel_contracts; ++i) {
-            contract_worker_threads_.emplace_back(&ParallelProcessor::contractWorkerThread, this);
+void ParallelProcessor::waitForInFlight() {
+    // Help the pool instead of sleeping so this cannot deadlock when called
+    // from a pool thread
+    while (in_flight_.load(std::memory_order_acquire) != 0) {
+        if (!pool_.run_one()) {
+            std::this_thread::yield();
         }
     }
 }
 
-void ParallelProcessor::stopWorkers() {
-    should_stop_ = true;
-    
-    // Wake up all worker threads
-    transaction_queue_cv_.notify_all();
-    contract_queue_cv_.notify_all();
+bool ParallelProcessor::submitTransaction(TransactionPtr tx) {
+    if (should_stop_) return false;
     
-    // Join worker threads
-    for (auto& thread : worker_threads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
+    auto result = mempool_.submit(std::move(tx));
+    if (result == Mempool::AddResult::Replaced) {
+        // Took over a slot that already has a task
+        return true;
     }
-    
-    // Join contract worker threads
-    for (auto& thread : contract_worker_threads_) {
-        if (thread.joinable()) {
-            thread.join();
-        }
+    if (result != Mempool::AddResult::Added) {
+        return false;
     }
     
-    worker_threads_.clear();
-    contract_worker_threads_.clear();
+    in_flight_.fetch_add(1, std::memory_order_acq_rel);
+    pool_.post(utils::TaskPriority::Execution, [this]() {
+        drainTransactionQueue();
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+    });
+    return true;
+}
+
+void ParallelProcessor::drainTransactionQueue() {
+    // One task per admitted transaction; whichever task runs first takes
+    // the best-paying entry that is next in its sender's nonce order
+    auto txs = mempool_.take(1);
+    if (txs.empty()) return;
+    processTransaction(txs.front());
 }
 
-bool ParallelProcessor::submitTransaction(const Transaction& tx) {
+bool ParallelProcessor::submitBatch(const std::vector<TransactionPtr>& batch) {
     if (should_stop_) return false;
     
-    std::unique_lock<std::mutex> lock(transaction_queue_mutex_);
-    if (transaction_queue_.size() >= config_.max_queue_size) {
-        return false;
+    // Colour the conflict graph into waves; waves run back to back, the
+    // transactions inside a wave run side by side on the worker threads
+    std::vector<AccessSet> access_sets;
+    access_sets.reserve(batch.size());
+    for (const auto& tx : batch) {
+        access_sets.push_back(ConflictScheduler::buildAccessSet(*tx));
     }
     
-    transaction_queue_.push(tx);
-    lock.unlock();
-    transaction_queue_cv_.notify_one();
-    return true;
+    std::vector<ConflictScheduler::Wave> waves;
+    ScheduleMetrics metrics;
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex_);
+        waves = scheduler_.schedule(access_sets);
+        metrics = scheduler_.lastMetrics();
+    }
+    
+    size_t total_failed = 0;
+    for (size_t w = 0; w < waves.size(); ++w) {
+        auto wave_start = std::chrono::steady_clock::now();
+        size_t failed = runWave(batch, waves[w]);
+        metrics.waves[w].failed = failed;
+        metrics.waves[w].duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - wave_start);
+        total_failed += failed;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex_);
+        last_schedule_metrics_ = std::move(metrics);
+    }
+    
+    return total_failed == 0;
 }
 
-bool ParallelProcessor::submitBatch(const std::vector<Transaction>& batch) {
-    if (should_stop_) return false;
+size_t ParallelProcessor::runWave(
+    const std::vector<TransactionPtr>& transactions,
+    const ConflictScheduler::Wave& wave
+) {
+    std::atomic<size_t> failed{0};
+    pool_.parallel_for(0, wave.size(), [&](size_t i) {
+        if (!processTransaction(transactions[wave[i]])) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }, utils::TaskPriority::Execution);
+    return failed.load();
+}
+
+OptimisticExecutor::Result ParallelProcessor::process_batch_optimistic(
+    StateManager& state,
+    const std::vector<Transaction>& batch
+) {
+    OptimisticExecutor::Config exec_config;
+    exec_config.num_threads = std::max<size_t>(1, config_.num_worker_threads);
+    OptimisticExecutor executor(exec_config);
     
-    // Split batch into independent sub-batches
-    auto independent_batches = createIndependentBatches(batch);
+    auto start = std::chrono::steady_clock::now();
+    auto result = executor.apply_batch(state, batch);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     
-    // Process each sub-batch
-    std::vector<std::future<bool>> results;
-    for (const auto& sub_batch : independent_batches) {
-        results.push_back(std::async(std::launch::async, [this, sub_batch]() {
-            return processBatch(sub_batch);
-        }));
+    size_t succeeded = static_cast<size_t>(std::count(result.success.begin(), result.success.end(), true));
+    metrics_.total_transactions += batch.size();
+    if (elapsed > 0.0) {
+        metrics_.tx_throughput = static_cast<double>(batch.size()) / elapsed;
     }
-    
-    // Wait for all sub-batches to complete
-    bool all_success = true;
-    for (auto& result : results) {
-        all_success &= result.get();
+    if (!batch.empty()) {
+        metrics_.success_rate = static_cast<double>(succeeded) / static_cast<double>(batch.size());
     }
     
-    return all_success;
+    return result;
+}
+
+ScheduleMetrics ParallelProcessor::getLastScheduleMetrics() const {
+    std::lock_guard<std::mutex> lock(schedule_mutex_);
+    return last_schedule_metrics_;
 }
 
 ParallelProcessor::ContractResult ParallelProcessor::executeContract(const ContractCall& call) {
     if (should_stop_) {
-        return std::async(std::launch::deferred, []() {
-            return quids::evm::EVMExecutor::ExecutionResult{
-                false, {}, 0, "Processor stopped"
-            };
-        });
+        return stoppedResult();
     }
-    
-    // Add to contract queue
-    std::unique_lock<std::mutex> lock(impl_->contract_queue_mutex_);
-    impl_->contract_queue_.push(call);
-    lock.unlock();
-    impl_->contract_queue_cv_.notify_one();
-    
-    // Return future for result
-    return std::async(std::launch::async, [this, call]() {
-        return this->executeContractInternal(call);
-    });
+
+    ContractState& state = contractState(call.contract_address);
+    PendingCall pending{call, {}};
+    ContractResult future = pending.result.get_future();
+    bool schedule;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        schedule = enqueueLocked(state, std::move(pending));
+    }
+    if (schedule) {
+        scheduleDrain(state);
+    }
+    return future;
 }
 
-void ParallelProcessor::workerThread() {
-    while (!should_stop_) {
-        Transaction tx;
+std::vector<ParallelProcessor::ContractResult> ParallelProcessor::executeContracts(std::vector<ContractCall> calls) {
+    std::vector<ContractResult> futures(calls.size());
+    if (should_stop_) {
+        for (auto& future : futures) {
+            future = stoppedResult();
+        }
+        return futures;
+    }
+
+    // Group by contract so each queue is locked and scheduled once
+    std::unordered_map<Address, std::vector<size_t>> by_contract;
+    for (size_t i = 0; i < calls.size(); ++i) {
+        by_contract[calls[i].contract_address].push_back(i);
+    }
+
+    for (const auto& [address, indices] : by_contract) {
+        ContractState& state = contractState(address);
+        bool schedule = false;
         {
-            std::unique_lock<std::mutex> lock(transaction_queue_mutex_);
-            transaction_queue_cv_.wait(lock, [this]() {
-                return !transaction_queue_.empty() || should_stop_;
-            });
-            
-            if (should_stop_) break;
-            
-            tx = transaction_queue_.front();
-            transaction_queue_.pop();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            for (size_t i : indices) {
+                PendingCall pending{std::move(calls[i]), {}};
+                futures[i] = pending.result.get_future();
+                schedule |= enqueueLocked(state, std::move(pending));
+            }
+        }
+        if (schedule) {
+            scheduleDrain(state);
         }
-        
-        processTransaction(tx);
     }
+    return futures;
 }
 
-void ParallelProcessor::contractWorkerThread() {
-    while (!should_stop_) {
-        ContractCall call;
-        {
-            std::unique_lock<std::mutex> lock(impl_->contract_queue_mutex_);
-            impl_->contract_queue_cv_.wait(lock, [this]() {
-                return !impl_->contract_queue_.empty() || should_stop_;
-            });
-            
-            if (should_stop_) break;
-            
-            call = impl_->contract_queue_.front();
-            impl_->contract_queue_.pop();
+ParallelProcessor::ContractState& ParallelProcessor::contractState(const Address& address) {
+    // Map nodes never move, so the reference outlives the lock
+    std::lock_guard<std::mutex> lock(impl_->contract_states_mutex_);
+    return impl_->contract_states_[address];
+}
+
+bool ParallelProcessor::enqueueLocked(ContractState& state, PendingCall pending) {
+    state.pending_calls.push_back(std::move(pending));
+    if (state.is_executing) {
+        return false;
+    }
+    state.is_executing = true;
+    return true;
+}
+
+void ParallelProcessor::scheduleDrain(ContractState& state) {
+    in_flight_.fetch_add(1, std::memory_order_acq_rel);
+    pool_.post(utils::TaskPriority::Execution, [this, &state]() {
+        drainContract(state);
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+    });
+}
+
+void ParallelProcessor::drainContract(ContractState& state) {
+    std::vector<PendingCall> batch;
+    batch.reserve(DRAIN_BATCH);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        while (!state.pending_calls.empty() && batch.size() < DRAIN_BATCH) {
+            batch.push_back(std::move(state.pending_calls.front()));
+            state.pending_calls.pop_front();
         }
-        
-        executeContractInternal(call);
+    }
+
+    for (auto& pending : batch) {
+        pending.result.set_value(executeContractInternal(pending.call));
+    }
+
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        more = !state.pending_calls.empty();
+        if (!more) {
+            state.is_executing = false;
+        }
+    }
+    // Re-post rather than loop so a hot contract cannot pin this worker
+    if (more) {
+        scheduleDrain(state);
     }
 }
 
-bool ParallelProcessor::processTransaction(const Transaction& tx) {
+bool ParallelProcessor::processTransaction(const TransactionPtr& ptr) {
+    const Transaction& tx = *ptr;
+    utils::Span span("execute", utils::transaction_trace_id(tx.getSender(), tx.getNonce()));
     auto start = std::chrono::high_resolution_clock::now();
     bool success = false;
     
     try {
         // Get account state
         std::unique_lock<std::mutex> account_lock(impl_->account_states_mutex_);
-        auto& account_state = impl_->account_states_[tx.getSender()];
+        auto& account_state = impl_->account_states_[Address::from_string(tx.getSender())];
         account_lock.unlock();
         
         // Process transaction
@@ -239,89 +365,46 @@ bool ParallelProcessor::processTransaction(const Transaction& tx) {
                 success = true;
             } else if (tx.getNonce() > account_state.nonce) {
                 // Queue transaction for later processing
-                account_state.pending_transactions.push(tx);
+                account_state.pending_transactions.push(ptr);
             }
         }
         
         auto end = std::chrono::high_resolution_clock::now();
-        impl_->metrics.update_transaction(
-            success,
-            std::chrono::duration_cast<std::chrono::microseconds>(end - start)
-        );
+        impl_->metrics.update_transaction(success, end - start);
         
     } catch (const std::exception&) {
-        // Handle error
-        std::lock_guard<std::mutex> lock(impl_->metrics.mutex);
-        impl_->metrics.failed_transactions++;
+        impl_->metrics.failed_transactions->add();
         return false;
     }
     
     return success;
 }
 
-bool ParallelProcessor::processBatch(const std::vector<Transaction>& batch) {
-    bool all_success = true;
-    std::vector<std::future<bool>> results;
+bool ParallelProcessor::processBatch(const std::vector<TransactionPtr>& batch) {
+    std::atomic<bool> all_success{true};
     
     // Process transactions in parallel
-    for (const auto& tx : batch) {
-        results.push_back(std::async(
-            std::launch::async,
-            &ParallelProcessor::processTransaction,
-            this,
-            tx
-        ));
-    }
-    
-    // Wait for all transactions to complete
-    for (auto& result : results) {
-        all_success &= result.get();
-    }
+    pool_.parallel_for(0, batch.size(), [&](size_t i) {
+        if (!processTransaction(batch[i])) {
+            all_success.store(false, std::memory_order_relaxed);
+        }
+    }, utils::TaskPriority::Execution);
     
-    return all_success;
+    return all_success.load();
 }
 
 EVMExecutor::ExecutionResult ParallelProcessor::executeContractInternal(const ContractCall& call) {
     auto start = std::chrono::high_resolution_clock::now();
     EVMExecutor::ExecutionResult result;
-    bool success = false;
     
     try {
-        // Get contract state
-        std::unique_lock<std::mutex> contract_lock(impl_->contract_states_mutex_);
-        auto& contract_state = impl_->contract_states_[call.contract_address];
-        contract_lock.unlock();
-        
-        // Execute contract
-        {
-            std::lock_guard<std::mutex> lock(contract_state.mutex);
-            if (!contract_state.is_executing) {
-                contract_state.is_executing = true;
-                auto* executor = getAvailableExecutor();
-                result = executor->execute_contract(
-                    call.contract_address,
-                    call.input,
-                    {},  // input data
-                    call.gas_limit
-                );
-                returnExecutor(executor);
-                contract_state.is_executing = false;
-                success = result.success;
-            } else {
-                // Queue call for later execution
-                contract_state.pending_calls.push(call);
-            }
-        }
+        result = runOnLocalExecutor(call);
         
         auto end = std::chrono::high_resolution_clock::now();
-        impl_->metrics.update_contract(
-            success,
-            std::chrono::duration_cast<std::chrono::microseconds>(end - start)
-        );
+        impl_->metrics.update_contract(result.success, end - start);
         
     } catch (const std::exception& e) {
-        std::lock_guard<std::mutex> lock(impl_->metrics.mutex);
-        impl_->metrics.failed_contracts++;
+        impl_->metrics.failed_contracts->add();
         result.success = false;
         result.error_message = e.what();
     }
@@ -329,76 +412,66 @@ EVMExecutor::ExecutionResult ParallelProcessor::executeContractInternal(const Co
     return result;
 }
 
-bool ParallelProcessor::hasDependency(
-    const Transaction& tx1,
-    const Transaction& tx2
-) const {
-    // Check for dependencies between transactions using getters
-    return tx1.getSender() == tx2.getSender() ||
-           tx1.getSender() == tx2.getRecipient() ||
-           tx1.getRecipient() == tx2.getSender();
-}
-
-std::vector<std::vector<Transaction>> ParallelProcessor::createIndependentBatches(
-    const std::vector<Transaction>& transactions
+std::vector<std::vector<TransactionPtr>> ParallelProcessor::createIndependentBatches(
+    const std::vector<TransactionPtr>& transactions
 ) {
-    std::vector<std::vector<Transaction>> batches;
-    std::vector<bool> assigned(transactions.size(), false);
+    std::vector<AccessSet> access_sets;
+    access_sets.reserve(transactions.size());
+    for (const auto& tx : transactions) {
+        access_sets.push_back(ConflictScheduler::buildAccessSet(*tx));
+    }
     
-    for (size_t i = 0; i < transactions.size(); ++i) {
-        if (assigned[i]) continue;
-        
-        std::vector<Transaction> batch;
-        batch.push_back(transactions[i]);
-        assigned[i] = true;
-        
-        for (size_t j = i + 1; j < transactions.size(); ++j) {
-            if (assigned[j]) continue;
-            
-            bool has_dependency = false;
-            for (const auto& tx : batch) {
-                if (hasDependency(tx, transactions[j])) {
-                    has_dependency = true;
-                    break;
-                }
-            }
-            
-            if (!has_dependency) {
-                batch.push_back(transactions[j]);
-                assigned[j] = true;
-            }
+    std::vector<ConflictScheduler::Wave> waves;
+    {
+        std::lock_guard<std::mutex> lock(schedule_mutex_);
+        waves = scheduler_.schedule(access_sets);
+    }
+    
+    std::vector<std::vector<TransactionPtr>> batches;
+    batches.reserve(waves.size());
+    for (const auto& wave : waves) {
+        std::vector<TransactionPtr> batch;
+        batch.reserve(wave.size());
+        for (size_t idx : wave) {
+            batch.push_back(transactions[idx]);
         }
-        
         batches.push_back(std::move(batch));
     }
     
     return batches;
 }
 
-quids::evm::EVMExecutor* ParallelProcessor::getAvailableExecutor() {
-    std::lock_guard<std::mutex> lock(evm_executors_mutex_);
-    // Simple round-robin allocation
-    static size_t current = 0;
-    auto* executor = evm_executors_[current].get();
-    current = (current + 1) % evm_executors_.size();
-    return executor;
-}
+EVMExecutor::ExecutionResult ParallelProcessor::runOnLocalExecutor(const ContractCall& call) {
+    auto run = [&](EVMExecutor& executor) {
+        // Every call starts from a clean executor whichever worker ran it
+        executor.reset();
+        return executor.execute_contract(
+            call.contract_address,
+            call.input,
+            {},  // input data
+            call.gas_limit
+        );
+    };
 
-void ParallelProcessor::returnExecutor(quids::evm::EVMExecutor* executor) {
-    (void)executor;
-    // No-op for now, could implement more sophisticated pooling
+    const size_t index = pool_.worker_index();
+    if (index < pool_.size()) {
+        return run(*evm_executors_[index]);
+    }
+    std::lock_guard<std::mutex> lock(external_executor_mutex_);
+    return run(*evm_executors_.back());
 }
 
 void ParallelProcessor::process(const ::evm::Address& contract_address) {
-    // Convert address to string for lookup
-    ContractState& contract_state = impl_->contract_states_[contract_address];
-    
-    // Process any pending calls
-    while (!contract_state.pending_calls.empty()) {
-        auto call = contract_state.pending_calls.front();
-        contract_state.pending_calls.pop();
-        executeContractInternal(call);
+    // Run queued calls on this thread unless a drain is already under way
+    ContractState& state = contractState(contract_address);
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.is_executing || state.pending_calls.empty()) {
+            return;
+        }
+        state.is_executing = true;
     }
+    drainContract(state);
 }
 
 } // namespace rollup
@@ -0,0 +1,242 @@
+#include "rollup/PreExecutor.hpp"
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+
+namespace quids {
+namespace rollup {
+
+PreExecutor::PreExecutor(std::shared_ptr<StateManager> state, std::shared_ptr<Mempool> mempool,
+                         const Config& config)
+    : state_(std::move(state)),
+      mempool_(std::move(mempool)),
+      config_(config),
+      pool_(utils::WorkStealingPool::global()) {}
+
+PreExecutor::PreExecutor(std::shared_ptr<StateManager> state, std::shared_ptr<Mempool> mempool)
+    : PreExecutor(std::move(state), std::move(mempool), Config{}) {}
+
+PreExecutor::~PreExecutor() {
+    stop();
+}
+
+size_t PreExecutor::run_once() {
+    const auto snapshot = state_->snapshot();
+    const uint64_t version = snapshot.version();
+    auto pending = mempool_->select(config_.max_per_pass);
+
+    // Each sender's transactions in nonce order; select() never puts a
+    // nonce ahead of a lower one from the same sender
+    std::vector<std::vector<size_t>> senders;
+    {
+        std::unordered_map<std::string, size_t> index;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            auto [it, inserted] = index.try_emplace(pending[i]->getSender(), senders.size());
+            if (inserted) {
+                senders.emplace_back();
+            }
+            senders[it->second].push_back(i);
+        }
+    }
+    // A sender whose run was already seen at this version is skipped whole,
+    // since its later transactions depend on the earlier ones
+    senders.erase(std::remove_if(senders.begin(), senders.end(), [&](const std::vector<size_t>& run) {
+        return std::all_of(run.begin(), run.end(), [&](size_t i) {
+            auto known = lookup(pending[i]->hash());
+            return known && known->state_version == version;
+        });
+    }), senders.end());
+
+    std::vector<std::vector<std::pair<blockchain::Hash, Prediction>>> results(senders.size());
+    pool_.parallel_for(0, senders.size(), [&](size_t s) {
+        const auto& run = senders[s];
+        auto sender = snapshot.get_account(pending[run.front()]->getSender());
+        for (size_t i : run) {
+            const auto& tx = *pending[i];
+            Prediction p;
+            p.state_version = version;
+            if (!tx.verified()) {
+                p.outcome = Outcome::BadSignature;
+            } else if (!sender || !snapshot.get_account(tx.getRecipient())) {
+                p.outcome = Outcome::UnknownAccount;
+            } else if (tx.getNonce() <= sender->nonce) {
+                p.outcome = Outcome::StaleNonce;
+            } else if (tx.getNonce() != sender->nonce + 1) {
+                p.outcome = Outcome::NonceGap;
+            } else if (sender->balance < tx.getAmount() + tx.calculate_gas_cost()) {
+                p.outcome = Outcome::InsufficientFunds;
+            } else {
+                sender->balance -= tx.getAmount() + tx.calculate_gas_cost();
+                sender->nonce++;
+                if (tx.getRecipient() == tx.getSender()) {
+                    sender->balance += tx.getAmount();
+                }
+            }
+            if (p.outcome == Outcome::Succeeds) {
+                p.access = ConflictScheduler::buildAccessSet(tx);
+            } else {
+                p.access.reads.push_back(ConflictScheduler::accountKey(tx.getSender()));
+            }
+            results[s].emplace_back(tx.hash(), std::move(p));
+        }
+    }, utils::TaskPriority::ML);
+
+    std::vector<std::pair<blockchain::Hash, Prediction>> flat;
+    for (auto& r : results) {
+        std::move(r.begin(), r.end(), std::back_inserter(flat));
+    }
+    const size_t executed = flat.size();
+    record(std::move(flat));
+    return executed;
+}
+
+void PreExecutor::record(std::vector<std::pair<blockchain::Hash, Prediction>> results) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.passes;
+    stats_.executed += results.size();
+    for (auto& [hash, p] : results) {
+        if (p.outcome != Outcome::Succeeds) {
+            ++stats_.predicted_failures;
+        }
+        auto [it, inserted] = predictions_.insert_or_assign(hash, std::move(p));
+        if (inserted) {
+            order_.push_back(hash);
+        }
+    }
+    while (predictions_.size() > config_.max_predictions && !order_.empty()) {
+        predictions_.erase(order_.front());
+        order_.pop_front();
+    }
+    // forget() leaves its hashes in order_; drop them once they dominate
+    if (order_.size() > 2 * std::max<size_t>(config_.max_predictions, predictions_.size())) {
+        std::unordered_set<blockchain::Hash, HashKey> seen;
+        std::deque<blockchain::Hash> live;
+        for (const auto& hash : order_) {
+            if (predictions_.count(hash) != 0 && seen.insert(hash).second) {
+                live.push_back(hash);
+            }
+        }
+        order_ = std::move(live);
+    }
+}
+
+std::optional<PreExecutor::Prediction> PreExecutor::lookup(const blockchain::Hash& hash) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = predictions_.find(hash);
+    if (it == predictions_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<PreExecutor::Prediction> PreExecutor::prediction(const blockchain::Transaction& tx) const {
+    return lookup(tx.hash());
+}
+
+std::vector<AccessSet> PreExecutor::access_sets(const std::vector<blockchain::TransactionPtr>& batch) const {
+    std::vector<AccessSet> sets;
+    sets.reserve(batch.size());
+    uint64_t hits = 0;
+    for (const auto& tx : batch) {
+        if (auto p = prediction(*tx)) {
+            sets.push_back(std::move(p->access));
+            ++hits;
+        } else {
+            sets.push_back(ConflictScheduler::buildAccessSet(*tx));
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.hits += hits;
+    stats_.misses += batch.size() - hits;
+    return sets;
+}
+
+std::vector<blockchain::TransactionPtr> PreExecutor::screen(std::vector<blockchain::TransactionPtr> batch) {
+    uint64_t hits = 0;
+    std::vector<blockchain::Hash> screened;
+    auto keep = std::remove_if(batch.begin(), batch.end(), [&](const blockchain::TransactionPtr& tx) {
+        auto p = prediction(*tx);
+        if (!p) {
+            return false;
+        }
+        ++hits;
+        if (!is_permanent(p->outcome)) {
+            return false;
+        }
+        screened.push_back(tx->hash());
+        return true;
+    });
+    batch.erase(keep, batch.end());
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Nothing will forget() these
+    for (const auto& hash : screened) {
+        predictions_.erase(hash);
+    }
+    stats_.hits += hits;
+    stats_.misses += batch.size() + screened.size() - hits;
+    stats_.screened += screened.size();
+    return batch;
+}
+
+void PreExecutor::forget(const std::vector<blockchain::TransactionPtr>& txs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& tx : txs) {
+        predictions_.erase(tx->hash());
+    }
+}
+
+void PreExecutor::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread([this] { loop(); });
+}
+
+void PreExecutor::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    notify();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void PreExecutor::notify() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        woken_ = true;
+    }
+    wake_.notify_one();
+}
+
+void PreExecutor::loop() {
+    while (running_.load(std::memory_order_acquire)) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait_for(lock, config_.interval, [this] {
+                return woken_ || !running_.load(std::memory_order_acquire);
+            });
+            woken_ = false;
+        }
+        if (!running_.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (!mempool_->empty()) {
+            run_once();
+        }
+    }
+}
+
+size_t PreExecutor::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return predictions_.size();
+}
+
+PreExecutor::Stats PreExecutor::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -1,86 +1,38 @@
 #include "rollup/ProofAggregator.hpp"
-#include <openssl/evp.h>
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include "zkp/ProofCodec.hpp"
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
 
 namespace {
-std::vector<uint8_t> compute_proof_merkle_root(
-    const std::vector<QZKPGenerator::Proof>& proofs
-) {
-    std::vector<std::array<uint8_t, 32>> hashes;
-    hashes.reserve(proofs.size());
-
-    // First level: hash individual proofs
-    for (const auto& proof : proofs) {
-        std::array<uint8_t, 32> hash;
-        EVP_MD_CTX* ctx = EVP_MD_CTX_new();
-        if (!ctx) {
-            throw std::runtime_error("Failed to create EVP context");
-        }
-
-        if (EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr) != 1) {
-            EVP_MD_CTX_free(ctx);
-            throw std::runtime_error("Failed to initialize SHA256");
-        }
-
-        // Hash the proof data
-        if (EVP_DigestUpdate(ctx, proof.proof_data.data(), proof.proof_data.size()) != 1) {
-            EVP_MD_CTX_free(ctx);
-            throw std::runtime_error("Failed to update digest");
-        }
 
-        unsigned int hash_len;
-        if (EVP_DigestFinal_ex(ctx, hash.data(), &hash_len) != 1) {
-            EVP_MD_CTX_free(ctx);
-            throw std::runtime_error("Failed to finalize digest");
-        }
+// Keeps an aggregate leaf from ever hashing like a proof leaf
+constexpr char AGGREGATE_TAG[] = "quids/proof-aggregate/v1";
 
-        EVP_MD_CTX_free(ctx);
-        hashes.push_back(hash);
+void put_le(uint8_t* out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
     }
+}
 
-    // Build Merkle tree
-    while (hashes.size() > 1) {
-        size_t pairs = hashes.size() / 2;
-        for (size_t i = 0; i < pairs; i++) {
-            std::array<uint8_t, 32> combined_hash;
-            EVP_MD_CTX* ctx = EVP_MD_CTX_new();
-            if (!ctx) {
-                throw std::runtime_error("Failed to create EVP context");
-            }
-
-            if (EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr) != 1) {
-                EVP_MD_CTX_free(ctx);
-                throw std::runtime_error("Failed to initialize SHA256");
-            }
-
-            if (EVP_DigestUpdate(ctx, hashes[2*i].data(), 32) != 1 ||
-                EVP_DigestUpdate(ctx, hashes[2*i + 1].data(), 32) != 1) {
-                EVP_MD_CTX_free(ctx);
-                throw std::runtime_error("Failed to update digest");
-            }
-
-            unsigned int hash_len;
-            if (EVP_DigestFinal_ex(ctx, combined_hash.data(), &hash_len) != 1) {
-                EVP_MD_CTX_free(ctx);
-                throw std::runtime_error("Failed to finalize digest");
-            }
-
-            EVP_MD_CTX_free(ctx);
-            hashes[i] = combined_hash;
-        }
-
-        // If odd number of hashes, keep the last one
-        if (hashes.size() % 2 == 1) {
-            hashes[pairs] = hashes.back();
-            hashes.resize(pairs + 1);
-        } else {
-            hashes.resize(pairs);
-        }
+uint64_t get_le(const uint8_t* in, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
     }
+    return value;
+}
 
-    // Convert final hash to vector
-    return std::vector<uint8_t>(hashes[0].begin(), hashes[0].end());
+std::vector<uint8_t> compute_proof_merkle_root(
+    const std::vector<QZKPGenerator::Proof>& proofs
+) {
+    quids::crypto::MerkleBuilder builder;
+    builder.appendParallel(proofs.size(), [&](size_t i) {
+        return ProofAggregator::proof_leaf(proofs[i]);
+    });
+    const auto root = builder.root();
+    return std::vector<uint8_t>(root.begin(), root.end());
 }
 } // namespace
 
@@ -135,4 +87,121 @@ bool ProofAggregator::verify_aggregated_proof(
 
     // Verify Merkle root matches
     return provided_root == expected_root;
-} 
\ No newline at end of file
+}
+
+std::vector<uint8_t> ProofAggregator::Aggregate::serialize() const {
+    std::vector<uint8_t> out(SERIALIZED_SIZE);
+    put_le(out.data(), level, 4);
+    put_le(out.data() + 4, proof_count, 8);
+    put_le(out.data() + 12, child_count, 8);
+    std::memcpy(out.data() + 20, root.data(), root.size());
+    return out;
+}
+
+ProofAggregator::Aggregate ProofAggregator::Aggregate::deserialize(std::span<const uint8_t> bytes) {
+    if (bytes.size() != SERIALIZED_SIZE) {
+        throw std::invalid_argument("Malformed proof aggregate");
+    }
+    Aggregate aggregate;
+    aggregate.level = static_cast<uint32_t>(get_le(bytes.data(), 4));
+    aggregate.proof_count = get_le(bytes.data() + 4, 8);
+    aggregate.child_count = get_le(bytes.data() + 12, 8);
+    std::memcpy(aggregate.root.data(), bytes.data() + 20, aggregate.root.size());
+    if (aggregate.child_count == 0 || aggregate.proof_count < aggregate.child_count) {
+        throw std::invalid_argument("Malformed proof aggregate");
+    }
+    return aggregate;
+}
+
+ProofAggregator::Hash ProofAggregator::proof_leaf(const QZKPGenerator::Proof& proof) {
+    return quids::zkp::ProofCodec::hash(proof);
+}
+
+ProofAggregator::Hash ProofAggregator::proof_leaf(std::span<const uint8_t> encoded) {
+    return quids::zkp::ProofCodec::hash(encoded);
+}
+
+ProofAggregator::Hash ProofAggregator::aggregate_leaf(const Aggregate& aggregate) {
+    std::vector<uint8_t> data(AGGREGATE_TAG, AGGREGATE_TAG + sizeof(AGGREGATE_TAG) - 1);
+    const auto encoded = aggregate.serialize();
+    data.insert(data.end(), encoded.begin(), encoded.end());
+    return quids::crypto::MerkleBuilder::hashLeaf(data);
+}
+
+void ProofAggregator::add_proof(const QZKPGenerator::Proof& proof) {
+    if (children_ == Children::Aggregates) {
+        throw std::logic_error("Aggregator already folds aggregates");
+    }
+    children_ = Children::Proofs;
+    builder_.appendHash(proof_leaf(proof));
+    ++proof_count_;
+}
+
+void ProofAggregator::add_proofs(const std::vector<QZKPGenerator::Proof>& proofs) {
+    if (children_ == Children::Aggregates) {
+        throw std::logic_error("Aggregator already folds aggregates");
+    }
+    if (proofs.empty()) {
+        return;
+    }
+    children_ = Children::Proofs;
+    builder_.appendParallel(proofs.size(), [&](size_t i) { return proof_leaf(proofs[i]); });
+    proof_count_ += proofs.size();
+}
+
+void ProofAggregator::add_aggregate(const Aggregate& child) {
+    if (children_ == Children::Proofs ||
+        (children_ == Children::Aggregates && child.level != child_level_)) {
+        throw std::logic_error("Aggregate does not match this aggregator's level");
+    }
+    children_ = Children::Aggregates;
+    child_level_ = child.level;
+    builder_.appendHash(aggregate_leaf(child));
+    proof_count_ += child.proof_count;
+}
+
+ProofAggregator::Aggregate ProofAggregator::current() {
+    if (builder_.size() == 0) {
+        throw std::logic_error("Nothing to aggregate");
+    }
+    Aggregate aggregate;
+    aggregate.level = children_ == Children::Aggregates ? child_level_ + 1 : 0;
+    aggregate.proof_count = proof_count_;
+    aggregate.child_count = builder_.size();
+    aggregate.root = builder_.root();
+    return aggregate;
+}
+
+ProofAggregator::PathStep ProofAggregator::path_step(size_t index) {
+    PathStep step;
+    step.proof = builder_.proof(index);
+    step.parent = current();
+    return step;
+}
+
+ProofAggregator::Aggregate ProofAggregator::seal() {
+    Aggregate aggregate = current();
+    builder_.clear();
+    children_ = Children::None;
+    child_level_ = 0;
+    proof_count_ = 0;
+    return aggregate;
+}
+
+bool ProofAggregator::verify_path(const Aggregate& trusted, const Hash& leaf, const InclusionPath& path) {
+    if (path.empty() || !(path.back().parent == trusted)) {
+        return false;
+    }
+    Hash node = leaf;
+    for (size_t i = 0; i < path.size(); ++i) {
+        const auto& step = path[i];
+        // Levels climb one at a time, and each proof is for the whole parent
+        if ((i > 0 && step.parent.level != path[i - 1].parent.level + 1) ||
+            step.proof.leaf_count != step.parent.child_count ||
+            !quids::crypto::MerkleBuilder::verify(step.parent.root, node, step.proof)) {
+            return false;
+        }
+        node = aggregate_leaf(step.parent);
+    }
+    return true;
+}
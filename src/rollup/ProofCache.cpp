@@ -0,0 +1,103 @@
+#include "rollup/ProofCache.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <algorithm>
+
+namespace quids {
+namespace rollup {
+
+ProofCache::ProofCache(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+std::string ProofCache::key_of(const std::vector<uint8_t>& root, const std::string& address) {
+    // Roots have a fixed width, so the concatenation is unambiguous
+    std::string key(root.begin(), root.end());
+    key += address;
+    return key;
+}
+
+std::shared_ptr<const StateTrie::Proof> ProofCache::lookup(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    ++stats_.hits;
+    return it->second->second;
+}
+
+void ProofCache::insert(const std::string& key, std::shared_ptr<const StateTrie::Proof> proof) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A racing request may have proven the same account
+    if (index_.count(key) != 0) {
+        return;
+    }
+    entries_.emplace_front(key, std::move(proof));
+    index_.emplace(key, entries_.begin());
+    if (entries_.size() > capacity_) {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+std::shared_ptr<const StateTrie::Proof> ProofCache::prove(const StateManager::Snapshot& snapshot,
+                                                          const std::string& address) {
+    const std::string key = key_of(snapshot.get_state_root(), address);
+    if (auto cached = lookup(key)) {
+        return cached;
+    }
+    auto proof = snapshot.prove_account(address);
+    if (!proof) {
+        return nullptr;
+    }
+    auto shared = std::make_shared<const StateTrie::Proof>(std::move(*proof));
+    insert(key, shared);
+    return shared;
+}
+
+std::vector<std::shared_ptr<const StateTrie::Proof>> ProofCache::prove_all(
+    const StateManager::Snapshot& snapshot, const std::vector<std::string>& addresses) {
+    const auto root = snapshot.get_state_root();
+    std::vector<std::shared_ptr<const StateTrie::Proof>> out(addresses.size());
+    std::vector<size_t> misses;
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        out[i] = lookup(key_of(root, addresses[i]));
+        if (!out[i]) {
+            misses.push_back(i);
+        }
+    }
+
+    utils::WorkStealingPool::global().parallel_for(0, misses.size(), [&](size_t m) {
+        const size_t i = misses[m];
+        if (auto proof = snapshot.prove_account(addresses[i])) {
+            out[i] = std::make_shared<const StateTrie::Proof>(std::move(*proof));
+        }
+    }, utils::TaskPriority::Proof, 64);
+
+    for (size_t i : misses) {
+        if (out[i]) {
+            insert(key_of(root, addresses[i]), out[i]);
+        }
+    }
+    return out;
+}
+
+void ProofCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+}
+
+size_t ProofCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+ProofCache::Stats ProofCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,201 @@
+#include "rollup/ProvingService.hpp"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+ProvingService::ProvingService(const Config& config, BackendFactory factory) : config_(config) {
+    if (!factory) {
+        throw std::invalid_argument("Proving service needs a backend factory");
+    }
+    size_t workers = config.workers;
+    if (workers == 0) {
+        workers = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+    }
+    workers_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this, backend = factory()]() { workerLoop(backend); });
+    }
+}
+
+ProvingService::ProvingService(const Config& config) : ProvingService(config, local()) {}
+
+ProvingService::ProvingService() : ProvingService(Config{}) {}
+
+ProvingService::~ProvingService() {
+    stop();
+}
+
+ProvingService::BackendFactory ProvingService::local() {
+    return [] {
+        // Generators keep running statistics, so each worker gets its own
+        auto generator = std::make_shared<zkp::QZKPGenerator>();
+        return [generator](const quantum::QuantumState& state) { return generator->generate_proof(state); };
+    };
+}
+
+std::optional<uint64_t> ProvingService::submit(quantum::QuantumState&& state, Priority priority, Completion done) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t depth = 0;
+        for (const auto& queue : queues_) {
+            depth += queue.size();
+        }
+        if (stopping_ || depth >= config_.max_queue) {
+            ++metrics_.rejected;
+            return std::nullopt;
+        }
+        id = next_id_++;
+        queues_[static_cast<size_t>(priority)].push_back({id, std::move(state), std::move(done), Clock::now()});
+        ++metrics_.submitted;
+    }
+    work_cv_.notify_one();
+    return id;
+}
+
+utils::Task<ProvingService::Proof> ProvingService::prove(quantum::QuantumState state, Priority priority) {
+    struct Outcome {
+        Proof proof;
+        std::exception_ptr error;
+    };
+    auto outcome = co_await utils::from_callback<Outcome>([&](auto resume) {
+        auto id = submit(std::move(state), priority, [resume](uint64_t, Proof&& proof, std::exception_ptr error) {
+            resume(Outcome{std::move(proof), error});
+        });
+        if (!id) {
+            resume(Outcome{{}, std::make_exception_ptr(std::runtime_error("Proving queue is full"))});
+        }
+    });
+    if (outcome.error) {
+        std::rethrow_exception(outcome.error);
+    }
+    co_return std::move(outcome.proof);
+}
+
+void ProvingService::workerLoop(Backend backend) {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock, [this] {
+                return stopping_ || std::any_of(queues_.begin(), queues_.end(),
+                                                [](const auto& queue) { return !queue.empty(); });
+            });
+            if (stopping_) {
+                return;
+            }
+            auto queue = std::find_if(queues_.begin(), queues_.end(),
+                                      [](const auto& q) { return !q.empty(); });
+            job = std::move(queue->front());
+            queue->pop_front();
+            running_.emplace_back(job.id, job.submitted);
+        }
+
+        Proof proof;
+        std::exception_ptr error;
+        try {
+            proof = backend(job.state);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        finish(job, Clock::now(), error != nullptr);
+        if (job.done) {
+            job.done(job.id, std::move(proof), error);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_.erase(std::find_if(running_.begin(), running_.end(),
+                                        [&](const auto& entry) { return entry.first == job.id; }));
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+void ProvingService::finish(const Job& job, Clock::time_point now, bool failed) {
+    const auto lag = std::chrono::duration_cast<std::chrono::microseconds>(now - job.submitted);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (failed) {
+        ++metrics_.failed;
+        return;
+    }
+    ++metrics_.completed;
+    const double sample = static_cast<double>(lag.count());
+    average_lag_us_ = metrics_.completed == 1 ? sample : average_lag_us_ + LAG_GAIN * (sample - average_lag_us_);
+    metrics_.max_lag = std::max(metrics_.max_lag, lag);
+}
+
+void ProvingService::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] {
+        return running_.empty() && std::all_of(queues_.begin(), queues_.end(),
+                                               [](const auto& queue) { return queue.empty(); });
+    });
+}
+
+void ProvingService::stop() {
+    std::array<std::deque<Job>, NUM_PRIORITIES> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+        abandoned.swap(queues_);
+    }
+    work_cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    const auto error = std::make_exception_ptr(std::runtime_error("Proving service stopped"));
+    for (auto& queue : abandoned) {
+        for (auto& job : queue) {
+            finish(job, Clock::now(), true);
+            if (job.done) {
+                job.done(job.id, Proof{}, error);
+            }
+        }
+    }
+    idle_cv_.notify_all();
+}
+
+double ProvingService::utilization() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t depth = 0;
+    for (const auto& queue : queues_) {
+        depth += queue.size();
+    }
+    return static_cast<double>(depth) / static_cast<double>(std::max<size_t>(1, config_.max_queue));
+}
+
+ProvingService::Metrics ProvingService::metrics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Metrics metrics = metrics_;
+    metrics.average_lag = std::chrono::microseconds(static_cast<int64_t>(average_lag_us_));
+    metrics.in_flight = running_.size();
+
+    auto oldest = Clock::time_point::max();
+    for (const auto& queue : queues_) {
+        metrics.queue_depth += queue.size();
+        if (!queue.empty()) {
+            oldest = std::min(oldest, queue.front().submitted);
+        }
+    }
+    for (const auto& [id, submitted] : running_) {
+        oldest = std::min(oldest, submitted);
+    }
+    if (oldest != Clock::time_point::max()) {
+        metrics.oldest_pending = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - oldest);
+    }
+    return metrics;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -11,11 +11,17 @@ namespace rollup {
 using quids::rollup::RollupPerformanceMetrics;
 using quids::rollup::RollupTransactionAPI;
 
+namespace {
+// Samples kept for online training
+constexpr size_t SAMPLE_CAPACITY = 4096;
+}
+
 RollupMLModel::RollupMLModel(
     const MLModelParameters& params,
     size_t input_size,
     size_t output_size
-) : params_(params), input_size_(input_size), output_size_(output_size) {
+) : params_(params), input_size_(input_size), output_size_(output_size),
+    store_(SAMPLE_CAPACITY, static_cast<Eigen::Index>(input_size), static_cast<Eigen::Index>(output_size)) {
     initializeWeights();
     initializeNLPModel();
 }
@@ -36,6 +42,12 @@ void RollupMLModel::initializeWeights() {
     // Output layer: hidden_size -> output_size
     weights_.push_back(Eigen::MatrixXd::Random(output_size_, hidden_size));
     biases_.push_back(Eigen::VectorXd::Zero(output_size_));
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < weights_.size(); ++i) {
+        bytes += static_cast<size_t>(weights_[i].size() + biases_[i].size()) * sizeof(double);
+    }
+    charge_ = memory::MemoryCharge(memory::Subsystem::MlModels, bytes);
 }
 
 Eigen::VectorXd RollupMLModel::forwardPass(const Eigen::VectorXd& input) {
@@ -424,5 +436,23 @@ void RollupMLModel::updateMetrics(const RollupPerformanceMetrics& metrics) {
     current_metrics_ = metrics;
 }
 
+void RollupMLModel::observe(const RollupPerformanceMetrics& metrics, const QuantumParameters& params) {
+    updateMetrics(metrics);
+    store_.push(extractFeatures(metrics).cast<float>().transpose(),
+                extractTargets(params).cast<float>().transpose());
+}
+
+size_t RollupMLModel::trainIncremental() {
+    FeatureStore::Matrix features;
+    FeatureStore::Matrix targets;
+    store_cursor_ = store_.read_since(store_cursor_, features, targets);
+    for (Eigen::Index i = 0; i < features.rows(); ++i) {
+        backward(features.row(i).transpose().cast<double>(),
+                 targets.row(i).transpose().cast<double>(),
+                 params_.learning_rate);
+    }
+    return static_cast<size_t>(features.rows());
+}
+
 } // namespace rollup
 } // namespace quids 
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "rollup/RollupScheduler.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+
+RollupScheduler::RollupScheduler(const Config& config, std::shared_ptr<ProvingService> prover)
+    : prover_(std::move(prover)) {
+    if (!prover_) {
+        throw std::invalid_argument("Rollup scheduler needs a proving service");
+    }
+    size_t executors = config.executors;
+    if (executors == 0) {
+        executors = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+    }
+    stages_[EXECUTE].slots = executors;
+    stages_[PROVE].slots = config.prover_slots == 0 ? executors : config.prover_slots;
+}
+
+RollupScheduler::~RollupScheduler() {
+    stop();
+}
+
+void RollupScheduler::add_rollup(RollupId rollup, const RollupConfig& config) {
+    if (config.weight == 0 || config.max_queued == 0) {
+        throw std::invalid_argument("Rollup needs a positive weight and queue bound");
+    }
+
+    auto entry = std::make_unique<Rollup>();
+    entry->config = config;
+    entry->queued = std::make_shared<utils::Gauge>();
+    entry->submitted = std::make_shared<utils::Counter>();
+    entry->completed = std::make_shared<utils::Counter>();
+    entry->failed = std::make_shared<utils::Counter>();
+    entry->rejected = std::make_shared<utils::Counter>();
+    entry->slo_misses = std::make_shared<utils::Counter>();
+    entry->executed_cost = std::make_shared<utils::Counter>();
+    entry->latency = std::make_shared<utils::Histogram>();
+    const Rollup& added = *entry;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rollups_.count(rollup) != 0) {
+            throw std::invalid_argument("Rollup " + std::to_string(rollup) + " is already scheduled");
+        }
+        // A rollup added after others starts level with them
+        for (size_t stage = 0; stage < NUM_STAGES; ++stage) {
+            entry->last_finish[stage] = stages_[stage].virtual_time;
+        }
+        rollups_.emplace(rollup, std::move(entry));
+    }
+
+    auto& registry = utils::MetricsRegistry::global();
+    const utils::MetricsRegistry::Labels labels{{"rollup", std::to_string(rollup)}};
+    registry.attach("quids_rollup_scheduler_queued", "Batches waiting to execute or prove", labels, added.queued);
+    registry.attach("quids_rollup_scheduler_submitted_total", "Batches accepted", labels, added.submitted);
+    registry.attach("quids_rollup_scheduler_completed_total", "Batches proved", labels, added.completed);
+    registry.attach("quids_rollup_scheduler_failed_total", "Batches that failed or were abandoned", labels, added.failed);
+    registry.attach("quids_rollup_scheduler_rejected_total", "Batches refused at the queue bound", labels, added.rejected);
+    registry.attach("quids_rollup_scheduler_slo_misses_total", "Batches proved after their SLO", labels, added.slo_misses);
+    registry.attach("quids_rollup_scheduler_executed_cost_total", "Batch cost sent to the executor", labels, added.executed_cost);
+    registry.attach("quids_rollup_scheduler_latency_seconds", "Submission to proof", labels, added.latency);
+}
+
+std::optional<uint64_t> RollupScheduler::submit(RollupId rollup, Execute execute, Completion done, uint32_t cost) {
+    if (!execute) {
+        throw std::invalid_argument("Batch needs an execute step");
+    }
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = rollups_.find(rollup);
+        if (it == rollups_.end()) {
+            throw std::out_of_range("Unknown rollup " + std::to_string(rollup));
+        }
+        Rollup& entry = *it->second;
+        if (stopping_ || entry.outstanding >= entry.config.max_queued) {
+            entry.rejected->add();
+            return std::nullopt;
+        }
+
+        auto batch = std::make_shared<Batch>();
+        id = next_id_++;
+        batch->id = id;
+        batch->rollup = rollup;
+        batch->cost = cost;
+        batch->execute = std::move(execute);
+        batch->done = std::move(done);
+        batch->submitted = Clock::now();
+        batch->deadline = batch->submitted + entry.config.slo;
+        ++entry.outstanding;
+        ++outstanding_;
+        entry.submitted->add();
+        enqueue(EXECUTE, std::move(batch));
+    }
+    dispatch();
+    return id;
+}
+
+void RollupScheduler::enqueue(Stage stage, BatchPtr batch) {
+    Rollup& entry = *rollups_.at(batch->rollup);
+    StageState& state = stages_[stage];
+    batch->start = std::max(state.virtual_time, entry.last_finish[stage]);
+    entry.last_finish[stage] = batch->start + static_cast<double>(batch->cost) / entry.config.weight;
+    entry.queues[stage].push_back(std::move(batch));
+    entry.queued->add(1);
+}
+
+RollupScheduler::BatchPtr RollupScheduler::pick(Stage stage) {
+    Rollup* best = nullptr;
+    for (auto& [id, entry] : rollups_) {
+        const auto& queue = entry->queues[stage];
+        if (queue.empty()) {
+            continue;
+        }
+        if (!best) {
+            best = entry.get();
+            continue;
+        }
+        const Batch& head = *queue.front();
+        const Batch& leader = *best->queues[stage].front();
+        if (head.start < leader.start || (head.start == leader.start && head.deadline < leader.deadline)) {
+            best = entry.get();
+        }
+    }
+    if (!best) {
+        return nullptr;
+    }
+
+    BatchPtr batch = std::move(best->queues[stage].front());
+    best->queues[stage].pop_front();
+    best->queued->add(-1);
+    ++best->running;
+    StageState& state = stages_[stage];
+    ++state.running;
+    state.virtual_time = std::max(state.virtual_time, batch->start);
+    if (stage == EXECUTE) {
+        best->executed_cost->add(batch->cost);
+    }
+    return batch;
+}
+
+void RollupScheduler::dispatch() {
+    std::vector<BatchPtr> to_execute;
+    std::vector<BatchPtr> to_prove;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (stages_[EXECUTE].running < stages_[EXECUTE].slots) {
+            auto batch = pick(EXECUTE);
+            if (!batch) break;
+            to_execute.push_back(std::move(batch));
+        }
+        while (stages_[PROVE].running < stages_[PROVE].slots) {
+            auto batch = pick(PROVE);
+            if (!batch) break;
+            to_prove.push_back(std::move(batch));
+        }
+    }
+
+    auto& pool = utils::WorkStealingPool::global();
+    for (auto& batch : to_execute) {
+        pool.post(utils::TaskPriority::Execution, [this, batch] { run(batch); });
+    }
+    for (auto& batch : to_prove) {
+        auto job = prover_->submit(std::move(batch->state), ProvingService::Priority::Normal,
+            [this, batch](uint64_t, Proof&& proof, std::exception_ptr error) {
+                proved(batch, std::move(proof), error);
+            });
+        if (!job) {
+            proved(batch, Proof{}, std::make_exception_ptr(std::runtime_error("Proving service refused the batch")));
+        }
+    }
+}
+
+void RollupScheduler::run(const BatchPtr& batch) {
+    std::exception_ptr error;
+    try {
+        batch->state = batch->execute();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    batch->execute = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --stages_[EXECUTE].running;
+        --rollups_.at(batch->rollup)->running;
+        if (!error && stopping_) {
+            error = std::make_exception_ptr(std::runtime_error("Rollup scheduler stopped"));
+        }
+        if (!error) {
+            enqueue(PROVE, batch);
+        }
+    }
+    dispatch();
+    if (error) {
+        finish(batch, Proof{}, error);
+    }
+}
+
+void RollupScheduler::proved(const BatchPtr& batch, Proof&& proof, std::exception_ptr error) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --stages_[PROVE].running;
+        --rollups_.at(batch->rollup)->running;
+    }
+    dispatch();
+    finish(batch, std::move(proof), error);
+}
+
+void RollupScheduler::finish(const BatchPtr& batch, Proof&& proof, std::exception_ptr error) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Rollup& entry = *rollups_.at(batch->rollup);
+        if (error) {
+            entry.failed->add();
+        } else {
+            const auto now = Clock::now();
+            entry.latency->record(now - batch->submitted);
+            entry.completed->add();
+            if (now > batch->deadline) {
+                entry.slo_misses->add();
+            }
+        }
+    }
+
+    if (batch->done) {
+        batch->done(batch->id, std::move(proof), error);
+    }
+
+    // Last touch of this scheduler: stop() may return as soon as it is seen
+    std::lock_guard<std::mutex> lock(mutex_);
+    --rollups_.at(batch->rollup)->outstanding;
+    --outstanding_;
+    idle_cv_.notify_all();
+}
+
+void RollupScheduler::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return outstanding_ == 0; });
+}
+
+void RollupScheduler::stop() {
+    std::vector<BatchPtr> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+        for (auto& [id, entry] : rollups_) {
+            for (auto& queue : entry->queues) {
+                entry->queued->add(-static_cast<int64_t>(queue.size()));
+                abandoned.insert(abandoned.end(), queue.begin(), queue.end());
+                queue.clear();
+            }
+        }
+    }
+
+    const auto error = std::make_exception_ptr(std::runtime_error("Rollup scheduler stopped"));
+    for (auto& batch : abandoned) {
+        finish(batch, Proof{}, error);
+    }
+    drain();
+}
+
+RollupScheduler::RollupMetrics RollupScheduler::metrics(RollupId rollup) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = rollups_.find(rollup);
+    if (it == rollups_.end()) {
+        throw std::out_of_range("Unknown rollup " + std::to_string(rollup));
+    }
+    const Rollup& entry = *it->second;
+
+    RollupMetrics metrics;
+    metrics.queued = entry.queues[EXECUTE].size() + entry.queues[PROVE].size();
+    metrics.running = entry.running;
+    metrics.submitted = entry.submitted->value();
+    metrics.completed = entry.completed->value();
+    metrics.failed = entry.failed->value();
+    metrics.rejected = entry.rejected->value();
+    metrics.slo_misses = entry.slo_misses->value();
+    metrics.executed_cost = entry.executed_cost->value();
+    const auto latency = entry.latency->snapshot();
+    metrics.p50_latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::nanoseconds(latency.quantile(0.5)));
+    metrics.p99_latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::nanoseconds(latency.quantile(0.99)));
+    return metrics;
+}
+
+} // namespace rollup
+} // namespace quids
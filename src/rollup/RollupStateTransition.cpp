@@ -24,37 +24,82 @@ namespace rollup {
 RollupStateTransition::RollupStateTransition(std::shared_ptr<QZKPGenerator> zkp_generator)
     : zkp_generator_(std::move(zkp_generator)) {}
 
+void RollupStateTransition::set_proving_service(std::shared_ptr<ProvingService> service,
+                                                ProofListener listener) {
+    proving_service_ = std::move(service);
+    proof_listener_ = std::move(listener);
+}
+
 StateTransitionProof RollupStateTransition::generate_transition_proof(
     const std::vector<blockchain::Transaction>& batch,
     const StateManager& state_manager
 ) {
-    // (1) Generate ZKP proof data (assume generate_proof takes a quantum state as input)
-    // For example, assume you have already created your quantum state from the batch.
-    quantum::QuantumState quantum_state = encode_batch_to_quantum_state(batch); // your implementation
-    auto proofResult = zkp_generator_->generate_proof(quantum_state);
-    std::vector<uint8_t> local_proof_data = proofResult.proof_data;
+    // The clone shares every node with state_manager, so executing into it
+    // dirties only the written accounts' trie paths
+    auto post_state = state_manager.clone();
+    auto execution = executor_.apply_batch(*post_state, batch);
+    auto vec_post_root = post_state->get_state_root();
+    StateTrie::Hash post_state_root{};
+    std::copy_n(vec_post_root.begin(), post_state_root.size(), post_state_root.begin());
+    return build_proof(batch, state_manager.get_state_root(), post_state_root, diff_of(execution));
+}
+
+StateTransitionProof RollupStateTransition::generate_transition_proof(
+    const std::vector<blockchain::Transaction>& batch,
+    const StateManager& pre_state,
+    const OptimisticExecutor::Result& execution
+) {
+    auto diff = diff_of(execution);
+    const auto post_state_root = pre_state.root_after(diff);
+    return build_proof(batch, pre_state.get_state_root(), post_state_root, std::move(diff));
+}
+
+StateTransitionProof RollupStateTransition::build_proof(
+    const std::vector<blockchain::Transaction>& batch,
+    const std::vector<uint8_t>& pre_root_bytes,
+    const StateTrie::Hash& post_state_root,
+    StateDiff state_diff
+) {
+    const uint64_t batch_number = batch_number_++;
+
+    // (1) Generate ZKP proof data from the batch's quantum encoding; with a
+    // proving service the proof follows through the listener
+    quantum::QuantumState quantum_state = encode_batch_to_quantum_state(batch);
+    std::vector<uint8_t> local_proof_data;
+    std::optional<uint64_t> job;
+    if (proving_service_) {
+        job = proving_service_->submit(std::move(quantum_state), ProvingService::Priority::Normal,
+            [batch_number, listener = proof_listener_](uint64_t, ProvingService::Proof&& proof,
+                                                       std::exception_ptr error) {
+                if (listener) {
+                    listener(batch_number, std::move(proof.proof_data), error);
+                }
+            });
+    }
+    if (!job) {
+        auto proofResult = zkp_generator_->generate_proof(quantum_state);
+        local_proof_data = std::move(proofResult.proof_data);
+    }
 
     // (2) Convert the pre-state root from the state manager (which returns a std::vector<uint8_t>)
-    auto vec_root = state_manager.get_state_root();
-    if(vec_root.size() < 32)
+    if(pre_root_bytes.size() < 32)
         throw std::runtime_error("State root size is invalid");
     std::array<uint8_t, 32> pre_state_root{};
-    std::copy_n(vec_root.begin(), 32, pre_state_root.begin());
+    std::copy_n(pre_root_bytes.begin(), 32, pre_state_root.begin());
 
-    // (3) Compute the post-state root and the batch hash (both returning std::array<uint8_t, 32>)
-    std::array<uint8_t, 32> post_state_root = compute_post_state_root(batch, state_manager);
+    // (3) Compute the batch hash; the post-state root came out of execution
     std::array<uint8_t, 32> batch_hash = compute_batch_hash(batch);
 
-    // (4) Get the timestamp and batch number (ensure these are uint64_t)
+    // (4) Get the timestamp (the batch number was taken up front)
     uint64_t timestamp = static_cast<uint64_t>(
         std::chrono::system_clock::now().time_since_epoch().count()
     );
-    uint64_t batch_number = batch_number_++; // assuming batch_number_ is defined as uint64_t
 
     // (5) Now build the StateTransitionProof by assigning each field explicitly.
     StateTransitionProof proof;
     proof.pre_state_root = pre_state_root;
     proof.post_state_root = post_state_root;
+    proof.state_diff = std::move(state_diff);
     proof.transactions = batch;
     proof.proof_data = std::move(local_proof_data);
     proof.timestamp = timestamp;
@@ -64,6 +109,15 @@ StateTransitionProof RollupStateTransition::generate_transition_proof(
     return proof;
 }
 
+StateDiff RollupStateTransition::diff_of(const OptimisticExecutor::Result& execution) {
+    StateDiff diff;
+    diff.reserve(execution.writes.size());
+    for (const auto& [address, account] : execution.writes) {
+        diff.emplace_back(address, StateManager::account_hash(account));
+    }
+    return diff;
+}
+
 bool RollupStateTransition::verify_transition(
     const StateManager& pre_state,
     const StateManager& post_state,
@@ -86,6 +140,18 @@ bool RollupStateTransition::verify_transition(
     return temp_state->get_state_root() == post_state.get_state_root();
 }
 
+bool RollupStateTransition::verify_transition(
+    const StateManager& pre_state,
+    const StateTransitionProof& proof
+) const {
+    auto pre_root = pre_state.get_state_root();
+    if (pre_root.size() != proof.pre_state_root.size() ||
+        !std::equal(pre_root.begin(), pre_root.end(), proof.pre_state_root.begin())) {
+        return false;
+    }
+    return pre_state.root_after(proof.state_diff) == proof.post_state_root;
+}
+
 bool RollupStateTransition::validate_batch(
     [[maybe_unused]] const std::vector<blockchain::Transaction>& batch
 ) const {
@@ -102,7 +168,7 @@ bool RollupStateTransition::verify_batch_ordering(
 
 quantum::QuantumState RollupStateTransition::encode_batch_to_quantum_state(
     const std::vector<blockchain::Transaction>& batch
-) const {
+) {
     // Convert batch to quantum state vector
     const size_t state_size = batch.size() * 256; // 256 bits per tx
     Eigen::VectorXcd state_vector(state_size);
@@ -118,6 +184,24 @@ quantum::QuantumState RollupStateTransition::encode_batch_to_quantum_state(
     return quantum::QuantumState(state_vector);
 }
 
+quantum::QuantumState RollupStateTransition::encode_batch_to_quantum_state(
+    std::span<const blockchain::TransactionPtr> batch
+) {
+    // Same layout as above: the first 256 serialized bytes of each
+    // transaction, zero padded
+    Eigen::VectorXcd state_vector = Eigen::VectorXcd::Zero(batch.size() * 256);
+    blockchain::ByteVector tx_data;
+    for (size_t i = 0; i < batch.size(); i++) {
+        tx_data.clear();
+        batch[i]->serialize(tx_data);
+        for (size_t j = 0; j < std::min<size_t>(tx_data.size(), 256); j++) {
+            state_vector(i * 256 + j) = std::complex<double>(tx_data[j] / 255.0, 0);
+        }
+    }
+
+    return quantum::QuantumState(state_vector);
+}
+
 bool RollupStateTransition::verify_transaction_sequence(
     const std::vector<blockchain::Transaction>& transactions
 ) const {
@@ -130,17 +214,6 @@ bool RollupStateTransition::verify_transaction_sequence(
     return true;
 }
 
-std::array<uint8_t, 32> RollupStateTransition::compute_post_state_root(
-    const std::vector<blockchain::Transaction>& batch,
-    const StateManager& state_manager
-) {
-    // Convert vector to array
-    auto vec_root = state_manager.get_state_root();
-    std::array<uint8_t, 32> arr_root;
-    std::copy_n(vec_root.begin(), 32, arr_root.begin());
-    return arr_root;
-}
-
 std::array<uint8_t, 32> RollupStateTransition::compute_batch_hash(
     const std::vector<blockchain::Transaction>& batch
 ) {
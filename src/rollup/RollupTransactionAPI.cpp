@@ -1,58 +1,89 @@
 #include "rollup/RollupTransactionAPI.hpp"
 #include "rollup/EnhancedRollupMLModel.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include "utils/HealthSampler.hpp"
+#include "utils/Hex.hpp"
+#include "utils/Tracing.hpp"
 #include <openssl/sha.h>
 #include <openssl/evp.h>
+#include <algorithm>
 #include <chrono>
 #include <thread>
-#include <sstream>
-#include <iomanip>
+#include <cstring>
 
 using namespace std::chrono;
 using namespace quids::rollup;
 
+std::vector<uint8_t> TransactionBatch::compute_merkle_root() const {
+    // Leaves are the memoized transaction hashes, filled in parallel
+    quids::crypto::MerkleBuilder builder;
+    builder.appendParallel(transactions.size(), [this](size_t i) {
+        return quids::crypto::MerkleBuilder::toHash(transactions[i]->hash());
+    });
+    const auto root = builder.root();
+    return std::vector<uint8_t>(root.begin(), root.end());
+}
 
 RollupTransactionAPI::RollupTransactionAPI(
     std::shared_ptr<EnhancedRollupMLModel> ml_model,
-    size_t num_worker_threads
+    size_t num_worker_threads,
+    std::shared_ptr<Mempool> mempool,
+    BatchSink sink
 ) : ml_model_(std::move(ml_model)),
-    last_metrics_update_(std::chrono::system_clock::now()),
+    parameters_(std::make_shared<const QuantumParameters>()),
+    mempool_(mempool ? std::move(mempool) : std::make_shared<Mempool>()),
+    admission_(std::make_shared<quids::utils::AdmissionController>()),
+    sink_(std::move(sink)),
+    pool_(quids::utils::WorkStealingPool::global()),
+    max_drains_(std::max<size_t>(1, num_worker_threads)),
+    latency_(std::make_shared<quids::utils::Histogram>()),
+    proof_time_(std::make_shared<quids::utils::Histogram>()),
+    verification_time_(std::make_shared<quids::utils::Histogram>()),
+    metrics_epoch_ns_(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count()),
     should_stop_(false) {
-    
-    // Start worker threads
-    for (size_t i = 0; i < num_worker_threads; i++) {
-        worker_threads_.emplace_back(&RollupTransactionAPI::worker_thread, this);
-    }
+    auto& registry = quids::utils::MetricsRegistry::global();
+    registry.attach("quids_tx_submit_latency_seconds", "Time to validate and queue a submission", {}, latency_);
+    registry.attach("quids_batch_proof_seconds", "Time to process one batch", {}, proof_time_);
+    registry.attach("quids_batch_verification_seconds", "Time to verify one batch", {}, verification_time_);
+
+    admission_->add_stage("mempool", [pool = std::weak_ptr<Mempool>(mempool_)] {
+        auto mempool = pool.lock();
+        return mempool ? static_cast<double>(mempool->size()) / static_cast<double>(std::max<size_t>(1, mempool->capacity()))
+                       : 0.0;
+    });
 }
 
 RollupTransactionAPI::~RollupTransactionAPI() {
     stop_processing();
-    for (auto& thread : worker_threads_) {
-        if (thread.joinable()) {
-            thread.join();
+    
+    // Drain and inference tasks reference this object until they finish
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            if (active_drains_ == 0 && !inference_running_.load(std::memory_order_acquire)) break;
+        }
+        if (!pool_.run_one()) {
+            std::this_thread::yield();
         }
     }
 }
 
-bool RollupTransactionAPI::submitTransaction(const blockchain::Transaction& tx) {
-    std::string validation_result = validate_transaction_with_message(tx);
-    if (!validation_result.empty()) {
+bool RollupTransactionAPI::submitTransaction(blockchain::TransactionPtr tx) {
+    std::string validation_result = validate_transaction_with_message(*tx);
+    if (!validation_result.empty() || is_overloaded()) {
         return false;
     }
 
     auto start = std::chrono::system_clock::now();
+    quids::utils::Span span("mempool.admit", quids::utils::transaction_trace_id(tx->getSender(), tx->getNonce()));
 
-    // Create batch for single transaction
-    TransactionBatch batch;
-    batch.transactions.push_back(tx);
-    batch.batch_id = 0;  // Single tx batch
-    batch.timestamp = static_cast<uint64_t>(
-        std::chrono::system_clock::now().time_since_epoch().count()
-    );
+    if (!Mempool::is_accepted(mempool_->submit(std::move(tx)))) {
+        return false;
+    }
 
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
-        batch_queue_.push(batch);
-        queue_cv_.notify_one();
+        schedule_drain_locked();
     }
 
     auto end = std::chrono::system_clock::now();
@@ -61,61 +92,89 @@ bool RollupTransactionAPI::submitTransaction(const blockchain::Transaction& tx)
     return true;
 }
 
-bool RollupTransactionAPI::submit_batch(const std::vector<blockchain::Transaction>& transactions) {
+bool RollupTransactionAPI::submit_batch(const std::vector<blockchain::TransactionPtr>& transactions) {
     auto start = std::chrono::system_clock::now();
 
     // Validate all transactions
+    if (is_overloaded()) {
+        return false;
+    }
     for (const auto& tx : transactions) {
-        if (!validate_transaction(tx)) {
+        if (!validate_transaction(*tx)) {
             return false;
         }
     }
 
-    // Create batch
-    TransactionBatch batch;
-    batch.transactions = transactions;
-    batch.batch_id = 0;  // Will be assigned by processor
-    batch.timestamp = static_cast<uint64_t>(
-        std::chrono::system_clock::now().time_since_epoch().count()
-    );
+    auto results = mempool_->submit_batch(transactions);
+    const bool all_accepted = std::all_of(results.begin(), results.end(), Mempool::is_accepted);
 
     {
         std::lock_guard<std::mutex> lock(queue_mutex_);
-        batch_queue_.push(batch);
-        queue_cv_.notify_one();
+        schedule_drain_locked();
     }
 
     auto end = std::chrono::system_clock::now();
     record_latency(std::chrono::duration_cast<std::chrono::microseconds>(end - start));
 
-    return true;
+    return all_accepted;
 }
 
 void RollupTransactionAPI::start_processing() {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
     should_stop_ = false;
+    // Pick up anything queued while stopped
+    const size_t pending_batches = (mempool_->size() + MAX_BATCH_SIZE - 1) / MAX_BATCH_SIZE;
+    while (active_drains_ < std::min(max_drains_, pending_batches)) {
+        schedule_drain_locked();
+    }
 }
 
 void RollupTransactionAPI::stop_processing() {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
     should_stop_ = true;
-    queue_cv_.notify_all();
 }
 
-void RollupTransactionAPI::worker_thread() {
-    while (!should_stop_) {
-        TransactionBatch batch;
-        
+void RollupTransactionAPI::schedule_drain_locked() {
+    if (should_stop_ || active_drains_ >= max_drains_) {
+        return;
+    }
+    active_drains_++;
+    pool_.post(quids::utils::TaskPriority::Execution, [this] { drain_batches(); });
+}
+
+void RollupTransactionAPI::drain_batches() {
+    while (true) {
         {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            queue_cv_.wait(lock, [this] {
-                return !batch_queue_.empty() || should_stop_;
-            });
-            
-            if (should_stop_) break;
-            
-            batch = batch_queue_.front();
-            batch_queue_.pop();
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            // Submitters add to the mempool before taking this lock, so a
+            // transaction is either seen here or schedules a new drain
+            if (should_stop_ || mempool_->empty()) {
+                active_drains_--;
+                return;
+            }
         }
         
+        TransactionBatch batch;
+        batch.transactions = mempool_->take(MAX_BATCH_SIZE);
+        if (batch.transactions.empty()) {
+            continue;
+        }
+        batch.batch_id = 0;  // Will be assigned by processor
+        batch.timestamp = static_cast<uint64_t>(
+            std::chrono::system_clock::now().time_since_epoch().count()
+        );
+        batch.merkle_root = batch.compute_merkle_root();
+        batch.parameters = parameters_.load(std::memory_order_acquire);
+
+        // The batch is named after its root; sampled members link into it
+        uint64_t root_prefix = 0;
+        std::memcpy(&root_prefix, batch.merkle_root.data(), std::min(sizeof(root_prefix), batch.merkle_root.size()));
+        const quids::utils::TraceId batch_trace = quids::utils::aggregate_trace_id("batch", root_prefix);
+        auto& tracer = quids::utils::Tracer::global();
+        for (const auto& tx : batch.transactions) {
+            tracer.link("batch.assign", quids::utils::transaction_trace_id(tx->getSender(), tx->getNonce()), batch_trace);
+        }
+        quids::utils::Span span("batch.process", batch_trace);
         process_batch(batch);
     }
 }
@@ -134,7 +193,7 @@ std::string RollupTransactionAPI::validate_transaction_with_message(const blockc
         return "Invalid recipient address";
     }
     
-    if (tx.value == 0) {
+    if (tx.getValue() == 0) {
         return "Transaction value cannot be zero";
     }
     
@@ -142,11 +201,8 @@ std::string RollupTransactionAPI::validate_transaction_with_message(const blockc
         return "Missing transaction signature";
     }
     
-    // Check if transaction would overload the system
-    if (is_overloaded()) {
-        return "System is currently overloaded";
-    }
-    
+    // Load is checked on submission only, so batches already admitted are
+    // never failed by the backlog behind them
     return "";  // Empty string means validation passed
 }
 
@@ -155,93 +211,122 @@ bool RollupTransactionAPI::process_batch(const TransactionBatch& batch) {
     bool success = true;
 
     for (const auto& tx : batch.transactions) {
-        if (!validate_transaction(tx)) {
+        if (!validate_transaction(*tx)) {
             success = false;
             break;
         }
         record_latency(duration_cast<microseconds>(system_clock::now() - start));
     }
 
+    if (success && sink_) {
+        sink_(batch);
+    }
+
     auto end = system_clock::now();
     record_proof_time(duration_cast<microseconds>(end - start));
     return success;
 }
 
 std::string RollupTransactionAPI::calculate_transaction_hash(const blockchain::Transaction& tx) const {
-    std::stringstream ss;
-    ss << tx.getSender() << tx.getRecipient() << std::to_string(tx.value);
-    // Add more fields as needed
-    
-    // For now, return a simple hash
-    // In production, use a proper cryptographic hash
-    return ss.str();
+    return utils::toHex(tx.hash());
 }
 
 RollupPerformanceMetrics RollupTransactionAPI::get_performance_metrics() const {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    return current_metrics_;
+    // Merged from the histogram shards here rather than on every record
+    RollupPerformanceMetrics metrics;
+    const auto latency = latency_->snapshot();
+    metrics.total_transactions = latency.count;
+    metrics.avg_tx_latency = latency.mean() / 1000.0;  // microseconds
+    metrics.proof_generation_time = proof_time_->snapshot().mean() * 1e-9;
+    metrics.verification_time = verification_time_->snapshot().mean() * 1e-9;
+
+    // Throughput over at most the last second
+    const auto now_ns = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    const double elapsed = static_cast<double>(now_ns - metrics_epoch_ns_.load(std::memory_order_relaxed)) * 1e-9;
+    if (elapsed > 0 && latency.count > 0) {
+        metrics.tx_throughput = static_cast<double>(latency.count) / std::min(elapsed, 1.0);
+    }
+    // Resource inputs for the ML model, smoothed over the sampler's 10 s window
+    const auto health = utils::HealthSampler::global().snapshot();
+    if (health.ticks > 0) {
+        metrics.cpu_usage = health.last_10s.cpu_usage * 100.0;
+        metrics.memory_usage = health.last_10s.memory_mb;
+    }
+    metrics.last_update = system_clock::now();
+    return metrics;
 }
 
 void RollupTransactionAPI::reset_metrics() {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    current_metrics_ = RollupPerformanceMetrics();
-    current_metrics_.total_transactions = 0;
-    current_metrics_.tx_throughput = 0;
-    current_metrics_.avg_tx_latency = 0;
-    last_metrics_update_ = system_clock::now();
+    latency_->reset();
+    proof_time_->reset();
+    verification_time_->reset();
+    metrics_epoch_ns_.store(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count(),
+                            std::memory_order_relaxed);
 }
 
 void RollupTransactionAPI::set_ml_model(std::shared_ptr<EnhancedRollupMLModel> model) {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    ml_model_ = model;
+    ml_model_.store(std::move(model), std::memory_order_release);
+}
+
+std::shared_ptr<const EnhancedRollupMLModel> RollupTransactionAPI::get_ml_model() const {
+    return ml_model_.load(std::memory_order_acquire);
 }
 
 void RollupTransactionAPI::optimize_parameters() {
-    if (ml_model_) {
-        std::vector<QuantumParameters> chain_params;  // Create empty vector
-        [[maybe_unused]] auto result = ml_model_->optimize_parameters(
-            current_metrics_,
-            chain_params
-        );
+    auto model = ml_model_.load(std::memory_order_acquire);
+    if (!model || inference_running_.exchange(true, std::memory_order_acq_rel)) {
+        return;
     }
+    // Inputs are captured here so the task touches nothing the hot path
+    // writes
+    auto metrics = get_performance_metrics();
+
+    pool_.post(quids::utils::TaskPriority::ML, [this, model = std::move(model), metrics]() {
+        try {
+            // The snapshot is labelled with the parameters it ran under, and
+            // the model catches up on it before predicting
+            if (auto current = parameters_.load(std::memory_order_acquire)) {
+                model->observe(metrics, *current);
+                model->train_incremental();
+            }
+            std::vector<QuantumParameters> chain_params;
+            auto result = model->optimize_parameters(metrics, chain_params);
+            if (result.success_flag) {
+                parameters_.store(std::make_shared<const QuantumParameters>(std::move(result.parameters)),
+                                  std::memory_order_release);
+                parameters_version_.fetch_add(1, std::memory_order_release);
+            }
+        } catch (...) {
+            // A failed inference keeps the last published parameters
+        }
+        inference_running_.store(false, std::memory_order_release);
+    });
+}
+
+std::shared_ptr<const QuantumParameters> RollupTransactionAPI::get_parameters() const {
+    return parameters_.load(std::memory_order_acquire);
+}
+
+uint64_t RollupTransactionAPI::get_parameters_version() const {
+    return parameters_version_.load(std::memory_order_acquire);
 }
 
 bool RollupTransactionAPI::is_overloaded() const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    return batch_queue_.size() >= MAX_QUEUE_SIZE;
+    // Past even the Priority lane's threshold; the RPC edge sheds the
+    // lower lanes before this
+    return mempool_->is_full() || admission_->overloaded();
 }
 
 void RollupTransactionAPI::record_latency(microseconds latency) {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    current_metrics_.avg_tx_latency = 
-        (current_metrics_.avg_tx_latency * current_metrics_.total_transactions + 
-         static_cast<double>(latency.count())) / 
-        (current_metrics_.total_transactions + 1);
-    current_metrics_.total_transactions++;
-    
-    // Calculate throughput based on a sliding window
-    auto now = system_clock::now();
-    auto duration = duration_cast<microseconds>(now - last_metrics_update_).count() / 1000000.0;
-    if (duration > 0) {
-        // Use a sliding window of 1 second for throughput calculation
-        if (duration > 1.0) {
-            last_metrics_update_ = now - seconds(1);
-            duration = 1.0;
-        }
-        current_metrics_.tx_throughput = current_metrics_.total_transactions / duration;
-    }
+    latency_->record(latency);
 }
 
 void RollupTransactionAPI::record_proof_time(microseconds time) {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    current_metrics_.proof_generation_time = 
-        (current_metrics_.proof_generation_time + time.count() / 1000000.0) / 2;
+    proof_time_->record(time);
 }
 
 void RollupTransactionAPI::record_verification_time(microseconds time) {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    current_metrics_.verification_time = 
-        (current_metrics_.verification_time + time.count() / 1000000.0) / 2;
+    verification_time_->record(time);
 }
 
 struct OptimizationResult {
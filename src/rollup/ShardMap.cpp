@@ -0,0 +1,234 @@
+#include "rollup/ShardMap.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+using Key = ShardMap::Key;
+
+constexpr Key KEY_MAX = std::numeric_limits<Key>::max();
+
+// First key of the upper half of [first, last]; needs last > first
+Key midpoint(Key first, Key last) {
+    return first + (last - first) / 2 + 1;
+}
+
+uint64_t distance(uint64_t a, uint64_t b) {
+    return a > b ? a - b : b - a;
+}
+
+} // namespace
+
+ShardMap::ShardMap(ChainId root) {
+    slots_.push_back(std::make_unique<Slot>(0, root));
+    chains_.push_back(root);
+}
+
+ShardMap::Key ShardMap::key_of(std::string_view account) {
+    uint8_t digest[8];
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, account.data(), account.size());
+    blake3_hasher_finalize(&hasher, digest, sizeof(digest));
+    Key key = 0;
+    for (size_t i = 0; i < sizeof(digest); ++i) {
+        key |= static_cast<Key>(digest[i]) << (8 * i);
+    }
+    return key;
+}
+
+size_t ShardMap::slot_index(Key key) const {
+    auto it = std::upper_bound(slots_.begin(), slots_.end(), key,
+                               [](Key k, const std::unique_ptr<Slot>& slot) { return k < slot->first; });
+    return static_cast<size_t>(std::distance(slots_.begin(), it)) - 1;
+}
+
+ShardMap::Key ShardMap::last_of(size_t index) const {
+    return index + 1 < slots_.size() ? slots_[index + 1]->first - 1 : KEY_MAX;
+}
+
+ShardMap::ChainId ShardMap::chain_for(std::string_view account) const {
+    return chain_for_key(key_of(account));
+}
+
+ShardMap::ChainId ShardMap::chain_for_key(Key key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return slots_[slot_index(key)]->chain;
+}
+
+void ShardMap::record(std::string_view account, uint64_t weight) {
+    const Key key = key_of(account);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    const size_t index = slot_index(key);
+    Slot& slot = *slots_[index];
+    const Key last = last_of(index);
+    auto& half = (last > slot.first && key >= midpoint(slot.first, last)) ? slot.upper : slot.lower;
+    half.fetch_add(weight, std::memory_order_relaxed);
+}
+
+bool ShardMap::split_to(size_t index, ChainId chain, uint64_t target, Migration& out) {
+    Slot& slot = *slots_[index];
+    const Key first = slot.first;
+    const Key last = last_of(index);
+    if (first == last) {
+        return false;
+    }
+    const Key mid = midpoint(first, last);
+    const uint64_t lower = slot.lower.load(std::memory_order_relaxed);
+    const uint64_t upper = slot.upper.load(std::memory_order_relaxed);
+
+    out.from = slot.chain;
+    if (distance(upper, target) <= distance(lower, target)) {
+        out.range = Range{mid, last, chain};
+        slots_.insert(slots_.begin() + static_cast<std::ptrdiff_t>(index) + 1,
+                      std::make_unique<Slot>(mid, chain));
+    } else {
+        out.range = Range{first, mid - 1, chain};
+        slot.first = mid;
+        slots_.insert(slots_.begin() + static_cast<std::ptrdiff_t>(index),
+                      std::make_unique<Slot>(first, chain));
+    }
+
+    // Counts start over under the new layout
+    for (auto& s : slots_) {
+        s->lower.store(0, std::memory_order_relaxed);
+        s->upper.store(0, std::memory_order_relaxed);
+    }
+    merge_neighbours();
+    out.epoch = ++epoch_;
+    return true;
+}
+
+void ShardMap::merge_neighbours() {
+    std::vector<std::unique_ptr<Slot>> merged;
+    merged.reserve(slots_.size());
+    for (auto& slot : slots_) {
+        if (!merged.empty() && merged.back()->chain == slot->chain) {
+            continue;
+        }
+        merged.push_back(std::move(slot));
+    }
+    slots_ = std::move(merged);
+}
+
+std::optional<ShardMap::Migration> ShardMap::add_chain(ChainId chain) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (std::find(chains_.begin(), chains_.end(), chain) != chains_.end()) {
+        return std::nullopt;
+    }
+
+    // Busiest splittable range, the widest when nothing has been recorded
+    std::optional<size_t> best;
+    uint64_t best_load = 0;
+    Key best_width = 0;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        const Key width = last_of(i) - slots_[i]->first;
+        if (width == 0) continue;
+        const uint64_t load = slots_[i]->lower.load(std::memory_order_relaxed) +
+                              slots_[i]->upper.load(std::memory_order_relaxed);
+        if (!best || load > best_load || (load == best_load && width > best_width)) {
+            best = i;
+            best_load = load;
+            best_width = width;
+        }
+    }
+    if (!best) {
+        return std::nullopt;
+    }
+
+    uint64_t owner_load = 0;
+    for (const auto& slot : slots_) {
+        if (slot->chain == slots_[*best]->chain) {
+            owner_load += slot->lower.load(std::memory_order_relaxed) + slot->upper.load(std::memory_order_relaxed);
+        }
+    }
+
+    Migration migration;
+    if (!split_to(*best, chain, owner_load / 2, migration)) {
+        return std::nullopt;
+    }
+    chains_.push_back(chain);
+    return migration;
+}
+
+std::optional<ShardMap::Migration> ShardMap::rebalance(const CrossChainState& state) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (state.chain_loads.size() != chains_.size()) {
+        throw std::invalid_argument("Chain state does not match the shard map");
+    }
+    // High utilization on balanced chains calls for another chain, which
+    // is add_chain()'s job
+    if (!state.needs_rebalancing() || state.is_balanced()) {
+        return std::nullopt;
+    }
+
+    const auto& loads = state.chain_loads;
+    const size_t hot = static_cast<size_t>(std::distance(loads.begin(), std::max_element(loads.begin(), loads.end())));
+    const size_t cold = static_cast<size_t>(std::distance(loads.begin(), std::min_element(loads.begin(), loads.end())));
+    if (loads[hot] <= loads[cold]) {
+        return std::nullopt;
+    }
+
+    uint64_t hot_load = 0;
+    uint64_t cold_load = 0;
+    std::optional<size_t> best;
+    uint64_t best_load = 0;
+    Key best_width = 0;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        const Slot& slot = *slots_[i];
+        const uint64_t load = slot.lower.load(std::memory_order_relaxed) + slot.upper.load(std::memory_order_relaxed);
+        if (slot.chain == chains_[cold]) {
+            cold_load += load;
+        }
+        if (slot.chain != chains_[hot]) {
+            continue;
+        }
+        hot_load += load;
+        const Key width = last_of(i) - slot.first;
+        if (width != 0 && (!best || load > best_load || (load == best_load && width > best_width))) {
+            best = i;
+            best_load = load;
+            best_width = width;
+        }
+    }
+    if (!best) {
+        return std::nullopt;
+    }
+
+    // Aim to close half the recorded gap between the two chains
+    const uint64_t target = hot_load > cold_load ? (hot_load - cold_load) / 2 : hot_load / 2;
+    Migration migration;
+    if (!split_to(*best, chains_[cold], target, migration)) {
+        return std::nullopt;
+    }
+    return migration;
+}
+
+std::vector<ShardMap::ChainId> ShardMap::chains() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return chains_;
+}
+
+std::vector<ShardMap::Range> ShardMap::ranges() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<Range> out;
+    out.reserve(slots_.size());
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        out.push_back(Range{slots_[i]->first, last_of(i), slots_[i]->chain});
+    }
+    return out;
+}
+
+uint64_t ShardMap::epoch() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return epoch_;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,86 @@
+#include "rollup/ShardRouter.hpp"
+
+namespace quids {
+namespace rollup {
+
+ShardRouter::ShardRouter(std::shared_ptr<ShardMap> map,
+                         std::shared_ptr<CrossRollupBridge> bridge,
+                         Mempool::Config pool_config)
+    : map_(std::move(map)),
+      bridge_(std::move(bridge)),
+      pool_config_(pool_config) {}
+
+Mempool& ShardRouter::mempool(ChainId chain) {
+    std::lock_guard<std::mutex> lock(pools_mutex_);
+    auto& pool = pools_[chain];
+    if (!pool) {
+        pool = std::make_unique<Mempool>(pool_config_);
+    }
+    return *pool;
+}
+
+ShardRouter::ChainId ShardRouter::chain_of(const Transaction& tx) const {
+    return map_->chain_for(tx.getSender());
+}
+
+bool ShardRouter::is_cross_shard(const Transaction& tx) const {
+    return map_->chain_for(tx.getRecipient()) != chain_of(tx);
+}
+
+Mempool::AddResult ShardRouter::submit(TransactionPtr tx) {
+    std::shared_lock<std::shared_mutex> lock(routing_mutex_);
+    const ChainId chain = chain_of(*tx);
+    const auto result = mempool(chain).submit(tx);
+    if (Mempool::is_accepted(result)) {
+        map_->record(tx->getSender());
+    }
+    return result;
+}
+
+std::optional<uint64_t> ShardRouter::on_committed(const Transaction& tx) {
+    const ChainId source = chain_of(tx);
+    mempool(source).on_committed(tx.getSender(), tx.getNonce());
+
+    const ChainId destination = map_->chain_for(tx.getRecipient());
+    if (destination == source || !bridge_) {
+        return std::nullopt;
+    }
+    CrossRollupBridge::CrossRollupMessage credit{};
+    credit.source_chain_id = source;
+    credit.destination_chain_id = destination;
+    tx.serialize(credit.payload);
+    return bridge_->send_message(credit);
+}
+
+size_t ShardRouter::apply(const ShardMap::Migration& migration) {
+    const auto& range = migration.range;
+    auto moved = mempool(migration.from).extract_senders([&](const std::string& sender) {
+        const auto key = ShardMap::key_of(sender);
+        return key >= range.first && key <= range.last;
+    });
+    if (!moved.empty()) {
+        (void)mempool(range.chain).submit_batch(moved);
+    }
+    return moved.size();
+}
+
+std::optional<ShardMap::Migration> ShardRouter::add_chain(ChainId chain) {
+    std::unique_lock<std::shared_mutex> lock(routing_mutex_);
+    auto migration = map_->add_chain(chain);
+    if (migration) {
+        apply(*migration);
+    }
+    return migration;
+}
+
+std::optional<ShardMap::Migration> ShardRouter::rebalance(const CrossChainState& state) {
+    std::unique_lock<std::shared_mutex> lock(routing_mutex_);
+    auto migration = map_->rebalance(state);
+    if (migration) {
+        apply(*migration);
+    }
+    return migration;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -1,4 +1,13 @@
 #include "rollup/StateManager.hpp"
+#include "crypto/signature/BatchVerifier.hpp"
+#include "rollup/HistoryIndexer.hpp"
+#include "rollup/StateTrie.hpp"
+#include "rollup/StateStore.hpp"
+#include "rollup/StateWitness.hpp"
+#include "state/LockFreeStateManager.hpp"
+#include "utils/PerfCounters.hpp"
+#include "utils/PersistentMap.hpp"
+#include "utils/WorkStealingPool.hpp"
 #include <stdexcept>
 #include <unordered_map>
 #include <mutex>
@@ -6,76 +15,455 @@
 #include <shared_mutex>
 #include <cstring>
 #include <cstdio>
-#include <iomanip>
-#include <sstream>
 #include <algorithm>
+#include <limits>
 
 #include <blake3.h>
 #include <deque>
+#include <set>
+#include <unordered_set>
 
 namespace quids {
 namespace rollup {
 
-    // Helper function to convert address to hex string
-    std::string address_to_hex(const ::evm::Address& address) {
-        std::stringstream ss;
-        ss << std::hex << std::setfill('0');
-        for (uint8_t byte : address.bytes) {
-            ss << std::setw(2) << static_cast<int>(byte);
-        }
-        return ss.str();
-    }
+namespace {
 
-    // Helper function to calculate state root
-    std::vector<uint8_t> calculate_state_root(const std::unordered_map<std::string, StateManager::Account>& accounts) {
-        blake3_hasher hasher;
-        blake3_hasher_init(&hasher);
+// Below this apply_transactions() runs on the calling thread
+constexpr size_t PARALLEL_APPLY_MIN_TXS = 64;
 
-        // Sort accounts by address for deterministic root
-        std::vector<std::pair<std::string, const StateManager::Account*>> sorted_accounts;
-        sorted_accounts.reserve(accounts.size());
-        for (const auto& [addr, account] : accounts) {
-            sorted_accounts.emplace_back(addr, &account);
-        }
-        std::sort(sorted_accounts.begin(), sorted_accounts.end());
+// Code size that marks serialized code as a hash
+constexpr size_t CODE_BY_HASH = std::numeric_limits<size_t>::max();
+
+} // namespace
 
-        // Hash each account's state
-        for (const auto& [addr, account] : sorted_accounts) {
-            std::vector<uint8_t> account_data = account->serialize();
-            blake3_hasher_update(&hasher, account_data.data(), account_data.size());
+using AccountMap = utils::PersistentMap<std::string, StateManager::Account>;
+
+namespace {
+
+// Accounts of a store-backed state that no version has written since it
+// was loaded. Each is read through StateStore::get() on first use and then
+// kept as it was at the loaded head, which is what every version that has
+// not written it sees. Writers load an account here before changing it, so
+// a value read from the store after a change reached it is always
+// superseded by the head value loaded first.
+class ColdAccounts {
+public:
+    explicit ColdAccounts(std::shared_ptr<StateStore> store) : store_(std::move(store)) {}
+
+    // Valid for the life of this object; nullptr if the store lacks it
+    const StateManager::Account* find(const std::string& address) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (auto it = loaded_.find(address); it != loaded_.end()) {
+                return it->second ? &*it->second : nullptr;
+            }
         }
+        auto account = store_->get(address);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = loaded_.try_emplace(address, std::move(account)).first;
+        return it->second ? &*it->second : nullptr;
+    }
 
-        std::vector<uint8_t> root(BLAKE3_OUT_LEN);
-        blake3_hasher_finalize(&hasher, root.data(), root.size());
-        return root;
+    // Every account on disk, at its head value if one was loaded, without
+    // loading the rest
+    void for_each(const std::function<void(const std::string&, const StateManager::Account&)>& fn) {
+        store_->for_each_account([&](const std::string& address, StateManager::Account account) {
+            const StateManager::Account* head = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (auto it = loaded_.find(address); it != loaded_.end() && it->second) {
+                    head = &*it->second;
+                }
+            }
+            fn(address, head ? *head : account);
+        });
     }
 
+private:
+    std::shared_ptr<StateStore> store_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::optional<StateManager::Account>> loaded_;
+};
+
+// `accounts` holds what was written since the load, `trie` says which
+// accounts exist at all, and the rest come from `cold`
+const StateManager::Account* find_in(const AccountMap& accounts, const StateTrie& trie,
+                                     ColdAccounts* cold, const std::string& address) {
+    if (const StateManager::Account* account = accounts.find(address)) {
+        return account;
+    }
+    return cold && trie.contains(address) ? cold->find(address) : nullptr;
+}
+
+} // namespace
+
+struct StateManager::Snapshot::Data {
+    uint64_t version{0};
+    AccountMap accounts;
+    StateTrie trie;
+    std::shared_ptr<ColdAccounts> cold;
+
+    const Account* find(const std::string& address) const {
+        return find_in(accounts, trie, cold.get(), address);
+    }
+};
 
 struct StateManager::Impl {
-    std::unordered_map<std::string, Account> accounts;
+    // Structurally shared with every snapshot taken from it
+    AccountMap accounts;
     std::vector<uint8_t> current_state_root;
     std::vector<uint8_t> previous_state_root;
-    std::unordered_map<std::string, std::deque<blockchain::Transaction>> history;
-    static constexpr size_t MAX_HISTORY_PER_ACCOUNT = 1000;
+    // History recorded since the last commit, for the indexer
+    std::shared_ptr<HistoryIndexer> history_indexer;
+    std::vector<HistoryIndexer::Ref> pending_history;
+    uint32_t pending_position{0};
+
+    // Committed versions reachable through at(), oldest first
+    uint64_t version{0};
+    std::deque<Snapshot> committed;
+    // Each retained version pins the nodes it shares with no later one
+    size_t max_retained_versions{64};
+
+    // Durable tier, if any, and the accounts touched since the last commit
+    std::shared_ptr<StateStore> store;
+    std::unordered_set<std::string> dirty;
+
+    // Authenticated view of `accounts`, kept in sync by touch()
+    StateTrie trie;
+    // Accounts loaded from the store but not written since, shared with
+    // every snapshot and clone; null unless the state was loaded from one
+    std::shared_ptr<ColdAccounts> cold;
+
+    // Balances and nonces for get_balance()/get_nonce(), read without the
+    // lock. Touched accounts are published once per mutating call; the
+    // ones published since the last commit are what a rollback rewrites.
+    // States built from a snapshot, clones included, have none, so that
+    // taking them stays O(1), and neither do states loaded from a store,
+    // whose accounts are not all in memory; they read under the lock.
+    std::unique_ptr<state::LockFreeStateManager> index;
+    std::vector<std::string> index_pending;
+    std::vector<std::string> index_uncommitted;
+    // Set while a witness records, so reads take the lock and note() sees them
+    std::atomic<bool> noting{false};
+
+    bool lock_free_reads() const { return index && !noting.load(std::memory_order_acquire); }
+
+    // Addresses noted since begin_witness(); shared with clones, which
+    // note into it under their own locks
+    struct WitnessLog {
+        Snapshot pre;
+        std::mutex mutex;
+        std::set<std::string> addresses;
+    };
+    std::shared_ptr<WitnessLog> witness;
+    // Set on a state built from a witness: the accounts it proves
+    std::shared_ptr<const std::unordered_set<std::string>> coverage;
+
+    void note(const std::string& address) const {
+        if (coverage && !coverage->count(address)) {
+            throw std::out_of_range("Witness does not cover account " + address);
+        }
+        if (witness) {
+            std::lock_guard<std::mutex> lock(witness->mutex);
+            witness->addresses.insert(address);
+        }
+    }
+
+    // Lookups and mutations below assume StateManager::mutex_ is held
+
+    // Unshares the account from any snapshot before handing it out; only
+    // valid under the unique lock
+    Account* find_mutable(const std::string& address) {
+        note(address);
+        return lookup_mutable(address);
+    }
+
+    const Account* find(const std::string& address) const {
+        note(address);
+        return lookup(address);
+    }
+
+    // As find() and find_mutable(), without noting the access
+    const Account* lookup(const std::string& address) const {
+        return find_in(accounts, trie, cold.get(), address);
+    }
+
+    Account* lookup_mutable(const std::string& address) {
+        if (Account* account = accounts.find_mutable(address)) {
+            return account;
+        }
+        const Account* loaded = cold && trie.contains(address) ? cold->find(address) : nullptr;
+        if (!loaded) {
+            return nullptr;
+        }
+        accounts.set(address, *loaded);
+        return accounts.find_mutable(address);
+    }
+
+    void touch(const std::string& address) {
+        if (const Account* account = lookup(address)) {
+            touch(address, StateManager::account_hash(*account));
+        } else {
+            note(address);
+            mark(address);
+            trie.erase(address);
+        }
+    }
+
+    // For an account that exists and whose leaf was hashed already
+    void touch(const std::string& address, const StateTrie::Hash& leaf) {
+        note(address);
+        mark(address);
+        trie.update(address, leaf);
+    }
+
+    void mark(const std::string& address) {
+        if (store) {
+            dirty.insert(address);
+        }
+        if (index) {
+            index_pending.push_back(address);
+        }
+    }
+
+    // Only the hash and the position are kept; both sides of a transfer
+    // share the position
+    void record(const std::string& address, const blockchain::Transaction& tx) {
+        if (!history_indexer) {
+            return;
+        }
+        const auto hash = tx.hash();
+        if (pending_history.empty() || pending_history.back().tx_hash != hash) {
+            if (!pending_history.empty()) {
+                pending_position++;
+            }
+        } else if (pending_history.back().address == address) {
+            return;  // self transfer
+        }
+        pending_history.push_back({address, version + 1, pending_position, hash});
+    }
+
+    void publish_index() {
+        if (index_pending.empty()) {
+            return;
+        }
+        auto batch = index->batch();
+        for (auto& address : index_pending) {
+            if (const Account* account = lookup(address)) {
+                batch.put(address, {account->balance, account->nonce});
+            } else {
+                batch.erase(address);
+            }
+            index_uncommitted.push_back(std::move(address));
+        }
+        index_pending.clear();
+        index->commit(batch);
+    }
+
+    std::vector<uint8_t> root_bytes() const {
+        auto root = trie.root();
+        return std::vector<uint8_t>(root.begin(), root.end());
+    }
+
+    Snapshot capture() const {
+        auto data = std::make_shared<Snapshot::Data>();
+        data->version = version;
+        data->accounts = accounts;
+        data->trie = trie;
+        data->cold = cold;
+        return Snapshot(std::move(data));
+    }
+
+    void restore(const Snapshot& snapshot) {
+        accounts = snapshot.data_->accounts;
+        trie = snapshot.data_->trie;
+        cold = snapshot.data_->cold;
+    }
 };
 
+StateManager::Snapshot::Snapshot() : data_(std::make_shared<Data>()) {}
+
+StateManager::Snapshot::Snapshot(std::shared_ptr<const Data> data) : data_(std::move(data)) {}
+
+uint64_t StateManager::Snapshot::version() const {
+    return data_->version;
+}
+
+size_t StateManager::Snapshot::account_count() const {
+    // Cold accounts are only in the trie
+    return data_->cold ? data_->trie.size() : data_->accounts.size();
+}
+
+std::optional<StateManager::Account> StateManager::Snapshot::get_account(const std::string& address) const {
+    if (const Account* account = data_->find(address)) {
+        return *account;
+    }
+    return std::nullopt;
+}
+
+const StateManager::Account* StateManager::Snapshot::find_account(const std::string& address) const {
+    return data_->find(address);
+}
+
+uint64_t StateManager::Snapshot::get_balance(const std::string& address) const {
+    const Account* account = data_->find(address);
+    return account ? account->balance : 0;
+}
+
+uint64_t StateManager::Snapshot::get_nonce(const std::string& address) const {
+    const Account* account = data_->find(address);
+    return account ? account->nonce : 0;
+}
+
+std::vector<uint8_t> StateManager::Snapshot::get_state_root() const {
+    auto root = data_->trie.root();
+    return std::vector<uint8_t>(root.begin(), root.end());
+}
+
+std::optional<StateTrie::Proof> StateManager::Snapshot::prove_account(const std::string& address) const {
+    return data_->trie.prove(address);
+}
+
+std::optional<StateTrie::AbsenceProof> StateManager::Snapshot::prove_absent(const std::string& address) const {
+    return data_->trie.prove_absent(address);
+}
+
+std::optional<StateTrie::MultiProof> StateManager::Snapshot::prove_accounts(
+    const std::vector<std::string>& addresses
+) const {
+    return data_->trie.prove_many(addresses);
+}
+
+void StateManager::Snapshot::for_each_account(
+    const std::function<void(const std::string&, const Account&)>& fn
+) const {
+    data_->accounts.for_each(fn);
+    if (data_->cold) {
+        // The store has every account the trie does except those written
+        // since the load, which were just visited; accounts are never
+        // deleted, so none is missing
+        data_->cold->for_each([&](const std::string& address, const Account& account) {
+            if (!data_->accounts.contains(address) && data_->trie.contains(address)) {
+                fn(address, account);
+            }
+        });
+    }
+}
+
 StateManager::StateManager() : impl_(std::make_unique<Impl>()) {
-    impl_->current_state_root = calculate_state_root(impl_->accounts);
+    impl_->index = std::make_unique<state::LockFreeStateManager>();
+    impl_->current_state_root = impl_->root_bytes();
+    impl_->previous_state_root = impl_->current_state_root;
+    impl_->committed.push_back(impl_->capture());
+}
+
+StateManager::StateManager(const Snapshot& snapshot) : impl_(std::make_unique<Impl>()) {
+    impl_->restore(snapshot);
+    impl_->version = snapshot.version();
+    impl_->current_state_root = impl_->root_bytes();
     impl_->previous_state_root = impl_->current_state_root;
+    impl_->committed.push_back(snapshot);
+}
+
+StateManager::StateManager(std::shared_ptr<StateStore> store) : StateManager() {
+    if (!store) {
+        throw std::invalid_argument("StateManager requires a state store");
+    }
+    auto head = store->load_head();
+    impl_->store = std::move(store);
+    if (!head) {
+        return;
+    }
+
+    // Only the leaf hashes are kept; accounts are read on demand. Hashed
+    // in chunks, which are independent, so memory stays bounded by the
+    // chunk rather than the state
+    constexpr size_t LOAD_CHUNK = 4096;
+    std::vector<std::pair<std::string, Account>> loaded;
+    std::vector<StateTrie::Hash> hashes;
+    auto hash_loaded = [&] {
+        hashes.resize(loaded.size());
+        utils::WorkStealingPool::global().parallel_for(0, loaded.size(), [&](size_t i) {
+            hashes[i] = account_hash(loaded[i].second);
+        }, utils::TaskPriority::Execution);
+        for (size_t i = 0; i < loaded.size(); ++i) {
+            impl_->trie.update(loaded[i].first, hashes[i]);
+        }
+        loaded.clear();
+    };
+    impl_->store->for_each_account([&](const std::string& address, Account account) {
+        loaded.emplace_back(address, std::move(account));
+        if (loaded.size() == LOAD_CHUNK) {
+            hash_loaded();
+        }
+    });
+    hash_loaded();
+    impl_->cold = std::make_shared<ColdAccounts>(impl_->store);
+    // The lock-free index would have to hold every account
+    impl_->index.reset();
+
+    if (impl_->root_bytes() != head->state_root) {
+        throw std::runtime_error("State store does not match its committed root");
+    }
+    impl_->version = head->version;
+    impl_->current_state_root = head->state_root;
+    impl_->previous_state_root = head->state_root;
+    impl_->committed.clear();
+    impl_->committed.push_back(impl_->capture());
 }
 
 StateManager::~StateManager() = default;
 
+StateTrie::Hash StateManager::account_hash(const Account& account) {
+    // Storage is hashed in key order; iteration order of the map does not
+    // leak into the root
+    std::vector<const std::pair<const std::vector<uint8_t>, std::vector<uint8_t>>*> slots;
+    slots.reserve(account.storage.size());
+    for (const auto& entry : account.storage) {
+        slots.push_back(&entry);
+    }
+    std::sort(slots.begin(), slots.end(),
+              [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    auto put_u64 = [&hasher](uint64_t v) {
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; ++i) bytes[i] = static_cast<uint8_t>(v >> (8 * i));
+        blake3_hasher_update(&hasher, bytes, sizeof(bytes));
+    };
+    auto put_bytes = [&](const uint8_t* data, size_t len) {
+        put_u64(len);
+        blake3_hasher_update(&hasher, data, len);
+    };
+
+    put_bytes(reinterpret_cast<const uint8_t*>(account.address.data()), account.address.size());
+    put_u64(account.balance);
+    put_u64(account.nonce);
+    put_bytes(account.code.bytes().data(), account.code.size());
+    put_u64(slots.size());
+    for (const auto* slot : slots) {
+        put_bytes(slot->first.data(), slot->first.size());
+        put_bytes(slot->second.data(), slot->second.size());
+    }
+
+    StateTrie::Hash out{};
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
 void StateManager::add_account(std::string address, Account account) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
-    impl_->accounts[std::move(address)] = std::move(account);
+    // Older versions still read the value this replaces
+    (void)impl_->lookup(address);
+    impl_->accounts.set(address, std::move(account));
+    impl_->touch(address);
+    impl_->publish_index();
 }
 
-bool StateManager::verify_transaction(const blockchain::Transaction& tx) const {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    
+bool StateManager::verify_transaction_locked(const blockchain::Transaction& tx) const {
     // Verify sender exists
-    auto sender = get_account(tx.getSender());
+    const Account* sender = impl_->find(tx.getSender());
     if (!sender) {
         return false;
     }
@@ -92,61 +480,213 @@ bool StateManager::verify_transaction(const blockchain::Transaction& tx) const {
     }
     
     // Verify signature
-    return tx.verify();
+    return tx.verified();
 }
 
-bool StateManager::apply_transactions(const std::vector<quids::blockchain::Transaction>& txs) {
-    std::shared_lock<std::shared_mutex> read_lock(mutex_);
-    
-    // Verify all transactions first
-    std::vector<bool> valid_txs(txs.size());
-    for (size_t i = 0; i < txs.size(); i++) {
-        valid_txs[i] = verify_transaction(txs[i]);
-    }
-    
-    // Release read lock before acquiring write lock
-    read_lock.unlock();
-    
+bool StateManager::verify_transaction(const blockchain::Transaction& tx) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return verify_transaction_locked(tx);
+}
+
+bool StateManager::apply_transactions(std::span<const blockchain::TransactionPtr> txs) {
+    // Signatures do not depend on state: check them in parallel before
+    // taking the lock, so the per-transaction checks below hit the memo
+    (void)crypto::BatchVerifier::global().verify_transactions(txs);
+
     std::unique_lock<std::shared_mutex> write_lock(mutex_);
     
     // Store current state root before modification
-    impl_->previous_state_root = impl_->current_state_root;
+    impl_->previous_state_root = impl_->root_bytes();
+
+    // Witness states note every access and may throw on one; keep those,
+    // and batches too small to split, on the serial path
+    if (txs.size() >= PARALLEL_APPLY_MIN_TXS && !impl_->witness && !impl_->coverage) {
+        const bool grouped = apply_grouped_locked(txs);
+        impl_->publish_index();
+        return grouped;
+    }
     
-    // Apply all valid transactions
+    // Apply all valid transactions; validity is checked against the state
+    // left by the previous ones
     bool success = true;
-    for (size_t i = 0; i < txs.size(); i++) {
-        if (valid_txs[i]) {
-            if (!apply_transaction(txs[i])) {
-                success = false;
-                break;
-            }
+    for (const auto& tx : txs) {
+        if (!verify_transaction_locked(*tx)) {
+            continue;
+        }
+        if (!apply_transaction_locked(*tx)) {
+            success = false;
+            break;
         }
     }
+    // One merge per shard for the whole block
+    impl_->publish_index();
     
     return success;
 }
 
-std::optional<StateManager::Account> StateManager::get_account(const std::string& address) const {
-    std::shared_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address);
-    if (it != impl_->accounts.end()) {
+bool StateManager::apply_grouped_locked(std::span<const blockchain::TransactionPtr> txs) {
+    // Accounts in first-seen order; transactions that share an account, as
+    // sender or recipient, end up in one group
+    std::unordered_map<std::string_view, uint32_t> slot_of;
+    std::vector<const std::string*> addresses;
+    std::vector<uint32_t> parent;
+    auto slot = [&](const std::string& address) {
+        auto [it, inserted] = slot_of.try_emplace(address, static_cast<uint32_t>(addresses.size()));
+        if (inserted) {
+            addresses.push_back(&address);
+            parent.push_back(it->second);
+        }
         return it->second;
+    };
+    auto root = [&](uint32_t a) {
+        while (parent[a] != a) {
+            a = parent[a] = parent[parent[a]];
+        }
+        return a;
+    };
+    std::vector<std::pair<uint32_t, uint32_t>> ends(txs.size());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        ends[i] = {slot(txs[i]->getSender()), slot(txs[i]->getRecipient())};
+        const uint32_t a = root(ends[i].first);
+        const uint32_t b = root(ends[i].second);
+        if (a != b) {
+            parent[std::max(a, b)] = std::min(a, b);
+        }
     }
-    return std::nullopt;
+
+    struct Group {
+        std::vector<uint32_t> txs;       // in block order
+        std::vector<uint32_t> accounts;
+    };
+    std::vector<Group> groups;
+    std::vector<uint32_t> group_of(addresses.size(), UINT32_MAX);
+    for (uint32_t a = 0; a < addresses.size(); ++a) {
+        const uint32_t r = root(a);
+        if (group_of[r] == UINT32_MAX) {
+            group_of[r] = static_cast<uint32_t>(groups.size());
+            groups.emplace_back();
+        }
+        group_of[a] = group_of[r];
+        groups[group_of[a]].accounts.push_back(a);
+    }
+    for (uint32_t i = 0; i < txs.size(); ++i) {
+        groups[group_of[ends[i].first]].txs.push_back(i);
+    }
+
+    // Each group runs the serial checks on its own copy of the balances and
+    // nonces it touches. No other field changes, and the maps are only read.
+    struct Balance {
+        bool exists{false};
+        uint64_t balance{0};
+        uint64_t nonce{0};
+    };
+    std::vector<Balance> balances(addresses.size());
+    std::vector<uint8_t> applied(txs.size(), 0);
+    constexpr uint32_t NONE = UINT32_MAX;
+    std::vector<uint32_t> failed(groups.size(), NONE);
+    auto run = [&](size_t g, uint32_t limit) {
+        const Group& group = groups[g];
+        for (uint32_t a : group.accounts) {
+            const Account* account = impl_->lookup(*addresses[a]);
+            balances[a] = account ? Balance{true, account->balance, account->nonce} : Balance{};
+        }
+        failed[g] = NONE;
+        for (uint32_t i : group.txs) {
+            applied[i] = 0;
+        }
+        for (uint32_t i : group.txs) {
+            if (i >= limit) {
+                break;
+            }
+            const auto& tx = *txs[i];
+            Balance& sender = balances[ends[i].first];
+            Balance& recipient = balances[ends[i].second];
+            const uint64_t total_cost = tx.getAmount() + tx.calculate_gas_cost();
+            if (!sender.exists || tx.getNonce() != sender.nonce + 1 || sender.balance < total_cost ||
+                !tx.verified()) {
+                continue;
+            }
+            if (!recipient.exists) {
+                // The serial loop stops the whole batch here
+                failed[g] = i;
+                break;
+            }
+            sender.balance -= total_cost;
+            recipient.balance += tx.getAmount();
+            sender.nonce++;
+            applied[i] = 1;
+        }
+    };
+
+    auto& pool = utils::WorkStealingPool::global();
+    pool.parallel_for(0, groups.size(), [&](size_t g) { run(g, NONE); }, utils::TaskPriority::Execution);
+    const uint32_t cutoff = *std::min_element(failed.begin(), failed.end());
+    if (cutoff != NONE) {
+        // Groups that ran past the first failure go again without the tail
+        for (size_t g = 0; g < groups.size(); ++g) {
+            if (!groups[g].txs.empty() && groups[g].txs.back() > cutoff) {
+                run(g, cutoff);
+            }
+        }
+    }
+
+    // Write back, then hash the changed leaves side by side
+    std::vector<uint32_t> changed;
+    for (uint32_t a = 0; a < addresses.size(); ++a) {
+        const Account* account = impl_->lookup(*addresses[a]);
+        if (account && (account->balance != balances[a].balance || account->nonce != balances[a].nonce)) {
+            Account* mutable_account = impl_->lookup_mutable(*addresses[a]);
+            mutable_account->balance = balances[a].balance;
+            mutable_account->nonce = balances[a].nonce;
+            changed.push_back(a);
+        }
+    }
+    std::vector<StateTrie::Hash> leaves(changed.size());
+    pool.parallel_for(0, changed.size(), [&](size_t c) {
+        leaves[c] = account_hash(*impl_->accounts.find(*addresses[changed[c]]));
+    }, utils::TaskPriority::Execution);
+    for (size_t c = 0; c < changed.size(); ++c) {
+        impl_->touch(*addresses[changed[c]], leaves[c]);
+    }
+
+    for (uint32_t i = 0; i < txs.size(); ++i) {
+        if (applied[i]) {
+            impl_->record(txs[i]->getSender(), *txs[i]);
+            impl_->record(txs[i]->getRecipient(), *txs[i]);
+        }
+    }
+    return cutoff == NONE;
+}
+
+bool StateManager::visit_account(const std::string& address, const std::function<void(const Account&)>& fn) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (const Account* account = impl_->find(address)) {
+        fn(*account);
+        return true;
+    }
+    return false;
 }
 
-std::vector<quids::blockchain::Transaction> StateManager::get_account_history(const std::string& address) const {
+std::optional<StateManager::Account> StateManager::get_account(const std::string& address) const {
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->history.find(address);
-    if (it != impl_->history.end()) {
-        return std::vector<quids::blockchain::Transaction>(it->second.begin(), it->second.end());
+    if (const Account* account = impl_->find(address)) {
+        return *account;
     }
-    return {};
+    return std::nullopt;
+}
+
+void StateManager::set_history_indexer(std::shared_ptr<HistoryIndexer> indexer) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    impl_->history_indexer = std::move(indexer);
+    impl_->pending_history.clear();
+    impl_->pending_position = 0;
 }
 
 std::vector<uint8_t> StateManager::get_state_root() const {
+    // Only the paths dirtied since the last call are rehashed
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    return impl_->current_state_root;
+    utils::PerfScope perf(utils::PerfStage::StateRoot);
+    return impl_->root_bytes();
 }
 
 std::vector<uint8_t> StateManager::get_previous_root() const {
@@ -154,25 +694,46 @@ std::vector<uint8_t> StateManager::get_previous_root() const {
     return impl_->previous_state_root;
 }
 
+StateTrie::Hash StateManager::root_after(
+    const std::vector<std::pair<std::string, StateTrie::Hash>>& leaves
+) const {
+    StateTrie trie;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (const auto& leaf : leaves) {
+            impl_->note(leaf.first);
+        }
+        trie = impl_->trie;
+    }
+    for (const auto& [address, hash] : leaves) {
+        trie.update(address, hash);
+    }
+    return trie.root();
+}
+
+std::optional<StateTrie::Proof> StateManager::prove_account(
+    const std::string& address,
+    std::vector<uint8_t>& root
+) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    impl_->note(address);
+    root = impl_->root_bytes();
+    return impl_->trie.prove(address);
+}
+
 void StateManager::record_transaction(const std::string& address, const quids::blockchain::Transaction& tx) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
-    auto& history = impl_->history[address];
-    history.push_back(tx);
-    
-    // Keep history size bounded
-    if (history.size() > Impl::MAX_HISTORY_PER_ACCOUNT) {
-        history.pop_front();
-    }
+    impl_->record(address, tx);
 }
 
-std::vector<uint8_t> StateManager::Account::serialize() const {
+std::vector<uint8_t> StateManager::Account::serialize(bool code_by_hash) const {
     std::vector<uint8_t> result;
     
     // Calculate total size needed
     size_t total_size = address.size() + sizeof(balance) + sizeof(nonce) + sizeof(size_t);
     
     // Add size for code
-    total_size += code.size() + sizeof(size_t);
+    total_size += (code_by_hash ? sizeof(evm::Hash256) : code.size()) + sizeof(size_t);
     
     // Add size for storage
     for (const auto& [key, value] : storage) {
@@ -196,12 +757,17 @@ std::vector<uint8_t> StateManager::Account::serialize() const {
                  reinterpret_cast<const uint8_t*>(&nonce),
                  reinterpret_cast<const uint8_t*>(&nonce) + sizeof(nonce));
     
-    // Serialize code
-    size_t code_size = code.size();
+    // Serialize code; a size of CODE_BY_HASH is followed by the hash instead
+    size_t code_size = code_by_hash && !code.empty() ? CODE_BY_HASH : code.size();
     result.insert(result.end(),
                  reinterpret_cast<const uint8_t*>(&code_size),
                  reinterpret_cast<const uint8_t*>(&code_size) + sizeof(size_t));
-    result.insert(result.end(), code.begin(), code.end());
+    if (code_size == CODE_BY_HASH) {
+        const evm::Hash256 code_hash = code.hash();
+        result.insert(result.end(), code_hash.begin(), code_hash.end());
+    } else {
+        result.insert(result.end(), code.bytes().begin(), code.bytes().end());
+    }
     
     // Serialize storage
     size_t storage_size = storage.size();
@@ -227,7 +793,8 @@ std::vector<uint8_t> StateManager::Account::serialize() const {
     return result;
 }
 
-std::optional<StateManager::Account> StateManager::Account::deserialize(const std::vector<uint8_t>& data) {
+std::optional<StateManager::Account> StateManager::Account::deserialize(const std::vector<uint8_t>& data,
+                                                                      const CodeLoader& load_code) {
     if (data.size() < sizeof(size_t)) {
         return std::nullopt;
     }
@@ -263,11 +830,27 @@ std::optional<StateManager::Account> StateManager::Account::deserialize(const st
     std::memcpy(&code_size, data.data() + offset, sizeof(size_t));
     offset += sizeof(size_t);
     
-    if (offset + code_size > data.size()) {
-        return std::nullopt;
+    if (code_size == CODE_BY_HASH) {
+        if (offset + sizeof(evm::Hash256) > data.size()) {
+            return std::nullopt;
+        }
+        evm::Hash256 code_hash;
+        std::memcpy(code_hash.data(), data.data() + offset, code_hash.size());
+        offset += code_hash.size();
+        if (auto entry = evm::CodeStore::global().find(code_hash)) {
+            account.code = evm::CodeRef(std::move(entry));
+        } else if (auto bytes = load_code ? load_code(code_hash) : std::nullopt) {
+            account.code = evm::CodeRef(evm::CodeStore::global().intern(code_hash, std::move(*bytes)));
+        } else {
+            return std::nullopt;
+        }
+    } else {
+        if (offset + code_size > data.size()) {
+            return std::nullopt;
+        }
+        account.code = std::vector<uint8_t>(data.begin() + offset, data.begin() + offset + code_size);
+        offset += code_size;
     }
-    account.code = std::vector<uint8_t>(data.begin() + offset, data.begin() + offset + code_size);
-    offset += code_size;
     
     // Deserialize storage
     if (offset + sizeof(size_t) > data.size()) {
@@ -311,15 +894,53 @@ std::optional<StateManager::Account> StateManager::Account::deserialize(const st
 }
 
 std::map<std::string, StateManager::Account> StateManager::get_accounts_snapshot() const {
+    // Copy out of a snapshot so writers are only blocked for the O(1) capture
+    Snapshot view = snapshot();
+    std::map<std::string, Account> accounts;
+    view.for_each_account([&accounts](const std::string& address, const Account& account) {
+        accounts.emplace(address, account);
+    });
+    return accounts;
+}
+
+StateManager::Snapshot StateManager::snapshot() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return impl_->capture();
+}
+
+std::optional<StateManager::Snapshot> StateManager::at(uint64_t version) const {
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    return std::map<std::string, Account>(impl_->accounts.begin(), impl_->accounts.end());
+    for (const auto& snapshot : impl_->committed) {
+        if (snapshot.version() == version) {
+            return snapshot;
+        }
+    }
+    return std::nullopt;
+}
+
+void StateManager::set_retained_versions(size_t versions) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    impl_->max_retained_versions = std::max<size_t>(1, versions);
+    while (impl_->committed.size() > impl_->max_retained_versions) {
+        impl_->committed.pop_front();
+    }
+}
+
+uint64_t StateManager::version() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return impl_->version;
 }
 
 bool StateManager::apply_transaction(const blockchain::Transaction& tx) {
     std::unique_lock<std::shared_mutex> write_lock(mutex_);
-    
-    auto sender = get_account(tx.getSender());
-    auto recipient = get_account(tx.getRecipient());
+    const bool applied = apply_transaction_locked(tx);
+    impl_->publish_index();
+    return applied;
+}
+
+bool StateManager::apply_transaction_locked(const blockchain::Transaction& tx) {
+    Account* sender = impl_->find_mutable(tx.getSender());
+    Account* recipient = impl_->find_mutable(tx.getRecipient());
     
     if (!sender || !recipient) {
         return false;
@@ -339,7 +960,7 @@ bool StateManager::apply_transaction(const blockchain::Transaction& tx) {
     }
 
     // Verify signature
-    if (!tx.verify()) {
+    if (!tx.verified()) {
         return false;
     }
 
@@ -348,13 +969,13 @@ bool StateManager::apply_transaction(const blockchain::Transaction& tx) {
     recipient->balance += tx.getAmount();
     sender->nonce++;
 
-    // Update accounts
-    impl_->accounts[sender->address] = *sender;
-    impl_->accounts[recipient->address] = *recipient;
+    // Only these two paths of the trie become dirty
+    impl_->touch(tx.getSender());
+    impl_->touch(tx.getRecipient());
 
     // Record transaction
-    record_transaction(sender->address, tx);
-    record_transaction(recipient->address, tx);
+    impl_->record(tx.getSender(), tx);
+    impl_->record(tx.getRecipient(), tx);
 
     return true;
 }
@@ -362,8 +983,8 @@ bool StateManager::apply_transaction(const blockchain::Transaction& tx) {
 bool StateManager::revert_transaction(const blockchain::Transaction& tx) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
     
-    auto sender = get_account(tx.getSender());
-    auto recipient = get_account(tx.getRecipient());
+    Account* sender = impl_->find_mutable(tx.getSender());
+    Account* recipient = impl_->find_mutable(tx.getRecipient());
     
     if (!sender || !recipient) {
         return false;
@@ -374,9 +995,9 @@ bool StateManager::revert_transaction(const blockchain::Transaction& tx) {
     recipient->balance -= tx.getAmount();
     sender->nonce--;
     
-    // Update accounts
-    impl_->accounts[sender->address] = *sender;
-    impl_->accounts[recipient->address] = *recipient;
+    impl_->touch(tx.getSender());
+    impl_->touch(tx.getRecipient());
+    impl_->publish_index();
     
     return true;
 }
@@ -384,40 +1005,78 @@ bool StateManager::revert_transaction(const blockchain::Transaction& tx) {
 bool StateManager::commit_state() {
     std::unique_lock<std::shared_mutex> lock(mutex_);
     impl_->previous_state_root = impl_->current_state_root;
-    impl_->current_state_root = calculate_state_root(impl_->accounts);
+    impl_->current_state_root = impl_->root_bytes();
+
+    impl_->version++;
+    impl_->committed.push_back(impl_->capture());
+    impl_->index_uncommitted.clear();
+    if (impl_->committed.size() > impl_->max_retained_versions) {
+        impl_->committed.pop_front();
+    }
+
+    if (impl_->store) {
+        // Write-behind: the store flushes these in the background
+        std::vector<StateStore::Change> changes;
+        changes.reserve(impl_->dirty.size());
+        for (const auto& address : impl_->dirty) {
+            const Account* account = impl_->find(address);
+            changes.emplace_back(address, account ? std::optional<Account>(*account) : std::nullopt);
+        }
+        impl_->dirty.clear();
+        impl_->store->commit(impl_->version, impl_->current_state_root, std::move(changes));
+    }
+    if (impl_->history_indexer && !impl_->pending_history.empty()) {
+        // Queued and written in the background
+        impl_->history_indexer->enqueue(std::move(impl_->pending_history));
+        impl_->pending_history.clear();
+        impl_->pending_position = 0;
+    }
     return true;
 }
 
 bool StateManager::rollback_state() {
+    // Drop everything applied since the last commit
     std::unique_lock<std::shared_mutex> lock(mutex_);
-    impl_->current_state_root = impl_->previous_state_root;
+    impl_->restore(impl_->committed.back());
+    impl_->current_state_root = impl_->root_bytes();
+    impl_->index_pending.swap(impl_->index_uncommitted);
+    impl_->publish_index();
+    impl_->index_uncommitted.clear();
+    impl_->dirty.clear();
+    impl_->pending_history.clear();
+    impl_->pending_position = 0;
     return true;
 }
 
 uint64_t StateManager::get_balance(const std::string& address) const {
+    if (impl_->lock_free_reads()) {
+        const auto state = impl_->index->read(address);
+        return state ? state->balance : 0;
+    }
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address);
-    if (it != impl_->accounts.end()) {
-        return it->second.balance;
+    if (const Account* account = impl_->find(address)) {
+        return account->balance;
     }
     return 0;
 }
 
 uint64_t StateManager::get_nonce(const std::string& address) const {
+    if (impl_->lock_free_reads()) {
+        const auto state = impl_->index->read(address);
+        return state ? state->nonce : 0;
+    }
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address);
-    if (it != impl_->accounts.end()) {
-        return it->second.nonce;
+    if (const Account* account = impl_->find(address)) {
+        return account->nonce;
     }
     return 0;
 }
 
 std::vector<uint8_t> StateManager::get_storage(const ::evm::Address& address, const std::vector<uint8_t>& key) const {
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address_to_hex(address));
-    if (it != impl_->accounts.end()) {
-        auto storage_it = it->second.storage.find(key);
-        if (storage_it != it->second.storage.end()) {
+    if (const Account* account = impl_->find(address.to_hex())) {
+        auto storage_it = account->storage.find(key);
+        if (storage_it != account->storage.end()) {
             return storage_it->second;
         }
     }
@@ -426,18 +1085,18 @@ std::vector<uint8_t> StateManager::get_storage(const ::evm::Address& address, co
 
 std::vector<uint8_t> StateManager::get_code(const ::evm::Address& address) const {
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address_to_hex(address));
-    if (it != impl_->accounts.end()) {
-        return it->second.code;
+    if (const Account* account = impl_->find(address.to_hex())) {
+        return account->code.bytes();
     }
     return std::vector<uint8_t>();
 }
 
 bool StateManager::set_balance(const std::string& address, uint64_t balance) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address);
-    if (it != impl_->accounts.end()) {
-        it->second.balance = balance;
+    if (Account* account = impl_->find_mutable(address)) {
+        account->balance = balance;
+        impl_->touch(address);
+        impl_->publish_index();
         return true;
     }
     return false;
@@ -445,9 +1104,10 @@ bool StateManager::set_balance(const std::string& address, uint64_t balance) {
 
 bool StateManager::set_nonce(const std::string& address, uint64_t nonce) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address);
-    if (it != impl_->accounts.end()) {
-        it->second.nonce = nonce;
+    if (Account* account = impl_->find_mutable(address)) {
+        account->nonce = nonce;
+        impl_->touch(address);
+        impl_->publish_index();
         return true;
     }
     return false;
@@ -455,9 +1115,11 @@ bool StateManager::set_nonce(const std::string& address, uint64_t nonce) {
 
 bool StateManager::set_storage(const ::evm::Address& address, const std::vector<uint8_t>& key, const std::vector<uint8_t>& value) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address_to_hex(address));
-    if (it != impl_->accounts.end()) {
-        it->second.storage[key] = value;
+    const std::string hex = address.to_hex();
+    if (Account* account = impl_->find_mutable(hex)) {
+        account->storage[key] = value;
+        impl_->touch(hex);
+        impl_->publish_index();
         return true;
     }
     return false;
@@ -465,26 +1127,95 @@ bool StateManager::set_storage(const ::evm::Address& address, const std::vector<
 
 bool StateManager::set_code(const ::evm::Address& address, const std::vector<uint8_t>& code) {
     std::unique_lock<std::shared_mutex> lock(mutex_);
-    auto it = impl_->accounts.find(address_to_hex(address));
-    if (it != impl_->accounts.end()) {
-        it->second.code = code;
+    const std::string hex = address.to_hex();
+    if (Account* account = impl_->find_mutable(hex)) {
+        account->code = code;
+        impl_->touch(hex);
+        impl_->publish_index();
         return true;
     }
     return false;
 }
 
 std::unique_ptr<StateManager> StateManager::clone() const {
-    // Create a new StateManager and copy internal data.
-    auto new_state = std::make_unique<StateManager>();
+    // Shares every node with this state; both sides copy on write. The
+    // clone does not feed the history indexer.
+    auto new_state = std::make_unique<StateManager>(snapshot());
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    new_state->impl_->current_state_root = impl_->current_state_root;
+    new_state->impl_->previous_state_root = impl_->previous_state_root;
+    new_state->impl_->witness = impl_->witness;
+    new_state->impl_->coverage = impl_->coverage;
+    return new_state;
+}
+
+void StateManager::begin_witness() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto log = std::make_shared<Impl::WitnessLog>();
+    log->pre = impl_->capture();
+    impl_->witness = std::move(log);
+    impl_->noting.store(true, std::memory_order_release);
+}
+
+StateWitness StateManager::take_witness() {
+    std::shared_ptr<Impl::WitnessLog> log;
     {
-        // Acquire lock if needed (assuming 'mutex_' exists).
-        std::shared_lock<std::shared_mutex> lock(mutex_);
-        new_state->impl_->accounts = impl_->accounts;
-        new_state->impl_->current_state_root = impl_->current_state_root;
-        new_state->impl_->previous_state_root = impl_->previous_state_root;
-        new_state->impl_->history = impl_->history;
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        log = std::move(impl_->witness);
+        impl_->noting.store(false, std::memory_order_release);
     }
-    return new_state;
+    if (!log) {
+        throw std::logic_error("take_witness() without begin_witness()");
+    }
+
+    // Clones may still hold the log; stop taking their notes here
+    std::vector<std::string> addresses;
+    {
+        std::lock_guard<std::mutex> lock(log->mutex);
+        addresses.assign(log->addresses.begin(), log->addresses.end());
+    }
+
+    const auto& pre = *log->pre.data_;
+    StateWitness witness;
+    witness.pre_root = pre.trie.root();
+    witness.entries.reserve(addresses.size());
+    for (const auto& address : addresses) {
+        StateWitness::Entry entry;
+        entry.address = address;
+        if (const Account* account = pre.find(address)) {
+            entry.account = *account;
+            entry.proof = *pre.trie.prove(address);
+        } else {
+            entry.absence = *pre.trie.prove_absent(address);
+        }
+        witness.entries.push_back(std::move(entry));
+    }
+    return witness;
+}
+
+std::unique_ptr<StateManager> StateManager::from_witness(const StateWitness& witness) {
+    auto data = std::make_shared<Snapshot::Data>();
+    auto coverage = std::make_shared<std::unordered_set<std::string>>();
+    for (const auto& entry : witness.entries) {
+        bool fits = entry.account
+            ? data->trie.graft(entry.address, account_hash(*entry.account), entry.proof)
+            : data->trie.graft_absent(entry.address, entry.absence);
+        if (!fits) {
+            return nullptr;
+        }
+        if (entry.account) {
+            data->accounts.set(entry.address, *entry.account);
+        }
+        coverage->insert(entry.address);
+    }
+    // One root check authenticates every grafted node at once
+    if (data->trie.root() != witness.pre_root) {
+        return nullptr;
+    }
+
+    auto state = std::make_unique<StateManager>(Snapshot(std::move(data)));
+    state->impl_->coverage = std::move(coverage);
+    return state;
 }
 
 } // namespace rollup
@@ -0,0 +1,125 @@
+#include "rollup/StatePruner.hpp"
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+StatePruner::StatePruner(std::shared_ptr<storage::PersistentStorage> storage, std::shared_ptr<StateManager> state,
+                         const Config& config)
+    : storage_(std::move(storage)), config_(config) {
+    if (!storage_) {
+        throw std::invalid_argument("StatePruner requires a storage backend");
+    }
+    if ((config.mode == Mode::Full && config.depth == 0) || config.blocks_per_step == 0 ||
+        config.addresses_per_step == 0) {
+        throw std::invalid_argument("invalid pruning configuration");
+    }
+    if (state) {
+        state->set_retained_versions(config.retained_versions);
+    }
+    worker_ = std::thread([this] { worker_loop(); });
+}
+
+StatePruner::StatePruner(std::shared_ptr<storage::PersistentStorage> storage, std::shared_ptr<StateManager> state)
+    : StatePruner(std::move(storage), std::move(state), Config{}) {}
+
+StatePruner::~StatePruner() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    idle_cv_.notify_all();
+    worker_.join();
+}
+
+void StatePruner::on_head(uint64_t head) {
+    if (config_.mode == Mode::Archive || head < config_.depth) {
+        return;
+    }
+    const uint64_t target = head + 1 - config_.depth;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (target <= target_) {
+            return;
+        }
+        target_ = target;
+        idle_ = false;
+    }
+    work_cv_.notify_one();
+}
+
+void StatePruner::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return idle_ || stop_; });
+}
+
+StatePruner::Stats StatePruner::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool StatePruner::step(uint64_t target) {
+    uint64_t pruned_below;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pruned_below = stats_.pruned_below;
+    }
+
+    if (pruned_below < target) {
+        const size_t pruned = storage_->pruneBlocks(target, config_.blocks_per_step);
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.pruned_blocks += pruned;
+        // A short step means nothing below the target is left
+        if (pruned < config_.blocks_per_step) {
+            stats_.pruned_below = target;
+        }
+        return true;
+    }
+
+    if (!sweep_cursor_ && swept_below_ < target) {
+        sweep_cursor_ = std::string();
+        sweep_target_ = target;
+    }
+    if (!sweep_cursor_) {
+        return false;
+    }
+    sweep_cursor_ = storage_->pruneAccountHistory(sweep_target_, *sweep_cursor_, config_.addresses_per_step);
+    if (!sweep_cursor_) {
+        swept_below_ = sweep_target_;
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.history_sweeps++;
+    }
+    return true;
+}
+
+void StatePruner::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this] { return stop_ || !idle_; });
+        if (stop_) {
+            break;
+        }
+        const uint64_t target = target_;
+        lock.unlock();
+        const bool worked = step(target);
+        lock.lock();
+
+        if (!worked) {
+            // A newer head may have come in while stepping
+            if (target_ == target) {
+                idle_ = true;
+                idle_cv_.notify_all();
+            }
+            continue;
+        }
+        stats_.steps++;
+        // The rate limit: one bounded step per interval
+        work_cv_.wait_for(lock, config_.step_interval, [this] { return stop_; });
+    }
+    idle_ = true;
+    idle_cv_.notify_all();
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,666 @@
+#include "rollup/StateStore.hpp"
+#include "memory/MemoryBudget.hpp"
+#include "rollup/StateTrie.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+const std::string ACCOUNT_PREFIX = "acct/";
+// Contract code by hash, written once however many accounts share it
+const std::string CODE_PREFIX = "code/";
+const std::string HEAD_KEY = "head";
+
+constexpr auto RETRY_DELAY = std::chrono::milliseconds(100);
+
+std::vector<uint8_t> encode_head(const StateStore::Head& head) {
+    std::vector<uint8_t> out(sizeof(uint64_t));
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        out[i] = static_cast<uint8_t>(head.version >> (8 * i));
+    }
+    out.insert(out.end(), head.state_root.begin(), head.state_root.end());
+    return out;
+}
+
+const std::string MANIFEST_FILE = "MANIFEST";
+const std::string MANIFEST_MAGIC = "qsnap1";
+
+void put_le(std::vector<uint8_t>& out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// Bounds-checked little-endian reader over the manifest bytes
+struct ManifestReader {
+    const std::vector<uint8_t>& data;
+    size_t pos{0};
+
+    bool get(uint64_t& value, size_t width) {
+        if (data.size() - pos < width) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < width; ++i) {
+            value |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+        }
+        return true;
+    }
+
+    bool bytes(std::string& out, size_t size) {
+        if (data.size() - pos < size) {
+            return false;
+        }
+        out.assign(data.begin() + pos, data.begin() + pos + size);
+        pos += size;
+        return true;
+    }
+};
+
+std::string code_key(const evm::Hash256& code_hash) {
+    return CODE_PREFIX + std::string(code_hash.begin(), code_hash.end());
+}
+
+std::string chunk_name(size_t index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "chunk-%06zu.sst", index);
+    return name;
+}
+
+} // namespace
+
+// Second-chance cache; absent accounts are cached too, as nullopt.
+// Guarded by StateStore::mutex_.
+// Entries are charged to memory::Subsystem::StateCache. While that budget
+// is exceeded the cache stops growing and sheds entries down to it, so a
+// budget below cache_capacity accounts is what bounds it.
+class StateStore::ClockCache {
+public:
+    explicit ClockCache(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {
+        slots_.reserve(std::min<size_t>(capacity_, 1 << 16));
+    }
+
+    ~ClockCache() {
+        memory::MemoryAccountant::global().release(memory::Subsystem::StateCache, bytes_);
+    }
+
+    const std::optional<Account>* find(const std::string& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return nullptr;
+        }
+        Slot& slot = slots_[it->second];
+        slot.referenced = true;
+        return &slot.value;
+    }
+
+    // Returns how many other entries had to make room
+    size_t put(const std::string& key, std::optional<Account> value) {
+        auto& accountant = memory::MemoryAccountant::global();
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            Slot& slot = slots_[it->second];
+            fill(slot, key, std::move(value));
+            return shed(it->second);
+        }
+
+        size_t evicted = 0;
+        size_t index;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else if (index_.empty() ||
+                   (slots_.size() < capacity_ && !accountant.over_budget(memory::Subsystem::StateCache))) {
+            index = slots_.size();
+            slots_.emplace_back();
+        } else {
+            index = sweep();
+            index_.erase(slots_[index].key);
+            ++evicted;
+        }
+        fill(slots_[index], key, std::move(value));
+        index_.emplace(key, index);
+        return evicted + shed(index);
+    }
+
+private:
+    struct Slot {
+        std::string key;
+        std::optional<Account> value;
+        bool referenced{false};
+        bool used{false};
+        size_t bytes{0};
+    };
+
+    static size_t entry_bytes(const std::string& key, const std::optional<Account>& value) {
+        constexpr size_t INDEX_NODE = sizeof(std::string) + sizeof(size_t) + 2 * sizeof(void*);
+        size_t bytes = sizeof(Slot) + INDEX_NODE + 2 * key.size();
+        if (value) {
+            bytes += value->address.size() + value->code.size();
+            for (const auto& [slot_key, slot_value] : value->storage) {
+                bytes += slot_key.size() + slot_value.size() + 2 * sizeof(std::vector<uint8_t>);
+            }
+        }
+        return bytes;
+    }
+
+    void fill(Slot& slot, const std::string& key, std::optional<Account> value) {
+        auto& accountant = memory::MemoryAccountant::global();
+        const size_t bytes = entry_bytes(key, value);
+        accountant.release(memory::Subsystem::StateCache, slot.bytes);
+        accountant.charge(memory::Subsystem::StateCache, bytes);
+        bytes_ = bytes_ - slot.bytes + bytes;
+        slot = Slot{key, std::move(value), true, true, bytes};
+    }
+
+    // Clears reference bits until an entry not used since the last sweep
+    // comes under the hand
+    size_t sweep() {
+        while (!slots_[hand_].used || slots_[hand_].referenced) {
+            slots_[hand_].referenced = false;
+            hand_ = (hand_ + 1) % slots_.size();
+        }
+        const size_t victim = hand_;
+        hand_ = (hand_ + 1) % slots_.size();
+        return victim;
+    }
+
+    // Drops entries while the subsystem is over budget, keeping at least
+    // the one just written
+    size_t shed(size_t keep) {
+        auto& accountant = memory::MemoryAccountant::global();
+        size_t evicted = 0;
+        while (accountant.over_budget(memory::Subsystem::StateCache) && index_.size() > 1) {
+            const size_t victim = sweep();
+            Slot& slot = slots_[victim];
+            if (victim == keep) {
+                slot.referenced = true;
+                continue;
+            }
+            index_.erase(slot.key);
+            accountant.release(memory::Subsystem::StateCache, slot.bytes);
+            bytes_ -= slot.bytes;
+            slot = Slot{};
+            free_.push_back(victim);
+            ++evicted;
+        }
+        return evicted;
+    }
+
+    size_t capacity_;
+    size_t hand_{0};
+    size_t bytes_{0};
+    std::vector<Slot> slots_;
+    std::vector<size_t> free_;  // slots emptied by shed()
+    std::unordered_map<std::string, size_t> index_;
+};
+
+StateStore::StateStore(std::shared_ptr<storage::PersistentStorage> storage, const Config& config)
+    : storage_(std::move(storage)),
+      config_(config),
+      cache_(std::make_unique<ClockCache>(config.cache_capacity)) {
+    if (!storage_) {
+        throw std::invalid_argument("StateStore requires a storage backend");
+    }
+    if (auto head = load_head()) {
+        committed_version_ = durable_version_ = head->version;
+    }
+    if (config_.async_flush) {
+        flusher_ = std::thread([this] { flusher_loop(); });
+    }
+}
+
+StateStore::StateStore(std::shared_ptr<storage::PersistentStorage> storage)
+    : StateStore(std::move(storage), Config{}) {}
+
+StateStore::~StateStore() {
+    if (flusher_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_cv_.notify_all();
+        flusher_.join();
+    } else {
+        flush();
+    }
+}
+
+std::optional<StateStore::Account> StateStore::get(const std::string& address) {
+    while (true) {
+        uint64_t seq_before;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (const auto* cached = cache_->find(address)) {
+                stats_.cache_hits++;
+                return *cached;
+            }
+            auto pending = unflushed_.find(address);
+            if (pending != unflushed_.end()) {
+                return pending->second.value;
+            }
+            stats_.cache_misses++;
+            seq_before = next_seq_;
+        }
+
+        // Disk read without the lock
+        std::optional<Account> account;
+        if (auto data = storage_->loadState(ACCOUNT_PREFIX + address)) {
+            account = Account::deserialize(*data, code_loader());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (next_seq_ != seq_before) {
+            // A commit raced with the read and may have been flushed and
+            // evicted already; what we read could be stale
+            continue;
+        }
+        stats_.evictions += cache_->put(address, account);
+        return account;
+    }
+}
+
+void StateStore::commit(uint64_t version, std::vector<uint8_t> state_root, std::vector<Change> changes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t seq = next_seq_++;
+    for (const auto& [address, value] : changes) {
+        stats_.evictions += cache_->put(address, value);
+        unflushed_[address] = Pending{seq, value};
+    }
+    queue_.push_back(Batch{seq, Head{version, std::move(state_root)}, std::move(changes)});
+    committed_version_ = version;
+
+    if (!config_.async_flush) {
+        lock.unlock();
+        flush();
+        return;
+    }
+    const uint64_t max_lag = config_.max_lag_versions;
+    if (max_lag > 0 && committed_version_ - durable_version_ > max_lag) {
+        // Too much would be lost in a crash: write now and hold the
+        // committer until the disk catches up
+        stats_.lag_stalls++;
+        urgent_ = true;
+        work_cv_.notify_one();
+        done_cv_.wait(lock, [&] { return stop_ || committed_version_ - durable_version_ <= max_lag; });
+        return;
+    }
+    lock.unlock();
+    work_cv_.notify_one();
+}
+
+bool StateStore::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t target = next_seq_ - 1;
+
+    if (config_.async_flush) {
+        const uint64_t failures = stats_.failed_flushes;
+        urgent_ = true;
+        work_cv_.notify_one();
+        done_cv_.wait(lock, [&] {
+            return flushed_seq_ >= target || stats_.failed_flushes != failures;
+        });
+        return flushed_seq_ >= target;
+    }
+
+    // Inline mode: writers take turns so batches reach disk in order
+    while (flushed_seq_ < target) {
+        done_cv_.wait(lock, [this] { return !writing_; });
+        if (flushed_seq_ >= target || queue_.empty()) {
+            break;
+        }
+        std::deque<Batch> batches;
+        batches.swap(queue_);
+        writing_ = true;
+        lock.unlock();
+        bool ok = write_batches(batches);
+        lock.lock();
+        writing_ = false;
+        done_cv_.notify_all();
+        if (!ok) {
+            for (auto it = batches.rbegin(); it != batches.rend(); ++it) {
+                queue_.push_front(std::move(*it));
+            }
+            return false;
+        }
+    }
+    return flushed_seq_ >= target;
+}
+
+void StateStore::flusher_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break;
+        }
+        if (config_.checkpoint_interval.count() > 0) {
+            // Let commits pile up until the interval is out
+            work_cv_.wait_until(lock, last_write_ + config_.checkpoint_interval,
+                                [this] { return stop_ || urgent_; });
+        }
+        urgent_ = false;
+
+        // Everything queued so far goes into one WriteBatch
+        std::deque<Batch> batches;
+        batches.swap(queue_);
+        writing_ = true;
+        lock.unlock();
+        bool ok = write_batches(batches);
+        lock.lock();
+        writing_ = false;
+        last_write_ = std::chrono::steady_clock::now();
+
+        if (!ok) {
+            for (auto it = batches.rbegin(); it != batches.rend(); ++it) {
+                queue_.push_front(std::move(*it));
+            }
+            done_cv_.notify_all();
+            if (stop_) {
+                break;
+            }
+            work_cv_.wait_for(lock, RETRY_DELAY, [this] { return stop_; });
+            urgent_ = true;  // the retry does not wait out another interval
+            continue;
+        }
+        done_cv_.notify_all();
+    }
+}
+
+bool StateStore::write_batches(std::deque<Batch>& batches) {
+    if (batches.empty()) {
+        return true;
+    }
+
+    // Only the last write per account survives the coalescing
+    std::vector<storage::PersistentStorage::StateWrite> writes;
+    std::unordered_map<std::string, size_t> slot_of;
+    std::vector<std::string> new_code;
+    for (const auto& batch : batches) {
+        for (const auto& [address, value] : batch.changes) {
+            std::optional<std::vector<uint8_t>> bytes;
+            if (value) {
+                // Accounts refer to their code, which goes in the same batch
+                // the first time it is seen
+                if (!value->code.empty()) {
+                    std::string key = code_key(value->code.hash());
+                    if (stored_code_.count(key) == 0 &&
+                        std::find(new_code.begin(), new_code.end(), key) == new_code.end()) {
+                        writes.push_back({key, value->code.bytes()});
+                        new_code.push_back(std::move(key));
+                    }
+                }
+                bytes = value->serialize(true);
+            }
+            auto [it, inserted] = slot_of.emplace(address, writes.size());
+            if (inserted) {
+                writes.push_back({ACCOUNT_PREFIX + address, std::move(bytes)});
+            } else {
+                writes[it->second].value = std::move(bytes);
+            }
+        }
+    }
+    writes.push_back({HEAD_KEY, encode_head(batches.back().head)});
+
+    const bool ok = storage_->storeStateBatch(writes, config_.sync_writes);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok) {
+        stats_.failed_flushes++;
+        return false;
+    }
+    const uint64_t last = batches.back().seq;
+    flushed_seq_ = last;
+    durable_version_ = batches.back().head.version;
+    stats_.flushed_batches++;
+    stats_.flushed_accounts += writes.size() - 1 - new_code.size();
+    stored_code_.insert(std::make_move_iterator(new_code.begin()), std::make_move_iterator(new_code.end()));
+    for (const auto& batch : batches) {
+        for (const auto& change : batch.changes) {
+            auto it = unflushed_.find(change.first);
+            if (it != unflushed_.end() && it->second.seq <= last) {
+                unflushed_.erase(it);
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t StateStore::committed_version() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return committed_version_;
+}
+
+uint64_t StateStore::durable_version() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return durable_version_;
+}
+
+std::optional<StateStore::Head> StateStore::load_head() {
+    auto data = storage_->loadState(HEAD_KEY);
+    if (!data || data->size() < sizeof(uint64_t)) {
+        return std::nullopt;
+    }
+    Head head;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        head.version |= static_cast<uint64_t>((*data)[i]) << (8 * i);
+    }
+    head.state_root.assign(data->begin() + sizeof(uint64_t), data->end());
+    return head;
+}
+
+void StateStore::for_each_account(const std::function<void(const std::string&, Account)>& fn) {
+    const auto load_code = code_loader();
+    storage_->scanState(ACCOUNT_PREFIX, [&](const std::string& key, const std::vector<uint8_t>& data) {
+        if (auto account = Account::deserialize(data, load_code)) {
+            fn(key.substr(ACCOUNT_PREFIX.size()), std::move(*account));
+        }
+        return true;
+    });
+}
+
+StateStore::Account::CodeLoader StateStore::code_loader() const {
+    return [storage = storage_](const evm::Hash256& code_hash) { return storage->loadState(code_key(code_hash)); };
+}
+
+StateStore::Stats StateStore::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::optional<StateStore::SnapshotManifest> StateStore::export_snapshot(const StateManager::Snapshot& snapshot,
+                                                                        const std::string& dir,
+                                                                        size_t accounts_per_chunk) {
+    if (accounts_per_chunk == 0) {
+        throw std::invalid_argument("accounts_per_chunk must be positive");
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+
+    // The snapshot's nodes outlive the export, so pointers into it are enough
+    std::vector<std::pair<const std::string*, const Account*>> accounts;
+    snapshot.for_each_account([&accounts](const std::string& address, const Account& account) {
+        accounts.emplace_back(&address, &account);
+    });
+    std::sort(accounts.begin(), accounts.end(),
+              [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+    SnapshotManifest manifest;
+    manifest.head.version = snapshot.version();
+    manifest.head.state_root = snapshot.get_state_root();
+    const size_t chunks = (accounts.size() + accounts_per_chunk - 1) / accounts_per_chunk;
+    manifest.chunks.resize(chunks);
+
+    // One writer per chunk; each holds only its own serialized accounts
+    std::atomic<bool> ok{true};
+    utils::WorkStealingPool::global().parallel_for(0, chunks, [&](size_t c) {
+        const size_t begin = c * accounts_per_chunk;
+        const size_t end = std::min(accounts.size(), begin + accounts_per_chunk);
+        std::vector<storage::PersistentStorage::StateEntry> entries;
+        entries.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            entries.emplace_back(ACCOUNT_PREFIX + *accounts[i].first, accounts[i].second->serialize());
+        }
+        manifest.chunks[c] = {chunk_name(c), end - begin};
+        const auto path = (std::filesystem::path(dir) / manifest.chunks[c].file).string();
+        if (!storage::PersistentStorage::writeStateFile(path, entries)) {
+            ok = false;
+        }
+    }, utils::TaskPriority::Execution, 1);
+    if (!ok) {
+        return std::nullopt;
+    }
+
+    // Written last, so a directory with a manifest always has its chunks
+    std::vector<uint8_t> out(MANIFEST_MAGIC.begin(), MANIFEST_MAGIC.end());
+    const auto head = encode_head(manifest.head);
+    put_le(out, head.size(), 4);
+    out.insert(out.end(), head.begin(), head.end());
+    put_le(out, manifest.chunks.size(), 4);
+    for (const auto& chunk : manifest.chunks) {
+        put_le(out, chunk.accounts, 8);
+        put_le(out, chunk.file.size(), 2);
+        out.insert(out.end(), chunk.file.begin(), chunk.file.end());
+    }
+    std::ofstream file(std::filesystem::path(dir) / MANIFEST_FILE, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    file.close();
+    if (!file) {
+        return std::nullopt;
+    }
+    return manifest;
+}
+
+std::optional<StateStore::SnapshotManifest> StateStore::read_manifest(const std::string& dir) {
+    std::ifstream file(std::filesystem::path(dir) / MANIFEST_FILE, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ManifestReader reader{data};
+
+    std::string magic;
+    uint64_t head_size = 0;
+    std::string head;
+    uint64_t chunks = 0;
+    if (!reader.bytes(magic, MANIFEST_MAGIC.size()) || magic != MANIFEST_MAGIC || !reader.get(head_size, 4) ||
+        head_size < sizeof(uint64_t) || !reader.bytes(head, head_size) || !reader.get(chunks, 4)) {
+        return std::nullopt;
+    }
+
+    SnapshotManifest manifest;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        manifest.head.version |= static_cast<uint64_t>(static_cast<uint8_t>(head[i])) << (8 * i);
+    }
+    manifest.head.state_root.assign(head.begin() + sizeof(uint64_t), head.end());
+    for (uint64_t c = 0; c < chunks; ++c) {
+        SnapshotChunk chunk;
+        uint64_t name_size = 0;
+        // SST files cannot be empty, and chunks must stay inside `dir`
+        if (!reader.get(chunk.accounts, 8) || chunk.accounts == 0 || !reader.get(name_size, 2) ||
+            !reader.bytes(chunk.file, name_size) || chunk.file.empty() || chunk.file.find('/') != std::string::npos) {
+            return std::nullopt;
+        }
+        manifest.chunks.push_back(std::move(chunk));
+    }
+    return manifest;
+}
+
+bool StateStore::import_snapshot(const std::string& dir, bool move_files) {
+    auto manifest = read_manifest(dir);
+    if (!manifest || !flush() || load_head()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (committed_version_ != 0) {
+            return false;
+        }
+    }
+
+    const size_t chunks = manifest->chunks.size();
+    std::vector<std::string> paths(chunks);
+    // First and last key of each chunk, to check they do not overlap
+    std::vector<std::pair<std::string, std::string>> ranges(chunks);
+    std::atomic<bool> ok{true};
+
+    std::mutex trie_mutex;
+    StateTrie trie;
+    utils::WorkStealingPool::global().parallel_for(0, chunks, [&](size_t c) {
+        const auto& chunk = manifest->chunks[c];
+        paths[c] = (std::filesystem::path(dir) / chunk.file).string();
+
+        std::vector<std::pair<std::string, StateTrie::Hash>> leaves;
+        leaves.reserve(chunk.accounts);
+        std::string last;
+        const bool read = storage::PersistentStorage::readStateFile(paths[c],
+            [&](const std::string& key, const std::vector<uint8_t>& data) {
+                auto account = Account::deserialize(data);
+                if (!account || key.compare(0, ACCOUNT_PREFIX.size(), ACCOUNT_PREFIX) != 0) {
+                    return false;
+                }
+                if (leaves.empty()) {
+                    ranges[c].first = key;
+                }
+                last = key;
+                leaves.emplace_back(key.substr(ACCOUNT_PREFIX.size()), StateManager::account_hash(*account));
+                return ok.load(std::memory_order_relaxed);
+            });
+        ranges[c].second = std::move(last);
+        if (!read || leaves.size() != chunk.accounts) {
+            ok = false;
+            return;
+        }
+
+        // Folded in as each chunk completes; the root is order-independent
+        std::lock_guard<std::mutex> lock(trie_mutex);
+        for (const auto& [address, hash] : leaves) {
+            trie.update(address, hash);
+        }
+    }, utils::TaskPriority::Execution, 1);
+    if (!ok) {
+        return false;
+    }
+
+    for (size_t c = 1; c < chunks; ++c) {
+        if (!(ranges[c - 1].second < ranges[c].first)) {
+            return false;
+        }
+    }
+    const auto root = trie.root();
+    if (std::vector<uint8_t>(root.begin(), root.end()) != manifest->head.state_root) {
+        return false;
+    }
+
+    if (!storage_->ingestStateFiles(paths, move_files)) {
+        return false;
+    }
+    // The head goes in after the accounts: a crash in between leaves no
+    // head, so the store still counts as empty and the import can rerun
+    if (!storage_->storeStateBatch({{HEAD_KEY, encode_head(manifest->head)}}, true)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    committed_version_ = durable_version_ = manifest->head.version;
+    stats_.flushed_batches++;
+    stats_.flushed_accounts += trie.size();
+    return true;
+}
+
+} // namespace rollup
+} // namespace quids
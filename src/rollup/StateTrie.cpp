@@ -0,0 +1,665 @@
+#include "rollup/StateTrie.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <blake3.h>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+constexpr uint8_t LEAF_TAG = 0x00;
+constexpr uint8_t BRANCH_TAG = 0x01;
+
+// Depth of the subtrees rehashed as independent pool tasks (16^2 = 256)
+constexpr size_t PARALLEL_DEPTH = 2;
+
+constexpr StateTrie::Hash EMPTY_HASH{};
+
+[[noreturn]] void uncovered() {
+    throw std::out_of_range("Key lies outside the proven part of the trie");
+}
+
+} // namespace
+
+struct StateTrie::Node {
+    bool is_leaf{false};
+    bool dirty{true};
+    // Grafted from a proof sibling: only the hash is known
+    bool opaque{false};
+    Hash hash{};
+
+    // Leaf
+    Hash path{};
+    Hash value_hash{};
+
+    // Branch
+    std::array<NodePtr, 16> children{};
+
+    size_t child_count() const {
+        return static_cast<size_t>(std::count_if(children.begin(), children.end(),
+            [](const NodePtr& c) { return c != nullptr; }));
+    }
+};
+
+StateTrie::StateTrie() = default;
+StateTrie::~StateTrie() = default;
+
+StateTrie::StateTrie(const StateTrie& other) {
+    other.root();
+    std::lock_guard<std::mutex> lock(other.hash_mutex_);
+    root_ = other.root_;
+    size_ = other.size_;
+}
+
+StateTrie& StateTrie::operator=(const StateTrie& other) {
+    if (this != &other) {
+        other.root();
+        NodePtr shared;
+        size_t size = 0;
+        {
+            std::lock_guard<std::mutex> lock(other.hash_mutex_);
+            shared = other.root_;
+            size = other.size_;
+        }
+        std::lock_guard<std::mutex> lock(hash_mutex_);
+        root_ = std::move(shared);
+        size_ = size;
+    }
+    return *this;
+}
+
+void StateTrie::make_unique(NodePtr& node) {
+    // Only nodes no other trie can reach are written in place
+    if (node.use_count() != 1) {
+        node = std::make_shared<Node>(*node);
+    }
+}
+
+const StateTrie::Node* StateTrie::find_leaf(const Hash& path) const {
+    const Node* node = root_.get();
+    size_t depth = 0;
+    while (node && !node->is_leaf) {
+        if (node->opaque) {
+            uncovered();
+        }
+        node = node->children[nibble_at(path, depth++)].get();
+    }
+    return (node && node->path == path) ? node : nullptr;
+}
+
+bool StateTrie::contains(const std::string& key) const {
+    return find_leaf(path_of(key)) != nullptr;
+}
+
+StateTrie::Hash StateTrie::hash_bytes(const uint8_t* data, size_t len) {
+    Hash out{};
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, data, len);
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+StateTrie::Hash StateTrie::path_of(const std::string& key) {
+    return hash_bytes(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+}
+
+StateTrie::Hash StateTrie::leaf_hash(const Hash& path, const Hash& value_hash) {
+    std::array<uint8_t, 1 + 32 + 32> buf{};
+    buf[0] = LEAF_TAG;
+    std::copy(path.begin(), path.end(), buf.begin() + 1);
+    std::copy(value_hash.begin(), value_hash.end(), buf.begin() + 33);
+    return hash_bytes(buf.data(), buf.size());
+}
+
+StateTrie::Hash StateTrie::branch_hash(uint16_t bitmap, const std::vector<Hash>& children) {
+    // Tag + bitmap + occupied child hashes only
+    std::vector<uint8_t> buf;
+    buf.reserve(3 + children.size() * 32);
+    buf.push_back(BRANCH_TAG);
+    buf.push_back(static_cast<uint8_t>(bitmap >> 8));
+    buf.push_back(static_cast<uint8_t>(bitmap & 0xFF));
+    for (const auto& child : children) {
+        buf.insert(buf.end(), child.begin(), child.end());
+    }
+    return hash_bytes(buf.data(), buf.size());
+}
+
+void StateTrie::update(const std::string& key, const Hash& value_hash) {
+    insert(root_, 0, path_of(key), value_hash);
+}
+
+bool StateTrie::erase(const std::string& key) {
+    const Hash path = path_of(key);
+    if (!find_leaf(path)) {
+        return false;
+    }
+    // Held so the removal copies its path, and a partial trie that cannot
+    // collapse a branch is left as it was
+    NodePtr before = root_;
+    try {
+        return remove(root_, 0, path);
+    } catch (const std::out_of_range&) {
+        root_ = std::move(before);
+        size_++;
+        throw;
+    }
+}
+
+void StateTrie::clear() {
+    root_.reset();
+    size_ = 0;
+}
+
+void StateTrie::insert(NodePtr& slot, size_t depth, const Hash& path, const Hash& value_hash) {
+    if (slot && slot->opaque) {
+        uncovered();
+    }
+    if (!slot) {
+        slot = std::make_shared<Node>();
+        slot->is_leaf = true;
+        slot->path = path;
+        slot->value_hash = value_hash;
+        size_++;
+        return;
+    }
+
+    if (slot->is_leaf) {
+        if (slot->path == path) {
+            if (slot->value_hash != value_hash) {
+                make_unique(slot);
+                slot->value_hash = value_hash;
+                slot->dirty = true;
+            }
+            return;
+        }
+        // Split: push the existing leaf one level down under a new branch
+        auto branch = std::make_shared<Node>();
+        branch->children[nibble_at(slot->path, depth)] = std::move(slot);
+        slot = std::move(branch);
+    } else {
+        make_unique(slot);
+    }
+
+    slot->dirty = true;
+    insert(slot->children[nibble_at(path, depth)], depth + 1, path, value_hash);
+}
+
+bool StateTrie::remove(NodePtr& slot, size_t depth, const Hash& path) {
+    if (!slot) {
+        return false;
+    }
+
+    if (slot->is_leaf) {
+        if (slot->path != path) {
+            return false;
+        }
+        slot.reset();
+        size_--;
+        return true;
+    }
+
+    make_unique(slot);
+    if (!remove(slot->children[nibble_at(path, depth)], depth + 1, path)) {
+        return false;
+    }
+    slot->dirty = true;
+
+    // Keep the trie canonical: no empty branches, no branch over a lone leaf
+    size_t count = slot->child_count();
+    if (count == 0) {
+        slot.reset();
+    } else if (count == 1) {
+        for (auto& child : slot->children) {
+            if (child && child->opaque) {
+                uncovered();  // a leaf would move up, a branch would not
+            }
+            if (child && child->is_leaf) {
+                NodePtr leaf = std::move(child);
+                slot = std::move(leaf);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+const StateTrie::Hash& StateTrie::rehash(Node& node) {
+    if (!node.dirty) {
+        return node.hash;
+    }
+    if (node.is_leaf) {
+        node.hash = leaf_hash(node.path, node.value_hash);
+    } else {
+        uint16_t bitmap = 0;
+        std::vector<Hash> child_hashes;
+        child_hashes.reserve(16);
+        for (size_t i = 0; i < 16; ++i) {
+            if (node.children[i]) {
+                bitmap |= static_cast<uint16_t>(1u << i);
+                child_hashes.push_back(rehash(*node.children[i]));
+            }
+        }
+        node.hash = branch_hash(bitmap, child_hashes);
+    }
+    node.dirty = false;
+    return node.hash;
+}
+
+StateTrie::Hash StateTrie::root() const {
+    std::lock_guard<std::mutex> lock(hash_mutex_);
+    if (!root_) {
+        return EMPTY_HASH;
+    }
+    if (!root_->dirty) {
+        return root_->hash;
+    }
+
+    // Collect dirty subtrees at PARALLEL_DEPTH and hash them side by side;
+    // the few nodes above them are finished serially
+    std::vector<Node*> frontier;
+    std::vector<Node*> level{root_.get()};
+    for (size_t depth = 0; depth < PARALLEL_DEPTH; ++depth) {
+        std::vector<Node*> next;
+        for (Node* node : level) {
+            if (node->is_leaf || !node->dirty) continue;
+            for (auto& child : node->children) {
+                if (child && child->dirty) next.push_back(child.get());
+            }
+        }
+        level = std::move(next);
+    }
+    frontier = std::move(level);
+
+    if (frontier.size() > 1) {
+        utils::WorkStealingPool::global().parallel_for(0, frontier.size(), [&](size_t i) {
+            rehash(*frontier[i]);
+        }, utils::TaskPriority::Execution);
+    }
+
+    return rehash(*root_);
+}
+
+StateTrie::ProofStep StateTrie::step_at(const Node& node, uint8_t nibble) {
+    ProofStep step;
+    step.nibble = nibble;
+    for (size_t i = 0; i < 16; ++i) {
+        if (!node.children[i]) continue;
+        step.bitmap |= static_cast<uint16_t>(1u << i);
+        if (i != nibble) {
+            step.siblings.push_back(node.children[i]->hash);
+        }
+    }
+    return step;
+}
+
+std::optional<StateTrie::Proof> StateTrie::prove(const std::string& key) const {
+    root();  // make sure every cached hash is current
+
+    std::lock_guard<std::mutex> lock(hash_mutex_);
+    const Hash path = path_of(key);
+    Proof proof;
+
+    const Node* node = root_.get();
+    size_t depth = 0;
+    std::vector<ProofStep> top_down;
+    while (node && !node->is_leaf) {
+        const uint8_t nibble = nibble_at(path, depth);
+        top_down.push_back(step_at(*node, nibble));
+        node = node->children[nibble].get();
+        depth++;
+    }
+
+    if (!node || node->path != path) {
+        return std::nullopt;
+    }
+
+    proof.steps.assign(top_down.rbegin(), top_down.rend());
+    return proof;
+}
+
+std::optional<StateTrie::AbsenceProof> StateTrie::prove_absent(const std::string& key) const {
+    root();
+
+    std::lock_guard<std::mutex> lock(hash_mutex_);
+    const Hash path = path_of(key);
+    AbsenceProof proof;
+
+    const Node* node = root_.get();
+    size_t depth = 0;
+    std::vector<ProofStep> top_down;
+    while (node && !node->is_leaf) {
+        if (node->opaque) {
+            return std::nullopt;
+        }
+        const uint8_t nibble = nibble_at(path, depth);
+        top_down.push_back(step_at(*node, nibble));
+        node = node->children[nibble].get();
+        depth++;
+    }
+
+    if (node) {
+        if (node->path == path) {
+            return std::nullopt;
+        }
+        proof.leaf_path = node->path;
+        proof.leaf_value_hash = node->value_hash;
+    }
+    proof.steps.assign(top_down.rbegin(), top_down.rend());
+    return proof;
+}
+
+bool StateTrie::climb(const Hash& path, Hash& current, const std::vector<ProofStep>& steps, size_t first) {
+    for (size_t s = first; s < steps.size(); ++s) {
+        const ProofStep& step = steps[s];
+        const size_t depth = steps.size() - 1 - s;
+        if (step.nibble != nibble_at(path, depth) ||
+            !(step.bitmap & (1u << step.nibble))) {
+            return false;
+        }
+
+        std::vector<Hash> children;
+        children.reserve(step.siblings.size() + 1);
+        size_t sibling = 0;
+        for (size_t i = 0; i < 16; ++i) {
+            if (!(step.bitmap & (1u << i))) continue;
+            if (i == step.nibble) {
+                children.push_back(current);
+            } else {
+                if (sibling >= step.siblings.size()) return false;
+                children.push_back(step.siblings[sibling++]);
+            }
+        }
+        if (sibling != step.siblings.size()) {
+            return false;
+        }
+        current = branch_hash(step.bitmap, children);
+    }
+    return true;
+}
+
+bool StateTrie::verify(const Hash& root, const std::string& key,
+                       const Hash& value_hash, const Proof& proof) {
+    const Hash path = path_of(key);
+    Hash current = leaf_hash(path, value_hash);
+    return climb(path, current, proof.steps, 0) && current == root;
+}
+
+bool StateTrie::verify_absent(const Hash& root, const std::string& key,
+                              const AbsenceProof& proof) {
+    const Hash path = path_of(key);
+    const auto& steps = proof.steps;
+    Hash current{};
+    size_t first = 0;
+
+    if (proof.leaf_path) {
+        // The other leaf has to sit on its own path, which it shares with
+        // `key` down to where it was found
+        const Hash& other = *proof.leaf_path;
+        if (other == path) {
+            return false;
+        }
+        for (size_t depth = 0; depth < steps.size(); ++depth) {
+            if (nibble_at(other, depth) != nibble_at(path, depth)) {
+                return false;
+            }
+        }
+        current = leaf_hash(other, proof.leaf_value_hash);
+    } else if (steps.empty()) {
+        return root == EMPTY_HASH;
+    } else {
+        const ProofStep& deepest = steps.front();
+        if (deepest.nibble != nibble_at(path, steps.size() - 1) ||
+            (deepest.bitmap & (1u << deepest.nibble)) ||
+            static_cast<size_t>(std::popcount(deepest.bitmap)) != deepest.siblings.size()) {
+            return false;
+        }
+        current = branch_hash(deepest.bitmap, deepest.siblings);
+        first = 1;
+    }
+
+    return climb(path, current, steps, first) && current == root;
+}
+
+bool StateTrie::walk_many(const Node& node, size_t depth, PathRange paths, MultiProof& proof) {
+    if (node.opaque || depth >= 2 * sizeof(Hash)) {
+        return false;
+    }
+    const size_t index = proof.branches.size();
+    proof.branches.emplace_back();
+    // Paths are sorted, so each child's share of them is a run
+    const Hash* first = paths.first;
+    for (size_t i = 0; i < 16; ++i) {
+        const Hash* last = first;
+        while (last != paths.second && nibble_at(*last, depth) == i) {
+            ++last;
+        }
+        const Node* child = node.children[i].get();
+        const auto bit = static_cast<uint16_t>(1u << i);
+        if (!child) {
+            if (last != first) {
+                return false;
+            }
+            continue;
+        }
+        proof.branches[index].bitmap |= bit;
+        if (last == first) {
+            proof.hashes.push_back(child->hash);
+            continue;
+        }
+        proof.branches[index].descend |= bit;
+        if (child->is_leaf) {
+            if (last - first != 1 || child->path != *first) {
+                return false;
+            }
+            proof.branches[index].leaves |= bit;
+        } else if (!walk_many(*child, depth + 1, {first, last}, proof)) {
+            return false;
+        }
+        first = last;
+    }
+    return true;
+}
+
+std::optional<StateTrie::MultiProof> StateTrie::prove_many(const std::vector<std::string>& keys) const {
+    if (keys.empty()) {
+        return std::nullopt;
+    }
+    std::vector<Hash> paths;
+    paths.reserve(keys.size());
+    for (const auto& key : keys) {
+        paths.push_back(path_of(key));
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    root();
+    std::lock_guard<std::mutex> lock(hash_mutex_);
+    if (!root_) {
+        return std::nullopt;
+    }
+    MultiProof proof;
+    if (root_->is_leaf) {
+        // A lone leaf is the root itself
+        if (paths.size() != 1 || root_->path != paths.front()) {
+            return std::nullopt;
+        }
+        return proof;
+    }
+    if (!walk_many(*root_, 0, {paths.data(), paths.data() + paths.size()}, proof)) {
+        return std::nullopt;
+    }
+    return proof;
+}
+
+bool StateTrie::verify_many(const Hash& root, const std::vector<std::pair<std::string, Hash>>& leaves,
+                            const MultiProof& proof) {
+    using Leaf = std::pair<Hash, Hash>;  // path, value hash
+    std::vector<Leaf> sorted;
+    sorted.reserve(leaves.size());
+    for (const auto& [key, value_hash] : leaves) {
+        sorted.emplace_back(path_of(key), value_hash);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    if (sorted.empty() || std::adjacent_find(sorted.begin(), sorted.end(), [](const Leaf& a, const Leaf& b) {
+            return a.first == b.first;
+        }) != sorted.end()) {
+        return false;
+    }
+    if (proof.branches.empty()) {
+        return sorted.size() == 1 && proof.hashes.empty() &&
+               leaf_hash(sorted.front().first, sorted.front().second) == root;
+    }
+
+    // Replays the walk prove_many() took, consuming branches and hashes in
+    // the order it produced them
+    struct Folder {
+        const MultiProof& proof;
+        size_t branch{0};
+        size_t hash{0};
+
+        std::optional<Hash> fold(size_t depth, const Leaf* first, const Leaf* end) {
+            if (depth >= 2 * sizeof(Hash) || branch >= proof.branches.size()) {
+                return std::nullopt;
+            }
+            const MultiProof::Branch b = proof.branches[branch++];
+            if ((b.descend & ~b.bitmap) || (b.leaves & ~b.descend)) {
+                return std::nullopt;
+            }
+            std::vector<Hash> children;
+            children.reserve(static_cast<size_t>(std::popcount(b.bitmap)));
+            for (size_t i = 0; i < 16; ++i) {
+                const Leaf* last = first;
+                while (last != end && nibble_at(last->first, depth) == i) {
+                    ++last;
+                }
+                const auto bit = static_cast<uint16_t>(1u << i);
+                if (!(b.bitmap & bit) || !(b.descend & bit)) {
+                    if (last != first) {
+                        return std::nullopt;
+                    }
+                    if (b.bitmap & bit) {
+                        if (hash >= proof.hashes.size()) {
+                            return std::nullopt;
+                        }
+                        children.push_back(proof.hashes[hash++]);
+                    }
+                    continue;
+                }
+                if (last == first) {
+                    return std::nullopt;
+                }
+                if (b.leaves & bit) {
+                    if (last - first != 1) {
+                        return std::nullopt;
+                    }
+                    children.push_back(leaf_hash(first->first, first->second));
+                } else {
+                    auto child = fold(depth + 1, first, last);
+                    if (!child) {
+                        return std::nullopt;
+                    }
+                    children.push_back(*child);
+                }
+                first = last;
+            }
+            return branch_hash(b.bitmap, children);
+        }
+    };
+
+    Folder folder{proof};
+    auto computed = folder.fold(0, sorted.data(), sorted.data() + sorted.size());
+    return computed && folder.branch == proof.branches.size() && folder.hash == proof.hashes.size() &&
+           *computed == root;
+}
+
+StateTrie::NodePtr* StateTrie::graft_steps(const Hash& path, const std::vector<ProofStep>& steps) {
+    NodePtr* slot = &root_;
+    for (size_t depth = 0; depth < steps.size(); ++depth) {
+        const ProofStep& step = steps[steps.size() - 1 - depth];
+        const uint8_t nibble = nibble_at(path, depth);
+        if (step.nibble != nibble) {
+            return nullptr;
+        }
+        if (!*slot || (*slot)->opaque) {
+            *slot = std::make_shared<Node>();
+        } else if ((*slot)->is_leaf) {
+            return nullptr;
+        } else {
+            make_unique(*slot);
+        }
+
+        // Siblings become opaque children. Ones already grafted are kept;
+        // a wrong sibling hash anywhere shows up in root()
+        Node& node = **slot;
+        size_t sibling = 0;
+        for (size_t i = 0; i < 16; ++i) {
+            NodePtr& child = node.children[i];
+            if (!(step.bitmap & (1u << i))) {
+                if (child) return nullptr;
+                continue;
+            }
+            if (i == nibble) continue;
+            if (sibling >= step.siblings.size()) return nullptr;
+            const Hash& hash = step.siblings[sibling++];
+            if (!child) {
+                child = std::make_shared<Node>();
+                child->opaque = true;
+                child->dirty = false;
+                child->hash = hash;
+            }
+        }
+        if (sibling != step.siblings.size()) {
+            return nullptr;
+        }
+        node.dirty = true;
+        slot = &node.children[nibble];
+    }
+    return slot;
+}
+
+bool StateTrie::graft_leaf(NodePtr& slot, const Hash& path, const Hash& value_hash) {
+    if (slot && !slot->opaque) {
+        return slot->is_leaf && slot->path == path && slot->value_hash == value_hash;
+    }
+    slot = std::make_shared<Node>();
+    slot->is_leaf = true;
+    slot->path = path;
+    slot->value_hash = value_hash;
+    size_++;
+    return true;
+}
+
+bool StateTrie::graft(const std::string& key, const Hash& value_hash, const Proof& proof) {
+    const Hash path = path_of(key);
+    if (!proof.steps.empty() && !(proof.steps.front().bitmap & (1u << proof.steps.front().nibble))) {
+        return false;
+    }
+    NodePtr* slot = graft_steps(path, proof.steps);
+    return slot && graft_leaf(*slot, path, value_hash);
+}
+
+bool StateTrie::graft_absent(const std::string& key, const AbsenceProof& proof) {
+    const Hash path = path_of(key);
+    if (proof.leaf_path) {
+        if (*proof.leaf_path == path ||
+            (!proof.steps.empty() && !(proof.steps.front().bitmap & (1u << proof.steps.front().nibble)))) {
+            return false;
+        }
+        NodePtr* slot = graft_steps(path, proof.steps);
+        return slot && graft_leaf(*slot, *proof.leaf_path, proof.leaf_value_hash);
+    }
+    if (proof.steps.empty()) {
+        return !root_;
+    }
+    // The deepest step lists the path's child as unoccupied, so it is
+    // left empty
+    NodePtr* slot = graft_steps(path, proof.steps);
+    return slot && !*slot;
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,198 @@
+#include "rollup/StateWitness.hpp"
+#include <bit>
+#include <cstring>
+#include <map>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+using Hash = StateTrie::Hash;
+
+enum : uint8_t {
+    PRESENT = 0,
+    ABSENT_EMPTY = 1,  // path ends at an empty child
+    ABSENT_LEAF = 2    // path ends at another key's leaf
+};
+
+class Writer {
+public:
+    explicit Writer(std::vector<uint8_t>& out) : out_(out) {}
+
+    void u8(uint8_t v) { out_.push_back(v); }
+    void u16(uint16_t v) { put(v, 2); }
+    void u32(uint32_t v) { put(v, 4); }
+    void bytes(const uint8_t* data, size_t len) { out_.insert(out_.end(), data, data + len); }
+    void hash(const Hash& h) { bytes(h.data(), h.size()); }
+
+private:
+    void put(uint64_t v, size_t width) {
+        for (size_t i = 0; i < width; ++i) out_.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    std::vector<uint8_t>& out_;
+};
+
+class Reader {
+public:
+    explicit Reader(const std::vector<uint8_t>& in) : in_(in) {}
+
+    bool u8(uint8_t& v) { uint64_t x; if (!get(x, 1)) return false; v = static_cast<uint8_t>(x); return true; }
+    bool u16(uint16_t& v) { uint64_t x; if (!get(x, 2)) return false; v = static_cast<uint16_t>(x); return true; }
+    bool u32(uint32_t& v) { uint64_t x; if (!get(x, 4)) return false; v = static_cast<uint32_t>(x); return true; }
+
+    bool bytes(uint8_t* out, size_t len) {
+        if (in_.size() - pos_ < len) return false;
+        std::memcpy(out, in_.data() + pos_, len);
+        pos_ += len;
+        return true;
+    }
+
+    bool hash(Hash& h) { return bytes(h.data(), h.size()); }
+    bool done() const { return pos_ == in_.size(); }
+    size_t remaining() const { return in_.size() - pos_; }
+
+private:
+    bool get(uint64_t& v, size_t width) {
+        if (in_.size() - pos_ < width) return false;
+        v = 0;
+        for (size_t i = 0; i < width; ++i) v |= static_cast<uint64_t>(in_[pos_++]) << (8 * i);
+        return true;
+    }
+
+    const std::vector<uint8_t>& in_;
+    size_t pos_{0};
+};
+
+size_t sibling_count(const StateTrie::ProofStep& step) {
+    return static_cast<size_t>(std::popcount(step.bitmap)) - ((step.bitmap >> step.nibble) & 1u);
+}
+
+} // namespace
+
+std::vector<uint8_t> StateWitness::serialize() const {
+    std::map<Hash, uint32_t> index;
+    std::vector<const Hash*> table;
+    auto intern = [&](const std::vector<StateTrie::ProofStep>& steps) {
+        for (const auto& step : steps) {
+            for (const auto& sibling : step.siblings) {
+                if (index.emplace(sibling, static_cast<uint32_t>(table.size())).second) {
+                    table.push_back(&index.find(sibling)->first);
+                }
+            }
+        }
+    };
+    for (const auto& entry : entries) {
+        intern(entry.account ? entry.proof.steps : entry.absence.steps);
+    }
+
+    std::vector<uint8_t> out;
+    Writer w(out);
+    w.hash(pre_root);
+    w.u32(static_cast<uint32_t>(table.size()));
+    for (const Hash* h : table) {
+        w.hash(*h);
+    }
+
+    w.u32(static_cast<uint32_t>(entries.size()));
+    for (const auto& entry : entries) {
+        w.u32(static_cast<uint32_t>(entry.address.size()));
+        w.bytes(reinterpret_cast<const uint8_t*>(entry.address.data()), entry.address.size());
+
+        const std::vector<StateTrie::ProofStep>* steps = &entry.proof.steps;
+        if (entry.account) {
+            w.u8(PRESENT);
+            const auto account = entry.account->serialize();
+            w.u32(static_cast<uint32_t>(account.size()));
+            w.bytes(account.data(), account.size());
+        } else if (entry.absence.leaf_path) {
+            w.u8(ABSENT_LEAF);
+            w.hash(*entry.absence.leaf_path);
+            w.hash(entry.absence.leaf_value_hash);
+            steps = &entry.absence.steps;
+        } else {
+            w.u8(ABSENT_EMPTY);
+            steps = &entry.absence.steps;
+        }
+
+        // Sibling counts follow from the bitmaps
+        w.u8(static_cast<uint8_t>(steps->size()));
+        for (const auto& step : *steps) {
+            w.u16(step.bitmap);
+            w.u8(step.nibble);
+            for (const auto& sibling : step.siblings) {
+                w.u32(index.at(sibling));
+            }
+        }
+    }
+    return out;
+}
+
+std::optional<StateWitness> StateWitness::deserialize(const std::vector<uint8_t>& data) {
+    StateWitness witness;
+    Reader r(data);
+
+    uint32_t hash_count = 0;
+    if (!r.hash(witness.pre_root) || !r.u32(hash_count) || hash_count > r.remaining() / 32) {
+        return std::nullopt;
+    }
+    std::vector<Hash> table(hash_count);
+    for (auto& h : table) {
+        if (!r.hash(h)) return std::nullopt;
+    }
+
+    uint32_t entry_count = 0;
+    if (!r.u32(entry_count) || entry_count > r.remaining()) {
+        return std::nullopt;
+    }
+    witness.entries.reserve(entry_count);
+    for (uint32_t e = 0; e < entry_count; ++e) {
+        Entry entry;
+        uint32_t len = 0;
+        uint8_t kind = 0;
+        if (!r.u32(len) || len > r.remaining()) return std::nullopt;
+        entry.address.resize(len);
+        if (!r.bytes(reinterpret_cast<uint8_t*>(entry.address.data()), len) || !r.u8(kind)) {
+            return std::nullopt;
+        }
+
+        std::vector<StateTrie::ProofStep>* steps = &entry.absence.steps;
+        if (kind == PRESENT) {
+            if (!r.u32(len) || len > r.remaining()) return std::nullopt;
+            std::vector<uint8_t> account(len);
+            if (!r.bytes(account.data(), len)) return std::nullopt;
+            entry.account = StateManager::Account::deserialize(account);
+            if (!entry.account) return std::nullopt;
+            steps = &entry.proof.steps;
+        } else if (kind == ABSENT_LEAF) {
+            Hash path{};
+            if (!r.hash(path) || !r.hash(entry.absence.leaf_value_hash)) return std::nullopt;
+            entry.absence.leaf_path = path;
+        } else if (kind != ABSENT_EMPTY) {
+            return std::nullopt;
+        }
+
+        uint8_t step_count = 0;
+        if (!r.u8(step_count)) return std::nullopt;
+        steps->resize(step_count);
+        for (auto& step : *steps) {
+            if (!r.u16(step.bitmap) || !r.u8(step.nibble) || step.nibble >= 16) return std::nullopt;
+            step.siblings.resize(sibling_count(step));
+            for (auto& sibling : step.siblings) {
+                uint32_t i = 0;
+                if (!r.u32(i) || i >= table.size()) return std::nullopt;
+                sibling = table[i];
+            }
+        }
+        witness.entries.push_back(std::move(entry));
+    }
+
+    if (!r.done()) {
+        return std::nullopt;
+    }
+    return witness;
+}
+
+} // namespace rollup
+} // namespace quids
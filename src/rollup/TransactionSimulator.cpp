@@ -0,0 +1,368 @@
+#include "rollup/TransactionSimulator.hpp"
+#include "evm/Keccak.hpp"
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+using evm::InterpreterStatus;
+
+// State keys for EVM addresses are their hex form; other account names
+// (the sender of a plain transfer, say) are kept as they are
+std::string state_key(const std::string& name) {
+    auto address = ::evm::Address::from_hex(name);
+    return address ? address->to_hex() : name;
+}
+
+::evm::uint256_t address_word(const ::evm::Address& address) {
+    return ::evm::uint256_t::load_be(address.bytes.data(), address.bytes.size());
+}
+
+// Slots a contract has in the snapshot, by 32-byte big-endian key
+class SnapshotSlots final : public ::evm::SlotBackend {
+public:
+    explicit SnapshotSlots(StateManager::Snapshot snapshot) : snapshot_(std::move(snapshot)) {}
+
+    std::vector<::evm::uint256_t> read(std::span<const ::evm::StorageKey> keys) override {
+        std::vector<::evm::uint256_t> values;
+        values.reserve(keys.size());
+        std::vector<uint8_t> slot(32);
+        for (const auto& key : keys) {
+            ::evm::uint256_t value{0};
+            if (const auto* account = snapshot_.find_account(key.address.to_hex())) {
+                key.slot.store_be(slot.data());
+                auto it = account->storage.find(slot);
+                if (it != account->storage.end() && !it->second.empty()) {
+                    const size_t n = std::min<size_t>(it->second.size(), 32);
+                    value = ::evm::uint256_t::load_be(it->second.data() + it->second.size() - n, n);
+                }
+            }
+            values.push_back(value);
+        }
+        return values;
+    }
+
+private:
+    StateManager::Snapshot snapshot_;
+};
+
+// Balances, nonces and code as one run changes them, over the snapshot.
+// Accounts are copied in on first touch, without their storage, and every
+// change is journaled so a failed nested call undoes only its own.
+class Overlay final : public evm::CallHost {
+public:
+    Overlay(const StateManager::Snapshot& snapshot, const evm::Precompiles& precompiles)
+        : snapshot_(snapshot), precompiles_(precompiles) {}
+
+    // For participants whose state key is not their hex address
+    void name(const ::evm::Address& address, std::string key) { names_[address] = std::move(key); }
+
+    std::shared_ptr<const evm::AnalyzedCode> code_at(const ::evm::Address& address) override {
+        return account(address).code.analysis();
+    }
+
+    bool transfer(const ::evm::Address& from, const ::evm::Address& to, const ::evm::uint256_t& value) override {
+        // Balances are 64-bit here
+        if (value > std::numeric_limits<uint64_t>::max()) {
+            return false;
+        }
+        const auto amount = static_cast<uint64_t>(value);
+        State& sender = account(from);
+        if (sender.balance < amount) {
+            return false;
+        }
+        journal_.push_back({Change::Balance, from, sender.balance, {}});
+        sender.balance -= amount;
+        State& receiver = account(to);
+        journal_.push_back({Change::Balance, to, receiver.balance, {}});
+        receiver.balance += amount;
+        return true;
+    }
+
+    uint64_t increment_nonce(const ::evm::Address& address) override {
+        State& state = account(address);
+        journal_.push_back({Change::Nonce, address, state.nonce, {}});
+        return state.nonce++;
+    }
+
+    void set_code(const ::evm::Address& address, std::vector<uint8_t> code) override {
+        State& state = account(address);
+        journal_.push_back({Change::Code, address, 0, std::move(state.code)});
+        state.code = evm::CodeRef(std::move(code));
+    }
+
+    std::optional<evm::PrecompileResult> run_precompile(const ::evm::Address& address, const uint8_t* input,
+                                                        size_t size, uint64_t gas) override {
+        return precompiles_.run(address, input, size, gas);
+    }
+
+    Checkpoint checkpoint() override { return journal_.size(); }
+
+    void revert(Checkpoint checkpoint) override {
+        while (journal_.size() > checkpoint) {
+            Change& change = journal_.back();
+            State& state = accounts_.at(change.address);
+            switch (change.kind) {
+                case Change::Balance: state.balance = change.value; break;
+                case Change::Nonce: state.nonce = change.value; break;
+                case Change::Code: state.code = std::move(change.code); break;
+            }
+            journal_.pop_back();
+        }
+    }
+
+    uint64_t nonce(const ::evm::Address& address) { return account(address).nonce; }
+
+private:
+    struct State {
+        uint64_t balance{0};
+        uint64_t nonce{0};
+        evm::CodeRef code;
+    };
+
+    struct Change {
+        enum Kind { Balance, Nonce, Code } kind;
+        ::evm::Address address;
+        uint64_t value;  // previous balance or nonce
+        evm::CodeRef code;  // previous code
+    };
+
+    State& account(const ::evm::Address& address) {
+        auto it = accounts_.find(address);
+        if (it != accounts_.end()) {
+            return it->second;
+        }
+        State state;
+        auto named = names_.find(address);
+        if (const auto* found = snapshot_.find_account(named != names_.end() ? named->second : address.to_hex())) {
+            state = State{found->balance, found->nonce, found->code};
+        }
+        return accounts_.emplace(address, std::move(state)).first->second;
+    }
+
+    const StateManager::Snapshot& snapshot_;
+    const evm::Precompiles& precompiles_;
+    std::unordered_map<::evm::Address, State, ::evm::AddressHash> accounts_;
+    std::unordered_map<::evm::Address, std::string, ::evm::AddressHash> names_;
+    std::vector<Change> journal_;
+};
+
+void put_u64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+void put_bytes(std::string& out, std::span<const uint8_t> bytes) {
+    put_u64(out, bytes.size());
+    out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+} // namespace
+
+TransactionSimulator::TransactionSimulator(std::shared_ptr<const StateManager> state, const Config& config,
+                                           utils::WorkStealingPool& pool)
+    : state_(std::move(state)), config_(config), pool_(pool),
+      results_(config.cache_entries), estimates_(config.cache_entries) {}
+
+uint64_t TransactionSimulator::intrinsic_gas(const Call& call) {
+    uint64_t gas = TX_GAS + (call.to.empty() ? CREATE_GAS : 0);
+    for (uint8_t byte : call.data) {
+        gas += byte == 0 ? ZERO_BYTE_GAS : NONZERO_BYTE_GAS;
+    }
+    return gas;
+}
+
+uint64_t TransactionSimulator::cap_of(const Call& call) const {
+    return call.gas_limit == 0 ? config_.max_gas : std::min(call.gas_limit, config_.max_gas);
+}
+
+TransactionSimulator::Result TransactionSimulator::run(const StateManager::Snapshot& snapshot, const Call& call,
+                                                       uint64_t gas_limit) const {
+    runs_.fetch_add(1, std::memory_order_relaxed);
+    Result result;
+    const uint64_t intrinsic = intrinsic_gas(call);
+    if (call.to.empty() && call.data.size() > 2 * MAX_CODE_SIZE) {
+        // EIP-3860's limit on init code
+        result.status = InterpreterStatus::OutOfGas;
+        result.gas_used = gas_limit;
+        result.error = "init code too large";
+        return result;
+    }
+    if (gas_limit < intrinsic) {
+        result.status = InterpreterStatus::OutOfGas;
+        result.gas_used = gas_limit;
+        result.error = "gas limit below intrinsic gas";
+        return result;
+    }
+
+    Overlay overlay(snapshot, precompiles_);
+    const ::evm::Address from = ::evm::Address::from_string(call.from);
+    overlay.name(from, state_key(call.from));
+    const bool deploy = call.to.empty();
+    ::evm::Address to;
+    if (deploy) {
+        to = evm::contract_address(from, overlay.nonce(from));
+    } else {
+        to = ::evm::Address::from_string(call.to);
+        overlay.name(to, state_key(call.to));
+    }
+    overlay.increment_nonce(from);
+
+    result.gas_used = intrinsic;
+    if (!overlay.transfer(from, to, ::evm::uint256_t(call.value))) {
+        result.status = InterpreterStatus::Revert;
+        result.error = "insufficient balance for value";
+        return result;
+    }
+
+    std::shared_ptr<const evm::AnalyzedCode> code;
+    if (deploy) {
+        if (call.data.empty()) {
+            result.contract_address = to.to_hex();
+            return result;
+        }
+        code = evm::CodeCache::global().get(evm::keccak256(call.data), call.data);
+    } else {
+        code = overlay.code_at(to);
+        if (!code) {
+            return result;  // plain transfer
+        }
+    }
+
+    ::evm::Storage storage;
+    storage.set_backend(std::make_shared<SnapshotSlots>(snapshot));
+    storage.begin_transaction();
+
+    evm::ExecutionContext ctx;
+    ctx.address = to;
+    ctx.caller = address_word(from);
+    ctx.origin = ctx.caller;
+    ctx.value = ::evm::uint256_t(call.value);
+    ctx.number = ::evm::uint256_t(snapshot.version());
+    ctx.block_gas_limit = ::evm::uint256_t(config_.max_gas);
+    ctx.input = deploy ? nullptr : call.data.data();
+    ctx.input_size = deploy ? 0 : call.data.size();
+    ctx.storage = &storage;
+    ctx.host = &overlay;
+
+    auto outcome = evm::interpret(*code, ctx, gas_limit - intrinsic);
+    uint64_t gas_left = outcome.gas_left;
+    if (deploy && outcome.status == InterpreterStatus::Success) {
+        const uint64_t deposit = CODE_DEPOSIT_BYTE_GAS * outcome.output.size();
+        if (outcome.output.size() > MAX_CODE_SIZE || gas_left < deposit) {
+            outcome.status = InterpreterStatus::OutOfGas;
+            gas_left = 0;
+        } else {
+            gas_left -= deposit;
+            result.contract_address = to.to_hex();
+        }
+    }
+    result.status = outcome.status;
+    result.gas_used = gas_limit - gas_left;
+    result.output = std::move(outcome.output);
+    result.logs = std::move(outcome.logs);
+    return result;
+}
+
+TransactionSimulator::Estimate TransactionSimulator::estimate(const StateManager::Snapshot& snapshot,
+                                                              const Call& call) const {
+    const uint64_t cap = cap_of(call);
+    Estimate estimate;
+    estimate.result = run(snapshot, call, cap);
+    estimate.probes = 1;
+    if (!estimate.result.success()) {
+        return estimate;
+    }
+
+    // Fails at lo, succeeds at hi. Nothing succeeds below what the capped
+    // run used, and the 63/64 rule is what can push the answer above it.
+    uint64_t lo = estimate.result.gas_used - 1;
+    uint64_t hi = cap;
+    bool first = true;
+    while (hi - lo > 1) {
+        const uint64_t gap = hi - lo;
+        const size_t k = static_cast<size_t>(std::min<uint64_t>(std::max<size_t>(config_.parallel_probes, 1), gap - 1));
+        std::vector<uint64_t> limits(k);
+        for (size_t i = 0; i < k; ++i) {
+            limits[i] = lo + std::max<uint64_t>(1, gap / (k + 1) * (i + 1));
+        }
+        if (first) {
+            limits[0] = lo + 1;
+            first = false;
+        }
+        std::sort(limits.begin(), limits.end());
+        limits.erase(std::unique(limits.begin(), limits.end()), limits.end());
+
+        std::vector<Result> results(limits.size());
+        pool_.parallel_for(0, limits.size(), [&](size_t i) { results[i] = run(snapshot, call, limits[i]); },
+                           utils::TaskPriority::Proof);
+        estimate.probes += limits.size();
+
+        // Success is monotone in the limit, so the first success bounds it
+        auto success = std::find_if(results.begin(), results.end(), [](const Result& r) { return r.success(); });
+        const size_t index = static_cast<size_t>(success - results.begin());
+        if (success != results.end()) {
+            hi = limits[index];
+            estimate.result = std::move(*success);
+        }
+        if (index > 0) {
+            lo = limits[index - 1];
+        }
+    }
+    estimate.gas = hi;
+    return estimate;
+}
+
+std::string TransactionSimulator::key_of(const StateManager::Snapshot& snapshot, const Call& call) {
+    std::string encoded;
+    put_bytes(encoded, {reinterpret_cast<const uint8_t*>(call.from.data()), call.from.size()});
+    put_bytes(encoded, {reinterpret_cast<const uint8_t*>(call.to.data()), call.to.size()});
+    put_u64(encoded, call.value);
+    put_u64(encoded, call.gas_limit);
+    put_bytes(encoded, call.data);
+    const auto digest = evm::keccak256(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+
+    const auto root = snapshot.get_state_root();
+    std::string key(root.begin(), root.end());
+    key.append(digest.begin(), digest.end());
+    return key;
+}
+
+std::shared_ptr<const TransactionSimulator::Result> TransactionSimulator::simulate(const Call& call) {
+    const auto snapshot = state_->snapshot();
+    const std::string key = key_of(snapshot, call);
+    if (auto cached = results_.find(key)) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return cached;
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    auto result = std::make_shared<const Result>(run(snapshot, call, cap_of(call)));
+    results_.insert(key, result);
+    return result;
+}
+
+std::shared_ptr<const TransactionSimulator::Estimate> TransactionSimulator::estimate_gas(const Call& call) {
+    const auto snapshot = state_->snapshot();
+    const std::string key = key_of(snapshot, call);
+    if (auto cached = estimates_.find(key)) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return cached;
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    auto result = std::make_shared<const Estimate>(estimate(snapshot, call));
+    estimates_.insert(key, result);
+    return result;
+}
+
+TransactionSimulator::Stats TransactionSimulator::stats() const {
+    return Stats{hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+                 runs_.load(std::memory_order_relaxed)};
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,126 @@
+#include "rollup/WithdrawalBatcher.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+
+namespace {
+
+void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void put_string(std::vector<uint8_t>& out, const std::string& value) {
+    put_u64(out, value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+} // namespace
+
+std::vector<uint8_t> WithdrawalBatcher::Withdrawal::encode() const {
+    // Lengths first, so no two withdrawals encode alike
+    std::vector<uint8_t> out;
+    out.reserve(8 * 5 + l2_address.size() + l1_address.size());
+    put_u64(out, id);
+    put_string(out, l2_address);
+    put_string(out, l1_address);
+    put_u64(out, amount);
+    put_u64(out, timestamp);
+    return out;
+}
+
+WithdrawalBatcher::WithdrawalBatcher(const Config& config, utils::WorkStealingPool& pool)
+    : config_(config), pool_(pool) {
+    if (config_.max_batch == 0) {
+        throw std::invalid_argument("withdrawal batches need room for at least one withdrawal");
+    }
+}
+
+uint64_t WithdrawalBatcher::enqueue(std::string l2_address, std::string l1_address, uint64_t amount,
+                                    uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t id = next_id_++;
+    queue_.push_back({id, std::move(l2_address), std::move(l1_address), amount, timestamp});
+    return id;
+}
+
+size_t WithdrawalBatcher::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+std::optional<WithdrawalBatcher::Batch> WithdrawalBatcher::seal() {
+    std::lock_guard<std::mutex> seal_lock(seal_mutex_);
+
+    auto sealed = std::make_shared<Sealed>(pool_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+            return std::nullopt;
+        }
+        const size_t count = std::min(queue_.size(), config_.max_batch);
+        sealed->withdrawals.assign(std::make_move_iterator(queue_.begin()),
+                                   std::make_move_iterator(queue_.begin() + count));
+        queue_.erase(queue_.begin(), queue_.begin() + count);
+    }
+
+    // Hashing is the bulk of the work, and needs no lock
+    const auto& withdrawals = sealed->withdrawals;
+    sealed->tree.appendParallel(withdrawals.size(), [&](size_t i) { return leaf(withdrawals[i]); });
+    sealed->batch.root = sealed->tree.root();
+    sealed->batch.first_id = withdrawals.front().id;
+    sealed->batch.count = withdrawals.size();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sealed->batch.number = next_batch_++;
+    const Batch batch = sealed->batch;
+    sealed_.push_back(std::move(sealed));
+    while (sealed_.size() > config_.retained_batches) {
+        sealed_.pop_front();
+    }
+    return batch;
+}
+
+std::optional<WithdrawalBatcher::Batch> WithdrawalBatcher::batch(uint64_t number) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sealed_.empty() || number < sealed_.front()->batch.number || number >= next_batch_) {
+        return std::nullopt;
+    }
+    return sealed_[number - sealed_.front()->batch.number]->batch;
+}
+
+std::optional<WithdrawalBatcher::Claim> WithdrawalBatcher::claim(uint64_t withdrawal_id) const {
+    std::shared_ptr<const Sealed> sealed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Batches cover consecutive ids in order
+        auto it = std::upper_bound(sealed_.begin(), sealed_.end(), withdrawal_id,
+                                   [](uint64_t id, const auto& s) { return id < s->batch.first_id; });
+        if (it == sealed_.begin()) {
+            return std::nullopt;
+        }
+        sealed = *std::prev(it);
+    }
+    const uint64_t offset = withdrawal_id - sealed->batch.first_id;
+    if (offset >= sealed->batch.count) {
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock(sealed->tree_mutex);
+    return Claim{sealed->batch.number, sealed->withdrawals[offset], sealed->tree.proof(offset)};
+}
+
+WithdrawalBatcher::Hash WithdrawalBatcher::leaf(const Withdrawal& withdrawal) {
+    return quids::crypto::MerkleBuilder::hashLeaf(withdrawal.encode());
+}
+
+bool WithdrawalBatcher::verify(const Hash& root, const Claim& claim) {
+    return quids::crypto::MerkleBuilder::verify(root, leaf(claim.withdrawal), claim.proof);
+}
+
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,398 @@
+#include "storage/BlockArchive.hpp"
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace quids {
+namespace storage {
+
+namespace {
+
+constexpr char MAGIC[8] = {'Q', 'U', 'I', 'D', 'S', 'B', 'L', 'K'};
+constexpr uint32_t FORMAT_VERSION = 1;
+
+// magic | format u32 | reserved u32 | first block u64 | reserved u64
+constexpr size_t SEGMENT_HEADER_SIZE = 32;
+// block number u64 | data length u32 | tx count u32 | bodies length u64
+constexpr size_t RECORD_HEADER_SIZE = 24;
+constexpr size_t INDEX_ENTRY_SIZE = 8;
+
+void put_le(std::vector<uint8_t>& out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t get_le(const uint8_t* in, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+struct RecordHeader {
+    uint64_t block_number;
+    uint32_t data_len;
+    uint32_t tx_count;
+    uint64_t bodies_len;
+
+    static RecordHeader parse(const uint8_t* in) {
+        return RecordHeader{
+            get_le(in, 8),
+            static_cast<uint32_t>(get_le(in + 8, 4)),
+            static_cast<uint32_t>(get_le(in + 12, 4)),
+            get_le(in + 16, 8)
+        };
+    }
+
+    uint64_t record_size() const {
+        return RECORD_HEADER_SIZE + data_len + 4ull * (tx_count + 1) + bodies_len;
+    }
+};
+
+bool write_all(int fd, const uint8_t* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t written = ::pwrite(fd, data, len, static_cast<off_t>(offset));
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        len -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, uint8_t* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t got = ::pread(fd, data, len, static_cast<off_t>(offset));
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        len -= static_cast<size_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+    return true;
+}
+
+uint64_t file_size(int fd) {
+    struct stat st{};
+    return ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+} // namespace
+
+// Read-only view of a segment prefix; unmapped when the last holder goes
+class BlockArchive::Mapping {
+public:
+    Mapping(int fd, size_t size) : size_(size) {
+        void* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error("Failed to map block segment");
+        }
+        base_ = static_cast<const uint8_t*>(base);
+    }
+
+    ~Mapping() {
+        ::munmap(const_cast<uint8_t*>(base_), size_);
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    const uint8_t* data() const { return base_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* base_{nullptr};
+    size_t size_;
+};
+
+struct BlockArchive::Segment {
+    uint64_t first_block{0};
+    int seg_fd{-1};
+    int idx_fd{-1};
+    std::vector<uint64_t> offsets;        // record offset per block
+    uint64_t end{SEGMENT_HEADER_SIZE};    // end of the last complete record
+
+    // Grown on demand by readers
+    mutable std::mutex map_mutex;
+    mutable std::shared_ptr<const Mapping> mapping;
+
+    ~Segment() {
+        if (seg_fd >= 0) ::close(seg_fd);
+        if (idx_fd >= 0) ::close(idx_fd);
+    }
+};
+
+std::span<const uint8_t> BlockArchive::BlockView::transaction(size_t index) const {
+    if (index >= tx_count_) {
+        return {};
+    }
+    uint64_t begin = get_le(offsets_ + 4 * index, 4);
+    uint64_t end = get_le(offsets_ + 4 * (index + 1), 4);
+    return std::span<const uint8_t>(bodies_ + begin, end - begin);
+}
+
+BlockArchive::BlockArchive(const std::string& directory, const Config& config)
+    : directory_(directory), config_(config) {
+    if (config_.blocks_per_segment == 0) {
+        config_.blocks_per_segment = 1;
+    }
+    std::filesystem::create_directories(directory_);
+    load_segments();
+}
+
+BlockArchive::BlockArchive(const std::string& directory)
+    : BlockArchive(directory, Config{}) {}
+
+BlockArchive::~BlockArchive() = default;
+
+void BlockArchive::load_segments() {
+    for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+        if (entry.path().extension() != ".seg") {
+            continue;
+        }
+
+        auto segment = std::make_unique<Segment>();
+        try {
+            segment->first_block = std::stoull(entry.path().stem().string());
+        } catch (const std::exception&) {
+            continue;
+        }
+
+        const std::string base = (std::filesystem::path(directory_) / entry.path().stem()).string();
+        segment->seg_fd = ::open((base + ".seg").c_str(), O_RDWR);
+        segment->idx_fd = ::open((base + ".idx").c_str(), O_RDWR | O_CREAT, 0644);
+        if (segment->seg_fd < 0 || segment->idx_fd < 0) {
+            throw std::runtime_error("Failed to open block segment " + base);
+        }
+
+        uint8_t header[SEGMENT_HEADER_SIZE];
+        if (!read_all(segment->seg_fd, header, sizeof(header), 0) ||
+            std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 ||
+            get_le(header + 8, 4) != FORMAT_VERSION) {
+            throw std::runtime_error("Corrupt block segment " + base);
+        }
+
+        // Keep index entries whose records made it to disk completely; a
+        // crash mid-append leaves at most one torn tail to drop
+        const uint64_t seg_size = file_size(segment->seg_fd);
+        const uint64_t entries = file_size(segment->idx_fd) / INDEX_ENTRY_SIZE;
+        std::vector<uint8_t> raw(entries * INDEX_ENTRY_SIZE);
+        if (!raw.empty() && !read_all(segment->idx_fd, raw.data(), raw.size(), 0)) {
+            throw std::runtime_error("Failed to read block index " + base);
+        }
+        for (uint64_t i = 0; i < entries; ++i) {
+            uint64_t offset = get_le(raw.data() + i * INDEX_ENTRY_SIZE, 8);
+            uint8_t record[RECORD_HEADER_SIZE];
+            if (offset != segment->end || offset + RECORD_HEADER_SIZE > seg_size ||
+                !read_all(segment->seg_fd, record, sizeof(record), offset)) {
+                break;
+            }
+            auto parsed = RecordHeader::parse(record);
+            if (parsed.block_number != segment->first_block + i ||
+                offset + parsed.record_size() > seg_size) {
+                break;
+            }
+            segment->offsets.push_back(offset);
+            segment->end = offset + parsed.record_size();
+        }
+
+        if (::ftruncate(segment->seg_fd, static_cast<off_t>(segment->end)) != 0 ||
+            ::ftruncate(segment->idx_fd, static_cast<off_t>(segment->offsets.size() * INDEX_ENTRY_SIZE)) != 0) {
+            throw std::runtime_error("Failed to trim block segment " + base);
+        }
+        segments_.emplace(segment->first_block, std::move(segment));
+    }
+}
+
+BlockArchive::Segment& BlockArchive::writable_segment(uint64_t block_number) {
+    while (!segments_.empty()) {
+        auto last = std::prev(segments_.end());
+        Segment& segment = *last->second;
+        if (!segment.offsets.empty() || segment.first_block == block_number) {
+            if (segment.offsets.size() < config_.blocks_per_segment) {
+                return segment;
+            }
+            break;
+        }
+
+        // Left empty by a failed first write: its name says which block
+        // comes first, so any other block needs a segment of its own
+        const std::string base = (std::filesystem::path(directory_) / std::to_string(segment.first_block)).string();
+        segments_.erase(last);
+        std::error_code ignored;
+        std::filesystem::remove(base + ".seg", ignored);
+        std::filesystem::remove(base + ".idx", ignored);
+    }
+
+    auto segment = std::make_unique<Segment>();
+    segment->first_block = block_number;
+    const std::string base = (std::filesystem::path(directory_) / std::to_string(block_number)).string();
+    segment->seg_fd = ::open((base + ".seg").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    segment->idx_fd = ::open((base + ".idx").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (segment->seg_fd < 0 || segment->idx_fd < 0) {
+        throw std::runtime_error("Failed to create block segment " + base);
+    }
+
+    std::vector<uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+    put_le(header, FORMAT_VERSION, 4);
+    put_le(header, 0, 4);
+    put_le(header, block_number, 8);
+    put_le(header, 0, 8);
+    if (!write_all(segment->seg_fd, header.data(), header.size(), 0)) {
+        throw std::runtime_error("Failed to write block segment " + base);
+    }
+
+    Segment& ref = *segment;
+    segments_.emplace(block_number, std::move(segment));
+    return ref;
+}
+
+bool BlockArchive::append(
+    uint64_t block_number,
+    std::span<const uint8_t> data,
+    const std::vector<std::vector<uint8_t>>& tx_bodies
+) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    if (auto last = last_block_locked(); last && block_number != *last + 1) {
+        return false;
+    }
+
+    uint64_t bodies_len = 0;
+    for (const auto& body : tx_bodies) {
+        bodies_len += body.size();
+    }
+    if (data.size() > std::numeric_limits<uint32_t>::max() ||
+        tx_bodies.size() >= std::numeric_limits<uint32_t>::max() ||
+        bodies_len > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    std::vector<uint8_t> record;
+    record.reserve(RECORD_HEADER_SIZE + data.size() + 4 * (tx_bodies.size() + 1) + bodies_len);
+    put_le(record, block_number, 8);
+    put_le(record, data.size(), 4);
+    put_le(record, tx_bodies.size(), 4);
+    put_le(record, bodies_len, 8);
+    record.insert(record.end(), data.begin(), data.end());
+    uint64_t offset = 0;
+    put_le(record, offset, 4);
+    for (const auto& body : tx_bodies) {
+        offset += body.size();
+        put_le(record, offset, 4);
+    }
+    for (const auto& body : tx_bodies) {
+        record.insert(record.end(), body.begin(), body.end());
+    }
+
+    Segment& segment = writable_segment(block_number);
+    std::vector<uint8_t> index_entry;
+    put_le(index_entry, segment.end, 8);
+
+    // Record first, then the index entry that makes it visible
+    if (!write_all(segment.seg_fd, record.data(), record.size(), segment.end) ||
+        (config_.sync_on_append && ::fdatasync(segment.seg_fd) != 0) ||
+        !write_all(segment.idx_fd, index_entry.data(), index_entry.size(),
+                   segment.offsets.size() * INDEX_ENTRY_SIZE) ||
+        (config_.sync_on_append && ::fdatasync(segment.idx_fd) != 0)) {
+        return false;
+    }
+
+    segment.offsets.push_back(segment.end);
+    segment.end += record.size();
+    return true;
+}
+
+std::shared_ptr<const BlockArchive::Mapping> BlockArchive::mapping_for(
+    const Segment& segment,
+    uint64_t end
+) const {
+    std::lock_guard<std::mutex> lock(segment.map_mutex);
+    if (!segment.mapping || segment.mapping->size() < end) {
+        // Older views keep the previous mapping alive
+        segment.mapping = std::make_shared<const Mapping>(segment.seg_fd, segment.end);
+    }
+    return segment.mapping;
+}
+
+std::optional<BlockArchive::BlockView> BlockArchive::get(uint64_t block_number) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    auto it = segments_.upper_bound(block_number);
+    if (it == segments_.begin()) {
+        return std::nullopt;
+    }
+    const Segment& segment = *std::prev(it)->second;
+    const uint64_t index = block_number - segment.first_block;
+    if (index >= segment.offsets.size()) {
+        return std::nullopt;
+    }
+
+    const uint64_t offset = segment.offsets[index];
+    const uint64_t record_end = index + 1 < segment.offsets.size()
+        ? segment.offsets[index + 1] : segment.end;
+    auto mapping = mapping_for(segment, record_end);
+
+    const uint8_t* record = mapping->data() + offset;
+    auto header = RecordHeader::parse(record);
+
+    BlockView view;
+    view.mapping_ = mapping;
+    view.block_number_ = header.block_number;
+    view.data_ = std::span<const uint8_t>(record + RECORD_HEADER_SIZE, header.data_len);
+    view.offsets_ = record + RECORD_HEADER_SIZE + header.data_len;
+    view.bodies_ = view.offsets_ + 4ull * (header.tx_count + 1);
+    view.tx_count_ = header.tx_count;
+    return view;
+}
+
+bool BlockArchive::contains(uint64_t block_number) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = segments_.upper_bound(block_number);
+    if (it == segments_.begin()) {
+        return false;
+    }
+    const Segment& segment = *std::prev(it)->second;
+    return block_number - segment.first_block < segment.offsets.size();
+}
+
+std::optional<uint64_t> BlockArchive::first_block() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& [first, segment] : segments_) {
+        if (!segment->offsets.empty()) {
+            return first;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<uint64_t> BlockArchive::last_block() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return last_block_locked();
+}
+
+std::optional<uint64_t> BlockArchive::last_block_locked() const {
+    for (auto it = segments_.rbegin(); it != segments_.rend(); ++it) {
+        if (!it->second->offsets.empty()) {
+            return it->first + it->second->offsets.size() - 1;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace storage
+} // namespace quids
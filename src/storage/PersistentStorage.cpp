@@ -1,135 +1,787 @@
 #include "storage/PersistentStorage.hpp"
+#include "memory/MemoryBudget.hpp"
+#include <rocksdb/cache.h>
 #include <rocksdb/db.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/slice_transform.h>
+#include <rocksdb/sst_file_reader.h>
+#include <rocksdb/sst_file_writer.h>
+#include <rocksdb/table.h>
 #include <rocksdb/write_batch.h>
+#include <charconv>
 #include <sstream>
 #include <filesystem>
+#include <stdexcept>
 
 namespace quids {
 namespace storage {
 
+namespace {
+
+// Column families; the order matches Impl::handles
+enum ColumnFamily : size_t {
+    CF_DEFAULT = 0,
+    CF_TX,        // tx hash -> transaction
+    CF_BLOCK_TX,  // block number | index -> tx hash
+    CF_PROOF,     // block number -> proof
+    CF_BLOCK,     // block number -> block data
+    CF_STATE,     // state key -> value
+    CF_TX_LOC,    // tx hash -> block number | index, once archived
+    CF_ACCOUNT_TX, // address length | address | block number | index -> tx hash
+    CF_COUNT
+};
+
+const char* const CF_NAMES[CF_COUNT] = {
+    "default", "tx", "block_tx", "proof", "block", "state", "tx_loc", "account_tx"
+};
+
+// Block cache shared by every family, for a node without a block cache budget
+constexpr size_t DEFAULT_BLOCK_CACHE_BYTES = size_t{256} << 20;
+
+constexpr size_t BLOCK_KEY_SIZE = 8;
+constexpr size_t INDEX_KEY_SIZE = BLOCK_KEY_SIZE + 4;
+
+// Fixed-width big-endian so byte order equals numeric order
+template <size_t N>
+void put_be(std::string& out, uint64_t value) {
+    for (size_t i = 0; i < N; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * (N - 1 - i))));
+    }
+}
+
+std::string block_key(uint64_t block_number) {
+    std::string key;
+    key.reserve(BLOCK_KEY_SIZE);
+    put_be<BLOCK_KEY_SIZE>(key, block_number);
+    return key;
+}
+
+std::string index_key(uint64_t block_number, uint32_t position) {
+    std::string key = block_key(block_number);
+    put_be<4>(key, position);
+    return key;
+}
+
+// The length prefix keeps one address from being a prefix of another's keys
+std::string account_prefix(const std::string& address) {
+    std::string key;
+    key.reserve(2 + address.size() + INDEX_KEY_SIZE);
+    put_be<2>(key, address.size());
+    key += address;
+    return key;
+}
+
+std::string account_key(const std::string& address, uint64_t block_number, uint32_t position) {
+    return account_prefix(address) + index_key(block_number, position);
+}
+
+uint64_t get_be(const char* p, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value = (value << 8) | static_cast<uint8_t>(p[i]);
+    }
+    return value;
+}
+
+rocksdb::BlockBasedTableOptions table_options(const std::shared_ptr<rocksdb::Cache>& cache, int bloom_bits,
+                                              bool whole_key_filtering) {
+    rocksdb::BlockBasedTableOptions table;
+    table.block_cache = cache;
+    if (bloom_bits > 0) {
+        table.filter_policy.reset(rocksdb::NewBloomFilterPolicy(bloom_bits));
+    }
+    table.whole_key_filtering = whole_key_filtering;
+    table.cache_index_and_filter_blocks = true;
+    table.pin_l0_filter_and_index_blocks_in_cache = true;
+    return table;
+}
+
+rocksdb::ColumnFamilyOptions family_options(size_t cf, const std::shared_ptr<rocksdb::Cache>& cache) {
+    rocksdb::ColumnFamilyOptions options;
+    options.compression = rocksdb::kLZ4Compression;
+    options.write_buffer_size = 64 * 1024 * 1024; // 64MB
+    options.target_file_size_base = 64 * 1024 * 1024; // 64MB
+    options.level_compaction_dynamic_level_bytes = true;
+
+    switch (cf) {
+        case CF_TX:
+        case CF_STATE:
+        case CF_TX_LOC:
+            // Point lookups by hash or address
+            options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options(cache, 10, true)));
+            options.optimize_filters_for_hits = true;
+            break;
+        case CF_BLOCK_TX:
+            // Scanned by block number prefix
+            options.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(BLOCK_KEY_SIZE));
+            options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options(cache, 10, false)));
+            options.memtable_prefix_bloom_size_ratio = 0.1;
+            break;
+        case CF_ACCOUNT_TX:
+            // Range scans within one address; whole keys are never looked up
+            options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options(cache, 0, false)));
+            break;
+        case CF_PROOF:
+        case CF_BLOCK:
+            // Written once in key order, read rarely: favour ratio over speed
+            options.bottommost_compression = rocksdb::kZSTD;
+            options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options(cache, 0, true)));
+            break;
+        default:
+            break;
+    }
+    return options;
+}
+
+rocksdb::Slice as_slice(const std::vector<uint8_t>& bytes) {
+    return rocksdb::Slice(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+// nullptr for bytes that do not decode
+blockchain::TransactionPtr decode_transaction(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    auto tx = std::make_shared<blockchain::StandardTransaction>();
+    if (!tx->deserialize(blockchain::ByteVector(bytes, bytes + size))) {
+        return nullptr;
+    }
+    return tx;
+}
+
+} // namespace
+
 struct PersistentStorage::Impl {
     std::unique_ptr<rocksdb::DB> db;
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
     std::string data_dir;
+    std::shared_ptr<BlockArchive> archive;
+    // Sized to the node's block cache budget; its usage is charged to that
+    // subsystem whenever the budget is applied
+    std::shared_ptr<rocksdb::Cache> block_cache;
+    memory::MemoryCharge block_cache_charge{memory::Subsystem::BlockCache, 0};
 
     explicit Impl(const std::string& dir) : data_dir(dir) {
-        rocksdb::Options options;
+        const size_t budget = memory::MemoryAccountant::global().budget(memory::Subsystem::BlockCache);
+        block_cache = rocksdb::NewLRUCache(budget > 0 ? budget : DEFAULT_BLOCK_CACHE_BYTES);
+
+        rocksdb::DBOptions options;
         options.create_if_missing = true;
-        options.compression = rocksdb::kLZ4Compression;
+        options.create_missing_column_families = true;
         options.max_background_jobs = 4;
-        options.write_buffer_size = 64 * 1024 * 1024; // 64MB
-        options.target_file_size_base = 64 * 1024 * 1024; // 64MB
-        
+
+        std::vector<rocksdb::ColumnFamilyDescriptor> families;
+        for (size_t cf = 0; cf < CF_COUNT; ++cf) {
+            families.emplace_back(CF_NAMES[cf], family_options(cf, block_cache));
+        }
+
         rocksdb::DB* db_ptr = nullptr;
-        rocksdb::Status status = rocksdb::DB::Open(options, data_dir, &db_ptr);
+        rocksdb::Status status = rocksdb::DB::Open(options, data_dir, families, &handles, &db_ptr);
         if (!status.ok()) {
             throw std::runtime_error("Failed to open database: " + status.ToString());
         }
         db.reset(db_ptr);
+
+        try {
+            migrate_legacy_layout();
+        } catch (...) {
+            close();
+            throw;
+        }
+    }
+
+    ~Impl() {
+        close();
+    }
+
+    void close() {
+        for (auto* handle : handles) {
+            db->DestroyColumnFamilyHandle(handle);
+        }
+        handles.clear();
+        db.reset();
     }
 
-    std::string makeKey(const std::string& prefix, const std::string& id) {
-        return prefix + ":" + id;
+    // Databases written before the column families kept everything in the
+    // default family as "tx:<hash>", "proof:<block>", "block:<block>" and
+    // "state:<key>", with decimal block numbers. Those keys are moved into
+    // their families, deleted in the same batch, so a move cut short by a
+    // crash carries on at the next open. Legacy transactions had no block
+    // index and stay reachable by hash only. Anything else in the default
+    // family is from a layout this code does not know, and opening fails
+    // rather than leaving it unreadable.
+    void migrate_legacy_layout() {
+        constexpr size_t KEYS_PER_BATCH = 4096;
+        rocksdb::WriteOptions sync;
+        sync.sync = true;
+        rocksdb::WriteBatch batch;
+        size_t pending = 0;
+        auto commit = [&] {
+            const auto status = db->Write(sync, &batch);
+            if (!status.ok()) {
+                throw std::runtime_error("Failed to migrate " + data_dir + ": " + status.ToString());
+            }
+            batch.Clear();
+            pending = 0;
+        };
+
+        std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(rocksdb::ReadOptions(), cf(CF_DEFAULT)));
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            const std::string key = it->key().ToString();
+            const auto colon = key.find(':');
+            const std::string kind = key.substr(0, colon);
+            const std::string id = colon == std::string::npos ? std::string() : key.substr(colon + 1);
+
+            uint64_t block_number = 0;
+            const auto parsed = std::from_chars(id.data(), id.data() + id.size(), block_number);
+            const bool numbered = !id.empty() && parsed.ec == std::errc() && parsed.ptr == id.data() + id.size();
+
+            if (kind == "tx" && !id.empty()) {
+                batch.Put(cf(CF_TX), id, it->value());
+            } else if (kind == "state" && colon != std::string::npos) {
+                batch.Put(cf(CF_STATE), id, it->value());
+            } else if (kind == "proof" && numbered) {
+                batch.Put(cf(CF_PROOF), block_key(block_number), it->value());
+            } else if (kind == "block" && numbered) {
+                batch.Put(cf(CF_BLOCK), block_key(block_number), it->value());
+            } else {
+                throw std::runtime_error("Unrecognized key in the default column family of " + data_dir +
+                                         "; the database layout is not one this version can read");
+            }
+            batch.Delete(cf(CF_DEFAULT), it->key());
+            if (++pending == KEYS_PER_BATCH) {
+                commit();
+            }
+        }
+        if (!it->status().ok()) {
+            throw std::runtime_error("Failed to migrate " + data_dir + ": " + it->status().ToString());
+        }
+        if (pending > 0) {
+            commit();
+        }
+    }
+
+    rocksdb::ColumnFamilyHandle* cf(ColumnFamily family) const {
+        return handles[family];
+    }
+
+    std::optional<std::string> get(ColumnFamily family, const rocksdb::Slice& key) const {
+        std::string value;
+        if (db->Get(rocksdb::ReadOptions(), cf(family), key, &value).ok()) {
+            return value;
+        }
+        return std::nullopt;
+    }
+
+    // Adds the transaction and, with a block, its index entry
+    void add_transaction(rocksdb::WriteBatch& batch, const blockchain::Transaction& tx,
+                         std::optional<std::pair<uint64_t, uint32_t>> position) const {
+        blockchain::ByteVector serialized;
+        tx.serialize(serialized);
+        const auto hash = tx.hash();
+        rocksdb::Slice hash_slice(reinterpret_cast<const char*>(hash.data()), hash.size());
+
+        batch.Put(cf(CF_TX), hash_slice, as_slice(serialized));
+        if (position) {
+            batch.Put(cf(CF_BLOCK_TX), index_key(position->first, position->second), hash_slice);
+        }
     }
 };
 
-PersistentStorage::PersistentStorage(const std::string& data_dir) 
+PersistentStorage::PersistentStorage(const std::string& data_dir)
     : impl_(std::make_unique<Impl>(data_dir)) {}
 
 PersistentStorage::~PersistentStorage() = default;
 
 bool PersistentStorage::storeTransaction(const blockchain::Transaction& tx) {
-    auto serialized = tx.serialize();
-    auto hash = tx.compute_hash();
-    std::string key = impl_->makeKey("tx", std::string(hash.begin(), hash.end()));
-    
-    rocksdb::Status status = impl_->db->Put(
-        rocksdb::WriteOptions(),
-        key,
-        rocksdb::Slice(reinterpret_cast<const char*>(serialized.data()), serialized.size())
-    );
-    
-    return status.ok();
+    rocksdb::WriteBatch batch;
+    impl_->add_transaction(batch, tx, std::nullopt);
+    return impl_->db->Write(rocksdb::WriteOptions(), &batch).ok();
 }
 
-std::optional<blockchain::Transaction> PersistentStorage::loadTransaction(
+bool PersistentStorage::storeTransactions(
+    uint64_t block_number,
+    std::span<const blockchain::TransactionPtr> txs
+) {
+    rocksdb::WriteBatch batch;
+    for (size_t i = 0; i < txs.size(); ++i) {
+        impl_->add_transaction(batch, *txs[i], std::make_pair(block_number, static_cast<uint32_t>(i)));
+    }
+    return impl_->db->Write(rocksdb::WriteOptions(), &batch).ok();
+}
+
+blockchain::TransactionPtr PersistentStorage::loadTransaction(
     const std::array<uint8_t, 32>& tx_hash
 ) {
-    std::string key = impl_->makeKey("tx", std::string(tx_hash.begin(), tx_hash.end()));
-    std::string tx_data;
-    
-    rocksdb::Status status = impl_->db->Get(
-        rocksdb::ReadOptions(),
-        key,
-        &tx_data
-    );
-    
-    if (status.ok()) {
-        std::vector<uint8_t> data(tx_data.begin(), tx_data.end());
-        return blockchain::Transaction::deserialize(data);
+    const rocksdb::Slice key(reinterpret_cast<const char*>(tx_hash.data()), tx_hash.size());
+    auto tx_data = impl_->get(CF_TX, key);
+    if (tx_data) {
+        return decode_transaction(tx_data->data(), tx_data->size());
     }
-    
-    return std::nullopt;
+
+    // Archived: the locator points into a segment
+    auto locator = impl_->get(CF_TX_LOC, key);
+    if (locator && locator->size() == INDEX_KEY_SIZE) {
+        uint64_t block_number = 0;
+        uint32_t position = 0;
+        for (size_t i = 0; i < BLOCK_KEY_SIZE; ++i) {
+            block_number = (block_number << 8) | static_cast<uint8_t>((*locator)[i]);
+        }
+        for (size_t i = BLOCK_KEY_SIZE; i < INDEX_KEY_SIZE; ++i) {
+            position = (position << 8) | static_cast<uint8_t>((*locator)[i]);
+        }
+        if (auto view = viewBlock(block_number); view && position < view->transaction_count()) {
+            auto body = view->transaction(position);
+            return decode_transaction(body.data(), body.size());
+        }
+    }
+
+    return nullptr;
+}
+
+std::vector<std::array<uint8_t, 32>> PersistentStorage::loadTransactionHashes(uint64_t block_number) {
+    std::vector<std::array<uint8_t, 32>> hashes;
+    const std::string prefix = block_key(block_number);
+
+    rocksdb::ReadOptions options;
+    options.prefix_same_as_start = true;
+    std::unique_ptr<rocksdb::Iterator> it(impl_->db->NewIterator(options, impl_->cf(CF_BLOCK_TX)));
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next()) {
+        rocksdb::Slice value = it->value();
+        if (it->key().size() != INDEX_KEY_SIZE || value.size() != 32) {
+            continue;
+        }
+        std::array<uint8_t, 32> hash{};
+        std::copy(value.data(), value.data() + value.size(), hash.begin());
+        hashes.push_back(hash);
+    }
+    return hashes;
+}
+
+std::vector<blockchain::TransactionPtr> PersistentStorage::loadTransactions(uint64_t block_number) {
+    if (auto view = viewBlock(block_number)) {
+        std::vector<blockchain::TransactionPtr> txs;
+        txs.reserve(view->transaction_count());
+        for (size_t i = 0; i < view->transaction_count(); ++i) {
+            auto body = view->transaction(i);
+            if (auto tx = decode_transaction(body.data(), body.size())) {
+                txs.push_back(std::move(tx));
+            }
+        }
+        return txs;
+    }
+
+    auto hashes = loadTransactionHashes(block_number);
+
+    // Fetch every body in one MultiGet instead of a Get per transaction
+    std::vector<rocksdb::Slice> keys;
+    keys.reserve(hashes.size());
+    for (const auto& hash : hashes) {
+        keys.emplace_back(reinterpret_cast<const char*>(hash.data()), hash.size());
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> families(keys.size(), impl_->cf(CF_TX));
+    std::vector<std::string> values;
+    auto statuses = impl_->db->MultiGet(rocksdb::ReadOptions(), families, keys, &values);
+
+    std::vector<blockchain::TransactionPtr> txs;
+    txs.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (!statuses[i].ok()) {
+            continue;
+        }
+        if (auto tx = decode_transaction(values[i].data(), values[i].size())) {
+            txs.push_back(std::move(tx));
+        }
+    }
+    return txs;
 }
 
 bool PersistentStorage::storeProof(uint64_t block_number, const rollup::StateTransitionProof& proof) {
     auto serialized = proof.serialize();
-    std::string key = impl_->makeKey("proof", std::to_string(block_number));
-    
     rocksdb::Status status = impl_->db->Put(
         rocksdb::WriteOptions(),
-        key,
-        rocksdb::Slice(reinterpret_cast<const char*>(serialized.data()), serialized.size())
+        impl_->cf(CF_PROOF),
+        block_key(block_number),
+        as_slice(serialized)
     );
-    
+
     return status.ok();
 }
 
 std::optional<rollup::StateTransitionProof> PersistentStorage::loadProof(uint64_t block_number) {
-    std::string key = impl_->makeKey("proof", std::to_string(block_number));
-    std::string proof_data;
-    
-    rocksdb::Status status = impl_->db->Get(
-        rocksdb::ReadOptions(),
-        key,
-        &proof_data
-    );
-    
-    if (status.ok()) {
-        std::vector<uint8_t> data(proof_data.begin(), proof_data.end());
+    auto proof_data = impl_->get(CF_PROOF, block_key(block_number));
+    if (proof_data) {
+        std::vector<uint8_t> data(proof_data->begin(), proof_data->end());
         return rollup::StateTransitionProof::deserialize(data);
     }
-    
+
     return std::nullopt;
 }
 
 bool PersistentStorage::storeBlockData(uint64_t block_number, const std::vector<uint8_t>& data) {
-    std::string key = impl_->makeKey("block", std::to_string(block_number));
-    
     rocksdb::Status status = impl_->db->Put(
         rocksdb::WriteOptions(),
-        key,
-        rocksdb::Slice(reinterpret_cast<const char*>(data.data()), data.size())
+        impl_->cf(CF_BLOCK),
+        block_key(block_number),
+        as_slice(data)
     );
-    
+
     return status.ok();
 }
 
 std::optional<std::vector<uint8_t>> PersistentStorage::loadBlockData(uint64_t block_number) {
-    std::string key = impl_->makeKey("block", std::to_string(block_number));
-    std::string block_data;
-    
-    rocksdb::Status status = impl_->db->Get(
-        rocksdb::ReadOptions(),
-        key,
-        &block_data
-    );
-    
-    if (status.ok()) {
-        return std::vector<uint8_t>(block_data.begin(), block_data.end());
+    if (auto view = viewBlock(block_number)) {
+        return std::vector<uint8_t>(view->data().begin(), view->data().end());
+    }
+
+    auto block_data = impl_->get(CF_BLOCK, block_key(block_number));
+    if (block_data) {
+        return std::vector<uint8_t>(block_data->begin(), block_data->end());
     }
-    
+
     return std::nullopt;
 }
 
+bool PersistentStorage::storeBlockAtomic(
+    uint64_t block_number,
+    std::span<const blockchain::TransactionPtr> txs,
+    const rollup::StateTransitionProof& proof,
+    const std::vector<uint8_t>& data
+) {
+    rocksdb::WriteBatch batch;
+    for (size_t i = 0; i < txs.size(); ++i) {
+        impl_->add_transaction(batch, *txs[i], std::make_pair(block_number, static_cast<uint32_t>(i)));
+    }
+    const std::string key = block_key(block_number);
+    auto serialized_proof = proof.serialize();
+    batch.Put(impl_->cf(CF_PROOF), key, as_slice(serialized_proof));
+    batch.Put(impl_->cf(CF_BLOCK), key, as_slice(data));
+
+    rocksdb::WriteOptions options;
+    options.sync = true;
+    const bool ok = impl_->db->Write(options, &batch).ok();
+    applyMemoryBudget();
+    return ok;
+}
+
+size_t PersistentStorage::applyMemoryBudget() {
+    const size_t budget = memory::MemoryAccountant::global().budget(memory::Subsystem::BlockCache);
+    // Shrinking the capacity evicts unpinned blocks straight away
+    if (budget > 0 && impl_->block_cache->GetCapacity() != budget) {
+        impl_->block_cache->SetCapacity(budget);
+    }
+    const size_t usage = impl_->block_cache->GetUsage();
+    impl_->block_cache_charge.resize(usage);
+    return usage;
+}
+
+void PersistentStorage::attachArchive(std::shared_ptr<BlockArchive> archive) {
+    impl_->archive = std::move(archive);
+}
+
+std::optional<BlockArchive::BlockView> PersistentStorage::viewBlock(uint64_t block_number) const {
+    if (!impl_->archive) {
+        return std::nullopt;
+    }
+    return impl_->archive->get(block_number);
+}
+
+size_t PersistentStorage::archiveBlocks(uint64_t last_block) {
+    if (!impl_->archive) {
+        return 0;
+    }
+
+    uint64_t next = 0;
+    if (auto last = impl_->archive->last_block()) {
+        next = *last + 1;
+    } else {
+        // An empty archive starts at the oldest block still held
+        std::unique_ptr<rocksdb::Iterator> it(impl_->db->NewIterator(rocksdb::ReadOptions(), impl_->cf(CF_BLOCK)));
+        it->SeekToFirst();
+        if (!it->Valid() || it->key().size() != BLOCK_KEY_SIZE) {
+            return 0;
+        }
+        for (size_t i = 0; i < BLOCK_KEY_SIZE; ++i) {
+            next = (next << 8) | static_cast<uint8_t>(it->key()[i]);
+        }
+    }
+
+    size_t archived = 0;
+    for (uint64_t block_number = next; block_number <= last_block; ++block_number) {
+        const std::string key = block_key(block_number);
+        auto data = impl_->get(CF_BLOCK, key);
+        if (!data) {
+            break;
+        }
+
+        // Raw wire bytes go straight into the segment, no decode/encode
+        auto hashes = loadTransactionHashes(block_number);
+        std::vector<rocksdb::Slice> keys;
+        keys.reserve(hashes.size());
+        for (const auto& hash : hashes) {
+            keys.emplace_back(reinterpret_cast<const char*>(hash.data()), hash.size());
+        }
+        std::vector<rocksdb::ColumnFamilyHandle*> families(keys.size(), impl_->cf(CF_TX));
+        std::vector<std::string> values;
+        auto statuses = impl_->db->MultiGet(rocksdb::ReadOptions(), families, keys, &values);
+
+        std::vector<std::vector<uint8_t>> bodies;
+        bodies.reserve(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (!statuses[i].ok()) {
+                return archived;  // incomplete block, leave it in RocksDB
+            }
+            bodies.emplace_back(values[i].begin(), values[i].end());
+        }
+
+        auto* bytes = reinterpret_cast<const uint8_t*>(data->data());
+        if (!impl_->archive->append(block_number, std::span<const uint8_t>(bytes, data->size()), bodies)) {
+            break;
+        }
+
+        rocksdb::WriteBatch batch;
+        batch.Delete(impl_->cf(CF_BLOCK), key);
+        batch.DeleteRange(impl_->cf(CF_BLOCK_TX), index_key(block_number, 0), block_key(block_number + 1));
+        for (size_t i = 0; i < keys.size(); ++i) {
+            batch.Delete(impl_->cf(CF_TX), keys[i]);
+            batch.Put(impl_->cf(CF_TX_LOC), keys[i], index_key(block_number, static_cast<uint32_t>(i)));
+        }
+        if (!impl_->db->Write(rocksdb::WriteOptions(), &batch).ok()) {
+            break;
+        }
+        archived++;
+    }
+    return archived;
+}
+
+bool PersistentStorage::storeAccountHistory(const std::vector<HistoryRef>& refs, bool sync) {
+    rocksdb::WriteBatch batch;
+    for (const auto& ref : refs) {
+        batch.Put(impl_->cf(CF_ACCOUNT_TX),
+                  account_key(ref.address, ref.block_number, ref.index),
+                  rocksdb::Slice(reinterpret_cast<const char*>(ref.tx_hash.data()), ref.tx_hash.size()));
+    }
+
+    rocksdb::WriteOptions options;
+    options.sync = sync;
+    return impl_->db->Write(options, &batch).ok();
+}
+
+std::vector<PersistentStorage::HistoryRef> PersistentStorage::loadAccountHistory(
+    const std::string& address,
+    const HistoryQuery& query
+) {
+    std::vector<HistoryRef> refs;
+    if (query.limit == 0 || query.from_block > query.to_block) {
+        return refs;
+    }
+    const std::string prefix = account_prefix(address);
+    const std::string lower = account_key(address, query.from_block, 0);
+    const std::string upper = account_key(address, query.to_block, std::numeric_limits<uint32_t>::max());
+
+    std::unique_ptr<rocksdb::Iterator> it(impl_->db->NewIterator(rocksdb::ReadOptions(), impl_->cf(CF_ACCOUNT_TX)));
+    std::string cursor;
+    if (query.after) {
+        cursor = account_key(address, query.after->first, query.after->second);
+    }
+
+    // The cursor entry itself was on the previous page
+    if (query.newest_first) {
+        it->SeekForPrev(query.after && cursor < upper ? cursor : upper);
+        if (query.after && it->Valid() && it->key() == rocksdb::Slice(cursor)) {
+            it->Prev();
+        }
+    } else {
+        it->Seek(query.after && cursor > lower ? cursor : lower);
+        if (query.after && it->Valid() && it->key() == rocksdb::Slice(cursor)) {
+            it->Next();
+        }
+    }
+
+    for (; it->Valid() && refs.size() < query.limit;
+         query.newest_first ? it->Prev() : it->Next()) {
+        const rocksdb::Slice key = it->key();
+        const rocksdb::Slice value = it->value();
+        if (key.compare(rocksdb::Slice(lower)) < 0 || key.compare(rocksdb::Slice(upper)) > 0) {
+            break;
+        }
+        if (key.size() != prefix.size() + INDEX_KEY_SIZE || value.size() != 32) {
+            continue;
+        }
+        HistoryRef ref;
+        ref.address = address;
+        ref.block_number = get_be(key.data() + prefix.size(), BLOCK_KEY_SIZE);
+        ref.index = static_cast<uint32_t>(get_be(key.data() + prefix.size() + BLOCK_KEY_SIZE, 4));
+        std::copy(value.data(), value.data() + value.size(), ref.tx_hash.begin());
+        refs.push_back(std::move(ref));
+    }
+    return refs;
+}
+
+size_t PersistentStorage::pruneBlocks(uint64_t below_block, size_t max_blocks) {
+    // Lowest block any per-block family still holds
+    std::optional<uint64_t> lowest;
+    for (ColumnFamily family : {CF_BLOCK, CF_PROOF, CF_BLOCK_TX}) {
+        std::unique_ptr<rocksdb::Iterator> it(impl_->db->NewIterator(rocksdb::ReadOptions(), impl_->cf(family)));
+        it->SeekToFirst();
+        if (it->Valid() && it->key().size() >= BLOCK_KEY_SIZE) {
+            const uint64_t first = get_be(it->key().data(), BLOCK_KEY_SIZE);
+            lowest = lowest ? std::min(*lowest, first) : first;
+        }
+    }
+    if (!lowest || *lowest >= below_block || max_blocks == 0) {
+        return 0;
+    }
+
+    const uint64_t end = *lowest + std::min<uint64_t>(max_blocks, below_block - *lowest);
+    rocksdb::WriteBatch batch;
+    for (uint64_t block_number = *lowest; block_number < end; ++block_number) {
+        for (const auto& hash : loadTransactionHashes(block_number)) {
+            batch.Delete(impl_->cf(CF_TX), rocksdb::Slice(reinterpret_cast<const char*>(hash.data()), hash.size()));
+        }
+    }
+    const std::string first_key = block_key(*lowest);
+    const std::string end_key = block_key(end);
+    batch.DeleteRange(impl_->cf(CF_BLOCK), first_key, end_key);
+    batch.DeleteRange(impl_->cf(CF_PROOF), first_key, end_key);
+    batch.DeleteRange(impl_->cf(CF_BLOCK_TX), first_key, end_key);
+    if (!impl_->db->Write(rocksdb::WriteOptions(), &batch).ok()) {
+        return 0;
+    }
+    return static_cast<size_t>(end - *lowest);
+}
+
+std::optional<std::string> PersistentStorage::pruneAccountHistory(uint64_t below_block, const std::string& cursor,
+                                                                  size_t max_addresses) {
+    std::unique_ptr<rocksdb::Iterator> it(impl_->db->NewIterator(rocksdb::ReadOptions(), impl_->cf(CF_ACCOUNT_TX)));
+    rocksdb::WriteBatch batch;
+    size_t visited = 0;
+    for (cursor.empty() ? it->SeekToFirst() : it->Seek(cursor); it->Valid(); ) {
+        const rocksdb::Slice key = it->key();
+        if (key.size() < 2) {
+            it->Next();
+            continue;
+        }
+        const size_t prefix_size = 2 + get_be(key.data(), 2);
+        if (key.size() != prefix_size + INDEX_KEY_SIZE) {
+            it->Next();
+            continue;
+        }
+        const std::string address(key.data() + 2, prefix_size - 2);
+        if (visited == max_addresses) {
+            return account_prefix(address);
+        }
+        // Entries of one address are in block order, so one range covers
+        // everything below the cut
+        if (get_be(key.data() + prefix_size, BLOCK_KEY_SIZE) < below_block) {
+            batch.DeleteRange(impl_->cf(CF_ACCOUNT_TX), account_key(address, 0, 0),
+                              account_key(address, below_block, 0));
+        }
+        ++visited;
+        // Past this address's last possible key
+        it->Seek(account_key(address, std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint32_t>::max()));
+        if (it->Valid() && it->key().starts_with(account_prefix(address))) {
+            it->Next();
+        }
+        if (batch.Count() >= 256) {
+            if (!impl_->db->Write(rocksdb::WriteOptions(), &batch).ok()) {
+                return account_prefix(address);  // this address is redone
+            }
+            batch.Clear();
+        }
+    }
+    if (!impl_->db->Write(rocksdb::WriteOptions(), &batch).ok()) {
+        return cursor;
+    }
+    return std::nullopt;
+}
+
+bool PersistentStorage::storeStateBatch(const std::vector<StateWrite>& writes, bool sync) {
+    rocksdb::WriteBatch batch;
+    for (const auto& write : writes) {
+        if (write.value) {
+            batch.Put(impl_->cf(CF_STATE), write.key, as_slice(*write.value));
+        } else {
+            batch.Delete(impl_->cf(CF_STATE), write.key);
+        }
+    }
+
+    rocksdb::WriteOptions options;
+    options.sync = sync;
+    return impl_->db->Write(options, &batch).ok();
+}
+
+std::optional<std::vector<uint8_t>> PersistentStorage::loadState(const std::string& key) {
+    auto value = impl_->get(CF_STATE, key);
+    if (value) {
+        return std::vector<uint8_t>(value->begin(), value->end());
+    }
+
+    return std::nullopt;
+}
+
+utils::Task<std::optional<std::vector<uint8_t>>> PersistentStorage::loadStateAsync(std::string key) {
+    co_return co_await utils::offload(utils::TaskPriority::Execution, [this, &key] { return loadState(key); });
+}
+
+void PersistentStorage::scanState(
+    const std::string& prefix,
+    const std::function<bool(const std::string&, const std::vector<uint8_t>&)>& fn
+) {
+    std::unique_ptr<rocksdb::Iterator> it(impl_->db->NewIterator(rocksdb::ReadOptions(), impl_->cf(CF_STATE)));
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next()) {
+        rocksdb::Slice value = it->value();
+        std::vector<uint8_t> data(value.data(), value.data() + value.size());
+        if (!fn(it->key().ToString(), data)) {
+            break;
+        }
+    }
+}
+
+bool PersistentStorage::writeStateFile(const std::string& path, const std::vector<StateEntry>& entries) {
+    // Same table layout as the family, so ingested files need no rewrite
+    const rocksdb::Options options(rocksdb::DBOptions(), family_options(CF_STATE, nullptr));
+    rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), options);
+    if (!writer.Open(path).ok()) {
+        return false;
+    }
+    for (const auto& [key, value] : entries) {
+        if (!writer.Put(key, as_slice(value)).ok()) {
+            return false;
+        }
+    }
+    return writer.Finish().ok();
+}
+
+bool PersistentStorage::readStateFile(
+    const std::string& path,
+    const std::function<bool(const std::string&, const std::vector<uint8_t>&)>& fn
+) {
+    const rocksdb::Options options(rocksdb::DBOptions(), family_options(CF_STATE, nullptr));
+    rocksdb::SstFileReader reader(options);
+    if (!reader.Open(path).ok() || !reader.VerifyChecksum().ok()) {
+        return false;
+    }
+    rocksdb::ReadOptions read_options;
+    read_options.verify_checksums = true;
+    std::unique_ptr<rocksdb::Iterator> it(reader.NewIterator(read_options));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        rocksdb::Slice value = it->value();
+        std::vector<uint8_t> data(value.data(), value.data() + value.size());
+        if (!fn(it->key().ToString(), data)) {
+            return true;
+        }
+    }
+    return it->status().ok();
+}
+
+bool PersistentStorage::ingestStateFiles(const std::vector<std::string>& paths, bool move_files) {
+    if (paths.empty()) {
+        return true;
+    }
+    rocksdb::IngestExternalFileOptions options;
+    options.move_files = move_files;
+    options.verify_checksums_before_ingest = true;
+    return impl_->db->IngestExternalFile(impl_->cf(CF_STATE), paths, options).ok();
+}
+
 } // namespace storage
-} // namespace quids 
\ No newline at end of file
+} // namespace quids
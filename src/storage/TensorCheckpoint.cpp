@@ -0,0 +1,291 @@
+#include "storage/TensorCheckpoint.hpp"
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace quids {
+namespace storage {
+
+namespace {
+
+constexpr char MAGIC[8] = {'Q', 'U', 'I', 'D', 'S', 'T', 'N', 'S'};
+constexpr uint32_t FORMAT_VERSION = 1;
+// magic | format u32 | count u32 | table length u64 | table checksum u64
+constexpr size_t HEADER_FIELDS = 32;
+constexpr size_t MAX_RANK = 8;
+
+static_assert(HEADER_FIELDS <= TensorCheckpoint::ALIGNMENT);
+
+void put_le(std::vector<uint8_t>& out, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t get_le(const uint8_t* in, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t align_up(uint64_t offset) {
+    return (offset + TensorCheckpoint::ALIGNMENT - 1) & ~uint64_t{TensorCheckpoint::ALIGNMENT - 1};
+}
+
+uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+bool write_all(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = ::write(fd, data, len);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        len -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Bounds-checked cursor over the mapped table
+struct Reader {
+    const uint8_t* at;
+    const uint8_t* end;
+
+    bool take(size_t n, const uint8_t*& out) {
+        if (static_cast<size_t>(end - at) < n) {
+            return false;
+        }
+        out = at;
+        at += n;
+        return true;
+    }
+
+    bool le(size_t width, uint64_t& value) {
+        const uint8_t* p = nullptr;
+        if (!take(width, p)) {
+            return false;
+        }
+        value = get_le(p, width);
+        return true;
+    }
+};
+
+} // namespace
+
+size_t TensorCheckpoint::dtype_size(DType dtype) {
+    switch (dtype) {
+        case DType::Float32: return 4;
+        case DType::Float64: return 8;
+        case DType::Int8: return 1;
+        case DType::Int32: return 4;
+        case DType::UInt8: return 1;
+    }
+    return 0;
+}
+
+uint64_t TensorCheckpoint::TensorView::elements() const {
+    uint64_t count = 1;
+    for (uint64_t dim : shape) {
+        count *= dim;
+    }
+    return count;
+}
+
+// Word-at-a-time multiply-rotate mix; catches corruption, not tampering
+uint64_t TensorCheckpoint::checksum(std::span<const uint8_t> data) noexcept {
+    constexpr uint64_t P1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    uint64_t h = P1 ^ data.size();
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h = rotl(h ^ (rotl(word * P2, 31) * P1), 27) * P1 + P2;
+    }
+    for (; i < data.size(); ++i) {
+        h = rotl(h ^ (data[i] * P1), 11) * P2;
+    }
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    return h;
+}
+
+void TensorCheckpoint::Writer::add(std::string name, DType dtype, std::vector<uint64_t> shape,
+                                   std::span<const uint8_t> bytes) {
+    if (name.empty() || name.size() > std::numeric_limits<uint16_t>::max() || shape.size() > MAX_RANK ||
+        dtype_size(dtype) == 0) {
+        throw std::invalid_argument("Invalid tensor name, rank or dtype");
+    }
+    TensorView shape_only{dtype, shape, {}};
+    if (shape_only.elements() * dtype_size(dtype) != bytes.size()) {
+        throw std::invalid_argument("Tensor size does not match its shape");
+    }
+    for (const auto& entry : entries_) {
+        if (entry.name == name) {
+            throw std::invalid_argument("Duplicate tensor " + name);
+        }
+    }
+    entries_.push_back({std::move(name), dtype, std::move(shape), {bytes.begin(), bytes.end()}});
+}
+
+void TensorCheckpoint::Writer::write(const std::string& path) const {
+    // Table size first, so data offsets are known while it is built
+    uint64_t table_length = 0;
+    for (const auto& entry : entries_) {
+        table_length += 2 + entry.name.size() + 2 + 8 * entry.shape.size() + 24;
+    }
+    uint64_t offset = align_up(ALIGNMENT + table_length);
+
+    std::vector<uint8_t> table;
+    table.reserve(table_length);
+    std::vector<uint64_t> offsets;
+    for (const auto& entry : entries_) {
+        put_le(table, entry.name.size(), 2);
+        table.insert(table.end(), entry.name.begin(), entry.name.end());
+        put_le(table, static_cast<uint8_t>(entry.dtype), 1);
+        put_le(table, entry.shape.size(), 1);
+        for (uint64_t dim : entry.shape) {
+            put_le(table, dim, 8);
+        }
+        put_le(table, offset, 8);
+        put_le(table, entry.bytes.size(), 8);
+        put_le(table, checksum(entry.bytes), 8);
+        offsets.push_back(offset);
+        offset = align_up(offset + entry.bytes.size());
+    }
+
+    std::vector<uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+    put_le(header, FORMAT_VERSION, 4);
+    put_le(header, entries_.size(), 4);
+    put_le(header, table_length, 8);
+    put_le(header, checksum(table), 8);
+    header.resize(ALIGNMENT, 0);
+
+    const std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create " + temporary);
+    }
+    const std::vector<uint8_t> padding(ALIGNMENT, 0);
+    uint64_t written = ALIGNMENT + table_length;
+    bool ok = write_all(fd, header.data(), header.size()) && write_all(fd, table.data(), table.size());
+    for (size_t i = 0; ok && i < entries_.size(); ++i) {
+        ok = write_all(fd, padding.data(), offsets[i] - written) &&
+             write_all(fd, entries_[i].bytes.data(), entries_[i].bytes.size());
+        written = offsets[i] + entries_[i].bytes.size();
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || ::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+        throw std::runtime_error("Failed to write checkpoint " + path);
+    }
+}
+
+std::shared_ptr<const TensorCheckpoint> TensorCheckpoint::open(const std::string& path, bool verify) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < ALIGNMENT) {
+        ::close(fd);
+        return nullptr;
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    void* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return nullptr;
+    }
+    std::shared_ptr<TensorCheckpoint> checkpoint(new TensorCheckpoint());
+    checkpoint->base_ = static_cast<const uint8_t*>(base);
+    checkpoint->size_ = size;
+
+    const uint8_t* data = checkpoint->base_;
+    if (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || get_le(data + 8, 4) != FORMAT_VERSION) {
+        return nullptr;
+    }
+    const uint64_t count = get_le(data + 12, 4);
+    const uint64_t table_length = get_le(data + 16, 8);
+    if (table_length > size - ALIGNMENT ||
+        checksum({data + ALIGNMENT, static_cast<size_t>(table_length)}) != get_le(data + 24, 8)) {
+        return nullptr;
+    }
+
+    Reader table{data + ALIGNMENT, data + ALIGNMENT + table_length};
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t name_length = 0;
+        uint64_t dtype = 0;
+        uint64_t rank = 0;
+        const uint8_t* name = nullptr;
+        if (!table.le(2, name_length) || !table.take(name_length, name) ||
+            !table.le(1, dtype) || !table.le(1, rank) || rank > MAX_RANK) {
+            return nullptr;
+        }
+        Entry entry;
+        entry.view.dtype = static_cast<DType>(dtype);
+        entry.view.shape.resize(rank);
+        for (auto& dim : entry.view.shape) {
+            if (!table.le(8, dim)) {
+                return nullptr;
+            }
+        }
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        if (!table.le(8, offset) || !table.le(8, length) || !table.le(8, entry.checksum) ||
+            dtype_size(entry.view.dtype) == 0 || offset % ALIGNMENT != 0 ||
+            offset > size || length > size - offset ||
+            entry.view.elements() * dtype_size(entry.view.dtype) != length) {
+            return nullptr;
+        }
+        entry.view.bytes = {data + offset, static_cast<size_t>(length)};
+        if (!checkpoint->tensors_.emplace(std::string(reinterpret_cast<const char*>(name), name_length),
+                                          std::move(entry)).second) {
+            return nullptr;
+        }
+    }
+    if (verify && !checkpoint->verify()) {
+        return nullptr;
+    }
+    return checkpoint;
+}
+
+TensorCheckpoint::~TensorCheckpoint() {
+    if (base_) {
+        ::munmap(const_cast<uint8_t*>(base_), size_);
+    }
+}
+
+const TensorCheckpoint::TensorView* TensorCheckpoint::find(std::string_view name) const {
+    auto it = tensors_.find(name);
+    return it == tensors_.end() ? nullptr : &it->second.view;
+}
+
+const TensorCheckpoint::TensorView& TensorCheckpoint::at(std::string_view name) const {
+    if (const auto* view = find(name)) {
+        return *view;
+    }
+    throw std::out_of_range("No tensor named " + std::string(name));
+}
+
+bool TensorCheckpoint::verify() const {
+    for (const auto& [name, entry] : tensors_) {
+        if (checksum(entry.view.bytes) != entry.checksum) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace storage
+} // namespace quids
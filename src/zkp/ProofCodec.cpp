@@ -0,0 +1,320 @@
+#include "zkp/ProofCodec.hpp"
+#include <zstd.h>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace quids {
+namespace zkp {
+
+namespace {
+
+// Keeps the two proof types from ever sharing a body
+enum Kind : uint8_t { GENERATOR_PROOF = 0, COMMITMENT_PROOF = 1 };
+
+constexpr uint8_t FLAG_VALID = 0x01;
+constexpr size_t HEADER_SIZE = 2;
+// Refuse to allocate more than this for the body of a hostile proof
+constexpr uint64_t MAX_BODY_SIZE = 16ULL << 20;
+constexpr double TURN = 2.0 * M_PI;
+constexpr double PHASE_STEPS = 4294967296.0;  // 2^32
+
+using Bytes = std::vector<uint8_t>;
+
+[[noreturn]] void malformed(const char* what) {
+    throw std::runtime_error(std::string("Malformed proof encoding: ") + what);
+}
+
+void put_varint(Bytes& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void put_le(Bytes& out, uint64_t v, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+uint32_t phase_to_fixed(double angle) {
+    if (!std::isfinite(angle)) {
+        throw std::invalid_argument("Phase angle is not finite");
+    }
+    const double turns = angle / TURN;
+    const double fraction = turns - std::floor(turns);
+    // A fraction that rounds up to a whole turn wraps to 0
+    return static_cast<uint32_t>(static_cast<uint64_t>(std::llround(fraction * PHASE_STEPS)));
+}
+
+double fixed_to_phase(uint32_t fixed) {
+    return static_cast<double>(fixed) * (TURN / PHASE_STEPS);
+}
+
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> data) : p_(data.data()), end_(data.data() + data.size()) {}
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p_ == end_) malformed("truncated varint");
+            const uint8_t b = *p_++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                // Only the shortest form is canonical
+                if (b == 0 && shift != 0) malformed("overlong varint");
+                if (shift == 63 && b > 1) malformed("varint overflows");
+                return v;
+            }
+        }
+        malformed("varint too long");
+    }
+
+    // A count of items at least item_size bytes each, bounded by what is left
+    uint64_t count(size_t item_size) {
+        const uint64_t n = varint();
+        if (n > remaining() / item_size) malformed("count exceeds input");
+        return n;
+    }
+
+    const uint8_t* bytes(uint64_t n) {
+        if (n > remaining()) malformed("truncated field");
+        const uint8_t* start = p_;
+        p_ += n;
+        return start;
+    }
+
+    uint64_t le(size_t width) {
+        const uint8_t* in = bytes(width);
+        uint64_t v = 0;
+        for (size_t i = 0; i < width; ++i) {
+            v |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return v;
+    }
+
+    uint8_t byte() { return *bytes(1); }
+    uint64_t remaining() const { return static_cast<uint64_t>(end_ - p_); }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+void put_timestamp(Bytes& out, std::chrono::system_clock::time_point timestamp) {
+    put_varint(out, zigzag(std::chrono::duration_cast<std::chrono::microseconds>(
+        timestamp.time_since_epoch()).count()));
+}
+
+std::chrono::system_clock::time_point get_timestamp(Reader& in) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::microseconds(unzigzag(in.varint()))));
+}
+
+void put_bytes(Bytes& out, std::span<const uint8_t> bytes) {
+    put_varint(out, bytes.size());
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+Bytes get_bytes(Reader& in) {
+    const uint64_t n = in.count(1);
+    const uint8_t* data = in.bytes(n);
+    return Bytes(data, data + n);
+}
+
+Bytes wrap(Bytes body, ProofCodec::Coding coding, int level) {
+    Bytes out{ProofCodec::VERSION, static_cast<uint8_t>(ProofCodec::Coding::Raw)};
+    if (coding == ProofCodec::Coding::Zstd) {
+        Bytes packed(ZSTD_compressBound(body.size()));
+        const size_t n = ZSTD_compress(packed.data(), packed.size(), body.data(), body.size(), level);
+        if (ZSTD_isError(n)) {
+            throw std::runtime_error(std::string("ZSTD compression failed: ") + ZSTD_getErrorName(n));
+        }
+        Bytes length;
+        put_varint(length, body.size());
+        if (length.size() + n < body.size()) {
+            out[1] = static_cast<uint8_t>(ProofCodec::Coding::Zstd);
+            out.insert(out.end(), length.begin(), length.end());
+            out.insert(out.end(), packed.begin(), packed.begin() + static_cast<std::ptrdiff_t>(n));
+            return out;
+        }
+    }
+    out.insert(out.end(), body.begin(), body.end());
+    return out;
+}
+
+// The body in place for a raw encoding; otherwise decompressed into storage
+std::span<const uint8_t> unwrap(std::span<const uint8_t> encoded, Bytes& storage) {
+    if (encoded.size() < HEADER_SIZE) malformed("truncated header");
+    if (encoded[0] != ProofCodec::VERSION) malformed("unknown version");
+    const auto payload = encoded.subspan(HEADER_SIZE);
+    switch (static_cast<ProofCodec::Coding>(encoded[1])) {
+        case ProofCodec::Coding::Raw:
+            return payload;
+        case ProofCodec::Coding::Zstd: {
+            Reader in(payload);
+            const uint64_t size = in.varint();
+            if (size > MAX_BODY_SIZE) malformed("body too large");
+            const uint64_t stored = in.remaining();
+            const uint8_t* frame = in.bytes(stored);
+            storage.resize(size);
+            const size_t n = ZSTD_decompress(storage.data(), storage.size(), frame, stored);
+            if (ZSTD_isError(n) || n != size) malformed("body does not decompress");
+            return storage;
+        }
+    }
+    malformed("unknown coding");
+}
+
+Bytes encode_body(const QZKPGenerator::Proof& proof) {
+    Bytes out;
+    out.reserve(16 + proof.proof_data.size() + proof.commitment.size() * 16 +
+                proof.measurement_qubits.size() * 2 + proof.phase_angles.size() * 4 +
+                proof.measurement_outcomes.size() / 8);
+    out.push_back(GENERATOR_PROOF);
+    out.push_back(proof.is_valid ? FLAG_VALID : 0);
+    put_timestamp(out, proof.timestamp);
+    put_bytes(out, proof.proof_data);
+
+    put_varint(out, proof.commitment.size());
+    for (const auto& amplitude : proof.commitment) {
+        put_le(out, std::bit_cast<uint64_t>(amplitude.real()), 8);
+        put_le(out, std::bit_cast<uint64_t>(amplitude.imag()), 8);
+    }
+
+    put_varint(out, proof.measurement_qubits.size());
+    for (size_t qubit : proof.measurement_qubits) {
+        put_varint(out, qubit);
+    }
+
+    put_varint(out, proof.phase_angles.size());
+    for (double angle : proof.phase_angles) {
+        put_le(out, phase_to_fixed(angle), 4);
+    }
+
+    const size_t outcomes = proof.measurement_outcomes.size();
+    put_varint(out, outcomes);
+    for (size_t i = 0; i < outcomes; i += 8) {
+        uint8_t packed = 0;
+        for (size_t bit = 0; bit < 8 && i + bit < outcomes; ++bit) {
+            packed |= static_cast<uint8_t>(proof.measurement_outcomes[i + bit]) << bit;
+        }
+        out.push_back(packed);
+    }
+    return out;
+}
+
+QZKPGenerator::Proof decode_body(std::span<const uint8_t> body) {
+    Reader in(body);
+    if (in.byte() != GENERATOR_PROOF) malformed("not a generator proof");
+    const uint8_t flags = in.byte();
+    if (flags & ~FLAG_VALID) malformed("unknown flags");
+
+    QZKPGenerator::Proof proof;
+    proof.is_valid = (flags & FLAG_VALID) != 0;
+    proof.timestamp = get_timestamp(in);
+    proof.proof_data = get_bytes(in);
+
+    proof.commitment.resize(in.count(16));
+    for (auto& amplitude : proof.commitment) {
+        const double re = std::bit_cast<double>(in.le(8));
+        const double im = std::bit_cast<double>(in.le(8));
+        amplitude = {re, im};
+    }
+
+    proof.measurement_qubits.resize(in.count(1));
+    for (auto& qubit : proof.measurement_qubits) {
+        const uint64_t value = in.varint();
+        if (value > SIZE_MAX) malformed("qubit index out of range");
+        qubit = static_cast<size_t>(value);
+    }
+
+    proof.phase_angles.resize(in.count(4));
+    for (auto& angle : proof.phase_angles) {
+        angle = fixed_to_phase(static_cast<uint32_t>(in.le(4)));
+    }
+
+    const uint64_t outcomes = in.varint();
+    if (outcomes > in.remaining() * 8) malformed("count exceeds input");
+    const uint8_t* packed = in.bytes((outcomes + 7) / 8);
+    proof.measurement_outcomes.resize(outcomes);
+    for (uint64_t i = 0; i < outcomes; ++i) {
+        proof.measurement_outcomes[i] = (packed[i / 8] >> (i % 8)) & 1;
+    }
+    if (outcomes % 8 != 0 && (packed[outcomes / 8] >> (outcomes % 8)) != 0) {
+        malformed("padding bits set");
+    }
+
+    if (in.remaining() != 0) malformed("trailing bytes");
+    return proof;
+}
+
+} // namespace
+
+std::vector<uint8_t> ProofCodec::encode(const QZKPGenerator::Proof& proof, Coding coding, int level) {
+    return wrap(encode_body(proof), coding, level);
+}
+
+std::vector<uint8_t> ProofCodec::encode(const QZKPProof& proof, Coding coding, int level) {
+    Bytes body;
+    body.reserve(12 + proof.proof_data.size());
+    body.push_back(COMMITMENT_PROOF);
+    put_timestamp(body, proof.timestamp);
+    put_bytes(body, proof.proof_data);
+    return wrap(std::move(body), coding, level);
+}
+
+QZKPGenerator::Proof ProofCodec::decode(std::span<const uint8_t> encoded) {
+    Bytes storage;
+    return decode_body(unwrap(encoded, storage));
+}
+
+QZKPProof ProofCodec::decode_commitment(std::span<const uint8_t> encoded) {
+    Bytes storage;
+    Reader in(unwrap(encoded, storage));
+    if (in.byte() != COMMITMENT_PROOF) malformed("not a commitment proof");
+    QZKPProof proof;
+    proof.timestamp = get_timestamp(in);
+    proof.proof_data = get_bytes(in);
+    if (in.remaining() != 0) malformed("trailing bytes");
+    return proof;
+}
+
+std::vector<uint8_t> ProofCodec::body(std::span<const uint8_t> encoded) {
+    Bytes storage;
+    const auto view = unwrap(encoded, storage);
+    if (!storage.empty()) {
+        return storage;
+    }
+    return Bytes(view.begin(), view.end());
+}
+
+ProofCodec::Hash ProofCodec::hash(std::span<const uint8_t> encoded) {
+    Bytes storage;
+    return crypto::MerkleBuilder::hashLeaf(unwrap(encoded, storage));
+}
+
+ProofCodec::Hash ProofCodec::hash(const QZKPGenerator::Proof& proof) {
+    return crypto::MerkleBuilder::hashLeaf(encode_body(proof));
+}
+
+double ProofCodec::quantize_phase(double angle) {
+    return fixed_to_phase(phase_to_fixed(angle));
+}
+
+} // namespace zkp
+} // namespace quids
@@ -20,8 +20,12 @@ static const std::vector<double> DEFAULT_PHASE_ANGLES = { 0.0, M_PI_4, M_PI_2, 3
 static constexpr size_t DEFAULT_MEASUREMENT_QUBITS = 8;
 
 #include "quantum/QuantumState.hpp"
+#include "quantum/StateBatch.hpp"
 #include <blake3.h>
 #include "zkp/QZKPGenerator.hpp"
+#include "zkp/ProofCodec.hpp"
+#include "utils/RandomService.hpp"
+#include "utils/WorkStealingPool.hpp"
 #include <random>
 #include <chrono>
 #include <complex>
@@ -29,6 +33,7 @@ static constexpr size_t DEFAULT_MEASUREMENT_QUBITS = 8;
 #include <algorithm>
 #include <thread>
 #include <array>
+#include <map>
 
 namespace quids {
 namespace zkp {
@@ -85,6 +90,53 @@ QZKPGenerator::Proof QZKPGenerator::generate_proof(const quantum::QuantumState&
     return proof;
 }
 
+std::vector<QZKPGenerator::Proof> QZKPGenerator::generate_proof_batch(
+    const std::vector<quantum::QuantumState>& states
+) {
+    std::vector<Proof> proofs(states.size());
+
+    // Positions of the states of each qubit count, in input order
+    std::map<size_t, std::vector<size_t>> groups;
+    for (size_t i = 0; i < states.size(); i++) {
+        groups[states[i].getNumQubits()].push_back(i);
+    }
+
+    for (const auto& [n_qubits, members] : groups) {
+        std::vector<quantum::QuantumState> group;
+        group.reserve(members.size());
+        for (size_t i : members) {
+            group.push_back(states[i]);
+        }
+        quantum::StateBatch batch(group);
+
+        // Same challenge for the whole batch, as generate_proof builds it
+        auto measurements = generate_random_measurements(optimal_measurement_qubits_);
+        auto phases = generate_random_phases();
+        for (size_t q = 0; q < phases.size(); q++) {
+            batch.applyPhase(q, phases[q]);
+        }
+
+        std::vector<std::vector<bool>> outcomes(members.size());
+        for (size_t qubit : measurements) {
+            auto results = batch.applyMeasurement(qubit);
+            for (size_t k = 0; k < members.size(); k++) {
+                outcomes[k].push_back(results[k]);
+            }
+        }
+
+        const auto now = std::chrono::system_clock::now();
+        for (size_t k = 0; k < members.size(); k++) {
+            Proof& proof = proofs[members[k]];
+            proof.measurement_outcomes = std::move(outcomes[k]);
+            proof.measurement_qubits = measurements;
+            proof.phase_angles = phases;
+            proof.timestamp = now;
+        }
+    }
+
+    return proofs;
+}
+
 bool QZKPGenerator::verify_proof(const Proof& proof, const quantum::QuantumState& state) const {
     if (!proof.is_valid) {
         return false;
@@ -109,28 +161,21 @@ bool QZKPGenerator::verify_proof(const Proof& proof, const quantum::QuantumState
 }
 
 std::vector<size_t> QZKPGenerator::generate_random_measurements(size_t n_qubits) {
-    std::vector<size_t> measurements;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<size_t> dist(0, n_qubits - 1);
-    
-    for (size_t i = 0; i < optimal_measurement_qubits_; i++) {
-        measurements.push_back(dist(gen));
+    auto& rng = utils::RandomService::global().local();
+    std::vector<size_t> measurements(optimal_measurement_qubits_);
+    for (auto& qubit : measurements) {
+        qubit = static_cast<size_t>(rng.below(n_qubits));
     }
-    
     return measurements;
 }
 
 std::vector<double> QZKPGenerator::generate_random_phases() {
-    std::vector<double> phases;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<double> dist(0, 2 * M_PI);
-    
-    for (size_t i = 0; i < optimal_phase_angles_.size(); i++) {
-        phases.push_back(dist(gen));
+    auto& rng = utils::RandomService::global().local();
+    std::vector<double> phases(optimal_phase_angles_.size());
+    for (auto& phase : phases) {
+        // On the encoding's grid, so a proof survives ProofCodec unchanged
+        phase = ProofCodec::quantize_phase(2 * M_PI * rng.uniform());
     }
-    
     return phases;
 }
 
@@ -191,22 +236,14 @@ QZKPGenerator::Proof QZKPGenerator::generate_proof_parallel(
     const quantum::QuantumState& state
 ) {
     constexpr size_t NUM_THREADS = 4;
-    std::vector<std::thread> threads;
     std::vector<std::vector<uint8_t>> partial_proofs(NUM_THREADS);
     
     // Generate partial proofs in parallel
-    for (size_t i = 0; i < NUM_THREADS; i++) {
-        threads.emplace_back([&, i]() {
-            auto start_idx = (state.size() * i) / NUM_THREADS;
-            auto end_idx = (state.size() * (i + 1)) / NUM_THREADS;
-            partial_proofs[i] = generate_partial_proof(state, start_idx, end_idx);
-        });
-    }
-    
-    // Wait for all threads
-    for (auto& thread : threads) {
-        thread.join();
-    }
+    utils::WorkStealingPool::global().parallel_for(0, NUM_THREADS, [&](size_t i) {
+        auto start_idx = (state.size() * i) / NUM_THREADS;
+        auto end_idx = (state.size() * (i + 1)) / NUM_THREADS;
+        partial_proofs[i] = generate_partial_proof(state, start_idx, end_idx);
+    }, utils::TaskPriority::Proof);
     
     // Combine partial proofs
     return combine_partial_proofs(partial_proofs);
@@ -1,11 +1,74 @@
 #include "zkp/QZKPVerifier.hpp"
+#include "utils/RandomService.hpp"
+#include "utils/WorkStealingPool.hpp"
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace quids {
 namespace zkp {
 
+SequentialMatchTest::SequentialMatchTest(
+    double required_rate,
+    double confidence,
+    size_t population,
+    size_t chunk_size
+) : required_rate_(required_rate),
+    population_(population) {
+    if (population == 0 || chunk_size == 0) {
+        throw std::invalid_argument("Sequential test needs items and a chunk size");
+    }
+    if (!(confidence > 0.0 && confidence < 1.0) || !(required_rate > 0.0 && required_rate <= 1.0)) {
+        throw std::invalid_argument("Confidence must be in (0, 1) and required rate in (0, 1]");
+    }
+    // Two-sided, split evenly over every look
+    const size_t looks = (population + chunk_size - 1) / chunk_size;
+    log_term_ = std::log(2.0 * static_cast<double>(looks) / (1.0 - confidence));
+}
+
+double SequentialMatchTest::radius() const {
+    if (checked_ == 0) {
+        return 1.0;
+    }
+    const double n = static_cast<double>(checked_);
+    const double finite_population = 1.0 - (n - 1.0) / static_cast<double>(population_);
+    return std::sqrt(finite_population * log_term_ / (2.0 * n));
+}
+
+double SequentialMatchTest::lower_bound() const {
+    const double rate = checked_ == 0 ? 0.0 : static_cast<double>(matched_) / checked_;
+    return std::max(0.0, rate - radius());
+}
+
+double SequentialMatchTest::upper_bound() const {
+    const double rate = checked_ == 0 ? 1.0 : static_cast<double>(matched_) / checked_;
+    return std::min(1.0, rate + radius());
+}
+
+SequentialMatchTest::Decision SequentialMatchTest::update(size_t checked, size_t matched) {
+    checked_ = std::min(population_, checked_ + checked);
+    matched_ = std::min(checked_, matched_ + matched);
+
+    // Settled whatever the unchecked items hold
+    const double population = static_cast<double>(population_);
+    if (static_cast<double>(matched_) / population >= required_rate_) {
+        return Decision::ACCEPT;
+    }
+    if (static_cast<double>(matched_ + (population_ - checked_)) / population < required_rate_) {
+        return Decision::REJECT;
+    }
+
+    if (lower_bound() >= required_rate_) {
+        return Decision::ACCEPT;
+    }
+    if (upper_bound() < required_rate_) {
+        return Decision::REJECT;
+    }
+    return Decision::CONTINUE;
+}
+
 QZKPVerifier::QZKPVerifier() noexcept 
     : confidence_threshold_(0.95),
       measurement_tolerance_(0.1),
@@ -29,19 +92,105 @@ void QZKPVerifier::set_fidelity_threshold(double threshold) {
     }
 }
 
+PreparedVerifier::PreparedVerifier(const quantum::QuantumState& claimed_state)
+    : reference_outcomes_(claimed_state.getMeasurementOutcomes()) {}
+
+double PreparedVerifier::phase_term(const std::vector<double>& phase_angles) const {
+    if (phase_angles.empty()) {
+        return 0.0;
+    }
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (auto it = phase_terms_.find(phase_angles); it != phase_terms_.end()) {
+            return it->second;
+        }
+    }
+
+    double term = 0.0;
+    for (double angle : phase_angles) {
+        term += std::cos(angle);
+    }
+    term /= static_cast<double>(phase_angles.size());
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (phase_terms_.size() >= MAX_PHASE_SETS) {
+        phase_terms_.clear();
+    }
+    phase_terms_.emplace(phase_angles, term);
+    return term;
+}
+
+std::shared_ptr<const PreparedVerifier> QZKPVerifier::prepare(const quantum::QuantumState& claimed_state) {
+    return std::make_shared<const PreparedVerifier>(claimed_state);
+}
+
 QZKPVerifier::VerificationDetails QZKPVerifier::verify_proof(
     const quantum::QuantumState& claimed_state,
     const QZKPGenerator::Proof& proof
 ) {
+    return verify_proof(PreparedVerifier(claimed_state), proof);
+}
+
+QZKPVerifier::VerificationDetails QZKPVerifier::verify_proof(
+    const PreparedVerifier& prepared,
+    const QZKPGenerator::Proof& proof
+) {
+    last_verification_ = check_proof(prepared, proof);
+    return last_verification_;
+}
+
+std::vector<QZKPVerifier::VerificationDetails> QZKPVerifier::verify_batch(
+    const PreparedVerifier& prepared,
+    std::span<const QZKPGenerator::Proof> proofs
+) {
+    std::vector<VerificationDetails> results(proofs.size());
+    utils::WorkStealingPool::global().parallel_for(0, proofs.size(), [&](size_t i) {
+        results[i] = check_proof(prepared, proofs[i]);
+    });
+    if (!results.empty()) {
+        last_verification_ = results.back();
+    }
+    return results;
+}
+
+std::vector<QZKPVerifier::VerificationDetails> QZKPVerifier::verify_batch(
+    std::span<const quantum::QuantumState* const> claimed_states,
+    std::span<const QZKPGenerator::Proof> proofs
+) {
+    if (claimed_states.size() != proofs.size()) {
+        throw std::invalid_argument("verify_batch needs one claimed state per proof");
+    }
+
+    // Prepared up front so the parallel pass only reads
+    std::unordered_map<const quantum::QuantumState*, std::shared_ptr<const PreparedVerifier>> prepared;
+    for (const auto* state : claimed_states) {
+        if (!prepared.contains(state)) {
+            prepared.emplace(state, prepare(*state));
+        }
+    }
+
+    std::vector<VerificationDetails> results(proofs.size());
+    utils::WorkStealingPool::global().parallel_for(0, proofs.size(), [&](size_t i) {
+        results[i] = check_proof(*prepared.at(claimed_states[i]), proofs[i]);
+    });
+    if (!results.empty()) {
+        last_verification_ = results.back();
+    }
+    return results;
+}
+
+QZKPVerifier::VerificationDetails QZKPVerifier::check_proof(
+    const PreparedVerifier& prepared,
+    const QZKPGenerator::Proof& proof
+) const {
     VerificationDetails details;
     details.phase_angles = proof.phase_angles;
     
     // Verify measurement consistency
     size_t matching_count = 0;
-    auto state_measurements = claimed_state.get_measurement_outcomes();
     details.measurements_match = verify_measurement_consistency(
         proof.measurement_outcomes, 
-        state_measurements,
+        prepared.reference_outcomes(),
         matching_count
     );
     
@@ -52,29 +201,83 @@ QZKPVerifier::VerificationDetails QZKPVerifier::verify_proof(
         details.fidelity = 0.0;
         details.total_measurements = proof.measurement_outcomes.size();
         details.matching_measurements = matching_count;
-        last_verification_ = details;
+        details.checked_measurements = details.total_measurements;
         return details;
     }
     
     // Calculate confidence score and fidelity
     details.confidence_score = calculate_confidence_score(
         proof, 
-        claimed_state,
+        prepared,
         details.fidelity,
         details.total_measurements,
         details.matching_measurements
     );
+    details.checked_measurements = details.total_measurements;
     
     // Verify minimum confidence threshold
     if (details.confidence_score < confidence_threshold_) {
         details.result = VerificationResult::INCONCLUSIVE;
         details.message = "Confidence score too low";
-        last_verification_ = details;
         return details;
     }
     
     details.result = VerificationResult::VALID;
     details.message = "Proof verified successfully";
+    return details;
+}
+
+QZKPVerifier::VerificationDetails QZKPVerifier::verify_proof_sequential(
+    const quantum::QuantumState& claimed_state,
+    const QZKPGenerator::Proof& proof,
+    size_t chunk_size
+) {
+    VerificationDetails details;
+    details.phase_angles = proof.phase_angles;
+    
+    const auto state_measurements = claimed_state.getMeasurementOutcomes();
+    const size_t total = proof.measurement_outcomes.size();
+    details.total_measurements = total;
+    if (total == 0 || state_measurements.size() != total) {
+        details.result = VerificationResult::INVALID;
+        details.message = "Measurement outcomes do not match";
+        last_verification_ = details;
+        return details;
+    }
+    
+    // A random order, so a prover cannot hide mismatches where checking stops
+    std::vector<size_t> order(total);
+    std::iota(order.begin(), order.end(), 0);
+    utils::RandomService::global().local().shuffle(order.begin(), order.end());
+    
+    chunk_size = std::max<size_t>(1, chunk_size);
+    SequentialMatchTest test(1.0 - measurement_tolerance_, confidence_threshold_, total, chunk_size);
+    auto decision = SequentialMatchTest::Decision::CONTINUE;
+    for (size_t first = 0; decision == SequentialMatchTest::Decision::CONTINUE; first += chunk_size) {
+        const size_t last = std::min(total, first + chunk_size);
+        size_t matched = 0;
+        for (size_t i = first; i < last; ++i) {
+            matched += proof.measurement_outcomes[order[i]] == state_measurements[order[i]];
+        }
+        decision = test.update(last - first, matched);
+    }
+    
+    details.checked_measurements = test.checked();
+    details.matching_measurements = test.matched();
+    details.fidelity = static_cast<double>(test.matched()) / test.checked();
+    details.measurements_match = decision == SequentialMatchTest::Decision::ACCEPT;
+    if (!details.measurements_match) {
+        details.result = VerificationResult::INVALID;
+        details.message = "Measurement outcomes do not match";
+        last_verification_ = details;
+        return details;
+    }
+    
+    details.result = VerificationResult::VALID;
+    // A decision settled by the checked matches alone is certain
+    details.confidence_score = std::max(test.lower_bound(), static_cast<double>(test.matched()) / total);
+    details.message = "Proof verified after " + std::to_string(test.checked()) + " of " +
+                      std::to_string(total) + " measurements";
     last_verification_ = details;
     return details;
 }
@@ -102,20 +305,19 @@ bool QZKPVerifier::verify_measurement_consistency(
 
 double QZKPVerifier::calculate_confidence_score(
     const QZKPGenerator::Proof& proof,
-    const quantum::QuantumState& state,
+    const PreparedVerifier& prepared,
     double& fidelity,
     size_t& total_measurements,
     size_t& matching_measurements
 ) const {
-    // Get state vector
-    auto state_vector = state.get_state_vector();
+    const auto& reference = prepared.reference_outcomes();
     total_measurements = proof.measurement_outcomes.size();
     matching_measurements = 0;
     
     // Calculate fidelity between proof and claimed state
     fidelity = 0.0;
     for (size_t i = 0; i < proof.measurement_outcomes.size(); i++) {
-        if (proof.measurement_outcomes[i] == state.get_measurement_outcomes()[i]) {
+        if (proof.measurement_outcomes[i] == reference[i]) {
             matching_measurements++;
             fidelity += 1.0;
         }
@@ -123,11 +325,7 @@ double QZKPVerifier::calculate_confidence_score(
     fidelity /= total_measurements;
     
     // Apply phase angle corrections
-    double phase_contribution = 0.0;
-    for (double angle : proof.phase_angles) {
-        phase_contribution += std::cos(angle);
-    }
-    phase_contribution /= proof.phase_angles.size();
+    const double phase_contribution = prepared.phase_term(proof.phase_angles);
     
     // Calculate final confidence score
     double measurement_confidence = static_cast<double>(matching_measurements) / total_measurements;
@@ -164,7 +362,7 @@ double QZKPVerifier::calculate_entanglement_fidelity(
     const EntanglementProof& proof
 ) const {
     // Get entanglement matrix
-    auto entanglement_matrix = state.generate_entanglement();
+    auto entanglement_matrix = state.generateEntanglement();
     
     // Calculate trace fidelity between state and proof
     double trace_fidelity = 0.0;
@@ -0,0 +1,51 @@
+#ifndef QUIDS_TESTS_TEST_STORAGE_HPP
+#define QUIDS_TESTS_TEST_STORAGE_HPP
+
+#include "storage/PersistentStorage.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+
+namespace quids::test {
+
+// A path under the temp directory that no other test, in this process or a
+// parallel ctest run, will pick
+inline std::filesystem::path uniqueTempPath(const std::string& prefix) {
+    static const auto run = std::random_device{}();
+    static std::atomic<uint64_t> counter{0};
+    return std::filesystem::temp_directory_path() /
+           (prefix + std::to_string(run) + "_" +
+            std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "_" +
+            std::to_string(counter++));
+}
+
+// Opens a PersistentStorage in a fresh directory and removes it afterwards.
+// Fixtures that own readers of storage_ reset them before calling TearDown().
+class TempStorageTest : public ::testing::Test {
+protected:
+    explicit TempStorageTest(std::string prefix) : prefix_(std::move(prefix)) {}
+
+    void SetUp() override {
+        dir_ = uniqueTempPath(prefix_);
+        storage_ = std::make_shared<storage::PersistentStorage>(dir_.string());
+    }
+
+    void TearDown() override {
+        storage_.reset();
+        std::filesystem::remove_all(dir_);
+    }
+
+    std::string prefix_;
+    std::filesystem::path dir_;
+    std::shared_ptr<storage::PersistentStorage> storage_;
+};
+
+} // namespace quids::test
+
+#endif // QUIDS_TESTS_TEST_STORAGE_HPP
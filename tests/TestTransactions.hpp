@@ -0,0 +1,57 @@
+#ifndef QUIDS_TESTS_TEST_TRANSACTIONS_HPP
+#define QUIDS_TESTS_TEST_TRANSACTIONS_HPP
+
+#include "blockchain/TransactionView.hpp"
+#include <blake3.h>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace quids::test {
+
+// A payload-free transfer in the canonical wire format, signed the way
+// TransactionView::verify() expects. `forge` flips a signature bit.
+inline blockchain::ByteVector signedTransferBytes(const std::string& from, const std::string& to,
+                                                  uint64_t value, uint64_t nonce, uint64_t gas = 0,
+                                                  bool forge = false) {
+    blockchain::ByteVector out{blockchain::wire::VERSION};
+    auto put = [&](uint64_t v, size_t width) {
+        for (size_t i = 0; i < width; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    };
+    put(1'700'000'000'000'000, 8);
+    put(value, 8);
+    put(nonce, 8);
+    put(gas, 8);
+    put(from.size(), 2);
+    put(to.size(), 2);
+    put(0, 4);
+    out.insert(out.end(), from.begin(), from.end());
+    out.insert(out.end(), to.begin(), to.end());
+
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, out.data(), out.size());
+    out.resize(out.size() + blockchain::wire::SIGNATURE_SIZE);
+    blake3_hasher_finalize(&hasher, out.data() + out.size() - blockchain::wire::SIGNATURE_SIZE,
+                           blockchain::wire::SIGNATURE_SIZE);
+    if (forge) {
+        out.back() ^= 1;
+    }
+    return out;
+}
+
+// signedTransferBytes() decoded into a transaction
+inline blockchain::TransactionPtr makeSignedTransfer(const std::string& from, const std::string& to,
+                                                     uint64_t value, uint64_t nonce, uint64_t gas = 0,
+                                                     bool forge = false) {
+    auto tx = std::make_shared<blockchain::StandardTransaction>();
+    if (!tx->deserialize(signedTransferBytes(from, to, value, nonce, gas, forge))) {
+        throw std::runtime_error("bad sample transfer");
+    }
+    return tx;
+}
+
+} // namespace quids::test
+
+#endif // QUIDS_TESTS_TEST_TRANSACTIONS_HPP
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "api/ResponseCache.hpp"
+#include <string>
+
+namespace quids {
+namespace api {
+namespace test {
+
+using Lifetime = ResponseCache::Lifetime;
+
+TEST(ResponseCacheTest, SharesOneBodyAndETagPerEntry) {
+    ResponseCache cache;
+    const auto put = cache.put("block/7", "{\"number\":7}", Lifetime::Final);
+    ASSERT_TRUE(put.body);
+    EXPECT_EQ(*put.body, "{\"number\":7}");
+    EXPECT_EQ(put.etag.front(), '"');
+    EXPECT_EQ(put.etag.back(), '"');
+
+    const auto first = cache.get("block/7");
+    const auto second = cache.get("block/7");
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(first->body.get(), put.body.get());
+    EXPECT_EQ(second->body.get(), put.body.get());
+    EXPECT_EQ(first->etag, put.etag);
+    EXPECT_FALSE(cache.get("block/8"));
+
+    // Another body under the same key gets another tag
+    const auto replaced = cache.put("block/7", "{\"number\":7,\"txs\":[]}", Lifetime::Final);
+    EXPECT_NE(replaced.etag, put.etag);
+    EXPECT_EQ(cache.get("block/7")->body.get(), replaced.body.get());
+    EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST(ResponseCacheTest, FinalEntriesAgeOutInTwoGenerations) {
+    ResponseCache cache(4);
+    cache.put("a", "1", Lifetime::Final);
+    cache.put("b", "2", Lifetime::Final);
+    // A full generation moves aside, still readable
+    cache.put("c", "3", Lifetime::Final);
+    EXPECT_TRUE(cache.get("a"));
+    cache.put("d", "4", Lifetime::Final);
+    // and is dropped when the next one fills
+    cache.put("e", "5", Lifetime::Final);
+    EXPECT_FALSE(cache.get("a"));
+    EXPECT_FALSE(cache.get("b"));
+    EXPECT_TRUE(cache.get("c"));
+    EXPECT_TRUE(cache.get("e"));
+    EXPECT_EQ(cache.size(), 3u);
+
+    // New blocks do not touch them
+    const auto before = cache.get("e")->etag;
+    cache.on_new_block();
+    EXPECT_EQ(cache.get("e")->etag, before);
+    EXPECT_EQ(cache.put("e", "5", Lifetime::Final).etag, before);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(ResponseCacheTest, HeadEntriesLastUntilTheNextBlock) {
+    ResponseCache cache;
+    const auto head = cache.put("head", "{\"number\":9}", Lifetime::UntilNextBlock);
+    cache.put("block/9", "{\"number\":9}", Lifetime::Final);
+    EXPECT_TRUE(cache.get("head"));
+
+    cache.on_new_block();
+    EXPECT_FALSE(cache.get("head"));
+    EXPECT_TRUE(cache.get("block/9"));
+
+    // The same body after a new block does not revalidate an old tag
+    const auto again = cache.put("head", "{\"number\":9}", Lifetime::UntilNextBlock);
+    EXPECT_NE(again.etag, head.etag);
+    EXPECT_FALSE(ResponseCache::matches(again, head.etag));
+}
+
+TEST(ResponseCacheTest, MatchesIfNoneMatchLists) {
+    ResponseCache cache;
+    const auto entry = cache.put("k", "body", Lifetime::Final);
+    const std::string& tag = entry.etag;
+
+    EXPECT_TRUE(ResponseCache::matches(entry, tag));
+    EXPECT_TRUE(ResponseCache::matches(entry, "*"));
+    EXPECT_TRUE(ResponseCache::matches(entry, "W/" + tag));
+    EXPECT_TRUE(ResponseCache::matches(entry, "\"other\", " + tag));
+    EXPECT_TRUE(ResponseCache::matches(entry, "\"other\" ,  W/" + tag + "  , \"more\""));
+    EXPECT_FALSE(ResponseCache::matches(entry, ""));
+    EXPECT_FALSE(ResponseCache::matches(entry, "\"other\""));
+    EXPECT_FALSE(ResponseCache::matches(entry, tag.substr(1)));
+    EXPECT_FALSE(ResponseCache::matches(entry, " , "));
+}
+
+} // namespace test
+} // namespace api
+} // namespace quids
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "api/SubmitPayload.hpp"
+#include "TestTransactions.hpp"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace quids {
+namespace api {
+namespace test {
+
+namespace {
+
+std::string to_hex(std::span<const uint8_t> bytes) {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    std::string out;
+    for (uint8_t b : bytes) {
+        out.push_back(DIGITS[b >> 4]);
+        out.push_back(DIGITS[b & 0xf]);
+    }
+    return out;
+}
+
+// The signature a correctly signed alice -> bob transfer carries
+std::string transfer_signature() {
+    const auto bytes = quids::test::signedTransferBytes("alice", "bob", 5, 1, 7);
+    return to_hex(std::span<const uint8_t>(bytes).last(blockchain::wire::SIGNATURE_SIZE));
+}
+
+} // namespace
+
+TEST(SubmitPayloadTest, ScansTheCommonShapeInPlace) {
+    const std::string body =
+        "{ \"sender\": \"alice\", \"recipient\":\"bob\",\n"
+        "  \"amount\": 5, \"nonce\": \"1\", \"gas_cost\":7,\t\"timestamp\": 1700000000000000,"
+        "  \"memo\": \"skipped\", \"urgent\": true, \"hint\": null, \"retries\": 3,"
+        "  \"signature\": \"0xabcd\", \"data\": \"\" }";
+    const auto payload = scan_submit_payload(body);
+    ASSERT_TRUE(payload);
+    EXPECT_EQ(payload->sender, "alice");
+    EXPECT_EQ(payload->recipient, "bob");
+    EXPECT_EQ(payload->signature, "0xabcd");
+    EXPECT_TRUE(payload->data.empty());
+    EXPECT_TRUE(payload->has_amount);
+    EXPECT_EQ(payload->amount, 5u);
+    EXPECT_EQ(payload->nonce, 1u);
+    EXPECT_EQ(payload->gas_cost, 7u);
+    EXPECT_EQ(payload->timestamp, 1700000000000000);
+    // Views into the body, not copies
+    EXPECT_GE(payload->sender.data(), body.data());
+    EXPECT_LT(payload->sender.data(), body.data() + body.size());
+
+    const auto empty = scan_submit_payload(" {} ");
+    ASSERT_TRUE(empty);
+    EXPECT_FALSE(empty->has_amount);
+    EXPECT_FALSE(empty->timestamp);
+}
+
+TEST(SubmitPayloadTest, LeavesAnythingElseToTheFullParser) {
+    for (const std::string_view body : {
+             "",
+             "[]",
+             "{\"sender\": \"alice\"",
+             "{\"sender\": \"alice\"} trailing",
+             "{\"sender\": \"al\\\"ice\"}",
+             "{\"sender\": 5}",
+             "{\"amount\": -5}",
+             "{\"amount\": 1.5}",
+             "{\"amount\": 1e3}",
+             "{\"amount\": 18446744073709551616}",
+             "{\"timestamp\": 9223372036854775808}",
+             "{\"memo\": {\"nested\": 1}}",
+             "{\"memo\": [1, 2]}",
+             "{\"memo\": maybe}",
+             "{\"sender\": \"alice\",}",
+             "{\"sender\" \"alice\"}",
+         }) {
+        EXPECT_FALSE(scan_submit_payload(body)) << body;
+    }
+    EXPECT_TRUE(scan_submit_payload("{\"amount\": 18446744073709551615}"));
+}
+
+TEST(SubmitPayloadTest, EncodesTheCanonicalWireFormat) {
+    const auto expected = quids::test::signedTransferBytes("alice", "bob", 5, 1, 7);
+    const std::string body = "{\"sender\":\"alice\",\"recipient\":\"bob\",\"amount\":5,\"nonce\":1,"
+                             "\"gas_cost\":7,\"timestamp\":1700000000000000,\"signature\":\"" +
+                             transfer_signature() + "\"}";
+    const auto payload = scan_submit_payload(body);
+    ASSERT_TRUE(payload);
+    const auto encoded = encode_submit_payload(*payload);
+    ASSERT_TRUE(encoded);
+    EXPECT_EQ(*encoded, expected);
+    const auto view = blockchain::TransactionView::parse(*encoded);
+    ASSERT_TRUE(view);
+    EXPECT_TRUE(view->verify());
+
+    // A raw encoding replaces every other field, and must parse
+    SubmitPayload raw;
+    const std::string hex = "0x" + to_hex(expected);
+    raw.raw = hex;
+    EXPECT_EQ(encode_submit_payload(raw), expected);
+    const std::string cut = hex.substr(0, hex.size() - 2);
+    raw.raw = cut;
+    EXPECT_FALSE(encode_submit_payload(raw));
+
+    // Without a timestamp the transaction is stamped now
+    auto unstamped = *payload;
+    unstamped.timestamp.reset();
+    const auto stamped = encode_submit_payload(unstamped);
+    ASSERT_TRUE(stamped);
+    EXPECT_GT(blockchain::TransactionView::parse(*stamped)->getTimestamp(),
+              blockchain::TransactionView::parse(expected)->getTimestamp());
+}
+
+TEST(SubmitPayloadTest, RefusesIncompleteOrMalformedFields) {
+    const std::string signature = transfer_signature();
+    SubmitPayload payload;
+    payload.sender = "alice";
+    payload.recipient = "bob";
+    payload.signature = signature;
+    payload.has_amount = true;
+    ASSERT_TRUE(encode_submit_payload(payload));
+
+    auto missing = payload;
+    missing.has_amount = false;
+    EXPECT_FALSE(encode_submit_payload(missing));
+    missing = payload;
+    missing.recipient = {};
+    EXPECT_FALSE(encode_submit_payload(missing));
+
+    const std::string short_signature = signature.substr(2);
+    auto bad = payload;
+    bad.signature = short_signature;
+    EXPECT_FALSE(encode_submit_payload(bad));
+    bad = payload;
+    bad.data = "abc";
+    EXPECT_FALSE(encode_submit_payload(bad));
+    bad.data = "zz";
+    EXPECT_FALSE(encode_submit_payload(bad));
+
+    auto with_data = payload;
+    with_data.data = "0xC0FFEE";
+    const auto encoded = encode_submit_payload(with_data);
+    ASSERT_TRUE(encoded);
+    const auto data = blockchain::TransactionView::parse(*encoded)->getData();
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), (std::vector<uint8_t>{0xc0, 0xff, 0xee}));
+}
+
+} // namespace test
+} // namespace api
+} // namespace quids
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "api/SubscriptionHub.hpp"
+#include <chrono>
+#include <thread>
+
+namespace quids {
+namespace api {
+namespace test {
+
+namespace {
+
+using namespace std::chrono_literals;
+using Topic = SubscriptionHub::Topic;
+
+} // namespace
+
+TEST(SubscriptionHubTest, FramesEachEventOnceForItsSubscribers) {
+    SubscriptionHub hub;
+    auto heads = hub.subscribe({Topic::NewHeads});
+    auto both = hub.subscribe({Topic::NewHeads, Topic::PendingTx});
+    auto pending = hub.subscribe({Topic::PendingTx});
+    EXPECT_EQ(hub.subscriber_count(), 3u);
+
+    hub.publish(Topic::NewHeads, {{"number", 1}});
+    const auto a = heads->wait(0ms);
+    const auto b = both->wait(0ms);
+    ASSERT_TRUE(a && b);
+    ASSERT_EQ(a->size(), 1u);
+    ASSERT_EQ(b->size(), 1u);
+    EXPECT_EQ(*a->front(), "event: newHeads\ndata: {\"number\":1}\n\n");
+    // One buffer for every subscriber
+    EXPECT_EQ(a->front().get(), b->front().get());
+    const auto none = pending->wait(0ms);
+    ASSERT_TRUE(none);
+    EXPECT_TRUE(none->empty());
+
+    hub.publish(Topic::PendingTx, {{"hash", "ab"}});
+    hub.publish(Topic::PendingTx, {{"hash", "cd"}});
+    const auto queued = both->wait(0ms);
+    ASSERT_TRUE(queued);
+    ASSERT_EQ(queued->size(), 2u);
+    EXPECT_EQ(*queued->back(), "event: pendingTx\ndata: {\"hash\":\"cd\"}\n\n");
+    EXPECT_TRUE(heads->wait(0ms)->empty());
+}
+
+TEST(SubscriptionHubTest, WaitReturnsWhenAnEventArrives) {
+    SubscriptionHub hub;
+    auto subscription = hub.subscribe({Topic::NewHeads});
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(subscription->wait(20ms)->empty());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+
+    std::thread publisher([&] {
+        std::this_thread::sleep_for(20ms);
+        hub.publish(Topic::NewHeads, {{"number", 2}});
+    });
+    const auto frames = subscription->wait(10s);
+    publisher.join();
+    ASSERT_TRUE(frames);
+    EXPECT_EQ(frames->size(), 1u);
+}
+
+TEST(SubscriptionHubTest, ClosesSubscribersThatFallBehind) {
+    SubscriptionHub hub(2);
+    auto slow = hub.subscribe({Topic::PendingTx});
+    auto fast = hub.subscribe({Topic::PendingTx});
+    for (int i = 0; i < 3; ++i) {
+        hub.publish(Topic::PendingTx, {{"n", i}});
+        if (i < 2) {
+            EXPECT_EQ(fast->wait(0ms)->size(), 1u);
+        }
+    }
+    // Its queued frames are dropped with it
+    EXPECT_TRUE(slow->closed());
+    EXPECT_FALSE(slow->wait(0ms));
+    EXPECT_FALSE(fast->closed());
+    EXPECT_EQ(fast->wait(0ms)->size(), 1u);
+
+    // A closed subscription stays closed
+    hub.publish(Topic::PendingTx, {{"n", 3}});
+    EXPECT_FALSE(slow->wait(0ms));
+}
+
+TEST(SubscriptionHubTest, ForgetsDroppedSubscriptionsAndClosesOnShutdown) {
+    SubscriptionHub hub;
+    auto kept = hub.subscribe({Topic::NewHeads});
+    auto dropped = hub.subscribe({Topic::NewHeads});
+    dropped.reset();
+    EXPECT_EQ(hub.subscriber_count(), 1u);
+    hub.publish(Topic::NewHeads, {{"number", 3}});
+    EXPECT_EQ(kept->wait(0ms)->size(), 1u);
+
+    std::thread waiter([&] { EXPECT_FALSE(kept->wait(10s)); });
+    std::this_thread::sleep_for(10ms);
+    hub.close_all();
+    waiter.join();
+    EXPECT_TRUE(kept->closed());
+    EXPECT_EQ(hub.subscriber_count(), 0u);
+
+    EXPECT_EQ(SubscriptionHub::parse_topic("newHeads"), Topic::NewHeads);
+    EXPECT_EQ(SubscriptionHub::parse_topic("pendingTx"), Topic::PendingTx);
+    EXPECT_FALSE(SubscriptionHub::parse_topic("logs"));
+}
+
+} // namespace test
+} // namespace api
+} // namespace quids
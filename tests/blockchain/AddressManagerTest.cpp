@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "blockchain/AddressManager.hpp"
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace quids::blockchain;
+
+namespace {
+
+AddressManager::LocationData city(double latitude, double longitude) {
+    return {latitude, longitude, "", ""};
+}
+
+std::vector<AddressManager::VSSShare> pick(const AddressManager::VSSScheme& scheme,
+                                           std::initializer_list<size_t> indices) {
+    std::vector<AddressManager::VSSShare> out;
+    for (const size_t index : indices) out.push_back(scheme.shares[index - 1]);
+    return out;
+}
+
+std::string account(size_t i) {
+    std::string hex = std::to_string(1000 + i);
+    return "0x" + std::string(40 - hex.size(), '0') + hex;
+}
+
+} // namespace
+
+TEST(AddressManagerTest, AnyThresholdSubsetRebuildsTheLocation) {
+    AddressManager manager;
+    const auto scheme = manager.generateShares(city(-33.8688, 151.2093), 5, 3);
+    ASSERT_EQ(scheme.shares.size(), 5u);
+
+    for (const auto& subset : {pick(scheme, {1, 2, 3}), pick(scheme, {5, 1, 4}), pick(scheme, {2, 4, 5})}) {
+        const auto location = manager.reconstructLocation(subset, 3);
+        ASSERT_TRUE(location.has_value());
+        EXPECT_NEAR(location->latitude, -33.8688, 1e-9);
+        EXPECT_NEAR(location->longitude, 151.2093, 1e-9);
+    }
+    for (const auto& share : scheme.shares) {
+        EXPECT_TRUE(manager.verifyShare(share, scheme.root_commitment));
+    }
+}
+
+TEST(AddressManagerTest, BatchSharesOneSetOfCoefficients) {
+    AddressManager manager;
+    std::vector<AddressManager::LocationData> locations;
+    for (int i = 0; i < 200; ++i) {
+        locations.push_back(city(-89.5 + i * 0.9, 179.0 - i * 1.7));
+    }
+    const auto schemes = manager.generateSharesBatch(locations, 7, 4);
+    ASSERT_EQ(schemes.size(), locations.size());
+
+    const std::array<size_t, 4> holders = {7, 2, 5, 3};
+    const auto coefficients = AddressManager::lagrangeCoefficients(holders);
+    ASSERT_TRUE(coefficients.has_value());
+    for (size_t i = 0; i < schemes.size(); ++i) {
+        const auto shares = pick(schemes[i], {7, 2, 5, 3});
+        const auto location = manager.reconstructLocation(shares, *coefficients);
+        ASSERT_TRUE(location.has_value());
+        EXPECT_NEAR(location->latitude, locations[i].latitude, 1e-9);
+        EXPECT_NEAR(location->longitude, locations[i].longitude, 1e-9);
+    }
+
+    // Shares must come in the order the coefficients were built for
+    EXPECT_FALSE(manager.reconstructLocation(pick(schemes[0], {2, 7, 5, 3}), *coefficients).has_value());
+}
+
+TEST(AddressManagerTest, RejectsBadParametersAndShares) {
+    AddressManager manager;
+    EXPECT_THROW((void)manager.generateShares(city(0, 0), 2, 2), std::invalid_argument);
+    EXPECT_THROW((void)manager.generateShares(city(0, 0), 5, 6), std::invalid_argument);
+
+    const std::array<size_t, 3> repeated = {1, 2, 1};
+    const std::array<size_t, 2> zero = {0, 4};
+    EXPECT_FALSE(AddressManager::lagrangeCoefficients(repeated).has_value());
+    EXPECT_FALSE(AddressManager::lagrangeCoefficients(zero).has_value());
+
+    auto scheme = manager.generateShares(city(48.8566, 2.3522), 4, 2);
+    auto tampered = scheme.shares[1];
+    tampered.data[0] ^= 1;
+    EXPECT_FALSE(manager.verifyShare(tampered, scheme.root_commitment));
+    EXPECT_FALSE(manager.reconstructLocation(pick(scheme, {1}), 2).has_value());
+}
+
+TEST(AddressManagerTest, ParsesAddressesOnce) {
+    const auto key = AddressManager::accountKey("0x00000000000000000000000000000000000012Ab");
+    ASSERT_TRUE(key.has_value());
+    EXPECT_EQ((*key)[30], 0x12);
+    EXPECT_EQ((*key)[31], 0xab);
+    EXPECT_EQ(key, AddressManager::accountKey("qu_0x12ab"));
+    EXPECT_FALSE(AddressManager::accountKey("0x12a").has_value());
+    EXPECT_FALSE(AddressManager::accountKey("0xzz").has_value());
+    EXPECT_FALSE(AddressManager::accountKey("0x" + std::string(66, '1')).has_value());
+
+    AddressManager manager;
+    EXPECT_TRUE(manager.create_account("0xABCD", 10));
+    EXPECT_FALSE(manager.create_account("0xabcd", 10));  // same account
+    EXPECT_FALSE(manager.create_account("alice", 10));
+    EXPECT_EQ(manager.get_balance(*AddressManager::accountKey("0x00abcd")), 10u);
+    EXPECT_TRUE(manager.create_contract_account("0x01", {0x60, 0x00}, 0));
+    EXPECT_TRUE(manager.is_contract_account("0x01"));
+    EXPECT_TRUE(manager.delete_account("0x01"));
+    EXPECT_FALSE(manager.account_exists("0x01"));
+}
+
+TEST(AddressManagerTest, ConcurrentTransfersConserveBalances) {
+    constexpr size_t ACCOUNTS = 16;
+    constexpr size_t THREADS = 8;
+    constexpr size_t TRANSFERS = 20000;
+    AddressManager manager;
+    for (size_t i = 0; i < ACCOUNTS; ++i) {
+        ASSERT_TRUE(manager.create_account(account(i), 1000));
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t n = 0; n < TRANSFERS; ++n) {
+                // Every pair is used in both directions
+                const size_t from = (n * 7 + t) % ACCOUNTS;
+                const size_t to = (n * 3 + t * 5 + 1) % ACCOUNTS;
+                (void)manager.transfer(account(from), account(to), 1 + n % 50);
+                (void)manager.increment_nonce(account(from));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    uint64_t total = 0;
+    uint64_t nonces = 0;
+    for (size_t i = 0; i < ACCOUNTS; ++i) {
+        total += manager.get_balance(account(i));
+        nonces += manager.get_nonce(account(i));
+    }
+    EXPECT_EQ(total, ACCOUNTS * 1000);
+    EXPECT_EQ(nonces, THREADS * TRANSFERS);
+    EXPECT_FALSE(manager.transfer(account(0), account(1), ACCOUNTS * 1000 + 1));
+    EXPECT_FALSE(manager.transfer(account(0), "0x99", 1));
+}
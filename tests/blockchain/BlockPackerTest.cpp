@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include "blockchain/BlockPacker.hpp"
+
+using namespace quids::blockchain;
+
+namespace {
+
+BlockPacker::Candidate candidate(uint64_t id, const Address& sender, Nonce nonce, GasPrice price,
+                                 std::vector<uint64_t> writes = {}) {
+    BlockPacker::Candidate c;
+    c.id = id;
+    c.sender = sender;
+    c.nonce = nonce;
+    c.gasPrice = price;
+    c.gasLimit = 21000;
+    c.writes = std::move(writes);
+    return c;
+}
+
+} // namespace
+
+TEST(BlockPackerTest, PricesNonceChainsAsPackages) {
+    BlockPackerConfig config;
+    config.maxGasPerBlock = 2 * 21000;
+    BlockPacker packer(config);
+
+    // alice's first transaction is cheap but unlocks an expensive one
+    EXPECT_TRUE(packer.offer(candidate(1, "alice", 0, 1)));
+    EXPECT_TRUE(packer.offer(candidate(2, "alice", 1, 100)));
+    EXPECT_TRUE(packer.offer(candidate(3, "bob", 0, 20)));
+    EXPECT_FALSE(packer.offer(candidate(4, "bob", 0, 20)));
+    packer.setNextNonce("carol", 4);
+    EXPECT_FALSE(packer.offer(candidate(5, "carol", 3, 500)));
+    EXPECT_TRUE(packer.offer(candidate(6, "carol", 5, 500)));  // gap at 4
+    EXPECT_EQ(packer.pending(), 4u);
+
+    auto block = packer.seal();
+    EXPECT_EQ(block.ids, (std::vector<uint64_t>{1, 2}));
+    ASSERT_EQ(block.waves.size(), 2u);  // same sender, so never side by side
+    EXPECT_EQ(block.gasReserved, 2u * 21000);
+    EXPECT_EQ(block.expectedFees, 101u * 21000);
+
+    EXPECT_FALSE(packer.offer(candidate(7, "alice", 1, 1000)));
+    EXPECT_TRUE(packer.offer(candidate(8, "carol", 4, 1)));
+    block = packer.seal();
+    EXPECT_EQ(block.ids, (std::vector<uint64_t>{8, 6}));
+    EXPECT_EQ(packer.seal().ids, (std::vector<uint64_t>{3}));
+    EXPECT_EQ(packer.pending(), 0u);
+}
+
+TEST(BlockPackerTest, BoundsConflictDepth) {
+    BlockPackerConfig config;
+    config.maxConflictDepth = 2;
+    BlockPacker packer(config);
+
+    for (uint64_t i = 0; i < 4; ++i) {
+        packer.offer(candidate(i, "hot" + std::to_string(i), 0, 50 - i, {7}));
+    }
+    packer.offer(candidate(10, "x", 0, 10, {1}));
+    packer.offer(candidate(11, "y", 0, 10, {2}));
+
+    auto block = packer.seal();
+    ASSERT_EQ(block.waves.size(), 2u);
+    EXPECT_EQ(block.waves[0], (std::vector<uint64_t>{0, 10, 11}));
+    EXPECT_EQ(block.waves[1], (std::vector<uint64_t>{1}));
+    EXPECT_EQ(block.ids, (std::vector<uint64_t>{0, 10, 11, 1}));
+
+    EXPECT_EQ(packer.seal().ids, (std::vector<uint64_t>{2, 3}));
+}
+
+TEST(BlockPackerTest, FillHoldsGasBackForBetterArrivals) {
+    BlockPackerConfig config;
+    config.maxGasPerBlock = 10 * 21000;
+    config.minFeePerGas = 1;
+    config.maxFeePerGas = 100;
+    BlockPacker packer(config);
+
+    for (uint64_t i = 0; i < 12; ++i) {
+        packer.offer(candidate(i, "s" + std::to_string(i), 0, 2));
+    }
+    // The threshold passes 2 once the block is about 30% full
+    EXPECT_EQ(packer.fill(), 4u);
+    EXPECT_EQ(packer.gasReserved(), 4u * 21000);
+    EXPECT_EQ(packer.fill(), 0u);
+
+    packer.offer(candidate(100, "rich", 0, 90));
+    EXPECT_EQ(packer.fill(), 1u);
+
+    auto block = packer.seal();
+    EXPECT_EQ(block.ids.size(), 10u);
+    EXPECT_EQ(block.ids[4], 100u);
+    EXPECT_EQ(packer.pending(), 3u);
+}
+
+TEST(BlockPackerTest, ReservesPredictedGasWithMargin) {
+    BlockPackerConfig config;
+    config.maxGasPerBlock = 120000;
+    config.minFeePerGas = config.maxFeePerGas = 1;
+    BlockPacker packer(config);
+
+    for (uint64_t i = 0; i < 3; ++i) {
+        auto c = candidate(i, "s" + std::to_string(i), 0, 10 - i);
+        c.gasLimit = 100000;
+        c.predictedGas = 50000;
+        packer.offer(c);
+    }
+    EXPECT_EQ(packer.fill(), 2u);
+    EXPECT_EQ(packer.gasReserved(), 110000u);
+    packer.reconcile(0, 40000);
+    EXPECT_EQ(packer.gasReserved(), 95000u);
+    packer.reconcile(0, 90000);  // never grows a reservation
+    EXPECT_EQ(packer.gasReserved(), 95000u);
+
+    auto block = packer.seal();
+    EXPECT_EQ(block.ids, (std::vector<uint64_t>{0, 1}));
+    EXPECT_EQ(block.expectedFees, (10u + 9u) * 50000);
+    EXPECT_EQ(packer.seal().ids, (std::vector<uint64_t>{2}));
+}
+
+TEST(BlockPackerTest, DropsFromTheOpenBlockAndLaysOutTheRest) {
+    BlockPackerConfig config;
+    config.maxConflictDepth = 2;
+    config.minFeePerGas = config.maxFeePerGas = 1;
+    BlockPacker packer(config);
+
+    packer.offer(candidate(1, "a", 0, 10, {7}));
+    packer.offer(candidate(2, "b", 0, 9, {7}));
+    packer.offer(candidate(3, "c", 0, 8, {7}));  // a third wave on key 7
+    packer.offer(candidate(4, "d", 0, 7, {1}));
+    EXPECT_EQ(packer.fill(), 3u);
+
+    auto admitted = packer.admittedSince(0);
+    ASSERT_EQ(admitted.size(), 3u);
+    EXPECT_EQ(admitted[0].id, 1u);
+    EXPECT_EQ(admitted[2].id, 4u);
+    EXPECT_EQ(packer.admittedSince(2).size(), 1u);
+    EXPECT_TRUE(packer.admittedSince(5).empty());
+
+    // Dropping 1 moves 2 into the first wave and lets c back in
+    packer.drop({1});
+    EXPECT_EQ(packer.admitted(), 2u);
+    EXPECT_EQ(packer.gasReserved(), 2u * 21000);
+    EXPECT_EQ(packer.topUp(), 1u);
+    EXPECT_EQ(packer.topUp(), 0u);
+
+    auto block = packer.seal();
+    ASSERT_EQ(block.waves.size(), 2u);
+    EXPECT_EQ(block.waves[0], (std::vector<uint64_t>{2, 4}));
+    EXPECT_EQ(block.waves[1], (std::vector<uint64_t>{3}));
+    EXPECT_EQ(packer.admitted(), 0u);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include "blockchain/Block.hpp"
+
+using namespace quids::blockchain;
+
+namespace {
+
+// Just enough of a block to exercise the shared transaction storage
+class TestBlock : public Block {
+public:
+    bool addTransaction(TransactionPtr tx) override {
+        appendTransaction(std::move(tx));
+        return true;
+    }
+    bool verify() const override { return true; }
+    Hash hash() const override { return {}; }
+    void computeHash() override {}
+    void computeMerkleRoot() override {}
+    void applyQuantumOptimization() override {}
+    double calculateQuantumSecurityScore() const override { return 0.0; }
+    void serialize(ByteVector&) const override {}
+    void deserialize(const ByteVector&) override {}
+};
+
+} // namespace
+
+TEST(BlockTest, SharesTransactionsAndKeepsTheirHashes) {
+    auto first = std::make_shared<StandardTransaction>();
+    auto second = std::make_shared<StandardTransaction>();
+    TransactionPtr held = first;
+
+    TestBlock block;
+    block.reserveTransactions(2);
+    block.addTransaction(held);
+    block.addTransaction(std::move(second));
+
+    ASSERT_EQ(block.getTransactionCount(), 2u);
+    EXPECT_EQ(&block.getTransaction(0), first.get());  // no copy was made
+    EXPECT_EQ(held.use_count(), 3);
+    ASSERT_EQ(block.transactionHashes().size(), 2u);
+    EXPECT_EQ(block.transactionHashes()[0], first->hash());
+    EXPECT_EQ(block.transactionHashes()[1], block.getTransaction(1).hash());
+    EXPECT_THROW(block.addTransaction(nullptr), std::invalid_argument);
+    EXPECT_EQ(block.getTransactionCount(), 2u);
+    EXPECT_EQ(block.transactionHashes().size(), 2u);
+}
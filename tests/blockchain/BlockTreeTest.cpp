@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "blockchain/BlockTree.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace quids::blockchain;
+
+namespace {
+
+Hash id(uint8_t branch, uint8_t height) {
+    Hash hash{};
+    hash[0] = branch;
+    hash[1] = height;
+    return hash;
+}
+
+} // namespace
+
+TEST(BlockTreeTest, HeadFollowsTheHeaviestBranch) {
+    const Hash genesis = id(0, 0);
+    BlockTree tree(genesis);
+    // a: genesis <- a1 <- a2 <- a3, weight 1 each
+    EXPECT_EQ(tree.insert(id(1, 1), genesis, 1), BlockTree::Insert::Added);
+    EXPECT_EQ(tree.insert(id(1, 2), id(1, 1), 1), BlockTree::Insert::Added);
+    EXPECT_EQ(tree.insert(id(1, 3), id(1, 2), 1), BlockTree::Insert::Added);
+    EXPECT_EQ(tree.head().hash, id(1, 3));
+    EXPECT_EQ(tree.head().totalWeight, 3u);
+
+    // b forks off a1 and draws level, then overtakes
+    EXPECT_EQ(tree.insert(id(2, 2), id(1, 1), 2), BlockTree::Insert::Added);
+    EXPECT_EQ(tree.head().hash, id(1, 3));
+    EXPECT_EQ(tree.insert(id(2, 3), id(2, 2), 1), BlockTree::Insert::Added);
+    EXPECT_EQ(tree.head().hash, id(2, 3));
+    EXPECT_EQ(tree.head().height, 3u);
+
+    EXPECT_EQ(tree.insert(id(2, 3), id(2, 2), 1), BlockTree::Insert::Duplicate);
+    EXPECT_EQ(tree.insert(id(9, 9), id(8, 8), 1), BlockTree::Insert::UnknownParent);
+
+    const auto reorg = tree.path(id(1, 3), id(2, 3));
+    EXPECT_EQ(reorg.ancestor, id(1, 1));
+    EXPECT_EQ(reorg.detached, (std::vector<Hash>{id(1, 3), id(1, 2)}));
+    EXPECT_EQ(reorg.attached, (std::vector<Hash>{id(2, 2), id(2, 3)}));
+    EXPECT_TRUE(tree.path(id(2, 3), id(2, 3)).empty());
+    EXPECT_EQ(tree.ancestorAt(id(2, 3), 1)->hash, id(1, 1));
+    EXPECT_EQ(tree.ancestorAt(id(2, 3), 4), nullptr);
+}
+
+TEST(BlockTreeTest, PruneKeepsOnlyDescendantsOfTheNewRoot) {
+    const Hash genesis = id(0, 0);
+    BlockTree tree(genesis);
+    tree.insert(id(1, 1), genesis, 1);
+    tree.insert(id(1, 2), id(1, 1), 1);
+    tree.insert(id(1, 3), id(1, 2), 1);
+    tree.insert(id(2, 1), genesis, 1);
+    tree.insert(id(3, 3), id(1, 2), 1);
+
+    EXPECT_THROW(tree.prune(id(2, 1)), std::invalid_argument);
+    auto dropped = tree.prune(id(1, 2));
+    std::sort(dropped.begin(), dropped.end());
+    EXPECT_EQ(dropped, (std::vector<Hash>{genesis, id(1, 1), id(2, 1)}));
+    EXPECT_EQ(tree.size(), 3u);
+    EXPECT_EQ(tree.root().hash, id(1, 2));
+    EXPECT_EQ(tree.head().hash, id(1, 3));
+    EXPECT_EQ(tree.insert(id(2, 2), id(2, 1), 1), BlockTree::Insert::UnknownParent);
+    EXPECT_EQ(tree.path(id(1, 3), id(3, 3)).ancestor, id(1, 2));
+}
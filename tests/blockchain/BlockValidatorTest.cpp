@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "blockchain/BlockValidator.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include "TestTransactions.hpp"
+#include <map>
+
+using namespace quids::blockchain;
+using quids::test::makeSignedTransfer;
+
+namespace {
+
+Hash rootOf(const std::vector<TransactionPtr>& txs) {
+    quids::crypto::MerkleBuilder builder;
+    for (const auto& tx : txs) {
+        builder.appendHash(tx->hash());
+    }
+    return builder.root();
+}
+
+BlockValidator::AccountLookup ledger(std::map<Address, BlockValidator::Account> accounts) {
+    return [accounts = std::move(accounts)](const Address& address) -> std::optional<BlockValidator::Account> {
+        if (auto it = accounts.find(address); it != accounts.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    };
+}
+
+std::vector<TransactionPtr> sampleBlock() {
+    std::vector<TransactionPtr> txs;
+    for (uint64_t i = 0; i < 64; ++i) {
+        txs.push_back(makeSignedTransfer("sender" + std::to_string(i % 8), "sink", 10, i / 8, 1));
+    }
+    return txs;
+}
+
+} // namespace
+
+TEST(BlockValidatorTest, AcceptsAValidBlock) {
+    auto txs = sampleBlock();
+    std::map<Address, BlockValidator::Account> accounts;
+    for (int s = 0; s < 8; ++s) {
+        accounts["sender" + std::to_string(s)] = {88, 0};
+    }
+    BlockValidator validator;
+    const auto lookup = ledger(accounts);
+    EXPECT_TRUE(validator.validate(txs, rootOf(txs), lookup));
+
+    // One unit short for the last of sender3's transactions
+    accounts["sender3"].balance = 87;
+    auto result = validator.validate(txs, rootOf(txs), ledger(accounts));
+    EXPECT_EQ(result.status, BlockValidator::Status::InsufficientBalance);
+    EXPECT_EQ(result.index, 59u);
+
+    accounts["sender3"] = {88, 1};
+    result = validator.validate(txs, rootOf(txs), ledger(accounts));
+    EXPECT_EQ(result.status, BlockValidator::Status::BadNonce);
+    EXPECT_EQ(result.index, 3u);
+
+    Hash wrong = rootOf(txs);
+    wrong[0] ^= 1;
+    EXPECT_EQ(validator.validate(txs, wrong, lookup).status, BlockValidator::Status::BadMerkleRoot);
+}
+
+TEST(BlockValidatorTest, SpendsCreditsFromEarlierInTheBlock) {
+    std::vector<TransactionPtr> txs{
+        makeSignedTransfer("alice", "bob", 50, 0, 1),
+        makeSignedTransfer("bob", "carol", 45, 0, 5),
+        makeSignedTransfer("carol", "alice", 46, 0, 0),
+    };
+    BlockValidator validator;
+    const auto lookup = ledger({{"alice", {51, 0}}, {"carol", {1, 0}}});
+    EXPECT_TRUE(validator.validate(txs, rootOf(txs), lookup));
+
+    // Same transfers, but bob spends before he is paid
+    std::swap(txs[0], txs[1]);
+    auto result = validator.validate(txs, rootOf(txs), lookup);
+    EXPECT_EQ(result.status, BlockValidator::Status::InsufficientBalance);
+    EXPECT_EQ(result.index, 0u);
+}
+
+TEST(BlockValidatorTest, StopsOnBadSignatureOrCancellation) {
+    auto txs = sampleBlock();
+    txs[17] = makeSignedTransfer("sender1", "sink", 10, 2, 1, true);
+    const auto lookup = ledger({});
+    BlockValidator validator;
+    auto result = validator.validate(txs, rootOf(txs), lookup);
+    EXPECT_EQ(result.status, BlockValidator::Status::BadSignature);
+    EXPECT_EQ(result.index, 17u);
+
+    std::stop_source stop;
+    stop.request_stop();
+    txs = sampleBlock();
+    result = validator.validate(txs, rootOf(txs), lookup, stop.get_token());
+    EXPECT_EQ(result.status, BlockValidator::Status::Cancelled);
+    EXPECT_FALSE(result);
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "blockchain/Chain.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include "TestTransactions.hpp"
+
+using namespace quids::blockchain;
+using quids::test::makeSignedTransfer;
+
+namespace {
+
+class TestBlock : public Block {
+public:
+    TestBlock(const Hash& parent, BlockNumber number, uint8_t salt, std::vector<TransactionPtr> txs) : salt_(salt) {
+        previousHash_ = parent;
+        number_ = number;
+        for (auto& tx : txs) {
+            appendTransaction(std::move(tx));
+        }
+        computeMerkleRoot();
+    }
+
+    bool addTransaction(TransactionPtr tx) override {
+        appendTransaction(std::move(tx));
+        return true;
+    }
+    bool verify() const override { return true; }
+    Hash hash() const override {
+        ByteVector bytes(previousHash_.begin(), previousHash_.end());
+        bytes.insert(bytes.end(), merkleRoot_.begin(), merkleRoot_.end());
+        bytes.push_back(static_cast<uint8_t>(number_));
+        bytes.push_back(salt_);
+        return quids::crypto::MerkleBuilder::hashLeaf(bytes);
+    }
+    void computeHash() override {}
+    void computeMerkleRoot() override {
+        quids::crypto::MerkleBuilder builder;
+        for (const auto& hash : transactionHashes_) {
+            builder.appendHash(hash);
+        }
+        merkleRoot_ = builder.root();
+    }
+    void applyQuantumOptimization() override {}
+    double calculateQuantumSecurityScore() const override { return 0.0; }
+    void serialize(ByteVector&) const override {}
+    void deserialize(const ByteVector&) override {}
+
+private:
+    uint8_t salt_;
+};
+
+std::shared_ptr<const Block> child(const Chain::BlockPtr& parent, const Hash& genesis, uint8_t salt,
+                                   std::vector<TransactionPtr> txs = {}) {
+    return std::make_shared<TestBlock>(parent ? parent->hash() : genesis, parent ? parent->number() + 1 : 1,
+                                       salt, std::move(txs));
+}
+
+uint64_t balance(const Chain::AccountState& state, const std::string& address) {
+    const Account* account = state.find(address);
+    return account ? account->balance : 0;
+}
+
+Chain::AccountState genesisState() {
+    Chain::AccountState state;
+    state.set("alice", Account("alice", 100));
+    return state;
+}
+
+} // namespace
+
+TEST(ChainTest, ReorgSwitchesToTheNewBranchState) {
+    Chain chain(Chain::Config{}, genesisState());
+    const Hash genesis = chain.head();
+
+    // Branch a: alice pays bob 10, then 5
+    auto a1 = child(nullptr, genesis, 1, {makeSignedTransfer("alice", "bob", 10, 0)});
+    auto a2 = child(a1, genesis, 1, {makeSignedTransfer("alice", "bob", 5, 1)});
+    EXPECT_EQ(chain.addBlock(a1).status, Chain::Status::Extended);
+    EXPECT_EQ(chain.addBlock(a2).status, Chain::Status::Extended);
+    EXPECT_EQ(balance(chain.state(), "bob"), 15u);
+
+    // Branch b: alice pays carol instead, and wins on weight
+    auto b1 = child(nullptr, genesis, 2, {makeSignedTransfer("alice", "carol", 30, 0)});
+    auto b2 = child(b1, genesis, 2);
+    EXPECT_EQ(chain.addBlock(b1).status, Chain::Status::SideBranch);
+    auto update = chain.addBlock(b2, 2);
+    EXPECT_EQ(update.status, Chain::Status::Extended);
+    EXPECT_EQ(update.reorg.ancestor, genesis);
+    EXPECT_EQ(update.reorg.detached, (std::vector<Hash>{a2->hash(), a1->hash()}));
+    EXPECT_EQ(update.reorg.attached, (std::vector<Hash>{b1->hash(), b2->hash()}));
+
+    const auto state = chain.state();
+    EXPECT_EQ(chain.head(), b2->hash());
+    EXPECT_EQ(balance(state, "bob"), 0u);
+    EXPECT_EQ(balance(state, "carol"), 30u);
+    EXPECT_EQ(balance(state, "alice"), 70u);
+    EXPECT_EQ(state.find("alice")->nonce, 1u);
+    EXPECT_EQ(balance(*chain.stateAt(a2->hash()), "bob"), 15u);
+
+    EXPECT_EQ(chain.addBlock(b2).status, Chain::Status::Duplicate);
+    // On branch b, alice has already used nonce 0
+    auto bad = child(b2, genesis, 2, {makeSignedTransfer("alice", "bob", 1, 0)});
+    update = chain.addBlock(bad);
+    EXPECT_EQ(update.status, Chain::Status::Invalid);
+    EXPECT_EQ(update.validation.status, BlockValidator::Status::BadNonce);
+}
+
+TEST(ChainTest, PrunesBranchesBelowFinality) {
+    Chain chain(Chain::Config{4}, genesisState());
+    const Hash genesis = chain.head();
+
+    auto side = child(nullptr, genesis, 9);
+    Chain::BlockPtr tip;
+    std::vector<Chain::BlockPtr> mainline;
+    for (int i = 0; i < 6; ++i) {
+        tip = child(tip, genesis, 1);
+        mainline.push_back(tip);
+        EXPECT_EQ(chain.addBlock(tip).status, Chain::Status::Extended);
+        if (i == 0) {
+            EXPECT_EQ(chain.addBlock(side).status, Chain::Status::SideBranch);
+        }
+    }
+    EXPECT_EQ(chain.height(), 6u);
+    EXPECT_EQ(chain.getLatestBlock(), tip);
+    // Height 2 is final: the side branch and everything below are gone
+    EXPECT_EQ(chain.getBlock(side->hash()), nullptr);
+    EXPECT_EQ(chain.getBlock(mainline[0]->hash()), nullptr);
+    EXPECT_NE(chain.getBlock(mainline[1]->hash()), nullptr);
+    EXPECT_EQ(chain.addBlock(child(side, genesis, 9)).status, Chain::Status::UnknownParent);
+}
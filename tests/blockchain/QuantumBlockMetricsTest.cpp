@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include "blockchain/QuantumBlockMetrics.hpp"
+
+using namespace quids::blockchain;
+using Series = QuantumBlockMetrics::Series;
+
+TEST(QuantumBlockMetricsTest, KeepsSeriesApartInOneBuffer) {
+    QuantumBlockMetrics metrics;
+    EXPECT_TRUE(metrics.empty());
+    EXPECT_TRUE(metrics.get(Series::Quality).empty());
+
+    const std::vector<double> phases{0.5, 1.5, 2.5};
+    metrics.assign(Series::Phases, phases);
+    metrics.assign(Series::States, std::vector<double>{1.0});
+    metrics.resize(Series::Quality, 2)[1] = 9.0;
+
+    auto stored = metrics.get(Series::Phases);
+    EXPECT_EQ(std::vector<double>(stored.begin(), stored.end()), phases);
+    EXPECT_EQ(metrics.get(Series::States)[0], 1.0);
+    EXPECT_EQ(metrics.get(Series::Quality)[0], 0.0);
+    EXPECT_EQ(metrics.get(Series::Quality)[1], 9.0);
+    EXPECT_TRUE(metrics.get(Series::Amplitudes).empty());
+
+    // Shrinking one series leaves its neighbours in place
+    metrics.resize(Series::Phases, 1);
+    EXPECT_EQ(metrics.get(Series::Phases).size(), 1u);
+    EXPECT_EQ(metrics.get(Series::Phases)[0], 0.5);
+    EXPECT_EQ(metrics.get(Series::States)[0], 1.0);
+    EXPECT_EQ(metrics.get(Series::Quality)[1], 9.0);
+
+    metrics.clear();
+    EXPECT_TRUE(metrics.empty());
+    EXPECT_TRUE(metrics.get(Series::Quality).empty());
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "blockchain/SignatureCache.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "TestTransactions.hpp"
+
+using namespace quids::blockchain;
+
+namespace {
+
+// Counts how often the expensive check actually runs
+class CountingTransaction : public StandardTransaction {
+public:
+    bool verify() const override {
+        ++calls;
+        return StandardTransaction::verify();
+    }
+    mutable int calls{0};
+};
+
+ByteVector signedSample(uint64_t nonce) {
+    return quids::test::signedTransferBytes("alice", "bob", 500, nonce, 21000);
+}
+
+Hash hashOf(uint8_t seed) {
+    Hash h{};
+    for (size_t i = 0; i < h.size(); ++i) h[i] = static_cast<uint8_t>(seed * 37 + i);
+    return h;
+}
+
+} // namespace
+
+TEST(SignatureCacheTest, KeepsRecentEntriesWithinCapacity) {
+    SignatureCache cache(320);
+    EXPECT_FALSE(cache.contains(hashOf(0)));
+    cache.insert(hashOf(0));
+    EXPECT_TRUE(cache.contains(hashOf(0)));
+
+    for (int i = 1; i < 250; ++i) {
+        cache.insert(hashOf(static_cast<uint8_t>(i)));
+        EXPECT_TRUE(cache.contains(hashOf(0)));  // hits keep it alive
+    }
+    EXPECT_LE(cache.size(), 320u);
+    EXPECT_TRUE(cache.contains(hashOf(249)));
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(SignatureCacheTest, TransactionsVerifyOnce) {
+    SignatureCache::global().clear();
+    const ByteVector bytes = signedSample(1);
+
+    CountingTransaction tx;
+    ASSERT_TRUE(tx.deserialize(bytes));
+    EXPECT_TRUE(tx.verified());
+    EXPECT_TRUE(tx.verified());
+    EXPECT_EQ(tx.calls, 1);
+
+    // A copy carries the memo along
+    CountingTransaction copy = tx;
+    copy.calls = 0;
+    EXPECT_TRUE(copy.verified());
+    EXPECT_EQ(copy.calls, 0);
+
+    // The same transaction decoded again, e.g. from gossip, hits the node cache
+    CountingTransaction regossiped;
+    ASSERT_TRUE(regossiped.deserialize(bytes));
+    EXPECT_TRUE(regossiped.verified());
+    EXPECT_EQ(regossiped.calls, 0);
+    EXPECT_EQ(regossiped.hash(), tx.hash());
+    EXPECT_EQ(tx.hash(), TransactionView::parse(bytes)->computeHash());
+}
+
+TEST(SignatureCacheTest, FailuresAreNotShared) {
+    SignatureCache::global().clear();
+    ByteVector bytes = signedSample(2);
+    bytes.back() ^= 1;
+
+    CountingTransaction forged;
+    ASSERT_TRUE(forged.deserialize(bytes));
+    EXPECT_FALSE(forged.verified());
+    EXPECT_FALSE(forged.verified());
+    EXPECT_EQ(forged.calls, 1);
+    EXPECT_EQ(SignatureCache::global().size(), 0u);
+}
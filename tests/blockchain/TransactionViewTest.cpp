@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "blockchain/TransactionView.hpp"
+
+using namespace quids::blockchain;
+
+namespace {
+
+// StandardTransaction has no setters here, so samples are written in the
+// wire format directly
+ByteVector encodeSample(uint64_t nonce) {
+    ByteVector out{wire::VERSION};
+    auto put = [&](uint64_t v, size_t width) {
+        for (size_t i = 0; i < width; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    };
+    const std::string sender = "alice";
+    const std::string recipient = "bob";
+    const ByteVector data = {0xa9, 0x05, 0x9c, 0xbb};
+    put(1'700'000'000'123'456, 8);
+    put(1000, 8);
+    put(nonce, 8);
+    put(21000, 8);
+    put(sender.size(), 2);
+    put(recipient.size(), 2);
+    put(data.size(), 4);
+    out.insert(out.end(), sender.begin(), sender.end());
+    out.insert(out.end(), recipient.begin(), recipient.end());
+    out.insert(out.end(), data.begin(), data.end());
+    out.resize(out.size() + wire::SIGNATURE_SIZE, 0x11);
+    return out;
+}
+
+} // namespace
+
+TEST(TransactionViewTest, ReadsFieldsInPlace) {
+    const ByteVector bytes = encodeSample(7);
+    auto view = TransactionView::parse(bytes);
+    ASSERT_TRUE(view);
+    EXPECT_EQ(view->getSender(), "alice");
+    EXPECT_EQ(view->getRecipient(), "bob");
+    EXPECT_EQ(view->getValue(), 1000u);
+    EXPECT_EQ(view->getNonce(), 7u);
+    EXPECT_EQ(view->calculate_gas_cost(), 21000u);
+    EXPECT_EQ(view->getData().size(), 4u);
+    EXPECT_EQ(view->getSignature()[0], 0x11);
+    // Views point into the buffer rather than copying it
+    EXPECT_EQ(view->bytes().data(), bytes.data());
+    EXPECT_EQ(reinterpret_cast<const uint8_t*>(view->getSender().data()), bytes.data() + wire::HEADER_SIZE);
+}
+
+TEST(TransactionViewTest, MaterializeRoundTrips) {
+    const ByteVector bytes = encodeSample(3);
+    StandardTransaction tx = TransactionView::parse(bytes)->materialize();
+    EXPECT_EQ(tx.getSender(), "alice");
+    EXPECT_EQ(tx.getNonce(), 3u);
+
+    ByteVector again;
+    tx.serialize(again);
+    EXPECT_EQ(again, bytes);
+
+    StandardTransaction decoded;
+    ASSERT_TRUE(decoded.deserialize(bytes));
+    const Hash hash = TransactionView::parse(bytes)->computeHash();
+    EXPECT_EQ(decoded.computeHash(), std::vector<uint8_t>(hash.begin(), hash.end()));
+}
+
+TEST(TransactionViewTest, ParsesPackedSequences) {
+    ByteVector packed;
+    for (uint64_t nonce = 0; nonce < 3; ++nonce) {
+        const auto one = encodeSample(nonce);
+        packed.insert(packed.end(), one.begin(), one.end());
+    }
+    std::span<const uint8_t> rest(packed);
+    uint64_t expected = 0;
+    while (!rest.empty()) {
+        auto view = TransactionView::parsePrefix(rest);
+        ASSERT_TRUE(view);
+        EXPECT_EQ(view->getNonce(), expected++);
+        rest = rest.subspan(view->bytes().size());
+    }
+    EXPECT_EQ(expected, 3u);
+    // A whole-buffer parse refuses trailing transactions
+    EXPECT_FALSE(TransactionView::parse(packed));
+}
+
+TEST(TransactionViewTest, RejectsMalformedBytes) {
+    ByteVector bytes = encodeSample(1);
+    EXPECT_FALSE(TransactionView::parse(std::span<const uint8_t>(bytes).first(bytes.size() - 1)));
+    EXPECT_FALSE(TransactionView::parse(std::span<const uint8_t>(bytes).first(wire::MIN_SIZE - 1)));
+    bytes[0] = wire::VERSION + 1;
+    EXPECT_FALSE(TransactionView::parse(bytes));
+    StandardTransaction tx;
+    EXPECT_FALSE(tx.deserialize(bytes));
+}
@@ -0,0 +1,106 @@
+#include "common/Config.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace quids {
+namespace common {
+namespace test {
+
+namespace {
+
+class ConfigFile {
+public:
+    explicit ConfigFile(const std::string& name)
+        : path_((std::filesystem::temp_directory_path() / name).string()) {}
+    ~ConfigFile() { std::filesystem::remove(path_); }
+
+    void write(size_t batch_size, const std::string& extra = "") {
+        std::ofstream f(path_, std::ios::trunc);
+        f << R"({"network": {"port": 9050, "stun_server": "stun.example:3478"},)"
+          << R"("storage": {"path": "./chaindata"},)"
+          << R"("rollup": {"batch_size": )" << batch_size << "}" << extra << "}";
+    }
+    // Moves the modification time on, since writes within one tick of
+    // the clock would look unchanged
+    void touch(int seconds) {
+        std::filesystem::last_write_time(path_, std::filesystem::last_write_time(path_) + std::chrono::seconds(seconds));
+    }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+} // namespace
+
+TEST(ConfigTest, ParsesTypedSettingsOnce) {
+    ConfigFile file("quids_config_typed.json");
+    file.write(250, R"(, "log": {"level": "debug"})");
+    Config config(file.path());
+
+    const Settings& settings = config.settings();
+    EXPECT_EQ(settings.network.port, 9050);
+    EXPECT_EQ(settings.network.stun_server, "stun.example:3478");
+    EXPECT_TRUE(settings.network.enable_upnp);  // default
+    EXPECT_EQ(settings.storage.path, "./chaindata");
+    EXPECT_EQ(settings.log.level, "debug");
+    EXPECT_EQ(settings.rollup.batch_size, 250u);
+    EXPECT_EQ(settings.rollup.num_worker_threads, 4u);
+    EXPECT_EQ(settings.generation, 1u);
+
+    // Untyped lookups take dotted keys
+    EXPECT_EQ(config.get<int>("network.port"), 9050);
+    EXPECT_EQ(config.get_or_default<std::string>("network.missing", "none"), "none");
+    EXPECT_EQ(config.get_or_default<int>("network.stun_server", -1), -1);
+}
+
+TEST(ConfigTest, ReloadPublishesOnlyValidFiles) {
+    ConfigFile file("quids_config_reload.json");
+    file.write(100);
+    Config config(file.path());
+    const Settings& first = config.settings();
+
+    file.write(500);
+    config.reload();
+    EXPECT_EQ(config.settings().rollup.batch_size, 500u);
+    EXPECT_EQ(config.settings().generation, 2u);
+    // Earlier snapshots stay readable
+    EXPECT_EQ(first.rollup.batch_size, 100u);
+
+    file.write(0);
+    EXPECT_THROW(config.reload(), std::runtime_error);
+    {
+        std::ofstream f(file.path(), std::ios::trunc);
+        f << R"({"network": {"port": "not a port"}})";
+    }
+    EXPECT_THROW(config.reload(), std::runtime_error);
+    EXPECT_EQ(config.settings().rollup.batch_size, 500u);
+    EXPECT_EQ(config.settings().generation, 2u);
+}
+
+TEST(ConfigTest, WatchPicksUpEdits) {
+    ConfigFile file("quids_config_watch.json");
+    file.write(100);
+    Config config(file.path());
+    config.watch(std::chrono::milliseconds(5));
+
+    file.write(0);  // invalid, skipped
+    file.touch(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(config.settings().rollup.batch_size, 100u);
+
+    file.write(750);
+    file.touch(2);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (config.settings().rollup.batch_size != 750 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(config.settings().rollup.batch_size, 750u);
+    config.stop_watching();
+}
+
+} // namespace test
+} // namespace common
+} // namespace quids
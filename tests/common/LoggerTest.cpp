@@ -0,0 +1,122 @@
+// Compiled at warn so the filtering below can be seen
+#define QUIDS_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_WARN
+#include "common/Logger.hpp"
+#include "TestStorage.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace quids {
+namespace common {
+namespace test {
+
+namespace {
+
+int evaluated = 0;
+
+int touch() {
+    return ++evaluated;
+}
+
+bool eventually(const std::function<bool()>& done) {
+    const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!done() && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return done();
+}
+
+} // namespace
+
+class LoggerFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = quids::test::uniqueTempPath("logger_");
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        Logger::shutdown();
+        std::filesystem::remove_all(dir_);
+    }
+
+    std::string logfile() const {
+        return (dir_ / "quids.log").string();
+    }
+
+    std::string contents() const {
+        std::ifstream in(logfile());
+        std::stringstream text;
+        text << in.rdbuf();
+        return text.str();
+    }
+
+    size_t count(const std::string& needle) const {
+        const std::string text = contents();
+        size_t n = 0;
+        for (auto pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+            ++n;
+        }
+        return n;
+    }
+
+    std::filesystem::path dir_;
+};
+
+TEST(LoggerTest, LevelsBelowTheActiveOneAreCompiledOut) {
+    evaluated = 0;
+    QUIDS_LOG_INFO("not evaluated {}", touch());
+    QUIDS_LOG_DEFERRED(DEBUG, "not evaluated {}", touch());
+    EXPECT_EQ(evaluated, 0);
+
+    // Above it, the runtime level decides
+    Logger::set_level(spdlog::level::critical);
+    QUIDS_LOG_ERROR("filtered at runtime {}", touch());
+    QUIDS_LOG_DEFERRED(ERROR, "filtered at runtime {}", touch());
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_FALSE(Logger::should_log(spdlog::level::err));
+
+    QUIDS_LOG_CRITICAL("evaluated {}", touch());
+    EXPECT_EQ(evaluated, 1);
+    Logger::set_level(spdlog::level::info);
+}
+
+TEST_F(LoggerFileTest, FlushWritesDeferredMessages) {
+    Logger::init("logger_test", logfile(), false, true, 1024);
+    QUIDS_LOG_DEFERRED(WARN, "deferred {} of {} at {:.1f}", 3, 4u, 2.5);
+    QUIDS_LOG_DEFERRED(ERROR, "no arguments");
+    Logger::flush();
+    EXPECT_TRUE(eventually([&] { return contents().find("deferred 3 of 4 at 2.5") != std::string::npos; }));
+    EXPECT_NE(contents().find("no arguments"), std::string::npos);
+
+    // After shutdown, deferred calls are formatted in place
+    Logger::shutdown();
+    QUIDS_LOG_DEFERRED(WARN, "late {}", 7);
+    Logger::flush();
+    EXPECT_TRUE(eventually([&] { return contents().find("late 7") != std::string::npos; }));
+}
+
+TEST_F(LoggerFileTest, FullQueuesDropAndCountMessages) {
+    constexpr int MESSAGES = 5000;
+    Logger::init("logger_test", logfile(), false, true, 8);
+    const uint64_t before = Logger::dropped();
+    for (int i = 0; i < MESSAGES; ++i) {
+        QUIDS_LOG_DEFERRED(WARN, "burst {}", i);
+    }
+    Logger::shutdown();
+
+    // Every message is either in the file or counted as dropped
+    EXPECT_TRUE(eventually([&] {
+        return count("burst ") + (Logger::dropped() - before) == static_cast<size_t>(MESSAGES);
+    })) << count("burst ") << " written, " << Logger::dropped() - before << " dropped";
+    EXPECT_GT(Logger::dropped(), before);
+}
+
+} // namespace test
+} // namespace common
+} // namespace quids
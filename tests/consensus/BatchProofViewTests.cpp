@@ -0,0 +1,277 @@
+#include <gtest/gtest.h>
+#include "consensus/BatchProofView.hpp"
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace consensus {
+namespace test {
+
+namespace {
+
+// Header offsets from the layout in BatchProofView.hpp
+constexpr size_t WITNESS_COUNT_OFFSET = 2;
+constexpr size_t MEASUREMENT_COUNT_OFFSET = 4;
+constexpr size_t FIELD_LENGTHS_OFFSET = 92;
+
+std::vector<uint8_t> bytes(size_t size, uint8_t seed) {
+    std::vector<uint8_t> out(size);
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = static_cast<uint8_t>(seed + 3 * i);
+    }
+    return out;
+}
+
+// Every variable field non-empty and of a different length, so a length
+// that lands on the wrong field shows
+OptimizedPOBPC::BatchProof sampleProof() {
+    OptimizedPOBPC::BatchProof proof;
+    proof.timestamp = 1'700'000'000'123;
+    proof.transaction_count = 42;
+    proof.batch_hash = bytes(proof_wire::HASH_SIZE, 1);
+    proof.proof_data = bytes(48, 2);
+    proof.quantum_state = quantum::QuantumState(3);
+    for (size_t i = 0; i < 4; ++i) {
+        quantum::QuantumMeasurement m;
+        m.outcome = i * 5;
+        m.fidelity = 0.25 * static_cast<double>(i);
+        proof.measurements.push_back(m);
+    }
+    proof.zkp_data.commitment = bytes(33, 3);
+    proof.zkp_data.challenge = bytes(17, 4);
+    proof.zkp_data.response = bytes(65, 5);
+    proof.zkp_data.recursive_proof = bytes(9, 6);
+    proof.zkp_data.verification_confidence = 0.875;
+    proof.witness_data.selected_witnesses = {"witness-0", "witness-1", "witness-2"};
+    proof.witness_data.reliability_scores = {1.0, 0.5, 0.75};
+    proof.witness_data.verification_times = {11, 22, 33};
+    proof.witness_data.quorum_threshold = 2.0 / 3.0;
+    proof.witness_data.has_consensus = true;
+    proof.witness_signatures = {bytes(40, 7), bytes(41, 8), bytes(39, 9)};
+    return proof;
+}
+
+std::vector<uint8_t> encode(const OptimizedPOBPC::BatchProof& proof) {
+    std::vector<uint8_t> out;
+    encodeBatchProof(proof, out);
+    return out;
+}
+
+void put32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        out[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+bool parses(const std::vector<uint8_t>& encoded) {
+    return BatchProofView::parse(encoded).has_value();
+}
+
+} // namespace
+
+TEST(BatchProofViewTest, ReadsBackEveryField) {
+    const auto proof = sampleProof();
+    // Appends after whatever is already in the buffer
+    std::vector<uint8_t> out{0xee, 0xee};
+    encodeBatchProof(proof, out);
+    const auto view = BatchProofView::parse(std::span(out).subspan(2));
+    ASSERT_TRUE(view);
+
+    EXPECT_EQ(view->timestamp(), proof.timestamp);
+    EXPECT_EQ(view->transactionCount(), proof.transaction_count);
+    EXPECT_TRUE(std::ranges::equal(view->batchHash(), proof.batch_hash));
+    EXPECT_TRUE(std::ranges::equal(view->stateCommitment(), stateCommitment(proof.quantum_state)));
+    EXPECT_EQ(view->stateQubits(), 3u);
+    EXPECT_TRUE(view->hasConsensus());
+    EXPECT_DOUBLE_EQ(view->quorumThreshold(), 2.0 / 3.0);
+    EXPECT_DOUBLE_EQ(view->zkpConfidence(), 0.875);
+
+    ASSERT_EQ(view->measurementCount(), proof.measurements.size());
+    for (size_t i = 0; i < proof.measurements.size(); ++i) {
+        EXPECT_EQ(view->measurement(i).outcome, proof.measurements[i].outcome);
+        EXPECT_EQ(view->measurement(i).fidelity, proof.measurements[i].fidelity);
+    }
+    ASSERT_EQ(view->witnessCount(), 3u);
+    for (size_t i = 0; i < 3; ++i) {
+        SCOPED_TRACE(i);
+        EXPECT_TRUE(std::ranges::equal(view->witnessId(i),
+                                       witnessIdDigest(proof.witness_data.selected_witnesses[i])));
+        EXPECT_EQ(view->witnessReliability(i), proof.witness_data.reliability_scores[i]);
+        EXPECT_EQ(view->witnessVerificationTime(i), proof.witness_data.verification_times[i]);
+        EXPECT_TRUE(std::ranges::equal(view->witnessSignature(i), proof.witness_signatures[i]));
+    }
+    EXPECT_TRUE(std::ranges::equal(view->proofData(), proof.proof_data));
+    EXPECT_TRUE(std::ranges::equal(view->zkpCommitment(), proof.zkp_data.commitment));
+    EXPECT_TRUE(std::ranges::equal(view->zkpChallenge(), proof.zkp_data.challenge));
+    EXPECT_TRUE(std::ranges::equal(view->zkpResponse(), proof.zkp_data.response));
+    EXPECT_TRUE(std::ranges::equal(view->zkpRecursiveProof(), proof.zkp_data.recursive_proof));
+
+    EXPECT_TRUE(view->commitsTo(proof.quantum_state));
+    EXPECT_FALSE(view->commitsTo(quantum::QuantumState(4)));
+    EXPECT_TRUE(view->isValid());
+    EXPECT_TRUE(view->isReadyForConsensus());
+}
+
+TEST(BatchProofViewTest, RejectsEveryTruncationAndTrailingBytes) {
+    const auto encoded = encode(sampleProof());
+    for (size_t size = 0; size < encoded.size(); ++size) {
+        EXPECT_FALSE(BatchProofView::parse(std::span(encoded).first(size))) << "truncated to " << size;
+    }
+    auto longer = encoded;
+    longer.push_back(0);
+    EXPECT_FALSE(parses(longer));
+
+    auto version = encoded;
+    version[0] = proof_wire::VERSION + 1;
+    EXPECT_FALSE(parses(version));
+    auto flags = encoded;
+    flags[1] |= 0x02;
+    EXPECT_FALSE(parses(flags));
+    EXPECT_TRUE(parses(encoded));
+}
+
+TEST(BatchProofViewTest, RejectsLengthsAndCountsPastTheBuffer) {
+    const auto encoded = encode(sampleProof());
+    const std::vector<uint32_t> lengths{48, 33, 17, 65, 9};
+
+    for (size_t f = 0; f < lengths.size(); ++f) {
+        SCOPED_TRACE(f);
+        for (const uint32_t length : {lengths[f] + 1, std::numeric_limits<uint32_t>::max()}) {
+            auto oversized = encoded;
+            put32(oversized, FIELD_LENGTHS_OFFSET + 4 * f, length);
+            EXPECT_FALSE(parses(oversized));
+        }
+    }
+
+    for (const uint32_t count : {5u, std::numeric_limits<uint32_t>::max()}) {
+        auto measurements = encoded;
+        put32(measurements, MEASUREMENT_COUNT_OFFSET, count);
+        EXPECT_FALSE(parses(measurements)) << count;
+    }
+    for (const uint16_t count : {uint16_t{4}, std::numeric_limits<uint16_t>::max()}) {
+        auto witnesses = encoded;
+        witnesses[WITNESS_COUNT_OFFSET] = static_cast<uint8_t>(count);
+        witnesses[WITNESS_COUNT_OFFSET + 1] = static_cast<uint8_t>(count >> 8);
+        EXPECT_FALSE(parses(witnesses)) << count;
+    }
+
+    // Signature ends must not go backwards or past the end
+    const size_t ends = proof_wire::HEADER_SIZE + 4 * proof_wire::MEASUREMENT_SIZE + 3 * proof_wire::WITNESS_SIZE;
+    auto backwards = encoded;
+    put32(backwards, ends + 4, 39);
+    EXPECT_FALSE(parses(backwards));
+    auto past = encoded;
+    put32(past, ends + 8, 40 + 41 + 39 + 1);
+    EXPECT_FALSE(parses(past));
+}
+
+TEST(BatchProofViewTest, EncoderRefusesWhatTheWireCannotHold) {
+    auto proof = sampleProof();
+    proof.batch_hash.pop_back();
+    EXPECT_THROW(encode(proof), std::length_error);
+
+    proof = sampleProof();
+    proof.witness_data.verification_times.pop_back();
+    EXPECT_THROW(encode(proof), std::invalid_argument);
+    proof = sampleProof();
+    proof.witness_signatures.push_back({});
+    EXPECT_THROW(encode(proof), std::invalid_argument);
+
+    proof = sampleProof();
+    const size_t too_many = std::numeric_limits<uint16_t>::max() + size_t{1};
+    proof.witness_data.selected_witnesses.assign(too_many, "w");
+    proof.witness_data.reliability_scores.assign(too_many, 1.0);
+    proof.witness_data.verification_times.assign(too_many, 1);
+    EXPECT_THROW(encode(proof), std::length_error);
+
+    // Nothing is written when it throws
+    std::vector<uint8_t> out{1, 2, 3};
+    EXPECT_THROW(encodeBatchProof(proof, out), std::length_error);
+    EXPECT_EQ(out, (std::vector<uint8_t>{1, 2, 3}));
+}
+
+TEST(BatchProofViewTest, QuorumMatchesTheDecodedProof) {
+    struct Case {
+        std::vector<double> reliability;
+        std::vector<uint64_t> verified_at;
+        size_t signatures;
+        double threshold;
+    };
+    const std::vector<Case> cases{
+        {{1.0, 1.0, 1.0}, {1, 1, 1}, 3, 0.66},
+        {{1.0, 1.0, 1.0}, {1, 1, 0}, 3, 0.66},   // exactly two thirds
+        {{1.0, 1.0, 1.0}, {1, 0, 0}, 3, 0.66},
+        {{3.0, 0.5, 0.5}, {1, 0, 0}, 3, 0.66},   // one heavy witness carries it
+        {{0.5, 0.5, 3.0}, {1, 1, 0}, 3, 0.66},
+        {{1.0, 1.0, 1.0}, {1, 1, 1}, 1, 0.66},   // verified but mostly unsigned
+        {{1.0, 1.0, 1.0}, {1, 1, 1}, 2, 0.66},
+        {{0.0, 0.0, 0.0}, {1, 1, 1}, 3, 0.66},   // no weight at all
+        {{1.0, 1.0, 1.0}, {1, 1, 1}, 3, 0.5},    // below the BFT minimum
+    };
+    for (size_t c = 0; c < cases.size(); ++c) {
+        SCOPED_TRACE(c);
+        auto proof = sampleProof();
+        proof.witness_data.reliability_scores = cases[c].reliability;
+        proof.witness_data.verification_times = cases[c].verified_at;
+        proof.witness_data.quorum_threshold = cases[c].threshold;
+        proof.witness_signatures.resize(cases[c].signatures);
+        proof.metrics = {1.0, 1.0, 1.0, 0, 1.0};
+
+        const auto encoded = encode(proof);
+        const auto view = BatchProofView::parse(encoded);
+        ASSERT_TRUE(view);
+        EXPECT_EQ(view->hasQuorum(), proof.witness_data.hasQuorum());
+        EXPECT_DOUBLE_EQ(view->calculateConfidence(), proof.calculateConfidence());
+        EXPECT_EQ(view->isValid(), proof.isValid());
+        EXPECT_EQ(view->isReadyForConsensus(), proof.isReadyForConsensus());
+        for (size_t i = cases[c].signatures; i < 3; ++i) {
+            EXPECT_TRUE(view->witnessSignature(i).empty());
+        }
+    }
+
+    // Spot checks, so a shared mistake on both sides still shows
+    auto proof = sampleProof();
+    proof.witness_data.verification_times = {1, 0, 0};
+    EXPECT_FALSE(BatchProofView::parse(encode(proof))->hasQuorum());
+    proof.witness_data.verification_times = {1, 0, 1};
+    EXPECT_TRUE(BatchProofView::parse(encode(proof))->hasQuorum());
+    proof.witness_signatures.resize(1);
+    EXPECT_FALSE(BatchProofView::parse(encode(proof))->isReadyForConsensus());
+}
+
+TEST(BatchProofViewTest, GeneratedProofVerifiesFromItsEncoding) {
+    BatchConfig config;
+    config.witness_count = 3;
+    config.consensus_threshold = 2.0 / 3.0;
+    config.batch_size = 4;
+    OptimizedPOBPC pobpc(config);
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_TRUE(pobpc.registerWitness("witness-" + std::to_string(i), std::vector<uint8_t>(32, uint8_t(i + 1))));
+    }
+    for (uint8_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(pobpc.addTransaction(std::vector<uint8_t>(48, i)));
+    }
+    const auto proof = pobpc.generateBatchProof();
+    const auto encoded = encode(proof);
+    ASSERT_TRUE(parses(encoded));
+    EXPECT_TRUE(pobpc.verifyBatchProof(encoded));
+
+    // Two of three signatures damaged loses the quorum
+    const auto view = BatchProofView::parse(encoded);
+    const size_t signatures = view->bytes().size() - view->witnessSignature(0).size() -
+                              view->witnessSignature(1).size() - view->witnessSignature(2).size();
+    auto damaged = encoded;
+    damaged[signatures] ^= 1;
+    EXPECT_TRUE(pobpc.verifyBatchProof(damaged));
+    damaged[signatures + view->witnessSignature(0).size()] ^= 1;
+    EXPECT_FALSE(pobpc.verifyBatchProof(damaged));
+
+    // And a cut encoding is refused outright
+    EXPECT_FALSE(pobpc.verifyBatchProof(std::span(encoded).first(encoded.size() - 1)));
+}
+
+} // namespace test
+} // namespace consensus
+} // namespace quids
@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+#include "consensus/OptimizedPOBPC.hpp"
+#include "crypto/signature/Falcon.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace consensus {
+namespace test {
+
+namespace {
+
+constexpr size_t WITNESSES = 3;
+
+BatchConfig config(size_t batch_size) {
+    BatchConfig config;
+    config.witness_count = WITNESSES;
+    config.consensus_threshold = 2.0 / 3.0;
+    config.batch_size = batch_size;
+    config.batch_timeout = std::chrono::milliseconds(50);
+    return config;
+}
+
+std::vector<uint8_t> transaction(size_t i) {
+    return std::vector<uint8_t>(48, static_cast<uint8_t>(i));
+}
+
+std::unique_ptr<OptimizedPOBPC> make_pobpc(const BatchConfig& config) {
+    auto pobpc = std::make_unique<OptimizedPOBPC>(config);
+    for (size_t i = 0; i < WITNESSES; ++i) {
+        EXPECT_TRUE(pobpc->registerWitness("witness-" + std::to_string(i), std::vector<uint8_t>(32, uint8_t(i + 1))));
+    }
+    return pobpc;
+}
+
+// Collects the pipeline's proofs and lets the test wait for a count
+class ProofSink {
+public:
+    void operator()(OptimizedPOBPC::BatchProof&& proof) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        proofs_.push_back(std::move(proof));
+        arrived_.notify_all();
+    }
+
+    bool waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return arrived_.wait_for(lock, std::chrono::seconds(60), [&] { return proofs_.size() >= count; });
+    }
+
+    std::vector<OptimizedPOBPC::BatchProof> take() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::move(proofs_);
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable arrived_;
+    std::vector<OptimizedPOBPC::BatchProof> proofs_;
+};
+
+} // namespace
+
+TEST(OptimizedPOBPCPipelineTest, EmitsProofsInBatchOrder) {
+    constexpr size_t BATCH = 4;
+    constexpr size_t BATCHES = 5;
+    auto pobpc = make_pobpc(config(BATCH));
+    for (size_t i = 0; i < BATCH * BATCHES; ++i) {
+        ASSERT_TRUE(pobpc->addTransaction(transaction(i)));
+    }
+
+    ProofSink sink;
+    pobpc->startPipeline([&](OptimizedPOBPC::BatchProof&& proof) { sink(std::move(proof)); });
+    EXPECT_THROW(pobpc->startPipeline(nullptr), std::logic_error);
+    ASSERT_TRUE(sink.waitFor(BATCHES));
+    pobpc->stopPipeline();
+    const auto proofs = sink.take();
+    ASSERT_EQ(proofs.size(), BATCHES);
+
+    // Batch k holds transactions 4k..4k+3, so its hash is what the
+    // sequential path gives for the same four
+    for (size_t k = 0; k < BATCHES; ++k) {
+        SCOPED_TRACE(k);
+        auto sequential = std::make_unique<OptimizedPOBPC>(config(BATCH));
+        for (size_t i = k * BATCH; i < (k + 1) * BATCH; ++i) {
+            ASSERT_TRUE(sequential->addTransaction(transaction(i)));
+        }
+        EXPECT_EQ(proofs[k].batch_hash, sequential->generateBatchProof().batch_hash);
+        EXPECT_EQ(proofs[k].transaction_count, BATCH);
+        EXPECT_TRUE(proofs[k].isValid());
+        EXPECT_TRUE(pobpc->verifyBatchProof(proofs[k]));
+    }
+
+    const auto stats = pobpc->getPipelineStats();
+    EXPECT_EQ(stats.batches_completed, BATCHES);
+    EXPECT_EQ(stats.collect.count, BATCHES);
+    EXPECT_EQ(stats.prove.count, BATCHES);
+    EXPECT_EQ(stats.witness.count, BATCHES);
+    EXPECT_GT(stats.witness.percentileMicros(1.0), 0u);
+    EXPECT_EQ(pobpc->getMetrics().total_batches, BATCHES);
+    EXPECT_EQ(pobpc->getMetrics().total_transactions, BATCH * BATCHES);
+}
+
+TEST(OptimizedPOBPCPipelineTest, EmitsPartialBatchAfterTimeout) {
+    auto pobpc = make_pobpc(config(8));
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_TRUE(pobpc->addTransaction(transaction(i)));
+    }
+
+    ProofSink sink;
+    pobpc->startPipeline([&](OptimizedPOBPC::BatchProof&& proof) { sink(std::move(proof)); });
+    ASSERT_TRUE(sink.waitFor(1));
+    pobpc->stopPipeline();
+    const auto proofs = sink.take();
+    ASSERT_EQ(proofs.size(), 1u);
+    EXPECT_EQ(proofs[0].transaction_count, 3u);
+}
+
+TEST(OptimizedPOBPCPipelineTest, SlowConsumerHoldsBackEarlierStages) {
+    constexpr size_t BATCHES = 6;
+    auto cfg = config(1);
+    cfg.pipeline_depth = 1;
+    auto pobpc = make_pobpc(cfg);
+    for (size_t i = 0; i < BATCHES; ++i) {
+        ASSERT_TRUE(pobpc->addTransaction(transaction(i)));
+    }
+
+    ProofSink sink;
+    pobpc->startPipeline([&](OptimizedPOBPC::BatchProof&& proof) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        sink(std::move(proof));
+    });
+    ASSERT_TRUE(sink.waitFor(BATCHES));
+    pobpc->stopPipeline();
+
+    // Nothing is dropped or reordered while the stages wait
+    const auto proofs = sink.take();
+    ASSERT_EQ(proofs.size(), BATCHES);
+    for (size_t k = 0; k < BATCHES; ++k) {
+        auto sequential = std::make_unique<OptimizedPOBPC>(cfg);
+        ASSERT_TRUE(sequential->addTransaction(transaction(k)));
+        EXPECT_EQ(proofs[k].batch_hash, sequential->generateBatchProof().batch_hash) << k;
+    }
+    EXPECT_GT(pobpc->getPipelineStats().backpressure_waits, 0u);
+}
+
+TEST(OptimizedPOBPCPipelineTest, StopDrainsBatchesAlreadyInside) {
+    constexpr size_t BATCHES = 4;
+    auto pobpc = make_pobpc(config(1));
+    for (size_t i = 0; i < BATCHES; ++i) {
+        ASSERT_TRUE(pobpc->addTransaction(transaction(i)));
+    }
+
+    ProofSink sink;
+    pobpc->startPipeline([&](OptimizedPOBPC::BatchProof&& proof) { sink(std::move(proof)); });
+    ASSERT_TRUE(sink.waitFor(1));
+    pobpc->stopPipeline();
+
+    // Whatever the collector took was proven and signed before stop returned
+    const auto stats = pobpc->getPipelineStats();
+    EXPECT_EQ(stats.batches_completed, stats.collect.count);
+    EXPECT_EQ(sink.take().size(), stats.collect.count);
+}
+
+TEST(OptimizedPOBPCWitnessTest, SignsEverySelectedWitnessSlot) {
+    auto pobpc = make_pobpc(config(4));
+    for (size_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(pobpc->addTransaction(transaction(i)));
+    }
+    const auto proof = pobpc->generateBatchProof();
+    ASSERT_EQ(proof.witness_signatures.size(), WITNESSES);
+    ASSERT_EQ(proof.witness_data.selected_witnesses.size(), WITNESSES);
+    for (const auto& signature : proof.witness_signatures) {
+        EXPECT_FALSE(signature.empty());
+    }
+    EXPECT_TRUE(proof.witness_data.has_consensus);
+    EXPECT_TRUE(pobpc->verifyBatchProof(proof));
+
+    // One bad slot still leaves two of three
+    auto damaged = proof;
+    damaged.witness_signatures[0][damaged.witness_signatures[0].size() / 2] ^= 1;
+    EXPECT_TRUE(pobpc->verifyBatchProof(damaged));
+    damaged.witness_signatures[1][damaged.witness_signatures[1].size() / 2] ^= 1;
+    EXPECT_FALSE(pobpc->verifyBatchProof(damaged));
+
+    // A slot is bound to its witness: swapped ids fail, repeated ids count once
+    auto swapped = proof;
+    std::swap(swapped.witness_data.selected_witnesses[0], swapped.witness_data.selected_witnesses[1]);
+    std::swap(swapped.witness_data.selected_witnesses[1], swapped.witness_data.selected_witnesses[2]);
+    EXPECT_FALSE(pobpc->verifyBatchProof(swapped));
+    auto repeated = proof;
+    repeated.witness_data.selected_witnesses = {proof.witness_data.selected_witnesses[0],
+                                                proof.witness_data.selected_witnesses[0],
+                                                proof.witness_data.selected_witnesses[0]};
+    repeated.witness_signatures = {proof.witness_signatures[0], proof.witness_signatures[0],
+                                   proof.witness_signatures[0]};
+    EXPECT_FALSE(pobpc->verifyBatchProof(repeated));
+
+    // Signatures over another batch do not carry over
+    auto other = proof;
+    other.batch_hash[0] ^= 1;
+    EXPECT_FALSE(pobpc->verifyBatchProof(other));
+}
+
+TEST(OptimizedPOBPCWitnessTest, KeysRotateWithTheEpoch) {
+    auto cfg = config(1);
+    cfg.key_rotation_batches = 2;
+    auto pobpc = make_pobpc(cfg);
+    std::vector<OptimizedPOBPC::BatchProof> proofs;
+    auto next = [&] {
+        EXPECT_TRUE(pobpc->addTransaction(transaction(proofs.size())));
+        proofs.push_back(pobpc->generateBatchProof());
+    };
+
+    // Batches 0 and 1 share epoch 0's keys
+    next();
+    next();
+    EXPECT_TRUE(pobpc->verifyBatchProof(proofs[0]));
+
+    // Epoch 1 rotates; the keys it replaced still verify what they signed
+    next();
+    EXPECT_TRUE(pobpc->verifyBatchProof(proofs[0]));
+    EXPECT_TRUE(pobpc->verifyBatchProof(proofs[2]));
+
+    // A second rotation retires epoch 0's keys
+    next();
+    next();
+    EXPECT_FALSE(pobpc->verifyBatchProof(proofs[0]));
+    EXPECT_FALSE(pobpc->verifyBatchProof(proofs[1]));
+    EXPECT_TRUE(pobpc->verifyBatchProof(proofs[3]));
+    EXPECT_TRUE(pobpc->verifyBatchProof(proofs[4]));
+}
+
+TEST(OptimizedPOBPCWitnessTest, VotesAreCheckedAgainstTheRegisteredKey) {
+    crypto::FalconSigner witness;
+    witness.generateKeyPair();
+    auto pobpc = std::make_unique<OptimizedPOBPC>(config(4));
+    ASSERT_TRUE(pobpc->registerWitness("voter", witness.getPublicKey()));
+    EXPECT_FALSE(pobpc->registerWitness("voter", witness.getPublicKey()));
+    ASSERT_TRUE(pobpc->addTransaction(transaction(0)));
+    const auto proof = pobpc->generateBatchProof();
+
+    auto forged = witness.sign(proof.batch_hash);
+    forged[forged.size() / 2] ^= 1;
+    EXPECT_FALSE(pobpc->submitWitnessVote("voter", forged, proof));
+    EXPECT_FALSE(pobpc->submitWitnessVote("stranger", witness.sign(proof.batch_hash), proof));
+    EXPECT_TRUE(pobpc->submitWitnessVote("voter", witness.sign(proof.batch_hash), proof));
+
+    const auto selected = pobpc->selectWitnesses();
+    ASSERT_EQ(selected.size(), 1u);
+    EXPECT_EQ(selected[0].total_validations, 2u);
+    EXPECT_DOUBLE_EQ(selected[0].reliability_score, 0.5);
+}
+
+} // namespace test
+} // namespace consensus
+} // namespace quids
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include "consensus/POBPC.hpp"
+#include "crypto/signature/Falcon.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace consensus {
+namespace test {
+
+namespace {
+
+constexpr size_t WITNESSES = 5;
+
+POBPC::BatchConfig config(const std::string& node_id = "proposer") {
+    POBPC::BatchConfig config;
+    config.node_id = node_id;
+    config.witness_count = WITNESSES;
+    config.consensus_threshold = 0.6;  // three of five
+    return config;
+}
+
+std::string witnessId(size_t i) {
+    return "witness-" + std::to_string(i);
+}
+
+} // namespace
+
+class POBPCVoteTest : public ::testing::Test {
+protected:
+    // Key generation dominates, so the witnesses keep theirs across tests
+    static void SetUpTestSuite() {
+        for (size_t i = 0; i < WITNESSES; ++i) {
+            signers_.emplace_back(std::make_unique<crypto::FalconSigner>())->generateKeyPair();
+        }
+    }
+    static void TearDownTestSuite() { signers_.clear(); }
+
+    void SetUp() override {
+        pobpc_ = std::make_unique<POBPC>(config());
+        for (size_t i = 0; i < WITNESSES; ++i) {
+            ASSERT_TRUE(pobpc_->registerWitness(witnessId(i), signers_[i]->getPublicKey()));
+        }
+        for (uint8_t i = 0; i < 4; ++i) {
+            ASSERT_TRUE(pobpc_->addTransaction(std::vector<uint8_t>(64, i)));
+        }
+        proof_ = pobpc_->generateBatchProof();
+    }
+
+    std::vector<uint8_t> vote(size_t witness) {
+        return signers_[witness]->sign(proof_.batch_hash);
+    }
+
+    // Another node with the same witness set, which saw none of the votes
+    std::unique_ptr<POBPC> observer() {
+        auto other = std::make_unique<POBPC>(config("observer"));
+        for (size_t i = 0; i < WITNESSES; ++i) {
+            other->registerWitness(witnessId(i), signers_[i]->getPublicKey());
+        }
+        return other;
+    }
+
+    static std::vector<std::unique_ptr<crypto::FalconSigner>> signers_;
+    std::unique_ptr<POBPC> pobpc_;
+    POBPC::BatchProof proof_;
+};
+
+std::vector<std::unique_ptr<crypto::FalconSigner>> POBPCVoteTest::signers_;
+
+TEST_F(POBPCVoteTest, HonestQuorumReachesConsensus) {
+    EXPECT_TRUE(pobpc_->verifyBatchProof(proof_));
+    EXPECT_EQ(proof_.transaction_count, 4u);
+
+    EXPECT_TRUE(pobpc_->submitWitnessVote(witnessId(4), vote(4), proof_));
+    EXPECT_TRUE(pobpc_->submitWitnessVote(witnessId(0), vote(0), proof_));
+    EXPECT_FALSE(pobpc_->hasReachedConsensus(proof_));
+    EXPECT_TRUE(pobpc_->submitWitnessVote(witnessId(2), vote(2), proof_));
+    EXPECT_TRUE(pobpc_->hasReachedConsensus(proof_));
+
+    // Signatures sit in witness order whatever order the votes came in
+    ASSERT_EQ(proof_.signerCount(), 3u);
+    ASSERT_EQ(proof_.witness_signatures.size(), 3u);
+    EXPECT_EQ(proof_.signer_bitmap, std::vector<uint64_t>{0b10101});
+
+    // Nothing local is needed to check the quorum
+    EXPECT_TRUE(observer()->hasReachedConsensus(proof_));
+}
+
+TEST_F(POBPCVoteTest, ForgedBitmapIsRejected) {
+    ASSERT_TRUE(pobpc_->submitWitnessVote(witnessId(0), vote(0), proof_));
+
+    // Bits claimed for witnesses that never signed, with no signatures
+    auto claimed = proof_;
+    claimed.signer_bitmap[0] |= 0b00110;
+    EXPECT_FALSE(pobpc_->hasReachedConsensus(claimed));
+    EXPECT_FALSE(observer()->hasReachedConsensus(claimed));
+
+    // Or padded with a signature that belongs to someone else
+    claimed.witness_signatures = {vote(0), vote(0), vote(0)};
+    EXPECT_FALSE(pobpc_->hasReachedConsensus(claimed));
+    EXPECT_FALSE(observer()->hasReachedConsensus(claimed));
+
+    // Real signatures over a different batch do not count either
+    auto other = proof_;
+    other.batch_hash[0] ^= 1;
+    claimed.witness_signatures = {vote(0), signers_[1]->sign(other.batch_hash),
+                                  signers_[2]->sign(other.batch_hash)};
+    EXPECT_FALSE(observer()->hasReachedConsensus(claimed));
+
+    // Bits past the witness table
+    auto beyond = proof_;
+    beyond.signer_bitmap = {0b1, 0b111};
+    beyond.witness_signatures = {vote(0), vote(1), vote(2), vote(3)};
+    EXPECT_FALSE(pobpc_->hasReachedConsensus(beyond));
+}
+
+TEST_F(POBPCVoteTest, DuplicateSignerIsIgnored) {
+    const auto signature = vote(1);
+    EXPECT_TRUE(pobpc_->submitWitnessVote(witnessId(1), signature, proof_));
+    EXPECT_FALSE(pobpc_->submitWitnessVote(witnessId(1), signature, proof_));
+    EXPECT_FALSE(pobpc_->submitWitnessVote(witnessId(1), vote(1), proof_));
+    EXPECT_EQ(proof_.signerCount(), 1u);
+    EXPECT_EQ(proof_.witness_signatures.size(), 1u);
+
+    EXPECT_TRUE(pobpc_->submitWitnessVote(witnessId(3), vote(3), proof_));
+    EXPECT_FALSE(pobpc_->hasReachedConsensus(proof_));
+
+    // A bad signature or an unknown witness adds nothing
+    auto corrupted = vote(0);
+    corrupted[corrupted.size() / 2] ^= 0x01;
+    EXPECT_FALSE(pobpc_->submitWitnessVote(witnessId(0), corrupted, proof_));
+    EXPECT_FALSE(pobpc_->submitWitnessVote("stranger", vote(0), proof_));
+    EXPECT_EQ(proof_.signerCount(), 2u);
+    EXPECT_FALSE(pobpc_->hasReachedConsensus(proof_));
+
+    EXPECT_TRUE(pobpc_->submitWitnessVote(witnessId(0), vote(0), proof_));
+    EXPECT_TRUE(pobpc_->hasReachedConsensus(proof_));
+}
+
+TEST_F(POBPCVoteTest, OtherNodesVerifyAgainstTheRegisteredProposerKey) {
+    EXPECT_EQ(proof_.proposer_id, "proposer");
+    auto other = observer();
+    // Unknown proposers are not trusted
+    EXPECT_FALSE(other->verifyBatchProof(proof_));
+
+    ASSERT_TRUE(other->registerProposer("proposer", pobpc_->getProposerPublicKey()));
+    EXPECT_TRUE(other->verifyBatchProof(proof_));
+
+    // Nor is a signature claimed for a proposer that did not make it
+    auto relabeled = proof_;
+    relabeled.proposer_id = "observer";
+    EXPECT_FALSE(other->verifyBatchProof(relabeled));
+    auto tampered = proof_;
+    tampered.batch_hash[0] ^= 1;
+    EXPECT_FALSE(other->verifyBatchProof(tampered));
+
+    // A node's own key cannot be replaced
+    EXPECT_FALSE(other->registerProposer("observer", pobpc_->getProposerPublicKey()));
+    EXPECT_FALSE(other->registerProposer("third", {}));
+}
+
+} // namespace test
+} // namespace consensus
+} // namespace quids
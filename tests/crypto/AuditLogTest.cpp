@@ -0,0 +1,55 @@
+#include "crypto/AuditLog.hpp"
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+TEST(AuditLogTest, FlushDeliversEveryRecordInOrder) {
+    AuditLog log;
+    std::mutex mutex;
+    std::vector<AuditLog::Record> seen;
+    log.setSink([&](const std::vector<AuditLog::Record>& batch) {
+        std::lock_guard<std::mutex> lock(mutex);
+        seen.insert(seen.end(), batch.begin(), batch.end());
+    });
+
+    const std::vector<uint8_t> key(1568, 0x5a);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(log.record("encapsulate." + std::to_string(i), key));
+    }
+    log.flush();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(seen.size(), 1000u);
+    EXPECT_EQ(seen.front().operation, "encapsulate.0");
+    EXPECT_EQ(seen.back().operation, "encapsulate.999");
+    EXPECT_EQ(seen.front().data_size, key.size());
+    EXPECT_EQ(seen.front().digest, seen.back().digest);
+    EXPECT_EQ(log.stats().written, 1000u);
+}
+
+TEST(AuditLogTest, DropsInsteadOfBlockingWhenFull) {
+    AuditLog log(4);
+    std::mutex gate;
+    std::unique_lock<std::mutex> held(gate);
+    log.setSink([&](const std::vector<AuditLog::Record>&) { std::lock_guard<std::mutex> lock(gate); });
+
+    const std::vector<uint8_t> data{1, 2, 3};
+    size_t accepted = 0;
+    for (int i = 0; i < 100; ++i) {
+        accepted += log.record("sign", data);
+    }
+    EXPECT_LT(accepted, 100u);
+    EXPECT_EQ(log.stats().dropped, 100u - accepted);
+
+    held.unlock();
+    log.flush();
+    EXPECT_EQ(log.stats().written, accepted);
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
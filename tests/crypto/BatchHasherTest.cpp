@@ -0,0 +1,47 @@
+#include "crypto/blake3/BatchHasher.hpp"
+#include "crypto/blake3/Blake3Hash.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+namespace {
+
+MerkleHash blake3(const std::vector<uint8_t>& data) {
+    Blake3Hash hasher;
+    hasher.update(data);
+    return MerkleBuilder::toHash(hasher.finalize());
+}
+
+} // namespace
+
+TEST(BatchHasherTest, MatchesBlake3OneAtATime) {
+    std::mt19937 rng(3);
+    std::vector<std::vector<uint8_t>> messages;
+    // Every block boundary of a chunk, plus messages past the chunk that take
+    // the library path, shuffled so groups mix lengths
+    for (size_t length : {0, 1, 63, 64, 65, 127, 128, 1023, 1024, 1025, 3000}) {
+        messages.emplace_back(length);
+    }
+    for (size_t i = 0; i < 200; ++i) {
+        messages.emplace_back(rng() % 1100);
+    }
+    for (auto& m : messages) {
+        for (auto& b : m) b = static_cast<uint8_t>(rng());
+    }
+    std::shuffle(messages.begin(), messages.end(), rng);
+
+    const auto digests = BatchHasher::hashMany(messages);
+    ASSERT_EQ(digests.size(), messages.size());
+    for (size_t i = 0; i < messages.size(); ++i) {
+        EXPECT_EQ(digests[i], blake3(messages[i])) << "length " << messages[i].size() << " on " << BatchHasher::isa();
+    }
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
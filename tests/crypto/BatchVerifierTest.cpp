@@ -0,0 +1,104 @@
+#include "crypto/signature/BatchVerifier.hpp"
+#include "crypto/falcon/falcon.hpp"
+#include <gtest/gtest.h>
+#include <array>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+namespace {
+
+constexpr size_t N = 512;
+
+struct Signed {
+    std::vector<uint8_t> message;
+    std::vector<uint8_t> signature;
+};
+
+class BatchVerifierTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        for (auto& key : keys) {
+            key.pk.resize(falcon_utils::compute_pkey_len<N>());
+            key.sk.resize(falcon_utils::compute_skey_len<N>());
+            ::falcon::keygen<N>(key.pk.data(), key.sk.data());
+        }
+    }
+
+    Signed sign(size_t key, uint8_t tag) {
+        Signed out;
+        out.message = {'t', 'x', tag, static_cast<uint8_t>(key)};
+        out.signature.resize(falcon_utils::compute_sig_len<N>());
+        EXPECT_TRUE(::falcon::sign<N>(keys[key].sk.data(), out.message.data(), out.message.size(),
+                                      out.signature.data()));
+        return out;
+    }
+
+    VerifyItem item(const Signed& s, size_t key, SignatureScheme scheme = SignatureScheme::Falcon512) {
+        return {scheme, s.message, s.signature, keys[key].pk};
+    }
+
+    struct KeyPair {
+        std::vector<uint8_t> pk;
+        std::vector<uint8_t> sk;
+    };
+    std::array<KeyPair, 2> keys;
+    utils::WorkStealingPool pool{utils::WorkStealingPool::Config{2}};
+};
+
+} // namespace
+
+TEST_F(BatchVerifierTest, ChecksEverySignatureAndDecodesEachKeyOnce) {
+    std::vector<Signed> sigs;
+    std::vector<size_t> owner;
+    for (uint8_t i = 0; i < 24; ++i) {
+        owner.push_back(i % 2);
+        sigs.push_back(sign(i % 2, i));
+    }
+    sigs[5].message[0] ^= 1;           // tampered message
+    sigs[9].signature[50] ^= 0x10;     // tampered signature
+    owner[13] = 1 - owner[13];         // signed by the other key
+
+    std::vector<VerifyItem> items;
+    for (size_t i = 0; i < sigs.size(); ++i) {
+        items.push_back(item(sigs[i], owner[i]));
+    }
+
+    BatchVerifier verifier(pool);
+    auto result = verifier.verify(items);
+    ASSERT_EQ(result.size(), items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        EXPECT_EQ(result[i], (i == 5 || i == 9 || i == 13) ? 0 : 1) << "item " << i;
+    }
+    EXPECT_EQ(verifier.stats().keys_decoded, 2u);
+
+    // A second batch under the same keys finds them cached
+    auto again = verifier.verify(items);
+    EXPECT_EQ(again, result);
+    EXPECT_EQ(verifier.stats().keys_decoded, 2u);
+    EXPECT_EQ(verifier.stats().key_cache_hits, 2u);
+    EXPECT_EQ(verifier.stats().signatures, 2 * items.size());
+}
+
+TEST_F(BatchVerifierTest, RejectsUnknownSchemesAndBadKeys) {
+    const Signed good = sign(0, 1);
+    std::vector<uint8_t> short_key(keys[0].pk.begin(), keys[0].pk.end() - 1);
+
+    std::vector<VerifyItem> items = {
+        item(good, 0),
+        item(good, 0, SignatureScheme::Dilithium),  // not registered here
+        {SignatureScheme::Falcon512, good.message, good.signature, short_key},
+        item(good, 0, SignatureScheme::Falcon1024),  // wrong degree for the key
+    };
+
+    BatchVerifier verifier(pool);
+    EXPECT_FALSE(verifier.has_scheme(SignatureScheme::Dilithium));
+    EXPECT_EQ(verifier.verify(items), (std::vector<uint8_t>{1, 0, 0, 0}));
+    EXPECT_TRUE(verifier.verify(std::span<const VerifyItem>{}).empty());
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
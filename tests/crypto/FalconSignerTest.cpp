@@ -0,0 +1,78 @@
+#include "crypto/signature/Falcon.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+TEST(FalconSignerTest, PreparedKeyVerifiesLikeEncodedKey) {
+    FalconSigner signer;
+    signer.generateKeyPair();
+    const std::vector<uint8_t> message{'w', 'i', 't', 'n', 'e', 's', 's'};
+    const auto signature = signer.sign(message);
+    ASSERT_EQ(signature.size(), signer.getSignatureSize());
+
+    auto prepared = PreparedPublicKey::prepare(signer.getPublicKey());
+    ASSERT_NE(prepared, nullptr);
+    EXPECT_EQ(prepared->getFingerprint(), PreparedPublicKey::fingerprint(signer.getPublicKey()));
+    EXPECT_TRUE(signer.verify(message, signature, *prepared));
+    EXPECT_TRUE(signer.verify(message, signature, signer.getPublicKey()));
+
+    auto tampered = message;
+    tampered[0] ^= 1;
+    EXPECT_FALSE(signer.verify(tampered, signature, *prepared));
+    EXPECT_FALSE(signer.verify(message, signature, std::vector<uint8_t>(signer.getPublicKeySize(), 0xff)));
+}
+
+TEST(FalconSignerTest, SigningKeyIsReusableAcrossThreads) {
+    FalconSigner signer;
+    signer.generateKeyPair();
+    auto loaded = SigningKey::load(signer.getPrivateKey());
+    ASSERT_NE(loaded, nullptr);
+    EXPECT_EQ(SigningKey::load({1, 2, 3}), nullptr);
+
+    std::vector<std::vector<uint8_t>> signatures(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < signatures.size(); ++i) {
+        threads.emplace_back([&, i] {
+            signatures[i] = loaded->sign({static_cast<uint8_t>(i)});
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (size_t i = 0; i < signatures.size(); ++i) {
+        EXPECT_TRUE(signer.verify({static_cast<uint8_t>(i)}, signatures[i], signer.getPublicKey()));
+    }
+    EXPECT_TRUE(signer.verify({9}, signer.getSigningKey()->sign({9}), signer.getPublicKey()));
+}
+
+TEST(FalconSignerTest, CacheEvictsLeastRecentlyUsed) {
+    std::vector<std::vector<uint8_t>> keys;
+    for (int i = 0; i < 3; ++i) {
+        FalconSigner signer;
+        signer.generateKeyPair();
+        keys.push_back(signer.getPublicKey());
+    }
+
+    PreparedKeyCache cache(2);
+    auto first = cache.get(keys[0]);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(cache.get(keys[1]), nullptr);
+    EXPECT_EQ(cache.get(keys[0]), first);  // hit, now most recent
+    ASSERT_NE(cache.get(keys[2]), nullptr);  // evicts keys[1]
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.get(keys[0]), first);
+    EXPECT_EQ(cache.stats().hits, 2u);
+
+    (void)cache.get(keys[1]);
+    EXPECT_EQ(cache.stats().misses, 4u);
+    EXPECT_EQ(cache.get({1, 2, 3}), nullptr);
+    EXPECT_EQ(cache.size(), 2u);
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
@@ -0,0 +1,102 @@
+#include "crypto/falcon/fft.hpp"
+#include "crypto/falcon/ntt.hpp"
+#include "crypto/falcon/polynomial.hpp"
+#include <gtest/gtest.h>
+#include <array>
+#include <cstring>
+#include <random>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+namespace {
+
+constexpr size_t LOG2N = 10;
+constexpr size_t N = 1ul << LOG2N;
+
+using ZqPoly = std::array<ff::ff_t, N>;
+using CPoly = std::array<fft::cmplx, N>;
+
+// Runs fn once on each path and returns (scalar, vector) outputs
+template<typename Poly, typename Fn>
+std::pair<Poly, Poly> both_paths(const Poly& input, Fn fn) {
+    Poly scalar = input;
+    Poly vector = input;
+    simd::enabled = false;
+    fn(scalar);
+    simd::enabled = true;
+    fn(vector);
+    return {scalar, vector};
+}
+
+bool same_bits(const CPoly& a, const CPoly& b) {
+    return std::memcmp(a.data(), b.data(), sizeof(CPoly)) == 0;
+}
+
+class FalconSimdTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::uniform_int_distribution<uint32_t> zq(0, ff::Q - 1);
+        std::uniform_real_distribution<double> real(-4096.0, 4096.0);
+        for (size_t i = 0; i < N; i++) {
+            a[i] = ff::ff_t{ static_cast<uint16_t>(zq(rng)) };
+            b[i] = ff::ff_t{ static_cast<uint16_t>(zq(rng)) };
+            x[i] = { real(rng), real(rng) };
+            y[i] = { real(rng), real(rng) };
+        }
+    }
+
+    void TearDown() override { simd::enabled = true; }
+
+    std::mt19937 rng{ 12289 };
+    ZqPoly a, b;
+    CPoly x, y;
+};
+
+} // namespace
+
+TEST_F(FalconSimdTest, NttMatchesScalar) {
+    if (!simd::has_avx2()) GTEST_SKIP() << "no AVX2 on this CPU";
+
+    auto [s, v] = both_paths(a, [](ZqPoly& p) { ntt::ntt<LOG2N>(p.data()); });
+    EXPECT_EQ(std::memcmp(s.data(), v.data(), sizeof(ZqPoly)), 0);
+
+    auto [si, vi] = both_paths(s, [](ZqPoly& p) { ntt::intt<LOG2N>(p.data()); });
+    EXPECT_EQ(std::memcmp(si.data(), vi.data(), sizeof(ZqPoly)), 0);
+    EXPECT_EQ(std::memcmp(vi.data(), a.data(), sizeof(ZqPoly)), 0);
+
+    // Falcon-512 uses its own twiddle tables
+    auto [s9, v9] = both_paths(a, [](ZqPoly& p) {
+        ntt::ntt<9>(p.data());
+        ntt::intt<9>(p.data());
+    });
+    EXPECT_EQ(std::memcmp(s9.data(), v9.data(), sizeof(ZqPoly)), 0);
+
+    auto [sm, vm] = both_paths(a, [&](ZqPoly& p) { polynomial::mul<LOG2N>(a.data(), b.data(), p.data()); });
+    EXPECT_EQ(std::memcmp(sm.data(), vm.data(), sizeof(ZqPoly)), 0);
+}
+
+TEST_F(FalconSimdTest, FftMatchesScalarBitForBit) {
+    if (!simd::has_avx2()) GTEST_SKIP() << "no AVX2 on this CPU";
+
+    auto [s, v] = both_paths(x, [](CPoly& p) { fft::fft<LOG2N>(p.data()); });
+    EXPECT_TRUE(same_bits(s, v));
+
+    auto [si, vi] = both_paths(s, [](CPoly& p) { fft::ifft<LOG2N>(p.data()); });
+    EXPECT_TRUE(same_bits(si, vi));
+
+    auto [sm, vm] = both_paths(x, [&](CPoly& p) { polynomial::mul<LOG2N>(x.data(), y.data(), p.data()); });
+    EXPECT_TRUE(same_bits(sm, vm));
+
+    // Small transforms from the sampler's recursion mix both paths
+    auto [s2, v2] = both_paths(x, [](CPoly& p) {
+        fft::fft<2>(p.data());
+        fft::ifft<2>(p.data());
+    });
+    EXPECT_TRUE(same_bits(s2, v2));
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
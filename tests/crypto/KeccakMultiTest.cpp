@@ -0,0 +1,84 @@
+#include "crypto/falcon/hashing.hpp"
+#include <gtest/gtest.h>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+namespace {
+
+std::vector<std::vector<uint8_t>> random_messages(std::mt19937& rng, size_t count) {
+    std::vector<std::vector<uint8_t>> msgs(count);
+    for (auto& m : msgs) {
+        // Lengths around the 136-byte rate so groups mix block counts
+        m.resize(rng() % 420);
+        for (auto& b : m) b = static_cast<uint8_t>(rng());
+    }
+    return msgs;
+}
+
+} // namespace
+
+TEST(KeccakMultiTest, ShakeManyMatchesOneAtATime) {
+    std::mt19937 rng(1600);
+    for (size_t count : {1, 3, 4, 8, 13}) {
+        auto msgs = random_messages(rng, count);
+        std::vector<const uint8_t*> ptrs;
+        std::vector<size_t> lens;
+        for (const auto& m : msgs) {
+            ptrs.push_back(m.data());
+            lens.push_back(m.size());
+        }
+
+        constexpr size_t dlen = 300;  // more than two output blocks
+        std::vector<std::vector<uint8_t>> out(count, std::vector<uint8_t>(dlen));
+        std::vector<uint8_t*> digs;
+        for (auto& d : out) digs.push_back(d.data());
+        shake256::shake256_many(ptrs.data(), lens.data(), digs.data(), dlen, count);
+
+        for (size_t i = 0; i < count; i++) {
+            shake256::shake256<false> hasher;
+            hasher.hash(msgs[i].data(), msgs[i].size());
+            std::vector<uint8_t> expected(dlen);
+            hasher.read(expected.data(), dlen);
+            EXPECT_EQ(out[i], expected) << "message " << i << " of " << count;
+        }
+    }
+}
+
+TEST(KeccakMultiTest, HashToPointManyMatchesOneAtATime) {
+    constexpr size_t N = 512;
+    constexpr size_t count = 11;
+    std::mt19937 rng(12289);
+    auto msgs = random_messages(rng, count);
+
+    std::vector<std::array<uint8_t, 40>> salts(count);
+    std::vector<const uint8_t*> salt_ptrs, msg_ptrs;
+    std::vector<size_t> lens;
+    for (size_t i = 0; i < count; i++) {
+        for (auto& b : salts[i]) b = static_cast<uint8_t>(rng());
+        salt_ptrs.push_back(salts[i].data());
+        msg_ptrs.push_back(msgs[i].data());
+        lens.push_back(msgs[i].size());
+    }
+
+    std::vector<std::array<ff::ff_t, N>> points(count);
+    std::vector<ff::ff_t*> point_ptrs;
+    for (auto& p : points) point_ptrs.push_back(p.data());
+    hashing::hash_to_point_many<N>(salt_ptrs.data(), 40, msg_ptrs.data(), lens.data(), point_ptrs.data(), count);
+
+    for (size_t i = 0; i < count; i++) {
+        std::array<ff::ff_t, N> expected;
+        hashing::hash_to_point<N>(salts[i].data(), 40, msgs[i].data(), msgs[i].size(), expected.data());
+        for (size_t k = 0; k < N; k++) {
+            ASSERT_EQ(points[i][k].v, expected[k].v) << "message " << i << " coefficient " << k;
+        }
+    }
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
@@ -0,0 +1,146 @@
+#include "crypto/KeyPairPool.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+namespace {
+
+// Key bytes live outside the pair, so a test can see them after the pool
+// drops it
+struct Keys {
+    explicit Keys(size_t count) : bytes(count, std::vector<uint8_t>(8, 0xAA)) {}
+
+    bool wiped(int id) const {
+        return std::all_of(bytes[id].begin(), bytes[id].end(), [](uint8_t b) { return b == 0; });
+    }
+
+    std::vector<std::vector<uint8_t>> bytes;
+};
+
+struct KeyView {
+    uint8_t* data() { return bytes ? bytes->data() : nullptr; }
+    size_t size() const { return bytes ? bytes->size() : 0; }
+    std::vector<uint8_t>* bytes{nullptr};
+};
+
+struct TestPair {
+    int id{-1};
+    KeyView private_key;
+};
+
+// Numbers pairs in the order they are made
+KeyPairPool<TestPair>::Generator counting(std::shared_ptr<Keys> keys, std::shared_ptr<std::atomic<int>> next) {
+    return [keys, next] {
+        const int id = (*next)++;
+        return TestPair{id, {&keys->bytes.at(id)}};
+    };
+}
+
+bool eventually(const std::function<bool()>& done) {
+    const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!done() && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return done();
+}
+
+} // namespace
+
+TEST(KeyPairPoolTest, HandsOutEachPairOnceAndRefills) {
+    auto keys = std::make_shared<Keys>(64);
+    auto next = std::make_shared<std::atomic<int>>(0);
+    KeyPairPool<TestPair> pool(counting(keys, next), 4);
+    pool.prefill();
+    EXPECT_EQ(pool.stats().ready, 4u);
+    EXPECT_EQ(pool.stats().generated, 4u);
+
+    std::set<int> seen;
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_TRUE(seen.insert(pool.take().id).second);
+    }
+    EXPECT_TRUE(eventually([&] { return pool.stats().ready == 4; }));
+    const auto stats = pool.stats();
+    EXPECT_EQ(stats.taken, 20u);
+    EXPECT_EQ(stats.generated + stats.misses, 24u);
+    // Pairs handed out keep their keys
+    for (const int id : seen) {
+        EXPECT_FALSE(keys->wiped(id));
+    }
+}
+
+TEST(KeyPairPoolTest, GeneratesOnTheCallerWithoutDepth) {
+    auto keys = std::make_shared<Keys>(8);
+    auto next = std::make_shared<std::atomic<int>>(0);
+    KeyPairPool<TestPair> pool(counting(keys, next), 0);
+    EXPECT_EQ(pool.take().id, 0);
+    EXPECT_EQ(pool.take().id, 1);
+    const auto stats = pool.stats();
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.generated, 0u);
+    EXPECT_EQ(stats.ready, 0u);
+
+    // Inline generation fails the way the generator does
+    KeyPairPool<TestPair> broken([]() -> TestPair { throw std::runtime_error("no entropy"); }, 0);
+    EXPECT_THROW(broken.take(), std::runtime_error);
+}
+
+TEST(KeyPairPoolTest, WipesPairsItDropsUnused) {
+    auto keys = std::make_shared<Keys>(16);
+    auto next = std::make_shared<std::atomic<int>>(0);
+    {
+        KeyPairPool<TestPair> pool(counting(keys, next), 4);
+        pool.prefill();
+        // Shrinking drops the newest
+        pool.setDepth(1);
+        EXPECT_EQ(pool.stats().ready, 1u);
+        for (int id = 1; id < 4; ++id) {
+            EXPECT_TRUE(keys->wiped(id)) << id;
+        }
+        EXPECT_FALSE(keys->wiped(0));
+
+        pool.setDepth(0);
+        EXPECT_EQ(pool.stats().ready, 0u);
+        EXPECT_TRUE(keys->wiped(0));
+
+        pool.setDepth(2);
+        pool.prefill();
+        EXPECT_EQ(pool.stats().ready, 2u);
+    }
+    // and so does the destructor
+    for (int id = 0; id < *next; ++id) {
+        EXPECT_TRUE(keys->wiped(id)) << id;
+    }
+}
+
+TEST(KeyPairPoolTest, BacksOffAfterAGeneratorFailure) {
+    auto keys = std::make_shared<Keys>(8);
+    auto calls = std::make_shared<std::atomic<int>>(0);
+    auto next = std::make_shared<std::atomic<int>>(0);
+    auto flaky = [keys, calls, inner = counting(keys, next)] {
+        if ((*calls)++ == 0) {
+            throw std::runtime_error("transient");
+        }
+        return inner();
+    };
+    KeyPairPool<TestPair> pool(flaky, 1);
+    const auto start = std::chrono::steady_clock::now();
+    pool.prefill();
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(900));
+    EXPECT_EQ(pool.stats().ready, 1u);
+    EXPECT_EQ(*calls, 2);
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
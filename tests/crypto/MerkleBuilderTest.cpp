@@ -0,0 +1,82 @@
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+namespace {
+
+MerkleHash leaf(size_t i) {
+    const std::string data = "leaf-" + std::to_string(i);
+    return MerkleBuilder::hashLeaf({reinterpret_cast<const uint8_t*>(data.data()), data.size()});
+}
+
+// Level by level, carrying an odd last node up
+MerkleHash reference_root(std::vector<MerkleHash> level) {
+    while (level.size() > 1) {
+        std::vector<MerkleHash> next;
+        for (size_t i = 0; i < level.size(); i += 2) {
+            next.push_back(i + 1 < level.size() ? MerkleBuilder::hashNode(level[i], level[i + 1]) : level[i]);
+        }
+        level = std::move(next);
+    }
+    return level.empty() ? MerkleHash{} : level.front();
+}
+
+} // namespace
+
+TEST(MerkleBuilderTest, IncrementalAppendMatchesFreshBuild) {
+    MerkleBuilder incremental;
+    std::vector<MerkleHash> leaves;
+    EXPECT_EQ(incremental.root(), MerkleHash{});
+
+    // Cross the parallel threshold so both paths run
+    for (size_t count : {1, 2, 3, 7, 64, 65, 700, 1500}) {
+        while (leaves.size() < count) {
+            leaves.push_back(leaf(leaves.size()));
+            incremental.appendHash(leaves.back());
+        }
+        const auto expected = reference_root(leaves);
+        EXPECT_EQ(incremental.root(), expected) << count << " leaves";
+
+        MerkleBuilder fresh;
+        fresh.appendParallel(count, [](size_t i) { return leaf(i); });
+        EXPECT_EQ(fresh.root(), expected) << count << " leaves";
+    }
+}
+
+TEST(MerkleBuilderTest, ProofsVerifyOnlyForTheirLeaf) {
+    for (size_t count : {1, 5, 8, 13}) {
+        MerkleBuilder builder;
+        for (size_t i = 0; i < count; ++i) {
+            builder.appendHash(leaf(i));
+        }
+        const auto root = builder.root();
+        for (size_t i = 0; i < count; ++i) {
+            const auto proof = builder.proof(i);
+            EXPECT_TRUE(MerkleBuilder::verify(root, leaf(i), proof)) << i << " of " << count;
+            EXPECT_FALSE(MerkleBuilder::verify(root, leaf(i + 1), proof));
+            if (!proof.siblings.empty()) {
+                auto tampered = proof;
+                tampered.siblings.back()[0] ^= 1;
+                EXPECT_FALSE(MerkleBuilder::verify(root, leaf(i), tampered));
+            }
+        }
+        EXPECT_THROW((void)builder.proof(count), std::out_of_range);
+    }
+
+    // Leaves and interior nodes hash under different domains
+    MerkleBuilder two;
+    two.appendHash(leaf(0));
+    two.appendHash(leaf(1));
+    std::vector<uint8_t> concatenated(leaf(0).begin(), leaf(0).end());
+    concatenated.insert(concatenated.end(), leaf(1).begin(), leaf(1).end());
+    EXPECT_NE(two.root(), MerkleBuilder::hashLeaf(concatenated));
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
@@ -0,0 +1,69 @@
+#include "crypto/QuantumHashFunction.hpp"
+#include "crypto/hybrid/QuantumResistantHash.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+namespace {
+
+std::vector<std::vector<uint8_t>> randomMessages(size_t count) {
+    std::mt19937 rng(7);
+    std::vector<std::vector<uint8_t>> messages;
+    for (size_t i = 0; i < count; ++i) {
+        std::vector<uint8_t> message(rng() % 2100);
+        for (auto& byte : message) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        messages.push_back(std::move(message));
+    }
+    return messages;
+}
+
+template<typename Hash>
+void expectBatchAndStreamMatchHash() {
+    const auto messages = randomMessages(40);
+    std::vector<std::span<const uint8_t>> views(messages.begin(), messages.end());
+    std::vector<typename Hash::Digest> digests(messages.size());
+    Hash::hashMany(views, digests);
+
+    Hash hasher;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        const auto expected = hasher.hash(messages[i]);
+        EXPECT_EQ(std::vector<uint8_t>(digests[i].begin(), digests[i].end()), expected);
+
+        // Uneven pieces, finalize() resets for the next message
+        std::span<const uint8_t> rest(messages[i]);
+        for (size_t piece = 1; !rest.empty(); piece *= 3) {
+            const size_t n = std::min(piece, rest.size());
+            hasher.update(rest.first(n));
+            rest = rest.subspan(n);
+        }
+        EXPECT_EQ(hasher.finalize(), digests[i]);
+    }
+
+    std::vector<typename Hash::Digest> short_out(1);
+    EXPECT_THROW(Hash::hashMany(views, short_out), std::invalid_argument);
+}
+
+} // namespace
+
+TEST(QuantumHashTest, HashFunctionBatchAndStreamMatch) {
+    expectBatchAndStreamMatchHash<QuantumHashFunction>();
+}
+
+TEST(QuantumHashTest, ResistantHashBatchAndStreamMatch) {
+    expectBatchAndStreamMatchHash<QuantumResistantHash>();
+
+    QuantumResistantHash hasher;
+    const std::vector<uint8_t> data{1, 2, 3};
+    EXPECT_EQ(hasher.hash(data), hasher.hash(data));
+    EXPECT_NE(hasher.hash(data), QuantumHashFunction().hash(data));
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
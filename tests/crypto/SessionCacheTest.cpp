@@ -0,0 +1,75 @@
+#include "crypto/hybrid/SessionCache.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace quids {
+namespace crypto {
+namespace test {
+
+namespace {
+
+const std::vector<uint8_t> SECRET(32, 0x42);
+const std::vector<uint8_t> NONCE_A{1, 2, 3, 4};
+const std::vector<uint8_t> NONCE_B{5, 6, 7, 8};
+
+} // namespace
+
+TEST(SessionCacheTest, BothSidesDeriveTheSameResumedKey) {
+    SessionCache client;
+    SessionCache server;
+    EXPECT_EQ(client.store("server", SECRET), server.store("client", SECRET));
+
+    auto a = client.resume("server", NONCE_A);
+    auto b = server.resume("client", NONCE_A);
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(*a, *b);
+    EXPECT_EQ(a->size(), 32u);
+    EXPECT_NE(*a, SECRET);
+
+    // A fresh nonce gives a fresh key
+    auto c = client.resume("server", NONCE_B);
+    ASSERT_TRUE(c);
+    EXPECT_NE(*a, *c);
+    EXPECT_EQ(client.stats().resumed, 2u);
+}
+
+TEST(SessionCacheTest, TicketsRunOutAndExpire) {
+    SessionCache::Config config;
+    config.max_resumptions = 2;
+    SessionCache limited(config);
+    limited.store("peer", SECRET);
+    EXPECT_TRUE(limited.resume("peer", NONCE_A));
+    EXPECT_TRUE(limited.resume("peer", NONCE_B));
+    EXPECT_FALSE(limited.resume("peer", NONCE_A));
+    EXPECT_EQ(limited.size(), 0u);
+
+    config = {};
+    config.ticket_lifetime = std::chrono::milliseconds(1);
+    SessionCache shortLived(config);
+    shortLived.store("peer", SECRET);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_FALSE(shortLived.resume("peer", NONCE_A));
+    EXPECT_EQ(shortLived.stats().misses, 1u);
+}
+
+TEST(SessionCacheTest, EvictsTheOldestPeerAtCapacity) {
+    SessionCache::Config config;
+    config.capacity = 2;
+    SessionCache cache(config);
+    cache.store("a", SECRET);
+    cache.store("b", SECRET);
+    cache.store("a", SECRET);  // replacing a ticket makes it the newest
+    cache.store("c", SECRET);
+
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_FALSE(cache.ticket("b"));
+    EXPECT_TRUE(cache.ticket("a"));
+    EXPECT_TRUE(cache.ticket("c"));
+
+    cache.invalidate("a");
+    EXPECT_FALSE(cache.resume("a", NONCE_A));
+}
+
+} // namespace test
+} // namespace crypto
+} // namespace quids
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include "evm/Address.hpp"
+#include <unordered_set>
+
+using ::evm::Address;
+
+TEST(AddressTest, ParsesAndPrintsHex) {
+    const auto addr = Address::from_hex("0x00000000000000000000000000000000DeadBeef");
+    ASSERT_TRUE(addr.has_value());
+    EXPECT_EQ(addr->bytes[16], 0xde);
+    EXPECT_EQ(addr->bytes[19], 0xef);
+    EXPECT_EQ(addr->to_hex(), "00000000000000000000000000000000deadbeef");
+
+    // Short forms are right-aligned, with or without the prefix
+    EXPECT_EQ(Address::from_hex("deadbeef"), addr);
+    EXPECT_EQ(Address::from_hex("0xdeadbeef"), addr);
+    EXPECT_EQ(Address::from_hex("0x")->to_hex(), std::string(40, '0'));
+
+    EXPECT_FALSE(Address::from_hex("0xdeadbeeg").has_value());
+    EXPECT_FALSE(Address::from_hex(std::string(41, 'a')).has_value());
+}
+
+TEST(AddressTest, NamesThatAreNotHexGetStableKeys) {
+    const auto alice = Address::from_string("alice");
+    EXPECT_EQ(alice, Address::from_string("alice"));
+    EXPECT_NE(alice, Address::from_string("bob"));
+    EXPECT_EQ(Address::from_string("0x1234"), Address::from_hex("1234"));
+}
+
+TEST(AddressTest, HashSpreadsSequentialAddresses) {
+    std::unordered_set<size_t> hashes;
+    for (uint32_t i = 0; i < 10000; ++i) {
+        Address addr{};
+        addr.bytes[16] = static_cast<uint8_t>(i >> 24);
+        addr.bytes[17] = static_cast<uint8_t>(i >> 16);
+        addr.bytes[18] = static_cast<uint8_t>(i >> 8);
+        addr.bytes[19] = static_cast<uint8_t>(i);
+        hashes.insert(std::hash<Address>{}(addr) & 0xffff);
+    }
+    // Low bits alone still tell most of them apart
+    EXPECT_GT(hashes.size(), 8000u);
+}
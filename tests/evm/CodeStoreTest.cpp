@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include "evm/CodeStore.hpp"
+
+using namespace quids::evm;
+
+TEST(CodeStoreTest, InternsEachCodeOnce) {
+    CodeStore store;
+    const std::vector<uint8_t> code = {0x60, 0x03, 0x60, 0x04, 0x02, 0x00};
+    auto first = store.intern(code);
+    auto second = store.intern(code);
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(first->hash(), keccak256(code));
+    EXPECT_EQ(first->code(), code);
+    EXPECT_EQ(store.find(first->hash()), first);
+
+    auto stats = store.stats();
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.bytes, code.size());
+    EXPECT_EQ(stats.interned, 2u);
+    EXPECT_EQ(stats.shared, 1u);
+}
+
+TEST(CodeStoreTest, LastHolderFreesTheCode) {
+    CodeStore store;
+    const std::vector<uint8_t> code = {0x60, 0x05, 0x60, 0x06, 0x03, 0x00};
+    const Hash256 code_hash = keccak256(code);
+    auto entry = store.intern(code);
+    auto copy = entry;
+    entry.reset();
+    EXPECT_TRUE(store.find(code_hash));
+    copy.reset();
+    EXPECT_FALSE(store.find(code_hash));
+    EXPECT_EQ(store.stats().entries, 0u);
+    EXPECT_EQ(store.stats().bytes, 0u);
+
+    // Interning again starts a fresh entry
+    EXPECT_EQ(store.intern(code)->code(), code);
+}
+
+TEST(CodeStoreTest, RefsShareCodeAndAnalysis) {
+    const std::vector<uint8_t> code = {0x60, 0x07, 0x60, 0x08, 0x01, 0x00};
+    CodeRef a(code);
+    CodeRef b(code);
+    CodeRef none;
+    EXPECT_EQ(a, b);
+    EXPECT_FALSE(a == none);
+    EXPECT_EQ(&a.bytes(), &b.bytes());
+    EXPECT_EQ(a.hash(), keccak256(code));
+    EXPECT_TRUE(none.empty());
+    EXPECT_EQ(none.hash(), Hash256{});
+    EXPECT_FALSE(none.analysis());
+    EXPECT_TRUE(CodeRef(std::vector<uint8_t>{}).empty());
+
+    const auto analysis = a.analysis();
+    ASSERT_TRUE(analysis);
+    EXPECT_EQ(analysis->code, code);
+    EXPECT_EQ(analysis->code_hash, a.hash());
+    // Fetches count towards the optimised tier, which the entry then keeps
+    std::shared_ptr<const AnalyzedCode> hot;
+    for (uint32_t i = 0; i <= CodeCache::DEFAULT_HOT_THRESHOLD && !hot; ++i) {
+        if (auto current = b.analysis(); current->tier != 0) hot = current;
+    }
+    ASSERT_TRUE(hot);
+    EXPECT_EQ(a.analysis(), hot);
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "evm/Compression.hpp"
+#include <string>
+
+using evm::Compression;
+
+namespace {
+
+// Transfer-like records that share most of their layout
+std::vector<uint8_t> sample_tx(uint32_t i) {
+    std::string s = "{\"from\":\"0x" + std::string(36, 'a') + std::to_string(i % 97) +
+                    "\",\"to\":\"0x" + std::string(36, 'b') + std::to_string(i % 13) +
+                    "\",\"value\":" + std::to_string(i * 1000) + ",\"nonce\":" + std::to_string(i) +
+                    ",\"gas\":21000,\"data\":\"0xa9059cbb\"}";
+    return {s.begin(), s.end()};
+}
+
+std::vector<std::vector<uint8_t>> samples(uint32_t from, uint32_t count) {
+    std::vector<std::vector<uint8_t>> out;
+    for (uint32_t i = from; i < from + count; ++i) {
+        out.push_back(sample_tx(i));
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(CompressionTest, RoundTripsBothAlgorithms) {
+    for (auto algo : {Compression::Algorithm::ZSTD, Compression::Algorithm::ZLIB}) {
+        Compression codec(algo);
+        std::vector<uint8_t> data;
+        for (const auto& tx : samples(0, 200)) {
+            data.insert(data.end(), tx.begin(), tx.end());
+        }
+        auto packed = codec.compress(data);
+        EXPECT_LT(packed.size(), data.size());
+        EXPECT_EQ(codec.decompress(packed), data);
+        EXPECT_GT(codec.get_compression_ratio(), 1.0);
+    }
+    EXPECT_THROW(Compression(Compression::Algorithm::LZ4), std::invalid_argument);
+}
+
+TEST(CompressionTest, DictionaryShrinksSmallPayloads) {
+    Compression plain;
+    Compression trained;
+    for (const auto& tx : samples(0, 2000)) {
+        trained.add_training_sample(tx);
+    }
+    trained.train_dictionary();
+    ASSERT_NE(trained.get_dictionary_id(), 0u);
+
+    size_t plain_size = 0;
+    size_t trained_size = 0;
+    for (const auto& tx : samples(5000, 100)) {
+        plain_size += plain.compress(tx).size();
+        auto packed = trained.compress(tx);
+        trained_size += packed.size();
+        ASSERT_EQ(trained.decompress(packed), tx);
+    }
+    EXPECT_LT(trained_size * 2, plain_size);
+}
+
+TEST(CompressionTest, OldFramesDecodeAfterRetraining) {
+    Compression codec;
+    codec.train_dictionary(samples(0, 1000));
+    const uint32_t first_id = codec.get_dictionary_id();
+    auto old_frame = codec.compress(sample_tx(42));
+
+    codec.train_dictionary(samples(3000, 1000));
+    EXPECT_NE(codec.get_dictionary_id(), first_id);
+    EXPECT_EQ(codec.decompress(old_frame), sample_tx(42));
+
+    // A codec that never loaded the dictionary cannot guess it
+    Compression stranger;
+    EXPECT_THROW((void)stranger.decompress(old_frame), std::runtime_error);
+}
+
+TEST(CompressionTest, StreamsRoundTripAcrossFrames) {
+    Compression codec;
+    codec.train_dictionary(samples(0, 1000));
+    auto writer = codec.create_compression_stream();
+    std::vector<uint8_t> expected;
+    for (const auto& tx : samples(100, 300)) {
+        writer->write(tx);
+        expected.insert(expected.end(), tx.begin(), tx.end());
+    }
+    writer->flush();
+    const auto last = sample_tx(7);
+    writer->write(last);  // second frame on the same context
+    expected.insert(expected.end(), last.begin(), last.end());
+    writer->flush();
+    auto packed = writer->read(writer->available());
+
+    // Feed it back in small pieces
+    auto reader = codec.create_decompression_stream();
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < packed.size(); i += 7) {
+        reader->write({packed.begin() + i, packed.begin() + std::min(packed.size(), i + 7)});
+        auto chunk = reader->read(64);
+        out.insert(out.end(), chunk.begin(), chunk.end());
+    }
+    reader->flush();
+    auto rest = reader->read(reader->available());
+    out.insert(out.end(), rest.begin(), rest.end());
+    EXPECT_EQ(out, expected);
+
+    // One-shot decompress handles the concatenated, unsized frames too
+    EXPECT_EQ(codec.decompress(packed), expected);
+}
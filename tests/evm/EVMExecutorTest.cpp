@@ -2,6 +2,7 @@
 #include "evm/EVMExecutor.hpp"
 #include "node/QuidsConfig.hpp"
 #include "evm/Address.hpp"
+#include "TestTransactions.hpp"
 
 using namespace quids::evm;
 
@@ -16,14 +17,12 @@ protected:
 };
 
 TEST_F(EVMExecutorTest, BasicTransfer) {
-    quids::blockchain::Transaction tx;
-    tx.from = "0x1234";
-    tx.to = "0x5678";
-    tx.value = 1000;
+    executor->set_balance(::evm::Address::from_string("0x1234"), 1000);
+    const auto tx = quids::test::makeSignedTransfer("0x1234", "0x5678", 1000, 1);
     
-    EXPECT_TRUE(executor->execute(tx));
-    EXPECT_EQ(executor->getBalance("0x5678"), 1000);
-    EXPECT_EQ(executor->getBalance("0x1234"), 0);
+    EXPECT_TRUE(executor->execute(*tx));
+    EXPECT_EQ(executor->getBalance("0x5678"), 1000u);
+    EXPECT_EQ(executor->getBalance("0x1234"), 0u);
 }
 
 TEST_F(EVMExecutorTest, ContractDeployment) {
@@ -50,12 +49,11 @@ TEST_F(EVMExecutorTest, StorageOperations) {
 }
 
 TEST_F(EVMExecutorTest, InsufficientBalance) {
-    quids::blockchain::Transaction tx;
-    tx.from = "0x1234";
-    tx.to = "0x5678";
-    tx.value = 1000000;  // More than available
+    executor->set_balance(::evm::Address::from_string("0x1234"), 1000);
+    const auto tx = quids::test::makeSignedTransfer("0x1234", "0x5678", 1000000, 1);  // More than available
     
-    EXPECT_FALSE(executor->execute(tx));
+    EXPECT_FALSE(executor->execute(*tx));
+    EXPECT_EQ(executor->getBalance("0x1234"), 1000u);
 }
 
 TEST_F(EVMExecutorTest, InvalidContractCode) {
@@ -93,24 +91,60 @@ TEST_F(EVMExecutorTest, ContractExecution) {
     );
     
     EXPECT_TRUE(result.success);
-    EXPECT_EQ(result.gas_used, 21);  // Basic operations
+    EXPECT_EQ(result.gas_used, 24u);  // Seven 3-gas operations plus one word of memory
+    ASSERT_EQ(result.return_data.size(), 32u);
+    EXPECT_EQ(result.return_data.back(), 5);
 }
 
 TEST_F(EVMExecutorTest, OutOfGas) {
     ::evm::Address contract_addr;
     auto result = executor->execute_contract(
         contract_addr,
-        std::vector<uint8_t>{0x5b},  // JUMPDEST in infinite loop
+        std::vector<uint8_t>{0x5b, 0x60, 0x00, 0x56},  // JUMPDEST PUSH1 0 JUMP: infinite loop
         std::vector<uint8_t>{},
         100  // Very low gas limit
     );
     
     EXPECT_FALSE(result.success);
-    EXPECT_EQ(result.gas_used, 100);
+    EXPECT_EQ(result.gas_used, 100u);
 }
 
-TEST(EVMExecutorTest, BasicExecution) {
-    quids::EVMConfig config; // Use fully qualified name
-    ::evm::Address contract_addr; // Use default constructor
-    // ... rest of the test ...
+TEST_F(EVMExecutorTest, ResetClearsStateForReuse) {
+    ::evm::Address contract_addr{};
+    // PUSH1 1 PUSH1 0 SSTORE PUSH1 0 SLOAD: cold set then warm read
+    const std::vector<uint8_t> code = {0x60, 0x01, 0x60, 0x00, 0x55, 0x60, 0x00, 0x54};
+    auto first = executor->execute_contract(contract_addr, code, {}, 100000);
+    ASSERT_TRUE(first.success);
+    ASSERT_EQ(first.storage_access.writes.size(), 1u);
+
+    executor->reset();
+    EXPECT_EQ(executor->get_gas_used(), 0u);
+
+    // Slot 0 is back to zero, so the store pays the full set cost again
+    auto second = executor->execute_contract(contract_addr, code, {}, 100000);
+    ASSERT_TRUE(second.success);
+    EXPECT_EQ(second.gas_used, first.gas_used);
+}
+
+TEST_F(EVMExecutorTest, NestedCallReachesInstalledCode) {
+    ::evm::Address callee{};
+    callee.bytes[19] = 0x0b;
+    // PUSH1 42 PUSH1 0 MSTORE PUSH1 32 PUSH1 0 RETURN
+    executor->set_code(callee, {0x60, 0x2a, 0x60, 0x00, 0x52, 0x60, 0x20, 0x60, 0x00, 0xf3});
+
+    // CALL(gas, 0x0b, 0, 0, 0, 0, 32) then RETURN(0, 32)
+    const std::vector<uint8_t> code = {0x60, 0x20, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00,
+                                       0x60, 0x0b, 0x5a, 0xf1, 0x60, 0x20, 0x60, 0x00, 0xf3};
+    ::evm::Address caller{};
+    auto result = executor->execute_contract(caller, code, {}, 100000);
+    ASSERT_TRUE(result.success);
+    ASSERT_EQ(result.return_data.size(), 32u);
+    EXPECT_EQ(result.return_data.back(), 42);
+}
+
+TEST_F(EVMExecutorTest, BasicExecution) {
+    // A fresh executor has spent nothing and holds nothing
+    EXPECT_EQ(executor->get_gas_used(), 0u);
+    EXPECT_EQ(executor->getBalance("0x1234"), 0u);
+    EXPECT_TRUE(executor->getCode("0x1234").empty());
 }
@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include "evm/ExternalLink.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using ::evm::ExternalData;
+using ::evm::ExternalLink;
+using quids::crypto::SignatureScheme;
+
+namespace {
+
+const std::string ENDPOINT = "https://oracle.example/price";
+
+ExternalLink::LinkConfig config() {
+    ExternalLink::LinkConfig c{};
+    c.max_response_time_ms = UINT32_MAX;
+    c.require_proof = false;
+    return c;
+}
+
+ExternalLink::DataRequest request(uint8_t key = 1) {
+    ExternalLink::DataRequest r{};
+    r.key = {key};
+    r.timestamp = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    r.endpoint = ENDPOINT;
+    r.method = "GET";
+    return r;
+}
+
+ExternalLink::DataResponse ok(uint8_t value) {
+    return {true, {value}, {}, "", {}};
+}
+
+// Transport that holds every fetch until released
+class Gate {
+public:
+    ExternalLink::DataResponse wait(ExternalLink::DataResponse response) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return open_; });
+        return response;
+    }
+    void open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool open_{false};
+};
+
+template<typename Predicate>
+bool eventually(Predicate predicate) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// Stands in for a real scheme: a signature is the message with every
+// byte xored with the key's first byte
+class XorKey : public quids::crypto::PreparedKey {
+public:
+    explicit XorKey(uint8_t k) : k(k) {}
+    uint8_t k;
+};
+
+class XorVerifier : public quids::crypto::SchemeVerifier {
+public:
+    std::shared_ptr<const quids::crypto::PreparedKey> prepare(std::span<const uint8_t> public_key) const override {
+        if (public_key.empty()) return nullptr;
+        return std::make_shared<XorKey>(public_key[0]);
+    }
+    bool verify(const quids::crypto::PreparedKey& key,
+                std::span<const uint8_t> message,
+                std::span<const uint8_t> signature) const override {
+        const auto k = static_cast<const XorKey&>(key).k;
+        if (message.size() != signature.size()) return false;
+        for (size_t i = 0; i < message.size(); ++i) {
+            if (signature[i] != (message[i] ^ k)) return false;
+        }
+        return true;
+    }
+};
+
+ExternalData signedData(const std::string& source, uint8_t key, uint8_t value) {
+    ExternalData data{{value}, {}, 0, source, {}};
+    for (const uint8_t b : ExternalLink::payload_hash(data)) {
+        data.signature.push_back(b ^ key);
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(ExternalLinkTest, IdenticalRequestsShareOneFetch) {
+    ExternalLink link(config(), nullptr, nullptr);
+    Gate gate;
+    std::atomic<int> fetches{0};
+    link.set_transport([&](const ExternalLink::DataRequest&) {
+        fetches++;
+        return gate.wait(ok(42));
+    });
+
+    constexpr int CALLERS = 32;
+    std::vector<std::thread> callers;
+    std::atomic<int> answered{0};
+    for (int i = 0; i < CALLERS; ++i) {
+        callers.emplace_back([&] {
+            auto response = link.fetch_data(request());
+            EXPECT_TRUE(response.success);
+            EXPECT_EQ(response.data, std::vector<uint8_t>{42});
+            answered++;
+        });
+    }
+    std::atomic<int> callbacks{0};
+    ASSERT_TRUE(eventually([&] { return link.stats().coalesced == CALLERS - 1; }));
+    link.fetch_data_with_callback(request(), [&](const ExternalLink::DataResponse& response) {
+        EXPECT_EQ(response.data, std::vector<uint8_t>{42});
+        callbacks++;
+    });
+    auto later = link.fetch_data_async(request());
+    EXPECT_EQ(answered.load(), 0);
+
+    gate.open();
+    for (auto& caller : callers) caller.join();
+    EXPECT_EQ(later.get().data, std::vector<uint8_t>{42});
+    EXPECT_EQ(callbacks.load(), 1);
+    EXPECT_EQ(fetches.load(), 1);
+    EXPECT_EQ(link.stats().upstream_fetches, 1u);
+
+    // Different keys are different requests
+    EXPECT_TRUE(link.fetch_data(request(2)).success);
+    EXPECT_EQ(fetches.load(), 2);
+}
+
+TEST(ExternalLinkTest, CachesAnswersAndFailures) {
+    ExternalLink link(config(), nullptr, nullptr);
+    link.enable_caching(true);
+    int fetches = 0;
+    link.set_transport([&](const ExternalLink::DataRequest& r) {
+        fetches++;
+        return r.key[0] == 1 ? ok(7) : ExternalLink::DataResponse{false, {}, {}, "HTTP 404", {}};
+    });
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(link.fetch_data(request(1)).data, std::vector<uint8_t>{7});
+        auto missing = link.fetch_data(request(2));
+        EXPECT_FALSE(missing.success);
+        EXPECT_EQ(missing.error_message, "HTTP 404");
+    }
+    EXPECT_EQ(fetches, 2);
+    EXPECT_EQ(link.stats().cache_hits, 2u);
+    EXPECT_EQ(link.stats().negative_hits, 2u);
+
+    link.clear_cache();
+    link.set_negative_cache_duration(std::chrono::seconds(0));
+    link.fetch_data(request(2));
+    link.fetch_data(request(2));
+    EXPECT_EQ(fetches, 4);
+}
+
+TEST(ExternalLinkTest, RateLimitChargesUpstreamFetchesOnly) {
+    ExternalLink link(config(), nullptr, nullptr);
+    int fetches = 0;
+    link.set_transport([&](const ExternalLink::DataRequest&) {
+        fetches++;
+        return ok(1);
+    });
+
+    // The burst is one second's worth
+    link.set_rate_limit(ENDPOINT, 3);
+    EXPECT_TRUE(link.fetch_data(request(1)).success);
+    EXPECT_TRUE(link.fetch_data(request(2)).success);
+    EXPECT_TRUE(link.fetch_data(request(3)).success);
+    auto limited = link.fetch_data(request(4));
+    EXPECT_FALSE(limited.success);
+    EXPECT_EQ(limited.error_message, "Rate limit exceeded");
+    EXPECT_EQ(link.stats().rate_limited, 1u);
+
+    // Cache hits are free
+    link.set_rate_limit(ENDPOINT, 0);
+    link.enable_caching(true);
+    link.set_quota(ENDPOINT, 1);
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(link.fetch_data(request(1)).success);
+    }
+    EXPECT_FALSE(link.fetch_data(request(5)).success);  // over the daily quota
+    EXPECT_EQ(fetches, 4);
+}
+
+TEST(ExternalLinkTest, VerifiesABlockOfResponsesOnce) {
+    quids::crypto::BatchVerifier::global().register_scheme(SignatureScheme::SphincsPlus, std::make_unique<XorVerifier>());
+    ExternalLink link(config(), nullptr, nullptr);
+    link.add_trusted_source("alpha", std::string(1, '\x11'), SignatureScheme::SphincsPlus);
+    link.add_trusted_source("beta", std::string(1, '\x22'), SignatureScheme::SphincsPlus);
+    link.add_trusted_source("named", "");
+
+    auto forged = signedData("beta", 0x11, 8);  // signed with alpha's key
+    auto retimed = signedData("alpha", 0x11, 5);
+    retimed.timestamp = 12345;  // receipt time is not signed
+    std::vector<ExternalData> block = {
+        signedData("alpha", 0x11, 5),
+        signedData("alpha", 0x11, 5),
+        retimed,
+        signedData("beta", 0x22, 9),
+        forged,
+        signedData("unknown", 0x11, 5),
+        ExternalData{{1}, {}, 0, "named", {}},
+    };
+    const std::vector<uint8_t> expected = {1, 1, 1, 1, 0, 0, 1};
+    EXPECT_EQ(link.verify_external_data(std::span<const ExternalData>(block)), expected);
+    // The copies of alpha's response share one check
+    EXPECT_EQ(link.stats().signatures_checked, 3u);
+
+    EXPECT_EQ(link.verify_external_data(std::span<const ExternalData>(block)), expected);
+    EXPECT_EQ(link.stats().signatures_checked, 4u);  // only the forgery again
+    EXPECT_EQ(link.stats().verifications_remembered, 5u);
+    EXPECT_TRUE(link.verify_external_data(block[3]));
+
+    // A changed source list forgets what was verified
+    EXPECT_EQ(link.get_trusted_sources(), (std::vector<std::string>{"alpha", "beta", "named"}));
+    EXPECT_TRUE(link.remove_trusted_source("alpha"));
+    EXPECT_FALSE(link.remove_trusted_source("alpha"));
+    EXPECT_FALSE(link.verify_external_data(block[0]));
+    EXPECT_TRUE(link.verify_external_data(block[3]));
+    EXPECT_EQ(link.stats().signatures_checked, 5u);
+}
@@ -0,0 +1,372 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Interpreter.hpp"
+
+using namespace quids::evm;
+
+namespace {
+
+// Appends PUSH1 0 MSTORE PUSH1 32 PUSH1 0 RETURN to return the top of stack
+std::vector<uint8_t> returning(std::vector<uint8_t> code) {
+    code.insert(code.end(), {0x60, 0x00, 0x52, 0x60, 0x20, 0x60, 0x00, 0xf3});
+    return code;
+}
+
+InterpreterResult run(const std::vector<uint8_t>& code, uint64_t gas = 100000) {
+    static ::evm::Storage storage;
+    ExecutionContext ctx;
+    ctx.storage = &storage;
+    return interpret(*CodeCache::global().get(code), ctx, gas);
+}
+
+::evm::uint256_t output_word(const InterpreterResult& result) {
+    return result.output.size() == 32 ? ::evm::uint256_t::load_be(result.output.data()) : ::evm::uint256_t(0);
+}
+
+::evm::Address account(uint8_t tag) {
+    ::evm::Address a{};
+    a.bytes.fill(0);
+    a.bytes[19] = tag;
+    return a;
+}
+
+// Accounts for call tests; a checkpoint is a copy of all of them
+class TestHost : public CallHost {
+public:
+    struct State {
+        std::map<::evm::Address, std::vector<uint8_t>> code;
+        std::map<::evm::Address, uint64_t> balances;
+        std::map<::evm::Address, uint64_t> nonces;
+    };
+    State state;
+
+    std::shared_ptr<const AnalyzedCode> code_at(const ::evm::Address& address) override {
+        auto it = state.code.find(address);
+        return it == state.code.end() || it->second.empty() ? nullptr : CodeCache::global().get(it->second);
+    }
+    bool transfer(const ::evm::Address& from, const ::evm::Address& to, const ::evm::uint256_t& value) override {
+        if (value > state.balances[from]) return false;
+        state.balances[from] -= static_cast<uint64_t>(value);
+        state.balances[to] += static_cast<uint64_t>(value);
+        return true;
+    }
+    uint64_t increment_nonce(const ::evm::Address& address) override { return state.nonces[address]++; }
+    void set_code(const ::evm::Address& address, std::vector<uint8_t> code) override {
+        state.code[address] = std::move(code);
+    }
+    Checkpoint checkpoint() override {
+        saved_.push_back(state);
+        return saved_.size() - 1;
+    }
+    void revert(Checkpoint checkpoint) override {
+        state = saved_[checkpoint];
+        saved_.resize(checkpoint);
+    }
+
+private:
+    std::vector<State> saved_;
+};
+
+// Runs code as account 0x0a with calls through host
+InterpreterResult run_calls(const std::vector<uint8_t>& code, TestHost& host, ::evm::Storage& storage,
+                            CallArena& arena, uint64_t gas = 1000000) {
+    ExecutionContext ctx;
+    ctx.address = account(0x0a);
+    ctx.caller = 0x99;
+    ctx.storage = &storage;
+    ctx.host = &host;
+    storage.begin_transaction();
+    return interpret(*CodeCache::global().get(code), ctx, gas, arena);
+}
+
+// CALL to 0x0b with all gas, no value or input, 32 bytes of output at 0
+const std::vector<uint8_t> CALL_B = {0x60, 0x20, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00,
+                                     0x60, 0x0b, 0x5a, 0xf1};
+
+} // namespace
+
+TEST(InterpreterTest, AnalysisSplitsBlocksAtJumpdests) {
+    // PUSH1 1 JUMPDEST PUSH1 2 PUSH1 3 JUMPI STOP
+    std::vector<uint8_t> code = {0x60, 0x01, 0x5b, 0x60, 0x02, 0x60, 0x03, 0x57, 0x00};
+    auto analyzed = analyze(code, keccak256(code));
+
+    EXPECT_FALSE(analyzed->is_jumpdest(0));
+    EXPECT_TRUE(analyzed->is_jumpdest(2));
+    ASSERT_EQ(analyzed->blocks.size(), 3u);
+    EXPECT_EQ(analyzed->blocks[0].gas, 3u);
+    EXPECT_EQ(analyzed->blocks[1].gas, 17u);  // JUMPDEST, two pushes, JUMPI
+    EXPECT_EQ(analyzed->instructions.back().op, H_STOP);
+}
+
+TEST(InterpreterTest, OpcodesFollowTheAnalysedFork) {
+    // PUSH0 BASEFEE ADD
+    const std::vector<uint8_t> code = returning({0x5f, 0x48, 0x01});
+    ExecutionContext ctx;
+    ctx.base_fee = 7;
+
+    auto shanghai = analyze(code, keccak256(code), Fork::Shanghai);
+    auto result = interpret(*shanghai, ctx, 100000);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(output_word(result), 7);
+
+    // Before Shanghai PUSH0 is undefined, before London so is BASEFEE
+    auto london = analyze(code, keccak256(code), Fork::London);
+    EXPECT_EQ(london->fork, Fork::London);
+    EXPECT_EQ(london->instructions[1].op, H_INVALID);
+    EXPECT_EQ(interpret(*london, ctx, 100000).status, InterpreterStatus::InvalidOpcode);
+    const std::vector<uint8_t> basefee = returning({0x48});
+    EXPECT_EQ(interpret(*analyze(basefee, keccak256(basefee), Fork::Berlin), ctx, 100000).status,
+              InterpreterStatus::InvalidOpcode);
+    EXPECT_EQ(interpret(*analyze(basefee, keccak256(basefee), Fork::London), ctx, 100000).status,
+              InterpreterStatus::Success);
+}
+
+TEST(InterpreterTest, ImmediateInsidePushIsNotAJumpdest) {
+    // PUSH1 0x5b PUSH1 1 JUMP
+    auto result = run({0x60, 0x5b, 0x60, 0x01, 0x56});
+    EXPECT_EQ(result.status, InterpreterStatus::BadJump);
+    EXPECT_EQ(result.gas_left, 0u);
+}
+
+TEST(InterpreterTest, LoopChargesPerBlock) {
+    // i = 10; do { i -= 1 } while (i != 0)
+    auto result = run(returning({0x60, 0x0a, 0x5b, 0x60, 0x01, 0x90, 0x03, 0x80, 0x60, 0x02, 0x57}));
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(output_word(result), 0);
+    EXPECT_EQ(100000 - result.gas_left, 3u + 10 * 26 + 15);
+}
+
+TEST(InterpreterTest, SignedArithmetic) {
+    // PUSH1 2 PUSH1 7 NOT SDIV: -8 / 2
+    auto result = run(returning({0x60, 0x02, 0x60, 0x07, 0x19, 0x05}));
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(output_word(result), ~::evm::uint256_t(3));
+}
+
+TEST(InterpreterTest, StackUnderflowIsCaughtAtBlockEntry) {
+    auto result = run({0x60, 0x01, 0x01});
+    EXPECT_EQ(result.status, InterpreterStatus::StackUnderflow);
+}
+
+TEST(InterpreterTest, RevertKeepsUnusedGas) {
+    auto result = run({0x60, 0x00, 0x60, 0x00, 0xfd});
+    EXPECT_EQ(result.status, InterpreterStatus::Revert);
+    EXPECT_EQ(result.gas_left, 100000u - 6);
+}
+
+TEST(InterpreterTest, CacheReusesAnalysis) {
+    CodeCache cache(2);
+    std::vector<uint8_t> code = {0x60, 0x01, 0x00};
+    auto first = cache.get(code);
+    auto second = cache.get(code);
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(cache.stats().hits, 1u);
+
+    cache.get(std::vector<uint8_t>{0x00});
+    cache.get(std::vector<uint8_t>{0x01});
+    EXPECT_EQ(cache.stats().evictions, 1u);
+}
+
+TEST(InterpreterTest, OptimizedTierMatchesBaseline) {
+    // i = 10; do { i -= 1 } while (i != 0), with the count masked and the
+    // exit test through EQ so every fused form is exercised:
+    // PUSH1 10 JUMPDEST PUSH1 1 SWAP1 SUB PUSH1 0xff AND DUP1 PUSH1 0 EQ
+    // ISZERO PUSH1 2 JUMPI PUSH1 5 ADD
+    const std::vector<uint8_t> code = returning({0x60, 0x0a, 0x5b, 0x60, 0x01, 0x90, 0x03, 0x60, 0xff, 0x16,
+                                                 0x80, 0x60, 0x00, 0x14, 0x15, 0x60, 0x02, 0x57, 0x60, 0x05,
+                                                 0x01});
+    auto baseline = analyze(code, keccak256(code));
+    auto optimized = optimize(*baseline);
+    EXPECT_EQ(optimized->tier, 1);
+    EXPECT_TRUE(std::any_of(optimized->instructions.begin(), optimized->instructions.end(),
+                            [](const Instruction& i) { return i.op == H_JUMPI_STATIC; }));
+
+    ExecutionContext ctx;
+    auto slow = interpret(*baseline, ctx, 100000);
+    auto fast = interpret(*optimized, ctx, 100000);
+    ASSERT_EQ(slow.status, InterpreterStatus::Success);
+    EXPECT_EQ(fast.status, slow.status);
+    EXPECT_EQ(fast.gas_left, slow.gas_left);
+    EXPECT_EQ(output_word(fast), 5);
+    EXPECT_EQ(fast.output, slow.output);
+}
+
+TEST(InterpreterTest, CachePromotesHotCode) {
+    CodeCache cache(16, 3);
+    std::vector<uint8_t> code = {0x60, 0x01, 0x60, 0x02, 0x01, 0x00};
+    EXPECT_EQ(cache.get(code)->tier, 0);
+    EXPECT_EQ(cache.get(code)->tier, 0);
+    EXPECT_EQ(cache.get(code)->tier, 0);
+    EXPECT_EQ(cache.get(code)->tier, 1);  // third hit crosses the threshold
+    EXPECT_EQ(cache.get(code)->tier, 1);
+    EXPECT_EQ(cache.stats().promotions, 1u);
+}
+
+TEST(InterpreterTest, CacheRestoresWarmEntries) {
+    CodeCache cache(16, 2);
+    std::vector<uint8_t> hot = {0x60, 0x01, 0x60, 0x02, 0x01, 0x00};
+    std::vector<uint8_t> warm = {0x60, 0x05, 0x00};
+    std::vector<uint8_t> cold = {0x00};
+    for (int i = 0; i < 3; ++i) cache.get(hot);
+    cache.get(warm);
+    cache.get(warm);
+    cache.get(cold);
+
+    auto saved = cache.export_warm(2);
+    ASSERT_EQ(saved.size(), 2u);
+    EXPECT_EQ(saved[0].code, hot);
+    EXPECT_TRUE(saved[0].hot);
+    EXPECT_EQ(saved[1].code, warm);
+    EXPECT_FALSE(saved[1].hot);
+
+    CodeCache restarted(16, 2);
+    EXPECT_EQ(restarted.import_warm(saved), 2u);
+    EXPECT_EQ(restarted.import_warm(saved), 0u);
+    EXPECT_EQ(restarted.get(hot)->tier, 1);
+    EXPECT_EQ(restarted.get(warm)->tier, 0);
+    EXPECT_EQ(restarted.stats().misses, 0u);
+}
+
+TEST(InterpreterTest, CallReturnsIntoCallerMemory) {
+    TestHost host;
+    ::evm::Storage storage;
+    CallArena arena;
+    host.state.code[account(0x0b)] = returning({0x60, 0x2a});
+
+    // success + mload(0), then RETURNDATASIZE
+    auto code = CALL_B;
+    code.insert(code.end(), {0x60, 0x00, 0x51, 0x01});
+    auto result = run_calls(returning(code), host, storage, arena);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(output_word(result), 43);
+
+    code = CALL_B;
+    code.insert(code.end(), {0x50, 0x3d});
+    result = run_calls(returning(code), host, storage, arena);
+    EXPECT_EQ(output_word(result), 32);
+    EXPECT_EQ(arena.capacity(), 2u);
+
+    // The plain form has no frames to call into
+    ExecutionContext ctx;
+    ctx.host = &host;
+    EXPECT_EQ(interpret(*CodeCache::global().get(CALL_B), ctx, 100000).status, InterpreterStatus::Success);
+    ::evm::Stack stack;
+    ::evm::Memory memory;
+    EXPECT_EQ(interpret(*CodeCache::global().get(CALL_B), ctx, 100000, stack, memory).status,
+              InterpreterStatus::Unsupported);
+}
+
+TEST(InterpreterTest, FailedCallUndoesOnlyItself) {
+    TestHost host;
+    ::evm::Storage storage;
+    CallArena arena;
+    // SSTORE(1, 7) LOG0 then REVERT
+    host.state.code[account(0x0b)] = {0x60, 0x07, 0x60, 0x01, 0x55, 0x60, 0x00, 0x60, 0x00, 0xa0,
+                                      0x60, 0x00, 0x60, 0x00, 0xfd};
+
+    // The caller stores too, and survives the callee's revert
+    std::vector<uint8_t> code = {0x60, 0x05, 0x60, 0x01, 0x55};
+    code.insert(code.end(), CALL_B.begin(), CALL_B.end());
+    auto result = run_calls(returning(code), host, storage, arena);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(output_word(result), 0);
+    EXPECT_TRUE(result.logs.empty());
+    EXPECT_EQ(storage.load(account(0x0b), 1), 0);
+    EXPECT_EQ(storage.load(account(0x0a), 1), 5);
+
+    // STOP instead of REVERT keeps the callee's write and log
+    host.state.code[account(0x0b)][12] = 0x00;
+    result = run_calls(returning(code), host, storage, arena);
+    EXPECT_EQ(output_word(result), 1);
+    EXPECT_EQ(result.logs.size(), 1u);
+    EXPECT_EQ(storage.load(account(0x0b), 1), 7);
+}
+
+TEST(InterpreterTest, StaticCallRejectsStateChanges) {
+    TestHost host;
+    ::evm::Storage storage;
+    CallArena arena;
+    // STATICCALL to 0x0b with all gas
+    const std::vector<uint8_t> code = {0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x0b, 0x5a, 0xfa};
+
+    host.state.code[account(0x0b)] = {0x60, 0x07, 0x60, 0x01, 0x55, 0x00};
+    auto result = run_calls(returning(code), host, storage, arena);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(output_word(result), 0);
+    EXPECT_EQ(storage.load(account(0x0b), 1), 0);
+
+    host.state.code[account(0x0b)] = returning({0x60, 0x2a});
+    result = run_calls(returning(code), host, storage, arena);
+    EXPECT_EQ(output_word(result), 1);
+}
+
+TEST(InterpreterTest, DelegateCallRunsInTheCallersContext) {
+    TestHost host;
+    ::evm::Storage storage;
+    CallArena arena;
+    // SSTORE(0, CALLER)
+    host.state.code[account(0x0b)] = {0x33, 0x60, 0x00, 0x55, 0x00};
+
+    auto result = run_calls({0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x0b, 0x5a, 0xf4, 0x00},
+                            host, storage, arena);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(storage.load(account(0x0a), 0), 0x99);
+    EXPECT_EQ(storage.load(account(0x0b), 0), 0);
+}
+
+TEST(InterpreterTest, DeepRecursionStopsAtTheDepthLimit) {
+    TestHost host;
+    ::evm::Storage storage;
+    CallArena arena;
+    // Count frames in slot 0, then CALL itself with all gas
+    std::vector<uint8_t> code = {0x60, 0x00, 0x54, 0x60, 0x01, 0x01, 0x60, 0x00, 0x55,
+                                 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00,
+                                 0x60, 0x0a, 0x5a, 0xf1, 0x00};
+    host.state.code[account(0x0a)] = code;
+
+    auto result = run_calls(code, host, storage, arena, 10000000000000ull);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(storage.load(account(0x0a), 0), CallArena::DEPTH_LIMIT + 1);
+    EXPECT_EQ(arena.capacity(), CallArena::DEPTH_LIMIT + 1);
+
+    // Frames are reused, not reallocated
+    run_calls(code, host, storage, arena, 10000000000000ull);
+    EXPECT_EQ(arena.capacity(), CallArena::DEPTH_LIMIT + 1);
+}
+
+TEST(InterpreterTest, CreateDeploysReturnedCode) {
+    TestHost host;
+    ::evm::Storage storage;
+    CallArena arena;
+    const std::vector<uint8_t> runtime = returning({0x60, 0x2a});
+    // PUSH10 runtime PUSH1 0 MSTORE PUSH1 10 PUSH1 22 RETURN
+    std::vector<uint8_t> init = {0x69};
+    init.insert(init.end(), runtime.begin(), runtime.end());
+    init.insert(init.end(), {0x60, 0x00, 0x52, 0x60, 0x0a, 0x60, 0x16, 0xf3});
+    ASSERT_EQ(init.size(), 19u);
+    // PUSH19 init PUSH1 0 MSTORE CREATE(0, 13, 19)
+    std::vector<uint8_t> code = {0x72};
+    code.insert(code.end(), init.begin(), init.end());
+    code.insert(code.end(), {0x60, 0x00, 0x52, 0x60, 0x13, 0x60, 0x0d, 0x60, 0x00, 0xf0});
+
+    ExecutionContext ctx;
+    ctx.address = *::evm::Address::from_hex("6ac7ea33f8831ea9dcc53393aaa88b25a785dbf0");
+    ctx.storage = &storage;
+    ctx.host = &host;
+    auto result = interpret(*CodeCache::global().get(returning(code)), ctx, 1000000, arena);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    const auto created = *::evm::Address::from_hex("cd234a471b72ba2f1ccf0a70fcaba648a5eecd8d");
+    EXPECT_EQ(output_word(result), ::evm::uint256_t::load_be(created.bytes.data(), 20));
+    EXPECT_EQ(host.state.code[created], runtime);
+    EXPECT_EQ(host.state.nonces[ctx.address], 1u);
+
+    // EIP-1014's first example: zero sender and salt, init code 0x00
+    ctx.address = account(0);
+    result = interpret(*CodeCache::global().get(returning({0x60, 0x00, 0x60, 0x01, 0x60, 0x00, 0x60, 0x00, 0xf5})),
+                       ctx, 1000000, arena);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    const auto salted = *::evm::Address::from_hex("4d1a2e2bb4f88f0250f26ffff098b0b30b26bf38");
+    EXPECT_EQ(output_word(result), ::evm::uint256_t::load_be(salted.bytes.data(), 20));
+}
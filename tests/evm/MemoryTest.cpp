@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include "evm/Memory.hpp"
+#include "evm/Stack.hpp"
+
+using namespace evm;
+
+TEST(MemoryTest, ExpansionCostIsIncremental) {
+    Memory memory;
+    EXPECT_EQ(memory.calculate_expansion_cost(0, 32), 3u);
+    EXPECT_EQ(memory.expand(32), 3u);
+    EXPECT_EQ(memory.calculate_expansion_cost(0, 32), 0u);
+
+    // 1024 words cost 3 * 1024 + 1024^2 / 512 in total, one already paid
+    EXPECT_EQ(memory.calculate_expansion_cost(0, 1024 * 32), 3u * 1024 + 2048 - 3);
+    EXPECT_EQ(memory.expand(1024 * 32 - 5), 3u * 1024 + 2048 - 3);
+    EXPECT_EQ(memory.size(), 1024u * 32);
+}
+
+TEST(MemoryTest, ViewsStayValidAcrossGrowth) {
+    Memory memory;
+    memory.store_word(0, uint256_t(0xabcd));
+    auto first = memory.view(0, 32);
+
+    (void)memory.expand(Memory::RETAINED_SIZE * 2);
+    EXPECT_EQ(first.data(), memory.data());
+    EXPECT_EQ(first[31], 0xcd);
+    EXPECT_EQ(memory.load_word(0), 0xabcd);
+    EXPECT_THROW((void)memory.view(memory.size(), 1), std::out_of_range);
+}
+
+TEST(MemoryTest, ClearZeroesAndKeepsAddress) {
+    Memory memory;
+    const uint8_t* base = memory.data();
+    memory.store(100, uint8_t{7});
+    memory.clear();
+
+    EXPECT_EQ(memory.size(), 0u);
+    EXPECT_EQ(memory.data(), base);
+    (void)memory.expand(128);
+    EXPECT_TRUE(memory.is_zero(0, 128));
+    EXPECT_EQ(memory.calculate_expansion_cost(0, 160), 3u);
+}
+
+TEST(MemoryTest, StackHasFixedCapacity) {
+    Stack stack;
+    for (size_t i = 0; i < Stack::LIMIT; ++i) {
+        stack.push(uint256_t(i));
+    }
+    EXPECT_THROW(stack.push(uint256_t(0)), std::runtime_error);
+    EXPECT_EQ(stack.peek(), Stack::LIMIT - 1);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(stack.slots()) % 64, 0u);
+
+    stack.clear();
+    EXPECT_TRUE(stack.empty());
+}
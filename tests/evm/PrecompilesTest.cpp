@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include "crypto/falcon/falcon.hpp"
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Precompiles.hpp"
+
+using namespace quids::evm;
+
+namespace {
+
+constexpr size_t N = 512;
+
+struct FalconKey {
+    std::vector<uint8_t> pk;
+    std::vector<uint8_t> sk;
+};
+
+FalconKey falcon_key() {
+    FalconKey key;
+    key.pk.resize(falcon_utils::compute_pkey_len<N>());
+    key.sk.resize(falcon_utils::compute_skey_len<N>());
+    ::falcon::keygen<N>(key.pk.data(), key.sk.data());
+    return key;
+}
+
+std::vector<uint8_t> falcon_sign(const FalconKey& key, const std::vector<uint8_t>& message) {
+    std::vector<uint8_t> sig(falcon_utils::compute_sig_len<N>());
+    EXPECT_TRUE(::falcon::sign<N>(key.sk.data(), message.data(), message.size(), sig.data()));
+    return sig;
+}
+
+PrecompileResult call(const Precompiles& precompiles, uint16_t id, const std::vector<uint8_t>& input,
+                      uint64_t gas = 1000000) {
+    auto result = precompiles.run(Precompiles::address(id), input.data(), input.size(), gas);
+    EXPECT_TRUE(result.has_value());
+    return result.value_or(PrecompileResult{});
+}
+
+// Serves only the native contracts
+class NativeHost : public CallHost {
+public:
+    std::shared_ptr<const AnalyzedCode> code_at(const ::evm::Address&) override { return nullptr; }
+    bool transfer(const ::evm::Address&, const ::evm::Address&, const ::evm::uint256_t& value) override {
+        return value == 0;
+    }
+    uint64_t increment_nonce(const ::evm::Address&) override { return 0; }
+    void set_code(const ::evm::Address&, std::vector<uint8_t>) override {}
+    std::optional<PrecompileResult> run_precompile(const ::evm::Address& address, const uint8_t* input,
+                                                   size_t size, uint64_t gas) override {
+        return precompiles.run(address, input, size, gas);
+    }
+    Checkpoint checkpoint() override { return 0; }
+    void revert(Checkpoint) override {}
+
+    Precompiles precompiles;
+};
+
+} // namespace
+
+TEST(PrecompilesTest, Blake3HashesAndChargesPerWord) {
+    Precompiles precompiles;
+    auto empty = call(precompiles, Precompiles::BLAKE3, {});
+    ASSERT_TRUE(empty.success);
+    EXPECT_EQ(empty.output, (std::vector<uint8_t>{
+        0xaf, 0x13, 0x49, 0xb9, 0xf5, 0xf9, 0xa1, 0xa6, 0xa0, 0x40, 0x4d, 0xea, 0x36, 0xdc, 0xc9, 0x49,
+        0x9b, 0xcb, 0x25, 0xc9, 0xad, 0xc1, 0x12, 0xb7, 0xcc, 0x9a, 0x93, 0xca, 0xe4, 0x1f, 0x32, 0x62}));
+    EXPECT_EQ(empty.gas_used, 30u);
+
+    auto long_input = call(precompiles, Precompiles::BLAKE3, std::vector<uint8_t>(65, 7));
+    EXPECT_EQ(long_input.gas_used, 30u + 3 * 3);
+    EXPECT_FALSE(call(precompiles, Precompiles::BLAKE3, {1, 2, 3}, 32).success);
+
+    ::evm::Address other{};
+    other.bytes.fill(0);
+    other.bytes[19] = 0x01;
+    EXPECT_FALSE(precompiles.run(other, nullptr, 0, 1000).has_value());
+    EXPECT_FALSE(precompiles.run(Precompiles::address(Precompiles::LAST + 1), nullptr, 0, 1000).has_value());
+}
+
+TEST(PrecompilesTest, FalconVerifyReportsValidity) {
+    Precompiles precompiles;
+    const auto key = falcon_key();
+    const std::vector<uint8_t> message = {'b', 'r', 'i', 'd', 'g', 'e'};
+    const auto sig = falcon_sign(key, message);
+
+    auto good = call(precompiles, Precompiles::FALCON512_VERIFY, Precompiles::encode_verify(key.pk, sig, message));
+    ASSERT_TRUE(good.success);
+    ASSERT_EQ(good.output.size(), 32u);
+    EXPECT_EQ(good.output[31], 1);
+    EXPECT_EQ(good.gas_used, precompiles.gas().falcon512_verify + precompiles.gas().message_word);
+
+    auto tampered = message;
+    tampered[0] ^= 1;
+    auto bad = call(precompiles, Precompiles::FALCON512_VERIFY, Precompiles::encode_verify(key.pk, sig, tampered));
+    ASSERT_TRUE(bad.success);
+    EXPECT_EQ(bad.output[31], 0);
+
+    // Truncated input and too little gas fail the call outright
+    auto truncated = Precompiles::encode_verify(key.pk, sig, message);
+    truncated.resize(100);
+    EXPECT_FALSE(call(precompiles, Precompiles::FALCON512_VERIFY, truncated).success);
+    EXPECT_FALSE(call(precompiles, Precompiles::FALCON512_VERIFY,
+                      Precompiles::encode_verify(key.pk, sig, message), 1000).success);
+}
+
+TEST(PrecompilesTest, BatchVerifyAnswersPerItem) {
+    Precompiles precompiles;
+    const auto key = falcon_key();
+    std::vector<std::vector<uint8_t>> messages, sigs;
+    for (uint8_t i = 0; i < 6; ++i) {
+        messages.push_back({'t', 'x', i});
+        sigs.push_back(falcon_sign(key, messages.back()));
+    }
+    sigs[2] = sigs[3];  // signature over another message
+
+    std::vector<quids::crypto::VerifyItem> items;
+    for (size_t i = 0; i < messages.size(); ++i) {
+        items.push_back({quids::crypto::SignatureScheme::Falcon512, messages[i], sigs[i], key.pk});
+    }
+    auto result = call(precompiles, Precompiles::BATCH_VERIFY, Precompiles::encode_batch(items));
+    ASSERT_TRUE(result.success);
+    ASSERT_EQ(result.output.size(), 32u * items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        EXPECT_EQ(result.output[32 * i + 31], i == 2 ? 0 : 1) << i;
+    }
+    const auto& gas = precompiles.gas();
+    EXPECT_EQ(result.gas_used, gas.batch_base + items.size() * (gas.falcon512_verify + gas.message_word));
+
+    // Gas runs out before anything is verified
+    EXPECT_FALSE(call(precompiles, Precompiles::BATCH_VERIFY, Precompiles::encode_batch(items), 5000).success);
+    // The count must match what follows
+    auto input = Precompiles::encode_batch(items);
+    input[3] = 7;
+    EXPECT_FALSE(call(precompiles, Precompiles::BATCH_VERIFY, input).success);
+    input = Precompiles::encode_batch(items);
+    input.push_back(0);
+    EXPECT_FALSE(call(precompiles, Precompiles::BATCH_VERIFY, input).success);
+}
+
+TEST(PrecompilesTest, ContractsReachThemThroughCalls) {
+    NativeHost host;
+    ExecutionContext ctx;
+    ctx.host = &host;
+    // STATICCALL(gas, 0x0100, 0, 0, 0, 32) then RETURN(0, 32)
+    const std::vector<uint8_t> code = {0x60, 0x20, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x61, 0x01, 0x00,
+                                       0x5a, 0xfa, 0x50, 0x60, 0x20, 0x60, 0x00, 0xf3};
+    auto result = interpret(*CodeCache::global().get(code), ctx, 100000);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    auto expected = call(host.precompiles, Precompiles::BLAKE3, {});
+    EXPECT_EQ(result.output, expected.output);
+}
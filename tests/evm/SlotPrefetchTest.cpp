@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Interpreter.hpp"
+#include "evm/Keccak.hpp"
+#include "evm/SlotPrefetch.hpp"
+
+using namespace quids::evm;
+using ::evm::uint256_t;
+
+namespace {
+
+::evm::Address address_of(uint8_t n) {
+    ::evm::Address a{};
+    a.bytes[19] = n;
+    return a;
+}
+
+// Committed state in a map, counting how it is asked
+class MapBackend : public ::evm::SlotBackend {
+public:
+    std::vector<uint256_t> read(std::span<const ::evm::StorageKey> keys) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        batches++;
+        std::vector<uint256_t> values;
+        for (const auto& key : keys) {
+            const auto it = slots.find(key.slot);
+            values.push_back(it == slots.end() ? uint256_t(0) : it->second);
+        }
+        return values;
+    }
+
+    std::mutex mutex;
+    std::map<uint256_t, uint256_t> slots;
+    size_t batches{0};
+};
+
+uint256_t mapping_slot(const uint256_t& key, const uint256_t& base) {
+    uint8_t buf[64];
+    key.store_be(buf);
+    base.store_be(buf + 32);
+    return uint256_t::load_be(keccak256(buf, sizeof(buf)).data());
+}
+
+// slot 5 + balances[calldata word 0], where balances is the mapping at slot 2
+const std::vector<uint8_t> BALANCE_PLUS_CONSTANT = {
+    0x60, 0x05, 0x54,                    // PUSH1 5 SLOAD
+    0x60, 0x04, 0x35, 0x60, 0x00, 0x52,  // PUSH1 4 CALLDATALOAD PUSH1 0 MSTORE
+    0x60, 0x02, 0x60, 0x20, 0x52,        // PUSH1 2 PUSH1 0x20 MSTORE
+    0x60, 0x40, 0x60, 0x00, 0x20, 0x54,  // PUSH1 0x40 PUSH1 0 SHA3 SLOAD
+    0x01,                                // ADD
+    0x60, 0x00, 0x52, 0x60, 0x20, 0x60, 0x00, 0xf3,
+};
+
+std::vector<uint8_t> call_with(const uint256_t& word) {
+    std::vector<uint8_t> input = {0xaa, 0xbb, 0xcc, 0xdd};
+    input.resize(36);
+    word.store_be(input.data() + 4);
+    return input;
+}
+
+bool predicts(const std::vector<::evm::StorageKey>& predicted, const uint256_t& slot) {
+    return std::any_of(predicted.begin(), predicted.end(),
+                       [&](const ::evm::StorageKey& key) { return key.slot == slot; });
+}
+
+} // namespace
+
+TEST(SlotPrefetchTest, FindsConstantSlotsAndMappingBases) {
+    const auto code = CodeCache::global().get(BALANCE_PLUS_CONSTANT);
+    const auto hints = SlotPredictor::analyze(*code);
+    EXPECT_EQ(hints.constant_slots, std::vector<uint256_t>{5});
+    EXPECT_NE(std::find(hints.mapping_bases.begin(), hints.mapping_bases.end(), uint256_t(2)),
+              hints.mapping_bases.end());
+    // The hash's offset and length are not slots
+    EXPECT_EQ(std::find(hints.mapping_bases.begin(), hints.mapping_bases.end(), uint256_t(0x40)),
+              hints.mapping_bases.end());
+}
+
+TEST(SlotPrefetchTest, PrefetchedCallDoesNotStallOnEachSlot) {
+    const uint256_t holder(0x1234567890ULL);
+    auto backend = std::make_shared<MapBackend>();
+    backend->slots[5] = 7;
+    backend->slots[mapping_slot(holder, 2)] = 100;
+
+    ::evm::Storage storage;
+    storage.set_backend(backend);
+    SlotPredictor predictor;
+    const auto code = CodeCache::global().get(BALANCE_PLUS_CONSTANT);
+    const auto input = call_with(holder);
+    const auto predicted = predictor.predict(*code, address_of(1), input);
+    EXPECT_TRUE(predicts(predicted, 5));
+    EXPECT_TRUE(predicts(predicted, mapping_slot(holder, 2)));
+    EXPECT_EQ(storage.prefetch(predicted), predicted.size());
+    EXPECT_EQ(storage.prefetch(predicted), 0u);  // already in flight
+
+    ExecutionContext ctx;
+    ctx.address = address_of(1);
+    ctx.storage = &storage;
+    ctx.input = input.data();
+    ctx.input_size = input.size();
+    storage.begin_transaction();
+    const auto result = interpret(*code, ctx, 100000);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(uint256_t::load_be(result.output.data()), 107);
+
+    EXPECT_EQ(storage.stats().backend_reads, 0u);
+    EXPECT_EQ(storage.stats().prefetch_waits, 1u);
+    EXPECT_EQ(backend->batches, 1u);
+}
+
+TEST(SlotPrefetchTest, HistoryCoversSlotsTheCodeDoesNotShow) {
+    // PUSH1 4 CALLDATALOAD SLOAD: the slot is whatever the caller passes
+    const std::vector<uint8_t> bytecode = {0x60, 0x04, 0x35, 0x54, 0x00};
+    const auto code = CodeCache::global().get(bytecode);
+    SlotPredictor predictor;
+    EXPECT_TRUE(predictor.predict(*code, address_of(1), call_with(9)).empty());
+
+    ::evm::StorageAccessSet accessed;
+    accessed.reads.push_back({address_of(1), uint256_t(9)});
+    accessed.reads.push_back({address_of(2), uint256_t(10)});  // another contract's
+    predictor.record(address_of(1), accessed);
+    const auto predicted = predictor.predict(*code, address_of(1), call_with(11));
+    ASSERT_EQ(predicted.size(), 1u);
+    EXPECT_EQ(predicted[0].slot, 9);
+    EXPECT_TRUE(predictor.predict(*code, address_of(2), {}).empty());
+}
+
+TEST(SlotPrefetchTest, WritesWinOverFetchesInFlight) {
+    auto backend = std::make_shared<MapBackend>();
+    backend->slots[1] = 50;
+    backend->slots[2] = 60;
+    ::evm::Storage storage;
+    storage.set_backend(backend);
+
+    const std::vector<::evm::StorageKey> keys = {{address_of(1), 1}, {address_of(1), 2}};
+    storage.prefetch(keys);
+    storage.store(address_of(1), 1, 0);
+    EXPECT_EQ(storage.load(address_of(1), 1), 0);
+    EXPECT_EQ(storage.load(address_of(1), 2), 60);
+    // Never prefetched, so read on its own
+    EXPECT_EQ(storage.load(address_of(1), 3), 0);
+    EXPECT_EQ(storage.stats().backend_reads, 1u);
+}
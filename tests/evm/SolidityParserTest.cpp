@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "evm/SolidityParser.hpp"
+#include <string>
+#include <vector>
+
+using ::evm::DataType;
+using ::evm::SolidityParser;
+using ::evm::Token;
+
+namespace {
+
+std::vector<std::string> values(const SolidityParser::ParseResult& result) {
+    std::vector<std::string> out;
+    for (const auto& token : result.tokens) out.emplace_back(token.value);
+    return out;
+}
+
+} // namespace
+
+TEST(SolidityParserTest, TokenizesInOnePass) {
+    SolidityParser parser;
+    const auto result = parser.parse(
+        "contract C {\n"
+        "  uint256 x = 42; // set\n"
+        "  /* two\n lines */ string s = \"a\\\"b\";\n"
+        "}");
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(values(result), (std::vector<std::string>{
+        "contract", "C", "{", "uint256", "x", "=", "42", ";", "// set",
+        "/* two\n lines */", "string", "s", "=", "\"a\\\"b\"", ";", "}", ""}));
+
+    EXPECT_EQ(result.tokens[0].type, Token::Type::KEYWORD);
+    EXPECT_EQ(result.tokens[1].type, Token::Type::IDENTIFIER);
+    EXPECT_EQ(result.tokens[2].type, Token::Type::PUNCTUATION);
+    EXPECT_EQ(result.tokens[5].type, Token::Type::OPERATOR);
+    EXPECT_EQ(result.tokens[6].type, Token::Type::NUMBER);
+    EXPECT_EQ(result.tokens[8].type, Token::Type::COMMENT);
+    EXPECT_EQ(result.tokens[13].type, Token::Type::STRING);
+    EXPECT_EQ(result.tokens.back().type, Token::Type::END);
+
+    // Lines and columns of the token starts
+    EXPECT_EQ(result.tokens[4].line, 2u);
+    EXPECT_EQ(result.tokens[4].column, 11u);
+    EXPECT_EQ(result.tokens[9].line, 3u);
+    EXPECT_EQ(result.tokens[10].line, 4u);
+    EXPECT_EQ(result.tokens[10].column, 11u);
+    EXPECT_EQ(result.tokens[15].line, 5u);
+}
+
+TEST(SolidityParserTest, RejectsMalformedWords) {
+    SolidityParser parser;
+    const auto result = parser.parse("uint 9lives;");
+    EXPECT_FALSE(result.success);
+    ASSERT_EQ(result.errors.size(), 1u);
+    EXPECT_EQ(result.errors[0], "Unrecognized token: 9lives");
+}
+
+TEST(SolidityParserTest, CachedResultsOutliveTheSource) {
+    SolidityParser::clear_cache();
+    SolidityParser::ParseResult first;
+    {
+        SolidityParser parser;
+        std::string source = "function f() public pure {}";
+        first = parser.parse(source);
+        source.assign(source.size(), 'x');
+    }
+    SolidityParser other;
+    const auto second = other.parse("function f() public pure {}");
+    EXPECT_EQ(values(first), values(second));
+    EXPECT_EQ(first.source, second.source);  // served from the cache
+    EXPECT_EQ(first.tokens[0].value, "function");
+}
+
+TEST(SolidityParserTest, ResolvesTypes) {
+    SolidityParser parser;
+    EXPECT_EQ(parser.resolve_type("uint").bits, 256);
+    EXPECT_EQ(parser.resolve_type("uint64").bits, 64);
+    EXPECT_EQ(parser.resolve_type("int8").base_type, DataType::INT);
+    EXPECT_EQ(parser.resolve_type("bytes32").bits, 256);
+    EXPECT_EQ(parser.resolve_type("address").base_type, DataType::ADDRESS);
+
+    const auto array = parser.resolve_type("uint32[16]");
+    EXPECT_TRUE(array.is_array);
+    EXPECT_EQ(array.array_size, 16u);
+    EXPECT_EQ(array.bits, 32);
+    EXPECT_FALSE(parser.resolve_type("bool[]").array_size.has_value());
+
+    const auto mapping = parser.resolve_type("mapping(address,uint128)");
+    ASSERT_TRUE(mapping.is_mapping);
+    EXPECT_EQ(mapping.mapping_key_type->base_type, DataType::ADDRESS);
+    EXPECT_EQ(mapping.mapping_value_type->bits, 128);
+
+    // Used to throw from std::stoul
+    EXPECT_NO_THROW((void)parser.resolve_type("uintx"));
+    EXPECT_NO_THROW((void)parser.resolve_type("bool[n]"));
+}
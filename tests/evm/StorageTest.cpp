@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include "evm/CodeAnalysis.hpp"
+#include "evm/Interpreter.hpp"
+#include "evm/Storage.hpp"
+
+using namespace quids::evm;
+using ::evm::uint256_t;
+
+namespace {
+
+::evm::Address address_of(uint8_t n) {
+    ::evm::Address a{};
+    a.bytes[19] = n;
+    return a;
+}
+
+InterpreterResult run(::evm::Storage& storage, const std::vector<uint8_t>& code, uint64_t gas = 100000) {
+    ExecutionContext ctx;
+    ctx.address = address_of(1);
+    ctx.storage = &storage;
+    return interpret(*CodeCache::global().get(code), ctx, gas);
+}
+
+} // namespace
+
+TEST(StorageTest, ZeroValuesAreNotStored) {
+    ::evm::Storage storage;
+    const auto a = address_of(1);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        storage.store(a, i, i + 1);
+    }
+    storage.store(address_of(2), 5, 9);
+    EXPECT_EQ(storage.size(a), 1000u);
+    EXPECT_EQ(storage.load(a, 999), 1000);
+
+    for (uint64_t i = 0; i < 1000; i += 2) {
+        storage.store(a, i, 0);
+    }
+    EXPECT_EQ(storage.size(a), 500u);
+    EXPECT_FALSE(storage.contains(a, 0));
+    EXPECT_EQ(storage.load(a, 1), 2);
+
+    storage.clear(a);
+    EXPECT_EQ(storage.size(a), 0u);
+    EXPECT_EQ(storage.load(address_of(2), 5), 9);
+}
+
+TEST(StorageTest, WarmthIsPerTransaction) {
+    ::evm::Storage storage;
+    const auto a = address_of(1);
+    storage.begin_transaction();
+    EXPECT_FALSE(storage.load_for_access(a, 7).warm);
+    EXPECT_TRUE(storage.load_for_access(a, 7).warm);
+    EXPECT_FALSE(storage.warm_account(a));
+    EXPECT_TRUE(storage.warm_account(a));
+
+    storage.begin_transaction();
+    EXPECT_FALSE(storage.load_for_access(a, 7).warm);
+    EXPECT_FALSE(storage.warm_account(a));
+}
+
+TEST(StorageTest, RevertRestoresValuesAndWarmth) {
+    ::evm::Storage storage;
+    const auto a = address_of(1);
+    storage.store(a, 1, 10);
+    storage.begin_transaction();
+    storage.store_for_access(a, 1, 11);
+    const auto snap = storage.snapshot();
+    auto write = storage.store_for_access(a, 2, 20);
+    EXPECT_FALSE(write.warm);
+    write = storage.store_for_access(a, 1, 0);
+    EXPECT_EQ(write.original, 10);
+    EXPECT_EQ(write.current, 11);
+
+    storage.revert(snap);
+    EXPECT_EQ(storage.load(a, 1), 11);
+    EXPECT_EQ(storage.load(a, 2), 0);
+    EXPECT_TRUE(storage.load_for_access(a, 1).warm);
+    EXPECT_FALSE(storage.load_for_access(a, 2).warm);
+}
+
+TEST(StorageTest, AccessSetListsWrittenSlotsOnlyAsWrites) {
+    ::evm::Storage storage;
+    const auto a = address_of(1);
+    storage.begin_transaction();
+    storage.load_for_access(a, 1);
+    storage.load_for_access(a, 2);
+    storage.store_for_access(a, 2, 5);
+    storage.store_for_access(a, 2, 6);
+
+    const auto set = storage.access_set();
+    ASSERT_EQ(set.reads.size(), 1u);
+    EXPECT_EQ(set.reads[0].slot, 1);
+    ASSERT_EQ(set.writes.size(), 1u);
+    EXPECT_EQ(set.writes[0].slot, 2);
+}
+
+TEST(StorageTest, ColdAndWarmSstoreGas) {
+    ::evm::Storage storage;
+    storage.begin_transaction();
+    // PUSH1 1 PUSH1 0 SSTORE, twice: cold set, then warm no-op
+    const std::vector<uint8_t> code = {0x60, 0x01, 0x60, 0x00, 0x55, 0x60, 0x01, 0x60, 0x00, 0x55};
+    auto result = run(storage, code);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(100000 - result.gas_left, 12u + 2100 + 20000 + 100);
+
+    // PUSH1 0 SLOAD: warm now
+    result = run(storage, {0x60, 0x00, 0x54});
+    EXPECT_EQ(100000 - result.gas_left, 3u + 100);
+}
+
+TEST(StorageTest, FailedCallRollsBackStorage) {
+    ::evm::Storage storage;
+    storage.begin_transaction();
+    // PUSH1 1 PUSH1 0 SSTORE PUSH1 0 PUSH1 0 REVERT
+    auto result = run(storage, {0x60, 0x01, 0x60, 0x00, 0x55, 0x60, 0x00, 0x60, 0x00, 0xfd});
+    EXPECT_EQ(result.status, InterpreterStatus::Revert);
+    EXPECT_EQ(storage.load(address_of(1), 0), 0);
+
+    // Not enough left above the call stipend
+    result = run(storage, {0x60, 0x01, 0x60, 0x00, 0x55}, 2300);
+    EXPECT_EQ(result.status, InterpreterStatus::OutOfGas);
+    EXPECT_EQ(storage.load(address_of(1), 0), 0);
+}
+
+TEST(StorageTest, WitnessReplaysWithoutTheState) {
+    // slot 5 = slot 5 + slot 6 + 1
+    const std::vector<uint8_t> code = {0x60, 0x05, 0x54, 0x60, 0x06, 0x54, 0x01,
+                                       0x60, 0x01, 0x01, 0x60, 0x05, 0x55};
+    ::evm::Storage full;
+    full.store(address_of(1), 5, 41);
+    full.store(address_of(1), 7, 9);  // never touched
+    full.begin_witness();
+    full.begin_transaction();
+    ASSERT_EQ(run(full, code).status, InterpreterStatus::Success);
+    const auto witness = full.take_witness();
+
+    // Values from before the write, zero slots included
+    ASSERT_EQ(witness.slots.size(), 2u);
+    EXPECT_EQ(witness.slots[0].first.slot, 5);
+    EXPECT_EQ(witness.slots[0].second, 41);
+    EXPECT_EQ(witness.slots[1].first.slot, 6);
+    EXPECT_EQ(witness.slots[1].second, 0);
+
+    ::evm::Storage replay;
+    replay.load_witness(witness);
+    replay.begin_transaction();
+    const auto result = run(replay, code);
+    ASSERT_EQ(result.status, InterpreterStatus::Success);
+    EXPECT_EQ(replay.load(address_of(1), 5), full.load(address_of(1), 5));
+
+    // PUSH1 7 SLOAD
+    replay.begin_transaction();
+    EXPECT_THROW(run(replay, {0x60, 0x07, 0x54}), std::out_of_range);
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "evm/uint256.hpp"
+#include <cstring>
 #include <unordered_map>
 
 using namespace evm;
@@ -90,4 +91,53 @@ TEST(uint256Test, LargeNumbers) {
     
     EXPECT_NO_THROW(a * b);
     EXPECT_NO_THROW(a + b);
-}
\ No newline at end of file
+}
+TEST(uint256Test, CarryPropagatesAcrossLimbs) {
+    uint256_t a = uint256_t::from_limbs(~0ull, ~0ull, ~0ull, 0);
+    EXPECT_EQ(a + 1, uint256_t::from_limbs(0, 0, 0, 1));
+    EXPECT_EQ(uint256_t(0) - 1, std::numeric_limits<uint256_t>::max());
+    EXPECT_EQ((uint256_t(1) << 128) * (uint256_t(1) << 128), 0);
+}
+
+TEST(uint256Test, MultiLimbDivision) {
+    uint256_t a("115792089237316195423570985008687907853269984665640564039457584007913129639935");
+    uint256_t b("340282366920938463463374607431768211457");  // 2^128 + 1
+    auto [q, r] = divmod(a, b);
+    EXPECT_EQ(q, uint256_t("340282366920938463463374607431768211455"));
+    EXPECT_EQ(r, 0);
+    EXPECT_EQ(q * b + r, a);
+}
+
+TEST(uint256Test, ModularArithmeticDoesNotWrap) {
+    const uint256_t max = std::numeric_limits<uint256_t>::max();
+    EXPECT_EQ(addmod(max, 2, 10), 7);  // (2^256 + 1) % 10
+    EXPECT_EQ(mulmod(max, max, 12), 9);
+    EXPECT_EQ(mulmod(5, 5, 0), 0);
+}
+
+TEST(uint256Test, BigEndianRoundTrip) {
+    uint8_t bytes[32];
+    for (int i = 0; i < 32; ++i) bytes[i] = static_cast<uint8_t>(i);
+    uint256_t v = uint256_t::load_be(bytes);
+    EXPECT_EQ(static_cast<uint8_t>(v), 31);
+    EXPECT_EQ(static_cast<uint8_t>(v >> 248), 0);
+
+    uint8_t out[32];
+    v.store_be(out);
+    EXPECT_EQ(std::memcmp(bytes, out, sizeof(out)), 0);
+    EXPECT_EQ(uint256_t::load_be(bytes + 30, 2), 0x1e1f);
+}
+
+TEST(uint256Test, StringConversion) {
+    uint256_t v("0xdeadbeef00000000000000000000000001");
+    EXPECT_EQ(v.to_hex(), "deadbeef00000000000000000000000001");
+    EXPECT_EQ(uint256_t(v.to_string()), v);
+    EXPECT_EQ(uint256_t(10000000000000000000ull).to_string(), "10000000000000000000");
+    EXPECT_THROW(uint256_t("12a"), std::invalid_argument);
+}
+
+TEST(uint256Test, ConstantEvaluation) {
+    static_assert(uint256_t(6) * 7 == 42);
+    static_assert((uint256_t(1) << 200) / (uint256_t(1) << 100) == uint256_t(1) << 100);
+    static_assert(exp(2, 255) == uint256_t(1) << 255);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "memory/Arena.hpp"
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace quids {
+namespace memory {
+namespace test {
+
+namespace {
+
+bool aligned(const void* p, size_t alignment) {
+    return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+struct Point {
+    int x;
+    int y;
+};
+
+} // namespace
+
+TEST(MonotonicArenaTest, HandsOutAlignedDisjointBlocks) {
+    MonotonicArena arena(1024);
+    auto* a = static_cast<unsigned char*>(arena.allocate_bytes(3, 1));
+    auto* b = static_cast<unsigned char*>(arena.allocate_bytes(8, 8));
+    auto* c = static_cast<unsigned char*>(arena.allocate_bytes(64, 64));
+    EXPECT_TRUE(aligned(b, 8));
+    EXPECT_TRUE(aligned(c, 64));
+    EXPECT_GE(b, a + 3);
+    EXPECT_GE(c, b + 8);
+    EXPECT_TRUE(aligned(arena.allocate_bytes(1), alignof(std::max_align_t)));
+
+    const Point* p = arena.create<Point>(Point{3, 4});
+    EXPECT_TRUE(aligned(p, alignof(Point)));
+    EXPECT_EQ(p->x + p->y, 7);
+
+    EXPECT_EQ(arena.stats().chunks, 1u);
+    EXPECT_EQ(arena.stats().reserved_bytes, 1024u);
+    EXPECT_EQ(arena.stats().used_bytes, 3u + 8u + 64u + 1u + sizeof(Point));
+}
+
+TEST(MonotonicArenaTest, GrowsForLargeRequests) {
+    MonotonicArena arena(256);
+    arena.allocate_bytes(200);
+    // Bigger than a chunk gets a chunk of its own
+    void* big = arena.allocate_bytes(4096, 128);
+    EXPECT_TRUE(aligned(big, 128));
+    EXPECT_EQ(arena.stats().chunks, 2u);
+    EXPECT_GE(arena.stats().reserved_bytes, 256u + 4096u);
+}
+
+TEST(MonotonicArenaTest, ResetReusesChunksWithoutAllocating) {
+    MonotonicArena arena(256);
+    std::vector<void*> first;
+    for (int i = 0; i < 20; ++i) {
+        first.push_back(arena.allocate_bytes(64));
+    }
+    const auto grown = arena.stats();
+    EXPECT_GT(grown.chunks, 1u);
+
+    arena.reset();
+    EXPECT_EQ(arena.stats().used_bytes, 0u);
+    EXPECT_EQ(arena.stats().peak_bytes, 20u * 64u);
+    EXPECT_EQ(arena.stats().resets, 1u);
+
+    // The same batch again walks the retained chunks from the start
+    EXPECT_EQ(arena.allocate_bytes(64), first.front());
+    for (int i = 1; i < 20; ++i) {
+        arena.allocate_bytes(64);
+    }
+    EXPECT_EQ(arena.stats().chunks, grown.chunks);
+    EXPECT_EQ(arena.stats().reserved_bytes, grown.reserved_bytes);
+}
+
+TEST(MonotonicArenaTest, BacksPmrContainers) {
+    MonotonicArena arena;
+    for (int round = 0; round < 3; ++round) {
+        {
+            std::pmr::vector<int> values(&arena);
+            for (int i = 0; i < 1000; ++i) {
+                values.push_back(i);
+            }
+            EXPECT_EQ(values[999], 999);
+        }
+        arena.reset();
+    }
+    EXPECT_EQ(arena.stats().chunks, 1u);
+    EXPECT_EQ(arena.stats().resets, 3u);
+
+    MonotonicArena other;
+    EXPECT_TRUE(arena.is_equal(arena));
+    EXPECT_FALSE(arena.is_equal(other));
+}
+
+} // namespace test
+} // namespace memory
+} // namespace quids
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "memory/MemoryPool.hpp"
+#include <cstdint>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace memory {
+namespace test {
+
+namespace {
+
+struct alignas(32) Wide {
+    uint64_t lanes[4];
+};
+
+struct Counted {
+    static inline int live = 0;
+    std::string name;
+    explicit Counted(std::string n = {}) : name(std::move(n)) { ++live; }
+    ~Counted() { --live; }
+};
+
+} // namespace
+
+TEST(MemoryPoolTest, ConstructsAlignedObjectsFromSlabs) {
+    MemoryPool<Wide> pool(4);
+    std::set<Wide*> seen;
+    std::vector<Wide*> objects;
+    for (int i = 0; i < 10; ++i) {
+        Wide* w = pool.construct();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(w) % alignof(Wide), 0u);
+        EXPECT_TRUE(seen.insert(w).second);
+        objects.push_back(w);
+    }
+    const auto stats = pool.stats();
+    EXPECT_EQ(stats.allocations, 10u);
+    EXPECT_EQ(stats.slabs, 3u);
+    EXPECT_EQ(stats.slab_bytes, 3u * 4u * sizeof(Wide));
+
+    for (Wide* w : objects) {
+        pool.destroy(w);
+    }
+    EXPECT_EQ(pool.stats().deallocations, 10u);
+    // Freed slots come back before the pool grows
+    Wide* again = pool.construct();
+    EXPECT_EQ(seen.count(again), 1u);
+    pool.destroy(again);
+    EXPECT_EQ(pool.stats().slabs, 3u);
+}
+
+TEST(MemoryPoolTest, RunsConstructorsAndDestructors) {
+    MemoryPool<Counted> pool(8);
+    {
+        auto owned = pool.make_unique("owned");
+        EXPECT_EQ(owned->name, "owned");
+        EXPECT_EQ(Counted::live, 1);
+    }
+    EXPECT_EQ(Counted::live, 0);
+
+    std::vector<Counted*> batch;
+    for (int i = 0; i < 20; ++i) {
+        batch.push_back(pool.construct(std::to_string(i)));
+    }
+    batch.push_back(nullptr);
+    EXPECT_EQ(Counted::live, 20);
+    pool.destroy_bulk(batch);
+    EXPECT_EQ(Counted::live, 0);
+    EXPECT_EQ(pool.stats().deallocations, 21u);
+}
+
+TEST(MemoryPoolTest, SlotsMoveBetweenThreads) {
+    const auto before = MemoryPool<uint64_t>::type_stats();
+    MemoryPool<uint64_t> pool(16);
+
+    std::vector<uint64_t*> made;
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < 500; ++i) {
+            made.push_back(pool.construct(i));
+        }
+    });
+    producer.join();
+    // Freed on another thread than the one that allocated
+    for (uint64_t i = 0; i < made.size(); ++i) {
+        EXPECT_EQ(*made[i], i);
+        pool.destroy(made[i]);
+    }
+
+    const auto stats = pool.stats();
+    EXPECT_EQ(stats.allocations, 500u);
+    EXPECT_EQ(stats.deallocations, 500u);
+    EXPECT_GT(stats.refills, 0u);
+    const auto after = MemoryPool<uint64_t>::type_stats();
+    EXPECT_EQ(after.allocations - before.allocations, 500u);
+    EXPECT_EQ(after.slabs - before.slabs, stats.slabs);
+}
+
+} // namespace test
+} // namespace memory
+} // namespace quids
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "memory/MemoryBudget.hpp"
+#include "network/BufferRing.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using memory::MemoryAccountant;
+using memory::Subsystem;
+
+// 4 x 256 B and 2 x 2 KiB, listed out of order on purpose
+BufferRing smallRing() {
+    return BufferRing({{2048, 2}, {256, 4}});
+}
+
+} // namespace
+
+TEST(BufferRingTest, ServesTheSmallestClassThatFits) {
+    auto ring = smallRing();
+    EXPECT_EQ(ring.maxBufferSize(), 2048u);
+
+    auto small = ring.acquire(100);
+    ASSERT_TRUE(small);
+    EXPECT_EQ(small.size(), 100u);
+    EXPECT_EQ(small.capacity(), 256u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(small.data()) % 64, 0u);
+    auto large = ring.acquire(257);
+    ASSERT_TRUE(large);
+    EXPECT_EQ(large.capacity(), 2048u);
+    EXPECT_FALSE(ring.acquire(2049));
+
+    // Once the small class is out, requests spill into the larger one
+    std::vector<BufferHandle> held;
+    for (int i = 0; i < 3; ++i) {
+        held.push_back(ring.acquire(10));
+        ASSERT_TRUE(held.back());
+        EXPECT_EQ(held.back().capacity(), 256u);
+    }
+    auto spilled = ring.acquire(10);
+    ASSERT_TRUE(spilled);
+    EXPECT_EQ(spilled.capacity(), 2048u);
+    EXPECT_FALSE(ring.acquire(10));
+
+    auto stats = ring.stats();
+    ASSERT_EQ(stats.classes.size(), 2u);
+    EXPECT_EQ(stats.classes[0].buffer_size, 256u);
+    EXPECT_EQ(stats.classes[0].in_use, 4u);
+    EXPECT_EQ(stats.classes[1].in_use, 2u);
+    EXPECT_EQ(stats.classes[0].exhausted, 2u);
+    EXPECT_EQ(stats.bytes_reserved, 4 * 256u + 2 * 2048u);
+    EXPECT_EQ(stats.bytes_in_use, stats.bytes_reserved);
+
+    // Released buffers are handed out again
+    held.clear();
+    spilled.reset();
+    stats = ring.stats();
+    EXPECT_EQ(stats.classes[0].in_use, 1u);
+    EXPECT_EQ(stats.classes[0].high_water, 4u);
+    EXPECT_EQ(stats.classes[1].in_use, 1u);
+    EXPECT_EQ(ring.acquire(10).capacity(), 256u);
+
+    EXPECT_THROW(BufferRing({}), std::invalid_argument);
+    EXPECT_THROW(BufferRing({{256, 0}}), std::invalid_argument);
+}
+
+TEST(BufferRingTest, CopiesShareTheBufferUntilTheLastIsGone) {
+    BufferRing ring({{64, 1}});
+    auto first = ring.acquire(3);
+    ASSERT_TRUE(first);
+    std::memcpy(first.data(), "abc", 3);
+
+    BufferHandle copy = first;
+    BufferHandle assigned;
+    assigned = copy;
+    EXPECT_EQ(copy.data(), first.data());
+    EXPECT_EQ(assigned.bytes().size(), 3u);
+    EXPECT_EQ(std::memcmp(assigned.data(), "abc", 3), 0);
+
+    // Moves transfer the reference without touching the count
+    BufferHandle moved = std::move(copy);
+    EXPECT_FALSE(copy);
+    first.reset();
+    assigned.reset();
+    EXPECT_FALSE(ring.acquire(1));
+    EXPECT_EQ(ring.stats().classes[0].in_use, 1u);
+
+    moved.resize(100);
+    EXPECT_EQ(moved.size(), 64u);
+    moved = BufferHandle();
+    EXPECT_EQ(ring.stats().classes[0].in_use, 0u);
+    EXPECT_TRUE(ring.acquire(1));
+}
+
+TEST(BufferRingTest, QuotaAndBudgetRefuseAndRefund) {
+    auto ring = smallRing();
+    auto quota = std::make_shared<BufferQuota>(600);
+    auto a = ring.acquire(10, quota);
+    auto b = ring.acquire(10, quota);
+    ASSERT_TRUE(a);
+    ASSERT_TRUE(b);
+    // Charged by capacity, not by the bytes asked for
+    EXPECT_EQ(quota->used(), 512u);
+    EXPECT_FALSE(ring.acquire(10, quota));
+    EXPECT_EQ(ring.stats().quota_rejections, 1u);
+    // Unquoted requests are not held back
+    EXPECT_TRUE(ring.acquire(10));
+    a.reset();
+    EXPECT_EQ(quota->used(), 256u);
+    EXPECT_TRUE(ring.acquire(10, quota));
+
+    // The node-wide budget for network buffers
+    auto& accountant = MemoryAccountant::global();
+    const size_t live = accountant.live(Subsystem::NetworkBuffers);
+    accountant.set_budget(Subsystem::NetworkBuffers, live + 300);
+    auto within = ring.acquire(10);
+    auto refused = ring.acquire(10);
+    accountant.set_budget(Subsystem::NetworkBuffers, 0);
+    EXPECT_TRUE(within);
+    EXPECT_FALSE(refused);
+    EXPECT_EQ(ring.stats().budget_rejections, 1u);
+    EXPECT_EQ(accountant.live(Subsystem::NetworkBuffers), live + 256);
+    within.reset();
+    EXPECT_EQ(accountant.live(Subsystem::NetworkBuffers), live);
+
+    // A budget refusal leaves the quota untouched and the slot free
+    EXPECT_EQ(quota->used(), 256u);
+    EXPECT_EQ(ring.stats().classes[0].in_use, 1u);
+}
+
+TEST(BufferRingTest, ConcurrentAcquireAndReleaseLoseNothing) {
+    constexpr size_t THREADS = 4;
+    constexpr int ROUNDS = 20000;
+    BufferRing ring({{128, 8}, {1024, 4}});
+    std::atomic<uint64_t> corrupted{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < ROUNDS; ++round) {
+                const size_t size = (round % 3 == 0) ? 500 : 100;
+                auto handle = ring.acquire(size);
+                if (!handle) {
+                    continue;
+                }
+                // Nobody else writes a buffer while this thread holds it
+                std::memset(handle.data(), static_cast<int>(t + 1), size);
+                BufferHandle shared = handle;
+                handle.reset();
+                for (size_t i = 0; i < size; ++i) {
+                    if (shared.data()[i] != t + 1) {
+                        corrupted.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(corrupted.load(), 0u);
+
+    // Every slot came back
+    const auto stats = ring.stats();
+    EXPECT_EQ(stats.bytes_in_use, 0u);
+    std::vector<BufferHandle> all;
+    for (int i = 0; i < 12; ++i) {
+        all.push_back(ring.acquire(1));
+        EXPECT_TRUE(all.back()) << i;
+    }
+    EXPECT_FALSE(ring.acquire(1));
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include "network/CompactBlock.hpp"
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using Hash = CompactBlock::Hash;
+
+std::vector<uint8_t> tx(uint32_t n) {
+    return {static_cast<uint8_t>(n), static_cast<uint8_t>(n >> 8), 0xAB, static_cast<uint8_t>(n * 7)};
+}
+
+// A block of `count` transactions with distinct hashes
+struct Block {
+    explicit Block(uint32_t count = 0, uint32_t first = 0) {
+        for (uint32_t i = 0; i < count; ++i) {
+            txs.push_back(tx(first + i));
+            hashes.push_back(CompactBlock::block_id(txs.back()));
+        }
+    }
+
+    std::vector<uint8_t> header{'h', 'd', 'r', 1};
+    std::vector<std::vector<uint8_t>> txs;
+    std::vector<Hash> hashes;
+};
+
+// A mempool holding `pool`; counts the transactions it had to serialize
+CompactBlock::TransactionSource mempool(const Block& pool, size_t* serialized = nullptr) {
+    return [&pool, serialized](const CompactBlock::Visitor& visit) {
+        for (size_t i = 0; i < pool.txs.size(); ++i) {
+            visit(pool.hashes[i], [&pool, i, serialized] {
+                if (serialized) ++*serialized;
+                return pool.txs[i];
+            });
+        }
+    };
+}
+
+} // namespace
+
+TEST(CompactBlockTest, RebuildsFromTheReceiversMempool) {
+    Block block(50);
+    const auto compact = CompactBlock::build(block.header, block.hashes, block.txs, 42);
+    ASSERT_EQ(compact.short_ids.size(), 50u);
+    EXPECT_TRUE(compact.prefilled.empty());
+    for (const auto id : compact.short_ids) {
+        EXPECT_EQ(id >> 48, 0u);
+    }
+    EXPECT_EQ(compact.short_id(block.hashes[7]), compact.short_ids[7]);
+
+    // Header, nonce, count and 6 bytes per transaction on the wire
+    const auto wire = compact.encode();
+    EXPECT_EQ(wire.size(), 4 + block.header.size() + 8 + 4 + 50 * CompactBlock::SHORT_ID_BYTES + 4);
+    const auto decoded = CompactBlock::decode(wire);
+    ASSERT_TRUE(decoded);
+    EXPECT_EQ(decoded->header, block.header);
+    EXPECT_EQ(decoded->nonce, 42u);
+    EXPECT_EQ(decoded->short_ids, compact.short_ids);
+    EXPECT_EQ(decoded->id(), CompactBlock::block_id(block.header));
+
+    // The mempool also holds unrelated transactions; only the block's
+    // are serialized
+    Block pool(50);
+    Block extra(30, 1000);
+    pool.txs.insert(pool.txs.end(), extra.txs.begin(), extra.txs.end());
+    pool.hashes.insert(pool.hashes.end(), extra.hashes.begin(), extra.hashes.end());
+    size_t serialized = 0;
+    PartialBlock partial(*decoded, mempool(pool, &serialized));
+    EXPECT_TRUE(partial.complete());
+    EXPECT_EQ(partial.matched(), 50u);
+    EXPECT_EQ(serialized, 50u);
+    EXPECT_EQ(partial.transactions(), block.txs);
+}
+
+TEST(CompactBlockTest, FetchesOnlyWhatIsMissingInOneRoundTrip) {
+    Block block(20);
+    const uint32_t prefill[] = {0, 5};
+    const auto compact = CompactBlock::build(block.header, block.hashes, block.txs, 7, prefill);
+    EXPECT_EQ(compact.short_ids.size(), 18u);
+    ASSERT_EQ(compact.prefilled.size(), 2u);
+    EXPECT_EQ(compact.prefilled[1].index, 5u);
+    EXPECT_EQ(compact.transaction_count(), 20u);
+
+    // The receiver lacks transactions 3, 5 (prefilled) and 12..14
+    Block pool;
+    for (uint32_t i = 0; i < 20; ++i) {
+        if (i != 3 && i != 5 && (i < 12 || i > 14)) {
+            pool.txs.push_back(block.txs[i]);
+            pool.hashes.push_back(block.hashes[i]);
+        }
+    }
+    PartialBlock partial(*CompactBlock::decode(compact.encode()), mempool(pool));
+    EXPECT_FALSE(partial.complete());
+    EXPECT_EQ(partial.missing(), (std::vector<uint32_t>{3, 12, 13, 14}));
+    EXPECT_EQ(partial.matched(), 14u);
+
+    const auto request = CompactBlock::encode_request(compact.id(), partial.missing());
+    Hash asked_block{};
+    std::vector<uint32_t> asked;
+    ASSERT_TRUE(CompactBlock::decode_request(request, asked_block, asked));
+    EXPECT_EQ(asked_block, compact.id());
+    EXPECT_EQ(asked, partial.missing());
+
+    std::vector<std::vector<uint8_t>> answer;
+    for (const uint32_t index : asked) {
+        answer.push_back(block.txs[index]);
+    }
+    const auto reply = CompactBlock::decode_transactions(CompactBlock::encode_transactions(answer));
+    ASSERT_TRUE(reply);
+    EXPECT_FALSE(partial.fill({answer.front()}));
+    ASSERT_TRUE(partial.fill(*reply));
+    EXPECT_TRUE(partial.complete());
+    EXPECT_EQ(partial.take_transactions(), block.txs);
+}
+
+TEST(CompactBlockTest, ShortIdsChangeWithTheNonceAndRepeatsAreFetched) {
+    Block block(200);
+    const auto a = CompactBlock::build(block.header, block.hashes, block.txs, 1);
+    const auto b = CompactBlock::build(block.header, block.hashes, block.txs, 2);
+    size_t same = 0;
+    for (size_t i = 0; i < a.short_ids.size(); ++i) {
+        same += a.short_ids[i] == b.short_ids[i];
+    }
+    EXPECT_EQ(same, 0u);
+    EXPECT_EQ(std::set<uint64_t>(a.short_ids.begin(), a.short_ids.end()).size(), 200u);
+
+    // An id the block repeats names no position; both are asked for
+    Block twice(3);
+    twice.hashes[2] = twice.hashes[0];
+    twice.txs[2] = twice.txs[0];
+    const auto compact = CompactBlock::build(twice.header, twice.hashes, twice.txs, 9);
+    PartialBlock partial(compact, mempool(twice));
+    EXPECT_EQ(partial.missing(), (std::vector<uint32_t>{0, 2}));
+    EXPECT_EQ(partial.matched(), 1u);
+
+    // Without a source everything but the prefilled is missing
+    const uint32_t prefill[] = {1};
+    PartialBlock empty(CompactBlock::build(block.header, block.hashes, block.txs, 3, prefill), {});
+    EXPECT_EQ(empty.missing().size(), 199u);
+    EXPECT_EQ(empty.matched(), 0u);
+}
+
+TEST(CompactBlockTest, RejectsMalformedFrames) {
+    Block block(4);
+    const uint32_t prefill[] = {1, 3};
+    const auto wire = CompactBlock::build(block.header, block.hashes, block.txs, 5, prefill).encode();
+    ASSERT_TRUE(CompactBlock::decode(wire));
+    for (size_t cut = 0; cut < wire.size(); ++cut) {
+        EXPECT_FALSE(CompactBlock::decode(std::span<const uint8_t>(wire).first(cut))) << cut;
+    }
+    auto trailing = wire;
+    trailing.push_back(0);
+    EXPECT_FALSE(CompactBlock::decode(trailing));
+
+    // Prefilled entries out of order or past the last transaction
+    CompactBlock bad;
+    bad.header = block.header;
+    bad.short_ids = {1, 2};
+    bad.prefilled = {{3, tx(3)}, {1, tx(1)}};
+    EXPECT_FALSE(CompactBlock::decode(bad.encode()));
+    bad.prefilled = {{1, tx(1)}, {4, tx(4)}};
+    EXPECT_FALSE(CompactBlock::decode(bad.encode()));
+    bad.prefilled = {{1, tx(1)}, {3, tx(3)}};
+    EXPECT_TRUE(CompactBlock::decode(bad.encode()));
+
+    Hash id{};
+    std::vector<uint32_t> indexes;
+    const uint32_t asked[] = {1, 2};
+    auto request = CompactBlock::encode_request(id, asked);
+    request.pop_back();
+    EXPECT_FALSE(CompactBlock::decode_request(request, id, indexes));
+    request.resize(id.size() + 2);
+    EXPECT_FALSE(CompactBlock::decode_request(request, id, indexes));
+
+    auto txs = CompactBlock::encode_transactions(block.txs);
+    txs.pop_back();
+    EXPECT_FALSE(CompactBlock::decode_transactions(txs));
+    txs = CompactBlock::encode_transactions(block.txs);
+    txs.push_back(0);
+    EXPECT_FALSE(CompactBlock::decode_transactions(txs));
+    // A count the frame cannot hold
+    EXPECT_FALSE(CompactBlock::decode_transactions(std::vector<uint8_t>{0xff, 0xff, 0xff, 0x7f}));
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include "network/ConsensusTransport.hpp"
+#include "network/OptimizedNetworkLayer.hpp"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+// Keeps what the layer sends and never receives anything
+class RecordingTransport : public MessageTransport {
+public:
+    void start() override {}
+    void stop() override {}
+    size_t getActiveConnections() const override { return 0; }
+    void sendMessage(Message&& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sent_.push_back(std::move(msg));
+    }
+    std::vector<Message> receiveMessages() override { return {}; }
+    void setMaxStreamBitrate(size_t) override {}
+    void setPeerWeights(const std::vector<std::pair<NodeID, double>>&) override {}
+    void setDisconnectionHandler(std::function<void(const NodeID&)>) override {}
+
+    std::vector<Message> sent() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sent_;
+    }
+
+    // Until at least count messages went out, or a second passed
+    std::vector<Message> waitFor(size_t count) const {
+        for (int i = 0; i < 1000; ++i) {
+            auto messages = sent();
+            if (messages.size() >= count) {
+                return messages;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return sent();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Message> sent_;
+};
+
+NetworkConfig layerConfig(size_t bufferSize) {
+    NetworkConfig config{};
+    config.bufferSize = bufferSize;
+    config.useQuantumEncryption = false;
+    config.numWorkerThreads = 1;
+    return config;
+}
+
+ConsensusTransport::Config manualFlush() {
+    ConsensusTransport::Config config;
+    config.tick = std::chrono::hours(1);
+    return config;
+}
+
+std::vector<uint8_t> bytes(const std::string& s) {
+    return {s.begin(), s.end()};
+}
+
+// The entries of one sent consensus message, as kind and payload
+std::vector<std::pair<ConsensusTransport::EntryKind, std::string>> entriesOf(const Message& msg) {
+    wire::Frame frame;
+    EXPECT_EQ(wire::decodeFrame(msg.data, frame), wire::Status::Ok);
+    EXPECT_EQ(frame.type(), wire::types::CONSENSUS_FRAME);
+    EXPECT_EQ(frame.size(), msg.data.size());
+    std::vector<std::pair<ConsensusTransport::EntryKind, std::string>> entries;
+    EXPECT_TRUE(ConsensusTransport::decodeFrame(frame.payload,
+        [&](ConsensusTransport::EntryKind kind, std::span<const uint8_t> payload) {
+            entries.emplace_back(kind, std::string(payload.begin(), payload.end()));
+        }));
+    return entries;
+}
+
+} // namespace
+
+TEST(ConsensusTransportTest, CoalescesEntriesPerPeerInQueueOrder) {
+    auto transport = std::make_unique<RecordingTransport>();
+    const RecordingTransport& sink = *transport;
+    OptimizedNetworkLayer network(layerConfig(64), std::move(transport));
+    ConsensusTransport consensus(network, manualFlush());
+
+    using Kind = ConsensusTransport::EntryKind;
+    consensus.queueVote("alice", bytes("v1"));
+    consensus.queueProof("bob", bytes("p1"));
+    consensus.queueAck("alice", bytes("a1"));
+    consensus.queueVote("alice", bytes("v2"));
+    consensus.flush();
+    EXPECT_EQ(consensus.stats().entries_sent, 4u);
+    EXPECT_EQ(consensus.stats().frames_sent, 2u);
+
+    network.start();
+    const auto sent = sink.waitFor(2);
+    network.stop();
+    ASSERT_EQ(sent.size(), 2u);
+
+    for (const auto& msg : sent) {
+        if (msg.target == "alice") {
+            EXPECT_EQ(entriesOf(msg), (std::vector<std::pair<Kind, std::string>>{
+                {Kind::Vote, "v1"}, {Kind::Ack, "a1"}, {Kind::Vote, "v2"}}));
+        } else {
+            EXPECT_EQ(msg.target, "bob");
+            EXPECT_EQ(entriesOf(msg), (std::vector<std::pair<Kind, std::string>>{{Kind::Proof, "p1"}}));
+        }
+    }
+
+    // The receiving side hands the entries out in the same order
+    std::vector<std::string> delivered;
+    consensus.setHandler(Kind::Vote, [&](const NodeID& from, std::span<const uint8_t> payload) {
+        delivered.push_back(from + ":vote:" + std::string(payload.begin(), payload.end()));
+    });
+    consensus.setHandler(Kind::Ack, [&](const NodeID& from, std::span<const uint8_t> payload) {
+        delivered.push_back(from + ":ack:" + std::string(payload.begin(), payload.end()));
+    });
+    const auto& alice = sent[0].target == "alice" ? sent[0] : sent[1];
+    consensus.onFrame("alice", std::span<const uint8_t>(alice.data).subspan(wire::HEADER_SIZE));
+    EXPECT_EQ(delivered, (std::vector<std::string>{"alice:vote:v1", "alice:ack:a1", "alice:vote:v2"}));
+    EXPECT_EQ(consensus.stats().entries_received, 3u);
+}
+
+TEST(ConsensusTransportTest, CutsAFrameThatWouldOverflow) {
+    auto transport = std::make_unique<RecordingTransport>();
+    const RecordingTransport& sink = *transport;
+    OptimizedNetworkLayer network(layerConfig(64), std::move(transport));
+    auto config = manualFlush();
+    config.max_frame_bytes = 70;
+    ConsensusTransport consensus(network, config);
+
+    // Each entry takes 5 bytes of header and 20 of payload, so two fit
+    // beside the wire and frame headers and the third starts a new frame
+    const std::vector<uint8_t> payload(20, 0x7a);
+    for (int i = 0; i < 3; ++i) {
+        consensus.queueVote("alice", payload);
+    }
+    EXPECT_EQ(consensus.stats().frames_sent, 1u);
+    consensus.flush();
+    EXPECT_EQ(consensus.stats().frames_sent, 2u);
+
+    network.start();
+    const auto sent = sink.waitFor(2);
+    network.stop();
+    ASSERT_EQ(sent.size(), 2u);
+    EXPECT_EQ(entriesOf(sent[0]).size(), 2u);
+    EXPECT_EQ(entriesOf(sent[1]).size(), 1u);
+    EXPECT_LE(sent[0].data.size(), config.max_frame_bytes);
+}
+
+TEST(ConsensusTransportTest, ConsensusLaneLeavesAheadOfQueuedGossip) {
+    auto transport = std::make_unique<RecordingTransport>();
+    const RecordingTransport& sink = *transport;
+    // Gossip skips the batcher's linger, so only the lane order decides
+    auto config = layerConfig(1024);
+    config.batching.max_batch_bytes = 1;
+    OptimizedNetworkLayer network(config, std::move(transport));
+    ConsensusTransport consensus(network, manualFlush());
+
+    // A gossip flood is already waiting when the vote is queued
+    constexpr size_t GOSSIP = 500;
+    for (size_t i = 0; i < GOSSIP; ++i) {
+        Message gossip;
+        wire::appendFrame(gossip.data, wire::types::GOSSIP, 0, bytes("tx-" + std::to_string(i)));
+        network.sendMessage("peer-" + std::to_string(i % 4), gossip);
+    }
+    consensus.queueVote("peer-0", bytes("vote"));
+    consensus.flush();
+
+    network.start();
+    const auto sent = sink.waitFor(GOSSIP + 1);
+    network.stop();
+    ASSERT_EQ(sent.size(), GOSSIP + 1);
+
+    wire::Frame first;
+    ASSERT_EQ(wire::decodeFrame(sent.front().data, first), wire::Status::Ok);
+    EXPECT_EQ(first.type(), wire::types::CONSENSUS_FRAME);
+    EXPECT_EQ(sent.front().target, "peer-0");
+    for (size_t i = 1; i < sent.size(); ++i) {
+        wire::Frame frame;
+        ASSERT_EQ(wire::decodeFrame(sent[i].data, frame), wire::Status::Ok);
+        EXPECT_NE(frame.type(), wire::types::CONSENSUS_FRAME) << i;
+    }
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include "network/DataAvailability.hpp"
+#include "network/ErasureCode.hpp"
+#include <cstdint>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+constexpr size_t K = 4;
+constexpr size_t M = 3;
+
+std::vector<uint8_t> block(size_t size, uint8_t seed) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<uint8_t>(seed + i * 31 + (i >> 8));
+    }
+    return bytes;
+}
+
+std::vector<std::vector<uint8_t>> encoded(const ReedSolomon& code, size_t shard_size) {
+    std::vector<std::vector<uint8_t>> shards;
+    for (size_t i = 0; i < code.data_shards(); ++i) {
+        shards.push_back(block(shard_size, static_cast<uint8_t>(i * 17 + 1)));
+    }
+    code.encode(shards);
+    return shards;
+}
+
+// Every subset of {0, ..., n - 1} as a bit mask, for small n
+std::vector<uint32_t> masks_of_size(size_t n, size_t size) {
+    std::vector<uint32_t> out;
+    for (uint32_t mask = 0; mask < (1u << n); ++mask) {
+        if (static_cast<size_t>(__builtin_popcount(mask)) == size) out.push_back(mask);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(ReedSolomonTest, RebuildsFromEveryKSubset) {
+    const ReedSolomon code(K, M);
+    const auto original = encoded(code, 37);
+    ASSERT_EQ(original.size(), K + M);
+
+    // Data shards come through unchanged
+    for (size_t i = 0; i < K; ++i) {
+        EXPECT_EQ(original[i], block(37, static_cast<uint8_t>(i * 17 + 1)));
+    }
+
+    const auto subsets = masks_of_size(K + M, K);
+    ASSERT_EQ(subsets.size(), 35u);
+    for (const uint32_t mask : subsets) {
+        SCOPED_TRACE(mask);
+        auto shards = original;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            if (!(mask & (1u << i))) shards[i].clear();
+        }
+        ASSERT_TRUE(code.reconstruct(shards));
+        for (size_t i = 0; i < K; ++i) {
+            EXPECT_EQ(shards[i], original[i]);
+        }
+    }
+}
+
+TEST(ReedSolomonTest, RefusesTooFewOrMismatchedShards) {
+    const ReedSolomon code(K, M);
+    const auto original = encoded(code, 16);
+    for (const uint32_t mask : masks_of_size(K + M, K - 1)) {
+        auto shards = original;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            if (!(mask & (1u << i))) shards[i].clear();
+        }
+        EXPECT_FALSE(code.reconstruct(shards)) << mask;
+    }
+
+    auto uneven = original;
+    uneven[0].clear();
+    uneven[2].push_back(0);
+    EXPECT_FALSE(code.reconstruct(uneven));
+    auto short_list = original;
+    short_list.pop_back();
+    EXPECT_FALSE(code.reconstruct(short_list));
+
+    EXPECT_THROW(ReedSolomon(0, 2), std::invalid_argument);
+    EXPECT_THROW(ReedSolomon(200, 57), std::invalid_argument);
+    EXPECT_NO_THROW(ReedSolomon(200, 56));
+    std::vector<std::vector<uint8_t>> ragged{{1, 2}, {3}, {4, 5}, {6, 7}};
+    EXPECT_THROW(code.encode(ragged), std::invalid_argument);
+}
+
+TEST(DataAvailabilityTest, RebuildsTheBlockFromAnyDataChunks) {
+    // Not a multiple of the chunk count, so the last data chunk is padded
+    const auto original = block(1001, 5);
+    const auto chunked = ChunkedBlock::encode(original, K, M);
+    const auto& commitment = chunked.commitment();
+    EXPECT_EQ(commitment.total_chunks(), K + M);
+    EXPECT_EQ(commitment.chunk_size, 251u);
+    EXPECT_EQ(commitment.block_size, original.size());
+
+    for (const uint32_t mask : masks_of_size(K + M, K)) {
+        SCOPED_TRACE(mask);
+        std::vector<BlockChunk> held;
+        for (const auto& chunk : chunked.chunks()) {
+            if (mask & (1u << chunk.index)) held.push_back(chunk);
+        }
+        const auto rebuilt = ChunkedBlock::reconstruct(commitment, held);
+        ASSERT_TRUE(rebuilt);
+        EXPECT_EQ(*rebuilt, original);
+        held.pop_back();
+        EXPECT_FALSE(ChunkedBlock::reconstruct(commitment, held));
+    }
+
+    // Commitments and chunks survive the wire
+    const auto decoded = AvailabilityCommitment::decode(commitment.encode());
+    ASSERT_TRUE(decoded);
+    EXPECT_EQ(decoded->id(), commitment.id());
+    for (const auto& chunk : chunked.chunks()) {
+        const auto copy = BlockChunk::decode(chunk.encode());
+        ASSERT_TRUE(copy);
+        EXPECT_TRUE(ChunkedBlock::verify(*decoded, *copy));
+    }
+}
+
+TEST(DataAvailabilityTest, RejectsChunksWithABadProof) {
+    const auto chunked = ChunkedBlock::encode(block(4096, 9), K, M);
+    const auto& commitment = chunked.commitment();
+    const auto& good = chunked.chunks()[2];
+    ASSERT_TRUE(ChunkedBlock::verify(commitment, good));
+
+    auto flipped_sibling = good;
+    flipped_sibling.proof[0][0] ^= 0x01;
+    EXPECT_FALSE(ChunkedBlock::verify(commitment, flipped_sibling));
+
+    auto short_proof = good;
+    short_proof.proof.pop_back();
+    EXPECT_FALSE(ChunkedBlock::verify(commitment, short_proof));
+
+    // A proof is bound to its position and to its data
+    auto moved = good;
+    moved.index = 3;
+    EXPECT_FALSE(ChunkedBlock::verify(commitment, moved));
+    auto altered = good;
+    altered.data[100] ^= 0x80;
+    EXPECT_FALSE(ChunkedBlock::verify(commitment, altered));
+    auto foreign = good;
+    foreign.proof = chunked.chunks()[5].proof;
+    EXPECT_FALSE(ChunkedBlock::verify(commitment, foreign));
+    auto outside = good;
+    outside.index = K + M;
+    EXPECT_FALSE(ChunkedBlock::verify(commitment, outside));
+
+    // Another block's commitment does not vouch for this one
+    const auto other = ChunkedBlock::encode(block(4096, 10), K, M);
+    EXPECT_FALSE(ChunkedBlock::verify(other.commitment(), good));
+
+    // Bad chunks are skipped, not used: with one of the four forged the
+    // block is only rebuilt once a fifth good chunk arrives
+    std::vector<BlockChunk> held{chunked.chunks()[0], chunked.chunks()[1], altered, chunked.chunks()[6]};
+    EXPECT_FALSE(ChunkedBlock::reconstruct(commitment, held));
+    held.push_back(chunked.chunks()[4]);
+    const auto rebuilt = ChunkedBlock::reconstruct(commitment, held);
+    ASSERT_TRUE(rebuilt);
+    EXPECT_EQ(*rebuilt, block(4096, 9));
+}
+
+TEST(DataAvailabilityTest, SamplesDistinctChunks) {
+    const auto chunked = ChunkedBlock::encode(block(512, 1), K, M);
+    std::mt19937_64 rng(3);
+    for (int round = 0; round < 20; ++round) {
+        const auto picked = ChunkedBlock::sample(chunked.commitment(), 4, rng);
+        ASSERT_EQ(picked.size(), 4u);
+        const std::set<uint32_t> distinct(picked.begin(), picked.end());
+        EXPECT_EQ(distinct.size(), 4u);
+        EXPECT_LT(*distinct.rbegin(), K + M);
+    }
+    EXPECT_EQ(ChunkedBlock::sample(chunked.commitment(), 100, rng).size(), K + M);
+
+    // Each sample misses a withheld block with probability at most
+    // (total - parity - 1) / total, and every chunk sampled leaves none
+    EXPECT_LE(chunked.commitment().miss_probability(1), 3.0 / 7.0 + 1e-12);
+    EXPECT_LT(chunked.commitment().miss_probability(2), chunked.commitment().miss_probability(1));
+    EXPECT_EQ(chunked.commitment().miss_probability(K + M), 0.0);
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
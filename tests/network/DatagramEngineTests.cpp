@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "network/DatagramEngine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using Endpoint = boost::asio::ip::udp::endpoint;
+
+// Datagram `index` of `size` bytes; the index leads so each can be told apart
+std::vector<uint8_t> datagram(uint32_t index, size_t size) {
+    std::vector<uint8_t> bytes(std::max<size_t>(size, 4));
+    for (size_t i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<uint8_t>(index >> (8 * i));
+    }
+    for (size_t i = 4; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(index * 7 + i);
+    }
+    return bytes;
+}
+
+// What a receiving engine's handler saw
+class Inbox {
+public:
+    DatagramEngine::Handler handler() {
+        return [this](const std::string& address, uint16_t port, std::span<const uint8_t> data) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            received_.emplace_back(data.begin(), data.end());
+            from_ = address + ":" + std::to_string(port);
+            arrived_.notify_all();
+        };
+    }
+
+    bool waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return arrived_.wait_for(lock, std::chrono::seconds(10), [&] { return received_.size() >= count; });
+    }
+
+    std::vector<std::vector<uint8_t>> sorted() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto out = received_;
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    std::string from() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return from_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable arrived_;
+    std::vector<std::vector<uint8_t>> received_;
+    std::string from_;
+};
+
+DatagramEngine::Config loopback() {
+    DatagramEngine::Config config;
+    config.bind_address = "127.0.0.1";
+    config.batch = 16;
+    return config;
+}
+
+// Sends `sizes` as datagrams 0, 1, ... and checks all of them arrive intact
+void expectDelivered(const DatagramEngine::Config& config, const std::vector<size_t>& sizes) {
+    Inbox inbox;
+    DatagramEngine receiver(config, inbox.handler());
+    DatagramEngine sender(config, nullptr);
+    receiver.start();
+    sender.start();
+    ASSERT_NE(receiver.port(), 0u);
+
+    const Endpoint to(boost::asio::ip::make_address("127.0.0.1"), receiver.port());
+    std::vector<std::vector<uint8_t>> sent;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        sent.push_back(datagram(static_cast<uint32_t>(i), sizes[i]));
+    }
+    std::vector<DatagramEngine::Outgoing> outgoing;
+    for (const auto& bytes : sent) {
+        outgoing.push_back({to, bytes});
+    }
+    EXPECT_EQ(sender.send(outgoing), sent.size());
+    ASSERT_TRUE(inbox.waitFor(sent.size()));
+
+    std::sort(sent.begin(), sent.end());
+    EXPECT_EQ(inbox.sorted(), sent);
+    EXPECT_EQ(inbox.from(), "127.0.0.1:" + std::to_string(sender.port()));
+
+    const auto out = sender.stats();
+    EXPECT_EQ(out.datagrams_sent, sent.size());
+    EXPECT_EQ(out.send_errors, 0u);
+    // Batched: many datagrams per system call
+    EXPECT_LE(out.send_calls, (sent.size() + config.batch - 1) / config.batch);
+    const auto in = receiver.stats();
+    EXPECT_EQ(in.datagrams_received, sent.size());
+    EXPECT_LE(in.receive_calls, in.datagrams_received);
+    EXPECT_EQ(in.truncated, 0u);
+}
+
+// Equal-sized runs GSO can coalesce, shorter tails that end a run, and
+// sizes that change every datagram
+std::vector<size_t> mixedSizes() {
+    std::vector<size_t> sizes;
+    for (size_t run = 0; run < 5; ++run) {
+        sizes.insert(sizes.end(), 20, 1200);
+        sizes.push_back(300 + run);
+    }
+    for (size_t i = 0; i < 60; ++i) {
+        sizes.push_back(16 + i * 23);
+    }
+    return sizes;
+}
+
+} // namespace
+
+TEST(DatagramEngineTest, DeliversEveryDatagramIntact) {
+    expectDelivered(loopback(), mixedSizes());
+}
+
+TEST(DatagramEngineTest, DeliversWithoutSegmentationOffload) {
+    auto config = loopback();
+    config.enable_gso = false;
+    config.enable_gro = false;
+    expectDelivered(config, mixedSizes());
+}
+
+TEST(DatagramEngineTest, CountsDatagramsLargerThanTheSlot) {
+    auto config = loopback();
+    config.enable_gro = false;
+    config.max_datagram = 512;
+    Inbox inbox;
+    DatagramEngine receiver(config, inbox.handler());
+    DatagramEngine sender(config, nullptr);
+    receiver.start();
+    sender.start();
+
+    const Endpoint to(boost::asio::ip::make_address("127.0.0.1"), receiver.port());
+    const auto big = datagram(0, 2000);
+    const auto small = datagram(1, 100);
+    std::vector<DatagramEngine::Outgoing> outgoing{{to, big}, {to, small}};
+    EXPECT_EQ(sender.send(outgoing), 2u);
+
+    // The oversized one is dropped, not handed over cut short
+    ASSERT_TRUE(inbox.waitFor(1));
+    EXPECT_EQ(inbox.sorted(), std::vector<std::vector<uint8_t>>{small});
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (receiver.stats().truncated == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(receiver.stats().truncated, 1u);
+    EXPECT_EQ(receiver.stats().datagrams_received, 1u);
+}
+
+TEST(DatagramEngineTest, RejectsBadConfigAndIdleSends) {
+    auto config = loopback();
+    config.batch = 0;
+    EXPECT_THROW(DatagramEngine(config, nullptr), std::invalid_argument);
+    config = loopback();
+    config.max_datagram = 70000;
+    EXPECT_THROW(DatagramEngine(config, nullptr), std::invalid_argument);
+
+    // Nothing goes out before start() or after stop()
+    DatagramEngine engine(loopback(), nullptr);
+    const auto bytes = datagram(0, 10);
+    const std::vector<DatagramEngine::Outgoing> one{{Endpoint(boost::asio::ip::make_address("127.0.0.1"), 9), bytes}};
+    EXPECT_EQ(engine.send(one), 0u);
+    engine.start();
+    engine.stop();
+    EXPECT_EQ(engine.send(one), 0u);
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
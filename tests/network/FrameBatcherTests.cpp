@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+#include "network/FrameBatcher.hpp"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = FrameBatcher::Clock;
+
+std::vector<uint8_t> frame(uint8_t type, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> out;
+    wire::appendFrame(out, type, 0, payload);
+    return out;
+}
+
+// Text-like payloads that compress well and share structure
+std::vector<uint8_t> vote(uint32_t n) {
+    const std::string text = "{\"type\":\"vote\",\"height\":" + std::to_string(1000 + n) +
+                             ",\"round\":" + std::to_string(n % 7) + ",\"validator\":\"validator-" +
+                             std::to_string(n % 13) + "\",\"signature\":\"" + std::string(32, 'a' + n % 26) + "\"}";
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+std::vector<uint8_t> noise(size_t size, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<uint8_t> out(size);
+    for (auto& byte : out) byte = static_cast<uint8_t>(rng());
+    return out;
+}
+
+// Packets a batcher sent, per peer
+struct Wire {
+    FrameBatcher::Send sender() {
+        return [this](const FrameBatcher::PeerID& peer, std::vector<uint8_t>&& packet) {
+            packets[peer].push_back(std::move(packet));
+        };
+    }
+
+    std::map<std::string, std::vector<std::vector<uint8_t>>> packets;
+};
+
+struct Unpacked {
+    bool ok{false};
+    std::vector<std::vector<uint8_t>> frames;
+};
+
+// Every frame in a packet, re-encoded so it can be compared to what was sent
+Unpacked unpackAll(FrameBatcher& batcher, const std::vector<uint8_t>& packet) {
+    Unpacked out;
+    std::vector<uint8_t> scratch;
+    out.ok = batcher.unpack(packet, scratch, [&](const wire::Frame& f) {
+        out.frames.push_back(frame(f.type(), std::vector<uint8_t>(f.payload.begin(), f.payload.end())));
+    });
+    return out;
+}
+
+std::vector<uint8_t> join(const std::vector<std::vector<uint8_t>>& frames) {
+    std::vector<uint8_t> out;
+    for (const auto& f : frames) out.insert(out.end(), f.begin(), f.end());
+    return out;
+}
+
+} // namespace
+
+TEST(FrameBatcherTest, HoldsFramesForLingerUpToMaxDelay) {
+    FrameBatcher::Config config;
+    config.linger = 20ms;
+    config.max_delay = 50ms;
+    Wire wire;
+    FrameBatcher batcher(config, wire.sender());
+    EXPECT_EQ(batcher.nextDeadline(), Clock::time_point::max());
+
+    std::vector<std::vector<uint8_t>> sent{frame(wire::types::GOSSIP, {1, 2, 3})};
+    batcher.enqueue("a", sent.back());
+    const auto first_sent = Clock::now();
+    const auto first_deadline = batcher.nextDeadline();
+    EXPECT_LE(first_deadline, first_sent + 20ms);
+    EXPECT_EQ(batcher.poll(first_deadline - 1us), 0u);
+
+    // Each frame pushes the deadline out, but never past max_delay
+    std::this_thread::sleep_for(5ms);
+    sent.push_back(frame(wire::types::GOSSIP, {4}));
+    batcher.enqueue("a", sent.back());
+    EXPECT_GT(batcher.nextDeadline(), first_deadline);
+    while (Clock::now() < first_sent + 60ms) {
+        std::this_thread::sleep_for(5ms);
+        sent.push_back(frame(wire::types::GOSSIP, {5}));
+        batcher.enqueue("a", sent.back());
+    }
+    EXPECT_LE(batcher.nextDeadline(), first_sent + 50ms);
+
+    EXPECT_EQ(batcher.poll(), 1u);
+    ASSERT_EQ(wire.packets["a"].size(), 1u);
+    // Small batches go out as the frames back to back
+    EXPECT_EQ(wire.packets["a"][0], join(sent));
+    EXPECT_EQ(batcher.nextDeadline(), Clock::time_point::max());
+
+    const auto stats = batcher.stats();
+    EXPECT_EQ(stats.frames_queued, sent.size());
+    EXPECT_EQ(stats.packets_sent, 1u);
+    EXPECT_EQ(stats.bytes_in, stats.bytes_out);
+
+    config.max_delay = 10ms;
+    EXPECT_THROW(FrameBatcher(config, wire.sender()), std::invalid_argument);
+}
+
+TEST(FrameBatcherTest, FullBatchesLeaveAtOnceAndPeersAreSeparate) {
+    FrameBatcher::Config config;
+    config.max_batch_bytes = 100;
+    config.linger = 1h;
+    config.max_delay = 1h;
+    Wire wire;
+    FrameBatcher batcher(config, wire.sender());
+
+    const auto a = frame(wire::types::GOSSIP, std::vector<uint8_t>(48, 1));
+    const auto b = frame(wire::types::GOSSIP, std::vector<uint8_t>(48, 2));
+    batcher.enqueue("a", a);
+    batcher.enqueue("b", b);
+    EXPECT_TRUE(wire.packets.empty());
+    batcher.enqueue("a", a);
+    ASSERT_EQ(wire.packets["a"].size(), 1u);
+    EXPECT_EQ(wire.packets["a"][0], join({a, a}));
+    EXPECT_TRUE(wire.packets["b"].empty());
+
+    batcher.flushAll();
+    ASSERT_EQ(wire.packets["b"].size(), 1u);
+    EXPECT_EQ(wire.packets["b"][0], b);
+}
+
+TEST(FrameBatcherTest, CompressesLargeGroupsAndUnpacksInOrder) {
+    Wire wire;
+    FrameBatcher sender(FrameBatcher::Config{}, wire.sender());
+    FrameBatcher receiver(FrameBatcher::Config{}, nullptr);
+
+    // Requests stay where they were; the votes, enough to compress, travel
+    // as one frame where the first of them was
+    std::vector<std::vector<uint8_t>> requests;
+    std::vector<std::vector<uint8_t>> votes;
+    for (uint32_t i = 0; i < 40; ++i) {
+        if (i % 10 == 0) {
+            requests.push_back(frame(wire::types::REQUEST, {static_cast<uint8_t>(i)}));
+            sender.enqueue("peer", requests.back());
+        }
+        votes.push_back(frame(wire::types::GOSSIP, vote(i)));
+        sender.enqueue("peer", votes.back());
+    }
+    sender.flushAll();
+    ASSERT_EQ(wire.packets["peer"].size(), 1u);
+    const auto& packet = wire.packets["peer"][0];
+    EXPECT_LT(packet.size(), (join(requests).size() + join(votes).size()) / 3);
+    EXPECT_EQ(sender.stats().batches_compressed, 1u);
+
+    std::vector<std::vector<uint8_t>> expected{requests[0]};
+    expected.insert(expected.end(), votes.begin(), votes.end());
+    expected.insert(expected.end(), requests.begin() + 1, requests.end());
+    const auto unpacked = unpackAll(receiver, packet);
+    EXPECT_TRUE(unpacked.ok);
+    EXPECT_EQ(unpacked.frames, expected);
+    EXPECT_EQ(receiver.stats().batches_unpacked, 1u);
+
+    // What does not shrink goes out as it was
+    const auto random = frame(wire::types::GOSSIP, noise(4000, 1));
+    sender.enqueue("peer", random);
+    sender.flushAll();
+    EXPECT_EQ(wire.packets["peer"].back(), random);
+    EXPECT_EQ(sender.stats().batches_compressed, 1u);
+}
+
+TEST(FrameBatcherTest, DictionariesMustBeKnownToTheReceiver) {
+    std::vector<std::vector<uint8_t>> samples;
+    for (uint32_t i = 0; i < 2000; ++i) samples.push_back(vote(i * 31));
+    const auto dictionary = FrameBatcher::trainDictionary(samples, 4096);
+    ASSERT_FALSE(dictionary.empty());
+    EXPECT_THROW(FrameBatcher::trainDictionary({}), std::invalid_argument);
+
+    Wire wire;
+    FrameBatcher sender(FrameBatcher::Config{}, wire.sender());
+    FrameBatcher plain(FrameBatcher::Config{}, wire.sender());
+    // Just past the threshold, where a dictionary pays off most
+    std::vector<std::vector<uint8_t>> votes;
+    for (uint32_t i = 0; i < 10; ++i) {
+        votes.push_back(frame(wire::types::GOSSIP, vote(i)));
+        sender.enqueue("with", votes.back());
+        plain.enqueue("without", votes.back());
+    }
+    sender.setDictionary(wire::types::GOSSIP, dictionary);
+    sender.flushAll();
+    plain.flushAll();
+    const auto& with = wire.packets["with"].at(0);
+    EXPECT_EQ(sender.stats().batches_compressed, 1u);
+    EXPECT_LT(with.size(), wire.packets["without"].at(0).size());
+
+    FrameBatcher stranger(FrameBatcher::Config{}, nullptr);
+    EXPECT_FALSE(unpackAll(stranger, with).ok);
+    EXPECT_EQ(stranger.stats().unpack_errors, 1u);
+
+    // A receiver keeps every dictionary it was given, so frames made before
+    // a switch still decode
+    FrameBatcher receiver(FrameBatcher::Config{}, nullptr);
+    receiver.setDictionary(wire::types::GOSSIP, dictionary);
+    receiver.setDictionary(wire::types::GOSSIP, FrameBatcher::trainDictionary(samples, 2048));
+    const auto unpacked = unpackAll(receiver, with);
+    EXPECT_TRUE(unpacked.ok);
+    EXPECT_EQ(unpacked.frames, votes);
+}
+
+TEST(FrameBatcherTest, RejectsMalformedAndOversizedBatches) {
+    Wire wire;
+    FrameBatcher sender(FrameBatcher::Config{}, wire.sender());
+    std::vector<std::vector<uint8_t>> votes;
+    for (uint32_t i = 0; i < 30; ++i) {
+        votes.push_back(frame(wire::types::GOSSIP, vote(i)));
+        sender.enqueue("peer", votes.back());
+    }
+    sender.flushAll();
+    const auto packet = wire.packets["peer"].at(0);
+
+    FrameBatcher::Config small;
+    small.max_unpacked_bytes = join(votes).size() - 1;
+    FrameBatcher strict(small, nullptr);
+    EXPECT_FALSE(unpackAll(strict, packet).ok);
+
+    FrameBatcher receiver(FrameBatcher::Config{}, nullptr);
+    auto corrupted = packet;
+    corrupted.back() ^= 1;
+    EXPECT_FALSE(unpackAll(receiver, corrupted).ok);
+    auto truncated = packet;
+    truncated.pop_back();
+    EXPECT_FALSE(unpackAll(receiver, truncated).ok);
+
+    // Batches do not nest, and a bad inner frame delivers nothing
+    std::vector<uint8_t> nested;
+    wire::appendFrame(nested, wire::types::GOSSIP, wire::BATCH, packet);
+    auto bad_inner = join({votes[0], votes[1]});
+    bad_inner.back() ^= 1;
+    std::vector<uint8_t> broken;
+    wire::appendFrame(broken, wire::types::GOSSIP, wire::BATCH, bad_inner);
+    EXPECT_FALSE(unpackAll(receiver, nested).ok);
+    const auto unpacked = unpackAll(receiver, broken);
+    EXPECT_FALSE(unpacked.ok);
+    EXPECT_TRUE(unpacked.frames.empty());
+    EXPECT_EQ(receiver.stats().unpack_errors, 4u);
+
+    // An uncompressed batch is just frames inside a frame
+    std::vector<uint8_t> batch;
+    wire::appendFrame(batch, wire::types::GOSSIP, wire::BATCH, join({votes[0], votes[1]}));
+    const auto plain = unpackAll(receiver, batch);
+    EXPECT_TRUE(plain.ok);
+    EXPECT_EQ(plain.frames, (std::vector<std::vector<uint8_t>>{votes[0], votes[1]}));
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
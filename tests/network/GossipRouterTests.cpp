@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+#include "network/GossipRouter.hpp"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+// First byte of every router frame
+constexpr uint8_t PUBLISH_FRAME = 1;
+constexpr uint8_t IHAVE_FRAME = 2;
+constexpr uint8_t IWANT_FRAME = 3;
+
+// Routers wired to each other through an in-memory queue
+class GossipNet {
+public:
+    GossipNet(size_t nodes, GossipRouter::Config config) {
+        config.seen_filter_bits = 1u << 16;
+        delivered_.resize(nodes);
+        for (size_t i = 0; i < nodes; ++i) {
+            config.seed = i + 1;
+            routers_.push_back(std::make_unique<GossipRouter>(
+                config, [this, i](const GossipRouter::PeerID& peer, std::vector<uint8_t>&& frame) {
+                    queue_.push_back({i, index(peer), std::move(frame)});
+                }));
+        }
+    }
+
+    static std::string name(size_t i) { return "node-" + std::to_string(i); }
+
+    void subscribeAll(const std::string& topic) {
+        for (size_t i = 0; i < routers_.size(); ++i) {
+            routers_[i]->subscribe(topic, [this, i](const std::string&, std::span<const uint8_t> payload,
+                                                    const GossipRouter::PeerID&) {
+                ++delivered_[i][std::vector<uint8_t>(payload.begin(), payload.end())];
+            });
+        }
+    }
+
+    void connectAll() {
+        for (size_t i = 0; i < routers_.size(); ++i) {
+            for (size_t j = 0; j < routers_.size(); ++j) {
+                if (i != j) routers_[i]->addPeer(name(j));
+            }
+        }
+        pump();
+    }
+
+    // Delivers queued frames, and whatever they cause, until it is quiet
+    void pump() {
+        while (!queue_.empty()) {
+            auto frame = std::move(queue_.front());
+            queue_.pop_front();
+            // Only message bodies are counted or dropped
+            const bool body = !frame.bytes.empty() && frame.bytes[0] == PUBLISH_FRAME;
+            if (body && drop && drop(frame.to)) {
+                continue;
+            }
+            bodies_sent_ += body;
+            routers_[frame.to]->handleFrame(name(frame.from), frame.bytes);
+        }
+    }
+
+    void heartbeat() {
+        for (auto& router : routers_) router->heartbeat();
+        pump();
+    }
+
+    void flushAnnouncements() {
+        for (auto& router : routers_) router->flushAnnouncements();
+        pump();
+    }
+
+    GossipRouter& operator[](size_t i) { return *routers_[i]; }
+    size_t size() const { return routers_.size(); }
+    size_t deliveries(size_t node, const std::vector<uint8_t>& payload) {
+        return delivered_[node][payload];
+    }
+    size_t bodiesSent() const { return bodies_sent_; }
+
+    // Publish frames to a node for which this returns true are lost
+    std::function<bool(size_t to)> drop;
+
+private:
+    struct Queued {
+        size_t from;
+        size_t to;
+        std::vector<uint8_t> bytes;
+    };
+
+    static size_t index(const GossipRouter::PeerID& peer) {
+        return std::stoul(peer.substr(peer.find('-') + 1));
+    }
+
+    std::vector<std::unique_ptr<GossipRouter>> routers_;
+    std::deque<Queued> queue_;
+    std::vector<std::map<std::vector<uint8_t>, size_t>> delivered_;
+    size_t bodies_sent_{0};
+};
+
+std::vector<uint8_t> message(uint8_t n) {
+    return std::vector<uint8_t>(40, n);
+}
+
+// kind, topic length and topic, id count, then the ids
+std::vector<uint8_t> ihave(const std::string& topic, const std::vector<GossipRouter::MessageId>& ids) {
+    std::vector<uint8_t> frame{IHAVE_FRAME, static_cast<uint8_t>(topic.size()), 0};
+    frame.insert(frame.end(), topic.begin(), topic.end());
+    frame.push_back(static_cast<uint8_t>(ids.size()));
+    frame.push_back(0);
+    for (const auto& id : ids) {
+        frame.insert(frame.end(), id.begin(), id.end());
+    }
+    return frame;
+}
+
+} // namespace
+
+TEST(GossipRouterTest, DeliversEachMessageOnceOverTheMesh) {
+    GossipRouter::Config config;
+    GossipNet net(20, config);
+    net.subscribeAll("blocks");
+    net.connectAll();
+    for (int i = 0; i < 3; ++i) net.heartbeat();
+
+    for (size_t i = 0; i < net.size(); ++i) {
+        const auto mesh = net[i].meshPeers("blocks");
+        EXPECT_GE(mesh.size(), config.degree_low) << i;
+        EXPECT_LE(mesh.size(), config.degree_high) << i;
+    }
+
+    constexpr uint8_t MESSAGES = 10;
+    for (uint8_t m = 0; m < MESSAGES; ++m) {
+        ASSERT_TRUE(net[m % net.size()].publish("blocks", message(m)));
+        net.pump();
+    }
+    for (uint8_t m = 0; m < MESSAGES; ++m) {
+        for (size_t i = 0; i < net.size(); ++i) {
+            // Publishers do not hand their own messages to themselves
+            EXPECT_EQ(net.deliveries(i, message(m)), i == m % net.size() ? 0u : 1u) << int(m) << " at " << i;
+        }
+    }
+
+    // Pushed along mesh links, not flooded to every peer
+    EXPECT_LE(net.bodiesSent(), MESSAGES * net.size() * config.degree_high);
+    EXPECT_LT(net.bodiesSent(), MESSAGES * net.size() * (net.size() - 1) / 2);
+    uint64_t duplicates = 0;
+    for (size_t i = 0; i < net.size(); ++i) duplicates += net[i].stats().duplicates;
+    EXPECT_EQ(duplicates, net.bodiesSent() - MESSAGES * (net.size() - 1));
+
+    // The same payload is not published twice
+    EXPECT_FALSE(net[3].publish("blocks", message(0)));
+    EXPECT_TRUE(net[3].publish("other", message(0)));
+}
+
+TEST(GossipRouterTest, RecoversLostPushesThroughIHave) {
+    GossipNet net(16, GossipRouter::Config{});
+    net.subscribeAll("blocks");
+    net.connectAll();
+    for (int i = 0; i < 3; ++i) net.heartbeat();
+
+    constexpr size_t VICTIM = 5;
+    net.drop = [](size_t to) { return to == VICTIM; };
+    ASSERT_TRUE(net[0].publish("blocks", message(7)));
+    net.pump();
+    EXPECT_EQ(net.deliveries(VICTIM, message(7)), 0u);
+    EXPECT_EQ(net.deliveries(6, message(7)), 1u);
+
+    // Once the link recovers, gossip about the lost message fills the gap
+    net.drop = nullptr;
+    for (int i = 0; i < 3 && net.deliveries(VICTIM, message(7)) == 0; ++i) {
+        net.heartbeat();
+    }
+    EXPECT_EQ(net.deliveries(VICTIM, message(7)), 1u);
+    EXPECT_GT(net[VICTIM].stats().iwant_sent, 0u);
+}
+
+TEST(GossipRouterTest, CountsMalformedFrames) {
+    GossipNet net(2, GossipRouter::Config{});
+    net.subscribeAll("blocks");
+    net.connectAll();
+
+    const std::vector<std::vector<uint8_t>> frames{
+        {},
+        {PUBLISH_FRAME},
+        // Topic length past the end
+        {PUBLISH_FRAME, 10, 0, 'b'},
+        // Payload length past the end
+        {PUBLISH_FRAME, 1, 0, 'b', 5, 0, 0, 0, 1},
+    };
+    for (const auto& frame : frames) {
+        net[1].handleFrame(GossipNet::name(0), frame);
+    }
+    EXPECT_EQ(net[1].stats().malformed, frames.size());
+    EXPECT_EQ(net[1].stats().delivered, 0u);
+
+    // The id is the hash of topic and payload, whoever sends it
+    EXPECT_EQ(GossipRouter::messageId("blocks", message(1)), GossipRouter::messageId("blocks", message(1)));
+    EXPECT_NE(GossipRouter::messageId("blocks", message(1)), GossipRouter::messageId("txs", message(1)));
+}
+
+TEST(GossipRouterPullTest, AnnounceTopicsPullEachBodyOnce) {
+    GossipRouter::Config config;
+    config.announce_topics = {"txs"};
+    GossipNet net(12, config);
+    net.subscribeAll("txs");
+    net.connectAll();
+    for (int i = 0; i < 3; ++i) net.heartbeat();
+
+    ASSERT_TRUE(net[0].publish("txs", message(1)));
+    net.pump();
+    // Only ids move until announcements are flushed
+    EXPECT_EQ(net.bodiesSent(), 0u);
+    for (int i = 0; i < 6; ++i) net.flushAnnouncements();
+
+    for (size_t i = 1; i < net.size(); ++i) {
+        EXPECT_EQ(net.deliveries(i, message(1)), 1u) << i;
+    }
+    EXPECT_EQ(net.bodiesSent(), net.size() - 1);
+}
+
+TEST(GossipRouterPullTest, RemovedPeersAreNotAskedAgain) {
+    GossipRouter::Config config;
+    config.announce_topics = {"txs"};
+    std::vector<std::pair<GossipRouter::PeerID, uint8_t>> sent;
+    GossipRouter router(config, [&](const GossipRouter::PeerID& peer, std::vector<uint8_t>&& frame) {
+        sent.emplace_back(peer, frame.at(0));
+    });
+    router.subscribe("txs", [](const std::string&, std::span<const uint8_t>, const GossipRouter::PeerID&) {});
+    for (const auto* peer : {"a", "b", "c", "d"}) {
+        router.addPeer(peer);
+    }
+    auto iwants = [&] {
+        std::vector<GossipRouter::PeerID> to;
+        for (const auto& [peer, kind] : sent) {
+            if (kind == IWANT_FRAME) to.push_back(peer);
+        }
+        sent.clear();
+        return to;
+    };
+
+    // a is asked first; b, c and d wait their turn
+    const auto first = ihave("txs", {GossipRouter::messageId("txs", message(1))});
+    for (const auto* peer : {"a", "b", "c", "d"}) {
+        router.handleFrame(peer, first);
+    }
+    EXPECT_EQ(iwants(), std::vector<GossipRouter::PeerID>{"a"});
+
+    // Losing a moves the pull on without waiting out the timeout, and
+    // skips b, which left too
+    router.removePeer("b");
+    router.removePeer("a");
+    router.flushAnnouncements();
+    EXPECT_EQ(iwants(), std::vector<GossipRouter::PeerID>{"c"});
+
+    // Once every announcer is gone the pull is dropped, so a fresh IHAVE
+    // asks straight away
+    router.removePeer("c");
+    router.removePeer("d");
+    router.flushAnnouncements();
+    EXPECT_TRUE(iwants().empty());
+    router.addPeer("e");
+    sent.clear();
+    router.handleFrame("e", first);
+    EXPECT_EQ(iwants(), std::vector<GossipRouter::PeerID>{"e"});
+    EXPECT_EQ(router.stats().pull_retries, 1u);
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+#include "network/IceAgent.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = IceAgent::Clock;
+using Type = IceCandidate::Type;
+
+IceAgent::Config fastConfig() {
+    IceAgent::Config config;
+    config.gather_timeout = 200ms;
+    config.check_timeout = 2s;
+    config.check_pacing = 5ms;
+    return config;
+}
+
+IceAgent::Gatherer after(std::chrono::milliseconds delay, std::vector<IceCandidate> candidates) {
+    return [delay, candidates] {
+        std::this_thread::sleep_for(delay);
+        return candidates;
+    };
+}
+
+// Checks run on detached threads, so what they touch is shared
+struct CheckLog {
+    std::atomic<int> started{0};
+    std::atomic<int> cancelled{0};
+};
+
+// Succeeds only towards `port`, after `delay`; the rest wait to be told
+// to stop
+IceAgent::Check succeedOn(uint16_t port, std::chrono::milliseconds delay, std::shared_ptr<CheckLog> log) {
+    return [port, delay, log](const IceCandidatePair& pair, const std::atomic<bool>& cancelled,
+                              Clock::time_point deadline) {
+        ++log->started;
+        if (pair.remote.port == port) {
+            std::this_thread::sleep_for(delay);
+            return true;
+        }
+        while (!cancelled && Clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        if (cancelled) {
+            ++log->cancelled;
+        }
+        return false;
+    };
+}
+
+bool eventually(const std::function<bool()>& done) {
+    const auto until = Clock::now() + 2s;
+    while (!done() && Clock::now() < until) {
+        std::this_thread::sleep_for(1ms);
+    }
+    return done();
+}
+
+} // namespace
+
+TEST(IceAgentTest, RanksCandidatesAndPairsAsRfc8445) {
+    const auto host = IceCandidate::make(Type::Host, "10.0.0.2", 9000);
+    const auto mapped = IceCandidate::make(Type::PortMapped, "203.0.113.5", 9000);
+    const auto reflexive = IceCandidate::make(Type::ServerReflexive, "203.0.113.5", 41000);
+    const auto relayed = IceCandidate::make(Type::Relayed, "198.51.100.1", 3478);
+    EXPECT_EQ(host.priority, (126u << 24) | (65535u << 8) | 255u);
+    EXPECT_GT(host.priority, mapped.priority);
+    EXPECT_GT(mapped.priority, reflexive.priority);
+    EXPECT_GT(reflexive.priority, relayed.priority);
+    EXPECT_LT(IceCandidate::compute_priority(Type::Host, 1), host.priority);
+
+    // Symmetric but for the tie-break bit of the controlling side
+    const auto a = IceCandidatePair::compute_priority(host, reflexive);
+    const auto b = IceCandidatePair::compute_priority(reflexive, host);
+    EXPECT_EQ(a, (uint64_t{reflexive.priority} << 32) + 2 * uint64_t{host.priority} + 1);
+    EXPECT_EQ(a, b + 1);
+
+    const auto pairs = IceAgent::pair({reflexive, host}, {relayed, host});
+    ASSERT_EQ(pairs.size(), 4u);
+    for (size_t i = 1; i < pairs.size(); ++i) {
+        EXPECT_GE(pairs[i - 1].priority, pairs[i].priority);
+    }
+    EXPECT_EQ(pairs.front().local.type, Type::Host);
+    EXPECT_EQ(pairs.front().remote.type, Type::Host);
+    EXPECT_EQ(pairs.back().remote.type, Type::Relayed);
+
+    // The checklist is capped
+    std::vector<IceCandidate> many;
+    for (uint16_t port = 0; port < 20; ++port) {
+        many.push_back(IceCandidate::make(Type::Host, "10.0.0.2", port, port));
+    }
+    EXPECT_EQ(IceAgent::pair(many, many).size(), 100u);
+}
+
+TEST(IceAgentTest, GathersConcurrentlyUntilTheDeadline) {
+    IceAgent agent(fastConfig());
+    agent.add_gatherer("host", after(50ms, {IceCandidate::make(Type::Host, "10.0.0.2", 9000)}));
+    agent.add_gatherer("stun", after(50ms, {IceCandidate::make(Type::ServerReflexive, "203.0.113.5", 9000)}));
+    agent.add_gatherer("upnp", after(50ms, {IceCandidate::make(Type::PortMapped, "203.0.113.5", 9000),
+                                            IceCandidate::make(Type::PortMapped, "203.0.113.5", 9001)}));
+    agent.add_gatherer("broken", [] () -> std::vector<IceCandidate> { throw std::runtime_error("no gateway"); });
+    agent.add_gatherer("slow", after(1s, {IceCandidate::make(Type::Relayed, "198.51.100.1", 3478)}));
+
+    const auto start = Clock::now();
+    const auto candidates = agent.gather();
+    const auto took = Clock::now() - start;
+    // Sources run side by side and the slow one costs only the deadline
+    EXPECT_GE(took, 200ms);
+    EXPECT_LT(took, 800ms);
+
+    // The mapping beats the STUN answer for the same address and port
+    ASSERT_EQ(candidates.size(), 3u);
+    EXPECT_EQ(candidates[0].type, Type::Host);
+    EXPECT_EQ(candidates[1].type, Type::PortMapped);
+    EXPECT_EQ(candidates[1].port, 9000);
+    EXPECT_EQ(candidates[2].port, 9001);
+
+    // Nothing to wait for once every source answered
+    IceAgent quick(fastConfig());
+    quick.add_gatherer("host", after(0ms, {IceCandidate::make(Type::Host, "10.0.0.2", 9000)}));
+    const auto begin = Clock::now();
+    EXPECT_EQ(quick.gather().size(), 1u);
+    EXPECT_LT(Clock::now() - begin, 150ms);
+}
+
+TEST(IceAgentTest, TheFirstSuccessfulCheckWinsAndStopsTheRest) {
+    IceAgent agent(fastConfig());
+    const auto local = IceCandidate::make(Type::Host, "10.0.0.2", 9000);
+    std::vector<IceCandidate> remote;
+    for (uint16_t port = 1; port <= 4; ++port) {
+        remote.push_back(IceCandidate::make(Type::Host, "10.0.0.3", port, 100 - port));
+    }
+    auto log = std::make_shared<CheckLog>();
+    const auto winner = agent.race(IceAgent::pair({local}, remote), succeedOn(3, 30ms, log));
+    ASSERT_TRUE(winner);
+    EXPECT_EQ(winner->remote.port, 3);
+    EXPECT_TRUE(eventually([&] { return log->cancelled == log->started - 1; }));
+    EXPECT_EQ(log->started, 4);
+
+    // Nothing succeeds: every check runs until the deadline
+    auto config = fastConfig();
+    config.check_timeout = 100ms;
+    IceAgent impatient(config);
+    auto none = std::make_shared<CheckLog>();
+    const auto start = Clock::now();
+    EXPECT_FALSE(impatient.race(IceAgent::pair({local}, remote), succeedOn(0, 0ms, none)));
+    EXPECT_GE(Clock::now() - start, 100ms);
+    EXPECT_FALSE(impatient.race({}, succeedOn(0, 0ms, none)));
+}
+
+TEST(IceAgentTest, CachesTheWinningPairPerPeer) {
+    IceAgent agent(fastConfig());
+    auto gathers = std::make_shared<std::atomic<int>>(0);
+    agent.add_gatherer("host", [gathers] {
+        ++*gathers;
+        return std::vector<IceCandidate>{IceCandidate::make(Type::Host, "10.0.0.2", 9000)};
+    });
+    const std::vector<IceCandidate> remote{IceCandidate::make(Type::Host, "10.0.0.3", 1),
+                                           IceCandidate::make(Type::ServerReflexive, "203.0.113.7", 2)};
+
+    auto log = std::make_shared<CheckLog>();
+    const auto first = agent.connect("peer", remote, succeedOn(2, 0ms, log));
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first->remote.port, 2);
+    EXPECT_EQ(agent.cached("peer")->remote.port, 2);
+    EXPECT_FALSE(agent.cached("other"));
+
+    // No gathering or checks for a cached peer
+    const auto second = agent.connect("peer", remote, succeedOn(1, 0ms, log));
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second->remote.port, 2);
+    EXPECT_EQ(*gathers, 1);
+
+    agent.forget("peer");
+    const auto third = agent.connect("peer", remote, succeedOn(1, 0ms, log));
+    ASSERT_TRUE(third);
+    EXPECT_EQ(third->remote.port, 1);
+    EXPECT_EQ(*gathers, 2);
+
+    // A failed connect leaves nothing behind
+    auto config = fastConfig();
+    config.check_timeout = 50ms;
+    IceAgent failing(config);
+    failing.add_gatherer("host", after(0ms, {IceCandidate::make(Type::Host, "10.0.0.2", 9000)}));
+    EXPECT_FALSE(failing.connect("peer", remote, succeedOn(0, 0ms, log)));
+    EXPECT_FALSE(failing.cached("peer"));
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
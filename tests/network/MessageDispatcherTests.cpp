@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include "network/MessageDispatcher.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using namespace std::chrono_literals;
+using Priority = MessageDispatcher::Priority;
+
+std::vector<uint8_t> payload(uint32_t n) {
+    return {static_cast<uint8_t>(n), static_cast<uint8_t>(n >> 8), static_cast<uint8_t>(n >> 16)};
+}
+
+uint32_t number(const std::vector<uint8_t>& bytes) {
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+}
+
+bool eventually(const std::function<bool()>& done) {
+    const auto until = std::chrono::steady_clock::now() + 5s;
+    while (!done() && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(1ms);
+    }
+    return done();
+}
+
+} // namespace
+
+TEST(MessageDispatcherTest, HandlesEachTopicInArrivalOrder) {
+    MessageDispatcher::Config config;
+    config.workers = {1, 1, 3, 1};
+    config.drain_batch = 4;
+    config.queue_capacity = 10000;
+    MessageDispatcher dispatcher(config);
+
+    // Several topics share the transaction workers; each stays in order
+    constexpr uint32_t TOPICS = 4;
+    constexpr uint32_t PER_TOPIC = 2000;
+    std::mutex mutex;
+    std::vector<std::vector<uint32_t>> seen(TOPICS);
+    std::vector<MessageDispatcher::TopicId> ids;
+    for (uint32_t t = 0; t < TOPICS; ++t) {
+        ids.push_back(dispatcher.intern("tx/" + std::to_string(t)));
+        dispatcher.setHandler(ids.back(), Priority::Transactions,
+                              [&, t](const std::vector<uint8_t>& bytes, const std::string& from) {
+                                  EXPECT_EQ(from, "peer");
+                                  std::lock_guard<std::mutex> lock(mutex);
+                                  seen[t].push_back(number(bytes));
+                              });
+    }
+    dispatcher.start();
+    for (uint32_t n = 0; n < PER_TOPIC; ++n) {
+        for (uint32_t t = 0; t < TOPICS; ++t) {
+            ASSERT_TRUE(dispatcher.dispatch(ids[t], payload(n), "peer"));
+        }
+    }
+    ASSERT_TRUE(eventually([&] { return dispatcher.stats(Priority::Transactions).handled == TOPICS * PER_TOPIC; }));
+    dispatcher.stop();
+
+    for (uint32_t t = 0; t < TOPICS; ++t) {
+        ASSERT_EQ(seen[t].size(), PER_TOPIC);
+        for (uint32_t n = 0; n < PER_TOPIC; ++n) {
+            ASSERT_EQ(seen[t][n], n) << "topic " << t;
+        }
+    }
+    const auto stats = dispatcher.stats(Priority::Transactions);
+    EXPECT_EQ(stats.queued, TOPICS * PER_TOPIC);
+    EXPECT_EQ(stats.dropped, 0u);
+    EXPECT_EQ(dispatcher.stats(Priority::Consensus).handled, 0u);
+}
+
+TEST(MessageDispatcherTest, ABackedUpClassDoesNotDelayConsensus) {
+    MessageDispatcher::Config config;
+    config.workers = {1, 1, 1, 1};
+    MessageDispatcher dispatcher(config);
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    const auto tx = dispatcher.intern("transactions");
+    dispatcher.setHandler(tx, Priority::Transactions, [gate](const auto&, const auto&) { gate.wait(); });
+    std::promise<void> voted;
+    const auto consensus = dispatcher.intern("consensus");
+    dispatcher.setHandler(consensus, Priority::Consensus, [&](const auto&, const auto&) { voted.set_value(); });
+
+    dispatcher.start();
+    for (uint32_t n = 0; n < 100; ++n) {
+        dispatcher.dispatch(tx, payload(n), "spammer");
+    }
+    ASSERT_TRUE(dispatcher.dispatch(consensus, payload(0), "validator"));
+    EXPECT_EQ(voted.get_future().wait_for(2s), std::future_status::ready);
+    EXPECT_EQ(dispatcher.stats(Priority::Transactions).handled, 0u);
+
+    release.set_value();
+    EXPECT_TRUE(eventually([&] { return dispatcher.stats(Priority::Transactions).handled == 100; }));
+}
+
+TEST(MessageDispatcherTest, DropsWhatDoesNotFitOrHasNowhereToGo) {
+    MessageDispatcher::Config config;
+    config.workers = {1, 1, 1, 1};
+    config.queue_capacity = 2;
+    MessageDispatcher dispatcher(config);
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    std::atomic<int> entered{0};
+    const auto blocks = dispatcher.intern("blocks");
+    dispatcher.setHandler(blocks, Priority::Blocks, [&, gate](const auto&, const auto&) {
+        ++entered;
+        gate.wait();
+    });
+    const auto orphan = dispatcher.intern("orphan");
+
+    // Nothing is queued while stopped
+    EXPECT_FALSE(dispatcher.dispatch(blocks, payload(0), "peer"));
+    EXPECT_EQ(dispatcher.stats(Priority::Blocks).dropped, 1u);
+
+    dispatcher.start();
+    ASSERT_TRUE(dispatcher.dispatch(blocks, payload(1), "peer"));
+    ASSERT_TRUE(eventually([&] { return entered == 1; }));
+    // The handler holds one; two more fit behind it
+    EXPECT_TRUE(dispatcher.dispatch(blocks, payload(2), "peer"));
+    EXPECT_TRUE(dispatcher.dispatch(blocks, payload(3), "peer"));
+    EXPECT_FALSE(dispatcher.dispatch(blocks, payload(4), "peer"));
+    EXPECT_EQ(dispatcher.stats(Priority::Blocks).dropped, 2u);
+
+    // A topic without a handler counts against the default class
+    EXPECT_FALSE(dispatcher.dispatch(orphan, payload(5), "peer"));
+    EXPECT_EQ(dispatcher.stats(Priority::Transactions).unrouted, 1u);
+
+    release.set_value();
+    EXPECT_TRUE(eventually([&] { return dispatcher.stats(Priority::Blocks).handled == 3; }));
+    dispatcher.stop();
+    EXPECT_FALSE(dispatcher.dispatch(blocks, payload(6), "peer"));
+
+    // and it starts again
+    dispatcher.start();
+    EXPECT_TRUE(dispatcher.dispatch(blocks, payload(7), "peer"));
+    EXPECT_TRUE(eventually([&] { return dispatcher.stats(Priority::Blocks).handled == 4; }));
+    const auto stats = dispatcher.stats(Priority::Blocks);
+    EXPECT_EQ(stats.queued, 4u);
+    EXPECT_EQ(stats.dropped, 3u);
+}
+
+TEST(MessageDispatcherTest, InternsTopicsAndMovesThemBetweenClasses) {
+    MessageDispatcher::Config config;
+    config.workers = {1, 1, 1, 1};
+    MessageDispatcher dispatcher(config);
+    const auto a = dispatcher.intern("a");
+    const auto b = dispatcher.intern("b");
+    EXPECT_EQ(a, 0u);
+    EXPECT_EQ(b, 1u);
+    EXPECT_EQ(dispatcher.intern("a"), a);
+    EXPECT_EQ(dispatcher.find("b"), b);
+    EXPECT_FALSE(dispatcher.find("c"));
+    EXPECT_THROW(dispatcher.setHandler(7, Priority::Dht, [](const auto&, const auto&) {}), std::out_of_range);
+    EXPECT_THROW(dispatcher.dispatch(7, payload(0), "peer"), std::out_of_range);
+
+    // A throwing handler does not take its worker down
+    std::atomic<int> calls{0};
+    dispatcher.setHandler(a, Priority::Dht, [&](const auto&, const auto&) {
+        if (calls++ == 0) {
+            throw std::runtime_error("bad chunk");
+        }
+    });
+    dispatcher.start();
+    dispatcher.dispatch(a, payload(0), "peer");
+    dispatcher.dispatch(a, payload(1), "peer");
+    ASSERT_TRUE(eventually([&] { return dispatcher.stats(Priority::Dht).handled == 2; }));
+
+    dispatcher.setHandler(a, Priority::Consensus, [&](const auto&, const auto&) { ++calls; });
+    dispatcher.dispatch(a, payload(2), "peer");
+    ASSERT_TRUE(eventually([&] { return dispatcher.stats(Priority::Consensus).handled == 1; }));
+    EXPECT_EQ(calls, 3);
+    EXPECT_EQ(dispatcher.stats(Priority::Dht).handled, 2u);
+
+    config.workers[2] = 0;
+    EXPECT_THROW(MessageDispatcher{config}, std::invalid_argument);
+    config.workers[2] = 1;
+    config.drain_batch = 0;
+    EXPECT_THROW(MessageDispatcher{config}, std::invalid_argument);
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include "network/OptimizedNetworkLayer.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+// Hands the layer a burst of received frames on every poll and keeps
+// what it sends
+class FloodingTransport : public MessageTransport {
+public:
+    explicit FloodingTransport(size_t burst) : burst_(burst) {}
+
+    void start() override {}
+    void stop() override {}
+    size_t getActiveConnections() const override { return 0; }
+    void sendMessage(Message&& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sent_.push_back(std::move(msg));
+    }
+    std::vector<Message> receiveMessages() override {
+        std::vector<Message> burst(burst_);
+        for (auto& msg : burst) {
+            msg.sender = "flooder";
+            const std::string body = "gossip-" + std::to_string(received_++);
+            wire::appendFrame(msg.data, wire::types::GOSSIP, 0,
+                              std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(body.data()), body.size()));
+        }
+        return burst;
+    }
+    void setMaxStreamBitrate(size_t) override {}
+    void setPeerWeights(const std::vector<std::pair<NodeID, double>>&) override {}
+    void setDisconnectionHandler(std::function<void(const NodeID&)>) override {}
+
+    size_t received() const { return received_.load(); }
+    std::vector<Message> sent() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sent_;
+    }
+
+private:
+    const size_t burst_;
+    std::atomic<size_t> received_{0};
+    mutable std::mutex mutex_;
+    std::vector<Message> sent_;
+};
+
+NetworkConfig layerConfig(size_t bufferSize) {
+    NetworkConfig config{};
+    config.bufferSize = bufferSize;
+    config.useQuantumEncryption = false;
+    config.numWorkerThreads = 1;
+    // Gossip leaves as soon as it is queued
+    config.batching.max_batch_bytes = 1;
+    return config;
+}
+
+Message frame(uint8_t type, const std::string& body) {
+    Message msg;
+    wire::appendFrame(msg.data, type, 0,
+                      std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(body.data()), body.size()));
+    return msg;
+}
+
+template <typename Pred>
+bool eventually(Pred pred) {
+    for (int i = 0; i < 2000; ++i) {
+        if (pred()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return pred();
+}
+
+} // namespace
+
+TEST(OptimizedNetworkLayerTest, FullIncomingRingDropsInsteadOfStallingSends) {
+    constexpr size_t RING = 16;
+    auto transport = std::make_unique<FloodingTransport>(8);
+    const FloodingTransport& link = *transport;
+    OptimizedNetworkLayer network(layerConfig(RING), std::move(transport));
+    std::atomic<size_t> dispatched{0};
+    network.registerMessageHandler(wire::types::GOSSIP, [&](const NodeID& from, const wire::Frame&) {
+        EXPECT_EQ(from, "flooder");
+        dispatched.fetch_add(1);
+    });
+
+    // Nobody drains the incoming ring, so it fills within a few polls
+    network.start();
+    ASSERT_TRUE(eventually([&] { return link.received() > 4 * RING; }));
+
+    // Both send lanes still go out while the flood continues
+    network.sendConsensusMessage("validator", frame(wire::types::CONSENSUS_FRAME, "vote"));
+    network.sendMessage("peer", frame(wire::types::GOSSIP, "tx"));
+    ASSERT_TRUE(eventually([&] { return link.sent().size() == 2; }));
+    const auto sent = link.sent();
+    EXPECT_EQ(sent[0].target, "validator");
+    EXPECT_EQ(sent[1].target, "peer");
+
+    // What did not fit was counted, and what did is still delivered
+    network.stop();
+    EXPECT_GT(network.getMetrics().errorCount, 0u);
+    network.processIncomingMessages();
+    EXPECT_EQ(dispatched.load(), RING);
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "network/PeerScoreBook.hpp"
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = PeerScoreBook::Clock;
+
+std::map<std::string, double> weightsOf(const PeerScoreBook& book) {
+    std::map<std::string, double> out;
+    for (const auto& [peer, share] : book.bandwidthWeights()) out[peer] = share;
+    return out;
+}
+
+} // namespace
+
+TEST(PeerScoreBookTest, ScoresLatencyAndFirstDeliveries) {
+    PeerScoreBook book(PeerScoreBook::Config{});
+    const auto start = Clock::now();
+    book.decay(start);
+    book.addPeer("fast");
+    book.addPeer("echo");
+    EXPECT_EQ(book.score("fast"), 0.0);
+    EXPECT_EQ(book.score("unknown"), 0.0);
+
+    // An RTT equal to the reference is worth half the weight
+    book.recordRtt("fast", 100ms);
+    EXPECT_DOUBLE_EQ(book.score("fast"), 0.5);
+    for (int i = 0; i < 3; ++i) book.recordDelivery("fast", 1000, true);
+    book.recordDelivery("fast", 1000, false);
+    EXPECT_DOUBLE_EQ(book.score("fast"), 0.5 + 2.0 * 3 / (4 + 1));
+
+    // Duplicates earn nothing, however many bytes they carry
+    for (int i = 0; i < 50; ++i) book.recordDelivery("echo", 1 << 20, false);
+
+    // Throughput is measured per decay interval, from first deliveries only
+    book.decay(start + 1s);
+    const double throughput = 0.25 * 3000;
+    EXPECT_NEAR(book.score("fast"),
+                0.5 + throughput / (throughput + 64 * 1024) + 2.0 * (3 * 0.9) / (4 * 0.9 + 1), 1e-9);
+    EXPECT_EQ(book.score("echo"), 0.0);
+
+    // Smoothed, not replaced, by a new sample
+    book.recordRtt("echo", 100ms);
+    book.recordRtt("echo", 900ms);
+    EXPECT_DOUBLE_EQ(book.score("echo"), 100.0 / (100 + 200));
+}
+
+TEST(PeerScoreBookTest, InvalidMessagesCostQuadraticallyAndFade) {
+    PeerScoreBook book(PeerScoreBook::Config{});
+    book.addPeer("bad");
+    book.recordInvalid("bad");
+    EXPECT_DOUBLE_EQ(book.score("bad"), -10.0);
+    book.recordInvalid("bad");
+    book.recordInvalid("bad");
+    EXPECT_DOUBLE_EQ(book.score("bad"), -90.0);
+
+    auto now = Clock::now();
+    book.decay(now);
+    EXPECT_DOUBLE_EQ(book.score("bad"), -10.0 * 2.7 * 2.7);
+    // Old mistakes are forgiven entirely, not just made small
+    for (int i = 0; i < 60; ++i) book.decay(now += 1s);
+    EXPECT_EQ(book.score("bad"), 0.0);
+}
+
+TEST(PeerScoreBookTest, ReconnectingKeepsAPenaltyUntilRetentionEnds) {
+    PeerScoreBook::Config config;
+    config.retain_rounds = 3;
+    config.decay_factor = 0.99;
+    PeerScoreBook book(config);
+    auto now = Clock::now();
+
+    book.addPeer("bad");
+    book.recordInvalid("bad");
+    book.removePeer("bad");
+    book.decay(now += 1s);
+    book.decay(now += 1s);
+    book.addPeer("bad");
+    EXPECT_LT(book.score("bad"), -9.0);
+
+    book.removePeer("bad");
+    for (int i = 0; i < 4; ++i) book.decay(now += 1s);
+    book.addPeer("bad");
+    EXPECT_EQ(book.score("bad"), 0.0);
+}
+
+TEST(PeerScoreBookTest, EvictsTheWorstNonValidator) {
+    PeerScoreBook book(PeerScoreBook::Config{});
+    EXPECT_FALSE(book.evictionCandidate());
+
+    book.addPeer("validator", true);
+    book.recordInvalid("validator");
+    EXPECT_FALSE(book.evictionCandidate());
+
+    // Ties go to the smaller id
+    book.addPeer("b");
+    book.addPeer("a");
+    EXPECT_EQ(book.evictionCandidate(), "a");
+    book.recordRtt("a", 50ms);
+    EXPECT_EQ(book.evictionCandidate(), "b");
+    book.recordInvalid("a");
+    EXPECT_EQ(book.evictionCandidate(), "a");
+
+    // Disconnected peers are already gone
+    book.removePeer("a");
+    EXPECT_EQ(book.evictionCandidate(), "b");
+    book.setValidator("b", true);
+    EXPECT_FALSE(book.evictionCandidate());
+}
+
+TEST(PeerScoreBookTest, BandwidthFollowsScoreWithAFloor) {
+    PeerScoreBook book(PeerScoreBook::Config{});
+    book.addPeer("new");
+    book.addPeer("good");
+    book.addPeer("bad");
+    book.addPeer("validator", true);
+    book.addPeer("gone");
+    book.removePeer("gone");
+
+    book.recordRtt("good", 100ms);
+    book.recordInvalid("bad");
+    auto weights = weightsOf(book);
+    EXPECT_EQ(weights.size(), 4u);
+    EXPECT_DOUBLE_EQ(weights["new"], 1.0);
+    EXPECT_DOUBLE_EQ(weights["good"], 1.5);
+    // Misbehaving peers keep a trickle so they can earn their way back
+    EXPECT_DOUBLE_EQ(weights["bad"], 0.05);
+    // The validator bonus is replaced by a multiple of the share
+    EXPECT_DOUBLE_EQ(weights["validator"], 4.0);
+
+    PeerScoreBook::Config config;
+    config.decay_factor = 1.0;
+    EXPECT_THROW(PeerScoreBook{config}, std::invalid_argument);
+    config = PeerScoreBook::Config{};
+    config.min_share = 0.0;
+    EXPECT_THROW(PeerScoreBook{config}, std::invalid_argument);
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "network/QDHT.hpp"
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+// A node whose routing state is rotated by `angle` off |0>
+QNodeIdentity node(uint8_t tag, double angle) {
+    QNodeIdentity identity;
+    identity.id.fill(0);
+    identity.id[0] = tag;
+    identity.last_seen = std::chrono::steady_clock::now();
+    Eigen::VectorXcd state(2);
+    state << std::cos(angle), std::sin(angle);
+    identity.quantum_state = quantum::QuantumState(state);
+    return identity;
+}
+
+void expectSameMetrics(const QBucketMetrics& a, const QBucketMetrics& b) {
+    EXPECT_DOUBLE_EQ(a.entanglement_factor, b.entanglement_factor);
+    EXPECT_DOUBLE_EQ(a.quantum_entropy, b.quantum_entropy);
+    EXPECT_DOUBLE_EQ(a.coherence_level, b.coherence_level);
+    EXPECT_DOUBLE_EQ(a.routing_efficiency, b.routing_efficiency);
+    EXPECT_TRUE(a.quantum_state.getStateVector().isApprox(b.quantum_state.getStateVector(), 1e-12));
+}
+
+} // namespace
+
+TEST(QDHTBucketTest, MetricsFollowMembership) {
+    QDHTBucket bucket;
+    EXPECT_DOUBLE_EQ(bucket.get_metrics().routing_efficiency, 1.0);
+    EXPECT_DOUBLE_EQ(bucket.get_metrics().coherence_level, 0.0);
+
+    ASSERT_TRUE(bucket.add_node(node(1, 0.1)));
+    ASSERT_TRUE(bucket.add_node(node(2, 0.7)));
+    EXPECT_DOUBLE_EQ(bucket.get_metrics().routing_efficiency, 1.0 - 2.0 / QDHT_K);
+    EXPECT_NEAR(bucket.get_metrics().coherence_level, 1.0, 1e-12);
+    // |<a|b>| for the two rotations
+    EXPECT_NEAR(bucket.get_metrics().entanglement_factor, std::cos(0.6), 1e-12);
+
+    // Re-adding a known id replaces it in place
+    ASSERT_TRUE(bucket.add_node(node(2, 0.1)));
+    EXPECT_EQ(bucket.get_nodes().size(), 2u);
+    EXPECT_NEAR(bucket.get_metrics().entanglement_factor, 1.0, 1e-12);
+
+    ASSERT_TRUE(bucket.remove_node(node(1, 0.0)));
+    EXPECT_FALSE(bucket.remove_node(node(1, 0.0)));
+    EXPECT_DOUBLE_EQ(bucket.get_metrics().routing_efficiency, 1.0 - 1.0 / QDHT_K);
+
+    // States of another width cannot join the routing sum
+    auto wide = node(3, 0.0);
+    wide.quantum_state = quantum::QuantumState(QDHT_STATE_QUBITS + 1);
+    EXPECT_FALSE(bucket.add_node(wide));
+    EXPECT_EQ(bucket.get_nodes().size(), 1u);
+}
+
+TEST(QDHTBucketTest, ChurnMatchesABucketBuiltFromTheSurvivors) {
+    QDHTBucket churned;
+    for (uint8_t tag = 1; tag <= 12; ++tag) {
+        ASSERT_TRUE(churned.add_node(node(tag, 0.1 * tag)));
+    }
+    for (uint8_t tag = 2; tag <= 12; tag += 2) {
+        ASSERT_TRUE(churned.remove_node(node(tag, 0.0)));
+    }
+
+    QDHTBucket fresh;
+    for (const auto& member : churned.get_nodes()) {
+        ASSERT_TRUE(fresh.add_node(member));
+    }
+    // Both are read once, so the running sum is all that differs
+    expectSameMetrics(churned.get_metrics(), fresh.get_metrics());
+
+    // refresh() rebuilds the sum from scratch
+    churned.refresh();
+    fresh.refresh();
+    expectSameMetrics(churned.get_metrics(), fresh.get_metrics());
+}
+
+TEST(QDHTBucketTest, RecomputesOnlyAfterAChange) {
+    QDHTBucket bucket;
+    ASSERT_TRUE(bucket.add_node(node(1, 0.3)));
+    ASSERT_TRUE(bucket.add_node(node(2, 0.9)));
+    const Eigen::VectorXcd first = bucket.get_metrics().quantum_state.getStateVector();
+
+    // Each recomputation folds the routing state in again, so an unchanged
+    // state shows no work was done
+    EXPECT_EQ(bucket.get_metrics().quantum_state.getStateVector(), first);
+    EXPECT_EQ(bucket.get_metrics().quantum_state.getStateVector(), first);
+
+    // Membership changes are batched into one recomputation at the next read
+    ASSERT_TRUE(bucket.add_node(node(3, 1.2)));
+    ASSERT_TRUE(bucket.remove_node(node(3, 0.0)));
+    const Eigen::VectorXcd second = bucket.get_metrics().quantum_state.getStateVector();
+    EXPECT_FALSE(second.isApprox(first, 1e-12));
+    EXPECT_EQ(bucket.get_metrics().quantum_state.getStateVector(), second);
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
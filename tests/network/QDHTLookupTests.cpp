@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include "network/QDHTLookup.hpp"
+#include "network/RoutingIndex.hpp"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using NodeId = QDHTLookup::NodeId;
+using namespace std::chrono_literals;
+
+constexpr size_t K = 8;
+
+QDHTLookup::Config lookupConfig() {
+    QDHTLookup::Config config;
+    config.k = K;
+    config.alpha = 3;
+    config.shortlist_limit = K * 4;
+    config.initial_timeout = 100ms;
+    config.min_timeout = 1ms;
+    return config;
+}
+
+// Nodes that each know their nearest neighbours and a few random ones, and
+// answer FIND_NODE from that table after `delay`
+class SimulatedNetwork {
+public:
+    SimulatedNetwork(boost::asio::io_context& io, size_t nodes, uint64_t seed) : io_(io) {
+        std::mt19937_64 rng(seed);
+        for (size_t i = 0; i < nodes; ++i) {
+            QDHTContact contact;
+            for (auto& byte : contact.id) byte = static_cast<uint8_t>(rng());
+            contact.address = "10.0.0." + std::to_string(i);
+            contact.port = static_cast<uint16_t>(4000 + i);
+            contacts_.push_back(contact);
+            by_id_[contact.id] = i;
+        }
+        for (size_t i = 0; i < nodes; ++i) {
+            auto table = nearest(contacts_[i].id, K + 1);
+            for (int r = 0; r < 4; ++r) table.push_back(contacts_[rng() % nodes]);
+            tables_.push_back(std::move(table));
+        }
+    }
+
+    // The true `count` closest, by brute force
+    std::vector<QDHTContact> nearest(const NodeId& target, size_t count) const {
+        auto sorted = contacts_;
+        const auto key = RoutingIndex::keyFromBytes(target);
+        std::sort(sorted.begin(), sorted.end(), [&](const QDHTContact& a, const QDHTContact& b) {
+            return RoutingIndex::distance(RoutingIndex::keyFromBytes(a.id), key) <
+                   RoutingIndex::distance(RoutingIndex::keyFromBytes(b.id), key);
+        });
+        sorted.resize(std::min(count, sorted.size()));
+        return sorted;
+    }
+
+    QDHTLookup::Transport transport() {
+        QDHTLookup::Transport transport;
+        transport.find_node = [this](uint64_t request, const QDHTContact& peer, const NodeId& target,
+                                     QDHTLookup::Reply reply) {
+            ++requests_[peer.id];
+            outstanding_.insert(request);
+            max_outstanding_ = std::max(max_outstanding_, outstanding_.size());
+            if (silent_.count(peer.id)) {
+                return;
+            }
+            const auto& table = tables_[by_id_.at(peer.id)];
+            std::vector<QDHTContact> answer = table;
+            const auto key = RoutingIndex::keyFromBytes(target);
+            std::sort(answer.begin(), answer.end(), [&](const QDHTContact& a, const QDHTContact& b) {
+                return RoutingIndex::distance(RoutingIndex::keyFromBytes(a.id), key) <
+                       RoutingIndex::distance(RoutingIndex::keyFromBytes(b.id), key);
+            });
+            answer.resize(std::min(answer.size(), K));
+            auto timer = std::make_shared<boost::asio::steady_timer>(io_, delay);
+            timer->async_wait([this, timer, request, reply, answer](const boost::system::error_code&) {
+                outstanding_.erase(request);
+                reply(answer);
+            });
+        };
+        transport.cancel = [this](uint64_t request) {
+            outstanding_.erase(request);
+            ++cancels_;
+        };
+        return transport;
+    }
+
+    const QDHTContact& operator[](size_t i) const { return contacts_[i]; }
+    size_t requestsTo(const NodeId& id) const {
+        auto it = requests_.find(id);
+        return it == requests_.end() ? 0 : it->second;
+    }
+
+    std::chrono::milliseconds delay{0};
+    std::set<NodeId> silent_;
+    size_t max_outstanding_{0};
+    size_t cancels_{0};
+
+private:
+    boost::asio::io_context& io_;
+    std::vector<QDHTContact> contacts_;
+    std::map<NodeId, size_t> by_id_;
+    std::vector<std::vector<QDHTContact>> tables_;
+    std::map<NodeId, size_t> requests_;
+    std::set<uint64_t> outstanding_;
+};
+
+std::vector<NodeId> idsOf(const std::vector<QDHTContact>& contacts) {
+    std::vector<NodeId> ids;
+    for (const auto& contact : contacts) ids.push_back(contact.id);
+    return ids;
+}
+
+NodeId randomId(uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    NodeId id;
+    for (auto& byte : id) byte = static_cast<uint8_t>(rng());
+    return id;
+}
+
+} // namespace
+
+TEST(QDHTLookupTest, ConvergesOnTheKClosestNodes) {
+    boost::asio::io_context io;
+    SimulatedNetwork net(io, 300, 1);
+    QDHTLookup engine(io, net.transport(), lookupConfig());
+
+    for (uint64_t trial = 0; trial < 5; ++trial) {
+        SCOPED_TRACE(trial);
+        const NodeId target = randomId(100 + trial);
+        std::optional<std::vector<QDHTContact>> result;
+        engine.lookup(target, {net[trial], net[trial + 50], net[trial + 100]},
+                      [&](std::vector<QDHTContact> closest) { result = std::move(closest); });
+        io.run_for(10s);
+        io.restart();
+        ASSERT_TRUE(result);
+        EXPECT_EQ(idsOf(*result), idsOf(net.nearest(target, K)));
+    }
+
+    // Never more than alpha requests out at once, and far fewer than a flood
+    EXPECT_LE(net.max_outstanding_, 3u);
+    const auto stats = engine.stats();
+    EXPECT_EQ(stats.lookups, 5u);
+    EXPECT_EQ(stats.replies + stats.cancelled, stats.requests);
+    EXPECT_LT(stats.requests, 5u * 60);
+    EXPECT_EQ(stats.timeouts, 0u);
+}
+
+TEST(QDHTLookupTest, ConcurrentLookupsForOneTargetShareTheWork) {
+    boost::asio::io_context io;
+    SimulatedNetwork net(io, 100, 2);
+    net.delay = 5ms;
+    QDHTLookup engine(io, net.transport(), lookupConfig());
+
+    const NodeId target = randomId(7);
+    std::vector<std::vector<QDHTContact>> results;
+    auto done = [&](std::vector<QDHTContact> closest) { results.push_back(std::move(closest)); };
+    engine.lookup(target, {net[0]}, done);
+    engine.lookup(target, {net[1]}, done);
+    io.run_for(10s);
+
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(idsOf(results[0]), idsOf(results[1]));
+    EXPECT_EQ(idsOf(results[0]), idsOf(net.nearest(target, K)));
+    EXPECT_EQ(engine.stats().coalesced, 1u);
+}
+
+TEST(QDHTLookupTest, SilentPeersTimeOutAndBackOff) {
+    boost::asio::io_context io;
+    SimulatedNetwork net(io, 100, 3);
+    net.delay = 20ms;
+    QDHTLookup engine(io, net.transport(), lookupConfig());
+
+    // A first lookup samples the seed's RTT
+    const QDHTContact seed = net[0];
+    EXPECT_EQ(engine.timeoutFor(seed.id), 100ms);
+    bool finished = false;
+    engine.lookup(randomId(1), {seed}, [&](std::vector<QDHTContact>) { finished = true; });
+    io.run_for(10s);
+    io.restart();
+    ASSERT_TRUE(finished);
+    const auto sampled = engine.timeoutFor(seed.id);
+    EXPECT_GE(sampled, 20ms);
+    EXPECT_LT(sampled, 100ms);
+
+    // Then it goes quiet. Looking up its own id keeps it among the k closest,
+    // so it is waited on rather than dropped; the lookup carries on without
+    // it, and its next timeout is doubled
+    net.silent_.insert(seed.id);
+    std::optional<std::vector<QDHTContact>> result;
+    const NodeId target = seed.id;
+    engine.lookup(target, {seed, net[1]}, [&](std::vector<QDHTContact> closest) { result = std::move(closest); });
+    io.run_for(10s);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(engine.stats().timeouts, 1u);
+    EXPECT_EQ(net.requestsTo(seed.id), 2u);
+    EXPECT_GE(net.cancels_, 1u);
+    const auto backed_off = engine.timeoutFor(seed.id);
+    EXPECT_GE(backed_off.count(), sampled.count() * 2 - 1);
+    EXPECT_LE(backed_off.count(), sampled.count() * 2 + 1);
+
+    // The result holds only contacts that answered
+    auto expected = net.nearest(target, K + 1);
+    expected.erase(std::remove_if(expected.begin(), expected.end(),
+                                  [&](const QDHTContact& c) { return c.id == seed.id; }),
+                   expected.end());
+    expected.resize(K);
+    EXPECT_EQ(idsOf(*result), idsOf(expected));
+}
+
+TEST(QDHTLookupTest, NeverQueriesOrReturnsItself) {
+    boost::asio::io_context io;
+    SimulatedNetwork net(io, 100, 4);
+    auto config = lookupConfig();
+    config.self = net[5].id;
+    QDHTLookup engine(io, net.transport(), config);
+
+    // Looking up our own id, as a node does when it joins
+    std::optional<std::vector<QDHTContact>> result;
+    engine.lookup(net[5].id, {net[5], net[6]}, [&](std::vector<QDHTContact> closest) { result = std::move(closest); });
+    io.run_for(10s);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(net.requestsTo(net[5].id), 0u);
+    auto expected = net.nearest(net[5].id, K + 1);
+    expected.erase(expected.begin());
+    EXPECT_EQ(idsOf(*result), idsOf(expected));
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
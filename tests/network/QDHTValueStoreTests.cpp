@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include "network/QDHTValueStore.hpp"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using Key = QDHTValueStore::Key;
+using namespace std::chrono_literals;
+
+Key keyOf(uint8_t n) {
+    Key key{};
+    key[0] = n;
+    return key;
+}
+
+QDHTContact contactOf(uint8_t n) {
+    QDHTContact contact;
+    contact.id[0] = n;
+    contact.address = "10.0.0." + std::to_string(n);
+    contact.port = 4000;
+    return contact;
+}
+
+std::vector<uint8_t> valueOf(uint8_t n, size_t size = 100) {
+    return std::vector<uint8_t>(size, n);
+}
+
+// Offers a store has sent, by the first byte of the peer's id
+struct Outbox {
+    QDHTValueStore::SendOffer sender() {
+        return [this](const QDHTContact& peer, std::vector<QDHTValueStore::OfferItem>&& items) {
+            auto& out = offers[peer.id[0]];
+            out.insert(out.end(), items.begin(), items.end());
+            ++batches;
+        };
+    }
+
+    std::map<uint8_t, std::vector<QDHTValueStore::OfferItem>> offers;
+    size_t batches{0};
+};
+
+QDHTValueStore::ClosestPeers peers(std::vector<uint8_t> ids) {
+    return [ids](const Key&) {
+        std::vector<QDHTContact> out;
+        for (uint8_t id : ids) out.push_back(contactOf(id));
+        return out;
+    };
+}
+
+// Lets a tick's worth of time pass, then ticks
+void advance(QDHTValueStore& store, size_t ticks) {
+    for (size_t i = 0; i < ticks; ++i) {
+        std::this_thread::sleep_for(store.tickInterval());
+        store.tick();
+    }
+}
+
+} // namespace
+
+TEST(QDHTValueStoreTest, ValuesExpireAfterTheirTtl) {
+    QDHTValueStore::Config config;
+    config.max_ttl = 1h;
+    Outbox outbox;
+    QDHTValueStore store(config, peers({}), outbox.sender());
+
+    ASSERT_TRUE(store.put(keyOf(1), valueOf(1), 20ms));
+    ASSERT_TRUE(store.put(keyOf(2), valueOf(2), 20ms));
+    ASSERT_TRUE(store.put(keyOf(3), valueOf(3)));
+    EXPECT_EQ(store.get(keyOf(1)), valueOf(1));
+    std::this_thread::sleep_for(30ms);
+
+    // Found expired on read, or when its slot comes round
+    EXPECT_FALSE(store.get(keyOf(1)));
+    store.tick();
+    auto stats = store.stats();
+    EXPECT_EQ(stats.expired, 2u);
+    EXPECT_EQ(stats.keys, 1u);
+    EXPECT_EQ(stats.memory_bytes, 100u);
+    EXPECT_EQ(store.get(keyOf(3)), valueOf(3));
+
+    // Lifetimes are capped, and expired keys are never served to peers
+    ASSERT_TRUE(store.put(keyOf(4), valueOf(4), 48h));
+    const auto records = store.recordsFor({keyOf(1), keyOf(3), keyOf(4)});
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_LE(records[1].ttl, 1h);
+    EXPECT_GT(records[1].ttl, 59min);
+    // default_ttl is a day, but still capped
+    EXPECT_LE(records[0].ttl, 1h);
+}
+
+TEST(QDHTValueStoreTest, RepublishOffersOnlyWhatPeersLack) {
+    QDHTValueStore::Config config;
+    config.republish_interval = 40ms;
+    config.wheel_slots = 4;
+    config.full_sync_rounds = 3;
+    Outbox outbox;
+    QDHTValueStore store(config, peers({7, 8, 9}), outbox.sender());
+    ASSERT_EQ(store.tickInterval(), 10ms);
+
+    // New keys go out at the next tick, in one batch per peer
+    ASSERT_TRUE(store.put(keyOf(1), valueOf(1)));
+    ASSERT_TRUE(store.put(keyOf(2), valueOf(2)));
+    store.tick();
+    EXPECT_EQ(outbox.batches, 3u);
+    for (uint8_t peer : {7, 8, 9}) {
+        ASSERT_EQ(outbox.offers[peer].size(), 2u);
+        EXPECT_EQ(outbox.offers[peer][0].version, QDHTValueStore::versionOf(valueOf(1)));
+    }
+
+    // The next round finds every peer already offered this version
+    outbox.offers.clear();
+    advance(store, 4);
+    EXPECT_TRUE(outbox.offers.empty());
+    EXPECT_EQ(store.stats().offer_items_skipped, 6u);
+
+    // Every full_sync_rounds the key is offered to everyone again
+    advance(store, 4);
+    EXPECT_EQ(outbox.offers[7].size(), 2u);
+
+    // A new version is offered again to peers that only had the old one
+    outbox.offers.clear();
+    ASSERT_TRUE(store.put(keyOf(1), valueOf(11)));
+    advance(store, 4);
+    ASSERT_EQ(outbox.offers[8].size(), 1u);
+    EXPECT_EQ(outbox.offers[8][0].key, keyOf(1));
+    EXPECT_EQ(outbox.offers[8][0].version, QDHTValueStore::versionOf(valueOf(11)));
+}
+
+TEST(QDHTValueStoreTest, OfferRequestAndReplicateBetweenStores) {
+    Outbox from_a;
+    Outbox from_b;
+    QDHTValueStore a(QDHTValueStore::Config{}, peers({2}), from_a.sender());
+    QDHTValueStore b(QDHTValueStore::Config{}, peers({1}), from_b.sender());
+
+    ASSERT_TRUE(a.put(keyOf(1), valueOf(1)));
+    ASSERT_TRUE(a.put(keyOf(2), valueOf(2)));
+    ASSERT_TRUE(a.put(keyOf(3), valueOf(3)));
+    // b already has key 1, and an older key 2
+    ASSERT_TRUE(b.put(keyOf(1), valueOf(1)));
+    ASSERT_TRUE(b.put(keyOf(2), valueOf(20)));
+
+    a.tick();
+    const auto wanted = b.handleOffer(from_a.offers[2]);
+    ASSERT_EQ(wanted.size(), 2u);
+    for (const auto& record : a.recordsFor(wanted)) {
+        EXPECT_TRUE(b.storeReplica(record, contactOf(1)));
+    }
+    EXPECT_EQ(b.get(keyOf(2)), valueOf(2));
+    EXPECT_EQ(b.get(keyOf(3)), valueOf(3));
+    EXPECT_TRUE(b.handleOffer(from_a.offers[2]).empty());
+
+    // b does not offer back what it got from a
+    b.tick();
+    ASSERT_EQ(from_b.offers[1].size(), 1u);
+    EXPECT_EQ(from_b.offers[1][0].key, keyOf(1));
+
+    // A replica whose bytes do not match its version is refused
+    auto forged = a.recordsFor({keyOf(3)}).front();
+    forged.value[0] ^= 1;
+    EXPECT_FALSE(b.storeReplica(forged, contactOf(1)));
+    forged = a.recordsFor({keyOf(3)}).front();
+    forged.ttl = 0ms;
+    EXPECT_FALSE(b.storeReplica(forged, contactOf(1)));
+    EXPECT_EQ(b.stats().rejected, 2u);
+}
+
+TEST(QDHTValueStoreTest, EvictsLeastRecentlyUsedWithoutSpill) {
+    QDHTValueStore::Config config;
+    config.memory_limit = 300;
+    config.max_value_size = 200;
+    Outbox outbox;
+    QDHTValueStore store(config, peers({}), outbox.sender());
+
+    ASSERT_TRUE(store.put(keyOf(1), valueOf(1)));
+    ASSERT_TRUE(store.put(keyOf(2), valueOf(2)));
+    ASSERT_TRUE(store.put(keyOf(3), valueOf(3)));
+    // Reading 1 makes 2 the oldest
+    EXPECT_TRUE(store.get(keyOf(1)));
+    ASSERT_TRUE(store.put(keyOf(4), valueOf(4)));
+
+    EXPECT_FALSE(store.get(keyOf(2)));
+    EXPECT_TRUE(store.get(keyOf(1)));
+    EXPECT_TRUE(store.get(keyOf(4)));
+    auto stats = store.stats();
+    EXPECT_EQ(stats.evicted, 1u);
+    EXPECT_EQ(stats.keys, 3u);
+    EXPECT_EQ(stats.memory_bytes, 300u);
+    EXPECT_EQ(stats.spilled, 0u);
+
+    EXPECT_FALSE(store.put(keyOf(5), valueOf(5, 201)));
+    EXPECT_EQ(store.stats().rejected, 1u);
+    EXPECT_TRUE(store.erase(keyOf(1)));
+    EXPECT_FALSE(store.erase(keyOf(1)));
+    EXPECT_EQ(store.stats().memory_bytes, 200u);
+
+    // The key limit holds too
+    config.max_keys = 2;
+    config.memory_limit = 1u << 20;
+    QDHTValueStore few(config, peers({}), outbox.sender());
+    for (uint8_t n = 1; n <= 3; ++n) ASSERT_TRUE(few.put(keyOf(n), valueOf(n)));
+    EXPECT_FALSE(few.get(keyOf(1)));
+    EXPECT_EQ(few.stats().keys, 2u);
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
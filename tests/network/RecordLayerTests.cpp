@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+#include "network/RecordLayer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+const std::vector<uint8_t> SECRET(32, 0x5a);
+
+std::vector<uint8_t> payload(size_t size, uint8_t seed) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] = static_cast<uint8_t>(seed + i * 7);
+    }
+    return bytes;
+}
+
+// The two ends of one session: "alice" initiated it, "bob" answered
+struct Session {
+    explicit Session(RecordLayer::Config config = {}) : alice(config), bob(config) {
+        alice.install("bob", SECRET, true);
+        bob.install("alice", SECRET, false);
+    }
+
+    // Sealed by alice for bob
+    std::vector<uint8_t> sealed(const std::vector<uint8_t>& plaintext) {
+        auto record = plaintext;
+        EXPECT_TRUE(alice.seal("bob", record));
+        return record;
+    }
+
+    bool opens(std::vector<uint8_t> record, const std::vector<uint8_t>& expected) {
+        return bob.open("alice", record) && record == expected;
+    }
+
+    RecordLayer alice;
+    RecordLayer bob;
+};
+
+uint32_t epochOf(const std::vector<uint8_t>& record) {
+    const uint8_t* header = record.data() + record.size() - RecordLayer::TRAILER_SIZE;
+    return static_cast<uint32_t>(header[1] | header[2] << 8 | header[3] << 16 | uint32_t(header[4]) << 24);
+}
+
+} // namespace
+
+TEST(RecordLayerTest, RoundTripsWithEitherCipher) {
+    for (const auto cipher : {RecordLayer::Cipher::Aes256Gcm, RecordLayer::Cipher::ChaCha20Poly1305}) {
+        SCOPED_TRACE(static_cast<int>(cipher));
+        RecordLayer::Config config;
+        config.cipher = cipher;
+        Session session(config);
+
+        const auto plaintext = payload(1000, 3);
+        auto record = session.sealed(plaintext);
+        ASSERT_EQ(record.size(), plaintext.size() + RecordLayer::TRAILER_SIZE);
+        EXPECT_EQ(record[plaintext.size()], static_cast<uint8_t>(cipher));
+        EXPECT_FALSE(std::equal(plaintext.begin(), plaintext.end(), record.begin()));
+
+        // Receivers open either cipher whatever they would seal with
+        RecordLayer::Config other;
+        other.cipher = cipher == RecordLayer::Cipher::Aes256Gcm ? RecordLayer::Cipher::ChaCha20Poly1305
+                                                                 : RecordLayer::Cipher::Aes256Gcm;
+        RecordLayer receiver(other);
+        receiver.install("alice", SECRET, false);
+        ASSERT_TRUE(receiver.open("alice", record));
+        EXPECT_EQ(record, plaintext);
+
+        // Empty records and whole batches too
+        EXPECT_TRUE(session.opens(session.sealed({}), {}));
+        std::vector<std::vector<uint8_t>> batch{payload(10, 1), payload(0, 2), payload(300, 3)};
+        const auto expected = batch;
+        ASSERT_TRUE(session.alice.seal("bob", batch));
+        EXPECT_EQ(session.bob.open("alice", batch), 3u);
+        EXPECT_EQ(batch, expected);
+    }
+}
+
+TEST(RecordLayerTest, RejectsTamperedRecords) {
+    Session session;
+    const auto plaintext = payload(64, 9);
+    const auto record = session.sealed(plaintext);
+
+    // Ciphertext, each trailer field and the tag are all authenticated
+    for (const size_t offset : {size_t{0}, size_t{63}, size_t{64}, size_t{65}, size_t{69},
+                                record.size() - RecordLayer::TAG_SIZE, record.size() - 1}) {
+        SCOPED_TRACE(offset);
+        auto tampered = record;
+        tampered[offset] ^= 0x01;
+        EXPECT_FALSE(session.bob.open("alice", tampered));
+        EXPECT_TRUE(tampered.empty());
+    }
+
+    auto truncated = record;
+    truncated.resize(RecordLayer::TRAILER_SIZE - 1);
+    EXPECT_FALSE(session.bob.open("alice", truncated));
+
+    // Each direction has its own keys, and unknown peers get nothing
+    auto reflected = record;
+    EXPECT_FALSE(session.alice.open("bob", reflected));
+    auto stranger = record;
+    EXPECT_FALSE(session.bob.open("carol", stranger));
+    std::vector<uint8_t> unsent = plaintext;
+    EXPECT_FALSE(session.alice.seal("carol", unsent));
+    EXPECT_EQ(unsent, plaintext);
+
+    // Nothing above disturbed the session
+    EXPECT_TRUE(session.opens(record, plaintext));
+    EXPECT_EQ(session.bob.stats().rejected, 9u);
+    EXPECT_EQ(session.bob.stats().opened, 1u);
+}
+
+TEST(RecordLayerTest, RefusesReplaysAndRecordsBehindTheWindow) {
+    Session session;
+    std::vector<std::vector<uint8_t>> records;
+    for (uint8_t i = 0; i < 80; ++i) {
+        records.push_back(session.sealed(payload(16, i)));
+    }
+
+    EXPECT_TRUE(session.opens(records[5], payload(16, 5)));
+    EXPECT_FALSE(session.opens(records[5], payload(16, 5)));
+
+    // Out of order inside the window is fine, once
+    EXPECT_TRUE(session.opens(records[2], payload(16, 2)));
+    EXPECT_FALSE(session.opens(records[2], payload(16, 2)));
+    EXPECT_TRUE(session.opens(records[70], payload(16, 70)));
+    EXPECT_TRUE(session.opens(records[7], payload(16, 7)));
+
+    // 64 or more behind the highest is refused even if never seen
+    EXPECT_FALSE(session.opens(records[6], payload(16, 6)));
+    EXPECT_FALSE(session.opens(records[3], payload(16, 3)));
+    EXPECT_TRUE(session.opens(records[79], payload(16, 79)));
+    EXPECT_FALSE(session.opens(records[70], payload(16, 70)));
+}
+
+TEST(RecordLayerTest, FollowsTheSenderAcrossRekeys) {
+    RecordLayer::Config config;
+    config.rekey_records = 3;
+    config.receive_epoch_window = 1;
+    Session session(config);
+    std::vector<std::vector<uint8_t>> records;
+    for (uint8_t i = 0; i < 9; ++i) {
+        records.push_back(session.sealed(payload(32, i)));
+        EXPECT_EQ(epochOf(records.back()), i / 3u);
+    }
+    EXPECT_EQ(session.alice.stats().rekeys, 2u);
+
+    // A record two epochs ahead is not followed
+    EXPECT_TRUE(session.opens(records[0], payload(32, 0)));
+    EXPECT_FALSE(session.opens(records[6], payload(32, 6)));
+
+    // The first record of epoch 1 moves the receiver on; epoch 0 records
+    // still in flight open under the previous keys
+    EXPECT_TRUE(session.opens(records[3], payload(32, 3)));
+    EXPECT_TRUE(session.opens(records[1], payload(32, 1)));
+    EXPECT_EQ(session.bob.stats().rekeys, 1u);
+
+    // Moving to epoch 2 retires epoch 0's keys
+    EXPECT_TRUE(session.opens(records[4], payload(32, 4)));
+    EXPECT_TRUE(session.opens(records[7], payload(32, 7)));
+    EXPECT_FALSE(session.opens(records[2], payload(32, 2)));
+    EXPECT_TRUE(session.opens(records[5], payload(32, 5)));
+    EXPECT_TRUE(session.opens(records[6], payload(32, 6)));
+    EXPECT_TRUE(session.opens(records[8], payload(32, 8)));
+    EXPECT_EQ(session.bob.stats().rekeys, 2u);
+
+    // A forged record claiming the next epoch does not move the receiver
+    auto forged = session.sealed(payload(32, 9));
+    ASSERT_EQ(epochOf(forged), 3u);
+    auto genuine = forged;
+    forged[0] ^= 0x01;
+    EXPECT_FALSE(session.bob.open("alice", forged));
+    EXPECT_EQ(session.bob.stats().rekeys, 2u);
+    EXPECT_TRUE(session.opens(genuine, payload(32, 9)));
+    EXPECT_EQ(session.bob.stats().rekeys, 3u);
+}
+
+TEST(RecordLayerTest, SkipsEpochsWhoseRecordsWereAllLost) {
+    RecordLayer::Config config;
+    config.rekey_records = 2;
+    config.receive_epoch_window = 3;
+    Session session(config);
+    std::vector<std::vector<uint8_t>> records;
+    for (uint8_t i = 0; i < 16; ++i) {
+        records.push_back(session.sealed(payload(24, i)));
+    }
+    ASSERT_EQ(epochOf(records[15]), 7u);
+
+    // Epochs 1 and 2 never arrive; the first epoch 3 record still opens
+    EXPECT_TRUE(session.opens(records[0], payload(24, 0)));
+    EXPECT_TRUE(session.opens(records[6], payload(24, 6)));
+    EXPECT_EQ(session.bob.stats().rekeys, 1u);
+    EXPECT_TRUE(session.opens(records[7], payload(24, 7)));
+    // Epoch 0 records in flight still open; the skipped epochs do not
+    EXPECT_TRUE(session.opens(records[1], payload(24, 1)));
+    EXPECT_FALSE(session.opens(records[3], payload(24, 3)));
+
+    // Four epochs ahead is past the window
+    EXPECT_FALSE(session.opens(records[14], payload(24, 14)));
+    EXPECT_TRUE(session.opens(records[12], payload(24, 12)));
+    EXPECT_TRUE(session.opens(records[14], payload(24, 14)));
+    EXPECT_EQ(session.bob.stats().rekeys, 3u);
+
+    config.receive_epoch_window = 0;
+    EXPECT_THROW(RecordLayer{config}, std::invalid_argument);
+}
+
+TEST(RecordLayerTest, RekeysOnTheInterval) {
+    RecordLayer::Config config;
+    config.rekey_interval = std::chrono::seconds(0);
+    Session session(config);
+    for (uint8_t i = 0; i < 4; ++i) {
+        const auto record = session.sealed(payload(8, i));
+        EXPECT_EQ(epochOf(record), i + 1u);
+        EXPECT_TRUE(session.opens(record, payload(8, i)));
+    }
+    EXPECT_EQ(session.bob.stats().rekeys, 4u);
+
+    // Installing again starts over at epoch 0
+    session.bob.install("alice", SECRET, false);
+    RecordLayer fresh;
+    fresh.install("bob", SECRET, true);
+    auto record = payload(8, 0);
+    ASSERT_TRUE(fresh.seal("bob", record));
+    EXPECT_EQ(epochOf(record), 0u);
+    EXPECT_TRUE(session.opens(record, payload(8, 0)));
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "network/RoutingIndex.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using Key = RoutingIndex::NodeKey;
+
+Key keyWith(std::initializer_list<std::pair<size_t, uint8_t>> bytes) {
+    Key key{};
+    for (const auto& [index, value] : bytes) {
+        key[index] = value;
+    }
+    return key;
+}
+
+// Positions sorted by full XOR distance, ties by position
+std::vector<uint32_t> bruteForceClosest(const std::vector<Key>& keys, const Key& target, size_t count) {
+    std::vector<uint32_t> order(keys.size());
+    for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const auto da = RoutingIndex::distance(keys[a], target);
+        const auto db = RoutingIndex::distance(keys[b], target);
+        return da != db ? da < db : a < b;
+    });
+    order.resize(std::min(count, order.size()));
+    return order;
+}
+
+} // namespace
+
+// Regression: buckets once ranked by the Hamming weight of the XOR, and
+// ids were folded into 64 bits, so high-order differences were lost
+TEST(RoutingIndexTest, DistanceIsTheXorReadAsABigEndianNumber) {
+    const Key target{};
+    // One differing bit, but the most significant one
+    const Key far = keyWith({{0, 0x80}});
+    // Every bit below the top one differs
+    Key near{};
+    std::fill(near.begin(), near.end(), 0xff);
+    near[0] = 0x7f;
+    EXPECT_LT(RoutingIndex::distance(near, target), RoutingIndex::distance(far, target));
+
+    // Differences only above the low 64 bits still count, and rank first
+    const Key high = keyWith({{3, 0x01}});
+    const Key low = keyWith({{31, 0xff}});
+    EXPECT_NE(RoutingIndex::distance(high, target), RoutingIndex::Distance{});
+    EXPECT_LT(RoutingIndex::distance(low, target), RoutingIndex::distance(high, target));
+
+    EXPECT_EQ(RoutingIndex::distance(far, far), RoutingIndex::Distance{});
+    EXPECT_EQ(RoutingIndex::distance(far, near), RoutingIndex::distance(near, far));
+    EXPECT_EQ(RoutingIndex::distance(far, target)[0], 0x8000000000000000ull);
+
+    RoutingIndex index;
+    index.add(far);
+    index.add(high);
+    index.add(near);
+    index.add(low);
+    EXPECT_EQ(index.closest(target, 4), (std::vector<uint32_t>{3, 1, 2, 0}));
+}
+
+TEST(RoutingIndexTest, CommonPrefixCountsFromTheMostSignificantBit) {
+    const Key zero{};
+    EXPECT_EQ(RoutingIndex::commonPrefixBits(zero, zero), RoutingIndex::KEY_BITS);
+    EXPECT_EQ(RoutingIndex::commonPrefixBits(zero, keyWith({{0, 0x80}})), 0u);
+    EXPECT_EQ(RoutingIndex::commonPrefixBits(zero, keyWith({{0, 0x01}})), 7u);
+    EXPECT_EQ(RoutingIndex::commonPrefixBits(zero, keyWith({{8, 0x40}})), 65u);
+    EXPECT_EQ(RoutingIndex::commonPrefixBits(zero, keyWith({{31, 0x01}})), 255u);
+
+    // Short ids are zero-padded; long ones are cut to 32 bytes
+    const std::vector<uint8_t> bytes(40, 0xab);
+    const auto key = RoutingIndex::keyFromBytes(bytes);
+    EXPECT_EQ(key[31], 0xab);
+    EXPECT_EQ(RoutingIndex::keyFromString("a")[0], 'a');
+    EXPECT_EQ(RoutingIndex::keyFromString("a")[1], 0);
+}
+
+TEST(RoutingIndexTest, ClosestMatchesBruteForce) {
+    std::mt19937_64 rng(11);
+    std::vector<Key> keys;
+    RoutingIndex index;
+    for (size_t i = 0; i < 300; ++i) {
+        Key key;
+        for (auto& byte : key) byte = static_cast<uint8_t>(rng());
+        // A third share their top word, so the selection has to look past it
+        if (i % 3 == 0) {
+            std::fill(key.begin(), key.begin() + 8, 0x5a);
+        }
+        keys.push_back(key);
+        EXPECT_EQ(index.add(key), i);
+    }
+
+    for (int trial = 0; trial < 20; ++trial) {
+        Key target;
+        for (auto& byte : target) byte = static_cast<uint8_t>(rng());
+        if (trial % 2 == 0) {
+            std::fill(target.begin(), target.begin() + 8, 0x5a);
+        }
+        for (const size_t count : {size_t{1}, size_t{20}, keys.size(), keys.size() + 5}) {
+            EXPECT_EQ(index.closest(target, count), bruteForceClosest(keys, target, count))
+                << "trial " << trial << " count " << count;
+        }
+    }
+    EXPECT_TRUE(RoutingIndex().closest(Key{}, 5).empty());
+}
+
+TEST(RoutingIndexTest, RemoveMovesTheLastKeyIntoTheHole) {
+    RoutingIndex index;
+    const Key a = keyWith({{0, 1}});
+    const Key b = keyWith({{0, 2}});
+    const Key c = keyWith({{0, 3}});
+    index.add(a);
+    index.add(b);
+    index.add(c);
+
+    EXPECT_EQ(index.remove(0), 2u);
+    EXPECT_EQ(index.size(), 2u);
+    EXPECT_EQ(index.find(c), 0u);
+    EXPECT_EQ(index.find(b), 1u);
+    EXPECT_EQ(index.find(a), index.size());
+
+    // Removing the last one moves nothing
+    EXPECT_EQ(index.remove(1), 1u);
+    EXPECT_EQ(index.find(c), 0u);
+    index.clear();
+    EXPECT_TRUE(index.empty());
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
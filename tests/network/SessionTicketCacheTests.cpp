@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "network/SessionTicketCache.hpp"
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = SessionTicketCache::Clock;
+
+// Whole seconds, as encode() stores them
+const Clock::time_point T0{std::chrono::seconds(1700000000)};
+
+std::vector<uint8_t> session(uint8_t tag, size_t size = 300) {
+    return std::vector<uint8_t>(size, tag);
+}
+
+} // namespace
+
+TEST(SessionTicketCacheTest, KeepsOneSessionPerPeerUntilItExpires) {
+    SessionTicketCache cache(16, 60s);
+    cache.store("alice", session(1), T0);
+    EXPECT_EQ(cache.find("alice", T0), session(1));
+    EXPECT_FALSE(cache.find("bob", T0));
+
+    // A new ticket replaces the old one and its lifetime
+    cache.store("alice", session(2), T0 + 30s);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.find("alice", T0 + 89s), session(2));
+    EXPECT_FALSE(cache.find("alice", T0 + 90s));
+
+    cache.erase("alice");
+    EXPECT_FALSE(cache.find("alice", T0 + 31s));
+    EXPECT_EQ(cache.size(), 0u);
+
+    // Nothing to resume from, or not a session
+    cache.store("bob", {}, T0);
+    cache.store("bob", session(3, 64 * 1024), T0);
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(SessionTicketCacheTest, EvictsTheSessionClosestToExpiring) {
+    SessionTicketCache cache(2, 60s);
+    cache.store("a", session(1), T0);
+    cache.store("b", session(2), T0 + 10s);
+    // Refreshing a keeps it past b
+    cache.store("a", session(3), T0 + 20s);
+    cache.store("c", session(4), T0 + 30s);
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_FALSE(cache.find("b", T0 + 30s));
+    EXPECT_EQ(cache.find("a", T0 + 30s), session(3));
+    EXPECT_EQ(cache.find("c", T0 + 30s), session(4));
+
+    // Capacity is at least one
+    SessionTicketCache tiny(0, 60s);
+    tiny.store("a", session(1), T0);
+    tiny.store("b", session(2), T0 + 1s);
+    EXPECT_EQ(tiny.size(), 1u);
+    EXPECT_TRUE(tiny.find("b", T0 + 1s));
+}
+
+TEST(SessionTicketCacheTest, CarriesUnexpiredSessionsAcrossARestart) {
+    SessionTicketCache before(16, 60s);
+    before.store("alice", session(1), T0);
+    before.store("bob", session(2), T0 + 40s);
+    before.store("carol", session(3, 1), T0 + 50s);
+    // alice has 5 s left, and is gone by the time the new run loads
+    const auto saved = before.encode(T0 + 55s);
+
+    SessionTicketCache after(16, 60s);
+    after.store("carol", session(9), T0 + 70s);
+    // carol learned in this run wins over the saved one
+    EXPECT_EQ(after.decode(saved, T0 + 70s), 1u);
+    EXPECT_FALSE(after.find("alice", T0 + 70s));
+    EXPECT_EQ(after.find("bob", T0 + 70s), session(2));
+    EXPECT_FALSE(after.find("bob", T0 + 100s));
+    EXPECT_EQ(after.find("carol", T0 + 70s), session(9));
+
+    // Expired sessions are not saved at all
+    EXPECT_EQ(before.encode(T0 + 200s), before.encode(T0 + 300s));
+    EXPECT_EQ(after.decode(before.encode(T0 + 200s), T0), 0u);
+
+    // A clock set back since the save does not stretch a lifetime
+    SessionTicketCache rewound(16, 60s);
+    EXPECT_EQ(rewound.decode(saved, T0 - 1h), 0u);
+    EXPECT_EQ(rewound.size(), 0u);
+}
+
+TEST(SessionTicketCacheTest, RejectsMalformedDataWithoutMergingAnything) {
+    SessionTicketCache source(16, 60s);
+    source.store("alice", session(1), T0);
+    source.store("bob", session(2), T0);
+    const auto saved = source.encode(T0);
+
+    SessionTicketCache cache(16, 60s);
+    for (size_t cut = 0; cut < saved.size(); ++cut) {
+        EXPECT_FALSE(cache.decode(std::span<const uint8_t>(saved).first(cut), T0)) << cut;
+    }
+    auto trailing = saved;
+    trailing.push_back(0);
+    EXPECT_FALSE(cache.decode(trailing, T0));
+    EXPECT_EQ(cache.size(), 0u);
+
+    // count 1, peer "x", expiry, then a zero-length session
+    std::vector<uint8_t> empty_session{1, 0, 0, 0, 1, 0, 'x'};
+    const auto expires = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                                   (T0 + 30s).time_since_epoch()).count());
+    for (int i = 0; i < 8; ++i) {
+        empty_session.push_back(static_cast<uint8_t>(expires >> (8 * i)));
+    }
+    empty_session.insert(empty_session.end(), {0, 0, 0, 0});
+    EXPECT_FALSE(cache.decode(empty_session, T0));
+
+    // An implausibly long peer id
+    EXPECT_FALSE(cache.decode(std::vector<uint8_t>{1, 0, 0, 0, 0xff, 0xff}, T0));
+
+    EXPECT_EQ(cache.decode(saved, T0), 2u);
+    EXPECT_EQ(cache.find("bob", T0), session(2));
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
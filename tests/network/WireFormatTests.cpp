@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include "network/WireFormat.hpp"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace quids {
+namespace network {
+namespace test {
+
+namespace {
+
+enum class Kind : uint16_t { Block = 1, Vote = 0x1234 };
+
+struct Origin {
+    std::array<uint8_t, 4> address{};
+    uint16_t port{0};
+    QUIDS_WIRE_FIELDS(address, port)
+};
+
+// One field of every kind the format supports
+struct Announce {
+    static constexpr uint8_t WIRE_TYPE = wire::types::GOSSIP;
+    uint64_t id{0};
+    int32_t delta{0};
+    bool urgent{false};
+    Kind kind{Kind::Block};
+    Origin origin;
+    std::span<const uint8_t> body;
+    std::string_view topic;
+    wire::Seq<uint32_t> seen;
+    wire::Seq<std::span<const uint8_t>> parts;
+    QUIDS_WIRE_FIELDS(id, delta, urgent, kind, origin, body, topic, seen, parts)
+};
+
+// An older sender's view of the same message
+struct AnnounceV0 {
+    static constexpr uint8_t WIRE_TYPE = wire::types::GOSSIP;
+    uint64_t id{0};
+    int32_t delta{0};
+    QUIDS_WIRE_FIELDS(id, delta)
+};
+
+struct Numbers {
+    static constexpr uint8_t WIRE_TYPE = wire::types::REQUEST;
+    wire::Seq<uint64_t> values;
+    QUIDS_WIRE_FIELDS(values)
+};
+
+template <class T>
+std::vector<T> collect(const wire::Seq<T>& seq) {
+    std::vector<T> out;
+    for (const auto& item : seq) {
+        out.push_back(item);
+    }
+    return out;
+}
+
+std::vector<uint8_t> frameOf(std::span<const uint8_t> payload) {
+    std::vector<uint8_t> out;
+    wire::appendFrame(out, wire::types::GOSSIP, wire::COMPRESSED, payload);
+    return out;
+}
+
+} // namespace
+
+TEST(WireFormatTest, DecodesAFrameInPlace) {
+    const std::vector<uint8_t> payload{1, 2, 3, 4, 5};
+    auto bytes = frameOf(payload);
+    ASSERT_EQ(bytes.size(), wire::HEADER_SIZE + payload.size());
+    EXPECT_EQ(bytes[0], wire::VERSION);
+    EXPECT_EQ(bytes[1], wire::types::GOSSIP);
+
+    // Bytes of the next frame after it are left alone
+    bytes.push_back(0xee);
+    wire::Frame frame;
+    ASSERT_EQ(wire::decodeFrame(bytes, frame), wire::Status::Ok);
+    EXPECT_EQ(frame.type(), wire::types::GOSSIP);
+    EXPECT_EQ(frame.header.flags, wire::COMPRESSED);
+    EXPECT_EQ(frame.size(), bytes.size() - 1);
+    EXPECT_EQ(frame.payload.data(), bytes.data() + wire::HEADER_SIZE);
+    EXPECT_EQ(std::vector<uint8_t>(frame.payload.begin(), frame.payload.end()), payload);
+
+    // CRC32C check value
+    const std::string_view check = "123456789";
+    EXPECT_EQ(wire::crc32c({reinterpret_cast<const uint8_t*>(check.data()), check.size()}), 0xe3069283u);
+}
+
+TEST(WireFormatTest, RejectsBadHeaders) {
+    const std::vector<uint8_t> payload(100, 0x42);
+    const auto good = frameOf(payload);
+    wire::Frame frame;
+
+    for (const uint8_t version : {uint8_t{0}, uint8_t{wire::VERSION + 1}, uint8_t{0xff}}) {
+        auto bad = good;
+        bad[0] = version;
+        EXPECT_EQ(wire::decodeFrame(bad, frame), wire::Status::BadVersion) << int(version);
+    }
+
+    // Refused from the header alone, before the payload arrives
+    auto oversize = good;
+    const uint32_t length = wire::MAX_PAYLOAD + 1;
+    for (size_t i = 0; i < 4; ++i) {
+        oversize[4 + i] = static_cast<uint8_t>(length >> (8 * i));
+    }
+    oversize.resize(wire::HEADER_SIZE);
+    EXPECT_EQ(wire::decodeFrame(oversize, frame), wire::Status::TooLarge);
+
+    for (const size_t offset : {size_t{8}, size_t{11}, wire::HEADER_SIZE, good.size() - 1}) {
+        auto bad = good;
+        bad[offset] ^= 0x10;
+        EXPECT_EQ(wire::decodeFrame(bad, frame), wire::Status::BadChecksum) << offset;
+    }
+
+    // Short reads ask for more
+    for (const size_t size : {size_t{0}, wire::HEADER_SIZE - 1, wire::HEADER_SIZE, good.size() - 1}) {
+        EXPECT_EQ(wire::decodeFrame(std::span(good).first(size), frame), wire::Status::Incomplete) << size;
+    }
+    EXPECT_EQ(wire::decodeFrame(good, frame), wire::Status::Ok);
+}
+
+TEST(WireFormatTest, FieldListRoundTrips) {
+    const std::vector<uint8_t> body{9, 8, 7};
+    const std::vector<uint32_t> seen{1, 0xdeadbeef, 3};
+    const std::vector<uint8_t> first{0xaa};
+    const std::vector<uint8_t> second{};
+    const std::vector<uint8_t> third{0xbb, 0xcc};
+    const std::vector<std::span<const uint8_t>> parts{first, second, third};
+
+    Announce sent;
+    sent.id = 0x0102030405060708ull;
+    sent.delta = -5;
+    sent.urgent = true;
+    sent.kind = Kind::Vote;
+    sent.origin = {{10, 0, 0, 1}, 30303};
+    sent.body = body;
+    sent.topic = "blocks";
+    sent.seen = wire::Seq<uint32_t>(seen);
+    sent.parts = wire::Seq<std::span<const uint8_t>>(parts);
+
+    std::vector<uint8_t> buffer;
+    wire::encode(sent, buffer);
+    EXPECT_EQ(buffer.size(), wire::HEADER_SIZE + wire::payloadSize(sent));
+    // Little-endian and unpadded
+    EXPECT_EQ(buffer[wire::HEADER_SIZE], 0x08);
+    EXPECT_EQ(buffer[wire::HEADER_SIZE + 7], 0x01);
+    EXPECT_EQ(wire::payloadSize(sent), 8 + 4 + 1 + 2 + 6 + (4 + 3) + (2 + 6) + (4 + 12) + (4 + 5 + 4 + 6u));
+
+    wire::Frame frame;
+    ASSERT_EQ(wire::decodeFrame(buffer, frame), wire::Status::Ok);
+    Announce got;
+    ASSERT_TRUE(wire::decode(frame, got));
+    EXPECT_EQ(got.id, sent.id);
+    EXPECT_EQ(got.delta, -5);
+    EXPECT_TRUE(got.urgent);
+    EXPECT_EQ(got.kind, Kind::Vote);
+    EXPECT_EQ(got.origin.address, sent.origin.address);
+    EXPECT_EQ(got.origin.port, 30303);
+    EXPECT_EQ(std::vector<uint8_t>(got.body.begin(), got.body.end()), body);
+    EXPECT_EQ(got.topic, "blocks");
+    // Views point into the receive buffer
+    EXPECT_GE(got.body.data(), buffer.data());
+    EXPECT_LT(got.body.data(), buffer.data() + buffer.size());
+
+    ASSERT_EQ(got.seen.size(), seen.size());
+    EXPECT_EQ(collect(got.seen), seen);
+    std::vector<std::vector<uint8_t>> got_parts;
+    for (const auto& part : got.parts) {
+        got_parts.emplace_back(part.begin(), part.end());
+    }
+    EXPECT_EQ(got_parts, (std::vector<std::vector<uint8_t>>{first, second, third}));
+
+    // Old readers skip the fields they do not know; the type must match
+    AnnounceV0 old;
+    ASSERT_TRUE(wire::decode(frame, old));
+    EXPECT_EQ(old.id, sent.id);
+    EXPECT_EQ(old.delta, -5);
+    Numbers other;
+    EXPECT_FALSE(wire::decode(frame, other));
+}
+
+TEST(WireFormatTest, RejectsTruncatedFields) {
+    const std::vector<uint64_t> values{1, 2, 3, 4};
+    Numbers sent;
+    sent.values = wire::Seq<uint64_t>(values);
+    std::vector<uint8_t> buffer;
+    wire::encode(sent, buffer);
+    const auto payload = std::span<const uint8_t>(buffer).subspan(wire::HEADER_SIZE);
+    ASSERT_EQ(payload.size(), 4 + 4 * 8u);
+
+    // Every cut inside the count or the elements fails
+    for (size_t size = 0; size < payload.size(); ++size) {
+        Numbers got;
+        EXPECT_FALSE(wire::decode(payload.first(size), got)) << size;
+    }
+    Numbers got;
+    ASSERT_TRUE(wire::decode(payload, got));
+    EXPECT_EQ(collect(got.values), values);
+
+    // A count beyond the bytes present
+    std::vector<uint8_t> inflated(payload.begin(), payload.end());
+    inflated[0] = 5;
+    EXPECT_FALSE(wire::decode(inflated, got));
+    inflated[0] = 0xff;
+    inflated[3] = 0xff;
+    EXPECT_FALSE(wire::decode(inflated, got));
+
+    // A byte string cut one short, with nothing after it
+    Announce announce;
+    const std::vector<uint8_t> body(16, 1);
+    announce.body = body;
+    std::vector<uint8_t> encoded;
+    wire::encode(announce, encoded);
+    const size_t body_end = 8 + 4 + 1 + 2 + 6 + 4 + body.size();
+    const auto fields = std::span<const uint8_t>(encoded).subspan(wire::HEADER_SIZE);
+    Announce cut;
+    EXPECT_FALSE(wire::decode(fields.first(body_end - 1), cut));
+    EXPECT_TRUE(wire::decode(fields, cut));
+}
+
+} // namespace test
+} // namespace network
+} // namespace quids
@@ -0,0 +1,117 @@
+#include "quantum/FixedQuantumState.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace quids::quantum::test {
+
+namespace {
+
+Eigen::Matrix2cd randomUnitary2(std::mt19937& rng) {
+    std::normal_distribution<double> dist;
+    Eigen::Matrix2cd m;
+    for (Eigen::Index i = 0; i < m.size(); ++i) {
+        m.data()[i] = {dist(rng), dist(rng)};
+    }
+    return Eigen::HouseholderQR<Eigen::Matrix2cd>(m).householderQ();
+}
+
+Eigen::Matrix4cd randomUnitary4(std::mt19937& rng) {
+    std::normal_distribution<double> dist;
+    Eigen::Matrix4cd m;
+    for (Eigen::Index i = 0; i < m.size(); ++i) {
+        m.data()[i] = {dist(rng), dist(rng)};
+    }
+    return Eigen::HouseholderQR<Eigen::Matrix4cd>(m).householderQ();
+}
+
+template<std::size_t N>
+void expectMatches(const FixedQuantumState<N>& fixed, const QuantumState& dynamic) {
+    ASSERT_EQ(dynamic.size(), fixed.size());
+    EXPECT_LT((StateVector(fixed.getStateVector()) - dynamic.getStateVector()).norm(), 1e-12);
+}
+
+// Short enough that the fixed kernels unroll, and one that loops
+template<std::size_t N>
+void runRandomCircuit(unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<std::size_t> qubit(0, N - 1);
+    FixedQuantumState<N> fixed;
+    QuantumState dynamic(N);
+    for (std::size_t q = 0; q < N; ++q) {
+        fixed.applyHadamard(q);
+        dynamic.applyHadamard(q);
+    }
+    for (int step = 0; step < 60; ++step) {
+        const std::size_t a = qubit(rng);
+        std::size_t b = qubit(rng);
+        if (b == a) {
+            b = (a + 1) % N;
+        }
+        switch (step % 5) {
+        case 0: {
+            const auto g = randomUnitary2(rng);
+            fixed.applySingleQubitGate(a, g);
+            dynamic.applySingleQubitGate(a, g);
+            break;
+        }
+        case 1: {
+            const auto g = randomUnitary2(rng);
+            fixed.applyControlledGate(a, b, g);
+            dynamic.applyControlledGate(a, b, g);
+            break;
+        }
+        case 2: {
+            const auto g = randomUnitary4(rng);
+            fixed.applyTwoQubitGate(a, b, g);
+            dynamic.applyTwoQubitGate(a, b, g);
+            break;
+        }
+        case 3:
+            fixed.applyCNOT(a, b);
+            dynamic.applyCNOT(a, b);
+            break;
+        default:
+            fixed.applyPhase(a, 0.1 * step);
+            dynamic.applyPhase(a, 0.1 * step);
+            break;
+        }
+    }
+    expectMatches(fixed, dynamic);
+    EXPECT_TRUE(fixed.isValid());
+}
+
+} // namespace
+
+TEST(FixedQuantumStateTest, GatesMatchDynamicState) {
+    runRandomCircuit<2>(1);
+    runRandomCircuit<4>(2);
+    runRandomCircuit<9>(3);
+}
+
+TEST(FixedQuantumStateTest, ConvertsToAndFromDynamic) {
+    FixedQuantumState<3> fixed;
+    fixed.applyHadamard(0);
+    fixed.applyCNOT(0, 2);
+
+    const QuantumState dynamic = fixed.toDynamic();
+    EXPECT_EQ(dynamic.getNumQubits(), 3u);
+    expectMatches(fixed, dynamic);
+    EXPECT_EQ(FixedQuantumState<3>(dynamic), fixed);
+    EXPECT_THROW(FixedQuantumState<3>(QuantumState(4)), std::invalid_argument);
+}
+
+TEST(FixedQuantumStateTest, RejectsBadQubitsAndCollapsesOnMeasurement) {
+    FixedQuantumState<2> state;
+    EXPECT_THROW(state.applyHadamard(2), std::out_of_range);
+    EXPECT_THROW(state.applyControlledGate(1, 1, Eigen::Matrix2cd::Identity()), std::invalid_argument);
+    EXPECT_THROW((void)state.getAmplitude(4), std::out_of_range);
+
+    state.applyHadamard(0);
+    state.applyCNOT(0, 1);
+    const bool bit = state.measure(0, 0.25);
+    EXPECT_TRUE(bit);
+    EXPECT_NEAR(std::abs(state.getAmplitude(3)), 1.0, 1e-12);
+    EXPECT_EQ(state.getAmplitude(0), std::complex<double>(0.0, 0.0));
+}
+
+} // namespace quids::quantum::test
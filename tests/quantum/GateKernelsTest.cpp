@@ -0,0 +1,107 @@
+#include "quantum/QuantumUtils.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace quids::quantum::test {
+
+namespace {
+
+StateVector randomState(std::size_t qubits, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> dist;
+    StateVector state(std::size_t{1} << qubits);
+    for (Eigen::Index i = 0; i < state.size(); ++i) {
+        state(i) = {dist(rng), dist(rng)};
+    }
+    return state.normalized();
+}
+
+OperatorMatrix randomGate(Eigen::Index dim, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> dist;
+    OperatorMatrix m(dim, dim);
+    for (Eigen::Index i = 0; i < m.size(); ++i) {
+        m.data()[i] = {dist(rng), dist(rng)};
+    }
+    return m;
+}
+
+// The dense operator the kernels avoid building: gate on the listed qubits
+// (most significant first), identity elsewhere
+OperatorMatrix denseOperator(const OperatorMatrix& gate, const std::vector<std::size_t>& qubits,
+                             std::size_t n, std::size_t control_mask = 0) {
+    const std::size_t dim = std::size_t{1} << n;
+    OperatorMatrix full = OperatorMatrix::Zero(dim, dim);
+    std::size_t mask = 0;
+    for (auto q : qubits) mask |= std::size_t{1} << q;
+    auto sub = [&](std::size_t i) {
+        std::size_t s = 0;
+        for (auto q : qubits) s = (s << 1) | ((i >> q) & 1);
+        return s;
+    };
+    for (std::size_t r = 0; r < dim; ++r) {
+        for (std::size_t c = 0; c < dim; ++c) {
+            if ((r & ~mask) != (c & ~mask)) continue;
+            if ((c & control_mask) != control_mask) {
+                full(r, c) = r == c ? 1.0 : 0.0;
+            } else {
+                full(r, c) = gate(sub(r), sub(c));
+            }
+        }
+    }
+    return full;
+}
+
+} // namespace
+
+TEST(GateKernelsTest, MatchDenseOperators) {
+    const std::size_t n = 5;
+    for (std::size_t q = 0; q < n; ++q) {
+        StateVector state = randomState(n, 1 + q);
+        const OperatorMatrix gate = randomGate(2, 7 + q);
+        const StateVector expected = denseOperator(gate, {q}, n) * state;
+        utils::simd::applySingleQubitGate(state, gate, q);
+        EXPECT_LT((state - expected).norm(), 1e-12) << "qubit " << q;
+    }
+
+    for (auto [q1, q2] : {std::pair<std::size_t, std::size_t>{0, 1}, {1, 0}, {2, 4}, {4, 1}}) {
+        StateVector state = randomState(n, 11);
+        const OperatorMatrix gate = randomGate(4, 13);
+        const StateVector expected = denseOperator(gate, {q1, q2}, n) * state;
+        utils::simd::applyTwoQubitGate(state, gate, q1, q2);
+        EXPECT_LT((state - expected).norm(), 1e-12) << q1 << "," << q2;
+
+        StateVector controlled = randomState(n, 17);
+        const OperatorMatrix target_gate = randomGate(2, 19);
+        const StateVector expected_controlled =
+            denseOperator(target_gate, {q2}, n, std::size_t{1} << q1) * controlled;
+        utils::simd::applyControlledGate(controlled, target_gate, q1, q2);
+        EXPECT_LT((controlled - expected_controlled).norm(), 1e-12) << q1 << "," << q2;
+    }
+}
+
+TEST(GateKernelsTest, LargeStatesTakeTheParallelPath) {
+    // Past the parallel threshold: H on every qubit gives the uniform superposition
+    const std::size_t n = 16;
+    StateVector state = StateVector::Zero(std::size_t{1} << n);
+    state(0) = 1.0;
+    const OperatorMatrix h = (OperatorMatrix(2, 2) << 1, 1, 1, -1).finished() / std::sqrt(2.0);
+    for (std::size_t q = 0; q < n; ++q) {
+        utils::simd::applySingleQubitGate(state, h, q);
+    }
+    const double amplitude = 1.0 / std::sqrt(static_cast<double>(state.size()));
+    EXPECT_LT((state - StateVector::Constant(state.size(), amplitude)).norm(), 1e-9);
+
+    utils::simd::applyControlledGate(state, (OperatorMatrix(2, 2) << 1, 0, 0, -1).finished(), 15, 0);
+    EXPECT_NEAR(state(std::size_t{1} << 15 | 1).real(), -amplitude, 1e-12);
+    EXPECT_NEAR(state(1).real(), amplitude, 1e-12);
+}
+
+TEST(GateKernelsTest, RejectsBadArguments) {
+    StateVector state = randomState(3, 3);
+    EXPECT_THROW(utils::simd::applySingleQubitGate(state, randomGate(2, 1), 3), std::out_of_range);
+    EXPECT_THROW(utils::simd::applySingleQubitGate(state, randomGate(4, 1), 0), std::invalid_argument);
+    EXPECT_THROW(utils::simd::applyTwoQubitGate(state, randomGate(4, 1), 1, 1), std::invalid_argument);
+}
+
+} // namespace quids::quantum::test
@@ -0,0 +1,140 @@
+#include "quantum/MatrixProductState.hpp"
+#include "quantum/QuantumGates.hpp"
+#include "quantum/QuantumState.hpp"
+#include "quantum/QuantumUtils.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace quids::quantum::test {
+
+namespace {
+
+using Complex = std::complex<double>;
+
+StateVector randomVector(std::size_t qubits, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> dist;
+    StateVector v(std::size_t{1} << qubits);
+    for (Eigen::Index i = 0; i < v.size(); ++i) {
+        v(i) = {dist(rng), dist(rng)};
+    }
+    return v.normalized();
+}
+
+template<int N>
+Eigen::Matrix<Complex, N, N> randomUnitary(std::mt19937& rng) {
+    std::normal_distribution<double> dist;
+    Eigen::Matrix<Complex, N, N> m;
+    for (int r = 0; r < N; ++r)
+        for (int c = 0; c < N; ++c)
+            m(r, c) = {dist(rng), dist(rng)};
+    return Eigen::HouseholderQR<Eigen::Matrix<Complex, N, N>>(m).householderQ();
+}
+
+StateVector amplitudes(const MatrixProductState& mps) {
+    StateVector v(std::size_t{1} << mps.getNumQubits());
+    mps.toAmplitudes(v.data());
+    return v;
+}
+
+} // namespace
+
+TEST(MatrixProductStateTest, DecompositionRoundTrips) {
+    const StateVector v = randomVector(7, 3);
+    const MatrixProductState mps(v.data(), 7, {});
+    EXPECT_LT((amplitudes(mps) - v).norm(), 1e-10);
+    EXPECT_EQ(mps.maxBondDimension(), 8u);  // 2^(7/2), the most a 7-qubit cut needs
+    EXPECT_LT(mps.truncationError(), 1e-12);
+
+    StateVector product = StateVector::Zero(32);
+    product(0b10110) = 1.0;
+    EXPECT_EQ(MatrixProductState(product.data(), 5, {}).maxBondDimension(), 1u);
+}
+
+TEST(MatrixProductStateTest, GatesMatchTheStateVector) {
+    constexpr std::size_t n = 6;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<std::size_t> qubit(0, n - 1);
+    StateVector v = randomVector(n, 5);
+    MatrixProductState mps(v.data(), n, {});
+
+    for (int step = 0; step < 80; ++step) {
+        const std::size_t a = qubit(rng);
+        std::size_t b = qubit(rng);
+        if (b == a) {
+            b = (a + 3) % n;
+        }
+        switch (rng() % 3) {
+            case 0: {
+                const Eigen::Matrix2cd u = randomUnitary<2>(rng);
+                mps.applySingleQubitGate(a, u);
+                utils::simd::applySingleQubitGate(v, u, a);
+                break;
+            }
+            case 1: {
+                const Eigen::Matrix2cd u = randomUnitary<2>(rng);
+                mps.applyControlledGate(a, b, u);
+                utils::simd::applyControlledGate(v, u, a, b);
+                break;
+            }
+            case 2: {
+                const Eigen::Matrix4cd u = randomUnitary<4>(rng);
+                mps.applyTwoQubitGate(a, b, u);
+                utils::simd::applyTwoQubitGate(v, u, a, b);
+                break;
+            }
+        }
+    }
+    EXPECT_LT((amplitudes(mps) - v).norm(), 1e-9);
+}
+
+TEST(MatrixProductStateTest, TruncationBoundsTheBondAndKeepsTheNorm) {
+    const StateVector v = randomVector(8, 9);
+    MatrixProductState mps(v.data(), 8, {.max_bond_dimension = 2});
+    EXPECT_EQ(mps.maxBondDimension(), 2u);
+    EXPECT_GT(mps.truncationError(), 0.0);
+    EXPECT_NEAR(amplitudes(mps).norm(), 1.0, 1e-10);
+
+    mps.applyControlledGate(0, 7, gates::X);
+    EXPECT_LE(mps.maxBondDimension(), 2u);
+    EXPECT_NEAR(amplitudes(mps).norm(), 1.0, 1e-10);
+}
+
+TEST(MatrixProductStateTest, WideGhzStateStaysSmall) {
+    constexpr std::size_t n = 200;
+    MatrixProductState mps(n);
+    mps.applySingleQubitGate(0, gates::H);
+    for (std::size_t q = 0; q + 1 < n; ++q) {
+        mps.applyControlledGate(q, q + 1, gates::X);
+    }
+    EXPECT_EQ(mps.maxBondDimension(), 2u);
+    EXPECT_LT(mps.memoryBytes(), n * 8 * sizeof(Complex));
+
+    const bool first = mps.measure(n / 2, 0.3);
+    EXPECT_TRUE(first);
+    for (double u : {0.0, 0.99}) {
+        EXPECT_EQ(mps.measure(0, u), first);
+        EXPECT_EQ(mps.measure(n - 1, u), first);
+    }
+    EXPECT_THROW(mps.measure(n, 0.5), std::out_of_range);
+    EXPECT_THROW(mps.applyTwoQubitGate(1, 1, Eigen::Matrix4cd::Identity()), std::invalid_argument);
+}
+
+TEST(MatrixProductStateTest, BacksQuantumStateWithoutAHostCopy) {
+    setSimulationBackend(makeMpsBackend(), 16);
+    QuantumState state(6);
+    state.applyHadamard(0);
+    for (std::size_t q = 0; q + 1 < 6; ++q) {
+        state.applyCNOT(q, q + 1);
+    }
+    EXPECT_EQ(state.size(), 64u);
+    EXPECT_NEAR(std::abs(state.getAmplitude(0)), M_SQRT1_2, 1e-12);
+    EXPECT_NEAR(std::abs(state.getAmplitude(63)), M_SQRT1_2, 1e-12);
+
+    state.applyMeasurement(2);
+    const bool outcome = state.getMeasurementOutcomes().back();
+    EXPECT_NEAR(std::abs(state.getAmplitude(outcome ? 63 : 0)), 1.0, 1e-12);
+    setSimulationBackend(nullptr);
+}
+
+} // namespace quids::quantum::test
@@ -0,0 +1,51 @@
+#include "quantum/QKDKeyPool.hpp"
+#include <gtest/gtest.h>
+
+namespace quantum::test {
+
+namespace {
+
+QKDKeyPool::Config smallPool() {
+    QKDKeyPool::Config config;
+    config.capacityBytes = 4096;
+    config.lowWatermarkBytes = 2048;
+    config.chunkLength = 8192;
+    return config;
+}
+
+} // namespace
+
+TEST(QKDKeyPoolTest, FillsInTheBackgroundAndHandsOutBytesOnce) {
+    QKDKeyPool pool("test-fill", smallPool());
+    EXPECT_FALSE(pool.take(16).has_value());
+    EXPECT_EQ(pool.stats().shortfalls, 1u);
+
+    pool.start();
+    ASSERT_TRUE(pool.waitFor(4096, std::chrono::seconds(30)));
+    const auto first = pool.take(1024);
+    const auto second = pool.take(1024);
+    ASSERT_TRUE(first && second);
+    EXPECT_EQ(first->size(), 1024u);
+    EXPECT_NE(*first, *second);
+
+    // Below the watermark the pool tops itself back up
+    ASSERT_TRUE(pool.take(1024));
+    ASSERT_TRUE(pool.waitFor(4096, std::chrono::seconds(30)));
+    const auto stats = pool.stats();
+    EXPECT_EQ(stats.availableBytes, 4096u);
+    EXPECT_EQ(stats.consumedBytes, 3072u);
+    EXPECT_EQ(stats.producedBytes, stats.consumedBytes + stats.availableBytes);
+    EXPECT_FALSE(pool.take(5000).has_value());
+    pool.stop();
+
+    const std::string scrape = quids::utils::MetricsRegistry::global().scrape();
+    EXPECT_NE(scrape.find("quids_qkd_pool_available_bytes{channel=\"test-fill\"} 4096"), std::string::npos);
+}
+
+TEST(QKDKeyPoolTest, RejectsWatermarkAboveCapacity) {
+    QKDKeyPool::Config config = smallPool();
+    config.lowWatermarkBytes = config.capacityBytes + 1;
+    EXPECT_THROW(QKDKeyPool("test-bad", config), std::invalid_argument);
+}
+
+} // namespace quantum::test
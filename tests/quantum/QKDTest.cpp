@@ -0,0 +1,83 @@
+#include "quantum/QKD.hpp"
+#include <gtest/gtest.h>
+
+namespace quantum::test {
+
+namespace {
+
+KeyBits randomBits(size_t length, uint64_t stream) {
+    return quids::utils::Philox(2024, stream).bits(length);
+}
+
+} // namespace
+
+TEST(QKDTest, SiftingKeepsMatchingBases) {
+    QKD qkd;
+    const KeyBits raw = randomBits(300, 1);
+    const KeyBits alice = randomBits(300, 2);
+    const KeyBits bob = randomBits(300, 3);
+
+    const KeyBits sifted = qkd.siftKeys(alice, bob, raw);
+    size_t at = 0;
+    for (size_t i = 0; i < raw.size; ++i) {
+        if (alice[i] == bob[i]) {
+            ASSERT_LT(at, sifted.size);
+            EXPECT_EQ(sifted[at++], raw[i]);
+        }
+    }
+    EXPECT_EQ(at, sifted.size);
+}
+
+TEST(QKDTest, CascadeRepairsChannelErrors) {
+    QKD qkd;
+    const KeyBits alice = randomBits(20000, 4);
+    KeyBits bob = alice;
+    quids::utils::Philox rng(7, 0);
+    size_t injected = 0;
+    for (size_t i = 0; i < bob.size; ++i) {
+        if (rng.uniform() < 0.03) {
+            bob.words[i >> 6] ^= uint64_t{1} << (i & 63);
+            ++injected;
+        }
+    }
+
+    const auto stats = qkd.correctErrors(alice, bob, 0.03);
+    EXPECT_EQ(bob.words, alice.words);
+    EXPECT_EQ(stats.correctedErrors, injected);
+    EXPECT_LT(stats.disclosedBits, alice.size / 2);
+}
+
+TEST(QKDTest, PrivacyAmplificationIsToeplitzProduct) {
+    QKD qkd;
+    const size_t n = 333;
+    const size_t m = 129;
+    const KeyBits key = randomBits(n, 5);
+    const KeyBits seed = randomBits(n + m - 1, 6);
+
+    const KeyBits hashed = qkd.privacyAmplification(key, m, seed);
+    ASSERT_EQ(hashed.size, m);
+    for (size_t i = 0; i < m; ++i) {
+        bool bit = false;
+        for (size_t j = 0; j < n; ++j) {
+            bit ^= seed[i + n - 1 - j] && key[j];
+        }
+        EXPECT_EQ(hashed[i], bit) << "bit " << i;
+    }
+}
+
+TEST(QKDTest, StreamsKeyInChunks) {
+    QKD qkd(0.02);
+    size_t chunks = 0;
+    size_t total = 0;
+    qkd.streamKey(20000, [&](const KeyBits& chunk) {
+        ++chunks;
+        total += chunk.size;
+    }, 8192);
+    EXPECT_GT(chunks, 1u);
+    EXPECT_EQ(total, 20000u);
+    EXPECT_EQ(qkd.generateKey(1000).size, 1000u);
+
+    EXPECT_THROW(QKD(0.2), std::invalid_argument);
+}
+
+} // namespace quantum::test
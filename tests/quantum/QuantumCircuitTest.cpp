@@ -0,0 +1,188 @@
+#include "quantum/QuantumCircuit.hpp"
+#include "quantum/QuantumUtils.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+namespace quids::quantum::test {
+
+namespace {
+
+QuantumState randomState(std::size_t qubits, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> dist;
+    StateVector v(std::size_t{1} << qubits);
+    for (Eigen::Index i = 0; i < v.size(); ++i) {
+        v(i) = {dist(rng), dist(rng)};
+    }
+    return QuantumState(v);
+}
+
+OperatorMatrix rotation(double angle) {
+    return (OperatorMatrix(2, 2) << std::cos(angle), -std::sin(angle),
+                                    std::sin(angle), std::cos(angle)).finished();
+}
+
+// The gates of buildCircuit, one kernel call each, with no compilation
+StateVector reference(const QuantumState& initial, std::size_t n) {
+    StateVector v = initial.getStateVector();
+    for (std::size_t q = 0; q < n; ++q) {
+        utils::simd::applySingleQubitGate(v, gates::HADAMARD, q);
+        utils::simd::applySingleQubitGate(v, rotation(0.1 * (q + 1)), q);
+    }
+    for (std::size_t q = 0; q + 1 < n; ++q) {
+        utils::simd::applyControlledGate(v, gates::PAULI_X, q, q + 1);
+        utils::simd::applySingleQubitGate(v, gates::PAULI_Z, q + 1);
+    }
+    if (n > 1) {
+        utils::simd::applyControlledGate(v, gates::PAULI_Z, n - 1, 0);
+    }
+    for (std::size_t q = 0; q < n; ++q) {
+        utils::simd::applySingleQubitGate(v, rotation(-0.2 * q), q);
+    }
+    return v;
+}
+
+void buildCircuit(QuantumCircuit& circuit) {
+    const std::size_t n = circuit.numQubits();
+    for (std::size_t q = 0; q < n; ++q) {
+        circuit.addGate(GateType::HADAMARD, q);
+        circuit.addCustomGate(rotation(0.1 * (q + 1)), q);
+    }
+    for (std::size_t q = 0; q + 1 < n; ++q) {
+        circuit.addControlledGate(GateType::CNOT, q, q + 1);
+        circuit.addGate(GateType::PAULI_Z, q + 1);
+    }
+    if (n > 1) {
+        circuit.addControlledGate(GateType::PAULI_Z, n - 1, 0);
+    }
+    for (std::size_t q = 0; q < n; ++q) {
+        circuit.addCustomGate(rotation(-0.2 * q), q);
+    }
+}
+
+} // namespace
+
+TEST(QuantumCircuitTest, CompiledCircuitMatchesGateByGate) {
+    // 15 qubits also takes the neighbouring-qubit pairing pass
+    for (std::size_t n : {1, 2, 5, 15}) {
+        QuantumCircuit circuit(n);
+        buildCircuit(circuit);
+        const QuantumState initial = randomState(n, static_cast<unsigned>(n));
+        const StateVector expected = reference(initial, n);
+
+        EXPECT_LT((circuit.execute(initial).getStateVector() - expected).norm(), 1e-10) << n;
+
+        const std::size_t before = circuit.size();
+        circuit.optimize();
+        EXPECT_LT(circuit.size(), before);
+        EXPECT_LT((circuit.execute(initial).getStateVector() - expected).norm(), 1e-10) << n;
+    }
+}
+
+TEST(QuantumCircuitTest, AdjacentInversesCancel) {
+    QuantumCircuit circuit(3);
+    circuit.addGate(GateType::HADAMARD, 0);
+    circuit.addControlledGate(GateType::CNOT, 1, 2);  // commutes past the H pair
+    circuit.addGate(GateType::HADAMARD, 0);
+    circuit.addControlledGate(GateType::CNOT, 1, 2);
+    circuit.addControlledGate(GateType::SWAP, 0, 2);
+    circuit.addControlledGate(GateType::SWAP, 2, 0);
+    circuit.optimize();
+    EXPECT_EQ(circuit.size(), 0u) << circuit.toString();
+
+    // A measurement in between blocks the cancellation
+    QuantumCircuit measured(1);
+    measured.addGate(GateType::PAULI_X, 0);
+    measured.addMeasurement(0);
+    measured.addGate(GateType::PAULI_X, 0);
+    measured.optimize();
+    EXPECT_EQ(measured.size(), 3u);
+    EXPECT_EQ(measured.measure(), std::vector<bool>{false});
+}
+
+TEST(QuantumCircuitTest, CompiledOnceByStructure) {
+    QuantumCircuit::clearCompileCache();
+    const QuantumState initial = randomState(4, 9);
+    for (int round = 0; round < 3; ++round) {
+        // Rebuilt each round, as callers with fixed circuits do
+        QuantumCircuit circuit(4);
+        buildCircuit(circuit);
+        (void)circuit.execute(initial);
+    }
+    const auto stats = QuantumCircuit::compileCacheStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 2u);
+}
+
+TEST(QuantumCircuitTest, RepeatedExecutionHitsResultCache) {
+    QuantumCircuit::clearResultCache();
+    QuantumCircuit circuit(4);
+    buildCircuit(circuit);
+    const QuantumState initial = randomState(4, 11);
+
+    const QuantumState first = circuit.execute(initial);
+    const QuantumState again = circuit.execute(QuantumState(initial.getStateVector()));
+    EXPECT_EQ(&first.getStateVector(), &again.getStateVector());
+    (void)circuit.execute(randomState(4, 12));
+    auto stats = QuantumCircuit::resultCacheStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.entries, 2u);
+
+    // Measurements are random, so those circuits always run
+    circuit.addMeasurement(0);
+    (void)circuit.execute(initial);
+    (void)circuit.execute(initial);
+    stats = QuantumCircuit::resultCacheStats();
+    EXPECT_EQ(stats.hits + stats.misses, 3u);
+}
+
+TEST(QuantumCircuitTest, CliffordCircuitsMeasureOnTheTableau) {
+    QuantumCircuit circuit(4);
+    circuit.addGate(GateType::PAULI_X, 0);
+    circuit.addControlledGate(GateType::CNOT, 0, 1);
+    circuit.addGate(GateType::HADAMARD, 2);
+    circuit.addGate(GateType::PHASE, 2);
+    circuit.addGate(GateType::PHASE, 2);
+    circuit.addGate(GateType::HADAMARD, 2);  // HZH = X
+    circuit.addCustomGate(rotation(M_PI / 2), 3);
+    circuit.addCustomGate(rotation(M_PI / 2), 3);  // -I
+    EXPECT_TRUE(circuit.isClifford());
+    EXPECT_EQ(circuit.measure(), (std::vector<bool>{true, true, true, false}));
+
+    circuit.optimize();
+    EXPECT_TRUE(circuit.isClifford());
+    circuit.addCustomGate(rotation(0.1), 3);
+    EXPECT_FALSE(circuit.isClifford());
+    EXPECT_EQ(circuit.measure().size(), 4u);
+    circuit.clear();
+    EXPECT_TRUE(circuit.isClifford());
+
+    // Past the state-vector limit only Clifford gates are taken
+    QuantumCircuit wide(200);
+    wide.addGate(GateType::HADAMARD, 0);
+    for (std::size_t q = 0; q + 1 < 200; ++q) {
+        wide.addControlledGate(GateType::CNOT, q, q + 1);
+    }
+    const auto outcomes = wide.measure();
+    ASSERT_EQ(outcomes.size(), 200u);
+    EXPECT_TRUE(std::all_of(outcomes.begin(), outcomes.end(), [&](bool b) { return b == outcomes[0]; }));
+    EXPECT_THROW(wide.addCustomGate(rotation(0.1), 0), std::invalid_argument);
+    EXPECT_TRUE(wide.isClifford());
+    EXPECT_EQ(wide.size(), 200u);
+    EXPECT_THROW((void)wide.execute(QuantumState(1)), std::invalid_argument);
+    EXPECT_THROW(QuantumCircuit(5000), std::invalid_argument);
+}
+
+TEST(QuantumCircuitTest, RejectsInvalidGates) {
+    QuantumCircuit circuit(2);
+    EXPECT_THROW(circuit.addGate(GateType::HADAMARD, 2), std::out_of_range);
+    EXPECT_THROW(circuit.addGate(GateType::CNOT, 0), std::invalid_argument);
+    EXPECT_THROW(circuit.addControlledGate(GateType::CNOT, 1, 1), std::invalid_argument);
+    EXPECT_THROW(circuit.addCustomGate(OperatorMatrix::Ones(2, 2), 0), std::invalid_argument);
+    EXPECT_THROW((void)circuit.execute(QuantumState(3)), std::invalid_argument);
+    EXPECT_TRUE(circuit.validate());
+}
+
+} // namespace quids::quantum::test
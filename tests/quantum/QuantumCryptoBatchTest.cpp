@@ -0,0 +1,45 @@
+#include "quantum/QuantumCrypto.hpp"
+#include "crypto/signature/Falcon.hpp"
+#include <gtest/gtest.h>
+
+namespace quids::quantum::test {
+
+TEST(QuantumCryptoBatchTest, SignsAndVerifiesManyMessagesUnderOneKey) {
+    QuantumCrypto quantum_crypto{QuantumEncryptionParams{}};
+    crypto::FalconSigner signer;
+    signer.generateKeyPair();
+
+    const std::vector<std::vector<uint8_t>> messages{{1, 2, 3}, {4, 5}, {6}};
+    auto signatures = quantum_crypto.signMany(messages, signer.getPrivateKey());
+    ASSERT_EQ(signatures.size(), messages.size());
+    for (const auto& signature : signatures) {
+        EXPECT_EQ(signature.scheme, SignatureScheme::FALCON);
+    }
+
+    EXPECT_EQ(quantum_crypto.verifyMany(messages, signatures, signer.getPublicKey()),
+              (std::vector<uint8_t>{1, 1, 1}));
+
+    signatures[1].sig_data[10] ^= 0x01;
+    EXPECT_EQ(quantum_crypto.verifyMany(messages, signatures, signer.getPublicKey()),
+              (std::vector<uint8_t>{1, 0, 1}));
+}
+
+TEST(QuantumCryptoBatchTest, SingleSignatureMatchesTheBatchPath) {
+    QuantumCrypto quantum_crypto{QuantumEncryptionParams{}};
+    crypto::FalconSigner signer;
+    signer.generateKeyPair();
+
+    const std::vector<uint8_t> message{7, 8, 9};
+    const auto signature = quantum_crypto.sign(message, signer.getPrivateKey());
+    EXPECT_EQ(signature.scheme, SignatureScheme::FALCON);
+    EXPECT_TRUE(signer.verify(message, signature.sig_data, signer.getPublicKey()));
+}
+
+TEST(QuantumCryptoBatchTest, RejectsMismatchedLengths) {
+    QuantumCrypto quantum_crypto{QuantumEncryptionParams{}};
+    const std::vector<std::vector<uint8_t>> messages{{1}, {2}};
+    const std::vector<QuantumSignature> signatures(1);
+    EXPECT_THROW((void)quantum_crypto.verifyMany(messages, signatures, {}), std::invalid_argument);
+}
+
+} // namespace quids::quantum::test
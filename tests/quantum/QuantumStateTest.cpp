@@ -0,0 +1,53 @@
+#include "quantum/QuantumState.hpp"
+#include <gtest/gtest.h>
+
+namespace quids::quantum::test {
+
+TEST(QuantumStateTest, CopiesShareUntilWritten) {
+    const QuantumState original(4);
+    QuantumState copy = original;
+    EXPECT_EQ(&original.getStateVector(), &copy.getStateVector());
+
+    copy.applyHadamard(0);
+    EXPECT_NE(&original.getStateVector(), &copy.getStateVector());
+    EXPECT_EQ(original.getAmplitude(0), std::complex<double>(1.0, 0.0));
+    EXPECT_NEAR(std::abs(copy.getAmplitude(1)), 1.0 / std::sqrt(2.0), 1e-12);
+    EXPECT_FALSE(original == copy);
+}
+
+TEST(QuantumStateTest, DescriptorTracksAmplitudes) {
+    QuantumState a(3);
+    const QuantumState b(3);
+    EXPECT_EQ(a.describe(), b.describe());
+    EXPECT_EQ(a.describe().num_qubits, 3u);
+    EXPECT_NEAR(a.describe().norm, 1.0, 1e-12);
+
+    a.applyPhase(0, 0.5);
+    a.applyHadamard(1);
+    EXPECT_NE(a.describe().fingerprint, b.describe().fingerprint);
+    EXPECT_NEAR(a.normalizedVector().norm(), 1.0, 1e-12);
+}
+
+TEST(QuantumStateTest, MetricsFollowTheState) {
+    // Large enough for the chunked reduction
+    constexpr std::size_t qubits = 17;
+    QuantumState state(qubits);
+    EXPECT_DOUBLE_EQ(state.getEntropy(), 0.0);
+    EXPECT_DOUBLE_EQ(state.getCoherence(), 0.0);
+    EXPECT_DOUBLE_EQ(state.computeMetrics().max_probability, 1.0);
+
+    for (std::size_t q = 0; q < qubits; ++q) {
+        state.applyHadamard(q);
+    }
+    const auto& metrics = state.computeMetrics();
+    EXPECT_NEAR(metrics.norm, 1.0, 1e-9);
+    EXPECT_NEAR(metrics.entropy, static_cast<double>(qubits), 1e-9);
+    EXPECT_NEAR(metrics.coherence, 1.0, 1e-9);
+    EXPECT_NEAR(metrics.max_probability, 1.0 / static_cast<double>(state.size()), 1e-15);
+    EXPECT_EQ(state.getEntropy(), state.calculateEntropy());
+
+    state.applyMeasurement(0);
+    EXPECT_NEAR(state.getEntropy(), static_cast<double>(qubits - 1), 1e-9);
+}
+
+} // namespace quids::quantum::test
@@ -0,0 +1,187 @@
+#include "quantum/QuantumCircuit.hpp"
+#include "quantum/SimulationBackend.hpp"
+#include "quantum/StateBatch.hpp"
+#include <gtest/gtest.h>
+
+namespace quids::quantum::test {
+
+namespace {
+
+using Complex = std::complex<double>;
+
+// Backend that keeps its "device" memory on the host and counts traffic
+class HostBackend : public SimulationBackend {
+public:
+    struct HostBuffer : Buffer {
+        std::size_t num_qubits;
+        std::size_t batch;
+        std::vector<Complex> a;
+    };
+
+    std::size_t uploads{0};
+    std::size_t downloads{0};
+    std::size_t gates{0};
+
+    const char* name() const noexcept override { return "host"; }
+
+    std::unique_ptr<Buffer> upload(const Complex* amplitudes, std::size_t num_qubits, std::size_t batch) override {
+        ++uploads;
+        auto b = std::make_unique<HostBuffer>();
+        b->num_qubits = num_qubits;
+        b->batch = batch;
+        b->a.assign(amplitudes, amplitudes + (std::size_t{1} << num_qubits) * batch);
+        return b;
+    }
+
+    void download(const Buffer& buffer, Complex* amplitudes) override {
+        ++downloads;
+        const auto& b = static_cast<const HostBuffer&>(buffer);
+        std::copy(b.a.begin(), b.a.end(), amplitudes);
+    }
+
+    void applySingleQubitGate(Buffer& buffer, const Eigen::Matrix2cd& g, std::size_t q) override {
+        ++gates;
+        auto& b = static_cast<HostBuffer&>(buffer);
+        forPairs(b, std::size_t{1} << q, 0, [&](Complex& x, Complex& y) {
+            const Complex x0 = x;
+            x = g(0, 0) * x0 + g(0, 1) * y;
+            y = g(1, 0) * x0 + g(1, 1) * y;
+        });
+    }
+
+    void applyTwoQubitGate(Buffer& buffer, const Eigen::Matrix4cd& g, std::size_t q1, std::size_t q2) override {
+        ++gates;
+        auto& b = static_cast<HostBuffer&>(buffer);
+        const std::size_t m1 = std::size_t{1} << q1;
+        const std::size_t m2 = std::size_t{1} << q2;
+        for (std::size_t i = 0; i < (std::size_t{1} << b.num_qubits); ++i) {
+            if (i & (m1 | m2)) {
+                continue;
+            }
+            const std::size_t idx[4] = {i, i | m2, i | m1, i | m1 | m2};
+            for (std::size_t k = 0; k < b.batch; ++k) {
+                Complex x[4];
+                for (int c = 0; c < 4; ++c) {
+                    x[c] = b.a[idx[c] * b.batch + k];
+                }
+                for (int r = 0; r < 4; ++r) {
+                    b.a[idx[r] * b.batch + k] = g(r, 0) * x[0] + g(r, 1) * x[1] + g(r, 2) * x[2] + g(r, 3) * x[3];
+                }
+            }
+        }
+    }
+
+    void applyControlledGate(Buffer& buffer, const Eigen::Matrix2cd& g, std::size_t c, std::size_t t) override {
+        ++gates;
+        auto& b = static_cast<HostBuffer&>(buffer);
+        forPairs(b, std::size_t{1} << t, std::size_t{1} << c, [&](Complex& x, Complex& y) {
+            const Complex x0 = x;
+            x = g(0, 0) * x0 + g(0, 1) * y;
+            y = g(1, 0) * x0 + g(1, 1) * y;
+        });
+    }
+
+    std::vector<bool> measure(Buffer& buffer, std::size_t q, const std::vector<double>& uniforms) override {
+        auto& b = static_cast<HostBuffer&>(buffer);
+        const std::size_t bit = std::size_t{1} << q;
+        std::vector<bool> outcomes(b.batch);
+        for (std::size_t k = 0; k < b.batch; ++k) {
+            double p1 = 0.0;
+            for (std::size_t i = bit; i < (std::size_t{1} << b.num_qubits); i = (i + 1) | bit) {
+                p1 += std::norm(b.a[i * b.batch + k]);
+            }
+            outcomes[k] = uniforms[k] < p1;
+            const double scale = 1.0 / std::sqrt(outcomes[k] ? p1 : 1.0 - p1);
+            for (std::size_t i = 0; i < (std::size_t{1} << b.num_qubits); ++i) {
+                Complex& x = b.a[i * b.batch + k];
+                x = (((i & bit) != 0) == outcomes[k]) ? x * scale : Complex{};
+            }
+        }
+        return outcomes;
+    }
+
+private:
+    template<typename F>
+    static void forPairs(HostBuffer& b, std::size_t partner, std::size_t required, F&& f) {
+        for (std::size_t i = 0; i < (std::size_t{1} << b.num_qubits); ++i) {
+            if ((i & partner) || (i & required) != required) {
+                continue;
+            }
+            for (std::size_t k = 0; k < b.batch; ++k) {
+                f(b.a[i * b.batch + k], b.a[(i | partner) * b.batch + k]);
+            }
+        }
+    }
+};
+
+class SimulationBackendTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        backend_ = std::make_shared<HostBackend>();
+        // Offload from 3 qubits so the test states are large enough
+        setSimulationBackend(backend_, 8);
+    }
+
+    void TearDown() override { setSimulationBackend(nullptr); }
+
+    std::shared_ptr<HostBackend> backend_;
+};
+
+} // namespace
+
+TEST_F(SimulationBackendTest, SmallStatesStayOnHost) {
+    QuantumState state(2);
+    state.applyHadamard(0);
+    EXPECT_EQ(backend_->uploads, 0u);
+}
+
+TEST_F(SimulationBackendTest, CircuitRunsOnBackendAndMatchesHost) {
+    QuantumCircuit circuit(4);
+    circuit.addGate(GateType::HADAMARD, 0);
+    circuit.addGate(GateType::HADAMARD, 2);
+    circuit.addControlledGate(GateType::CNOT, 0, 3);
+    circuit.addControlledGate(GateType::SWAP, 1, 2);
+    circuit.addGate(GateType::PAULI_Y, 3);
+
+    const QuantumState offloaded = circuit.execute(QuantumState(4));
+    EXPECT_EQ(backend_->uploads, 1u);
+    EXPECT_GT(backend_->gates, 0u);
+
+    setSimulationBackend(nullptr);
+    QuantumCircuit::clearResultCache();
+    const QuantumState host = circuit.execute(QuantumState(4));
+    for (std::size_t i = 0; i < host.size(); ++i) {
+        EXPECT_NEAR(std::abs(offloaded.getAmplitude(i) - host.getAmplitude(i)), 0.0, 1e-12);
+    }
+    EXPECT_EQ(backend_->downloads, 1u);
+}
+
+TEST_F(SimulationBackendTest, MeasurementKeepsAmplitudesOnDevice) {
+    QuantumState state(3);
+    state.applyHadamard(1);
+    state.applyMeasurement(1);
+    state.applyMeasurement(1);
+    EXPECT_EQ(backend_->downloads, 0u);
+
+    const auto outcomes = state.getMeasurementOutcomes();
+    ASSERT_EQ(outcomes.size(), 2u);
+    EXPECT_EQ(outcomes[0], outcomes[1]);
+    EXPECT_NEAR(std::abs(state.getAmplitude(outcomes[0] ? 2 : 0)), 1.0, 1e-12);
+    EXPECT_EQ(backend_->downloads, 1u);
+}
+
+TEST_F(SimulationBackendTest, BatchOffloadsAsOneBuffer) {
+    StateBatch batch(2, 16);
+    batch.applyHadamard(0);
+    batch.applyCNOT(0, 1);
+    const auto outcomes = batch.applyMeasurement(0);
+    EXPECT_EQ(backend_->uploads, 1u);
+    EXPECT_EQ(backend_->downloads, 0u);
+
+    for (std::size_t k = 0; k < batch.size(); ++k) {
+        EXPECT_NEAR(std::abs(batch.getAmplitude(k, outcomes[k] ? 3 : 0)), 1.0, 1e-12);
+    }
+    EXPECT_EQ(backend_->downloads, 1u);
+}
+
+} // namespace quids::quantum::test
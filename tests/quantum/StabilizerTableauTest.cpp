@@ -0,0 +1,111 @@
+#include "quantum/StabilizerTableau.hpp"
+#include "quantum/QuantumGates.hpp"
+#include "quantum/QuantumUtils.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace quids::quantum::test {
+
+namespace {
+
+double probabilityOne(const StateVector& v, std::size_t qubit) {
+    double p = 0.0;
+    for (Eigen::Index i = 0; i < v.size(); ++i) {
+        if ((static_cast<std::size_t>(i) >> qubit) & 1) {
+            p += std::norm(v(i));
+        }
+    }
+    return p;
+}
+
+void project(StateVector& v, std::size_t qubit, bool outcome) {
+    for (Eigen::Index i = 0; i < v.size(); ++i) {
+        if ((((static_cast<std::size_t>(i) >> qubit) & 1) != 0) != outcome) {
+            v(i) = 0.0;
+        }
+    }
+    v.normalize();
+}
+
+// What the state vector says a Z measurement of qubit would give
+std::optional<bool> certainOutcome(const StateVector& v, std::size_t qubit) {
+    const double p = probabilityOne(v, qubit);
+    if (p < 1e-9) {
+        return false;
+    }
+    if (p > 1.0 - 1e-9) {
+        return true;
+    }
+    EXPECT_NEAR(p, 0.5, 1e-9);
+    return std::nullopt;
+}
+
+} // namespace
+
+TEST(StabilizerTableauTest, MatchesStateVectorOnRandomCliffords) {
+    constexpr std::size_t n = 5;
+    for (unsigned seed = 0; seed < 25; ++seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::size_t> qubit(0, n - 1);
+        StabilizerTableau tableau(n);
+        StateVector v = StateVector::Zero(std::size_t{1} << n);
+        v(0) = 1.0;
+
+        for (int step = 0; step < 60; ++step) {
+            const std::size_t a = qubit(rng);
+            std::size_t b = qubit(rng);
+            if (b == a) {
+                b = (a + 1) % n;
+            }
+            switch (rng() % 9) {
+                case 0: tableau.applyHadamard(a); utils::simd::applySingleQubitGate(v, gates::H, a); break;
+                case 1: tableau.applyPhase(a); utils::simd::applySingleQubitGate(v, gates::S, a); break;
+                case 2: tableau.applyPauliX(a); utils::simd::applySingleQubitGate(v, gates::X, a); break;
+                case 3: tableau.applyPauliY(a); utils::simd::applySingleQubitGate(v, gates::Y, a); break;
+                case 4: tableau.applyPauliZ(a); utils::simd::applySingleQubitGate(v, gates::Z, a); break;
+                case 5: tableau.applyCNOT(a, b); utils::simd::applyControlledGate(v, gates::X, a, b); break;
+                case 6: tableau.applyCZ(a, b); utils::simd::applyControlledGate(v, gates::Z, a, b); break;
+                case 7:
+                    tableau.applySwap(a, b);
+                    utils::simd::applyControlledGate(v, gates::X, a, b);
+                    utils::simd::applyControlledGate(v, gates::X, b, a);
+                    utils::simd::applyControlledGate(v, gates::X, a, b);
+                    break;
+                case 8: {
+                    const auto expected = certainOutcome(v, a);
+                    EXPECT_EQ(tableau.peekMeasurement(a), expected) << "seed " << seed << " step " << step;
+                    const bool outcome = tableau.measure(a);
+                    if (expected) {
+                        EXPECT_EQ(outcome, *expected);
+                    }
+                    project(v, a, outcome);
+                    break;
+                }
+            }
+        }
+        for (std::size_t q = 0; q < n; ++q) {
+            EXPECT_EQ(tableau.peekMeasurement(q), certainOutcome(v, q)) << "seed " << seed << " qubit " << q;
+        }
+    }
+}
+
+TEST(StabilizerTableauTest, WideGhzStateIsCorrelated) {
+    constexpr std::size_t n = 300;
+    for (int run = 0; run < 8; ++run) {
+        StabilizerTableau tableau(n);
+        tableau.applyHadamard(0);
+        for (std::size_t q = 0; q + 1 < n; ++q) {
+            tableau.applyCNOT(q, q + 1);
+        }
+        EXPECT_FALSE(tableau.peekMeasurement(n - 1));
+        const bool first = tableau.measure(0);
+        EXPECT_EQ(tableau.peekMeasurement(n - 1), first);
+        for (std::size_t q = 1; q < n; ++q) {
+            EXPECT_EQ(tableau.measure(q), first);
+        }
+    }
+    EXPECT_THROW(StabilizerTableau(0), std::invalid_argument);
+    EXPECT_THROW((void)StabilizerTableau(3).measure(3), std::out_of_range);
+}
+
+} // namespace quids::quantum::test
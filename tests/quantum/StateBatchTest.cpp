@@ -0,0 +1,113 @@
+#include "quantum/StateBatch.hpp"
+#include "utils/RandomService.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace quids::quantum::test {
+
+namespace {
+
+QuantumState randomState(std::size_t qubits, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> dist;
+    StateVector v(std::size_t{1} << qubits);
+    for (Eigen::Index i = 0; i < v.size(); ++i) {
+        v(i) = {dist(rng), dist(rng)};
+    }
+    return QuantumState(v);
+}
+
+} // namespace
+
+TEST(StateBatchTest, MatchesPerStateSimulation) {
+    // Large enough that gates are split across the pool
+    constexpr std::size_t qubits = 10;
+    constexpr std::size_t count = 33;
+    std::vector<QuantumState> states;
+    for (std::size_t k = 0; k < count; ++k) {
+        states.push_back(randomState(qubits, static_cast<unsigned>(k)));
+    }
+
+    StateBatch batch(states);
+    ASSERT_EQ(batch.size(), count);
+    for (std::size_t q = 0; q < qubits; ++q) {
+        batch.applyHadamard(q);
+        batch.applyPhase(q, 0.3 * static_cast<double>(q + 1));
+    }
+    batch.applyCNOT(2, 7);
+    batch.applyCNOT(9, 0);
+
+    for (std::size_t k = 0; k < count; ++k) {
+        QuantumState expected = states[k];
+        for (std::size_t q = 0; q < qubits; ++q) {
+            expected.applyHadamard(q);
+            expected.applyPhase(q, 0.3 * static_cast<double>(q + 1));
+        }
+        expected.applyCNOT(2, 7);
+        expected.applyCNOT(9, 0);
+
+        const auto& v = expected.getStateVector();
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_NEAR(std::abs(batch.getAmplitude(k, i) - v(static_cast<Eigen::Index>(i))), 0.0, 1e-12);
+        }
+    }
+}
+
+TEST(StateBatchTest, MeasurementCollapsesEachState) {
+    StateBatch batch(3, 64);
+    batch.applyHadamard(1);
+    const auto outcomes = batch.applyMeasurement(1);
+    ASSERT_EQ(outcomes.size(), 64u);
+
+    for (std::size_t k = 0; k < batch.size(); ++k) {
+        const std::size_t kept = outcomes[k] ? 2 : 0;
+        EXPECT_NEAR(std::abs(batch.getAmplitude(k, kept)), 1.0, 1e-12);
+        EXPECT_NEAR(batch.extract(k).getStateVector().norm(), 1.0, 1e-12);
+    }
+    EXPECT_THROW(batch.applyMeasurement(3), std::out_of_range);
+}
+
+TEST(StateBatchTest, MeasurementsReplayAfterReseed) {
+    auto measure = [] {
+        StateBatch batch(2, 128);
+        batch.applyHadamard(0);
+        return batch.applyMeasurement(0);
+    };
+    auto& random = ::quids::utils::RandomService::global();
+    random.reseed(2024);
+    const auto first = measure();
+    random.reseed(2024);
+    EXPECT_EQ(measure(), first);
+    random.reseed(2025);
+    EXPECT_NE(measure(), first);
+}
+
+TEST(StateBatchTest, RejectsMixedQubitCounts) {
+    std::vector<QuantumState> states{QuantumState(2), QuantumState(3)};
+    EXPECT_THROW(StateBatch{states}, std::invalid_argument);
+}
+
+TEST(StateBatchTest, PerStateRotationsAndZReadout) {
+    constexpr std::size_t count = 5;
+    StateBatch batch(2, count);
+    std::vector<double> angles;
+    for (std::size_t k = 0; k < count; ++k) {
+        angles.push_back(0.4 * static_cast<double>(k));
+    }
+    batch.applyRotationY(0, angles);
+    batch.applyCNOT(0, 1);
+    batch.applyPhase(1, angles);
+
+    // RY(t)|0> gives <Z> = cos t; the CNOT copies it, the phase keeps it
+    const Eigen::MatrixXd z = batch.expectationZ();
+    ASSERT_EQ(z.rows(), static_cast<Eigen::Index>(count));
+    ASSERT_EQ(z.cols(), 2);
+    for (std::size_t k = 0; k < count; ++k) {
+        const auto row = static_cast<Eigen::Index>(k);
+        EXPECT_NEAR(z(row, 0), std::cos(angles[k]), 1e-12);
+        EXPECT_NEAR(z(row, 1), std::cos(angles[k]), 1e-12);
+    }
+    EXPECT_THROW(batch.applyRotationY(0, std::span(angles).first(2)), std::invalid_argument);
+}
+
+} // namespace quids::quantum::test
@@ -0,0 +1,41 @@
+#include "quantum/QuantumConsensus.hpp"
+#include "utils/RandomService.hpp"
+#include <gtest/gtest.h>
+
+namespace quids::quantum::consensus::test {
+
+TEST(VoteTallyTest, CountsFirstVotePerParty) {
+    const vector<Vote> votes = {{0, 1}, {1, 0}, {0, 0}, {2, 1}, {7, 1}, {1, 5}, {3, 1}};
+    const auto tally = tallyVotes(votes, 4, 2, 0.75);
+
+    EXPECT_EQ(tally.counts, (vector<size_t>{1, 3}));
+    EXPECT_EQ(tally.duplicates, 1u);
+    EXPECT_EQ(tally.invalid, 2u);
+    ASSERT_TRUE(tally.winner.has_value());
+    EXPECT_EQ(*tally.winner, 1u);
+}
+
+TEST(VoteTallyTest, StopsOnceTheOutcomeIsDecided) {
+    constexpr size_t parties = 100000;
+    quids::utils::Philox rng(11, 0);
+    vector<Vote> votes(parties);
+    for (size_t i = 0; i < parties; ++i) {
+        // Parties in random order, four in five voting for outcome 2
+        votes[i] = Vote{.party = i, .outcome = rng.below(5) == 0 ? rng.below(3) : 2};
+    }
+    rng.shuffle(votes.begin(), votes.end());
+
+    const auto decided = tallyVotes(votes, parties, 3, 0.6);
+    ASSERT_TRUE(decided.winner.has_value());
+    EXPECT_EQ(*decided.winner, 2u);
+    EXPECT_LT(decided.examined, votes.size());
+    EXPECT_EQ(tallyVotes(votes, parties, 3, 0.6).counts, decided.counts);
+
+    // No outcome can reach 95% once a few windows are in
+    const auto hopeless = tallyVotes(votes, parties, 3, 0.95);
+    EXPECT_TRUE(hopeless.settled);
+    EXPECT_FALSE(hopeless.winner.has_value());
+    EXPECT_LT(hopeless.examined, votes.size());
+}
+
+} // namespace quids::quantum::consensus::test
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "rl/PrioritizedReplay.hpp"
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace quids {
+namespace rl {
+namespace test {
+
+namespace {
+
+// State, action and next state all carry `tag`, so a sampled row shows
+// which experience it came from
+Experience tagged(double tag, bool done = false) {
+    return {{tag, tag + 0.5}, {-tag}, tag * 10.0, {tag + 1.0, tag + 1.5}, done};
+}
+
+} // namespace
+
+TEST(PrioritizedReplayTest, GathersRowsAndOverwritesTheOldest) {
+    PrioritizedReplay replay(3, 2, 1);
+    const std::vector<Experience> first{tagged(0), tagged(1), tagged(2, true)};
+    replay.add(first);
+    replay.add(tagged(3));
+    EXPECT_EQ(replay.size(), 3u);
+    EXPECT_EQ(replay.capacity(), 3u);
+
+    std::mt19937_64 rng(1);
+    PrioritizedReplay::Batch batch;
+    replay.sample(64, 0.4, rng, batch);
+    ASSERT_EQ(batch.indices.size(), 64u);
+    ASSERT_EQ(batch.states.rows(), 64);
+    for (Eigen::Index i = 0; i < batch.states.rows(); ++i) {
+        const std::size_t slot = batch.indices[static_cast<std::size_t>(i)];
+        ASSERT_LT(slot, 3u);
+        // Experience 3 took slot 0
+        const double tag = slot == 0 ? 3.0 : static_cast<double>(slot);
+        EXPECT_EQ(batch.states(i, 0), tag);
+        EXPECT_EQ(batch.states(i, 1), tag + 0.5);
+        EXPECT_EQ(batch.actions(i, 0), -tag);
+        EXPECT_EQ(batch.next_states(i, 1), tag + 1.5);
+        EXPECT_EQ(batch.rewards(i), tag * 10.0);
+        EXPECT_EQ(batch.not_done(i), slot == 2 ? 0.0 : 1.0);
+    }
+}
+
+TEST(PrioritizedReplayTest, SamplesInProportionToPriority) {
+    PrioritizedReplay replay(4, 2, 1, 1.0);
+    for (int tag = 0; tag < 4; ++tag) {
+        replay.add(tagged(tag));
+    }
+    // New experiences start at the highest priority seen
+    EXPECT_DOUBLE_EQ(replay.totalPriority(), 4.0);
+    const std::vector<std::size_t> slots{0, 1, 2, 3};
+    replay.updatePriorities(slots, Eigen::Vector4d(1.0, -1.0, 1.0, 7.0));
+    EXPECT_DOUBLE_EQ(replay.totalPriority(), 10.0);
+
+    std::mt19937_64 rng(2);
+    PrioritizedReplay::Batch batch;
+    std::vector<std::size_t> counts(4, 0);
+    for (int round = 0; round < 200; ++round) {
+        replay.sample(50, 1.0, rng, batch);
+        for (const std::size_t slot : batch.indices) {
+            ++counts[slot];
+        }
+    }
+    // Stratified draws land close to the expected share
+    EXPECT_NEAR(static_cast<double>(counts[3]) / 10000.0, 0.7, 0.02);
+    for (std::size_t slot = 0; slot < 3; ++slot) {
+        EXPECT_NEAR(static_cast<double>(counts[slot]) / 10000.0, 0.1, 0.02) << slot;
+    }
+
+    // Rarer draws weigh more, normalized to the largest
+    for (Eigen::Index i = 0; i < batch.weights.size(); ++i) {
+        EXPECT_DOUBLE_EQ(batch.weights(i), batch.indices[static_cast<std::size_t>(i)] == 3 ? 1.0 / 7.0 : 1.0);
+    }
+
+    replay.add(tagged(4));
+    EXPECT_DOUBLE_EQ(replay.totalPriority(), 16.0);
+}
+
+TEST(PrioritizedReplayTest, KeepsZeroErrorTransitionsSampleable) {
+    PrioritizedReplay replay(2, 2, 1, 1.0);
+    replay.add(tagged(0));
+    replay.add(tagged(1));
+    const std::vector<std::size_t> slots{0, 1};
+    replay.updatePriorities(slots, Eigen::Vector2d(0.0, 0.0));
+    EXPECT_GT(replay.totalPriority(), 0.0);
+
+    std::mt19937_64 rng(3);
+    PrioritizedReplay::Batch batch;
+    replay.sample(8, 0.5, rng, batch);
+    EXPECT_EQ(batch.weights.maxCoeff(), 1.0);
+}
+
+TEST(PrioritizedReplayTest, RejectsWhatItCannotHold) {
+    EXPECT_THROW(PrioritizedReplay(0, 2, 1), std::invalid_argument);
+
+    PrioritizedReplay replay(4, 2, 1);
+    std::mt19937_64 rng(4);
+    PrioritizedReplay::Batch batch;
+    EXPECT_THROW(replay.sample(1, 0.4, rng, batch), std::logic_error);
+
+    auto wide = tagged(0);
+    wide.state.push_back(0.0);
+    EXPECT_THROW(replay.add(wide), std::invalid_argument);
+    auto no_action = tagged(0);
+    no_action.action.clear();
+    EXPECT_THROW(replay.add(no_action), std::invalid_argument);
+    EXPECT_EQ(replay.size(), 0u);
+}
+
+} // namespace test
+} // namespace rl
+} // namespace quids
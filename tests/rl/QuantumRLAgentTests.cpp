@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include "rl/QuantumRLAgent.hpp"
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace quids {
+namespace rl {
+namespace test {
+
+namespace {
+
+QuantumRLAgent::Config smallConfig() {
+    QuantumRLAgent::Config config;
+    config.batchSize = 16;
+    config.replayCapacity = 256;
+    config.trainInterval = 8;
+    config.numQubits = 2;
+    return config;
+}
+
+// One-step episodes where only the first action pays
+Experience bandit(std::size_t action) {
+    std::vector<double> one_hot(2, 0.0);
+    one_hot[action] = 1.0;
+    return {{1.0, 0.0}, one_hot, action == 0 ? 1.0 : -1.0, {1.0, 0.0}, true};
+}
+
+} // namespace
+
+TEST(QuantumRLAgentTest, StepsOncePerIntervalOfExperience) {
+    QuantumRLAgent agent(2, 2, smallConfig());
+    for (int i = 0; i < 7; ++i) {
+        agent.update(bandit(static_cast<std::size_t>(i % 2)));
+    }
+    EXPECT_EQ(agent.trainingSteps(), 0u);
+    agent.update(bandit(0));
+    EXPECT_EQ(agent.trainingSteps(), 1u);
+
+    // A large batch still takes a single step
+    const std::vector<Experience> backlog(40, bandit(1));
+    agent.update(backlog);
+    EXPECT_EQ(agent.trainingSteps(), 2u);
+    EXPECT_EQ(agent.replaySize(), 48u);
+
+    agent.train(3);
+    EXPECT_EQ(agent.trainingSteps(), 5u);
+}
+
+TEST(QuantumRLAgentTest, LearnsToPreferTheRewardedAction) {
+    QuantumRLAgent agent(2, 2, smallConfig());
+    Eigen::MatrixXd state(1, 2);
+    state << 1.0, 0.0;
+    const double before = agent.actionProbabilities(state)(0, 0);
+
+    for (int i = 0; i < 64; ++i) {
+        agent.update(bandit(static_cast<std::size_t>(i % 2)));
+    }
+    agent.train(200);
+    const Eigen::MatrixXd after = agent.actionProbabilities(state);
+    EXPECT_GT(after(0, 0), before);
+    EXPECT_NEAR(after.row(0).sum(), 1.0, 1e-9);
+
+    const auto action = agent.selectAction({1.0, 0.0});
+    ASSERT_EQ(action.size(), 2u);
+    EXPECT_EQ(action[0] + action[1], 1.0);
+}
+
+TEST(QuantumRLAgentTest, RejectsMismatchedShapes) {
+    EXPECT_THROW(QuantumRLAgent(0, 2, smallConfig()), std::invalid_argument);
+    QuantumRLAgent agent(2, 2, smallConfig());
+    EXPECT_THROW(agent.selectAction({1.0}), std::invalid_argument);
+    auto wide = bandit(0);
+    wide.state.push_back(0.0);
+    EXPECT_THROW(agent.update(wide), std::invalid_argument);
+    // Learning from nothing is a no-op
+    agent.train(2);
+    EXPECT_EQ(agent.trainingSteps(), 0u);
+}
+
+} // namespace test
+} // namespace rl
+} // namespace quids
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "utils/AdmissionController.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using utils::AdmissionController;
+using Lane = AdmissionController::Lane;
+
+namespace {
+
+AdmissionController::Config fresh() {
+    AdmissionController::Config config;
+    config.refresh = std::chrono::milliseconds(0);  // every call reads the probes
+    return config;
+}
+
+} // namespace
+
+TEST(AdmissionControllerTest, LanesShedInOrderAsPressureRises) {
+    AdmissionController admission(fresh());
+    double fill = 0.0;
+    admission.add_stage("proving", [&] { return fill; });
+
+    for (auto lane : {Lane::Bulk, Lane::Standard, Lane::Priority}) {
+        EXPECT_TRUE(admission.admit(lane).admitted);
+    }
+
+    fill = 0.7;
+    EXPECT_FALSE(admission.admit(Lane::Bulk).admitted);
+    EXPECT_TRUE(admission.admit(Lane::Standard).admitted);
+
+    fill = 0.9;
+    EXPECT_FALSE(admission.admit(Lane::Standard).admitted);
+    EXPECT_TRUE(admission.admit(Lane::Priority).admitted);
+    EXPECT_FALSE(admission.overloaded());
+
+    fill = 1.0;
+    EXPECT_FALSE(admission.admit(Lane::Priority).admitted);
+    EXPECT_TRUE(admission.overloaded());
+
+    const auto stats = admission.stats();
+    EXPECT_EQ(stats.bottleneck, "proving");
+    EXPECT_EQ(stats.admitted[0], 1u);
+    EXPECT_EQ(stats.shed[0], 1u);
+    EXPECT_EQ(stats.admitted[2], 2u);
+    EXPECT_EQ(stats.shed[2], 1u);
+}
+
+TEST(AdmissionControllerTest, FullestStageDecides) {
+    AdmissionController admission(fresh());
+    admission.add_stage("mempool", [] { return 0.1; });
+    admission.add_stage("l1", [] { return 0.95; });
+
+    EXPECT_DOUBLE_EQ(admission.pressure(), 0.95);
+    EXPECT_EQ(admission.stats().bottleneck, "l1");
+    EXPECT_FALSE(admission.admit(Lane::Standard).admitted);
+}
+
+TEST(AdmissionControllerTest, RetryGrowsWithOverload) {
+    auto config = fresh();
+    config.min_retry = std::chrono::milliseconds(100);
+    config.max_retry = std::chrono::milliseconds(1100);
+    AdmissionController admission(config);
+    double fill = 0.6;
+    admission.add_stage("mempool", [&] { return fill; });
+
+    const auto edge = admission.admit(Lane::Bulk);
+    ASSERT_FALSE(edge.admitted);
+    EXPECT_EQ(edge.retry_after, std::chrono::milliseconds(100));
+
+    fill = 0.9;
+    const auto mid = admission.admit(Lane::Bulk);
+    EXPECT_GT(mid.retry_after, edge.retry_after);
+    EXPECT_LT(mid.retry_after, config.max_retry);
+
+    fill = 5.0;
+    EXPECT_EQ(admission.admit(Lane::Bulk).retry_after, config.max_retry);
+}
+
+TEST(AdmissionControllerTest, FeesPickLanes) {
+    auto config = fresh();
+    config.standard_fee = 10;
+    config.priority_fee = 100;
+    AdmissionController admission(config);
+    EXPECT_EQ(admission.lane_for_fee(0), Lane::Bulk);
+    EXPECT_EQ(admission.lane_for_fee(10), Lane::Standard);
+    EXPECT_EQ(admission.lane_for_fee(99), Lane::Standard);
+    EXPECT_EQ(admission.lane_for_fee(100), Lane::Priority);
+}
+
+TEST(AdmissionControllerTest, ProbesRunOncePerRefresh) {
+    AdmissionController::Config config;
+    config.refresh = std::chrono::hours(1);
+    AdmissionController admission(config);
+    std::atomic<int> polls{0};
+    admission.add_stage("mempool", [&] { ++polls; return 0.0; });
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(admission.admit(Lane::Bulk).admitted);
+    }
+    EXPECT_EQ(polls.load(), 1);
+}
+
+TEST(AdmissionControllerTest, RejectsInvertedLanes) {
+    auto config = fresh();
+    config.shed_above = {0.9, 0.5, 1.0};
+    EXPECT_THROW(AdmissionController{config}, std::invalid_argument);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "rollup/BlockReplay.hpp"
+#include "utils/Tracing.hpp"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateManager::Snapshot base_state(size_t accounts) {
+    StateManager state;
+    for (size_t i = 0; i < accounts; ++i) {
+        StateManager::Account account;
+        account.address = "account_" + std::to_string(i);
+        account.balance = 1000 + i;
+        account.nonce = 0;
+        state.add_account(account.address, account);
+    }
+    return state.snapshot();
+}
+
+StateTrie::Hash root_of(const StateManager::Snapshot& snapshot) {
+    StateTrie::Hash hash{};
+    const auto root = snapshot.get_state_root();
+    std::copy_n(root.begin(), std::min(root.size(), hash.size()), hash.begin());
+    return hash;
+}
+
+// Empty blocks leave the root alone, so every stored root is the base one
+// unless listed in `wrong`
+BlockReplayer::BlockSource source(uint64_t first, uint64_t last, const StateTrie::Hash& root,
+                                  std::map<uint64_t, bool> wrong = {}) {
+    return [=](uint64_t number) -> std::optional<BlockReplayer::StoredBlock> {
+        if (number < first || number > last) {
+            return std::nullopt;
+        }
+        BlockReplayer::StoredBlock block;
+        block.number = number;
+        block.post_state_root = root;
+        if (wrong.count(number)) {
+            (*block.post_state_root)[0] ^= 1;
+        }
+        return block;
+    };
+}
+
+} // namespace
+
+TEST(BlockReplayTest, ReplaysRangeAndChecksRoots) {
+    const auto base = base_state(100);
+    BlockReplayer replayer(base);
+
+    const auto report = replayer.run(source(1, 20, root_of(base)), 1, 10);
+    ASSERT_EQ(report.blocks.size(), 10u);
+    EXPECT_EQ(report.blocks.front().number, 1u);
+    EXPECT_EQ(report.blocks.back().number, 10u);
+    EXPECT_EQ(report.mismatches, 0u);
+    EXPECT_FALSE(report.missing_block);
+    EXPECT_EQ(report.final_root, root_of(base));
+    for (const auto& block : report.blocks) {
+        EXPECT_TRUE(block.root_checked);
+        EXPECT_TRUE(block.root_matches);
+    }
+    EXPECT_EQ(report.block_latency.count, 10u);
+    EXPECT_EQ(report.stage_latency[BlockReplayer::Execute].count, 10u);
+}
+
+TEST(BlockReplayTest, OpenRangeEndsAtFirstMissingBlock) {
+    const auto base = base_state(10);
+    BlockReplayer replayer(base);
+
+    const auto report = replayer.run(source(5, 12, root_of(base)), 5, std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(report.blocks.size(), 8u);
+    ASSERT_TRUE(report.missing_block);
+    EXPECT_EQ(*report.missing_block, 13u);
+}
+
+TEST(BlockReplayTest, StopsAtFirstDivergingBlock) {
+    const auto base = base_state(10);
+    const auto blocks = source(1, 10, root_of(base), {{4, true}, {7, true}});
+
+    BlockReplayer stopping(base);
+    auto report = stopping.run(blocks, 1, 10);
+    EXPECT_EQ(report.blocks.size(), 4u);
+    EXPECT_EQ(report.mismatches, 1u);
+    ASSERT_TRUE(report.first_mismatch);
+    EXPECT_EQ(*report.first_mismatch, 4u);
+
+    BlockReplayer::Config config;
+    config.stop_on_mismatch = false;
+    BlockReplayer continuing(base, config);
+    report = continuing.run(blocks, 1, 10);
+    EXPECT_EQ(report.blocks.size(), 10u);
+    EXPECT_EQ(report.mismatches, 2u);
+    EXPECT_EQ(*report.first_mismatch, 4u);
+}
+
+TEST(BlockReplayTest, StagesAreTracedPerBlock) {
+    const auto base = base_state(10);
+    BlockReplayer replayer(base);
+    utils::Tracer::global().clear();
+    replayer.run(source(1, 3, root_of(base)), 1, 3);
+
+    const auto spans = utils::Tracer::global().collect(utils::aggregate_trace_id("replay", 2));
+    std::map<std::string, size_t> names;
+    for (const auto& span : spans) {
+        ++names[span.name];
+    }
+    EXPECT_EQ(names["replay.load"], 1u);
+    EXPECT_EQ(names["replay.execute"], 1u);
+    EXPECT_EQ(names["replay.state_root"], 1u);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
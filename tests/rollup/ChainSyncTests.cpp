@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include "rollup/ChainSync.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "TestTransactions.hpp"
+#include "crypto/blake3/MerkleBuilder.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateManager::Account make_account(const std::string& address, uint64_t balance) {
+    StateManager::Account account;
+    account.address = address;
+    account.balance = balance;
+    account.nonce = 0;
+    return account;
+}
+
+SyncHeader::Hash to_hash(const std::vector<uint8_t>& bytes) {
+    SyncHeader::Hash hash{};
+    std::copy_n(bytes.begin(), std::min(bytes.size(), hash.size()), hash.begin());
+    return hash;
+}
+
+// A chain where block h pays a new account and carries a few transfers
+struct Chain {
+    std::vector<SyncHeader> headers;  // by height, genesis first
+    std::vector<std::vector<blockchain::ByteVector>> bodies;
+    std::vector<StateManager::Snapshot> states;
+
+    explicit Chain(uint64_t height) {
+        StateManager state;
+        for (int i = 0; i < 50; ++i) {
+            state.add_account("genesis_" + std::to_string(i), make_account("genesis_" + std::to_string(i), 1000));
+        }
+        SyncHeader genesis;
+        genesis.state_root = to_hash(state.get_state_root());
+        headers.push_back(genesis);
+        bodies.emplace_back();
+        states.push_back(state.snapshot());
+
+        for (uint64_t h = 1; h <= height; ++h) {
+            std::vector<blockchain::ByteVector> body;
+            for (uint64_t i = 0; i < h % 5; ++i) {
+                body.push_back(quids::test::signedTransferBytes("genesis_" + std::to_string(i), "block_" + std::to_string(h), 1, h, 1));
+            }
+            state.add_account("block_" + std::to_string(h), make_account("block_" + std::to_string(h), h));
+            state.set_balance("genesis_" + std::to_string(h % 50), 1000 + h);
+
+            crypto::MerkleBuilder builder;
+            for (const auto& bytes : body) {
+                auto tx = std::make_shared<blockchain::StandardTransaction>();
+                tx->deserialize(bytes);
+                builder.appendHash(tx->hash());
+            }
+
+            SyncHeader header;
+            header.height = h;
+            header.parent = headers.back().hash();
+            header.tx_root = builder.root();
+            header.state_root = to_hash(state.get_state_root());
+            header.tx_count = static_cast<uint32_t>(body.size());
+            headers.push_back(header);
+            bodies.push_back(std::move(body));
+            states.push_back(state.snapshot());
+        }
+    }
+
+    SyncServer::Source source() const {
+        SyncServer::Source source;
+        source.header = [this](uint64_t h) -> std::optional<SyncHeader> {
+            if (h >= headers.size()) return std::nullopt;
+            return headers[h];
+        };
+        source.body = [this](uint64_t h) -> std::optional<std::vector<blockchain::ByteVector>> {
+            if (h >= bodies.size()) return std::nullopt;
+            return bodies[h];
+        };
+        source.state = [this](const StateTrie::Hash& root) -> std::optional<StateManager::Snapshot> {
+            for (const auto& snapshot : states) {
+                if (to_hash(snapshot.get_state_root()) == root) return snapshot;
+            }
+            return std::nullopt;
+        };
+        return source;
+    }
+
+    ChainSync::Target tip() const {
+        return {headers.back().height, headers.back().hash()};
+    }
+};
+
+// Peers answer straight from a SyncServer, on the caller's thread; peers
+// named "liar..." flip a byte in every reply
+class Network {
+public:
+    explicit Network(const Chain& chain) : server_(chain.source(), SyncServer::Limits{64, 8}) {}
+
+    ChainSync::Transport transport() {
+        return [this](const std::string& peer, std::vector<uint8_t> request, ChainSync::ResponseCallback done) {
+            ++requests_[peer];
+            auto reply = server_.handle(request);
+            if (peer.rfind("liar", 0) == 0) {
+                reply[reply.size() / 2] ^= 0x01;
+            }
+            done(std::move(reply));
+        };
+    }
+
+    size_t requests(const std::string& peer) const {
+        auto it = requests_.find(peer);
+        return it == requests_.end() ? 0 : it->second;
+    }
+
+private:
+    SyncServer server_;
+    std::map<std::string, size_t> requests_;
+};
+
+ChainSync::Config small_config() {
+    ChainSync::Config config;
+    config.headers_per_request = 16;
+    config.bodies_per_request = 4;
+    config.state_chunks = 8;
+    config.max_inflight_per_peer = 1;
+    config.max_peer_failures = 2;
+    return config;
+}
+
+} // namespace
+
+TEST(ChainSyncTest, ReplaysEveryBlockInOrder) {
+    const Chain chain(60);
+    Network network(chain);
+    auto config = small_config();
+    config.snapshot_distance = 0;
+    ChainSync sync(config, network.transport());
+
+    std::vector<uint64_t> heights;
+    size_t transactions = 0;
+    auto result = sync.run(chain.headers[0], chain.tip(), {"liar", "a", "b"},
+        [&](const SyncHeader& header, std::vector<blockchain::TransactionPtr>&& txs) {
+            EXPECT_EQ(header.hash(), chain.headers[header.height].hash());
+            for (const auto& tx : txs) {
+                EXPECT_EQ(tx->getRecipient(), "block_" + std::to_string(header.height));
+            }
+            heights.push_back(header.height);
+            transactions += txs.size();
+            return true;
+        },
+        {});
+
+    EXPECT_EQ(result.status, ChainSync::Status::Synced);
+    EXPECT_EQ(result.height, 60u);
+    EXPECT_EQ(result.headers, 60u);
+    EXPECT_EQ(result.bodies, 60u);
+    ASSERT_EQ(heights.size(), 60u);
+    for (size_t i = 0; i < heights.size(); ++i) {
+        EXPECT_EQ(heights[i], i + 1);
+    }
+    EXPECT_EQ(transactions, 120u);
+    // The liar is dropped after max_peer_failures bad replies
+    EXPECT_EQ(network.requests("liar"), 2u);
+}
+
+TEST(ChainSyncTest, SyncsStateAtPivotThenRecentBlocks) {
+    const Chain chain(60);
+    Network network(chain);
+    auto config = small_config();
+    config.snapshot_distance = 10;
+    ChainSync sync(config, network.transport());
+
+    std::mutex mutex;
+    StateManager synced;
+    std::vector<uint64_t> heights;
+    auto result = sync.run(chain.headers[0], chain.tip(), {"a", "liar", "b"},
+        [&](const SyncHeader& header, std::vector<blockchain::TransactionPtr>&&) {
+            heights.push_back(header.height);
+            return true;
+        },
+        [&](std::vector<StateManager::Account>&& accounts) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& account : accounts) {
+                synced.add_account(account.address, account);
+            }
+        });
+
+    EXPECT_EQ(result.status, ChainSync::Status::Synced);
+    EXPECT_EQ(result.state_height, 50u);
+    EXPECT_EQ(result.accounts, 100u);
+    EXPECT_EQ(to_hash(synced.get_state_root()), chain.headers[50].state_root);
+    ASSERT_EQ(heights.size(), 10u);
+    EXPECT_EQ(heights.front(), 51u);
+    EXPECT_EQ(heights.back(), 60u);
+}
+
+TEST(ChainSyncTest, FailsOnWrongTargetOrNoHonestPeer) {
+    const Chain chain(30);
+    Network network(chain);
+    auto config = small_config();
+    config.snapshot_distance = 0;
+    ChainSync sync(config, network.transport());
+    auto accept = [](const SyncHeader&, std::vector<blockchain::TransactionPtr>&&) { return true; };
+
+    auto target = chain.tip();
+    target.hash[0] ^= 1;
+    EXPECT_EQ(sync.run(chain.headers[0], target, {"a", "b"}, accept, {}).status,
+              ChainSync::Status::BadChain);
+
+    EXPECT_EQ(sync.run(chain.headers[0], chain.tip(), {"liar", "liar2"}, accept, {}).status,
+              ChainSync::Status::NoPeers);
+
+    size_t applied = 0;
+    auto result = sync.run(chain.headers[0], chain.tip(), {"a"},
+        [&](const SyncHeader&, std::vector<blockchain::TransactionPtr>&&) { return ++applied < 5; }, {});
+    EXPECT_EQ(result.status, ChainSync::Status::Rejected);
+    EXPECT_EQ(result.height, 4u);
+
+    std::stop_source stop;
+    stop.request_stop();
+    EXPECT_EQ(sync.run(chain.headers[0], chain.tip(), {"a"}, accept, {}, stop.get_token()).status,
+              ChainSync::Status::Stopped);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "rollup/ChallengeIndex.hpp"
+#include "storage/PersistentStorage.hpp"
+#include "TestStorage.hpp"
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+using Clock = ChallengeIndex::Clock;
+using std::chrono::milliseconds;
+
+ChallengeIndex::Commitment make_commitment(uint64_t batch, Clock::time_point window_end) {
+    ChallengeIndex::Commitment commitment;
+    commitment.batch_number = batch;
+    commitment.pre_state_root.fill(static_cast<uint8_t>(batch));
+    commitment.post_state_root.fill(static_cast<uint8_t>(batch + 1));
+    commitment.post_state_root[31] = static_cast<uint8_t>(batch >> 8);
+    commitment.batch_hash.fill(static_cast<uint8_t>(batch + 2));
+    commitment.window_end = window_end;
+    return commitment;
+}
+
+} // namespace
+
+class ChallengeIndexTest : public quids::test::TempStorageTest {
+protected:
+    ChallengeIndexTest() : TempStorageTest("challenge_index_") {}
+
+    void SetUp() override {
+        TempStorageTest::SetUp();
+        start_ = Clock::now();
+    }
+
+    std::unique_ptr<ChallengeIndex> make_index(milliseconds tick) {
+        return std::make_unique<ChallengeIndex>(storage_, ChallengeIndex::Config{tick, false},
+            [this](const std::vector<ChallengeIndex::Commitment>& closed) {
+                batches_.emplace_back();
+                for (const auto& commitment : closed) {
+                    batches_.back().push_back(commitment.batch_number);
+                }
+            });
+    }
+
+    Clock::time_point start_;
+    std::vector<std::vector<uint64_t>> batches_;
+};
+
+TEST_F(ChallengeIndexTest, FinalizesEachWindowInOneBatchWhenItCloses) {
+    auto index = make_index(milliseconds(10));
+    ASSERT_TRUE(index->add(make_commitment(1, start_ + milliseconds(50))));
+    ASSERT_TRUE(index->add(make_commitment(2, start_ + milliseconds(45))));
+    ASSERT_TRUE(index->add(make_commitment(3, start_ + milliseconds(120))));
+    ASSERT_TRUE(index->add(make_commitment(4, start_ + milliseconds(5000))));
+    EXPECT_FALSE(index->add(make_commitment(3, start_ + milliseconds(999))));
+
+    EXPECT_EQ(index->advance(start_ + milliseconds(40)), 0u);
+    EXPECT_EQ(index->advance(start_ + milliseconds(60)), 2u);
+    EXPECT_EQ(index->advance(start_ + milliseconds(200)), 1u);
+    EXPECT_EQ(batches_, (std::vector<std::vector<uint64_t>>{{2, 1}, {3}}));
+    EXPECT_EQ(index->size(), 1u);
+    EXPECT_FALSE(index->find(make_commitment(1, start_).post_state_root));
+    ASSERT_TRUE(index->find(make_commitment(4, start_).post_state_root));
+}
+
+TEST_F(ChallengeIndexTest, NeverFinalizesEarlyOrLateAcrossLevels) {
+    auto index = make_index(milliseconds(1));
+    std::mt19937_64 rng(7);
+    // Up to five minutes of 1 ms ticks reaches the third level
+    std::uniform_int_distribution<int64_t> window(0, 300000);
+    std::vector<Clock::time_point> ends;
+    for (uint64_t batch = 0; batch < 300; ++batch) {
+        ends.push_back(start_ + milliseconds(window(rng)));
+        ASSERT_TRUE(index->add(make_commitment(batch, ends.back())));
+    }
+
+    std::uniform_int_distribution<int64_t> step(1, 4000);
+    size_t finalized = 0;
+    for (auto now = start_; finalized < ends.size(); now += milliseconds(step(rng))) {
+        const size_t before = batches_.size();
+        finalized += index->advance(now);
+        for (size_t b = before; b < batches_.size(); ++b) {
+            for (uint64_t batch : batches_[b]) {
+                EXPECT_LE(ends[batch], now) << "batch " << batch << " closed early";
+            }
+        }
+        for (uint64_t batch = 0; batch < ends.size(); ++batch) {
+            if (ends[batch] + milliseconds(1) <= now) {
+                EXPECT_FALSE(index->find(make_commitment(batch, start_).post_state_root))
+                    << "batch " << batch << " closed late";
+            }
+        }
+    }
+    EXPECT_EQ(finalized, ends.size());
+    EXPECT_EQ(index->size(), 0u);
+}
+
+TEST_F(ChallengeIndexTest, ChallengedCommitmentsWaitForResolution) {
+    auto index = make_index(milliseconds(10));
+    const auto upheld = make_commitment(1, start_ + milliseconds(50));
+    const auto fraud = make_commitment(2, start_ + milliseconds(50));
+    ASSERT_TRUE(index->add(upheld));
+    ASSERT_TRUE(index->add(fraud));
+
+    EXPECT_TRUE(index->challenge(upheld.post_state_root));
+    EXPECT_TRUE(index->challenge(fraud.post_state_root));
+    EXPECT_FALSE(index->challenge(fraud.post_state_root));
+    EXPECT_EQ(index->find(upheld.post_state_root)->status, ChallengeIndex::Status::Challenged);
+
+    EXPECT_EQ(index->advance(start_ + milliseconds(100)), 0u);
+    EXPECT_TRUE(index->resolve(upheld.post_state_root, false));
+    EXPECT_TRUE(index->resolve(fraud.post_state_root, true));
+    EXPECT_FALSE(index->resolve(fraud.post_state_root, true));
+    EXPECT_EQ(index->advance(start_ + milliseconds(110)), 1u);
+    EXPECT_EQ(batches_, (std::vector<std::vector<uint64_t>>{{1}}));
+    EXPECT_EQ(index->size(), 0u);
+}
+
+TEST_F(ChallengeIndexTest, ResumesOpenWindowsFromStorage) {
+    const auto open = make_commitment(1, start_ + milliseconds(50));
+    const auto disputed = make_commitment(2, start_ + milliseconds(50));
+    {
+        auto index = make_index(milliseconds(10));
+        ASSERT_TRUE(index->add(open));
+        ASSERT_TRUE(index->add(disputed));
+        ASSERT_TRUE(index->challenge(disputed.post_state_root));
+    }
+
+    {
+        auto index = make_index(milliseconds(10));
+        EXPECT_EQ(index->size(), 2u);
+        const auto restored = index->find(open.post_state_root);
+        ASSERT_TRUE(restored);
+        EXPECT_EQ(restored->batch_number, 1u);
+        EXPECT_EQ(restored->pre_state_root, open.pre_state_root);
+        EXPECT_EQ(restored->batch_hash, open.batch_hash);
+        EXPECT_EQ(index->find(disputed.post_state_root)->status, ChallengeIndex::Status::Challenged);
+        EXPECT_EQ(index->advance(start_ + milliseconds(100)), 1u);
+    }
+
+    auto index = make_index(milliseconds(10));
+    EXPECT_EQ(index->size(), 1u);
+    EXPECT_TRUE(index->find(disputed.post_state_root));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
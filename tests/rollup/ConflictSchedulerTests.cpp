@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "rollup/ConflictScheduler.hpp"
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+AccessSet transfer(const std::string& from, const std::string& to) {
+    AccessSet access;
+    access.writes.push_back(ConflictScheduler::accountKey(from));
+    access.writes.push_back(ConflictScheduler::accountKey(to));
+    return access;
+}
+
+} // namespace
+
+TEST(ConflictSchedulerTest, IndependentTransfersShareOneWave) {
+    std::vector<AccessSet> sets;
+    for (int i = 0; i < 100; ++i) {
+        sets.push_back(transfer("sender_" + std::to_string(i), "recipient_" + std::to_string(i)));
+    }
+
+    ConflictScheduler scheduler;
+    auto waves = scheduler.schedule(sets);
+
+    ASSERT_EQ(waves.size(), 1u);
+    EXPECT_EQ(waves[0].size(), 100u);
+    EXPECT_DOUBLE_EQ(scheduler.lastMetrics().parallelism(), 100.0);
+}
+
+TEST(ConflictSchedulerTest, HotAccountSerializes) {
+    std::vector<AccessSet> sets;
+    for (int i = 0; i < 10; ++i) {
+        sets.push_back(transfer("hot", "recipient_" + std::to_string(i)));
+    }
+
+    ConflictScheduler scheduler;
+    auto waves = scheduler.schedule(sets);
+
+    ASSERT_EQ(waves.size(), 10u);
+    for (size_t w = 0; w < waves.size(); ++w) {
+        ASSERT_EQ(waves[w].size(), 1u);
+        EXPECT_EQ(waves[w][0], w);
+    }
+}
+
+TEST(ConflictSchedulerTest, ConflictsKeepSequentialOrder) {
+    // 0: a->b, 1: c->d, 2: b->c, 3: e->f
+    std::vector<AccessSet> sets = {
+        transfer("a", "b"),
+        transfer("c", "d"),
+        transfer("b", "c"),
+        transfer("e", "f"),
+    };
+
+    ConflictScheduler scheduler;
+    auto waves = scheduler.schedule(sets);
+
+    ASSERT_EQ(waves.size(), 2u);
+    EXPECT_EQ(waves[0], (ConflictScheduler::Wave{0, 1, 3}));
+    EXPECT_EQ(waves[1], (ConflictScheduler::Wave{2}));
+}
+
+TEST(ConflictSchedulerTest, ReadersShareWaveButWaitForWriter) {
+    StateKey slot = ConflictScheduler::storageKey("contract", {0x01});
+
+    AccessSet writer;
+    writer.writes.push_back(slot);
+    AccessSet reader;
+    reader.reads.push_back(slot);
+
+    // write, read, read, write
+    std::vector<AccessSet> sets = {writer, reader, reader, writer};
+
+    ConflictScheduler scheduler;
+    auto waves = scheduler.schedule(sets);
+
+    ASSERT_EQ(waves.size(), 3u);
+    EXPECT_EQ(waves[0], (ConflictScheduler::Wave{0}));
+    EXPECT_EQ(waves[1], (ConflictScheduler::Wave{1, 2}));
+    EXPECT_EQ(waves[2], (ConflictScheduler::Wave{3}));
+}
+
+TEST(ConflictSchedulerTest, ReusesItsScratchAcrossBatches) {
+    std::vector<AccessSet> sets;
+    for (int i = 0; i < 2000; ++i) {
+        sets.push_back(transfer("sender_" + std::to_string(i), "recipient_" + std::to_string(i % 7)));
+    }
+
+    ConflictScheduler scheduler;
+    const auto first = scheduler.schedule(sets);
+    const auto grown = scheduler.scratchStats();
+    EXPECT_EQ(grown.resets, 1u);
+    EXPECT_EQ(grown.used_bytes, 0u);
+    EXPECT_GT(grown.peak_bytes, 0u);
+
+    // A batch of the same size fits in what the first one reserved
+    for (int round = 0; round < 3; ++round) {
+        EXPECT_EQ(scheduler.schedule(sets), first);
+    }
+    EXPECT_EQ(scheduler.scratchStats().chunks, grown.chunks);
+    EXPECT_EQ(scheduler.scratchStats().reserved_bytes, grown.reserved_bytes);
+    EXPECT_EQ(scheduler.scratchStats().resets, 4u);
+}
+
+TEST(ConflictSchedulerTest, AccountAndStorageKeysDiffer) {
+    EXPECT_NE(ConflictScheduler::accountKey("contract"),
+              ConflictScheduler::storageKey("contract", {}));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "rollup/CrossRollupBridge.hpp"
+#include <atomic>
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+CrossRollupBridge::CrossRollupMessage make_message(uint32_t destination, const std::string& text) {
+    CrossRollupBridge::CrossRollupMessage message;
+    message.source_chain_id = 1;
+    message.destination_chain_id = destination;
+    message.payload.assign(text.begin(), text.end());
+    return message;
+}
+
+} // namespace
+
+TEST(CrossRollupBridgeTest, BatchesPerDestinationWithOneProofEach) {
+    std::atomic<int> proofs{0};
+    CrossRollupBridge::Config config;
+    config.max_batch_size = 4;
+    CrossRollupBridge source(config, [&](const CrossRollupBridge::BatchHeader&) {
+        ++proofs;
+        CrossRollupBridge::Proof proof;
+        proof.is_valid = true;
+        return proof;
+    }, nullptr);
+
+    for (int i = 0; i < 6; ++i) {
+        EXPECT_EQ(source.send_message(make_message(2, "to-2-" + std::to_string(i))), static_cast<uint64_t>(i));
+    }
+    EXPECT_EQ(source.send_message(make_message(3, "to-3")), 0u);
+    // The first four filled a batch on their own
+    EXPECT_EQ(proofs.load(), 1);
+    source.seal();
+    EXPECT_EQ(proofs.load(), 3);
+
+    auto batches = source.take_sealed();
+    ASSERT_EQ(batches.size(), 3u);
+    EXPECT_EQ(batches[0].header.destination_chain_id, 2u);
+    EXPECT_EQ(batches[0].header.message_count, 4u);
+    EXPECT_TRUE(source.verify_incoming_message(batches[0].messages[1]));
+    EXPECT_FALSE(source.verify_incoming_message(make_message(2, "never sent")));
+    EXPECT_TRUE(source.take_sealed().empty());
+}
+
+TEST(CrossRollupBridgeTest, DeliversEachMessageOnceAgainstAcceptedRoot) {
+    CrossRollupBridge source;
+    for (int i = 0; i < 5; ++i) {
+        source.send_message(make_message(2, "m" + std::to_string(i)));
+    }
+    source.seal();
+    auto batch = source.take_sealed().at(0);
+
+    CrossRollupBridge destination(CrossRollupBridge::Config{}, nullptr,
+        [](const CrossRollupBridge::BatchHeader& header) { return header.message_count > 0; });
+    CrossRollupBridge::MessageProof proof{batch.header.batch_number, batch.inclusion[3]};
+    // Unknown root
+    EXPECT_FALSE(destination.receive_message(batch.messages[3], proof));
+
+    ASSERT_TRUE(destination.accept_batch(batch.header));
+    EXPECT_FALSE(destination.accept_batch(batch.header));
+    EXPECT_TRUE(destination.receive_message(batch.messages[3], proof));
+    EXPECT_FALSE(destination.receive_message(batch.messages[3], proof));
+
+    auto forged = batch.messages[2];
+    forged.payload[0] ^= 1;
+    EXPECT_FALSE(destination.receive_message(forged, {batch.header.batch_number, batch.inclusion[2]}));
+
+    for (size_t i : {0u, 1u, 2u, 4u}) {
+        EXPECT_TRUE(destination.receive_message(batch.messages[i], {batch.header.batch_number, batch.inclusion[i]}));
+    }
+    for (size_t i = 0; i < batch.messages.size(); ++i) {
+        EXPECT_FALSE(destination.receive_message(batch.messages[i], {batch.header.batch_number, batch.inclusion[i]}));
+    }
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "rollup/DataCompressor.hpp"
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+// Transfers among a small set of accounts, as a sequencer would batch them
+std::vector<TransactionRecord> sample_batch(size_t count) {
+    std::vector<TransactionRecord> batch;
+    std::vector<uint64_t> nonces(16, 100);
+    for (size_t i = 0; i < count; ++i) {
+        TransactionRecord tx;
+        tx.sender = "0x" + std::string(38, 'a') + std::to_string(10 + i % 16);
+        tx.recipient = "0x" + std::string(38, 'b') + std::to_string(10 + i % 7);
+        tx.nonce = nonces[i % 16]++;
+        tx.value = 1000 * (i % 50);
+        tx.gas_cost = 21000;
+        tx.timestamp_us = 1'700'000'000'000'000 + static_cast<int64_t>(i) * 250;
+        for (size_t b = 0; b < tx.signature.size(); ++b) {
+            tx.signature[b] = static_cast<uint8_t>((i * 131 + b * 17) ^ (i >> 3));
+        }
+        if (i % 4 == 0) tx.data = {0xa9, 0x05, 0x9c, 0xbb, static_cast<uint8_t>(i)};
+        batch.push_back(std::move(tx));
+    }
+    return batch;
+}
+
+size_t naive_size(const std::vector<TransactionRecord>& batch) {
+    size_t total = 0;
+    for (const auto& tx : batch) {
+        total += tx.sender.size() + tx.recipient.size() + 4 * sizeof(uint64_t) +
+                 tx.signature.size() + tx.data.size();
+    }
+    return total;
+}
+
+} // namespace
+
+TEST(DataCompressorTest, RoundTripsBatch) {
+    const auto batch = sample_batch(500);
+    auto packed = DataCompressor::compress_batch(batch);
+    EXPECT_EQ(DataCompressor::decompress_batch(packed), batch);
+
+    // Empty batches and out-of-order nonces and timestamps survive too
+    EXPECT_TRUE(DataCompressor::decompress_batch(DataCompressor::compress_batch(std::vector<TransactionRecord>{})).empty());
+    auto shuffled = sample_batch(20);
+    std::swap(shuffled[1], shuffled[17]);
+    shuffled[3].nonce = 0;
+    shuffled[5].timestamp_us = -5;
+    EXPECT_EQ(DataCompressor::decompress_batch(DataCompressor::compress_batch(shuffled)), shuffled);
+}
+
+TEST(DataCompressorTest, ColumnsBeatRowLayout) {
+    const auto batch = sample_batch(1000);
+    auto packed = DataCompressor::compress_batch(batch);
+    EXPECT_LT(packed.original_size, naive_size(batch));
+    // Signatures dominate and are incompressible; everything else nearly vanishes
+    EXPECT_LT(packed.compressed_data.size(), batch.size() * 32 + batch.size() * 4);
+}
+
+TEST(DataCompressorTest, RejectsMalformedInput) {
+    auto packed = DataCompressor::compress_batch(sample_batch(50)).compressed_data;
+    std::vector<uint8_t> bytes(packed.begin(), packed.end());
+
+    auto truncated = bytes;
+    truncated.resize(bytes.size() / 2);
+    EXPECT_THROW(DataCompressor::decompress_batch(truncated), std::runtime_error);
+
+    auto bad_magic = bytes;
+    bad_magic[0] ^= 0xff;
+    EXPECT_THROW(DataCompressor::decompress_batch(bad_magic), std::runtime_error);
+
+    auto trailing = bytes;
+    trailing.push_back(0);
+    EXPECT_THROW(DataCompressor::decompress_batch(trailing), std::runtime_error);
+
+    // Corrupt every byte in turn: decoding must fail cleanly or succeed, never crash
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        auto corrupt = bytes;
+        corrupt[i] ^= 0x5a;
+        try {
+            (void)DataCompressor::decompress_batch(corrupt);
+        } catch (const std::runtime_error&) {
+        }
+    }
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include "drivers/DeviceEventBus.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using drivers::DeviceEvent;
+using drivers::DeviceEventBus;
+
+namespace {
+
+template<typename Pred>
+bool eventually(Pred pred) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+class DeviceEventBusTest : public ::testing::Test {
+protected:
+    utils::WorkStealingPool pool_{utils::WorkStealingPool::Config{2}};
+};
+
+TEST_F(DeviceEventBusTest, InternsTypes) {
+    DeviceEventBus bus(DeviceEventBus::Config{}, pool_);
+    const auto connected = bus.intern("connected");
+    const auto data = bus.intern("data");
+    EXPECT_NE(connected, data);
+    EXPECT_EQ(bus.intern("connected"), connected);
+    EXPECT_EQ(bus.typeName(data), "data");
+    EXPECT_EQ(bus.typeName(99), "");
+}
+
+TEST_F(DeviceEventBusTest, DeliversInOrderAndInBatches) {
+    DeviceEventBus::Config config;
+    config.max_batch = 16;
+    DeviceEventBus bus(config, pool_);
+    const auto type = bus.intern("data");
+    const auto other = bus.intern("other");
+
+    std::mutex mutex;
+    std::vector<uint8_t> seen;
+    size_t largest = 0;
+    std::atomic<bool> concurrent{false};
+    std::atomic<int> inside{0};
+    bus.subscribe(type, [&](std::span<const DeviceEvent> events) {
+        if (inside.fetch_add(1) != 0) {
+            concurrent = true;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        largest = std::max(largest, events.size());
+        for (const auto& event : events) {
+            EXPECT_EQ(event.device_id, "dev0");
+            seen.push_back(event.data.at(0));
+        }
+        inside.fetch_sub(1);
+    });
+
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_TRUE(bus.publish(type, "dev0", {static_cast<uint8_t>(i)}));
+    }
+    EXPECT_FALSE(bus.publish(other, "dev0", {}));
+    ASSERT_TRUE(eventually([&] { return bus.stats().delivered == 200; }));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(seen.size(), 200u);
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(seen[i], static_cast<uint8_t>(i));
+    }
+    EXPECT_LE(largest, 16u);
+    EXPECT_FALSE(concurrent);
+    EXPECT_EQ(bus.stats().unrouted, 1u);
+    EXPECT_LT(bus.stats().batches, 200u);
+}
+
+TEST_F(DeviceEventBusTest, FullQueuesDropWithoutBlocking) {
+    DeviceEventBus bus(DeviceEventBus::Config{}, pool_);
+    const auto type = bus.intern("data");
+
+    std::atomic<bool> release{false};
+    std::atomic<uint64_t> received{0};
+    bus.subscribe(type, [&](std::span<const DeviceEvent> events) {
+        while (!release) {
+            std::this_thread::yield();
+        }
+        received += events.size();
+    }, 4);
+    std::atomic<uint64_t> fast{0};
+    bus.subscribe(type, [&](std::span<const DeviceEvent> events) { fast += events.size(); });
+
+    // The slow handler holds its first batch; its queue then fills
+    for (int i = 0; i < 50; ++i) {
+        bus.publish(type, "dev", {});
+    }
+    EXPECT_GT(bus.stats().dropped, 0u);
+    ASSERT_TRUE(eventually([&] { return fast == 50; }));
+
+    release = true;
+    ASSERT_TRUE(eventually([&] { return bus.stats().delivered == 100 - bus.stats().dropped; }));
+    EXPECT_EQ(received + fast, bus.stats().delivered);
+}
+
+TEST_F(DeviceEventBusTest, NoCallsAfterUnsubscribe) {
+    DeviceEventBus bus(DeviceEventBus::Config{}, pool_);
+    const auto type = bus.intern("data");
+
+    std::atomic<bool> stopped{false};
+    std::atomic<bool> late{false};
+    const auto id = bus.subscribe(type, [&](std::span<const DeviceEvent>) {
+        if (stopped) {
+            late = true;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    });
+
+    std::thread producer([&] {
+        for (int i = 0; i < 2000; ++i) {
+            bus.publish(type, "dev", {});
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_TRUE(bus.unsubscribe(id));
+    stopped = true;
+    producer.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_FALSE(late);
+    EXPECT_FALSE(bus.unsubscribe(id));
+
+    // A handler may remove itself mid-batch
+    DeviceEventBus::SubscriptionId self = 0;
+    std::atomic<int> calls{0};
+    self = bus.subscribe(type, [&](std::span<const DeviceEvent>) {
+        ++calls;
+        bus.unsubscribe(self);
+    });
+    bus.publish(type, "dev", {});
+    ASSERT_TRUE(eventually([&] { return calls == 1; }));
+    bus.publish(type, "dev", {});
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(calls, 1);
+}
+
+TEST_F(DeviceEventBusTest, HandlerErrorsAreCounted) {
+    DeviceEventBus bus(DeviceEventBus::Config{}, pool_);
+    const auto type = bus.intern("data");
+    bus.subscribe(type, [](std::span<const DeviceEvent>) { throw std::runtime_error("bad device"); });
+    bus.publish(type, "dev", {});
+    ASSERT_TRUE(eventually([&] { return bus.stats().handler_errors == 1; }));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
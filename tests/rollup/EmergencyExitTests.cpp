@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "rollup/EmergencyExit.hpp"
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+std::shared_ptr<StateManager> make_state(size_t accounts) {
+    auto state = std::make_shared<StateManager>();
+    for (size_t i = 0; i < accounts; ++i) {
+        StateManager::Account account;
+        account.address = "account-" + std::to_string(i);
+        account.balance = 1000 + i;
+        account.nonce = 7;
+        state->add_account(account.address, account);
+    }
+    return state;
+}
+
+} // namespace
+
+TEST(EmergencyExitTest, CheckpointPrecomputesEveryWitness) {
+    auto state = make_state(32);
+    EmergencyExit exits(state);
+    EXPECT_TRUE(exits.checkpoint_root().empty());
+
+    const auto root = exits.checkpoint();
+    EXPECT_EQ(root, state->get_state_root());
+    EXPECT_EQ(exits.checkpoint_root(), root);
+
+    // Witnesses are built at the checkpoint, so they share its timestamp
+    const auto first = exits.generate_proof("account-0");
+    const auto last = exits.generate_proof("account-31");
+    EXPECT_EQ(first.state_root, root);
+    EXPECT_EQ(first.timestamp, last.timestamp);
+    EXPECT_FALSE(first.account_proof.steps.empty());
+    EXPECT_TRUE(exits.verify_proof(first));
+    EXPECT_TRUE(exits.verify_proof(last));
+
+    // Once the live state moves on, proofs are built against it instead
+    ASSERT_TRUE(state->set_balance("account-3", 1));
+    const auto fresh = exits.generate_proof("account-0");
+    EXPECT_EQ(fresh.state_root, state->get_state_root());
+    EXPECT_NE(fresh.state_root, root);
+    EXPECT_TRUE(exits.verify_proof(fresh));
+    EXPECT_FALSE(exits.verify_proof(first));
+
+    EXPECT_THROW(exits.generate_proof("nobody"), std::runtime_error);
+}
+
+TEST(EmergencyExitTest, ProcessExitsAcceptsValidWitnessesOnly) {
+    auto state = make_state(16);
+    EmergencyExit exits(state);
+    exits.checkpoint();
+
+    std::vector<EmergencyProof> batch;
+    batch.push_back(exits.generate_proof("account-0"));
+
+    auto bad_signature = exits.generate_proof("account-1");
+    bad_signature.signature.back() ^= 1;
+    batch.push_back(bad_signature);
+
+    auto bad_path = exits.generate_proof("account-2");
+    ASSERT_FALSE(bad_path.account_proof.steps.front().siblings.empty());
+    bad_path.account_proof.steps.front().siblings.front()[0] ^= 1;
+    batch.push_back(bad_path);
+
+    // Another account's witness, relabelled
+    auto borrowed = exits.generate_proof("account-4");
+    borrowed.account_address = "account-3";
+    batch.push_back(borrowed);
+
+    auto other_root = exits.generate_proof("account-5");
+    other_root.state_root[0] ^= 1;
+    batch.push_back(other_root);
+
+    // The same account twice exits once
+    batch.push_back(exits.generate_proof("account-6"));
+    batch.push_back(exits.generate_proof("account-6"));
+
+    const auto accepted = exits.process_exits(batch);
+    EXPECT_EQ(accepted, (std::vector<bool>{true, false, false, false, false, true, false}));
+
+    EXPECT_EQ(state->get_balance("account-0"), 0u);
+    EXPECT_EQ(state->get_nonce("account-0"), 8u);
+    EXPECT_EQ(state->get_balance("account-6"), 0u);
+    for (const char* kept : {"account-1", "account-2", "account-3", "account-5"}) {
+        EXPECT_NE(state->get_balance(kept), 0u) << kept;
+        EXPECT_EQ(state->get_nonce(kept), 7u) << kept;
+    }
+
+    // A later batch cannot exit an account again
+    EXPECT_EQ(exits.process_exits(std::vector<EmergencyProof>{batch.front()}), std::vector<bool>{false});
+}
+
+TEST(EmergencyExitTest, ProcessExitsTakesACheckpointWhenThereIsNone) {
+    auto state = make_state(4);
+    EmergencyExit exits(state);
+    const auto proof = exits.generate_proof("account-1");
+    EXPECT_EQ(exits.process_exits(std::vector<EmergencyProof>{proof}), std::vector<bool>{true});
+    EXPECT_FALSE(exits.checkpoint_root().empty());
+    EXPECT_FALSE(exits.process_exit(proof));
+}
+
+TEST(EmergencyExitTest, RejectsWitnessesDatedInTheFuture) {
+    auto state = make_state(4);
+    EmergencyExit exits(state);
+    exits.checkpoint();
+
+    const uint64_t ahead = static_cast<uint64_t>(
+        (std::chrono::system_clock::now() + std::chrono::hours(1)).time_since_epoch().count());
+    auto proof = exits.generate_proof("account-2");
+    proof.timestamp = ahead;
+    // Signed for that time, so only the clock check can refuse it
+    std::memcpy(proof.signature.data() + proof.account_address.size(), &ahead, sizeof(ahead));
+
+    EXPECT_FALSE(exits.verify_proof(proof));
+    EXPECT_FALSE(exits.process_exit(proof));
+    EXPECT_EQ(exits.process_exits(std::vector<EmergencyProof>{proof}), std::vector<bool>{false});
+    EXPECT_EQ(state->get_balance("account-2"), 1002u);
+}
+
+TEST(EmergencyExitTest, PeriodicCheckpointsFollowTheState) {
+    auto state = make_state(8);
+    EmergencyExit exits(state);
+    exits.start(std::chrono::milliseconds(5));
+    EXPECT_THROW(exits.start(std::chrono::milliseconds(5)), std::logic_error);
+
+    auto wait_for_root = [&](const std::vector<uint8_t>& root) {
+        for (int i = 0; i < 2000 && exits.checkpoint_root() != root; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return exits.checkpoint_root() == root;
+    };
+    EXPECT_TRUE(wait_for_root(state->get_state_root()));
+
+    // The next interval picks up a change without anyone asking
+    ASSERT_TRUE(state->set_balance("account-1", 5));
+    EXPECT_TRUE(wait_for_root(state->get_state_root()));
+
+    // stop() wakes the worker rather than waiting out the interval
+    exits.stop();
+    exits.start(std::chrono::hours(1));
+    const auto before = std::chrono::steady_clock::now();
+    exits.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - before, std::chrono::seconds(1));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "rollup/EncryptedMempool.hpp"
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+std::vector<uint8_t> bytes(const std::string& text) {
+    return {text.begin(), text.end()};
+}
+
+} // namespace
+
+TEST(ThresholdCipherTest, AnyThresholdSubsetRebuildsTheKey) {
+    auto [key, shares] = ThresholdCipher::deal(1, 3, 5);
+    ASSERT_EQ(shares.size(), 5u);
+    for (const auto& share : shares) {
+        EXPECT_TRUE(ThresholdCipher::verify_share(key, share));
+    }
+
+    const auto ciphertext = ThresholdCipher::encrypt(key, bytes("transfer 10 to bob"));
+    std::vector<ThresholdCipher::SecretShare> subset{shares[4], shares[0], shares[2]};
+    auto secret = ThresholdCipher::combine(key, subset);
+    ASSERT_TRUE(secret);
+    EXPECT_EQ(ThresholdCipher::decrypt(*secret, ciphertext), bytes("transfer 10 to bob"));
+
+    // Two shares say nothing about the key
+    EXPECT_FALSE(ThresholdCipher::combine(key, std::span(subset).first(2)));
+
+    auto forged = shares[1];
+    forged.value[31] ^= 1;
+    EXPECT_FALSE(ThresholdCipher::verify_share(key, forged));
+    subset[1] = forged;
+    EXPECT_FALSE(ThresholdCipher::combine(key, subset));
+}
+
+TEST(EncryptedMempoolTest, CommitsBlindThenDecryptsBatchInOrder) {
+    auto [key, shares] = ThresholdCipher::deal(7, 2, 3);
+    EncryptedMempool mempool(key);
+
+    std::vector<std::vector<uint8_t>> plaintexts;
+    for (int i = 0; i < 20; ++i) {
+        plaintexts.push_back(bytes("tx-" + std::to_string(i)));
+        ASSERT_TRUE(mempool.submit(ThresholdCipher::encrypt(key, plaintexts.back())));
+    }
+    EXPECT_FALSE(mempool.submit(mempool.ordering().front()));
+    auto tampered = ThresholdCipher::encrypt(key, bytes("tampered"));
+    tampered.body[0] ^= 1;
+    ASSERT_TRUE(mempool.submit(tampered));
+
+    // Shares are only taken once the order is fixed
+    EXPECT_THROW(mempool.add_shares(shares), std::logic_error);
+    const auto commitment = mempool.commit();
+    EXPECT_EQ(mempool.commit().batch_hash, commitment.batch_hash);
+    EXPECT_FALSE(mempool.submit(ThresholdCipher::encrypt(key, bytes("late"))));
+
+    EXPECT_EQ(mempool.add_shares(std::span(shares).first(1)), 1u);
+    EXPECT_FALSE(mempool.ready());
+    EXPECT_THROW(mempool.decrypt_batch(), std::logic_error);
+    EXPECT_EQ(mempool.add_shares(shares), 2u);
+    ASSERT_TRUE(mempool.ready());
+
+    const auto payloads = mempool.decrypt_batch();
+    ASSERT_EQ(payloads.size(), 21u);
+    for (size_t i = 0; i < plaintexts.size(); ++i) {
+        ASSERT_TRUE(payloads[i]) << i;
+        EXPECT_EQ(*payloads[i], plaintexts[i]);
+    }
+    EXPECT_FALSE(payloads.back());
+}
+
+TEST(EncryptedMempoolTest, RejectsCiphertextsForOtherEpochs) {
+    auto [key, shares] = ThresholdCipher::deal(1, 1, 1);
+    auto [other, other_shares] = ThresholdCipher::deal(2, 1, 1);
+    EncryptedMempool mempool(key);
+    EXPECT_FALSE(mempool.submit(ThresholdCipher::encrypt(other, bytes("x"))));
+    EXPECT_EQ(mempool.size(), 0u);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+#include "rollup/EnhancedRollupMLModel.hpp"
+#include "rollup/RollupPerformanceMetrics.hpp"
+#include "quantum/QuantumParameters.hpp"
+#include "TestStorage.hpp"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+EnhancedRollupMLModel::ModelParameters smallModel() {
+    return {16, 2, 0.01, 0.9, 0.999, 1e-8};
+}
+
+struct History {
+    std::vector<RollupPerformanceMetrics> metrics;
+    std::vector<QuantumParameters> params;
+    // What the model should predict for each row
+    Eigen::MatrixXf targets;
+};
+
+// Targets are a smooth function of the features, so the model can fit them
+History synthetic(size_t samples, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    History history;
+    history.targets.resize(static_cast<Eigen::Index>(samples), 3);
+    for (size_t i = 0; i < samples; ++i) {
+        const double a = unit(rng);
+        const double b = unit(rng);
+        const double c = unit(rng);
+        RollupPerformanceMetrics metrics;
+        metrics.tx_throughput = 500.0 + 1000.0 * a;
+        metrics.avg_tx_latency = 0.01 + 0.1 * b;
+        metrics.verification_time = 0.5 + c;
+        metrics.quantum_energy_usage = 50.0 + 50.0 * a * b;
+        const double angle = 0.5 * a - 0.3 * b;
+        const size_t qubits = static_cast<size_t>(200.0 + 400.0 * c);
+        const double entanglement = 0.9 + 0.1 * (0.5 * a + 0.5 * c);
+        history.metrics.push_back(metrics);
+        history.params.emplace_back(std::vector<double>{angle}, qubits, entanglement, true);
+        const auto row = static_cast<Eigen::Index>(i);
+        history.targets(row, 0) = static_cast<float>(angle);
+        history.targets(row, 1) = static_cast<float>(qubits) / 1000.0f;
+        history.targets(row, 2) = static_cast<float>((entanglement - 0.9) / 0.1);
+    }
+    return history;
+}
+
+float meanSquaredError(const Eigen::MatrixXf& predicted, const Eigen::MatrixXf& targets) {
+    return (predicted - targets).squaredNorm() / static_cast<float>(predicted.rows());
+}
+
+Eigen::VectorXd features(const RollupPerformanceMetrics& metrics) {
+    Eigen::VectorXd row(4);
+    row << metrics.tx_throughput, metrics.avg_tx_latency, metrics.verification_time, metrics.quantum_energy_usage;
+    return row;
+}
+
+bool eventually(const std::function<bool()>& done) {
+    const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!done() && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return done();
+}
+
+} // namespace
+
+class EnhancedRollupMLModelCheckpointTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = quids::test::uniqueTempPath("enhanced_ml_model_");
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    std::string path(const std::string& name) const {
+        return (dir_ / name).string();
+    }
+
+    std::filesystem::path dir_;
+};
+
+TEST(EnhancedRollupMLModelTest, BatchedInferenceMatchesOneSampleAtATime) {
+    EnhancedRollupMLModel model(smallModel());
+    const auto history = synthetic(64, 1);
+    model.train(history.metrics, history.params);
+
+    const Eigen::MatrixXf batch = model.predict_batch(history.metrics);
+    ASSERT_EQ(batch.rows(), 64);
+    ASSERT_EQ(batch.cols(), 3);
+    for (Eigen::Index i = 0; i < batch.rows(); ++i) {
+        const Eigen::VectorXd single = model.forward_pass(features(history.metrics[static_cast<size_t>(i)]));
+        EXPECT_TRUE(batch.row(i).transpose().isApprox(single.cast<float>(), 1e-5f)) << i;
+    }
+
+    // The raw outputs decode into parameters
+    const auto params = model.predict_optimal_parameters(history.metrics[0]);
+    ASSERT_EQ(params.phase_angles.size(), 1u);
+    EXPECT_NEAR(params.phase_angles[0], batch(0, 0), 1e-5);
+    EXPECT_NEAR(params.entanglement_degree, 0.9 + 0.1 * batch(0, 2), 1e-5);
+
+    EXPECT_EQ(model.predict_batch({}).rows(), 0);
+    EXPECT_THROW((void)model.forward_pass(Eigen::VectorXd::Zero(3)), std::invalid_argument);
+}
+
+TEST(EnhancedRollupMLModelTest, TrainingFitsALearnableTarget) {
+    EnhancedRollupMLModel model(smallModel());
+    const auto history = synthetic(256, 2);
+    const auto held_out = synthetic(64, 3);
+
+    model.train(history.metrics, history.params);
+    const float early = meanSquaredError(model.predict_batch(held_out.metrics), held_out.targets);
+    for (int round = 0; round < 20; ++round) {
+        model.train(history.metrics, history.params);
+    }
+    const float late = meanSquaredError(model.predict_batch(held_out.metrics), held_out.targets);
+    EXPECT_LT(late, early * 0.5f);
+    EXPECT_LT(late, 0.01f);
+
+    // A zero batch size still trains one sample at a time
+    model.set_batch_size(0);
+    EXPECT_NO_THROW(model.train(history.metrics, history.params));
+    // Nothing to learn from leaves the model as it was
+    const Eigen::MatrixXf before = model.predict_batch(held_out.metrics);
+    model.train({}, {});
+    EXPECT_TRUE(model.predict_batch(held_out.metrics).isApprox(before));
+}
+
+TEST(EnhancedRollupMLModelTest, Int8InferenceStaysCloseToFloat) {
+    EnhancedRollupMLModel model(smallModel());
+    const auto history = synthetic(256, 4);
+    for (int round = 0; round < 10; ++round) {
+        model.train(history.metrics, history.params);
+    }
+    const auto probe = synthetic(64, 5);
+    const Eigen::MatrixXf exact = model.predict_batch(probe.metrics);
+
+    model.set_quantized_inference(true);
+    const Eigen::MatrixXf quantized = model.predict_batch(probe.metrics);
+    EXPECT_LT((quantized - exact).cwiseAbs().maxCoeff(), 0.1f);
+    EXPECT_FALSE(quantized.isApprox(exact, 1e-7f));
+
+    // Training while quantized keeps the int8 copy current
+    model.train(history.metrics, history.params);
+    const Eigen::MatrixXf retrained = model.predict_batch(probe.metrics);
+    model.set_quantized_inference(false);
+    EXPECT_LT((retrained - model.predict_batch(probe.metrics)).cwiseAbs().maxCoeff(), 0.1f);
+}
+
+TEST(EnhancedRollupMLModelTest, TrainsIncrementallyOnOnlyTheNewSamples) {
+    EnhancedRollupMLModel model(smallModel());
+    const auto history = synthetic(5000, 6);
+    EXPECT_EQ(model.train_incremental(), 0u);
+
+    for (size_t i = 0; i < 50; ++i) {
+        model.observe(history.metrics[i], history.params[i]);
+    }
+    EXPECT_EQ(model.train_incremental(), 50u);
+    EXPECT_EQ(model.train_incremental(), 0u);
+
+    // Samples overwritten before a step are skipped
+    for (size_t i = 0; i < history.metrics.size(); ++i) {
+        model.observe(history.metrics[i], history.params[i]);
+    }
+    EXPECT_EQ(model.train_incremental(), 4096u);
+
+    // Repeated steps learn the way a full retrain does
+    const auto held_out = synthetic(64, 7);
+    const float early = meanSquaredError(model.predict_batch(held_out.metrics), held_out.targets);
+    for (int round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < 512; ++i) {
+            model.observe(history.metrics[i], history.params[i]);
+        }
+        EXPECT_EQ(model.train_incremental(), 512u);
+    }
+    EXPECT_LT(meanSquaredError(model.predict_batch(held_out.metrics), held_out.targets), early);
+}
+
+TEST_F(EnhancedRollupMLModelCheckpointTest, RoundTripsThroughACheckpoint) {
+    EnhancedRollupMLModel model(smallModel());
+    const auto history = synthetic(128, 8);
+    model.train(history.metrics, history.params);
+    model.save_model(path("model.ckpt"));
+
+    EnhancedRollupMLModel restored(smallModel());
+    ASSERT_TRUE(restored.load_model(path("model.ckpt")));
+    EXPECT_EQ(restored.predict_batch(history.metrics), model.predict_batch(history.metrics));
+
+    // Training after a load moves off the mapped weights, not the file
+    restored.train(history.metrics, history.params);
+    EnhancedRollupMLModel again(smallModel());
+    ASSERT_TRUE(again.load_model(path("model.ckpt")));
+    EXPECT_EQ(again.predict_batch(history.metrics), model.predict_batch(history.metrics));
+}
+
+TEST_F(EnhancedRollupMLModelCheckpointTest, RejectsCheckpointsItCannotUse) {
+    EnhancedRollupMLModel model(smallModel());
+    const auto history = synthetic(64, 9);
+    model.train(history.metrics, history.params);
+    const Eigen::MatrixXf before = model.predict_batch(history.metrics);
+
+    EXPECT_FALSE(model.load_model(path("missing.ckpt")));
+
+    auto wider = smallModel();
+    wider.hidden_size = 32;
+    EnhancedRollupMLModel other(wider);
+    other.save_model(path("wider.ckpt"));
+    EXPECT_FALSE(model.load_model(path("wider.ckpt")));
+
+    auto deeper = smallModel();
+    deeper.num_layers = 3;
+    EnhancedRollupMLModel stacked(deeper);
+    stacked.save_model(path("deeper.ckpt"));
+    EXPECT_FALSE(model.load_model(path("deeper.ckpt")));
+
+    std::ofstream(path("garbage.ckpt"), std::ios::binary) << std::string(4096, 'x');
+    EXPECT_FALSE(model.load_model(path("garbage.ckpt")));
+
+    EXPECT_EQ(model.predict_batch(history.metrics), before);
+}
+
+TEST_F(EnhancedRollupMLModelCheckpointTest, CheckpointsOnlyWhenTheWeightsChange) {
+    EnhancedRollupMLModel model(smallModel());
+    const auto history = synthetic(64, 10);
+    const auto file = path("auto.ckpt");
+
+    // The first tick saves even an untrained model
+    model.start_checkpoints(file, std::chrono::milliseconds(10));
+    ASSERT_TRUE(eventually([&] { return std::filesystem::exists(file); }));
+    std::filesystem::remove(file);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(std::filesystem::exists(file));
+
+    for (size_t i = 0; i < history.metrics.size(); ++i) {
+        model.observe(history.metrics[i], history.params[i]);
+    }
+    ASSERT_EQ(model.train_incremental(), 64u);
+    ASSERT_TRUE(eventually([&] { return std::filesystem::exists(file); }));
+    model.stop_checkpoints();
+
+    EnhancedRollupMLModel restored(smallModel());
+    ASSERT_TRUE(restored.load_model(file));
+    EXPECT_EQ(restored.predict_batch(history.metrics), model.predict_batch(history.metrics));
+
+    // Stopping twice is fine, and a stopped worker writes nothing
+    model.stop_checkpoints();
+    std::filesystem::remove(file);
+    model.train(history.metrics, history.params);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(std::filesystem::exists(file));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "rollup/FeatureStore.hpp"
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+void push_sample(FeatureStore& store, float value) {
+    store.push(Eigen::RowVectorXf::Constant(2, value), Eigen::RowVectorXf::Constant(1, -value));
+}
+
+} // namespace
+
+TEST(FeatureStoreTest, ReadsOnlyNewSamplesInOrder) {
+    FeatureStore store(8, 2, 1);
+    FeatureStore::Matrix features;
+    FeatureStore::Matrix targets;
+
+    for (int i = 0; i < 3; ++i) {
+        push_sample(store, static_cast<float>(i));
+    }
+    uint64_t cursor = store.read_since(0, features, targets);
+    EXPECT_EQ(cursor, 3u);
+    ASSERT_EQ(features.rows(), 3);
+    EXPECT_EQ(features(2, 1), 2.0f);
+    EXPECT_EQ(targets(2, 0), -2.0f);
+
+    EXPECT_EQ(store.read_since(cursor, features, targets), 3u);
+    EXPECT_EQ(features.rows(), 0);
+
+    push_sample(store, 3.0f);
+    cursor = store.read_since(cursor, features, targets);
+    ASSERT_EQ(features.rows(), 1);
+    EXPECT_EQ(features(0, 0), 3.0f);
+}
+
+TEST(FeatureStoreTest, StaysBoundedAndSkipsOverwrittenSamples) {
+    FeatureStore store(4, 2, 1);
+    for (int i = 0; i < 10; ++i) {
+        push_sample(store, static_cast<float>(i));
+    }
+    EXPECT_EQ(store.size(), 4u);
+    EXPECT_EQ(store.total(), 10u);
+
+    FeatureStore::Matrix features;
+    FeatureStore::Matrix targets;
+    // Samples 0-5 are gone; the rest wrap around the ring
+    EXPECT_EQ(store.read_since(1, features, targets), 10u);
+    ASSERT_EQ(features.rows(), 4);
+    for (Eigen::Index i = 0; i < 4; ++i) {
+        EXPECT_EQ(features(i, 0), static_cast<float>(6 + i));
+    }
+
+    EXPECT_THROW(store.push(Eigen::RowVectorXf::Zero(3), Eigen::RowVectorXf::Zero(1)), std::invalid_argument);
+    EXPECT_THROW(FeatureStore(0, 1, 1), std::invalid_argument);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include "rollup/FraudProof.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "TestTransactions.hpp"
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+using Claims = std::vector<FraudProof::StateClaim>;
+
+blockchain::TransactionPtr transfer(const std::string& from, const std::string& to, uint64_t value,
+                                    uint64_t nonce) {
+    return quids::test::makeSignedTransfer(from, to, value, nonce, 1);
+}
+
+std::unique_ptr<StateManager> make_state() {
+    auto state = std::make_unique<StateManager>();
+    for (int i = 0; i < 8; ++i) {
+        StateManager::Account account;
+        account.address = "account-" + std::to_string(i);
+        account.balance = 1'000'000;
+        account.nonce = 0;
+        state->add_account(account.address, account);
+    }
+    return state;
+}
+
+// Sixteen transfers around the accounts; `value_at` overrides one amount
+std::vector<blockchain::TransactionPtr> batch(size_t changed = SIZE_MAX, uint64_t value_at = 0) {
+    std::vector<blockchain::TransactionPtr> txs;
+    std::vector<uint64_t> nonces(8, 0);
+    for (size_t i = 0; i < 16; ++i) {
+        const size_t from = i % 8;
+        const size_t to = (i * 3 + 1) % 8;
+        txs.push_back(transfer("account-" + std::to_string(from), "account-" + std::to_string(to),
+                               i == changed ? value_at : 100 + i, ++nonces[from]));
+    }
+    return txs;
+}
+
+Claims trace_all(const StateManager& pre, const std::vector<blockchain::TransactionPtr>& txs, size_t stride) {
+    Claims claims;
+    FraudProof::trace(pre, txs, stride, [&](FraudProof::StateClaim&& claim) {
+        claims.push_back(std::move(claim));
+        return true;
+    });
+    return claims;
+}
+
+// Plays the game with the asserter answering from `asserted` and the
+// challenger agreeing whenever the root matches its own trace
+FraudProof::Bisection bisect(const StateManager& pre, const Claims& asserted, const Claims& honest) {
+    FraudProof::Bisection game(FraudProof::initial_claim(pre), asserted.back());
+    while (!game.resolved()) {
+        const size_t at = game.midpoint();
+        const auto& claim = asserted.at(at - 1);
+        game.respond(claim, claim.root == honest.at(at - 1).root);
+    }
+    return game;
+}
+
+} // namespace
+
+TEST(FraudProofTest, HonestTraceSurvivesTheGame) {
+    const auto pre = make_state();
+    const auto txs = batch();
+    const auto honest = trace_all(*pre, txs, 1);
+    ASSERT_EQ(honest.size(), txs.size());
+    for (const auto& claim : honest) {
+        EXPECT_TRUE(FraudProof::consistent(*pre, claim)) << claim.index;
+    }
+
+    const auto game = bisect(*pre, honest, honest);
+    EXPECT_EQ(game.disputed().index, 16u);
+    EXPECT_EQ(game.agreed().index, 15u);
+    EXPECT_EQ(game.rounds(), 4u);
+    EXPECT_FALSE(FraudProof::verify_step(*pre, txs, game).is_valid);
+
+    EXPECT_FALSE(FraudProof::find_divergent_segment(*pre, txs, trace_all(*pre, txs, 4)).has_value());
+}
+
+TEST(FraudProofTest, BisectionFindsTheOneBadStep) {
+    const auto pre = make_state();
+    const auto txs = batch();
+    const auto honest = trace_all(*pre, txs, 1);
+    // The asserter runs transaction 10 with a different amount, so every
+    // root from index 11 on is wrong while each stays consistent with its writes
+    const auto asserted = trace_all(*pre, batch(10, 5000), 1);
+    for (size_t i = 0; i < 10; ++i) {
+        ASSERT_EQ(asserted[i].root, honest[i].root) << i;
+    }
+    ASSERT_NE(asserted[10].root, honest[10].root);
+
+    const auto game = bisect(*pre, asserted, honest);
+    EXPECT_EQ(game.agreed().index, 10u);
+    EXPECT_EQ(game.disputed().index, 11u);
+    const auto result = FraudProof::verify_step(*pre, txs, game);
+    EXPECT_TRUE(result.is_valid);
+    EXPECT_NE(result.message.find("Transaction 10"), std::string::npos) << result.message;
+    EXPECT_THROW(const_cast<FraudProof::Bisection&>(game).respond(asserted[10], true), std::logic_error);
+
+    // A challenger holding only the witness reaches the same verdict
+    const auto witness = FraudProof::witness_step(*pre, txs, game);
+    const auto pre_root = FraudProof::initial_claim(*pre).root;
+    EXPECT_TRUE(FraudProof::verify_step(witness, pre_root, txs, game).is_valid);
+    auto other_root = pre_root;
+    other_root[0] ^= 1;
+    EXPECT_THROW(FraudProof::verify_step(witness, other_root, txs, game), std::invalid_argument);
+
+    // Checkpoints every four transactions put the fault in the third segment
+    EXPECT_EQ(FraudProof::find_divergent_segment(*pre, txs, trace_all(*pre, batch(10, 5000), 4)), 2u);
+}
+
+TEST(FraudProofTest, ClaimWhoseWritesMissTheRootIsFraud) {
+    const auto pre = make_state();
+    const auto txs = batch();
+    auto honest = trace_all(*pre, txs, 1);
+
+    // Agreed to at index 7, but its writes were tampered with
+    auto agreed = honest[6];
+    agreed.writes.front().second.balance += 1;
+    EXPECT_FALSE(FraudProof::consistent(*pre, agreed));
+    FraudProof::Bisection game(agreed, honest[7]);
+    ASSERT_TRUE(game.resolved());
+    EXPECT_TRUE(FraudProof::verify_step(*pre, txs, game).is_valid);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "utils/AdaptiveBatchController.hpp"
+#include "utils/HealthSampler.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using utils::HealthSampler;
+
+// The sampler is process-wide; tests drive its ticks by hand
+class HealthSamplerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        sampler().stop();
+        HealthSampler::Config config;
+        config.tick = std::chrono::milliseconds(100);
+        sampler().configure(config);
+    }
+
+    void TearDown() override { sampler().stop(); }
+
+    static HealthSampler& sampler() { return HealthSampler::global(); }
+};
+
+TEST_F(HealthSamplerTest, TicksFillTheWindows) {
+    EXPECT_EQ(sampler().snapshot().ticks, 0u);
+
+    for (int i = 0; i < 12; ++i) {
+        sampler().tick();
+    }
+    const auto snapshot = sampler().snapshot();
+    EXPECT_EQ(snapshot.ticks, 12u);
+    EXPECT_GT(snapshot.latest.memory_mb, 0.0);
+    EXPECT_GT(snapshot.last_10s.memory_mb, 0.0);
+    EXPECT_GE(snapshot.latest.disk_usage, 0.0);
+    EXPECT_LE(snapshot.latest.disk_usage, 1.0);
+    EXPECT_GE(snapshot.last_1s.cpu_usage, 0.0);
+    EXPECT_GE(snapshot.cpu_peak_10s, snapshot.last_10s.cpu_usage);
+    EXPECT_GT(snapshot.sampled_at_ns, 0);
+
+    // configure() starts the windows over
+    sampler().configure({});
+    EXPECT_EQ(sampler().snapshot().ticks, 0u);
+    sampler().tick();
+    EXPECT_EQ(sampler().snapshot().ticks, 1u);
+}
+
+TEST_F(HealthSamplerTest, LatencyIsTheMeanPerTick) {
+    sampler().record_network_latency(std::chrono::microseconds(100));
+    sampler().record_network_latency(std::chrono::microseconds(300));
+    sampler().tick();
+    EXPECT_DOUBLE_EQ(sampler().snapshot().latest.network_latency_us, 200.0);
+
+    // A tick without round trips keeps the last mean
+    sampler().tick();
+    const auto snapshot = sampler().snapshot();
+    EXPECT_DOUBLE_EQ(snapshot.latest.network_latency_us, 200.0);
+    EXPECT_DOUBLE_EQ(snapshot.last_1s.network_latency_us, 200.0);
+}
+
+TEST_F(HealthSamplerTest, BackgroundThreadPublishesConsistentSnapshots) {
+    HealthSampler::Config config;
+    config.tick = std::chrono::milliseconds(1);
+    sampler().start(config);
+
+    std::atomic<bool> torn{false};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            for (int i = 0; i < 20000; ++i) {
+                const auto snapshot = sampler().snapshot();
+                if (snapshot.ticks < last || snapshot.latest.cpu_usage < 0.0 ||
+                    (snapshot.ticks > 0 && snapshot.latest.memory_mb <= 0.0)) {
+                    torn = true;
+                }
+                last = snapshot.ticks;
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    while (sampler().snapshot().ticks < 5) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    sampler().stop();
+    EXPECT_FALSE(torn);
+}
+
+TEST(AdaptiveBatchControllerLoadTest, HoldsGrowthWhileCpuBound) {
+    utils::AdaptiveBatchController::Config config;
+    config.min_batch_size = 10;
+    config.max_batch_size = 100;
+    config.increase_step = 10;
+    config.cpu_ceiling = 0.8;
+    utils::AdaptiveBatchController controller(config);
+    // Starts at the largest batch; one slow batch gives it room to grow
+    controller.observe(config.max_batch_size, config.max_batch_size, config.latency_target * 10, 0);
+    const size_t start = controller.batchSize();
+    ASSERT_LT(start, config.max_batch_size);
+
+    controller.observeLoad(0.95);
+    for (int i = 0; i < 20; ++i) {
+        controller.observe(start, start, std::chrono::microseconds(1), 1000);
+    }
+    EXPECT_EQ(controller.batchSize(), start);
+
+    controller.observeLoad(0.2);
+    for (int i = 0; i < 20; ++i) {
+        controller.observe(controller.batchSize(), controller.batchSize(), std::chrono::microseconds(1), 1000);
+    }
+    EXPECT_GT(controller.batchSize(), start);
+
+    config.cpu_ceiling = 0.0;
+    EXPECT_THROW(utils::AdaptiveBatchController{config}, std::invalid_argument);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "utils/Hex.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace utils {
+namespace test {
+
+namespace {
+
+struct Kernels {
+    const char* name;
+    CpuFeature feature;
+    hex_detail::Encode encode;
+    hex_detail::Decode decode;
+    hex_detail::Validate validate;
+};
+
+// Every variant this host can run, so each is checked against the scalar
+// loop whichever one the process selected
+std::vector<Kernels> host_kernels() {
+    std::vector<Kernels> kernels = {
+        {"scalar", CpuFeature::Scalar, hex_detail::encodeScalar, hex_detail::decodeScalar,
+         hex_detail::validateScalar},
+#if QUIDS_HEX_X86
+        {"sse", CpuFeature::Sse42, hex_detail::encodeSse, hex_detail::decodeSse, hex_detail::validateSse},
+        {"avx2", CpuFeature::Avx2, hex_detail::encodeAvx2, hex_detail::decodeAvx2, hex_detail::validateAvx2},
+#endif
+#if QUIDS_HEX_NEON
+        {"neon", CpuFeature::Neon, hex_detail::encodeNeon, hex_detail::decodeNeon, hex_detail::validateNeon},
+#endif
+    };
+    std::erase_if(kernels, [](const Kernels& k) { return !CpuFeatures::host().has(k.feature); });
+    return kernels;
+}
+
+std::string reference_hex(const std::vector<uint8_t>& bytes) {
+    std::string out;
+    for (uint8_t b : bytes) {
+        out.push_back("0123456789abcdef"[b >> 4]);
+        out.push_back("0123456789abcdef"[b & 0x0f]);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(HexTest, EveryKernelRoundTripsEveryLength) {
+    std::mt19937 rng(7);
+    for (const auto& k : host_kernels()) {
+        // Past two AVX2 blocks, with every tail length on the way
+        for (size_t n = 0; n <= 100; ++n) {
+            std::vector<uint8_t> bytes(n);
+            for (auto& b : bytes) b = static_cast<uint8_t>(rng());
+            const std::string expected = reference_hex(bytes);
+
+            std::string text(2 * n, '\0');
+            k.encode(bytes.data(), n, text.data());
+            ASSERT_EQ(text, expected) << k.name << " n=" << n;
+
+            std::vector<uint8_t> decoded(n);
+            ASSERT_TRUE(k.decode(text.data(), n, decoded.data())) << k.name << " n=" << n;
+            EXPECT_EQ(decoded, bytes) << k.name << " n=" << n;
+            EXPECT_TRUE(k.validate(text.data(), text.size())) << k.name << " n=" << n;
+        }
+    }
+}
+
+TEST(HexTest, DecodingTakesEitherCase) {
+    const std::string mixed = "00ffAb9C0aBcDeF0123456789abcdefABCDEF0123456789aBcDeFabcdef012345";
+    std::vector<uint8_t> expected(mixed.size() / 2);
+    ASSERT_TRUE(hex_detail::decodeScalar(mixed.data(), expected.size(), expected.data()));
+    EXPECT_EQ(expected[1], 0xff);
+    EXPECT_EQ(expected[2], 0xab);
+    for (const auto& k : host_kernels()) {
+        std::vector<uint8_t> decoded(expected.size());
+        ASSERT_TRUE(k.decode(mixed.data(), decoded.size(), decoded.data())) << k.name;
+        EXPECT_EQ(decoded, expected) << k.name;
+    }
+}
+
+TEST(HexTest, NonDigitsAreRejectedAnywhere) {
+    std::vector<char> bad;
+    for (int c = 0; c < 256; ++c) {
+        if (hex_detail::digitValue(static_cast<char>(c)) < 0) bad.push_back(static_cast<char>(c));
+    }
+    ASSERT_EQ(bad.size(), 256u - 22u);
+
+    for (const auto& k : host_kernels()) {
+        const std::string valid(128, 'a');
+        std::vector<uint8_t> out(valid.size() / 2);
+        for (size_t pos = 0; pos < valid.size(); pos += 5) {
+            for (char c : bad) {
+                std::string text = valid;
+                text[pos] = c;
+                EXPECT_FALSE(k.decode(text.data(), out.size(), out.data())) << k.name << " pos=" << pos;
+                EXPECT_FALSE(k.validate(text.data(), text.size())) << k.name << " pos=" << pos;
+            }
+        }
+    }
+}
+
+TEST(HexTest, PublicHelpers) {
+    const std::vector<uint8_t> bytes = {0xde, 0xad, 0xbe, 0xef};
+    EXPECT_EQ(toHex(bytes), "deadbeef");
+    EXPECT_EQ(fromHex("DEADbeef"), bytes);
+    EXPECT_FALSE(fromHex("deadbee").has_value());
+    EXPECT_FALSE(fromHex("0xdeadbeef").has_value());
+    EXPECT_TRUE(fromHex("").has_value());
+    EXPECT_TRUE(isHex("0123456789abcdefABCDEF"));
+    EXPECT_FALSE(isHex("qu_0x00"));
+}
+
+} // namespace test
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "rollup/HistoryIndexer.hpp"
+#include "TestStorage.hpp"
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+using Ref = HistoryIndexer::Ref;
+using Query = HistoryIndexer::Query;
+using Position = std::pair<uint64_t, uint32_t>;
+
+Ref ref(const std::string& address, uint64_t block, uint32_t index) {
+    Ref r;
+    r.address = address;
+    r.block_number = block;
+    r.index = index;
+    r.tx_hash.fill(0);
+    for (int i = 0; i < 8; ++i) {
+        r.tx_hash[i] = static_cast<uint8_t>(block >> (8 * i));
+    }
+    r.tx_hash[8] = static_cast<uint8_t>(index);
+    r.tx_hash[9] = static_cast<uint8_t>(address.size());
+    return r;
+}
+
+std::vector<Position> positions(const std::vector<Ref>& refs) {
+    std::vector<Position> out;
+    for (const auto& r : refs) {
+        out.emplace_back(r.block_number, r.index);
+    }
+    return out;
+}
+
+// Every page of a query, following the cursors
+std::vector<std::vector<Position>> pages(const HistoryIndexer& indexer, const std::string& address, Query query) {
+    std::vector<std::vector<Position>> out;
+    while (true) {
+        const auto page = indexer.query(address, query);
+        out.push_back(positions(page.entries));
+        if (!page.next) {
+            return out;
+        }
+        query.after = page.next;
+    }
+}
+
+} // namespace
+
+class HistoryIndexerTest : public quids::test::TempStorageTest {
+protected:
+    HistoryIndexerTest() : TempStorageTest("history_") {}
+
+    void SetUp() override {
+        TempStorageTest::SetUp();
+        indexer_ = std::make_unique<HistoryIndexer>(storage_);
+    }
+
+    void TearDown() override {
+        indexer_.reset();
+        TempStorageTest::TearDown();
+    }
+
+    // Blocks 1..5 with two transactions of "ab" each; the last has three
+    void indexBlocks() {
+        for (uint64_t block = 1; block <= 5; ++block) {
+            std::vector<Ref> refs{ref("ab", block, 0), ref("ab", block, 2)};
+            if (block == 5) {
+                refs.push_back(ref("ab", block, 7));
+            }
+            refs.push_back(ref("abc", block, 1));
+            indexer_->enqueue(std::move(refs));
+        }
+        ASSERT_TRUE(indexer_->flush());
+    }
+
+    std::unique_ptr<HistoryIndexer> indexer_;
+};
+
+TEST_F(HistoryIndexerTest, PagesNewestFirstWithoutGapsOrRepeats) {
+    indexBlocks();
+    Query query;
+    query.limit = 4;
+    const auto all = pages(*indexer_, "ab", query);
+    ASSERT_EQ(all.size(), 3u);
+    EXPECT_EQ(all[0], (std::vector<Position>{{5, 7}, {5, 2}, {5, 0}, {4, 2}}));
+    EXPECT_EQ(all[1], (std::vector<Position>{{4, 0}, {3, 2}, {3, 0}, {2, 2}}));
+    EXPECT_EQ(all[2], (std::vector<Position>{{2, 0}, {1, 2}, {1, 0}}));
+
+    // A page that ends exactly on the last entry has no cursor
+    query.limit = 11;
+    const auto exact = indexer_->query("ab", query);
+    EXPECT_EQ(exact.entries.size(), 11u);
+    EXPECT_FALSE(exact.next);
+    EXPECT_EQ(exact.entries.front().tx_hash, ref("ab", 5, 7).tx_hash);
+}
+
+TEST_F(HistoryIndexerTest, PagesOldestFirstWithinABlockRange) {
+    indexBlocks();
+    Query query;
+    query.newest_first = false;
+    query.from_block = 2;
+    query.to_block = 4;
+    query.limit = 4;
+    const auto all = pages(*indexer_, "ab", query);
+    ASSERT_EQ(all.size(), 2u);
+    EXPECT_EQ(all[0], (std::vector<Position>{{2, 0}, {2, 2}, {3, 0}, {3, 2}}));
+    EXPECT_EQ(all[1], (std::vector<Position>{{4, 0}, {4, 2}}));
+
+    // A cursor from outside the range does not widen it
+    query.after = Position{0, 0};
+    EXPECT_EQ(positions(indexer_->query("ab", query).entries).front(), (Position{2, 0}));
+    query.newest_first = true;
+    query.after = Position{9, 0};
+    EXPECT_EQ(positions(indexer_->query("ab", query).entries).front(), (Position{4, 2}));
+
+    query.from_block = 5;
+    query.to_block = 4;
+    EXPECT_TRUE(indexer_->query("ab", query).entries.empty());
+    query.from_block = 0;
+    query.limit = 0;
+    EXPECT_TRUE(indexer_->query("ab", query).entries.empty());
+}
+
+TEST_F(HistoryIndexerTest, KeepsAddressesThatSharePrefixesApart) {
+    indexBlocks();
+    Query query;
+    query.newest_first = false;
+    const auto abc = indexer_->query("abc", query);
+    EXPECT_EQ(positions(abc.entries), (std::vector<Position>{{1, 1}, {2, 1}, {3, 1}, {4, 1}, {5, 1}}));
+    for (const auto& entry : abc.entries) {
+        EXPECT_EQ(entry.address, "abc");
+    }
+    EXPECT_EQ(indexer_->query("ab", query).entries.size(), 11u);
+    EXPECT_TRUE(indexer_->query("a", query).entries.empty());
+    EXPECT_TRUE(indexer_->query("abcd", query).entries.empty());
+}
+
+TEST_F(HistoryIndexerTest, FlushMakesQueuedBlocksVisible) {
+    for (uint64_t block = 1; block <= 50; ++block) {
+        indexer_->enqueue({ref("carol", block, 0)});
+    }
+    ASSERT_TRUE(indexer_->flush());
+    Query query;
+    query.limit = 100;
+    EXPECT_EQ(indexer_->query("carol", query).entries.size(), 50u);
+
+    const auto stats = indexer_->stats();
+    EXPECT_EQ(stats.indexed_blocks, 50u);
+    EXPECT_EQ(stats.indexed_refs, 50u);
+    EXPECT_EQ(stats.failed_flushes, 0u);
+    // Blocks queued while the writer was busy share a batch
+    EXPECT_LE(stats.flushed_batches, 50u);
+    EXPECT_GE(stats.flushed_batches, 1u);
+
+    // Nothing queued: flush returns at once
+    EXPECT_TRUE(indexer_->flush());
+    EXPECT_THROW(HistoryIndexer(nullptr), std::invalid_argument);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include "rollup/L1Batcher.hpp"
+#include "TestStorage.hpp"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+// Records everything sent; status() answers from a per-id table
+class FakeClient : public L1Batcher::Client {
+public:
+    L1Batcher::Fees fees() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return quote;
+    }
+
+    uint64_t next_nonce() override { return 7; }
+
+    std::string send(const L1Batcher::L1Transaction& tx) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        sent.push_back(tx);
+        return "tx" + std::to_string(sent.size());
+    }
+
+    L1Batcher::TxStatus status(const std::string& id) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = statuses.find(id);
+        return it == statuses.end() ? L1Batcher::TxStatus::Pending : it->second;
+    }
+
+    size_t sent_count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return sent.size();
+    }
+
+    std::mutex mutex;
+    L1Batcher::Fees quote{10, 1, 1};
+    std::vector<L1Batcher::L1Transaction> sent;
+    std::map<std::string, L1Batcher::TxStatus> statuses;
+};
+
+L2BlockProcessor::L2Block make_block(uint64_t number) {
+    L2BlockProcessor::L2Block block;
+    block.block_number = number;
+    block.state_root.fill(static_cast<uint8_t>(number + 1));
+    block.block_hash.fill(static_cast<uint8_t>(number + 100));
+    block.block_proof.proof_data.assign(8, static_cast<uint8_t>(number));
+    block.block_proof.is_valid = true;
+    return block;
+}
+
+template<typename Pred>
+bool wait_for(Pred pred) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+L1Batcher::Config fast_config() {
+    L1Batcher::Config config;
+    config.poll_interval = std::chrono::milliseconds(2);
+    config.max_delay = std::chrono::hours(1);
+    config.replace_after = std::chrono::hours(1);
+    return config;
+}
+
+} // namespace
+
+class L1BatcherTest : public quids::test::TempStorageTest {
+protected:
+    L1BatcherTest() : TempStorageTest("l1batcher_") {}
+};
+
+TEST(L1BatcherCodecTest, BlobsRoundTripAndKeepElementsInRange) {
+    std::vector<uint8_t> bytes(L1Batcher::BLOB_CAPACITY + 100);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(0xFF - i);
+    }
+    auto blobs = L1Batcher::encode_blobs(bytes);
+    ASSERT_EQ(blobs.size(), 2 * L1Batcher::BLOB_SIZE);
+    for (size_t i = 0; i < blobs.size(); i += 32) {
+        ASSERT_EQ(blobs[i], 0) << i;
+    }
+    EXPECT_EQ(L1Batcher::decode_blobs(blobs), bytes);
+
+    blobs[32] = 1;
+    EXPECT_THROW(L1Batcher::decode_blobs(blobs), std::invalid_argument);
+    EXPECT_EQ(L1Batcher::calldata_gas(std::vector<uint8_t>{0, 1, 0, 2}), 40u);
+}
+
+TEST_F(L1BatcherTest, PacksBlocksIntoOneFrameWithOneAggregate) {
+    auto client = std::make_shared<FakeClient>();
+    L1Batcher batcher(client, storage_, fast_config());
+    for (uint64_t n = 0; n < 5; ++n) {
+        EXPECT_TRUE(batcher.add_block(make_block(n)));
+    }
+    EXPECT_FALSE(batcher.add_block(make_block(2)));
+    batcher.flush();
+    ASSERT_TRUE(wait_for([&] { return client->sent_count() == 1; }));
+
+    const auto tx = client->sent.front();
+    EXPECT_EQ(tx.nonce, 7u);
+    // Tiny frames are cheaper as calldata than as a whole blob
+    ASSERT_EQ(tx.posting, L1Batcher::Posting::Calldata);
+    const auto frame = L1Batcher::Frame::decode(tx.payload);
+    ASSERT_EQ(frame.blocks.size(), 5u);
+    EXPECT_EQ(frame.blocks.front().block_number, 0u);
+    EXPECT_EQ(frame.blocks.back().state_root, make_block(4).state_root);
+    EXPECT_EQ(frame.proofs.proof_count, 5u);
+
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->statuses["tx1"] = L1Batcher::TxStatus::Included;
+    }
+    ASSERT_TRUE(wait_for([&] { return batcher.confirmed_height() == 5; }));
+    EXPECT_EQ(batcher.metrics().frames_confirmed, 1u);
+}
+
+TEST_F(L1BatcherTest, ReplacesStuckTransactionAtSameNonceWithHigherFees) {
+    auto client = std::make_shared<FakeClient>();
+    auto config = fast_config();
+    config.replace_after = std::chrono::milliseconds(10);
+    L1Batcher batcher(client, storage_, config);
+    batcher.add_block(make_block(0));
+    batcher.flush();
+    ASSERT_TRUE(wait_for([&] { return client->sent_count() >= 2; }));
+    batcher.stop();
+
+    const auto& first = client->sent[0];
+    const auto& second = client->sent[1];
+    EXPECT_EQ(first.nonce, second.nonce);
+    EXPECT_EQ(first.payload, second.payload);
+    EXPECT_GE(second.max_fee, first.max_fee * 1.1);
+    EXPECT_GT(second.priority_fee, first.priority_fee);
+    EXPECT_GE(batcher.metrics().replacements, 1u);
+}
+
+TEST_F(L1BatcherTest, RestartResumesOutboxWithoutResubmitting) {
+    auto client = std::make_shared<FakeClient>();
+    {
+        L1Batcher batcher(client, storage_, fast_config());
+        batcher.add_block(make_block(0));
+        batcher.add_block(make_block(1));
+        batcher.flush();
+        ASSERT_TRUE(wait_for([&] { return client->sent_count() == 1; }));
+        // Queued at shutdown: sealed into the outbox, not sent
+        batcher.add_block(make_block(2));
+    }
+    EXPECT_EQ(client->sent_count(), 1u);
+
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        client->statuses["tx1"] = L1Batcher::TxStatus::Included;
+    }
+    L1Batcher restarted(client, storage_, fast_config());
+    EXPECT_EQ(restarted.next_block(), 3u);
+    EXPECT_FALSE(restarted.add_block(make_block(1)));
+    ASSERT_TRUE(wait_for([&] { return client->sent_count() == 2; }));
+    ASSERT_TRUE(wait_for([&] { return restarted.confirmed_height() == 2; }));
+
+    // Only block 2 went out again, at the next nonce
+    const auto frame = L1Batcher::Frame::decode(client->sent[1].payload);
+    ASSERT_EQ(frame.blocks.size(), 1u);
+    EXPECT_EQ(frame.blocks.front().block_number, 2u);
+    EXPECT_EQ(client->sent[1].nonce, 8u);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
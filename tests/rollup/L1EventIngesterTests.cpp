@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+#include "rollup/L1EventIngester.hpp"
+#include "TestStorage.hpp"
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+using Ingester = L1EventIngester;
+
+// An L1 chain held in memory; fork() replaces everything from a height
+class FakeL1 : public Ingester::Client {
+public:
+    explicit FakeL1(uint64_t length) { extend(length, 0); }
+
+    void extend(uint64_t count, uint8_t fork) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint64_t i = 0; i < count; ++i) {
+            Ingester::Block block;
+            block.header.number = chain.size();
+            block.header.hash.fill(fork);
+            block.header.hash[0] = static_cast<uint8_t>(block.header.number);
+            block.header.hash[1] = static_cast<uint8_t>(block.header.number >> 8);
+            if (!chain.empty()) {
+                block.header.parent_hash = chain.back().header.hash;
+            }
+            if (block.header.number % 10 == 0) {
+                Ingester::Deposit deposit;
+                deposit.l1_block = block.header.number;
+                deposit.l2_address = "l2_" + std::to_string(block.header.number);
+                deposit.amount = 100 + fork;
+                block.deposits.push_back(deposit);
+            }
+            chain.push_back(block);
+        }
+    }
+
+    void fork(uint64_t from, uint8_t tag) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const uint64_t length = chain.size();
+            chain.resize(from);
+            pending_extend = length - from;
+        }
+        extend(pending_extend, tag);
+    }
+
+    uint64_t head() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return chain.size() - 1;
+    }
+
+    std::optional<Ingester::BlockHeader> header(uint64_t number) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (number >= chain.size()) return std::nullopt;
+        return chain[number].header;
+    }
+
+    std::vector<Ingester::Block> blocks(uint64_t first, uint64_t last) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        ranges.emplace_back(first, last);
+        if (fail_from && first >= *fail_from) {
+            fail_from.reset();
+            throw std::runtime_error("rpc timeout");
+        }
+        return {chain.begin() + static_cast<std::ptrdiff_t>(first),
+                chain.begin() + static_cast<std::ptrdiff_t>(last + 1)};
+    }
+
+    std::mutex mutex;
+    std::vector<Ingester::Block> chain;
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    std::optional<uint64_t> fail_from;
+    uint64_t pending_extend{0};
+};
+
+class RecordingSink : public Ingester::Sink {
+public:
+    void apply(const Ingester::Block& block) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(block.header.number, applied.size());
+        applied.push_back(block);
+    }
+
+    void rollback(uint64_t first) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        rollbacks.push_back(first);
+        applied.resize(first);
+    }
+
+    size_t count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return applied.size();
+    }
+
+    std::mutex mutex;
+    std::vector<Ingester::Block> applied;
+    std::vector<uint64_t> rollbacks;
+};
+
+Ingester::Config config(uint64_t confirmations, uint64_t range, size_t concurrent) {
+    Ingester::Config c;
+    c.confirmations = confirmations;
+    c.range_blocks = range;
+    c.max_concurrent = concurrent;
+    c.requests_per_second = 0;
+    c.reorg_window = 16;
+    c.poll_interval = std::chrono::milliseconds(5);
+    return c;
+}
+
+} // namespace
+
+class L1EventIngesterTest : public quids::test::TempStorageTest {
+protected:
+    L1EventIngesterTest() : TempStorageTest("l1ingest_") {}
+
+    void SetUp() override {
+        TempStorageTest::SetUp();
+        l1_ = std::make_shared<FakeL1>(100);
+        sink_ = std::make_shared<RecordingSink>();
+    }
+
+    std::shared_ptr<FakeL1> l1_;
+    std::shared_ptr<RecordingSink> sink_;
+};
+
+TEST_F(L1EventIngesterTest, FetchesConfirmedBlocksInConcurrentRanges) {
+    Ingester ingester(l1_, sink_, storage_, config(2, 10, 4));
+    EXPECT_EQ(ingester.poll(), 40u);
+    EXPECT_EQ(ingester.poll(), 40u);
+    EXPECT_EQ(ingester.poll(), 18u);  // head 99, two confirmations
+    EXPECT_EQ(ingester.poll(), 0u);
+
+    EXPECT_EQ(sink_->count(), 98u);
+    for (const auto& [first, last] : l1_->ranges) {
+        EXPECT_LE(last - first + 1, 10u);
+    }
+    const auto metrics = ingester.metrics();
+    EXPECT_EQ(metrics.cursor, 98u);
+    EXPECT_EQ(metrics.l1_head, 99u);
+    EXPECT_EQ(metrics.blocks_applied, 98u);
+    EXPECT_EQ(metrics.deposits_applied, 10u);
+    EXPECT_EQ(metrics.reorgs, 0u);
+}
+
+TEST_F(L1EventIngesterTest, RollsBackAndReplaysAReorg) {
+    Ingester ingester(l1_, sink_, storage_, config(0, 50, 2));
+    EXPECT_EQ(ingester.poll(), 100u);
+
+    l1_->fork(90, 7);
+    l1_->extend(5, 7);
+    EXPECT_EQ(ingester.poll(), 15u);
+
+    EXPECT_EQ(sink_->rollbacks, (std::vector<uint64_t>{90}));
+    ASSERT_EQ(sink_->count(), 105u);
+    EXPECT_EQ(sink_->applied[90].deposits.at(0).amount, 107u);
+    EXPECT_EQ(sink_->applied[104].header.hash, l1_->chain.back().header.hash);
+    const auto metrics = ingester.metrics();
+    EXPECT_EQ(metrics.reorgs, 1u);
+    EXPECT_EQ(metrics.blocks_rolled_back, 10u);
+    EXPECT_FALSE(metrics.halted);
+}
+
+TEST_F(L1EventIngesterTest, HaltsOnAReorgDeeperThanTheWindow) {
+    Ingester ingester(l1_, sink_, storage_, config(0, 100, 1));
+    EXPECT_EQ(ingester.poll(), 100u);
+    l1_->fork(50, 9);
+    EXPECT_EQ(ingester.poll(), 0u);
+    EXPECT_TRUE(ingester.metrics().halted);
+    EXPECT_EQ(sink_->count(), 100u);
+}
+
+TEST_F(L1EventIngesterTest, ResumesFromThePersistedCursor) {
+    {
+        Ingester ingester(l1_, sink_, storage_, config(0, 30, 1));
+        EXPECT_EQ(ingester.poll(), 30u);
+    }
+    // Reorg while down, within the saved window
+    l1_->fork(25, 3);
+    Ingester ingester(l1_, sink_, storage_, config(0, 30, 1));
+    EXPECT_EQ(ingester.metrics().cursor, 30u);
+    EXPECT_EQ(ingester.poll(), 30u);
+    EXPECT_EQ(sink_->rollbacks, (std::vector<uint64_t>{25}));
+    EXPECT_EQ(ingester.metrics().cursor, 55u);
+}
+
+TEST_F(L1EventIngesterTest, StopsAtAFailedRangeAndRetriesIt) {
+    Ingester ingester(l1_, sink_, storage_, config(0, 10, 4));
+    l1_->fail_from = 20;
+    EXPECT_EQ(ingester.poll(), 20u);
+    EXPECT_EQ(ingester.metrics().request_failures, 1u);
+    EXPECT_EQ(ingester.poll(), 40u);
+    EXPECT_EQ(sink_->count(), 60u);
+}
+
+TEST_F(L1EventIngesterTest, PacesRequests) {
+    auto c = config(0, 10, 4);
+    c.requests_per_second = 100;
+    Ingester ingester(l1_, sink_, storage_, c);
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(ingester.poll(), 40u);  // head plus four ranges
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(35));
+    EXPECT_EQ(ingester.metrics().requests, 5u);
+}
+
+TEST_F(L1EventIngesterTest, WorkerCatchesUpWithoutWaiting) {
+    auto c = config(1, 10, 2);
+    c.poll_interval = std::chrono::seconds(10);
+    Ingester ingester(l1_, sink_, storage_, c);
+    ingester.start();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (sink_->count() < 99 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ingester.stop();
+    EXPECT_EQ(sink_->count(), 99u);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+#include "rollup/L2BlockProcessor.hpp"
+#include "TestTransactions.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+using BlockPtr = L2BlockProcessor::BlockPtr;
+using Hash = L2BlockProcessor::Hash;
+
+const std::vector<std::string> ACCOUNTS{"alice", "bob", "carol", "dave", "erin"};
+
+std::shared_ptr<StateManager> fundedState() {
+    auto state = std::make_shared<StateManager>();
+    for (const auto& name : ACCOUNTS) {
+        StateManager::Account account;
+        account.address = name;
+        account.balance = 1000000;
+        account.nonce = 0;
+        state->add_account(name, account);
+    }
+    return state;
+}
+
+// Transfers in a ring, with each sender's nonces in order across blocks
+std::vector<std::vector<blockchain::TransactionPtr>> ringBlocks(size_t blocks, size_t per_block) {
+    std::vector<uint64_t> nonces(ACCOUNTS.size(), 0);
+    std::vector<std::vector<blockchain::TransactionPtr>> out(blocks);
+    for (size_t b = 0; b < blocks; ++b) {
+        for (size_t i = 0; i < per_block; ++i) {
+            const size_t from = (b * per_block + i) % ACCOUNTS.size();
+            const size_t to = (from + 1 + b) % ACCOUNTS.size();
+            out[b].push_back(quids::test::makeSignedTransfer(ACCOUNTS[from], ACCOUNTS[to], 10 + i, ++nonces[from]));
+        }
+    }
+    return out;
+}
+
+Hash rootOf(const StateManager& state) {
+    Hash out;
+    const auto root = state.get_state_root();
+    std::copy_n(root.begin(), out.size(), out.begin());
+    return out;
+}
+
+// A prover that takes longer for some blocks, so proofs finish out of order
+ProvingService::BackendFactory unevenProver() {
+    auto calls = std::make_shared<std::atomic<uint64_t>>(0);
+    return [calls] {
+        return [calls](const quantum::QuantumState&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds((*calls)++ % 3 == 0 ? 15 : 1));
+            ProvingService::Proof proof;
+            proof.proof_data = {1, 2, 3};
+            return proof;
+        };
+    };
+}
+
+// Blocks as the submitter saw them
+struct Outbox {
+    L2BlockProcessor::Submitter submitter() {
+        return [this](const BlockPtr& block) {
+            std::lock_guard<std::mutex> lock(mutex);
+            blocks.push_back(block);
+        };
+    }
+
+    std::mutex mutex;
+    std::vector<BlockPtr> blocks;
+};
+
+} // namespace
+
+TEST(L2BlockProcessorTest, MatchesSequentialExecutionInBlockOrder) {
+    auto state = fundedState();
+    auto reference = state->clone();
+    auto batches = ringBlocks(12, 20);
+    // A forged signature in block 3 is dropped at ingest
+    batches[3].push_back(quids::test::makeSignedTransfer("alice", "bob", 1, 1000, 0, true));
+
+    Outbox outbox;
+    L2BlockProcessor::Config config;
+    config.proof_workers = 3;
+    L2BlockProcessor processor(state, config, outbox.submitter(), unevenProver());
+    for (auto batch : batches) {
+        processor.submit(std::move(batch));
+    }
+    processor.drain();
+
+    ASSERT_EQ(outbox.blocks.size(), batches.size());
+    OptimisticExecutor executor;
+    Hash previous{};
+    Hash previous_root = rootOf(*reference);
+    for (size_t b = 0; b < batches.size(); ++b) {
+        SCOPED_TRACE(b);
+        const auto& block = *outbox.blocks[b];
+        EXPECT_EQ(block.block_number, b);
+        EXPECT_FALSE(block.error);
+        EXPECT_FALSE(block.block_proof.proof_data.empty());
+
+        // The same blocks run one after another on a copy of the state
+        auto txs = batches[b];
+        txs.erase(std::remove_if(txs.begin(), txs.end(), [](const auto& tx) { return !tx->verified(); }),
+                  txs.end());
+        const auto expected = executor.apply_batch(*reference, txs);
+        EXPECT_EQ(block.executed, expected.success);
+        EXPECT_EQ(block.pre_state_root, previous_root);
+        EXPECT_EQ(block.state_root, rootOf(*reference));
+        EXPECT_TRUE(L2BlockProcessor::verify_block(block, previous));
+        previous = block.block_hash;
+        previous_root = block.state_root;
+    }
+    EXPECT_EQ(rootOf(*state), rootOf(*reference));
+
+    const auto metrics = processor.metrics();
+    EXPECT_EQ(metrics.blocks_submitted, batches.size());
+    EXPECT_EQ(metrics.blocks_failed, 0u);
+    EXPECT_EQ(metrics.transactions_rejected, 1u);
+    EXPECT_GE(metrics.max_latency, metrics.average_latency);
+    EXPECT_GT(metrics.busy[L2BlockProcessor::Proof].count(), 0);
+}
+
+TEST(L2BlockProcessorTest, ASlowStagePushesBackOnProducers) {
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    auto stuck = [gate] {
+        return [gate](const quantum::QuantumState&) {
+            gate.wait();
+            return ProvingService::Proof{};
+        };
+    };
+
+    Outbox outbox;
+    L2BlockProcessor::Config config;
+    config.queue_capacity = 1;
+    config.proof_workers = 1;
+    L2BlockProcessor processor(fundedState(), config, outbox.submitter(), stuck);
+
+    constexpr size_t BLOCKS = 30;
+    auto batches = ringBlocks(BLOCKS, 2);
+    std::atomic<size_t> accepted{0};
+    std::thread producer([&] {
+        for (auto& batch : batches) {
+            processor.submit(std::move(batch));
+            ++accepted;
+        }
+    });
+
+    // One block in each queue and one in the hands of each stage up to
+    // proof; the producer waits for room instead of piling up blocks
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_LE(accepted.load(), 10u);
+    EXPECT_EQ(processor.metrics().queue_depth[L2BlockProcessor::Ingest], 1u);
+    {
+        std::lock_guard<std::mutex> lock(outbox.mutex);
+        EXPECT_TRUE(outbox.blocks.empty());
+    }
+
+    release.set_value();
+    producer.join();
+    processor.drain();
+    EXPECT_EQ(accepted.load(), BLOCKS);
+    EXPECT_EQ(outbox.blocks.size(), BLOCKS);
+}
+
+TEST(L2BlockProcessorTest, FailedBlocksStillReachTheSubmitterInOrder) {
+    auto calls = std::make_shared<std::atomic<int>>(0);
+    auto failing = [calls] {
+        return [calls](const quantum::QuantumState&) -> ProvingService::Proof {
+            if ((*calls)++ == 1) {
+                throw std::runtime_error("prover crashed");
+            }
+            return ProvingService::Proof{};
+        };
+    };
+    std::vector<uint64_t> order;
+    L2BlockProcessor::Config config;
+    config.proof_workers = 1;
+    L2BlockProcessor processor(fundedState(), config, [&](const BlockPtr& block) {
+        order.push_back(block->block_number);
+        if (block->block_number == 3) {
+            throw std::runtime_error("L1 unavailable");
+        }
+    }, failing);
+
+    for (auto batch : ringBlocks(5, 3)) {
+        processor.submit(std::move(batch));
+    }
+    processor.drain();
+    EXPECT_EQ(order, (std::vector<uint64_t>{0, 1, 2, 3, 4}));
+    const auto metrics = processor.metrics();
+    EXPECT_EQ(metrics.blocks_submitted, 5u);
+    EXPECT_EQ(metrics.blocks_failed, 2u);
+}
+
+TEST(L2BlockProcessorTest, RefusedBatchesStayWithTheCaller) {
+    L2BlockProcessor::Config config;
+    config.max_block_size = 2;
+    Outbox outbox;
+    L2BlockProcessor processor(fundedState(), config, outbox.submitter(), unevenProver());
+
+    std::vector<blockchain::TransactionPtr> empty;
+    EXPECT_THROW(processor.submit(std::move(empty)), std::invalid_argument);
+    auto batch = ringBlocks(1, 3).front();
+    EXPECT_THROW(processor.submit(std::move(batch)), std::invalid_argument);
+    EXPECT_EQ(batch.size(), 3u);
+
+    processor.stop();
+    batch.resize(2);
+    EXPECT_THROW(processor.submit(std::move(batch)), std::runtime_error);
+    EXPECT_EQ(batch.size(), 2u);
+    processor.drain();
+
+    EXPECT_THROW(L2BlockProcessor(nullptr, config, outbox.submitter()), std::invalid_argument);
+    EXPECT_THROW(L2BlockProcessor(fundedState(), config, nullptr), std::invalid_argument);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "memory/LargePages.hpp"
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using memory::HUGE_PAGE_SIZE;
+using memory::LargeBuffer;
+using memory::PagePolicy;
+using memory::Placement;
+
+TEST(LargePagesTest, HugeBuffersStartOnAHugePage) {
+    LargeBuffer buffer(3 * HUGE_PAGE_SIZE + 123);
+    ASSERT_NE(buffer.data(), nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % HUGE_PAGE_SIZE, 0u);
+    EXPECT_EQ(buffer.data()[buffer.size() - 1], 0);  // zero-filled
+    std::memset(buffer.data(), 0xab, buffer.size());
+
+    LargeBuffer moved(std::move(buffer));
+    EXPECT_EQ(buffer.data(), nullptr);
+    EXPECT_EQ(moved.data()[moved.size() - 1], 0xab);
+}
+
+TEST(LargePagesTest, PoliciesFallBack) {
+    // Small buffers are never rounded up to a huge page
+    LargeBuffer small(4096, Placement{PagePolicy::HugeTlb, 0});
+    ASSERT_NE(small.data(), nullptr);
+    EXPECT_FALSE(small.hugetlb());
+
+    // Without a reserved pool hugetlb falls back to an ordinary mapping
+    LargeBuffer pooled(HUGE_PAGE_SIZE, Placement{PagePolicy::HugeTlb, -1});
+    ASSERT_NE(pooled.data(), nullptr);
+    pooled.data()[0] = 1;
+}
+
+TEST(LargePagesTest, NodeArenasServeContainers) {
+    memory::NodeArenas arenas;
+    EXPECT_GE(arenas.nodes(), 1u);
+    EXPECT_LT(memory::numa::current_node(), memory::numa::node_count());
+
+    std::pmr::vector<uint64_t> small(arenas.local());
+    for (uint64_t i = 0; i < 10000; ++i) {
+        small.push_back(i);
+    }
+    std::pmr::vector<uint8_t> large(4 * HUGE_PAGE_SIZE, 7, arenas.resource(0));
+    EXPECT_EQ(small[9999], 9999u);
+    EXPECT_EQ(large.back(), 7);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
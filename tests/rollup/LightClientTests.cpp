@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "rollup/LightClient.hpp"
+#include "rollup/StateWitness.hpp"
+#include <bit>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+using Header = LightClient::Header;
+
+LightClient::Config config(uint32_t shift) {
+    LightClient::Config c;
+    c.checkpoint_shift = shift;
+    return c;
+}
+
+// Stands in for an aggregated proof: the two roots it connects
+std::vector<uint8_t> transition(const Header& from, const StateTrie::Hash& to_root) {
+    std::vector<uint8_t> proof(from.state_root.begin(), from.state_root.end());
+    proof.insert(proof.end(), to_root.begin(), to_root.end());
+    return proof;
+}
+
+bool check_transition(const Header& from, const Header& to, std::span<const uint8_t> proof) {
+    const auto expected = transition(from, to.state_root);
+    return std::equal(proof.begin(), proof.end(), expected.begin(), expected.end());
+}
+
+// Headers 0..count with skip links laid out as a producer would
+std::vector<Header> make_chain(uint64_t count, uint32_t shift) {
+    const LightClient layout(Header{}, config(shift), check_transition);
+    std::vector<Header> chain;
+    for (uint64_t n = 0; n <= count; ++n) {
+        Header h;
+        h.number = n;
+        h.parent_hash = n > 0 ? chain.back().hash() : StateTrie::Hash{};
+        const std::string tag = "state-" + std::to_string(n);
+        h.state_root = StateTrie::hash_bytes(reinterpret_cast<const uint8_t*>(tag.data()), tag.size());
+        h.timestamp = 1000 + n;
+        for (uint64_t target : layout.skip_targets(n)) {
+            h.skips.push_back({chain[target].hash(), transition(chain[target], h.state_root)});
+        }
+        chain.push_back(std::move(h));
+    }
+    return chain;
+}
+
+StateManager::Account account(const std::string& address, uint64_t balance) {
+    StateManager::Account a;
+    a.address = address;
+    a.balance = balance;
+    a.nonce = 3;
+    return a;
+}
+
+} // namespace
+
+TEST(LightClientTest, SyncFetchesLogarithmicallyManyHeaders) {
+    const uint32_t shift = 2;
+    const auto chain = make_chain(1 << 12, shift);
+
+    for (uint64_t target : {uint64_t{4}, uint64_t{1000}, uint64_t{4093}, uint64_t{4096}}) {
+        LightClient client(chain.front(), config(shift), check_transition);
+        std::vector<uint64_t> fetched;
+        ASSERT_TRUE(client.sync(target, [&](uint64_t n) {
+            fetched.push_back(n);
+            return std::optional<Header>(chain.at(n));
+        })) << target;
+        EXPECT_EQ(client.head().number, target);
+        EXPECT_EQ(client.head().hash(), chain[target].hash());
+        EXPECT_EQ(client.trusted().number, target - target % 4);
+
+        // Up and down the skip list, then less than one interval of headers
+        const size_t levels = std::bit_width(target >> shift);
+        EXPECT_LE(fetched.size(), 2 * levels + 3) << target;
+        EXPECT_EQ(client.stats().headers_fetched, fetched.size());
+    }
+}
+
+TEST(LightClientTest, FollowsHeadersOneAtATime) {
+    const auto chain = make_chain(12, 2);
+    LightClient client(chain.front(), config(2), check_transition);
+    for (uint64_t n = 1; n <= 6; ++n) {
+        ASSERT_TRUE(client.follow(chain[n])) << n;
+    }
+    EXPECT_EQ(client.head().number, 6u);
+    EXPECT_EQ(client.trusted().number, 4u);
+    EXPECT_EQ(client.stats().transitions_checked, 1u);
+
+    // Not the next header, or not linked to the head
+    EXPECT_FALSE(client.follow(chain[8]));
+    Header forged = chain[7];
+    forged.parent_hash[0] ^= 1;
+    EXPECT_FALSE(client.follow(forged));
+    EXPECT_EQ(client.head().number, 6u);
+
+    // Resumes over the skip list from where it is
+    ASSERT_TRUE(client.sync(12, [&](uint64_t n) { return std::optional<Header>(chain.at(n)); }));
+    EXPECT_EQ(client.head().number, 12u);
+}
+
+TEST(LightClientTest, RejectsACheckpointWhoseProofFails) {
+    auto chain = make_chain(64, 2);
+    chain[64].skips[4].proof.back() ^= 1;
+
+    LightClient client(chain.front(), config(2), check_transition);
+    EXPECT_FALSE(client.sync(64, [&](uint64_t n) { return std::optional<Header>(chain.at(n)); }));
+    EXPECT_EQ(client.trusted().number, 0u);
+
+    // A checkpoint whose link skips to another checkpoint
+    chain = make_chain(64, 2);
+    chain[64].skips[4].checkpoint = chain[32].hash();
+    LightClient other(chain.front(), config(2), check_transition);
+    EXPECT_FALSE(other.sync(64, [&](uint64_t n) { return std::optional<Header>(chain.at(n)); }));
+    EXPECT_EQ(other.trusted().number, 0u);
+
+    EXPECT_THROW(LightClient(chain[3], config(2), check_transition), std::invalid_argument);
+}
+
+TEST(LightClientTest, AnswersAccountQueriesFromDhtProofs) {
+    StateManager state;
+    state.add_account("alice", account("alice", 500));
+    state.add_account("bob", account("bob", 7));
+    const auto snapshot = state.snapshot();
+    const auto root_bytes = snapshot.get_state_root();
+
+    Header genesis;
+    std::copy(root_bytes.begin(), root_bytes.end(), genesis.state_root.begin());
+
+    // What full nodes would have stored in the DHT
+    std::map<LightClient::DhtKey, std::vector<uint8_t>> dht;
+    for (const std::string address : {"alice", "carol"}) {
+        dht[LightClient::proof_key(genesis.state_root, address)] = LightClient::account_proof(snapshot, address);
+    }
+    const LightClient::ProofSource source = [&](const LightClient::DhtKey& key) {
+        auto it = dht.find(key);
+        return it == dht.end() ? std::nullopt : std::optional<std::vector<uint8_t>>(it->second);
+    };
+
+    LightClient client(genesis, config(4), check_transition);
+    const auto alice = client.get_account("alice", source);
+    ASSERT_EQ(alice.status, LightClient::AccountQuery::Status::Found);
+    EXPECT_EQ(alice.account->balance, 500u);
+    EXPECT_EQ(alice.account->nonce, 3u);
+    EXPECT_EQ(client.get_account("carol", source).status, LightClient::AccountQuery::Status::Absent);
+    EXPECT_EQ(client.get_account("bob", source).status, LightClient::AccountQuery::Status::Unavailable);
+
+    // A served account that was altered no longer opens to the root
+    auto& stored = dht[LightClient::proof_key(genesis.state_root, "alice")];
+    auto witness = StateWitness::deserialize(stored);
+    ASSERT_TRUE(witness.has_value());
+    witness->entries.front().account->balance = 5000;
+    stored = witness->serialize();
+    EXPECT_EQ(client.get_account("alice", source).status, LightClient::AccountQuery::Status::Invalid);
+
+    // As does the proof for another account
+    dht[LightClient::proof_key(genesis.state_root, "bob")] = dht[LightClient::proof_key(genesis.state_root, "carol")];
+    EXPECT_EQ(client.get_account("bob", source).status, LightClient::AccountQuery::Status::Invalid);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "state/LockFreeStateManager.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using state::AccountState;
+using state::LockFreeStateManager;
+
+namespace {
+
+std::string address(size_t i) {
+    return "0x" + std::to_string(i);
+}
+
+} // namespace
+
+TEST(LockFreeStateManagerTest, ReadsWritesAndErases) {
+    LockFreeStateManager store({.shards = 4, .initial_capacity = 4});
+    EXPECT_EQ(store.shard_count(), 4u);
+    EXPECT_FALSE(store.read("0xabc"));
+
+    store.write("0xabc", {100, 1});
+    ASSERT_TRUE(store.read("0xabc"));
+    EXPECT_EQ(*store.read("0xabc"), (AccountState{100, 1}));
+    store.write("0xabc", {90, 2});
+    EXPECT_EQ(store.read("0xabc")->balance, 90u);
+    EXPECT_EQ(store.size(), 1u);
+
+    EXPECT_TRUE(store.erase("0xabc"));
+    EXPECT_FALSE(store.erase("0xabc"));
+    EXPECT_FALSE(store.read("0xabc"));
+    EXPECT_EQ(store.size(), 0u);
+    store.write("0xabc", {5, 0});
+    EXPECT_EQ(store.read("0xabc")->balance, 5u);
+}
+
+TEST(LockFreeStateManagerTest, BatchesMergePerShardAndGrow) {
+    LockFreeStateManager store({.shards = 8, .initial_capacity = 4});
+    auto batch = store.batch();
+    for (size_t i = 0; i < 5000; ++i) {
+        batch.put(address(i), {i, 0});
+    }
+    batch.put(address(7), {777, 3});  // the later write wins
+    batch.erase(address(8));
+    EXPECT_EQ(batch.size(), 5002u);
+    store.commit(batch);
+    EXPECT_TRUE(batch.empty());
+
+    EXPECT_EQ(store.size(), 4999u);
+    EXPECT_EQ(*store.read(address(7)), (AccountState{777, 3}));
+    EXPECT_FALSE(store.read(address(8)));
+    for (size_t i = 0; i < 5000; i += 97) {
+        if (i != 7 && i != 8) {
+            EXPECT_EQ(store.read(address(i))->balance, i);
+        }
+    }
+
+    store.clear();
+    EXPECT_EQ(store.size(), 0u);
+    EXPECT_FALSE(store.read(address(1)));
+}
+
+TEST(LockFreeStateManagerTest, ReadersNeverSeeTornAccounts) {
+    // Writers keep balance + nonce constant per account, and the shards
+    // grow while readers probe them
+    LockFreeStateManager store({.shards = 4, .initial_capacity = 4});
+    constexpr size_t ACCOUNTS = 2000;
+    std::atomic<bool> done{false};
+    std::atomic<bool> torn{false};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r] {
+            size_t i = static_cast<size_t>(r);
+            while (!done.load(std::memory_order_relaxed)) {
+                if (auto state = store.read(address(i % ACCOUNTS))) {
+                    if (state->balance + state->nonce != 1'000'000) {
+                        torn = true;
+                    }
+                }
+                i += 7;
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; ++w) {
+        writers.emplace_back([&, w] {
+            for (uint64_t round = 0; round < 20; ++round) {
+                auto batch = store.batch();
+                for (size_t i = static_cast<size_t>(w); i < ACCOUNTS; i += 2) {
+                    batch.put(address(i), {1'000'000 - round, round});
+                }
+                store.commit(batch);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_FALSE(torn);
+    EXPECT_EQ(store.size(), ACCOUNTS);
+    EXPECT_EQ(store.read(address(3))->nonce, 19u);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
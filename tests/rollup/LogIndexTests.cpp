@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "rollup/LogIndex.hpp"
+#include "TestStorage.hpp"
+#include <stdexcept>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+LogIndex::Address address(uint8_t tag) {
+    LogIndex::Address a{};
+    a.fill(tag);
+    return a;
+}
+
+LogIndex::Topic topic(uint8_t tag) {
+    LogIndex::Topic t{};
+    t.fill(tag);
+    t[0] = 0xEE;
+    return t;
+}
+
+LogIndex::Hash tx_hash(uint64_t block, uint32_t index) {
+    LogIndex::Hash h{};
+    for (int i = 0; i < 8; ++i) {
+        h[i] = static_cast<uint8_t>(block >> (8 * i));
+    }
+    h[8] = static_cast<uint8_t>(index);
+    return h;
+}
+
+LogIndex::Receipt receipt(uint64_t block, uint32_t index, std::vector<LogIndex::Log> logs) {
+    LogIndex::Receipt r;
+    r.tx_hash = tx_hash(block, index);
+    r.gas_used = 21000 + index;
+    r.logs = std::move(logs);
+    return r;
+}
+
+LogIndex::Log log(uint8_t addr, std::vector<LogIndex::Topic> topics) {
+    LogIndex::Log l;
+    l.address = address(addr);
+    l.topics = std::move(topics);
+    l.data = {addr, 1, 2, 3};
+    return l;
+}
+
+} // namespace
+
+class LogIndexTest : public quids::test::TempStorageTest {
+protected:
+    LogIndexTest() : TempStorageTest("logindex_") {}
+
+    void SetUp() override {
+        TempStorageTest::SetUp();
+        index_ = std::make_unique<LogIndex>(storage_);
+    }
+
+    void TearDown() override {
+        index_.reset();
+        TempStorageTest::TearDown();
+    }
+
+    std::unique_ptr<LogIndex> index_;
+};
+
+TEST_F(LogIndexTest, LooksUpReceiptsByTransactionHash) {
+    ASSERT_TRUE(index_->index_block(7, {receipt(7, 0, {log(1, {topic(1)})}), receipt(7, 1, {})}));
+
+    auto located = index_->receipt(tx_hash(7, 1));
+    ASSERT_TRUE(located.has_value());
+    EXPECT_EQ(located->block_number, 7u);
+    EXPECT_EQ(located->tx_index, 1u);
+    EXPECT_EQ(located->receipt.gas_used, 21001u);
+    EXPECT_FALSE(index_->receipt(tx_hash(8, 0)).has_value());
+
+    auto bloom = index_->block_bloom(7);
+    ASSERT_TRUE(bloom.has_value());
+    EXPECT_TRUE(bloom->may_contain(address(1).data(), 20));
+    EXPECT_TRUE(bloom->may_contain(topic(1).data(), 32));
+    EXPECT_EQ(index_->block_receipts(7)->size(), 2u);
+}
+
+TEST_F(LogIndexTest, MatchesTopicsByPositionWithAlternatives) {
+    ASSERT_TRUE(index_->index_block(1, {receipt(1, 0, {log(1, {topic(1), topic(2)})})}));
+    ASSERT_TRUE(index_->index_block(2, {receipt(2, 0, {log(1, {topic(2), topic(1)})})}));
+    ASSERT_TRUE(index_->index_block(3, {receipt(3, 0, {log(2, {topic(1), topic(3)})})}));
+
+    LogIndex::Filter filter;
+    filter.topics = {{topic(1)}};
+    auto matches = index_->query(filter);
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matches[0].block_number, 1u);
+    EXPECT_EQ(matches[1].block_number, 3u);
+
+    // Address AND second topic in {2, 3}
+    filter.addresses = {address(1)};
+    filter.topics = {{}, {topic(2), topic(3)}};
+    matches = index_->query(filter);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0].block_number, 1u);
+    EXPECT_EQ(matches[0].tx_hash, tx_hash(1, 0));
+
+    filter.addresses = {address(1), address(2)};
+    matches = index_->query(filter);
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matches[1].block_number, 3u);
+
+    filter = {};
+    filter.limit = 2;
+    EXPECT_EQ(index_->query(filter).size(), 2u);
+}
+
+TEST_F(LogIndexTest, ReadsOnlyCandidateBlocksOverALongRange) {
+    constexpr uint64_t BLOCKS = 100000;
+    for (uint64_t b = 0; b < BLOCKS; ++b) {
+        // A common event everywhere, a rare one every 10007 blocks
+        std::vector<LogIndex::Log> logs = {log(1, {topic(1)})};
+        if (b % 10007 == 0) {
+            logs.push_back(log(9, {topic(9)}));
+        }
+        ASSERT_TRUE(index_->index_block(b, {receipt(b, 0, std::move(logs))}));
+    }
+
+    LogIndex::Filter filter;
+    filter.addresses = {address(9)};
+    auto matches = index_->query(filter);
+    ASSERT_EQ(matches.size(), 10u);
+    for (size_t i = 0; i < matches.size(); ++i) {
+        EXPECT_EQ(matches[i].block_number, i * 10007);
+        EXPECT_EQ(matches[i].log_index, 1u);
+    }
+    const auto stats = index_->stats();
+    EXPECT_EQ(stats.blocks_indexed, BLOCKS);
+    EXPECT_EQ(stats.blocks_read, 10u);
+    // Batches without the rare event are ruled out by their bloom,
+    // give or take a false positive
+    EXPECT_GE(stats.batches_skipped, 10u);
+}
+
+TEST_F(LogIndexTest, RangeBoundsAndPersistence) {
+    for (uint64_t b = 4090; b < 4100; ++b) {
+        ASSERT_TRUE(index_->index_block(b, {receipt(b, 0, {log(3, {topic(3)})})}));
+    }
+    LogIndex::Filter filter;
+    filter.from_block = 4094;
+    filter.to_block = 4097;
+    EXPECT_EQ(index_->query(filter).size(), 4u);
+
+    // A second writer picks up the batch where the first stopped
+    index_ = std::make_unique<LogIndex>(storage_);
+    ASSERT_TRUE(index_->index_block(4100, {receipt(4100, 0, {log(3, {topic(3)})})}));
+    filter = {};
+    filter.addresses = {address(3)};
+    auto matches = index_->query(filter);
+    ASSERT_EQ(matches.size(), 11u);
+    EXPECT_EQ(matches.front().block_number, 4090u);
+    EXPECT_EQ(matches.back().block_number, 4100u);
+    EXPECT_TRUE(index_->receipt(tx_hash(4093, 0)).has_value());
+}
+
+TEST_F(LogIndexTest, RejectsLogsWithTooManyTopics) {
+    auto topics = std::vector<LogIndex::Topic>(5, topic(1));
+    EXPECT_THROW(index_->index_block(1, {receipt(1, 0, {log(1, topics)})}), std::invalid_argument);
+    EXPECT_FALSE(index_->block_receipts(1).has_value());
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
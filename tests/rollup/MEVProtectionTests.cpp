@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "rollup/MEVProtection.hpp"
+#include "TestTransactions.hpp"
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+using quids::test::makeSignedTransfer;
+
+// Same-target arrivals the detector looks back over
+constexpr size_t LOOKBACK = 64;
+
+std::vector<blockchain::TransactionPtr> add_all(MEVProtection& mev,
+                                                const std::vector<blockchain::TransactionPtr>& txs) {
+    for (const auto& tx : txs) {
+        mev.add_transaction(tx);
+    }
+    return txs;
+}
+
+// Transfers to the pool from distinct senders, far from any other value so
+// none of them looks like a front-run
+void add_fillers(MEVProtection& mev, std::vector<blockchain::TransactionPtr>& arrivals, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        arrivals.push_back(makeSignedTransfer("filler-" + std::to_string(i), "pool", 1, 1, 10));
+        mev.add_transaction(arrivals.back());
+    }
+}
+
+} // namespace
+
+TEST(MEVProtectionTest, DetectsSandwichVictims) {
+    MEVProtection mev;
+    const std::vector<blockchain::TransactionPtr> batch{
+        makeSignedTransfer("attacker", "pool", 500, 1, 10),
+        makeSignedTransfer("victim", "pool", 100, 1, 10),
+        makeSignedTransfer("bystander", "other-pool", 100, 1, 10),
+        makeSignedTransfer("attacker", "pool", 500, 2, 10),
+        // Bracketing its own transfers makes no one a victim
+        makeSignedTransfer("trader", "third-pool", 100, 1, 10),
+        makeSignedTransfer("trader", "third-pool", 100, 2, 10),
+        makeSignedTransfer("trader", "third-pool", 100, 3, 10),
+    };
+    EXPECT_EQ(mev.detect_sandwiches(batch), std::vector<size_t>{1});
+    EXPECT_TRUE(mev.detect_sandwich_attack(*batch[1], batch));
+    EXPECT_FALSE(mev.detect_sandwich_attack(*batch[0], batch));
+    EXPECT_FALSE(mev.detect_sandwich_attack(*batch[2], batch));
+    EXPECT_FALSE(mev.detect_sandwich_attack(*batch[5], batch));
+
+    // Two victims under one span, and a leg of another sender's span
+    const std::vector<blockchain::TransactionPtr> nested{
+        makeSignedTransfer("a", "pool", 500, 1, 10),
+        makeSignedTransfer("b", "pool", 100, 1, 10),
+        makeSignedTransfer("c", "pool", 100, 1, 10),
+        makeSignedTransfer("b", "pool", 100, 2, 10),
+        makeSignedTransfer("a", "pool", 500, 2, 10),
+    };
+    EXPECT_EQ(mev.detect_sandwiches(nested), (std::vector<size_t>{1, 2, 3}));
+}
+
+TEST(MEVProtectionTest, OrderingKeepsArrivalAndMovesFlaggedLast) {
+    MEVProtection mev;
+    const auto arrivals = add_all(mev, {
+        makeSignedTransfer("honest", "pool", 1000, 1, 10),
+        makeSignedTransfer("other", "other-pool", 5, 1, 10),
+        // Same value to the same pool at more than 1.2x the gas
+        makeSignedTransfer("frontrunner", "pool", 1000, 1, 20),
+        makeSignedTransfer("attacker", "swap", 500, 1, 10),
+        makeSignedTransfer("victim", "swap", 50, 1, 10),
+        makeSignedTransfer("attacker", "swap", 500, 2, 10),
+        makeSignedTransfer("late", "other-pool", 7, 1, 10),
+    });
+
+    // A repeat is ignored
+    mev.add_transaction(arrivals[0]);
+    EXPECT_EQ(mev.pending_count(), arrivals.size());
+
+    const auto ordering = mev.get_optimal_ordering();
+    const std::vector<blockchain::TransactionPtr> expected{
+        arrivals[0], arrivals[1], arrivals[4], arrivals[6],
+        arrivals[2], arrivals[3], arrivals[5],
+    };
+    EXPECT_EQ(ordering, expected);
+
+    // The commitment binds the order
+    const auto commitment = mev.create_ordering_commitment(ordering);
+    EXPECT_EQ(commitment.batch_hash, mev.compute_fairness_hash(ordering));
+    EXPECT_NE(commitment.batch_hash, mev.compute_fairness_hash(arrivals));
+
+    mev.finalize_batch();
+    EXPECT_EQ(mev.pending_count(), 0u);
+    EXPECT_TRUE(mev.get_optimal_ordering().empty());
+}
+
+TEST(MEVProtectionTest, FrontrunLookbackStopsAtTheWindowCap) {
+    // The honest transfer sits `fillers + 1` same-target entries back
+    for (size_t fillers : {LOOKBACK - 1, LOOKBACK}) {
+        SCOPED_TRACE(fillers);
+        MEVProtection mev;
+        std::vector<blockchain::TransactionPtr> arrivals{makeSignedTransfer("honest", "pool", 1000, 1, 10)};
+        mev.add_transaction(arrivals.back());
+        add_fillers(mev, arrivals, fillers);
+        const auto frontrunner = makeSignedTransfer("frontrunner", "pool", 1000, 1, 20);
+        mev.add_transaction(frontrunner);
+        mev.add_transaction(makeSignedTransfer("late", "other-pool", 7, 1, 10));
+
+        const auto ordering = mev.get_optimal_ordering();
+        ASSERT_EQ(ordering.size(), fillers + 3);
+        EXPECT_EQ(ordering.back() == frontrunner, fillers < LOOKBACK);
+    }
+}
+
+TEST(MEVProtectionTest, SandwichLookbackStopsAtTheWindowCap) {
+    // The first leg sits `fillers + 2` same-target entries back
+    for (size_t fillers : {LOOKBACK - 2, LOOKBACK - 1}) {
+        SCOPED_TRACE(fillers);
+        MEVProtection mev;
+        std::vector<blockchain::TransactionPtr> arrivals{
+            makeSignedTransfer("attacker", "pool", 500, 1, 10),
+            makeSignedTransfer("victim", "pool", 50, 1, 10),
+        };
+        add_all(mev, arrivals);
+        add_fillers(mev, arrivals, fillers);
+        const auto closing = makeSignedTransfer("attacker", "pool", 500, 2, 10);
+        mev.add_transaction(closing);
+        mev.add_transaction(makeSignedTransfer("late", "other-pool", 7, 1, 10));
+
+        const auto ordering = mev.get_optimal_ordering();
+        ASSERT_EQ(ordering.size(), fillers + 4);
+        const bool flagged = ordering[ordering.size() - 2] == arrivals[0] && ordering.back() == closing;
+        EXPECT_EQ(flagged, fillers + 2 <= LOOKBACK);
+        // The victim keeps its place either way
+        EXPECT_EQ(ordering[flagged ? 0 : 1], arrivals[1]);
+    }
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
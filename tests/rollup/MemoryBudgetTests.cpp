@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include "memory/MemoryBudget.hpp"
+#include "network/BufferRing.hpp"
+#include "rollup/FeatureStore.hpp"
+#include "utils/Metrics.hpp"
+#include <utility>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using memory::MemoryAccountant;
+using memory::MemoryCharge;
+using memory::Subsystem;
+
+// Budgets are process-wide; every test leaves them unset
+class MemoryBudgetTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        for (size_t s = 0; s < memory::NUM_SUBSYSTEMS; ++s) {
+            accountant().set_budget(static_cast<Subsystem>(s), 0);
+        }
+    }
+
+    static MemoryAccountant& accountant() { return MemoryAccountant::global(); }
+};
+
+TEST_F(MemoryBudgetTest, ChargesFollowTheirOwners) {
+    const size_t before = accountant().live(Subsystem::Dht);
+    {
+        MemoryCharge charge(Subsystem::Dht, 1000);
+        EXPECT_EQ(accountant().live(Subsystem::Dht), before + 1000);
+
+        MemoryCharge copy(charge);
+        EXPECT_EQ(accountant().live(Subsystem::Dht), before + 2000);
+
+        MemoryCharge moved(std::move(copy));
+        EXPECT_EQ(copy.bytes(), 0u);
+        EXPECT_EQ(accountant().live(Subsystem::Dht), before + 2000);
+
+        moved.resize(400);
+        EXPECT_EQ(accountant().live(Subsystem::Dht), before + 1400);
+        EXPECT_GE(accountant().usage(Subsystem::Dht).peak_bytes, before + 2000);
+    }
+    EXPECT_EQ(accountant().live(Subsystem::Dht), before);
+}
+
+TEST_F(MemoryBudgetTest, BudgetsRefuseAndReportExcess) {
+    const size_t base = accountant().live(Subsystem::Mempool);
+    accountant().set_budget(Subsystem::Mempool, base + 1000);
+
+    ASSERT_TRUE(accountant().try_charge(Subsystem::Mempool, 600));
+    EXPECT_FALSE(accountant().try_charge(Subsystem::Mempool, 600));
+    EXPECT_EQ(accountant().live(Subsystem::Mempool), base + 600);
+    EXPECT_FALSE(accountant().over_budget(Subsystem::Mempool));
+
+    // Unconditional charges can go over; evicting owners free the excess
+    accountant().charge(Subsystem::Mempool, 600);
+    EXPECT_EQ(accountant().excess(Subsystem::Mempool), 200u);
+    accountant().release(Subsystem::Mempool, 1200);
+    EXPECT_FALSE(accountant().over_budget(Subsystem::Mempool));
+    EXPECT_GE(accountant().usage(Subsystem::Mempool).rejections, 1u);
+
+    const auto scrape = utils::MetricsRegistry::global().scrape();
+    EXPECT_NE(scrape.find("quids_memory_live_bytes{subsystem=\"mempool\"}"), std::string::npos);
+    EXPECT_NE(scrape.find("quids_memory_budget_bytes{subsystem=\"block_cache\"}"), std::string::npos);
+}
+
+TEST_F(MemoryBudgetTest, BufferRingAppliesBackpressure) {
+    network::BufferRing ring({{1024, 8}});
+    const size_t base = accountant().live(Subsystem::NetworkBuffers);
+    accountant().set_budget(Subsystem::NetworkBuffers, base + 2048);
+
+    auto first = ring.acquire(1000);
+    auto second = ring.acquire(1000);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(accountant().live(Subsystem::NetworkBuffers), base + 2048);
+    EXPECT_FALSE(ring.acquire(1000));
+    EXPECT_EQ(ring.stats().budget_rejections, 1u);
+
+    first.reset();
+    EXPECT_TRUE(ring.acquire(1000));
+    second.reset();
+    EXPECT_EQ(accountant().live(Subsystem::NetworkBuffers), base);
+}
+
+TEST_F(MemoryBudgetTest, FeatureStoresAreModelMemory) {
+    const size_t before = accountant().live(Subsystem::MlModels);
+    {
+        FeatureStore store(100, 8, 2);
+        EXPECT_EQ(accountant().live(Subsystem::MlModels), before + 100 * 10 * sizeof(float));
+    }
+    EXPECT_EQ(accountant().live(Subsystem::MlModels), before);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
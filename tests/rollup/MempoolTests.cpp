@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "rollup/Mempool.hpp"
+#include "rollup/ShardRouter.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "TestTransactions.hpp"
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+// A signed transfer paying fee as its gas price
+blockchain::TransactionPtr transfer(const std::string& from, uint64_t nonce, uint64_t fee,
+                                    const std::string& to = "sink") {
+    return quids::test::makeSignedTransfer(from, to, 1, nonce, fee);
+}
+
+Mempool::Config small(size_t capacity) {
+    Mempool::Config config;
+    config.shard_count = 1;
+    config.capacity = capacity;
+    return config;
+}
+
+} // namespace
+
+TEST(MempoolTest, TakesByFeeWithoutSkippingANonce) {
+    Mempool pool;
+    const auto a1 = transfer("alice", 1, 5);
+    const auto a2 = transfer("alice", 2, 50);
+    const auto b1 = transfer("bob", 1, 20);
+    for (const auto& tx : {a2, a1, b1}) {
+        ASSERT_EQ(pool.submit(tx), Mempool::AddResult::Added);
+    }
+    EXPECT_EQ(pool.submit(b1), Mempool::AddResult::Duplicate);
+
+    // alice's richer second nonce waits for her first
+    EXPECT_EQ(pool.select(3), (std::vector<blockchain::TransactionPtr>{b1, a1, a2}));
+    EXPECT_EQ(pool.size(), 3u);
+
+    // The submitted objects come back out, not copies
+    const auto taken = pool.take(2);
+    ASSERT_EQ(taken.size(), 2u);
+    EXPECT_EQ(taken[0].get(), b1.get());
+    EXPECT_EQ(taken[1].get(), a1.get());
+    EXPECT_EQ(pool.size(), 1u);
+    EXPECT_EQ(pool.stats().taken, 2u);
+}
+
+TEST(MempoolTest, ReplacementNeedsTheFeeBump) {
+    Mempool pool;
+    ASSERT_EQ(pool.submit(transfer("alice", 1, 100)), Mempool::AddResult::Added);
+    EXPECT_EQ(pool.submit(transfer("alice", 1, 105)), Mempool::AddResult::Underpriced);
+    const auto bumped = transfer("alice", 1, 110);
+    EXPECT_EQ(pool.submit(bumped), Mempool::AddResult::Replaced);
+    EXPECT_EQ(pool.size(), 1u);
+    EXPECT_EQ(pool.take(1).front(), bumped);
+
+    // While alice has something pending her committed nonces stay closed
+    ASSERT_EQ(pool.submit(transfer("alice", 2, 1)), Mempool::AddResult::Added);
+    pool.on_committed("alice", 1);
+    EXPECT_EQ(pool.submit(transfer("alice", 1, 500)), Mempool::AddResult::NonceTooLow);
+    EXPECT_EQ(pool.size(), 1u);
+}
+
+TEST(MempoolTest, FullPoolEvictsTheCheapestSenderTail) {
+    Mempool pool(small(3));
+    ASSERT_EQ(pool.submit(transfer("alice", 1, 10)), Mempool::AddResult::Added);
+    ASSERT_EQ(pool.submit(transfer("bob", 1, 2)), Mempool::AddResult::Added);
+    ASSERT_EQ(pool.submit(transfer("bob", 2, 30)), Mempool::AddResult::Added);
+
+    EXPECT_EQ(pool.submit(transfer("carol", 1, 1)), Mempool::AddResult::PoolFull);
+    // bob's first nonce is the cheapest; his second could never run without it
+    EXPECT_EQ(pool.submit(transfer("carol", 1, 5)), Mempool::AddResult::Added);
+    EXPECT_EQ(pool.size(), 2u);
+    EXPECT_EQ(pool.stats().evicted, 2u);
+
+    const auto left = pool.take(2);
+    ASSERT_EQ(left.size(), 2u);
+    EXPECT_EQ(left[0]->getSender(), "alice");
+    EXPECT_EQ(left[1]->getSender(), "carol");
+}
+
+TEST(MempoolTest, BatchesKeepInputOrderAcrossShards) {
+    Mempool::Config config;
+    config.parallel_batch_threshold = 1;  // fan out even a small batch
+    Mempool pool(config);
+    std::vector<blockchain::TransactionPtr> batch;
+    for (uint64_t i = 0; i < 64; ++i) {
+        batch.push_back(transfer("sender-" + std::to_string(i % 16), i / 16 + 1, 10 + i));
+    }
+    batch.push_back(batch.front());
+
+    const auto results = pool.submit_batch(batch);
+    ASSERT_EQ(results.size(), batch.size());
+    for (size_t i = 0; i + 1 < results.size(); ++i) {
+        EXPECT_EQ(results[i], Mempool::AddResult::Added) << i;
+    }
+    EXPECT_EQ(results.back(), Mempool::AddResult::Duplicate);
+    EXPECT_EQ(pool.size(), 64u);
+}
+
+TEST(MempoolTest, RouterMovesPendingTransactionsWithTheirRange) {
+    auto map = std::make_shared<ShardMap>(1);
+    ShardRouter router(map, nullptr);
+    std::vector<std::string> senders;
+    for (size_t i = 0; i < 32; ++i) {
+        senders.push_back("account-" + std::to_string(i));
+        ASSERT_TRUE(Mempool::is_accepted(router.submit(transfer(senders.back(), 1, 10))));
+    }
+    EXPECT_EQ(router.mempool(1).size(), 32u);
+
+    const auto migration = router.add_chain(2);
+    ASSERT_TRUE(migration);
+    size_t on_new_chain = 0;
+    for (const auto& sender : senders) {
+        on_new_chain += router.map().chain_for(sender) == 2;
+    }
+    EXPECT_EQ(router.mempool(2).size(), on_new_chain);
+    EXPECT_EQ(router.mempool(1).size() + router.mempool(2).size(), 32u);
+    for (const auto& tx : router.mempool(2).select(32)) {
+        EXPECT_EQ(router.chain_of(*tx), 2u);
+    }
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
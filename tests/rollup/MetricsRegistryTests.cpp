@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "utils/Metrics.hpp"
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using utils::Counter;
+using utils::Histogram;
+using utils::MetricsRegistry;
+
+namespace {
+
+bool contains(const std::string& text, const std::string& needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+} // namespace
+
+TEST(MetricsRegistryTest, BucketsCoverEveryValue) {
+    for (uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, (1ull << 39) + 5}) {
+        const size_t bucket = Histogram::bucket_of(v);
+        EXPECT_LE(Histogram::bucket_floor(bucket), v);
+        if (bucket + 1 < Histogram::NUM_BUCKETS) {
+            EXPECT_GT(Histogram::bucket_floor(bucket + 1), v);
+        }
+    }
+    for (size_t bucket = 0; bucket + 1 < Histogram::NUM_BUCKETS; ++bucket) {
+        EXPECT_EQ(Histogram::bucket_of(Histogram::bucket_floor(bucket)), bucket);
+    }
+}
+
+TEST(MetricsRegistryTest, QuantilesUnderConcurrentRecording) {
+    Histogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            for (uint64_t i = 1; i <= 100000; ++i) {
+                histogram.record(i * 1000);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 800000u);
+    EXPECT_EQ(snapshot.max, 100000u * 1000);
+    // Log-linear buckets keep quantiles within a few percent
+    EXPECT_NEAR(static_cast<double>(snapshot.quantile(0.5)), 50e6, 50e6 * 0.07);
+    EXPECT_NEAR(static_cast<double>(snapshot.quantile(0.99)), 99e6, 99e6 * 0.07);
+}
+
+TEST(MetricsRegistryTest, AttachedSeriesMergeAndExpire) {
+    auto& registry = MetricsRegistry::global();
+    auto owned = registry.counter("quids_test_merged_total", "Test counter", {{"stage", "a"}});
+    owned->add(3);
+    auto attached = std::make_shared<Counter>();
+    attached->add(4);
+    registry.attach("quids_test_merged_total", "Test counter", {{"stage", "a"}}, attached);
+
+    auto latency = std::make_shared<Histogram>();
+    latency->record(std::chrono::milliseconds(2));
+    registry.attach("quids_test_latency_seconds", "Test latency", {}, latency);
+
+    std::string out = registry.scrape();
+    EXPECT_TRUE(contains(out, "# TYPE quids_test_merged_total counter"));
+    EXPECT_TRUE(contains(out, "quids_test_merged_total{stage=\"a\"} 7"));
+    EXPECT_TRUE(contains(out, "# TYPE quids_test_latency_seconds summary"));
+    EXPECT_TRUE(contains(out, "quids_test_latency_seconds_count 1"));
+
+    // The registry only holds attached series weakly
+    attached.reset();
+    out = registry.scrape();
+    EXPECT_TRUE(contains(out, "quids_test_merged_total{stage=\"a\"} 3"));
+}
+
+TEST(MetricsRegistryTest, KindMismatchThrows) {
+    auto& registry = MetricsRegistry::global();
+    registry.counter("quids_test_kind_total", "Test counter");
+    EXPECT_THROW(registry.histogram("quids_test_kind_total", "Test counter"), std::invalid_argument);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
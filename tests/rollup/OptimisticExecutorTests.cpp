@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include "rollup/OptimisticExecutor.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+struct Transfer {
+    std::string from;
+    std::string to;
+    uint64_t amount;
+};
+
+StateManager::Account make_account(const std::string& address, uint64_t balance) {
+    StateManager::Account account;
+    account.address = address;
+    account.balance = balance;
+    account.nonce = 0;
+    return account;
+}
+
+// Plain in-order reference execution
+std::map<std::string, uint64_t> run_sequential(
+    std::map<std::string, uint64_t> balances,
+    const std::vector<Transfer>& transfers,
+    std::vector<bool>& success
+) {
+    success.clear();
+    for (const auto& t : transfers) {
+        if (balances[t.from] < t.amount) {
+            success.push_back(false);
+            continue;
+        }
+        balances[t.from] -= t.amount;
+        balances[t.to] += t.amount;
+        success.push_back(true);
+    }
+    return balances;
+}
+
+} // namespace
+
+class OptimisticExecutorTest : public ::testing::Test {
+protected:
+    OptimisticExecutor::Result run(size_t threads, size_t max_rounds) {
+        OptimisticExecutor::Config config;
+        config.num_threads = threads;
+        config.max_rounds = max_rounds;
+        OptimisticExecutor executor(config);
+
+        OptimisticExecutor::BaseReader base = [this](const std::string& key)
+            -> std::optional<StateManager::Account> {
+            auto it = base_.find(key);
+            if (it == base_.end()) return std::nullopt;
+            return make_account(key, it->second);
+        };
+
+        return executor.execute(transfers_.size(), base,
+            [this](size_t idx, OptimisticExecutor::View& view) {
+                const auto& t = transfers_[idx];
+                auto from = view.read(t.from);
+                if (!from || from->balance < t.amount) return false;
+                from->balance -= t.amount;
+                view.write(t.from, *from);
+                auto to = view.read(t.to);
+                if (!to) to = make_account(t.to, 0);
+                to->balance += t.amount;
+                view.write(t.to, *to);
+                return true;
+            });
+    }
+
+    void expect_matches_sequential(const OptimisticExecutor::Result& result) {
+        std::vector<bool> expected_success;
+        auto expected = run_sequential(base_, transfers_, expected_success);
+
+        EXPECT_EQ(result.success, expected_success);
+
+        auto actual = base_;
+        for (const auto& [key, account] : result.writes) {
+            actual[key] = account.balance;
+        }
+        for (const auto& [key, balance] : expected) {
+            EXPECT_EQ(actual[key], balance) << key;
+        }
+    }
+
+    std::map<std::string, uint64_t> base_;
+    std::vector<Transfer> transfers_;
+};
+
+TEST_F(OptimisticExecutorTest, IndependentTransfersNeedOneRound) {
+    for (int i = 0; i < 64; ++i) {
+        base_["a" + std::to_string(i)] = 100;
+        transfers_.push_back({"a" + std::to_string(i), "b" + std::to_string(i), 10});
+    }
+
+    auto result = run(8, 8);
+
+    EXPECT_EQ(result.metrics.rounds, 1u);
+    EXPECT_EQ(result.metrics.reexecutions, 0u);
+    expect_matches_sequential(result);
+}
+
+TEST_F(OptimisticExecutorTest, HotAccountMatchesSequentialOrder) {
+    base_["hot"] = 50;
+    for (int i = 0; i < 40; ++i) {
+        base_["u" + std::to_string(i)] = 5;
+        // Every other transfer pays into the hot account, the rest drain it
+        if (i % 2 == 0) {
+            transfers_.push_back({"u" + std::to_string(i), "hot", 5});
+        } else {
+            transfers_.push_back({"hot", "u" + std::to_string(i), 12});
+        }
+    }
+
+    auto result = run(8, 64);
+
+    expect_matches_sequential(result);
+}
+
+TEST_F(OptimisticExecutorTest, SequentialFallbackStillCorrect) {
+    // A strict chain a0 -> a1 -> a2 ... forces one finalized tx per round
+    base_["a0"] = 1000;
+    for (int i = 0; i < 32; ++i) {
+        transfers_.push_back({"a" + std::to_string(i), "a" + std::to_string(i + 1), 1000});
+    }
+
+    auto result = run(4, 2);
+
+    EXPECT_LE(result.metrics.rounds, 2u);
+    expect_matches_sequential(result);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "rollup/ParallelProcessor.hpp"
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+ParallelProcessor::ContractCall call(uint8_t contract, std::vector<uint8_t> code) {
+    ParallelProcessor::ContractCall c;
+    c.contract_address = ::evm::Address{};
+    c.contract_address.bytes[19] = contract;
+    c.input = std::move(code);  // executed as the contract code
+    c.gas_limit = 100000;
+    return c;
+}
+
+} // namespace
+
+TEST(ParallelProcessorTest, BatchedCallsResolveInInputOrder) {
+    ParallelProcessor processor(ParallelProcessor::Config{});
+
+    std::vector<ParallelProcessor::ContractCall> calls;
+    for (uint8_t i = 0; i < 200; ++i) {
+        // PUSH1 i PUSH1 0 MSTORE8 PUSH1 1 PUSH1 0 RETURN
+        calls.push_back(call(i % 4, {0x60, i, 0x60, 0x00, 0x53, 0x60, 0x01, 0x60, 0x00, 0xf3}));
+    }
+
+    auto futures = processor.executeContracts(calls);
+    ASSERT_EQ(futures.size(), calls.size());
+    for (size_t i = 0; i < futures.size(); ++i) {
+        auto result = futures[i].get();
+        ASSERT_TRUE(result.success) << result.error_message;
+        ASSERT_EQ(result.return_data.size(), 1u);
+        EXPECT_EQ(result.return_data[0], static_cast<uint8_t>(i));
+    }
+}
+
+TEST(ParallelProcessorTest, StoppedProcessorRejectsCalls) {
+    ParallelProcessor processor(ParallelProcessor::Config{});
+    processor.stop();
+
+    auto result = processor.executeContract(call(1, {0x00})).get();
+    EXPECT_FALSE(result.success);
+    EXPECT_EQ(result.error_message, "Processor stopped");
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
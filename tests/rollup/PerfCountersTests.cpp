@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include "utils/PerfCounters.hpp"
+#include <cstdint>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using utils::PerfCounters;
+using utils::PerfScope;
+using utils::PerfStage;
+
+namespace {
+
+uint64_t spin(uint64_t rounds) {
+    volatile uint64_t x = 1;
+    for (uint64_t i = 0; i < rounds; ++i) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return x;
+}
+
+} // namespace
+
+TEST(PerfCountersTest, DisabledScopesRecordNothing) {
+    auto& counters = PerfCounters::global();
+    counters.disable();
+    const auto before = counters.totals(PerfStage::NetworkDecode);
+    {
+        PerfScope scope(PerfStage::NetworkDecode);
+        spin(1000);
+    }
+    EXPECT_EQ(counters.totals(PerfStage::NetworkDecode).scopes, before.scopes);
+}
+
+TEST(PerfCountersTest, SeriesAreExportedPerStage) {
+    auto& counters = PerfCounters::global();
+    // Registers the series whether or not this host has a PMU
+    const bool enabled = counters.enable();
+    const auto text = utils::MetricsRegistry::global().scrape();
+    EXPECT_NE(text.find("quids_perf_cycles_total{stage=\"gate_apply\"}"), std::string::npos);
+    EXPECT_NE(text.find("quids_perf_branch_misses_total{stage=\"evm_execute\"}"), std::string::npos);
+    EXPECT_NE(text.find("quids_perf_scopes_total{stage=\"signature_verify\"}"), std::string::npos);
+    EXPECT_EQ(counters.enabled(), enabled);
+    counters.disable();
+}
+
+TEST(PerfCountersTest, ScopesCountTheirStage) {
+    auto& counters = PerfCounters::global();
+    if (!counters.enable()) {
+        GTEST_SKIP() << "no hardware counters on this host";
+    }
+    const auto before = counters.totals(PerfStage::GateApply);
+    {
+        PerfScope scope(PerfStage::GateApply);
+        spin(1'000'000);
+    }
+    const auto after = counters.totals(PerfStage::GateApply);
+    counters.disable();
+
+    EXPECT_EQ(after.scopes, before.scopes + 1);
+    EXPECT_GT(after.counts.instructions(), before.counts.instructions() + 1'000'000);
+    EXPECT_GT(after.counts.cycles(), before.counts.cycles());
+    EXPECT_GT(after.ipc(), 0.0);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
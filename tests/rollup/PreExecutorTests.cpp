@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "rollup/PreExecutor.hpp"
+#include "blockchain/TransactionView.hpp"
+#include "TestTransactions.hpp"
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+blockchain::TransactionPtr transfer(const std::string& from, const std::string& to, uint64_t amount,
+                                    uint64_t nonce, bool sign = true) {
+    return quids::test::makeSignedTransfer(from, to, amount, nonce, 10, !sign);
+}
+
+StateManager::Account account(const std::string& address, uint64_t balance) {
+    StateManager::Account a;
+    a.address = address;
+    a.balance = balance;
+    a.nonce = 0;
+    return a;
+}
+
+} // namespace
+
+class PreExecutorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        state_ = std::make_shared<StateManager>();
+        state_->add_account("alice", account("alice", 1000));
+        state_->add_account("bob", account("bob", 1000));
+        state_->add_account("carol", account("carol", 1000));
+        mempool_ = std::make_shared<Mempool>();
+    }
+
+    PreExecutor::Outcome outcome(const PreExecutor& pre, const blockchain::TransactionPtr& tx) {
+        auto p = pre.prediction(*tx);
+        EXPECT_TRUE(p.has_value());
+        return p ? p->outcome : PreExecutor::Outcome::Succeeds;
+    }
+
+    std::shared_ptr<StateManager> state_;
+    std::shared_ptr<Mempool> mempool_;
+};
+
+TEST_F(PreExecutorTest, ReplaysEachSenderInNonceOrder) {
+    const auto first = transfer("alice", "bob", 600, 1);
+    const auto second = transfer("alice", "bob", 600, 2);  // the first leaves too little
+    const auto unknown = transfer("bob", "dave", 1, 1);
+    const auto forged = transfer("carol", "bob", 1, 1, false);
+    for (const auto& tx : {first, second, unknown, forged}) {
+        ASSERT_TRUE(Mempool::is_accepted(mempool_->submit(tx)));
+    }
+
+    PreExecutor pre(state_, mempool_);
+    EXPECT_EQ(pre.run_once(), 4u);
+    EXPECT_EQ(mempool_->size(), 4u);  // nothing is taken
+
+    EXPECT_EQ(outcome(pre, first), PreExecutor::Outcome::Succeeds);
+    EXPECT_EQ(outcome(pre, second), PreExecutor::Outcome::InsufficientFunds);
+    EXPECT_EQ(outcome(pre, unknown), PreExecutor::Outcome::UnknownAccount);
+    EXPECT_EQ(outcome(pre, forged), PreExecutor::Outcome::BadSignature);
+
+    // A success writes both accounts, a failure only reads its sender
+    const auto access = pre.access_sets({first, second});
+    EXPECT_EQ(access[0].writes.size(), ConflictScheduler::buildAccessSet(*first).writes.size());
+    EXPECT_TRUE(access[1].writes.empty());
+    ASSERT_EQ(access[1].reads.size(), 1u);
+    EXPECT_EQ(access[1].reads[0], ConflictScheduler::accountKey("alice"));
+
+    // Nothing changed, so a second pass has nothing to do
+    EXPECT_EQ(pre.run_once(), 0u);
+    EXPECT_EQ(pre.stats().passes, 2u);
+    EXPECT_EQ(pre.stats().predicted_failures, 3u);
+}
+
+TEST_F(PreExecutorTest, ScreensOnlyPermanentFailures) {
+    const auto ok = transfer("alice", "bob", 10, 1);
+    const auto gap = transfer("bob", "alice", 10, 3);
+    const auto forged = transfer("carol", "alice", 10, 1, false);
+    for (const auto& tx : {ok, gap, forged}) {
+        ASSERT_TRUE(Mempool::is_accepted(mempool_->submit(tx)));
+    }
+
+    PreExecutor pre(state_, mempool_);
+    pre.run_once();
+    EXPECT_EQ(outcome(pre, gap), PreExecutor::Outcome::NonceGap);
+
+    // A nonce gap may close before sealing, a bad signature never will
+    const auto kept = pre.screen({ok, gap, forged});
+    ASSERT_EQ(kept.size(), 2u);
+    EXPECT_EQ(kept[0], ok);
+    EXPECT_EQ(kept[1], gap);
+    EXPECT_EQ(pre.stats().screened, 1u);
+    EXPECT_FALSE(pre.prediction(*forged).has_value());
+
+    pre.forget(kept);
+    EXPECT_EQ(pre.size(), 0u);
+}
+
+TEST_F(PreExecutorTest, NewStateVersionReruns) {
+    const auto tx = transfer("alice", "bob", 10, 1);
+    ASSERT_TRUE(Mempool::is_accepted(mempool_->submit(tx)));
+
+    PreExecutor pre(state_, mempool_);
+    EXPECT_EQ(pre.run_once(), 1u);
+    const uint64_t before = pre.prediction(*tx)->state_version;
+
+    state_->add_account("alice", account("alice", 5));
+    state_->commit_state();
+    EXPECT_EQ(pre.run_once(), 1u);
+    EXPECT_NE(pre.prediction(*tx)->state_version, before);
+    EXPECT_EQ(outcome(pre, tx), PreExecutor::Outcome::InsufficientFunds);
+}
+
+TEST_F(PreExecutorTest, BackgroundPassesFollowSubmissions) {
+    PreExecutor::Config config;
+    config.interval = std::chrono::milliseconds(5);
+    PreExecutor pre(state_, mempool_, config);
+    pre.start();
+
+    const auto tx = transfer("alice", "bob", 10, 1);
+    ASSERT_TRUE(Mempool::is_accepted(mempool_->submit(tx)));
+    pre.notify();
+    for (int i = 0; i < 400 && !pre.prediction(*tx); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    pre.stop();
+    EXPECT_EQ(outcome(pre, tx), PreExecutor::Outcome::Succeeds);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "rollup/ProofAggregator.hpp"
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+QZKPGenerator::Proof make_proof(size_t i) {
+    QZKPGenerator::Proof proof;
+    const std::string data = "proof-" + std::to_string(i);
+    proof.proof_data.assign(data.begin(), data.end());
+    proof.is_valid = true;
+    return proof;
+}
+
+} // namespace
+
+TEST(ProofAggregatorTest, IncrementalFoldMatchesBatchFold) {
+    ProofAggregator one_by_one;
+    ProofAggregator batch;
+    std::vector<QZKPGenerator::Proof> proofs;
+    for (size_t i = 0; i < 37; ++i) {
+        proofs.push_back(make_proof(i));
+        one_by_one.add_proof(proofs.back());
+    }
+    batch.add_proofs(proofs);
+
+    const auto a = one_by_one.seal();
+    EXPECT_EQ(a, batch.seal());
+    EXPECT_EQ(a.level, 0u);
+    EXPECT_EQ(a.proof_count, 37u);
+    EXPECT_EQ(one_by_one.size(), 0u);
+}
+
+TEST(ProofAggregatorTest, EpochPathProvesOneProofWithoutTheOthers) {
+    constexpr size_t BLOCKS = 9;
+    constexpr size_t PROOFS_PER_BLOCK = 13;
+
+    ProofAggregator epoch;
+    std::vector<ProofAggregator::InclusionPath> paths;
+    for (size_t b = 0; b < BLOCKS; ++b) {
+        ProofAggregator block;
+        for (size_t p = 0; p < PROOFS_PER_BLOCK; ++p) {
+            block.add_proof(make_proof(b * PROOFS_PER_BLOCK + p));
+        }
+        // Path of the block's third proof up to the block
+        paths.push_back({block.path_step(2)});
+        epoch.add_aggregate(block.seal());
+    }
+    for (size_t b = 0; b < BLOCKS; ++b) {
+        paths[b].push_back(epoch.path_step(b));
+    }
+    const auto top = epoch.seal();
+    EXPECT_EQ(top.level, 1u);
+    EXPECT_EQ(top.proof_count, BLOCKS * PROOFS_PER_BLOCK);
+
+    // L1 keeps only the serialized top aggregate
+    const auto committed = ProofAggregator::Aggregate::deserialize(top.serialize());
+    for (size_t b = 0; b < BLOCKS; ++b) {
+        const auto leaf = ProofAggregator::proof_leaf(make_proof(b * PROOFS_PER_BLOCK + 2));
+        EXPECT_TRUE(ProofAggregator::verify_path(committed, leaf, paths[b]));
+
+        const auto other = ProofAggregator::proof_leaf(make_proof(b * PROOFS_PER_BLOCK + 3));
+        EXPECT_FALSE(ProofAggregator::verify_path(committed, other, paths[b]));
+    }
+
+    auto forged = committed;
+    forged.proof_count += 1;
+    const auto leaf = ProofAggregator::proof_leaf(make_proof(2));
+    EXPECT_FALSE(ProofAggregator::verify_path(forged, leaf, paths[0]));
+}
+
+TEST(ProofAggregatorTest, RejectsMixedChildren) {
+    ProofAggregator block;
+    block.add_proof(make_proof(0));
+    const auto aggregate = block.current();
+    EXPECT_THROW(block.add_aggregate(aggregate), std::logic_error);
+
+    ProofAggregator epoch;
+    epoch.add_aggregate(aggregate);
+    EXPECT_THROW(epoch.add_proof(make_proof(1)), std::logic_error);
+    auto higher = aggregate;
+    higher.level = 3;
+    EXPECT_THROW(epoch.add_aggregate(higher), std::logic_error);
+    EXPECT_THROW(ProofAggregator().seal(), std::logic_error);
+}
+
+TEST(ProofAggregatorTest, FlatAggregationStillVerifies) {
+    ProofAggregator aggregator;
+    std::vector<QZKPGenerator::Proof> proofs{make_proof(1), make_proof(2), make_proof(3)};
+    const auto aggregated = aggregator.aggregate_proofs(proofs);
+    EXPECT_TRUE(aggregator.verify_aggregated_proof(aggregated, proofs));
+    proofs[1] = make_proof(9);
+    EXPECT_FALSE(aggregator.verify_aggregated_proof(aggregated, proofs));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "rollup/ProofCache.hpp"
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+void populate(StateManager& state, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        StateManager::Account account;
+        account.address = "account_" + std::to_string(i);
+        account.balance = 1000 + i;
+        account.nonce = 0;
+        state.add_account(account.address, account);
+    }
+}
+
+StateTrie::Hash root_of(const StateManager::Snapshot& snapshot) {
+    StateTrie::Hash root{};
+    auto bytes = snapshot.get_state_root();
+    std::copy(bytes.begin(), bytes.end(), root.begin());
+    return root;
+}
+
+} // namespace
+
+TEST(ProofCacheTest, HitsUntilTheRootChanges) {
+    StateManager state;
+    populate(state, 500);
+    ProofCache cache;
+
+    auto before = state.snapshot();
+    auto proof = cache.prove(before, "account_7");
+    ASSERT_NE(proof, nullptr);
+    EXPECT_TRUE(StateTrie::verify(root_of(before), "account_7",
+                                  StateManager::account_hash(*before.get_account("account_7")), *proof));
+    EXPECT_EQ(cache.prove(before, "account_7"), proof);
+    EXPECT_EQ(cache.prove(state.snapshot(), "account_7"), proof);
+    EXPECT_EQ(cache.stats().hits, 2u);
+
+    // A write moves the root; the old snapshot still gets its own proof
+    state.set_balance("account_7", 1);
+    auto after = state.snapshot();
+    auto fresh = cache.prove(after, "account_7");
+    ASSERT_NE(fresh, nullptr);
+    EXPECT_NE(fresh, proof);
+    EXPECT_TRUE(StateTrie::verify(root_of(after), "account_7",
+                                  StateManager::account_hash(*after.get_account("account_7")), *fresh));
+    EXPECT_EQ(cache.prove(before, "account_7"), proof);
+
+    EXPECT_EQ(cache.prove(after, "nobody"), nullptr);
+    EXPECT_EQ(cache.size(), 2u);
+}
+
+TEST(ProofCacheTest, ProvesABurstAndEvictsTheLeastRecent) {
+    StateManager state;
+    populate(state, 300);
+    ProofCache cache(100);
+    auto view = state.snapshot();
+
+    std::vector<std::string> addresses;
+    for (size_t i = 0; i < 150; ++i) {
+        addresses.push_back("account_" + std::to_string(i));
+    }
+    addresses.push_back("nobody");
+    auto proofs = cache.prove_all(view, addresses);
+    ASSERT_EQ(proofs.size(), addresses.size());
+    for (size_t i = 0; i < 150; ++i) {
+        ASSERT_NE(proofs[i], nullptr);
+        EXPECT_TRUE(StateTrie::verify(root_of(view), addresses[i],
+                                      StateManager::account_hash(*view.get_account(addresses[i])), *proofs[i]));
+    }
+    EXPECT_EQ(proofs.back(), nullptr);
+    EXPECT_EQ(cache.size(), 100u);
+    EXPECT_EQ(cache.stats().evictions, 50u);
+
+    // The burst's first half was pushed out by its second
+    const auto misses = cache.stats().misses;
+    EXPECT_EQ(cache.prove(view, "account_149"), proofs[149]);
+    EXPECT_EQ(cache.stats().misses, misses);
+    const auto reproved = cache.prove(view, "account_0");
+    ASSERT_NE(reproved, nullptr);
+    EXPECT_NE(reproved, proofs[0]);
+    EXPECT_TRUE(StateTrie::verify(root_of(view), "account_0",
+                                  StateManager::account_hash(*view.get_account("account_0")), *reproved));
+    EXPECT_EQ(cache.stats().misses, misses + 1);
+}
+
+TEST(ProofCacheTest, SnapshotMultiProofCoversEveryAccount) {
+    StateManager state;
+    populate(state, 1000);
+    auto view = state.snapshot();
+
+    std::vector<std::string> addresses;
+    std::vector<std::pair<std::string, StateTrie::Hash>> leaves;
+    for (size_t i = 0; i < 1000; i += 9) {
+        addresses.push_back("account_" + std::to_string(i));
+        leaves.emplace_back(addresses.back(), StateManager::account_hash(*view.get_account(addresses.back())));
+    }
+    auto proof = view.prove_accounts(addresses);
+    ASSERT_TRUE(proof.has_value());
+
+    // Later writes leave the snapshot's proof intact
+    state.set_balance("account_0", 5);
+    EXPECT_TRUE(StateTrie::verify_many(root_of(view), leaves, *proof));
+    EXPECT_FALSE(StateTrie::verify_many(root_of(state.snapshot()), leaves, *proof));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
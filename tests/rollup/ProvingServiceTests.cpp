@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "rollup/ProvingService.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+// Proves instantly, tagging the proof with the state's qubit count
+ProvingService::BackendFactory tagging_backend() {
+    return [] {
+        return [](const quantum::QuantumState& state) {
+            ProvingService::Proof proof;
+            proof.proof_data.push_back(static_cast<uint8_t>(state.getNumQubits()));
+            proof.is_valid = true;
+            return proof;
+        };
+    };
+}
+
+} // namespace
+
+TEST(ProvingServiceTest, CompletesEveryJobAndReportsMetrics) {
+    ProvingService service({2, 64}, tagging_backend());
+    std::mutex mutex;
+    std::vector<uint8_t> tags;
+    for (size_t i = 1; i <= 8; ++i) {
+        auto job = service.submit(quantum::QuantumState(i), ProvingService::Priority::Normal,
+            [&](uint64_t, ProvingService::Proof&& proof, std::exception_ptr error) {
+                ASSERT_FALSE(error);
+                std::lock_guard<std::mutex> lock(mutex);
+                tags.push_back(proof.proof_data.at(0));
+            });
+        ASSERT_TRUE(job.has_value());
+    }
+    service.drain();
+
+    std::sort(tags.begin(), tags.end());
+    EXPECT_EQ(tags, (std::vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8}));
+
+    const auto metrics = service.metrics();
+    EXPECT_EQ(metrics.submitted, 8u);
+    EXPECT_EQ(metrics.completed, 8u);
+    EXPECT_EQ(metrics.queue_depth, 0u);
+    EXPECT_EQ(metrics.in_flight, 0u);
+    EXPECT_GE(metrics.max_lag, metrics.average_lag);
+}
+
+TEST(ProvingServiceTest, UrgentJobsOvertakeQueuedOnes) {
+    // One worker, held on its first job until everything else is queued
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    std::atomic<bool> started{false};
+    ProvingService service({1, 64}, [&] {
+        return [&](const quantum::QuantumState& state) {
+            if (!started.exchange(true)) {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return release; });
+            }
+            ProvingService::Proof proof;
+            proof.proof_data.push_back(static_cast<uint8_t>(state.getNumQubits()));
+            return proof;
+        };
+    });
+
+    std::vector<uint8_t> order;
+    auto record = [&](uint64_t, ProvingService::Proof&& proof, std::exception_ptr) {
+        order.push_back(proof.proof_data.at(0));
+    };
+    ASSERT_TRUE(service.submit(quantum::QuantumState(1), ProvingService::Priority::Normal, record));
+    while (!started) {
+        std::this_thread::yield();
+    }
+    ASSERT_TRUE(service.submit(quantum::QuantumState(2), ProvingService::Priority::Background, record));
+    ASSERT_TRUE(service.submit(quantum::QuantumState(3), ProvingService::Priority::Normal, record));
+    ASSERT_TRUE(service.submit(quantum::QuantumState(4), ProvingService::Priority::Urgent, record));
+    EXPECT_EQ(service.metrics().queue_depth, 3u);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    service.drain();
+
+    EXPECT_EQ(order, (std::vector<uint8_t>{1, 4, 3, 2}));
+}
+
+TEST(ProvingServiceTest, RefusesPastQueueLimitAndFailsQueuedJobsOnStop) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool release = false;
+    std::atomic<bool> started{false};
+    ProvingService service({1, 2}, [&] {
+        return [&](const quantum::QuantumState&) {
+            started = true;
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return release; });
+            return ProvingService::Proof{};
+        };
+    });
+
+    std::atomic<int> errors{0};
+    auto count_errors = [&](uint64_t, ProvingService::Proof&&, std::exception_ptr error) {
+        errors += error ? 1 : 0;
+    };
+    ASSERT_TRUE(service.submit(quantum::QuantumState(1), ProvingService::Priority::Normal, count_errors));
+    while (!started) {
+        std::this_thread::yield();
+    }
+    ASSERT_TRUE(service.submit(quantum::QuantumState(1), ProvingService::Priority::Normal, count_errors));
+    ASSERT_TRUE(service.submit(quantum::QuantumState(1), ProvingService::Priority::Normal, count_errors));
+
+    quantum::QuantumState refused(3);
+    EXPECT_FALSE(service.submit(std::move(refused), ProvingService::Priority::Urgent, count_errors));
+    EXPECT_EQ(refused.getNumQubits(), 3u);
+    EXPECT_EQ(service.metrics().rejected, 1u);
+
+    std::thread stopper([&] { service.stop(); });
+    // stop() empties the queue before it waits for the running job
+    while (service.metrics().queue_depth != 0) {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cv.notify_all();
+    stopper.join();
+
+    EXPECT_EQ(errors.load(), 2);
+    EXPECT_FALSE(service.submit(quantum::QuantumState(1), ProvingService::Priority::Normal, count_errors));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+#include "rollup/RollupScheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+using Id = RollupScheduler::RollupId;
+
+std::shared_ptr<ProvingService> instant_prover(size_t workers = 2) {
+    return std::make_shared<ProvingService>(ProvingService::Config{workers, 256}, [] {
+        return [](const quantum::QuantumState& state) {
+            ProvingService::Proof proof;
+            proof.proof_data.push_back(static_cast<uint8_t>(state.getNumQubits()));
+            proof.is_valid = true;
+            return proof;
+        };
+    });
+}
+
+// Holds the first batch that runs until release(), so the rest queue up
+class Gate {
+public:
+    RollupScheduler::Execute hold() {
+        return [this] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            held_ = true;
+            cv_.notify_all();
+            cv_.wait(lock, [this] { return released_; });
+            return quantum::QuantumState(1);
+        };
+    }
+    void wait_held() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return held_; });
+    }
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_ = true;
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool held_{false};
+    bool released_{false};
+};
+
+} // namespace
+
+TEST(RollupSchedulerTest, ProvesEveryRollupsBatches) {
+    RollupScheduler scheduler({2, 2}, instant_prover());
+    scheduler.add_rollup(1, {});
+    scheduler.add_rollup(2, {});
+
+    std::mutex mutex;
+    std::vector<uint8_t> tags;
+    for (Id rollup : {1u, 2u}) {
+        for (size_t qubits = 1; qubits <= 4; ++qubits) {
+            auto batch = scheduler.submit(rollup, [qubits] { return quantum::QuantumState(qubits); },
+                [&](uint64_t, RollupScheduler::Proof&& proof, std::exception_ptr error) {
+                    ASSERT_FALSE(error);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    tags.push_back(proof.proof_data.at(0));
+                });
+            ASSERT_TRUE(batch.has_value());
+        }
+    }
+    scheduler.drain();
+
+    std::sort(tags.begin(), tags.end());
+    EXPECT_EQ(tags, (std::vector<uint8_t>{1, 1, 2, 2, 3, 3, 4, 4}));
+    for (Id rollup : {1u, 2u}) {
+        const auto metrics = scheduler.metrics(rollup);
+        EXPECT_EQ(metrics.submitted, 4u);
+        EXPECT_EQ(metrics.completed, 4u);
+        EXPECT_EQ(metrics.queued, 0u);
+        EXPECT_EQ(metrics.running, 0u);
+        EXPECT_EQ(metrics.executed_cost, 4u);
+    }
+    EXPECT_THROW((void)scheduler.metrics(3), std::out_of_range);
+    EXPECT_THROW(scheduler.add_rollup(1, {}), std::invalid_argument);
+}
+
+TEST(RollupSchedulerTest, BurstGetsOnlyItsWeightedShare) {
+    RollupScheduler scheduler({1, 1}, instant_prover(1));
+    scheduler.add_rollup(1, {3, std::chrono::milliseconds(2000), 64});
+    scheduler.add_rollup(2, {1, std::chrono::milliseconds(2000), 64});
+
+    Gate gate;
+    std::mutex mutex;
+    std::vector<Id> order;
+    auto note = [&](Id rollup) {
+        return [&, rollup] {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(rollup);
+            return quantum::QuantumState(1);
+        };
+    };
+
+    ASSERT_TRUE(scheduler.submit(1, gate.hold(), nullptr));
+    gate.wait_held();
+    // Rollup 1 bursts well ahead of rollup 2
+    for (int i = 0; i < 30; ++i) {
+        ASSERT_TRUE(scheduler.submit(1, note(1), nullptr));
+    }
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(scheduler.submit(2, note(2), nullptr));
+    }
+    gate.release();
+    scheduler.drain();
+
+    ASSERT_EQ(order.size(), 40u);
+    // Rollup 2 is served at once and then gets one batch in four
+    EXPECT_EQ(order.front(), 2u);
+    const auto first_sixteen = std::count(order.begin(), order.begin() + 16, 2u);
+    EXPECT_GE(first_sixteen, 4);
+    EXPECT_LE(first_sixteen, 5);
+}
+
+TEST(RollupSchedulerTest, QueueBoundIsPerRollup) {
+    RollupScheduler scheduler({1, 1}, instant_prover(1));
+    scheduler.add_rollup(1, {1, std::chrono::milliseconds(2000), 3});
+    scheduler.add_rollup(2, {1, std::chrono::milliseconds(2000), 3});
+
+    Gate gate;
+    ASSERT_TRUE(scheduler.submit(1, gate.hold(), nullptr));
+    gate.wait_held();
+    auto one = [] { return quantum::QuantumState(1); };
+    EXPECT_TRUE(scheduler.submit(1, one, nullptr));
+    EXPECT_TRUE(scheduler.submit(1, one, nullptr));
+    EXPECT_FALSE(scheduler.submit(1, one, nullptr));
+    EXPECT_TRUE(scheduler.submit(2, one, nullptr));
+    EXPECT_EQ(scheduler.metrics(1).rejected, 1u);
+    EXPECT_EQ(scheduler.metrics(1).queued, 2u);
+    EXPECT_EQ(scheduler.metrics(2).rejected, 0u);
+
+    gate.release();
+    scheduler.drain();
+    EXPECT_EQ(scheduler.metrics(1).completed, 3u);
+    EXPECT_EQ(scheduler.metrics(2).completed, 1u);
+    EXPECT_THROW(scheduler.submit(9, one, nullptr), std::out_of_range);
+}
+
+TEST(RollupSchedulerTest, CountsFailuresAndSloMisses) {
+    RollupScheduler scheduler({2, 2}, instant_prover());
+    scheduler.add_rollup(1, {1, std::chrono::milliseconds(1), 8});
+
+    std::atomic<int> errors{0};
+    auto done = [&](uint64_t, RollupScheduler::Proof&&, std::exception_ptr error) {
+        if (error) ++errors;
+    };
+    ASSERT_TRUE(scheduler.submit(1, []() -> quantum::QuantumState { throw std::runtime_error("bad batch"); }, done));
+    ASSERT_TRUE(scheduler.submit(1, [] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return quantum::QuantumState(1);
+    }, done));
+    scheduler.drain();
+
+    const auto metrics = scheduler.metrics(1);
+    EXPECT_EQ(errors.load(), 1);
+    EXPECT_EQ(metrics.failed, 1u);
+    EXPECT_EQ(metrics.completed, 1u);
+    EXPECT_EQ(metrics.slo_misses, 1u);
+    EXPECT_GE(metrics.p50_latency, std::chrono::milliseconds(4));
+
+    const auto scrape = utils::MetricsRegistry::global().scrape();
+    EXPECT_NE(scrape.find("quids_rollup_scheduler_slo_misses_total{rollup=\"1\"} 1"), std::string::npos);
+}
+
+TEST(RollupSchedulerTest, StopAbandonsQueuedBatches) {
+    auto scheduler = std::make_unique<RollupScheduler>(RollupScheduler::Config{1, 1}, instant_prover(1));
+    scheduler->add_rollup(1, {});
+
+    Gate gate;
+    std::atomic<int> errors{0};
+    std::atomic<int> proofs{0};
+    auto done = [&](uint64_t, RollupScheduler::Proof&&, std::exception_ptr error) {
+        ++(error ? errors : proofs);
+    };
+    ASSERT_TRUE(scheduler->submit(1, gate.hold(), done));
+    gate.wait_held();
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(scheduler->submit(1, [] { return quantum::QuantumState(1); }, done));
+    }
+
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        gate.release();
+    });
+    scheduler->stop();
+    releaser.join();
+
+    // The held batch was running, so it ends too, but not with a proof
+    EXPECT_EQ(errors.load(), 4);
+    EXPECT_EQ(proofs.load(), 0);
+    EXPECT_FALSE(scheduler->submit(1, [] { return quantum::QuantumState(1); }, done));
+    scheduler.reset();
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include "rollup/RollupTransactionAPI.hpp"
+#include "rollup/EnhancedRollupMLModel.hpp"
+#include "TestTransactions.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+std::shared_ptr<EnhancedRollupMLModel> smallModel() {
+    return std::make_shared<EnhancedRollupMLModel>(EnhancedRollupMLModel::ModelParameters{16, 2, 0.01, 0.9, 0.999, 1e-8});
+}
+
+bool eventually(const std::function<bool()>& done) {
+    const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done() && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return done();
+}
+
+// Snapshots the sink saw, one per batch
+struct Batches {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<const QuantumParameters>> parameters;
+    size_t transactions{0};
+
+    RollupTransactionAPI::BatchSink sink() {
+        return [this](const TransactionBatch& batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            parameters.push_back(batch.parameters);
+            transactions += batch.size();
+        };
+    }
+
+    size_t seen() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return transactions;
+    }
+};
+
+} // namespace
+
+TEST(RollupTransactionAPITest, BatchesRunUnderTheLatestPublishedParameters) {
+    Batches batches;
+    RollupTransactionAPI api(smallModel(), 2, nullptr, batches.sink());
+    const auto initial = api.get_parameters();
+    ASSERT_NE(initial, nullptr);
+    EXPECT_EQ(api.get_parameters_version(), 0u);
+
+    ASSERT_TRUE(api.submitTransaction(quids::test::makeSignedTransfer("alice", "bob", 1, 0)));
+    ASSERT_TRUE(eventually([&] { return batches.seen() == 1; }));
+
+    api.optimize_parameters();
+    ASSERT_TRUE(eventually([&] { return api.get_parameters_version() == 1; }));
+    const auto published = api.get_parameters();
+    EXPECT_NE(published, initial);
+
+    ASSERT_TRUE(api.submitTransaction(quids::test::makeSignedTransfer("carol", "bob", 1, 0)));
+    ASSERT_TRUE(eventually([&] { return batches.seen() == 2; }));
+    std::lock_guard<std::mutex> lock(batches.mutex);
+    ASSERT_EQ(batches.parameters.size(), 2u);
+    EXPECT_EQ(batches.parameters[0], initial);
+    EXPECT_EQ(batches.parameters[1], published);
+
+    // Nothing to run inference with publishes nothing
+    api.set_ml_model(nullptr);
+    api.optimize_parameters();
+    EXPECT_EQ(api.get_parameters_version(), 1u);
+}
+
+TEST(RollupTransactionAPITest, ReadersSeeWholeSnapshotsWhilePublishing) {
+    constexpr uint64_t PUBLISHES = 20;
+    constexpr size_t SENDERS = 200;
+    Batches batches;
+    RollupTransactionAPI api(smallModel(), 2, nullptr, batches.sink());
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> torn{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&] {
+            uint64_t last_version = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                const uint64_t version = api.get_parameters_version();
+                const auto parameters = api.get_parameters();
+                if (!parameters || version < last_version ||
+                    parameters->phase_angles.size() != parameters->num_qubits) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+                last_version = version;
+            }
+        });
+    }
+
+    // Submissions and publishes interleave; a call while an inference is
+    // in flight is dropped, so keep asking until enough have landed
+    size_t submitted = 0;
+    const bool published = eventually([&] {
+        if (submitted < SENDERS) {
+            EXPECT_TRUE(api.submitTransaction(
+                quids::test::makeSignedTransfer("sender_" + std::to_string(submitted), "bob", 1, 0)));
+            ++submitted;
+        }
+        api.optimize_parameters();
+        return submitted == SENDERS && api.get_parameters_version() >= PUBLISHES;
+    });
+    EXPECT_TRUE(published) << api.get_parameters_version() << " publishes";
+    EXPECT_TRUE(eventually([&] { return batches.seen() == SENDERS; }));
+    done.store(true, std::memory_order_release);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(torn.load(), 0u);
+    std::lock_guard<std::mutex> lock(batches.mutex);
+    for (const auto& parameters : batches.parameters) {
+        EXPECT_NE(parameters, nullptr);
+    }
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
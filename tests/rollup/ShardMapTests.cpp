@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "rollup/ShardMap.hpp"
+#include <limits>
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+std::string account(size_t i) {
+    return "account-" + std::to_string(i);
+}
+
+// Ranges tile the key space in order and never repeat a chain back to back
+void expect_tiling(const ShardMap& map) {
+    const auto ranges = map.ranges();
+    ASSERT_FALSE(ranges.empty());
+    EXPECT_EQ(ranges.front().first, 0u);
+    EXPECT_EQ(ranges.back().last, std::numeric_limits<ShardMap::Key>::max());
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        EXPECT_EQ(ranges[i].first, ranges[i - 1].last + 1);
+        EXPECT_NE(ranges[i].chain, ranges[i - 1].chain);
+    }
+}
+
+CrossChainState loads(std::vector<double> chain_loads) {
+    CrossChainState state(chain_loads.size());
+    state.chain_loads = std::move(chain_loads);
+    return state;
+}
+
+} // namespace
+
+TEST(ShardMapTest, StartsWithEverythingOnTheRootChain) {
+    ShardMap map(7);
+    EXPECT_EQ(map.chain_for(account(1)), 7u);
+    EXPECT_EQ(map.chain_for(account(2)), 7u);
+    EXPECT_EQ(ShardMap::key_of(account(1)), ShardMap::key_of(account(1)));
+    EXPECT_EQ(map.chains(), std::vector<ShardMap::ChainId>{7});
+    EXPECT_EQ(map.epoch(), 0u);
+    expect_tiling(map);
+}
+
+TEST(ShardMapTest, NewChainTakesHalfOfTheBusiestRange) {
+    ShardMap map(1);
+    auto migration = map.add_chain(2);
+    ASSERT_TRUE(migration);
+    EXPECT_EQ(migration->from, 1u);
+    EXPECT_EQ(migration->range.chain, 2u);
+    EXPECT_EQ(migration->epoch, 1u);
+    EXPECT_EQ(map.chains(), (std::vector<ShardMap::ChainId>{1, 2}));
+    expect_tiling(map);
+
+    size_t moved = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        const auto key = ShardMap::key_of(account(i));
+        const bool in_range = key >= migration->range.first && key <= migration->range.last;
+        EXPECT_EQ(map.chain_for(account(i)), in_range ? 2u : 1u);
+        moved += in_range;
+    }
+    EXPECT_GT(moved, 400u);
+    EXPECT_LT(moved, 600u);
+
+    EXPECT_FALSE(map.add_chain(2));
+}
+
+TEST(ShardMapTest, RebalanceMovesHotAccountsToTheQuietChain) {
+    ShardMap map(1);
+    ASSERT_TRUE(map.add_chain(2));
+
+    // All the traffic lands on chain 1
+    for (size_t i = 0; i < 2000; ++i) {
+        if (map.chain_for(account(i)) == 1) {
+            map.record(account(i));
+        }
+    }
+    auto migration = map.rebalance(loads({0.9, 0.1}));
+    ASSERT_TRUE(migration);
+    EXPECT_EQ(migration->from, 1u);
+    EXPECT_EQ(migration->range.chain, 2u);
+    EXPECT_EQ(migration->epoch, 2u);
+    expect_tiling(map);
+
+    for (size_t i = 0; i < 2000; ++i) {
+        const auto key = ShardMap::key_of(account(i));
+        if (key >= migration->range.first && key <= migration->range.last) {
+            EXPECT_EQ(map.chain_for(account(i)), 2u);
+        }
+    }
+}
+
+TEST(ShardMapTest, BalancedChainsStayPut) {
+    ShardMap map(1);
+    ASSERT_TRUE(map.add_chain(2));
+    EXPECT_FALSE(map.rebalance(loads({0.5, 0.5})));
+
+    // Busy but even: another chain is the answer, not a move
+    auto busy = loads({0.5, 0.5});
+    busy.chain_utilization = {0.95, 0.95};
+    ASSERT_TRUE(busy.needs_rebalancing());
+    EXPECT_FALSE(map.rebalance(busy));
+    EXPECT_EQ(map.epoch(), 1u);
+
+    EXPECT_THROW((void)map.rebalance(loads({0.9, 0.05, 0.05})), std::invalid_argument);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "rollup/StateStore.hpp"
+#include "TestStorage.hpp"
+#include <chrono>
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateManager::Account account(const std::string& address, uint64_t balance) {
+    StateManager::Account a;
+    a.address = address;
+    a.balance = balance;
+    a.nonce = 0;
+    return a;
+}
+
+} // namespace
+
+class StateCheckpointTest : public quids::test::TempStorageTest {
+protected:
+    StateCheckpointTest() : TempStorageTest("state_checkpoint_") {}
+};
+
+TEST_F(StateCheckpointTest, IntervalCoalescesHotAccounts) {
+    StateStore::Config config;
+    config.sync_writes = false;
+    config.checkpoint_interval = std::chrono::hours(1);
+    auto store = std::make_shared<StateStore>(storage_, config);
+    {
+        StateManager state(store);
+        state.add_account("hot", account("hot", 0));
+        state.commit_state();
+        ASSERT_TRUE(store->flush());  // the first checkpoint goes out at once
+
+        for (uint64_t i = 1; i <= 50; ++i) {
+            state.add_account("hot", account("hot", i));
+            state.commit_state();
+        }
+        EXPECT_EQ(store->durable_version(), 1u);  // held for the interval
+        EXPECT_EQ(store->get("hot")->balance, 50u);
+
+        ASSERT_TRUE(store->flush());
+        EXPECT_EQ(store->durable_version(), 51u);
+        EXPECT_EQ(store->stats().flushed_batches, 2u);
+    }
+
+    // A restart resumes from the last checkpoint
+    StateManager restarted(std::make_shared<StateStore>(storage_, config));
+    EXPECT_EQ(restarted.version(), 51u);
+    EXPECT_EQ(restarted.get_balance("hot"), 50u);
+}
+
+TEST_F(StateCheckpointTest, LagBoundHoldsCommitsBack) {
+    StateStore::Config config;
+    config.sync_writes = false;
+    config.checkpoint_interval = std::chrono::hours(1);
+    config.max_lag_versions = 4;
+    auto store = std::make_shared<StateStore>(storage_, config);
+    StateManager state(store);
+    for (uint64_t i = 1; i <= 20; ++i) {
+        state.add_account("a", account("a", i));
+        state.commit_state();
+        EXPECT_LE(store->committed_version() - store->durable_version(), 4u);
+    }
+    EXPECT_GT(store->stats().lag_stalls, 0u);
+}
+
+TEST_F(StateCheckpointTest, SharedCodeIsStoredOnceByHash) {
+    StateStore::Config config;
+    config.async_flush = false;
+    config.sync_writes = false;
+    const std::vector<uint8_t> code = {0x60, 0x2a, 0x60, 0x00, 0x55, 0x00};
+    evm::Hash256 code_hash{};
+    {
+        auto store = std::make_shared<StateStore>(storage_, config);
+        StateManager state(store);
+        for (const char* address : {"clone1", "clone2"}) {
+            auto a = account(address, 1);
+            a.code = code;
+            state.add_account(address, a);
+        }
+        state.commit_state();
+        ASSERT_TRUE(store->flush());
+        EXPECT_EQ(store->stats().flushed_accounts, 2u);
+
+        const auto first = store->get("clone1");
+        code_hash = first->code.hash();
+        EXPECT_EQ(first->code, store->get("clone2")->code);
+    }
+    // Nothing holds the code now, so it comes back from disk
+    EXPECT_FALSE(evm::CodeStore::global().find(code_hash));
+
+    StateStore reopened(storage_, config);
+    const auto first = reopened.get("clone1");
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first->code.bytes(), code);
+    EXPECT_EQ(first->code.hash(), code_hash);
+    EXPECT_TRUE(evm::CodeStore::global().find(code_hash));
+    EXPECT_EQ(reopened.get("clone2")->code.bytes(), code);
+
+    // Written for the wire, an account still carries its code
+    const auto wire = StateManager::Account::deserialize(first->serialize());
+    ASSERT_TRUE(wire);
+    EXPECT_EQ(wire->code.bytes(), code);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
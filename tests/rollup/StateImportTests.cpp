@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include "rollup/StateStore.hpp"
+#include "TestStorage.hpp"
+#include <filesystem>
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateManager::Account account(const std::string& address, uint64_t balance) {
+    StateManager::Account a;
+    a.address = address;
+    a.balance = balance;
+    a.nonce = balance % 5;
+    return a;
+}
+
+StateStore::Config inline_writes() {
+    StateStore::Config config;
+    config.async_flush = false;
+    config.sync_writes = false;
+    return config;
+}
+
+} // namespace
+
+class StateImportTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = quids::test::uniqueTempPath("state_import_");
+        std::filesystem::create_directories(dir_);
+        for (int i = 0; i < 500; ++i) {
+            const auto address = "acct" + std::to_string(i);
+            state_.add_account(address, account(address, 1000 + i));
+        }
+        state_.commit_state();
+    }
+
+    void TearDown() override {
+        storages_.clear();
+        std::filesystem::remove_all(dir_);
+    }
+
+    std::shared_ptr<StateStore> store(const std::string& name) {
+        storages_.push_back(std::make_shared<storage::PersistentStorage>((dir_ / name).string()));
+        return std::make_shared<StateStore>(storages_.back(), inline_writes());
+    }
+
+    std::filesystem::path dir_;
+    StateManager state_;
+    std::vector<std::shared_ptr<storage::PersistentStorage>> storages_;
+};
+
+TEST_F(StateImportTest, RoundTripsThroughChunks) {
+    const auto snapshot_dir = (dir_ / "snapshot").string();
+    const auto manifest = StateStore::export_snapshot(state_.snapshot(), snapshot_dir, 64);
+    ASSERT_TRUE(manifest.has_value());
+    EXPECT_EQ(manifest->chunks.size(), 8u);  // 500 accounts, 64 per chunk
+    EXPECT_EQ(manifest->chunks.back().accounts, 500u - 7 * 64);
+
+    const auto read = StateStore::read_manifest(snapshot_dir);
+    ASSERT_TRUE(read.has_value());
+    EXPECT_EQ(read->head.version, state_.version());
+    EXPECT_EQ(read->head.state_root, state_.get_state_root());
+
+    auto target = store("target");
+    ASSERT_TRUE(target->import_snapshot(snapshot_dir));
+    EXPECT_EQ(target->durable_version(), state_.version());
+    ASSERT_TRUE(target->get("acct42").has_value());
+    EXPECT_EQ(target->get("acct42")->balance, 1042u);
+
+    // Loading the imported store checks the root once more
+    StateManager loaded(target);
+    EXPECT_EQ(loaded.get_state_root(), state_.get_state_root());
+    EXPECT_EQ(loaded.version(), state_.version());
+}
+
+TEST_F(StateImportTest, RejectsRootMismatch) {
+    const auto snapshot_dir = (dir_ / "snapshot").string();
+    ASSERT_TRUE(StateStore::export_snapshot(state_.snapshot(), snapshot_dir, 100).has_value());
+
+    // Chunks of a different state under the original manifest
+    StateManager other;
+    other.add_account("acct0", account("acct0", 1));
+    const auto other_dir = (dir_ / "other").string();
+    ASSERT_TRUE(StateStore::export_snapshot(other.snapshot(), other_dir, 100).has_value());
+    std::filesystem::copy_file(std::filesystem::path(other_dir) / "chunk-000000.sst",
+                               std::filesystem::path(snapshot_dir) / "chunk-000000.sst",
+                               std::filesystem::copy_options::overwrite_existing);
+
+    auto target = store("target");
+    EXPECT_FALSE(target->import_snapshot(snapshot_dir));
+    EXPECT_FALSE(target->load_head().has_value());
+    EXPECT_FALSE(target->get("acct42").has_value());
+}
+
+TEST_F(StateImportTest, OnlyIntoAnEmptyStore) {
+    const auto snapshot_dir = (dir_ / "snapshot").string();
+    ASSERT_TRUE(StateStore::export_snapshot(state_.snapshot(), snapshot_dir, 128).has_value());
+
+    auto target = store("target");
+    target->commit(1, state_.get_state_root(), {{"acct0", account("acct0", 1)}});
+    ASSERT_TRUE(target->flush());
+    EXPECT_FALSE(target->import_snapshot(snapshot_dir));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "rollup/StateManager.hpp"
+#include "TestTransactions.hpp"
+#include <span>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+constexpr size_t ACCOUNTS = 24;
+
+std::string account_name(size_t i) {
+    return "account-" + std::to_string(i);
+}
+
+std::unique_ptr<StateManager> make_state() {
+    auto state = std::make_unique<StateManager>();
+    for (size_t i = 0; i < ACCOUNTS; ++i) {
+        StateManager::Account account;
+        account.address = account_name(i);
+        account.balance = 100'000;
+        account.nonce = 0;
+        state->add_account(account.address, account);
+    }
+    return state;
+}
+
+// Transfers within clusters of four accounts, so the batch splits into
+// groups, salted with ones the serial loop skips: a stale nonce, an
+// overdraft and a forged signature. `stop_at` sends that transfer to an
+// account that does not exist.
+std::vector<blockchain::TransactionPtr> batch(size_t count, size_t stop_at = SIZE_MAX) {
+    std::vector<blockchain::TransactionPtr> txs;
+    std::vector<uint64_t> nonces(ACCOUNTS, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const size_t from = i % ACCOUNTS;
+        const size_t to = (from / 4) * 4 + (from + 1 + i / ACCOUNTS) % 4;
+        const std::string recipient = i == stop_at ? "nowhere" : account_name(to);
+        if (i % 13 == 5) {
+            txs.push_back(quids::test::makeSignedTransfer(account_name(from), recipient, 1, nonces[from], 1));
+        } else if (i % 17 == 7) {
+            txs.push_back(quids::test::makeSignedTransfer(account_name(from), recipient, 1'000'000, nonces[from] + 1, 1));
+        } else if (i % 19 == 11) {
+            txs.push_back(quids::test::makeSignedTransfer(account_name(from), recipient, 1, nonces[from] + 1, 1, true));
+        } else {
+            txs.push_back(quids::test::makeSignedTransfer(account_name(from), recipient, 10 + i, ++nonces[from], 1));
+        }
+    }
+    return txs;
+}
+
+// The reference: one transaction per call, stopping where a call fails
+bool apply_one_by_one(StateManager& state, const std::vector<blockchain::TransactionPtr>& txs) {
+    for (size_t i = 0; i < txs.size(); ++i) {
+        if (!state.apply_transactions(std::span(txs).subspan(i, 1))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void expect_same_state(const StateManager& grouped, const StateManager& serial) {
+    for (size_t i = 0; i < ACCOUNTS; ++i) {
+        SCOPED_TRACE(account_name(i));
+        EXPECT_EQ(grouped.get_balance(account_name(i)), serial.get_balance(account_name(i)));
+        EXPECT_EQ(grouped.get_nonce(account_name(i)), serial.get_nonce(account_name(i)));
+    }
+    EXPECT_EQ(grouped.get_state_root(), serial.get_state_root());
+}
+
+} // namespace
+
+TEST(StateManagerTest, GroupedBatchMatchesTheSerialLoop) {
+    const auto txs = batch(200);
+    auto grouped = make_state();
+    auto serial = make_state();
+
+    EXPECT_TRUE(grouped->apply_transactions(txs));
+    EXPECT_TRUE(apply_one_by_one(*serial, txs));
+    expect_same_state(*grouped, *serial);
+    EXPECT_NE(grouped->get_state_root(), make_state()->get_state_root());
+}
+
+TEST(StateManagerTest, GroupedBatchStopsWhereTheSerialLoopDoes) {
+    // Other groups have transfers after the failing one; those must not land
+    const auto txs = batch(200, 121);
+    auto grouped = make_state();
+    auto serial = make_state();
+
+    EXPECT_FALSE(grouped->apply_transactions(txs));
+    EXPECT_FALSE(apply_one_by_one(*serial, txs));
+    expect_same_state(*grouped, *serial);
+
+    // And the prefix before the cutoff is exactly what landed
+    auto prefix = make_state();
+    EXPECT_TRUE(prefix->apply_transactions(std::span(txs).first(121)));
+    expect_same_state(*grouped, *prefix);
+}
+
+TEST(StateManagerTest, SkipsInvalidTransactionsWithoutFailingTheBatch) {
+    auto state = make_state();
+    const std::vector<blockchain::TransactionPtr> txs{
+        quids::test::makeSignedTransfer(account_name(0), account_name(1), 100, 1, 1),
+        quids::test::makeSignedTransfer(account_name(0), account_name(1), 100, 1, 1),        // replayed nonce
+        quids::test::makeSignedTransfer(account_name(2), account_name(3), 100, 1, 1, true),  // forged
+    };
+    EXPECT_TRUE(state->apply_transactions(txs));
+    EXPECT_EQ(state->get_balance(account_name(0)), 99'899u);
+    EXPECT_EQ(state->get_balance(account_name(1)), 100'100u);
+    EXPECT_EQ(state->get_nonce(account_name(0)), 1u);
+    EXPECT_EQ(state->get_balance(account_name(2)), 100'000u);
+    EXPECT_EQ(state->get_nonce(account_name(2)), 0u);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
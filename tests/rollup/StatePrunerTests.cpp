@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "rollup/StatePruner.hpp"
+#include "TestStorage.hpp"
+#include <chrono>
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+storage::PersistentStorage::HistoryRef history(const std::string& address, uint64_t block) {
+    storage::PersistentStorage::HistoryRef ref;
+    ref.address = address;
+    ref.block_number = block;
+    ref.tx_hash.fill(static_cast<uint8_t>(block));
+    return ref;
+}
+
+} // namespace
+
+class StatePrunerTest : public quids::test::TempStorageTest {
+protected:
+    StatePrunerTest() : TempStorageTest("pruner_") {}
+
+    void SetUp() override {
+        TempStorageTest::SetUp();
+        for (uint64_t block = 0; block < 100; ++block) {
+            ASSERT_TRUE(storage_->storeBlockData(block, {static_cast<uint8_t>(block)}));
+            ASSERT_TRUE(storage_->storeAccountHistory(
+                {history("alice", block), history("bob", block), history("carol" + std::to_string(block % 7), block)},
+                false));
+        }
+    }
+
+    size_t history_size(const std::string& address) {
+        storage::PersistentStorage::HistoryQuery query;
+        query.limit = 1000;
+        return storage_->loadAccountHistory(address, query).size();
+    }
+
+    static StatePruner::Config config(StatePruner::Mode mode) {
+        StatePruner::Config c;
+        c.mode = mode;
+        c.depth = 30;
+        c.blocks_per_step = 16;
+        c.addresses_per_step = 2;
+        c.step_interval = std::chrono::milliseconds(1);
+        return c;
+    }
+};
+
+TEST_F(StatePrunerTest, FullModeKeepsOnlyTheWindow) {
+    StatePruner pruner(storage_, nullptr, config(StatePruner::Mode::Full));
+    pruner.on_head(99);
+    pruner.drain();
+
+    for (uint64_t block = 0; block < 70; ++block) {
+        EXPECT_FALSE(storage_->loadBlockData(block).has_value()) << block;
+    }
+    for (uint64_t block = 70; block < 100; ++block) {
+        EXPECT_TRUE(storage_->loadBlockData(block).has_value()) << block;
+    }
+    EXPECT_EQ(history_size("alice"), 30u);
+    EXPECT_EQ(history_size("bob"), 30u);
+
+    const auto stats = pruner.stats();
+    EXPECT_EQ(stats.pruned_below, 70u);
+    EXPECT_EQ(stats.pruned_blocks, 70u);
+    EXPECT_EQ(stats.history_sweeps, 1u);
+    EXPECT_GT(stats.steps, 70u / 16);  // spread over many small steps
+}
+
+TEST_F(StatePrunerTest, LaterHeadsPruneIncrementally) {
+    StatePruner pruner(storage_, nullptr, config(StatePruner::Mode::Full));
+    pruner.on_head(50);
+    pruner.drain();
+    EXPECT_FALSE(storage_->loadBlockData(20).has_value());
+    EXPECT_TRUE(storage_->loadBlockData(21).has_value());
+
+    pruner.on_head(60);
+    pruner.drain();
+    EXPECT_FALSE(storage_->loadBlockData(30).has_value());
+    EXPECT_TRUE(storage_->loadBlockData(31).has_value());
+    EXPECT_EQ(history_size("alice"), 69u);
+    EXPECT_EQ(pruner.stats().history_sweeps, 2u);
+}
+
+TEST_F(StatePrunerTest, ArchiveModeKeepsEverything) {
+    StatePruner pruner(storage_, nullptr, config(StatePruner::Mode::Archive));
+    pruner.on_head(99);
+    pruner.drain();
+    EXPECT_TRUE(storage_->loadBlockData(0).has_value());
+    EXPECT_EQ(history_size("alice"), 100u);
+    EXPECT_EQ(pruner.stats().pruned_blocks, 0u);
+}
+
+TEST_F(StatePrunerTest, BoundsRetainedVersions) {
+    auto state = std::make_shared<StateManager>();
+    auto c = config(StatePruner::Mode::Archive);
+    c.retained_versions = 3;
+    StatePruner pruner(storage_, state, c);
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(state->commit_state());
+    }
+    const uint64_t head = state->version();
+    EXPECT_TRUE(state->at(head).has_value());
+    EXPECT_TRUE(state->at(head - 2).has_value());
+    EXPECT_FALSE(state->at(head - 3).has_value());
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
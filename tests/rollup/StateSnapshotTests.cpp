@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "rollup/StateManager.hpp"
+#include "utils/PersistentMap.hpp"
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateManager::Account make_account(const std::string& address, uint64_t balance) {
+    StateManager::Account account;
+    account.address = address;
+    account.balance = balance;
+    account.nonce = 0;
+    return account;
+}
+
+void populate(StateManager& state, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        std::string address = "account_" + std::to_string(i);
+        state.add_account(address, make_account(address, 1000 + i));
+    }
+}
+
+} // namespace
+
+TEST(PersistentMapTest, CopiesAreIsolated) {
+    utils::PersistentMap<std::string, int> a;
+    for (int i = 0; i < 1000; ++i) a.set("k" + std::to_string(i), i);
+
+    auto b = a;
+    for (int i = 0; i < 1000; i += 3) b.set("k" + std::to_string(i), -i);
+    EXPECT_TRUE(b.erase("k1"));
+    *b.find_mutable("k2") = 42;
+
+    EXPECT_EQ(a.size(), 1000u);
+    EXPECT_EQ(b.size(), 999u);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_NE(a.find("k" + std::to_string(i)), nullptr);
+        EXPECT_EQ(*a.find("k" + std::to_string(i)), i);
+    }
+    EXPECT_EQ(b.find("k1"), nullptr);
+    EXPECT_EQ(*b.find("k2"), 42);
+    EXPECT_EQ(*b.find("k3"), -3);
+}
+
+TEST(StateSnapshotTest, SnapshotIsUnaffectedByLaterWrites) {
+    StateManager state;
+    populate(state, 500);
+
+    auto snapshot = state.snapshot();
+    auto root_before = state.get_state_root();
+
+    state.set_balance("account_7", 1);
+    state.add_account("fresh", make_account("fresh", 5));
+
+    EXPECT_EQ(snapshot.get_balance("account_7"), 1007u);
+    EXPECT_FALSE(snapshot.get_account("fresh").has_value());
+    EXPECT_EQ(snapshot.account_count(), 500u);
+    EXPECT_EQ(snapshot.get_state_root(), root_before);
+    EXPECT_NE(state.get_state_root(), root_before);
+    EXPECT_EQ(state.get_balance("account_7"), 1u);
+}
+
+TEST(StateSnapshotTest, CommittedVersionsAndRollback) {
+    StateManager state;
+    populate(state, 100);
+    state.commit_state();
+    const uint64_t v1 = state.version();
+    auto root_v1 = state.get_state_root();
+
+    state.set_balance("account_3", 0);
+    state.commit_state();
+    const uint64_t v2 = state.version();
+
+    state.set_balance("account_3", 99);
+    ASSERT_TRUE(state.rollback_state());
+    EXPECT_EQ(state.get_balance("account_3"), 0u);
+
+    auto old = state.at(v1);
+    ASSERT_TRUE(old.has_value());
+    EXPECT_EQ(old->get_balance("account_3"), 1003u);
+    EXPECT_EQ(old->get_state_root(), root_v1);
+    ASSERT_TRUE(state.at(v2).has_value());
+    EXPECT_FALSE(state.at(v2 + 1).has_value());
+}
+
+TEST(StateSnapshotTest, CloneSharesStateButNotWrites) {
+    StateManager state;
+    populate(state, 200);
+
+    auto copy = state.clone();
+    EXPECT_EQ(copy->get_state_root(), state.get_state_root());
+
+    copy->set_balance("account_1", 0);
+    EXPECT_EQ(state.get_balance("account_1"), 1001u);
+    EXPECT_NE(copy->get_state_root(), state.get_state_root());
+}
+
+TEST(StateSnapshotTest, RootAfterDiffMatchesApplyingIt) {
+    StateManager state;
+    populate(state, 200);
+    const auto root_before = state.get_state_root();
+
+    auto changed = make_account("account_5", 7);
+    auto fresh = make_account("fresh", 9);
+    const auto root = state.root_after({{"account_5", StateManager::account_hash(changed)},
+                                        {"fresh", StateManager::account_hash(fresh)}});
+    EXPECT_EQ(state.get_state_root(), root_before);
+
+    state.add_account("account_5", changed);
+    state.add_account("fresh", fresh);
+    const auto applied = state.get_state_root();
+    EXPECT_TRUE(std::equal(root.begin(), root.end(), applied.begin(), applied.end()));
+}
+
+TEST(StateSnapshotTest, ReadersRunAlongsideWriter) {
+    StateManager state;
+    populate(state, 300);
+    auto snapshot = state.snapshot();
+    auto expected_root = snapshot.get_state_root();
+
+    std::thread writer([&state] {
+        for (int round = 0; round < 20; ++round) {
+            for (size_t i = 0; i < 300; i += 7) {
+                state.set_balance("account_" + std::to_string(i), round);
+            }
+            state.get_state_root();
+        }
+    });
+
+    uint64_t total = 0;
+    for (int pass = 0; pass < 20; ++pass) {
+        total = 0;
+        snapshot.for_each_account([&total](const std::string&, const StateManager::Account& account) {
+            total += account.balance;
+        });
+    }
+    writer.join();
+
+    // 1000 * 300 + (0 + ... + 299)
+    EXPECT_EQ(total, 300000u + 44850u);
+    EXPECT_EQ(snapshot.get_state_root(), expected_root);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include "rollup/StateStore.hpp"
+#include "TestStorage.hpp"
+#include <map>
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateManager::Account account(const std::string& address, uint64_t balance) {
+    StateManager::Account a;
+    a.address = address;
+    a.balance = balance;
+    a.nonce = 0;
+    return a;
+}
+
+std::string address(int i) {
+    return "acct" + std::to_string(i);
+}
+
+StateStore::Config inline_writes(size_t cache_capacity = 1 << 16) {
+    StateStore::Config config;
+    config.async_flush = false;
+    config.sync_writes = false;
+    config.cache_capacity = cache_capacity;
+    return config;
+}
+
+} // namespace
+
+class StateStoreTest : public quids::test::TempStorageTest {
+protected:
+    StateStoreTest() : TempStorageTest("state_store_") {}
+
+    // 100 accounts committed over two versions and flushed
+    std::vector<uint8_t> populate() {
+        auto store = std::make_shared<StateStore>(storage_, inline_writes());
+        StateManager state(store);
+        for (int i = 0; i < 100; ++i) {
+            state.add_account(address(i), account(address(i), 1000 + i));
+        }
+        state.commit_state();
+        state.set_balance(address(0), 1);
+        state.commit_state();
+        EXPECT_TRUE(store->flush());
+        return state.get_state_root();
+    }
+};
+
+TEST_F(StateStoreTest, EvictsPastCapacityAndRereadsFromDisk) {
+    StateStore store(storage_, inline_writes(4));
+    std::vector<StateStore::Change> changes;
+    for (int i = 0; i < 10; ++i) {
+        changes.emplace_back(address(i), account(address(i), i));
+    }
+    store.commit(1, {1}, std::move(changes));
+    ASSERT_TRUE(store.flush());
+    EXPECT_EQ(store.stats().evictions, 6u);
+
+    // The four most recent stay cached; the rest come back from disk
+    for (int i = 0; i < 10; ++i) {
+        const auto value = store.get(address(i));
+        ASSERT_TRUE(value) << i;
+        EXPECT_EQ(value->balance, static_cast<uint64_t>(i));
+    }
+    const auto stats = store.stats();
+    EXPECT_EQ(stats.cache_hits + stats.cache_misses, 10u);
+    EXPECT_GE(stats.cache_misses, 6u);
+    EXPECT_FALSE(store.get("missing"));
+}
+
+TEST_F(StateStoreTest, WriteBehindFlushMakesCommitsDurable) {
+    StateStore::Config config;
+    config.sync_writes = false;
+    {
+        StateStore store(storage_, config);
+        for (uint64_t version = 1; version <= 20; ++version) {
+            store.commit(version, {static_cast<uint8_t>(version)},
+                         {{"hot", account("hot", version)}, {address(static_cast<int>(version)), account("x", 1)}});
+            // Queued commits are visible before they reach disk
+            EXPECT_EQ(store.get("hot")->balance, version);
+        }
+        EXPECT_EQ(store.committed_version(), 20u);
+        ASSERT_TRUE(store.flush());
+        EXPECT_EQ(store.durable_version(), 20u);
+        // Each batch writes an account once however often it changed
+        const auto stats = store.stats();
+        EXPECT_LE(stats.flushed_accounts, 40u);
+        EXPECT_GE(stats.flushed_batches, 1u);
+    }
+
+    StateStore reopened(storage_, config);
+    EXPECT_EQ(reopened.durable_version(), 20u);
+    const auto head = reopened.load_head();
+    ASSERT_TRUE(head);
+    EXPECT_EQ(head->state_root, std::vector<uint8_t>{20});
+    EXPECT_EQ(reopened.get("hot")->balance, 20u);
+    size_t accounts = 0;
+    reopened.for_each_account([&](const std::string&, StateManager::Account) { ++accounts; });
+    EXPECT_EQ(accounts, 21u);
+}
+
+TEST_F(StateStoreTest, ReloadReadsAccountsOnDemand) {
+    const auto root = populate();
+
+    auto store = std::make_shared<StateStore>(storage_, inline_writes());
+    StateManager state(store);
+    EXPECT_EQ(state.version(), 2u);
+    EXPECT_EQ(state.get_state_root(), root);
+    // Opening only hashed the accounts; none went through the cache
+    EXPECT_EQ(store->stats().cache_misses, 0u);
+
+    EXPECT_EQ(state.get_balance(address(7)), 1007u);
+    EXPECT_EQ(state.get_balance(address(7)), 1007u);
+    EXPECT_EQ(state.get_balance(address(0)), 1u);
+    EXPECT_EQ(state.get_balance("missing"), 0u);
+    // Once read, an account stays resident
+    EXPECT_EQ(store->stats().cache_misses, 2u);
+
+    const auto before = state.snapshot();
+    EXPECT_EQ(before.account_count(), 100u);
+    ASSERT_TRUE(state.set_balance(address(8), 5));
+    state.add_account(address(9), account(address(9), 6));
+    state.add_account("new", account("new", 7));
+    state.commit_state();
+    ASSERT_TRUE(store->flush());
+
+    // The snapshot keeps what it saw although the store moved on
+    EXPECT_EQ(store->get(address(8))->balance, 5u);
+    EXPECT_EQ(before.get_balance(address(8)), 1008u);
+    EXPECT_EQ(before.get_balance(address(9)), 1009u);
+    EXPECT_FALSE(before.get_account("new"));
+    std::map<std::string, uint64_t> seen;
+    before.for_each_account([&](const std::string& key, const StateManager::Account& a) { seen[key] = a.balance; });
+    EXPECT_EQ(seen.size(), 100u);
+    EXPECT_EQ(seen[address(8)], 1008u);
+    EXPECT_EQ(seen[address(9)], 1009u);
+    EXPECT_EQ(seen[address(50)], 1050u);
+
+    const auto after = state.snapshot();
+    EXPECT_EQ(after.account_count(), 101u);
+    EXPECT_EQ(after.get_balance(address(8)), 5u);
+    EXPECT_EQ(state.get_accounts_snapshot().size(), 101u);
+
+    // A second restart sees the committed writes
+    StateManager restarted(std::make_shared<StateStore>(storage_, inline_writes()));
+    EXPECT_EQ(restarted.get_state_root(), state.get_state_root());
+    EXPECT_EQ(restarted.get_balance(address(9)), 6u);
+    EXPECT_EQ(restarted.get_balance("new"), 7u);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "rollup/StateTrie.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateTrie::Hash value_of(uint64_t v) {
+    return StateTrie::hash_bytes(reinterpret_cast<const uint8_t*>(&v), sizeof(v));
+}
+
+} // namespace
+
+TEST(StateTrieTest, EmptyRootIsZero) {
+    StateTrie trie;
+    EXPECT_EQ(trie.root(), StateTrie::Hash{});
+    EXPECT_EQ(trie.size(), 0u);
+}
+
+TEST(StateTrieTest, RootIndependentOfInsertionOrder) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 2000; ++i) {
+        keys.push_back("account_" + std::to_string(i));
+    }
+
+    StateTrie a;
+    for (size_t i = 0; i < keys.size(); ++i) a.update(keys[i], value_of(i));
+
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    StateTrie b;
+    for (size_t i : order) b.update(keys[i], value_of(i));
+
+    EXPECT_EQ(a.size(), keys.size());
+    EXPECT_EQ(a.root(), b.root());
+}
+
+TEST(StateTrieTest, IncrementalMatchesFromScratch) {
+    StateTrie incremental;
+    for (int i = 0; i < 500; ++i) incremental.update("k" + std::to_string(i), value_of(i));
+    incremental.root();
+
+    // Touch a handful of keys after the first root
+    for (int i = 0; i < 500; i += 37) incremental.update("k" + std::to_string(i), value_of(i + 1000));
+
+    StateTrie scratch;
+    for (int i = 0; i < 500; ++i) {
+        scratch.update("k" + std::to_string(i), value_of(i % 37 == 0 ? i + 1000 : i));
+    }
+
+    EXPECT_EQ(incremental.root(), scratch.root());
+}
+
+TEST(StateTrieTest, EraseRestoresPreviousRoot) {
+    StateTrie trie;
+    for (int i = 0; i < 100; ++i) trie.update("k" + std::to_string(i), value_of(i));
+    auto before = trie.root();
+
+    trie.update("extra", value_of(7));
+    EXPECT_NE(trie.root(), before);
+
+    EXPECT_TRUE(trie.erase("extra"));
+    EXPECT_FALSE(trie.erase("extra"));
+    EXPECT_EQ(trie.root(), before);
+}
+
+TEST(StateTrieTest, MembershipProofs) {
+    StateTrie trie;
+    for (int i = 0; i < 300; ++i) trie.update("k" + std::to_string(i), value_of(i));
+    auto root = trie.root();
+
+    for (int i = 0; i < 300; i += 17) {
+        auto proof = trie.prove("k" + std::to_string(i));
+        ASSERT_TRUE(proof.has_value());
+        EXPECT_TRUE(StateTrie::verify(root, "k" + std::to_string(i), value_of(i), *proof));
+        EXPECT_FALSE(StateTrie::verify(root, "k" + std::to_string(i), value_of(i + 1), *proof));
+    }
+
+    EXPECT_FALSE(trie.prove("missing").has_value());
+}
+
+TEST(StateTrieTest, MultiProofsShareBranches) {
+    StateTrie trie;
+    for (int i = 0; i < 2000; ++i) trie.update("k" + std::to_string(i), value_of(i));
+    auto root = trie.root();
+
+    std::vector<std::string> keys;
+    std::vector<std::pair<std::string, StateTrie::Hash>> leaves;
+    size_t single_steps = 0;
+    for (int i = 0; i < 2000; i += 7) {
+        keys.push_back("k" + std::to_string(i));
+        leaves.emplace_back(keys.back(), value_of(i));
+        single_steps += trie.prove(keys.back())->steps.size();
+    }
+    auto proof = trie.prove_many(keys);
+    ASSERT_TRUE(proof.has_value());
+    EXPECT_TRUE(StateTrie::verify_many(root, leaves, *proof));
+    // The root branch alone is repeated in every single proof
+    EXPECT_LT(proof->branches.size(), single_steps / 2);
+
+    // Order of the leaves does not matter, their values do
+    std::reverse(leaves.begin(), leaves.end());
+    EXPECT_TRUE(StateTrie::verify_many(root, leaves, *proof));
+    leaves[3].second = value_of(99999);
+    EXPECT_FALSE(StateTrie::verify_many(root, leaves, *proof));
+    leaves[3].second = value_of(std::stoi(leaves[3].first.substr(1)));
+
+    // Leaving out or adding a key breaks the walk
+    auto fewer = leaves;
+    fewer.pop_back();
+    EXPECT_FALSE(StateTrie::verify_many(root, fewer, *proof));
+    auto more = leaves;
+    more.emplace_back("k1", value_of(1));
+    EXPECT_FALSE(StateTrie::verify_many(root, more, *proof));
+
+    auto tampered = *proof;
+    tampered.hashes.front()[0] ^= 1;
+    EXPECT_FALSE(StateTrie::verify_many(root, leaves, tampered));
+
+    keys.push_back("missing");
+    EXPECT_FALSE(trie.prove_many(keys).has_value());
+    EXPECT_FALSE(trie.prove_many({}).has_value());
+}
+
+TEST(StateTrieTest, MultiProofOfALoneLeaf) {
+    StateTrie trie;
+    trie.update("only", value_of(1));
+    auto proof = trie.prove_many({"only"});
+    ASSERT_TRUE(proof.has_value());
+    EXPECT_TRUE(proof->branches.empty());
+    EXPECT_TRUE(StateTrie::verify_many(trie.root(), {{"only", value_of(1)}}, *proof));
+    EXPECT_FALSE(StateTrie::verify_many(trie.root(), {{"only", value_of(2)}}, *proof));
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include "rollup/StateManager.hpp"
+#include "rollup/StateTrie.hpp"
+#include "rollup/StateWitness.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateTrie::Hash value_of(uint64_t v) {
+    return StateTrie::hash_bytes(reinterpret_cast<const uint8_t*>(&v), sizeof(v));
+}
+
+StateManager::Account make_account(const std::string& address, uint64_t balance) {
+    StateManager::Account account;
+    account.address = address;
+    account.balance = balance;
+    account.nonce = 0;
+    return account;
+}
+
+std::unique_ptr<StateManager> populated(size_t count) {
+    auto state = std::make_unique<StateManager>();
+    for (size_t i = 0; i < count; ++i) {
+        std::string address = "account_" + std::to_string(i);
+        state->add_account(address, make_account(address, 1000 + i));
+    }
+    return state;
+}
+
+// Reads two accounts, moves balance between them, probes a missing one
+// and creates another
+void run(StateManager& state) {
+    const uint64_t a = state.get_balance("account_3");
+    const uint64_t b = state.get_balance("account_17");
+    state.set_balance("account_3", a - 10);
+    state.set_balance("account_17", b + 10);
+    EXPECT_FALSE(state.get_account("nobody").has_value());
+    state.add_account("newcomer", make_account("newcomer", 5));
+}
+
+} // namespace
+
+TEST(StateWitnessTest, AbsenceProofsVerify) {
+    StateTrie trie;
+    EXPECT_TRUE(StateTrie::verify_absent(trie.root(), "k", *trie.prove_absent("k")));
+
+    trie.update("only", value_of(1));
+    auto single = trie.prove_absent("k");
+    ASSERT_TRUE(single.has_value());
+    EXPECT_TRUE(single->leaf_path.has_value());
+    EXPECT_TRUE(StateTrie::verify_absent(trie.root(), "k", *single));
+
+    for (int i = 0; i < 300; ++i) trie.update("k" + std::to_string(i), value_of(i));
+    const auto root = trie.root();
+    EXPECT_FALSE(trie.prove_absent("k7").has_value());
+    for (int i = 0; i < 100; ++i) {
+        const std::string key = "missing_" + std::to_string(i);
+        auto proof = trie.prove_absent(key);
+        ASSERT_TRUE(proof.has_value());
+        EXPECT_TRUE(StateTrie::verify_absent(root, key, *proof));
+        // The same proof does not show a present key missing
+        EXPECT_FALSE(StateTrie::verify_absent(root, "k7", *proof));
+    }
+}
+
+TEST(StateWitnessTest, GraftedTrieUpdatesLikeTheFullOne) {
+    StateTrie full;
+    for (int i = 0; i < 500; ++i) full.update("k" + std::to_string(i), value_of(i));
+
+    StateTrie partial;
+    ASSERT_TRUE(partial.graft("k1", value_of(1), *full.prove("k1")));
+    ASSERT_TRUE(partial.graft("k2", value_of(2), *full.prove("k2")));
+    ASSERT_TRUE(partial.graft_absent("new", *full.prove_absent("new")));
+    EXPECT_EQ(partial.root(), full.root());
+
+    for (auto* trie : {&full, &partial}) {
+        trie->update("k1", value_of(100));
+        trie->update("new", value_of(7));
+    }
+    EXPECT_EQ(partial.root(), full.root());
+    EXPECT_THROW(partial.update("k3", value_of(3)), std::out_of_range);
+    EXPECT_EQ(partial.root(), full.root());
+
+    // Erasing may need to know whether the leaf's last sibling is a leaf
+    try {
+        EXPECT_TRUE(partial.erase("k2"));
+        full.erase("k2");
+    } catch (const std::out_of_range&) {
+        // Left as it was
+    }
+    EXPECT_EQ(partial.root(), full.root());
+}
+
+TEST(StateWitnessTest, ReplayMatchesTheFullState) {
+    auto full = populated(200);
+    const auto pre_root = full->get_state_root();
+
+    full->begin_witness();
+    run(*full);
+    const StateWitness witness = full->take_witness();
+    EXPECT_EQ(std::vector<uint8_t>(witness.pre_root.begin(), witness.pre_root.end()), pre_root);
+    ASSERT_EQ(witness.entries.size(), 4u);
+
+    auto replay = StateManager::from_witness(witness);
+    ASSERT_NE(replay, nullptr);
+    EXPECT_EQ(replay->get_state_root(), pre_root);
+    run(*replay);
+    EXPECT_EQ(replay->get_state_root(), full->get_state_root());
+
+    // Clones replay too; anything the run did not touch is out of reach
+    auto copy = replay->clone();
+    EXPECT_EQ(copy->get_balance("account_3"), 1000 + 3 - 10);
+    EXPECT_THROW(copy->get_balance("account_4"), std::out_of_range);
+}
+
+TEST(StateWitnessTest, SerializedWitnessRoundTrips) {
+    auto full = populated(1000);
+    full->begin_witness();
+    for (int i = 0; i < 64; ++i) {
+        full->get_balance("account_" + std::to_string(i * 13));
+    }
+    full->get_balance("missing");
+    const StateWitness witness = full->take_witness();
+
+    const auto bytes = witness.serialize();
+    auto decoded = StateWitness::deserialize(bytes);
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->serialize(), bytes);
+    auto replay = StateManager::from_witness(*decoded);
+    ASSERT_NE(replay, nullptr);
+    EXPECT_EQ(replay->get_balance("account_13"), 1013u);
+
+    // Shared hashes are stored once
+    size_t siblings = 0;
+    for (const auto& entry : witness.entries) {
+        for (const auto& step : entry.account ? entry.proof.steps : entry.absence.steps) {
+            siblings += step.siblings.size();
+        }
+    }
+    EXPECT_LT(bytes.size(), siblings * 32);
+
+    EXPECT_FALSE(StateWitness::deserialize(std::vector<uint8_t>(bytes.begin(), bytes.end() - 1)).has_value());
+}
+
+TEST(StateWitnessTest, TamperedWitnessIsRejected) {
+    auto full = populated(100);
+    full->begin_witness();
+    full->get_balance("account_5");
+    full->get_balance("absent");
+    StateWitness witness = full->take_witness();
+
+    StateWitness richer = witness;
+    for (auto& entry : richer.entries) {
+        if (entry.account) entry.account->balance += 1;
+    }
+    EXPECT_EQ(StateManager::from_witness(richer), nullptr);
+
+    // Claiming a present account is absent
+    StateWitness hidden = witness;
+    for (auto& entry : hidden.entries) {
+        if (entry.account) {
+            entry.account.reset();
+            StateTrie trie;
+            trie.update("unrelated", value_of(1));
+            entry.absence = *trie.prove_absent(entry.address);
+        }
+    }
+    EXPECT_EQ(StateManager::from_witness(hidden), nullptr);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
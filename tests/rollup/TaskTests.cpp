@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "utils/Task.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using utils::Task;
+using utils::TaskPriority;
+using utils::WorkStealingPool;
+
+namespace {
+
+Task<int> constant(int value) {
+    co_return value;
+}
+
+Task<int> sum_of(int n) {
+    int total = 0;
+    for (int i = 1; i <= n; ++i) {
+        total += co_await constant(i);
+    }
+    co_return total;
+}
+
+Task<void> fail() {
+    throw std::runtime_error("boom");
+    co_return;
+}
+
+} // namespace
+
+TEST(TaskTest, AwaitsChainWithoutThreads) {
+    EXPECT_EQ(utils::sync_wait(sum_of(1000)), 500500);
+}
+
+TEST(TaskTest, ExceptionsReachTheAwaiter) {
+    EXPECT_THROW(utils::sync_wait(fail()), std::runtime_error);
+
+    auto caught = []() -> Task<bool> {
+        try {
+            co_await fail();
+        } catch (const std::runtime_error&) {
+            co_return true;
+        }
+        co_return false;
+    };
+    EXPECT_TRUE(utils::sync_wait(caught()));
+}
+
+TEST(TaskTest, OffloadContinuesOnThePool) {
+    auto& pool = WorkStealingPool::global();
+    auto on_pool = [&pool]() -> Task<bool> {
+        const int value = co_await utils::offload(TaskPriority::Execution, [] { return 7; });
+        co_return value == 7 && pool.in_worker();
+    };
+    EXPECT_TRUE(utils::sync_wait(on_pool()));
+    EXPECT_FALSE(pool.in_worker());
+}
+
+TEST(TaskTest, CallbacksCompleteFromAnyThread) {
+    auto immediate = []() -> Task<int> {
+        co_return co_await utils::from_callback<int>([](auto resume) { resume(1); });
+    };
+    EXPECT_EQ(utils::sync_wait(immediate()), 1);
+
+    auto later = []() -> Task<int> {
+        co_return co_await utils::from_callback<int>([](auto resume) {
+            std::thread([resume] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                resume(2);
+            }).detach();
+        });
+    };
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(utils::sync_wait(later()), 2);
+    }
+}
+
+TEST(TaskTest, SpawnedTasksRunToCompletion) {
+    std::atomic<int> done{0};
+    auto bump = [](std::atomic<int>& counter) -> Task<void> {
+        co_await utils::offload(TaskPriority::ML, [] {});
+        counter.fetch_add(1);
+    };
+    for (int i = 0; i < 64; ++i) {
+        utils::spawn(bump(done));
+    }
+    for (int i = 0; i < 1000 && done.load() != 64; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(done.load(), 64);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "utils/Tracing.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+using utils::Span;
+using utils::SpanRecord;
+using utils::Tracer;
+
+class TracingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        previous_rate_ = Tracer::global().sample_rate();
+        Tracer::global().set_sample_rate(1.0);
+        Tracer::global().clear();
+    }
+
+    void TearDown() override {
+        Tracer::global().clear();
+        Tracer::global().set_sample_rate(previous_rate_);
+    }
+
+    static size_t count(const std::vector<SpanRecord>& spans, const std::string& name) {
+        size_t n = 0;
+        for (const auto& span : spans) {
+            n += name == span.name;
+        }
+        return n;
+    }
+
+    double previous_rate_{0.0};
+};
+
+TEST_F(TracingTest, IdsAreStableAndKindsDisjoint) {
+    const auto id = utils::transaction_trace_id("alice", 7);
+    EXPECT_EQ(id, utils::transaction_trace_id("alice", 7));
+    EXPECT_NE(id, utils::transaction_trace_id("alice", 8));
+    EXPECT_EQ(id & utils::AGGREGATE_TRACE, 0u);
+    EXPECT_NE(utils::aggregate_trace_id("block", 7), utils::aggregate_trace_id("l1", 7));
+    EXPECT_NE(utils::aggregate_trace_id("block", 7) & utils::AGGREGATE_TRACE, 0u);
+}
+
+TEST_F(TracingTest, SamplingIsDecidedById) {
+    auto& tracer = Tracer::global();
+    tracer.set_sample_rate(0.25);
+    size_t sampled = 0;
+    for (uint64_t nonce = 0; nonce < 10000; ++nonce) {
+        const auto id = utils::transaction_trace_id("sender", nonce);
+        EXPECT_EQ(tracer.sampled(id), tracer.sampled(id));
+        sampled += tracer.sampled(id);
+    }
+    EXPECT_NEAR(static_cast<double>(sampled), 2500.0, 250.0);
+    EXPECT_TRUE(tracer.sampled(utils::aggregate_trace_id("block", 1)));
+
+    tracer.set_sample_rate(0.0);
+    EXPECT_FALSE(tracer.sampled(utils::aggregate_trace_id("block", 1)));
+    {
+        Span span("off", utils::transaction_trace_id("sender", 1));
+        EXPECT_FALSE(span.active());
+    }
+    EXPECT_TRUE(tracer.collect().empty());
+}
+
+TEST_F(TracingTest, CollectFollowsLinksIntoAggregates) {
+    auto& tracer = Tracer::global();
+    const auto tx = utils::transaction_trace_id("alice", 1);
+    const auto other = utils::transaction_trace_id("bob", 1);
+    const auto block = utils::aggregate_trace_id("block", 3);
+    const auto frame = utils::aggregate_trace_id("l1", 3);
+    { Span span("rpc.submit", tx); }
+    tracer.link("block.assign", tx, block);
+    { Span span("rpc.submit", other); }
+    { Span span("block.execute", block); }
+    tracer.link("l1.frame", block, frame);
+    { Span span("l1.submit", frame); }
+
+    const auto spans = tracer.collect(tx);
+    EXPECT_EQ(spans.size(), 5u);
+    EXPECT_EQ(count(spans, "rpc.submit"), 1u);
+    EXPECT_EQ(count(spans, "l1.submit"), 1u);
+    for (size_t i = 1; i < spans.size(); ++i) {
+        EXPECT_LE(spans[i - 1].start_ns, spans[i].start_ns);
+    }
+
+    const std::string json = Tracer::to_chrome_json(spans);
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(json.back(), '}');
+    EXPECT_NE(json.find("\"name\":\"block.execute\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+}
+
+TEST_F(TracingTest, RingKeepsNewestSpans) {
+    const auto tx = utils::transaction_trace_id("alice", 2);
+    std::thread writer([&] {
+        for (size_t i = 0; i < Tracer::RING_CAPACITY + 100; ++i) {
+            Span span("execute", tx);
+        }
+    });
+    writer.join();
+    EXPECT_EQ(Tracer::global().collect(tx).size(), Tracer::RING_CAPACITY);
+
+    Tracer::global().clear();
+    EXPECT_TRUE(Tracer::global().collect(tx).empty());
+}
+
+TEST_F(TracingTest, ConcurrentWritersAndReader) {
+    std::atomic<bool> done{false};
+    std::atomic<int> finished{0};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([t, &finished] {
+            for (uint64_t i = 0; i < 20000; ++i) {
+                Span span("execute", utils::transaction_trace_id("w" + std::to_string(t), i));
+            }
+            // Hold the ring until every writer is done, so none is reused
+            finished++;
+            while (finished.load() < 4) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    std::thread reader([&] {
+        while (!done.load()) {
+            for (const auto& span : Tracer::global().collect()) {
+                // Slots being rewritten are skipped, never returned half-written
+                ASSERT_STREQ(span.name, "execute");
+            }
+        }
+    });
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+    EXPECT_EQ(count(Tracer::global().collect(), "execute"), 4 * Tracer::RING_CAPACITY);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "rollup/TransactionSimulator.hpp"
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+StateManager::Account account(const std::string& address, uint64_t balance) {
+    StateManager::Account a;
+    a.address = address;
+    a.balance = balance;
+    a.nonce = 0;
+    return a;
+}
+
+::evm::Address address_of(const std::string& hex) {
+    return *::evm::Address::from_hex(hex);
+}
+
+// SSTORE 1 into slot 0, then STOP
+std::vector<uint8_t> store_code() {
+    return {0x60, 0x01, 0x60, 0x00, 0x55, 0x00};
+}
+
+// CALLs callee with all the gas it has and reverts unless the call succeeds
+std::vector<uint8_t> forward_code(const ::evm::Address& callee) {
+    std::vector<uint8_t> code = {0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x73};
+    code.insert(code.end(), callee.bytes.begin(), callee.bytes.end());
+    const std::vector<uint8_t> tail = {0x5a, 0xf1, 0x60, 0x29, 0x57, 0x60, 0x00, 0x60, 0x00, 0xfd, 0x5b, 0x00};
+    code.insert(code.end(), tail.begin(), tail.end());
+    return code;
+}
+
+} // namespace
+
+class TransactionSimulatorTest : public ::testing::Test {
+protected:
+    static constexpr const char* SENDER = "00000000000000000000000000000000000000a1";
+    static constexpr const char* STORE = "00000000000000000000000000000000000000c1";
+    static constexpr const char* FORWARD = "00000000000000000000000000000000000000c2";
+
+    void SetUp() override {
+        state_ = std::make_shared<StateManager>();
+        state_->add_account(SENDER, account(SENDER, 1'000'000));
+        state_->add_account("bob", account("bob", 0));
+        state_->add_account(STORE, account(STORE, 0));
+        state_->add_account(FORWARD, account(FORWARD, 0));
+        ASSERT_TRUE(state_->set_code(address_of(STORE), store_code()));
+        ASSERT_TRUE(state_->set_code(address_of(FORWARD), forward_code(address_of(STORE))));
+    }
+
+    TransactionSimulator::Call call_to(const std::string& to, uint64_t value = 0) {
+        TransactionSimulator::Call call;
+        call.from = SENDER;
+        call.to = to;
+        call.value = value;
+        return call;
+    }
+
+    std::shared_ptr<StateManager> state_;
+};
+
+TEST_F(TransactionSimulatorTest, TransferCostsTheIntrinsicGasAndLeavesStateAlone) {
+    TransactionSimulator simulator(state_, TransactionSimulator::Config{});
+    const auto result = simulator.simulate(call_to("bob", 500));
+    ASSERT_TRUE(result->success());
+    EXPECT_EQ(result->gas_used, TransactionSimulator::TX_GAS);
+    EXPECT_EQ(state_->get_balance("bob"), 0u);
+    EXPECT_EQ(state_->get_balance(SENDER), 1'000'000u);
+
+    const auto estimate = simulator.estimate_gas(call_to("bob", 500));
+    EXPECT_EQ(estimate->gas, TransactionSimulator::TX_GAS);
+
+    const auto broke = simulator.simulate(call_to("bob", 2'000'000));
+    EXPECT_FALSE(broke->success());
+    EXPECT_FALSE(broke->error.empty());
+}
+
+TEST_F(TransactionSimulatorTest, EstimateIsTheLeastLimitThatSucceeds) {
+    TransactionSimulator simulator(state_, TransactionSimulator::Config{});
+    const auto snapshot = state_->snapshot();
+
+    for (const char* contract : {STORE, FORWARD}) {
+        const auto call = call_to(contract);
+        const auto estimate = simulator.estimate(snapshot, call);
+        ASSERT_GT(estimate.gas, 0u) << contract;
+        EXPECT_TRUE(simulator.run(snapshot, call, estimate.gas).success()) << contract;
+        EXPECT_FALSE(simulator.run(snapshot, call, estimate.gas - 1).success()) << contract;
+    }
+
+    // A callee given all but 1/64 of what is left needs the caller to hold
+    // back more than the capped run ends up using
+    const auto forward = call_to(FORWARD);
+    const auto capped = simulator.run(snapshot, forward, TransactionSimulator::Config{}.max_gas);
+    EXPECT_GT(simulator.estimate(snapshot, forward).gas, capped.gas_used);
+    EXPECT_TRUE(snapshot.get_account(STORE)->storage.empty());
+}
+
+TEST_F(TransactionSimulatorTest, ResultsAreCachedPerStateRoot) {
+    TransactionSimulator simulator(state_, TransactionSimulator::Config{});
+    const auto call = call_to(STORE);
+
+    const auto first = simulator.estimate_gas(call);
+    const auto second = simulator.estimate_gas(call);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(simulator.stats().hits, 1u);
+
+    const uint64_t runs = simulator.stats().runs;
+    ASSERT_TRUE(state_->set_balance("bob", 7));
+    const auto third = simulator.estimate_gas(call);
+    EXPECT_NE(first, third);
+    EXPECT_EQ(third->gas, first->gas);
+    EXPECT_GT(simulator.stats().runs, runs);
+    EXPECT_EQ(simulator.stats().misses, 2u);
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "rollup/WithdrawalBatcher.hpp"
+#include <string>
+
+namespace quids {
+namespace rollup {
+namespace test {
+
+namespace {
+
+uint64_t queue_withdrawals(WithdrawalBatcher& batcher, size_t count) {
+    uint64_t first = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t id = batcher.enqueue("l2-" + std::to_string(i), "l1-" + std::to_string(i), 100 + i, i);
+        if (i == 0) first = id;
+    }
+    return first;
+}
+
+} // namespace
+
+TEST(WithdrawalBatcherTest, EveryWithdrawalClaimsAgainstItsBatchRoot) {
+    WithdrawalBatcher batcher(WithdrawalBatcher::Config{});
+    queue_withdrawals(batcher, 1000);
+
+    const auto batch = batcher.seal();
+    ASSERT_TRUE(batch.has_value());
+    EXPECT_EQ(batch->count, 1000u);
+    EXPECT_EQ(batcher.pending(), 0u);
+    EXPECT_FALSE(batcher.seal().has_value());
+
+    for (uint64_t id : {uint64_t{0}, uint64_t{517}, uint64_t{999}}) {
+        const auto claim = batcher.claim(id);
+        ASSERT_TRUE(claim.has_value());
+        EXPECT_EQ(claim->batch, batch->number);
+        EXPECT_EQ(claim->withdrawal.id, id);
+        EXPECT_TRUE(WithdrawalBatcher::verify(batch->root, *claim));
+    }
+}
+
+TEST(WithdrawalBatcherTest, AlteredClaimFailsVerification) {
+    WithdrawalBatcher batcher(WithdrawalBatcher::Config{});
+    queue_withdrawals(batcher, 7);
+    const auto batch = batcher.seal();
+    ASSERT_TRUE(batch.has_value());
+
+    auto claim = batcher.claim(3);
+    ASSERT_TRUE(claim.has_value());
+    claim->withdrawal.amount += 1;
+    EXPECT_FALSE(WithdrawalBatcher::verify(batch->root, *claim));
+
+    claim = batcher.claim(3);
+    claim->withdrawal.l1_address = "someone-else";
+    EXPECT_FALSE(WithdrawalBatcher::verify(batch->root, *claim));
+}
+
+TEST(WithdrawalBatcherTest, BatchesCoverConsecutiveIdsUpToTheLimit) {
+    WithdrawalBatcher::Config config;
+    config.max_batch = 4;
+    config.retained_batches = 2;
+    WithdrawalBatcher batcher(config);
+    queue_withdrawals(batcher, 10);
+
+    const auto first = batcher.seal();
+    const auto second = batcher.seal();
+    const auto third = batcher.seal();
+    ASSERT_TRUE(first && second && third);
+    EXPECT_EQ(first->first_id, 0u);
+    EXPECT_EQ(second->first_id, 4u);
+    EXPECT_EQ(third->first_id, 8u);
+    EXPECT_EQ(third->count, 2u);
+    EXPECT_NE(first->root, second->root);
+
+    // Only the last two are retained
+    EXPECT_FALSE(batcher.batch(first->number).has_value());
+    EXPECT_FALSE(batcher.claim(2).has_value());
+    const auto claim = batcher.claim(9);
+    ASSERT_TRUE(claim.has_value());
+    EXPECT_EQ(claim->batch, third->number);
+    EXPECT_TRUE(WithdrawalBatcher::verify(third->root, *claim));
+
+    // Queued but not sealed yet
+    const uint64_t queued = batcher.enqueue("l2", "l1", 1, 0);
+    EXPECT_FALSE(batcher.claim(queued).has_value());
+}
+
+} // namespace test
+} // namespace rollup
+} // namespace quids
@@ -0,0 +1,193 @@
+#include "storage/BlockArchive.hpp"
+#include <gtest/gtest.h>
+#include <csignal>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace quids {
+namespace storage {
+namespace test {
+
+namespace {
+
+std::string fresh_directory(const char* name) {
+    const std::string path = ::testing::TempDir() + name;
+    std::filesystem::remove_all(path);
+    return path;
+}
+
+std::vector<uint8_t> block_data(uint64_t number) {
+    return std::vector<uint8_t>(10 + number, static_cast<uint8_t>(number));
+}
+
+std::vector<std::vector<uint8_t>> bodies(uint64_t number) {
+    std::vector<std::vector<uint8_t>> out;
+    for (uint64_t i = 0; i < number % 3; ++i) {
+        out.push_back(std::vector<uint8_t>(5 + i, static_cast<uint8_t>(number * 10 + i)));
+    }
+    return out;
+}
+
+bool append(BlockArchive& archive, uint64_t number) {
+    return archive.append(number, block_data(number), bodies(number));
+}
+
+void expect_block(const BlockArchive& archive, uint64_t number) {
+    SCOPED_TRACE(number);
+    const auto view = archive.get(number);
+    ASSERT_TRUE(view);
+    EXPECT_EQ(view->block_number(), number);
+    const auto data = view->data();
+    EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.end()), block_data(number));
+    const auto expected = bodies(number);
+    ASSERT_EQ(view->transaction_count(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const auto tx = view->transaction(i);
+        EXPECT_EQ(std::vector<uint8_t>(tx.begin(), tx.end()), expected[i]);
+    }
+    EXPECT_TRUE(view->transaction(expected.size()).empty());
+}
+
+BlockArchive::Config small_segments() {
+    BlockArchive::Config config;
+    config.blocks_per_segment = 3;
+    return config;
+}
+
+} // namespace
+
+TEST(BlockArchiveTest, AppendsAndReadsAcrossSegments) {
+    const auto directory = fresh_directory("archive_segments");
+    {
+        BlockArchive archive(directory, small_segments());
+        EXPECT_FALSE(archive.first_block());
+        EXPECT_FALSE(archive.get(0));
+        for (uint64_t n = 100; n < 108; ++n) {
+            ASSERT_TRUE(append(archive, n)) << n;
+        }
+        EXPECT_EQ(archive.first_block(), 100u);
+        EXPECT_EQ(archive.last_block(), 107u);
+        for (uint64_t n = 100; n < 108; ++n) {
+            expect_block(archive, n);
+        }
+        EXPECT_FALSE(archive.contains(99));
+        EXPECT_FALSE(archive.contains(108));
+        EXPECT_FALSE(archive.get(108));
+
+        // Views stay valid while later appends grow the mapping
+        const auto early = archive.get(106);
+        ASSERT_TRUE(append(archive, 108));
+        EXPECT_EQ(early->data()[0], 106);
+        expect_block(archive, 108);
+    }
+    EXPECT_TRUE(std::filesystem::exists(directory + "/100.seg"));
+    EXPECT_TRUE(std::filesystem::exists(directory + "/103.seg"));
+    EXPECT_TRUE(std::filesystem::exists(directory + "/106.seg"));
+
+    BlockArchive reopened(directory, small_segments());
+    EXPECT_EQ(reopened.first_block(), 100u);
+    EXPECT_EQ(reopened.last_block(), 108u);
+    for (uint64_t n = 100; n < 109; ++n) {
+        expect_block(reopened, n);
+    }
+    ASSERT_TRUE(append(reopened, 109));
+    expect_block(reopened, 109);
+}
+
+TEST(BlockArchiveTest, RejectsOutOfOrderAppends) {
+    BlockArchive archive(fresh_directory("archive_order"), small_segments());
+    ASSERT_TRUE(append(archive, 5));
+    EXPECT_FALSE(append(archive, 5));
+    EXPECT_FALSE(append(archive, 4));
+    EXPECT_FALSE(append(archive, 7));
+    ASSERT_TRUE(append(archive, 6));
+    ASSERT_TRUE(append(archive, 7));
+    // Also across a segment boundary
+    EXPECT_FALSE(append(archive, 9));
+    ASSERT_TRUE(append(archive, 8));
+    EXPECT_EQ(archive.last_block(), 8u);
+    for (uint64_t n = 5; n < 9; ++n) {
+        expect_block(archive, n);
+    }
+}
+
+TEST(BlockArchiveTest, ReopenDropsATornTail) {
+    const auto directory = fresh_directory("archive_torn");
+    const auto segment = directory + "/0.seg";
+    uint64_t size_before_last = 0;
+    {
+        BlockArchive::Config config;
+        config.blocks_per_segment = 16;
+        BlockArchive archive(directory, config);
+        for (uint64_t n = 0; n < 4; ++n) {
+            ASSERT_TRUE(append(archive, n));
+        }
+        size_before_last = std::filesystem::file_size(segment);
+        ASSERT_TRUE(append(archive, 4));
+    }
+
+    // Block 4's record is cut halfway while its index entry survives
+    const auto full_size = std::filesystem::file_size(segment);
+    std::filesystem::resize_file(segment, (size_before_last + full_size) / 2);
+
+    BlockArchive::Config config;
+    config.blocks_per_segment = 16;
+    {
+        BlockArchive archive(directory, config);
+        EXPECT_EQ(archive.last_block(), 3u);
+        EXPECT_FALSE(archive.contains(4));
+        for (uint64_t n = 0; n < 4; ++n) {
+            expect_block(archive, n);
+        }
+        EXPECT_EQ(std::filesystem::file_size(segment), size_before_last);
+        EXPECT_EQ(std::filesystem::file_size(directory + "/0.idx"), 4 * 8u);
+
+        // The block can be written again where it was lost
+        ASSERT_TRUE(append(archive, 4));
+        ASSERT_TRUE(append(archive, 5));
+    }
+
+    BlockArchive reopened(directory, config);
+    EXPECT_EQ(reopened.last_block(), 5u);
+    for (uint64_t n = 0; n < 6; ++n) {
+        expect_block(reopened, n);
+    }
+}
+
+TEST(BlockArchiveTest, FailedFirstWriteDoesNotClaimTheSegment) {
+    const auto directory = fresh_directory("archive_failed");
+    BlockArchive archive(directory, small_segments());
+
+    // Room for the segment header but not the record; EFBIG instead of SIGXFSZ
+    rlimit original{};
+    ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &original), 0);
+    const auto previous_handler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit tight = original;
+    tight.rlim_cur = 64;
+    ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &tight), 0);
+    const bool written = archive.append(5, std::vector<uint8_t>(200, 5), {});
+    ::setrlimit(RLIMIT_FSIZE, &original);
+    std::signal(SIGXFSZ, previous_handler);
+    ASSERT_FALSE(written);
+    EXPECT_FALSE(archive.first_block());
+
+    // The empty segment was named for block 5; block 7 must not land in it
+    ASSERT_TRUE(append(archive, 7));
+    EXPECT_EQ(archive.first_block(), 7u);
+    expect_block(archive, 7);
+    EXPECT_FALSE(std::filesystem::exists(directory + "/5.seg"));
+    ASSERT_TRUE(append(archive, 8));
+
+    BlockArchive reopened(directory, small_segments());
+    EXPECT_EQ(reopened.first_block(), 7u);
+    EXPECT_EQ(reopened.last_block(), 8u);
+    expect_block(reopened, 7);
+    expect_block(reopened, 8);
+}
+
+} // namespace test
+} // namespace storage
+} // namespace quids
@@ -0,0 +1,229 @@
+#include "storage/PersistentStorage.hpp"
+#include "TestStorage.hpp"
+#include "TestTransactions.hpp"
+#include <gtest/gtest.h>
+#include <rocksdb/db.h>
+#include <algorithm>
+#include <array>
+#include <csignal>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace quids {
+namespace storage {
+namespace test {
+
+namespace {
+
+using Hash = std::array<uint8_t, 32>;
+
+std::vector<blockchain::TransactionPtr> transfers(uint64_t block_number, size_t count) {
+    std::vector<blockchain::TransactionPtr> txs;
+    for (size_t i = 0; i < count; ++i) {
+        txs.push_back(quids::test::makeSignedTransfer("sender_" + std::to_string(block_number), "recipient",
+                                                      1 + i, i));
+    }
+    return txs;
+}
+
+std::vector<Hash> hashes(const std::vector<blockchain::TransactionPtr>& txs) {
+    std::vector<Hash> out;
+    for (const auto& tx : txs) {
+        out.push_back(tx->hash());
+    }
+    return out;
+}
+
+rollup::StateTransitionProof proof(uint8_t tag) {
+    rollup::StateTransitionProof::ProofData data{};
+    data.pre_state_root.fill(tag);
+    data.post_state_root.fill(static_cast<uint8_t>(tag + 1));
+    data.zk_proof = {tag, tag};
+    return rollup::StateTransitionProof(data);
+}
+
+std::vector<uint8_t> block_data(uint64_t block_number, size_t size = 64) {
+    return std::vector<uint8_t>(size, static_cast<uint8_t>(block_number));
+}
+
+// Largest file in `dir`, which a write-size limit has to leave room for
+uintmax_t largest_file(const std::filesystem::path& dir) {
+    uintmax_t largest = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.is_regular_file()) {
+            largest = std::max(largest, entry.file_size());
+        }
+    }
+    return largest;
+}
+
+} // namespace
+
+class PersistentStorageTest : public quids::test::TempStorageTest {
+protected:
+    PersistentStorageTest() : TempStorageTest("persistent_storage_") {}
+
+    void reopen() {
+        storage_.reset();
+        storage_ = std::make_shared<PersistentStorage>(dir_.string());
+    }
+
+    void expect_absent(uint64_t block_number, const std::vector<blockchain::TransactionPtr>& txs) {
+        SCOPED_TRACE(block_number);
+        EXPECT_FALSE(storage_->loadBlockData(block_number));
+        EXPECT_FALSE(storage_->loadProof(block_number));
+        EXPECT_TRUE(storage_->loadTransactionHashes(block_number).empty());
+        for (const auto& tx : txs) {
+            EXPECT_EQ(storage_->loadTransaction(tx->hash()), nullptr);
+        }
+    }
+};
+
+// A raw single-family database, laid out the way storage was before the
+// column families
+class LegacyLayoutTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = quids::test::uniqueTempPath("legacy_storage_");
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    void write_legacy(const std::vector<std::pair<std::string, std::string>>& entries) {
+        rocksdb::Options options;
+        options.create_if_missing = true;
+        rocksdb::DB* raw = nullptr;
+        ASSERT_TRUE(rocksdb::DB::Open(options, dir_.string(), &raw).ok());
+        std::unique_ptr<rocksdb::DB> db(raw);
+        for (const auto& [key, value] : entries) {
+            ASSERT_TRUE(db->Put(rocksdb::WriteOptions(), key, value).ok());
+        }
+    }
+
+    std::filesystem::path dir_;
+};
+
+TEST_F(PersistentStorageTest, StoresABlockAtomicallyAndReadsItBack) {
+    const auto txs = transfers(7, 3);
+    ASSERT_TRUE(storage_->storeBlockAtomic(7, txs, proof(7), block_data(7)));
+
+    EXPECT_EQ(storage_->loadTransactionHashes(7), hashes(txs));
+    const auto loaded = storage_->loadTransactions(7);
+    ASSERT_EQ(loaded.size(), txs.size());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        EXPECT_EQ(loaded[i]->hash(), txs[i]->hash());
+        EXPECT_EQ(loaded[i]->getAmount(), txs[i]->getAmount());
+    }
+    const auto single = storage_->loadTransaction(txs[1]->hash());
+    ASSERT_NE(single, nullptr);
+    EXPECT_EQ(single->getSender(), "sender_7");
+
+    const auto stored_proof = storage_->loadProof(7);
+    ASSERT_TRUE(stored_proof);
+    EXPECT_EQ(stored_proof->getPostStateRoot(), proof(7).getPostStateRoot());
+    EXPECT_EQ(storage_->loadBlockData(7), block_data(7));
+
+    // Survives a restart
+    reopen();
+    EXPECT_EQ(storage_->loadTransactionHashes(7), hashes(txs));
+    EXPECT_EQ(storage_->loadBlockData(7), block_data(7));
+
+    expect_absent(8, {});
+    EXPECT_TRUE(storage_->loadTransactions(8).empty());
+}
+
+TEST_F(PersistentStorageTest, PrefixScansStayInsideOneBlockInOrder) {
+    // More than 256 positions, and neighbours whose decimal numbers would
+    // share a prefix with block 1
+    const auto block1 = transfers(1, 300);
+    const auto block10 = transfers(10, 2);
+    const auto block256 = transfers(256, 2);
+    ASSERT_TRUE(storage_->storeTransactions(0, transfers(0, 2)));
+    ASSERT_TRUE(storage_->storeTransactions(1, block1));
+    ASSERT_TRUE(storage_->storeTransactions(10, block10));
+    ASSERT_TRUE(storage_->storeTransactions(256, block256));
+
+    EXPECT_EQ(storage_->loadTransactionHashes(1), hashes(block1));
+    EXPECT_EQ(storage_->loadTransactionHashes(10), hashes(block10));
+    EXPECT_EQ(storage_->loadTransactionHashes(256), hashes(block256));
+    EXPECT_TRUE(storage_->loadTransactionHashes(2).empty());
+
+    const auto loaded = storage_->loadTransactions(1);
+    ASSERT_EQ(loaded.size(), block1.size());
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        ASSERT_EQ(loaded[i]->hash(), block1[i]->hash()) << i;
+    }
+}
+
+TEST_F(PersistentStorageTest, FailedBlockWriteLeavesNothingBehind) {
+    const auto first = transfers(1, 2);
+    ASSERT_TRUE(storage_->storeBlockAtomic(1, first, proof(1), block_data(1)));
+
+    // Room for what is on disk but not the next batch; EFBIG instead of SIGXFSZ
+    const auto second = transfers(2, 50);
+    rlimit original{};
+    ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &original), 0);
+    const auto previous_handler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit tight = original;
+    tight.rlim_cur = static_cast<rlim_t>(largest_file(dir_) + 1024);
+    ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &tight), 0);
+    const bool stored = storage_->storeBlockAtomic(2, second, proof(2), block_data(2, 256 * 1024));
+    ::setrlimit(RLIMIT_FSIZE, &original);
+    std::signal(SIGXFSZ, previous_handler);
+    ASSERT_FALSE(stored);
+
+    reopen();
+    expect_absent(2, second);
+    EXPECT_EQ(storage_->loadTransactionHashes(1), hashes(first));
+    EXPECT_EQ(storage_->loadBlockData(1), block_data(1));
+    ASSERT_TRUE(storage_->storeBlockAtomic(2, second, proof(2), block_data(2)));
+    EXPECT_EQ(storage_->loadTransactionHashes(2), hashes(second));
+}
+
+TEST_F(LegacyLayoutTest, MovesSingleFamilyKeysIntoTheirFamilies) {
+    const auto bytes = quids::test::signedTransferBytes("alice", "bob", 5, 0);
+    const Hash hash = quids::test::makeSignedTransfer("alice", "bob", 5, 0)->hash();
+    const auto proof_bytes = proof(12).serialize();
+    write_legacy({
+        {"tx:" + std::string(hash.begin(), hash.end()), std::string(bytes.begin(), bytes.end())},
+        {"proof:12", std::string(proof_bytes.begin(), proof_bytes.end())},
+        {"block:12", "block twelve"},
+        {"state:acct/1", "balance"},
+    });
+
+    for (int open = 0; open < 2; ++open) {
+        SCOPED_TRACE(open);
+        PersistentStorage storage(dir_.string());
+        const auto tx = storage.loadTransaction(hash);
+        ASSERT_NE(tx, nullptr);
+        EXPECT_EQ(tx->getAmount(), 5u);
+        ASSERT_TRUE(storage.loadProof(12));
+        EXPECT_EQ(storage.loadProof(12)->getPostStateRoot(), proof(12).getPostStateRoot());
+        const auto data = storage.loadBlockData(12);
+        ASSERT_TRUE(data);
+        EXPECT_EQ(std::string(data->begin(), data->end()), "block twelve");
+        const auto state = storage.loadState("acct/1");
+        ASSERT_TRUE(state);
+        EXPECT_EQ(std::string(state->begin(), state->end()), "balance");
+    }
+}
+
+TEST_F(LegacyLayoutTest, RefusesKeysItCannotPlace) {
+    write_legacy({{"proof:twelve", "x"}});
+    EXPECT_THROW(PersistentStorage(dir_.string()), std::runtime_error);
+    std::filesystem::remove_all(dir_);
+
+    write_legacy({{"mystery", "x"}});
+    EXPECT_THROW(PersistentStorage(dir_.string()), std::runtime_error);
+}
+
+} // namespace test
+} // namespace storage
+} // namespace quids
@@ -0,0 +1,91 @@
+#include "storage/TensorCheckpoint.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace quids {
+namespace storage {
+namespace test {
+
+namespace {
+
+std::string temp_path(const char* name) {
+    return ::testing::TempDir() + name;
+}
+
+} // namespace
+
+TEST(TensorCheckpointTest, RoundTripsAlignedTensorsInPlace) {
+    const std::string path = temp_path("tensors.ckpt");
+    std::vector<float> weights(3 * 5);
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = static_cast<float>(i) * 0.5f;
+    }
+    const std::vector<int8_t> codes{-3, 0, 7};
+
+    TensorCheckpoint::Writer writer;
+    writer.add<float>("dense.weight", {3, 5}, weights);
+    writer.add<int8_t>("dense.codes", {3}, codes);
+    EXPECT_THROW(writer.add<float>("short", {4}, weights), std::invalid_argument);
+    EXPECT_THROW(writer.add<int8_t>("dense.codes", {3}, codes), std::invalid_argument);
+    writer.write(path);
+
+    auto checkpoint = TensorCheckpoint::open(path);
+    ASSERT_TRUE(checkpoint);
+    EXPECT_EQ(checkpoint->size(), 2u);
+    const auto& view = checkpoint->at("dense.weight");
+    EXPECT_EQ(view.shape, (std::vector<uint64_t>{3, 5}));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(view.bytes.data()) % TensorCheckpoint::ALIGNMENT, 0u);
+    const auto values = view.as<float>();
+    EXPECT_EQ(std::vector<float>(values.begin(), values.end()), weights);
+    EXPECT_THROW((void)view.as<double>(), std::invalid_argument);
+    const auto stored = checkpoint->at("dense.codes").as<int8_t>();
+    EXPECT_EQ(std::vector<int8_t>(stored.begin(), stored.end()), codes);
+    EXPECT_EQ(checkpoint->find("missing"), nullptr);
+    EXPECT_THROW((void)checkpoint->at("missing"), std::out_of_range);
+
+    // A rewrite swaps the file; the open mapping keeps the old contents
+    TensorCheckpoint::Writer next;
+    next.add<float>("dense.weight", {1}, std::vector<float>{42.0f});
+    next.write(path);
+    EXPECT_EQ(checkpoint->at("dense.weight").as<float>()[1], 0.5f);
+    auto reopened = TensorCheckpoint::open(path);
+    ASSERT_TRUE(reopened);
+    EXPECT_EQ(reopened->at("dense.weight").as<float>()[0], 42.0f);
+    std::remove(path.c_str());
+}
+
+TEST(TensorCheckpointTest, RejectsCorruptOrForeignFiles) {
+    const std::string path = temp_path("corrupt.ckpt");
+    EXPECT_FALSE(TensorCheckpoint::open(path));
+
+    TensorCheckpoint::Writer writer;
+    writer.add<double>("values", {4}, std::vector<double>{1, 2, 3, 4});
+    writer.write(path);
+    ASSERT_TRUE(TensorCheckpoint::open(path));
+
+    // Flip the last data byte: only the tensor checksum notices
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(-1, std::ios::end);
+        char byte = 0;
+        file.read(&byte, 1);
+        file.seekp(-1, std::ios::end);
+        byte ^= 1;
+        file.write(&byte, 1);
+    }
+    EXPECT_FALSE(TensorCheckpoint::open(path));
+    auto unchecked = TensorCheckpoint::open(path, false);
+    ASSERT_TRUE(unchecked);
+    EXPECT_FALSE(unchecked->verify());
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << std::string(128, 'x');
+    EXPECT_FALSE(TensorCheckpoint::open(path));
+    std::remove(path.c_str());
+}
+
+} // namespace test
+} // namespace storage
+} // namespace quids
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include "utils/AdaptiveBatchController.hpp"
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+
+namespace quids {
+namespace utils {
+namespace test {
+
+namespace {
+
+using namespace std::chrono_literals;
+
+AdaptiveBatchController::Config smallConfig() {
+    AdaptiveBatchController::Config config;
+    config.min_batch_size = 10;
+    config.max_batch_size = 200;
+    config.min_wait = 2ms;
+    config.max_wait = 100ms;
+    config.latency_target = 10ms;
+    config.increase_step = 10;
+    config.decrease_factor = 0.5;
+    config.smoothing = 1.0;
+    return config;
+}
+
+// A full batch at the current limit that finished well inside the target
+void fullAndFast(AdaptiveBatchController& controller) {
+    const size_t limit = controller.batchSize();
+    controller.observe(limit, limit, 1ms, 1000);
+}
+
+} // namespace
+
+TEST(AdaptiveBatchControllerTest, CutsMultiplicativelyFromTheLateBatch) {
+    AdaptiveBatchController controller(smallConfig());
+    EXPECT_EQ(controller.batchSize(), 200u);
+    EXPECT_EQ(controller.waitTime(), 100ms);
+
+    controller.observe(200, 200, 20ms, 0);
+    EXPECT_EQ(controller.batchSize(), 100u);
+    EXPECT_EQ(controller.waitTime(), 50ms);
+
+    // Other batches cut at 200 land late too; they do not cut again
+    controller.observe(200, 200, 20ms, 0);
+    controller.observe(200, 200, 20ms, 0);
+    EXPECT_EQ(controller.batchSize(), 100u);
+    EXPECT_EQ(controller.waitTime(), 50ms);
+    // unless their own size calls for a deeper cut
+    controller.observe(150, 200, 20ms, 0);
+    EXPECT_EQ(controller.batchSize(), 75u);
+    EXPECT_EQ(controller.waitTime(), 25ms);
+
+    // A late batch smaller than the limit it was cut under sets the cut
+    controller.observe(60, 75, 20ms, 0);
+    EXPECT_EQ(controller.batchSize(), 30u);
+    EXPECT_EQ(controller.waitTime(), 12ms);
+
+    const auto stats = controller.stats();
+    EXPECT_EQ(stats.slo_violations, 5u);
+    EXPECT_EQ(stats.decreases, 3u);
+}
+
+TEST(AdaptiveBatchControllerTest, GrowsAdditivelyOnlyOnFullBatchesUnderTheCurrentLimit) {
+    AdaptiveBatchController controller(smallConfig());
+    controller.observe(200, 200, 20ms, 0);
+    controller.observe(100, 100, 20ms, 0);
+    ASSERT_EQ(controller.batchSize(), 50u);
+
+    fullAndFast(controller);
+    EXPECT_EQ(controller.batchSize(), 60u);
+    // A full batch from before the increase does not count twice
+    controller.observe(50, 50, 1ms, 1000);
+    EXPECT_EQ(controller.batchSize(), 60u);
+    // Nothing left queued, or latency without headroom, holds the size
+    controller.observe(60, 60, 1ms, 0);
+    controller.observe(60, 60, 9ms, 1000);
+    EXPECT_EQ(controller.batchSize(), 60u);
+
+    for (int i = 0; i < 5; ++i) {
+        fullAndFast(controller);
+    }
+    EXPECT_EQ(controller.batchSize(), 110u);
+    EXPECT_EQ(controller.stats().increases, 6u);
+}
+
+TEST(AdaptiveBatchControllerTest, ClampsToTheConfiguredRange) {
+    AdaptiveBatchController controller(smallConfig());
+    for (int i = 0; i < 20; ++i) {
+        const size_t limit = controller.batchSize();
+        controller.observe(limit, limit, 1s, 0);
+    }
+    EXPECT_EQ(controller.batchSize(), 10u);
+    EXPECT_EQ(controller.waitTime(), 2ms);
+
+    for (int i = 0; i < 100; ++i) {
+        fullAndFast(controller);
+    }
+    EXPECT_EQ(controller.batchSize(), 200u);
+    EXPECT_EQ(controller.waitTime(), 100ms);
+}
+
+TEST(AdaptiveBatchControllerTest, ShortensTheWaitForBatchesItCannotFill) {
+    AdaptiveBatchController controller(smallConfig());
+    controller.observe(20, 200, 1ms, 0);
+    EXPECT_EQ(controller.waitTime(), 50ms);
+    controller.observe(20, 200, 1ms, 0);
+    EXPECT_EQ(controller.waitTime(), 25ms);
+    EXPECT_EQ(controller.batchSize(), 200u);
+
+    // A full one lets it recover a step at a time
+    fullAndFast(controller);
+    EXPECT_EQ(controller.waitTime(), 27ms);
+}
+
+TEST(AdaptiveBatchControllerTest, RejectsInconsistentConfigurations) {
+    auto config = smallConfig();
+    config.min_batch_size = 0;
+    EXPECT_THROW(AdaptiveBatchController{config}, std::invalid_argument);
+    config = smallConfig();
+    config.min_batch_size = 300;
+    EXPECT_THROW(AdaptiveBatchController{config}, std::invalid_argument);
+    config = smallConfig();
+    config.min_wait = 200ms;
+    EXPECT_THROW(AdaptiveBatchController{config}, std::invalid_argument);
+    config = smallConfig();
+    config.decrease_factor = 1.0;
+    EXPECT_THROW(AdaptiveBatchController{config}, std::invalid_argument);
+}
+
+} // namespace test
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "utils/BoundedQueue.hpp"
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace quids {
+namespace utils {
+namespace test {
+
+TEST(BoundedQueueTest, BulkCallsStopAtCapacityAndOnEmpty) {
+    BoundedQueue<std::unique_ptr<int>> queue(6);
+    EXPECT_EQ(queue.capacity(), 8u);
+
+    std::vector<std::unique_ptr<int>> in;
+    for (int i = 0; i < 12; ++i) {
+        in.push_back(std::make_unique<int>(i));
+    }
+    EXPECT_EQ(queue.try_push_bulk(in.begin(), in.size()), 8u);
+    EXPECT_EQ(queue.try_push_bulk(in.begin() + 8, 4), 0u);
+    // Whatever did not go in is left with the caller
+    EXPECT_EQ(*in[8], 8);
+
+    std::vector<std::unique_ptr<int>> out;
+    EXPECT_EQ(queue.try_pop_bulk(std::back_inserter(out), 5), 5u);
+    EXPECT_EQ(queue.try_pop_bulk(std::back_inserter(out), 5), 3u);
+    EXPECT_EQ(queue.try_pop_bulk(std::back_inserter(out), 5), 0u);
+    ASSERT_EQ(out.size(), 8u);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(*out[i], i);
+    }
+}
+
+TEST(BoundedQueueTest, ZeroCountBulkCallsReturnAtOnce) {
+    BoundedQueue<int> queue(4);
+    std::vector<int> none;
+    EXPECT_EQ(queue.try_push_bulk(none.begin(), 0), 0u);
+    EXPECT_EQ(queue.try_pop_bulk(std::back_inserter(none), 0), 0u);
+
+    ASSERT_TRUE(queue.try_push(1));
+    EXPECT_EQ(queue.try_pop_bulk(std::back_inserter(none), 0), 0u);
+    EXPECT_EQ(queue.size(), 1u);
+
+    BoundedQueue<int, QueueMode::SPSC> spsc(4);
+    EXPECT_EQ(spsc.try_push_bulk(none.begin(), 0), 0u);
+    EXPECT_EQ(spsc.try_pop_bulk(std::back_inserter(none), 0), 0u);
+    EXPECT_TRUE(none.empty());
+}
+
+TEST(BoundedQueueTest, ConcurrentProducersAndConsumersLoseNothing) {
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 20000;
+    BoundedQueue<int> queue(64);
+    std::vector<std::atomic<int>> seen(PRODUCERS * PER_PRODUCER);
+    std::atomic<int> consumed{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        threads.emplace_back([&, p] {
+            std::vector<int> batch;
+            for (int i = 0; i < PER_PRODUCER; i += 8) {
+                batch.clear();
+                for (int j = i; j < i + 8; ++j) {
+                    batch.push_back(p * PER_PRODUCER + j);
+                }
+                size_t pushed = 0;
+                while (pushed < batch.size()) {
+                    pushed += queue.try_push_bulk(batch.begin() + pushed, batch.size() - pushed);
+                }
+            }
+        });
+    }
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&] {
+            std::vector<int> out;
+            while (consumed.load() < PRODUCERS * PER_PRODUCER) {
+                out.clear();
+                const size_t n = queue.try_pop_bulk(std::back_inserter(out), 16);
+                for (int v : out) {
+                    seen[v].fetch_add(1);
+                }
+                consumed.fetch_add(static_cast<int>(n));
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (size_t i = 0; i < seen.size(); ++i) {
+        ASSERT_EQ(seen[i].load(), 1) << i;
+    }
+}
+
+} // namespace test
+} // namespace utils
+} // namespace quids
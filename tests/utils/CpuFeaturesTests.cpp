@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "utils/CpuFeatures.hpp"
+#include <algorithm>
+#include <string>
+
+namespace quids {
+namespace utils {
+namespace test {
+
+namespace {
+
+int plain() { return 1; }
+int wide() { return 2; }
+
+CpuFeature recorded(const std::string& kernel) {
+    const auto entries = KernelRegistry::global().selected();
+    const auto it = std::find_if(entries.begin(), entries.end(),
+                                 [&](const auto& entry) { return entry.first == kernel; });
+    EXPECT_NE(it, entries.end()) << kernel;
+    return it == entries.end() ? CpuFeature::Scalar : it->second;
+}
+
+} // namespace
+
+TEST(CpuFeaturesTest, DisabledFeaturesAreHidden) {
+    const auto all = CpuFeatures::detect(nullptr);
+    EXPECT_TRUE(all.has(CpuFeature::Scalar));
+    EXPECT_TRUE(CpuFeatures::host().has(CpuFeature::Scalar));
+
+    const auto narrowed = CpuFeatures::detect("avx512f,avx2");
+    EXPECT_FALSE(narrowed.has(CpuFeature::Avx512f));
+    EXPECT_FALSE(narrowed.has(CpuFeature::Avx2));
+    // Everything not named is left as detected
+    for (const auto feature : {CpuFeature::Sse42, CpuFeature::Bmi2, CpuFeature::Pclmul,
+                               CpuFeature::Neon, CpuFeature::Aes}) {
+        EXPECT_EQ(narrowed.has(feature), all.has(feature)) << featureName(feature);
+    }
+}
+
+TEST(CpuFeaturesTest, OverrideIgnoresWhatItDoesNotKnow) {
+    const auto all = CpuFeatures::detect(nullptr);
+    // Unknown names, empty entries and case mismatches hide nothing
+    const auto unchanged = CpuFeatures::detect(",bogus,,AVX2,");
+    for (uint32_t i = 0; i <= static_cast<uint32_t>(CpuFeature::Aes); ++i) {
+        const auto feature = static_cast<CpuFeature>(i);
+        EXPECT_EQ(unchanged.has(feature), all.has(feature)) << featureName(feature);
+    }
+    EXPECT_TRUE(CpuFeatures::detect("scalar").has(CpuFeature::Scalar));
+
+    const auto none = CpuFeatures::detect("sse4.2,avx2,avx512f,bmi2,pclmul,neon,aes");
+    for (uint32_t i = 1; i <= static_cast<uint32_t>(CpuFeature::Aes); ++i) {
+        EXPECT_FALSE(none.has(static_cast<CpuFeature>(i))) << featureName(static_cast<CpuFeature>(i));
+    }
+}
+
+TEST(CpuFeaturesTest, SelectsTheFirstAvailableCandidate) {
+    const auto none = CpuFeatures::detect("sse4.2,avx2,avx512f,bmi2,pclmul,neon,aes");
+    EXPECT_EQ(selectFeature("test.fallback", {CpuFeature::Avx512f, CpuFeature::Avx2}, none), CpuFeature::Scalar);
+    EXPECT_EQ(recorded("test.fallback"), CpuFeature::Scalar);
+    EXPECT_FALSE(useFeature("test.single", CpuFeature::Avx2, none));
+    EXPECT_EQ(recorded("test.single"), CpuFeature::Scalar);
+
+    const auto all = CpuFeatures::detect(nullptr);
+    if (all.has(CpuFeature::Avx2)) {
+        // Hiding the wider feature falls through to the next one
+        const auto no_avx512 = CpuFeatures::detect("avx512f");
+        EXPECT_EQ(selectFeature("test.fallback", {CpuFeature::Avx512f, CpuFeature::Avx2}, no_avx512),
+                  CpuFeature::Avx2);
+        EXPECT_EQ(recorded("test.fallback"), CpuFeature::Avx2);
+        EXPECT_TRUE(useFeature("test.single", CpuFeature::Avx2, all));
+    }
+    // A kernel selected twice keeps one entry
+    const auto entries = KernelRegistry::global().selected();
+    EXPECT_EQ(std::count_if(entries.begin(), entries.end(),
+                            [](const auto& entry) { return entry.first == "test.fallback"; }),
+              1);
+}
+
+TEST(CpuFeaturesTest, SelectsKernelFunctions) {
+    using Fn = int (*)();
+    const auto all = CpuFeatures::detect(nullptr);
+    const auto none = CpuFeatures::detect("sse4.2,avx2,avx512f,bmi2,pclmul,neon,aes");
+
+    EXPECT_EQ(selectKernel<Fn>("test.kernel", {{CpuFeature::Avx2, wide}, {CpuFeature::Scalar, plain}}, none),
+              &plain);
+    EXPECT_EQ(recorded("test.kernel"), CpuFeature::Scalar);
+    // Without a Scalar variant there is nothing to run
+    EXPECT_EQ(selectKernel<Fn>("test.kernel", {{CpuFeature::Avx2, wide}}, none), nullptr);
+
+    const Fn chosen = selectKernel<Fn>("test.kernel", {{CpuFeature::Avx2, wide}, {CpuFeature::Scalar, plain}}, all);
+    EXPECT_EQ(chosen(), all.has(CpuFeature::Avx2) ? 2 : 1);
+}
+
+} // namespace test
+} // namespace utils
+} // namespace quids
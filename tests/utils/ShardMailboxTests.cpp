@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "utils/ShardMailbox.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace quids {
+namespace utils {
+namespace test {
+
+namespace {
+
+struct Item {
+    size_t from;   // sending shard, or SHARDS for an application thread
+    size_t target;
+    size_t sequence;
+};
+
+} // namespace
+
+TEST(ShardMailboxTest, RoutesByTheCallingThread) {
+    ShardMailbox<std::unique_ptr<int>> mailbox(3, 4, 2);
+    EXPECT_EQ(mailbox.shards(), 3u);
+    EXPECT_FALSE(mailbox.current_shard());
+    size_t local = 0;
+    auto count_local = [&](std::unique_ptr<int>&&) { ++local; };
+
+    // Off any loop, sends wait in the inbox
+    mailbox.send(1, std::make_unique<int>(1), count_local);
+    {
+        const ShardMailbox<std::unique_ptr<int>>::LoopScope scope(mailbox, 1);
+        EXPECT_EQ(mailbox.current_shard(), 1u);
+        // The loop's own shard runs in place; others take its SPSC queue
+        mailbox.send(1, std::make_unique<int>(2), count_local);
+        mailbox.send(2, std::make_unique<int>(3), count_local);
+        EXPECT_EQ(local, 1u);
+
+        std::vector<int> drained;
+        EXPECT_EQ(mailbox.drain(1, [&](std::unique_ptr<int>&& v) { drained.push_back(*v); }, 8), 1u);
+        EXPECT_EQ(drained, std::vector<int>{1});
+    }
+    EXPECT_FALSE(mailbox.current_shard());
+
+    // Another mailbox's loop counts as an application thread here
+    ShardMailbox<std::unique_ptr<int>> other(3, 4, 2);
+    {
+        const ShardMailbox<std::unique_ptr<int>>::LoopScope scope(other, 2);
+        EXPECT_FALSE(mailbox.current_shard());
+        mailbox.send(2, std::make_unique<int>(4), count_local);
+    }
+    EXPECT_EQ(local, 1u);
+
+    std::vector<int> drained;
+    EXPECT_EQ(mailbox.drain(2, [&](std::unique_ptr<int>&& v) { drained.push_back(*v); }, 8), 2u);
+    // The inbox before the shard queues
+    EXPECT_EQ(drained, (std::vector<int>{4, 3}));
+    EXPECT_THROW(ShardMailbox<int>(0, 4, 4), std::invalid_argument);
+}
+
+TEST(ShardMailboxTest, FullQueuesThrowAndKeepTheItem) {
+    ShardMailbox<std::unique_ptr<int>> mailbox(2, 2, 2);
+    auto never = [](std::unique_ptr<int>&&) { FAIL(); };
+    mailbox.send(0, std::make_unique<int>(0), never);
+    mailbox.send(0, std::make_unique<int>(1), never);
+    auto refused = std::make_unique<int>(2);
+    EXPECT_THROW(mailbox.send(0, std::move(refused), never), std::runtime_error);
+    ASSERT_NE(refused, nullptr);
+
+    const ShardMailbox<std::unique_ptr<int>>::LoopScope scope(mailbox, 1);
+    mailbox.send(0, std::make_unique<int>(3), never);
+    mailbox.send(0, std::make_unique<int>(4), never);
+    EXPECT_THROW(mailbox.send(0, std::make_unique<int>(5), never), std::runtime_error);
+
+    // A batch is taken from each queue, so neither starves the other
+    std::vector<int> drained;
+    EXPECT_EQ(mailbox.drain(0, [&](std::unique_ptr<int>&& v) { drained.push_back(*v); }, 1), 2u);
+    EXPECT_EQ(drained, (std::vector<int>{0, 3}));
+}
+
+TEST(ShardMailboxTest, LoopsAndProducersDeliverEverythingInOrder) {
+    constexpr size_t SHARDS = 4;
+    constexpr size_t PER_SENDER = 2000;
+    ShardMailbox<Item> mailbox(SHARDS, 256, 64);
+
+    std::atomic<bool> stop{false};
+    // Next sequence expected per (target, sender); senders are the shards plus
+    // one application thread
+    std::vector<std::vector<size_t>> next(SHARDS, std::vector<size_t>(SHARDS + 1, 0));
+    std::atomic<size_t> delivered{0};
+    std::atomic<size_t> misrouted{0};
+    std::atomic<size_t> reordered{0};
+
+    auto receive = [&](size_t shard, Item&& item) {
+        if (item.target != shard) {
+            misrouted.fetch_add(1, std::memory_order_relaxed);
+        }
+        // next[shard] is only touched by this shard's loop
+        if (item.sequence != next[shard][item.from]++) {
+            reordered.fetch_add(1, std::memory_order_relaxed);
+        }
+        delivered.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    // Each loop sends to every shard round robin while draining its own
+    std::vector<std::thread> loops;
+    for (size_t shard = 0; shard < SHARDS; ++shard) {
+        loops.emplace_back([&, shard] {
+            const ShardMailbox<Item>::LoopScope scope(mailbox, shard);
+            std::vector<size_t> sent(SHARDS, 0);
+            size_t total = 0;
+            auto deliver = [&](Item&& item) { receive(shard, std::move(item)); };
+            while (!stop.load(std::memory_order_acquire)) {
+                if (total < PER_SENDER * SHARDS) {
+                    const size_t target = total % SHARDS;
+                    try {
+                        mailbox.send(target, Item{shard, target, sent[target]}, deliver);
+                        ++sent[target];
+                        ++total;
+                    } catch (const std::runtime_error&) {
+                        // Full; drain and retry the same item
+                    }
+                }
+                mailbox.drain(shard, deliver, 16);
+            }
+        });
+    }
+
+    std::vector<size_t> sent(SHARDS, 0);
+    for (size_t total = 0; total < PER_SENDER * SHARDS;) {
+        const size_t target = total % SHARDS;
+        try {
+            mailbox.send(target, Item{SHARDS, target, sent[target]}, [](Item&&) { FAIL(); });
+            ++sent[target];
+            ++total;
+        } catch (const std::runtime_error&) {
+            std::this_thread::yield();
+        }
+    }
+
+    const size_t expected = PER_SENDER * SHARDS * (SHARDS + 1);
+    const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (delivered.load() < expected && std::chrono::steady_clock::now() < until) {
+        std::this_thread::yield();
+    }
+    stop.store(true, std::memory_order_release);
+    for (auto& loop : loops) {
+        loop.join();
+    }
+
+    EXPECT_EQ(delivered.load(), expected);
+    EXPECT_EQ(misrouted.load(), 0u);
+    EXPECT_EQ(reordered.load(), 0u);
+}
+
+} // namespace test
+} // namespace utils
+} // namespace quids
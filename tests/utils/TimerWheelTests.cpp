@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "utils/TimerWheel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace quids {
+namespace utils {
+namespace test {
+
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = TimerWheel::Clock;
+
+const Clock::time_point START{};
+
+Clock::time_point at(uint64_t ticks) {
+    return START + std::chrono::milliseconds(ticks);
+}
+
+} // namespace
+
+TEST(TimerWheelTest, RoundsDelaysUpToWholeTicks) {
+    TimerWheel wheel(1ms, START);
+    std::vector<int> fired;
+    wheel.schedule(0ms, [&] { fired.push_back(0); });
+    wheel.schedule(1500us, [&] { fired.push_back(2); });
+    wheel.schedule(2ms, [&] { fired.push_back(3); });
+
+    EXPECT_EQ(wheel.advance(START), 0u);
+    EXPECT_EQ(wheel.advance(at(1) - 1ns), 0u);
+    EXPECT_EQ(wheel.advance(at(1)), 1u);
+    EXPECT_EQ(wheel.advance(at(2)), 2u);
+    // Timers due on the same tick run in no particular order
+    std::sort(fired.begin(), fired.end());
+    EXPECT_EQ(fired, (std::vector<int>{0, 2, 3}));
+    EXPECT_TRUE(wheel.empty());
+    // Time going backwards is ignored
+    EXPECT_EQ(wheel.advance(at(1)), 0u);
+}
+
+TEST(TimerWheelTest, FiresOnTheFirstAdvancePastTheDeadlineAtEveryLevel) {
+    TimerWheel wheel(1ms, START);
+    std::mt19937_64 rng(7);
+    struct Timer {
+        uint64_t deadline;
+        bool fired{false};
+    };
+    std::vector<Timer> timers(2000);
+    for (size_t i = 0; i < timers.size(); ++i) {
+        // Spread over all four levels
+        const int bits = 1 + static_cast<int>(rng() % 30);
+        timers[i].deadline = 1 + rng() % (uint64_t{1} << bits);
+        wheel.schedule(std::chrono::milliseconds(timers[i].deadline), [&timers, i] { timers[i].fired = true; });
+    }
+    EXPECT_EQ(wheel.size(), timers.size());
+
+    // Uneven steps, so some advances cross many idle ticks at once
+    uint64_t previous = 0;
+    uint64_t now = 0;
+    size_t total = 0;
+    while (!wheel.empty()) {
+        now += 1 + rng() % (uint64_t{1} << (rng() % 24));
+        const size_t fired = wheel.advance(at(now));
+        total += fired;
+        size_t expected = 0;
+        for (auto& timer : timers) {
+            if (timer.deadline > previous && timer.deadline <= now) {
+                ++expected;
+                EXPECT_TRUE(timer.fired) << timer.deadline << " by " << now;
+            } else if (timer.deadline > now) {
+                EXPECT_FALSE(timer.fired) << timer.deadline << " early at " << now;
+            }
+        }
+        EXPECT_EQ(fired, expected);
+        previous = now;
+    }
+    EXPECT_EQ(total, timers.size());
+}
+
+TEST(TimerWheelTest, CancelsAndReschedulesWithStaleIdsRejected) {
+    TimerWheel wheel(1ms, START);
+    int fired = 0;
+    const auto a = wheel.schedule(10ms, [&] { fired += 1; });
+    const auto b = wheel.schedule(10ms, [&] { fired += 10; });
+    const auto c = wheel.schedule(300ms, [&] { fired += 100; });
+    EXPECT_TRUE(wheel.cancel(a));
+    EXPECT_FALSE(wheel.cancel(a));
+    EXPECT_EQ(wheel.size(), 2u);
+
+    // Pushed out past the first level, then pulled back in
+    auto moved = wheel.reschedule(b, 500ms);
+    EXPECT_TRUE(moved.valid());
+    EXPECT_FALSE(wheel.cancel(b));
+    EXPECT_EQ(wheel.advance(at(100)), 0u);
+    moved = wheel.reschedule(moved, 5ms);
+    EXPECT_EQ(wheel.advance(at(105)), 1u);
+    EXPECT_EQ(fired, 10);
+
+    // A fired timer's id stays stale when its node is reused
+    EXPECT_FALSE(wheel.cancel(moved));
+    EXPECT_FALSE(wheel.reschedule(moved, 1ms).valid());
+    const auto reused = wheel.schedule(1ms, [&] { fired += 1000; });
+    EXPECT_FALSE(wheel.cancel(moved));
+    EXPECT_TRUE(wheel.cancel(reused));
+
+    EXPECT_EQ(wheel.advance(at(300)), 1u);
+    EXPECT_EQ(fired, 110);
+    EXPECT_FALSE(wheel.cancel(c));
+    EXPECT_FALSE(wheel.cancel(TimerWheel::TimerId{}));
+}
+
+TEST(TimerWheelTest, CallbacksMayScheduleAndCancel) {
+    TimerWheel wheel(1ms, START);
+    std::vector<uint64_t> fired;
+    uint64_t now = 0;
+    TimerWheel::TimerId victim;
+    // Re-arms itself three times, one tick apart
+    std::function<void()> periodic = [&] {
+        fired.push_back(now);
+        if (fired.size() < 3) {
+            wheel.schedule(0ms, periodic);
+        }
+    };
+    wheel.schedule(4ms, periodic);
+    // Cancels a timer due on the same tick that has not run yet
+    victim = wheel.schedule(4ms, [&] { ADD_FAILURE() << "cancelled timer fired"; });
+    bool cancelled = false;
+    wheel.schedule(4ms, [&] { cancelled = wheel.cancel(victim); });
+
+    for (now = 1; now <= 10; ++now) {
+        wheel.advance(at(now));
+    }
+    EXPECT_EQ(fired, (std::vector<uint64_t>{4, 5, 6}));
+    EXPECT_TRUE(cancelled);
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, DeadlinesBeyondTheTopLevelStillFire) {
+    TimerWheel wheel(1ms, START);
+    const uint64_t far = (uint64_t{1} << 32) + 12345;
+    const uint64_t farther = 3 * (uint64_t{1} << 32) + 7;
+    bool fired_far = false;
+    bool fired_farther = false;
+    wheel.schedule(std::chrono::milliseconds(far), [&] { fired_far = true; });
+    wheel.schedule(std::chrono::milliseconds(farther), [&] { fired_farther = true; });
+
+    EXPECT_EQ(wheel.advance(at(far - 1)), 0u);
+    EXPECT_FALSE(fired_far);
+    EXPECT_EQ(wheel.advance(at(far)), 1u);
+    EXPECT_TRUE(fired_far);
+    EXPECT_EQ(wheel.advance(at(farther - 1)), 0u);
+    EXPECT_EQ(wheel.advance(at(farther)), 1u);
+    EXPECT_TRUE(fired_farther);
+}
+
+} // namespace test
+} // namespace utils
+} // namespace quids
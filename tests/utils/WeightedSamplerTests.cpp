@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "utils/WeightedSampler.hpp"
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace quids {
+namespace utils {
+namespace test {
+
+TEST(WeightedSamplerTest, FindWalksTheCumulativeRanges) {
+    WeightedSampler sampler;
+    const std::vector<uint64_t> weights{3, 0, 5, 1, 0, 0, 7, 2, 4};
+    for (uint64_t w : weights) {
+        sampler.push_back(w);
+    }
+    EXPECT_EQ(sampler.total(), 22u);
+
+    // Every target lands on the index whose range holds it; zero weights never match
+    uint64_t start = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        for (uint64_t t = start; t < start + weights[i]; ++t) {
+            EXPECT_EQ(sampler.find(t), i) << "target " << t;
+        }
+        start += weights[i];
+    }
+
+    // Updates keep the tree in step, lowering a weight included
+    sampler.set(2, 1);
+    sampler.set(4, 6);
+    EXPECT_EQ(sampler.total(), 24u);
+    EXPECT_EQ(sampler.find(3), 2u);
+    EXPECT_EQ(sampler.find(4), 3u);
+    EXPECT_EQ(sampler.find(5), 4u);
+    EXPECT_EQ(sampler.find(10), 4u);
+    EXPECT_EQ(sampler.find(11), 6u);
+}
+
+TEST(WeightedSamplerTest, SamplesDistinctIndicesAndRestoresWeights) {
+    WeightedSampler sampler;
+    for (uint64_t w : {4, 0, 9, 2, 0, 6}) {
+        sampler.push_back(w);
+    }
+    Philox rng(7, 1);
+    for (int round = 0; round < 50; ++round) {
+        const auto drawn = sampler.sample(rng, 3);
+        ASSERT_EQ(drawn.size(), 3u);
+        EXPECT_EQ(std::set<size_t>(drawn.begin(), drawn.end()).size(), 3u);
+        for (size_t i : drawn) {
+            EXPECT_NE(sampler.weight(i), 0u);
+        }
+    }
+
+    // Only four indices carry weight
+    EXPECT_EQ(sampler.sample(rng, 10).size(), 4u);
+    EXPECT_EQ(sampler.total(), 21u);
+    EXPECT_EQ(sampler.weight(2), 9u);
+}
+
+TEST(WeightedSamplerTest, DrawsFollowWeightsAndReplayExactly) {
+    WeightedSampler sampler;
+    for (uint64_t w : {1, 3, 0, 6}) {
+        sampler.push_back(w);
+    }
+    std::vector<size_t> hits(4, 0);
+    Philox rng(42, 0);
+    constexpr int DRAWS = 20000;
+    for (int i = 0; i < DRAWS; ++i) {
+        hits[sampler.sample(rng, 1).front()]++;
+    }
+    EXPECT_EQ(hits[2], 0u);
+    EXPECT_NEAR(hits[0] / double(DRAWS), 0.1, 0.02);
+    EXPECT_NEAR(hits[1] / double(DRAWS), 0.3, 0.02);
+    EXPECT_NEAR(hits[3] / double(DRAWS), 0.6, 0.02);
+
+    // The same seed and the same weights give the same draw on every node
+    WeightedSampler other;
+    for (uint64_t w : {1, 3, 0, 6}) {
+        other.push_back(w);
+    }
+    Philox a(9, 3);
+    Philox b(9, 3);
+    EXPECT_EQ(sampler.sample(a, 3), other.sample(b, 3));
+}
+
+} // namespace test
+} // namespace utils
+} // namespace quids
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "utils/WorkStealingPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+namespace quids {
+namespace utils {
+namespace test {
+
+namespace {
+
+WorkStealingPool::Config threads(size_t n) {
+    WorkStealingPool::Config config;
+    config.num_threads = n;
+    return config;
+}
+
+} // namespace
+
+TEST(WorkStealingPoolTest, ParallelForRunsEveryIndexOnce) {
+    WorkStealingPool pool(threads(4));
+    std::vector<std::atomic<int>> hits(1000);
+    pool.parallel_for(0, hits.size(), [&](size_t i) { hits[i].fetch_add(1); });
+    for (size_t i = 0; i < hits.size(); ++i) {
+        EXPECT_EQ(hits[i].load(), 1) << i;
+    }
+}
+
+TEST(WorkStealingPoolTest, ThrowingBodyRethrowsOnceEveryChunkHasFinished) {
+    WorkStealingPool pool(threads(4));
+    std::atomic<int> running{0};
+    std::atomic<int> started{0};
+    auto body = [&](size_t i) {
+        running.fetch_add(1);
+        started.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        running.fetch_sub(1);
+        if (i == 0) {
+            throw std::runtime_error("bad index");
+        }
+    };
+
+    EXPECT_THROW(pool.parallel_for(0, 64, body), std::runtime_error);
+    // Nothing may still be using body or the loop's state
+    EXPECT_EQ(running.load(), 0);
+    // The failure stops chunks that had not started
+    EXPECT_LT(started.load(), 64);
+
+    // The pool is still usable and its workers are still alive
+    std::atomic<int> after{0};
+    pool.parallel_for(0, 64, [&](size_t) { after.fetch_add(1); });
+    EXPECT_EQ(after.load(), 64);
+}
+
+TEST(WorkStealingPoolTest, ThrowingPostedTaskDoesNotKillItsWorker) {
+    WorkStealingPool pool(threads(1));
+    pool.post(TaskPriority::Execution, [] { throw std::runtime_error("fire and forget"); });
+    for (int i = 0; i < 1000 && pool.stats().failed == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(pool.stats().failed, 1u);
+    auto value = pool.submit(TaskPriority::Execution, [] { return 42; });
+    EXPECT_EQ(value.get(), 42);
+
+    // submit() still hands the exception to the future
+    auto failing = pool.submit(TaskPriority::Execution, []() -> int { throw std::logic_error("to the caller"); });
+    EXPECT_THROW(failing.get(), std::logic_error);
+}
+
+TEST(WorkStealingPoolTest, WaitingCallerDoesNotPickUpLessUrgentWork) {
+    WorkStealingPool pool(threads(1));
+
+    // Park the only worker so every chunk and task stays queued
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<bool> parked{false};
+    pool.post(TaskPriority::Consensus, [&] {
+        parked.store(true);
+        released.wait();
+    });
+    while (!parked.load()) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> ml_ran{false};
+    pool.post(TaskPriority::ML, [&] { ml_ran.store(true); });
+
+    std::atomic<int> done{0};
+    pool.parallel_for(0, 16, [&](size_t) {
+        EXPECT_FALSE(ml_ran.load());
+        done.fetch_add(1);
+    }, TaskPriority::Consensus);
+    EXPECT_EQ(done.load(), 16);
+    EXPECT_FALSE(ml_ran.load());
+    EXPECT_FALSE(pool.run_one(TaskPriority::Proof));
+
+    release.set_value();
+    for (int i = 0; i < 1000 && !ml_ran.load(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_TRUE(ml_ran.load());
+}
+
+} // namespace test
+} // namespace utils
+} // namespace quids
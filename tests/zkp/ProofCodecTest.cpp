@@ -0,0 +1,103 @@
+#include "zkp/ProofCodec.hpp"
+#include <gtest/gtest.h>
+
+namespace quids::zkp::test {
+
+namespace {
+
+QZKPGenerator::Proof make_proof() {
+    QZKPGenerator::Proof proof;
+    proof.proof_data = {1, 2, 3, 4, 5};
+    proof.commitment = {{0.5, -0.25}, {0.0, 1.0}};
+    for (size_t i = 0; i < 64; ++i) {
+        proof.measurement_qubits.push_back(i % 8);
+        proof.phase_angles.push_back(ProofCodec::quantize_phase(0.1 * static_cast<double>(i)));
+        proof.measurement_outcomes.push_back(i % 3 == 0);
+    }
+    proof.measurement_outcomes.push_back(true);  // 65 outcomes, one padded byte
+    proof.timestamp = std::chrono::system_clock::time_point(std::chrono::microseconds(1700000000123456));
+    proof.is_valid = true;
+    return proof;
+}
+
+void expect_same(const QZKPGenerator::Proof& a, const QZKPGenerator::Proof& b) {
+    EXPECT_EQ(a.proof_data, b.proof_data);
+    EXPECT_EQ(a.commitment, b.commitment);
+    EXPECT_EQ(a.measurement_qubits, b.measurement_qubits);
+    EXPECT_EQ(a.phase_angles, b.phase_angles);
+    EXPECT_EQ(a.measurement_outcomes, b.measurement_outcomes);
+    EXPECT_EQ(a.timestamp, b.timestamp);
+    EXPECT_EQ(a.is_valid, b.is_valid);
+}
+
+} // namespace
+
+TEST(ProofCodecTest, RoundTripsQuantizedProofsExactly) {
+    const auto proof = make_proof();
+    for (auto coding : {ProofCodec::Coding::Raw, ProofCodec::Coding::Zstd}) {
+        const auto encoded = ProofCodec::encode(proof, coding);
+        expect_same(ProofCodec::decode(encoded), proof);
+    }
+}
+
+TEST(ProofCodecTest, IsSmallerThanTheRawFields) {
+    const auto proof = make_proof();
+    const size_t raw = proof.proof_data.size() + proof.commitment.size() * 16 +
+                       proof.measurement_qubits.size() * sizeof(size_t) +
+                       proof.phase_angles.size() * sizeof(double) +
+                       proof.measurement_outcomes.size();
+    const auto encoded = ProofCodec::encode(proof);
+    EXPECT_LT(encoded.size(), raw / 2);
+    EXPECT_LE(ProofCodec::encode(proof, ProofCodec::Coding::Zstd).size(), encoded.size());
+}
+
+TEST(ProofCodecTest, HashIsTheSameForEveryCoding) {
+    const auto proof = make_proof();
+    const auto raw = ProofCodec::encode(proof);
+    auto repetitive = proof;
+    repetitive.proof_data.assign(4096, 0xab);
+    const auto packed = ProofCodec::encode(repetitive, ProofCodec::Coding::Zstd);
+    ASSERT_EQ(packed[1], static_cast<uint8_t>(ProofCodec::Coding::Zstd));
+
+    EXPECT_EQ(ProofCodec::hash(raw), ProofCodec::hash(proof));
+    EXPECT_EQ(ProofCodec::hash(packed), ProofCodec::hash(repetitive));
+    EXPECT_EQ(ProofCodec::hash(packed), ProofCodec::hash(ProofCodec::encode(repetitive)));
+    EXPECT_NE(ProofCodec::hash(raw), ProofCodec::hash(packed));
+}
+
+TEST(ProofCodecTest, WrapsPhasesIntoOneTurn) {
+    EXPECT_DOUBLE_EQ(ProofCodec::quantize_phase(-M_PI / 2), ProofCodec::quantize_phase(3 * M_PI / 2));
+    EXPECT_EQ(ProofCodec::quantize_phase(2 * M_PI), 0.0);
+    EXPECT_NEAR(ProofCodec::quantize_phase(1.0), 1.0, 1e-9);
+}
+
+TEST(ProofCodecTest, RejectsNonCanonicalEncodings) {
+    const auto encoded = ProofCodec::encode(make_proof());
+
+    auto trailing = encoded;
+    trailing.push_back(0);
+    EXPECT_THROW((void)ProofCodec::decode(trailing), std::runtime_error);
+
+    auto padded = encoded;
+    padded.back() |= 0x80;  // past the 65th outcome
+    EXPECT_THROW((void)ProofCodec::decode(padded), std::runtime_error);
+
+    auto truncated = encoded;
+    truncated.resize(truncated.size() / 2);
+    EXPECT_THROW((void)ProofCodec::decode(truncated), std::runtime_error);
+
+    auto version = encoded;
+    version[0] = ProofCodec::VERSION + 1;
+    EXPECT_THROW((void)ProofCodec::decode(version), std::runtime_error);
+}
+
+TEST(ProofCodecTest, KeepsCommitmentProofsApart) {
+    QZKPProof commitment(std::vector<uint8_t>{9, 8, 7});
+    const auto encoded = ProofCodec::encode(commitment);
+    const auto decoded = ProofCodec::decode_commitment(encoded);
+    EXPECT_EQ(decoded.proof_data, commitment.proof_data);
+    EXPECT_EQ(decoded.timestamp, std::chrono::time_point_cast<std::chrono::microseconds>(commitment.timestamp));
+    EXPECT_THROW((void)ProofCodec::decode(encoded), std::runtime_error);
+}
+
+} // namespace quids::zkp::test
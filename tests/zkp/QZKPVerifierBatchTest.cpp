@@ -0,0 +1,70 @@
+#include "zkp/QZKPVerifier.hpp"
+#include <gtest/gtest.h>
+
+namespace quids::zkp::test {
+
+namespace {
+
+// A state with recorded outcomes and a proof that claims them
+std::pair<quantum::QuantumState, QZKPGenerator::Proof> measured(size_t qubits, size_t count) {
+    quantum::QuantumState state(qubits);
+    for (size_t i = 0; i < count; ++i) {
+        state.applyMeasurement(i % qubits);
+    }
+    QZKPGenerator::Proof proof;
+    proof.measurement_outcomes = state.getMeasurementOutcomes();
+    proof.phase_angles = {0.0, 0.1, 0.2, 0.3};
+    proof.is_valid = true;
+    return {std::move(state), std::move(proof)};
+}
+
+} // namespace
+
+TEST(QZKPVerifierBatchTest, MatchesOneByOneVerification) {
+    auto [state, good] = measured(4, 32);
+    auto bad = good;
+    for (size_t i = 0; i < bad.measurement_outcomes.size(); i += 2) {
+        bad.measurement_outcomes[i] = !bad.measurement_outcomes[i];
+    }
+    const std::vector<QZKPGenerator::Proof> proofs{good, bad, good};
+
+    QZKPVerifier verifier;
+    const auto prepared = QZKPVerifier::prepare(state);
+    const auto batch = verifier.verify_batch(*prepared, proofs);
+    ASSERT_EQ(batch.size(), proofs.size());
+    for (size_t i = 0; i < proofs.size(); ++i) {
+        const auto single = verifier.verify_proof(state, proofs[i]);
+        EXPECT_EQ(batch[i].result, single.result);
+        EXPECT_DOUBLE_EQ(batch[i].confidence_score, single.confidence_score);
+        EXPECT_EQ(batch[i].matching_measurements, single.matching_measurements);
+    }
+    EXPECT_EQ(batch[0].result, QZKPVerifier::VerificationResult::VALID);
+    EXPECT_EQ(batch[1].result, QZKPVerifier::VerificationResult::INVALID);
+}
+
+TEST(QZKPVerifierBatchTest, PreparesEachStateOnceAcrossProofs) {
+    auto [first_state, first_proof] = measured(3, 16);
+    auto [second_state, second_proof] = measured(5, 24);
+    const std::vector<const quantum::QuantumState*> states{&first_state, &second_state, &first_state};
+    const std::vector<QZKPGenerator::Proof> proofs{first_proof, second_proof, second_proof};
+
+    QZKPVerifier verifier;
+    const auto results = verifier.verify_batch(states, proofs);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].result, QZKPVerifier::VerificationResult::VALID);
+    EXPECT_EQ(results[1].result, QZKPVerifier::VerificationResult::VALID);
+    EXPECT_EQ(results[2].result, QZKPVerifier::VerificationResult::INVALID);
+
+    EXPECT_THROW((void)verifier.verify_batch(std::span(states).first(2), proofs), std::invalid_argument);
+}
+
+TEST(QZKPVerifierBatchTest, CachesThePhaseTermPerAngleSet) {
+    quantum::QuantumState state(2);
+    PreparedVerifier prepared(state);
+    EXPECT_DOUBLE_EQ(prepared.phase_term({0.0, M_PI}), 0.0);
+    EXPECT_DOUBLE_EQ(prepared.phase_term({0.0, 0.0}), 1.0);
+    EXPECT_DOUBLE_EQ(prepared.phase_term({0.0, M_PI}), 0.0);
+    EXPECT_EQ(prepared.phase_term({}), 0.0);
+}
+
+} // namespace quids::zkp::test
@@ -0,0 +1,53 @@
+#include "zkp/QZKPVerifier.hpp"
+#include <gtest/gtest.h>
+
+namespace quids::zkp::test {
+
+namespace {
+
+using Decision = SequentialMatchTest::Decision;
+
+// Feeds chunks with the given match rate until the test decides
+Decision run(SequentialMatchTest& test, size_t chunk, double rate) {
+    Decision decision = Decision::CONTINUE;
+    double owed = 0.0;
+    while (decision == Decision::CONTINUE) {
+        const size_t n = std::min(chunk, test.population() - test.checked());
+        owed += rate * static_cast<double>(n);
+        const auto matched = static_cast<size_t>(owed);
+        owed -= static_cast<double>(matched);
+        decision = test.update(n, matched);
+    }
+    return decision;
+}
+
+} // namespace
+
+TEST(SequentialMatchTest, AcceptsCleanProofsEarly) {
+    SequentialMatchTest test(0.9, 0.95, 10000, 64);
+    EXPECT_EQ(run(test, 64, 1.0), Decision::ACCEPT);
+    EXPECT_LT(test.checked(), 1000u);
+    EXPECT_GE(test.lower_bound(), 0.9);
+}
+
+TEST(SequentialMatchTest, RejectsBadProofsEarly) {
+    SequentialMatchTest test(0.9, 0.95, 10000, 64);
+    EXPECT_EQ(run(test, 64, 0.5), Decision::REJECT);
+    EXPECT_LT(test.checked(), 1000u);
+}
+
+TEST(SequentialMatchTest, BorderlineRatesCheckEverything) {
+    SequentialMatchTest below(0.9, 0.95, 2000, 64);
+    EXPECT_EQ(run(below, 64, 0.895), Decision::REJECT);
+    SequentialMatchTest above(0.9, 0.95, 2000, 64);
+    EXPECT_EQ(run(above, 64, 0.905), Decision::ACCEPT);
+    EXPECT_GT(above.checked(), 1000u);
+
+    // With no tolerance only a full check can accept
+    SequentialMatchTest strict(1.0, 0.99, 500, 64);
+    EXPECT_EQ(run(strict, 64, 1.0), Decision::ACCEPT);
+    EXPECT_EQ(strict.checked(), 500u);
+    EXPECT_THROW(SequentialMatchTest(0.9, 1.0, 10, 1), std::invalid_argument);
+}
+
+} // namespace quids::zkp::test